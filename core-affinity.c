@@ -28,6 +28,35 @@ static const char option[] = "taskset";
 #if defined(HAVE_SCHED_SETAFFINITY)
 
 static cpu_set_t stress_affinity_cpu_set;
+static cpu_set_t stress_victim_cpu_set;	/* --victim-taskset CPUs */
+static bool stress_victim_cpu_set_valid;
+
+typedef enum {
+	STRESS_PLACEMENT_NONE = 0,
+	STRESS_PLACEMENT_COMPACT,
+	STRESS_PLACEMENT_SCATTER,
+	STRESS_PLACEMENT_PER_LLC,
+	STRESS_PLACEMENT_PER_NUMA,
+	STRESS_PLACEMENT_SMT_PAIR,
+} stress_placement_policy_t;
+
+typedef struct {
+	const char *name;
+	const stress_placement_policy_t policy;
+} stress_placement_info_t;
+
+static const stress_placement_info_t placement_policies[] = {
+	{ "none",	STRESS_PLACEMENT_NONE },
+	{ "compact",	STRESS_PLACEMENT_COMPACT },
+	{ "scatter",	STRESS_PLACEMENT_SCATTER },
+	{ "per-llc",	STRESS_PLACEMENT_PER_LLC },
+	{ "per-numa",	STRESS_PLACEMENT_PER_NUMA },
+	{ "smt-pair",	STRESS_PLACEMENT_SMT_PAIR },
+};
+
+static stress_placement_policy_t placement_policy = STRESS_PLACEMENT_NONE;
+static cpu_set_t *placement_sets;	/* CPU set per placement slot */
+static int32_t placement_count;		/* number of placement slots */
 
 /*
  * stress_check_cpu_affinity_range()
@@ -35,12 +64,13 @@ static cpu_set_t stress_affinity_cpu_set;
  * @cpu: cpu number to check
  */
 static void stress_check_cpu_affinity_range(
+	const char *name,
 	const int32_t max_cpus,
 	const int32_t cpu)
 {
 	if ((cpu < 0) || ((max_cpus != -1) && (cpu >= max_cpus))) {
 		(void)fprintf(stderr, "%s: invalid range, %" PRId32 " is not allowed, "
-			"allowed range: 0 to %" PRId32 "\n", option,
+			"allowed range: 0 to %" PRId32 "\n", name,
 			cpu, max_cpus - 1);
 		_exit(EXIT_FAILURE);
 	}
@@ -52,30 +82,31 @@ static void stress_check_cpu_affinity_range(
  *
  * Returns: cpu number, or exits the program on invalid number in str
  */
-static int stress_parse_cpu(const char *const str)
+static int stress_parse_cpu(const char *name, const char *const str)
 {
 	int val;
 
 	if (sscanf(str, "%d", &val) != 1) {
-		(void)fprintf(stderr, "%s: invalid number '%s'\n", option, str);
+		(void)fprintf(stderr, "%s: invalid number '%s'\n", name, str);
 		_exit(EXIT_FAILURE);
 	}
 	return val;
 }
 
 /*
- * stress_set_cpu_affinity()
- * @arg: list of CPUs to set affinity to, comma separated
+ * stress_parse_cpu_set()
+ * @name: option name for error messages
+ * @arg: list of CPUs, comma separated, with optional N-M ranges
+ * @set: CPU set to fill in
  *
- * Returns: 0 - OK
+ * Exits the program on an invalid list
  */
-int stress_set_cpu_affinity(const char *arg)
+static void stress_parse_cpu_set(const char *name, const char *arg, cpu_set_t *set)
 {
-	cpu_set_t set;
 	char *str, *ptr, *token;
 	const int32_t max_cpus = stress_get_processors_configured();
 
-	CPU_ZERO(&set);
+	CPU_ZERO(set);
 
 	str = stress_const_optdup(arg);
 	if (!str) {
@@ -87,43 +118,105 @@ int stress_set_cpu_affinity(const char *arg)
 		int i, lo, hi;
 		char *tmpptr = strstr(token, "-");
 
-		hi = lo = stress_parse_cpu(token);
+		hi = lo = stress_parse_cpu(name, token);
 		if (tmpptr) {
 			tmpptr++;
 			if (*tmpptr)
-				hi = stress_parse_cpu(tmpptr);
+				hi = stress_parse_cpu(name, tmpptr);
 			else {
 				(void)fprintf(stderr, "%s: expecting number following "
-					"'-' in '%s'\n", option, token);
+					"'-' in '%s'\n", name, token);
 				free(str);
 				_exit(EXIT_FAILURE);
 			}
 			if (hi < lo) {
 				(void)fprintf(stderr, "%s: invalid range in '%s' "
 					"(end value must be larger than "
-					"start value\n", option, token);
+					"start value\n", name, token);
 				free(str);
 				_exit(EXIT_FAILURE);
 			}
 		}
-		stress_check_cpu_affinity_range(max_cpus, lo);
-		stress_check_cpu_affinity_range(max_cpus, hi);
+		stress_check_cpu_affinity_range(name, max_cpus, lo);
+		stress_check_cpu_affinity_range(name, max_cpus, hi);
 
 		for (i = lo; i <= hi; i++)
-			CPU_SET(i, &set);
+			CPU_SET(i, set);
 	}
+	free(str);
+}
+
+/*
+ * stress_set_cpu_affinity()
+ * @arg: list of CPUs to set affinity to, comma separated
+ *
+ * Returns: 0 - OK
+ */
+int stress_set_cpu_affinity(const char *arg)
+{
+	cpu_set_t set;
+
+	stress_parse_cpu_set(option, arg, &set);
 	if (sched_setaffinity(getpid(), sizeof(set), &set) < 0) {
 		pr_err("%s: cannot set CPU affinity, errno=%d (%s)\n",
 			option, errno, strerror(errno));
-		free(str);
 		_exit(EXIT_FAILURE);
 	}
 	shim_memcpy(&stress_affinity_cpu_set, &set, sizeof(stress_affinity_cpu_set));
 
-	free(str);
 	return 0;
 }
 
+/*
+ * stress_set_victim_taskset()
+ * @arg: list of CPUs to run the --victim stressor on, comma separated
+ *
+ * Returns: 0 - OK
+ */
+int stress_set_victim_taskset(const char *arg)
+{
+	stress_parse_cpu_set("victim-taskset", arg, &stress_victim_cpu_set);
+	if (CPU_COUNT(&stress_victim_cpu_set) == 0) {
+		(void)fprintf(stderr, "victim-taskset: no CPUs specified\n");
+		_exit(EXIT_FAILURE);
+	}
+	stress_victim_cpu_set_valid = true;
+	return 0;
+}
+
+/*
+ *  stress_victim_taskset_set()
+ *	pin the calling instance of the --victim stressor to the
+ *	--victim-taskset CPUs and instances of the aggressor stressors
+ *	to the rest of the CPUs they are allowed to run on, aggressors
+ *	are left as they are if there are no CPUs left for them
+ */
+void stress_victim_taskset_set(const char *name, const bool victim)
+{
+	cpu_set_t set;
+	int cpu;
+
+	if (!stress_victim_cpu_set_valid)
+		return;
+
+	if (victim) {
+		shim_memcpy(&set, &stress_victim_cpu_set, sizeof(set));
+	} else {
+		if (sched_getaffinity(0, sizeof(set), &set) < 0)
+			return;
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &stress_victim_cpu_set))
+				CPU_CLR(cpu, &set);
+		}
+		if (CPU_COUNT(&set) == 0)
+			return;
+	}
+	if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+		pr_dbg("%s: cannot set victim-taskset CPU affinity, errno=%d (%s)\n",
+			name, errno, strerror(errno));
+	}
+}
+
 /*
  *  stress_change_cpu()
  *	try and change process to a different CPU.
@@ -168,6 +261,394 @@ int stress_change_cpu(stress_args_t *args, const int old_cpu)
 	return (int)from_cpu;
 }
 
+
+/*
+ *  stress_placement_cpulist()
+ *	parse a sysfs CPU list such as 0-3,8-11 into set,
+ *	returns the number of CPUs or -1 if it cannot be read
+ */
+static int stress_placement_cpulist(const char *path, cpu_set_t *set)
+{
+	char buf[4096], *ptr;
+
+	CPU_ZERO(set);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return -1;
+
+	for (ptr = buf; *ptr; ) {
+		char *end;
+		long int lo, hi, i;
+
+		lo = strtol(ptr, &end, 10);
+		if (end == ptr)
+			break;
+		hi = lo;
+		ptr = end;
+		if (*ptr == '-') {
+			ptr++;
+			hi = strtol(ptr, &end, 10);
+			if (end == ptr)
+				break;
+			ptr = end;
+		}
+		for (i = lo; (i <= hi) && (i < CPU_SETSIZE); i++)
+			if (i >= 0)
+				CPU_SET((int)i, set);
+		if (*ptr != ',')
+			break;
+		ptr++;
+	}
+	return CPU_COUNT(set);
+}
+
+/*
+ *  stress_placement_first()
+ *	lowest CPU in set, -1 if set is empty
+ */
+static int32_t stress_placement_first(const cpu_set_t *set)
+{
+	int32_t cpu;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, set))
+			return cpu;
+	return -1;
+}
+
+/*
+ *  stress_placement_topology()
+ *	fill in the package, LLC, core, SMT thread and NUMA node of a CPU,
+ *	topology that can't be read defaults to one package, LLC and node
+ */
+void stress_placement_topology(stress_placement_cpu_t *pc, const int32_t cpu)
+{
+	char path[PATH_MAX], buf[64];
+	cpu_set_t set;
+	int32_t i, level = -1;
+
+	pc->cpu = cpu;
+	pc->node = 0;
+	pc->package = 0;
+	pc->llc = -1;
+	pc->core = cpu;
+	pc->thread = 0;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/topology/physical_package_id", cpu);
+	if (stress_system_read(path, buf, sizeof(buf)) > 0)
+		pc->package = atoi(buf);
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", cpu);
+	if (stress_placement_cpulist(path, &set) > 0) {
+		pc->core = stress_placement_first(&set);
+		for (i = 0; i < cpu; i++)
+			if (CPU_ISSET(i, &set))
+				pc->thread++;
+	}
+
+	/* the last level cache is the highest level data or unified cache */
+	for (i = 0; i < 16; i++) {
+		int32_t cache_level;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%" PRId32 "/type", cpu, i);
+		if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+			break;
+		if (!strncmp(buf, "Instruction", 11))
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%" PRId32 "/level", cpu, i);
+		if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+			continue;
+		cache_level = atoi(buf);
+		if (cache_level <= level)
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%" PRId32 "/shared_cpu_list", cpu, i);
+		if (stress_placement_cpulist(path, &set) > 0) {
+			level = cache_level;
+			pc->llc = stress_placement_first(&set);
+		}
+	}
+	/* no cache information, assume one LLC per package */
+	if (pc->llc < 0)
+		pc->llc = -1 - pc->package;
+}
+
+/*
+ *  stress_placement_compact_cmp()
+ *	sort CPUs so that SMT siblings, cores sharing a LLC, LLCs of
+ *	a package and packages of a node are adjacent
+ */
+static int stress_placement_compact_cmp(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *pc1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *pc2 = (const stress_placement_cpu_t *)p2;
+
+	if (pc1->node != pc2->node)
+		return (pc1->node < pc2->node) ? -1 : 1;
+	if (pc1->package != pc2->package)
+		return (pc1->package < pc2->package) ? -1 : 1;
+	if (pc1->llc != pc2->llc)
+		return (pc1->llc < pc2->llc) ? -1 : 1;
+	if (pc1->core != pc2->core)
+		return (pc1->core < pc2->core) ? -1 : 1;
+	if (pc1->thread != pc2->thread)
+		return (pc1->thread < pc2->thread) ? -1 : 1;
+	return (pc1->cpu < pc2->cpu) ? -1 : (pc1->cpu > pc2->cpu);
+}
+
+/*
+ *  stress_placement_scatter_cmp()
+ *	sort CPUs so that adjacent CPUs are as far apart as possible,
+ *	one SMT thread per core first, round robin over the nodes and LLCs
+ */
+static int stress_placement_scatter_cmp(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *pc1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *pc2 = (const stress_placement_cpu_t *)p2;
+
+	if (pc1->thread != pc2->thread)
+		return (pc1->thread < pc2->thread) ? -1 : 1;
+	if (pc1->core_rank != pc2->core_rank)
+		return (pc1->core_rank < pc2->core_rank) ? -1 : 1;
+	if (pc1->llc_rank != pc2->llc_rank)
+		return (pc1->llc_rank < pc2->llc_rank) ? -1 : 1;
+	if (pc1->node != pc2->node)
+		return (pc1->node < pc2->node) ? -1 : 1;
+	return (pc1->cpu < pc2->cpu) ? -1 : (pc1->cpu > pc2->cpu);
+}
+
+/*
+ *  stress_set_placement()
+ *	parse --placement option
+ */
+int stress_set_placement(const char *arg)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(placement_policies); i++) {
+		if (!strcmp(arg, placement_policies[i].name)) {
+			placement_policy = placement_policies[i].policy;
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "placement must be one of:");
+	for (i = 1; i < SIZEOF_ARRAY(placement_policies); i++)
+		(void)fprintf(stderr, " %s", placement_policies[i].name);
+	(void)fprintf(stderr, "\n");
+	_exit(EXIT_FAILURE);
+}
+
+/*
+ *  stress_placement_add()
+ *	add a CPU set to the placement table
+ */
+static void stress_placement_add(const cpu_set_t *set)
+{
+	shim_memcpy(&placement_sets[placement_count], set, sizeof(*set));
+	placement_count++;
+}
+
+/*
+ *  stress_placement_init()
+ *	read the topology of the usable CPUs and build the table of CPU
+ *	sets that --placement assigns to stressor instances, instance j
+ *	of each stressor is placed on set j modulo the number of sets
+ */
+int stress_placement_init(void)
+{
+	stress_placement_cpu_t *cpus;
+	cpu_set_t allowed, set;
+	int32_t cpu, n = 0, i, j;
+	DIR *dir;
+
+	if (placement_policy == STRESS_PLACEMENT_NONE)
+		return 0;
+
+	if (CPU_COUNT(&stress_affinity_cpu_set) > 0) {
+		shim_memcpy(&allowed, &stress_affinity_cpu_set, sizeof(allowed));
+	} else if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+		pr_err("placement: cannot get CPU affinity, errno=%d (%s)\n",
+			errno, strerror(errno));
+		return -1;
+	}
+
+	cpus = (stress_placement_cpu_t *)calloc((size_t)CPU_COUNT(&allowed), sizeof(*cpus));
+	/* smt-pair can use two sets per CPU on systems without SMT */
+	placement_sets = (cpu_set_t *)calloc(2 * (size_t)CPU_COUNT(&allowed), sizeof(*placement_sets));
+	if (!cpus || !placement_sets) {
+		pr_err("placement: cannot allocate CPU topology table\n");
+		free(cpus);
+		stress_placement_free();
+		return -1;
+	}
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed))
+			stress_placement_topology(&cpus[n++], cpu);
+	}
+
+	/* map CPUs to NUMA nodes */
+	dir = opendir("/sys/devices/system/node");
+	if (dir) {
+		const struct dirent *d;
+
+		while ((d = readdir(dir)) != NULL) {
+			char path[PATH_MAX];
+			int node;
+
+			if (strncmp(d->d_name, "node", 4) || !isdigit((unsigned char)d->d_name[4]))
+				continue;
+			node = atoi(d->d_name + 4);
+			(void)snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", d->d_name);
+			if (stress_placement_cpulist(path, &set) <= 0)
+				continue;
+			for (i = 0; i < n; i++)
+				if (CPU_ISSET(cpus[i].cpu, &set))
+					cpus[i].node = node;
+		}
+		(void)closedir(dir);
+	}
+
+	/* rank of each LLC within its node and each core within its LLC */
+	qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_compact_cmp);
+	for (i = 0; i < n; i++) {
+		if (i == 0) {
+			cpus[i].llc_rank = 0;
+			cpus[i].core_rank = 0;
+			continue;
+		}
+		if (cpus[i].node != cpus[i - 1].node) {
+			cpus[i].llc_rank = 0;
+			cpus[i].core_rank = 0;
+		} else if (cpus[i].llc != cpus[i - 1].llc) {
+			cpus[i].llc_rank = cpus[i - 1].llc_rank + 1;
+			cpus[i].core_rank = 0;
+		} else {
+			cpus[i].llc_rank = cpus[i - 1].llc_rank;
+			cpus[i].core_rank = cpus[i - 1].core_rank +
+				(cpus[i].core != cpus[i - 1].core);
+		}
+	}
+
+	switch (placement_policy) {
+	case STRESS_PLACEMENT_COMPACT:
+		for (i = 0; i < n; i++) {
+			CPU_ZERO(&set);
+			CPU_SET(cpus[i].cpu, &set);
+			stress_placement_add(&set);
+		}
+		break;
+	case STRESS_PLACEMENT_SCATTER:
+		qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_scatter_cmp);
+		for (i = 0; i < n; i++) {
+			CPU_ZERO(&set);
+			CPU_SET(cpus[i].cpu, &set);
+			stress_placement_add(&set);
+		}
+		break;
+	case STRESS_PLACEMENT_SMT_PAIR:
+		/* pairs of instances on the first two SMT threads of scattered cores */
+		qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_scatter_cmp);
+		for (i = 0; (i < n) && (cpus[i].thread == 0); i++) {
+			int32_t sibling = cpus[i].cpu;
+
+			for (j = 0; j < n; j++) {
+				if ((cpus[j].core == cpus[i].core) && (cpus[j].thread == 1)) {
+					sibling = cpus[j].cpu;
+					break;
+				}
+			}
+			CPU_ZERO(&set);
+			CPU_SET(cpus[i].cpu, &set);
+			stress_placement_add(&set);
+			CPU_ZERO(&set);
+			CPU_SET(sibling, &set);
+			stress_placement_add(&set);
+		}
+		break;
+	case STRESS_PLACEMENT_PER_LLC:
+	case STRESS_PLACEMENT_PER_NUMA:
+		/* one set per LLC or node, LLCs are taken round robin over the nodes */
+		qsort(cpus, (size_t)n, sizeof(*cpus), stress_placement_scatter_cmp);
+		for (i = 0; i < n; i++) {
+			bool seen = false;
+
+			for (j = 0; j < i; j++) {
+				if ((placement_policy == STRESS_PLACEMENT_PER_LLC) ?
+				    (cpus[j].llc == cpus[i].llc) : (cpus[j].node == cpus[i].node)) {
+					seen = true;
+					break;
+				}
+			}
+			if (seen)
+				continue;
+			CPU_ZERO(&set);
+			for (j = 0; j < n; j++) {
+				if ((placement_policy == STRESS_PLACEMENT_PER_LLC) ?
+				    (cpus[j].llc == cpus[i].llc) : (cpus[j].node == cpus[i].node))
+					CPU_SET(cpus[j].cpu, &set);
+			}
+			stress_placement_add(&set);
+		}
+		break;
+	default:
+		break;
+	}
+	free(cpus);
+
+	pr_dbg("placement: %" PRId32 " CPU sets for %" PRId32 " usable CPUs\n",
+		placement_count, n);
+	return 0;
+}
+
+/*
+ *  stress_placement_free()
+ *	free the placement table
+ */
+void stress_placement_free(void)
+{
+	free(placement_sets);
+	placement_sets = NULL;
+	placement_count = 0;
+}
+
+/*
+ *  stress_placement_set()
+ *	pin the calling stressor instance to its --placement CPU set
+ */
+void stress_placement_set(const char *name, const int32_t instance)
+{
+	const cpu_set_t *set;
+
+	if ((placement_count == 0) || (instance < 0))
+		return;
+
+	set = &placement_sets[instance % placement_count];
+	if (sched_setaffinity(0, sizeof(*set), set) < 0) {
+		pr_dbg("%s: cannot set placement CPU affinity, errno=%d (%s)\n",
+			name, errno, strerror(errno));
+	}
+}
+
+/*
+ *  stress_node_affinity_set()
+ *	pin the calling thread to the CPUs of a NUMA node,
+ *	returns 0 on success, -1 if it cannot be pinned
+ */
+int stress_node_affinity_set(const int node)
+{
+	char path[PATH_MAX];
+	cpu_set_t set;
+
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	if (stress_placement_cpulist(path, &set) <= 0)
+		return -1;
+	return (sched_setaffinity(0, sizeof(set), &set) < 0) ? -1 : 0;
+}
+
 #else
 int stress_change_cpu(stress_args_t *args, const int old_cpu)
 {
@@ -184,4 +665,56 @@ int stress_set_cpu_affinity(const char *arg)
 	(void)fprintf(stderr, "%s: setting CPU affinity not supported\n", option);
 	_exit(EXIT_FAILURE);
 }
+
+int stress_set_victim_taskset(const char *arg)
+{
+	(void)arg;
+
+	(void)fprintf(stderr, "victim-taskset: setting CPU affinity not supported\n");
+	_exit(EXIT_FAILURE);
+}
+
+void stress_victim_taskset_set(const char *name, const bool victim)
+{
+	(void)name;
+	(void)victim;
+}
+
+int stress_set_placement(const char *arg)
+{
+	(void)arg;
+
+	(void)fprintf(stderr, "placement: setting CPU affinity not supported\n");
+	_exit(EXIT_FAILURE);
+}
+
+int stress_placement_init(void)
+{
+	return 0;
+}
+
+void stress_placement_free(void)
+{
+}
+
+void stress_placement_set(const char *name, const int32_t instance)
+{
+	(void)name;
+	(void)instance;
+}
+
+int stress_node_affinity_set(const int node)
+{
+	(void)node;
+
+	return -1;
+}
+
+void stress_placement_topology(stress_placement_cpu_t *pc, const int32_t cpu)
+{
+	(void)shim_memset(pc, 0, sizeof(*pc));
+	pc->cpu = cpu;
+	pc->llc = -1;
+	pc->core = cpu;
+}
 #endif
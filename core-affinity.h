@@ -19,7 +19,27 @@
 #ifndef CORE_AFFINITY_H
 #define CORE_AFFINITY_H
 
+/* topology of a usable CPU */
+typedef struct {
+	int32_t cpu;		/* CPU number */
+	int32_t node;		/* NUMA node */
+	int32_t package;	/* physical package id */
+	int32_t llc;		/* lowest CPU sharing the last level cache */
+	int32_t core;		/* lowest SMT sibling CPU */
+	int32_t thread;		/* SMT thread number in core */
+	int32_t llc_rank;	/* LLC number within the node */
+	int32_t core_rank;	/* core number within the LLC */
+} stress_placement_cpu_t;
+
 extern int stress_set_cpu_affinity(const char *arg);
 extern int stress_change_cpu(stress_args_t *args, const int old_cpu);
+extern int stress_set_placement(const char *arg);
+extern int stress_placement_init(void);
+extern void stress_placement_free(void);
+extern void stress_placement_set(const char *name, const int32_t instance);
+extern void stress_placement_topology(stress_placement_cpu_t *pc, const int32_t cpu);
+extern int stress_node_affinity_set(const int node);
+extern int stress_set_victim_taskset(const char *arg);
+extern void stress_victim_taskset_set(const char *name, const bool victim);
 
 #endif
@@ -0,0 +1,690 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-art.h"
+#include "core-builtin.h"
+
+#if defined(HAVE_IMMINTRIN_H) &&	\
+    defined(__SSE2__)
+#include <immintrin.h>
+#define HAVE_ART_SSE2	(1)
+#endif
+
+#define ART_KEY_BYTES	(8)
+
+#define ART_NODE4	(0)
+#define ART_NODE16	(1)
+#define ART_NODE48	(2)
+#define ART_NODE256	(3)
+
+/* leaves are tagged with the bottom pointer bit */
+#define ART_IS_LEAF(p)	(((uintptr_t)(p)) & 1)
+#define ART_LEAF(p)	((art_leaf_t *)(((uintptr_t)(p)) & ~(uintptr_t)1))
+#define ART_TAG(p)	((void *)(((uintptr_t)(p)) | 1))
+
+typedef struct {
+	uint8_t type;			/* ART_NODE* */
+	uint8_t prefix_len;		/* compressed path length */
+	uint16_t n_children;
+	uint8_t prefix[ART_KEY_BYTES];	/* compressed path key bytes */
+} art_node_t;
+
+typedef struct {
+	art_node_t n;
+	uint8_t keys[4];		/* sorted key bytes */
+	void *children[4];
+} art_node4_t;
+
+typedef struct {
+	art_node_t n;
+	uint8_t keys[16];		/* sorted key bytes, searched with SIMD */
+	void *children[16];
+} art_node16_t;
+
+typedef struct {
+	art_node_t n;
+	uint8_t child_index[256];	/* key byte to children index + 1, 0 = none */
+	void *children[48];
+} art_node48_t;
+
+typedef struct {
+	art_node_t n;
+	void *children[256];		/* indexed by key byte */
+} art_node256_t;
+
+typedef struct {
+	uint64_t key;
+	uint64_t value;
+} art_leaf_t;
+
+static const size_t art_node_sizes[] = {
+	sizeof(art_node4_t),
+	sizeof(art_node16_t),
+	sizeof(art_node48_t),
+	sizeof(art_node256_t),
+};
+
+static inline uint8_t art_key_byte(const uint64_t key, const size_t depth)
+{
+	return (uint8_t)(key >> (56 - (depth * 8)));
+}
+
+static art_node_t *art_node_new(stress_art_t *art, const uint8_t type)
+{
+	art_node_t *node;
+
+	node = (art_node_t *)calloc(1, art_node_sizes[type]);
+	if (UNLIKELY(!node))
+		return NULL;
+	node->type = type;
+	art->bytes += art_node_sizes[type];
+	return node;
+}
+
+static void art_node_free(stress_art_t *art, art_node_t *node)
+{
+	art->bytes -= art_node_sizes[node->type];
+	free(node);
+}
+
+/*
+ *  art_node_replace()
+ *	allocate a node of a new type with the header of an old one
+ */
+static art_node_t *art_node_replace(stress_art_t *art, const art_node_t *old, const uint8_t type)
+{
+	art_node_t *node = art_node_new(art, type);
+
+	if (UNLIKELY(!node))
+		return NULL;
+	node->prefix_len = old->prefix_len;
+	node->n_children = old->n_children;
+	(void)shim_memcpy(node->prefix, old->prefix, sizeof(node->prefix));
+	return node;
+}
+
+static art_leaf_t *art_leaf_new(stress_art_t *art, const uint64_t key, const uint64_t value)
+{
+	art_leaf_t *leaf;
+
+	leaf = (art_leaf_t *)malloc(sizeof(*leaf));
+	if (UNLIKELY(!leaf))
+		return NULL;
+	leaf->key = key;
+	leaf->value = value;
+	art->bytes += sizeof(*leaf);
+	art->count++;
+	return leaf;
+}
+
+static void art_leaf_free(stress_art_t *art, art_leaf_t *leaf)
+{
+	art->bytes -= sizeof(*leaf);
+	art->count--;
+	free(leaf);
+}
+
+/*
+ *  art_prefix_mismatch()
+ *	index of the first compressed path byte that differs from
+ *	the key, prefix_len if they all match
+ */
+static inline size_t OPTIMIZE3 art_prefix_mismatch(
+	const art_node_t *node,
+	const uint64_t key,
+	const size_t depth)
+{
+	register size_t i;
+
+	for (i = 0; i < node->prefix_len; i++) {
+		if (node->prefix[i] != art_key_byte(key, depth + i))
+			return i;
+	}
+	return i;
+}
+
+/*
+ *  art_node16_find()
+ *	index of key byte b in a node16, -1 if not found
+ */
+static inline int OPTIMIZE3 art_node16_find(const art_node16_t *n16, const uint8_t b)
+{
+#if defined(HAVE_ART_SSE2)
+	const __m128i keys = _mm_loadu_si128((const __m128i *)n16->keys);
+	const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8((char)b))) &
+		((1U << n16->n.n_children) - 1);
+
+	if (!mask)
+		return -1;
+#if defined(HAVE_BUILTIN_CTZ)
+	return __builtin_ctz(mask);
+#else
+	{
+		register int i = 0;
+
+		while (!(mask & (1U << i)))
+			i++;
+		return i;
+	}
+#endif
+#else
+	register int i;
+
+	for (i = 0; i < (int)n16->n.n_children; i++) {
+		if (n16->keys[i] == b)
+			return i;
+	}
+	return -1;
+#endif
+}
+
+/*
+ *  art_find_child()
+ *	find the child slot for key byte b, NULL if there is none
+ */
+static inline void OPTIMIZE3 **art_find_child(art_node_t *node, const uint8_t b)
+{
+	switch (node->type) {
+	case ART_NODE4: {
+			art_node4_t *n4 = (art_node4_t *)node;
+			register size_t i;
+
+			for (i = 0; i < node->n_children; i++) {
+				if (n4->keys[i] == b)
+					return &n4->children[i];
+			}
+			return NULL;
+		}
+	case ART_NODE16: {
+			art_node16_t *n16 = (art_node16_t *)node;
+			const int i = art_node16_find(n16, b);
+
+			return (i < 0) ? NULL : &n16->children[i];
+		}
+	case ART_NODE48: {
+			art_node48_t *n48 = (art_node48_t *)node;
+			const uint8_t i = n48->child_index[b];
+
+			return i ? &n48->children[i - 1] : NULL;
+		}
+	default: {
+			art_node256_t *n256 = (art_node256_t *)node;
+
+			return n256->children[b] ? &n256->children[b] : NULL;
+		}
+	}
+}
+
+/*
+ *  art_sorted_add()
+ *	add a child into sorted key and child arrays that have room
+ */
+static inline void art_sorted_add(
+	uint8_t *keys,
+	void **children,
+	const size_t n,
+	const uint8_t b,
+	void *child)
+{
+	register size_t i;
+
+	for (i = 0; (i < n) && (keys[i] < b); i++)
+		;
+	(void)shim_memmove(keys + i + 1, keys + i, n - i);
+	(void)shim_memmove(children + i + 1, children + i, (n - i) * sizeof(*children));
+	keys[i] = b;
+	children[i] = child;
+}
+
+/*
+ *  art_add_child()
+ *	add child for key byte b, growing the node to the next
+ *	larger type if it is full, ref is the parent's pointer to node
+ */
+static int art_add_child(
+	stress_art_t *art,
+	void **ref,
+	art_node_t *node,
+	const uint8_t b,
+	void *child)
+{
+	art_node_t *grown;
+	size_t i;
+
+	switch (node->type) {
+	case ART_NODE4: {
+			art_node4_t *n4 = (art_node4_t *)node;
+			art_node16_t *n16;
+
+			if (node->n_children < 4) {
+				art_sorted_add(n4->keys, n4->children, node->n_children, b, child);
+				node->n_children++;
+				return 0;
+			}
+			grown = art_node_replace(art, node, ART_NODE16);
+			if (UNLIKELY(!grown))
+				return -1;
+			n16 = (art_node16_t *)grown;
+			(void)shim_memcpy(n16->keys, n4->keys, sizeof(n4->keys));
+			(void)shim_memcpy(n16->children, n4->children, sizeof(n4->children));
+			break;
+		}
+	case ART_NODE16: {
+			art_node16_t *n16 = (art_node16_t *)node;
+			art_node48_t *n48;
+
+			if (node->n_children < 16) {
+				art_sorted_add(n16->keys, n16->children, node->n_children, b, child);
+				node->n_children++;
+				return 0;
+			}
+			grown = art_node_replace(art, node, ART_NODE48);
+			if (UNLIKELY(!grown))
+				return -1;
+			n48 = (art_node48_t *)grown;
+			for (i = 0; i < 16; i++) {
+				n48->children[i] = n16->children[i];
+				n48->child_index[n16->keys[i]] = (uint8_t)(i + 1);
+			}
+			break;
+		}
+	case ART_NODE48: {
+			art_node48_t *n48 = (art_node48_t *)node;
+			art_node256_t *n256;
+
+			if (node->n_children < 48) {
+				for (i = 0; n48->children[i]; i++)
+					;
+				n48->children[i] = child;
+				n48->child_index[b] = (uint8_t)(i + 1);
+				node->n_children++;
+				return 0;
+			}
+			grown = art_node_replace(art, node, ART_NODE256);
+			if (UNLIKELY(!grown))
+				return -1;
+			n256 = (art_node256_t *)grown;
+			for (i = 0; i < 256; i++) {
+				if (n48->child_index[i])
+					n256->children[i] = n48->children[n48->child_index[i] - 1];
+			}
+			break;
+		}
+	default: {
+			art_node256_t *n256 = (art_node256_t *)node;
+
+			n256->children[b] = child;
+			node->n_children++;
+			return 0;
+		}
+	}
+	*ref = grown;
+	art_node_free(art, node);
+	return art_add_child(art, ref, grown, b, child);
+}
+
+/*
+ *  art_remove_child()
+ *	remove the child at slot for key byte b, shrinking the node
+ *	to the next smaller type when it gets sparse, a node4 left
+ *	with one child is merged with that child
+ */
+static void art_remove_child(
+	stress_art_t *art,
+	void **ref,
+	art_node_t *node,
+	const uint8_t b,
+	void **slot)
+{
+	art_node_t *shrunk = NULL;
+	size_t i, j;
+
+	switch (node->type) {
+	case ART_NODE4: {
+			art_node4_t *n4 = (art_node4_t *)node;
+			void *child;
+
+			i = (size_t)(slot - n4->children);
+			(void)shim_memmove(n4->keys + i, n4->keys + i + 1, node->n_children - 1 - i);
+			(void)shim_memmove(n4->children + i, n4->children + i + 1,
+				(node->n_children - 1 - i) * sizeof(*n4->children));
+			node->n_children--;
+			if (node->n_children > 1)
+				return;
+			/* one child left, fold this node's path into the child */
+			child = n4->children[0];
+			if (!ART_IS_LEAF(child)) {
+				art_node_t *c = (art_node_t *)child;
+				uint8_t prefix[ART_KEY_BYTES * 2];
+				size_t len = node->prefix_len;
+
+				(void)shim_memcpy(prefix, node->prefix, len);
+				prefix[len++] = n4->keys[0];
+				(void)shim_memcpy(prefix + len, c->prefix, c->prefix_len);
+				len += c->prefix_len;
+				(void)shim_memcpy(c->prefix, prefix, STRESS_MINIMUM(len, (size_t)ART_KEY_BYTES));
+				c->prefix_len = (uint8_t)len;
+			}
+			*ref = child;
+			art_node_free(art, node);
+			return;
+		}
+	case ART_NODE16: {
+			art_node16_t *n16 = (art_node16_t *)node;
+			art_node4_t *n4;
+
+			i = (size_t)(slot - n16->children);
+			(void)shim_memmove(n16->keys + i, n16->keys + i + 1, node->n_children - 1 - i);
+			(void)shim_memmove(n16->children + i, n16->children + i + 1,
+				(node->n_children - 1 - i) * sizeof(*n16->children));
+			node->n_children--;
+			if (node->n_children > 3)
+				return;
+			shrunk = art_node_replace(art, node, ART_NODE4);
+			if (UNLIKELY(!shrunk))
+				return;
+			n4 = (art_node4_t *)shrunk;
+			(void)shim_memcpy(n4->keys, n16->keys, node->n_children);
+			(void)shim_memcpy(n4->children, n16->children, node->n_children * sizeof(*n4->children));
+			break;
+		}
+	case ART_NODE48: {
+			art_node48_t *n48 = (art_node48_t *)node;
+			art_node16_t *n16;
+
+			n48->children[n48->child_index[b] - 1] = NULL;
+			n48->child_index[b] = 0;
+			node->n_children--;
+			if (node->n_children > 12)
+				return;
+			shrunk = art_node_replace(art, node, ART_NODE16);
+			if (UNLIKELY(!shrunk))
+				return;
+			n16 = (art_node16_t *)shrunk;
+			for (i = 0, j = 0; i < 256; i++) {
+				if (n48->child_index[i]) {
+					n16->keys[j] = (uint8_t)i;
+					n16->children[j] = n48->children[n48->child_index[i] - 1];
+					j++;
+				}
+			}
+			break;
+		}
+	default: {
+			art_node256_t *n256 = (art_node256_t *)node;
+			art_node48_t *n48;
+
+			(void)slot;
+			n256->children[b] = NULL;
+			node->n_children--;
+			if (node->n_children > 37)
+				return;
+			shrunk = art_node_replace(art, node, ART_NODE48);
+			if (UNLIKELY(!shrunk))
+				return;
+			n48 = (art_node48_t *)shrunk;
+			for (i = 0, j = 0; i < 256; i++) {
+				if (n256->children[i]) {
+					n48->children[j] = n256->children[i];
+					n48->child_index[i] = (uint8_t)(j + 1);
+					j++;
+				}
+			}
+			break;
+		}
+	}
+	*ref = shrunk;
+	art_node_free(art, node);
+}
+
+static uint64_t *art_insert(
+	stress_art_t *art,
+	void **ref,
+	const uint64_t key,
+	const uint64_t value,
+	size_t depth)
+{
+	void *ptr = *ref;
+	art_node_t *node;
+	art_node4_t *n4;
+	art_leaf_t *leaf;
+	void **child;
+	size_t p;
+
+	if (!ptr) {
+		leaf = art_leaf_new(art, key, value);
+		if (UNLIKELY(!leaf))
+			return NULL;
+		*ref = ART_TAG(leaf);
+		return &leaf->value;
+	}
+
+	if (ART_IS_LEAF(ptr)) {
+		const art_leaf_t *old = ART_LEAF(ptr);
+
+		if (old->key == key) {
+			ART_LEAF(ptr)->value = value;
+			return &ART_LEAF(ptr)->value;
+		}
+		/* split the leaf, the new node4 holds the common key bytes */
+		n4 = (art_node4_t *)art_node_new(art, ART_NODE4);
+		if (UNLIKELY(!n4))
+			return NULL;
+		leaf = art_leaf_new(art, key, value);
+		if (UNLIKELY(!leaf)) {
+			art_node_free(art, &n4->n);
+			return NULL;
+		}
+		for (p = 0; art_key_byte(old->key, depth + p) == art_key_byte(key, depth + p); p++)
+			n4->n.prefix[p] = art_key_byte(key, depth + p);
+		n4->n.prefix_len = (uint8_t)p;
+		art_sorted_add(n4->keys, n4->children, 0, art_key_byte(old->key, depth + p), ptr);
+		art_sorted_add(n4->keys, n4->children, 1, art_key_byte(key, depth + p), ART_TAG(leaf));
+		n4->n.n_children = 2;
+		*ref = n4;
+		return &leaf->value;
+	}
+
+	node = (art_node_t *)ptr;
+	if (node->prefix_len) {
+		p = art_prefix_mismatch(node, key, depth);
+		if (p < node->prefix_len) {
+			/* split the compressed path at the first mismatch */
+			n4 = (art_node4_t *)art_node_new(art, ART_NODE4);
+			if (UNLIKELY(!n4))
+				return NULL;
+			leaf = art_leaf_new(art, key, value);
+			if (UNLIKELY(!leaf)) {
+				art_node_free(art, &n4->n);
+				return NULL;
+			}
+			n4->n.prefix_len = (uint8_t)p;
+			(void)shim_memcpy(n4->n.prefix, node->prefix, p);
+			art_sorted_add(n4->keys, n4->children, 0, node->prefix[p], node);
+			art_sorted_add(n4->keys, n4->children, 1, art_key_byte(key, depth + p), ART_TAG(leaf));
+			n4->n.n_children = 2;
+			node->prefix_len -= (uint8_t)(p + 1);
+			(void)shim_memmove(node->prefix, node->prefix + p + 1, node->prefix_len);
+			*ref = n4;
+			return &leaf->value;
+		}
+		depth += node->prefix_len;
+	}
+
+	child = art_find_child(node, art_key_byte(key, depth));
+	if (child)
+		return art_insert(art, child, key, value, depth + 1);
+
+	leaf = art_leaf_new(art, key, value);
+	if (UNLIKELY(!leaf))
+		return NULL;
+	if (UNLIKELY(art_add_child(art, ref, node, art_key_byte(key, depth), ART_TAG(leaf)) < 0)) {
+		art_leaf_free(art, leaf);
+		return NULL;
+	}
+	return &leaf->value;
+}
+
+static bool art_delete(
+	stress_art_t *art,
+	void **ref,
+	const uint64_t key,
+	size_t depth)
+{
+	void *ptr = *ref;
+	art_node_t *node;
+	void **child;
+	uint8_t b;
+
+	if (!ptr)
+		return false;
+	if (ART_IS_LEAF(ptr)) {
+		if (ART_LEAF(ptr)->key != key)
+			return false;
+		art_leaf_free(art, ART_LEAF(ptr));
+		*ref = NULL;
+		return true;
+	}
+
+	node = (art_node_t *)ptr;
+	if (node->prefix_len) {
+		if (art_prefix_mismatch(node, key, depth) != node->prefix_len)
+			return false;
+		depth += node->prefix_len;
+	}
+	b = art_key_byte(key, depth);
+	child = art_find_child(node, b);
+	if (!child)
+		return false;
+	if (ART_IS_LEAF(*child)) {
+		art_leaf_t *leaf = ART_LEAF(*child);
+
+		if (leaf->key != key)
+			return false;
+		art_remove_child(art, ref, node, b, child);
+		art_leaf_free(art, leaf);
+		return true;
+	}
+	return art_delete(art, child, key, depth + 1);
+}
+
+static void art_free(stress_art_t *art, void *ptr)
+{
+	art_node_t *node = (art_node_t *)ptr;
+	size_t i;
+
+	if (!ptr)
+		return;
+	if (ART_IS_LEAF(ptr)) {
+		art_leaf_free(art, ART_LEAF(ptr));
+		return;
+	}
+	switch (node->type) {
+	case ART_NODE4:
+		for (i = 0; i < node->n_children; i++)
+			art_free(art, ((art_node4_t *)node)->children[i]);
+		break;
+	case ART_NODE16:
+		for (i = 0; i < node->n_children; i++)
+			art_free(art, ((art_node16_t *)node)->children[i]);
+		break;
+	case ART_NODE48:
+		for (i = 0; i < 48; i++)
+			art_free(art, ((art_node48_t *)node)->children[i]);
+		break;
+	default:
+		for (i = 0; i < 256; i++)
+			art_free(art, ((art_node256_t *)node)->children[i]);
+		break;
+	}
+	art_node_free(art, node);
+}
+
+/*
+ *  stress_art_init()
+ *	initialize an empty tree
+ */
+void stress_art_init(stress_art_t *art)
+{
+	art->root = NULL;
+	art->count = 0;
+	art->bytes = 0;
+}
+
+/*
+ *  stress_art_free()
+ *	free all the nodes and leaves of a tree
+ */
+void stress_art_free(stress_art_t *art)
+{
+	art_free(art, art->root);
+	art->root = NULL;
+}
+
+/*
+ *  stress_art_insert()
+ *	insert or update key, returns a pointer to its value or
+ *	NULL if out of memory
+ */
+uint64_t *stress_art_insert(stress_art_t *art, const uint64_t key, const uint64_t value)
+{
+	return art_insert(art, &art->root, key, value, 0);
+}
+
+/*
+ *  stress_art_get()
+ *	get a pointer to the value of key, NULL if not found
+ */
+uint64_t OPTIMIZE3 *stress_art_get(const stress_art_t *art, const uint64_t key)
+{
+	void *ptr = art->root;
+	size_t depth = 0;
+
+	while (ptr) {
+		art_node_t *node;
+		void **child;
+
+		if (ART_IS_LEAF(ptr)) {
+			art_leaf_t *leaf = ART_LEAF(ptr);
+
+			return (leaf->key == key) ? &leaf->value : NULL;
+		}
+		node = (art_node_t *)ptr;
+		if (node->prefix_len) {
+			if (art_prefix_mismatch(node, key, depth) != node->prefix_len)
+				return NULL;
+			depth += node->prefix_len;
+		}
+		child = art_find_child(node, art_key_byte(key, depth));
+		if (!child)
+			return NULL;
+		ptr = *child;
+		depth++;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_art_delete()
+ *	delete key, returns false if it is not in the tree
+ */
+bool stress_art_delete(stress_art_t *art, const uint64_t key)
+{
+	return art_delete(art, &art->root, key, 0);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_ART_H
+#define CORE_ART_H
+
+#include "stress-ng.h"
+
+/*
+ *  Adaptive radix tree (Leis et al.) of 64 bit keys and values.
+ *  Keys are split into 8 bytes, most significant byte first, inner
+ *  nodes grow and shrink between 4, 16, 48 and 256 children and
+ *  single child paths are compressed into node prefixes.
+ */
+typedef struct {
+	void *root;		/* root node or tagged leaf */
+	size_t count;		/* number of keys */
+	size_t bytes;		/* bytes allocated to nodes and leaves */
+} stress_art_t;
+
+extern void stress_art_init(stress_art_t *art);
+extern void stress_art_free(stress_art_t *art);
+extern uint64_t *stress_art_insert(stress_art_t *art, const uint64_t key, const uint64_t value);
+extern WARN_UNUSED uint64_t *stress_art_get(const stress_art_t *art, const uint64_t key);
+extern bool stress_art_delete(stress_art_t *art, const uint64_t key);
+
+#endif
@@ -29,6 +29,35 @@ static inline void ALWAYS_INLINE stress_asm_arm_yield(void)
 	__asm__ __volatile__("yield;\n");
 }
 
+#if defined(__aarch64__)
+static inline uint64_t ALWAYS_INLINE stress_asm_arm_cntvct(void)
+{
+	uint64_t val;
+
+	__asm__ __volatile__("mrs %0, cntvct_el0\n" : "=r"(val));
+	return val;
+}
+
+static inline void ALWAYS_INLINE stress_asm_arm_dsb_ish(void)
+{
+	__asm__ __volatile__("dsb ish\n" : : : "memory");
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CVAC)
+static inline void ALWAYS_INLINE stress_asm_arm_dc_cvac(void *p)
+{
+	__asm__ __volatile__("dc cvac, %0\n" : : "r"(p) : "memory");
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CIVAC)
+static inline void ALWAYS_INLINE stress_asm_arm_dc_civac(void *p)
+{
+	__asm__ __volatile__("dc civac, %0\n" : : "r"(p) : "memory");
+}
+#endif
+
 /* #if defined(STRESS_ARCH_ARM) */
 #endif
 
@@ -169,6 +169,13 @@
 #define PURE
 #endif
 
+/* thread local storage */
+#if defined(HAVE_THREAD_LOCAL)
+#define THREAD_LOCAL	__thread
+#else
+#define THREAD_LOCAL
+#endif
+
 /* GCC mlocked data and data section attribute */
 #if ((defined(HAVE_COMPILER_GCC_OR_MUSL) && NEED_GNUC(4, 6, 0) ||	\
      (defined(HAVE_COMPILER_CLANG) && NEED_CLANG(3, 0, 0)))) &&		\
@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-benchmark.h"
+#include "core-compare.h"
+
+#include <sched.h>
+
+/*
+ *  Bump the version whenever the stressors, their options, the
+ *  bogo-op counts or the reference rates change, scores from
+ *  different versions cannot be compared
+ */
+#define BENCHMARK_VERSION	(1)
+#define BENCHMARK_WARMUP	(1)	/* unscored warm-up runs */
+#define BENCHMARK_REPS		(5)	/* scored runs */
+#define BENCHMARK_SCORE		(1000.0) /* score at the reference rate */
+#define BENCHMARK_ARGS		(10)	/* max stress-ng args per stressor */
+
+/* a stressor run with fixed options and bogo-ops count */
+typedef struct {
+	const char *subsystem;		/* subsystem the stressor scores */
+	const char *stressor;		/* stressor name */
+	const char *ops;		/* bogo-ops to run */
+	const double reference;		/* reference bogo-ops per second */
+	const char *opts[5];		/* stressor options, NULL terminated */
+} stress_benchmark_entry_t;
+
+static const char * const benchmark_subsystems[] = {
+	"cpu",
+	"memory",
+	"io",
+	"ipc",
+};
+
+/*
+ *  The reference rates are those of a single instance pinned to
+ *  one CPU of the reference system, where each bogo-op count runs
+ *  for about a second
+ */
+static const stress_benchmark_entry_t benchmark_entries[] = {
+	{ "cpu",	"cpu",		"2600",		2600.0,
+		{ "--cpu-method", "int64", NULL } },
+	{ "cpu",	"matrix",	"600",		600.0,
+		{ "--matrix-method", "prod", "--matrix-size", "128", NULL } },
+	{ "cpu",	"bsearch",	"230",		230.0,
+		{ "--bsearch-size", "65536", NULL } },
+	{ "cpu",	"qsort",	"75",		77.0,
+		{ "--qsort-size", "65536", NULL } },
+	{ "memory",	"memcpy",	"9600",		9600.0,
+		{ "--memcpy-method", "libc", NULL } },
+	{ "memory",	"stream",	"50",		54.0,
+		{ "--stream-l3-size", "8m", NULL } },
+	{ "memory",	"vm",		"2700",		2700.0,
+		{ "--vm-bytes", "64m", "--vm-method", "write64", NULL } },
+	{ "io",		"hdd",		"16000",	16000.0,
+		{ "--hdd-bytes", "64m", NULL } },
+	{ "io",		"seek",		"54000",	54000.0,
+		{ "--seek-size", "64m", NULL } },
+	{ "io",		"fstat",	"11800",	11800.0,
+		{ NULL } },
+	{ "ipc",	"switch",	"540000",	540000.0,
+		{ NULL } },
+	{ "ipc",	"pipe",		"1150000",	1150000.0,
+		{ NULL } },
+	{ "ipc",	"mq",		"400000",	400000.0,
+		{ NULL } },
+};
+
+static const char * const benchmark_profiles[] = {
+	"all",		/* every subsystem */
+	"cpu",
+	"memory",
+	"io",
+	"ipc",
+};
+
+static const char *benchmark_profile;
+static double benchmark_rates[SIZEOF_ARRAY(benchmark_entries)][BENCHMARK_REPS];
+static size_t benchmark_rates_n[SIZEOF_ARRAY(benchmark_entries)];
+static int benchmark_cpu = -1;
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+static cpu_set_t benchmark_cpu_set;	/* affinity before pinning */
+#endif
+
+/*
+ *  stress_set_benchmark()
+ *	parse --benchmark profile name
+ */
+int stress_set_benchmark(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_profiles); i++) {
+		if (!strcmp(opt, benchmark_profiles[i])) {
+			benchmark_profile = benchmark_profiles[i];
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "benchmark must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_profiles); i++)
+		(void)fprintf(stderr, " %s", benchmark_profiles[i]);
+	(void)fprintf(stderr, "\n");
+	_exit(EXIT_FAILURE);
+}
+
+/*
+ *  stress_benchmark_enabled()
+ *	true if --benchmark is being used
+ */
+bool stress_benchmark_enabled(void)
+{
+	return benchmark_profile != NULL;
+}
+
+/*
+ *  stress_benchmark_selected()
+ *	true if the entry is in the --benchmark profile
+ */
+static bool stress_benchmark_selected(const stress_benchmark_entry_t *entry)
+{
+	if (!benchmark_profile)
+		return false;
+	return !strcmp(benchmark_profile, "all") ||
+	       !strcmp(benchmark_profile, entry->subsystem);
+}
+
+/*
+ *  stress_benchmark_stressors()
+ *	declare a single instance of each stressor in the profile
+ *	with its fixed options and bogo-ops count
+ */
+int stress_benchmark_stressors(void)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_entries); i++) {
+		const stress_benchmark_entry_t *entry = &benchmark_entries[i];
+		char args[BENCHMARK_ARGS][32];
+		char *argv[BENCHMARK_ARGS + 1];
+		int argc = 0;
+		size_t j;
+
+		if (!stress_benchmark_selected(entry))
+			continue;
+
+		(void)snprintf(args[argc++], sizeof(args[0]), "stress-ng");
+		(void)snprintf(args[argc++], sizeof(args[0]), "--%s", entry->stressor);
+		(void)snprintf(args[argc++], sizeof(args[0]), "1");
+		(void)snprintf(args[argc++], sizeof(args[0]), "--%s-ops", entry->stressor);
+		(void)snprintf(args[argc++], sizeof(args[0]), "%s", entry->ops);
+		for (j = 0; entry->opts[j] && (argc < BENCHMARK_ARGS); j++)
+			(void)snprintf(args[argc++], sizeof(args[0]), "%s", entry->opts[j]);
+		for (j = 0; j < (size_t)argc; j++)
+			argv[j] = args[j];
+		argv[argc] = NULL;
+
+		if (stress_parse_opts(argc, argv, true) != EXIT_SUCCESS) {
+			(void)fprintf(stderr, "benchmark: cannot declare stressor %s\n",
+				entry->stressor);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_benchmark_runs()
+ *	number of warm-up and scored runs of each stressor
+ */
+uint32_t stress_benchmark_runs(void)
+{
+	return BENCHMARK_WARMUP + BENCHMARK_REPS;
+}
+
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+/*
+ *  stress_benchmark_pin()
+ *	pin stress-ng and hence all the stressors to the first
+ *	CPU it is allowed to run on so each run has the same placement
+ */
+void stress_benchmark_pin(void)
+{
+	cpu_set_t set;
+	int cpu;
+
+	if (sched_getaffinity(0, sizeof(benchmark_cpu_set), &benchmark_cpu_set) < 0) {
+		pr_inf("benchmark: cannot get CPU affinity, errno=%d (%s), running unpinned\n",
+			errno, strerror(errno));
+		return;
+	}
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &benchmark_cpu_set))
+			break;
+	}
+	if (cpu >= CPU_SETSIZE)
+		return;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+		pr_inf("benchmark: cannot pin to CPU %d, errno=%d (%s), running unpinned\n",
+			cpu, errno, strerror(errno));
+		return;
+	}
+	benchmark_cpu = cpu;
+}
+
+/*
+ *  stress_benchmark_unpin()
+ *	restore the CPU affinity from before stress_benchmark_pin()
+ */
+void stress_benchmark_unpin(void)
+{
+	if (benchmark_cpu < 0)
+		return;
+	if (sched_setaffinity(0, sizeof(benchmark_cpu_set), &benchmark_cpu_set) < 0)
+		pr_dbg("benchmark: cannot restore CPU affinity, errno=%d (%s)\n",
+			errno, strerror(errno));
+}
+#else
+void stress_benchmark_pin(void)
+{
+	pr_inf("benchmark: setting CPU affinity not supported, running unpinned\n");
+}
+
+void stress_benchmark_unpin(void)
+{
+}
+#endif
+
+/*
+ *  stress_benchmark_record()
+ *	record the bogo-ops rate of a run of a stressor,
+ *	the warm-up runs are not recorded
+ */
+void stress_benchmark_record(const uint32_t run, const stress_stressor_t *ss)
+{
+	char munged[64];
+	double run_time = 0.0;
+	uint64_t counter = 0;
+	int32_t j, n = 0;
+	size_t i;
+
+	if (run < BENCHMARK_WARMUP)
+		return;
+
+	(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_entries); i++) {
+		if (stress_benchmark_selected(&benchmark_entries[i]) &&
+		    !strcmp(munged, benchmark_entries[i].stressor))
+			break;
+	}
+	if ((i >= SIZEOF_ARRAY(benchmark_entries)) ||
+	    (benchmark_rates_n[i] >= BENCHMARK_REPS))
+		return;
+
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		counter += stats->args.ci.counter;
+		if (stats->completed) {
+			run_time += stats->duration;
+			n++;
+		}
+	}
+	/* runs that were interrupted or failed are not scored */
+	if ((n < ss->num_instances) || (run_time <= 0.0) || (counter == 0))
+		return;
+	benchmark_rates[i][benchmark_rates_n[i]++] = (double)counter / (run_time / (double)n);
+}
+
+/*
+ *  stress_benchmark_stats()
+ *	mean, sample standard deviation and 95% confidence
+ *	interval half width of n values
+ */
+static void stress_benchmark_stats(
+	const double *values,
+	const size_t n,
+	double *mean,
+	double *stddev,
+	double *ci)
+{
+	double sum = 0.0, sum_sq = 0.0;
+	size_t i;
+
+	*mean = 0.0;
+	*stddev = 0.0;
+	*ci = 0.0;
+	if (n == 0)
+		return;
+	for (i = 0; i < n; i++)
+		sum += values[i];
+	*mean = sum / (double)n;
+	if (n < 2)
+		return;
+	for (i = 0; i < n; i++)
+		sum_sq += (values[i] - *mean) * (values[i] - *mean);
+	*stddev = sqrt(sum_sq / (double)(n - 1));
+	*ci = stress_compare_t_crit((double)(n - 1)) * *stddev / sqrt((double)n);
+}
+
+/*
+ *  stress_benchmark_composite()
+ *	per scored run geometric mean of the scores of the entries
+ *	in the subsystem, or all entries if subsystem is NULL, and
+ *	the mean and confidence interval of these over the runs,
+ *	returns false if an entry has no scored runs
+ */
+static bool stress_benchmark_composite(
+	const char *subsystem,
+	double *mean,
+	double *ci)
+{
+	double scores[BENCHMARK_REPS], stddev;
+	size_t i, r, reps = BENCHMARK_REPS, entries = 0;
+
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_entries); i++) {
+		const stress_benchmark_entry_t *entry = &benchmark_entries[i];
+
+		if (!stress_benchmark_selected(entry))
+			continue;
+		if (subsystem && strcmp(subsystem, entry->subsystem))
+			continue;
+		if (benchmark_rates_n[i] < reps)
+			reps = benchmark_rates_n[i];
+		entries++;
+	}
+	if ((entries == 0) || (reps == 0))
+		return false;
+
+	for (r = 0; r < reps; r++) {
+		double log_sum = 0.0;
+
+		for (i = 0; i < SIZEOF_ARRAY(benchmark_entries); i++) {
+			const stress_benchmark_entry_t *entry = &benchmark_entries[i];
+
+			if (!stress_benchmark_selected(entry))
+				continue;
+			if (subsystem && strcmp(subsystem, entry->subsystem))
+				continue;
+			log_sum += log(BENCHMARK_SCORE * benchmark_rates[i][r] / entry->reference);
+		}
+		scores[r] = exp(log_sum / (double)entries);
+	}
+	stress_benchmark_stats(scores, reps, mean, &stddev, ci);
+	return true;
+}
+
+/*
+ *  stress_benchmark_dump()
+ *	report the rate and score of each stressor and the composite
+ *	scores of each subsystem and overall, scores are relative to
+ *	BENCHMARK_SCORE at the reference rates, composite scores are
+ *	geometric means of the stressor scores of each scored run
+ */
+void stress_benchmark_dump(FILE *yaml)
+{
+	size_t i;
+	double mean, ci;
+
+	if (!benchmark_profile)
+		return;
+
+	pr_block_begin();
+	pr_inf("benchmark: profile %s, version %d, %d warm-up and %d scored runs per stressor%s\n",
+		benchmark_profile, BENCHMARK_VERSION, BENCHMARK_WARMUP, BENCHMARK_REPS,
+		(benchmark_cpu < 0) ? ", unpinned" : "");
+	if (benchmark_cpu >= 0)
+		pr_inf("benchmark: pinned to CPU %d\n", benchmark_cpu);
+	pr_inf("%-9s %-9s %5s %12s %7s %9s %9s\n", "subsystem", "stressor", "runs",
+		"bogo ops/s", "cv", "score", "95% CI");
+	pr_yaml(yaml, "benchmark:\n");
+	pr_yaml(yaml, "    profile: %s\n", benchmark_profile);
+	pr_yaml(yaml, "    version: %d\n", BENCHMARK_VERSION);
+	pr_yaml(yaml, "    warm-up-runs: %d\n", BENCHMARK_WARMUP);
+	pr_yaml(yaml, "    scored-runs: %d\n", BENCHMARK_REPS);
+	if (benchmark_cpu >= 0)
+		pr_yaml(yaml, "    cpu: %d\n", benchmark_cpu);
+	pr_yaml(yaml, "    stressors:\n");
+
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_entries); i++) {
+		const stress_benchmark_entry_t *entry = &benchmark_entries[i];
+		const size_t n = benchmark_rates_n[i];
+		double scores[BENCHMARK_REPS];
+		double rate, rate_stddev, rate_ci, score, score_stddev, score_ci, cv;
+		size_t r;
+
+		if (!stress_benchmark_selected(entry))
+			continue;
+		if (n == 0) {
+			pr_inf("%-9s %-9s %5zu %12s %7s %9s %9s\n", entry->subsystem,
+				entry->stressor, n, "-", "-", "-", "-");
+			continue;
+		}
+		for (r = 0; r < n; r++)
+			scores[r] = BENCHMARK_SCORE * benchmark_rates[i][r] / entry->reference;
+		stress_benchmark_stats(benchmark_rates[i], n, &rate, &rate_stddev, &rate_ci);
+		stress_benchmark_stats(scores, n, &score, &score_stddev, &score_ci);
+		cv = (rate > 0.0) ? 100.0 * rate_stddev / rate : 0.0;
+
+		pr_inf("%-9s %-9s %5zu %12.2f %6.2f%% %9.2f %9.2f\n", entry->subsystem,
+			entry->stressor, n, rate, cv, score, score_ci);
+		pr_yaml(yaml, "      - stressor: %s\n", entry->stressor);
+		pr_yaml(yaml, "        subsystem: %s\n", entry->subsystem);
+		pr_yaml(yaml, "        bogo-ops: %s\n", entry->ops);
+		pr_yaml(yaml, "        runs: %zu\n", n);
+		pr_yaml(yaml, "        bogo-ops-per-second: %f\n", rate);
+		pr_yaml(yaml, "        bogo-ops-per-second-cv-percent: %f\n", cv);
+		pr_yaml(yaml, "        score: %f\n", score);
+		pr_yaml(yaml, "        score-ci95: %f\n", score_ci);
+	}
+
+	pr_inf("%-9s %9s %9s\n", "subsystem", "score", "95% CI");
+	pr_yaml(yaml, "    subsystems:\n");
+	for (i = 0; i < SIZEOF_ARRAY(benchmark_subsystems); i++) {
+		if (!stress_benchmark_composite(benchmark_subsystems[i], &mean, &ci))
+			continue;
+		pr_inf("%-9s %9.2f %9.2f\n", benchmark_subsystems[i], mean, ci);
+		pr_yaml(yaml, "      - subsystem: %s\n", benchmark_subsystems[i]);
+		pr_yaml(yaml, "        score: %f\n", mean);
+		pr_yaml(yaml, "        score-ci95: %f\n", ci);
+	}
+	if (stress_benchmark_composite(NULL, &mean, &ci)) {
+		pr_inf("%-9s %9.2f %9.2f\n", "overall", mean, ci);
+		pr_yaml(yaml, "    overall-score: %f\n", mean);
+		pr_yaml(yaml, "    overall-score-ci95: %f\n", ci);
+	} else {
+		pr_inf("benchmark: no overall score, one or more stressors have no scored runs\n");
+	}
+	pr_yaml(yaml, "\n");
+	pr_block_end();
+}
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cgroup.h"
+
+#define STRESS_CGROUP_CPU_PERIOD	(100000)	/* cpu.max period, usecs */
+#define STRESS_CGROUP_CPU_MAX_CPUS	(4096.0)
+#define STRESS_CGROUP_MEMORY_MIN	(MB)
+
+/* A stressor's cgroup */
+typedef struct stress_cgroup {
+	struct stress_cgroup *next;	/* next cgroup in list */
+	const stress_stressor_t *ss;	/* stressor contained in the cgroup */
+	char path[PATH_MAX];		/* cgroup directory */
+} stress_cgroup_t;
+
+/* cgroup statistics reported per stressor */
+typedef struct {
+	const char *file;		/* cgroup file */
+	const char *key;		/* key in file, NULL for single value files */
+	const char *yaml;		/* YAML key */
+} stress_cgroup_stat_t;
+
+static const stress_cgroup_stat_t cgroup_stats[] = {
+	{ "cpu.stat",		"usage_usec",	"cpu-usage-usec" },
+	{ "cpu.stat",		"user_usec",	"cpu-user-usec" },
+	{ "cpu.stat",		"system_usec",	"cpu-system-usec" },
+	{ "cpu.stat",		"nr_periods",	"cpu-nr-periods" },
+	{ "cpu.stat",		"nr_throttled",	"cpu-nr-throttled" },
+	{ "cpu.stat",		"throttled_usec", "cpu-throttled-usec" },
+	{ "memory.peak",	NULL,		"memory-peak-bytes" },
+	{ "memory.stat",	"anon",		"memory-anon-bytes" },
+	{ "memory.stat",	"file",		"memory-file-bytes" },
+	{ "memory.stat",	"pgfault",	"memory-pgfault" },
+	{ "memory.stat",	"pgmajfault",	"memory-pgmajfault" },
+	{ "io.stat",		"rbytes",	"io-read-bytes" },
+	{ "io.stat",		"wbytes",	"io-write-bytes" },
+	{ "io.stat",		"rios",		"io-read-ops" },
+	{ "io.stat",		"wios",		"io-write-ops" },
+	{ "cpu.pressure",	"some",		"cpu-pressure-some-usec" },
+	{ "cpu.pressure",	"full",		"cpu-pressure-full-usec" },
+	{ "memory.pressure",	"some",		"memory-pressure-some-usec" },
+	{ "memory.pressure",	"full",		"memory-pressure-full-usec" },
+	{ "io.pressure",	"some",		"io-pressure-some-usec" },
+	{ "io.pressure",	"full",		"io-pressure-full-usec" },
+};
+
+static double cgroup_cpu_max;		/* cpu.max limit in CPUs, 0 = none */
+static uint64_t cgroup_memory_max;	/* memory.max limit in bytes, 0 = none */
+static char cgroup_parent[PATH_MAX - 128]; /* per run parent cgroup */
+static stress_cgroup_t *cgroups;	/* per stressor cgroups */
+
+/*
+ *  stress_set_cgroup_cpu_max()
+ *	parse --cgroup-cpu-max option, the cpu.max quota
+ *	of each stressor's cgroup in CPUs
+ */
+int stress_set_cgroup_cpu_max(const char *opt)
+{
+	char *end;
+	double cpus;
+
+	errno = 0;
+	cpus = strtod(opt, &end);
+	if ((errno != 0) || (end == opt) || (*end != '\0') ||
+	    (cpus < 0.01) || (cpus > STRESS_CGROUP_CPU_MAX_CPUS)) {
+		(void)fprintf(stderr, "cgroup-cpu-max must be a number of CPUs "
+			"from 0.01 to %.0f\n", STRESS_CGROUP_CPU_MAX_CPUS);
+		_exit(EXIT_FAILURE);
+	}
+	cgroup_cpu_max = cpus;
+	g_opt_flags |= OPT_FLAGS_CGROUP_STATS;
+	return 0;
+}
+
+/*
+ *  stress_set_cgroup_memory_max()
+ *	parse --cgroup-memory-max option, the memory.max
+ *	limit of each stressor's cgroup in bytes
+ */
+int stress_set_cgroup_memory_max(const char *opt)
+{
+	cgroup_memory_max = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("cgroup-memory-max", cgroup_memory_max,
+		STRESS_CGROUP_MEMORY_MIN, MAX_MEM_LIMIT);
+	g_opt_flags |= OPT_FLAGS_CGROUP_STATS;
+	return 0;
+}
+
+/*
+ *  stress_cgroup_mount()
+ *	find the cgroup v2 directory this process is in,
+ *	returns -1 if there is no cgroup v2 hierarchy
+ */
+static int stress_cgroup_mount(char *path, const size_t path_len)
+{
+	char buf[PATH_MAX], mnt[PATH_MAX], type[64];
+	char cgroup[PATH_MAX] = "";
+	FILE *fp;
+	bool found = false;
+	int ret;
+
+	fp = fopen("/proc/self/cgroup", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (!strncmp(buf, "0::", 3)) {
+			(void)sscanf(buf + 3, "%4095s", cgroup);
+			break;
+		}
+	}
+	(void)fclose(fp);
+	if (!*cgroup)
+		return -1;
+
+	fp = fopen("/proc/mounts", "r");
+	if (!fp)
+		return -1;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if ((sscanf(buf, "%*s %4095s %63s", mnt, type) == 2) &&
+		    !strcmp(type, "cgroup2")) {
+			found = true;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	if (!found)
+		return -1;
+
+	ret = snprintf(path, path_len, "%s%s", mnt,
+		strcmp(cgroup, "/") ? cgroup : "");
+	return ((ret < 0) || ((size_t)ret >= path_len)) ? -1 : 0;
+}
+
+/*
+ *  stress_cgroup_write()
+ *	write a string to a cgroup file
+ */
+static int stress_cgroup_write(const char *dir, const char *file, const char *str)
+{
+	char path[PATH_MAX];
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/%s", dir, file);
+	if ((ret < 0) || ((size_t)ret >= sizeof(path))) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	return (stress_system_write(path, str, strlen(str)) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_cgroup_controllers()
+ *	enable the cpu, memory and io controllers in the
+ *	subtree of cgroup dir, these fail if the controller is
+ *	not available or dir contains processes, which is not
+ *	fatal as cpu.stat is always available
+ */
+static void stress_cgroup_controllers(const char *dir)
+{
+	(void)stress_cgroup_write(dir, "cgroup.subtree_control", "+cpu");
+	(void)stress_cgroup_write(dir, "cgroup.subtree_control", "+memory");
+	(void)stress_cgroup_write(dir, "cgroup.subtree_control", "+io");
+}
+
+/*
+ *  stress_cgroup_init()
+ *	create a cgroup v2 child group for each stressor under
+ *	a per run parent group and apply any cpu.max and
+ *	memory.max limits
+ */
+void stress_cgroup_init(stress_stressor_t *stressors_list)
+{
+	char base[PATH_MAX - 160], buf[64];
+	stress_stressor_t *ss;
+	uint32_t n = 0;
+
+	if (!(g_opt_flags & OPT_FLAGS_CGROUP_STATS))
+		return;
+
+	if (stress_cgroup_mount(base, sizeof(base)) < 0) {
+		pr_inf("cgroup: cannot find a cgroup v2 hierarchy, disabling cgroup stats\n");
+		return;
+	}
+	(void)snprintf(cgroup_parent, sizeof(cgroup_parent),
+		"%s/stress-ng-%" PRIdMAX, base, (intmax_t)getpid());
+	if (mkdir(cgroup_parent, 0755) < 0) {
+		pr_inf("cgroup: cannot create cgroup %s, errno=%d (%s), disabling cgroup stats\n",
+			cgroup_parent, errno, strerror(errno));
+		*cgroup_parent = '\0';
+		return;
+	}
+	stress_cgroup_controllers(base);
+	stress_cgroup_controllers(cgroup_parent);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_cgroup_t *cgroup;
+		char munged[64];
+
+		if (ss->ignore.run)
+			continue;
+		cgroup = (stress_cgroup_t *)calloc(1, sizeof(*cgroup));
+		if (!cgroup)
+			break;
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		(void)snprintf(cgroup->path, sizeof(cgroup->path), "%s/%s-%" PRIu32,
+			cgroup_parent, munged, n++);
+		if (mkdir(cgroup->path, 0755) < 0) {
+			pr_inf("cgroup: cannot create cgroup %s, errno=%d (%s)\n",
+				cgroup->path, errno, strerror(errno));
+			free(cgroup);
+			continue;
+		}
+		if (cgroup_cpu_max > 0.0) {
+			(void)snprintf(buf, sizeof(buf), "%" PRIu64 " %d",
+				(uint64_t)(cgroup_cpu_max * STRESS_CGROUP_CPU_PERIOD),
+				STRESS_CGROUP_CPU_PERIOD);
+			if (stress_cgroup_write(cgroup->path, "cpu.max", buf) < 0)
+				pr_warn("cgroup: cannot set cpu.max of %s, cpu controller "
+					"may not be available\n", cgroup->path);
+		}
+		if (cgroup_memory_max > 0) {
+			(void)snprintf(buf, sizeof(buf), "%" PRIu64, cgroup_memory_max);
+			if (stress_cgroup_write(cgroup->path, "memory.max", buf) < 0)
+				pr_warn("cgroup: cannot set memory.max of %s, memory controller "
+					"may not be available\n", cgroup->path);
+		}
+		cgroup->ss = ss;
+		cgroup->next = cgroups;
+		cgroups = cgroup;
+	}
+}
+
+/*
+ *  stress_cgroup_free()
+ *	remove the stressor cgroups and the parent cgroup,
+ *	all the stressor processes must have exited
+ */
+void stress_cgroup_free(void)
+{
+	stress_cgroup_t *cgroup = cgroups;
+
+	while (cgroup) {
+		stress_cgroup_t *next = cgroup->next;
+
+		(void)rmdir(cgroup->path);
+		free(cgroup);
+		cgroup = next;
+	}
+	cgroups = NULL;
+	if (*cgroup_parent) {
+		(void)rmdir(cgroup_parent);
+		*cgroup_parent = '\0';
+	}
+}
+
+/*
+ *  stress_cgroup_attach()
+ *	move the calling stressor instance process into the
+ *	cgroup of stressor ss
+ */
+void stress_cgroup_attach(const stress_stressor_t *ss)
+{
+	const stress_cgroup_t *cgroup;
+	char buf[32];
+
+	for (cgroup = cgroups; cgroup; cgroup = cgroup->next) {
+		if (cgroup->ss == ss)
+			break;
+	}
+	if (!cgroup)
+		return;
+
+	(void)snprintf(buf, sizeof(buf), "%" PRIdMAX "\n", (intmax_t)getpid());
+	if (stress_cgroup_write(cgroup->path, "cgroup.procs", buf) < 0)
+		pr_dbg("cgroup: cannot move PID %" PRIdMAX " into %s, errno=%d (%s)\n",
+			(intmax_t)getpid(), cgroup->path, errno, strerror(errno));
+}
+
+/*
+ *  stress_cgroup_read_stat()
+ *	read a cgroup statistic, keyed files are "key value" lines,
+ *	io.stat values are summed over all devices and pressure
+ *	values are the total stall time, returns -1 if the file
+ *	or key does not exist
+ */
+static int stress_cgroup_read_stat(
+	const char *dir,
+	const stress_cgroup_stat_t *stat,
+	uint64_t *value)
+{
+	char path[PATH_MAX], buf[4096];
+	FILE *fp;
+	const size_t key_len = stat->key ? strlen(stat->key) : 0;
+	bool found = false;
+
+	*value = 0;
+	(void)snprintf(path, sizeof(path), "%s/%s", dir, stat->file);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		uint64_t val;
+		char *ptr;
+
+		if (!stat->key) {
+			if (sscanf(buf, "%" SCNu64, &val) == 1) {
+				*value = val;
+				found = true;
+			}
+			break;
+		}
+		if (!strcmp(stat->file, "io.stat")) {
+			/* "maj:min rbytes=N wbytes=N rios=N wios=N ..." */
+			for (ptr = strstr(buf, stat->key); ptr; ptr = strstr(ptr + 1, stat->key)) {
+				if ((ptr > buf) && (ptr[-1] == ' ') && (ptr[key_len] == '=') &&
+				    (sscanf(ptr + key_len + 1, "%" SCNu64, &val) == 1)) {
+					*value += val;
+					found = true;
+					break;
+				}
+			}
+			continue;
+		}
+		if (strncmp(buf, stat->key, key_len) || (buf[key_len] != ' '))
+			continue;
+		if (strstr(stat->file, ".pressure")) {
+			/* "some avg10=N avg60=N avg300=N total=N" */
+			ptr = strstr(buf, "total=");
+			if (ptr && (sscanf(ptr + 6, "%" SCNu64, &val) == 1)) {
+				*value = val;
+				found = true;
+			}
+		} else if (sscanf(buf + key_len, "%" SCNu64, &val) == 1) {
+			*value = val;
+			found = true;
+		}
+		break;
+	}
+	(void)fclose(fp);
+
+	/* io.stat is empty if there was no block I/O */
+	if (!found && !strcmp(stat->file, "io.stat"))
+		return 0;
+	return found ? 0 : -1;
+}
+
+/*
+ *  stress_cgroup_dump()
+ *	report the cgroup resource usage of each stressor
+ */
+void stress_cgroup_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool yaml_header = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_cgroup_t *cgroup;
+		uint64_t values[SIZEOF_ARRAY(cgroup_stats)];
+		bool valid[SIZEOF_ARRAY(cgroup_stats)];
+		char munged[64];
+		size_t i;
+
+		for (cgroup = cgroups; cgroup; cgroup = cgroup->next) {
+			if (cgroup->ss == ss)
+				break;
+		}
+		if (!cgroup)
+			continue;
+
+		for (i = 0; i < SIZEOF_ARRAY(cgroup_stats); i++)
+			valid[i] = (stress_cgroup_read_stat(cgroup->path, &cgroup_stats[i], &values[i]) == 0);
+
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		if (!yaml_header) {
+			pr_yaml(yaml, "cgroup:\n");
+			yaml_header = true;
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		if (cgroup_cpu_max > 0.0)
+			pr_yaml(yaml, "      cpu-max-cpus: %f\n", cgroup_cpu_max);
+		if (cgroup_memory_max > 0)
+			pr_yaml(yaml, "      memory-max-bytes: %" PRIu64 "\n", cgroup_memory_max);
+		for (i = 0; i < SIZEOF_ARRAY(cgroup_stats); i++) {
+			if (valid[i])
+				pr_yaml(yaml, "      %s: %" PRIu64 "\n", cgroup_stats[i].yaml, values[i]);
+		}
+		pr_yaml(yaml, "\n");
+
+		/* indices match the order of cgroup_stats[] */
+		if (valid[0])
+			pr_inf("cgroup: %s: cpu %.2fs (user %.2fs, sys %.2fs), throttled %" PRIu64
+				" of %" PRIu64 " periods (%.2fs)\n", munged,
+				(double)values[0] / 1000000.0, (double)values[1] / 1000000.0,
+				(double)values[2] / 1000000.0, values[4], values[3],
+				(double)values[5] / 1000000.0);
+		if (valid[6] || valid[7])
+			pr_inf("cgroup: %s: memory peak %.2f MB (anon %.2f MB, file %.2f MB), "
+				"%" PRIu64 " page faults, %" PRIu64 " major\n", munged,
+				(double)values[6] / (double)MB, (double)values[7] / (double)MB,
+				(double)values[8] / (double)MB, values[9], values[10]);
+		if (valid[11])
+			pr_inf("cgroup: %s: io read %.2f MB (%" PRIu64 " ops), write %.2f MB (%" PRIu64 " ops)\n",
+				munged, (double)values[11] / (double)MB, values[13],
+				(double)values[12] / (double)MB, values[14]);
+		if (valid[15] || valid[17] || valid[19])
+			pr_inf("cgroup: %s: pressure stall some/full cpu %.2fs/%.2fs, "
+				"memory %.2fs/%.2fs, io %.2fs/%.2fs\n", munged,
+				(double)values[15] / 1000000.0, (double)values[16] / 1000000.0,
+				(double)values[17] / 1000000.0, (double)values[18] / 1000000.0,
+				(double)values[19] / 1000000.0, (double)values[20] / 1000000.0);
+	}
+}
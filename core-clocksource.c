@@ -30,6 +30,38 @@ static inline void stress_clocksource_tolower(char *str)
 }
 #endif
 
+/*
+ *  stress_clocksource_get()
+ *	get the name of the current clocksource, returns the
+ *	length of the name or -1 if it cannot be determined
+ */
+ssize_t stress_clocksource_get(char *name, const size_t len)
+{
+#if defined(__linux__)
+	ssize_t ret;
+	char *ptr;
+
+	if (len < 1)
+		return -1;
+	ret = stress_system_read("/sys/devices/system/clocksource/clocksource0/current_clocksource",
+		name, len);
+	if (ret <= 0) {
+		*name = '\0';
+		return -1;
+	}
+	for (ptr = name; *ptr && (*ptr != '\n'); ptr++)
+		;
+	*ptr = '\0';
+	stress_clocksource_tolower(name);
+
+	return (ssize_t)(ptr - name);
+#else
+	if (len > 0)
+		*name = '\0';
+	return -1;
+#endif
+}
+
 /*
  *  stress_clocksource_check()
  *	check the clocksource being used, warn if the less accurate
@@ -19,6 +19,7 @@
 #ifndef CORE_CLOCKSOURCE_H
 #define CORE_CLOCKSOURCE_H
 
+extern ssize_t stress_clocksource_get(char *name, const size_t len);
 extern void stress_clocksource_check(void);
 
 #endif
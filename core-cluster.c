@@ -0,0 +1,819 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cluster.h"
+#include "core-net.h"
+
+#include <netdb.h>
+#include <sys/wait.h>
+
+#define STRESS_CLUSTER_PORT		"4277"
+#define STRESS_CLUSTER_START_DELAY	(5.0)	/* secs from dispatch to start */
+#define STRESS_CLUSTER_HEADER_MAX	(256)
+#define STRESS_CLUSTER_SECRET_MAX	(128)
+#define STRESS_CLUSTER_JOB_MAX		(1024 * 1024)
+#define STRESS_CLUSTER_YAML_MAX		(64 * 1024 * 1024)
+#define STRESS_CLUSTER_JOB_MAGIC	"STRESS-NG-JOB"
+#define STRESS_CLUSTER_YAML_MAGIC	"STRESS-NG-YAML"
+
+typedef struct {
+	char name[64];			/* munged stressor name */
+	uint64_t bogo_ops;		/* bogo ops */
+	double rate;			/* bogo ops per sec, real time */
+} stress_cluster_metric_t;
+
+typedef struct {
+	char *name;			/* host as given by the user */
+	int fd;				/* connection to the agent */
+	int rc;				/* agent run exit status */
+	size_t n_metrics;		/* number of stressor metrics */
+	stress_cluster_metric_t *metrics; /* stressor metrics */
+} stress_cluster_host_t;
+
+/*
+ *  stress_cluster_split()
+ *	split [host]:port, host:port, host or port into host
+ *	and port, host is NULL if it is not specified
+ */
+static int stress_cluster_split(
+	char *str,
+	char **host,
+	char **port,
+	const bool port_only)
+{
+	char *ptr;
+
+	*host = NULL;
+	*port = STRESS_CLUSTER_PORT;
+
+	if (*str == '[') {
+		*host = str + 1;
+		ptr = strchr(str, ']');
+		if (!ptr)
+			return -1;
+		*ptr++ = '\0';
+		if (*ptr == ':')
+			*port = ptr + 1;
+		else if (*ptr)
+			return -1;
+	} else {
+		ptr = strchr(str, ':');
+		if (ptr && (ptr == strrchr(str, ':'))) {
+			*ptr = '\0';
+			*host = str;
+			*port = ptr + 1;
+		} else if (port_only && (strspn(str, "0123456789") == strlen(str))) {
+			*port = str;
+		} else {
+			*host = str;
+		}
+	}
+	if (*host && (**host == '\0'))
+		*host = NULL;
+	if (**port == '\0')
+		return -1;
+	if (!port_only && !*host)
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_cluster_write()
+ *	write all of buf to fd
+ */
+static int stress_cluster_write(const int fd, const void *buf, const size_t len)
+{
+	const char *ptr = (const char *)buf;
+	size_t n = len;
+
+	while (n > 0) {
+		const ssize_t ret = write(fd, ptr, n);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		ptr += ret;
+		n -= (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cluster_read()
+ *	read exactly len bytes from fd into buf
+ */
+static int stress_cluster_read(const int fd, void *buf, const size_t len)
+{
+	char *ptr = (char *)buf;
+	size_t n = len;
+
+	while (n > 0) {
+		const ssize_t ret = read(fd, ptr, n);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (ret == 0)
+			return -1;
+		ptr += ret;
+		n -= (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cluster_read_header()
+ *	read a newline terminated protocol header from fd
+ */
+static int stress_cluster_read_header(const int fd, char *buf, const size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len - 1; i++) {
+		if (stress_cluster_read(fd, buf + i, 1) < 0)
+			return -1;
+		if (buf[i] == '\n') {
+			buf[i] = '\0';
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ *  stress_cluster_read_file()
+ *	read a file of at most max bytes into a nul terminated
+ *	buffer, returns NULL on failure
+ */
+static char *stress_cluster_read_file(const char *filename, const size_t max, size_t *len)
+{
+	struct stat statbuf;
+	char *buf;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if ((fstat(fd, &statbuf) < 0) ||
+	    (statbuf.st_size < 0) ||
+	    ((size_t)statbuf.st_size > max)) {
+		(void)close(fd);
+		return NULL;
+	}
+	*len = (size_t)statbuf.st_size;
+	buf = (char *)malloc(*len + 1);
+	if (!buf) {
+		(void)close(fd);
+		return NULL;
+	}
+	if (stress_cluster_read(fd, buf, *len) < 0) {
+		free(buf);
+		(void)close(fd);
+		return NULL;
+	}
+	buf[*len] = '\0';
+	(void)close(fd);
+	return buf;
+}
+
+/*
+ *  stress_cluster_secret()
+ *	read the shared secret from the first line of the
+ *	--cluster-secret file into secret, returns -1 on failure
+ */
+static int stress_cluster_secret(const char *who, char *secret, const size_t len)
+{
+	char *filename = NULL, *buf;
+	size_t buf_len, n;
+
+	if (!stress_get_setting("cluster-secret", &filename) || !filename) {
+		pr_err("%s: a shared secret file must be specified with --cluster-secret\n", who);
+		return -1;
+	}
+	buf = stress_cluster_read_file(filename, 4096, &buf_len);
+	if (!buf) {
+		pr_err("%s: cannot read shared secret file %s\n", who, filename);
+		return -1;
+	}
+	n = strcspn(buf, " \t\r\n");
+	if ((n == 0) || (n >= len)) {
+		pr_err("%s: shared secret in %s must be 1 to %zu non-white space characters\n",
+			who, filename, len - 1);
+		free(buf);
+		return -1;
+	}
+	(void)shim_memcpy(secret, buf, n);
+	secret[n] = '\0';
+	(void)shim_memset(buf, 0, buf_len);
+	free(buf);
+	return 0;
+}
+
+/*
+ *  stress_cluster_secret_cmp()
+ *	compare the secret with the token in a time independent
+ *	of where they differ, returns true if they match
+ */
+static bool stress_cluster_secret_cmp(const char *secret, const char *token)
+{
+	char a[STRESS_CLUSTER_SECRET_MAX], b[STRESS_CLUSTER_SECRET_MAX];
+	uint8_t diff = 0;
+	size_t i;
+
+	(void)shim_memset(a, 0, sizeof(a));
+	(void)shim_memset(b, 0, sizeof(b));
+	(void)shim_strscpy(a, secret, sizeof(a));
+	(void)shim_strscpy(b, token, sizeof(b));
+	for (i = 0; i < sizeof(a); i++)
+		diff |= (uint8_t)(a[i] ^ b[i]);
+	return diff == 0;
+}
+
+/*
+ *  stress_cluster_time_str()
+ *	format a wall clock time as a local time string
+ */
+static void stress_cluster_time_str(const double t, char *buf, const size_t len)
+{
+	const time_t secs = (time_t)t;
+	struct tm *tm;
+
+	tm = localtime(&secs);
+	if (!tm || (strftime(buf, len, "%Y-%m-%d %H:%M:%S %Z", tm) == 0))
+		(void)snprintf(buf, len, "%.0f", t);
+}
+
+/*
+ *  stress_cluster_sleep_until()
+ *	sleep until the wall clock reaches start, returns
+ *	the number of seconds start was missed by
+ */
+static double stress_cluster_sleep_until(const double start)
+{
+	double delta;
+
+	while ((delta = start - stress_time_now()) > 0.0) {
+		if (delta > 1.0)
+			delta = 1.0;
+		(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+	}
+	return -delta;
+}
+
+/*
+ *  stress_cluster_agent_run()
+ *	run the stress-ng job in jobfile, writing the
+ *	metrics to yamlfile, returns the exit status
+ */
+static int stress_cluster_agent_run(const char *jobfile, const char *yamlfile)
+{
+	char path[PATH_MAX];
+	int status;
+	pid_t pid;
+
+	if (!stress_get_proc_self_exe(path, sizeof(path))) {
+		pr_err("agent: cannot determine the stress-ng executable path\n");
+		return EXIT_FAILURE;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		pr_err("agent: fork failed, errno=%d (%s)\n", errno, strerror(errno));
+		return EXIT_FAILURE;
+	} else if (pid == 0) {
+		(void)execl(path, path, "--metrics", "--job", jobfile, "--yaml", yamlfile, (char *)NULL);
+		_exit(EXIT_FAILURE);
+	}
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR)
+			return EXIT_FAILURE;
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
+
+/*
+ *  stress_cluster_agent_serve()
+ *	receive a job from a controller, run it at the requested
+ *	wall clock start time and send back the YAML results
+ */
+static void stress_cluster_agent_serve(const int fd, const char *peer, const char *secret)
+{
+	char header[STRESS_CLUSTER_HEADER_MAX];
+	char magic[32], token[STRESS_CLUSTER_SECRET_MAX], when[64];
+	char jobfile[PATH_MAX], yamlfile[PATH_MAX];
+	char *job = NULL, *yaml = NULL;
+	double start, late;
+	size_t len, yaml_len = 0;
+	int job_fd, yaml_fd, rc;
+
+	if (stress_cluster_read_header(fd, header, sizeof(header)) < 0)
+		return;
+	if ((sscanf(header, "%31s %127s %lf %zu", magic, token, &start, &len) != 4) ||
+	    strcmp(magic, STRESS_CLUSTER_JOB_MAGIC) ||
+	    (len > STRESS_CLUSTER_JOB_MAX)) {
+		pr_err("agent: invalid job request from %s\n", peer);
+		return;
+	}
+	if (!stress_cluster_secret_cmp(secret, token)) {
+		pr_err("agent: job request from %s has the wrong shared secret, ignoring it\n", peer);
+		/* slow down guessing */
+		(void)sleep(1);
+		return;
+	}
+	job = (char *)malloc(len + 1);
+	if (!job)
+		return;
+	if (stress_cluster_read(fd, job, len) < 0) {
+		pr_err("agent: short job read from %s\n", peer);
+		free(job);
+		return;
+	}
+
+	(void)snprintf(jobfile, sizeof(jobfile), "%s/stress-ng-job-XXXXXX", stress_get_temp_path());
+	(void)snprintf(yamlfile, sizeof(yamlfile), "%s/stress-ng-yaml-XXXXXX", stress_get_temp_path());
+	job_fd = mkstemp(jobfile);
+	if (job_fd < 0) {
+		pr_err("agent: cannot create job file %s, errno=%d (%s)\n",
+			jobfile, errno, strerror(errno));
+		free(job);
+		return;
+	}
+	yaml_fd = mkstemp(yamlfile);
+	if (yaml_fd < 0) {
+		pr_err("agent: cannot create yaml file %s, errno=%d (%s)\n",
+			yamlfile, errno, strerror(errno));
+		(void)close(job_fd);
+		(void)unlink(jobfile);
+		free(job);
+		return;
+	}
+	(void)close(yaml_fd);
+	rc = stress_cluster_write(job_fd, job, len);
+	(void)close(job_fd);
+	free(job);
+
+	if (rc < 0) {
+		pr_err("agent: cannot write job file %s\n", jobfile);
+		rc = EXIT_FAILURE;
+	} else {
+		stress_cluster_time_str(start, when, sizeof(when));
+		pr_inf("agent: received job from %s, starting at %s\n", peer, when);
+		late = stress_cluster_sleep_until(start);
+		if (late > 0.1)
+			pr_warn("agent: started %.3f seconds late, clocks may not be synchronised\n", late);
+		rc = stress_cluster_agent_run(jobfile, yamlfile);
+		pr_inf("agent: job finished with exit status %d\n", rc);
+		yaml = stress_cluster_read_file(yamlfile, STRESS_CLUSTER_YAML_MAX, &yaml_len);
+		if (!yaml)
+			yaml_len = 0;
+	}
+
+	(void)snprintf(header, sizeof(header), "%s %d %zu\n",
+		STRESS_CLUSTER_YAML_MAGIC, rc, yaml_len);
+	if ((stress_cluster_write(fd, header, strlen(header)) < 0) ||
+	    (stress_cluster_write(fd, yaml ? yaml : "", yaml_len) < 0))
+		pr_err("agent: failed to send results to %s\n", peer);
+
+	free(yaml);
+	(void)unlink(jobfile);
+	(void)unlink(yamlfile);
+}
+
+/*
+ *  stress_cluster_agent()
+ *	listen on [addr:]port for controller job requests
+ *	and run them one at a time, this never returns unless
+ *	the listening socket cannot be created. The agent only
+ *	listens on the loopback address unless addr is given
+ *	and only runs jobs that carry the shared secret
+ */
+int stress_cluster_agent(const char *opt)
+{
+	struct addrinfo hints, *res, *ai;
+	char *str, *host, *port;
+	char secret[STRESS_CLUSTER_SECRET_MAX];
+	int fd = -1, ret;
+
+	if (stress_cluster_secret("agent", secret, sizeof(secret)) < 0)
+		return EXIT_FAILURE;
+	str = strdup(opt);
+	if (!str) {
+		pr_err("agent: out of memory\n");
+		return EXIT_FAILURE;
+	}
+	if (stress_cluster_split(str, &host, &port, true) < 0) {
+		pr_err("agent: invalid address '%s', expecting [addr:]port\n", opt);
+		free(str);
+		return EXIT_FAILURE;
+	}
+
+	(void)shim_memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	/* only listen on the loopback address unless told otherwise */
+	if (!host)
+		host = "localhost";
+	ret = getaddrinfo(host, port, &hints, &res);
+	if (ret != 0) {
+		pr_err("agent: cannot resolve '%s': %s\n", opt, gai_strerror(ret));
+		free(str);
+		return EXIT_FAILURE;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		const int one = 1;
+
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+		(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if ((bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) &&
+		    (listen(fd, 16) == 0))
+			break;
+		(void)close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (fd < 0) {
+		pr_err("agent: cannot listen on '%s', errno=%d (%s)\n",
+			opt, errno, strerror(errno));
+		free(str);
+		return EXIT_FAILURE;
+	}
+	pr_inf("agent: listening for jobs on %s port %s\n", host, port);
+	free(str);
+	/* a controller going away must not kill the agent */
+	(void)signal(SIGPIPE, SIG_IGN);
+
+	for (;;) {
+		struct sockaddr_storage addr;
+		socklen_t addr_len = sizeof(addr);
+		char peer[NI_MAXHOST];
+		int cfd;
+
+		cfd = accept(fd, (struct sockaddr *)&addr, &addr_len);
+		if (cfd < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_err("agent: accept failed, errno=%d (%s)\n", errno, strerror(errno));
+			break;
+		}
+		if (getnameinfo((struct sockaddr *)&addr, addr_len, peer, sizeof(peer),
+				NULL, 0, NI_NUMERICHOST) != 0)
+			(void)shim_strscpy(peer, "unknown", sizeof(peer));
+		stress_cluster_agent_serve(cfd, peer, secret);
+		(void)close(cfd);
+	}
+	(void)close(fd);
+	return EXIT_FAILURE;
+}
+
+/*
+ *  stress_cluster_connect()
+ *	connect to the agent on host, returns fd or -1 on failure
+ */
+static int stress_cluster_connect(const char *name)
+{
+	struct addrinfo hints, *res, *ai;
+	char *str, *host, *port;
+	int fd = -1, ret;
+
+	str = strdup(name);
+	if (!str)
+		return -1;
+	if (stress_cluster_split(str, &host, &port, false) < 0) {
+		pr_err("controller: invalid agent address '%s', expecting host[:port]\n", name);
+		free(str);
+		return -1;
+	}
+	(void)shim_memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	ret = getaddrinfo(host, port, &hints, &res);
+	if (ret != 0) {
+		pr_err("controller: cannot resolve '%s': %s\n", name, gai_strerror(ret));
+		free(str);
+		return -1;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		(void)close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(res);
+	if (fd < 0)
+		pr_err("controller: cannot connect to agent '%s', errno=%d (%s)\n",
+			name, errno, strerror(errno));
+	free(str);
+	return fd;
+}
+
+/*
+ *  stress_cluster_parse_yaml()
+ *	extract the per stressor bogo ops and bogo ops per second
+ *	from the metrics section of an agent's YAML results
+ */
+static void stress_cluster_parse_yaml(stress_cluster_host_t *host, char *yaml)
+{
+	char *line, *saveptr = NULL;
+	bool in_metrics = false;
+
+	for (line = strtok_r(yaml, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+		stress_cluster_metric_t *metric;
+		char name[64];
+
+		if (*line != ' ') {
+			in_metrics = !strcmp(line, "metrics:");
+			continue;
+		}
+		if (!in_metrics)
+			continue;
+		if (sscanf(line, "    - stressor: %63s", name) == 1) {
+			stress_cluster_metric_t *metrics;
+
+			metrics = (stress_cluster_metric_t *)realloc(host->metrics,
+				(host->n_metrics + 1) * sizeof(*metrics));
+			if (!metrics)
+				return;
+			host->metrics = metrics;
+			metric = &host->metrics[host->n_metrics++];
+			(void)shim_memset(metric, 0, sizeof(*metric));
+			(void)shim_strscpy(metric->name, name, sizeof(metric->name));
+			continue;
+		}
+		if (host->n_metrics == 0)
+			continue;
+		metric = &host->metrics[host->n_metrics - 1];
+		if (sscanf(line, "      bogo-ops: %" SCNu64, &metric->bogo_ops) == 1)
+			continue;
+		(void)sscanf(line, "      bogo-ops-per-second-real-time: %lf", &metric->rate);
+	}
+}
+
+/*
+ *  stress_cluster_find()
+ *	find the metrics of stressor name on a host
+ */
+static const stress_cluster_metric_t *stress_cluster_find(
+	const stress_cluster_host_t *host,
+	const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < host->n_metrics; i++) {
+		if (!strcmp(host->metrics[i].name, name))
+			return &host->metrics[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_cluster_report()
+ *	report per host and aggregate throughput of each stressor
+ *	and the slowest host relative to the cluster mean
+ */
+static void stress_cluster_report(
+	const stress_cluster_host_t *hosts,
+	const size_t n_hosts,
+	const double start,
+	const char *yaml_filename)
+{
+	FILE *yaml = NULL;
+	size_t i, j, k;
+
+	if (yaml_filename) {
+		yaml = fopen(yaml_filename, "w");
+		if (!yaml)
+			pr_err("controller: cannot output YAML data to %s\n", yaml_filename);
+	}
+	pr_yaml(yaml, "---\n");
+	pr_yaml(yaml, "cluster:\n");
+	pr_yaml(yaml, "    start-time: %.0f\n", start);
+	pr_yaml(yaml, "    hosts:\n");
+	for (i = 0; i < n_hosts; i++) {
+		pr_yaml(yaml, "      - host: %s\n", hosts[i].name);
+		pr_yaml(yaml, "        exit-status: %d\n", hosts[i].rc);
+	}
+	pr_yaml(yaml, "    stressors:\n");
+
+	pr_inf("cluster: %-13s %-24s %12s %14s\n",
+		"stressor", "host", "bogo ops", "bogo ops/s");
+	for (i = 0; i < n_hosts; i++) {
+		for (j = 0; j < hosts[i].n_metrics; j++) {
+			const char *name = hosts[i].metrics[j].name;
+			double sum = 0.0, sum_sq = 0.0, mean, stddev, below, min_rate = 0.0;
+			uint64_t ops = 0;
+			const char *min_host = NULL;
+			size_t n = 0;
+
+			/* report each stressor once, on its first host */
+			for (k = 0; k < i; k++) {
+				if (stress_cluster_find(&hosts[k], name))
+					break;
+			}
+			if ((k < i) || (stress_cluster_find(&hosts[i], name) != &hosts[i].metrics[j]))
+				continue;
+
+			pr_yaml(yaml, "      - stressor: %s\n", name);
+			pr_yaml(yaml, "        per-host:\n");
+			for (k = i; k < n_hosts; k++) {
+				const stress_cluster_metric_t *metric = stress_cluster_find(&hosts[k], name);
+
+				if (!metric)
+					continue;
+				pr_inf("cluster: %-13s %-24s %12" PRIu64 " %14.2f\n",
+					name, hosts[k].name, metric->bogo_ops, metric->rate);
+				pr_yaml(yaml, "          - host: %s\n", hosts[k].name);
+				pr_yaml(yaml, "            bogo-ops: %" PRIu64 "\n", metric->bogo_ops);
+				pr_yaml(yaml, "            bogo-ops-per-second-real-time: %f\n", metric->rate);
+				if (!min_host || (metric->rate < min_rate)) {
+					min_host = hosts[k].name;
+					min_rate = metric->rate;
+				}
+				ops += metric->bogo_ops;
+				sum += metric->rate;
+				sum_sq += metric->rate * metric->rate;
+				n++;
+			}
+			mean = sum / (double)n;
+			stddev = sqrt(fabs((sum_sq / (double)n) - (mean * mean)));
+			below = (mean > 0.0) ? 100.0 * (mean - min_rate) / mean : 0.0;
+
+			pr_inf("cluster: %-13s %-24s %12" PRIu64 " %14.2f\n",
+				name, "total", ops, sum);
+			pr_inf("cluster: %-13s %-24s %12s %14.2f (stddev %.2f)\n",
+				name, "mean", "", mean, stddev);
+			pr_inf("cluster: %-13s slowest host %s, %.2f%% below the mean\n",
+				name, min_host, below);
+
+			pr_yaml(yaml, "        hosts: %zu\n", n);
+			pr_yaml(yaml, "        bogo-ops-total: %" PRIu64 "\n", ops);
+			pr_yaml(yaml, "        bogo-ops-per-second-real-time-total: %f\n", sum);
+			pr_yaml(yaml, "        bogo-ops-per-second-real-time-mean: %f\n", mean);
+			pr_yaml(yaml, "        bogo-ops-per-second-real-time-stddev: %f\n", stddev);
+			pr_yaml(yaml, "        slowest-host: %s\n", min_host);
+			pr_yaml(yaml, "        slowest-host-below-mean-percent: %f\n", below);
+		}
+	}
+	pr_yaml(yaml, "...\n");
+	if (yaml)
+		(void)fclose(yaml);
+}
+
+/*
+ *  stress_cluster_controller()
+ *	send the job file to the comma separated list of agents,
+ *	start them all at the same wall clock time, gather their
+ *	YAML results and write a cluster report
+ */
+int stress_cluster_controller(const char *opt, const char *job_filename, const char *yaml_filename)
+{
+	stress_cluster_host_t *hosts;
+	char *str, *token, *saveptr = NULL;
+	char header[STRESS_CLUSTER_HEADER_MAX], when[64];
+	char secret[STRESS_CLUSTER_SECRET_MAX];
+	char *job;
+	size_t i, n_hosts = 1, job_len, connected = 0;
+	double start;
+	int rc = EXIT_SUCCESS;
+	const char *ptr;
+
+	if (!job_filename) {
+		pr_err("controller: a job file must be specified with --job\n");
+		return EXIT_FAILURE;
+	}
+	if (stress_cluster_secret("controller", secret, sizeof(secret)) < 0)
+		return EXIT_FAILURE;
+	job = stress_cluster_read_file(job_filename, STRESS_CLUSTER_JOB_MAX, &job_len);
+	if (!job) {
+		pr_err("controller: cannot read job file %s\n", job_filename);
+		return EXIT_FAILURE;
+	}
+
+	for (ptr = opt; *ptr; ptr++) {
+		if (*ptr == ',')
+			n_hosts++;
+	}
+	hosts = (stress_cluster_host_t *)calloc(n_hosts, sizeof(*hosts));
+	str = strdup(opt);
+	if (!hosts || !str) {
+		pr_err("controller: out of memory\n");
+		free(hosts);
+		free(str);
+		free(job);
+		return EXIT_FAILURE;
+	}
+
+	(void)signal(SIGPIPE, SIG_IGN);
+	n_hosts = 0;
+	for (token = strtok_r(str, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr)) {
+		stress_cluster_host_t *host = &hosts[n_hosts++];
+
+		host->name = token;
+		host->rc = EXIT_FAILURE;
+		host->fd = stress_cluster_connect(token);
+		if (host->fd >= 0)
+			connected++;
+	}
+	if (connected == 0) {
+		pr_err("controller: no agents could be contacted\n");
+		rc = EXIT_FAILURE;
+		goto free_hosts;
+	}
+
+	/* all agents start together at the same wall clock time */
+	start = ceil(stress_time_now() + STRESS_CLUSTER_START_DELAY);
+	(void)snprintf(header, sizeof(header), "%s %s %.0f %zu\n",
+		STRESS_CLUSTER_JOB_MAGIC, secret, start, job_len);
+	for (i = 0; i < n_hosts; i++) {
+		stress_cluster_host_t *host = &hosts[i];
+
+		if (host->fd < 0)
+			continue;
+		if ((stress_cluster_write(host->fd, header, strlen(header)) < 0) ||
+		    (stress_cluster_write(host->fd, job, job_len) < 0)) {
+			pr_err("controller: failed to send job to agent '%s'\n", host->name);
+			(void)close(host->fd);
+			host->fd = -1;
+		}
+	}
+	stress_cluster_time_str(start, when, sizeof(when));
+	pr_inf("controller: dispatched job %s to %zu of %zu agents, starting at %s\n",
+		job_filename, connected, n_hosts, when);
+
+	for (i = 0; i < n_hosts; i++) {
+		stress_cluster_host_t *host = &hosts[i];
+		char magic[32];
+		char *yaml;
+		size_t len;
+
+		if (host->fd < 0) {
+			rc = EXIT_FAILURE;
+			continue;
+		}
+		if ((stress_cluster_read_header(host->fd, header, sizeof(header)) < 0) ||
+		    (sscanf(header, "%31s %d %zu", magic, &host->rc, &len) != 3) ||
+		    strcmp(magic, STRESS_CLUSTER_YAML_MAGIC) ||
+		    (len > STRESS_CLUSTER_YAML_MAX)) {
+			pr_err("controller: invalid results from agent '%s'\n", host->name);
+			host->rc = EXIT_FAILURE;
+			goto next;
+		}
+		yaml = (char *)malloc(len + 1);
+		if (!yaml) {
+			pr_err("controller: out of memory reading results from agent '%s'\n", host->name);
+			goto next;
+		}
+		if (stress_cluster_read(host->fd, yaml, len) < 0) {
+			pr_err("controller: short results read from agent '%s'\n", host->name);
+			free(yaml);
+			goto next;
+		}
+		yaml[len] = '\0';
+		stress_cluster_parse_yaml(host, yaml);
+		free(yaml);
+		pr_inf("controller: agent '%s' finished with exit status %d\n",
+			host->name, host->rc);
+next:
+		if (host->rc != EXIT_SUCCESS)
+			rc = EXIT_FAILURE;
+		(void)close(host->fd);
+		host->fd = -1;
+	}
+	stress_cluster_report(hosts, n_hosts, start, yaml_filename);
+
+free_hosts:
+	for (i = 0; i < n_hosts; i++) {
+		if (hosts[i].fd >= 0)
+			(void)close(hosts[i].fd);
+		free(hosts[i].metrics);
+	}
+	free(hosts);
+	free(str);
+	free(job);
+	return rc;
+}
@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-compare.h"
+
+#define COMPARE_METRICS_MAX	(STRESS_MISC_METRICS_MAX + 16)
+#define COMPARE_THRESHOLD	(5.0)	/* default --compare-threshold, % */
+
+/* bogo-op rate metric, this is always compared */
+#define COMPARE_RATE		"bogo-ops-per-second-real-time"
+#define COMPARE_RATE_STDDEV	"bogo-ops-per-second-real-time-instance-stddev"
+#define COMPARE_INSTANCES	"instances"
+
+/* a metric loaded from the baseline YAML */
+typedef struct {
+	char *key;			/* yamlified metric name */
+	double value;			/* metric value */
+} stress_compare_metric_t;
+
+/* per stressor metrics loaded from the baseline YAML */
+typedef struct stress_compare_base {
+	struct stress_compare_base *next;
+	char name[64];			/* munged stressor name */
+	size_t count;			/* number of metrics */
+	stress_compare_metric_t metrics[COMPARE_METRICS_MAX];
+} stress_compare_base_t;
+
+static stress_compare_base_t *compare_base;
+static double compare_threshold = COMPARE_THRESHOLD;
+static const char *compare_filename;
+
+/*
+ *  two sided 95% critical values of Student's t distribution
+ *  for 1..30 degrees of freedom
+ */
+static const double t_crit_95[] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+};
+
+/*
+ *  stress_set_compare_threshold()
+ *	parse --compare-threshold option, the percentage a metric
+ *	has to be worse than the baseline to be a regression
+ */
+int stress_set_compare_threshold(const char *const opt)
+{
+	char *end;
+	const double threshold = strtod(opt, &end);
+
+	if ((end == opt) || (*end != '\0') || (threshold < 0.0) || (threshold > 100.0)) {
+		(void)fprintf(stderr, "compare-threshold must be a percentage from 0 to 100.\n");
+		_exit(EXIT_FAILURE);
+	}
+	compare_threshold = threshold;
+
+	return 0;
+}
+
+/*
+ *  stress_compare_get_threshold()
+ *	get the --compare-threshold percentage
+ */
+double stress_compare_get_threshold(void)
+{
+	return compare_threshold;
+}
+
+/*
+ *  stress_compare_t_crit()
+ *	95% two sided critical t value for df degrees of freedom
+ */
+double stress_compare_t_crit(const double df)
+{
+	if (df < 1.0)
+		return t_crit_95[0];
+	if (df <= (double)SIZEOF_ARRAY(t_crit_95))
+		return t_crit_95[(size_t)df - 1];
+	if (df < 60.0)
+		return 2.021;
+	if (df < 120.0)
+		return 2.000;
+	return 1.960;
+}
+
+/*
+ *  stress_compare_find()
+ *	find a metric of a baseline stressor, returns true if found
+ */
+static bool stress_compare_find(
+	const stress_compare_base_t *base,
+	const char *key,
+	double *value)
+{
+	size_t i;
+
+	for (i = 0; i < base->count; i++) {
+		if (!strcmp(base->metrics[i].key, key)) {
+			*value = base->metrics[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ *  stress_compare_free()
+ *	free the baseline metrics
+ */
+void stress_compare_free(void)
+{
+	while (compare_base) {
+		stress_compare_base_t *next = compare_base->next;
+		size_t i;
+
+		for (i = 0; i < compare_base->count; i++)
+			free(compare_base->metrics[i].key);
+		free(compare_base);
+		compare_base = next;
+	}
+}
+
+/*
+ *  stress_compare_load()
+ *	load the per stressor metrics from the metrics: section of a
+ *	--compare baseline YAML file produced by an earlier --yaml run,
+ *	returns 0 if successful or no baseline is being used, -1 on error
+ */
+int stress_compare_load(void)
+{
+	char *filename = NULL;
+	char buf[4096];
+	stress_compare_base_t *base = NULL, *tail = NULL;
+	bool in_metrics = false;
+	FILE *fp;
+
+	if (!stress_get_setting("compare", &filename) || !filename)
+		return 0;
+	/* the misc metrics being compared are computed with the metrics */
+	g_opt_flags |= OPT_FLAGS_METRICS;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_err("compare: cannot open baseline file %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *key, *val, *end;
+		double value;
+
+		buf[strcspn(buf, "\r\n")] = '\0';
+		if (!strcmp(buf, "metrics:")) {
+			in_metrics = true;
+			continue;
+		}
+		if (!in_metrics)
+			continue;
+		/* a new top level key ends the metrics */
+		if ((buf[0] != '\0') && (buf[0] != ' ')) {
+			in_metrics = false;
+			continue;
+		}
+		if (!strncmp(buf, "    - stressor: ", 16)) {
+			base = (stress_compare_base_t *)calloc(1, sizeof(*base));
+			if (!base) {
+				pr_err("compare: cannot allocate baseline metrics\n");
+				(void)fclose(fp);
+				stress_compare_free();
+				return -1;
+			}
+			(void)shim_strscpy(base->name, buf + 16, sizeof(base->name));
+			if (tail)
+				tail->next = base;
+			else
+				compare_base = base;
+			tail = base;
+			continue;
+		}
+		/* only metrics of the current stressor, ignore nested data */
+		if (!base || strncmp(buf, "      ", 6) || (buf[6] == ' ') || (buf[6] == '-'))
+			continue;
+		key = buf + 6;
+		val = strstr(key, ": ");
+		if (!val)
+			continue;
+		*val = '\0';
+		val += 2;
+		value = strtod(val, &end);
+		if ((end == val) || (*end != '\0'))
+			continue;
+		if (base->count >= COMPARE_METRICS_MAX)
+			continue;
+		base->metrics[base->count].key = strdup(key);
+		if (!base->metrics[base->count].key)
+			continue;
+		base->metrics[base->count].value = value;
+		base->count++;
+	}
+	(void)fclose(fp);
+
+	if (!compare_base) {
+		pr_err("compare: no stressor metrics found in baseline file %s\n", filename);
+		return -1;
+	}
+	compare_filename = filename;
+	return 0;
+}
+
+/*
+ *  stress_compare_instance_rate()
+ *	mean and sample standard deviation of the real time bogo-op
+ *	rates of the completed instances of a stressor
+ */
+void stress_compare_instance_rate(
+	const stress_stressor_t *ss,
+	double *mean,
+	double *stddev,
+	int32_t *n)
+{
+	double sum = 0.0, sum_sq = 0.0;
+	int32_t j, count = 0;
+
+	*mean = 0.0;
+	*stddev = 0.0;
+	*n = 0;
+
+	if (!ss->stats)
+		return;
+
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+		double rate;
+
+		if (!stats->completed || (stats->duration_total <= 0.0))
+			continue;
+		rate = (double)stats->counter_total / stats->duration_total;
+		sum += rate;
+		sum_sq += rate * rate;
+		count++;
+	}
+	if (count == 0)
+		return;
+
+	*mean = sum / (double)count;
+	if (count > 1) {
+		const double var = (sum_sq - (sum * sum) / (double)count) / (double)(count - 1);
+
+		*stddev = (var > 0.0) ? sqrt(var) : 0.0;
+	}
+	*n = count;
+}
+
+/*
+ *  stress_compare_verdict()
+ *	report a metric against the baseline, higher is +1 if higher
+ *	values are better, -1 if lower values are better and 0 if
+ *	unknown, returns true if the metric has regressed
+ */
+static bool stress_compare_verdict(
+	FILE *yaml,
+	const char *name,
+	const char *key,
+	const double baseline,
+	const double current,
+	const int higher,
+	const bool tested,
+	const double t,
+	const bool significant)
+{
+	const double delta = (baseline != 0.0) ?
+		100.0 * (current - baseline) / fabs(baseline) : 0.0;
+	const double better = delta * (double)higher;
+	const char *verdict;
+	bool regressed = false;
+	char tstr[32];
+
+	if (higher == 0) {
+		verdict = "-";
+	} else if (tested && !significant) {
+		verdict = "within noise";
+	} else if (better < -compare_threshold) {
+		verdict = "regressed";
+		regressed = true;
+	} else if (better > compare_threshold) {
+		verdict = "improved";
+	} else {
+		verdict = "unchanged";
+	}
+
+	if (tested)
+		(void)snprintf(tstr, sizeof(tstr), "%7.2f", t);
+	else
+		(void)shim_strscpy(tstr, "      -", sizeof(tstr));
+
+	pr_inf("%-13s %-36.36s %12.2f %12.2f %7.2f%% %s %s\n",
+		name, key, baseline, current, delta, tstr, verdict);
+
+	pr_yaml(yaml, "    - stressor: %s\n", name);
+	pr_yaml(yaml, "      metric: %s\n", key);
+	pr_yaml(yaml, "      baseline: %f\n", baseline);
+	pr_yaml(yaml, "      current: %f\n", current);
+	pr_yaml(yaml, "      delta-percent: %f\n", delta);
+	if (tested)
+		pr_yaml(yaml, "      t-statistic: %f\n", t);
+	pr_yaml(yaml, "      verdict: %s\n", verdict);
+	pr_yaml(yaml, "\n");
+
+	return regressed;
+}
+
+/*
+ *  stress_compare_direction()
+ *	guess if higher values of a misc metric are better (+1),
+ *	worse (-1) or if this is unknown (0) from its name
+ */
+static int stress_compare_direction(const char *key)
+{
+	if (strstr(key, "latency"))
+		return -1;
+	if (strstr(key, "per-sec") || strstr(key, "-rate"))
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_compare_dump()
+ *	compare the bogo-op rates and misc metrics of the stressors
+ *	against the --compare baseline, the bogo-op rates are checked
+ *	for significance with Welch's t-test on the per instance rates.
+ *	Returns true if any metric has regressed by more than the
+ *	--compare-threshold percentage.
+ */
+bool stress_compare_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool regressed = false;
+
+	if (!compare_base)
+		return false;
+
+	pr_block_begin();
+	pr_inf("compare: against baseline %s, regression threshold %.2f%%\n",
+		compare_filename, compare_threshold);
+	pr_inf("%-13s %-36s %12s %12s %8s %7s %s\n",
+		"stressor", "metric", "baseline", "current", "delta", "t", "verdict");
+
+	pr_yaml(yaml, "compare-info:\n");
+	pr_yaml(yaml, "      baseline: %s\n", compare_filename);
+	pr_yaml(yaml, "      threshold-percent: %f\n", compare_threshold);
+	pr_yaml(yaml, "\n");
+	pr_yaml(yaml, "compare:\n");
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_compare_base_t *base;
+		char name[64];
+		double mean, stddev, base_rate, base_stddev, base_n, rate, r_total = 0.0;
+		double t = 0.0;
+		uint64_t c_total = 0;
+		int32_t j, n, completed = 0;
+		bool tested = false, significant = false;
+		size_t i;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+		for (base = compare_base; base; base = base->next) {
+			if (!strcmp(base->name, name))
+				break;
+		}
+		if (!base) {
+			pr_inf("%-13s not in baseline\n", name);
+			continue;
+		}
+
+		/* aggregate rate, computed in the same way as the YAML metrics */
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if (stats->completed)
+				completed++;
+			c_total += stats->counter_total;
+			r_total += stats->duration_total;
+		}
+		r_total = completed ? r_total / (double)completed : 0.0;
+		rate = (r_total > 0.0) ? (double)c_total / r_total : 0.0;
+
+		if (stress_compare_find(base, COMPARE_RATE, &base_rate)) {
+			stress_compare_instance_rate(ss, &mean, &stddev, &n);
+
+			/* Welch's t-test on the per instance rates */
+			if (stress_compare_find(base, COMPARE_RATE_STDDEV, &base_stddev) &&
+			    stress_compare_find(base, COMPARE_INSTANCES, &base_n) &&
+			    (base_n >= 2.0) && (n >= 2)) {
+				const double base_mean = base_rate / base_n;
+				const double v1 = (base_stddev * base_stddev) / base_n;
+				const double v2 = (stddev * stddev) / (double)n;
+
+				tested = true;
+				if ((v1 + v2) > 0.0) {
+					const double df = ((v1 + v2) * (v1 + v2)) /
+						((v1 * v1) / (base_n - 1.0) + (v2 * v2) / (double)(n - 1));
+
+					t = (mean - base_mean) / sqrt(v1 + v2);
+					significant = fabs(t) > stress_compare_t_crit(df);
+				} else {
+					significant = (mean != base_mean);
+				}
+			}
+			regressed |= stress_compare_verdict(yaml, name, COMPARE_RATE,
+				base_rate, rate, 1, tested, t, significant);
+		}
+
+		/* same mean over the completed instances as the YAML metrics */
+		for (i = 0; i < STRESS_MISC_METRICS_MAX; i++) {
+			const char *description = ss->stats[0]->metrics.items[i].description;
+			const char *key;
+			double base_value;
+
+			if (!description)
+				continue;
+			key = stress_description_yamlify(description);
+			if (!stress_compare_find(base, key, &base_value))
+				continue;
+			regressed |= stress_compare_verdict(yaml, name, key, base_value,
+				stress_metrics_mean(ss, i),
+				stress_compare_direction(key), false, 0.0, false);
+		}
+	}
+	if (regressed)
+		pr_inf("compare: one or more metrics regressed by more than %.2f%%\n",
+			compare_threshold);
+	pr_block_end();
+
+	return regressed;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_COMPARE_H
+#define CORE_COMPARE_H
+
+#include "stress-ng.h"
+
+extern int stress_set_compare_threshold(const char *const opt);
+extern double stress_compare_get_threshold(void);
+extern double stress_compare_t_crit(const double df);
+extern int stress_compare_load(void);
+extern void stress_compare_free(void);
+extern void stress_compare_instance_rate(const stress_stressor_t *ss,
+	double *mean, double *stddev, int32_t *n);
+extern bool stress_compare_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
@@ -586,6 +586,46 @@ bool stress_cpu_x86_has_serialize(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_erms()
+ *	does x86 cpu support enhanced rep movsb/stosb?
+ */
+bool stress_cpu_x86_has_erms(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_erms_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fsrm()
+ *	does x86 cpu support fast short rep movsb?
+ */
+bool stress_cpu_x86_has_fsrm(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(edx & CPUID_fsrm_EDX);
+#else
+	return false;
+#endif
+}
+
 /*
  *  stress_cpu_x86_has_avx_vnni()
  *	does x86 cpu support avx_vnni
@@ -606,6 +646,62 @@ bool stress_cpu_x86_has_avx_vnni(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_avx2()
+ *	does x86 cpu support avx2 (and the OS save the ymm registers)
+ */
+bool stress_cpu_x86_has_avx2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+	if (!(ecx & CPUID_osxsave_ECX))
+		return false;
+
+	eax = 0x7;
+	ebx = 0;
+	ecx = 0;
+	edx = 0;
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_avx2_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_avx512_f()
+ *	does x86 cpu support avx512_f (and the OS save the zmm registers)
+ */
+bool stress_cpu_x86_has_avx512_f(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+	if (!(ecx & CPUID_osxsave_ECX))
+		return false;
+
+	eax = 0x7;
+	ebx = 0;
+	ecx = 0;
+	edx = 0;
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_avx512_f_EBX);
+#else
+	return false;
+#endif
+}
+
 /*
  *  stress_cpu_x86_has_avx512_vl()
  *	does x86 cpu support avx512_vl
@@ -666,3 +762,64 @@ bool stress_cpu_x86_has_avx512_bw(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_amx_int8()
+ *	does x86 cpu support amx_tile and amx_int8
+ */
+bool stress_cpu_x86_has_amx_int8(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return (edx & (CPUID_amx_tile_EDX | CPUID_amx_int8_EDX)) ==
+		(CPUID_amx_tile_EDX | CPUID_amx_int8_EDX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_amx_bf16()
+ *	does x86 cpu support amx_tile and amx_bf16
+ */
+bool stress_cpu_x86_has_amx_bf16(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return (edx & (CPUID_amx_tile_EDX | CPUID_amx_bf16_EDX)) ==
+		(CPUID_amx_tile_EDX | CPUID_amx_bf16_EDX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_sse4_2()
+ *	does x86 cpu support sse4_2
+ */
+bool stress_cpu_x86_has_sse4_2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_sse4_2_ECX);
+#else
+	return false;
+#endif
+}
@@ -38,9 +38,16 @@ extern WARN_UNUSED bool stress_cpu_x86_has_mmx(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_sse(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_sse2(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_serialize(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_erms(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fsrm(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx_vnni(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx512_f(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_vl(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_vnni(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_bw(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_amx_int8(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_amx_bf16(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_sse4_2(void);
 
 #endif
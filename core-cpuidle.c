@@ -17,8 +17,12 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-cpuidle.h"
 #include "core-sort.h"
+#include "core-time.h"
+
+#include <sched.h>
 
 static cpu_cstate_t *cpu_cstate_list;
 static size_t cpu_cstate_list_len;
@@ -177,3 +181,200 @@ void stress_cpuidle_log_info(void)
 		cpu_cstate_list_len, (cpu_cstate_list_len == 1) ? "" : "s", buf);
 	free(buf);
 }
+
+#if defined(__linux__) &&		\
+    defined(HAVE_SCHED_GETAFFINITY)
+static cpu_set_t cpuidle_cpu_set;	/* CPUs sampled by this instance */
+
+/*
+ *  stress_cpuidle_cstate_index()
+ *	index of a C-state in the C-state list, -1 if not found
+ */
+static int stress_cpuidle_cstate_index(const char *cstate)
+{
+	const cpu_cstate_t *cc;
+	int i;
+
+	for (i = 0, cc = cpu_cstate_list; cc; cc = cc->next, i++) {
+		if (!strcmp(cstate, cc->cstate))
+			return (i < STRESS_CSTATES_MAX) ? i : -1;
+	}
+	return -1;
+}
+
+/*
+ *  stress_cpuidle_stats_read()
+ *	sum the per C-state time (microseconds) and usage counts of
+ *	the CPUs in cpuidle_cpu_set, returns the number of CPUs that
+ *	have C-states
+ */
+static uint32_t stress_cpuidle_stats_read(uint64_t *time, uint64_t *usage)
+{
+	uint32_t cpus = 0;
+	int cpu;
+
+	(void)shim_memset(time, 0, sizeof(*time) * STRESS_CSTATES_MAX);
+	(void)shim_memset(usage, 0, sizeof(*usage) * STRESS_CSTATES_MAX);
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		int state;
+
+		if (!CPU_ISSET(cpu, &cpuidle_cpu_set))
+			continue;
+
+		for (state = 0; ; state++) {
+			char path[PATH_MAX], data[64], *ptr;
+			int idx;
+
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%d/cpuidle/state%d/name", cpu, state);
+			if (stress_system_read(path, data, sizeof(data)) < 1)
+				break;
+			ptr = strchr(data, '\n');
+			if (ptr)
+				*ptr = '\0';
+			idx = stress_cpuidle_cstate_index(data);
+			if (idx < 0)
+				continue;
+
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%d/cpuidle/state%d/time", cpu, state);
+			if (stress_system_read(path, data, sizeof(data)) > 0)
+				time[idx] += (uint64_t)strtoull(data, NULL, 10);
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%d/cpuidle/state%d/usage", cpu, state);
+			if (stress_system_read(path, data, sizeof(data)) > 0)
+				usage[idx] += (uint64_t)strtoull(data, NULL, 10);
+		}
+		if (state > 0)
+			cpus++;
+	}
+	return cpus;
+}
+
+/*
+ *  stress_cpuidle_stats_start()
+ *	snapshot the C-state time and usage counters of the CPUs
+ *	the stressor instance is allowed to run on
+ */
+void stress_cpuidle_stats_start(stress_cstates_t *cstates)
+{
+	(void)shim_memset(cstates, 0, sizeof(*cstates));
+	if (cpu_cstate_list_len < 1)
+		return;
+	if (sched_getaffinity(0, sizeof(cpuidle_cpu_set), &cpuidle_cpu_set) < 0)
+		return;
+
+	cstates->cpus = stress_cpuidle_stats_read(cstates->time_start, cstates->usage_start);
+	cstates->when_start = stress_time_now();
+}
+
+/*
+ *  stress_cpuidle_stats_stop()
+ *	snapshot the C-state time and usage counters of the same
+ *	CPUs sampled by stress_cpuidle_stats_start()
+ */
+void stress_cpuidle_stats_stop(stress_cstates_t *cstates)
+{
+	if ((cstates->cpus == 0) || (cstates->when_start <= 0.0))
+		return;
+
+	cstates->when_stop = stress_time_now();
+	if (stress_cpuidle_stats_read(cstates->time_stop, cstates->usage_stop) != cstates->cpus)
+		cstates->cpus = 0;	/* CPUs went offline, discard */
+}
+#else
+void stress_cpuidle_stats_start(stress_cstates_t *cstates)
+{
+	(void)shim_memset(cstates, 0, sizeof(*cstates));
+}
+
+void stress_cpuidle_stats_stop(stress_cstates_t *cstates)
+{
+	(void)cstates;
+}
+#endif
+
+/*
+ *  stress_cpuidle_stats_dump()
+ *	dump the C-state residency as a percentage of the CPU time
+ *	of the CPUs each stressor ran on and the C-state entries per
+ *	second per CPU, the C-states are ordered by target residency
+ */
+void stress_cpuidle_stats_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	const cpu_cstate_t *order[STRESS_CSTATES_MAX];
+	const cpu_cstate_t *cc;
+	stress_stressor_t *ss;
+	size_t i, j, n;
+	bool pr_heading = false;
+
+	for (n = 0, cc = cpu_cstate_list; cc && (n < STRESS_CSTATES_MAX); cc = cc->next)
+		order[n++] = cc;
+	if (n == 0) {
+		pr_inf("cstate-stats: no CPU idle C-states found, cannot report C-state residency\n");
+		return;
+	}
+	/* insertion sort by target residency, shallow C-states first */
+	for (i = 1; i < n; i++) {
+		const cpu_cstate_t *tmp = order[i];
+
+		for (j = i; (j > 0) && (order[j - 1]->residency > tmp->residency); j--)
+			order[j] = order[j - 1];
+		order[j] = tmp;
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t time[STRESS_CSTATES_MAX], usage[STRESS_CSTATES_MAX];
+		double cpu_usecs = 0.0, idle_pct = 0.0;
+		char munged[64];
+		int32_t k;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+
+		(void)shim_memset(time, 0, sizeof(time));
+		(void)shim_memset(usage, 0, sizeof(usage));
+		for (k = 0; k < ss->num_instances; k++) {
+			const stress_cstates_t *cstates = &ss->stats[k]->cstates;
+
+			if ((cstates->cpus == 0) || (cstates->when_stop <= cstates->when_start))
+				continue;
+			cpu_usecs += (double)cstates->cpus *
+				(cstates->when_stop - cstates->when_start) * STRESS_DBL_MICROSECOND;
+			for (i = 0; i < STRESS_CSTATES_MAX; i++) {
+				time[i] += cstates->time_stop[i] - cstates->time_start[i];
+				usage[i] += cstates->usage_stop[i] - cstates->usage_start[i];
+			}
+		}
+		if (cpu_usecs <= 0.0)
+			continue;
+
+		if (!pr_heading) {
+			pr_inf("C-state residency (%% of time on the CPUs the instances ran on):\n");
+			pr_yaml(yaml, "cstates:\n");
+			pr_heading = true;
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("%s:\n", munged);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+
+		for (j = 0; j < n; j++) {
+			const int idx = stress_cpuidle_cstate_index(order[j]->cstate);
+			double pct, rate;
+
+			if (idx < 0)
+				continue;
+			pct = 100.0 * (double)time[idx] / cpu_usecs;
+			rate = (double)usage[idx] / (cpu_usecs / STRESS_DBL_MICROSECOND);
+			idle_pct += pct;
+			pr_inf("   %-8s %6.2f%% residency, %12.2f entries per sec per CPU\n",
+				order[j]->cstate, pct, rate);
+			pr_yaml(yaml, "      %s-residency-percent: %.2f\n", order[j]->cstate, pct);
+			pr_yaml(yaml, "      %s-entries-per-sec: %.2f\n", order[j]->cstate, rate);
+		}
+		idle_pct = (idle_pct > 100.0) ? 0.0 : 100.0 - idle_pct;
+		pr_inf("   %-8s %6.2f%% residency (not idle)\n", "C0", idle_pct);
+		pr_yaml(yaml, "      C0-residency-percent: %.2f\n\n", idle_pct);
+	}
+}
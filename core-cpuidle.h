@@ -29,5 +29,8 @@ extern void stress_cpuidle_init(void);
 extern void stress_cpuidle_free(void);
 extern void stress_cpuidle_log_info(void);
 extern cpu_cstate_t *stress_cpuidle_cstate_list_head(void);
+extern void stress_cpuidle_stats_start(stress_cstates_t *cstates);
+extern void stress_cpuidle_stats_stop(stress_cstates_t *cstates);
+extern void stress_cpuidle_stats_dump(FILE *yaml, stress_stressor_t *stressors_list);
 
 #endif
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-arch.h"
+#include "core-asm-arm.h"
+#include "core-asm-loong64.h"
+#include "core-asm-s390.h"
+#include "core-asm-sparc.h"
+#include "core-asm-x86.h"
+#include "core-cpu.h"
+#include "core-cycles.h"
+#include "core-latency.h"
+#include "core-ops-rate.h"
+
+#if defined(HAVE_SYS_PLATFORM_PPC_H)
+#include <sys/platform/ppc.h>
+#endif
+
+typedef struct {
+	char *description;		/* metrics description */
+	int mean_type;			/* type of metric mean */
+} stress_cycles_metric_t;
+
+/*
+ *  Cycle counter metrics, these sit just below the
+ *  stress_ops_rate_metrics() slots at the top of the
+ *  misc metrics to keep clear of the stressor metrics
+ */
+static const stress_cycles_metric_t cycles_metrics[STRESS_CYCLES_METRICS] = {
+	{ "cycles per bogo op",	STRESS_GEOMETRIC_MEAN },
+	{ "cycles per second",	STRESS_GEOMETRIC_MEAN },
+};
+
+#define STRESS_CYCLES_METRICS_BASE				\
+	(STRESS_MISC_METRICS_MAX - STRESS_LATENCY_METRICS -	\
+	 STRESS_OPS_RATE_METRICS - SIZEOF_ARRAY(cycles_metrics))
+
+/*
+ *  stress_cycles_read()
+ *	read the free running cycle counter, the counter is
+ *	the time stamp counter or the closest architectural
+ *	equivalent and ticks at a constant rate, returns
+ *	false if there is no usable counter
+ */
+static inline bool stress_cycles_read(uint64_t *cycles)
+{
+#if defined(STRESS_ARCH_X86) &&		\
+    !defined(HAVE_COMPILER_PCC) &&	\
+    !defined(HAVE_COMPILER_TCC)
+	static int x86_has_tsc = -1;
+
+	if (UNLIKELY(x86_has_tsc < 0))
+		x86_has_tsc = stress_cpu_is_x86() && stress_cpu_x86_has_tsc();
+	if (!x86_has_tsc)
+		return false;
+	*cycles = stress_asm_x86_rdtsc();
+	return true;
+#elif defined(STRESS_ARCH_ARM) &&	\
+      defined(__aarch64__)
+	*cycles = stress_asm_arm_cntvct();
+	return true;
+#elif defined(STRESS_ARCH_PPC64) &&		\
+      defined(HAVE_SYS_PLATFORM_PPC_H) &&	\
+      defined(HAVE_PPC_GET_TIMEBASE)
+	*cycles = (uint64_t)__ppc_get_timebase();
+	return true;
+#elif defined(STRESS_ARCH_S390)
+	*cycles = stress_asm_s390_stck();
+	return true;
+#elif defined(STRESS_ARCH_SPARC) &&	\
+      defined(HAVE_ASM_SPARC_TICK)
+	*cycles = stress_asm_sparc_tick();
+	return true;
+#elif defined(STRESS_ARCH_LOONG64) &&	\
+      defined(HAVE_ASM_LOONG64_RDTIME)
+	*cycles = stress_asm_loong64_rdtime();
+	return true;
+#else
+	(void)cycles;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_cycles_supported()
+ *	return true if there is a cycle counter to read
+ */
+bool stress_cycles_supported(void)
+{
+	uint64_t cycles;
+
+	return stress_cycles_read(&cycles);
+}
+
+/*
+ *  stress_cycles_get()
+ *	get the cycle counter, 0 if there is no cycle counter
+ */
+uint64_t OPTIMIZE3 stress_cycles_get(void)
+{
+	uint64_t cycles;
+
+	return stress_cycles_read(&cycles) ? cycles : 0;
+}
+
+/*
+ *  stress_cycles_metrics()
+ *	set the cycles per bogo op and cycles per second of
+ *	the run time of each completed instance of a stressor,
+ *	these are independent of the clock speed and need no
+ *	perf permissions
+ */
+void stress_cycles_metrics(stress_stressor_t *ss)
+{
+	int32_t j;
+
+	if (!ss->stats || !stress_cycles_supported())
+		return;
+
+	for (j = 0; j < ss->num_instances; j++) {
+		stress_stats_t *const stats = ss->stats[j];
+		double values[SIZEOF_ARRAY(cycles_metrics)];
+		size_t i;
+
+		if (!stats->completed || (stats->cycles_total == 0))
+			continue;
+
+		values[0] = (stats->counter_total > 0) ?
+			(double)stats->cycles_total / (double)stats->counter_total : 0.0;
+		values[1] = (stats->duration_total > 0.0) ?
+			(double)stats->cycles_total / stats->duration_total : 0.0;
+
+		for (i = 0; i < SIZEOF_ARRAY(cycles_metrics); i++)
+			stress_metrics_set(&stats->args, STRESS_CYCLES_METRICS_BASE + i,
+				cycles_metrics[i].description, values[i],
+				cycles_metrics[i].mean_type);
+	}
+}
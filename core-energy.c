@@ -0,0 +1,503 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-energy.h"
+#include "core-killpid.h"
+
+#define STRESS_ENERGY_DOMAINS_MAX	(16)	/* max energy counters tracked */
+#define STRESS_ENERGY_HWMON_MAX		(16)	/* max energyN_input per hwmon */
+#define STRESS_ENERGY_SAMPLE_SECS	(1.0)	/* counter sampling interval */
+
+/* An energy counter, all counters are in microjoules */
+typedef struct {
+	char name[64];			/* domain name, e.g. rapl-package-0 */
+	char path[PATH_MAX];		/* counter sysfs path */
+	uint64_t range;			/* counter wrap range, 0 = 64 bit */
+} stress_energy_domain_t;
+
+/*
+ *  Counter totals, shared with the sampling process, this is
+ *  the only writer and seq is odd while it updates the totals
+ */
+typedef struct {
+	volatile uint32_t seq;		/* update sequence count */
+	uint64_t last[STRESS_ENERGY_DOMAINS_MAX];  /* last counter reading */
+	uint64_t total[STRESS_ENERGY_DOMAINS_MAX]; /* total microjoules */
+} stress_energy_shared_t;
+
+/* Energy used while a stressor was running */
+typedef struct stress_energy_record {
+	struct stress_energy_record *next;	/* next record in list */
+	const stress_stressor_t *ss;	/* stressor */
+	double duration;		/* run duration in seconds */
+	uint64_t used[STRESS_ENERGY_DOMAINS_MAX]; /* microjoules used */
+} stress_energy_record_t;
+
+static stress_energy_domain_t energy_domains[STRESS_ENERGY_DOMAINS_MAX];
+static size_t energy_domains_num;
+static stress_energy_shared_t *energy_shared = MAP_FAILED;
+static stress_energy_record_t *energy_records;
+static uint64_t energy_begin[STRESS_ENERGY_DOMAINS_MAX];
+static pid_t energy_pid = -1;
+
+/*
+ *  stress_energy_read()
+ *	read a microjoule energy counter, returns false on failure
+ */
+static bool stress_energy_read(const char *path, uint64_t *uj)
+{
+	char buf[64];
+
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	return sscanf(buf, "%" SCNu64, uj) == 1;
+}
+
+/*
+ *  stress_energy_read_name()
+ *	read a sysfs name file into name and strip the newline
+ */
+static bool stress_energy_read_name(const char *path, char *name, const size_t len)
+{
+	char *ptr;
+
+	if (stress_system_read(path, name, len) <= 0)
+		return false;
+	ptr = strchr(name, '\n');
+	if (ptr)
+		*ptr = '\0';
+	return *name != '\0';
+}
+
+/*
+ *  stress_energy_add()
+ *	add a domain if its counter is readable, RAPL counters
+ *	are readable by root only on most kernels
+ */
+static void stress_energy_add(const char *name, const char *path, const uint64_t range)
+{
+	stress_energy_domain_t *domain;
+	uint64_t uj;
+
+	if (energy_domains_num >= STRESS_ENERGY_DOMAINS_MAX)
+		return;
+	if (!stress_energy_read(path, &uj))
+		return;
+
+	domain = &energy_domains[energy_domains_num++];
+	(void)stress_munge_underscore(domain->name, name, sizeof(domain->name));
+	(void)shim_strscpy(domain->path, path, sizeof(domain->path));
+	domain->range = range;
+}
+
+/*
+ *  stress_energy_powercap()
+ *	find the powercap RAPL domains, package, core, uncore,
+ *	dram and psys. The intel-rapl-mmio zones duplicate the
+ *	package zones so these are ignored
+ */
+static void stress_energy_powercap(void)
+{
+	static const char powercap[] = "/sys/class/powercap";
+	struct dirent **namelist = NULL;
+	int i, n;
+
+	n = scandir(powercap, &namelist, NULL, alphasort);
+	for (i = 0; i < n; i++) {
+		const char *d_name = namelist[i]->d_name;
+		char path[PATH_MAX], zone[64], parent[64], name[160];
+		const char *colon;
+		uint64_t range = 0;
+
+		if ((*d_name == '.') || strncmp(d_name, "intel-rapl:", 11))
+			continue;
+
+		(void)snprintf(path, sizeof(path), "%s/%s/name", powercap, d_name);
+		if (!stress_energy_read_name(path, zone, sizeof(zone)))
+			continue;
+
+		/* sub-zones, e.g. intel-rapl:0:1, are named after their parent zone */
+		colon = strrchr(d_name, ':');
+		if (colon && (colon - d_name > 10)) {
+			char parent_name[64];
+
+			(void)snprintf(parent_name, sizeof(parent_name), "%.*s", (int)(colon - d_name), d_name);
+			(void)snprintf(path, sizeof(path), "%s/%s/name", powercap, parent_name);
+			if (!stress_energy_read_name(path, parent, sizeof(parent)))
+				continue;
+			(void)snprintf(name, sizeof(name), "rapl-%s-%s", parent, zone);
+		} else {
+			(void)snprintf(name, sizeof(name), "rapl-%s", zone);
+		}
+
+		(void)snprintf(path, sizeof(path), "%s/%s/max_energy_range_uj", powercap, d_name);
+		if (!stress_energy_read(path, &range))
+			range = 0;
+		(void)snprintf(path, sizeof(path), "%s/%s/energy_uj", powercap, d_name);
+		stress_energy_add(name, path, range);
+	}
+	stress_dirent_list_free(namelist, n);
+}
+
+/*
+ *  stress_energy_hwmon()
+ *	find the hwmon energyN_input counters, e.g. amd_energy
+ *	core and socket counters
+ */
+static void stress_energy_hwmon(void)
+{
+	static const char hwmon[] = "/sys/class/hwmon";
+	struct dirent **namelist = NULL;
+	int i, n;
+
+	n = scandir(hwmon, &namelist, NULL, alphasort);
+	for (i = 0; i < n; i++) {
+		const char *d_name = namelist[i]->d_name;
+		char path[PATH_MAX], chip[64];
+		int j;
+
+		if (*d_name == '.')
+			continue;
+		(void)snprintf(path, sizeof(path), "%s/%s/name", hwmon, d_name);
+		if (!stress_energy_read_name(path, chip, sizeof(chip)))
+			continue;
+
+		for (j = 1; j <= STRESS_ENERGY_HWMON_MAX; j++) {
+			char label[64], name[160];
+
+			(void)snprintf(path, sizeof(path), "%s/%s/energy%d_label", hwmon, d_name, j);
+			if (!stress_energy_read_name(path, label, sizeof(label)))
+				(void)snprintf(label, sizeof(label), "energy%d", j);
+			(void)snprintf(name, sizeof(name), "hwmon-%s-%s", chip, label);
+			(void)snprintf(path, sizeof(path), "%s/%s/energy%d_input", hwmon, d_name, j);
+			stress_energy_add(name, path, 0);
+		}
+	}
+	stress_dirent_list_free(namelist, n);
+}
+
+/*
+ *  stress_energy_delta()
+ *	microjoules between two counter readings, handles
+ *	a counter that has wrapped once
+ */
+static uint64_t stress_energy_delta(const stress_energy_domain_t *domain,
+	const uint64_t prev, const uint64_t now)
+{
+	if (now >= prev)
+		return now - prev;
+	return (domain->range > prev) ? (domain->range - prev) + now : 0;
+}
+
+/*
+ *  stress_energy_sample()
+ *	sample the counters and add to the totals, called
+ *	by the sampling process only
+ */
+static void stress_energy_sample(void)
+{
+	size_t i;
+
+	energy_shared->seq++;
+	stress_asm_mb();
+	for (i = 0; i < energy_domains_num; i++) {
+		uint64_t uj;
+
+		if (!stress_energy_read(energy_domains[i].path, &uj))
+			continue;
+		energy_shared->total[i] += stress_energy_delta(&energy_domains[i],
+					energy_shared->last[i], uj);
+		energy_shared->last[i] = uj;
+	}
+	stress_asm_mb();
+	energy_shared->seq++;
+}
+
+/*
+ *  stress_energy_now()
+ *	get the total microjoules used by each domain since
+ *	stress_energy_init(), this is the sampled total plus
+ *	the energy used since the last sample
+ */
+static void stress_energy_now(uint64_t now[STRESS_ENERGY_DOMAINS_MAX])
+{
+	size_t i;
+
+	for (i = 0; i < energy_domains_num; i++) {
+		uint64_t uj, last, total;
+		uint32_t seq;
+
+		do {
+			seq = energy_shared->seq;
+			stress_asm_mb();
+			last = energy_shared->last[i];
+			total = energy_shared->total[i];
+			stress_asm_mb();
+		} while ((seq & 1) || (seq != energy_shared->seq));
+
+		if (stress_energy_read(energy_domains[i].path, &uj))
+			total += stress_energy_delta(&energy_domains[i], last, uj);
+		now[i] = total;
+	}
+}
+
+/*
+ *  stress_energy_package_uj()
+ *	get the total microjoules used by the RAPL package domains
+ *	since stress_energy_init(), allows stressors to measure the
+ *	energy used over an interval, returns false if --energy is
+ *	not enabled or there are no package domains
+ */
+bool stress_energy_package_uj(uint64_t *uj)
+{
+	uint64_t now[STRESS_ENERGY_DOMAINS_MAX];
+	size_t i;
+	bool found = false;
+
+	*uj = 0;
+	if ((energy_domains_num == 0) || (energy_shared == MAP_FAILED))
+		return false;
+
+	stress_energy_now(now);
+	for (i = 0; i < energy_domains_num; i++) {
+		const char *name = energy_domains[i].name;
+
+		/* rapl-package-N, but not the rapl-package-N-core sub-zones */
+		if (strncmp(name, "rapl-package-", 13) || strchr(name + 13, '-'))
+			continue;
+		*uj += now[i];
+		found = true;
+	}
+	return found;
+}
+
+/*
+ *  stress_energy_init()
+ *	find the energy counters if --energy is enabled
+ */
+void stress_energy_init(void)
+{
+	size_t i;
+
+	if (!(g_opt_flags & OPT_FLAGS_ENERGY))
+		return;
+
+	energy_domains_num = 0;
+	stress_energy_powercap();
+	stress_energy_hwmon();
+	if (energy_domains_num == 0) {
+		pr_inf("energy: no readable RAPL powercap or hwmon energy counters "
+			"found, energy accounting disabled\n");
+		return;
+	}
+
+	energy_shared = (stress_energy_shared_t *)stress_mmap_populate(NULL,
+		sizeof(*energy_shared), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (energy_shared == MAP_FAILED) {
+		pr_inf("energy: cannot mmap energy counters, errno=%d (%s), "
+			"energy accounting disabled\n", errno, strerror(errno));
+		energy_domains_num = 0;
+		return;
+	}
+	stress_set_vma_anon_name(energy_shared, sizeof(*energy_shared), "energy-counters");
+	for (i = 0; i < energy_domains_num; i++) {
+		if (!stress_energy_read(energy_domains[i].path, &energy_shared->last[i]))
+			energy_shared->last[i] = 0;
+		pr_dbg("energy: using %s (%s)\n", energy_domains[i].name, energy_domains[i].path);
+	}
+}
+
+/*
+ *  stress_energy_free()
+ *	free the energy counters and records
+ */
+void stress_energy_free(void)
+{
+	stress_energy_record_t *record = energy_records;
+
+	while (record) {
+		stress_energy_record_t *next = record->next;
+
+		free(record);
+		record = next;
+	}
+	energy_records = NULL;
+
+	if (energy_shared != MAP_FAILED) {
+		(void)munmap((void *)energy_shared, sizeof(*energy_shared));
+		energy_shared = MAP_FAILED;
+	}
+	energy_domains_num = 0;
+}
+
+/*
+ *  stress_energy_start()
+ *	start the counter sampling process, sampling the counters
+ *	every second ensures wraps of the RAPL counters are not
+ *	missed on long runs
+ */
+void stress_energy_start(void)
+{
+	double t_next;
+
+	if (energy_domains_num == 0)
+		return;
+
+	energy_pid = fork();
+	if ((energy_pid < 0) || (energy_pid > 0))
+		return;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [energy]");
+
+	t_next = stress_time_now();
+	while (stress_continue_flag()) {
+		double delta;
+
+		t_next += STRESS_ENERGY_SAMPLE_SECS;
+		delta = t_next - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+		stress_energy_sample();
+	}
+	_exit(0);
+}
+
+/*
+ *  stress_energy_stop()
+ *	stop the counter sampling process
+ */
+void stress_energy_stop(void)
+{
+	if (energy_pid > 0) {
+		(void)stress_kill_pid_wait(energy_pid, NULL);
+		energy_pid = -1;
+	}
+}
+
+/*
+ *  stress_energy_begin()
+ *	note the energy counters as a run of stressors starts
+ */
+void stress_energy_begin(void)
+{
+	if (energy_domains_num == 0)
+		return;
+	stress_energy_now(energy_begin);
+}
+
+/*
+ *  stress_energy_end()
+ *	add the energy used since stress_energy_begin() to each
+ *	of the stressors that were run, stressors that run in
+ *	parallel all share the same system wide energy
+ */
+void stress_energy_end(const stress_stressor_t *stressors_list, const double duration)
+{
+	const stress_stressor_t *ss;
+	uint64_t end[STRESS_ENERGY_DOMAINS_MAX];
+
+	if (energy_domains_num == 0)
+		return;
+	stress_energy_now(end);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_energy_record_t *record;
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (record = energy_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record) {
+			record = (stress_energy_record_t *)calloc(1, sizeof(*record));
+			if (!record)
+				continue;
+			record->ss = ss;
+			record->next = energy_records;
+			energy_records = record;
+		}
+		record->duration += duration;
+		for (i = 0; i < energy_domains_num; i++)
+			record->used[i] += end[i] - energy_begin[i];
+	}
+}
+
+/*
+ *  stress_energy_dump()
+ *	dump joules, average watts and bogo ops per joule
+ *	of each domain for each stressor
+ */
+void stress_energy_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool dumped_heading = false;
+
+	if (energy_domains_num == 0)
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_energy_record_t *record;
+		uint64_t bogo_ops = 0;
+		char munged[64];
+		int32_t j;
+		size_t i;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		for (record = energy_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record)
+			continue;
+
+		for (j = 0; j < ss->num_instances; j++)
+			bogo_ops += ss->stats[j]->counter_total;
+
+		if (!dumped_heading) {
+			dumped_heading = true;
+			pr_inf("energy:\n");
+			pr_yaml(yaml, "energy:\n");
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("%s:\n", munged);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      duration: %f\n", record->duration);
+
+		for (i = 0; i < energy_domains_num; i++) {
+			const char *name = energy_domains[i].name;
+			const double joules = (double)record->used[i] / 1000000.0;
+			const double watts = (record->duration > 0.0) ? joules / record->duration : 0.0;
+			const double ops_per_joule = (joules > 0.0) ? (double)bogo_ops / joules : 0.0;
+
+			pr_inf("%30s %12.2f J %9.2f W %14.2f bogo ops/J\n",
+				name, joules, watts, ops_per_joule);
+			pr_yaml(yaml, "      %s-joules: %f\n", name, joules);
+			pr_yaml(yaml, "      %s-watts: %f\n", name, watts);
+			pr_yaml(yaml, "      %s-bogo-ops-per-joule: %f\n", name, ops_per_joule);
+		}
+	}
+	if (dumped_heading)
+		pr_yaml(yaml, "\n");
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_ENERGY_H
+#define CORE_ENERGY_H
+
+#include "stress-ng.h"
+
+extern void stress_energy_init(void);
+extern void stress_energy_free(void);
+extern void stress_energy_start(void);
+extern void stress_energy_stop(void);
+extern void stress_energy_begin(void);
+extern void stress_energy_end(const stress_stressor_t *stressors_list, const double duration);
+extern void stress_energy_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern WARN_UNUSED bool stress_energy_package_uj(uint64_t *uj);
+
+#endif
@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-event-reap.h"
+#include "io-uring.h"
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+#define STRESS_EVENT_REAP_HAVE_EPOLL
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(HAVE_POLL_H) &&		\
+    defined(__NR_io_uring_enter) &&	\
+    defined(__NR_io_uring_setup) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES) &&		\
+    defined(IORING_POLL_ADD_MULTI) &&	\
+    defined(IORING_CQE_F_MORE) &&	\
+    defined(HAVE_IORING_OP_POLL_ADD)
+#define STRESS_EVENT_REAP_HAVE_IO_URING
+#endif
+
+#define STRESS_EVENT_REAP_MAX_EVENTS	(1024)
+#define STRESS_EVENT_REAP_MAX_SQ	(4096)
+#define STRESS_EVENT_REAP_MAX_CQ	(65536)
+
+#define STRESS_EVENT_REAP_OFFSET(addr, offset)	\
+	((void *)((uintptr_t)(addr) + (uintptr_t)(offset)))
+
+struct stress_event_reap {
+	stress_event_reap_method_t method;	/* reaping method */
+	int fd;					/* epoll or io_uring fd */
+	uint64_t syscalls;			/* wait/submit syscalls made */
+#if defined(STRESS_EVENT_REAP_HAVE_EPOLL)
+	struct epoll_event *events;		/* epoll_wait events */
+	int max_events;				/* maxevents per epoll_wait */
+#endif
+#if defined(STRESS_EVENT_REAP_HAVE_IO_URING)
+	unsigned *sq_head;			/* submission ring */
+	unsigned *sq_tail;
+	unsigned *sq_ring_mask;
+	unsigned *sq_ring_entries;
+	unsigned *sq_array;
+	unsigned *cq_head;			/* completion ring */
+	unsigned *cq_tail;
+	unsigned *cq_ring_mask;
+	struct io_uring_cqe *cqes;
+	struct io_uring_sqe *sqes;
+	void *sq_mmap;
+	void *cq_mmap;
+	size_t sq_size;
+	size_t cq_size;
+	size_t sqes_size;
+	unsigned pending;			/* sqes not yet submitted */
+	bool ext_arg;				/* io_uring_enter timeouts */
+#endif
+};
+
+#if defined(STRESS_EVENT_REAP_HAVE_IO_URING)
+/*
+ *  stress_event_reap_pow2()
+ *	round n up to a power of 2, minimum of 8
+ */
+static unsigned stress_event_reap_pow2(const size_t n)
+{
+	unsigned p2 = 8;
+
+	while ((p2 < n) && (p2 < STRESS_EVENT_REAP_MAX_CQ))
+		p2 <<= 1;
+	return p2;
+}
+
+/*
+ *  stress_event_reap_io_uring_enter()
+ *	submit pending sqes and wait for min_complete completions
+ */
+static int stress_event_reap_io_uring_enter(
+	stress_event_reap_t *reap,
+	const unsigned int min_complete,
+	const int timeout_ms)
+{
+	unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+	int ret;
+
+	reap->syscalls++;
+#if defined(IORING_ENTER_EXT_ARG)
+	if (min_complete && (timeout_ms >= 0) && reap->ext_arg) {
+		struct io_uring_getevents_arg arg;
+		struct __kernel_timespec ts;
+
+		(void)shim_memset(&arg, 0, sizeof(arg));
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+		ret = (int)syscall(__NR_io_uring_enter, reap->fd, reap->pending,
+			min_complete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	} else
+#endif
+	{
+		(void)timeout_ms;
+		ret = (int)syscall(__NR_io_uring_enter, reap->fd, reap->pending,
+			min_complete, flags, NULL, 0);
+	}
+	if (ret >= 0)
+		reap->pending -= STRESS_MINIMUM((unsigned)ret, reap->pending);
+	return ret;
+}
+
+/*
+ *  stress_event_reap_io_uring_poll_add()
+ *	queue a multishot POLL_ADD sqe for fd, the fd is the user data
+ */
+static int stress_event_reap_io_uring_poll_add(stress_event_reap_t *reap, const int fd)
+{
+	struct io_uring_sqe *sqe;
+	unsigned tail, index;
+
+	stress_asm_mb();
+	tail = *reap->sq_tail;
+	if ((tail - *reap->sq_head) >= *reap->sq_ring_entries) {
+		/* ring full, submit what we have so far */
+		if (stress_event_reap_io_uring_enter(reap, 0, -1) < 0)
+			return -1;
+		stress_asm_mb();
+		if ((tail - *reap->sq_head) >= *reap->sq_ring_entries) {
+			errno = EBUSY;
+			return -1;
+		}
+	}
+	index = tail & *reap->sq_ring_mask;
+	sqe = &reap->sqes[index];
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll_events = POLLIN;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = (uint64_t)fd;
+	reap->sq_array[index] = index;
+	stress_asm_mb();
+	*reap->sq_tail = tail + 1;
+	stress_asm_mb();
+	reap->pending++;
+
+	return 0;
+}
+
+/*
+ *  stress_event_reap_io_uring_harvest()
+ *	reap up to max_fds poll completions, re-arming polls that
+ *	the kernel has terminated
+ */
+static int stress_event_reap_io_uring_harvest(
+	stress_event_reap_t *reap,
+	int *fds,
+	const int max_fds)
+{
+	unsigned head = *reap->cq_head;
+	int n = 0;
+
+	while (n < max_fds) {
+		const struct io_uring_cqe *cqe;
+		int fd;
+
+		stress_asm_mb();
+		if (head == *reap->cq_tail)
+			break;
+		cqe = &reap->cqes[head & *reap->cq_ring_mask];
+		fd = (int)cqe->user_data;
+		if (cqe->res > 0)
+			fds[n++] = fd;
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			(void)stress_event_reap_io_uring_poll_add(reap, fd);
+		head++;
+	}
+	*reap->cq_head = head;
+	stress_asm_mb();
+
+	return n;
+}
+
+/*
+ *  stress_event_reap_io_uring_unmap()
+ *	unmap io_uring rings
+ */
+static void stress_event_reap_io_uring_unmap(stress_event_reap_t *reap)
+{
+	if (reap->sqes && (reap->sqes != MAP_FAILED))
+		(void)munmap((void *)reap->sqes, reap->sqes_size);
+	if (reap->cq_mmap && (reap->cq_mmap != MAP_FAILED) &&
+	    (reap->cq_mmap != reap->sq_mmap))
+		(void)munmap(reap->cq_mmap, reap->cq_size);
+	if (reap->sq_mmap && (reap->sq_mmap != MAP_FAILED))
+		(void)munmap(reap->sq_mmap, reap->sq_size);
+}
+
+/*
+ *  stress_event_reap_io_uring_create()
+ *	setup an io_uring with a completion ring large enough
+ *	for a multishot poll completion per fd
+ */
+static int stress_event_reap_io_uring_create(stress_event_reap_t *reap, const size_t max_fds)
+{
+	struct io_uring_params p;
+	const unsigned entries = stress_event_reap_pow2(STRESS_MINIMUM(max_fds, STRESS_EVENT_REAP_MAX_SQ));
+
+	(void)shim_memset(&p, 0, sizeof(p));
+#if defined(IORING_SETUP_CQSIZE)
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = stress_event_reap_pow2(max_fds * 2);
+	if (p.cq_entries < entries * 2)
+		p.cq_entries = entries * 2;
+#endif
+	reap->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (reap->fd < 0)
+		return -1;
+#if defined(IORING_FEAT_EXT_ARG)
+	reap->ext_arg = !!(p.features & IORING_FEAT_EXT_ARG);
+#endif
+
+	reap->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	reap->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (reap->cq_size > reap->sq_size)
+			reap->sq_size = reap->cq_size;
+		reap->cq_size = reap->sq_size;
+	}
+	reap->sq_mmap = stress_mmap_populate(NULL, reap->sq_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, reap->fd, IORING_OFF_SQ_RING);
+	if (reap->sq_mmap == MAP_FAILED)
+		goto err;
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		reap->cq_mmap = reap->sq_mmap;
+	} else {
+		reap->cq_mmap = stress_mmap_populate(NULL, reap->cq_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED, reap->fd, IORING_OFF_CQ_RING);
+		if (reap->cq_mmap == MAP_FAILED)
+			goto err;
+	}
+	reap->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	reap->sqes = (struct io_uring_sqe *)stress_mmap_populate(NULL, reap->sqes_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, reap->fd, IORING_OFF_SQES);
+	if (reap->sqes == MAP_FAILED)
+		goto err;
+
+	reap->sq_head = STRESS_EVENT_REAP_OFFSET(reap->sq_mmap, p.sq_off.head);
+	reap->sq_tail = STRESS_EVENT_REAP_OFFSET(reap->sq_mmap, p.sq_off.tail);
+	reap->sq_ring_mask = STRESS_EVENT_REAP_OFFSET(reap->sq_mmap, p.sq_off.ring_mask);
+	reap->sq_ring_entries = STRESS_EVENT_REAP_OFFSET(reap->sq_mmap, p.sq_off.ring_entries);
+	reap->sq_array = STRESS_EVENT_REAP_OFFSET(reap->sq_mmap, p.sq_off.array);
+	reap->cq_head = STRESS_EVENT_REAP_OFFSET(reap->cq_mmap, p.cq_off.head);
+	reap->cq_tail = STRESS_EVENT_REAP_OFFSET(reap->cq_mmap, p.cq_off.tail);
+	reap->cq_ring_mask = STRESS_EVENT_REAP_OFFSET(reap->cq_mmap, p.cq_off.ring_mask);
+	reap->cqes = STRESS_EVENT_REAP_OFFSET(reap->cq_mmap, p.cq_off.cqes);
+	return 0;
+err:
+	stress_event_reap_io_uring_unmap(reap);
+	(void)close(reap->fd);
+	reap->fd = -1;
+	return -1;
+}
+#endif
+
+/*
+ *  stress_event_reap_create()
+ *	create a reaper for up to max_fds file descriptors, returns
+ *	NULL with errno set on failure, ENOSYS if the method is not
+ *	supported
+ */
+stress_event_reap_t *stress_event_reap_create(
+	const stress_event_reap_method_t method,
+	const size_t max_fds)
+{
+	stress_event_reap_t *reap;
+	int saved_errno;
+
+	reap = (stress_event_reap_t *)calloc(1, sizeof(*reap));
+	if (!reap)
+		return NULL;
+	reap->method = method;
+	reap->fd = -1;
+
+	switch (method) {
+#if defined(STRESS_EVENT_REAP_HAVE_EPOLL)
+	case STRESS_EVENT_REAP_EPOLL:
+		reap->max_events = (int)STRESS_MINIMUM(STRESS_MAXIMUM(max_fds, 1), STRESS_EVENT_REAP_MAX_EVENTS);
+		reap->events = (struct epoll_event *)calloc((size_t)reap->max_events, sizeof(*reap->events));
+		if (!reap->events)
+			goto err;
+		reap->fd = epoll_create1(0);
+		if (reap->fd < 0)
+			goto err;
+		return reap;
+#endif
+#if defined(STRESS_EVENT_REAP_HAVE_IO_URING)
+	case STRESS_EVENT_REAP_IO_URING:
+		if (stress_event_reap_io_uring_create(reap, max_fds) < 0)
+			goto err;
+		return reap;
+#endif
+	default:
+		errno = ENOSYS;
+		break;
+	}
+err:
+	saved_errno = errno;
+	stress_event_reap_destroy(reap);
+	errno = saved_errno;
+	return NULL;
+}
+
+/*
+ *  stress_event_reap_destroy()
+ *	free a reaper, the added fds are not closed
+ */
+void stress_event_reap_destroy(stress_event_reap_t *reap)
+{
+	if (!reap)
+		return;
+#if defined(STRESS_EVENT_REAP_HAVE_EPOLL)
+	free(reap->events);
+#endif
+#if defined(STRESS_EVENT_REAP_HAVE_IO_URING)
+	if (reap->method == STRESS_EVENT_REAP_IO_URING)
+		stress_event_reap_io_uring_unmap(reap);
+#endif
+	if (reap->fd >= 0)
+		(void)close(reap->fd);
+	free(reap);
+}
+
+/*
+ *  stress_event_reap_add()
+ *	watch fd for read readiness, io_uring polls are submitted
+ *	in a batch on the next stress_event_reap_wait call
+ */
+int stress_event_reap_add(stress_event_reap_t *reap, const int fd)
+{
+	switch (reap->method) {
+#if defined(STRESS_EVENT_REAP_HAVE_EPOLL)
+	case STRESS_EVENT_REAP_EPOLL: {
+		struct epoll_event ev;
+
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		return epoll_ctl(reap->fd, EPOLL_CTL_ADD, fd, &ev);
+	}
+#endif
+#if defined(STRESS_EVENT_REAP_HAVE_IO_URING)
+	case STRESS_EVENT_REAP_IO_URING:
+		return stress_event_reap_io_uring_poll_add(reap, fd);
+#endif
+	default:
+		break;
+	}
+	errno = ENOSYS;
+	return -1;
+}
+
+/*
+ *  stress_event_reap_wait()
+ *	wait up to timeout_ms milliseconds (-1 for no timeout) for
+ *	ready fds, returns the number of ready fds stored in fds,
+ *	0 on timeout or interrupt and -1 with errno set on failure
+ */
+int stress_event_reap_wait(
+	stress_event_reap_t *reap,
+	int *fds,
+	const int max_fds,
+	const int timeout_ms)
+{
+	int i, n;
+
+	switch (reap->method) {
+#if defined(STRESS_EVENT_REAP_HAVE_EPOLL)
+	case STRESS_EVENT_REAP_EPOLL:
+		reap->syscalls++;
+		n = epoll_wait(reap->fd, reap->events,
+			STRESS_MINIMUM(max_fds, reap->max_events), timeout_ms);
+		if (n < 0)
+			return (errno == EINTR) ? 0 : -1;
+		for (i = 0; i < n; i++)
+			fds[i] = reap->events[i].data.fd;
+		return n;
+#endif
+#if defined(STRESS_EVENT_REAP_HAVE_IO_URING)
+	case STRESS_EVENT_REAP_IO_URING:
+		/* completions may already be waiting from a previous wait */
+		n = stress_event_reap_io_uring_harvest(reap, fds, max_fds);
+		if (n > 0)
+			return n;
+		if (stress_event_reap_io_uring_enter(reap, 1, timeout_ms) < 0) {
+			if ((errno == EINTR) || (errno == ETIME) || (errno == EBUSY))
+				return 0;
+			return -1;
+		}
+		return stress_event_reap_io_uring_harvest(reap, fds, max_fds);
+#endif
+	default:
+		break;
+	}
+	(void)i;
+	(void)n;
+	errno = ENOSYS;
+	return -1;
+}
+
+/*
+ *  stress_event_reap_syscalls()
+ *	number of wait and submission syscalls made by the reaper
+ */
+uint64_t stress_event_reap_syscalls(const stress_event_reap_t *reap)
+{
+	return reap->syscalls;
+}
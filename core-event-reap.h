@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_EVENT_REAP_H
+#define CORE_EVENT_REAP_H
+
+#include "stress-ng.h"
+
+/*
+ *  Batched readiness reaping of many file descriptors, either
+ *  with epoll_wait() returning up to maxevents ready fds per
+ *  call or with io_uring multishot POLL_ADD completions reaped
+ *  from the completion ring. Ready fds may be reported more than
+ *  once per wake-up, so they should be non-blocking.
+ */
+typedef enum {
+	STRESS_EVENT_REAP_EPOLL,	/* epoll_wait, maxevents batching */
+	STRESS_EVENT_REAP_IO_URING,	/* io_uring multishot poll */
+} stress_event_reap_method_t;
+
+typedef struct stress_event_reap stress_event_reap_t;
+
+extern WARN_UNUSED stress_event_reap_t *stress_event_reap_create(
+	const stress_event_reap_method_t method, const size_t max_fds);
+extern void stress_event_reap_destroy(stress_event_reap_t *reap);
+extern int stress_event_reap_add(stress_event_reap_t *reap, const int fd);
+extern WARN_UNUSED int stress_event_reap_wait(stress_event_reap_t *reap,
+	int *fds, const int max_fds, const int timeout_ms);
+extern WARN_UNUSED uint64_t stress_event_reap_syscalls(const stress_event_reap_t *reap);
+
+#endif
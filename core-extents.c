@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-extents.h"
+
+#if defined(HAVE_LINUX_FIEMAP_H)
+#include <linux/fiemap.h>
+#endif
+
+#if defined(HAVE_LINUX_FS_H)
+#include <linux/fs.h>
+#endif
+
+/* extents fetched per FS_IOC_FIEMAP call */
+#define EXTENTS_PER_CALL	(256)
+/* cap on the sequential read check to keep sampling cheap */
+#define EXTENTS_READ_MAX	(64 * MB)
+#define EXTENTS_READ_SIZE	(1 * MB)
+
+/*
+ *  stress_extents_init()
+ *	reset layout sampling, first sample is taken immediately
+ */
+void stress_extents_init(stress_extents_t *extents)
+{
+	(void)shim_memset(extents, 0, sizeof(*extents));
+	extents->t_start = stress_time_now();
+	extents->t_next = extents->t_start;
+}
+
+#if defined(HAVE_LINUX_FS_H) &&		\
+    defined(HAVE_LINUX_FIEMAP_H) &&	\
+    defined(FS_IOC_FIEMAP)
+/*
+ *  stress_extents_layout()
+ *	walk the file extents with FS_IOC_FIEMAP, count the extents,
+ *	mapped bytes and the extents that do not physically follow
+ *	on from the previous extent
+ */
+static int stress_extents_layout(
+	const int fd,
+	uint64_t *n_extents,
+	uint64_t *fragmented,
+	uint64_t *bytes)
+{
+	struct fiemap *fiemap;
+	uint64_t start = 0, prev_end = 0;
+	const size_t size = sizeof(*fiemap) + (EXTENTS_PER_CALL * sizeof(struct fiemap_extent));
+	bool last = false;
+
+	*n_extents = 0;
+	*fragmented = 0;
+	*bytes = 0;
+
+	fiemap = (struct fiemap *)malloc(size);
+	if (!fiemap)
+		return -ENOMEM;
+
+	while (!last) {
+		uint32_t i;
+
+		(void)shim_memset(fiemap, 0, size);
+		fiemap->fm_start = start;
+		fiemap->fm_length = ~0ULL - start;
+		fiemap->fm_extent_count = EXTENTS_PER_CALL;
+		if (ioctl(fd, FS_IOC_FIEMAP, fiemap) < 0) {
+			const int err = errno;
+
+			free(fiemap);
+			return -err;
+		}
+		if (fiemap->fm_mapped_extents == 0)
+			break;
+		for (i = 0; i < fiemap->fm_mapped_extents; i++) {
+			const struct fiemap_extent *fe = &fiemap->fm_extents[i];
+
+			if ((*n_extents > 0) && (fe->fe_physical != prev_end))
+				(*fragmented)++;
+			prev_end = fe->fe_physical + fe->fe_length;
+			(*n_extents)++;
+			*bytes += fe->fe_length;
+			start = fe->fe_logical + fe->fe_length;
+			if (fe->fe_flags & FIEMAP_EXTENT_LAST)
+				last = true;
+		}
+	}
+	free(fiemap);
+	return 0;
+}
+#else
+static int stress_extents_layout(
+	const int fd,
+	uint64_t *n_extents,
+	uint64_t *fragmented,
+	uint64_t *bytes)
+{
+	(void)fd;
+
+	*n_extents = 0;
+	*fragmented = 0;
+	*bytes = 0;
+	return -ENOSYS;
+}
+#endif
+
+/*
+ *  stress_extents_read_rate()
+ *	drop the cached pages and time a sequential read of up
+ *	to the first EXTENTS_READ_MAX bytes of the file, MB/s
+ */
+static double stress_extents_read_rate(const int fd, const off_t size)
+{
+	char *buf;
+	off_t offset;
+	const off_t len = STRESS_MINIMUM(size, (off_t)EXTENTS_READ_MAX);
+	double t, duration, bytes = 0.0;
+
+	buf = (char *)malloc(EXTENTS_READ_SIZE);
+	if (!buf)
+		return 0.0;
+
+	(void)shim_fdatasync(fd);
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	(void)posix_fadvise(fd, 0, len, POSIX_FADV_DONTNEED);
+#endif
+	t = stress_time_now();
+	for (offset = 0; offset < len; ) {
+		const ssize_t ret = pread(fd, buf, EXTENTS_READ_SIZE, offset);
+
+		if (ret <= 0)
+			break;
+		offset += ret;
+		bytes += (double)ret;
+	}
+	duration = stress_time_now() - t;
+	free(buf);
+
+	return (duration > 0.0) ? (bytes / (double)MB) / duration : 0.0;
+}
+
+/*
+ *  stress_extents_sample()
+ *	every STRESS_EXTENTS_INTERVAL seconds sample the file layout
+ *	and the sequential read rate, returns -errno if the layout
+ *	cannot be fetched, 0 otherwise
+ */
+int stress_extents_sample(
+	stress_args_t *args,
+	const int fd,
+	const off_t size,
+	stress_extents_t *extents)
+{
+	const double now = stress_time_now();
+	double rate;
+	int ret;
+
+	if (now < extents->t_next)
+		return 0;
+	extents->t_next = now + STRESS_EXTENTS_INTERVAL;
+
+	ret = stress_extents_layout(fd, &extents->extents,
+				&extents->fragmented, &extents->bytes);
+	if (ret < 0)
+		return ret;
+
+	rate = stress_extents_read_rate(fd, size);
+	/* the baseline is the first sample with data in the file */
+	if ((extents->read_rate_first <= 0.0) && (extents->extents > 0))
+		extents->read_rate_first = rate;
+	extents->read_rate_last = rate;
+	extents->samples++;
+
+	if (args->instance == 0) {
+		pr_dbg("%s: %6.1fs %8" PRIu64 " extents, %8.1f KB average extent, "
+			"%5.1f%% fragmented, %8.1f MB/s sequential read\n",
+			args->name, now - extents->t_start, extents->extents,
+			extents->extents ? ((double)extents->bytes / (double)extents->extents) / (double)KB : 0.0,
+			extents->extents ? 100.0 * (double)extents->fragmented / (double)extents->extents : 0.0,
+			rate);
+	}
+	return 0;
+}
+
+/*
+ *  stress_extents_metrics()
+ *	report the last sampled layout and the read rate change,
+ *	uses STRESS_EXTENTS_METRICS metrics slots from idx
+ */
+void stress_extents_metrics(
+	stress_args_t *args,
+	const size_t idx,
+	const stress_extents_t *extents)
+{
+	const double n = (double)extents->extents;
+
+	if (extents->samples == 0)
+		return;
+
+	stress_metrics_set(args, idx + 0, "file extents",
+		n, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, idx + 1, "KB average extent size",
+		(n > 0.0) ? ((double)extents->bytes / n) / (double)KB : 0.0,
+		STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, idx + 2, "% extents fragmented",
+		(n > 0.0) ? 100.0 * (double)extents->fragmented / n : 0.0,
+		STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, idx + 3, "MB per sec sequential read at start",
+		extents->read_rate_first, STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, idx + 4, "MB per sec sequential read at end",
+		extents->read_rate_last, STRESS_HARMONIC_MEAN);
+}
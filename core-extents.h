@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_EXTENTS_H
+#define CORE_EXTENTS_H
+
+#include "stress-ng.h"
+
+/* seconds between file layout samples */
+#define STRESS_EXTENTS_INTERVAL		(1.0)
+
+/* number of misc metrics slots used by stress_extents_metrics() */
+#define STRESS_EXTENTS_METRICS		(5)
+
+typedef struct {
+	double t_start;			/* time of first sample */
+	double t_next;			/* time of next sample */
+	uint64_t samples;		/* number of layout samples */
+	uint64_t extents;		/* extents in last sample */
+	uint64_t fragmented;		/* physically discontiguous extents */
+	uint64_t bytes;			/* bytes mapped in last sample */
+	double read_rate_first;		/* sequential read MB/s, first sample */
+	double read_rate_last;		/* sequential read MB/s, last sample */
+} stress_extents_t;
+
+extern void stress_extents_init(stress_extents_t *extents);
+extern int stress_extents_sample(stress_args_t *args, const int fd,
+	const off_t size, stress_extents_t *extents);
+extern void stress_extents_metrics(stress_args_t *args, const size_t idx,
+	const stress_extents_t *extents);
+
+#endif
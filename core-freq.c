@@ -0,0 +1,368 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-arch.h"
+#include "core-cycles.h"
+#include "core-freq.h"
+#include "core-latency.h"
+#include "core-ops-rate.h"
+#include "core-time.h"
+
+#define STRESS_MSR_MPERF	(0xe7)	/* x86 maximum performance counter */
+#define STRESS_MSR_APERF	(0xe8)	/* x86 actual performance counter */
+
+typedef struct {
+	char *description;		/* metrics description */
+	int mean_type;			/* type of metric mean */
+} stress_freq_metric_t;
+
+/*
+ *  Frequency metrics, these sit just below the
+ *  stress_cycles_metrics() slots at the top of the
+ *  misc metrics to keep clear of the stressor metrics
+ */
+static const stress_freq_metric_t freq_metrics[STRESS_FREQ_METRICS] = {
+	{ "effective CPU GHz",		STRESS_GEOMETRIC_MEAN },
+	{ "bogo ops per sec per GHz",	STRESS_GEOMETRIC_MEAN },
+};
+
+#define STRESS_FREQ_METRICS_BASE				\
+	(STRESS_MISC_METRICS_MAX - STRESS_LATENCY_METRICS -	\
+	 STRESS_OPS_RATE_METRICS - STRESS_CYCLES_METRICS -	\
+	 SIZEOF_ARRAY(freq_metrics))
+
+#if defined(__linux__)
+/* Per CPU frequency sampling state, private to the sampler process */
+typedef struct {
+	int msr_fd;			/* /dev/cpu/N/msr fd, -1 = not usable */
+	uint64_t aperf;			/* APERF at last sample */
+	uint64_t mperf;			/* MPERF at last sample */
+	double when;			/* time of last sample */
+	double ghz;			/* GHz at last sample, 0 = unknown */
+} stress_freq_cpu_t;
+
+static stress_freq_cpu_t *freq_cpus;
+static int32_t freq_cpus_num;
+static uint64_t freq_cycles_start;	/* cycle counter at first sample */
+static double freq_cycles_time;		/* time of first sample */
+
+/*
+ *  stress_freq_cpus_init()
+ *	allocate the per CPU sampling state, the APERF and MPERF
+ *	MSRs are used if /dev/cpu/N/msr can be read, this requires
+ *	root and the msr driver
+ */
+static bool stress_freq_cpus_init(void)
+{
+	int32_t i;
+
+	if (freq_cpus)
+		return true;
+
+	freq_cpus_num = stress_get_processors_configured();
+	if (freq_cpus_num < 1)
+		return false;
+	freq_cpus = (stress_freq_cpu_t *)calloc((size_t)freq_cpus_num, sizeof(*freq_cpus));
+	if (!freq_cpus)
+		return false;
+
+	for (i = 0; i < freq_cpus_num; i++) {
+#if defined(STRESS_ARCH_X86)
+		char path[PATH_MAX];
+		uint64_t val;
+
+		(void)snprintf(path, sizeof(path), "/dev/cpu/%" PRId32 "/msr", i);
+		freq_cpus[i].msr_fd = open(path, O_RDONLY);
+		if ((freq_cpus[i].msr_fd >= 0) &&
+		    (pread(freq_cpus[i].msr_fd, &val, sizeof(val), STRESS_MSR_APERF) != sizeof(val))) {
+			(void)close(freq_cpus[i].msr_fd);
+			freq_cpus[i].msr_fd = -1;
+		}
+#else
+		freq_cpus[i].msr_fd = -1;
+#endif
+		freq_cpus[i].when = -1.0;
+	}
+	freq_cycles_start = stress_cycles_get();
+	freq_cycles_time = stress_time_now();
+	return true;
+}
+
+/*
+ *  stress_freq_aperf_mperf()
+ *	effective GHz of a CPU since the last sample, this is the
+ *	cycle counter rate scaled by APERF/MPERF, both only count
+ *	when the CPU is not idle and MPERF counts at the TSC rate.
+ *	Returns 0.0 if not known.
+ */
+static double stress_freq_aperf_mperf(stress_freq_cpu_t *fcpu, const double now)
+{
+	uint64_t aperf, mperf;
+	double ghz = 0.0;
+
+	if ((pread(fcpu->msr_fd, &aperf, sizeof(aperf), STRESS_MSR_APERF) != sizeof(aperf)) ||
+	    (pread(fcpu->msr_fd, &mperf, sizeof(mperf), STRESS_MSR_MPERF) != sizeof(mperf)))
+		return 0.0;
+
+	if ((fcpu->when >= 0.0) && (mperf > fcpu->mperf) && (now > freq_cycles_time)) {
+		const double cycles_hz = (double)(stress_cycles_get() - freq_cycles_start) /
+					 (now - freq_cycles_time);
+
+		ghz = (cycles_hz * (double)(aperf - fcpu->aperf) /
+			(double)(mperf - fcpu->mperf)) / STRESS_DBL_NANOSECOND;
+	}
+	fcpu->aperf = aperf;
+	fcpu->mperf = mperf;
+	return ghz;
+}
+
+/*
+ *  stress_freq_scaling_cur()
+ *	current GHz of a CPU from cpufreq, 0.0 if not known
+ */
+static double stress_freq_scaling_cur(const int32_t cpu)
+{
+	char path[PATH_MAX], buf[64];
+	double khz;
+
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_cur_freq", cpu);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return 0.0;
+	if ((sscanf(buf, "%lf", &khz) != 1) || (khz <= 0.0))
+		return 0.0;
+	return khz / 1000000.0;
+}
+
+/*
+ *  stress_freq_cpu_ghz()
+ *	effective GHz of a CPU, instances that last ran on the
+ *	same CPU in the same sampling round share the sample
+ */
+static double stress_freq_cpu_ghz(const int32_t cpu, const double now)
+{
+	stress_freq_cpu_t *fcpu;
+
+	if ((cpu < 0) || (cpu >= freq_cpus_num))
+		return 0.0;
+
+	fcpu = &freq_cpus[cpu];
+	if (fcpu->when == now)
+		return fcpu->ghz;
+
+	fcpu->ghz = (fcpu->msr_fd >= 0) ?
+		stress_freq_aperf_mperf(fcpu, now) : stress_freq_scaling_cur(cpu);
+	fcpu->when = now;
+	return fcpu->ghz;
+}
+
+/*
+ *  stress_freq_proc_stat()
+ *	get the utime + stime ticks and the CPU last run on
+ *	of a process from /proc/$pid/stat
+ */
+static bool stress_freq_proc_stat(const pid_t pid, uint64_t *ticks, int32_t *cpu)
+{
+	char path[PATH_MAX], buf[1024];
+	unsigned long utime, stime;
+	const char *ptr;
+	int processor, i;
+
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+
+	/* skip over comm, it may contain spaces, to field 3 */
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return false;
+	ptr += 2;
+
+	/* fields 3..13 */
+	for (i = 3; i < 14; i++) {
+		ptr = strchr(ptr, ' ');
+		if (!ptr)
+			return false;
+		ptr++;
+	}
+	if (sscanf(ptr, "%lu %lu", &utime, &stime) != 2)
+		return false;
+	/* fields 14..38 */
+	for (i = 14; i < 39; i++) {
+		ptr = strchr(ptr, ' ');
+		if (!ptr)
+			return false;
+		ptr++;
+	}
+	if (sscanf(ptr, "%d", &processor) != 1)
+		return false;
+
+	*ticks = (uint64_t)utime + (uint64_t)stime;
+	*cpu = (int32_t)processor;
+	return true;
+}
+
+/*
+ *  stress_freq_sample()
+ *	sample the effective frequency of the CPU a running stressor
+ *	instance last ran on, weighted by the CPU ticks the instance
+ *	used since the last sample so idle instances don't count
+ */
+void stress_freq_sample(stress_stats_t *stats, const double now)
+{
+	uint64_t ticks;
+	int32_t cpu;
+	double ghz;
+
+	if (!(g_opt_flags & OPT_FLAGS_FREQ_STATS))
+		return;
+	if ((stats->pid <= 0) || (stats->start <= 0.0) || stats->completed)
+		return;
+	if (!stress_freq_cpus_init())
+		return;
+	if (!stress_freq_proc_stat(stats->pid, &ticks, &cpu))
+		return;
+
+	ghz = stress_freq_cpu_ghz(cpu, now);
+	if ((ghz > 0.0) && (ticks > stats->freq.ticks)) {
+		const double delta = (double)(ticks - stats->freq.ticks);
+
+		stats->freq.ghz_sum += ghz * delta;
+		stats->freq.ticks_sum += delta;
+	}
+	stats->freq.ticks = ticks;
+}
+
+/*
+ *  stress_freq_sample_free()
+ *	free the per CPU sampling state
+ */
+void stress_freq_sample_free(void)
+{
+	int32_t i;
+
+	if (!freq_cpus)
+		return;
+	for (i = 0; i < freq_cpus_num; i++) {
+		if (freq_cpus[i].msr_fd >= 0)
+			(void)close(freq_cpus[i].msr_fd);
+	}
+	free(freq_cpus);
+	freq_cpus = NULL;
+	freq_cpus_num = 0;
+}
+#else
+void stress_freq_sample(stress_stats_t *stats, const double now)
+{
+	(void)stats;
+	(void)now;
+}
+
+void stress_freq_sample_free(void)
+{
+}
+#endif
+
+/*
+ *  stress_freq_metrics()
+ *	set the average effective GHz and the bogo ops per second
+ *	per GHz of each completed instance of a stressor, the latter
+ *	separates throughput changes from turbo and thermal throttling
+ */
+void stress_freq_metrics(stress_stressor_t *ss)
+{
+	int32_t j;
+
+	if (!(g_opt_flags & OPT_FLAGS_FREQ_STATS) || !ss->stats)
+		return;
+
+	for (j = 0; j < ss->num_instances; j++) {
+		stress_stats_t *const stats = ss->stats[j];
+		double values[SIZEOF_ARRAY(freq_metrics)], rate;
+		size_t i;
+
+		if (!stats->completed || (stats->freq.ticks_sum <= 0.0))
+			continue;
+
+		values[0] = stats->freq.ghz_sum / stats->freq.ticks_sum;
+		rate = (stats->duration_total > 0.0) ?
+			(double)stats->counter_total / stats->duration_total : 0.0;
+		values[1] = (values[0] > 0.0) ? rate / values[0] : 0.0;
+
+		for (i = 0; i < SIZEOF_ARRAY(freq_metrics); i++)
+			stress_metrics_set(&stats->args, STRESS_FREQ_METRICS_BASE + i,
+				freq_metrics[i].description, values[i],
+				freq_metrics[i].mean_type);
+	}
+}
+
+#define STRESS_FREQ_PROBE_LOOPS		(16384)
+#define STRESS_FREQ_PROBE_ADD()				\
+do {							\
+	val += inc;					\
+	__asm__ __volatile__("" : "+r"(val));		\
+} while (0)
+
+/*
+ *  stress_freq_effective_mhz()
+ *	estimate the current core clock in MHz by timing a chain of
+ *	dependent register to register integer adds, each of which
+ *	takes one cycle (immediate adds can be folded by newer x86
+ *	cores so the increment is hidden from the compiler). Call it
+ *	straight after a burst of work to see the clock that work ran
+ *	at, e.g. to expose wide vector downclocking. Returns 0.0 if
+ *	the estimate can't be made.
+ */
+double OPTIMIZE3 stress_freq_effective_mhz(void)
+{
+#if (defined(HAVE_COMPILER_GCC) || defined(HAVE_COMPILER_CLANG)) &&	\
+    !defined(HAVE_COMPILER_ICC)
+	register uint64_t val = 0, inc = 1;
+	register int i;
+	double t1, t2;
+
+	__asm__ __volatile__("" : "+r"(inc));
+	t1 = stress_time_now();
+	for (i = 0; i < STRESS_FREQ_PROBE_LOOPS; i++) {
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+		STRESS_FREQ_PROBE_ADD();
+	}
+	t2 = stress_time_now();
+
+	if ((t2 <= t1) || (val != (uint64_t)STRESS_FREQ_PROBE_LOOPS * 16))
+		return 0.0;
+	return ((double)val / (t2 - t1)) / 1000000.0;
+#else
+	return 0.0;
+#endif
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_FREQ_H
+#define CORE_FREQ_H
+
+#include "stress-ng.h"
+
+extern void stress_freq_sample(stress_stats_t *stats, const double now);
+extern void stress_freq_sample_free(void);
+extern void stress_freq_metrics(stress_stressor_t *ss);
+extern double stress_freq_effective_mhz(void);
+
+#endif
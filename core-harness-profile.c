@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-harness-profile.h"
+
+#include <sys/resource.h>
+
+/* parent wait and sampling loop accounting */
+static double parent_wait_start;	/* wall clock time at start of wait */
+static double parent_wait_cpu_start;	/* CPU time at start of wait */
+static double parent_wait_time;		/* total wall clock time in wait */
+static double parent_wait_cpu;		/* total CPU time in wait */
+
+/*
+ *  stress_harness_profile_enabled()
+ *	return true if --harness-profile is enabled
+ */
+bool stress_harness_profile_enabled(void)
+{
+	bool harness_profile = false;
+
+	(void)stress_get_setting("harness-profile", &harness_profile);
+	return harness_profile;
+}
+
+/*
+ *  stress_harness_profile_cpu_time()
+ *	user and system CPU time used by the calling
+ *	process in seconds, 0.0 if not available
+ */
+double stress_harness_profile_cpu_time(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return stress_timeval_to_double(&usage.ru_utime) +
+	       stress_timeval_to_double(&usage.ru_stime);
+}
+
+/*
+ *  stress_harness_profile_parent_begin()
+ *	mark the start of the parent wait and sampling loop
+ */
+void stress_harness_profile_parent_begin(void)
+{
+	parent_wait_start = stress_time_now();
+	parent_wait_cpu_start = stress_harness_profile_cpu_time();
+}
+
+/*
+ *  stress_harness_profile_parent_end()
+ *	accumulate the time and CPU used by the parent
+ *	wait and sampling loop, runs with --permute or
+ *	--seq wait several times so totals are summed
+ */
+void stress_harness_profile_parent_end(void)
+{
+	parent_wait_time += stress_time_now() - parent_wait_start;
+	parent_wait_cpu += stress_harness_profile_cpu_time() - parent_wait_cpu_start;
+}
+
+/*
+ *  stress_harness_profile_dump()
+ *	dump the per stressor harness phase timings, averaged
+ *	over the instances that were profiled, and the CPU
+ *	used by the parent while waiting on the stressors
+ */
+void stress_harness_profile_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool pr_heading = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		double setup = 0.0, run = 0.0, teardown = 0.0, reap = 0.0;
+		double setup_cpu = 0.0, teardown_cpu = 0.0, checksum = 0.0;
+		double setting_time = 0.0, total, overhead, n;
+		uint64_t setting_lookups = 0;
+		int32_t k, instances = 0;
+		char munged[64];
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+
+		for (k = 0; k < ss->num_instances; k++) {
+			const stress_stats_t *stats = ss->stats[k];
+			const stress_harness_profile_t *harness = &stats->harness;
+
+			if (!harness->valid)
+				continue;
+			setup += harness->setup;
+			run += harness->run;
+			teardown += harness->teardown;
+			if (stats->exited >= harness->end)
+				reap += stats->exited - harness->end;
+			setup_cpu += harness->setup_cpu;
+			teardown_cpu += harness->teardown_cpu;
+			checksum += harness->checksum;
+			setting_lookups += harness->setting_lookups;
+			setting_time += harness->setting_time;
+			instances++;
+		}
+		if (instances == 0)
+			continue;
+
+		if (!pr_heading) {
+			pr_inf("harness profile (averages per instance):\n");
+			pr_inf("%-13s %10s %10s %10s %10s %10s %10s\n",
+				"stressor", "setup (ms)", "run (s)", "tdown (ms)",
+				"reap (ms)", "chksum(us)", "overhead %");
+			pr_yaml(yaml, "harness-profile:\n");
+			pr_heading = true;
+		}
+		n = (double)instances;
+		total = setup + run + teardown + reap;
+		overhead = (total > 0.0) ? 100.0 * (setup + teardown + reap) / total : 0.0;
+
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("%-13s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+			munged, 1000.0 * setup / n, run / n, 1000.0 * teardown / n,
+			1000.0 * reap / n, 1000000.0 * checksum / n, overhead);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      instances: %" PRId32 "\n", instances);
+		pr_yaml(yaml, "      setup-ms: %.3f\n", 1000.0 * setup / n);
+		pr_yaml(yaml, "      setup-cpu-ms: %.3f\n", 1000.0 * setup_cpu / n);
+		pr_yaml(yaml, "      run-secs: %.6f\n", run / n);
+		pr_yaml(yaml, "      teardown-ms: %.3f\n", 1000.0 * teardown / n);
+		pr_yaml(yaml, "      teardown-cpu-ms: %.3f\n", 1000.0 * teardown_cpu / n);
+		pr_yaml(yaml, "      reap-ms: %.3f\n", 1000.0 * reap / n);
+		pr_yaml(yaml, "      checksum-us: %.3f\n", 1000000.0 * checksum / n);
+		pr_yaml(yaml, "      setting-lookups: %.1f\n", (double)setting_lookups / n);
+		pr_yaml(yaml, "      setting-lookup-us: %.3f\n", 1000000.0 * setting_time / n);
+		pr_yaml(yaml, "      overhead-percent: %.3f\n", overhead);
+		pr_yaml(yaml, "\n");
+	}
+
+	if (!pr_heading) {
+		pr_inf("harness profile: no stressor instances were profiled\n");
+		return;
+	}
+
+	pr_inf("harness profile: parent wait and sampling used %.3fs CPU in %.3fs (%.3f%%)\n",
+		parent_wait_cpu, parent_wait_time,
+		(parent_wait_time > 0.0) ? 100.0 * parent_wait_cpu / parent_wait_time : 0.0);
+	pr_yaml(yaml, "harness-parent:\n");
+	pr_yaml(yaml, "      wait-secs: %.6f\n", parent_wait_time);
+	pr_yaml(yaml, "      wait-cpu-secs: %.6f\n", parent_wait_cpu);
+	pr_yaml(yaml, "\n");
+}
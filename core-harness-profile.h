@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_HARNESS_PROFILE_H
+#define CORE_HARNESS_PROFILE_H
+
+#include "stress-ng.h"
+
+extern bool stress_harness_profile_enabled(void);
+extern double stress_harness_profile_cpu_time(void);
+extern void stress_harness_profile_parent_begin(void);
+extern void stress_harness_profile_parent_end(void);
+extern void stress_harness_profile_dump(FILE *yaml, stress_stressor_t *stressors_list);
+
+#endif
@@ -20,9 +20,22 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-hash.h"
 #include "core-pragma.h"
 
+#if defined(STRESS_ARCH_ARM) &&		\
+    defined(__aarch64__) &&		\
+    defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HAVE_HASH_CRC32C_ARM
+#elif defined(STRESS_ARCH_X86_64) &&	\
+    (defined(HAVE_COMPILER_GCC) ||	\
+     defined(HAVE_COMPILER_CLANG)) &&	\
+    !defined(HAVE_COMPILER_ICC)
+#define HAVE_HASH_CRC32C_SSE4_2
+#endif
+
 /*
  *  stress_hash_jenkin()
  *	Jenkin's hash on random data
@@ -283,23 +296,186 @@ static const uint32_t ALIGN64 crc32c_table[256] = {
 	0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351,
 };
 
+/* slicing-by-8 tables, crc32c_slice8[0] is crc32c_table */
+static uint32_t crc32c_slice8[8][256];
+
+typedef uint32_t (*stress_hash_crc32c_func_t)(const uint8_t *data, const size_t len);
+
+static stress_hash_crc32c_func_t crc32c_func;
+
 /*
- *  crc32c the Castagnoli CRC32
- *	lookup table implementation
+ *  stress_hash_crc32c_slice8_init()
+ *	derive the slicing-by-8 tables from crc32c_table
+ */
+static void stress_hash_crc32c_slice8_init(void)
+{
+	size_t i, j;
+
+	for (i = 0; i < 256; i++)
+		crc32c_slice8[0][i] = crc32c_table[i];
+	for (j = 1; j < 8; j++) {
+		for (i = 0; i < 256; i++) {
+			const uint32_t crc = crc32c_slice8[j - 1][i];
+
+			crc32c_slice8[j][i] = (crc >> 8) ^ crc32c_table[crc & 0xff];
+		}
+	}
+}
+
+/*
+ *  stress_hash_crc32c_le32()
+ *	endian neutral little endian 32 bit load
+ */
+static inline uint32_t ALWAYS_INLINE stress_hash_crc32c_le32(const uint8_t *ptr)
+{
+	return (uint32_t)ptr[0] |
+	       ((uint32_t)ptr[1] << 8) |
+	       ((uint32_t)ptr[2] << 16) |
+	       ((uint32_t)ptr[3] << 24);
+}
+
+/*
+ *  stress_hash_crc32c_sw()
+ *	crc32c the Castagnoli CRC32, slicing-by-8
+ *	software implementation
  */
-uint32_t PURE HOT OPTIMIZE3 stress_hash_crc32c(const char *str)
+uint32_t PURE HOT OPTIMIZE3 stress_hash_crc32c_sw(const uint8_t *data, const size_t len)
 {
 	register uint32_t crc = ~0U;
-	register uint8_t val;
-	register const uint8_t *ptr = (const uint8_t *)str;
+	register const uint8_t *ptr = data;
+	register const uint8_t *end = data + len;
 
-PRAGMA_UNROLL_N(4)
-	while ((val = *ptr++))
-		crc = (crc >> 8) ^ crc32c_table[(crc ^ val) & 0xff];
+	if (UNLIKELY(!crc32c_slice8[1][1]))
+		stress_hash_crc32c_slice8_init();
+
+	while (ptr + 8 <= end) {
+		const uint32_t hi = stress_hash_crc32c_le32(ptr + 4);
+
+		crc ^= stress_hash_crc32c_le32(ptr);
+		crc = crc32c_slice8[7][crc & 0xff] ^
+		      crc32c_slice8[6][(crc >> 8) & 0xff] ^
+		      crc32c_slice8[5][(crc >> 16) & 0xff] ^
+		      crc32c_slice8[4][crc >> 24] ^
+		      crc32c_slice8[3][hi & 0xff] ^
+		      crc32c_slice8[2][(hi >> 8) & 0xff] ^
+		      crc32c_slice8[1][(hi >> 16) & 0xff] ^
+		      crc32c_slice8[0][hi >> 24];
+		ptr += 8;
+	}
+	while (ptr < end)
+		crc = (crc >> 8) ^ crc32c_table[(crc ^ *ptr++) & 0xff];
 
 	return ~crc;
 }
 
+#if defined(HAVE_HASH_CRC32C_SSE4_2)
+/*
+ *  stress_hash_crc32c_hw()
+ *	crc32c using the x86 SSE4.2 crc32 instruction
+ */
+static uint32_t PURE HOT OPTIMIZE3 __attribute__ ((target("sse4.2")))
+stress_hash_crc32c_sse4_2(const uint8_t *data, const size_t len)
+{
+	register uint64_t crc = ~0U;
+	register const uint8_t *ptr = data;
+	register const uint8_t *end = data + len;
+
+	while (ptr + sizeof(uint64_t) <= end) {
+		uint64_t val;
+
+		(void)shim_memcpy(&val, ptr, sizeof(val));
+		crc = __builtin_ia32_crc32di(crc, val);
+		ptr += sizeof(uint64_t);
+	}
+	while (ptr < end)
+		crc = __builtin_ia32_crc32qi((uint32_t)crc, *ptr++);
+
+	return ~(uint32_t)crc;
+}
+#endif
+
+#if defined(HAVE_HASH_CRC32C_ARM)
+/*
+ *  stress_hash_crc32c_arm()
+ *	crc32c using the ARMv8 CRC32C instructions
+ */
+static uint32_t PURE HOT OPTIMIZE3 stress_hash_crc32c_arm(const uint8_t *data, const size_t len)
+{
+	register uint32_t crc = ~0U;
+	register const uint8_t *ptr = data;
+	register const uint8_t *end = data + len;
+
+	while (ptr + sizeof(uint64_t) <= end) {
+		uint64_t val;
+
+		(void)shim_memcpy(&val, ptr, sizeof(val));
+		crc = __crc32cd(crc, val);
+		ptr += sizeof(uint64_t);
+	}
+	while (ptr < end)
+		crc = __crc32cb(crc, *ptr++);
+
+	return ~crc;
+}
+#endif
+
+/*
+ *  stress_hash_crc32c_hw_available()
+ *	can crc32c use processor CRC32C instructions
+ */
+bool stress_hash_crc32c_hw_available(void)
+{
+#if defined(HAVE_HASH_CRC32C_SSE4_2)
+	return stress_cpu_x86_has_sse4_2();
+#elif defined(HAVE_HASH_CRC32C_ARM)
+	/* built with __ARM_FEATURE_CRC32, so always available */
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_hw()
+ *	crc32c using processor CRC32C instructions, only
+ *	to be used if stress_hash_crc32c_hw_available()
+ */
+uint32_t PURE HOT OPTIMIZE3 stress_hash_crc32c_hw(const uint8_t *data, const size_t len)
+{
+#if defined(HAVE_HASH_CRC32C_SSE4_2)
+	return stress_hash_crc32c_sse4_2(data, len);
+#elif defined(HAVE_HASH_CRC32C_ARM)
+	return stress_hash_crc32c_arm(data, len);
+#else
+	return stress_hash_crc32c_sw(data, len);
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_len()
+ *	crc32c the Castagnoli CRC32 of len bytes, uses
+ *	CRC32C instructions when available, otherwise
+ *	slicing-by-8
+ */
+uint32_t HOT OPTIMIZE3 stress_hash_crc32c_len(const uint8_t *data, const size_t len)
+{
+	if (UNLIKELY(!crc32c_func)) {
+		/* benign race, all callers resolve the same function */
+		crc32c_func = stress_hash_crc32c_hw_available() ?
+			stress_hash_crc32c_hw : stress_hash_crc32c_sw;
+	}
+	return crc32c_func(data, len);
+}
+
+/*
+ *  crc32c the Castagnoli CRC32
+ *	of a NUL terminated string
+ */
+uint32_t HOT OPTIMIZE3 stress_hash_crc32c(const char *str)
+{
+	return stress_hash_crc32c_len((const uint8_t *)str, strlen(str));
+}
+
 /*
  *  stress_hash_adler32()
  *	Mark Adler 32 bit hash
@@ -45,6 +45,10 @@ extern WARN_UNUSED uint32_t stress_hash_coffin(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_coffin32_be(const char *str, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_coffin32_le(const char *str, const size_t len);
 extern WARN_UNUSED uint32_t stress_hash_crc32c(const char *str);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_len(const uint8_t *data, const size_t len);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_sw(const uint8_t *data, const size_t len);
+extern WARN_UNUSED uint32_t stress_hash_crc32c_hw(const uint8_t *data, const size_t len);
+extern WARN_UNUSED bool stress_hash_crc32c_hw_available(void);
 extern WARN_UNUSED uint32_t stress_hash_djb2a(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_fnv1a(const char *str);
 extern WARN_UNUSED uint32_t stress_hash_jenkin(const uint8_t *data, const size_t len);
@@ -30,6 +30,7 @@
 #include "core-pthread.h"
 #include "core-pragma.h"
 #include "core-sort.h"
+#include "core-sync-start.h"
 
 #include <sched.h>
 #include <pwd.h>
@@ -1286,12 +1287,15 @@ void stress_set_proc_state_str(const char *name, const char *str)
 #endif
 }
 
+static uint8_t *proc_state;	/* shared memory copy of run state */
+static pid_t proc_state_pid;	/* process that owns proc_state */
+
 /*
- *  stress_set_proc_state
- *	set process name based on run state, see
- *	macros STRESS_STATE_*
+ *  stress_proc_state_str()
+ *	name of run state, see macros STRESS_STATE_*,
+ *	returns NULL for an unknown state
  */
-void stress_set_proc_state(const char *name, const int state)
+const char *stress_proc_state_str(const int state)
 {
 	static const char * const stress_states[] = {
 		"start",
@@ -1305,9 +1309,39 @@ void stress_set_proc_state(const char *name, const int state)
 	};
 
 	if ((state < 0) || (state >= (int)SIZEOF_ARRAY(stress_states)))
+		return NULL;
+	return stress_states[state];
+}
+
+/*
+ *  stress_set_proc_state_shared()
+ *	also record the run state of the calling process in
+ *	state so that it can be read by other processes, child
+ *	processes of the caller do not update the state
+ */
+void stress_set_proc_state_shared(uint8_t *state)
+{
+	proc_state = state;
+	proc_state_pid = getpid();
+}
+
+/*
+ *  stress_set_proc_state
+ *	set process name based on run state, see
+ *	macros STRESS_STATE_*
+ */
+void stress_set_proc_state(const char *name, const int state)
+{
+	const char *str = stress_proc_state_str(state);
+
+	if (!str)
 		return;
 
-	stress_set_proc_state_str(name, stress_states[state]);
+	if (state == STRESS_STATE_RUN)
+		stress_sync_start_wait();
+	if (proc_state && (getpid() == proc_state_pid))
+		*proc_state = (uint8_t)state;
+	stress_set_proc_state_str(name, str);
 }
 
 /*
@@ -1777,6 +1811,35 @@ void stress_runinfo(void)
 	pr_dbg("temporary file path: '%s'%s\n", real_path_ret ? real_path : temp_path, fs_type);
 }
 
+/*
+ *  stress_description_yamlify()
+ *	turn a metrics description into a yaml key,
+ *	e.g. "bogo ops per sec" to "bogo-ops-per-sec"
+ */
+char *stress_description_yamlify(const char *description)
+{
+	static char yamlified[40];
+	char *dst;
+	const char *src, *end = yamlified + sizeof(yamlified);
+
+	for (dst = yamlified, src = description; *src; src++) {
+		register int ch = (int)*src;
+
+		if (isalpha(ch)) {
+			*(dst++) = (char)tolower(ch);
+		} else if (isdigit(ch)) {
+			*(dst++) = (char)ch;
+		} else if (ch == ' ') {
+			*(dst++) = '-';
+		}
+		if (dst >= end - 1)
+			break;
+	}
+	*dst = '\0';
+
+	return yamlified;
+}
+
 /*
  *  stress_yaml_runinfo()
  *	log info about the system we are running stress-ng on
@@ -2959,6 +3022,44 @@ size_t stress_exec_text_addr(char **start, char **end)
 	return text_len;
 }
 
+/*
+ *  stress_smaps_field()
+ *	return the size in bytes of the /proc/self/smaps field
+ *	(e.g. "AnonHugePages") of the mapping that contains
+ *	address addr, 0 if it cannot be determined
+ */
+size_t stress_smaps_field(const void *addr, const char *field)
+{
+	FILE *fp;
+	char buf[256];
+	bool found = false;
+	size_t value = 0;
+	const size_t len = strlen(field);
+
+	fp = fopen("/proc/self/smaps", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		uintptr_t begin, end;
+		size_t kb;
+
+		if (sscanf(buf, "%" SCNxPTR "-%" SCNxPTR, &begin, &end) == 2) {
+			if (found)
+				break;
+			found = ((uintptr_t)addr >= begin) && ((uintptr_t)addr < end);
+			continue;
+		}
+		if (found && !strncmp(buf, field, len) && (buf[len] == ':') &&
+		    (sscanf(buf + len + 1, "%zu kB", &kb) == 1)) {
+			value = kb * 1024;
+			break;
+		}
+	}
+	(void)fclose(fp);
+
+	return value;
+}
+
 /*
  *  stress_is_dev_tty()
  *	return true if fd is on a /dev/ttyN device. If it can't
@@ -72,6 +72,8 @@ extern void stress_set_proc_name_init(int argc, char *argv[], char *envp[]);
 extern void stress_set_proc_name(const char *name);
 extern void stress_set_proc_state_str(const char *name, const char *str);
 extern void stress_set_proc_state(const char *name, const int state);
+extern void stress_set_proc_state_shared(uint8_t *state);
+extern const char *stress_proc_state_str(const int state);
 extern size_t stress_munge_underscore(char *dst, const char *src, size_t len);
 extern WARN_UNUSED int stress_strcmp_munged(const char *s1, const char *s2);
 extern WARN_UNUSED ssize_t stress_get_stack_direction(void);
@@ -99,6 +101,7 @@ extern WARN_UNUSED bool stress_little_endian(void);
 extern void stress_uint8rnd4(uint8_t *data, const size_t len);
 extern void stress_runinfo(void);
 extern void stress_yaml_runinfo(FILE *yaml);
+extern char *stress_description_yamlify(const char *description);
 extern WARN_UNUSED int stress_cache_alloc(const char *name);
 extern void stress_cache_free(void);
 extern ssize_t stress_system_write(const char *path, const char *buf,
@@ -136,6 +139,7 @@ extern WARN_UNUSED int stress_drop_capabilities(const char *name);
 extern WARN_UNUSED bool stress_is_dot_filename(const char *name);
 extern WARN_UNUSED char *stress_const_optdup(const char *opt);
 extern size_t stress_exec_text_addr(char **start, char **end);
+extern size_t stress_smaps_field(const void *addr, const char *field);
 extern WARN_UNUSED bool stress_is_dev_tty(const int fd);
 extern void stress_dirent_list_free(struct dirent **dlist, const int n);
 extern WARN_UNUSED int stress_dirent_list_prune(struct dirent **dlist, const int n);
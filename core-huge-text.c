@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-huge-text.h"
+
+#define STRESS_HUGE_TEXT_SIZE	((uintptr_t)2 * 1024 * 1024)
+
+#if defined(__linux__) &&	\
+    defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_FIXED) &&	\
+    defined(MREMAP_MAYMOVE) &&	\
+    defined(MADV_HUGEPAGE)
+
+/*
+ *  stress_huge_text_remap()
+ *	copy the 2MB aligned part of the text segment into an
+ *	anonymous huge page backed mapping and move it over the
+ *	original text. mremap replaces the text in one system call
+ *	so the copy (and this function) is executable throughout.
+ */
+void stress_huge_text_remap(void)
+{
+	char *text_start, *text_end;
+	uintptr_t start, end, aligned;
+	size_t len, head, tail, anon_huge;
+	void *tmp, *ptr;
+
+	if (!stress_exec_text_addr(&text_start, &text_end)) {
+		pr_inf("huge-text: cannot determine text segment address, ignoring --huge-text\n");
+		return;
+	}
+	start = ((uintptr_t)text_start + STRESS_HUGE_TEXT_SIZE - 1) & ~(STRESS_HUGE_TEXT_SIZE - 1);
+	end = (uintptr_t)text_end & ~(STRESS_HUGE_TEXT_SIZE - 1);
+	if (end <= start) {
+		pr_inf("huge-text: text segment does not span a 2MB aligned huge page, ignoring --huge-text\n");
+		return;
+	}
+	len = (size_t)(end - start);
+
+	/* over allocate so the copy can be 2MB aligned, then trim */
+	tmp = mmap(NULL, len + STRESS_HUGE_TEXT_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (tmp == MAP_FAILED) {
+		pr_inf("huge-text: cannot mmap %zu bytes for text copy, errno=%d (%s), ignoring --huge-text\n",
+			len, errno, strerror(errno));
+		return;
+	}
+	aligned = ((uintptr_t)tmp + STRESS_HUGE_TEXT_SIZE - 1) & ~(STRESS_HUGE_TEXT_SIZE - 1);
+	head = (size_t)(aligned - (uintptr_t)tmp);
+	tail = (size_t)STRESS_HUGE_TEXT_SIZE - head;
+	if (head)
+		(void)munmap(tmp, head);
+	if (tail)
+		(void)munmap((void *)(aligned + len), tail);
+
+	(void)madvise((void *)aligned, len, MADV_HUGEPAGE);
+	(void)shim_memcpy((void *)aligned, (void *)start, len);
+#if defined(MADV_COLLAPSE)
+	/* force collapse if the copy faulted in as small pages */
+	(void)madvise((void *)aligned, len, MADV_COLLAPSE);
+#endif
+	if (mprotect((void *)aligned, len, PROT_READ | PROT_EXEC) < 0) {
+		pr_inf("huge-text: cannot make text copy executable, errno=%d (%s), ignoring --huge-text\n",
+			errno, strerror(errno));
+		(void)munmap((void *)aligned, len);
+		return;
+	}
+	ptr = mremap((void *)aligned, len, len, MREMAP_MAYMOVE | MREMAP_FIXED, (void *)start);
+	if (ptr == MAP_FAILED) {
+		pr_inf("huge-text: cannot mremap text copy over text segment, errno=%d (%s), ignoring --huge-text\n",
+			errno, strerror(errno));
+		(void)munmap((void *)aligned, len);
+		return;
+	}
+	anon_huge = stress_smaps_field((void *)start, "AnonHugePages");
+	pr_inf("huge-text: remapped %zu MB of text at %p, %zu MB backed by huge pages\n",
+		len >> 20, ptr, anon_huge >> 20);
+}
+#else
+void stress_huge_text_remap(void)
+{
+	pr_inf("huge-text: text remapping not supported, ignoring --huge-text\n");
+}
+#endif
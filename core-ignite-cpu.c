@@ -20,9 +20,12 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-ignite-cpu.h"
 #include "core-killpid.h"
 
+#include <sched.h>
+
 #define SETTING_SCALING_FREQ		(0x01)
 #define SETTING_CPUINFO_FREQ		(0x02)
 #define SETTING_FREQ			(SETTING_SCALING_FREQ | SETTING_CPUINFO_FREQ)
@@ -375,3 +378,294 @@ void stress_ignite_cpu_stop(void)
 	}
 	enabled = false;
 }
+
+#define STRESS_RAMP_IDLE_USECS		(250000)	/* idle time before each burst */
+#define STRESS_RAMP_BURST_SECS		(0.25)		/* load burst duration */
+#define STRESS_RAMP_SAMPLE_SECS		(0.00005)	/* frequency sample interval */
+#define STRESS_RAMP_SAMPLES_MAX		(8192)		/* samples per burst */
+#define STRESS_RAMP_TRIALS		(5)		/* bursts per governor and EPP */
+#define STRESS_RAMP_PEAK_FRACTION	(0.95)		/* ramp ends at 95% of peak */
+#define STRESS_RAMP_SETTINGS_MAX	(16)		/* governors or EPP settings */
+
+#define STRESS_MSR_IA32_APERF		(0xe8)
+
+/* frequency ramp measurement state for the CPU being measured */
+typedef struct {
+	int32_t cpu;			/* CPU being measured */
+	int msr_fd;			/* /dev/cpu/N/msr fd, -1 if not used */
+	char cur_freq_path[PATH_MAX];	/* scaling_cur_freq path */
+	uint64_t aperf;			/* last APERF reading */
+	double t;			/* time of last reading */
+	double *mhz;			/* burst frequency samples, MHz */
+	double *when;			/* burst sample times, seconds */
+} stress_ramp_t;
+
+/*
+ *  stress_ignite_cpu_ramp_mhz()
+ *	sample the CPU frequency in MHz, with APERF this is the
+ *	average frequency since the previous sample, otherwise it
+ *	is the cpufreq scaling_cur_freq, returns < 0 on failure
+ */
+static double stress_ignite_cpu_ramp_mhz(stress_ramp_t *ramp, const double t)
+{
+	char buf[64];
+	uint64_t khz;
+
+	if (ramp->msr_fd >= 0) {
+		uint64_t aperf;
+		double mhz;
+
+		if (pread(ramp->msr_fd, &aperf, sizeof(aperf), STRESS_MSR_IA32_APERF) != (ssize_t)sizeof(aperf))
+			return -1.0;
+		mhz = (t > ramp->t) ? (double)(aperf - ramp->aperf) / ((t - ramp->t) * 1000000.0) : 0.0;
+		ramp->aperf = aperf;
+		ramp->t = t;
+		return mhz;
+	}
+	if (stress_system_read(ramp->cur_freq_path, buf, sizeof(buf)) <= 0)
+		return -1.0;
+	if (sscanf(buf, "%" SCNu64, &khz) != 1)
+		return -1.0;
+	return (double)khz / 1000.0;
+}
+
+/*
+ *  stress_ignite_cpu_ramp_trial()
+ *	idle the CPU, then run a busy burst sampling the frequency,
+ *	the ramp time is the time from the start of the burst to
+ *	reach STRESS_RAMP_PEAK_FRACTION of the burst peak frequency
+ */
+static bool stress_ignite_cpu_ramp_trial(
+	stress_ramp_t *ramp,
+	double *start_mhz,
+	double *peak_mhz,
+	double *ramp_secs)
+{
+	double t_start, t, t_next, peak = 0.0;
+	size_t i, n = 0;
+	volatile uint64_t counter = 0;
+
+	(void)shim_usleep(STRESS_RAMP_IDLE_USECS);
+
+	t_start = stress_time_now();
+	if (stress_ignite_cpu_ramp_mhz(ramp, t_start) < 0.0)
+		return false;
+	t_next = t_start + STRESS_RAMP_SAMPLE_SECS;
+	do {
+		t = stress_time_now();
+		if (t >= t_next) {
+			const double mhz = stress_ignite_cpu_ramp_mhz(ramp, t);
+
+			if (mhz < 0.0)
+				return false;
+			ramp->mhz[n] = mhz;
+			ramp->when[n] = t - t_start;
+			n++;
+			t_next += STRESS_RAMP_SAMPLE_SECS;
+		} else {
+			counter++;
+		}
+	} while ((t - t_start < STRESS_RAMP_BURST_SECS) && (n < STRESS_RAMP_SAMPLES_MAX));
+
+	if (n == 0)
+		return false;
+	for (i = 0; i < n; i++)
+		peak = STRESS_MAXIMUM(peak, ramp->mhz[i]);
+	for (i = 0; i < n; i++) {
+		if (ramp->mhz[i] >= peak * STRESS_RAMP_PEAK_FRACTION)
+			break;
+	}
+	*start_mhz = ramp->mhz[0];
+	*peak_mhz = peak;
+	*ramp_secs = ramp->when[i];
+	return true;
+}
+
+/*
+ *  stress_ignite_cpu_ramp_tokens()
+ *	split a sysfs space separated list into at most max tokens
+ */
+static size_t stress_ignite_cpu_ramp_tokens(char *buf, char *tokens[], const size_t max)
+{
+	size_t n = 0;
+	char *ptr, *saveptr = NULL;
+
+	for (ptr = strtok_r(buf, " \n", &saveptr); ptr && (n < max); ptr = strtok_r(NULL, " \n", &saveptr))
+		tokens[n++] = ptr;
+	return n;
+}
+
+static int stress_ignite_cpu_ramp_cmp(const void *p1, const void *p2)
+{
+	const double d1 = *(const double *)p1;
+	const double d2 = *(const double *)p2;
+
+	return (d1 > d2) - (d1 < d2);
+}
+
+/*
+ *  stress_ignite_cpu_ramp()
+ *	measure the time for an idle CPU to ramp up to its peak
+ *	frequency when a load burst starts for each cpufreq governor
+ *	and energy performance preference (EPP), sampling APERF via
+ *	the msr driver or the cpufreq scaling_cur_freq
+ */
+void stress_ignite_cpu_ramp(void)
+{
+	char path[PATH_MAX];
+	char governors_buf[512], epps_buf[512];
+	char orig_governor[64], orig_epp[64];
+	char *governors[STRESS_RAMP_SETTINGS_MAX], *epps[STRESS_RAMP_SETTINGS_MAX];
+	size_t n_governors, n_epps, g, e;
+	stress_ramp_t ramp;
+	const bool root = (geteuid() == 0);
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+	cpu_set_t mask, orig_mask;
+	const bool pinned = (sched_getaffinity(0, sizeof(orig_mask), &orig_mask) == 0);
+#endif
+
+	(void)shim_memset(&ramp, 0, sizeof(ramp));
+	ramp.cpu = (int32_t)stress_get_cpu();
+	ramp.msr_fd = -1;
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+	CPU_ZERO(&mask);
+	CPU_SET((int)ramp.cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+#endif
+
+	(void)snprintf(ramp.cur_freq_path, sizeof(ramp.cur_freq_path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_cur_freq", ramp.cpu);
+#if defined(STRESS_ARCH_X86)
+	if (stress_cpu_x86_has_msr()) {
+		(void)snprintf(path, sizeof(path), "/dev/cpu/%" PRId32 "/msr", ramp.cpu);
+		ramp.msr_fd = open(path, O_RDONLY);
+		if ((ramp.msr_fd >= 0) &&
+		    (pread(ramp.msr_fd, &ramp.aperf, sizeof(ramp.aperf), STRESS_MSR_IA32_APERF) != (ssize_t)sizeof(ramp.aperf))) {
+			(void)close(ramp.msr_fd);
+			ramp.msr_fd = -1;
+		}
+	}
+#endif
+	if ((ramp.msr_fd < 0) && (access(ramp.cur_freq_path, R_OK) < 0)) {
+		pr_inf("ignite-cpu: cannot read APERF or cpufreq scaling_cur_freq on cpu %" PRId32
+			", skipping frequency ramp measurement\n", ramp.cpu);
+		goto restore_affinity;
+	}
+
+	ramp.mhz = calloc(STRESS_RAMP_SAMPLES_MAX, sizeof(*ramp.mhz));
+	ramp.when = calloc(STRESS_RAMP_SAMPLES_MAX, sizeof(*ramp.when));
+	if (!ramp.mhz || !ramp.when) {
+		pr_inf("ignite-cpu: cannot allocate frequency samples, skipping frequency ramp measurement\n");
+		goto tidy;
+	}
+
+	/* the current settings, restored after the measurements */
+	(void)shim_memset(orig_governor, 0, sizeof(orig_governor));
+	(void)shim_memset(orig_epp, 0, sizeof(orig_epp));
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_governor", ramp.cpu);
+	VOID_RET(ssize_t, stress_system_read(path, orig_governor, sizeof(orig_governor)));
+	(void)snprintf(path, sizeof(path),
+		"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/energy_performance_preference", ramp.cpu);
+	VOID_RET(ssize_t, stress_system_read(path, orig_epp, sizeof(orig_epp)));
+	orig_governor[strcspn(orig_governor, "\n")] = '\0';
+	orig_epp[strcspn(orig_epp, "\n")] = '\0';
+
+	/* without root only the current setting can be measured */
+	(void)shim_memset(governors_buf, 0, sizeof(governors_buf));
+	(void)shim_memset(epps_buf, 0, sizeof(epps_buf));
+	if (root) {
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_available_governors", ramp.cpu);
+		VOID_RET(ssize_t, stress_system_read(path, governors_buf, sizeof(governors_buf)));
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/energy_performance_available_preferences", ramp.cpu);
+		VOID_RET(ssize_t, stress_system_read(path, epps_buf, sizeof(epps_buf)));
+	}
+	n_governors = stress_ignite_cpu_ramp_tokens(governors_buf, governors, STRESS_RAMP_SETTINGS_MAX);
+	if (n_governors == 0) {
+		governors[0] = orig_governor;
+		n_governors = 1;
+	}
+	n_epps = stress_ignite_cpu_ramp_tokens(epps_buf, epps, STRESS_RAMP_SETTINGS_MAX);
+	if (n_epps == 0) {
+		epps[0] = orig_epp;
+		n_epps = 1;
+	}
+
+	pr_block_begin();
+	pr_inf("ignite-cpu: cpu %" PRId32 " frequency ramp, %s sampled every %.0f us, "
+		"%d trials of a %.0f ms burst after %.0f ms idle\n", ramp.cpu,
+		(ramp.msr_fd >= 0) ? "APERF" : "scaling_cur_freq",
+		STRESS_RAMP_SAMPLE_SECS * 1000000.0, STRESS_RAMP_TRIALS,
+		STRESS_RAMP_BURST_SECS * 1000.0, (double)STRESS_RAMP_IDLE_USECS / 1000.0);
+	pr_inf("ignite-cpu: %-14s %-22s %9s %9s %10s %10s\n",
+		"governor", "EPP", "start MHz", "peak MHz", "median ms", "max ms");
+
+	for (g = 0; (g < n_governors) && stress_continue_flag(); g++) {
+		/* the userspace governor holds a fixed frequency, there is no ramp */
+		if (!strcmp(governors[g], "userspace"))
+			continue;
+		if (root && (*governors[g] != '\0')) {
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_governor", ramp.cpu);
+			if (stress_system_write(path, governors[g], strlen(governors[g])) < 0)
+				continue;
+		}
+		for (e = 0; (e < n_epps) && stress_continue_flag(); e++) {
+			double ramps[STRESS_RAMP_TRIALS], start = 0.0, peak = 0.0;
+			int i, n = 0;
+
+			if (root && (*epps[e] != '\0')) {
+				(void)snprintf(path, sizeof(path),
+					"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/energy_performance_preference", ramp.cpu);
+				/* EPP may be fixed by the governor, e.g. performance */
+				if (stress_system_write(path, epps[e], strlen(epps[e])) < 0)
+					continue;
+			}
+			for (i = 0; (i < STRESS_RAMP_TRIALS) && stress_continue_flag(); i++) {
+				double start_mhz, peak_mhz;
+
+				if (!stress_ignite_cpu_ramp_trial(&ramp, &start_mhz, &peak_mhz, &ramps[n]))
+					break;
+				start += start_mhz;
+				peak = STRESS_MAXIMUM(peak, peak_mhz);
+				n++;
+			}
+			if (n == 0)
+				continue;
+			qsort(ramps, (size_t)n, sizeof(*ramps), stress_ignite_cpu_ramp_cmp);
+			pr_inf("ignite-cpu: %-14s %-22s %9.0f %9.0f %10.3f %10.3f\n",
+				*governors[g] ? governors[g] : "-", *epps[e] ? epps[e] : "-",
+				start / (double)n, peak, ramps[n / 2] * 1000.0, ramps[n - 1] * 1000.0);
+		}
+	}
+	pr_block_end();
+
+	if (root) {
+		if (*orig_governor) {
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/scaling_governor", ramp.cpu);
+			(void)stress_system_write(path, orig_governor, strlen(orig_governor));
+		}
+		if (*orig_epp) {
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%" PRId32 "/cpufreq/energy_performance_preference", ramp.cpu);
+			(void)stress_system_write(path, orig_epp, strlen(orig_epp));
+		}
+	}
+tidy:
+	free(ramp.when);
+	free(ramp.mhz);
+	if (ramp.msr_fd >= 0)
+		(void)close(ramp.msr_fd);
+restore_affinity:
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+	if (pinned)
+		(void)sched_setaffinity(0, sizeof(orig_mask), &orig_mask);
+#endif
+	return;
+}
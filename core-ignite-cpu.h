@@ -21,5 +21,6 @@
 
 extern void stress_ignite_cpu_start(void);
 extern void stress_ignite_cpu_stop(void);
+extern void stress_ignite_cpu_ramp(void);
 
 #endif
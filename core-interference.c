@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-interference.h"
+
+/*
+ *  Bogo-op rates of each stressor (the victim) when run alone, the
+ *  diagonal of the matrix, and when run alongside each of the other
+ *  stressors (the aggressor), 0.0 = not measured
+ */
+static stress_stressor_t *interference_ss[STRESS_INTERFERENCE_MAX];
+static double interference_rate[STRESS_INTERFERENCE_MAX][STRESS_INTERFERENCE_MAX];
+static size_t interference_n;
+
+/*
+ *  stress_interference_init()
+ *	set the stressors in the interference matrix
+ */
+int stress_interference_init(stress_stressor_t *stressors[], const size_t n)
+{
+	size_t i, j;
+
+	if (n > STRESS_INTERFERENCE_MAX)
+		return -1;
+	for (i = 0; i < n; i++) {
+		interference_ss[i] = stressors[i];
+		for (j = 0; j < n; j++)
+			interference_rate[i][j] = 0.0;
+	}
+	interference_n = n;
+	return 0;
+}
+
+/*
+ *  stress_interference_record()
+ *	record the bogo-op rate of the last run of the victim
+ *	stressor, a victim that is its own aggressor was run alone
+ */
+void stress_interference_record(const size_t victim, const size_t aggressor)
+{
+	const stress_stressor_t *ss;
+	uint64_t counter = 0;
+	double run_time = 0.0;
+	int32_t j, n = 0;
+
+	if ((victim >= interference_n) || (aggressor >= interference_n))
+		return;
+
+	ss = interference_ss[victim];
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		counter += stats->args.ci.counter;
+		if (stats->completed) {
+			run_time += stats->duration;
+			n++;
+		}
+	}
+	run_time = n ? run_time / (double)n : 0.0;
+	interference_rate[victim][aggressor] =
+		(run_time > 0.0) ? (double)counter / run_time : 0.0;
+}
+
+/*
+ *  stress_interference_slowdown()
+ *	slowdown of the victim when run with the aggressor, the
+ *	baseline rate divided by the co-located rate, so 1.0 is
+ *	no slowdown and 2.0 is half the throughput. Returns 0.0
+ *	if either rate was not measured
+ */
+static double stress_interference_slowdown(const size_t victim, const size_t aggressor)
+{
+	const double baseline = interference_rate[victim][victim];
+	const double rate = interference_rate[victim][aggressor];
+
+	if ((baseline <= 0.0) || (rate <= 0.0))
+		return 0.0;
+	return baseline / rate;
+}
+
+/*
+ *  stress_interference_dump()
+ *	report the N x N matrix of slowdowns, rows are the victim
+ *	stressors and columns are the aggressor stressors
+ */
+void stress_interference_dump(FILE *yaml)
+{
+	char munged[64], line[256];
+	size_t i, j;
+
+	if (interference_n == 0)
+		return;
+
+	pr_block_begin();
+	pr_inf("interference: slowdown of each stressor (row) when run with another (column)\n");
+	(void)snprintf(line, sizeof(line), "%-12s %12s", "stressor", "baseline/s");
+	for (j = 0; j < interference_n; j++) {
+		char col[16];
+
+		(void)stress_munge_underscore(munged, interference_ss[j]->stressor->name, sizeof(munged));
+		(void)snprintf(col, sizeof(col), " %8.8s", munged);
+		shim_strlcat(line, col, sizeof(line));
+	}
+	pr_inf("%s\n", line);
+	pr_yaml(yaml, "interference:\n");
+
+	for (i = 0; i < interference_n; i++) {
+		(void)stress_munge_underscore(munged, interference_ss[i]->stressor->name, sizeof(munged));
+		(void)snprintf(line, sizeof(line), "%-12.12s %12.2f", munged, interference_rate[i][i]);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      baseline-bogo-ops-per-second: %f\n", interference_rate[i][i]);
+
+		for (j = 0; j < interference_n; j++) {
+			const double slowdown = stress_interference_slowdown(i, j);
+			char col[16], aggressor[64];
+
+			if (slowdown > 0.0)
+				(void)snprintf(col, sizeof(col), " %8.2f", slowdown);
+			else
+				(void)snprintf(col, sizeof(col), " %8s", "-");
+			shim_strlcat(line, col, sizeof(line));
+
+			if ((i == j) || (slowdown <= 0.0))
+				continue;
+			(void)stress_munge_underscore(aggressor, interference_ss[j]->stressor->name, sizeof(aggressor));
+			pr_yaml(yaml, "      slowdown-with-%s: %f\n", aggressor, slowdown);
+		}
+		pr_inf("%s\n", line);
+		pr_yaml(yaml, "\n");
+	}
+	pr_block_end();
+}
+
+/*
+ *  stress_interference_free()
+ *	forget the interference matrix stressors
+ */
+void stress_interference_free(void)
+{
+	interference_n = 0;
+}
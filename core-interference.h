@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_INTERFERENCE_H
+#define CORE_INTERFERENCE_H
+
+#include "stress-ng.h"
+
+#define STRESS_INTERFERENCE_MAX	(16)	/* max stressors in the matrix */
+
+extern int stress_interference_init(stress_stressor_t *stressors[], const size_t n);
+extern void stress_interference_record(const size_t victim, const size_t aggressor);
+extern void stress_interference_dump(FILE *yaml);
+extern void stress_interference_free(void);
+
+#endif
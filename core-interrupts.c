@@ -141,6 +141,72 @@ static void stress_interrupts_count(stress_interrupts_t *counters, const int whi
 	(void)fclose(fp);
 }
 
+/*
+ *  stress_interrupts_per_cpu()
+ *	fill counts[cpu] with the per CPU /proc/interrupts counts of
+ *	interrupt type (e.g. "TLB:") for CPUs 0..max_cpus-1, the CPU
+ *	columns are mapped using the CPUn heading as offline CPUs are
+ *	not listed. Returns the number of CPU counts read or -1 if the
+ *	interrupt type is not found.
+ */
+int stress_interrupts_per_cpu(const char *type, uint64_t *counts, const int32_t max_cpus)
+{
+	FILE *fp;
+	char buffer[16384];
+	int32_t cpus[1024];
+	int n_cpus = 0, ret = -1;
+	const size_t len = strlen(type);
+
+	(void)memset(counts, 0, sizeof(*counts) * (size_t)max_cpus);
+
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return -1;
+
+	/* heading, CPU0 CPU1 .. CPUn */
+	if (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr = buffer;
+
+		while ((ptr = strstr(ptr, "CPU")) != NULL) {
+			int cpu;
+
+			ptr += 3;
+			if ((sscanf(ptr, "%d", &cpu) == 1) && (n_cpus < (int)SIZEOF_ARRAY(cpus)))
+				cpus[n_cpus++] = cpu;
+		}
+	}
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr = buffer;
+		int i;
+
+		while (*ptr == ' ')
+			ptr++;
+		if (strncmp(ptr, type, len))
+			continue;
+		ptr += len;
+		for (i = 0; i < n_cpus; i++) {
+			uint64_t val = 0ULL;
+
+			while (*ptr == ' ')
+				ptr++;
+			if (!isdigit((int)*ptr))
+				break;
+			if (sscanf(ptr, "%" SCNu64, &val) == 1) {
+				if ((cpus[i] >= 0) && (cpus[i] < max_cpus))
+					counts[cpus[i]] = val;
+			}
+			while (isdigit((int)*ptr))
+				ptr++;
+		}
+		ret = i;
+		break;
+	}
+	(void)fclose(fp);
+
+	return ret;
+}
+
 /*
  *  stress_interrupts_start()
  *	count interrupts at start of run
@@ -258,3 +324,463 @@ void stress_interrupts_dump(FILE *yaml, stress_stressor_t *stressors_list)
 			pr_yaml(yaml, "\n");
 	}
 }
+
+/* Per CPU counts of an interrupt line, from /proc/interrupts or /proc/softirqs */
+typedef struct {
+	char label[32];			/* IRQ number or name, e.g. 24, LOC, NET_RX */
+	char descr[64];			/* device or description */
+	bool softirq;			/* true = /proc/softirqs line */
+	uint64_t *counts;		/* per CPU counts */
+} stress_irq_line_t;
+
+typedef struct {
+	stress_irq_line_t *lines;	/* interrupt lines */
+	size_t n_lines;			/* number of lines */
+} stress_irq_snapshot_t;
+
+/* Per CPU interrupt count deltas accrued while a stressor was running */
+typedef struct stress_irq_record {
+	struct stress_irq_record *next;	/* next record in list */
+	const stress_stressor_t *ss;	/* stressor */
+	double duration;		/* run duration in seconds */
+	stress_irq_snapshot_t delta;	/* per CPU count deltas */
+} stress_irq_record_t;
+
+#define STRESS_IRQ_HOTSPOTS	(5)	/* number of busiest lines to report */
+
+static int32_t irq_cpus;
+static stress_irq_snapshot_t irq_begin;
+static bool irq_begin_valid;
+static stress_irq_record_t *irq_records;
+
+/*
+ *  stress_irq_snapshot_free()
+ *	free the lines of an interrupt snapshot
+ */
+static void stress_irq_snapshot_free(stress_irq_snapshot_t *snap)
+{
+	size_t i;
+
+	for (i = 0; i < snap->n_lines; i++)
+		free(snap->lines[i].counts);
+	free(snap->lines);
+	snap->lines = NULL;
+	snap->n_lines = 0;
+}
+
+/*
+ *  stress_irq_snapshot_find()
+ *	find an interrupt line in a snapshot, NULL if not found
+ */
+static stress_irq_line_t *stress_irq_snapshot_find(
+	const stress_irq_snapshot_t *snap,
+	const char *label,
+	const bool softirq)
+{
+	size_t i;
+
+	for (i = 0; i < snap->n_lines; i++) {
+		if ((snap->lines[i].softirq == softirq) &&
+		    !strcmp(snap->lines[i].label, label))
+			return &snap->lines[i];
+	}
+	return NULL;
+}
+
+/*
+ *  stress_irq_snapshot_add()
+ *	add a zeroed interrupt line to a snapshot, NULL if out of memory
+ */
+static stress_irq_line_t *stress_irq_snapshot_add(
+	stress_irq_snapshot_t *snap,
+	const char *label,
+	const char *descr,
+	const bool softirq)
+{
+	stress_irq_line_t *lines, *line;
+
+	lines = (stress_irq_line_t *)realloc(snap->lines, (snap->n_lines + 1) * sizeof(*lines));
+	if (!lines)
+		return NULL;
+	snap->lines = lines;
+	line = &lines[snap->n_lines];
+	line->counts = (uint64_t *)calloc((size_t)irq_cpus, sizeof(*line->counts));
+	if (!line->counts)
+		return NULL;
+	(void)shim_strscpy(line->label, label, sizeof(line->label));
+	(void)shim_strscpy(line->descr, descr, sizeof(line->descr));
+	line->softirq = softirq;
+	snap->n_lines++;
+	return line;
+}
+
+/*
+ *  stress_irq_snapshot_read_file()
+ *	read the per CPU counts of all the lines of /proc/interrupts
+ *	or /proc/softirqs, the CPU columns are mapped using the CPUn
+ *	heading as offline CPUs are not listed
+ */
+static int stress_irq_snapshot_read_file(
+	const char *path,
+	const bool softirq,
+	stress_irq_snapshot_t *snap)
+{
+	FILE *fp;
+	char buffer[16384];
+	int32_t cpus[1024];
+	int n_cpus = 0;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return -1;
+
+	if (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr = buffer;
+
+		while ((ptr = strstr(ptr, "CPU")) != NULL) {
+			int cpu;
+
+			ptr += 3;
+			if ((sscanf(ptr, "%d", &cpu) == 1) && (n_cpus < (int)SIZEOF_ARRAY(cpus)))
+				cpus[n_cpus++] = cpu;
+		}
+	}
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		char *ptr = buffer, *label, *descr, *end;
+		stress_irq_line_t *line;
+		int i;
+
+		while (*ptr == ' ')
+			ptr++;
+		label = ptr;
+		ptr = strchr(ptr, ':');
+		if (!ptr)
+			continue;
+		*ptr++ = '\0';
+
+		line = stress_irq_snapshot_add(snap, label, "", softirq);
+		if (!line)
+			break;
+		for (i = 0; i < n_cpus; i++) {
+			uint64_t val = 0ULL;
+
+			while (*ptr == ' ')
+				ptr++;
+			if (!isdigit((int)*ptr))
+				break;
+			if (sscanf(ptr, "%" SCNu64, &val) == 1) {
+				if ((cpus[i] >= 0) && (cpus[i] < irq_cpus))
+					line->counts[cpus[i]] = val;
+			}
+			while (isdigit((int)*ptr))
+				ptr++;
+		}
+
+		/* remaining text, the device name is the last field of numbered IRQs */
+		end = ptr + strlen(ptr);
+		while ((end > ptr) && isspace((int)end[-1]))
+			*--end = '\0';
+		descr = ptr;
+		if (isdigit((int)*label)) {
+			descr = strrchr(ptr, ' ');
+			descr = descr ? descr + 1 : ptr;
+		}
+		while (*descr == ' ')
+			descr++;
+		(void)shim_strscpy(line->descr, descr, sizeof(line->descr));
+	}
+	(void)fclose(fp);
+	return 0;
+}
+
+/*
+ *  stress_irq_snapshot_read()
+ *	snapshot /proc/interrupts and /proc/softirqs,
+ *	returns -1 if interrupts can't be read
+ */
+static int stress_irq_snapshot_read(stress_irq_snapshot_t *snap)
+{
+	snap->lines = NULL;
+	snap->n_lines = 0;
+
+	if (stress_irq_snapshot_read_file("/proc/interrupts", false, snap) < 0) {
+		stress_irq_snapshot_free(snap);
+		return -1;
+	}
+	(void)stress_irq_snapshot_read_file("/proc/softirqs", true, snap);
+	return 0;
+}
+
+/*
+ *  stress_interrupts_irq_begin()
+ *	snapshot the per CPU interrupt counts at the start of a run
+ */
+void stress_interrupts_irq_begin(void)
+{
+	if (!(g_opt_flags & OPT_FLAGS_IRQ_STATS))
+		return;
+	if (irq_cpus < 1) {
+		irq_cpus = stress_get_processors_configured();
+		if (irq_cpus < 1)
+			return;
+	}
+	stress_irq_snapshot_free(&irq_begin);
+	irq_begin_valid = (stress_irq_snapshot_read(&irq_begin) == 0);
+}
+
+/*
+ *  stress_interrupts_irq_end()
+ *	add the per CPU interrupt counts since stress_interrupts_irq_begin()
+ *	to each of the stressors that were run, stressors that run in
+ *	parallel all share the same system wide interrupt counts
+ */
+void stress_interrupts_irq_end(const stress_stressor_t *stressors_list, const double duration)
+{
+	const stress_stressor_t *ss;
+	stress_irq_snapshot_t end;
+
+	if (!irq_begin_valid)
+		return;
+	irq_begin_valid = false;
+	if (stress_irq_snapshot_read(&end) < 0)
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_irq_record_t *record;
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (record = irq_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record) {
+			record = (stress_irq_record_t *)calloc(1, sizeof(*record));
+			if (!record)
+				continue;
+			record->ss = ss;
+			record->next = irq_records;
+			irq_records = record;
+		}
+		record->duration += duration;
+
+		for (i = 0; i < end.n_lines; i++) {
+			const stress_irq_line_t *line_end = &end.lines[i];
+			const stress_irq_line_t *line_begin;
+			stress_irq_line_t *line_delta;
+			int32_t cpu;
+
+			line_begin = stress_irq_snapshot_find(&irq_begin, line_end->label, line_end->softirq);
+			line_delta = stress_irq_snapshot_find(&record->delta, line_end->label, line_end->softirq);
+			if (!line_delta) {
+				line_delta = stress_irq_snapshot_add(&record->delta, line_end->label,
+						line_end->descr, line_end->softirq);
+				if (!line_delta)
+					break;
+			}
+			for (cpu = 0; cpu < irq_cpus; cpu++) {
+				const uint64_t begin = line_begin ? line_begin->counts[cpu] : 0ULL;
+
+				if (line_end->counts[cpu] > begin)
+					line_delta->counts[cpu] += line_end->counts[cpu] - begin;
+			}
+		}
+	}
+	stress_irq_snapshot_free(&end);
+	stress_irq_snapshot_free(&irq_begin);
+}
+
+/*
+ *  stress_irq_line_total()
+ *	total count of an interrupt line over all CPUs
+ */
+static uint64_t stress_irq_line_total(const stress_irq_line_t *line)
+{
+	uint64_t total = 0;
+	int32_t cpu;
+
+	for (cpu = 0; cpu < irq_cpus; cpu++)
+		total += line->counts[cpu];
+	return total;
+}
+
+/*
+ *  stress_irq_busiest_cpu()
+ *	CPU with the most interrupts of a line, -1 if none
+ */
+static int32_t stress_irq_busiest_cpu(const stress_irq_line_t *line)
+{
+	int32_t cpu, busiest = -1;
+	uint64_t max = 0;
+
+	for (cpu = 0; cpu < irq_cpus; cpu++) {
+		if (line->counts[cpu] > max) {
+			max = line->counts[cpu];
+			busiest = cpu;
+		}
+	}
+	return busiest;
+}
+
+/*
+ *  stress_irq_dump_yaml()
+ *	dump the hard IRQ or softirq lines with non-zero counts
+ */
+static void stress_irq_dump_yaml(FILE *yaml, const stress_irq_record_t *record, const bool softirq)
+{
+	size_t i;
+	bool pr_heading = false;
+
+	for (i = 0; i < record->delta.n_lines; i++) {
+		const stress_irq_line_t *line = &record->delta.lines[i];
+		const uint64_t total = stress_irq_line_total(line);
+		int32_t cpu;
+
+		if ((line->softirq != softirq) || (total == 0))
+			continue;
+		if (!pr_heading) {
+			pr_yaml(yaml, "      %s:\n", softirq ? "softirqs" : "hardirqs");
+			pr_heading = true;
+		}
+		pr_yaml(yaml, "        - irq: \"%s\"\n", line->label);
+		if (*line->descr)
+			pr_yaml(yaml, "          description: \"%s\"\n", line->descr);
+		pr_yaml(yaml, "          total: %" PRIu64 "\n", total);
+		pr_yaml(yaml, "          per-sec: %f\n",
+			(record->duration > 0.0) ? (double)total / record->duration : 0.0);
+		pr_yaml(yaml, "          per-cpu: [");
+		for (cpu = 0; cpu < irq_cpus; cpu++)
+			pr_yaml(yaml, "%s%" PRIu64, cpu ? ", " : "", line->counts[cpu]);
+		pr_yaml(yaml, "]\n");
+	}
+}
+
+/*
+ *  stress_irq_dump_busiest_cpu()
+ *	report the CPU that handled the most hard IRQs or softirqs
+ */
+static void stress_irq_dump_busiest_cpu(const stress_irq_record_t *record, const bool softirq)
+{
+	uint64_t total = 0, max = 0;
+	int32_t cpu, busiest = -1;
+
+	for (cpu = 0; cpu < irq_cpus; cpu++) {
+		uint64_t sum = 0;
+		size_t i;
+
+		for (i = 0; i < record->delta.n_lines; i++) {
+			if (record->delta.lines[i].softirq == softirq)
+				sum += record->delta.lines[i].counts[cpu];
+		}
+		total += sum;
+		if (sum > max) {
+			max = sum;
+			busiest = cpu;
+		}
+	}
+	if (busiest < 0)
+		return;
+	pr_inf("   busiest %s CPU: CPU%" PRId32 " handled %.1f%% of %.1f %s per sec\n",
+		softirq ? "softirq" : "hard IRQ", busiest,
+		100.0 * (double)max / (double)total,
+		(record->duration > 0.0) ? (double)total / record->duration : 0.0,
+		softirq ? "softirqs" : "hard IRQs");
+}
+
+/*
+ *  stress_interrupts_irq_dump()
+ *	dump the busiest interrupt lines and CPUs of each stressor
+ *	and the per CPU counts of all the interrupt lines to YAML
+ */
+void stress_interrupts_irq_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool pr_heading = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_irq_record_t *record;
+		size_t hotspots[STRESS_IRQ_HOTSPOTS];
+		size_t i, j, n = 0;
+		char munged[64];
+
+		if (ss->ignore.run)
+			continue;
+		for (record = irq_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record)
+			continue;
+
+		/* busiest lines, insertion sorted by total */
+		for (i = 0; i < record->delta.n_lines; i++) {
+			const uint64_t total = stress_irq_line_total(&record->delta.lines[i]);
+
+			if (total == 0)
+				continue;
+			for (j = n; j > 0; j--) {
+				if (stress_irq_line_total(&record->delta.lines[hotspots[j - 1]]) >= total)
+					break;
+				if (j < STRESS_IRQ_HOTSPOTS)
+					hotspots[j] = hotspots[j - 1];
+			}
+			if (j < STRESS_IRQ_HOTSPOTS) {
+				hotspots[j] = i;
+				if (n < STRESS_IRQ_HOTSPOTS)
+					n++;
+			}
+		}
+
+		if (!pr_heading) {
+			pr_inf("interrupt hotspots:\n");
+			pr_yaml(yaml, "irq-stats:\n");
+			pr_heading = true;
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("%s:\n", munged);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      duration: %f\n", record->duration);
+
+		for (i = 0; i < n; i++) {
+			const stress_irq_line_t *line = &record->delta.lines[hotspots[i]];
+			const uint64_t total = stress_irq_line_total(line);
+			const int32_t cpu = stress_irq_busiest_cpu(line);
+			char name[48];
+
+			(void)snprintf(name, sizeof(name), "%s%s", line->softirq ? "softirq " : "", line->label);
+			pr_inf("   %-16s %-24.24s %12.1f per sec, %5.1f%% on CPU%" PRId32 "\n",
+				name, line->descr,
+				(record->duration > 0.0) ? (double)total / record->duration : 0.0,
+				100.0 * (double)line->counts[cpu] / (double)total, cpu);
+		}
+		stress_irq_dump_busiest_cpu(record, false);
+		stress_irq_dump_busiest_cpu(record, true);
+		stress_irq_dump_yaml(yaml, record, false);
+		stress_irq_dump_yaml(yaml, record, true);
+	}
+	if (pr_heading)
+		pr_yaml(yaml, "\n");
+}
+
+/*
+ *  stress_interrupts_irq_free()
+ *	free the per stressor interrupt records
+ */
+void stress_interrupts_irq_free(void)
+{
+	stress_irq_record_t *record = irq_records;
+
+	while (record) {
+		stress_irq_record_t *next = record->next;
+
+		stress_irq_snapshot_free(&record->delta);
+		free(record);
+		record = next;
+	}
+	irq_records = NULL;
+	stress_irq_snapshot_free(&irq_begin);
+	irq_begin_valid = false;
+}
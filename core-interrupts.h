@@ -24,5 +24,10 @@ extern void stress_interrupts_stop(stress_interrupts_t *counters);
 extern void stress_interrupts_check_failure(const char *name,
 	stress_interrupts_t *counters, uint32_t instance, int *rc);
 extern void stress_interrupts_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern int stress_interrupts_per_cpu(const char *type, uint64_t *counts, const int32_t max_cpus);
+extern void stress_interrupts_irq_begin(void);
+extern void stress_interrupts_irq_end(const stress_stressor_t *stressors_list, const double duration);
+extern void stress_interrupts_irq_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_interrupts_irq_free(void);
 
 #endif
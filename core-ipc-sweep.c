@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-ipc-sweep.h"
+#include "core-killpid.h"
+#include "core-latency.h"
+
+#define IPC_SWEEP_MAX_SIZE	(1 * MB)
+#define IPC_SWEEP_ACK_SIZE	(8)
+
+#define IPC_SWEEP_MODE_STREAM	(0)
+#define IPC_SWEEP_MODE_PINGPONG	(1)
+
+#define IPC_SWEEP_DATA		('D')	/* streamed data message */
+#define IPC_SWEEP_END		('E')	/* last streamed message, child acks */
+
+static const size_t stress_ipc_sweep_sizes[] = {
+	8, 64, 512, 4 * KB, 32 * KB, 256 * KB, IPC_SWEEP_MAX_SIZE,
+};
+
+/* results of one message size and mode */
+typedef struct {
+	size_t size;			/* message size in bytes */
+	int mode;			/* stream or ping-pong */
+	stress_latency_t lat;		/* round trip latency */
+	uint64_t msgs;			/* messages transferred */
+	double bytes;			/* bytes transferred */
+	double duration;		/* time taken */
+	bool failed;
+} stress_ipc_sweep_result_t;
+
+/*
+ *  stress_ipc_sweep_send()
+ *	send len bytes in chunks of at most max_chunk,
+ *	returns 0 on success, -1 on error or when stopping
+ */
+static int stress_ipc_sweep_send(
+	const stress_ipc_transport_t *transport,
+	void *ctxt,
+	const int dir,
+	const uint8_t *buf,
+	const size_t len,
+	const size_t max_chunk)
+{
+	size_t sent = 0;
+
+	while (sent < len) {
+		const ssize_t n = transport->send(ctxt, dir, buf + sent,
+				STRESS_MINIMUM(len - sent, max_chunk));
+		if (n < 0) {
+			if ((errno == EINTR) && stress_continue_flag())
+				continue;
+			return -1;
+		}
+		sent += (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ipc_sweep_recv()
+ *	receive len bytes in chunks of at most max_chunk,
+ *	returns 0 on success, -1 on error or when stopping
+ */
+static int stress_ipc_sweep_recv(
+	const stress_ipc_transport_t *transport,
+	void *ctxt,
+	const int dir,
+	uint8_t *buf,
+	const size_t len,
+	const size_t max_chunk)
+{
+	size_t received = 0;
+
+	while (received < len) {
+		const ssize_t n = transport->recv(ctxt, dir, buf + received,
+				STRESS_MINIMUM(len - received, max_chunk));
+		if (n <= 0) {
+			if ((n < 0) && (errno == EINTR) && stress_continue_flag())
+				continue;
+			return -1;
+		}
+		received += (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ipc_sweep_size_str()
+ *	short human readable message size
+ */
+static void stress_ipc_sweep_size_str(char *str, const size_t len, const size_t size)
+{
+	if (size >= MB)
+		(void)snprintf(str, len, "%zuM", (size_t)(size / MB));
+	else if (size >= KB)
+		(void)snprintf(str, len, "%zuK", (size_t)(size / KB));
+	else
+		(void)snprintf(str, len, "%zuB", size);
+}
+
+/*
+ *  stress_ipc_sweep_child()
+ *	receive messages, echo them back in ping-pong mode and
+ *	acknowledge the last message in stream mode
+ */
+static void NORETURN stress_ipc_sweep_child(
+	const stress_ipc_transport_t *transport,
+	void *ctxt,
+	const stress_ipc_sweep_result_t *result,
+	uint8_t *buf,
+	const size_t max_chunk)
+{
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	for (;;) {
+		if (stress_ipc_sweep_recv(transport, ctxt, STRESS_IPC_TO_CHILD,
+				buf, result->size, max_chunk) < 0)
+			break;
+		if (result->mode == IPC_SWEEP_MODE_PINGPONG) {
+			if (stress_ipc_sweep_send(transport, ctxt, STRESS_IPC_TO_PARENT,
+					buf, result->size, max_chunk) < 0)
+				break;
+		} else if (buf[0] == IPC_SWEEP_END) {
+			if (stress_ipc_sweep_send(transport, ctxt, STRESS_IPC_TO_PARENT,
+					buf, IPC_SWEEP_ACK_SIZE, max_chunk) < 0)
+				break;
+		}
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_ipc_sweep_pass()
+ *	run one message size and mode against a forked child
+ *	for duration seconds, returns -1 on a failure
+ */
+static int stress_ipc_sweep_pass(
+	stress_args_t *args,
+	const stress_ipc_transport_t *transport,
+	void *ctxt,
+	stress_ipc_sweep_result_t *result,
+	uint8_t *buf,
+	const size_t max_chunk,
+	const double duration)
+{
+	const size_t size = result->size;
+	double t_start, t_end;
+	pid_t pid;
+	int rc = 0;
+
+	(void)shim_memset(buf, IPC_SWEEP_DATA, size);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (!stress_continue(args))
+			return 0;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	} else if (pid == 0) {
+		stress_ipc_sweep_child(transport, ctxt, result, buf, max_chunk);
+	}
+
+	t_start = stress_time_now();
+	t_end = t_start + duration;
+	if (result->mode == IPC_SWEEP_MODE_STREAM) {
+		uint64_t msgs = 0;
+		double t;
+
+		do {
+			if (stress_ipc_sweep_send(transport, ctxt, STRESS_IPC_TO_CHILD,
+					buf, size, max_chunk) < 0)
+				goto reap;
+			msgs++;
+			stress_bogo_inc(args);
+		} while ((stress_time_now() < t_end) && stress_continue(args));
+
+		/* the child acks the end marker once all the data is consumed */
+		buf[0] = IPC_SWEEP_END;
+		if (stress_ipc_sweep_send(transport, ctxt, STRESS_IPC_TO_CHILD,
+				buf, size, max_chunk) < 0)
+			goto reap;
+		if (stress_ipc_sweep_recv(transport, ctxt, STRESS_IPC_TO_PARENT,
+				buf, IPC_SWEEP_ACK_SIZE, max_chunk) < 0)
+			goto reap;
+		t = stress_time_now();
+		msgs++;
+		result->msgs += msgs;
+		result->bytes += (double)msgs * (double)size;
+		result->duration += t - t_start;
+	} else {
+		uint64_t rounds = 0;
+		double t = t_start;
+
+		do {
+			const uint8_t val = (uint8_t)rounds;
+			const double t_round = t;
+
+			buf[size - 1] = val;
+			if (stress_ipc_sweep_send(transport, ctxt, STRESS_IPC_TO_CHILD,
+					buf, size, max_chunk) < 0)
+				break;
+			buf[size - 1] = (uint8_t)~val;
+			if (stress_ipc_sweep_recv(transport, ctxt, STRESS_IPC_TO_PARENT,
+					buf, size, max_chunk) < 0)
+				break;
+			t = stress_time_now();
+			if (buf[size - 1] != val) {
+				pr_fail("%s: %s %zu byte ping-pong message corrupted, "
+					"got 0x%2.2x, expected 0x%2.2x\n",
+					args->name, transport->name, size, buf[size - 1], val);
+				rc = -1;
+				break;
+			}
+			stress_latency_add(&result->lat, (uint64_t)((t - t_round) * STRESS_DBL_NANOSECOND));
+			rounds++;
+			stress_bogo_inc(args);
+		} while ((t < t_end) && stress_continue(args));
+
+		result->msgs += rounds;
+		result->bytes += 2.0 * (double)rounds * (double)size;
+		result->duration += t - t_start;
+	}
+reap:
+	(void)stress_kill_pid_wait(pid, NULL);
+
+	return rc;
+}
+
+/*
+ *  stress_ipc_sweep()
+ *	sweep message sizes from 8 bytes to 1 MB in streaming and
+ *	ping-pong modes over an IPC transport and report throughput
+ *	and round trip latency in a table common to all transports
+ */
+int stress_ipc_sweep(stress_args_t *args, const stress_ipc_transport_t *transport, void *ctxt)
+{
+	const size_t n_results = 2 * SIZEOF_ARRAY(stress_ipc_sweep_sizes);
+	stress_ipc_sweep_result_t *results;
+	size_t max_chunk = IPC_SWEEP_MAX_SIZE, i, idx = 0, metric = 0;
+	uint8_t *buf;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	if (stress_sighandler(args->name, SIGPIPE, stress_sighandler_nop, NULL) < 0)
+		return EXIT_NO_RESOURCE;
+
+	results = (stress_ipc_sweep_result_t *)calloc(n_results, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < n_results; i++) {
+		results[i].size = stress_ipc_sweep_sizes[i / 2];
+		results[i].mode = (i & 1) ? IPC_SWEEP_MODE_PINGPONG : IPC_SWEEP_MODE_STREAM;
+	}
+
+	buf = (uint8_t *)mmap(NULL, IPC_SWEEP_MAX_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte message buffer, skipping stressor\n",
+			args->name, (size_t)IPC_SWEEP_MAX_SIZE);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	if (transport->open(args, ctxt, &max_chunk) < 0) {
+		(void)munmap((void *)buf, IPC_SWEEP_MAX_SIZE);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	max_chunk = STRESS_MAXIMUM(IPC_SWEEP_ACK_SIZE, STRESS_MINIMUM(max_chunk, IPC_SWEEP_MAX_SIZE));
+
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_ipc_sweep_result_t *result = &results[idx];
+
+		if (!result->failed &&
+		    (stress_ipc_sweep_pass(args, transport, ctxt, result, buf, max_chunk, slice) < 0)) {
+			result->failed = true;
+			rc = EXIT_FAILURE;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	transport->close(ctxt);
+	(void)munmap((void *)buf, IPC_SWEEP_MAX_SIZE);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %-9s %6s %10s %12s %10s %10s %10s\n", args->name,
+			"transport", "mode", "size", "MB/sec", "msgs/sec",
+			"rtt ns", "rtt p50", "rtt p99");
+	for (i = 0; i < n_results; i++) {
+		const stress_ipc_sweep_result_t *result = &results[i];
+		const double mb_rate = result->bytes / (result->duration * (double)MB);
+		char size_str[16], str[64];
+
+		if ((result->msgs == 0) || (result->duration <= 0.0))
+			continue;
+		stress_ipc_sweep_size_str(size_str, sizeof(size_str), result->size);
+		if (result->mode == IPC_SWEEP_MODE_STREAM) {
+			if (args->instance == 0)
+				pr_inf("%s: %-9s %-9s %6s %10.2f %12.0f %10s %10s %10s\n", args->name,
+					transport->name, "stream", size_str, mb_rate,
+					(double)result->msgs / result->duration, "-", "-", "-");
+			if (metric >= STRESS_STRESSOR_METRICS_MAX)
+				continue;
+			(void)snprintf(str, sizeof(str), "%s stream MB per sec", size_str);
+			stress_metrics_set(args, metric++, str, mb_rate, STRESS_HARMONIC_MEAN);
+		} else {
+			const double p50 = (double)stress_latency_percentile(&result->lat, 50.0);
+
+			if (args->instance == 0)
+				pr_inf("%s: %-9s %-9s %6s %10.2f %12.0f %10.0f %10.0f %10.0f\n", args->name,
+					transport->name, "ping-pong", size_str, mb_rate,
+					(double)result->msgs / result->duration,
+					STRESS_DBL_NANOSECOND * result->duration / (double)result->msgs,
+					p50, (double)stress_latency_percentile(&result->lat, 99.0));
+			if (metric >= STRESS_STRESSOR_METRICS_MAX)
+				continue;
+			(void)snprintf(str, sizeof(str), "%s ping-pong round trip p50 (ns)", size_str);
+			stress_metrics_set(args, metric++, str, p50, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	free(results);
+
+	return rc;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_IPC_SWEEP_H
+#define CORE_IPC_SWEEP_H
+
+#include "stress-ng.h"
+
+#define STRESS_IPC_TO_CHILD	(0)	/* parent to child direction */
+#define STRESS_IPC_TO_PARENT	(1)	/* child to parent direction */
+
+/*
+ *  IPC transport used by the message size sweep, a transport
+ *  provides a channel in each direction that a parent and a
+ *  forked child both inherit. send and recv return the number
+ *  of bytes transferred or -1 with errno set, message based
+ *  transports transfer at most the max_chunk set by open in
+ *  each call and receive whole messages.
+ */
+typedef struct {
+	const char *name;
+	int (*open)(stress_args_t *args, void *ctxt, size_t *max_chunk);
+	void (*close)(void *ctxt);
+	ssize_t (*send)(void *ctxt, const int dir, const void *buf, const size_t len);
+	ssize_t (*recv)(void *ctxt, const int dir, void *buf, const size_t len);
+} stress_ipc_transport_t;
+
+extern int stress_ipc_sweep(stress_args_t *args, const stress_ipc_transport_t *transport, void *ctxt);
+
+#endif
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-job.h"
+#include "core-profile.h"
 
 #define MAX_ARGS	(64)
 #define RUN_SEQUENTIAL	(0x01)
@@ -196,6 +197,26 @@ int stress_parse_jobfile(
 				continue;
 			}
 
+			/* Check for job load profile, declares the stressor too */
+			rc = stress_profile_parse(jobfile, new_argc, new_argv);
+			if (rc < 0) {
+				stress_parse_error(lineno, txt);
+				goto err;
+			} else if (rc == 1) {
+				char opt[80], instances[16];
+
+				(void)snprintf(opt, sizeof(opt), "--%s", stress_profile_stressor());
+				(void)snprintf(instances, sizeof(instances), "%" PRId32,
+					stress_profile_instances_max());
+				new_argv[1] = opt;
+				new_argv[2] = instances;
+				if (stress_parse_opts(3, new_argv, true) != EXIT_SUCCESS) {
+					stress_parse_error(lineno, txt);
+					goto err;
+				}
+				continue;
+			}
+
 			tmp = malloc(len);
 			if (!tmp) {
 				(void)fprintf(stderr, "Out of memory parsing '%s'\n", jobfile);
@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-jsonl.h"
+
+#include <stdarg.h>
+
+#define JSONL_RECORD_MAX	(64 * KB)
+
+/* JSON record being built, written out with one write */
+typedef struct {
+	char *buf;			/* record buffer */
+	size_t len;			/* length of record */
+	bool overflow;			/* true if record did not fit */
+} stress_jsonl_rec_t;
+
+/* per stressor counter at previous sample for --jsonl sample rates */
+typedef struct {
+	double time;			/* time of previous sample */
+	uint64_t counter;		/* sum of instance counters */
+} stress_jsonl_prev_t;
+
+static int jsonl_fd = -1;
+static stress_jsonl_prev_t *jsonl_prev;	/* sampler process only */
+
+/*
+ *  stress_jsonl_add()
+ *	append formatted text to a record
+ */
+static void FORMAT(printf, 2, 3) stress_jsonl_add(stress_jsonl_rec_t *rec, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (rec->overflow)
+		return;
+
+	va_start(ap, fmt);
+	n = vsnprintf(rec->buf + rec->len, JSONL_RECORD_MAX - rec->len, fmt, ap);
+	va_end(ap);
+
+	if ((n < 0) || ((size_t)n >= JSONL_RECORD_MAX - rec->len))
+		rec->overflow = true;
+	else
+		rec->len += (size_t)n;
+}
+
+/*
+ *  stress_jsonl_add_str()
+ *	append a JSON string value to a record
+ */
+static void stress_jsonl_add_str(stress_jsonl_rec_t *rec, const char *str)
+{
+	const char *s;
+
+	stress_jsonl_add(rec, "\"");
+	for (s = str; *s; s++) {
+		if ((*s == '"') || (*s == '\\'))
+			stress_jsonl_add(rec, "\\%c", *s);
+		else if ((unsigned char)*s < ' ')
+			stress_jsonl_add(rec, "\\u%4.4x", (unsigned int)(unsigned char)*s);
+		else
+			stress_jsonl_add(rec, "%c", *s);
+	}
+	stress_jsonl_add(rec, "\"");
+}
+
+/*
+ *  stress_jsonl_add_double()
+ *	append a JSON number, JSON has no inf or nan so map these to null
+ */
+static void stress_jsonl_add_double(stress_jsonl_rec_t *rec, const double value)
+{
+	if (isfinite(value))
+		stress_jsonl_add(rec, "%f", value);
+	else
+		stress_jsonl_add(rec, "null");
+}
+
+/*
+ *  stress_jsonl_begin()
+ *	start a record of a given type
+ */
+static bool stress_jsonl_begin(stress_jsonl_rec_t *rec, const char *type)
+{
+	rec->len = 0;
+	rec->overflow = false;
+	rec->buf = (char *)malloc(JSONL_RECORD_MAX);
+	if (!rec->buf)
+		return false;
+	stress_jsonl_add(rec, "{\"record\":\"%s\",\"time\":", type);
+	stress_jsonl_add_double(rec, (g_shared->time_started > 0.0) ?
+		stress_time_now() - g_shared->time_started : 0.0);
+	return true;
+}
+
+/*
+ *  stress_jsonl_end()
+ *	end the record and append it to the file, records are written
+ *	with a single write to an O_APPEND file so records written by
+ *	different processes do not interleave
+ */
+static void stress_jsonl_end(stress_jsonl_rec_t *rec)
+{
+	stress_jsonl_add(rec, "}\n");
+	if (rec->overflow) {
+		pr_dbg("jsonl: record too large, not written\n");
+	} else if (write(jsonl_fd, rec->buf, rec->len) != (ssize_t)rec->len) {
+		pr_dbg("jsonl: write failed, errno=%d (%s)\n", errno, strerror(errno));
+	}
+	free(rec->buf);
+	rec->buf = NULL;
+}
+
+/*
+ *  stress_jsonl_open()
+ *	open the --jsonl file for appending and write a start record
+ */
+void stress_jsonl_open(void)
+{
+	stress_jsonl_rec_t rec;
+	char *filename = NULL;
+
+	if (!stress_get_setting("jsonl", &filename) || !filename)
+		return;
+
+	jsonl_fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0666);
+	if (jsonl_fd < 0) {
+		pr_err("Cannot output JSON lines data to %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return;
+	}
+	if (!stress_jsonl_begin(&rec, "start"))
+		return;
+	stress_jsonl_add(&rec, ",\"stress-ng-version\":\"" VERSION "\",\"pid\":%d,\"epoch\":%" PRIu64,
+		(int)getpid(), (uint64_t)time(NULL));
+	stress_jsonl_end(&rec);
+}
+
+/*
+ *  stress_jsonl_close()
+ *	write an end of run record and close the --jsonl file
+ */
+void stress_jsonl_close(const double duration)
+{
+	stress_jsonl_rec_t rec;
+
+	if (jsonl_fd < 0)
+		return;
+	if (stress_jsonl_begin(&rec, "end")) {
+		stress_jsonl_add(&rec, ",\"run-time\":");
+		stress_jsonl_add_double(&rec, duration);
+		stress_jsonl_end(&rec);
+	}
+	(void)close(jsonl_fd);
+	jsonl_fd = -1;
+}
+
+/*
+ *  stress_jsonl_instance()
+ *	write a record for a completed stressor instance with the same
+ *	fields as the YAML metrics, called by the instance on completion
+ */
+void stress_jsonl_instance(const stress_stressor_t *ss, const int32_t instance)
+{
+	const stress_stats_t *stats;
+	stress_jsonl_rec_t rec;
+	char name[64];
+	double cpu_time;
+	size_t i;
+	bool first = true;
+
+	if ((jsonl_fd < 0) || (instance < 0) || (instance >= ss->num_instances))
+		return;
+	stats = ss->stats[instance];
+	if (!stress_jsonl_begin(&rec, "instance"))
+		return;
+
+	(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+	cpu_time = stats->rusage_utime + stats->rusage_stime;
+	stress_jsonl_add(&rec, ",\"stressor\":");
+	stress_jsonl_add_str(&rec, name);
+	stress_jsonl_add(&rec, ",\"instance\":%" PRId32 ",\"pid\":%d,\"completed\":%s,\"run-ok\":%s",
+		instance, (int)getpid(), stats->completed ? "true" : "false",
+		stats->args.ci.run_ok ? "true" : "false");
+	stress_jsonl_add(&rec, ",\"bogo-ops\":%" PRIu64, stats->args.ci.counter);
+	stress_jsonl_add(&rec, ",\"bogo-ops-per-second-usr-sys-time\":");
+	stress_jsonl_add_double(&rec, cpu_time > 0.0 ? (double)stats->args.ci.counter / cpu_time : 0.0);
+	stress_jsonl_add(&rec, ",\"bogo-ops-per-second-real-time\":");
+	stress_jsonl_add_double(&rec, stats->duration > 0.0 ? (double)stats->args.ci.counter / stats->duration : 0.0);
+	stress_jsonl_add(&rec, ",\"wall-clock-time\":");
+	stress_jsonl_add_double(&rec, stats->duration);
+	stress_jsonl_add(&rec, ",\"user-time\":");
+	stress_jsonl_add_double(&rec, stats->rusage_utime);
+	stress_jsonl_add(&rec, ",\"system-time\":");
+	stress_jsonl_add_double(&rec, stats->rusage_stime);
+	stress_jsonl_add(&rec, ",\"cpu-usage\":");
+	stress_jsonl_add_double(&rec, stats->duration > 0.0 ? 100.0 * cpu_time / stats->duration : 0.0);
+	stress_jsonl_add(&rec, ",\"max-rss\":%ld", stats->rusage_maxrss);
+	stress_jsonl_add(&rec, ",\"spawn-latency\":");
+	stress_jsonl_add_double(&rec, stats->spawn_latency);
+
+	stress_jsonl_add(&rec, ",\"metrics\":{");
+	for (i = 0; i < STRESS_MISC_METRICS_MAX; i++) {
+		const stress_metrics_item_t *item = &stats->metrics.items[i];
+
+		if (!item->description)
+			continue;
+		stress_jsonl_add(&rec, "%s", first ? "" : ",");
+		stress_jsonl_add_str(&rec, stress_description_yamlify(item->description));
+		stress_jsonl_add(&rec, ":");
+		stress_jsonl_add_double(&rec, item->value);
+		first = false;
+	}
+	stress_jsonl_add(&rec, "}");
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if ((g_opt_flags & OPT_FLAGS_PERF_STATS) && stress_perf_stat_succeeded(&stats->sp)) {
+		char event[64];
+
+		first = true;
+		stress_jsonl_add(&rec, ",\"perf\":{");
+		for (i = 0; stress_perf_event_name(i, event, sizeof(event)); i++) {
+			if (stats->sp.perf_stat[i].counter == STRESS_PERF_INVALID)
+				continue;
+			stress_jsonl_add(&rec, "%s\"%s\":%" PRIu64, first ? "" : ",",
+				event, stats->sp.perf_stat[i].counter);
+			first = false;
+		}
+		stress_jsonl_add(&rec, "}");
+	}
+#endif
+	stress_jsonl_end(&rec);
+}
+
+/*
+ *  stress_jsonl_sample()
+ *	write a record of the bogo-op counters of each stressor,
+ *	called by the sampler process every sample interval
+ */
+void stress_jsonl_sample(const stress_stressor_t *stressors_list, const double now)
+{
+	const stress_stressor_t *ss;
+	size_t k;
+
+	if (jsonl_fd < 0)
+		return;
+
+	if (!jsonl_prev) {
+		size_t n = 0;
+
+		for (ss = stressors_list; ss; ss = ss->next)
+			n++;
+		jsonl_prev = (stress_jsonl_prev_t *)calloc(n, sizeof(*jsonl_prev));
+		if (!jsonl_prev)
+			return;
+	}
+
+	for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+		stress_jsonl_rec_t rec;
+		uint64_t counter = 0;
+		uint32_t running = 0;
+		int32_t j;
+		char name[64];
+		double rate = 0.0;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+
+			counter += stats->args.ci.counter;
+			if ((stats->pid > 0) && (stats->start > 0.0) && !stats->completed)
+				running++;
+		}
+		if ((jsonl_prev[k].time > 0.0) && (now > jsonl_prev[k].time))
+			rate = (double)(counter - jsonl_prev[k].counter) / (now - jsonl_prev[k].time);
+		jsonl_prev[k].time = now;
+		jsonl_prev[k].counter = counter;
+
+		/* Nothing to report before a stressor starts */
+		if ((counter == 0) && (running == 0))
+			continue;
+
+		if (!stress_jsonl_begin(&rec, "sample"))
+			return;
+		(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+		stress_jsonl_add(&rec, ",\"stressor\":");
+		stress_jsonl_add_str(&rec, name);
+		stress_jsonl_add(&rec, ",\"instances\":%" PRId32 ",\"running\":%" PRIu32
+			",\"bogo-ops\":%" PRIu64 ",\"bogo-ops-per-second\":",
+			ss->num_instances, running, counter);
+		stress_jsonl_add_double(&rec, rate);
+		stress_jsonl_add(&rec, ",\"instance-bogo-ops\":[");
+		for (j = 0; j < ss->num_instances; j++)
+			stress_jsonl_add(&rec, "%s%" PRIu64, j ? "," : "", ss->stats[j]->args.ci.counter);
+		stress_jsonl_add(&rec, "]");
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+		if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+			uint64_t totals[STRESS_PERF_MAX], counters[STRESS_PERF_MAX];
+			char event[64];
+			bool sampled = false;
+			size_t i;
+
+			(void)shim_memset(totals, 0, sizeof(totals));
+			for (j = 0; j < ss->num_instances; j++) {
+				if (!stress_perf_sample_last((int32_t)(ss->stats[j] - g_shared->stats), counters))
+					continue;
+				for (i = 0; i < STRESS_PERF_MAX; i++) {
+					if ((counters[i] == STRESS_PERF_INVALID) ||
+					    (totals[i] == STRESS_PERF_INVALID))
+						totals[i] = STRESS_PERF_INVALID;
+					else
+						totals[i] += counters[i];
+				}
+				sampled = true;
+			}
+			if (sampled) {
+				bool first = true;
+
+				stress_jsonl_add(&rec, ",\"perf\":{");
+				for (i = 0; stress_perf_event_name(i, event, sizeof(event)); i++) {
+					if (totals[i] == STRESS_PERF_INVALID)
+						continue;
+					stress_jsonl_add(&rec, "%s\"%s\":%" PRIu64, first ? "" : ",",
+						event, totals[i]);
+					first = false;
+				}
+				stress_jsonl_add(&rec, "}");
+			}
+		}
+#endif
+		stress_jsonl_end(&rec);
+	}
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_JSONL_H
+#define CORE_JSONL_H
+
+#include "stress-ng.h"
+
+extern void stress_jsonl_open(void);
+extern void stress_jsonl_close(const double duration);
+extern void stress_jsonl_instance(const stress_stressor_t *ss, const int32_t instance);
+extern void stress_jsonl_sample(const stress_stressor_t *stressors_list, const double now);
+
+#endif
@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-killpid.h"
+#include "core-ksm.h"
+
+#define STRESS_KSM_PATH		"/sys/kernel/mm/ksm"
+#define STRESS_KSM_INTERVAL	(0.25)	/* --ksm sample interval, secs */
+
+/* ksm counters and ksmd CPU time */
+typedef struct {
+	uint64_t pages_shared;		/* KSM pages in use */
+	uint64_t pages_sharing;		/* pages mapped to KSM pages, i.e. saved */
+	uint64_t pages_scanned;		/* pages scanned by ksmd */
+	uint64_t full_scans;		/* full scans of mergeable areas */
+	uint64_t ksmd_ticks;		/* ksmd user + system clock ticks */
+	double t;			/* time of snapshot */
+} stress_ksm_snapshot_t;
+
+/* --ksm interval samples, shared with the sampling process */
+typedef struct {
+	uint64_t samples;		/* number of interval samples */
+	uint64_t pages_shared_max;	/* peak pages_shared */
+	uint64_t pages_sharing_max;	/* peak pages_sharing */
+	uint64_t pages_merged;		/* sum of pages_sharing increases */
+} stress_ksm_samples_t;
+
+static stress_ksm_snapshot_t ksm_start;	/* counters at start of run */
+static stress_ksm_snapshot_t ksm_end;	/* counters at end of run */
+static stress_ksm_samples_t *ksm_samples; /* shared interval samples */
+static pid_t ksm_sampler_pid = -1;	/* --ksm sampling process */
+static pid_t ksmd_pid = -1;		/* ksmd kernel thread */
+static bool ksm_valid;			/* ksm counters readable */
+
+/*
+ *  stress_ksm_read()
+ *	read a ksm sysfs counter, 0 if not readable
+ */
+static uint64_t stress_ksm_read(const char *name)
+{
+	char path[PATH_MAX], buf[64];
+	uint64_t val = 0;
+
+	(void)snprintf(path, sizeof(path), "%s/%s", STRESS_KSM_PATH, name);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return 0;
+	if (sscanf(buf, "%" SCNu64, &val) != 1)
+		return 0;
+	return val;
+}
+
+/*
+ *  stress_ksm_find_ksmd()
+ *	find the pid of the ksmd kernel thread, -1 if not found
+ */
+static pid_t stress_ksm_find_ksmd(void)
+{
+	DIR *dir;
+	const struct dirent *d;
+	pid_t pid = -1;
+
+	dir = opendir("/proc");
+	if (!dir)
+		return -1;
+	while ((d = readdir(dir)) != NULL) {
+		char path[PATH_MAX], comm[32];
+
+		if (!isdigit((unsigned char)d->d_name[0]))
+			continue;
+		(void)snprintf(path, sizeof(path), "/proc/%s/comm", d->d_name);
+		if (stress_system_read(path, comm, sizeof(comm)) <= 0)
+			continue;
+		if (!strncmp(comm, "ksmd", 4) && ((comm[4] == '\n') || (comm[4] == '\0'))) {
+			pid = (pid_t)atoi(d->d_name);
+			break;
+		}
+	}
+	(void)closedir(dir);
+	return pid;
+}
+
+/*
+ *  stress_ksm_ksmd_ticks()
+ *	ksmd user and system time in clock ticks, fields 14 and 15
+ *	of /proc/pid/stat, parsed after the comm field
+ */
+static uint64_t stress_ksm_ksmd_ticks(void)
+{
+	char path[PATH_MAX], buf[1024];
+	const char *ptr;
+	unsigned long int utime, stime;
+
+	if (ksmd_pid < 0)
+		return 0;
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)ksmd_pid);
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return 0;
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return 0;
+	/* skip state, ppid, pgrp, session, tty_nr, tpgid, flags, minflt, cminflt, majflt, cmajflt */
+	if (sscanf(ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+		   &utime, &stime) != 2)
+		return 0;
+	return (uint64_t)utime + (uint64_t)stime;
+}
+
+/*
+ *  stress_ksm_snapshot()
+ *	snapshot the ksm counters and ksmd CPU time
+ */
+static void stress_ksm_snapshot(stress_ksm_snapshot_t *snapshot)
+{
+	snapshot->pages_shared = stress_ksm_read("pages_shared");
+	snapshot->pages_sharing = stress_ksm_read("pages_sharing");
+	snapshot->pages_scanned = stress_ksm_read("pages_scanned");
+	snapshot->full_scans = stress_ksm_read("full_scans");
+	snapshot->ksmd_ticks = stress_ksm_ksmd_ticks();
+	snapshot->t = stress_time_now();
+}
+
+/*
+ *  stress_ksm_stats_start()
+ *	snapshot the ksm counters and start a process that samples
+ *	the ksm page sharing every interval for --ksm runs
+ */
+void stress_ksm_stats_start(void)
+{
+	uint64_t prev_sharing;
+	double t;
+
+	if (!(g_opt_flags & OPT_FLAGS_KSM))
+		return;
+
+	ksm_valid = (access(STRESS_KSM_PATH "/pages_sharing", R_OK) == 0);
+	if (!ksm_valid) {
+		pr_inf("ksm: cannot read %s, KSM statistics not available\n", STRESS_KSM_PATH);
+		return;
+	}
+	ksmd_pid = stress_ksm_find_ksmd();
+	stress_ksm_snapshot(&ksm_start);
+
+	ksm_samples = (stress_ksm_samples_t *)stress_mmap_populate(NULL,
+		sizeof(*ksm_samples), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ksm_samples == MAP_FAILED) {
+		pr_inf("ksm: cannot mmap %zu bytes for ksm samples, "
+			"reporting run totals only\n", sizeof(*ksm_samples));
+		ksm_samples = NULL;
+		return;
+	}
+	stress_set_vma_anon_name(ksm_samples, sizeof(*ksm_samples), "ksm-samples");
+	ksm_samples->pages_shared_max = ksm_start.pages_shared;
+	ksm_samples->pages_sharing_max = ksm_start.pages_sharing;
+
+	ksm_sampler_pid = fork();
+	if ((ksm_sampler_pid < 0) || (ksm_sampler_pid > 0))
+		return;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [ksm]");
+
+	t = stress_time_now();
+	prev_sharing = ksm_start.pages_sharing;
+	while (stress_continue_flag()) {
+		uint64_t shared, sharing;
+		double delta;
+
+		t += STRESS_KSM_INTERVAL;
+		delta = t - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+
+		shared = stress_ksm_read("pages_shared");
+		sharing = stress_ksm_read("pages_sharing");
+		ksm_samples->samples++;
+		ksm_samples->pages_shared_max = STRESS_MAXIMUM(ksm_samples->pages_shared_max, shared);
+		ksm_samples->pages_sharing_max = STRESS_MAXIMUM(ksm_samples->pages_sharing_max, sharing);
+		if (sharing > prev_sharing)
+			ksm_samples->pages_merged += sharing - prev_sharing;
+		prev_sharing = sharing;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_ksm_stats_stop()
+ *	stop the ksm sampling process and snapshot the end counters
+ */
+void stress_ksm_stats_stop(void)
+{
+	if (!ksm_valid)
+		return;
+	if (ksm_sampler_pid > 0) {
+		(void)stress_kill_pid_wait(ksm_sampler_pid, NULL);
+		ksm_sampler_pid = -1;
+	}
+	stress_ksm_snapshot(&ksm_end);
+}
+
+/*
+ *  stress_ksm_stats_dump()
+ *	report the pages merged per second, memory saved at the
+ *	peak of page sharing and the ksmd CPU cost per GB merged
+ */
+void stress_ksm_stats_dump(FILE *yaml)
+{
+	const double page_size = (double)stress_get_page_size();
+	const int32_t ticks = stress_get_ticks_per_second();
+	uint64_t merged, sharing_max, shared_max;
+	double duration, merged_gb, saved_bytes, ksmd_secs = -1.0;
+
+	if (!ksm_valid)
+		return;
+
+	duration = ksm_end.t - ksm_start.t;
+	sharing_max = STRESS_MAXIMUM(ksm_start.pages_sharing, ksm_end.pages_sharing);
+	shared_max = STRESS_MAXIMUM(ksm_start.pages_shared, ksm_end.pages_shared);
+	merged = (ksm_end.pages_sharing > ksm_start.pages_sharing) ?
+		ksm_end.pages_sharing - ksm_start.pages_sharing : 0;
+	if (ksm_samples) {
+		sharing_max = STRESS_MAXIMUM(sharing_max, ksm_samples->pages_sharing_max);
+		shared_max = STRESS_MAXIMUM(shared_max, ksm_samples->pages_shared_max);
+		merged = STRESS_MAXIMUM(merged, ksm_samples->pages_merged);
+		(void)munmap((void *)ksm_samples, sizeof(*ksm_samples));
+		ksm_samples = NULL;
+	}
+	merged_gb = (double)merged * page_size / (double)GB;
+	saved_bytes = (sharing_max > ksm_start.pages_sharing) ?
+		(double)(sharing_max - ksm_start.pages_sharing) * page_size : 0.0;
+	if ((ksmd_pid > 0) && (ticks > 0))
+		ksmd_secs = (double)(ksm_end.ksmd_ticks - ksm_start.ksmd_ticks) / (double)ticks;
+
+	pr_inf("ksm:\n");
+	pr_inf("  pages merged:      %" PRIu64 " (%.2f per sec)\n", merged,
+		duration > 0.0 ? (double)merged / duration : 0.0);
+	pr_inf("  memory saved:      %.2f MB at peak, %" PRIu64 " pages shared, %" PRIu64 " pages sharing\n",
+		saved_bytes / (double)MB, shared_max, sharing_max);
+	pr_inf("  pages scanned:     %" PRIu64 " in %" PRIu64 " full scans\n",
+		ksm_end.pages_scanned - ksm_start.pages_scanned,
+		ksm_end.full_scans - ksm_start.full_scans);
+	if (ksmd_secs >= 0.0) {
+		if (merged_gb > 0.0)
+			pr_inf("  ksmd CPU time:     %.2f secs (%.2f%% of a CPU), %.2f secs per GB merged\n",
+				ksmd_secs, duration > 0.0 ? 100.0 * ksmd_secs / duration : 0.0,
+				ksmd_secs / merged_gb);
+		else
+			pr_inf("  ksmd CPU time:     %.2f secs (%.2f%% of a CPU), no pages merged\n",
+				ksmd_secs, duration > 0.0 ? 100.0 * ksmd_secs / duration : 0.0);
+	} else {
+		pr_inf("  ksmd CPU time:     n/a, cannot find ksmd\n");
+	}
+
+	pr_yaml(yaml, "ksm:\n");
+	pr_yaml(yaml, "    pages-merged: %" PRIu64 "\n", merged);
+	pr_yaml(yaml, "    pages-merged-per-sec: %f\n",
+		duration > 0.0 ? (double)merged / duration : 0.0);
+	pr_yaml(yaml, "    pages-shared-max: %" PRIu64 "\n", shared_max);
+	pr_yaml(yaml, "    pages-sharing-max: %" PRIu64 "\n", sharing_max);
+	pr_yaml(yaml, "    memory-saved-bytes: %.0f\n", saved_bytes);
+	pr_yaml(yaml, "    pages-scanned: %" PRIu64 "\n", ksm_end.pages_scanned - ksm_start.pages_scanned);
+	pr_yaml(yaml, "    full-scans: %" PRIu64 "\n", ksm_end.full_scans - ksm_start.full_scans);
+	if (ksmd_secs >= 0.0) {
+		pr_yaml(yaml, "    ksmd-cpu-secs: %f\n", ksmd_secs);
+		if (merged_gb > 0.0)
+			pr_yaml(yaml, "    ksmd-cpu-secs-per-gb-merged: %f\n", ksmd_secs / merged_gb);
+	}
+	pr_yaml(yaml, "\n");
+	ksm_valid = false;
+}
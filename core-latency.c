@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-latency.h"
+
+typedef struct {
+	const double percentile;	/* percentile to report */
+	char *description;		/* metrics description */
+} stress_latency_metric_t;
+
+/*
+ *  Merged latency metrics, these use the top few misc
+ *  metrics slots to keep clear of the stressor metrics
+ */
+static const stress_latency_metric_t latency_metrics[STRESS_LATENCY_METRICS] = {
+	{ 50.0,		"nanosecs latency p50" },
+	{ 90.0,		"nanosecs latency p90" },
+	{ 99.0,		"nanosecs latency p99" },
+	{ 99.9,		"nanosecs latency p99.9" },
+	{ 100.0,	"nanosecs latency max" },
+};
+
+/*
+ *  stress_latency_merge()
+ *	add the latencies of histogram src to histogram dst
+ */
+void stress_latency_merge(stress_latency_t *dst, const stress_latency_t *src)
+{
+	size_t i;
+
+	if (src->count == 0)
+		return;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++)
+		dst->bucket[i] += src->bucket[i];
+	if ((dst->count == 0) || (src->min < dst->min))
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->sum += src->sum;
+	dst->count += src->count;
+}
+
+/*
+ *  stress_latency_bucket_max()
+ *	highest latency that maps to bucket idx
+ */
+static uint64_t stress_latency_bucket_max(const size_t idx)
+{
+	uint32_t shift;
+	uint64_t lo;
+
+	if (idx < STRESS_LATENCY_SUB_BUCKETS)
+		return (uint64_t)idx;
+
+	shift = (uint32_t)(idx >> STRESS_LATENCY_SUB_BITS) - 1;
+	lo = (uint64_t)(STRESS_LATENCY_SUB_BUCKETS + (idx & (STRESS_LATENCY_SUB_BUCKETS - 1))) << shift;
+
+	return lo + ((1ULL << shift) - 1);
+}
+
+/*
+ *  stress_latency_percentile()
+ *	return the latency in nanoseconds at a given percentile,
+ *	this is the highest value of the bucket the percentile
+ *	falls in, clamped to the observed minimum and maximum
+ */
+uint64_t stress_latency_percentile(const stress_latency_t *latency, const double percentile)
+{
+	uint64_t target, total = 0;
+	size_t i;
+
+	if (latency->count == 0)
+		return 0;
+	if (percentile >= 100.0)
+		return latency->max;
+
+	target = (uint64_t)ceil(((double)latency->count * percentile) / 100.0);
+	if (target < 1)
+		target = 1;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++) {
+		total += latency->bucket[i];
+		if (total >= target) {
+			const uint64_t ns = stress_latency_bucket_max(i);
+
+			if (ns < latency->min)
+				return latency->min;
+			return (ns > latency->max) ? latency->max : ns;
+		}
+	}
+	return latency->max;
+}
+
+/*
+ *  stress_latency_mode()
+ *	return the latency in nanoseconds of the most populated
+ *	bucket, clamped to the observed minimum and maximum
+ */
+uint64_t stress_latency_mode(const stress_latency_t *latency)
+{
+	uint64_t best = 0, ns;
+	size_t i, best_i = 0;
+
+	if (latency->count == 0)
+		return 0;
+
+	for (i = 0; i < STRESS_LATENCY_BUCKETS; i++) {
+		if (latency->bucket[i] > best) {
+			best = latency->bucket[i];
+			best_i = i;
+		}
+	}
+	ns = stress_latency_bucket_max(best_i);
+	if (ns < latency->min)
+		return latency->min;
+	return (ns > latency->max) ? latency->max : ns;
+}
+
+/*
+ *  stress_latency_metrics()
+ *	merge the latency histograms of all the instances of
+ *	a stressor and set the merged percentiles as metrics
+ *	of each completed instance
+ */
+void stress_latency_metrics(stress_stressor_t *ss)
+{
+	stress_latency_t *merged;
+	int32_t j;
+	size_t i;
+
+	if (!ss->stats)
+		return;
+
+	merged = (stress_latency_t *)calloc(1, sizeof(*merged));
+	if (!merged)
+		return;
+
+	for (j = 0; j < ss->num_instances; j++)
+		stress_latency_merge(merged, &ss->stats[j]->latency);
+
+	if (merged->count == 0) {
+		free(merged);
+		return;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(latency_metrics); i++) {
+		const size_t idx = STRESS_MISC_METRICS_MAX - SIZEOF_ARRAY(latency_metrics) + i;
+		const double ns = (double)stress_latency_percentile(merged, latency_metrics[i].percentile);
+
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			if (stats->completed)
+				stress_metrics_set(&stats->args, idx, latency_metrics[i].description,
+					ns, STRESS_MERGED_VALUE);
+		}
+	}
+	free(merged);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_LATENCY_H
+#define CORE_LATENCY_H
+
+/*
+ *  stress_latency_index()
+ *	map a latency in nanoseconds to a histogram bucket index
+ */
+static inline size_t ALWAYS_INLINE stress_latency_index(const uint64_t ns)
+{
+	register uint32_t msb;
+	register size_t idx;
+
+	if (ns < STRESS_LATENCY_SUB_BUCKETS)
+		return (size_t)ns;
+
+#if defined(HAVE_BUILTIN_CLZLL)
+	msb = (uint32_t)(63 - __builtin_clzll(ns));
+#else
+	{
+		register uint64_t n = ns;
+
+		for (msb = 0; n > 1; msb++)
+			n >>= 1;
+	}
+#endif
+	idx = ((size_t)(msb - STRESS_LATENCY_SUB_BITS) << STRESS_LATENCY_SUB_BITS) +
+	      (size_t)(ns >> (msb - STRESS_LATENCY_SUB_BITS));
+
+	return (idx < STRESS_LATENCY_BUCKETS) ? idx : STRESS_LATENCY_BUCKETS - 1;
+}
+
+/*
+ *  stress_latency_add()
+ *	record a latency in nanoseconds, cheap enough to be
+ *	called from a stressor's inner loop, use args->latency
+ *	to record into the instance's histogram
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_latency_add(
+	stress_latency_t *latency,
+	const uint64_t ns)
+{
+	if (UNLIKELY(!latency))
+		return;
+
+	latency->bucket[stress_latency_index(ns)]++;
+	if ((latency->count == 0) || (ns < latency->min))
+		latency->min = ns;
+	if (ns > latency->max)
+		latency->max = ns;
+	latency->sum += (double)ns;
+	latency->count++;
+}
+
+extern void stress_latency_merge(stress_latency_t *dst, const stress_latency_t *src);
+extern uint64_t stress_latency_percentile(const stress_latency_t *latency, const double percentile);
+extern uint64_t stress_latency_mode(const stress_latency_t *latency);
+extern void stress_latency_metrics(stress_stressor_t *ss);
+
+#endif
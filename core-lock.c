@@ -85,13 +85,59 @@
 #define LOCK_METHOD_SEM_SYSV		(0)
 #endif
 
+#if defined(HAVE_LINUX_FUTEX_H) &&	\
+    defined(__NR_futex) &&		\
+    defined(HAVE_SYSCALL)
+#define LOCK_METHOD_TICKET_FUTEX	(0x0040)
+#else
+#define LOCK_METHOD_TICKET_FUTEX	(0)
+#endif
+
 #define LOCK_METHOD_ALL			\
 	(LOCK_METHOD_ATOMIC_SPINLOCK |	\
 	 LOCK_METHOD_PTHREAD_SPINLOCK | \
 	 LOCK_METHOD_PTHREAD_MUTEX |	\
 	 LOCK_METHOD_FUTEX |		\
 	 LOCK_METHOD_SEM_POSIX | 	\
-	 LOCK_METHOD_SEM_SYSV)
+	 LOCK_METHOD_SEM_SYSV |		\
+	 LOCK_METHOD_TICKET_FUTEX)
+
+/*
+ *  The ticket futex lock is used instead of the default spinning
+ *  lock when there are more instances than this or more instances
+ *  than CPUs, spinning collapses when lock holders get preempted
+ */
+#define STRESS_LOCK_QUEUED_INSTANCES	(64)
+
+#define STRESS_LOCK_TICKET_SLOTS	(64)	/* futexes waiters sleep on */
+#define STRESS_LOCK_TICKET_PIDS		(1024)	/* ticket holder pids */
+#define STRESS_LOCK_TICKET_SPINS	(256)	/* spins before sleeping */
+#define STRESS_LOCK_TICKET_SLEEP_NS	(10000000)	/* 10 ms sleeps */
+#define STRESS_LOCK_TICKET_STALLS	(10)	/* sleeps before dead holder check */
+
+/* waits longer than this are accounted as contended */
+#define STRESS_LOCK_CONTENDED_SECS	(0.000001)
+
+#if LOCK_METHOD_TICKET_FUTEX != 0
+/* futex that ticket waiters sleep on, one per cache line */
+typedef struct {
+	uint32_t futex ALIGNED(64);
+} stress_lock_ticket_slot_t;
+
+/* process that took a ticket */
+typedef struct {
+	uint32_t ticket;
+	pid_t pid;		/* 0 if ticket abandoned */
+} stress_lock_ticket_pid_t;
+
+typedef struct {
+	uint32_t next ALIGNED(64);	/* next ticket to take */
+	uint32_t owner ALIGNED(64);	/* ticket holding the lock */
+	uint32_t sleepers;		/* waiters sleeping on slots */
+	stress_lock_ticket_slot_t slot[STRESS_LOCK_TICKET_SLOTS];
+	stress_lock_ticket_pid_t pid[STRESS_LOCK_TICKET_PIDS];
+} stress_lock_ticket_t;
+#endif
 
 typedef struct stress_lock {
 	uint32_t	magic;		/* Lock magic struct pattern */
@@ -115,8 +161,20 @@ typedef struct stress_lock {
 #endif
 #if LOCK_METHOD_SEM_SYSV != 0
 		int 	sem_id;		/* SYS V semaphore */
+#endif
+#if LOCK_METHOD_TICKET_FUTEX != 0
+		stress_lock_ticket_t ticket;	/* ticket futex lock */
 #endif
 	} u;
+	const char	*name;		/* lock name for debug */
+	bool		stats;		/* gather hold and wait stats */
+	uint64_t	acquires;	/* number of acquires */
+	uint64_t	contended;	/* acquires that had to wait */
+	double		t_acquired;	/* time of last acquire */
+	double		wait_total;	/* total time waiting to acquire */
+	double		wait_max;	/* longest wait to acquire */
+	double		hold_total;	/* total time lock held */
+	double		hold_max;	/* longest time lock held */
 	int (*init)(struct stress_lock *lock);
 	int (*deinit)(struct stress_lock *lock);
 	int (*acquire)(struct stress_lock *lock);
@@ -380,6 +438,138 @@ static int stress_sem_sysv_release(stress_lock_t *lock)
 }
 #endif
 
+#if LOCK_METHOD_TICKET_FUTEX != 0
+/*
+ *  Locking via tickets, waiters spin briefly and then sleep on one
+ *  of a set of futexes picked by ticket so a release only wakes the
+ *  waiters of the next ticket rather than all of them. Tickets of dead
+ *  or abandoning waiters are skipped so they cannot stall the queue.
+ */
+static int stress_ticket_futex_init(stress_lock_t *lock)
+{
+	(void)shim_memset(&lock->u.ticket, 0, sizeof(lock->u.ticket));
+
+	return 0;
+}
+
+static int stress_ticket_futex_deinit(stress_lock_t *lock)
+{
+	(void)lock;
+
+	return 0;
+}
+
+/*
+ *  stress_ticket_futex_wake()
+ *	wake the waiters of the ticket now holding the lock
+ */
+static void stress_ticket_futex_wake(stress_lock_ticket_t *ticket, const uint32_t owner)
+{
+	stress_lock_ticket_slot_t *slot = &ticket->slot[owner % STRESS_LOCK_TICKET_SLOTS];
+
+	(void)__atomic_add_fetch(&slot->futex, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ticket->sleepers, __ATOMIC_SEQ_CST))
+		(void)shim_futex_wake(&slot->futex, INT_MAX);
+}
+
+/*
+ *  stress_ticket_futex_skip_dead()
+ *	the lock owner ticket has not changed for a while, skip
+ *	it if the process that took the ticket has gone away
+ */
+static void stress_ticket_futex_skip_dead(stress_lock_ticket_t *ticket, uint32_t owner)
+{
+	const stress_lock_ticket_pid_t *p = &ticket->pid[owner % STRESS_LOCK_TICKET_PIDS];
+	const pid_t pid = p->pid;
+
+	if (p->ticket != owner)
+		return;
+	if ((pid == 0) || ((kill(pid, 0) < 0) && (errno == ESRCH))) {
+		if (__atomic_compare_exchange_n(&ticket->owner, &owner, owner + 1, false,
+						__ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			stress_ticket_futex_wake(ticket, owner + 1);
+	}
+}
+
+static int stress_ticket_futex_acquire(stress_lock_t *lock)
+{
+	stress_lock_ticket_t *ticket = &lock->u.ticket;
+	const uint32_t my_ticket = __atomic_fetch_add(&ticket->next, 1, __ATOMIC_SEQ_CST);
+	stress_lock_ticket_slot_t *slot = &ticket->slot[my_ticket % STRESS_LOCK_TICKET_SLOTS];
+	stress_lock_ticket_pid_t *p = &ticket->pid[my_ticket % STRESS_LOCK_TICKET_PIDS];
+	uint32_t owner, last_owner = ~my_ticket;
+	double t = 0.0;
+	int spins, stalls = 0;
+
+	p->ticket = my_ticket;
+	p->pid = getpid();
+
+	for (spins = 0; spins < STRESS_LOCK_TICKET_SPINS; spins++) {
+		if (__atomic_load_n(&ticket->owner, __ATOMIC_ACQUIRE) == my_ticket)
+			return 0;
+#if defined(HAVE_ASM_X86_PAUSE)
+		stress_asm_x86_pause();
+#endif
+	}
+
+	for (;;) {
+		const struct timespec ts = { 0, STRESS_LOCK_TICKET_SLEEP_NS };
+		const uint32_t val = __atomic_load_n(&slot->futex, __ATOMIC_SEQ_CST);
+
+		(void)__atomic_add_fetch(&ticket->sleepers, 1, __ATOMIC_SEQ_CST);
+		owner = __atomic_load_n(&ticket->owner, __ATOMIC_SEQ_CST);
+		if (owner != my_ticket)
+			(void)shim_futex_wait(&slot->futex, (int)val, &ts);
+		(void)__atomic_sub_fetch(&ticket->sleepers, 1, __ATOMIC_SEQ_CST);
+
+		owner = __atomic_load_n(&ticket->owner, __ATOMIC_ACQUIRE);
+		if (owner == my_ticket)
+			return 0;
+		if (owner != last_owner) {
+			last_owner = owner;
+			stalls = 0;
+		} else if (++stalls >= STRESS_LOCK_TICKET_STALLS) {
+			stress_ticket_futex_skip_dead(ticket, owner);
+			stalls = 0;
+		}
+		/* give up when stopping, the ticket gets skipped */
+		if (t == 0.0) {
+			t = stress_time_now();
+		} else if (((stress_time_now() - t) > 5.0) && !stress_continue_flag()) {
+			p->pid = 0;
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+}
+
+static int stress_ticket_futex_release(stress_lock_t *lock)
+{
+	stress_lock_ticket_t *ticket = &lock->u.ticket;
+	const uint32_t owner = __atomic_load_n(&ticket->owner, __ATOMIC_RELAXED) + 1;
+
+	__atomic_store_n(&ticket->owner, owner, __ATOMIC_SEQ_CST);
+	stress_ticket_futex_wake(ticket, owner);
+
+	return 0;
+}
+
+/*
+ *  stress_lock_queued()
+ *	true if there are enough instances contending on
+ *	locks for the ticket futex lock to be used
+ */
+static bool stress_lock_queued(void)
+{
+	const int32_t cpus = stress_get_processors_online();
+
+	if (!g_shared)
+		return false;
+	return (g_shared->instance_count.total > STRESS_LOCK_QUEUED_INSTANCES) ||
+	       ((cpus > 0) && (g_shared->instance_count.total > (uint32_t)cpus));
+}
+#endif
+
 static bool stress_lock_valid(const stress_lock_t *lock)
 {
 	return (lock && (lock->magic == STRESS_LOCK_MAGIC));
@@ -389,7 +579,7 @@ static bool stress_lock_valid(const stress_lock_t *lock)
  *  stress_lock_create()
  *	generic lock creation and initialization
  */
-void *stress_lock_create(void)
+void *stress_lock_create(const char *name)
 {
 	stress_lock_t *lock;
 
@@ -403,6 +593,19 @@ void *stress_lock_create(void)
 	if (lock == MAP_FAILED)
 		return NULL;
 
+	lock->name = name;
+	lock->stats = !!(g_opt_flags & OPT_FLAGS_PR_DEBUG);
+
+#if LOCK_METHOD_TICKET_FUTEX != 0
+	if (stress_lock_queued()) {
+		lock->init = stress_ticket_futex_init;
+		lock->deinit = stress_ticket_futex_deinit;
+		lock->acquire = stress_ticket_futex_acquire;
+		lock->release = stress_ticket_futex_release;
+		lock->type = "ticket-futex";
+		goto init;
+	}
+#endif
 	/*
 	 *  Select locking implementation, try to use fast atomic
 	 *  spinlock, then pthread spinlock, then pthread mutex
@@ -444,9 +647,18 @@ void *stress_lock_create(void)
 	lock->acquire = stress_sem_sysv_acquire;
 	lock->release = stress_sem_sysv_release;
 	lock->type = "sem-posix";
+#elif LOCK_METHOD_TICKET_FUTEX != 0
+	lock->init = stress_ticket_futex_init;
+	lock->deinit = stress_ticket_futex_deinit;
+	lock->acquire = stress_ticket_futex_acquire;
+	lock->release = stress_ticket_futex_release;
+	lock->type = "ticket-futex";
 #else
 	(void)munmap((void *)lock, sizeof(*lock));
 	goto no_locks;
+#endif
+#if LOCK_METHOD_TICKET_FUTEX != 0
+init:
 #endif
 	lock->magic = STRESS_LOCK_MAGIC;
 
@@ -472,6 +684,19 @@ int stress_lock_destroy(void *lock_handle)
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
 	if (stress_lock_valid(lock)) {
+		if (lock->stats && (lock->acquires > 0)) {
+			const double acquires = (double)lock->acquires;
+
+			pr_dbg("core-lock: %s %s lock: %" PRIu64 " acquires, "
+				"%.2f%% contended, wait mean %.3f us max %.3f us, "
+				"hold mean %.3f us max %.3f us\n",
+				lock->name ? lock->name : "unnamed", lock->type,
+				lock->acquires, 100.0 * (double)lock->contended / acquires,
+				STRESS_DBL_MICROSECOND * lock->wait_total / acquires,
+				STRESS_DBL_MICROSECOND * lock->wait_max,
+				STRESS_DBL_MICROSECOND * lock->hold_total / acquires,
+				STRESS_DBL_MICROSECOND * lock->hold_max);
+		}
 		(void)lock->deinit(lock);
 		(void)shim_memset(lock, 0, sizeof(*lock));
 		(void)munmap((void *)lock, sizeof(*lock));
@@ -489,8 +714,28 @@ int stress_lock_acquire(void *lock_handle)
 {
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
-	if (stress_lock_valid(lock))
-		return lock->acquire(lock);
+	if (stress_lock_valid(lock)) {
+		double t, wait;
+		int ret;
+
+		if (LIKELY(!lock->stats))
+			return lock->acquire(lock);
+
+		t = stress_time_now();
+		ret = lock->acquire(lock);
+		if (ret < 0)
+			return ret;
+		/* stats are updated while holding the lock */
+		lock->t_acquired = stress_time_now();
+		wait = lock->t_acquired - t;
+		lock->acquires++;
+		if (wait > STRESS_LOCK_CONTENDED_SECS)
+			lock->contended++;
+		lock->wait_total += wait;
+		if (wait > lock->wait_max)
+			lock->wait_max = wait;
+		return 0;
+	}
 
 	errno = EINVAL;
 	return -1;
@@ -504,8 +749,16 @@ int stress_lock_release(void *lock_handle)
 {
 	stress_lock_t *lock = (stress_lock_t *)lock_handle;
 
-	if (stress_lock_valid(lock))
+	if (stress_lock_valid(lock)) {
+		if (UNLIKELY(lock->stats)) {
+			const double hold = stress_time_now() - lock->t_acquired;
+
+			lock->hold_total += hold;
+			if (hold > lock->hold_max)
+				lock->hold_max = hold;
+		}
 		return lock->release(lock);
+	}
 
 	errno = EINVAL;
 	return -1;
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-log.h"
 #include "core-syslog.h"
 
@@ -27,9 +28,44 @@
 
 #define ABORT_FAILURES	(5)	/* Number of failures before we abort */
 
+#define PR_RING_SIZE	(16 * KB)	/* Per instance log ring size */
+#define PR_RING_DRAIN_NS (50000000ULL)	/* Ring drain period, 50ms */
+
+/*
+ *  --log-ring message record, followed by len bytes of message
+ *  text and padded to a multiple of the record header size
+ */
+typedef struct {
+	double time;			/* time message was logged */
+	uint32_t len;			/* length of message text */
+	uint32_t padding;		/* alignment padding */
+} pr_ring_rec_t;
+
+/*
+ *  Single producer, single consumer log ring in shared memory, the
+ *  producer is the stressor instance process and the consumer is the
+ *  log drain process or the main stress-ng process at the end of a run
+ */
+typedef struct {
+	volatile uint64_t head ALIGN64;	/* producer offset, written by instance */
+	volatile uint64_t tail ALIGN64;	/* consumer offset, written by drainer */
+	uint8_t data[PR_RING_SIZE];	/* ring of pr_ring_rec_t records */
+} pr_ring_t;
+
+typedef struct {
+	volatile bool stop;		/* true to stop the drain process */
+	int32_t	num_rings;		/* number of rings */
+	pr_ring_t ring[];		/* per instance rings */
+} pr_rings_t;
+
 static uint16_t	abort_fails;	/* count of failures */
 static bool	abort_msg_emitted;
 static int 	log_fd = -1;
+static pr_rings_t *pr_rings = NULL;	/* shared log rings */
+static size_t pr_rings_size;		/* size of pr_rings mapping */
+static pr_ring_t *pr_ring = NULL;	/* this process' log ring */
+static int pr_ring_tid = -1;		/* owner thread of pr_ring */
+static pid_t pr_ring_drain_pid = -1;	/* log drain process */
 
 /*
  *  This is used per stress-ng process and not shared, so locking is not required
@@ -71,6 +107,67 @@ static void pr_log_write_buf_fd(const int fd, const char *buf, const size_t buf_
 		shim_fsync(fd);
 }
 
+/*
+ *  pr_ring_copy_in()
+ *	copy len bytes of src into the ring at offset off
+ */
+static void pr_ring_copy_in(pr_ring_t *ring, const uint64_t off, const void *src, const size_t len)
+{
+	const size_t idx = (size_t)(off % PR_RING_SIZE);
+	const size_t n = STRESS_MINIMUM(len, PR_RING_SIZE - idx);
+
+	(void)shim_memcpy(ring->data + idx, src, n);
+	if (n < len)
+		(void)shim_memcpy(ring->data, (const uint8_t *)src + n, len - n);
+}
+
+/*
+ *  pr_ring_copy_out()
+ *	copy len bytes from the ring at offset off to dst
+ */
+static void pr_ring_copy_out(const pr_ring_t *ring, const uint64_t off, void *dst, const size_t len)
+{
+	const size_t idx = (size_t)(off % PR_RING_SIZE);
+	const size_t n = STRESS_MINIMUM(len, PR_RING_SIZE - idx);
+
+	(void)shim_memcpy(dst, ring->data + idx, n);
+	if (n < len)
+		(void)shim_memcpy((uint8_t *)dst + n, ring->data, len - n);
+}
+
+/*
+ *  pr_ring_write()
+ *	add a message to this process' log ring, returns false if
+ *	there is no ring or the ring is full so the message has to
+ *	be written out directly
+ */
+static bool pr_ring_write(const char *buf, const size_t buf_len)
+{
+	pr_ring_rec_t rec;
+	uint64_t head;
+	size_t rec_len;
+
+	/* single producer ring, other threads of the owner write directly */
+	if (!pr_ring || (pr_ring_tid != shim_gettid()))
+		return false;
+
+	rec_len = (sizeof(rec) + buf_len + sizeof(rec) - 1) & ~(sizeof(rec) - 1);
+	head = pr_ring->head;
+	if (rec_len > PR_RING_SIZE - (head - pr_ring->tail))
+		return false;
+
+	rec.time = stress_time_now();
+	rec.len = (uint32_t)buf_len;
+	rec.padding = 0;
+	pr_ring_copy_in(pr_ring, head, &rec, sizeof(rec));
+	pr_ring_copy_in(pr_ring, head + sizeof(rec), buf, buf_len);
+	/* make the record visible before moving the head on */
+	stress_asm_mb();
+	pr_ring->head = head + rec_len;
+
+	return true;
+}
+
 /*
  *  pr_log_write_buf()
  *  	write buf message to log file and tty
@@ -80,6 +177,9 @@ static void pr_log_write_buf(const char *buf, const size_t buf_len)
 {
 	const int fd = pr_fd();
 
+	if (pr_ring_write(buf, buf_len))
+		return;
+
 	if (log_fd != -1)
 		pr_log_write_buf_fd(log_fd, buf, buf_len);
 
@@ -138,12 +238,15 @@ void pr_block_begin(void)
  */
 void pr_block_end(void)
 {
-	if (pr_msg_buf.buf && (pr_msg_buf.pid == getpid())) {
+	if (pr_msg_buf.pid != getpid())
+		return;
+	if (pr_msg_buf.buf) {
 		pr_log_write_buf(pr_msg_buf.buf, strlen(pr_msg_buf.buf));
 		free(pr_msg_buf.buf);
 		pr_msg_buf.buf = NULL;
-		pr_msg_buf.pid = -1;
 	}
+	/* Always end buffering, even if nothing was buffered */
+	pr_msg_buf.pid = -1;
 }
 
 /*
@@ -455,3 +558,216 @@ void pr_metrics(const char *fmt, ...)
 	(void)pr_msg(OPT_FLAGS_PR_METRICS, fmt, ap);
 	va_end(ap);
 }
+
+typedef struct {
+	double time;			/* time message was logged */
+	size_t offset;			/* offset of message in batch buffer */
+	size_t len;			/* length of message */
+} pr_ring_msg_t;
+
+/*
+ *  pr_ring_msg_cmp()
+ *	sort messages by time, oldest first
+ */
+static int pr_ring_msg_cmp(const void *p1, const void *p2)
+{
+	const pr_ring_msg_t *m1 = (const pr_ring_msg_t *)p1;
+	const pr_ring_msg_t *m2 = (const pr_ring_msg_t *)p2;
+
+	if (m1->time < m2->time)
+		return -1;
+	if (m1->time > m2->time)
+		return 1;
+	return 0;
+}
+
+/*
+ *  pr_ring_drain()
+ *	drain all the messages in the log rings, sort them by
+ *	time and write them out in one batch
+ */
+static void pr_ring_drain(void)
+{
+	pr_ring_msg_t *msgs;
+	uint8_t *buf, *out;
+	size_t total = 0, n = 0, max_msgs = 0, i, len = 0;
+	int32_t r;
+
+	for (r = 0; r < pr_rings->num_rings; r++) {
+		const pr_ring_t *ring = &pr_rings->ring[r];
+		const uint64_t pending = ring->head - ring->tail;
+
+		total += (size_t)pending;
+		max_msgs += (size_t)pending / sizeof(pr_ring_rec_t);
+	}
+	if (total == 0)
+		return;
+
+	buf = (uint8_t *)malloc(total);
+	msgs = (pr_ring_msg_t *)calloc(max_msgs, sizeof(*msgs));
+	out = (uint8_t *)malloc(total);
+	if (!buf || !msgs || !out) {
+		free(out);
+		free(msgs);
+		free(buf);
+		return;
+	}
+
+	for (r = 0; r < pr_rings->num_rings; r++) {
+		pr_ring_t *ring = &pr_rings->ring[r];
+		const uint64_t head = ring->head;
+		uint64_t tail = ring->tail;
+
+		/* read the head before the records it covers */
+		stress_asm_mb();
+		while ((tail < head) && (n < max_msgs)) {
+			pr_ring_rec_t rec;
+			size_t rec_len;
+
+			pr_ring_copy_out(ring, tail, &rec, sizeof(rec));
+			rec_len = (sizeof(rec) + rec.len + sizeof(rec) - 1) & ~(sizeof(rec) - 1);
+			if ((rec_len > head - tail) || (len + rec.len > total))
+				break;
+			pr_ring_copy_out(ring, tail + sizeof(rec), buf + len, rec.len);
+			msgs[n].time = rec.time;
+			msgs[n].offset = len;
+			msgs[n].len = rec.len;
+			len += rec.len;
+			n++;
+			tail += rec_len;
+		}
+		stress_asm_mb();
+		ring->tail = tail;
+	}
+
+	qsort(msgs, n, sizeof(*msgs), pr_ring_msg_cmp);
+	for (len = 0, i = 0; i < n; i++) {
+		(void)shim_memcpy(out + len, buf + msgs[i].offset, msgs[i].len);
+		len += msgs[i].len;
+	}
+	if (log_fd != -1)
+		pr_log_write_buf_fd(log_fd, (const char *)out, len);
+	pr_log_write_buf_fd(pr_fd(), (const char *)out, len);
+
+	free(out);
+	free(msgs);
+	free(buf);
+}
+
+/*
+ *  pr_ring_init()
+ *	allocate shared log rings for the --log-ring option, one ring
+ *	per stressor instance and one for the main stress-ng process,
+ *	returns -1 if the rings cannot be mapped
+ */
+int pr_ring_init(const int32_t num_instances)
+{
+	void *ptr;
+
+	if (num_instances < 1)
+		return 0;
+
+	pr_rings_size = sizeof(*pr_rings) + ((size_t)(num_instances + 1) * sizeof(pr_ring_t));
+	ptr = mmap(NULL, pr_rings_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED) {
+		pr_inf("log-ring: cannot mmap %zd bytes for log rings, errno=%d (%s), "
+			"writing messages directly\n",
+			pr_rings_size, errno, strerror(errno));
+		return -1;
+	}
+	pr_rings = (pr_rings_t *)ptr;
+	pr_rings->num_rings = num_instances + 1;
+	pr_rings->stop = false;
+
+	return 0;
+}
+
+/*
+ *  pr_ring_attach()
+ *	make the calling stressor instance thread log into its own
+ *	ring, other threads and processes such as stressor children
+ *	keep on writing messages out directly
+ */
+void pr_ring_attach(const int32_t instance)
+{
+	const int tid = shim_gettid();
+
+	if (!pr_rings || (tid < 0) || (instance < 0) || (instance >= pr_rings->num_rings - 1))
+		return;
+
+	pr_ring = &pr_rings->ring[instance];
+	pr_ring_tid = tid;
+}
+
+/*
+ *  pr_ring_start()
+ *	start the process that drains the log rings every 50ms, the
+ *	main process logs into the last ring while the rings are
+ *	being drained to keep its messages in time order too
+ */
+void pr_ring_start(void)
+{
+	if (!pr_rings)
+		return;
+
+	pr_ring_drain_pid = fork();
+	if (pr_ring_drain_pid < 0)
+		return;
+	if (pr_ring_drain_pid > 0) {
+		const int tid = shim_gettid();
+
+		/* without a thread id the owner can't be told apart */
+		if (tid >= 0) {
+			pr_ring = &pr_rings->ring[pr_rings->num_rings - 1];
+			pr_ring_tid = tid;
+		}
+		return;
+	}
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [log-ring]");
+
+	while (!pr_rings->stop) {
+		(void)shim_nanosleep_uint64(PR_RING_DRAIN_NS);
+		pr_ring_drain();
+	}
+	_exit(0);
+}
+
+/*
+ *  pr_ring_stop()
+ *	stop the drain process and flush out any messages still in
+ *	the rings, this includes messages of instances that got killed
+ */
+void pr_ring_stop(void)
+{
+	if (!pr_rings)
+		return;
+
+	pr_ring = NULL;
+	if (pr_ring_drain_pid > 0) {
+		int status;
+
+		pr_rings->stop = true;
+		while ((shim_waitpid(pr_ring_drain_pid, &status, 0) < 0) && (errno == EINTR))
+			;
+		pr_ring_drain_pid = -1;
+	}
+	pr_ring_drain();
+}
+
+/*
+ *  pr_ring_free()
+ *	unmap the log rings
+ */
+void pr_ring_free(void)
+{
+	if (!pr_rings)
+		return;
+
+	pr_ring_stop();
+	(void)munmap((void *)pr_rings, pr_rings_size);
+	pr_rings = NULL;
+	pr_ring = NULL;
+}
@@ -27,6 +27,11 @@ extern void pr_fail_check(int *const rc);
 extern int pr_yaml(FILE *fp, const char *const fmt, ...) FORMAT(printf, 2, 3);
 extern void pr_closelog(void);
 extern void pr_openlog(const char *filename);
+extern int pr_ring_init(const int32_t num_instances);
+extern void pr_ring_attach(const int32_t instance);
+extern void pr_ring_start(void);
+extern void pr_ring_stop(void);
+extern void pr_ring_free(void);
 extern void pr_dbg(const char *fmt, ...)	FORMAT(printf, 1, 2);
 extern void pr_dbg_skip(const char *fmt, ...)	FORMAT(printf, 1, 2);
 extern void pr_inf(const char *fmt, ...)	FORMAT(printf, 1, 2);
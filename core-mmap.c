@@ -18,15 +18,112 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-pragma.h"
 #include "core-cpu-cache.h"
 #include "core-mmap.h"
+#include "core-target-clones.h"
+#include "core-vecmath.h"
 
-#if defined(HAVE_ASM_X86_REP_STOSQ) &&  \
+/*
+ *  With vector math the page fill and check use 64 byte vectors,
+ *  the target clones map these onto SSE, AVX2, AVX512 or NEON
+ */
+#if defined(HAVE_VECMATH)
+#define USE_MMAP_VECTOR
+#define STRESS_MMAP_VEC_SIZE	(64)
+
+typedef uint64_t stress_mmap_v8u64_t __attribute__ ((vector_size(STRESS_MMAP_VEC_SIZE)));
+#elif defined(HAVE_ASM_X86_REP_STOSQ) &&  \
     !defined(__ILP32__)
 #define USE_ASM_X86_REP_STOSQ
 #endif
 
+#if defined(USE_MMAP_VECTOR)
+/*
+ *  stress_mmap_set_page()
+ *	fill [ptr, end) with val, vector version
+ */
+static void TARGET_CLONES OPTIMIZE3 stress_mmap_set_page(
+	uint8_t *ptr,
+	const uint8_t *end,
+	const uint64_t val)
+{
+	stress_mmap_v8u64_t v;
+	register size_t i;
+
+	for (i = 0; i < STRESS_MMAP_VEC_SIZE / sizeof(uint64_t); i++)
+		v[i] = val;
+
+	while (ptr + (4 * sizeof(v)) <= end) {
+		(void)shim_memcpy(ptr + (0 * sizeof(v)), &v, sizeof(v));
+		(void)shim_memcpy(ptr + (1 * sizeof(v)), &v, sizeof(v));
+		(void)shim_memcpy(ptr + (2 * sizeof(v)), &v, sizeof(v));
+		(void)shim_memcpy(ptr + (3 * sizeof(v)), &v, sizeof(v));
+		ptr += 4 * sizeof(v);
+	}
+	while (ptr + sizeof(val) <= end) {
+		(void)shim_memcpy(ptr, &val, sizeof(val));
+		ptr += sizeof(val);
+	}
+}
+
+/*
+ *  stress_mmap_check_page()
+ *	check all the 64 bit words in [ptr, end) are the same, the
+ *	page is compared with vector xor/or and only rescanned with
+ *	scalar code to find the exact failing address
+ */
+static int TARGET_CLONES OPTIMIZE3 stress_mmap_check_page(
+	const uint8_t *ptr,
+	const uint8_t *end)
+{
+	const uint8_t *start = ptr;
+	stress_mmap_v8u64_t v, diff;
+	uint64_t val, any = 0;
+	register size_t i;
+
+	(void)shim_memcpy(&val, ptr, sizeof(val));
+	for (i = 0; i < STRESS_MMAP_VEC_SIZE / sizeof(uint64_t); i++) {
+		v[i] = val;
+		diff[i] = 0;
+	}
+	while (ptr + (4 * sizeof(v)) <= end) {
+		stress_mmap_v8u64_t v0, v1, v2, v3;
+
+		(void)shim_memcpy(&v0, ptr + (0 * sizeof(v)), sizeof(v));
+		(void)shim_memcpy(&v1, ptr + (1 * sizeof(v)), sizeof(v));
+		(void)shim_memcpy(&v2, ptr + (2 * sizeof(v)), sizeof(v));
+		(void)shim_memcpy(&v3, ptr + (3 * sizeof(v)), sizeof(v));
+		diff |= (v0 ^ v) | (v1 ^ v) | (v2 ^ v) | (v3 ^ v);
+		ptr += 4 * sizeof(v);
+	}
+	for (i = 0; i < STRESS_MMAP_VEC_SIZE / sizeof(uint64_t); i++)
+		any |= diff[i];
+	while (ptr + sizeof(val) <= end) {
+		uint64_t tmp;
+
+		(void)shim_memcpy(&tmp, ptr, sizeof(tmp));
+		any |= tmp ^ val;
+		ptr += sizeof(tmp);
+	}
+	if (LIKELY(!any))
+		return 0;
+
+	for (ptr = start; ptr + sizeof(val) <= end; ptr += sizeof(val)) {
+		uint64_t tmp;
+
+		(void)shim_memcpy(&tmp, ptr, sizeof(tmp));
+		if (tmp != val) {
+			pr_dbg("mmap: data check failed at %p, got 0x%16.16" PRIx64
+				", expected 0x%16.16" PRIx64 "\n", ptr, tmp, val);
+			break;
+		}
+	}
+	return -1;
+}
+#endif
+
 /*
  *  stress_mmap_set()
  *	set mmap'd data, touching pages in
@@ -39,6 +136,20 @@ void OPTIMIZE3 stress_mmap_set(
 	const size_t page_size)
 {
 	register uint64_t val = stress_mwc64();
+#if defined(USE_MMAP_VECTOR)
+	register uint8_t *ptr = buf;
+	register const uint8_t *end = buf + sz;
+
+	while (ptr < end) {
+		uint8_t *page_end = (uint8_t *)STRESS_MINIMUM((uintptr_t)end, (uintptr_t)ptr + page_size);
+
+		if (!stress_continue_flag())
+			break;
+		stress_mmap_set_page(ptr, page_end, val);
+		ptr = page_end;
+		val++;
+	}
+#else
 	register uint64_t *ptr = (uint64_t *)buf;
 	register const uint64_t *end = (uint64_t *)(buf + sz);
 #if defined(USE_ASM_X86_REP_STOSQ)
@@ -93,6 +204,7 @@ void OPTIMIZE3 stress_mmap_set(
 #endif
 		val++;
 	}
+#endif
 }
 
 /*
@@ -104,6 +216,19 @@ int OPTIMIZE3 stress_mmap_check(
 	const size_t sz,
 	const size_t page_size)
 {
+#if defined(USE_MMAP_VECTOR)
+	register const uint8_t *ptr = buf;
+	register const uint8_t *end = buf + sz;
+
+	while ((ptr < end) && stress_continue_flag()) {
+		const uint8_t *page_end = (const uint8_t *)STRESS_MINIMUM((uintptr_t)end, (uintptr_t)ptr + page_size);
+
+		if (stress_mmap_check_page(ptr, page_end) < 0)
+			return -1;
+		ptr = page_end;
+	}
+	return 0;
+#else
 	register uint64_t *ptr = (uint64_t *)buf;
 	register const uint64_t *end = (uint64_t *)(buf + sz);
 
@@ -151,6 +276,7 @@ int OPTIMIZE3 stress_mmap_check(
 		}
 	}
 	return 0;
+#endif
 }
 
 /*
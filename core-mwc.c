@@ -19,8 +19,10 @@
  */
 #include "stress-ng.h"
 #include "core-attribute.h"
+#include "core-builtin.h"
 #include "core-cpu-cache.h"
 #include "core-mwc.h"
+#include "core-target-clones.h"
 
 #if defined(HAVE_SYS_AUXV_H)
 #include <sys/auxv.h>
@@ -52,7 +54,11 @@ typedef struct {
 	uint32_t saved1;
 } stress_mwc_t;
 
-static stress_mwc_t mwc = {
+/*
+ *  Per thread state so that threads replaying a seeded
+ *  sequence (e.g. vm --vm-threads) do not race on it
+ */
+static THREAD_LOCAL stress_mwc_t mwc = {
 #if defined(STRESS_USE_MWC_32)
 	STRESS_MWC_SEED_W,
 	STRESS_MWC_SEED_Z,
@@ -442,17 +448,127 @@ HOT OPTIMIZE3 uint64_t stress_mwc64modn(const uint64_t max)
 	return val % max;
 }
 
+/*
+ *  Bulk fill uses STRESS_MWC_FILL_LANES independent xorshift128+
+ *  streams seeded from the mwc generator, so the output is still
+ *  determined by the mwc seed; the streams only use shifts, xors
+ *  and adds so they map onto plain SIMD integer instructions
+ */
+#define STRESS_MWC_FILL_LANES	(8)
+#define STRESS_MWC_FILL_BLOCK	(STRESS_MWC_FILL_LANES * sizeof(uint64_t))
+#define STRESS_MWC_FILL_MIN	(STRESS_MWC_FILL_BLOCK * 4)
+
+#if defined(HAVE_VECMATH)
+typedef uint64_t stress_mwc_v8u64_t __attribute__ ((vector_size(STRESS_MWC_FILL_BLOCK)));
+
+/*
+ *  stress_mwc_fill_lanes()
+ *	fill n blocks of STRESS_MWC_FILL_BLOCK bytes, vector version
+ */
+static void TARGET_CLONES OPTIMIZE3 stress_mwc_fill_lanes(
+	uint8_t *ptr,
+	size_t n,
+	uint64_t s0[STRESS_MWC_FILL_LANES],
+	uint64_t s1[STRESS_MWC_FILL_LANES])
+{
+	stress_mwc_v8u64_t v0, v1;
+
+	(void)shim_memcpy(&v0, s0, sizeof(v0));
+	(void)shim_memcpy(&v1, s1, sizeof(v1));
+
+	while (n--) {
+		stress_mwc_v8u64_t x = v0;
+		const stress_mwc_v8u64_t y = v1;
+
+		v0 = y;
+		x ^= x << 23;
+		v1 = x ^ y ^ (x >> 17) ^ (y >> 26);
+		x = v1 + y;
+		(void)shim_memcpy(ptr, &x, sizeof(x));
+		ptr += sizeof(x);
+	}
+	(void)shim_memcpy(s0, &v0, sizeof(v0));
+	(void)shim_memcpy(s1, &v1, sizeof(v1));
+}
+#else
+/*
+ *  stress_mwc_fill_lanes()
+ *	fill n blocks of STRESS_MWC_FILL_BLOCK bytes, scalar version
+ */
+static void TARGET_CLONES OPTIMIZE3 stress_mwc_fill_lanes(
+	uint8_t *ptr,
+	size_t n,
+	uint64_t s0[STRESS_MWC_FILL_LANES],
+	uint64_t s1[STRESS_MWC_FILL_LANES])
+{
+	while (n--) {
+		uint64_t out[STRESS_MWC_FILL_LANES];
+		register size_t i;
+
+		for (i = 0; i < STRESS_MWC_FILL_LANES; i++) {
+			register uint64_t x = s0[i];
+			register const uint64_t y = s1[i];
+
+			s0[i] = y;
+			x ^= x << 23;
+			s1[i] = x ^ y ^ (x >> 17) ^ (y >> 26);
+			out[i] = s1[i] + y;
+		}
+		(void)shim_memcpy(ptr, out, sizeof(out));
+		ptr += sizeof(out);
+	}
+}
+#endif
+
+/*
+ *  stress_mwc_fill()
+ *	fill buffer with pseudorandom bytes, large buffers are
+ *	filled with multiple parallel streams seeded from mwc
+ */
+HOT OPTIMIZE3 void stress_mwc_fill(void *buf, const size_t len)
+{
+	register uint8_t *ptr = (uint8_t *)buf;
+	register size_t n;
+	uint64_t s0[STRESS_MWC_FILL_LANES], s1[STRESS_MWC_FILL_LANES];
+	size_t i;
+
+	if (len < STRESS_MWC_FILL_MIN) {
+		for (n = len; n >= sizeof(uint64_t); n -= sizeof(uint64_t)) {
+			const uint64_t val = stress_mwc64();
+
+			(void)shim_memcpy(ptr, &val, sizeof(val));
+			ptr += sizeof(val);
+		}
+		while (n--)
+			*ptr++ = stress_mwc8();
+		return;
+	}
+
+	for (i = 0; i < STRESS_MWC_FILL_LANES; i++) {
+		/* xorshift128+ state must not be all zero */
+		s0[i] = stress_mwc64() | 1;
+		s1[i] = stress_mwc64();
+	}
+	n = len / STRESS_MWC_FILL_BLOCK;
+	stress_mwc_fill_lanes(ptr, n, s0, s1);
+	ptr += n * STRESS_MWC_FILL_BLOCK;
+
+	n = len % STRESS_MWC_FILL_BLOCK;
+	if (n) {
+		uint8_t tail[STRESS_MWC_FILL_BLOCK];
+
+		stress_mwc_fill_lanes(tail, 1, s0, s1);
+		(void)shim_memcpy(ptr, tail, n);
+	}
+}
+
 /*
  *  stress_rndbuf()
  *	fill buffer with pseudorandom bytes
  */
-HOT OPTIMIZE3 void stress_rndbuf(void *buf, const size_t len)
+void stress_rndbuf(void *buf, const size_t len)
 {
-	register char *ptr = (char *)buf;
-	register const char *end = ptr + len;
-
-	while (ptr < end)
-		*ptr++ = stress_mwc8();
+	stress_mwc_fill(buf, len);
 }
 
 /*
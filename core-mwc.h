@@ -37,6 +37,7 @@ extern uint16_t stress_mwc16modn(const uint16_t max);
 extern uint32_t stress_mwc32modn(const uint32_t max);
 extern uint64_t stress_mwc64modn(const uint64_t max);
 
+extern void stress_mwc_fill(void *buf, const size_t len);
 extern void stress_rndbuf(void *buf, const size_t len);
 extern void stress_rndstr(char *str, size_t len);
 
@@ -17,6 +17,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-numa.h"
 
 #if defined(HAVE_LINUX_MEMPOLICY_H)
@@ -25,6 +26,148 @@
 
 static const char option[] = "option --mbind";
 
+typedef enum {
+	STRESS_NUMA_POLICY_NONE = 0,
+	STRESS_NUMA_POLICY_LOCAL,
+	STRESS_NUMA_POLICY_INTERLEAVE,
+	STRESS_NUMA_POLICY_REMOTE,
+	STRESS_NUMA_POLICY_NODE,
+} stress_numa_policy_t;
+
+static stress_numa_policy_t numa_policy = STRESS_NUMA_POLICY_NONE;
+static const char *numa_policy_name;	/* --numa-policy argument */
+
+/*
+ *  stress_numa_policy_enabled()
+ *	true if a --numa-policy is set
+ */
+bool stress_numa_policy_enabled(void)
+{
+	return numa_policy != STRESS_NUMA_POLICY_NONE;
+}
+
+/*
+ *  stress_numa_pages_pid()
+ *	add the resident pages per node of a process and of its
+ *	child processes, many stressors allocate memory in children
+ */
+static void stress_numa_pages_pid(stress_numa_pages_t *pages, const pid_t pid, const int depth)
+{
+	char path[64], buf[4096];
+	FILE *fp;
+	intmax_t child;
+
+	(void)snprintf(path, sizeof(path), "/proc/%jd/numa_maps", (intmax_t)pid);
+	fp = fopen(path, "r");
+	if (!fp)
+		return;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *ptr;
+
+		/* per node page counts are space separated N<node>=<pages> fields */
+		for (ptr = strstr(buf, " N"); ptr; ptr = strstr(ptr + 1, " N")) {
+			unsigned long node;
+			uint64_t n;
+
+			if (sscanf(ptr, " N%lu=%" SCNu64, &node, &n) != 2)
+				continue;
+			pages->total += n;
+			if (node < STRESS_NUMA_NODES_MAX)
+				pages->node[node] += n;
+		}
+	}
+	(void)fclose(fp);
+
+	if (depth <= 0)
+		return;
+	(void)snprintf(path, sizeof(path), "/proc/%jd/task/%jd/children",
+		(intmax_t)pid, (intmax_t)pid);
+	fp = fopen(path, "r");
+	if (!fp)
+		return;
+	while (fscanf(fp, "%jd", &child) == 1)
+		stress_numa_pages_pid(pages, (pid_t)child, depth - 1);
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_numa_pages_sample()
+ *	sample the resident pages per node of a running stressor
+ *	instance from /proc/$pid/numa_maps, the sample with the
+ *	most resident pages is kept as the instance peak
+ */
+void stress_numa_pages_sample(stress_stats_t *stats)
+{
+	stress_numa_pages_t pages;
+
+	if ((stats->pid <= 0) || (stats->start <= 0.0) || stats->completed)
+		return;
+
+	(void)shim_memset(&pages, 0, sizeof(pages));
+	stress_numa_pages_pid(&pages, stats->pid, 3);
+
+	if (pages.total > stats->numa_pages.total)
+		(void)shim_memcpy(&stats->numa_pages, &pages, sizeof(pages));
+}
+
+/*
+ *  stress_numa_pages_dump()
+ *	report the peak resident pages per NUMA node of each instance
+ */
+void stress_numa_pages_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool dumped = false;
+
+	if (numa_policy == STRESS_NUMA_POLICY_NONE)
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		char name[64];
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+
+		(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_numa_pages_t *pages = &ss->stats[j]->numa_pages;
+			char buf[256];
+			size_t i, len = 0;
+
+			if (pages->total == 0)
+				continue;
+			if (!dumped) {
+				pr_block_begin();
+				pr_inf("numa: peak resident pages per node, --numa-policy %s\n",
+					numa_policy_name);
+				pr_yaml(yaml, "numa-pages:\n");
+				dumped = true;
+			}
+			pr_yaml(yaml, "    - stressor: %s\n", name);
+			pr_yaml(yaml, "      instance: %" PRId32 "\n", j);
+			pr_yaml(yaml, "      numa-policy: %s\n", numa_policy_name);
+			pr_yaml(yaml, "      resident-pages: %" PRIu64 "\n", pages->total);
+
+			*buf = '\0';
+			for (i = 0; i < STRESS_NUMA_NODES_MAX; i++) {
+				if (pages->node[i] == 0)
+					continue;
+				pr_yaml(yaml, "      node%zu-pages: %" PRIu64 "\n", i, pages->node[i]);
+				if (len < sizeof(buf))
+					len += (size_t)snprintf(buf + len, sizeof(buf) - len,
+						" node%zu: %" PRIu64 " (%.1f%%)", i, pages->node[i],
+						100.0 * (double)pages->node[i] / (double)pages->total);
+			}
+			pr_yaml(yaml, "\n");
+			pr_inf("%-13s %4" PRId32 "%s\n", name, j, buf);
+		}
+	}
+	if (dumped)
+		pr_block_end();
+}
+
 #if defined(__NR_get_mempolicy) &&      \
     defined(__NR_mbind) &&              \
     defined(__NR_migrate_pages) &&      \
@@ -116,6 +259,62 @@ int stress_numa_count_mem_nodes(unsigned long *max_node)
 	return n;
 }
 
+/*
+ *  stress_numa_farthest_node()
+ *	find the allowed memory node with the largest SLIT distance
+ *	from node, the distance list in sysfs is in node order. If
+ *	the distances cannot be read the next allowed node after node
+ *	is used. Returns -1 if there is no allowed node other than node.
+ */
+long stress_numa_farthest_node(const unsigned long node)
+{
+	unsigned long max_node, *allowed, i;
+	const size_t nodemask_bits = sizeof(*allowed) * 8;
+	char path[PATH_MAX], buf[4096], *ptr;
+	long farthest = -1;
+	int mode, max_distance = 0;
+
+	if (stress_numa_count_mem_nodes(&max_node) < 1)
+		return -1;
+	allowed = calloc((max_node + (nodemask_bits - 1)) / nodemask_bits, sizeof(*allowed));
+	if (!allowed)
+		return -1;
+	if (shim_get_mempolicy(&mode, allowed, max_node, NULL, MPOL_F_MEMS_ALLOWED) < 0) {
+		free(allowed);
+		return -1;
+	}
+
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%lu/distance", node);
+	if (stress_system_read(path, buf, sizeof(buf)) > 0) {
+		for (ptr = buf, i = 0; i < max_node; i++) {
+			char *end;
+			const long distance = strtol(ptr, &end, 10);
+
+			if (end == ptr)
+				break;
+			ptr = end;
+			if ((i != node) && STRESS_GETBIT(allowed, i) && (distance > max_distance)) {
+				max_distance = (int)distance;
+				farthest = (long)i;
+			}
+		}
+	}
+	if (farthest < 0) {
+		/* no distances, next allowed node after node, wrapping round */
+		for (i = 1; i < max_node; i++) {
+			const unsigned long n = (node + i) % max_node;
+
+			if (STRESS_GETBIT(allowed, n)) {
+				farthest = (long)n;
+				break;
+			}
+		}
+	}
+	free(allowed);
+
+	return farthest;
+}
+
 /*
  *  stress_numa_nodes()
  *	determine the number of NUMA memory nodes,
@@ -226,12 +425,146 @@ int stress_set_mbind(const char *arg)
 	return 0;
 }
 
+static unsigned long numa_policy_node;	/* node for --numa-policy nodeN */
+
+/*
+ *  stress_set_numa_policy()
+ *	parse --numa-policy option
+ */
+int stress_set_numa_policy(const char *arg)
+{
+	unsigned long max_node;
+
+	numa_policy_name = arg;
+	if (!strcmp(arg, "local")) {
+		numa_policy = STRESS_NUMA_POLICY_LOCAL;
+		return 0;
+	}
+	if (!strcmp(arg, "interleave")) {
+		numa_policy = STRESS_NUMA_POLICY_INTERLEAVE;
+		return 0;
+	}
+	if (!strcmp(arg, "remote")) {
+		numa_policy = STRESS_NUMA_POLICY_REMOTE;
+		return 0;
+	}
+	if (!strncmp(arg, "node", 4) && isdigit((unsigned char)arg[4])) {
+		numa_policy_node = stress_parse_node(arg + 4);
+		if (stress_numa_count_mem_nodes(&max_node) < 0) {
+			(void)fprintf(stderr, "no NUMA nodes found, cannot use --numa-policy %s\n", arg);
+			_exit(EXIT_FAILURE);
+		}
+		stress_check_numa_range(max_node, numa_policy_node);
+		{
+			char path[PATH_MAX];
+
+			(void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%lu", numa_policy_node);
+			if (access(path, F_OK) < 0) {
+				(void)fprintf(stderr, "%s: NUMA node %lu does not exist\n",
+					"option --numa-policy", numa_policy_node);
+				_exit(EXIT_FAILURE);
+			}
+		}
+		numa_policy = STRESS_NUMA_POLICY_NODE;
+		return 0;
+	}
+	(void)fprintf(stderr, "numa-policy must be one of: local interleave remote nodeN\n");
+	_exit(EXIT_FAILURE);
+}
+
+/*
+ *  stress_numa_policy_apply()
+ *	set the --numa-policy memory policy of a stressor instance,
+ *	this is called after --placement so that local and remote
+ *	are relative to the node of the CPU the instance runs on
+ */
+void stress_numa_policy_apply(const char *name)
+{
+	unsigned long max_node, *allowed, *nodemask;
+	const size_t nodemask_bits = sizeof(*nodemask) * 8;
+	size_t nodemask_sz;
+	unsigned int cpu = 0, node = 0;
+	int mode, ret = 0;
+
+	if (numa_policy == STRESS_NUMA_POLICY_NONE)
+		return;
+
+	if (stress_numa_count_mem_nodes(&max_node) < 0)
+		return;
+	nodemask_sz = (max_node + (nodemask_bits - 1)) / nodemask_bits;
+	allowed = calloc(nodemask_sz, sizeof(*allowed));
+	nodemask = calloc(nodemask_sz, sizeof(*nodemask));
+	if (!allowed || !nodemask)
+		goto err;
+	if (shim_get_mempolicy(&mode, allowed, max_node, NULL, MPOL_F_MEMS_ALLOWED) < 0)
+		goto err;
+
+	switch (numa_policy) {
+	case STRESS_NUMA_POLICY_LOCAL:
+		/* preferred with an empty nodemask is local allocation */
+		ret = shim_set_mempolicy(MPOL_PREFERRED, NULL, 0);
+		break;
+	case STRESS_NUMA_POLICY_INTERLEAVE:
+		ret = shim_set_mempolicy(MPOL_INTERLEAVE, allowed, max_node);
+		break;
+	case STRESS_NUMA_POLICY_REMOTE:
+		if (shim_getcpu(&cpu, &node, NULL) < 0)
+			node = 0;
+		{
+			unsigned long i, remote = max_node;
+
+			/* next allowed node after the local node, wrapping round */
+			for (i = 1; i < max_node; i++) {
+				const unsigned long n = ((unsigned long)node + i) % max_node;
+
+				if (STRESS_GETBIT(allowed, n)) {
+					remote = n;
+					break;
+				}
+			}
+			if (remote == max_node) {
+				pr_dbg("%s: no remote NUMA node for node %u, using local memory\n",
+					name, node);
+				ret = shim_set_mempolicy(MPOL_PREFERRED, NULL, 0);
+				break;
+			}
+			STRESS_SETBIT(nodemask, remote);
+		}
+		ret = shim_set_mempolicy(MPOL_BIND, nodemask, max_node);
+		break;
+	case STRESS_NUMA_POLICY_NODE:
+		STRESS_SETBIT(nodemask, numa_policy_node);
+		ret = shim_set_mempolicy(MPOL_BIND, nodemask, max_node);
+		break;
+	default:
+		break;
+	}
+	if (ret < 0)
+		goto err;
+
+	free(nodemask);
+	free(allowed);
+	return;
+err:
+	pr_inf("%s: cannot set --numa-policy %s, errno=%d (%s)\n",
+		name, numa_policy_name, errno, strerror(errno));
+	free(nodemask);
+	free(allowed);
+}
+
 #else
 int stress_numa_nodes(void)
 {
 	return 1;
 }
 
+long stress_numa_farthest_node(const unsigned long node)
+{
+	(void)node;
+
+	return -1;
+}
+
 int stress_numa_count_mem_nodes(unsigned long *max_node)
 {
 	*max_node = 0;
@@ -246,4 +579,17 @@ int stress_set_mbind(const char *arg)
 	(void)fprintf(stderr, "%s: setting NUMA memory policy binding not supported\n", option);
 	_exit(EXIT_FAILURE);
 }
+
+int stress_set_numa_policy(const char *arg)
+{
+	(void)arg;
+
+	(void)fprintf(stderr, "option --numa-policy: setting NUMA memory policy not supported\n");
+	_exit(EXIT_FAILURE);
+}
+
+void stress_numa_policy_apply(const char *name)
+{
+	(void)name;
+}
 #endif
@@ -19,8 +19,16 @@
 #ifndef CORE_NUMA_H
 #define CORE_NUMA_H
 
+#include "stress-ng.h"
+
 extern int stress_numa_count_mem_nodes(unsigned long *max_node);
 extern int stress_numa_nodes(void);
+extern long stress_numa_farthest_node(const unsigned long node);
 extern int stress_set_mbind(const char *arg);
+extern int stress_set_numa_policy(const char *arg);
+extern bool stress_numa_policy_enabled(void);
+extern void stress_numa_policy_apply(const char *name);
+extern void stress_numa_pages_sample(stress_stats_t *stats);
+extern void stress_numa_pages_dump(FILE *yaml, stress_stressor_t *stressors_list);
 
 #endif
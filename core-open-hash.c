@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-open-hash.h"
+
+#if defined(HAVE_IMMINTRIN_H) &&	\
+    defined(__SSE2__)
+#include <immintrin.h>
+#define HAVE_OPEN_HASH_SSE2	(1)
+#endif
+
+/*
+ *  Swiss table: slots are in groups of 16, each slot has a control
+ *  byte that is either empty, deleted or the low 7 bits of the hash
+ *  (H2). The high hash bits (H1) select the first group to probe and
+ *  all 16 control bytes of a group are matched against H2 at once.
+ */
+#define SWISS_GROUP		(16)
+#define SWISS_EMPTY		(0x80)
+#define SWISS_DELETED		(0xfe)
+
+/*
+ *  Robin hood table: the control byte is the distance of the entry
+ *  from its home slot plus 1, 0 for an empty slot.
+ */
+#define ROBINHOOD_DIST_MAX	(255)
+
+static inline uint32_t stress_open_hash_ctz(const uint32_t x)
+{
+#if defined(HAVE_BUILTIN_CTZ)
+	return (uint32_t)__builtin_ctz(x);
+#else
+	register uint32_t n = 0;
+	register uint32_t v = x;
+
+	while (!(v & 1)) {
+		v >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static inline uint64_t stress_open_hash_key_hash(
+	const stress_open_hash_t *table,
+	const uint64_t key)
+{
+	return table->hash ? table->hash(key) : stress_open_hash_mix64(key);
+}
+
+static inline bool stress_open_hash_key_eq(
+	const stress_open_hash_t *table,
+	const uint64_t key1,
+	const uint64_t key2)
+{
+	return table->eq ? table->eq(key1, key2) : (key1 == key2);
+}
+
+/*
+ *  stress_swiss_match()
+ *	bit mask of the control bytes in a group that equal h
+ */
+static inline uint32_t OPTIMIZE3 stress_swiss_match(const uint8_t *group, const uint8_t h)
+{
+#if defined(HAVE_OPEN_HASH_SSE2)
+	const __m128i ctrl = _mm_load_si128((const __m128i *)group);
+
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h)));
+#else
+	register uint32_t i, mask = 0;
+
+	for (i = 0; i < SWISS_GROUP; i++)
+		mask |= (uint32_t)(group[i] == h) << i;
+	return mask;
+#endif
+}
+
+/*
+ *  stress_swiss_match_free()
+ *	bit mask of the empty or deleted control bytes in a group,
+ *	these are the only control bytes with the top bit set
+ */
+static inline uint32_t OPTIMIZE3 stress_swiss_match_free(const uint8_t *group)
+{
+#if defined(HAVE_OPEN_HASH_SSE2)
+	return (uint32_t)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+	register uint32_t i, mask = 0;
+
+	for (i = 0; i < SWISS_GROUP; i++)
+		mask |= (uint32_t)(group[i] >> 7) << i;
+	return mask;
+#endif
+}
+
+/*
+ *  stress_open_hash_alloc()
+ *	allocate control bytes and slots for n_slots entries
+ */
+static int stress_open_hash_alloc(stress_open_hash_t *table, const size_t n_slots)
+{
+	/* 16 byte aligned control bytes for aligned group loads */
+	if (posix_memalign((void **)&table->ctrl, SWISS_GROUP, n_slots) != 0)
+		return -1;
+	table->slots = (stress_open_hash_slot_t *)calloc(n_slots, sizeof(*table->slots));
+	if (!table->slots) {
+		free(table->ctrl);
+		table->ctrl = NULL;
+		return -1;
+	}
+	(void)shim_memset(table->ctrl,
+		(table->type == STRESS_OPEN_HASH_SWISS) ? SWISS_EMPTY : 0, n_slots);
+	table->n_slots = n_slots;
+	table->count = 0;
+	table->deleted = 0;
+	return 0;
+}
+
+/*
+ *  stress_open_hash_create()
+ *	create an open addressing hash table for n entries, the swiss
+ *	table is sized to be at most 7/8 full, robin hood 9/10 full
+ */
+stress_open_hash_t *stress_open_hash_create(
+	const stress_open_hash_type_t type,
+	const size_t n,
+	stress_open_hash_func_t hash,
+	stress_open_hash_eq_t eq)
+{
+	stress_open_hash_t *table;
+	size_t n_slots, max_count;
+
+	for (n_slots = SWISS_GROUP; ; n_slots <<= 1) {
+		max_count = (type == STRESS_OPEN_HASH_SWISS) ?
+			(n_slots / 8) * 7 : (n_slots / 10) * 9;
+		if (max_count >= n)
+			break;
+		if (n_slots > (SIZE_MAX >> 2))
+			return NULL;
+	}
+
+	table = (stress_open_hash_t *)calloc(1, sizeof(*table));
+	if (!table)
+		return NULL;
+	table->type = type;
+	table->hash = hash;
+	table->eq = eq;
+	table->max_count = max_count;
+	if (stress_open_hash_alloc(table, n_slots) < 0) {
+		free(table);
+		return NULL;
+	}
+	return table;
+}
+
+/*
+ *  stress_open_hash_destroy()
+ *	free a hash table
+ */
+void stress_open_hash_destroy(stress_open_hash_t *table)
+{
+	if (!table)
+		return;
+	free(table->slots);
+	free(table->ctrl);
+	free(table);
+}
+
+/*
+ *  stress_open_hash_bytes()
+ *	memory used by the table
+ */
+size_t stress_open_hash_bytes(const stress_open_hash_t *table)
+{
+	return sizeof(*table) + (table->n_slots * (sizeof(*table->ctrl) + sizeof(*table->slots)));
+}
+
+/*
+ *  stress_swiss_find()
+ *	find the slot of key, returns n_slots if not found
+ */
+static inline size_t OPTIMIZE3 stress_swiss_find(
+	const stress_open_hash_t *table,
+	const uint64_t hash,
+	const uint64_t key)
+{
+	const size_t group_mask = (table->n_slots / SWISS_GROUP) - 1;
+	const uint8_t h2 = (uint8_t)(hash & 0x7f);
+	register size_t g = (size_t)(hash >> 7) & group_mask;
+	register size_t i;
+
+	for (i = 0; i <= group_mask; i++) {
+		const uint8_t *group = table->ctrl + (g * SWISS_GROUP);
+		register uint32_t match = stress_swiss_match(group, h2);
+
+		while (match) {
+			const size_t idx = (g * SWISS_GROUP) + stress_open_hash_ctz(match);
+
+			if (stress_open_hash_key_eq(table, table->slots[idx].key, key))
+				return idx;
+			match &= match - 1;
+		}
+		/* an empty slot ends the probe sequence */
+		if (stress_swiss_match(group, SWISS_EMPTY))
+			break;
+		/* triangular probing visits every group */
+		g = (g + i + 1) & group_mask;
+	}
+	return table->n_slots;
+}
+
+/*
+ *  stress_swiss_insert()
+ *	insert a key known not to be in the table
+ */
+static size_t OPTIMIZE3 stress_swiss_insert(
+	stress_open_hash_t *table,
+	const uint64_t hash,
+	const uint64_t key,
+	const uint64_t value)
+{
+	const size_t group_mask = (table->n_slots / SWISS_GROUP) - 1;
+	register size_t g = (size_t)(hash >> 7) & group_mask;
+	register size_t i;
+
+	for (i = 0; i <= group_mask; i++) {
+		const uint32_t free_slots = stress_swiss_match_free(table->ctrl + (g * SWISS_GROUP));
+
+		if (free_slots) {
+			const size_t idx = (g * SWISS_GROUP) + stress_open_hash_ctz(free_slots);
+
+			if (table->ctrl[idx] == SWISS_DELETED)
+				table->deleted--;
+			table->ctrl[idx] = (uint8_t)(hash & 0x7f);
+			table->slots[idx].key = key;
+			table->slots[idx].value = value;
+			table->count++;
+			return idx;
+		}
+		g = (g + i + 1) & group_mask;
+	}
+	return table->n_slots;
+}
+
+/*
+ *  stress_swiss_rehash()
+ *	rebuild the table to drop the deleted slot tombstones
+ */
+static int stress_swiss_rehash(stress_open_hash_t *table)
+{
+	stress_open_hash_t old = *table;
+	size_t i;
+
+	if (stress_open_hash_alloc(table, old.n_slots) < 0) {
+		*table = old;
+		return -1;
+	}
+	for (i = 0; i < old.n_slots; i++) {
+		if (!(old.ctrl[i] & 0x80)) {
+			const stress_open_hash_slot_t *slot = &old.slots[i];
+
+			(void)stress_swiss_insert(table,
+				stress_open_hash_key_hash(table, slot->key),
+				slot->key, slot->value);
+		}
+	}
+	free(old.slots);
+	free(old.ctrl);
+	return 0;
+}
+
+/*
+ *  stress_robinhood_find()
+ *	find the slot of key, returns n_slots if not found
+ */
+static inline size_t OPTIMIZE3 stress_robinhood_find(
+	const stress_open_hash_t *table,
+	const uint64_t hash,
+	const uint64_t key)
+{
+	const size_t mask = table->n_slots - 1;
+	register size_t idx = (size_t)hash & mask;
+	register uint32_t dist;
+
+	/* entries further from home than dist cannot be key */
+	for (dist = 1; table->ctrl[idx] >= dist; dist++) {
+		if ((table->ctrl[idx] == dist) &&
+		    stress_open_hash_key_eq(table, table->slots[idx].key, key))
+			return idx;
+		idx = (idx + 1) & mask;
+	}
+	return table->n_slots;
+}
+
+/*
+ *  stress_robinhood_insert()
+ *	insert a key known not to be in the table, an entry closer
+ *	to its home slot than the entry being inserted gives up its
+ *	slot and is carried on to be re-inserted further along
+ */
+static size_t OPTIMIZE3 stress_robinhood_insert(
+	stress_open_hash_t *table,
+	const uint64_t hash,
+	const uint64_t key,
+	const uint64_t value)
+{
+	const size_t mask = table->n_slots - 1;
+	stress_open_hash_slot_t entry = { key, value };
+	register size_t idx = (size_t)hash & mask;
+	size_t placed = table->n_slots;
+	uint32_t dist;
+
+	for (dist = 1; dist <= ROBINHOOD_DIST_MAX; dist++) {
+		const uint32_t ctrl = table->ctrl[idx];
+
+		if (ctrl == 0) {
+			table->ctrl[idx] = (uint8_t)dist;
+			table->slots[idx] = entry;
+			table->count++;
+			return (placed == table->n_slots) ? idx : placed;
+		}
+		if (ctrl < dist) {
+			const stress_open_hash_slot_t tmp = table->slots[idx];
+
+			table->ctrl[idx] = (uint8_t)dist;
+			table->slots[idx] = entry;
+			entry = tmp;
+			dist = ctrl;
+			if (placed == table->n_slots)
+				placed = idx;
+		}
+		idx = (idx + 1) & mask;
+	}
+	/* probe sequence too long, the carried entry is lost */
+	return table->n_slots;
+}
+
+/*
+ *  stress_open_hash_put()
+ *	put a key and value into the table, returns a pointer to
+ *	the value or NULL if the table is full
+ */
+uint64_t *stress_open_hash_put(
+	stress_open_hash_t *table,
+	const uint64_t key,
+	const uint64_t value)
+{
+	const uint64_t hash = stress_open_hash_key_hash(table, key);
+	size_t idx;
+
+	if (table->type == STRESS_OPEN_HASH_SWISS) {
+		idx = stress_swiss_find(table, hash, key);
+		if (idx < table->n_slots) {
+			table->slots[idx].value = value;
+			return &table->slots[idx].value;
+		}
+		if (table->count >= table->max_count)
+			return NULL;
+		/* too many tombstones lengthen probes, rebuild the table */
+		if ((table->count + table->deleted >= table->max_count) &&
+		    (stress_swiss_rehash(table) < 0))
+			return NULL;
+		idx = stress_swiss_insert(table, hash, key, value);
+	} else {
+		idx = stress_robinhood_find(table, hash, key);
+		if (idx < table->n_slots) {
+			table->slots[idx].value = value;
+			return &table->slots[idx].value;
+		}
+		if (table->count >= table->max_count)
+			return NULL;
+		idx = stress_robinhood_insert(table, hash, key, value);
+	}
+	return (idx < table->n_slots) ? &table->slots[idx].value : NULL;
+}
+
+/*
+ *  stress_open_hash_get()
+ *	get a pointer to the value of key, NULL if not found
+ */
+uint64_t *stress_open_hash_get(stress_open_hash_t *table, const uint64_t key)
+{
+	const uint64_t hash = stress_open_hash_key_hash(table, key);
+	const size_t idx = (table->type == STRESS_OPEN_HASH_SWISS) ?
+		stress_swiss_find(table, hash, key) :
+		stress_robinhood_find(table, hash, key);
+
+	return (idx < table->n_slots) ? &table->slots[idx].value : NULL;
+}
+
+/*
+ *  stress_open_hash_del()
+ *	delete key, returns false if not found
+ */
+bool stress_open_hash_del(stress_open_hash_t *table, const uint64_t key)
+{
+	const uint64_t hash = stress_open_hash_key_hash(table, key);
+	const size_t mask = table->n_slots - 1;
+	size_t idx, next;
+
+	if (table->type == STRESS_OPEN_HASH_SWISS) {
+		idx = stress_swiss_find(table, hash, key);
+		if (idx >= table->n_slots)
+			return false;
+		/*
+		 *  a probe for another key only passed through this group
+		 *  if it was full, so if it has an empty slot this slot
+		 *  can be marked empty rather than deleted
+		 */
+		if (stress_swiss_match(table->ctrl + (idx & ~(size_t)(SWISS_GROUP - 1)), SWISS_EMPTY)) {
+			table->ctrl[idx] = SWISS_EMPTY;
+		} else {
+			table->ctrl[idx] = SWISS_DELETED;
+			table->deleted++;
+		}
+		table->count--;
+		return true;
+	}
+
+	idx = stress_robinhood_find(table, hash, key);
+	if (idx >= table->n_slots)
+		return false;
+	/* shift following displaced entries back one slot, no tombstones */
+	for (next = (idx + 1) & mask; table->ctrl[next] > 1; next = (next + 1) & mask) {
+		table->ctrl[idx] = table->ctrl[next] - 1;
+		table->slots[idx] = table->slots[next];
+		idx = next;
+	}
+	table->ctrl[idx] = 0;
+	table->count--;
+	return true;
+}
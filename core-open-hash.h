@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_OPEN_HASH_H
+#define CORE_OPEN_HASH_H
+
+#include "stress-ng.h"
+
+/*
+ *  Open addressing hash tables of 64 bit keys and values. Keys are
+ *  hashed with stress_open_hash_mix64 and compared directly unless
+ *  hash and equality functions are given, e.g. for keys that are
+ *  pointers to strings.
+ */
+typedef enum {
+	STRESS_OPEN_HASH_SWISS,		/* control byte groups, SIMD probed */
+	STRESS_OPEN_HASH_ROBINHOOD,	/* linear probing, robin hood insert */
+} stress_open_hash_type_t;
+
+typedef uint64_t (*stress_open_hash_func_t)(const uint64_t key);
+typedef bool (*stress_open_hash_eq_t)(const uint64_t key1, const uint64_t key2);
+
+typedef struct {
+	uint64_t key;
+	uint64_t value;
+} stress_open_hash_slot_t;
+
+typedef struct {
+	stress_open_hash_type_t type;	/* table type */
+	size_t n_slots;			/* number of slots, a power of 2 */
+	size_t max_count;		/* maximum entries before table is full */
+	size_t count;			/* entries in use */
+	size_t deleted;			/* swiss deleted slot tombstones */
+	uint8_t *ctrl;			/* per slot control byte or probe distance */
+	stress_open_hash_slot_t *slots;	/* key and value slots */
+	stress_open_hash_func_t hash;	/* key hash, NULL to mix the key */
+	stress_open_hash_eq_t eq;	/* key equality, NULL to compare keys */
+} stress_open_hash_t;
+
+/*
+ *  stress_open_hash_mix64()
+ *	murmur3 64 bit finalizer, hashes integer keys
+ */
+static inline uint64_t stress_open_hash_mix64(register uint64_t x)
+{
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+extern WARN_UNUSED stress_open_hash_t *stress_open_hash_create(const stress_open_hash_type_t type,
+	const size_t n, stress_open_hash_func_t hash, stress_open_hash_eq_t eq);
+extern void stress_open_hash_destroy(stress_open_hash_t *table);
+extern uint64_t *stress_open_hash_put(stress_open_hash_t *table, const uint64_t key,
+	const uint64_t value);
+extern WARN_UNUSED uint64_t *stress_open_hash_get(stress_open_hash_t *table, const uint64_t key);
+extern bool stress_open_hash_del(stress_open_hash_t *table, const uint64_t key);
+extern WARN_UNUSED size_t stress_open_hash_bytes(const stress_open_hash_t *table);
+
+#endif
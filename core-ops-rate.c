@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-ops-rate.h"
+
+#define STRESS_OPS_RATE_MAX	(1.0E9)	/* 1 bogo op per nanosecond */
+
+typedef struct {
+	const double percentile;	/* percentile to report */
+	char *description;		/* metrics description */
+} stress_ops_rate_metric_t;
+
+/*
+ *  Schedule latency metrics, these sit just below the
+ *  stress_latency_metrics() slots at the top of the misc
+ *  metrics to keep clear of the stressor metrics
+ */
+static const stress_ops_rate_metric_t ops_rate_metrics[STRESS_OPS_RATE_METRICS] = {
+	{ 50.0,		"nanosecs schedule latency p50" },
+	{ 90.0,		"nanosecs schedule latency p90" },
+	{ 99.0,		"nanosecs schedule latency p99" },
+	{ 99.9,		"nanosecs schedule latency p99.9" },
+	{ 100.0,	"nanosecs schedule latency max" },
+};
+
+#define STRESS_OPS_RATE_METRICS_BASE \
+	(STRESS_MISC_METRICS_MAX - STRESS_LATENCY_METRICS - SIZEOF_ARRAY(ops_rate_metrics))
+
+static double ops_rate;		/* --ops-rate bogo ops per second, 0 = off */
+
+/*
+ *  stress_set_ops_rate()
+ *	parse --ops-rate option
+ */
+int stress_set_ops_rate(const char *arg)
+{
+	char *end;
+	double rate;
+
+	errno = 0;
+	rate = strtod(arg, &end);
+	if ((errno != 0) || (end == arg) || (*end != '\0') ||
+	    (rate <= 0.0) || (rate > STRESS_OPS_RATE_MAX)) {
+		(void)fprintf(stderr, "ops-rate must be a number greater than 0 "
+			"and no more than %.0f bogo ops per second\n", STRESS_OPS_RATE_MAX);
+		_exit(EXIT_FAILURE);
+	}
+	ops_rate = rate;
+	return 0;
+}
+
+/*
+ *  stress_ops_rate_init()
+ *	reset the pacing state of a stressor instance that is
+ *	about to start, returns NULL if --ops-rate is not enabled
+ *	so that stress_bogo_inc() and stress_bogo_add() skip pacing.
+ *	If measure is true and --ops-rate is not enabled the time
+ *	taken by each bogo op is recorded without any pacing
+ */
+struct stress_ops_rate *stress_ops_rate_init(stress_ops_rate_t *rate, const bool measure)
+{
+	(void)shim_memset(rate, 0, sizeof(*rate));
+	if ((ops_rate <= 0.0) && !measure)
+		return NULL;
+
+	rate->interval = (ops_rate > 0.0) ? 1.0 / ops_rate : 0.0;
+	rate->start = stress_time_now();
+	return rate;
+}
+
+/*
+ *  stress_ops_rate_pace()
+ *	called after inc bogo ops have completed, records the time
+ *	from when the first of these ops was scheduled to start to
+ *	now and then sleeps until the next op is scheduled to start.
+ *	The schedule is open loop, bogo op N is scheduled at
+ *	start + N * interval regardless of how long earlier ops
+ *	took, so a stall shows up as latency on every op that was
+ *	queued behind it rather than being hidden by the stall
+ *	delaying the following ops (coordinated omission)
+ */
+void stress_ops_rate_pace(struct stress_ops_rate *rate, const uint64_t inc)
+{
+	const double now = stress_time_now();
+	const double scheduled = rate->start + ((double)rate->ops * rate->interval);
+	double next;
+
+	/* unpaced, start is the completion time of the previous ops */
+	if (rate->interval <= 0.0) {
+		stress_latency_add(&rate->latency,
+			(uint64_t)(((now - rate->start) * STRESS_DBL_NANOSECOND) / (double)(inc ? inc : 1)));
+		rate->ops += inc;
+		rate->start = now;
+		return;
+	}
+
+	stress_latency_add(&rate->latency,
+		(now > scheduled) ? (uint64_t)((now - scheduled) * STRESS_DBL_NANOSECOND) : 0);
+	rate->ops += inc;
+
+	next = rate->start + ((double)rate->ops * rate->interval);
+	if ((next > now) && stress_continue_flag())
+		(void)shim_nanosleep_uint64((uint64_t)((next - now) * STRESS_DBL_NANOSECOND));
+}
+
+/*
+ *  stress_ops_rate_metrics()
+ *	merge the schedule latency histograms of all the instances
+ *	of a stressor and set the merged percentiles as metrics
+ *	of each completed instance
+ */
+void stress_ops_rate_metrics(stress_stressor_t *ss)
+{
+	stress_latency_t *merged;
+	int32_t j;
+	size_t i;
+
+	if ((ops_rate <= 0.0) || !ss->stats)
+		return;
+
+	merged = (stress_latency_t *)calloc(1, sizeof(*merged));
+	if (!merged)
+		return;
+
+	for (j = 0; j < ss->num_instances; j++)
+		stress_latency_merge(merged, &ss->stats[j]->ops_rate.latency);
+
+	if (merged->count == 0) {
+		free(merged);
+		return;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(ops_rate_metrics); i++) {
+		const size_t idx = STRESS_OPS_RATE_METRICS_BASE + i;
+		const double ns = (double)stress_latency_percentile(merged, ops_rate_metrics[i].percentile);
+
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			if (stats->completed)
+				stress_metrics_set(&stats->args, idx, ops_rate_metrics[i].description,
+					ns, STRESS_MERGED_VALUE);
+		}
+	}
+	free(merged);
+}
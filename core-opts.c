@@ -29,7 +29,9 @@ const struct option stress_long_options[] = {
 	{ "acl-rand",		0,	0,	OPT_acl_rand },
 	{ "acl-ops",		1,	0,	OPT_acl_ops },
 	{ "af-alg",		1,	0,	OPT_af_alg },
+	{ "af-alg-aio-depth",	1,	0,	OPT_af_alg_aio_depth },
 	{ "af-alg-dump",	0,	0,	OPT_af_alg_dump },
+	{ "af-alg-mode",	1,	0,	OPT_af_alg_mode },
 	{ "af-alg-ops",		1,	0,	OPT_af_alg_ops },
 	{ "affinity",		1,	0,	OPT_affinity },
 	{ "affinity-delay",	1,	0,	OPT_affinity_delay },
@@ -37,12 +39,17 @@ const struct option stress_long_options[] = {
 	{ "affinity-pin",	0,	0,	OPT_affinity_pin },
 	{ "affinity-rand",	0,	0,	OPT_affinity_rand },
 	{ "affinity-sleep",	1,	0,	OPT_affinity_sleep },
+	{ "agent",		1,	0,	OPT_agent },
 	{ "aggressive",		0,	0,	OPT_aggressive },
 	{ "aio",		1,	0,	OPT_aio },
 	{ "aio-ops",		1,	0,	OPT_aio_ops },
 	{ "aio-requests",	1,	0,	OPT_aio_requests },
 	{ "aiol",		1,	0,	OPT_aiol},
+	{ "aiol-batch",		1,	0,	OPT_aiol_batch },
+	{ "aiol-eventfd",	0,	0,	OPT_aiol_eventfd },
+	{ "aiol-min-nr",	1,	0,	OPT_aiol_min_nr },
 	{ "aiol-ops",		1,	0,	OPT_aiol_ops },
+	{ "aiol-poll",		0,	0,	OPT_aiol_poll },
 	{ "aiol-requests",	1,	0,	OPT_aiol_requests },
 	{ "alarm",		1,	0,	OPT_alarm },
 	{ "alarm-ops",		1,	0,	OPT_alarm_ops },
@@ -51,15 +58,18 @@ const struct option stress_long_options[] = {
 	{ "apparmor-ops",	1,	0,	OPT_apparmor_ops },
 	{ "atomic",		1,	0,	OPT_atomic },
 	{ "atomic-ops",		1,	0,	OPT_atomic_ops },
+	{ "atomic-sweep",	0,	0,	OPT_atomic_sweep },
 	{ "bad-altstack",	1,	0,	OPT_bad_altstack },
 	{ "bad-altstack-ops",	1,	0,	OPT_bad_altstack_ops },
 	{ "bad-ioctl",		1,	0,	OPT_bad_ioctl },
 	{ "bad-ioctl-method",	1,	0,	OPT_bad_ioctl_method },
 	{ "bad-ioctl-ops",	1,	0,	OPT_bad_ioctl_ops },
 	{ "backoff",		1,	0,	OPT_backoff },
+	{ "benchmark",		1,	0,	OPT_benchmark },
 	{ "bigheap",		1,	0,	OPT_bigheap },
 	{ "bigheap-bytes",	1,	0,	OPT_bigheap_bytes },
 	{ "bigheap-growth",	1,	0,	OPT_bigheap_growth },
+	{ "bigheap-method",	1,	0,	OPT_bigheap_method },
 	{ "bigheap-mlock",	0,	0,	OPT_bigheap_mlock },
 	{ "bigheap-ops",	1,	0,	OPT_bigheap_ops },
 	{ "bind-mount",		1,	0,	OPT_bind_mount },
@@ -69,8 +79,10 @@ const struct option stress_long_options[] = {
 	{ "bitonicsort",	1,	0,	OPT_bitonicsort },
 	{ "bitonicsort-ops",	1,	0,	OPT_bitonicsort_ops },
 	{ "bitonicsort-size",	1,	0,	OPT_bitonicsort_size },
+	{ "bogo-overhead",	0,	0,	OPT_bogo_overhead },
 	{ "branch",		1,	0,	OPT_branch },
 	{ "branch-ops",		1,	0,	OPT_branch_ops },
+	{ "branch-sweep",	0,	0,	OPT_branch_sweep },
 	{ "brk",		1,	0,	OPT_brk },
 	{ "brk-bytes",		1,	0,	OPT_brk_bytes },
 	{ "brk-mlock",		0,	0,	OPT_brk_mlock },
@@ -80,6 +92,7 @@ const struct option stress_long_options[] = {
 	{ "bsearch-method",	1,	0,	OPT_bsearch_method },
 	{ "bsearch-ops",	1,	0,	OPT_bsearch_ops },
 	{ "bsearch-size",	1,	0,	OPT_bsearch_size },
+	{ "bsearch-sweep",	0,	0,	OPT_bsearch_sweep },
 	{ "cache",		1,	0, 	OPT_cache },
 	{ "cache-size",		1,	0, 	OPT_cache_size},
 	{ "cache-cldemote",	0,	0,	OPT_cache_cldemote },
@@ -96,6 +109,7 @@ const struct option stress_long_options[] = {
 	{ "cache-ways",		1,	0,	OPT_cache_ways },
 	{ "cacheline",		1,	0, 	OPT_cacheline },
 	{ "cacheline-affinity",	0,	0,	OPT_cacheline_affinity },
+	{ "cacheline-matrix",	0,	0,	OPT_cacheline_matrix },
 	{ "cacheline-method",	1,	0,	OPT_cacheline_method },
 	{ "cacheline-ops",	1,	0,	OPT_cacheline_ops },
 	{ "cap",		1,	0, 	OPT_cap },
@@ -113,7 +127,10 @@ const struct option stress_long_options[] = {
 	{ "chroot",		1,	0, 	OPT_chroot},
 	{ "chroot-ops",		1,	0,	OPT_chroot_ops },
 	{ "cgroup",		1,	0,	OPT_cgroup },
+	{ "cgroup-cpu-max",	1,	0,	OPT_cgroup_cpu_max },
+	{ "cgroup-memory-max",	1,	0,	OPT_cgroup_memory_max },
 	{ "cgroup-ops",		1,	0,	OPT_cgroup_ops },
+	{ "cgroup-stats",	0,	0,	OPT_cgroup_stats },
 	{ "class",		1,	0,	OPT_class },
 	{ "clock",		1,	0,	OPT_clock },
 	{ "clock-ops",		1,	0,	OPT_clock_ops },
@@ -122,24 +139,33 @@ const struct option stress_long_options[] = {
 	{ "clone-ops",		1,	0,	OPT_clone_ops },
 	{ "close",		1,	0,	OPT_close },
 	{ "close-ops",		1,	0,	OPT_close_ops },
+	{ "cluster-secret",	1,	0,	OPT_cluster_secret },
+	{ "compare",		1,	0,	OPT_compare },
+	{ "compare-threshold",	1,	0,	OPT_compare_threshold },
 	{ "config",		0,	0,	OPT_config },
 	{ "context",		1,	0,	OPT_context },
 	{ "context-ops",	1,	0,	OPT_context_ops },
+	{ "controller",	1,	0,	OPT_controller },
 	{ "copy-file",		1,	0,	OPT_copy_file },
 	{ "copy-file-bytes",	1,	0,	OPT_copy_file_bytes },
 	{ "copy-file-ops",	1,	0,	OPT_copy_file_ops },
 	{ "cpu",		1,	0,	OPT_cpu },
 	{ "cpu-ops",		1,	0,	OPT_cpu_ops },
+	{ "cpu-calibrate",	1,	0,	OPT_cpu_calibrate },
 	{ "cpu-load",		1,	0,	OPT_cpu_load },
 	{ "cpu-load-slice",	1,	0,	OPT_cpu_load_slice },
 	{ "cpu-method",		1,	0,	OPT_cpu_method },
+	{ "cpu-profile",	1,	0,	OPT_cpu_profile },
+	{ "cpu-vector",		1,	0,	OPT_cpu_vector },
 	{ "cpu-online",		1,	0,	OPT_cpu_online },
 	{ "cpu-online-affinity",0,	0,	OPT_cpu_online_affinity },
 	{ "cpu-online-all",	0,	0,	OPT_cpu_online_all },
+	{ "cpu-online-load",	0,	0,	OPT_cpu_online_load },
 	{ "cpu-online-ops",	1,	0,	OPT_cpu_online_ops },
 	{ "crypt",		1,	0,	OPT_crypt },
 	{ "crypt-method",	1,	0,	OPT_crypt_method },
 	{ "crypt-ops",		1,	0,	OPT_crypt_ops },
+	{ "cstate-stats",	0,	0,	OPT_cstate_stats },
 	{ "cyclic",		1,	0,	OPT_cyclic },
 	{ "cyclic-dist",	1,	0,	OPT_cyclic_dist },
 	{ "cyclic-method",	1,	0,	OPT_cyclic_method },
@@ -148,6 +174,7 @@ const struct option stress_long_options[] = {
 	{ "cyclic-prio",	1,	0,	OPT_cyclic_prio },
 	{ "cyclic-samples",	1,	0,	OPT_cyclic_samples },
 	{ "cyclic-sleep",	1,	0,	OPT_cyclic_sleep },
+	{ "cyclic-smp",		0,	0,	OPT_cyclic_smp },
 	{ "daemon",		1,	0,	OPT_daemon },
 	{ "daemon-ops",		1,	0,	OPT_daemon_ops },
 	{ "daemon-wait",	0,	0,	OPT_daemon_wait },
@@ -180,7 +207,10 @@ const struct option stress_long_options[] = {
 	{ "dirdeep-ops",	1,	0,	OPT_dirdeep_ops },
 	{ "dirmany",		1,	0,	OPT_dirmany },
 	{ "dirmany-bytes",	1,	0,	OPT_dirmany_bytes },
+	{ "dirmany-files",	1,	0,	OPT_dirmany_files },
+	{ "dirmany-mdtest",	0,	0,	OPT_dirmany_mdtest },
 	{ "dirmany-ops",	1,	0,	OPT_dirmany_ops },
+	{ "dirmany-threads",	1,	0,	OPT_dirmany_threads },
 	{ "dry-run",		0,	0,	OPT_dry_run },
 	{ "dnotify",		1,	0,	OPT_dnotify },
 	{ "dnotify-ops",	1,	0,	OPT_dnotify_ops },
@@ -188,12 +218,16 @@ const struct option stress_long_options[] = {
 	{ "dup-ops",		1,	0,	OPT_dup_ops },
 	{ "dynlib",		1,	0,	OPT_dynlib },
 	{ "dynlib-ops",		1,	0,	OPT_dynlib_ops },
+	{ "dynlib-sweep",	0,	0,	OPT_dynlib_sweep },
 	{ "eigen",		1,	0,	OPT_eigen },
 	{ "eigen-ops",		1,	0,	OPT_eigen_ops },
 	{ "eigen-method",	1,	0,	OPT_eigen_method },
 	{ "eigen-size",		1,	0,	OPT_eigen_size },
+	{ "eigen-sweep",	0,	0,	OPT_eigen_sweep },
+	{ "eigen-threads",	1,	0,	OPT_eigen_threads },
 	{ "efivar",		1,	0,	OPT_efivar },
 	{ "efivar-ops",		1,	0,	OPT_efivar_ops },
+	{ "energy",		0,	0,	OPT_energy },
 	{ "enosys",		1,	0,	OPT_enosys },
 	{ "enosys-ops",		1,	0,	OPT_enosys_ops },
 	{ "env",		1,	0,	OPT_env },
@@ -202,12 +236,17 @@ const struct option stress_long_options[] = {
 	{ "epoll-domain",	1,	0,	OPT_epoll_domain },
 	{ "epoll-ops",		1,	0,	OPT_epoll_ops },
 	{ "epoll-port",		1,	0,	OPT_epoll_port },
+	{ "epoll-shard",	1,	0,	OPT_epoll_shard },
 	{ "epoll-sockets",	1,	0,	OPT_epoll_sockets },
+	{ "epoll-threads",	1,	0,	OPT_epoll_threads },
 	{ "eventfd",		1,	0,	OPT_eventfd },
+	{ "eventfd-fds",	1,	0,	OPT_eventfd_fds },
 	{ "eventfd-nonblock",	0,	0,	OPT_eventfd_nonblock },
 	{ "eventfd-ops",	1,	0,	OPT_eventfd_ops },
+	{ "eventfd-reap",	1,	0,	OPT_eventfd_reap },
 	{ "exclude",		1,	0,	OPT_exclude },
 	{ "exec",		1,	0,	OPT_exec },
+	{ "exec-compare",	0,	0,	OPT_exec_compare },
 	{ "exec-fork-method",	1,	0,	OPT_exec_fork_method },
 	{ "exec-max",		1,	0,	OPT_exec_max },
 	{ "exec-method",	1,	0,	OPT_exec_method },
@@ -222,10 +261,14 @@ const struct option stress_long_options[] = {
 	{ "fallocate-bytes",	1,	0,	OPT_fallocate_bytes },
 	{ "fallocate-ops",	1,	0,	OPT_fallocate_ops },
 	{ "fanotify",		1,	0,	OPT_fanotify },
+	{ "fanotify-events",	0,	0,	OPT_fanotify_events },
+	{ "fanotify-marks",	1,	0,	OPT_fanotify_marks },
 	{ "fanotify-ops",	1,	0,	OPT_fanotify_ops },
+	{ "fanotify-rate",	1,	0,	OPT_fanotify_rate },
 	{ "far-branch",		1,	0,	OPT_far_branch },
 	{ "far-branch-ops",	1,	0,	OPT_far_branch_ops },
 	{ "far-branch-pages",	1,	0,	OPT_far_branch_pages },
+	{ "far-branch-sweep",	0,	0,	OPT_far_branch_sweep },
 	{ "fault",		1,	0,	OPT_fault },
 	{ "fault-ops",		1,	0,	OPT_fault_ops },
 	{ "fcntl",		1,	0,	OPT_fcntl},
@@ -250,11 +293,14 @@ const struct option stress_long_options[] = {
 	{ "flock-ops",		1,	0,	OPT_flock_ops },
 	{ "flushcache",		1,	0,	OPT_flushcache },
 	{ "flushcache-ops",	1,	0,	OPT_flushcache_ops },
+	{ "flushcache-sweep",	0,	0,	OPT_flushcache_sweep },
 	{ "fma",		1,	0,	OPT_fma },
 	{ "fma-ops",		1,	0,	OPT_fma_ops },
+	{ "fma-wide",		0,	0,	OPT_fma_wide },
 	{ "fork",		1,	0,	OPT_fork },
 	{ "fork-max",		1,	0,	OPT_fork_max },
 	{ "fork-ops",		1,	0,	OPT_fork_ops },
+	{ "fork-sweep",	1,	0,	OPT_fork_sweep },
 	{ "fork-unmap",		0,	0,	OPT_fork_unmap },
 	{ "fork-vm",		0,	0,	OPT_fork_vm },
 	{ "forkheavy",		1,	0,	OPT_forkheavy },
@@ -264,12 +310,15 @@ const struct option stress_long_options[] = {
 	{ "forkheavy-procs",	1,	0,	OPT_forkheavy_procs },
 	{ "fp",			1,	0,	OPT_fp },
 	{ "fp-method",		1,	0,	OPT_fp_method },
+	{ "fp-mode",		1,	0,	OPT_fp_mode },
 	{ "fp-ops",		1,	0,	OPT_fp_ops },
 	{ "fp-error",		1,	0,	OPT_fp_error},
+	{ "fp-error-mode",	1,	0,	OPT_fp_error_mode },
 	{ "fp-error-ops",	1,	0,	OPT_fp_error_ops },
 	{ "fpunch",		1,	0,	OPT_fpunch },
 	{ "fpunch-bytes",	1,	0,	OPT_fpunch_bytes },
 	{ "fpunch-ops",		1,	0,	OPT_fpunch_ops },
+	{ "freq-stats",		0,	0,	OPT_freq_stats },
 	{ "fsize",		1,	0,	OPT_fsize },
 	{ "fsize-ops",		1,	0,	OPT_fsize_ops },
 	{ "fstat",		1,	0,	OPT_fstat },
@@ -285,12 +334,17 @@ const struct option stress_long_options[] = {
 	{ "funcret-method",	1,	0,	OPT_funcret_method },
 	{ "funcret-ops",	1,	0,	OPT_funcret_ops },
 	{ "futex",		1,	0,	OPT_futex },
+	{ "futex-method",	1,	0,	OPT_futex_method },
 	{ "futex-ops",		1,	0,	OPT_futex_ops },
+	{ "futex-waiters",	1,	0,	OPT_futex_waiters },
 	{ "get",		1,	0,	OPT_get },
 	{ "get-ops",		1,	0,	OPT_get_ops },
 	{ "getrandom",		1,	0,	OPT_getrandom },
 	{ "getrandom-ops",	1,	0,	OPT_getrandom_ops },
+	{ "getrandom-sweep",	0,	0,	OPT_getrandom_sweep },
+	{ "getrandom-threads",	1,	0,	OPT_getrandom_threads },
 	{ "getdent",		1,	0,	OPT_getdent },
+	{ "getdent-entries",	1,	0,	OPT_getdent_entries },
 	{ "getdent-ops",	1,	0,	OPT_getdent_ops },
 	{ "goto",		1,	0,	OPT_goto },
 	{ "goto-direction", 	1,	0,	OPT_goto_direction },
@@ -298,6 +352,7 @@ const struct option stress_long_options[] = {
 	{ "gpu",		1,	0,	OPT_gpu },
 	{ "gpu-devnode",	1,	0,	OPT_gpu_devnode },
 	{ "gpu-frag",		1,	0,	OPT_gpu_frag },
+	{ "gpu-mode",		1,	0,	OPT_gpu_mode },
 	{ "gpu-ops",		1,	0,	OPT_gpu_ops },
 	{ "gpu-tex-size",	1,	0,	OPT_gpu_size },
 	{ "gpu-upload",		1,	0,	OPT_gpu_uploads },
@@ -305,11 +360,15 @@ const struct option stress_long_options[] = {
 	{ "gpu-ysize",		1,	0,	OPT_gpu_ysize },
 	{ "handle",		1,	0,	OPT_handle },
 	{ "handle-ops",		1,	0,	OPT_handle_ops },
+	{ "harness-profile",	0,	0,	OPT_harness_profile },
 	{ "hash",		1,	0,	OPT_hash },
+	{ "hash-bytes",		1,	0,	OPT_hash_bytes },
 	{ "hash-method",	1,	0,	OPT_hash_method },
 	{ "hash-ops",		1,	0,	OPT_hash_ops },
 	{ "hdd",		1,	0,	OPT_hdd },
 	{ "hdd-bytes",		1,	0,	OPT_hdd_bytes },
+	{ "hdd-engine",		1,	0,	OPT_hdd_engine },
+	{ "hdd-iodepth",	1,	0,	OPT_hdd_iodepth },
 	{ "hdd-ops",		1,	0,	OPT_hdd_ops },
 	{ "hdd-opts",		1,	0,	OPT_hdd_opts },
 	{ "hdd-write-size", 	1,	0,	OPT_hdd_write_size },
@@ -317,6 +376,7 @@ const struct option stress_long_options[] = {
 	{ "heapsort-method",	1,	0,	OPT_heapsort_method },
 	{ "heapsort-ops",	1,	0,	OPT_heapsort_ops },
 	{ "heapsort-size",	1,	0,	OPT_heapsort_size },
+	{ "heapsort-threads",	1,	0,	OPT_heapsort_threads },
 	{ "hrtimers",		1,	0,	OPT_hrtimers },
 	{ "hrtimers-adjust",	0,	0,	OPT_hrtimers_adjust },
 	{ "hrtimers-ops",	1,	0,	OPT_hrtimers_ops },
@@ -325,23 +385,33 @@ const struct option stress_long_options[] = {
 	{ "hsearch-method",	1,	0,	OPT_hsearch_method },
 	{ "hsearch-ops",	1,	0,	OPT_hsearch_ops },
 	{ "hsearch-size",	1,	0,	OPT_hsearch_size },
+	{ "huge-text",		0,	0,	OPT_huge_text },
 	{ "icache",		1,	0,	OPT_icache },
 	{ "icache-ops",		1,	0,	OPT_icache_ops },
 	{ "icmp-flood",		1,	0,	OPT_icmp_flood },
 	{ "icmp-flood-ops",	1,	0,	OPT_icmp_flood_ops },
 	{ "idle-page",		1,	0,	OPT_idle_page },
+	{ "idle-page-interval",1,	0,	OPT_idle_page_interval },
 	{ "idle-page-ops",	1,	0,	OPT_idle_page_ops },
+	{ "idle-page-wss",	1,	0,	OPT_idle_page_wss },
 	{ "ignite-cpu",		0,	0, 	OPT_ignite_cpu },
+	{ "ignite-cpu-ramp",	0,	0,	OPT_ignite_cpu_ramp },
+	{ "instance-model",	1,	0,	OPT_instance_model },
+	{ "interference",	0,	0,	OPT_interference },
 	{ "interrupts",		0,	0,	OPT_interrupts },
 	{ "inode-flags",	1,	0,	OPT_inode_flags },
 	{ "inode-flags-ops",	1,	0,	OPT_inode_flags_ops },
 	{ "inotify",		1,	0,	OPT_inotify },
+	{ "inotify-events",	0,	0,	OPT_inotify_events },
 	{ "inotify-ops",	1,	0,	OPT_inotify_ops },
+	{ "inotify-rate",	1,	0,	OPT_inotify_rate },
+	{ "inotify-watches",	1,	0,	OPT_inotify_watches },
 	{ "io",			1,	0,	OPT_io },
 	{ "io-ops",		1,	0,	OPT_io_ops },
 	{ "iomix",		1,	0,	OPT_iomix },
 	{ "iomix-bytes",	1,	0,	OPT_iomix_bytes },
 	{ "iomix-ops",		1,	0,	OPT_iomix_ops },
+	{ "iomix-profile",	1,	0,	OPT_iomix_profile },
 	{ "ionice-class",	1,	0,	OPT_ionice_class },
 	{ "ionice-level",	1,	0,	OPT_ionice_level },
 	{ "ioport",		1,	0,	OPT_ioport },
@@ -352,24 +422,34 @@ const struct option stress_long_options[] = {
 	{ "iostat",		1,	0,	OPT_iostat },
 	{ "io-uring",		1,	0,	OPT_io_uring },
 	{ "io-uring-entries",	1,	0,	OPT_io_uring_entries },
+	{ "io-uring-mode",	1,	0,	OPT_io_uring_mode },
 	{ "io-uring-ops",	1,	0,	OPT_io_uring_ops },
+	{ "io-uring-qd",	1,	0,	OPT_io_uring_qd },
 	{ "ipsec-mb",		1,	0,	OPT_ipsec_mb },
+	{ "ipsec-mb-burst",	1,	0,	OPT_ipsec_mb_burst },
 	{ "ipsec-mb-feature",	1,	0,	OPT_ipsec_mb_feature },
 	{ "ipsec-mb-jobs",	1,	0,	OPT_ipsec_mb_jobs },
 	{ "ipsec-mb-method",	1,	0,	OPT_ipsec_mb_method },
 	{ "ipsec-mb-ops",	1,	0,	OPT_ipsec_mb_ops },
+	{ "ipsec-mb-sweep",	0,	0,	OPT_ipsec_mb_sweep },
+	{ "irq-stats",		0,	0,	OPT_irq_stats },
 	{ "itimer",		1,	0,	OPT_itimer },
 	{ "itimer-freq",	1,	0,	OPT_itimer_freq },
 	{ "itimer-ops",		1,	0,	OPT_itimer_ops },
 	{ "itimer-rand",	0,	0,	OPT_itimer_rand },
 	{ "job",		1,	0,	OPT_job },
 	{ "jpeg",		1,	0,	OPT_jpeg },
+	{ "jpeg-decode",	0,	0,	OPT_jpeg_decode },
 	{ "jpeg-height",	1,	0,	OPT_jpeg_height },
 	{ "jpeg-image",		1,	0,	OPT_jpeg_image },
 	{ "jpeg-ops",		1,	0,	OPT_jpeg_ops },
 	{ "jpeg-quality",	1,	0,	OPT_jpeg_quality },
+	{ "jpeg-threads",	1,	0,	OPT_jpeg_threads },
 	{ "jpeg-width",		1,	0,	OPT_jpeg_width },
+	{ "jsonl",		1,	0,	OPT_jsonl },
 	{ "judy",		1,	0,	OPT_judy },
+	{ "judy-keys",		1,	0,	OPT_judy_keys },
+	{ "judy-method",	1,	0,	OPT_judy_method },
 	{ "judy-ops",		1,	0,	OPT_judy_ops },
 	{ "judy-size",		1,	0,	OPT_judy_size },
 	{ "kcmp",		1,	0,	OPT_kcmp },
@@ -385,17 +465,20 @@ const struct option stress_long_options[] = {
 	{ "klog-ops",		1,	0,	OPT_klog_ops },
 	{ "ksm",		0,	0,	OPT_ksm },
 	{ "kvm",		1,	0,	OPT_kvm },
+	{ "kvm-exits",		0,	0,	OPT_kvm_exits },
 	{ "kvm-ops",		1,	0,	OPT_kvm_ops },
 	{ "l1cache",		1,	0, 	OPT_l1cache },
 	{ "l1cache-line-size",	1,	0,	OPT_l1cache_line_size },
 	{ "l1cache-method",	1,	0,	OPT_l1cache_method },
 	{ "l1cache-mlock",	0,	0,	OPT_l1cache_mlock },
 	{ "l1cache-ops",	1,	0,	OPT_l1cache_ops },
+	{ "l1cache-probe",	0,	0,	OPT_l1cache_probe },
 	{ "l1cache-sets",	1,	0,	OPT_l1cache_sets},
 	{ "l1cache-size",	1,	0,	OPT_l1cache_size },
 	{ "l1cache-ways",	1,	0,	OPT_l1cache_ways},
 	{ "landlock",		1,	0,	OPT_landlock },
 	{ "landlock-ops",	1,	0,	OPT_landlock_ops },
+	{ "launcher",		1,	0,	OPT_launcher },
 	{ "led",		1,	0,	OPT_led },
 	{ "led-ops",		1,	0,	OPT_led_ops },
 	{ "lease",		1,	0,	OPT_lease },
@@ -405,6 +488,7 @@ const struct option stress_long_options[] = {
 	{ "link-ops",		1,	0,	OPT_link_ops },
 	{ "link-sync",		0,	0,	OPT_link_sync },
 	{ "list",		1,	0,	OPT_list },
+	{ "list-layout",	1,	0,	OPT_list_layout },
 	{ "list-method",	1,	0,	OPT_list_method },
 	{ "list-ops",		1,	0,	OPT_list_ops },
 	{ "list-size",		1,	0,	OPT_list_size },
@@ -427,10 +511,13 @@ const struct option stress_long_options[] = {
 	{ "log-brief",		0,	0,	OPT_log_brief },
 	{ "log-file",		1,	0,	OPT_log_file },
 	{ "log-lockless",	0,	0,	OPT_log_lockless },
+	{ "log-ring",		0,	0,	OPT_log_ring },
 	{ "longjmp",		1,	0,	OPT_longjmp },
 	{ "longjmp-ops",	1,	0,	OPT_longjmp_ops },
 	{ "loop",		1,	0,	OPT_loop },
+	{ "loop-bytes",		1,	0,	OPT_loop_bytes },
 	{ "loop-ops",		1,	0,	OPT_loop_ops },
+	{ "loop-sweep",		0,	0,	OPT_loop_sweep },
 	{ "lsearch",		1,	0,	OPT_lsearch },
 	{ "lsearch-method",	1,	0,	OPT_lsearch_method },
 	{ "lsearch-ops",	1,	0,	OPT_lsearch_ops },
@@ -439,11 +526,15 @@ const struct option stress_long_options[] = {
 	{ "madvise-ops",	1,	0,	OPT_madvise_ops },
 	{ "madvise-hwpoison",	0,	0,	OPT_madvise_hwpoison },
 	{ "malloc",		1,	0,	OPT_malloc },
+	{ "malloc-allocator",	1,	0,	OPT_malloc_allocator },
 	{ "malloc-bytes",	1,	0,	OPT_malloc_bytes },
+	{ "malloc-latency",	0,	0,	OPT_malloc_latency },
 	{ "malloc-max",		1,	0,	OPT_malloc_max },
 	{ "malloc-mlock",	0,	0,	OPT_malloc_mlock },
 	{ "malloc-ops",		1,	0,	OPT_malloc_ops },
 	{ "malloc-pthreads",	1,	0,	OPT_malloc_pthreads },
+	{ "malloc-size-file",	1,	0,	OPT_malloc_size_file },
+	{ "malloc-size-profile",1,	0,	OPT_malloc_size_profile },
 	{ "malloc-thresh",	1,	0,	OPT_malloc_threshold },
 	{ "malloc-touch",	0,	0,	OPT_malloc_touch },
 	{ "malloc-trim",	0,	0,	OPT_malloc_trim },
@@ -452,22 +543,27 @@ const struct option stress_long_options[] = {
 	{ "matrix-method",	1,	0,	OPT_matrix_method },
 	{ "matrix-ops",		1,	0,	OPT_matrix_ops },
 	{ "matrix-size",	1,	0,	OPT_matrix_size },
+	{ "matrix-sweep",	0,	0,	OPT_matrix_sweep },
 	{ "matrix-yx",		0,	0,	OPT_matrix_yx },
 	{ "matrix-3d",		1,	0,	OPT_matrix_3d },
 	{ "matrix-3d-method",	1,	0,	OPT_matrix_3d_method },
+	{ "matrix-3d-numa",	0,	0,	OPT_matrix_3d_numa },
 	{ "matrix-3d-ops",	1,	0,	OPT_matrix_3d_ops },
 	{ "matrix-3d-size",	1,	0,	OPT_matrix_3d_size },
+	{ "matrix-3d-threads",	1,	0,	OPT_matrix_3d_threads },
 	{ "matrix-3d-zyx",	0,	0,	OPT_matrix_3d_zyx },
 	{ "maximize",		0,	0,	OPT_maximize },
 	{ "max-fd",		1,	0,	OPT_max_fd },
 	{ "mbind",		1,	0,	OPT_mbind },
 	{ "mcontend",		1,	0,	OPT_mcontend },
+	{ "mcontend-false-sharing",0,	0,	OPT_mcontend_false_sharing },
 	{ "mcontend-ops",	1,	0,	OPT_mcontend_ops },
 	{ "membarrier",		1,	0,	OPT_membarrier },
 	{ "membarrier-ops",	1,	0,	OPT_membarrier_ops },
 	{ "memcpy",		1,	0,	OPT_memcpy },
 	{ "memcpy-method",	1,	0,	OPT_memcpy_method },
 	{ "memcpy-ops",		1,	0,	OPT_memcpy_ops },
+	{ "memcpy-sweep",	0,	0,	OPT_memcpy_sweep },
 	{ "memfd",		1,	0,	OPT_memfd },
 	{ "memfd-bytes",	1,	0,	OPT_memfd_bytes },
 	{ "memfd-fds",		1,	0,	OPT_memfd_fds },
@@ -480,16 +576,20 @@ const struct option stress_long_options[] = {
 	{ "memrate",		1,	0,	OPT_memrate },
 	{ "memrate-bytes",	1,	0,	OPT_memrate_bytes },
 	{ "memrate-flush",	0,	0,	OPT_memrate_flush },
+	{ "memrate-latency",	0,	0,	OPT_memrate_latency },
+	{ "memrate-latency-threads",1,	0,	OPT_memrate_latency_threads },
 	{ "memrate-ops",	1,	0,	OPT_memrate_ops },
 	{ "memrate-rd-mbs",	1,	0,	OPT_memrate_rd_mbs },
 	{ "memrate-wr-mbs",	1,	0,	OPT_memrate_wr_mbs },
 	{ "memthrash",		1,	0,	OPT_memthrash },
 	{ "memthrash-method",	1,	0,	OPT_memthrash_method },
+	{ "memthrash-numa-compare",0,	0,	OPT_memthrash_numa_compare },
 	{ "memthrash-ops",	1,	0,	OPT_memthrash_ops },
 	{ "mergesort",		1,	0,	OPT_mergesort },
 	{ "mergesort-method",	1,	0,	OPT_mergesort_method },
 	{ "mergesort-ops",	1,	0,	OPT_mergesort_ops },
 	{ "mergesort-size",	1,	0,	OPT_mergesort_size },
+	{ "mergesort-threads",1,	0,	OPT_mergesort_threads },
 	{ "metamix",		1,	0,	OPT_metamix },
         { "metamix-ops",	1,	0,	OPT_metamix_ops },
         { "metamix-bytes",	1,	0,	OPT_metamix_bytes },
@@ -513,6 +613,7 @@ const struct option stress_long_options[] = {
 	{ "mmap-async",		0,	0,	OPT_mmap_async },
 	{ "mmap-bytes",		1,	0,	OPT_mmap_bytes },
 	{ "mmap-file",		0,	0,	OPT_mmap_file },
+	{ "mmap-latency",	0,	0,	OPT_mmap_latency },
 	{ "mmap-madvise",	0,	0,	OPT_mmap_madvise },
 	{ "mmap-mergeable",	0,	0,	OPT_mmap_mergeable },
 	{ "mmap-mprotect",	0,	0,	OPT_mmap_mprotect },
@@ -523,6 +624,7 @@ const struct option stress_long_options[] = {
 	{ "mmap-osync",		0,	0,	OPT_mmap_osync },
 	{ "mmap-slow-munmap",	0,	0,	OPT_mmap_slow_munmap },
 	{ "mmap-stressful",	0,	0,	OPT_mmap_stressful },
+	{ "mmap-threads",	1,	0,	OPT_mmap_threads },
 	{ "mmap-write-check",	0,	0,	OPT_mmap_write_check },
 	{ "mmapaddr",		1,	0,	OPT_mmapaddr },
 	{ "mmapaddr-mlock",	0,	0,	OPT_mmapaddr_mlock },
@@ -530,6 +632,7 @@ const struct option stress_long_options[] = {
 	{ "mmapfiles",		1,	0,	OPT_mmapfiles },
 	{ "mmapfiles-ops",	1,	0,	OPT_mmapfiles_ops },
 	{ "mmapfiles-populate",	0,	0,	OPT_mmapfiles_populate },
+	{ "mmapfiles-read",	0,	0,	OPT_mmapfiles_read },
 	{ "mmapfiles-shared",	0,	0,	OPT_mmapfiles_shared },
 	{ "mmapfixed",		1,	0,	OPT_mmapfixed},
 	{ "mmapfixed-mlock",	0,	0,	OPT_mmapfixed_mlock },
@@ -560,15 +663,23 @@ const struct option stress_long_options[] = {
 	{ "mpfr",		1,	0,	OPT_mpfr },
 	{ "mpfr-ops",		1,	0,	OPT_mpfr_ops },
 	{ "mpfr-precision",	1,	0,	OPT_mpfr_precision },
+	{ "mpmc",		1,	0,	OPT_mpmc },
+	{ "mpmc-ops",		1,	0,	OPT_mpmc_ops },
+	{ "mpmc-method",	1,	0,	OPT_mpmc_method },
+	{ "mpmc-size",		1,	0,	OPT_mpmc_size },
+	{ "mpmc-threads",	1,	0,	OPT_mpmc_threads },
 	{ "mq",			1,	0,	OPT_mq },
+	{ "mq-ipc-sweep",	0,	0,	OPT_mq_ipc_sweep },
 	{ "mq-ops",		1,	0,	OPT_mq_ops },
 	{ "mq-size",		1,	0,	OPT_mq_size },
 	{ "mremap",		1,	0,	OPT_mremap },
 	{ "mremap-bytes",	1,	0,	OPT_mremap_bytes },
 	{ "mremap-mlock",	0,	0,	OPT_mremap_mlock },
 	{ "mremap-ops",		1,	0,	OPT_mremap_ops },
+	{ "mremap-sweep",	0,	0,	OPT_mremap_sweep },
 	{ "msg",		1,	0,	OPT_msg },
 	{ "msg-bytes",		1,	0,	OPT_msg_bytes },
+	{ "msg-ipc-sweep",	0,	0,	OPT_msg_ipc_sweep },
 	{ "msg-ops",		1,	0,	OPT_msg_ops },
 	{ "msg-types",		1,	0,	OPT_msg_types },
 	{ "msync",		1,	0,	OPT_msync },
@@ -580,6 +691,9 @@ const struct option stress_long_options[] = {
 	{ "munmap-ops",		1,	0,	OPT_munmap_ops },
 	{ "mutex",		1,	0,	OPT_mutex },
 	{ "mutex-affinity",	0,	0,	OPT_mutex_affinity },
+	{ "mutex-cs-work",	1,	0,	OPT_mutex_cs_work },
+	{ "mutex-method",	1,	0,	OPT_mutex_method },
+	{ "mutex-ncs-work",	1,	0,	OPT_mutex_ncs_work },
 	{ "mutex-ops",		1,	0,	OPT_mutex_ops },
 	{ "mutex-procs",	1,	0,	OPT_mutex_procs },
 	{ "nanosleep",		1,	0,	OPT_nanosleep },
@@ -605,7 +719,9 @@ const struct option stress_long_options[] = {
 	{ "null-write",		0,	0,	OPT_null_write },
 	{ "numa",		1,	0,	OPT_numa },
 	{ "numa-bytes",		1,	0,	OPT_numa_bytes },
+	{ "numa-migrate-sweep",0,	0,	OPT_numa_migrate_sweep },
 	{ "numa-ops",		1,	0,	OPT_numa_ops },
+	{ "numa-policy",	1,	0,	OPT_numa_policy },
 	{ "numa-shuffle-addr",	0,	0,	OPT_numa_shuffle_addr },
 	{ "numa-shuffle-node",	0,	0,	OPT_numa_shuffle_node },
 	{ "oomable",		0,	0,	OPT_oomable },
@@ -620,6 +736,7 @@ const struct option stress_long_options[] = {
 	{ "open-fd",		0,	0,	OPT_open_fd },
 	{ "open-max",		1,	0,	OPT_open_max },
 	{ "open-ops",		1,	0,	OPT_open_ops },
+	{ "ops-rate",		1,	0,	OPT_ops_rate },
 	{ "page-in",		0,	0,	OPT_page_in },
 	{ "pagemove",		1,	0,	OPT_pagemove },
 	{ "pagemove-bytes",	1,	0,	OPT_pagemove_bytes },
@@ -634,6 +751,8 @@ const struct option stress_long_options[] = {
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ "perf",		0,	0,	OPT_perf_stats },
+	{ "perf-events",	1,	0,	OPT_perf_events },
+	{ "perf-metric",	1,	0,	OPT_perf_metric },
 #endif
 	{ "permute",		1,	0,	OPT_permute },
 	{ "personality",	1,	0,	OPT_personality },
@@ -649,6 +768,7 @@ const struct option stress_long_options[] = {
 	{ "ping-sock-ops",	1,	0,	OPT_ping_sock_ops },
 	{ "pipe",		1,	0,	OPT_pipe },
 	{ "pipe-data-size",	1,	0,	OPT_pipe_data_size },
+	{ "pipe-ipc-sweep",	0,	0,	OPT_pipe_ipc_sweep },
 	{ "pipe-ops",		1,	0,	OPT_pipe_ops },
 #if defined(F_SETPIPE_SZ)
 	{ "pipe-size",		1,	0,	OPT_pipe_size },
@@ -657,6 +777,7 @@ const struct option stress_long_options[] = {
 	{ "pipeherd",		1,	0,	OPT_pipeherd },
 	{ "pipeherd-ops",	1,	0,	OPT_pipeherd_ops },
 	{ "pipeherd-yield", 	0,	0,	OPT_pipeherd_yield },
+	{ "placement",		1,	0,	OPT_placement },
 	{ "pkey",		1,	0,	OPT_pkey },
 	{ "pkey-ops",		1,	0,	OPT_pkey_ops },
 	{ "plugin",		1,	0,	OPT_plugin },
@@ -672,6 +793,7 @@ const struct option stress_long_options[] = {
 	{ "prefetch-l3-size",	1,	0,	OPT_prefetch_l3_size },
 	{ "prefetch-method",	1,	0,	OPT_prefetch_method },
 	{ "prefetch-ops",	1,	0,	OPT_prefetch_ops },
+	{ "prefetch-sweep",	0,	0,	OPT_prefetch_sweep },
 	{ "prio-inv",		1,	0,	OPT_prio_inv },
 	{ "prio-inv-ops",	1,	0,	OPT_prio_inv_ops },
 	{ "prio-inv-policy",	1,	0,	OPT_prio_inv_policy },
@@ -679,9 +801,13 @@ const struct option stress_long_options[] = {
 	{ "priv-instr",		1,	0,	OPT_priv_instr },
 	{ "priv-instr-ops",	1,	0,	OPT_priv_instr_ops },
 	{ "procfs",		1,	0,	OPT_procfs },
+	{ "procfs-latency",	1,	0,	OPT_procfs_latency },
 	{ "procfs-ops",		1,	0,	OPT_procfs_ops },
+	{ "procfs-yaml",	1,	0,	OPT_procfs_yaml },
 	{ "progress",		0,	0,	OPT_progress },
+	{ "psistat",		1,	0,	OPT_psistat },
 	{ "pthread",		1,	0,	OPT_pthread },
+	{ "pthread-compare",	0,	0,	OPT_pthread_compare },
 	{ "pthread-max",	1,	0,	OPT_pthread_max },
 	{ "pthread-ops",	1,	0,	OPT_pthread_ops },
 	{ "ptrace",		1,	0,	OPT_ptrace },
@@ -693,6 +819,7 @@ const struct option stress_long_options[] = {
 	{ "qsort-method",	1,	0,	OPT_qsort_method },
 	{ "qsort-ops",		1,	0,	OPT_qsort_ops },
 	{ "qsort-size",		1,	0,	OPT_qsort_integers },
+	{ "qsort-threads",	1,	0,	OPT_qsort_threads },
 	{ "quiet",		0,	0,	OPT_quiet },
 	{ "quota",		1,	0,	OPT_quota },
 	{ "quota-ops",		1,	0,	OPT_quota_ops },
@@ -710,16 +837,23 @@ const struct option stress_long_options[] = {
 	{ "randlist",		1,	0,	OPT_randlist },
 	{ "randlist-compact",	0,	0,	OPT_randlist_compact },
 	{ "randlist-items", 	1,	0,	OPT_randlist_items },
+	{ "randlist-latency",	0,	0,	OPT_randlist_latency },
+	{ "randlist-latency-huge",0,	0,	OPT_randlist_latency_huge },
+	{ "randlist-latency-order",1,	0,	OPT_randlist_latency_order },
 	{ "randlist-ops",	1,	0,	OPT_randlist_ops },
 	{ "randlist-size", 	1,	0,	OPT_randlist_size },
 	{ "random",		1,	0,	OPT_random },
 	{ "rawdev",		1,	0,	OPT_rawdev },
+	{ "rawdev-iosweep",	0,	0,	OPT_rawdev_iosweep },
 	{ "rawdev-method",	1,	0,	OPT_rawdev_method },
 	{ "rawdev-ops",		1,	0,	OPT_rawdev_ops },
 	{ "rawpkt",		1,	0,	OPT_rawpkt },
+	{ "rawpkt-if",		1,	0,	OPT_rawpkt_if },
 	{ "rawpkt-ops",		1,	0,	OPT_rawpkt_ops },
 	{ "rawpkt-port",	1,	0,	OPT_rawpkt_port },
 	{ "rawpkt-rxring",	1,	0,	OPT_rawpkt_rxring },
+	{ "rawpkt-txring",	1,	0,	OPT_rawpkt_txring },
+	{ "rawpkt-xdp",		1,	0,	OPT_rawpkt_xdp },
 	{ "rawsock",		1,	0,	OPT_rawsock },
 	{ "rawsock-ops",	1,	0,	OPT_rawsock_ops },
 	{ "rawsock-port",	1,	0,	OPT_rawsock_port },
@@ -732,6 +866,7 @@ const struct option stress_long_options[] = {
 	{ "rdrand-seed",	0,	0,	OPT_rdrand_seed },
 	{ "readahead",		1,	0,	OPT_readahead },
 	{ "readahead-bytes",	1,	0,	OPT_readahead_bytes },
+	{ "readahead-mode",	1,	0,	OPT_readahead_mode },
 	{ "readahead-ops",	1,	0,	OPT_readahead_ops },
 	{ "reboot",		1,	0,	OPT_reboot },
 	{ "reboot-ops",		1,	0,	OPT_reboot_ops },
@@ -745,6 +880,8 @@ const struct option stress_long_options[] = {
 	{ "rename-ops",		1,	0,	OPT_rename_ops },
 	{ "resched",		1,	0,	OPT_resched },
 	{ "resched-ops",	1,	0,	OPT_resched_ops },
+	{ "resctrl",		1,	0,	OPT_resctrl },
+	{ "resctrl-stats",	0,	0,	OPT_resctrl_stats },
 	{ "resources",		1,	0,	OPT_resources },
 	{ "resources-mlock",	0,	0,	OPT_resources_mlock },
 	{ "resources-ops",	1,	0,	OPT_resources_ops },
@@ -765,9 +902,12 @@ const struct option stress_long_options[] = {
 	{ "rotate-method",	1,	0,	OPT_rotate_method },
 	{ "rotate-ops",		1,	0,	OPT_rotate_ops },
 	{ "rseq",		1,	0,	OPT_rseq },
+	{ "rseq-bench",		0,	0,	OPT_rseq_bench },
 	{ "rseq-ops",		1,	0,	OPT_rseq_ops },
 	{ "rtc",		1,	0,	OPT_rtc },
 	{ "rtc-ops",		1,	0,	OPT_rtc_ops },
+	{ "sample-interval",	1,	0,	OPT_sample_interval },
+	{ "scale-sweep",	1,	0,	OPT_scale_sweep },
 	{ "sched",		1,	0,	OPT_sched },
 	{ "sched-deadline",	1,	0,	OPT_sched_deadline },
 	{ "sched-period",	1,	0,	OPT_sched_period },
@@ -775,17 +915,21 @@ const struct option stress_long_options[] = {
 	{ "sched-reclaim",	0,	0,      OPT_sched_reclaim },
 	{ "sched-runtime",	1,	0,	OPT_sched_runtime },
 	{ "schedmix",		1,	0,	OPT_schedmix },
+	{ "schedmix-latency",	0,	0,	OPT_schedmix_latency },
 	{ "schedmix-ops",	1,	0,	OPT_schedmix_ops },
 	{ "schedmix-procs",	1,	0,	OPT_schedmix_procs },
 	{ "schedpolicy",	1,	0,	OPT_schedpolicy },
 	{ "schedpolicy-ops",	1,	0,	OPT_schedpolicy_ops },
 	{ "schedpolicy-rand",	0,	0,	OPT_schedpolicy_rand },
 	{ "sctp",		1,	0,	OPT_sctp },
+	{ "sctp-batch",		1,	0,	OPT_sctp_batch },
 	{ "sctp-domain",	1,	0,	OPT_sctp_domain },
 	{ "sctp-if",		1,	0,	OPT_sctp_if },
 	{ "sctp-ops",		1,	0,	OPT_sctp_ops },
 	{ "sctp-port",		1,	0,	OPT_sctp_port },
 	{ "sctp-sched",		1,	0,	OPT_sctp_sched },
+	{ "sctp-streams",	1,	0,	OPT_sctp_streams },
+	{ "sctp-sweep",		0,	0,	OPT_sctp_sweep },
 	{ "seal",		1,	0,	OPT_seal },
 	{ "seal-ops",		1,	0,	OPT_seal_ops },
 	{ "seccomp",		1,	0,	OPT_seccomp },
@@ -820,6 +964,8 @@ const struct option stress_long_options[] = {
 	{ "shm-mlock",		0,	0,	OPT_shm_mlock },
 	{ "shm-objs",		1,	0,	OPT_shm_objects },
 	{ "shm-ops",		1,	0,	OPT_shm_ops },
+	{ "shm-ring",		0,	0,	OPT_shm_ring },
+	{ "shm-ring-producers",	1,	0,	OPT_shm_ring_producers },
 	{ "shm-sysv",		1,	0,	OPT_shm_sysv },
 	{ "shm-sysv-bytes",	1,	0,	OPT_shm_sysv_bytes },
 	{ "shm-sysv-mlock",	0,	0,	OPT_shm_sysv_mlock },
@@ -846,6 +992,7 @@ const struct option stress_long_options[] = {
 	{ "sigpipe",		1,	0,	OPT_sigpipe },
 	{ "sigpipe-ops",	1,	0,	OPT_sigpipe_ops },
 	{ "sigq",		1,	0,	OPT_sigq },
+	{ "sigq-latency",	0,	0,	OPT_sigq_latency },
 	{ "sigq-ops",		1,	0,	OPT_sigq_ops },
 	{ "sigrt",		1,	0,	OPT_sigrt },
 	{ "sigrt-ops",		1,	0,	OPT_sigrt_ops },
@@ -861,7 +1008,9 @@ const struct option stress_long_options[] = {
 	{ "sigxfsz-ops",	1,	0,	OPT_sigxfsz_ops },
 	{ "skiplist",		1,	0,	OPT_skiplist },
 	{ "skiplist-ops",	1,	0,	OPT_skiplist_ops },
+	{ "skiplist-read-pct",	1,	0,	OPT_skiplist_read_pct },
 	{ "skiplist-size",	1,	0,	OPT_skiplist_size },
+	{ "skiplist-threads",	1,	0,	OPT_skiplist_threads },
 	{ "skip-silent",	0,	0,	OPT_skip_silent },
 	{ "sleep",		1,	0,	OPT_sleep },
 	{ "sleep-max",		1,	0,	OPT_sleep_max },
@@ -871,14 +1020,20 @@ const struct option stress_long_options[] = {
 	{ "smi-ops",		1,	0,	OPT_smi_ops },
 	{ "sn",			0,	0,	OPT_sn },
 	{ "sock",		1,	0,	OPT_sock },
+	{ "sock-conns",		1,	0,	OPT_sock_conns },
 	{ "sock-domain",	1,	0,	OPT_sock_domain },
 	{ "sock-if",		1,	0,	OPT_sock_if },
+	{ "sock-ktls",		1,	0,	OPT_sock_ktls },
 	{ "sock-msgs",		1,	0,	OPT_sock_msgs },
 	{ "sock-nodelay",	0,	0,	OPT_sock_nodelay },
 	{ "sock-ops",		1,	0,	OPT_sock_ops },
 	{ "sock-opts",		1,	0,	OPT_sock_opts },
 	{ "sock-port",		1,	0,	OPT_sock_port },
 	{ "sock-protocol",	1,	0,	OPT_sock_protocol },
+	{ "sock-rr",		1,	0,	OPT_sock_rr },
+	{ "sock-rr-depth",	1,	0,	OPT_sock_rr_depth },
+	{ "sock-rr-req",	1,	0,	OPT_sock_rr_req },
+	{ "sock-rr-resp",	1,	0,	OPT_sock_rr_resp },
 	{ "sock-type",		1,	0,	OPT_sock_type },
 	{ "sock-zerocopy", 	0,	0,	OPT_sock_zerocopy },
 	{ "sockabuse",		1,	0,	OPT_sockabuse },
@@ -890,18 +1045,25 @@ const struct option stress_long_options[] = {
 	{ "sockfd-ops",		1,	0,	OPT_sockfd_ops },
 	{ "sockfd-port",	1,	0,	OPT_sockfd_port },
 	{ "sockmany",		1,	0,	OPT_sockmany },
+	{ "sockmany-churn",	1,	0,	OPT_sockmany_churn },
+	{ "sockmany-fastopen",	0,	0,	OPT_sockmany_fastopen },
 	{ "sockmany-if",	1,	0,	OPT_sockmany_if },
 	{ "sockmany-ops",	1,	0,	OPT_sockmany_ops },
 	{ "sockmany-port",	1,	0,	OPT_sockmany_port },
 	{ "sockpair",		1,	0,	OPT_sockpair },
+	{ "sockpair-ipc-sweep",0,	0,	OPT_sockpair_ipc_sweep },
 	{ "sockpair-ops",	1,	0,	OPT_sockpair_ops },
 	{ "softlockup",		1,	0,	OPT_softlockup },
 	{ "softlockup-ops",	1,	0,	OPT_softlockup_ops },
+	{ "sort-dist",		1,	0,	OPT_sort_dist },
+	{ "sort-dist-swaps",	1,	0,	OPT_sort_dist_swaps },
 	{ "sparsematrix",	1,	0,	OPT_sparsematrix},
 	{ "sparsematrix-items",	1,	0,	OPT_sparsematrix_items },
 	{ "sparsematrix-method",1,	0,	OPT_sparsematrix_method },
 	{ "sparsematrix-ops",	1,	0,	OPT_sparsematrix_ops },
 	{ "sparsematrix-size",	1,	0,	OPT_sparsematrix_size },
+	{ "sparsematrix-spmv",	1,	0,	OPT_sparsematrix_spmv },
+	{ "sparsematrix-threads",1,	0,	OPT_sparsematrix_threads },
 	{ "spawn",		1,	0,	OPT_spawn },
 	{ "spawn-ops",		1,	0,	OPT_spawn_ops },
 	{ "splice",		1,	0,	OPT_splice },
@@ -916,22 +1078,31 @@ const struct option stress_long_options[] = {
 	{ "stackmmap",		1,	0,	OPT_stackmmap },
 	{ "stackmmap-ops",	1,	0,	OPT_stackmmap_ops },
 	{ "status",		1,	0,	OPT_status },
+	{ "status-socket",	1,	0,	OPT_status_socket },
 	{ "stderr",		0,	0,	OPT_stderr },
 	{ "stdout",		0,	0,	OPT_stdout },
 	{ "str",		1,	0,	OPT_str },
+	{ "str-impl",		1,	0,	OPT_str_impl },
 	{ "str-method",		1,	0,	OPT_str_method },
 	{ "str-ops",		1,	0,	OPT_str_ops },
+	{ "str-sweep",		0,	0,	OPT_str_sweep },
 	{ "stressors",		0,	0,	OPT_stressors },
 	{ "stream",		1,	0,	OPT_stream },
 	{ "stream-index",	1,	0,	OPT_stream_index },
 	{ "stream-l3-size",	1,	0,	OPT_stream_l3_size },
 	{ "stream-madvise",	1,	0,	OPT_stream_madvise },
 	{ "stream-mlock",	0,	0,	OPT_stream_mlock },
+	{ "stream-numa-matrix",	0,	0,	OPT_stream_numa_matrix },
 	{ "stream-ops",		1,	0,	OPT_stream_ops },
+	{ "stream-sweep",	0,	0,	OPT_stream_sweep },
+	{ "stream-threads",	1,	0,	OPT_stream_threads },
 	{ "swap",		1,	0,	OPT_swap },
+	{ "swap-cluster-sweep",0,	0,	OPT_swap_cluster_sweep },
 	{ "swap-ops",		1,	0,	OPT_swap_ops },
+	{ "swap-zswap-compare",0,	0,	OPT_swap_zswap_compare },
 	{ "switch",		1,	0,	OPT_switch },
 	{ "switch-freq",	1,	0,	OPT_switch_freq },
+	{ "switch-latency",	0,	0,	OPT_switch_latency },
 	{ "switch-method",	1,	0,	OPT_switch_method },
 	{ "switch-ops",		1,	0,	OPT_switch_ops },
 	{ "symlink",		1,	0,	OPT_symlink },
@@ -939,7 +1110,10 @@ const struct option stress_long_options[] = {
 	{ "symlink-sync",	0,	0,	OPT_symlink_sync },
 	{ "sync-file",		1,	0,	OPT_sync_file },
 	{ "sync-file-bytes", 	1,	0,	OPT_sync_file_bytes },
+	{ "sync-file-journal",	0,	0,	OPT_sync_file_journal },
 	{ "sync-file-ops", 	1,	0,	OPT_sync_file_ops },
+	{ "sync-file-writers",	1,	0,	OPT_sync_file_writers },
+	{ "sync-start",		0,	0,	OPT_sync_start },
 	{ "syncload",		1,	0,	OPT_syncload },
 	{ "syncload-msbusy",	1,	0,	OPT_syncload_msbusy },
 	{ "syncload-mssleep",	1,	0,	OPT_syncload_mssleep },
@@ -947,11 +1121,15 @@ const struct option stress_long_options[] = {
 	{ "sysbadaddr",		1,	0,	OPT_sysbadaddr },
 	{ "sysbadaddr-ops",	1,	0,	OPT_sysbadaddr_ops },
 	{ "syscall",		1,	0,	OPT_syscall },
+	{ "syscall-compare",	1,	0,	OPT_syscall_compare },
 	{ "syscall-method",	1,	0,	OPT_syscall_method },
 	{ "syscall-ops",	1,	0,	OPT_syscall_ops },
 	{ "syscall-top",	1,	0,	OPT_syscall_top },
+	{ "syscall-yaml",	1,	0,	OPT_syscall_yaml },
 	{ "sysfs",		1,	0,	OPT_sysfs },
+	{ "sysfs-latency",	1,	0,	OPT_sysfs_latency },
 	{ "sysfs-ops",		1,	0,	OPT_sysfs_ops },
+	{ "sysfs-yaml",		1,	0,	OPT_sysfs_yaml },
 	{ "sysinfo",		1,	0,	OPT_sysinfo },
 	{ "sysinfo-ops",	1,	0,	OPT_sysinfo_ops },
 	{ "sysinval",		1,	0,	OPT_sysinval },
@@ -960,6 +1138,7 @@ const struct option stress_long_options[] = {
 	{ "syslog",		0,	0,	OPT_syslog },
 #endif
 	{ "taskset",		1,	0,	OPT_taskset },
+	{ "taskstats",		0,	0,	OPT_taskstats },
 	{ "tee",		1,	0,	OPT_tee },
 	{ "tee-ops",		1,	0,	OPT_tee_ops },
 	{ "temp-path",		1,	0,	OPT_temp_path },
@@ -968,16 +1147,19 @@ const struct option stress_long_options[] = {
 	{ "timer-freq",		1,	0,	OPT_timer_freq },
 	{ "timer-ops",		1,	0,	OPT_timer_ops },
 	{ "timer-rand", 	0,	0,	OPT_timer_rand },
+	{ "timer-sweep",	0,	0,	OPT_timer_sweep },
 	{ "timerfd",		1,	0,	OPT_timerfd },
 	{ "timerfd-fds",	1,	0,	OPT_timerfd_fds },
 	{ "timerfd-freq",	1,	0,	OPT_timerfd_freq },
 	{ "timerfd-ops",	1,	0,	OPT_timerfd_ops },
 	{ "timerfd-rand",	0,	0,	OPT_timerfd_rand },
+	{ "timerfd-reap",	1,	0,	OPT_timerfd_reap },
 	{ "timer-slack"	,	1,	0,	OPT_timer_slack },
 	{ "time-warp",		1,	0,	OPT_time_warp },
 	{ "time-warp-ops",	1,	0,	OPT_time_warp_ops },
 	{ "tlb-shootdown",	1,	0,	OPT_tlb_shootdown },
 	{ "tlb-shootdown-ops",	1,	0,	OPT_tlb_shootdown_ops },
+	{ "tlb-shootdown-sweep",0,	0,	OPT_tlb_shootdown_sweep },
 	{ "tmpfs",		1,	0,	OPT_tmpfs },
 	{ "tmpfs-mmap-async",	0,	0,	OPT_tmpfs_mmap_async },
 	{ "tmpfs-mmap-file",	0,	0,	OPT_tmpfs_mmap_file },
@@ -990,8 +1172,10 @@ const struct option stress_long_options[] = {
 	{ "tree-method",	1,	0,	OPT_tree_method },
 	{ "tree-ops",		1,	0,	OPT_tree_ops },
 	{ "tree-size",		1,	0,	OPT_tree_size },
+	{ "tree-sweep",		0,	0,	OPT_tree_sweep },
 	{ "trig",		1,	0,	OPT_trig },
 	{ "trig-method",	1,	0,	OPT_trig_method },
+	{ "trig-mode",		1,	0,	OPT_trig_mode },
 	{ "trig-ops",		1,	0,	OPT_trig_ops },
 	{ "tsc",		1,	0,	OPT_tsc },
 	{ "tsc-lfence",		0,	0,	OPT_tsc_lfence },
@@ -1006,29 +1190,44 @@ const struct option stress_long_options[] = {
 	{ "timestamp",		0,	0,	OPT_timestamp },
 	{ "tz",			0,	0,	OPT_thermal_zones },
 	{ "tun",		1,	0,	OPT_tun},
+	{ "tun-batch",		1,	0,	OPT_tun_batch },
+	{ "tun-gso",		0,	0,	OPT_tun_gso },
+	{ "tun-mq",		1,	0,	OPT_tun_mq },
 	{ "tun-tap",		0,	0,	OPT_tun_tap },
 	{ "tun-ops",		1,	0,	OPT_tun_ops },
 	{ "udp",		1,	0,	OPT_udp },
+	{ "udp-batch",		1,	0,	OPT_udp_batch },
 	{ "udp-domain",		1,	0,	OPT_udp_domain },
 	{ "udp-gro",		0,	0,	OPT_udp_gro },
+	{ "udp-gso",		1,	0,	OPT_udp_gso },
 	{ "udp-if",		1,	0,	OPT_udp_if },
 	{ "udp-lite",		0,	0,	OPT_udp_lite },
 	{ "udp-ops",		1,	0,	OPT_udp_ops },
 	{ "udp-port",		1,	0,	OPT_udp_port },
+	{ "udp-txtime",		1,	0,	OPT_udp_txtime },
 	{ "udp-flood",		1,	0,	OPT_udp_flood },
+	{ "udp-flood-bps",	1,	0,	OPT_udp_flood_bps },
 	{ "udp-flood-domain",	1,	0,	OPT_udp_flood_domain },
+	{ "udp-flood-fq",	0,	0,	OPT_udp_flood_fq },
 	{ "udp-flood-if",	1,	0,	OPT_udp_flood_if },
 	{ "udp-flood-ops",	1,	0,	OPT_udp_flood_ops },
+	{ "udp-flood-pps",	1,	0,	OPT_udp_flood_pps },
+	{ "udp-flood-size",	1,	0,	OPT_udp_flood_size },
 	{ "umount",		1,	0,	OPT_umount },
 	{ "umount-ops",		1,	0,	OPT_umount_ops },
 	{ "unshare",		1,	0,	OPT_unshare },
 	{ "unshare-ops",	1,	0,	OPT_unshare_ops },
+	{ "until-stable",	1,	0,	OPT_until_stable },
+	{ "until-stable-window",1,	0,	OPT_until_stable_window },
 	{ "uprobe",		1,	0,	OPT_uprobe },
 	{ "uprobe-ops",		1,	0,	OPT_uprobe_ops },
 	{ "urandom",		1,	0,	OPT_urandom },
 	{ "urandom-ops",	1,	0,	OPT_urandom_ops },
 	{ "userfaultfd",	1,	0,	OPT_userfaultfd },
+	{ "userfaultfd-batch",	1,	0,	OPT_userfaultfd_batch },
 	{ "userfaultfd-bytes",	1,	0,	OPT_userfaultfd_bytes },
+	{ "userfaultfd-handlers",1,	0,	OPT_userfaultfd_handlers },
+	{ "userfaultfd-mode",	1,	0,	OPT_userfaultfd_mode },
 	{ "userfaultfd-ops",	1,	0,	OPT_userfaultfd_ops },
 	{ "usersyscall",	1,	0,	OPT_usersyscall },
 	{ "usersyscall-ops",	1,	0,	OPT_usersyscall_ops },
@@ -1043,6 +1242,7 @@ const struct option stress_long_options[] = {
 	{ "vecfp-ops",		1,	0,	OPT_vecfp_ops },
 	{ "vecmath",		1,	0,	OPT_vecmath },
 	{ "vecmath-ops",	1,	0,	OPT_vecmath_ops },
+	{ "vecmath-wide",	0,	0,	OPT_vecmath_wide },
 	{ "vecshuf",		1,	0,	OPT_vecshuf },
 	{ "vecshuf-method",	1,	0,	OPT_vecshuf_method },
 	{ "vecshuf-ops",	1,	0,	OPT_vecshuf_ops },
@@ -1054,6 +1254,9 @@ const struct option stress_long_options[] = {
 	{ "verity",		1,	0,	OPT_verity },
 	{ "verity-ops",		1,	0,	OPT_verity_ops },
 	{ "version",		0,	0,	OPT_version },
+	{ "victim",		1,	0,	OPT_victim },
+	{ "victim-steps",	1,	0,	OPT_victim_steps },
+	{ "victim-taskset",	1,	0,	OPT_victim_taskset },
 	{ "vfork",		1,	0,	OPT_vfork },
 	{ "vfork-max",		1,	0,	OPT_vfork_max },
 	{ "vfork-ops",		1,	0,	OPT_vfork_ops },
@@ -1064,6 +1267,7 @@ const struct option stress_long_options[] = {
 	{ "vm",			1,	0,	OPT_vm },
 	{ "vm-bytes",		1,	0,	OPT_vm_bytes },
 	{ "vm-hang",		1,	0,	OPT_vm_hang },
+	{ "vm-hugepage",	1,	0,	OPT_vm_hugepage },
 	{ "vm-keep",		0,	0,	OPT_vm_keep },
 #if defined(MAP_LOCKED)
 	{ "vm-locked",		0,	0,	OPT_vm_mmap_locked },
@@ -1074,6 +1278,7 @@ const struct option stress_long_options[] = {
 #if defined(MAP_POPULATE)
 	{ "vm-populate",	0,	0,	OPT_vm_mmap_populate },
 #endif
+	{ "vm-threads",		1,	0,	OPT_vm_threads },
 	{ "vm-addr",		1,	0,	OPT_vm_addr },
 	{ "vm-addr-method",	1,	0,	OPT_vm_addr_method },
 	{ "vm-addr-mlock",	0,	0,	OPT_vm_addr_mlock },
@@ -1081,6 +1286,7 @@ const struct option stress_long_options[] = {
 	{ "vm-rw",		1,	0,	OPT_vm_rw },
 	{ "vm-rw-bytes",	1,	0,	OPT_vm_rw_bytes },
 	{ "vm-rw-ops",		1,	0,	OPT_vm_rw_ops },
+	{ "vm-rw-sweep",	0,	0,	OPT_vm_rw_sweep },
 	{ "vm-segv",		1,	0,	OPT_vm_segv },
 	{ "vm-segv-ops",	1,	0,	OPT_vm_segv_ops },
 	{ "vm-splice",		1,	0,	OPT_vm_splice },
@@ -1097,20 +1303,25 @@ const struct option stress_long_options[] = {
 	{ "wait-ops",		1,	0,	OPT_wait_ops },
 	{ "waitcpu",		1,	0,	OPT_waitcpu },
 	{ "waitcpu-ops",	1,	0,	OPT_waitcpu_ops },
+	{ "warmup",		1,	0,	OPT_warmup },
 	{ "watchdog",		1,	0,	OPT_watchdog },
 	{ "watchdog-ops",	1,	0,	OPT_watchdog_ops },
 	{ "with",		1,	0,	OPT_with },
 	{ "wcs",		1,	0,	OPT_wcs},
+	{ "wcs-impl",		1,	0,	OPT_wcs_impl },
 	{ "wcs-method",		1,	0,	OPT_wcs_method },
 	{ "wcs-ops",		1,	0,	OPT_wcs_ops },
+	{ "wcs-sweep",		0,	0,	OPT_wcs_sweep },
 	{ "workload",		1,	0,	OPT_workload },
 	{ "workload-dist",	1,	0,	OPT_workload_dist },
 	{ "workload-load",	1,	0,	OPT_workload_load },
 	{ "workload-method",	1,	0,	OPT_workload_method },
 	{ "workload-ops",	1,	0,	OPT_workload_ops },
+	{ "workload-pool",	1,	0,	OPT_workload_pool },
 	{ "workload-quanta-us",	1,	0,	OPT_workload_quanta_us },
 	{ "workload-sched",	1,	0,	OPT_workload_sched },
 	{ "workload-slice-us",	1,	0,	OPT_workload_slice_us },
+	{ "workload-sweep",	0,	0,	OPT_workload_sweep },
 	{ "workload-threads",	1,	0,	OPT_workload_threads },
 	{ "x86cpuid",		1,	0,	OPT_x86cpuid },
 	{ "x86cpuid-ops",	1,	0,	OPT_x86cpuid_ops },
@@ -1125,13 +1336,19 @@ const struct option stress_long_options[] = {
 	{ "zero",		1,	0,	OPT_zero },
 	{ "zero-ops",		1,	0,	OPT_zero_ops },
 	{ "zero-read",		0,	0,	OPT_zero_read },
+	{ "zerocopy",		1,	0,	OPT_zerocopy },
+	{ "zerocopy-bytes",	1,	0,	OPT_zerocopy_bytes },
+	{ "zerocopy-ops",	1,	0,	OPT_zerocopy_ops },
+	{ "zerocopy-size",	1,	0,	OPT_zerocopy_size },
 	{ "zlib",		1,	0,	OPT_zlib },
+	{ "zlib-codec",		1,	0,	OPT_zlib_codec },
 	{ "zlib-level",		1,	0,	OPT_zlib_level },
 	{ "zlib-method",	1,	0,	OPT_zlib_method },
 	{ "zlib-mem-level",	1,	0,	OPT_zlib_mem_level },
 	{ "zlib-ops",		1,	0,	OPT_zlib_ops },
 	{ "zlib-strategy",	1,	0,	OPT_zlib_strategy, },
 	{ "zlib-stream-bytes",	1,	0,	OPT_zlib_stream_bytes, },
+	{ "zlib-threads",	1,	0,	OPT_zlib_threads },
 	{ "zlib-window-bits",	1,	0,	OPT_zlib_window_bits },
 	{ "zombie",		1,	0,	OPT_zombie },
 	{ "zombie-max",		1,	0,	OPT_zombie_max },
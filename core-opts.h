@@ -82,6 +82,16 @@
 #define OPT_FLAGS_PERMUTE	 STRESS_BIT_ULL(51)	/* --permute N */
 #define OPT_FLAGS_INTERRUPTS	 STRESS_BIT_ULL(52)	/* --interrupts */
 #define OPT_FLAGS_PROGRESS	 STRESS_BIT_ULL(53)	/* --progress */
+#define OPT_FLAGS_ENERGY	 STRESS_BIT_ULL(54)	/* --energy */
+#define OPT_FLAGS_FREQ_STATS	 STRESS_BIT_ULL(55)	/* --freq-stats */
+#define OPT_FLAGS_SYNC_START	 STRESS_BIT_ULL(56)	/* --sync-start */
+#define OPT_FLAGS_CGROUP_STATS	 STRESS_BIT_ULL(57)	/* --cgroup-stats */
+#define OPT_FLAGS_INTERFERENCE	 STRESS_BIT_ULL(58)	/* --interference */
+#define OPT_FLAGS_HUGE_TEXT	 STRESS_BIT_ULL(59)	/* --huge-text */
+#define OPT_FLAGS_IGNITE_CPU_RAMP STRESS_BIT_ULL(60)	/* --ignite-cpu-ramp */
+#define OPT_FLAGS_RESCTRL_STATS	 STRESS_BIT_ULL(61)	/* --resctrl-stats */
+#define OPT_FLAGS_CSTATE_STATS	 STRESS_BIT_ULL(62)	/* --cstate-stats */
+#define OPT_FLAGS_IRQ_STATS	 STRESS_BIT_ULL(63)	/* --irq-stats */
 
 #define OPT_FLAGS_MINMAX_MASK		\
 	(OPT_FLAGS_MINIMIZE | OPT_FLAGS_MAXIMIZE)
@@ -157,6 +167,10 @@ typedef enum {
 	OPT_af_alg,
 	OPT_af_alg_ops,
 	OPT_af_alg_dump,
+	OPT_af_alg_mode,
+	OPT_af_alg_aio_depth,
+
+	OPT_agent,
 
 	OPT_aggressive,
 
@@ -165,7 +179,11 @@ typedef enum {
 	OPT_aio_requests,
 
 	OPT_aiol,
+	OPT_aiol_batch,
+	OPT_aiol_eventfd,
+	OPT_aiol_min_nr,
 	OPT_aiol_ops,
+	OPT_aiol_poll,
 	OPT_aiol_requests,
 
 	OPT_alarm,
@@ -176,6 +194,7 @@ typedef enum {
 
 	OPT_atomic,
 	OPT_atomic_ops,
+	OPT_atomic_sweep,
 
 	OPT_bad_altstack,
 	OPT_bad_altstack_ops,
@@ -184,8 +203,11 @@ typedef enum {
 	OPT_bad_ioctl_method,
 	OPT_bad_ioctl_ops,
 
+	OPT_benchmark,
+
 	OPT_bigheap_bytes,
 	OPT_bigheap_growth,
+	OPT_bigheap_method,
 	OPT_bigheap_mlock,
 	OPT_bigheap_ops,
 
@@ -199,8 +221,11 @@ typedef enum {
 	OPT_bitonicsort_ops,
 	OPT_bitonicsort_size,
 
+	OPT_bogo_overhead,
+
 	OPT_branch,
 	OPT_branch_ops,
+	OPT_branch_sweep,
 
 	OPT_brk,
 	OPT_brk_bytes,
@@ -212,8 +237,10 @@ typedef enum {
 	OPT_bsearch_method,
 	OPT_bsearch_ops,
 	OPT_bsearch_size,
+	OPT_bsearch_sweep,
 
 	OPT_class,
+	OPT_cluster_secret,
 
 	OPT_cache_ops,
 	OPT_cache_size,
@@ -232,6 +259,7 @@ typedef enum {
 	OPT_cacheline,
 	OPT_cacheline_ops,
 	OPT_cacheline_affinity,
+	OPT_cacheline_matrix,
 	OPT_cacheline_method,
 
 	OPT_cap,
@@ -239,6 +267,9 @@ typedef enum {
 
 	OPT_cgroup,
 	OPT_cgroup_ops,
+	OPT_cgroup_cpu_max,
+	OPT_cgroup_memory_max,
+	OPT_cgroup_stats,
 
 	OPT_chattr,
 	OPT_chattr_ops,
@@ -268,9 +299,14 @@ typedef enum {
 	OPT_close,
 	OPT_close_ops,
 
+	OPT_compare,
+	OPT_compare_threshold,
+
 	OPT_context,
 	OPT_context_ops,
 
+	OPT_controller,
+
 	OPT_config,
 
 	OPT_copy_file,
@@ -281,16 +317,22 @@ typedef enum {
 	OPT_cpu_method,
 	OPT_cpu_load_slice,
 	OPT_cpu_old_metrics,
+	OPT_cpu_calibrate,
+	OPT_cpu_profile,
+	OPT_cpu_vector,
 
 	OPT_cpu_online,
 	OPT_cpu_online_affinity,
 	OPT_cpu_online_all,
+	OPT_cpu_online_load,
 	OPT_cpu_online_ops,
 
 	OPT_crypt,
 	OPT_crypt_method,
 	OPT_crypt_ops,
 
+	OPT_cstate_stats,
+
 	OPT_cyclic,
 	OPT_cyclic_ops,
 	OPT_cyclic_dist,
@@ -299,6 +341,7 @@ typedef enum {
 	OPT_cyclic_prio,
 	OPT_cyclic_samples,
 	OPT_cyclic_sleep,
+	OPT_cyclic_smp,
 
 	OPT_daemon,
 	OPT_daemon_ops,
@@ -340,6 +383,9 @@ typedef enum {
 	OPT_dirmany,
 	OPT_dirmany_ops,
 	OPT_dirmany_bytes,
+	OPT_dirmany_files,
+	OPT_dirmany_mdtest,
+	OPT_dirmany_threads,
 
 	OPT_dnotify,
 	OPT_dnotify_ops,
@@ -349,15 +395,20 @@ typedef enum {
 
 	OPT_dynlib,
 	OPT_dynlib_ops,
+	OPT_dynlib_sweep,
 
 	OPT_eigen,
 	OPT_eigen_ops,
 	OPT_eigen_method,
 	OPT_eigen_size,
+	OPT_eigen_sweep,
+	OPT_eigen_threads,
 
 	OPT_efivar,
 	OPT_efivar_ops,
 
+	OPT_energy,
+
 	OPT_enosys,
 	OPT_enosys_ops,
 
@@ -368,13 +419,18 @@ typedef enum {
 	OPT_epoll_ops,
 	OPT_epoll_port,
 	OPT_epoll_domain,
+	OPT_epoll_shard,
 	OPT_epoll_sockets,
+	OPT_epoll_threads,
 
 	OPT_eventfd,
 	OPT_eventfd_ops,
 	OPT_eventfd_nonblock,
+	OPT_eventfd_fds,
+	OPT_eventfd_reap,
 
 	OPT_exec,
+	OPT_exec_compare,
 	OPT_exec_ops,
 	OPT_exec_max,
 	OPT_exec_method,
@@ -392,11 +448,15 @@ typedef enum {
 	OPT_fallocate_bytes,
 
 	OPT_fanotify,
+	OPT_fanotify_events,
+	OPT_fanotify_marks,
 	OPT_fanotify_ops,
+	OPT_fanotify_rate,
 
 	OPT_far_branch,
 	OPT_far_branch_ops,
 	OPT_far_branch_pages,
+	OPT_far_branch_sweep,
 
 	OPT_fault,
 	OPT_fault_ops,
@@ -430,12 +490,15 @@ typedef enum {
 
 	OPT_flushcache,
 	OPT_flushcache_ops,
+	OPT_flushcache_sweep,
 
 	OPT_fma,
 	OPT_fma_ops,
+	OPT_fma_wide,
 
 	OPT_fork_ops,
 	OPT_fork_max,
+	OPT_fork_sweep,
 	OPT_fork_unmap,
 	OPT_fork_vm,
 
@@ -447,15 +510,19 @@ typedef enum {
 
 	OPT_fp,
 	OPT_fp_method,
+	OPT_fp_mode,
 	OPT_fp_ops,
 
 	OPT_fp_error,
+	OPT_fp_error_mode,
 	OPT_fp_error_ops,
 
 	OPT_fpunch,
 	OPT_fpunch_bytes,
 	OPT_fpunch_ops,
 
+	OPT_freq_stats,
+
 	OPT_fsize,
 	OPT_fsize_ops,
 
@@ -478,14 +545,19 @@ typedef enum {
 
 	OPT_futex,
 	OPT_futex_ops,
+	OPT_futex_method,
+	OPT_futex_waiters,
 
 	OPT_get,
 	OPT_get_ops,
 
 	OPT_getrandom,
 	OPT_getrandom_ops,
+	OPT_getrandom_sweep,
+	OPT_getrandom_threads,
 
 	OPT_getdent,
+	OPT_getdent_entries,
 	OPT_getdent_ops,
 
 	OPT_goto,
@@ -496,6 +568,7 @@ typedef enum {
 	OPT_gpu_ops,
 	OPT_gpu_devnode,
 	OPT_gpu_frag,
+	OPT_gpu_mode,
 	OPT_gpu_uploads,
 	OPT_gpu_size,
 	OPT_gpu_xsize,
@@ -504,11 +577,16 @@ typedef enum {
 	OPT_handle,
 	OPT_handle_ops,
 
+	OPT_harness_profile,
+
 	OPT_hash,
 	OPT_hash_ops,
+	OPT_hash_bytes,
 	OPT_hash_method,
 
 	OPT_hdd_bytes,
+	OPT_hdd_engine,
+	OPT_hdd_iodepth,
 	OPT_hdd_write_size,
 	OPT_hdd_ops,
 	OPT_hdd_opts,
@@ -517,6 +595,7 @@ typedef enum {
 	OPT_heapsort_method,
 	OPT_heapsort_ops,
 	OPT_heapsort_size,
+	OPT_heapsort_threads,
 
 	OPT_hrtimers,
 	OPT_hrtimers_ops,
@@ -527,6 +606,8 @@ typedef enum {
 	OPT_hsearch_ops,
 	OPT_hsearch_size,
 
+	OPT_huge_text,
+
 	OPT_icache,
 	OPT_icache_ops,
 
@@ -535,8 +616,15 @@ typedef enum {
 
 	OPT_idle_page,
 	OPT_idle_page_ops,
+	OPT_idle_page_interval,
+	OPT_idle_page_wss,
 
 	OPT_ignite_cpu,
+	OPT_ignite_cpu_ramp,
+
+	OPT_instance_model,
+
+	OPT_interference,
 
 	OPT_interrupts,
 
@@ -544,11 +632,15 @@ typedef enum {
 	OPT_inode_flags_ops,
 
 	OPT_inotify,
+	OPT_inotify_events,
 	OPT_inotify_ops,
+	OPT_inotify_rate,
+	OPT_inotify_watches,
 
 	OPT_iomix,
 	OPT_iomix_bytes,
 	OPT_iomix_ops,
+	OPT_iomix_profile,
 
 	OPT_ioport,
 	OPT_ioport_ops,
@@ -566,13 +658,19 @@ typedef enum {
 
 	OPT_io_uring,
 	OPT_io_uring_entries,
+	OPT_io_uring_mode,
 	OPT_io_uring_ops,
+	OPT_io_uring_qd,
 
 	OPT_ipsec_mb,
 	OPT_ipsec_mb_ops,
+	OPT_ipsec_mb_burst,
 	OPT_ipsec_mb_feature,
 	OPT_ipsec_mb_jobs,
 	OPT_ipsec_mb_method,
+	OPT_ipsec_mb_sweep,
+
+	OPT_irq_stats,
 
 	OPT_itimer,
 	OPT_itimer_ops,
@@ -581,12 +679,18 @@ typedef enum {
 
 	OPT_jpeg,
 	OPT_jpeg_ops,
+	OPT_jpeg_decode,
 	OPT_jpeg_height,
 	OPT_jpeg_image,
 	OPT_jpeg_width,
 	OPT_jpeg_quality,
+	OPT_jpeg_threads,
+
+	OPT_jsonl,
 
 	OPT_judy,
+	OPT_judy_keys,
+	OPT_judy_method,
 	OPT_judy_ops,
 	OPT_judy_size,
 
@@ -609,6 +713,7 @@ typedef enum {
 	OPT_ksm,
 
 	OPT_kvm,
+	OPT_kvm_exits,
 	OPT_kvm_ops,
 
 	OPT_l1cache,
@@ -616,6 +721,7 @@ typedef enum {
 	OPT_l1cache_method,
 	OPT_l1cache_mlock,
 	OPT_l1cache_ops,
+	OPT_l1cache_probe,
 	OPT_l1cache_sets,
 	OPT_l1cache_size,
 	OPT_l1cache_ways,
@@ -623,6 +729,8 @@ typedef enum {
 	OPT_landlock,
 	OPT_landlock_ops,
 
+	OPT_launcher,
+
 	OPT_lease,
 	OPT_lease_ops,
 	OPT_lease_breakers,
@@ -635,6 +743,7 @@ typedef enum {
 	OPT_link_sync,
 
 	OPT_list,
+	OPT_list_layout,
 	OPT_list_ops,
 	OPT_list_method,
 	OPT_list_size,
@@ -664,12 +773,15 @@ typedef enum {
 	OPT_log_brief,
 	OPT_log_file,
 	OPT_log_lockless,
+	OPT_log_ring,
 
 	OPT_longjmp,
 	OPT_longjmp_ops,
 
 	OPT_loop,
+	OPT_loop_bytes,
 	OPT_loop_ops,
+	OPT_loop_sweep,
 
 	OPT_lsearch,
 	OPT_lsearch_method,
@@ -684,10 +796,14 @@ typedef enum {
 
 	OPT_malloc,
 	OPT_malloc_ops,
+	OPT_malloc_allocator,
 	OPT_malloc_bytes,
+	OPT_malloc_latency,
 	OPT_malloc_max,
 	OPT_malloc_mlock,
 	OPT_malloc_pthreads,
+	OPT_malloc_size_file,
+	OPT_malloc_size_profile,
 	OPT_malloc_threshold,
 	OPT_malloc_touch,
 	OPT_malloc_trim,
@@ -697,12 +813,15 @@ typedef enum {
 	OPT_matrix_ops,
 	OPT_matrix_size,
 	OPT_matrix_method,
+	OPT_matrix_sweep,
 	OPT_matrix_yx,
 
 	OPT_matrix_3d,
 	OPT_matrix_3d_ops,
 	OPT_matrix_3d_size,
 	OPT_matrix_3d_method,
+	OPT_matrix_3d_numa,
+	OPT_matrix_3d_threads,
 	OPT_matrix_3d_zyx,
 
 	OPT_maximize,
@@ -710,6 +829,7 @@ typedef enum {
 
 	OPT_mcontend,
 	OPT_mcontend_ops,
+	OPT_mcontend_false_sharing,
 
 	OPT_membarrier,
 	OPT_membarrier_ops,
@@ -717,6 +837,7 @@ typedef enum {
 	OPT_memcpy,
 	OPT_memcpy_ops,
 	OPT_memcpy_method,
+	OPT_memcpy_sweep,
 
 	OPT_memfd,
 	OPT_memfd_bytes,
@@ -732,6 +853,8 @@ typedef enum {
 	OPT_memrate,
 	OPT_memrate_bytes,
 	OPT_memrate_flush,
+	OPT_memrate_latency,
+	OPT_memrate_latency_threads,
 	OPT_memrate_ops,
 	OPT_memrate_rd_mbs,
 	OPT_memrate_wr_mbs,
@@ -739,11 +862,13 @@ typedef enum {
 	OPT_memthrash,
 	OPT_memthrash_ops,
 	OPT_memthrash_method,
+	OPT_memthrash_numa_compare,
 
 	OPT_mergesort,
 	OPT_mergesort_method,
 	OPT_mergesort_ops,
 	OPT_mergesort_size,
+	OPT_mergesort_threads,
 
 	OPT_metamix,
 	OPT_metamix_ops,
@@ -775,6 +900,7 @@ typedef enum {
 	OPT_mmap_async,
 	OPT_mmap_bytes,
 	OPT_mmap_file,
+	OPT_mmap_latency,
 	OPT_mmap_madvise,
 	OPT_mmap_mergeable,
 	OPT_mmap_mlock,
@@ -785,6 +911,7 @@ typedef enum {
 	OPT_mmap_osync,
 	OPT_mmap_slow_munmap,
 	OPT_mmap_stressful,
+	OPT_mmap_threads,
 	OPT_mmap_write_check,
 
 	OPT_mmapaddr,
@@ -794,6 +921,7 @@ typedef enum {
 	OPT_mmapfiles,
 	OPT_mmapfiles_ops,
 	OPT_mmapfiles_populate,
+	OPT_mmapfiles_read,
 	OPT_mmapfiles_shared,
 
 	OPT_mmapfixed,
@@ -832,8 +960,14 @@ typedef enum {
 	OPT_mpfr,
 	OPT_mpfr_ops,
 	OPT_mpfr_precision,
+	OPT_mpmc,
+	OPT_mpmc_ops,
+	OPT_mpmc_method,
+	OPT_mpmc_size,
+	OPT_mpmc_threads,
 
 	OPT_mq,
+	OPT_mq_ipc_sweep,
 	OPT_mq_ops,
 	OPT_mq_size,
 
@@ -841,9 +975,11 @@ typedef enum {
 	OPT_mremap_ops,
 	OPT_mremap_bytes,
 	OPT_mremap_mlock,
+	OPT_mremap_sweep,
 
 	OPT_msg,
 	OPT_msg_bytes,
+	OPT_msg_ipc_sweep,
 	OPT_msg_ops,
 	OPT_msg_types,
 
@@ -860,6 +996,9 @@ typedef enum {
 	OPT_mutex,
 	OPT_mutex_ops,
 	OPT_mutex_affinity,
+	OPT_mutex_cs_work,
+	OPT_mutex_method,
+	OPT_mutex_ncs_work,
 	OPT_mutex_procs,
 
 	OPT_nanosleep,
@@ -893,7 +1032,9 @@ typedef enum {
 
 	OPT_numa,
 	OPT_numa_bytes,
+	OPT_numa_migrate_sweep,
 	OPT_numa_ops,
+	OPT_numa_policy,
 	OPT_numa_shuffle_addr,
 	OPT_numa_shuffle_node,
 
@@ -912,6 +1053,8 @@ typedef enum {
 	OPT_open_fd,
 	OPT_open_max,
 
+	OPT_ops_rate,
+
 	OPT_page_in,
 	OPT_pathological,
 
@@ -926,6 +1069,8 @@ typedef enum {
 	OPT_pci,
 	OPT_pci_ops,
 
+	OPT_perf_events,
+	OPT_perf_metric,
 	OPT_perf_stats,
 
 	OPT_permute,
@@ -947,6 +1092,7 @@ typedef enum {
 	OPT_ping_sock_ops,
 
 	OPT_pipe_data_size,
+	OPT_pipe_ipc_sweep,
 	OPT_pipe_ops,
 	OPT_pipe_size,
 	OPT_pipe_vmsplice,
@@ -955,6 +1101,8 @@ typedef enum {
 	OPT_pipeherd_ops,
 	OPT_pipeherd_yield,
 
+	OPT_placement,
+
 	OPT_pkey,
 	OPT_pkey_ops,
 
@@ -970,6 +1118,7 @@ typedef enum {
 	OPT_prefetch_l3_size,
 	OPT_prefetch_method,
 	OPT_prefetch_ops,
+	OPT_prefetch_sweep,
 
 	OPT_prctl,
 	OPT_prctl_ops,
@@ -984,11 +1133,16 @@ typedef enum {
 
 	OPT_procfs,
 	OPT_procfs_ops,
+	OPT_procfs_latency,
+	OPT_procfs_yaml,
 
 	OPT_progress,
 
+	OPT_psistat,
+
 	OPT_pthread,
 	OPT_pthread_ops,
+	OPT_pthread_compare,
 	OPT_pthread_max,
 
 	OPT_ptrace,
@@ -1001,6 +1155,7 @@ typedef enum {
 	OPT_qsort,
 	OPT_qsort_ops,
 	OPT_qsort_integers,
+	OPT_qsort_threads,
 	OPT_qsort_method,
 
 	OPT_quota,
@@ -1019,6 +1174,9 @@ typedef enum {
 	OPT_randlist_ops,
 	OPT_randlist_compact,
 	OPT_randlist_items,
+	OPT_randlist_latency,
+	OPT_randlist_latency_huge,
+	OPT_randlist_latency_order,
 	OPT_randlist_size,
 
 	OPT_ramfs,
@@ -1027,13 +1185,17 @@ typedef enum {
 	OPT_ramfs_size,
 
 	OPT_rawdev,
+	OPT_rawdev_iosweep,
 	OPT_rawdev_method,
 	OPT_rawdev_ops,
 
 	OPT_rawpkt,
+	OPT_rawpkt_if,
 	OPT_rawpkt_ops,
 	OPT_rawpkt_port,
 	OPT_rawpkt_rxring,
+	OPT_rawpkt_txring,
+	OPT_rawpkt_xdp,
 
 	OPT_rawsock,
 	OPT_rawsock_ops,
@@ -1051,6 +1213,7 @@ typedef enum {
 	OPT_readahead,
 	OPT_readahead_ops,
 	OPT_readahead_bytes,
+	OPT_readahead_mode,
 
 	OPT_reboot,
 	OPT_reboot_ops,
@@ -1068,6 +1231,9 @@ typedef enum {
 	OPT_resched,
 	OPT_resched_ops,
 
+	OPT_resctrl,
+	OPT_resctrl_stats,
+
 	OPT_resources,
 	OPT_resources_mlock,
 	OPT_resources_ops,
@@ -1095,15 +1261,21 @@ typedef enum {
 
 	OPT_rseq,
 	OPT_rseq_ops,
+	OPT_rseq_bench,
 
 	OPT_rtc,
 	OPT_rtc_ops,
 
+	OPT_sample_interval,
+
+	OPT_scale_sweep,
+
 	OPT_sched,
 	OPT_sched_prio,
 
 	OPT_schedmix,
 	OPT_schedmix_ops,
+	OPT_schedmix_latency,
 	OPT_schedmix_procs,
 
 	OPT_schedpolicy,
@@ -1117,10 +1289,13 @@ typedef enum {
 
 	OPT_sctp,
 	OPT_sctp_ops,
+	OPT_sctp_batch,
 	OPT_sctp_domain,
 	OPT_sctp_if,
 	OPT_sctp_port,
 	OPT_sctp_sched,
+	OPT_sctp_streams,
+	OPT_sctp_sweep,
 
 	OPT_seal,
 	OPT_seal_ops,
@@ -1167,6 +1342,8 @@ typedef enum {
 	OPT_shm_mlock,
 	OPT_shm_ops,
 	OPT_shm_objects,
+	OPT_shm_ring,
+	OPT_shm_ring_producers,
 
 	OPT_shm_sysv,
 	OPT_shm_sysv_bytes,
@@ -1207,6 +1384,7 @@ typedef enum {
 	OPT_sigpipe_ops,
 
 	OPT_sigq,
+	OPT_sigq_latency,
 	OPT_sigq_ops,
 
 	OPT_sigrt,
@@ -1229,7 +1407,9 @@ typedef enum {
 
 	OPT_skiplist,
 	OPT_skiplist_ops,
+	OPT_skiplist_read_pct,
 	OPT_skiplist_size,
+	OPT_skiplist_threads,
 
 	OPT_skip_silent,
 
@@ -1245,13 +1425,19 @@ typedef enum {
 	OPT_sn,
 
 	OPT_sock_ops,
+	OPT_sock_conns,
 	OPT_sock_domain,
 	OPT_sock_if,
+	OPT_sock_ktls,
 	OPT_sock_msgs,
 	OPT_sock_nodelay,
 	OPT_sock_opts,
 	OPT_sock_port,
 	OPT_sock_protocol,
+	OPT_sock_rr,
+	OPT_sock_rr_depth,
+	OPT_sock_rr_req,
+	OPT_sock_rr_resp,
 	OPT_sock_type,
 	OPT_sock_zerocopy,
 
@@ -1267,21 +1453,30 @@ typedef enum {
 	OPT_sockfd_port,
 
 	OPT_sockmany,
+	OPT_sockmany_churn,
+	OPT_sockmany_fastopen,
 	OPT_sockmany_if,
 	OPT_sockmany_ops,
 	OPT_sockmany_port,
 
 	OPT_sockpair,
+	OPT_sockpair_ipc_sweep,
 	OPT_sockpair_ops,
 
 	OPT_softlockup,
 	OPT_softlockup_ops,
 
+	OPT_sort_dist,
+	OPT_sort_dist_swaps,
+
 	OPT_swap,
 	OPT_swap_ops,
+	OPT_swap_cluster_sweep,
+	OPT_swap_zswap_compare,
 
 	OPT_switch_ops,
 	OPT_switch_freq,
+	OPT_switch_latency,
 	OPT_switch_method,
 
 	OPT_spawn,
@@ -1292,6 +1487,8 @@ typedef enum {
 	OPT_sparsematrix_items,
 	OPT_sparsematrix_method,
 	OPT_sparsematrix_size,
+	OPT_sparsematrix_spmv,
+	OPT_sparsematrix_threads,
 
 	OPT_splice,
 	OPT_splice_ops,
@@ -1308,6 +1505,7 @@ typedef enum {
 	OPT_stackmmap_ops,
 
 	OPT_status,
+	OPT_status_socket,
 
 	OPT_stderr,
 	OPT_stdout,
@@ -1315,13 +1513,18 @@ typedef enum {
 	OPT_str,
 	OPT_str_ops,
 	OPT_str_method,
+	OPT_str_impl,
+	OPT_str_sweep,
 
 	OPT_stream,
 	OPT_stream_index,
 	OPT_stream_l3_size,
 	OPT_stream_madvise,
 	OPT_stream_mlock,
+	OPT_stream_numa_matrix,
 	OPT_stream_ops,
+	OPT_stream_sweep,
+	OPT_stream_threads,
 
 	OPT_stressors,
 
@@ -1332,6 +1535,10 @@ typedef enum {
 	OPT_sync_file,
 	OPT_sync_file_ops,
 	OPT_sync_file_bytes,
+	OPT_sync_file_journal,
+	OPT_sync_file_writers,
+
+	OPT_sync_start,
 
 	OPT_syncload,
 	OPT_syncload_ops,
@@ -1342,9 +1549,11 @@ typedef enum {
 	OPT_sysbadaddr_ops,
 
 	OPT_syscall,
+	OPT_syscall_compare,
 	OPT_syscall_method,
 	OPT_syscall_ops,
 	OPT_syscall_top,
+	OPT_syscall_yaml,
 
 	OPT_sysinfo,
 	OPT_sysinfo_ops,
@@ -1354,6 +1563,8 @@ typedef enum {
 
 	OPT_sysfs,
 	OPT_sysfs_ops,
+	OPT_sysfs_latency,
+	OPT_sysfs_yaml,
 
 	OPT_syslog,
 
@@ -1361,6 +1572,7 @@ typedef enum {
 	OPT_tee_ops,
 
 	OPT_taskset,
+	OPT_taskstats,
 
 	OPT_temp_path,
 
@@ -1374,12 +1586,14 @@ typedef enum {
 	OPT_timer_ops,
 	OPT_timer_freq,
 	OPT_timer_rand,
+	OPT_timer_sweep,
 
 	OPT_timerfd,
 	OPT_timerfd_ops,
 	OPT_timerfd_fds,
 	OPT_timerfd_freq,
 	OPT_timerfd_rand,
+	OPT_timerfd_reap,
 
 	OPT_times,
 
@@ -1390,6 +1604,7 @@ typedef enum {
 
 	OPT_tlb_shootdown,
 	OPT_tlb_shootdown_ops,
+	OPT_tlb_shootdown_sweep,
 
 	OPT_tmpfs,
 	OPT_tmpfs_ops,
@@ -1405,9 +1620,11 @@ typedef enum {
 	OPT_tree_ops,
 	OPT_tree_method,
 	OPT_tree_size,
+	OPT_tree_sweep,
 
 	OPT_trig,
 	OPT_trig_method,
+	OPT_trig_mode,
 	OPT_trig_ops,
 
 	OPT_tsc,
@@ -1420,6 +1637,9 @@ typedef enum {
 	OPT_tsearch_size,
 
 	OPT_tun,
+	OPT_tun_batch,
+	OPT_tun_gso,
+	OPT_tun_mq,
 	OPT_tun_ops,
 	OPT_tun_tap,
 
@@ -1430,11 +1650,18 @@ typedef enum {
 	OPT_udp_lite,
 	OPT_udp_gro,
 	OPT_udp_if,
+	OPT_udp_batch,
+	OPT_udp_gso,
+	OPT_udp_txtime,
 
 	OPT_udp_flood,
 	OPT_udp_flood_ops,
+	OPT_udp_flood_bps,
 	OPT_udp_flood_domain,
+	OPT_udp_flood_fq,
 	OPT_udp_flood_if,
+	OPT_udp_flood_pps,
+	OPT_udp_flood_size,
 
 	OPT_umount,
 	OPT_umount_ops,
@@ -1442,6 +1669,9 @@ typedef enum {
 	OPT_unshare,
 	OPT_unshare_ops,
 
+	OPT_until_stable,
+	OPT_until_stable_window,
+
 	OPT_uprobe,
 	OPT_uprobe_ops,
 
@@ -1449,7 +1679,10 @@ typedef enum {
 
 	OPT_userfaultfd,
 	OPT_userfaultfd_ops,
+	OPT_userfaultfd_batch,
 	OPT_userfaultfd_bytes,
+	OPT_userfaultfd_handlers,
+	OPT_userfaultfd_mode,
 
 	OPT_usersyscall,
 	OPT_usersyscall_ops,
@@ -1468,6 +1701,7 @@ typedef enum {
 
 	OPT_vecmath,
 	OPT_vecmath_ops,
+	OPT_vecmath_wide,
 
 	OPT_vecshuf,
 	OPT_vecshuf_ops,
@@ -1482,6 +1716,10 @@ typedef enum {
 	OPT_verity,
 	OPT_verity_ops,
 
+	OPT_victim,
+	OPT_victim_steps,
+	OPT_victim_taskset,
+
 	OPT_vfork,
 	OPT_vfork_ops,
 	OPT_vfork_max,
@@ -1493,12 +1731,14 @@ typedef enum {
 
 	OPT_vm_bytes,
 	OPT_vm_hang,
+	OPT_vm_hugepage,
 	OPT_vm_keep,
 	OPT_vm_mmap_populate,
 	OPT_vm_mmap_locked,
 	OPT_vm_ops,
 	OPT_vm_madvise,
 	OPT_vm_method,
+	OPT_vm_threads,
 
 	OPT_vm_addr,
 	OPT_vm_addr_method,
@@ -1508,6 +1748,7 @@ typedef enum {
 	OPT_vm_rw,
 	OPT_vm_rw_ops,
 	OPT_vm_rw_bytes,
+	OPT_vm_rw_sweep,
 
 	OPT_vm_segv,
 	OPT_vm_segv_ops,
@@ -1532,6 +1773,8 @@ typedef enum {
 	OPT_waitcpu,
 	OPT_waitcpu_ops,
 
+	OPT_warmup,
+
 	OPT_watchdog,
 	OPT_watchdog_ops,
 
@@ -1540,15 +1783,19 @@ typedef enum {
 	OPT_wcs,
 	OPT_wcs_ops,
 	OPT_wcs_method,
+	OPT_wcs_impl,
+	OPT_wcs_sweep,
 
 	OPT_workload,
 	OPT_workload_dist,
 	OPT_workload_load,
 	OPT_workload_method,
 	OPT_workload_ops,
+	OPT_workload_pool,
 	OPT_workload_quanta_us,
 	OPT_workload_sched,
 	OPT_workload_slice_us,
+	OPT_workload_sweep,
 	OPT_workload_threads,
 
 	OPT_x86cpuid,
@@ -1567,14 +1814,21 @@ typedef enum {
 	OPT_zero_read,
 	OPT_zero_ops,
 
+	OPT_zerocopy,
+	OPT_zerocopy_bytes,
+	OPT_zerocopy_ops,
+	OPT_zerocopy_size,
+
 	OPT_zlib,
 	OPT_zlib_ops,
+	OPT_zlib_codec,
 	OPT_zlib_level,
 	OPT_zlib_mem_level,
 	OPT_zlib_method,
 	OPT_zlib_window_bits,
 	OPT_zlib_stream_bytes,
 	OPT_zlib_strategy,
+	OPT_zlib_threads,
 
 	OPT_zombie,
 	OPT_zombie_ops,
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-hash.h"
+#include "core-lock.h"
+#include "core-path-latency.h"
+
+/*
+ *  Per path read latencies shared by all the instances of a
+ *  stressor (and their threads and child processes), kept in a
+ *  fixed size open addressing hash table in shared memory. Each
+ *  path has a coarse log2 histogram with 2 buckets per power of
+ *  2 nanoseconds for the percentiles.
+ */
+#define STRESS_PATH_LATENCY_ENTRIES	(32768)	/* power of 2 */
+#define STRESS_PATH_LATENCY_BUCKETS	(64)	/* up to ~2^31 ns */
+#define STRESS_PATH_LATENCY_PATH_LEN	(176)
+
+typedef struct {
+	uint32_t hash;			/* path hash, 0 = unused */
+	uint32_t count;			/* number of reads */
+	uint64_t min_ns;		/* fastest read */
+	uint64_t max_ns;		/* slowest read */
+	uint64_t sum_ns;		/* sum of read times */
+	uint32_t bucket[STRESS_PATH_LATENCY_BUCKETS]; /* histogram */
+	char path[STRESS_PATH_LATENCY_PATH_LEN]; /* path, may be truncated */
+} stress_path_latency_entry_t;
+
+struct stress_path_latency {
+	void *lock;			/* lock for all the entries */
+	size_t size;			/* size of mapping */
+	uint64_t dropped;		/* reads not recorded, table full */
+	uint32_t used;			/* entries used */
+	uint32_t finished;		/* instances that have finished */
+	stress_path_latency_entry_t entries[STRESS_PATH_LATENCY_ENTRIES];
+};
+
+/* Summary of an entry for sorting and reporting */
+typedef struct {
+	const stress_path_latency_entry_t *entry;
+	uint64_t p50;			/* 50th percentile, ns */
+	uint64_t p99;			/* 99th percentile, ns */
+} stress_path_latency_sum_t;
+
+/*
+ *  stress_path_latency_create()
+ *	create a shared memory per path latency table, returns
+ *	NULL if it can't be allocated
+ */
+stress_path_latency_t *stress_path_latency_create(const char *name)
+{
+	stress_path_latency_t *pl;
+	const size_t size = sizeof(*pl);
+
+	pl = (stress_path_latency_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED | MAP_NORESERVE, -1, 0);
+	if (pl == MAP_FAILED)
+		return NULL;
+	stress_set_vma_anon_name(pl, size, name);
+	pl->lock = stress_lock_create(name);
+	if (!pl->lock) {
+		(void)munmap((void *)pl, size);
+		return NULL;
+	}
+	pl->size = size;
+	return pl;
+}
+
+/*
+ *  stress_path_latency_destroy()
+ *	free the per path latency table
+ */
+void stress_path_latency_destroy(stress_path_latency_t *pl)
+{
+	if (!pl)
+		return;
+	(void)stress_lock_destroy(pl->lock);
+	(void)munmap((void *)pl, pl->size);
+}
+
+/*
+ *  stress_path_latency_index()
+ *	map nanoseconds to a histogram bucket, 2 buckets per power of 2
+ */
+static inline size_t stress_path_latency_index(const uint64_t ns)
+{
+	uint32_t msb = 0;
+	uint64_t n = ns;
+	size_t idx;
+
+	if (ns < 2)
+		return (size_t)ns;
+	while (n > 1) {
+		n >>= 1;
+		msb++;
+	}
+	idx = ((size_t)msb << 1) + (size_t)((ns >> (msb - 1)) & 1);
+	return (idx < STRESS_PATH_LATENCY_BUCKETS) ? idx : STRESS_PATH_LATENCY_BUCKETS - 1;
+}
+
+/*
+ *  stress_path_latency_bucket_max()
+ *	upper bound of a histogram bucket in nanoseconds
+ */
+static inline uint64_t stress_path_latency_bucket_max(const size_t idx)
+{
+	uint32_t msb;
+
+	if (idx < 2)
+		return (uint64_t)idx;
+	msb = (uint32_t)(idx >> 1);
+	return (1ULL << msb) + ((uint64_t)((idx & 1) + 1) << (msb - 1)) - 1;
+}
+
+/*
+ *  stress_path_latency_add()
+ *	record the time taken to read a path
+ */
+void stress_path_latency_add(stress_path_latency_t *pl, const char *path, const double duration)
+{
+	const uint64_t ns = (duration > 0.0) ? (uint64_t)(duration * STRESS_DBL_NANOSECOND) : 0;
+	const uint32_t hash = stress_hash_fnv1a(path) | 1;
+	uint32_t i, slot;
+
+	if (!pl)
+		return;
+	if (stress_lock_acquire(pl->lock) < 0)
+		return;
+
+	slot = hash & (STRESS_PATH_LATENCY_ENTRIES - 1);
+	for (i = 0; i < STRESS_PATH_LATENCY_ENTRIES; i++) {
+		stress_path_latency_entry_t *entry = &pl->entries[slot];
+
+		if (entry->hash == 0) {
+			/* keep a few slots free so probing stays short */
+			if (pl->used >= (STRESS_PATH_LATENCY_ENTRIES - (STRESS_PATH_LATENCY_ENTRIES >> 3)))
+				break;
+			entry->hash = hash;
+			entry->min_ns = ns;
+			(void)shim_strscpy(entry->path, path, sizeof(entry->path));
+			pl->used++;
+		}
+		if ((entry->hash == hash) &&
+		    !strncmp(entry->path, path, sizeof(entry->path) - 1)) {
+			entry->count++;
+			if (ns < entry->min_ns)
+				entry->min_ns = ns;
+			if (ns > entry->max_ns)
+				entry->max_ns = ns;
+			entry->sum_ns += ns;
+			entry->bucket[stress_path_latency_index(ns)]++;
+			(void)stress_lock_release(pl->lock);
+			return;
+		}
+		slot = (slot + 1) & (STRESS_PATH_LATENCY_ENTRIES - 1);
+	}
+	pl->dropped++;
+	(void)stress_lock_release(pl->lock);
+}
+
+/*
+ *  stress_path_latency_percentile()
+ *	percentile of an entry's read times in nanoseconds, the
+ *	upper bound of the bucket clamped to the slowest read
+ */
+static uint64_t stress_path_latency_percentile(
+	const stress_path_latency_entry_t *entry,
+	const double percentile)
+{
+	const uint64_t target = (uint64_t)ceil((double)entry->count * percentile / 100.0);
+	uint64_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < STRESS_PATH_LATENCY_BUCKETS; i++) {
+		sum += entry->bucket[i];
+		if (sum >= target) {
+			const uint64_t ns = stress_path_latency_bucket_max(i);
+
+			return (ns < entry->max_ns) ? ns : entry->max_ns;
+		}
+	}
+	return entry->max_ns;
+}
+
+/*
+ *  stress_path_latency_cmp()
+ *	sort slowest first, on p99 then slowest read
+ */
+static int stress_path_latency_cmp(const void *p1, const void *p2)
+{
+	const stress_path_latency_sum_t *s1 = (const stress_path_latency_sum_t *)p1;
+	const stress_path_latency_sum_t *s2 = (const stress_path_latency_sum_t *)p2;
+
+	if (s1->p99 != s2->p99)
+		return (s1->p99 < s2->p99) ? 1 : -1;
+	if (s1->entry->max_ns != s2->entry->max_ns)
+		return (s1->entry->max_ns < s2->entry->max_ns) ? 1 : -1;
+	return 0;
+}
+
+/*
+ *  stress_path_latency_dump()
+ *	report the top_n slowest paths and write all of the
+ *	paths to the YAML file, slowest first
+ */
+static void stress_path_latency_dump(
+	stress_args_t *args,
+	const stress_path_latency_t *pl,
+	const uint32_t top_n,
+	const char *yaml_filename)
+{
+	stress_path_latency_sum_t *sums;
+	FILE *yaml = NULL;
+	uint32_t i, n;
+
+	sums = (stress_path_latency_sum_t *)calloc((size_t)pl->used + 1, sizeof(*sums));
+	if (!sums) {
+		pr_inf("%s: cannot allocate %" PRIu32 " path latency summaries, skipping report\n",
+			args->name, pl->used);
+		return;
+	}
+	for (n = 0, i = 0; i < STRESS_PATH_LATENCY_ENTRIES; i++) {
+		const stress_path_latency_entry_t *entry = &pl->entries[i];
+
+		if ((entry->hash == 0) || (entry->count == 0))
+			continue;
+		sums[n].entry = entry;
+		sums[n].p50 = stress_path_latency_percentile(entry, 50.0);
+		sums[n].p99 = stress_path_latency_percentile(entry, 99.0);
+		n++;
+	}
+	qsort(sums, (size_t)n, sizeof(*sums), stress_path_latency_cmp);
+
+	if (top_n > 0) {
+		pr_block_begin();
+		pr_inf("%s: %" PRIu32 " paths read, %" PRIu32 " slowest by 99th percentile read time:\n",
+			args->name, n, STRESS_MINIMUM(top_n, n));
+		pr_inf("%s: %10s %9s %9s %9s %9s %9s  %s\n", args->name, "reads",
+			"min us", "mean us", "p50 us", "p99 us", "max us", "path");
+		for (i = 0; (i < n) && (i < top_n); i++) {
+			const stress_path_latency_entry_t *entry = sums[i].entry;
+
+			pr_inf("%s: %10" PRIu32 " %9.1f %9.1f %9.1f %9.1f %9.1f  %s\n",
+				args->name, entry->count,
+				(double)entry->min_ns / 1000.0,
+				(double)entry->sum_ns / (1000.0 * (double)entry->count),
+				(double)sums[i].p50 / 1000.0,
+				(double)sums[i].p99 / 1000.0,
+				(double)entry->max_ns / 1000.0,
+				entry->path);
+		}
+		if (pl->dropped)
+			pr_inf("%s: path table full, %" PRIu64 " reads not recorded\n",
+				args->name, pl->dropped);
+		pr_block_end();
+	}
+
+	if (yaml_filename) {
+		yaml = fopen(yaml_filename, "w");
+		if (!yaml) {
+			pr_inf("%s: cannot create YAML file %s, errno=%d (%s)\n",
+				args->name, yaml_filename, errno, strerror(errno));
+		} else {
+			pr_yaml(yaml, "---\n");
+			pr_yaml(yaml, "%s-path-latencies:\n", args->name);
+			for (i = 0; i < n; i++) {
+				const stress_path_latency_entry_t *entry = sums[i].entry;
+
+				pr_yaml(yaml, "    - path: \"%s\"\n", entry->path);
+				pr_yaml(yaml, "      count: %" PRIu32 "\n", entry->count);
+				pr_yaml(yaml, "      min-ns: %" PRIu64 "\n", entry->min_ns);
+				pr_yaml(yaml, "      mean-ns: %.0f\n",
+					(double)entry->sum_ns / (double)entry->count);
+				pr_yaml(yaml, "      p50-ns: %" PRIu64 "\n", sums[i].p50);
+				pr_yaml(yaml, "      p90-ns: %" PRIu64 "\n",
+					stress_path_latency_percentile(entry, 90.0));
+				pr_yaml(yaml, "      p99-ns: %" PRIu64 "\n", sums[i].p99);
+				pr_yaml(yaml, "      max-ns: %" PRIu64 "\n", entry->max_ns);
+				pr_yaml(yaml, "\n");
+			}
+			(void)fclose(yaml);
+		}
+	}
+	free(sums);
+}
+
+/*
+ *  stress_path_latency_report()
+ *	called by each instance when it has finished, the last
+ *	instance to finish reports the slowest paths and writes
+ *	the YAML file
+ */
+void stress_path_latency_report(
+	stress_args_t *args,
+	stress_path_latency_t *pl,
+	const uint32_t top_n,
+	const char *yaml_filename)
+{
+	bool last;
+
+	if (!pl)
+		return;
+	if (stress_lock_acquire(pl->lock) < 0)
+		return;
+	pl->finished++;
+	last = (pl->finished >= args->num_instances);
+	if (last)
+		stress_path_latency_dump(args, pl, top_n, yaml_filename);
+	(void)stress_lock_release(pl->lock);
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PATH_LATENCY_H
+#define CORE_PATH_LATENCY_H
+
+#include "stress-ng.h"
+
+typedef struct stress_path_latency stress_path_latency_t;
+
+extern stress_path_latency_t *stress_path_latency_create(const char *name);
+extern void stress_path_latency_destroy(stress_path_latency_t *pl);
+extern void stress_path_latency_add(stress_path_latency_t *pl, const char *path,
+	const double duration);
+extern void stress_path_latency_report(stress_args_t *args, stress_path_latency_t *pl,
+	const uint32_t top_n, const char *yaml_filename);
+
+#endif
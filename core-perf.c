@@ -47,9 +47,12 @@
 
 #define UNRESOLVED	(~0UL)
 
+#define STRESS_PERF_METRICS_MAX	(16)
+#define STRESS_PERF_NAME_LEN	(64)
+
 /* used for table of perf events to gather */
 typedef struct {
-	const unsigned int type;	/* perf types */
+	unsigned int type;		/* perf types */
 	unsigned long config;		/* perf type specific config */
 	const char *path;		/* perf trace point path (only for trace points) */
 	const char *label;		/* human readable name for perf type */
@@ -62,6 +65,48 @@ typedef struct {
 	uint64_t time_running;		/* perf time running */
 } stress_perf_data_t;
 
+/* perf group data, PERF_FORMAT_GROUP read format */
+typedef struct {
+	uint64_t nr;			/* number of counters in group */
+	uint64_t time_enabled;		/* perf time enabled */
+	uint64_t time_running;		/* perf time running */
+	uint64_t counter[STRESS_PERF_GROUP_MAX]; /* perf counters */
+} stress_perf_group_data_t;
+
+/* perf counters of an instance sampled at the sample interval */
+typedef struct {
+	double time;			/* time since instance started */
+	uint64_t counter[STRESS_PERF_MAX]; /* perf counters */
+} stress_perf_sample_t;
+
+typedef struct {
+	uint32_t head;			/* next sample ring slot to write to */
+	uint32_t count;			/* total number of samples taken */
+	bool final;			/* true if end of run sample taken */
+	stress_perf_sample_t item[STRESS_SAMPLES_MAX]; /* ring of samples */
+} stress_perf_samples_t;
+
+/* user defined derived perf metric, --perf-metric NAME=expr */
+typedef struct {
+	char *name;			/* metric name */
+	char *expr;			/* metric expression */
+} stress_perf_metric_t;
+
+/* expression evaluation state */
+typedef struct {
+	const char *ptr;		/* current position in expression */
+	const uint64_t *totals;		/* counter totals, NULL = syntax check */
+	double bogo_ops;		/* bogo-ops of stressor */
+	double duration;		/* run duration in seconds */
+	bool error;			/* true if expression is not valid */
+} stress_perf_expr_t;
+
+/* perf tool style event name aliases */
+typedef struct {
+	const char *alias;		/* perf tool event name */
+	const char *name;		/* name of event in perf_info */
+} stress_perf_alias_t;
+
 typedef struct {
 	const double	threshold;	/* scaling threshold */
 	const double	scale;		/* scaling value */
@@ -109,6 +154,33 @@ static const stress_perf_scale_t perf_scale[] = {
 	{ -1, 			-1,		NULL }
 };
 
+static const stress_perf_alias_t perf_aliases[] = {
+	{ "cycles",			"cpu_cycles" },
+	{ "branches",			"branch_instructions" },
+	{ "ref_cycles",			"total_cycles" },
+	{ "faults",			"page_faults_total" },
+	{ "page_faults",		"page_faults_total" },
+	{ "minor_faults",		"page_faults_minor" },
+	{ "major_faults",		"page_faults_major" },
+	{ "cs",				"context_switches" },
+	{ "migrations",			"cpu_migrations" },
+	{ "l1_dcache_loads",		"cache_l1d_read" },
+	{ "l1_dcache_load_misses",	"cache_l1d_read_miss" },
+	{ "l1_icache_loads",		"cache_l1i_read" },
+	{ "l1_icache_load_misses",	"cache_l1i_read_miss" },
+	{ "llc_loads",			"cache_ll_read" },
+	{ "llc_load_misses",		"cache_ll_read_miss" },
+	{ "llc_stores",			"cache_ll_write" },
+	{ "llc_store_misses",		"cache_ll_write_miss" },
+	{ "dtlb_loads",			"cache_dtlb_read" },
+	{ "dtlb_load_misses",		"cache_dtlb_read_miss" },
+	{ "itlb_loads",			"cache_itlb_read" },
+	{ "itlb_load_misses",		"cache_itlb_read_miss" },
+};
+
+static stress_perf_metric_t perf_metrics[STRESS_PERF_METRICS_MAX];
+static size_t perf_metrics_count;
+
 /* perf counters to be read */
 static stress_perf_info_t perf_info[STRESS_PERF_MAX] = {
 	/*
@@ -243,9 +315,6 @@ static stress_perf_info_t perf_info[STRESS_PERF_MAX] = {
 #endif
 #if STRESS_PERF_DEFINED(SW_EMULATION_FAULTS)
 	PERF_INFO_SW(SW_EMULATION_FAULTS,	"Emulation Faults"),
-#endif
-#if STRESS_PERF_DEFINED(SW_CGROUP_SWITCHES)
-	PERF_INFO_SW(SW_CGROUP_SWITCHES,	"Cgroup Switches"),
 #endif
 	/*
 	 *  Tracepoint counters
@@ -462,45 +531,451 @@ static char *stress_perf_yaml_label(char *dst, const char *src, const size_t n)
 }
 
 /*
- *  stress_perf_open()
- *	open perf, get leader and perf fd's
+ *  stress_perf_name()
+ *	normalize an event name or label, lower case with spaces
+ *	and dashes turned into underscores, so "CPU Cycles" and
+ *	"cpu-cycles" are both cpu_cycles
  */
-int stress_perf_open(stress_perf_t *sp)
+static char *stress_perf_name(char *dst, const char *src, const size_t n)
 {
 	size_t i;
 
-	if (!sp)
-		return -1;
-	if (g_shared->perf.no_perf)
-		return -1;
+	for (i = 0; (i < n - 1) && src[i]; i++) {
+		if ((src[i] == ' ') || (src[i] == '-'))
+			dst[i] = '_';
+		else
+			dst[i] = (char)tolower((int)src[i]);
+	}
+	dst[i] = '\0';
+
+	return dst;
+}
+
+/*
+ *  stress_perf_event_find()
+ *	find a perf event by name or perf tool alias,
+ *	returns STRESS_PERF_MAX if not found
+ */
+static size_t stress_perf_event_find(const char *name)
+{
+	char norm[STRESS_PERF_NAME_LEN], label[STRESS_PERF_NAME_LEN];
+	size_t i;
+
+	(void)stress_perf_name(norm, name, sizeof(norm));
+	for (i = 0; i < SIZEOF_ARRAY(perf_aliases); i++) {
+		if (!strcmp(norm, perf_aliases[i].alias)) {
+			(void)shim_strscpy(norm, perf_aliases[i].name, sizeof(norm));
+			break;
+		}
+	}
+	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if (!strcmp(norm, stress_perf_name(label, perf_info[i].label, sizeof(label))))
+			return i;
+	}
+	return STRESS_PERF_MAX;
+}
+
+/*
+ *  stress_set_perf_events()
+ *	parse --perf-events option, a comma separated list of events,
+ *	these can be names of the default events (as shown by --perf),
+ *	perf tool style names such as cycles and llc-load-misses, raw
+ *	PMU events rNNNN (NNNN in hex) or tracepoints subsystem:event.
+ *	Only the listed events are gathered.
+ */
+int stress_set_perf_events(const char *opt)
+{
+	static stress_perf_info_t events[STRESS_PERF_MAX];
+	char *str, *token, *saveptr = NULL;
+	size_t n = 0;
+
+	str = strdup(opt);
+	if (!str) {
+		(void)fprintf(stderr, "perf-events: out of memory parsing '%s'\n", opt);
+		_exit(EXIT_FAILURE);
+	}
+
+	(void)shim_memset(events, 0, sizeof(events));
+	for (token = strtok_r(str, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr)) {
+		const char *colon = strchr(token, ':');
+		size_t i;
+
+		if (n >= STRESS_PERF_MAX - 1) {
+			(void)fprintf(stderr, "perf-events: too many events, maximum is %d\n",
+				STRESS_PERF_MAX - 1);
+			_exit(EXIT_FAILURE);
+		}
+		i = stress_perf_event_find(token);
+		if (i < STRESS_PERF_MAX) {
+			events[n++] = perf_info[i];
+		} else if ((token[0] == 'r') && token[1] &&
+			   (strspn(token + 1, "0123456789abcdefABCDEF") == strlen(token + 1))) {
+			events[n].type = PERF_TYPE_RAW;
+			events[n].config = strtoul(token + 1, NULL, 16);
+			events[n].path = NULL;
+			events[n].label = strdup(token);
+			if (!events[n].label)
+				goto nomem;
+			n++;
+		} else if (colon && (colon != token) && colon[1]) {
+			char path[PATH_MAX];
+
+			/* tracepoint subsystem:event, resolved by stress_perf_init */
+			(void)snprintf(path, sizeof(path), "%.*s/%s",
+				(int)(colon - token), token, colon + 1);
+			events[n].type = PERF_TYPE_TRACEPOINT;
+			events[n].config = UNRESOLVED;
+			events[n].path = strdup(path);
+			events[n].label = strdup(colon + 1);
+			if (!events[n].path || !events[n].label)
+				goto nomem;
+			n++;
+		} else {
+			(void)fprintf(stderr, "perf-events: unknown perf event '%s', "
+				"use event names as shown by --perf, rNNNN for raw "
+				"events or subsystem:event for tracepoints\n", token);
+			_exit(EXIT_FAILURE);
+		}
+	}
+	free(str);
+
+	if (n == 0) {
+		(void)fprintf(stderr, "perf-events: no perf events specified\n");
+		_exit(EXIT_FAILURE);
+	}
+	(void)shim_memcpy(perf_info, events, sizeof(perf_info));
+	g_opt_flags |= OPT_FLAGS_PERF_STATS;
+
+	return 0;
+
+nomem:
+	(void)fprintf(stderr, "perf-events: out of memory parsing '%s'\n", opt);
+	_exit(EXIT_FAILURE);
+}
+
+static double stress_perf_expr_sum(stress_perf_expr_t *e);
+
+/*
+ *  stress_perf_expr_skip()
+ *	skip over white space in an expression
+ */
+static inline void stress_perf_expr_skip(stress_perf_expr_t *e)
+{
+	while (isspace((int)*e->ptr))
+		e->ptr++;
+}
+
+/*
+ *  stress_perf_expr_variable()
+ *	value of a named variable, bogo_ops, duration or a perf
+ *	event counter total, NAN if it is not available
+ */
+static double stress_perf_expr_variable(stress_perf_expr_t *e, const char *name)
+{
+	size_t i;
+
+	if (!e->totals)
+		return 1.0;
+	if (!strcmp(name, "bogo_ops"))
+		return e->bogo_ops;
+	if (!strcmp(name, "duration"))
+		return e->duration;
+	i = stress_perf_event_find(name);
+	if ((i >= STRESS_PERF_MAX) || (e->totals[i] == STRESS_PERF_INVALID))
+		return NAN;
+	return (double)e->totals[i];
+}
+
+/*
+ *  stress_perf_expr_factor()
+ *	factor: number | name | ( sum ) | - factor
+ */
+static double stress_perf_expr_factor(stress_perf_expr_t *e)
+{
+	char name[STRESS_PERF_NAME_LEN];
+	double value;
+	size_t n = 0;
+
+	stress_perf_expr_skip(e);
+	if (*e->ptr == '(') {
+		e->ptr++;
+		value = stress_perf_expr_sum(e);
+		stress_perf_expr_skip(e);
+		if (*e->ptr != ')') {
+			e->error = true;
+			return NAN;
+		}
+		e->ptr++;
+		return value;
+	}
+	if (*e->ptr == '-') {
+		e->ptr++;
+		return -stress_perf_expr_factor(e);
+	}
+	if (isdigit((int)*e->ptr) || (*e->ptr == '.')) {
+		char *end;
+
+		value = strtod(e->ptr, &end);
+		if (end == e->ptr)
+			e->error = true;
+		e->ptr = end;
+		return value;
+	}
+	while ((isalnum((int)*e->ptr) || (*e->ptr == '_')) && (n < sizeof(name) - 1))
+		name[n++] = *e->ptr++;
+	name[n] = '\0';
+	if (n == 0) {
+		e->error = true;
+		return NAN;
+	}
+	return stress_perf_expr_variable(e, name);
+}
+
+/*
+ *  stress_perf_expr_term()
+ *	term: factor { (* | /) factor }
+ */
+static double stress_perf_expr_term(stress_perf_expr_t *e)
+{
+	double value = stress_perf_expr_factor(e);
+
+	for (;;) {
+		stress_perf_expr_skip(e);
+		if (*e->ptr == '*') {
+			e->ptr++;
+			value *= stress_perf_expr_factor(e);
+		} else if (*e->ptr == '/') {
+			double divisor;
+
+			e->ptr++;
+			divisor = stress_perf_expr_factor(e);
+			value = (divisor == 0.0) ? NAN : value / divisor;
+		} else {
+			return value;
+		}
+	}
+}
+
+/*
+ *  stress_perf_expr_sum()
+ *	sum: term { (+ | -) term }
+ */
+static double stress_perf_expr_sum(stress_perf_expr_t *e)
+{
+	double value = stress_perf_expr_term(e);
+
+	for (;;) {
+		stress_perf_expr_skip(e);
+		if (*e->ptr == '+') {
+			e->ptr++;
+			value += stress_perf_expr_term(e);
+		} else if (*e->ptr == '-') {
+			e->ptr++;
+			value -= stress_perf_expr_term(e);
+		} else {
+			return value;
+		}
+	}
+}
+
+/*
+ *  stress_perf_expr_eval()
+ *	evaluate expression expr, if totals is NULL just check
+ *	the syntax, returns NAN if the expression can't be evaluated
+ */
+static double stress_perf_expr_eval(
+	const char *expr,
+	const uint64_t *totals,
+	const double bogo_ops,
+	const double duration,
+	bool *error)
+{
+	stress_perf_expr_t e;
+	double value;
+
+	e.ptr = expr;
+	e.totals = totals;
+	e.bogo_ops = bogo_ops;
+	e.duration = duration;
+	e.error = false;
+
+	value = stress_perf_expr_sum(&e);
+	stress_perf_expr_skip(&e);
+	if (*e.ptr)
+		e.error = true;
+	*error = e.error;
+
+	return e.error ? NAN : value;
+}
+
+/*
+ *  stress_set_perf_metric()
+ *	parse --perf-metric NAME=expr option, expr is an arithmetic
+ *	expression of perf event counter totals, bogo_ops and duration,
+ *	this option can be used multiple times
+ */
+int stress_set_perf_metric(const char *opt)
+{
+	const char *eq = strchr(opt, '=');
+	stress_perf_metric_t *metric;
+	size_t i, len;
+	bool error;
+
+	if (perf_metrics_count >= STRESS_PERF_METRICS_MAX) {
+		(void)fprintf(stderr, "perf-metric: too many metrics, maximum is %d\n",
+			STRESS_PERF_METRICS_MAX);
+		_exit(EXIT_FAILURE);
+	}
+	if (!eq || (eq == opt)) {
+		(void)fprintf(stderr, "perf-metric: '%s' should be of the form NAME=expression\n", opt);
+		_exit(EXIT_FAILURE);
+	}
+	len = (size_t)(eq - opt);
+	for (i = 0; i < len; i++) {
+		if (!isalnum((int)opt[i]) && (opt[i] != '_')) {
+			(void)fprintf(stderr, "perf-metric: metric name '%.*s' must only "
+				"contain letters, digits and underscores\n", (int)len, opt);
+			_exit(EXIT_FAILURE);
+		}
+	}
+	(void)stress_perf_expr_eval(eq + 1, NULL, 0.0, 0.0, &error);
+	if (error) {
+		(void)fprintf(stderr, "perf-metric: invalid expression '%s'\n", eq + 1);
+		_exit(EXIT_FAILURE);
+	}
+
+	metric = &perf_metrics[perf_metrics_count];
+	metric->name = (char *)calloc(len + 1, sizeof(char));
+	metric->expr = strdup(eq + 1);
+	if (!metric->name || !metric->expr) {
+		(void)fprintf(stderr, "perf-metric: out of memory parsing '%s'\n", opt);
+		_exit(EXIT_FAILURE);
+	}
+	(void)shim_strscpy(metric->name, opt, len + 1);
+	perf_metrics_count++;
+	g_opt_flags |= OPT_FLAGS_PERF_STATS;
+
+	return 0;
+}
+
+/*
+ *  stress_perf_group_join()
+ *	can perf event i join the group led by event leader?
+ *	groups are made of adjacent events of the same type so
+ *	that related counters such as instructions and cycles are
+ *	scheduled together, hardware groups are kept small so the
+ *	group fits into the available PMU counters
+ */
+static bool stress_perf_group_join(const int leader, const size_t i, const size_t group_size)
+{
+	const unsigned int type = perf_info[leader].type;
+
+	if (perf_info[i].type != type)
+		return false;
+	switch (type) {
+	case PERF_TYPE_HW_CACHE:
+		/* keep each cache in its own group */
+		if ((perf_info[i].config & 0xff) != (perf_info[leader].config & 0xff))
+			return false;
+		return group_size < STRESS_PERF_GROUP_HW_MAX;
+	case PERF_TYPE_HARDWARE:
+		return group_size < STRESS_PERF_GROUP_HW_MAX;
+	default:
+		break;
+	}
+	return group_size < STRESS_PERF_GROUP_MAX;
+}
+
+/*
+ *  stress_perf_open_pid()
+ *	open perf counters of process pid as groups of events,
+ *	returns number of counters opened
+ */
+static int stress_perf_open_pid(stress_perf_t *sp, const pid_t pid)
+{
+	size_t i, group_size = 0;
+	int leader = -1;
 
 	(void)shim_memset(sp, 0, sizeof(*sp));
 	sp->perf_opened = 0;
 
 	for (i = 0; i < STRESS_PERF_MAX; i++) {
 		sp->perf_stat[i].fd = -1;
+		sp->perf_stat[i].leader = -1;
 		sp->perf_stat[i].counter = 0;
 	}
 
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
-		if (perf_info[i].config != UNRESOLVED) {
-			struct perf_event_attr attr;
-
-			(void)shim_memset(&attr, 0, sizeof(attr));
-			attr.type = perf_info[i].type;
-			attr.config = perf_info[i].config;
-			attr.disabled = 1;
-			attr.inherit = 1;
-			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
-					   PERF_FORMAT_TOTAL_TIME_RUNNING;
-			attr.size = sizeof(attr);
-			sp->perf_stat[i].fd =
-				stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
-			if (sp->perf_stat[i].fd > -1)
+		struct perf_event_attr attr;
+		const int prev_leader = leader;
+		int fd;
+
+		if (perf_info[i].config == UNRESOLVED)
+			continue;
+		if ((leader >= 0) && !stress_perf_group_join(leader, i, group_size))
+			leader = -1;
+
+		(void)shim_memset(&attr, 0, sizeof(attr));
+		attr.type = perf_info[i].type;
+		attr.config = perf_info[i].config;
+		attr.inherit = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING |
+				   PERF_FORMAT_GROUP;
+		attr.size = sizeof(attr);
+
+		if (leader >= 0) {
+			/* group members follow the leader being enabled */
+			attr.disabled = 0;
+			fd = stress_sys_perf_event_open(&attr, pid, -1,
+				sp->perf_stat[leader].fd, 0);
+			if (fd > -1) {
+				sp->perf_stat[i].fd = fd;
+				sp->perf_stat[i].leader = (int16_t)leader;
 				sp->perf_opened++;
+				group_size++;
+				continue;
+			}
+			/* may not fit in the group, try it as a new leader */
+		}
+
+		attr.disabled = 1;
+		fd = stress_sys_perf_event_open(&attr, pid, -1, -1, 0);
+		if (fd > -1) {
+			sp->perf_stat[i].fd = fd;
+			sp->perf_stat[i].leader = (int16_t)i;
+			sp->perf_opened++;
+			leader = (int)i;
+			group_size = 1;
+			continue;
+		}
+		/* event not supported, keep adding to the previous group */
+		leader = prev_leader;
+
+		/* older kernels can't group read inherited counters */
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fd = stress_sys_perf_event_open(&attr, pid, -1, -1, 0);
+		if (fd > -1) {
+			sp->perf_stat[i].fd = fd;
+			sp->perf_opened++;
 		}
 	}
-	if (!sp->perf_opened) {
+	return sp->perf_opened;
+}
+
+/*
+ *  stress_perf_open()
+ *	open perf, get leader and perf fd's
+ */
+int stress_perf_open(stress_perf_t *sp)
+{
+	if (!sp)
+		return -1;
+	if (g_shared->perf.no_perf)
+		return -1;
+
+	if (!stress_perf_open_pid(sp, 0)) {
 		int ret;
 
 		ret = stress_lock_acquire(g_shared->perf.lock);
@@ -524,6 +999,38 @@ int stress_perf_open(stress_perf_t *sp)
 	return 0;
 }
 
+/*
+ *  stress_perf_group_close()
+ *	close all the counters in the group led by counter leader,
+ *	ungrouped counters are just closed
+ */
+static void stress_perf_group_close(stress_perf_t *sp, const size_t leader)
+{
+	size_t i;
+
+	for (i = leader + 1; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if ((sp->perf_stat[i].fd > -1) &&
+		    (sp->perf_stat[i].leader == (int16_t)leader)) {
+			(void)close(sp->perf_stat[i].fd);
+			sp->perf_stat[i].fd = -1;
+		}
+	}
+	(void)close(sp->perf_stat[leader].fd);
+	sp->perf_stat[leader].fd = -1;
+}
+
+/*
+ *  stress_perf_is_leader()
+ *	true if counter i is a group leader or ungrouped, these
+ *	are the counters that are enabled, disabled and read
+ */
+static inline bool stress_perf_is_leader(const stress_perf_t *sp, const size_t i)
+{
+	return (sp->perf_stat[i].fd > -1) &&
+	       ((sp->perf_stat[i].leader < 0) ||
+		(sp->perf_stat[i].leader == (int16_t)i));
+}
+
 /*
  *  stress_perf_enable()
  *	enable perf counters
@@ -540,19 +1047,11 @@ int stress_perf_enable(stress_perf_t *sp)
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
 		const int fd = sp->perf_stat[i].fd;
 
-		if (fd > -1) {
-			if (ioctl(fd, PERF_EVENT_IOC_RESET,
-				  PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
-				continue;
-			}
-			if (ioctl(fd, PERF_EVENT_IOC_ENABLE,
-				  PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
-			}
-		}
+		if (!stress_perf_is_leader(sp, i))
+			continue;
+		if ((ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) < 0) ||
+		    (ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) < 0))
+			stress_perf_group_close(sp, i);
 	}
 	return 0;
 }
@@ -573,15 +1072,86 @@ int stress_perf_disable(stress_perf_t *sp)
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
 		const int fd = sp->perf_stat[i].fd;
 
-		if (fd > -1) {
-			if (ioctl(fd, PERF_EVENT_IOC_DISABLE,
-			          PERF_IOC_FLAG_GROUP) < 0) {
-				(void)close(fd);
-				sp->perf_stat[i].fd = -1;
+		if (!stress_perf_is_leader(sp, i))
+			continue;
+		if (ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP) < 0)
+			stress_perf_group_close(sp, i);
+	}
+	return 0;
+}
+
+/*
+ *  stress_perf_scaled()
+ *	scale a counter by the time it was enabled vs running
+ *	to account for counter multiplexing
+ */
+static uint64_t stress_perf_scaled(
+	const uint64_t counter,
+	const uint64_t time_enabled,
+	const uint64_t time_running)
+{
+	double scale;
+
+	/* Ensure we don't get division by zero */
+	if (time_running == 0)
+		scale = (time_enabled == 0) ? 1.0 : 0.0;
+	else
+		scale = (double)time_enabled / (double)time_running;
+
+	return (uint64_t)((double)counter * scale);
+}
+
+/*
+ *  stress_perf_read()
+ *	read all the counters, each group is read with one read and
+ *	all the counters in a group are scaled by the same factor so
+ *	ratios between counters in a group are consistent
+ */
+static void stress_perf_read(stress_perf_t *sp)
+{
+	size_t i;
+
+	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		const int fd = sp->perf_stat[i].fd;
+		ssize_t ret;
+
+		if (fd < 0) {
+			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+			continue;
+		}
+		if (sp->perf_stat[i].leader < 0) {
+			stress_perf_data_t data;
+
+			(void)shim_memset(&data, 0, sizeof(data));
+			ret = read(fd, &data, sizeof(data));
+			sp->perf_stat[i].counter = (ret != sizeof(data)) ?
+				STRESS_PERF_INVALID :
+				stress_perf_scaled(data.counter,
+					data.time_enabled, data.time_running);
+		} else if (sp->perf_stat[i].leader == (int16_t)i) {
+			stress_perf_group_data_t data;
+			size_t j;
+			uint64_t n = 0;
+
+			(void)shim_memset(&data, 0, sizeof(data));
+			ret = read(fd, &data, sizeof(data));
+			if (ret < (ssize_t)offsetof(stress_perf_group_data_t, counter))
+				data.nr = 0;
+
+			for (j = i; (j < STRESS_PERF_MAX) && perf_info[j].label; j++) {
+				if ((sp->perf_stat[j].fd < 0) ||
+				    (sp->perf_stat[j].leader != (int16_t)i))
+					continue;
+				sp->perf_stat[j].counter = (n < data.nr) ?
+					stress_perf_scaled(data.counter[n],
+						data.time_enabled, data.time_running) :
+					STRESS_PERF_INVALID;
+				n++;
 			}
 		}
 	}
-	return 0;
+	for (; i < STRESS_PERF_MAX; i++)
+		sp->perf_stat[i].counter = STRESS_PERF_INVALID;
 }
 
 /*
@@ -590,48 +1160,255 @@ int stress_perf_disable(stress_perf_t *sp)
  */
 int stress_perf_close(stress_perf_t *sp)
 {
-	size_t i = 0;
-	stress_perf_data_t data;
-	ssize_t ret;
-	double scale;
+	size_t i;
 
 	if (!sp)
 		return -1;
-	if (!sp->perf_opened)
-		goto out_ok;
+	if (!sp->perf_opened) {
+		for (i = 0; i < STRESS_PERF_MAX; i++)
+			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+		return 0;
+	}
 
+	stress_perf_read(sp);
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
-		const int fd = sp->perf_stat[i].fd;
+		if (sp->perf_stat[i].fd > -1) {
+			(void)close(sp->perf_stat[i].fd);
+			sp->perf_stat[i].fd = -1;
+		}
+	}
+	return 0;
+}
 
-		if (fd < 0 ) {
-			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
-			continue;
+/*
+ *  stress_perf_user_open()
+ *	open a user space only counter on the calling thread,
+ *	counting from now, returns -1 if not available
+ */
+static int stress_perf_user_open(const uint32_t type, const uint64_t config)
+{
+	struct perf_event_attr attr;
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.type = type;
+	attr.config = config;
+	attr.size = sizeof(attr);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+}
+
+/*
+ *  stress_perf_hw_open()
+ *	open a user space only hardware counter on the calling
+ *	process, counting from now, returns -1 if not available
+ */
+int stress_perf_hw_open(const uint64_t config)
+{
+	return stress_perf_user_open(PERF_TYPE_HARDWARE, config);
+}
+
+/*
+ *  stress_perf_hw_cache_open()
+ *	open a user space only hardware cache counter on the calling
+ *	thread, config is the PERF_TYPE_HW_CACHE id | (op << 8) |
+ *	(result << 16), returns -1 if not available
+ */
+int stress_perf_hw_cache_open(const uint64_t config)
+{
+	return stress_perf_user_open(PERF_TYPE_HW_CACHE, config);
+}
+
+/*
+ *  stress_perf_hw_read()
+ *	read a counter opened by stress_perf_hw_open(),
+ *	returns STRESS_PERF_INVALID on failure
+ */
+uint64_t stress_perf_hw_read(const int fd)
+{
+	uint64_t counter;
+
+	if (fd < 0)
+		return STRESS_PERF_INVALID;
+	if (read(fd, &counter, sizeof(counter)) != (ssize_t)sizeof(counter))
+		return STRESS_PERF_INVALID;
+	return counter;
+}
+
+static stress_perf_samples_t *perf_samples;	/* shared per instance samples */
+static size_t perf_samples_size;		/* size of perf_samples mapping */
+static stress_perf_t *perf_sample_sp;		/* sampler per instance counters */
+static int32_t perf_sample_instances;		/* number of instances sampled */
+
+/*
+ *  stress_perf_sample_init()
+ *	allocate per instance perf sample rings, these are shared
+ *	with the sampler process that fills them every sample
+ *	interval seconds
+ */
+void stress_perf_sample_init(const int32_t num_instances)
+{
+	void *ptr;
+
+	if ((num_instances < 1) || g_shared->perf.no_perf)
+		return;
+
+	perf_samples_size = sizeof(*perf_samples) * (size_t)num_instances;
+	ptr = mmap(NULL, perf_samples_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED) {
+		pr_inf("perf: cannot mmap %zd bytes for perf samples, errno=%d (%s), "
+			"perf sampling disabled\n", perf_samples_size, errno, strerror(errno));
+		return;
+	}
+	perf_sample_sp = (stress_perf_t *)calloc((size_t)num_instances, sizeof(*perf_sample_sp));
+	if (!perf_sample_sp) {
+		pr_inf("perf: cannot allocate perf sample counters, perf sampling disabled\n");
+		(void)munmap(ptr, perf_samples_size);
+		return;
+	}
+	perf_samples = (stress_perf_samples_t *)ptr;
+	perf_sample_instances = num_instances;
+}
+
+/*
+ *  stress_perf_sample_add()
+ *	add a perf counter sample to the sample ring
+ */
+static void stress_perf_sample_add(
+	stress_perf_samples_t *samples,
+	const double time,
+	const stress_perf_t *sp)
+{
+	stress_perf_sample_t *sample = &samples->item[samples->head];
+	size_t i;
+
+	sample->time = time;
+	for (i = 0; i < STRESS_PERF_MAX; i++)
+		sample->counter[i] = sp ? sp->perf_stat[i].counter : 0;
+	samples->head = (samples->head + 1) % STRESS_SAMPLES_MAX;
+	samples->count++;
+}
+
+/*
+ *  stress_perf_sample()
+ *	sample the perf counters of a stressor instance, called by the
+ *	sampler process. The sampler opens its own counter groups on the
+ *	instance pid since the instance's counters can only be read by
+ *	the instance itself, a zero sample is taken when the counters
+ *	are opened and a final sample once the instance has completed
+ */
+void stress_perf_sample(const int32_t instance, const double now)
+{
+	const stress_stats_t *stats;
+	stress_perf_samples_t *samples;
+	stress_perf_t *sp;
+	size_t i;
+
+	if (!perf_samples || (instance < 0) || (instance >= perf_sample_instances))
+		return;
+
+	stats = &g_shared->stats[instance];
+	samples = &perf_samples[instance];
+	sp = &perf_sample_sp[instance];
+	if (samples->final)
+		return;
+
+	if (!sp->perf_opened) {
+		/* Not started yet or gone before it could be sampled */
+		if ((stats->pid <= 0) || (stats->start <= 0.0) || stats->completed)
+			return;
+		if (!stress_perf_open_pid(sp, stats->pid)) {
+			samples->final = true;
+			return;
 		}
+		(void)stress_perf_enable(sp);
+		stress_perf_sample_add(samples, now - stats->start, NULL);
+		return;
+	}
 
-		(void)shim_memset(&data, 0, sizeof(data));
-		ret = read(fd, &data, sizeof(data));
-		if (ret != sizeof(data))
-			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
-		else {
-			/* Ensure we don't get division by zero */
-			if (data.time_running == 0) {
-				scale = (data.time_enabled == 0) ? 1.0 : 0.0;
-			} else {
-				scale = (double)data.time_enabled /
-					(double)data.time_running;
+	stress_perf_read(sp);
+	if (stats->completed) {
+		stress_perf_sample_add(samples, stats->duration, sp);
+		for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+			if (sp->perf_stat[i].fd > -1) {
+				(void)close(sp->perf_stat[i].fd);
+				sp->perf_stat[i].fd = -1;
 			}
-			sp->perf_stat[i].counter = (uint64_t)
-				((double)data.counter * scale);
 		}
-		(void)close(fd);
-		sp->perf_stat[i].fd = -1;
+		samples->final = true;
+	} else {
+		stress_perf_sample_add(samples, now - stats->start, sp);
 	}
+}
 
-out_ok:
-	for (; i < STRESS_PERF_MAX; i++)
-		sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+/*
+ *  stress_perf_sample_last()
+ *	copy the counters of the most recent perf sample of an
+ *	instance into counters, returns false if there are none
+ */
+bool stress_perf_sample_last(const int32_t instance, uint64_t counters[STRESS_PERF_MAX])
+{
+	const stress_perf_samples_t *samples;
+
+	if (!perf_samples || (instance < 0) || (instance >= perf_sample_instances))
+		return false;
+	samples = &perf_samples[instance];
+	if (samples->count == 0)
+		return false;
+	(void)shim_memcpy(counters,
+		samples->item[(samples->head + STRESS_SAMPLES_MAX - 1) % STRESS_SAMPLES_MAX].counter,
+		sizeof(samples->item[0].counter));
+	return true;
+}
 
-	return 0;
+/*
+ *  stress_perf_event_name()
+ *	normalized name of perf event i, NULL if there is no event i
+ */
+const char *stress_perf_event_name(const size_t i, char *name, const size_t len)
+{
+	if ((i >= STRESS_PERF_MAX) || !perf_info[i].label)
+		return NULL;
+	return stress_perf_name(name, perf_info[i].label, len);
+}
+
+/*
+ *  stress_perf_stat_syscalls()
+ *	number of system calls counted by the raw_syscalls/sys_enter
+ *	tracepoint, STRESS_PERF_INVALID if it was not counted
+ */
+uint64_t stress_perf_stat_syscalls(const stress_perf_t *sp)
+{
+	size_t i;
+
+	if (!sp || (sp->perf_opened <= 0))
+		return STRESS_PERF_INVALID;
+
+	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if ((perf_info[i].type == PERF_TYPE_TRACEPOINT) &&
+		    perf_info[i].path &&
+		    !strcmp(perf_info[i].path, "raw_syscalls/sys_enter"))
+			return sp->perf_stat[i].counter;
+	}
+	return STRESS_PERF_INVALID;
+}
+
+/*
+ *  stress_perf_sample_free()
+ *	free perf sample rings
+ */
+void stress_perf_sample_free(void)
+{
+	if (!perf_samples)
+		return;
+
+	(void)munmap((void *)perf_samples, perf_samples_size);
+	free(perf_sample_sp);
+	perf_samples = NULL;
+	perf_sample_sp = NULL;
+	perf_sample_instances = 0;
 }
 
 /*
@@ -683,47 +1460,115 @@ typedef struct {
 	const unsigned long	ref_config;
 	const bool		percent;	/* scale by 100.0 for percentages? */
 	const char 		*fmt;		/* snprintf format */
+	const char		*label;		/* yaml sample label */
 } perf_relative_t;
 
 static const perf_relative_t perf_relatives[] = {
 	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
 	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES,
-	  false, " (%.3f instr. per cycle)" },
+	  false, " (%.3f instr. per cycle)", "instructions_per_cycle" },
 	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_MISSES,
 	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_REFERENCES,
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_miss_percent" },
 	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES,
 	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "branch_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(L1D, READ, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(L1D, READ, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_l1d_read_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(LL, READ, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(LL, READ, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_ll_read_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(LL, WRITE, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(LL, WRITE, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_ll_write_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, READ, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, READ, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_dtlb_read_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, WRITE, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, WRITE, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_dtlb_write_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(ITLB, READ, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(ITLB, READ, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_itlb_read_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(BPU, READ, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(BPU, READ, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_bpu_read_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(NODE, READ, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(NODE, READ, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_node_read_miss_percent" },
 	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(NODE, WRITE, MISS),
 	  PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(NODE, WRITE, ACCESS),
-	  true, " (%6.3f%%)" },
+	  true, " (%6.3f%%)", "cache_node_write_miss_percent" },
 };
 
+/*
+ *  stress_perf_sample_dump()
+ *	dump the per sample interval perf counter deltas and
+ *	the ratios of related counters of each instance of a stressor
+ */
+static void stress_perf_sample_dump(FILE *yaml, const stress_stressor_t *ss)
+{
+	int32_t j;
+
+	if (!yaml || !perf_samples)
+		return;
+
+	pr_yaml(yaml, "      perf-samples:\n");
+	for (j = 0; j < ss->num_instances; j++) {
+		const int32_t instance = (int32_t)(ss->stats[j] - g_shared->stats);
+		const stress_perf_samples_t *samples;
+		uint32_t i, n, start;
+
+		if ((instance < 0) || (instance >= perf_sample_instances))
+			continue;
+		samples = &perf_samples[instance];
+		n = STRESS_MINIMUM(samples->count, STRESS_SAMPLES_MAX);
+		start = (samples->count > STRESS_SAMPLES_MAX) ? samples->head : 0;
+
+		pr_yaml(yaml, "        - instance: %" PRId32 "\n", j);
+		pr_yaml(yaml, "          samples-taken: %" PRIu32 "\n", samples->count);
+		if (n < 2)
+			continue;
+		pr_yaml(yaml, "          samples:\n");
+		for (i = 1; i < n; i++) {
+			const stress_perf_sample_t *prev = &samples->item[(start + i - 1) % STRESS_SAMPLES_MAX];
+			const stress_perf_sample_t *sample = &samples->item[(start + i) % STRESS_SAMPLES_MAX];
+			uint64_t delta[STRESS_PERF_MAX];
+			size_t p, r;
+
+			pr_yaml(yaml, "            - time: %f\n", sample->time);
+			for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label; p++) {
+				char yaml_label[128];
+
+				delta[p] = STRESS_PERF_INVALID;
+				if ((sample->counter[p] == STRESS_PERF_INVALID) ||
+				    (prev->counter[p] == STRESS_PERF_INVALID))
+					continue;
+				/* scaled multiplexed counters may step backwards */
+				delta[p] = (sample->counter[p] > prev->counter[p]) ?
+					sample->counter[p] - prev->counter[p] : 0;
+				stress_perf_yaml_label(yaml_label, perf_info[p].label, sizeof(yaml_label));
+				pr_yaml(yaml, "              %s: %" PRIu64 "\n", yaml_label, delta[p]);
+			}
+			for (r = 0; r < SIZEOF_ARRAY(perf_relatives); r++) {
+				const size_t idx = stress_perf_info_find(perf_relatives[r].type,
+							perf_relatives[r].config);
+				const size_t ref = stress_perf_info_find(perf_relatives[r].ref_type,
+							perf_relatives[r].ref_config);
+
+				if ((idx >= p) || (ref >= p) ||
+				    (delta[idx] == STRESS_PERF_INVALID) ||
+				    (delta[ref] == STRESS_PERF_INVALID) || (delta[ref] == 0))
+					continue;
+				pr_yaml(yaml, "              %s: %f\n", perf_relatives[r].label,
+					(perf_relatives[r].percent ? 100.0 : 1.0) *
+					(double)delta[idx] / (double)delta[ref]);
+			}
+		}
+	}
+}
+
 /*
  *  stress_perf_stat_dump()
  *	emit perf statistics
@@ -745,6 +1590,9 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 		bool got_data = false;
 		char munged[64];
 		stress_perf_t *sp;
+		double bogo_ops = 0.0;
+		int32_t j;
+		size_t m;
 
 		if (ss->ignore.run)
 			continue;
@@ -758,10 +1606,13 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 
 		/* Sum totals across all instances of the stressor */
 		for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label; p++) {
-			int32_t j;
-
 			for (j = 0; j < ss->num_instances; j++) {
-				const uint64_t counter = sp->perf_stat[p].counter;
+				const stress_perf_t *sp_j = &ss->stats[j]->sp;
+				uint64_t counter;
+
+				if (!stress_perf_stat_succeeded(sp_j))
+					continue;
+				counter = sp_j->perf_stat[p].counter;
 
 				if (counter == STRESS_PERF_INVALID) {
 					counter_totals[p] = STRESS_PERF_INVALID;
@@ -775,6 +1626,9 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 		if (!got_data)
 			continue;
 
+		for (j = 0; j < ss->num_instances; j++)
+			bogo_ops += (double)ss->stats[j]->counter_total;
+
 		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
 		pr_inf("%s:\n", munged);
 		pr_yaml(yaml, "    - stressor: %s\n", munged);
@@ -818,8 +1672,27 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 					"\n", yaml_label, ct);
 				pr_yaml(yaml, "      %s_per_second: %f\n",
 					yaml_label, (double)ct / duration);
+				if (bogo_ops > 0.0)
+					pr_yaml(yaml, "      %s_per_bogo_op: %f\n",
+						yaml_label, (double)ct / bogo_ops);
+			}
+		}
+
+		/* User defined --perf-metric derived metrics */
+		for (m = 0; m < perf_metrics_count; m++) {
+			const stress_perf_metric_t *metric = &perf_metrics[m];
+			bool error;
+			const double value = stress_perf_expr_eval(metric->expr,
+				counter_totals, bogo_ops, duration, &error);
+
+			if (error || !isfinite(value)) {
+				pr_inf("%26s %-24s (%s)\n", "n/a", metric->name, metric->expr);
+				continue;
 			}
+			pr_inf("%'26.3f %-24s (%s)\n", value, metric->name, metric->expr);
+			pr_yaml(yaml, "      %s: %f\n", metric->name, value);
 		}
+		stress_perf_sample_dump(yaml, ss);
 		pr_yaml(yaml, "\n");
 	}
 	if (no_perf_stats) {
@@ -28,12 +28,15 @@
 #define STRESS_PERF_STATS	(1)
 #define STRESS_PERF_INVALID	(~0ULL)
 #define STRESS_PERF_MAX		(128 + 32)
+#define STRESS_PERF_GROUP_MAX	(16)	/* max perf events in a group */
+#define STRESS_PERF_GROUP_HW_MAX (4)	/* max hardware events in a group */
 
 /* per perf counter info */
 typedef struct {
 	uint64_t counter;		/* perf counter */
 	int	 fd;			/* perf per counter fd */
-	uint8_t	 padding[4];		/* padding */
+	int16_t	 leader;		/* index of group leader, -1 = ungrouped */
+	uint8_t	 padding[2];		/* padding */
 } stress_perf_stat_t;
 
 /* per stressor perf info */
@@ -51,6 +54,17 @@ extern bool stress_perf_stat_succeeded(const stress_perf_t *sp);
 extern void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *procs_head,
 	const double duration);
 extern void stress_perf_init(void);
+extern int stress_set_perf_events(const char *opt);
+extern int stress_set_perf_metric(const char *opt);
+extern void stress_perf_sample_init(const int32_t num_instances);
+extern void stress_perf_sample(const int32_t instance, const double now);
+extern void stress_perf_sample_free(void);
+extern bool stress_perf_sample_last(const int32_t instance, uint64_t counters[STRESS_PERF_MAX]);
+extern const char *stress_perf_event_name(const size_t i, char *name, const size_t len);
+extern uint64_t stress_perf_stat_syscalls(const stress_perf_t *sp);
+extern int stress_perf_hw_open(const uint64_t config);
+extern int stress_perf_hw_cache_open(const uint64_t config);
+extern uint64_t stress_perf_hw_read(const int fd);
 #endif
 
 #endif
@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-profile.h"
+
+#define PROFILE_PHASES_MAX	(256)
+#define PROFILE_RAMP_STEPS	(10)	/* default ramp phases */
+#define PROFILE_SINE_STEPS	(8)	/* default sine phases per period */
+#define PROFILE_DUTY_PERIOD	(0.1)	/* duty cycle period, seconds */
+#define PROFILE_KNEE_GAIN	(0.5)	/* knee when marginal gain < 50% of first */
+
+typedef enum {
+	STRESS_PROFILE_NONE = 0,
+	STRESS_PROFILE_RAMP,
+	STRESS_PROFILE_STEP,
+	STRESS_PROFILE_SINE,
+} stress_profile_type_t;
+
+/* a load profile phase and its results */
+typedef struct {
+	int32_t instances;		/* instances to run, 0 = all */
+	uint64_t duration;		/* phase duration, seconds */
+	double load;			/* duty cycle load, % */
+	uint64_t counter;		/* bogo-ops */
+	double run_time;		/* mean instance run time */
+	bool recorded;			/* true if phase has been run */
+} stress_profile_phase_t;
+
+static const char * const profile_type_names[] = {
+	"none", "ramp", "step", "sine",
+};
+
+static stress_profile_type_t profile_type = STRESS_PROFILE_NONE;
+static char profile_stressor[64];
+static int32_t profile_instances_max;
+static stress_profile_phase_t profile_phases[PROFILE_PHASES_MAX];
+static size_t profile_phase_count;
+static pid_t profile_duty_pid = -1;
+
+/*
+ *  stress_profile_error()
+ *	report a profile syntax error
+ */
+static int stress_profile_error(const char *jobfile, const char *msg)
+{
+	(void)fprintf(stderr, "%s: profile %s\n", jobfile ? jobfile : "jobfile", msg);
+	return -1;
+}
+
+/*
+ *  stress_profile_parse_time()
+ *	parse a non-zero duration such as 30s or 10m
+ */
+static uint64_t stress_profile_parse_time(const char *str)
+{
+	const uint64_t t = stress_get_uint64_time(str);
+
+	if (t == 0) {
+		(void)fprintf(stderr, "profile durations must be greater than zero\n");
+		longjmp(g_error_env, 1);
+	}
+	return t;
+}
+
+/*
+ *  stress_profile_parse()
+ *	parse a job file load profile command, one of:
+ *	  profile STRESSOR ramp LO..HI over TIME [steps N]
+ *	  profile STRESSOR step N1,N2,... every TIME
+ *	  profile STRESSOR sine LO..HI period TIME over TIME [steps N] [instances N]
+ *	ramp and step vary the number of instances, sine varies the duty
+ *	cycle load in percent. Returns 1 if this was a profile command,
+ *	0 if not and -1 on error.
+ */
+int stress_profile_parse(const char *jobfile, const int argc, char **argv)
+{
+	uint64_t over = 0, period = 0, every = 0;
+	int32_t steps = 0, instances = 0;
+	double lo = 0.0, hi = 0.0;
+	int i;
+	size_t k;
+
+	if ((argc < 2) || strcmp(argv[1], "profile"))
+		return 0;
+	if (profile_type != STRESS_PROFILE_NONE)
+		return stress_profile_error(jobfile, "can only be used once in a jobfile");
+	if (argc < 5)
+		return stress_profile_error(jobfile, "expects a stressor, profile type and arguments");
+
+	(void)shim_strscpy(profile_stressor, argv[2], sizeof(profile_stressor));
+	if (!strcmp(argv[3], "ramp"))
+		profile_type = STRESS_PROFILE_RAMP;
+	else if (!strcmp(argv[3], "step"))
+		profile_type = STRESS_PROFILE_STEP;
+	else if (!strcmp(argv[3], "sine"))
+		profile_type = STRESS_PROFILE_SINE;
+	else
+		return stress_profile_error(jobfile, "type must be one of ramp, step or sine");
+
+	if (profile_type == STRESS_PROFILE_STEP) {
+		char *str, *ptr, *token;
+
+		str = stress_const_optdup(argv[4]);
+		if (!str)
+			return stress_profile_error(jobfile, "out of memory");
+		for (ptr = str; (token = strtok(ptr, ",")) != NULL; ptr = NULL) {
+			if (profile_phase_count >= PROFILE_PHASES_MAX) {
+				free(str);
+				return stress_profile_error(jobfile, "has too many steps");
+			}
+			profile_phases[profile_phase_count].instances = stress_get_int32(token);
+			if (profile_phases[profile_phase_count].instances < 1) {
+				free(str);
+				return stress_profile_error(jobfile, "step instances must be 1 or more");
+			}
+			profile_phase_count++;
+		}
+		free(str);
+	} else {
+		const char *dots = strstr(argv[4], "..");
+		char buf[64], *end;
+
+		/* can't use sscanf %lf..%lf, 1..4 would scan as 1. and .4 */
+		if (!dots || ((size_t)(dots - argv[4]) >= sizeof(buf)))
+			return stress_profile_error(jobfile, "expects a LO..HI range");
+		(void)shim_strscpy(buf, argv[4], (size_t)(dots - argv[4]) + 1);
+		lo = strtod(buf, &end);
+		if ((end == buf) || (*end != '\0'))
+			return stress_profile_error(jobfile, "expects a LO..HI range");
+		hi = strtod(dots + 2, &end);
+		if ((end == dots + 2) || (*end != '\0'))
+			return stress_profile_error(jobfile, "expects a LO..HI range");
+	}
+
+	for (i = 5; i < argc; i += 2) {
+		if (i + 1 >= argc)
+			return stress_profile_error(jobfile, "argument is missing a value");
+		if (!strcmp(argv[i], "over"))
+			over = stress_profile_parse_time(argv[i + 1]);
+		else if (!strcmp(argv[i], "every"))
+			every = stress_profile_parse_time(argv[i + 1]);
+		else if (!strcmp(argv[i], "period"))
+			period = stress_profile_parse_time(argv[i + 1]);
+		else if (!strcmp(argv[i], "steps"))
+			steps = stress_get_int32(argv[i + 1]);
+		else if (!strcmp(argv[i], "instances"))
+			instances = stress_get_int32(argv[i + 1]);
+		else
+			return stress_profile_error(jobfile, "has an unknown argument");
+	}
+
+	switch (profile_type) {
+	case STRESS_PROFILE_RAMP:
+		if ((lo < 1.0) || (hi < lo) || (over == 0))
+			return stress_profile_error(jobfile, "ramp expects LO..HI instances, 1 <= LO <= HI, over TIME");
+		if (steps <= 0)
+			steps = (int32_t)STRESS_MINIMUM(hi - lo + 1.0, PROFILE_RAMP_STEPS);
+		/* phases run for whole seconds */
+		steps = (int32_t)STRESS_MINIMUM((uint64_t)steps, over);
+		steps = STRESS_MINIMUM(steps, PROFILE_PHASES_MAX);
+		for (k = 0; k < (size_t)steps; k++) {
+			const double frac = (steps > 1) ? (double)k / (double)(steps - 1) : 1.0;
+
+			profile_phases[k].instances = (int32_t)round(lo + (hi - lo) * frac);
+			profile_phases[k].duration = STRESS_MAXIMUM(over / (uint64_t)steps, 1);
+			profile_phases[k].load = 100.0;
+		}
+		profile_phase_count = (size_t)steps;
+		profile_instances_max = (int32_t)hi;
+		break;
+	case STRESS_PROFILE_STEP:
+		if (every == 0)
+			return stress_profile_error(jobfile, "step expects N1,N2,... every TIME");
+		for (k = 0; k < profile_phase_count; k++) {
+			profile_phases[k].duration = every;
+			profile_phases[k].load = 100.0;
+			profile_instances_max = STRESS_MAXIMUM(profile_instances_max,
+				profile_phases[k].instances);
+		}
+		break;
+	case STRESS_PROFILE_SINE:
+		if ((lo < 0.0) || (hi > 100.0) || (hi < lo) || (period == 0) || (over == 0))
+			return stress_profile_error(jobfile, "sine expects LO..HI load %, 0 <= LO <= HI <= 100, period TIME over TIME");
+		if (steps <= 0)
+			steps = (int32_t)((PROFILE_SINE_STEPS * over + period - 1) / period);
+		steps = (int32_t)STRESS_MINIMUM((uint64_t)steps, over);
+		steps = STRESS_MAXIMUM(1, STRESS_MINIMUM(steps, PROFILE_PHASES_MAX));
+		for (k = 0; k < (size_t)steps; k++) {
+			const double duration = (double)over / (double)steps;
+			const double t = ((double)k + 0.5) * duration;
+
+			profile_phases[k].instances = instances;
+			profile_phases[k].duration = STRESS_MAXIMUM((uint64_t)round(duration), 1);
+			profile_phases[k].load = ((lo + hi) / 2.0) +
+				((hi - lo) / 2.0) * sin(2.0 * M_PI * t / (double)period);
+		}
+		profile_phase_count = (size_t)steps;
+		profile_instances_max = instances;
+		break;
+	default:
+		break;
+	}
+	return 1;
+}
+
+/*
+ *  stress_profile_enabled()
+ *	true if the job file has a load profile
+ */
+bool stress_profile_enabled(void)
+{
+	return profile_type != STRESS_PROFILE_NONE;
+}
+
+/*
+ *  stress_profile_stressor()
+ *	name of the stressor the load profile applies to
+ */
+const char *stress_profile_stressor(void)
+{
+	return profile_stressor;
+}
+
+/*
+ *  stress_profile_instances_max()
+ *	the largest number of instances used by any phase, 0 = all CPUs
+ */
+int32_t stress_profile_instances_max(void)
+{
+	return profile_instances_max;
+}
+
+/*
+ *  stress_profile_phases()
+ *	number of phases of the load profile
+ */
+size_t stress_profile_phases(void)
+{
+	return profile_phase_count;
+}
+
+/*
+ *  stress_profile_phase()
+ *	get the number of instances, duration and load of a phase
+ */
+void stress_profile_phase(
+	const size_t phase,
+	int32_t *instances,
+	uint64_t *duration,
+	double *load)
+{
+	*instances = profile_phases[phase].instances;
+	*duration = profile_phases[phase].duration;
+	*load = profile_phases[phase].load;
+}
+
+/*
+ *  stress_profile_signal()
+ *	send a signal to the running instances of a stressor
+ */
+static void stress_profile_signal(stress_stressor_t *ss, const int32_t instances, const int sig)
+{
+	int32_t j;
+
+	for (j = 0; j < instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		/* only signal live instances, pids of completed ones may be reused */
+		if ((stats->pid > 0) && !stats->completed)
+			(void)shim_kill(stats->pid, sig);
+	}
+}
+
+/*
+ *  stress_profile_duty_start()
+ *	start a duty cycle process that runs the instances for load% of
+ *	every 100 milliseconds by stopping and continuing them with
+ *	SIGSTOP and SIGCONT until the end of the phase
+ */
+void stress_profile_duty_start(
+	stress_stressor_t *ss,
+	const int32_t instances,
+	const double load,
+	const uint64_t duration)
+{
+	double t, end;
+
+	if (load >= 100.0)
+		return;
+
+	profile_duty_pid = fork();
+	if (profile_duty_pid != 0)
+		return;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [profile]");
+
+	t = stress_time_now();
+	end = t + (double)duration;
+	while (stress_continue_flag() && (t < end)) {
+		const double on = PROFILE_DUTY_PERIOD * load / 100.0;
+
+		stress_profile_signal(ss, instances, SIGCONT);
+		if (on > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(on * STRESS_DBL_NANOSECOND));
+		stress_profile_signal(ss, instances, SIGSTOP);
+		t += PROFILE_DUTY_PERIOD;
+		if (t > stress_time_now())
+			(void)shim_nanosleep_uint64((uint64_t)((t - stress_time_now()) * STRESS_DBL_NANOSECOND));
+	}
+	stress_profile_signal(ss, instances, SIGCONT);
+	_exit(0);
+}
+
+/*
+ *  stress_profile_duty_stop()
+ *	stop the duty cycle process
+ */
+void stress_profile_duty_stop(void)
+{
+	if (profile_duty_pid <= 0)
+		return;
+	(void)stress_kill_pid_wait(profile_duty_pid, NULL);
+	profile_duty_pid = -1;
+}
+
+/*
+ *  stress_profile_record()
+ *	record the bogo-ops and run time of the instances of a phase
+ */
+void stress_profile_record(
+	const size_t phase,
+	const stress_stressor_t *ss,
+	const int32_t instances)
+{
+	stress_profile_phase_t *p = &profile_phases[phase];
+	int32_t j, n = 0;
+	double run_time = 0.0;
+
+	p->counter = 0;
+	for (j = 0; j < instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		p->counter += stats->args.ci.counter;
+		if (stats->completed) {
+			run_time += stats->duration;
+			n++;
+		}
+	}
+	p->instances = instances;
+	p->run_time = n ? run_time / (double)n : 0.0;
+	p->recorded = true;
+}
+
+/*
+ *  stress_profile_dump()
+ *	report the throughput of each phase and, for ramp and step
+ *	profiles, the knee point, the first phase where adding instances
+ *	gains less than half the per instance throughput of the first phase
+ */
+void stress_profile_dump(FILE *yaml)
+{
+	size_t k, knee = 0;
+	double base = 0.0, prev_rate = 0.0;
+	int32_t prev_instances = 0;
+	bool found = false;
+
+	if (profile_type == STRESS_PROFILE_NONE)
+		return;
+
+	pr_block_begin();
+	pr_inf("profile: %s %s, %zu phases\n", profile_stressor,
+		profile_type_names[profile_type], profile_phase_count);
+	pr_inf("%5s %9s %8s %9s %12s %12s %14s\n", "phase", "instances", "load %",
+		"time (s)", "bogo ops", "bogo ops/s", "ops/s/instance");
+	pr_yaml(yaml, "profile:\n");
+
+	for (k = 0; k < profile_phase_count; k++) {
+		const stress_profile_phase_t *p = &profile_phases[k];
+		double rate, rate_per_instance;
+
+		if (!p->recorded)
+			continue;
+		rate = (p->run_time > 0.0) ? (double)p->counter / p->run_time : 0.0;
+		rate_per_instance = (p->instances > 0) ? rate / (double)p->instances : 0.0;
+
+		pr_inf("%5zu %9" PRId32 " %8.2f %9.2f %12" PRIu64 " %12.2f %14.2f\n",
+			k, p->instances, p->load, p->run_time, p->counter,
+			rate, rate_per_instance);
+		pr_yaml(yaml, "    - phase: %zu\n", k);
+		pr_yaml(yaml, "      instances: %" PRId32 "\n", p->instances);
+		pr_yaml(yaml, "      load-percent: %f\n", p->load);
+		pr_yaml(yaml, "      run-time: %f\n", p->run_time);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", p->counter);
+		pr_yaml(yaml, "      bogo-ops-per-second: %f\n", rate);
+		pr_yaml(yaml, "      bogo-ops-per-second-per-instance: %f\n", rate_per_instance);
+		pr_yaml(yaml, "\n");
+
+		if (profile_type == STRESS_PROFILE_SINE)
+			continue;
+		if (base <= 0.0) {
+			base = rate_per_instance;
+		} else if (!found && (p->instances > prev_instances) &&
+			   ((rate - prev_rate) / (double)(p->instances - prev_instances) <
+			    PROFILE_KNEE_GAIN * base)) {
+			knee = k;
+			found = true;
+		}
+		prev_rate = rate;
+		prev_instances = p->instances;
+	}
+
+	if (found) {
+		pr_inf("profile: knee at phase %zu, %" PRId32 " instances\n",
+			knee, profile_phases[knee].instances);
+		pr_yaml(yaml, "profile-knee:\n");
+		pr_yaml(yaml, "      stressor: %s\n", profile_stressor);
+		pr_yaml(yaml, "      phase: %zu\n", knee);
+		pr_yaml(yaml, "      instances: %" PRId32 "\n", profile_phases[knee].instances);
+		pr_yaml(yaml, "\n");
+	} else if (profile_type != STRESS_PROFILE_SINE) {
+		pr_inf("profile: no knee point found, throughput scales with instances\n");
+	}
+	pr_block_end();
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PROFILE_H
+#define CORE_PROFILE_H
+
+#include "stress-ng.h"
+
+extern int stress_profile_parse(const char *jobfile, const int argc, char **argv);
+extern bool stress_profile_enabled(void);
+extern const char *stress_profile_stressor(void);
+extern int32_t stress_profile_instances_max(void);
+extern size_t stress_profile_phases(void);
+extern void stress_profile_phase(const size_t phase, int32_t *instances,
+	uint64_t *duration, double *load);
+extern void stress_profile_duty_start(stress_stressor_t *ss, const int32_t instances,
+	const double load, const uint64_t duration);
+extern void stress_profile_duty_stop(void);
+extern void stress_profile_record(const size_t phase, const stress_stressor_t *ss,
+	const int32_t instances);
+extern void stress_profile_dump(FILE *yaml);
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-psi.h"
+
+const char *stress_psi_resources[STRESS_PSI_RESOURCES] = {
+	"cpu",
+	"memory",
+	"io",
+};
+
+/* Stall time accrued while a stressor was running */
+typedef struct stress_psi_record {
+	struct stress_psi_record *next;	/* next record in list */
+	const stress_stressor_t *ss;	/* stressor */
+	double duration;		/* run duration in seconds */
+	uint64_t some[STRESS_PSI_RESOURCES]; /* some stall, usecs */
+	uint64_t full[STRESS_PSI_RESOURCES]; /* full stall, usecs */
+} stress_psi_record_t;
+
+static bool psi_enabled;
+static stress_psi_t psi_begin[STRESS_PSI_RESOURCES];
+static bool psi_begin_valid;
+static stress_psi_record_t *psi_records;
+
+/*
+ *  stress_psi_enable()
+ *	enable per stressor pressure stall accounting
+ */
+void stress_psi_enable(void)
+{
+	psi_enabled = true;
+}
+
+/*
+ *  stress_psi_read()
+ *	read /proc/pressure/{cpu,memory,io}, returns -1 if
+ *	PSI is not supported, missing full lines read as zero
+ */
+int stress_psi_read(stress_psi_t psi[STRESS_PSI_RESOURCES])
+{
+	size_t i;
+
+	(void)shim_memset(psi, 0, sizeof(*psi) * STRESS_PSI_RESOURCES);
+	for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+		char path[64], buf[256];
+		FILE *fp;
+
+		(void)snprintf(path, sizeof(path), "/proc/pressure/%s", stress_psi_resources[i]);
+		fp = fopen(path, "r");
+		if (!fp)
+			return -1;
+		while (fgets(buf, sizeof(buf), fp)) {
+			double avg10;
+			uint64_t total;
+
+			if (sscanf(buf, "some avg10=%lf avg60=%*f avg300=%*f total=%" SCNu64,
+				   &avg10, &total) == 2) {
+				psi[i].some_avg10 = avg10;
+				psi[i].some_total = total;
+			} else if (sscanf(buf, "full avg10=%lf avg60=%*f avg300=%*f total=%" SCNu64,
+				   &avg10, &total) == 2) {
+				psi[i].full_avg10 = avg10;
+				psi[i].full_total = total;
+			}
+		}
+		(void)fclose(fp);
+	}
+	return 0;
+}
+
+/*
+ *  stress_psi_begin()
+ *	snapshot the stall totals at the start of a run
+ */
+void stress_psi_begin(void)
+{
+	if (!psi_enabled)
+		return;
+	psi_begin_valid = (stress_psi_read(psi_begin) == 0);
+}
+
+/*
+ *  stress_psi_end()
+ *	add the stall time since stress_psi_begin() to each
+ *	of the stressors that were run, stressors that run in
+ *	parallel all share the same system wide stall time
+ */
+void stress_psi_end(const stress_stressor_t *stressors_list, const double duration)
+{
+	const stress_stressor_t *ss;
+	stress_psi_t end[STRESS_PSI_RESOURCES];
+
+	if (!psi_begin_valid)
+		return;
+	psi_begin_valid = false;
+	if (stress_psi_read(end) < 0)
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_psi_record_t *record;
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (record = psi_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record) {
+			record = (stress_psi_record_t *)calloc(1, sizeof(*record));
+			if (!record)
+				continue;
+			record->ss = ss;
+			record->next = psi_records;
+			psi_records = record;
+		}
+		record->duration += duration;
+		for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+			record->some[i] += end[i].some_total - psi_begin[i].some_total;
+			record->full[i] += end[i].full_total - psi_begin[i].full_total;
+		}
+	}
+}
+
+/*
+ *  stress_psi_dump()
+ *	dump the some and full stall time of each resource and
+ *	the percentage of the run time stalled for each stressor
+ */
+void stress_psi_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool dumped_heading = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_psi_record_t *record;
+		char munged[64];
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+		for (record = psi_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record)
+			continue;
+
+		if (!dumped_heading) {
+			dumped_heading = true;
+			pr_inf("pressure stall:%16s %10s %8s %10s %8s\n",
+				"", "some (s)", "some %", "full (s)", "full %");
+			pr_yaml(yaml, "pressure-stall:\n");
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("%s:\n", munged);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      duration: %f\n", record->duration);
+
+		for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+			const char *name = stress_psi_resources[i];
+			const double some = (double)record->some[i] / 1000000.0;
+			const double full = (double)record->full[i] / 1000000.0;
+			const double some_pc = (record->duration > 0.0) ? 100.0 * some / record->duration : 0.0;
+			const double full_pc = (record->duration > 0.0) ? 100.0 * full / record->duration : 0.0;
+
+			pr_inf("%30s %10.2f %8.2f %10.2f %8.2f\n",
+				name, some, some_pc, full, full_pc);
+			pr_yaml(yaml, "      %s-some-stall-secs: %f\n", name, some);
+			pr_yaml(yaml, "      %s-some-stall-percent: %f\n", name, some_pc);
+			pr_yaml(yaml, "      %s-full-stall-secs: %f\n", name, full);
+			pr_yaml(yaml, "      %s-full-stall-percent: %f\n", name, full_pc);
+		}
+	}
+	if (dumped_heading)
+		pr_yaml(yaml, "\n");
+}
+
+/*
+ *  stress_psi_free()
+ *	free the per stressor stall records
+ */
+void stress_psi_free(void)
+{
+	stress_psi_record_t *record = psi_records;
+
+	while (record) {
+		stress_psi_record_t *next = record->next;
+
+		free(record);
+		record = next;
+	}
+	psi_records = NULL;
+}
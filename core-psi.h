@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_PSI_H
+#define CORE_PSI_H
+
+#include "stress-ng.h"
+
+#define STRESS_PSI_RESOURCES	(3)	/* cpu, memory and io */
+
+/* Pressure stall information of a resource */
+typedef struct {
+	double some_avg10;		/* % time some tasks stalled, last 10s */
+	double full_avg10;		/* % time all tasks stalled, last 10s */
+	uint64_t some_total;		/* total some stall time, usecs */
+	uint64_t full_total;		/* total full stall time, usecs */
+} stress_psi_t;
+
+extern const char *stress_psi_resources[STRESS_PSI_RESOURCES];
+
+extern void stress_psi_enable(void);
+extern int stress_psi_read(stress_psi_t psi[STRESS_PSI_RESOURCES]);
+extern void stress_psi_begin(void);
+extern void stress_psi_end(const stress_stressor_t *stressors_list, const double duration);
+extern void stress_psi_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_psi_free(void);
+
+#endif
@@ -0,0 +1,512 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-resctrl.h"
+
+#define STRESS_RESCTRL_PATH		"/sys/fs/resctrl"
+#define STRESS_RESCTRL_SPECS_MAX	(64)
+#define STRESS_RESCTRL_SCHEMATA_MAX	(256)
+#define STRESS_RESCTRL_INTERVAL		(1.0)	/* --resctrl-stats sample interval, secs */
+
+/* A --resctrl stressor:schemata specification */
+typedef struct {
+	char name[64];			/* stressor name or "all" */
+	char schemata[STRESS_RESCTRL_SCHEMATA_MAX]; /* schemata lines, comma separated */
+} stress_resctrl_spec_t;
+
+/* resctrl monitoring counters, summed over all L3 domains */
+typedef struct {
+	uint64_t llc_occupancy;		/* bytes of L3 occupied */
+	uint64_t mbm_total_bytes;	/* total memory bandwidth bytes */
+	uint64_t mbm_local_bytes;	/* local memory bandwidth bytes */
+	bool llc_valid;			/* llc_occupancy readable */
+	bool mbm_valid;			/* mbm counters readable */
+} stress_resctrl_mon_t;
+
+/* --resctrl-stats interval samples, shared with the sampling process */
+typedef struct {
+	uint64_t samples;		/* number of interval samples */
+	uint64_t llc_sum;		/* sum of sampled llc_occupancy */
+	uint64_t llc_max;		/* peak llc_occupancy */
+	double total_rate_max;		/* peak total bandwidth, bytes/sec */
+	double local_rate_max;		/* peak local bandwidth, bytes/sec */
+} stress_resctrl_samples_t;
+
+/* A stressor's resctrl group */
+typedef struct stress_resctrl {
+	struct stress_resctrl *next;	/* next group in list */
+	const stress_stressor_t *ss;	/* stressor in the group */
+	const stress_resctrl_spec_t *spec; /* schemata applied, NULL for a monitoring group */
+	stress_resctrl_mon_t mon_start;	/* counters at start of run */
+	stress_resctrl_samples_t *samples; /* interval samples, NULL if not sampled */
+	double t_start;			/* time of start counters */
+	char path[PATH_MAX];		/* resctrl group directory */
+} stress_resctrl_t;
+
+static stress_resctrl_spec_t resctrl_specs[STRESS_RESCTRL_SPECS_MAX];
+static size_t resctrl_specs_count;
+static stress_resctrl_t *resctrls;	/* per stressor resctrl groups */
+static stress_resctrl_samples_t *resctrl_samples; /* shared interval samples */
+static size_t resctrl_samples_size;	/* size of resctrl_samples mapping */
+static pid_t resctrl_sampler_pid = -1;	/* --resctrl-stats sampling process */
+
+/*
+ *  stress_set_resctrl()
+ *	parse a --resctrl stressor:schemata option, schemata lines
+ *	are comma separated, e.g. cache:L3:0=00f,MB:0=20, the
+ *	option may be used more than once
+ */
+int stress_set_resctrl(const char *opt)
+{
+	stress_resctrl_spec_t *spec;
+	const char *colon = strchr(opt, ':');
+	size_t len;
+
+	if (!colon || (colon == opt) || (colon[1] == '\0')) {
+		(void)fprintf(stderr, "resctrl must be of the form stressor:schemata, "
+			"e.g. stream:L3:0=00f,MB:0=20\n");
+		return -1;
+	}
+	if (resctrl_specs_count >= STRESS_RESCTRL_SPECS_MAX) {
+		(void)fprintf(stderr, "resctrl can only be specified %d times\n",
+			STRESS_RESCTRL_SPECS_MAX);
+		return -1;
+	}
+	len = (size_t)(colon - opt);
+	spec = &resctrl_specs[resctrl_specs_count];
+	if ((len >= sizeof(spec->name)) || (strlen(colon + 1) >= sizeof(spec->schemata))) {
+		(void)fprintf(stderr, "resctrl stressor name or schemata too long\n");
+		return -1;
+	}
+	(void)memcpy(spec->name, opt, len);
+	spec->name[len] = '\0';
+	(void)shim_strscpy(spec->schemata, colon + 1, sizeof(spec->schemata));
+	resctrl_specs_count++;
+	return 0;
+}
+
+/*
+ *  stress_resctrl_spec()
+ *	find the schemata for a stressor, a spec that names the
+ *	stressor takes precedence over an "all" spec
+ */
+static const stress_resctrl_spec_t *stress_resctrl_spec(const char *name)
+{
+	const stress_resctrl_spec_t *all = NULL;
+	size_t i;
+
+	for (i = 0; i < resctrl_specs_count; i++) {
+		if (!strcmp(resctrl_specs[i].name, name))
+			return &resctrl_specs[i];
+		if (!strcmp(resctrl_specs[i].name, "all"))
+			all = &resctrl_specs[i];
+	}
+	return all;
+}
+
+/*
+ *  stress_resctrl_write()
+ *	write a string to a resctrl file
+ */
+static int stress_resctrl_write(const char *dir, const char *file, const char *str)
+{
+	char path[PATH_MAX];
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/%s", dir, file);
+	if ((ret < 0) || ((size_t)ret >= sizeof(path))) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	return (stress_system_write(path, str, strlen(str)) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_resctrl_read_mon_file()
+ *	read a monitoring counter of a mon_data domain,
+ *	returns -1 if the path is too long or the counter
+ *	can't be read
+ */
+static int stress_resctrl_read_mon_file(
+	const char *path,
+	const char *domain,
+	const char *counter,
+	uint64_t *val)
+{
+	char file[PATH_MAX + NAME_MAX + 32], buf[64];
+	int ret;
+
+	ret = snprintf(file, sizeof(file), "%s/%s/%s", path, domain, counter);
+	if ((ret < 0) || ((size_t)ret >= sizeof(file)))
+		return -1;
+	if ((stress_system_read(file, buf, sizeof(buf)) > 0) &&
+	    (sscanf(buf, "%" SCNu64, val) == 1))
+		return 0;
+	return -1;
+}
+
+/*
+ *  stress_resctrl_read_mon()
+ *	sum the L3 monitoring counters of a resctrl group over
+ *	all the mon_data/mon_L3_NN domains
+ */
+static void stress_resctrl_read_mon(const char *dir, stress_resctrl_mon_t *mon)
+{
+	char path[PATH_MAX];
+	DIR *dp;
+	const struct dirent *de;
+
+	(void)shim_memset(mon, 0, sizeof(*mon));
+	(void)snprintf(path, sizeof(path), "%s/mon_data", dir);
+	dp = opendir(path);
+	if (!dp)
+		return;
+	while ((de = readdir(dp)) != NULL) {
+		uint64_t val;
+
+		if (strncmp(de->d_name, "mon_L3_", 7))
+			continue;
+		if (stress_resctrl_read_mon_file(path, de->d_name, "llc_occupancy", &val) == 0) {
+			mon->llc_occupancy += val;
+			mon->llc_valid = true;
+		}
+		if (stress_resctrl_read_mon_file(path, de->d_name, "mbm_total_bytes", &val) == 0) {
+			mon->mbm_total_bytes += val;
+			mon->mbm_valid = true;
+		}
+		if (stress_resctrl_read_mon_file(path, de->d_name, "mbm_local_bytes", &val) == 0)
+			mon->mbm_local_bytes += val;
+	}
+	(void)closedir(dp);
+}
+
+/*
+ *  stress_resctrl_schemata()
+ *	write the comma separated schemata lines to a group, each
+ *	line is written separately so a bad line is reported
+ */
+static int stress_resctrl_schemata(const char *dir, const char *schemata)
+{
+	char buf[STRESS_RESCTRL_SCHEMATA_MAX];
+	char *line, *saveptr = NULL, *str;
+	int rc = 0;
+
+	(void)shim_strscpy(buf, schemata, sizeof(buf));
+	for (str = buf; (line = strtok_r(str, ",", &saveptr)) != NULL; str = NULL) {
+		char tmp[STRESS_RESCTRL_SCHEMATA_MAX + 2];
+
+		(void)snprintf(tmp, sizeof(tmp), "%s\n", line);
+		if (stress_resctrl_write(dir, "schemata", tmp) < 0) {
+			pr_warn("resctrl: cannot set schemata '%s' of %s, errno=%d (%s)\n",
+				line, dir, errno, strerror(errno));
+			rc = -1;
+		}
+	}
+	return rc;
+}
+
+/*
+ *  stress_resctrl_init()
+ *	create a resctrl group for each stressor that has a
+ *	--resctrl schemata and apply the cache allocation (CAT)
+ *	and memory bandwidth allocation (MBA) schemata, with
+ *	--resctrl-stats the other stressors get a monitoring
+ *	group in the default group's mon_groups
+ */
+void stress_resctrl_init(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	stress_resctrl_t *resctrl;
+	uint32_t n = 0;
+
+	if ((resctrl_specs_count == 0) && !(g_opt_flags & OPT_FLAGS_RESCTRL_STATS))
+		return;
+
+	if (access(STRESS_RESCTRL_PATH "/schemata", R_OK) < 0) {
+		pr_inf("resctrl: %s is not mounted or not supported, disabling resctrl groups\n",
+			STRESS_RESCTRL_PATH);
+		g_opt_flags &= ~OPT_FLAGS_RESCTRL_STATS;
+		return;
+	}
+	if ((g_opt_flags & OPT_FLAGS_RESCTRL_STATS) &&
+	    (access(STRESS_RESCTRL_PATH "/info/L3_MON", R_OK) < 0)) {
+		pr_inf("resctrl: no L3 cache or memory bandwidth monitoring support, "
+			"disabling resctrl stats\n");
+		g_opt_flags &= ~OPT_FLAGS_RESCTRL_STATS;
+	}
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_resctrl_spec_t *spec;
+		stress_resctrl_t *resctrl;
+		char munged[64];
+
+		if (ss->ignore.run)
+			continue;
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		spec = stress_resctrl_spec(munged);
+		if (!spec && !(g_opt_flags & OPT_FLAGS_RESCTRL_STATS))
+			continue;
+
+		resctrl = (stress_resctrl_t *)calloc(1, sizeof(*resctrl));
+		if (!resctrl)
+			break;
+		(void)snprintf(resctrl->path, sizeof(resctrl->path),
+			"%s%s/stress-ng-%" PRIdMAX "-%s-%" PRIu32,
+			STRESS_RESCTRL_PATH, spec ? "" : "/mon_groups",
+			(intmax_t)getpid(), munged, n++);
+		if (mkdir(resctrl->path, 0755) < 0) {
+			pr_inf("resctrl: cannot create group %s, errno=%d (%s)%s\n",
+				resctrl->path, errno, strerror(errno),
+				(errno == ENOSPC) ? (spec ? ", out of CLOSIDs" : ", out of RMIDs") : "");
+			free(resctrl);
+			continue;
+		}
+		if (spec)
+			(void)stress_resctrl_schemata(resctrl->path, spec->schemata);
+		stress_resctrl_read_mon(resctrl->path, &resctrl->mon_start);
+		resctrl->t_start = stress_time_now();
+		resctrl->ss = ss;
+		resctrl->spec = spec;
+		resctrl->next = resctrls;
+		resctrls = resctrl;
+	}
+
+	if (!(g_opt_flags & OPT_FLAGS_RESCTRL_STATS) || (n == 0))
+		return;
+	resctrl_samples_size = n * sizeof(*resctrl_samples);
+	resctrl_samples = (stress_resctrl_samples_t *)stress_mmap_populate(NULL,
+		resctrl_samples_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (resctrl_samples == MAP_FAILED) {
+		pr_inf("resctrl: cannot mmap %zu bytes for resctrl stats samples, "
+			"reporting run totals only\n", resctrl_samples_size);
+		resctrl_samples = NULL;
+		return;
+	}
+	stress_set_vma_anon_name(resctrl_samples, resctrl_samples_size, "resctrl-samples");
+	for (n = 0, resctrl = resctrls; resctrl; resctrl = resctrl->next, n++)
+		resctrl->samples = &resctrl_samples[n];
+}
+
+/*
+ *  stress_resctrl_stats_start()
+ *	start a process that samples the LLC occupancy and memory
+ *	bandwidth of each resctrl group every interval
+ */
+void stress_resctrl_stats_start(void)
+{
+	stress_resctrl_t *resctrl;
+	double t;
+
+	if (!resctrl_samples)
+		return;
+
+	resctrl_sampler_pid = fork();
+	if ((resctrl_sampler_pid < 0) || (resctrl_sampler_pid > 0))
+		return;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [resctrl]");
+
+	/* this process's copy of the start counters become the previous sample */
+	t = stress_time_now();
+	for (resctrl = resctrls; resctrl; resctrl = resctrl->next)
+		resctrl->t_start = t;
+
+	while (stress_continue_flag()) {
+		double delta;
+
+		t += STRESS_RESCTRL_INTERVAL;
+		delta = t - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+
+		for (resctrl = resctrls; resctrl; resctrl = resctrl->next) {
+			stress_resctrl_samples_t *samples = resctrl->samples;
+			stress_resctrl_mon_t mon;
+			const double now = stress_time_now();
+			const double dt = now - resctrl->t_start;
+
+			stress_resctrl_read_mon(resctrl->path, &mon);
+			samples->samples++;
+			samples->llc_sum += mon.llc_occupancy;
+			samples->llc_max = STRESS_MAXIMUM(samples->llc_max, mon.llc_occupancy);
+			if (mon.mbm_valid && (dt > 0.0)) {
+				const double total_rate = (double)(mon.mbm_total_bytes -
+					resctrl->mon_start.mbm_total_bytes) / dt;
+				const double local_rate = (double)(mon.mbm_local_bytes -
+					resctrl->mon_start.mbm_local_bytes) / dt;
+
+				samples->total_rate_max = STRESS_MAXIMUM(samples->total_rate_max, total_rate);
+				samples->local_rate_max = STRESS_MAXIMUM(samples->local_rate_max, local_rate);
+			}
+			resctrl->mon_start = mon;
+			resctrl->t_start = now;
+		}
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_resctrl_stats_stop()
+ *	stop the resctrl sampling process
+ */
+void stress_resctrl_stats_stop(void)
+{
+	if (resctrl_sampler_pid <= 0)
+		return;
+	(void)stress_kill_pid_wait(resctrl_sampler_pid, NULL);
+	resctrl_sampler_pid = -1;
+}
+
+/*
+ *  stress_resctrl_free()
+ *	remove the stressor resctrl groups, any tasks still in
+ *	a group are moved back to the default group by the kernel
+ */
+void stress_resctrl_free(void)
+{
+	stress_resctrl_t *resctrl = resctrls;
+
+	while (resctrl) {
+		stress_resctrl_t *next = resctrl->next;
+
+		(void)rmdir(resctrl->path);
+		free(resctrl);
+		resctrl = next;
+	}
+	resctrls = NULL;
+	if (resctrl_samples) {
+		(void)munmap((void *)resctrl_samples, resctrl_samples_size);
+		resctrl_samples = NULL;
+	}
+}
+
+/*
+ *  stress_resctrl_attach()
+ *	move the calling stressor instance into the resctrl group
+ *	of stressor ss, threads created after this inherit the group
+ */
+void stress_resctrl_attach(const stress_stressor_t *ss)
+{
+	const stress_resctrl_t *resctrl;
+	char buf[32];
+
+	for (resctrl = resctrls; resctrl; resctrl = resctrl->next) {
+		if (resctrl->ss == ss)
+			break;
+	}
+	if (!resctrl)
+		return;
+
+	(void)snprintf(buf, sizeof(buf), "%" PRIdMAX "\n", (intmax_t)getpid());
+	if (stress_resctrl_write(resctrl->path, "tasks", buf) < 0)
+		pr_dbg("resctrl: cannot move PID %" PRIdMAX " into %s, errno=%d (%s)\n",
+			(intmax_t)getpid(), resctrl->path, errno, strerror(errno));
+}
+
+/*
+ *  stress_resctrl_dump()
+ *	report the schemata, L3 occupancy and the total, local and
+ *	remote memory bandwidth of each stressor's resctrl group
+ */
+void stress_resctrl_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool header = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_resctrl_t *resctrl;
+		const stress_resctrl_samples_t *samples;
+		stress_resctrl_mon_t mon;
+		char munged[64], llc_str[32], mbm_str[48];
+		double duration, llc_mean = 0.0;
+		uint64_t total_bytes, local_bytes, remote_bytes;
+
+		for (resctrl = resctrls; resctrl; resctrl = resctrl->next) {
+			if (resctrl->ss == ss)
+				break;
+		}
+		if (!resctrl)
+			continue;
+
+		stress_resctrl_read_mon(resctrl->path, &mon);
+		duration = stress_time_now() - resctrl->t_start;
+		samples = (resctrl->samples && resctrl->samples->samples) ? resctrl->samples : NULL;
+		total_bytes = mon.mbm_total_bytes - resctrl->mon_start.mbm_total_bytes;
+		local_bytes = mon.mbm_local_bytes - resctrl->mon_start.mbm_local_bytes;
+		remote_bytes = (total_bytes > local_bytes) ? total_bytes - local_bytes : 0;
+		if (mon.llc_valid)
+			llc_mean = samples ? (double)samples->llc_sum / (double)samples->samples :
+					     (double)mon.llc_occupancy;
+
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		if (!header) {
+			pr_inf("resctrl:\n");
+			pr_inf("%-15s %-24s %10s %10s %8s %8s %8s\n", "stressor", "schemata",
+				"LLC KB", "LLC KB", "DRAM", "local", "remote");
+			pr_inf("%-15s %-24s %10s %10s %8s %8s %8s\n", "", "",
+				"mean", "max", "GB/sec", "GB/sec", "GB/sec");
+			pr_yaml(yaml, "resctrl:\n");
+			header = true;
+		}
+		if (mon.llc_valid)
+			(void)snprintf(llc_str, sizeof(llc_str), "%10.1f %10.1f", llc_mean / (double)KB,
+				(double)(samples ? samples->llc_max : mon.llc_occupancy) / (double)KB);
+		else
+			(void)snprintf(llc_str, sizeof(llc_str), "%10s %10s", "n/a", "n/a");
+		if (mon.mbm_valid && (duration > 0.0))
+			(void)snprintf(mbm_str, sizeof(mbm_str), "%8.3f %8.3f %8.3f",
+				(double)total_bytes / (duration * (double)GB),
+				(double)local_bytes / (duration * (double)GB),
+				(double)remote_bytes / (duration * (double)GB));
+		else
+			(void)snprintf(mbm_str, sizeof(mbm_str), "%8s %8s %8s", "n/a", "n/a", "n/a");
+		pr_inf("%-15s %-24s %s %s\n", munged,
+			resctrl->spec ? resctrl->spec->schemata : "(monitor only)",
+			llc_str, mbm_str);
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		if (resctrl->spec)
+			pr_yaml(yaml, "      schemata: \"%s\"\n", resctrl->spec->schemata);
+		if (mon.llc_valid) {
+			pr_yaml(yaml, "      llc-occupancy-bytes: %" PRIu64 "\n", mon.llc_occupancy);
+			pr_yaml(yaml, "      llc-occupancy-mean-bytes: %.0f\n", llc_mean);
+			if (samples)
+				pr_yaml(yaml, "      llc-occupancy-max-bytes: %" PRIu64 "\n", samples->llc_max);
+		}
+		if (mon.mbm_valid) {
+			pr_yaml(yaml, "      mbm-total-bytes: %" PRIu64 "\n", total_bytes);
+			pr_yaml(yaml, "      mbm-local-bytes: %" PRIu64 "\n", local_bytes);
+			pr_yaml(yaml, "      mbm-remote-bytes: %" PRIu64 "\n", remote_bytes);
+			if (duration > 0.0) {
+				pr_yaml(yaml, "      dram-gb-per-sec: %f\n", (double)total_bytes / (duration * (double)GB));
+				pr_yaml(yaml, "      dram-local-gb-per-sec: %f\n", (double)local_bytes / (duration * (double)GB));
+				pr_yaml(yaml, "      dram-remote-gb-per-sec: %f\n", (double)remote_bytes / (duration * (double)GB));
+			}
+			if (samples) {
+				pr_yaml(yaml, "      dram-peak-gb-per-sec: %f\n", samples->total_rate_max / (double)GB);
+				pr_yaml(yaml, "      dram-local-peak-gb-per-sec: %f\n", samples->local_rate_max / (double)GB);
+			}
+		}
+		pr_yaml(yaml, "\n");
+	}
+}
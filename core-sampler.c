@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2024      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-jsonl.h"
+#include "core-killpid.h"
+#include "core-cycles.h"
+#include "core-freq.h"
+#include "core-numa.h"
+#include "core-sampler.h"
+
+#define STABLE_WINDOW_MIN	(3)
+#define STABLE_WINDOW_MAX	(64)
+#define STABLE_WINDOW_DEFAULT	(5)
+
+#define WARMUP_POLL_SECS	(0.1)	/* --warmup snapshot poll interval */
+
+/* Per stressor bogo-op rate history for --until-stable */
+typedef struct {
+	double prev_time;		/* time of previous sample */
+	uint64_t prev_counter;		/* sum of counters at previous sample */
+	double rate[STABLE_WINDOW_MAX];	/* ring of bogo-op rates */
+	uint32_t head;			/* next rate to write */
+	uint32_t count;			/* number of rates in ring */
+	bool sampled;			/* true if prev_* are valid */
+	bool stopped;			/* true if stressor told to stop */
+} stress_stable_t;
+
+static pid_t sampler_pid = -1;
+static int32_t sample_interval = 0;
+static double stable_cv = 0.0;		/* --until-stable CV threshold, % */
+static uint32_t stable_window = STABLE_WINDOW_DEFAULT;
+static uint64_t warmup = 0;		/* --warmup seconds */
+
+/*
+ *  stress_set_sample_interval()
+ *	parse --sample-interval option
+ */
+int stress_set_sample_interval(const char *const opt)
+{
+	const uint64_t interval = stress_get_uint64_time(opt);
+
+	if ((interval < 1) || (interval > 3600)) {
+		(void)fprintf(stderr, "sample-interval must in the range 1 to 3600 seconds.\n");
+		_exit(EXIT_FAILURE);
+	}
+	sample_interval = (int32_t)interval;
+	/* samples are reported with the metrics */
+	g_opt_flags |= OPT_FLAGS_METRICS;
+
+	return stress_set_setting_global("sample-interval", TYPE_ID_INT32, &sample_interval);
+}
+
+/*
+ *  stress_set_warmup()
+ *	parse --warmup option
+ */
+int stress_set_warmup(const char *const opt)
+{
+	warmup = stress_get_uint64_time(opt);
+	stress_check_range("warmup", warmup, 1, 86400);
+
+	return 0;
+}
+
+/*
+ *  stress_set_until_stable()
+ *	parse --until-stable option, the coefficient of variation
+ *	threshold in percent of a stressor's bogo-op rate
+ */
+int stress_set_until_stable(const char *const opt)
+{
+	char *end;
+	const double cv = strtod(opt, &end);
+
+	if ((end == opt) || (*end != '\0') || (cv <= 0.0) || (cv > 100.0)) {
+		(void)fprintf(stderr, "until-stable must be a percentage greater than 0 and up to 100.\n");
+		_exit(EXIT_FAILURE);
+	}
+	stable_cv = cv;
+
+	return 0;
+}
+
+/*
+ *  stress_set_until_stable_window()
+ *	parse --until-stable-window option, number of samples
+ *	of bogo-op rate used to check for a stable rate
+ */
+int stress_set_until_stable_window(const char *const opt)
+{
+	const uint32_t window = stress_get_uint32(opt);
+
+	stress_check_range("until-stable-window", (uint64_t)window,
+		STABLE_WINDOW_MIN, STABLE_WINDOW_MAX);
+	stable_window = window;
+
+	return 0;
+}
+
+/*
+ *  stress_sampler_until_stable()
+ *	return true if stressors are stopped once stable
+ */
+bool stress_sampler_until_stable(void)
+{
+	return stable_cv > 0.0;
+}
+
+/*
+ *  stress_sampler_add()
+ *	add a bogo-op counter sample to the sample ring
+ */
+static void stress_sampler_add(
+	stress_samples_t *samples,
+	const double time,
+	const uint64_t counter)
+{
+	stress_sample_t *sample = &samples->item[samples->head];
+
+	sample->time = time;
+	sample->counter = counter;
+	samples->head = (samples->head + 1) % STRESS_SAMPLES_MAX;
+	samples->count++;
+}
+
+/*
+ *  stress_sampler_sample()
+ *	sample the bogo-op counter of a stressor instance, once the
+ *	instance has completed a final sample is taken at the end
+ *	of the instance run time and no more samples are taken
+ */
+static void stress_sampler_sample(stress_stats_t *stats, const double now)
+{
+	stress_samples_t *samples = &stats->samples;
+
+	if (samples->final)
+		return;
+	/* Not started yet */
+	if (stats->start <= 0.0)
+		return;
+	/* Don't sample a counter in the middle of an update */
+	if (!stats->args.ci.counter_ready)
+		return;
+
+	if (stats->completed) {
+		if (stats->duration > 0.0) {
+			stress_sampler_add(samples, stats->duration, stats->args.ci.counter);
+			samples->final = true;
+		}
+	} else if (stats->pid > 0) {
+		stress_sampler_add(samples, now - stats->start, stats->args.ci.counter);
+	}
+}
+
+/*
+ *  stress_sampler_warmup()
+ *	snapshot the bogo-op counter, cycle counter and CPU time of
+ *	a running stressor instance once the --warmup time has
+ *	elapsed, only the run time after the snapshot is counted
+ *	in the instance metrics. Returns true if the snapshot of
+ *	the instance is still pending
+ */
+static bool stress_sampler_warmup(stress_stats_t *stats, const double now)
+{
+	stress_warmup_t *wu = &stats->warmup;
+	char path[PATH_MAX], buf[1024], status[4096];
+	unsigned long int utime, stime, minflt, cminflt, majflt, cmajflt;
+	long int cutime, cstime;
+	const long int ticks_per_sec = sysconf(_SC_CLK_TCK);
+	const char *ptr;
+
+	if ((warmup == 0) || (wu->time > 0.0) || stats->completed)
+		return false;
+	if ((stats->start <= 0.0) || (stats->pid <= 0))
+		return true;
+	if (now < stats->start + (double)warmup)
+		return true;
+	/* Don't snapshot a counter in the middle of an update */
+	if (!stats->args.ci.counter_ready)
+		return true;
+
+	wu->utime = 0.0;
+	wu->stime = 0.0;
+	(void)shim_memset(&wu->counts, 0, sizeof(wu->counts));
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)stats->pid);
+	if ((ticks_per_sec > 0) &&
+	    (stress_system_read(path, buf, sizeof(buf)) > 0) &&
+	    ((ptr = strrchr(buf, ')')) != NULL) &&
+	    (sscanf(ptr + 1, " %*c %*d %*d %*d %*d %*d %*u %lu %lu %lu %lu %lu %lu %ld %ld",
+		&minflt, &cminflt, &majflt, &cmajflt,
+		&utime, &stime, &cutime, &cstime) == 8)) {
+		wu->utime = (double)(utime + (unsigned long int)cutime) / (double)ticks_per_sec;
+		wu->stime = (double)(stime + (unsigned long int)cstime) / (double)ticks_per_sec;
+		wu->counts.minflt = (uint64_t)(minflt + cminflt);
+		wu->counts.majflt = (uint64_t)(majflt + cmajflt);
+	}
+	/* context switches of reaped children are not available */
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/status", (intmax_t)stats->pid);
+	if (stress_system_read(path, status, sizeof(status)) > 0) {
+		static const char nvcsw[] = "\nvoluntary_ctxt_switches:";
+		static const char nivcsw[] = "\nnonvoluntary_ctxt_switches:";
+
+		if ((ptr = strstr(status, nvcsw)) != NULL)
+			wu->counts.nvcsw = (uint64_t)strtoull(ptr + sizeof(nvcsw) - 1, NULL, 10);
+		if ((ptr = strstr(status, nivcsw)) != NULL)
+			wu->counts.nivcsw = (uint64_t)strtoull(ptr + sizeof(nivcsw) - 1, NULL, 10);
+	}
+	wu->counter = stats->args.ci.counter;
+	wu->cycles = stress_cycles_get();
+	stress_asm_mb();
+	wu->time = stress_time_now();
+	return false;
+}
+
+/*
+ *  stress_sampler_stable()
+ *	add the current bogo-op rate of all the instances of a
+ *	stressor to its rate history and stop the stressor once
+ *	the coefficient of variation of the rate over the window
+ *	drops below the --until-stable threshold
+ */
+static void stress_sampler_stable(
+	stress_stressor_t *ss,
+	stress_stable_t *stable,
+	const double now)
+{
+	uint64_t counter = 0;
+	double rate, sum = 0.0, sum_sq = 0.0, mean, cv;
+	int32_t j;
+	uint32_t i;
+
+	if (stable->stopped)
+		return;
+
+	/* Only track the rate when all instances are running */
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		if ((stats->pid <= 0) || (stats->start <= 0.0) ||
+		    stats->completed || !stats->args.ci.counter_ready) {
+			stable->sampled = false;
+			stable->count = 0;
+			return;
+		}
+		counter += stats->args.ci.counter;
+	}
+	if (!stable->sampled) {
+		stable->prev_time = now;
+		stable->prev_counter = counter;
+		stable->sampled = true;
+		return;
+	}
+	if (now <= stable->prev_time)
+		return;
+
+	rate = (double)(counter - stable->prev_counter) / (now - stable->prev_time);
+	stable->prev_time = now;
+	stable->prev_counter = counter;
+	stable->rate[stable->head] = rate;
+	stable->head = (stable->head + 1) % stable_window;
+	if (stable->count < stable_window)
+		stable->count++;
+	if (stable->count < stable_window)
+		return;
+
+	for (i = 0; i < stable_window; i++) {
+		sum += stable->rate[i];
+		sum_sq += stable->rate[i] * stable->rate[i];
+	}
+	mean = sum / (double)stable_window;
+	if (mean <= 0.0)
+		return;
+	cv = 100.0 * sqrt(STRESS_MAXIMUM(0.0, (sum_sq / (double)stable_window) - (mean * mean))) / mean;
+	if (cv >= stable_cv)
+		return;
+
+	pr_inf("%s: bogo-op rate %.2f is stable (%.2f%% coefficient of variation "
+		"over %" PRIu32 " samples), stopping stressor\n",
+		ss->stressor->name, mean, cv, stable_window);
+	stable->stopped = true;
+	for (j = 0; j < ss->num_instances; j++) {
+		const pid_t pid = ss->stats[j]->pid;
+
+		if (pid > 0)
+			(void)shim_kill(pid, SIGALRM);
+	}
+}
+
+/*
+ *  stress_sampler_start()
+ *	start bogo-op counter sampler process, this samples the counters
+ *	of all the stressor instances every sample interval seconds, and
+ *	the perf counters too with the --perf option, and
+ *	stops stressors once their bogo-op rate is stable if the
+ *	--until-stable option is used
+ */
+void stress_sampler_start(stress_stressor_t *stressors_list, const int32_t num_instances)
+{
+	stress_stressor_t *ss;
+	stress_stable_t *stable = NULL;
+	size_t n = 0;
+	bool warmup_pending;
+	double t, interval;
+
+	if ((sample_interval == 0) && (stable_cv <= 0.0) &&
+	    !stress_numa_policy_enabled() &&
+	    !(g_opt_flags & OPT_FLAGS_FREQ_STATS) && (warmup == 0))
+		return;
+	/*
+	 *  --until-stable, --numa-policy, --freq-stats and --warmup
+	 *  default to sampling every second
+	 */
+	interval = (sample_interval > 0) ? (double)sample_interval : 1.0;
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if ((sample_interval > 0) && (g_opt_flags & OPT_FLAGS_PERF_STATS))
+		stress_perf_sample_init(num_instances);
+#endif
+
+	sampler_pid = fork();
+	if ((sampler_pid < 0) || (sampler_pid > 0))
+		return;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [sampler]");
+
+	if (stable_cv > 0.0) {
+		for (ss = stressors_list; ss; ss = ss->next)
+			n++;
+		stable = (stress_stable_t *)calloc(n, sizeof(*stable));
+		if (!stable)
+			pr_inf("sampler: cannot allocate stable rate tracking data, --until-stable disabled\n");
+	}
+
+	warmup_pending = (warmup > 0);
+	t = stress_time_now();
+	while (stress_continue_flag()) {
+		double delta, now;
+		int32_t i;
+		size_t k;
+
+		t += interval;
+		while ((delta = t - stress_time_now()) > 0.0) {
+			bool pending = false;
+
+			/* poll more frequently until the warm-up snapshots are taken */
+			if (warmup_pending)
+				delta = STRESS_MINIMUM(delta, WARMUP_POLL_SECS);
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+			if (!warmup_pending)
+				break;
+			now = stress_time_now();
+			for (i = 0; i < num_instances; i++)
+				pending |= stress_sampler_warmup(&g_shared->stats[i], now);
+			warmup_pending = pending;
+		}
+		now = stress_time_now();
+		for (i = 0; i < num_instances; i++) {
+			stress_sampler_sample(&g_shared->stats[i], now);
+			if (stress_numa_policy_enabled())
+				stress_numa_pages_sample(&g_shared->stats[i]);
+			stress_freq_sample(&g_shared->stats[i], now);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+			if (sample_interval > 0)
+				stress_perf_sample(i, now);
+#endif
+		}
+		if (sample_interval > 0)
+			stress_jsonl_sample(stressors_list, now);
+		if (!stable)
+			continue;
+		for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+			if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+				continue;
+			stress_sampler_stable(ss, &stable[k], now);
+		}
+	}
+	free(stable);
+	stress_freq_sample_free();
+	_exit(0);
+}
+
+/*
+ *  stress_sampler_stop()
+ *	stop the sampler process and take any outstanding final
+ *	samples of instances that completed since the last sample
+ */
+void stress_sampler_stop(const int32_t num_instances)
+{
+	int32_t i;
+
+	if (sampler_pid <= 0)
+		return;
+
+	(void)stress_kill_pid_wait(sampler_pid, NULL);
+	sampler_pid = -1;
+
+	for (i = 0; i < num_instances; i++) {
+		stress_stats_t *stats = &g_shared->stats[i];
+
+		if (stats->completed)
+			stress_sampler_sample(stats, stress_time_now());
+	}
+}
+
+/*
+ *  stress_sampler_dump()
+ *	dump the bogo-op counter samples of each instance of a stressor
+ */
+void stress_sampler_dump(FILE *yaml, const stress_stressor_t *ss)
+{
+	int32_t j;
+
+	if (!yaml || (sample_interval == 0))
+		return;
+
+	pr_yaml(yaml, "      bogo-ops-samples:\n");
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_samples_t *samples = &ss->stats[j]->samples;
+		const uint32_t n = STRESS_MINIMUM(samples->count, STRESS_SAMPLES_MAX);
+		const uint32_t start = (samples->count > STRESS_SAMPLES_MAX) ? samples->head : 0;
+		double prev_time = 0.0;
+		uint64_t prev_counter = 0;
+		uint32_t i;
+
+		pr_yaml(yaml, "        - instance: %" PRId32 "\n", j);
+		pr_yaml(yaml, "          samples-taken: %" PRIu32 "\n", samples->count);
+		if (n == 0)
+			continue;
+		pr_yaml(yaml, "          samples:\n");
+		for (i = 0; i < n; i++) {
+			const stress_sample_t *sample = &samples->item[(start + i) % STRESS_SAMPLES_MAX];
+			const double dt = sample->time - prev_time;
+			const double rate = (dt > 0.0) ?
+				(double)(sample->counter - prev_counter) / dt : 0.0;
+
+			/* First sample of a wrapped ring has no previous sample */
+			if ((i > 0) || (start == 0)) {
+				pr_yaml(yaml, "            - time: %f\n", sample->time);
+				pr_yaml(yaml, "              bogo-ops: %" PRIu64 "\n", sample->counter);
+				pr_yaml(yaml, "              bogo-ops-per-second: %f\n", rate);
+			}
+			prev_time = sample->time;
+			prev_counter = sample->counter;
+		}
+	}
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-scale.h"
+
+#define SCALE_SWEEP_MAX		(32)	/* max instance counts to sweep */
+#define SCALE_SWEEP_KNEE_GAIN	(0.5)	/* knee when marginal gain < 50% of first */
+
+/* throughput of a stressor at each of the swept instance counts */
+typedef struct stress_scale_record {
+	struct stress_scale_record *next; /* next record in list */
+	const stress_stressor_t *ss;	/* stressor */
+	uint64_t counter[SCALE_SWEEP_MAX]; /* bogo-ops */
+	double run_time[SCALE_SWEEP_MAX]; /* mean instance run time */
+	bool recorded[SCALE_SWEEP_MAX];	/* true if count has been run */
+} stress_scale_record_t;
+
+static int32_t scale_counts[SCALE_SWEEP_MAX];
+static size_t scale_counts_n;
+static stress_scale_record_t *scale_records;
+
+/*
+ *  stress_scale_cmp()
+ *	sort instance counts into ascending order
+ */
+static int stress_scale_cmp(const void *p1, const void *p2)
+{
+	const int32_t c1 = *(const int32_t *)p1;
+	const int32_t c2 = *(const int32_t *)p2;
+
+	return (c1 > c2) - (c1 < c2);
+}
+
+/*
+ *  stress_set_scale_sweep()
+ *	parse --scale-sweep, a comma separated list of instance counts,
+ *	the counts are sorted into ascending order and duplicates dropped
+ */
+int stress_set_scale_sweep(const char *opt)
+{
+	char *str, *ptr, *token;
+	size_t i, n = 0;
+
+	str = stress_const_optdup(opt);
+	if (!str) {
+		(void)fprintf(stderr, "out of memory duplicating argument '%s'\n", opt);
+		_exit(EXIT_FAILURE);
+	}
+	for (ptr = str; (token = strtok(ptr, ",")) != NULL; ptr = NULL) {
+		int32_t count;
+
+		if (n >= SCALE_SWEEP_MAX) {
+			(void)fprintf(stderr, "scale-sweep: no more than %d instance counts allowed\n",
+				SCALE_SWEEP_MAX);
+			free(str);
+			_exit(EXIT_FAILURE);
+		}
+		count = stress_get_int32(token);
+		stress_check_range("scale-sweep", (uint64_t)count, 1, STRESS_PROCS_MAX);
+		scale_counts[n++] = count;
+	}
+	free(str);
+	if (n == 0) {
+		(void)fprintf(stderr, "scale-sweep: no instance counts specified\n");
+		_exit(EXIT_FAILURE);
+	}
+
+	qsort(scale_counts, n, sizeof(*scale_counts), stress_scale_cmp);
+	for (scale_counts_n = 0, i = 0; i < n; i++) {
+		if ((scale_counts_n == 0) || (scale_counts[scale_counts_n - 1] != scale_counts[i]))
+			scale_counts[scale_counts_n++] = scale_counts[i];
+	}
+	return 0;
+}
+
+/*
+ *  stress_scale_sweep_counts()
+ *	number of instance counts to sweep, 0 = --scale-sweep not used
+ */
+size_t stress_scale_sweep_counts(void)
+{
+	return scale_counts_n;
+}
+
+/*
+ *  stress_scale_sweep_count()
+ *	the i'th instance count to sweep
+ */
+int32_t stress_scale_sweep_count(const size_t i)
+{
+	return (i < scale_counts_n) ? scale_counts[i] : 0;
+}
+
+/*
+ *  stress_scale_sweep_max()
+ *	the largest instance count to sweep
+ */
+int32_t stress_scale_sweep_max(void)
+{
+	return scale_counts_n ? scale_counts[scale_counts_n - 1] : 0;
+}
+
+/*
+ *  stress_scale_sweep_record()
+ *	record the bogo-ops and run time of a stressor
+ *	that was run with the i'th instance count
+ */
+void stress_scale_sweep_record(const size_t i, const stress_stressor_t *ss)
+{
+	stress_scale_record_t *record;
+	const int32_t instances = stress_scale_sweep_count(i);
+	int32_t j, n = 0;
+	double run_time = 0.0;
+
+	if (i >= scale_counts_n)
+		return;
+
+	for (record = scale_records; record; record = record->next) {
+		if (record->ss == ss)
+			break;
+	}
+	if (!record) {
+		record = (stress_scale_record_t *)calloc(1, sizeof(*record));
+		if (!record)
+			return;
+		record->ss = ss;
+		record->next = scale_records;
+		scale_records = record;
+	}
+
+	record->counter[i] = 0;
+	for (j = 0; j < instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		record->counter[i] += stats->args.ci.counter;
+		if (stats->completed) {
+			run_time += stats->duration;
+			n++;
+		}
+	}
+	record->run_time[i] = n ? run_time / (double)n : 0.0;
+	record->recorded[i] = true;
+}
+
+/*
+ *  stress_scale_sweep_dump()
+ *	report the aggregate and per instance throughput and
+ *	the parallel efficiency, the per instance throughput
+ *	relative to that of the smallest instance count, of each
+ *	stressor at each instance count. The peak is the count with
+ *	the highest aggregate throughput and the knee is the first
+ *	count where adding instances gains less than half the per
+ *	instance throughput of the smallest count
+ */
+void stress_scale_sweep_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	const stress_stressor_t *ss;
+	bool dumped_heading = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_scale_record_t *record;
+		double base = 0.0, prev_rate = 0.0, peak_rate = 0.0;
+		int32_t prev_instances = 0;
+		size_t i, knee = 0, peak = 0;
+		bool found = false;
+		char munged[64];
+
+		for (record = scale_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record)
+			continue;
+
+		if (!dumped_heading) {
+			dumped_heading = true;
+			pr_block_begin();
+			pr_inf("scale-sweep:\n");
+			pr_inf("%-13s %9s %12s %14s %10s\n", "stressor", "instances",
+				"bogo ops/s", "ops/s/instance", "efficiency");
+			pr_yaml(yaml, "scale-sweep:\n");
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+
+		/* find the peak and knee first so they can be marked in the table */
+		for (i = 0; i < scale_counts_n; i++) {
+			double rate;
+
+			if (!record->recorded[i])
+				continue;
+			rate = (record->run_time[i] > 0.0) ?
+				(double)record->counter[i] / record->run_time[i] : 0.0;
+			if (rate > peak_rate) {
+				peak_rate = rate;
+				peak = i;
+			}
+			if (base <= 0.0) {
+				base = rate / (double)scale_counts[i];
+			} else if (!found &&
+				   ((rate - prev_rate) / (double)(scale_counts[i] - prev_instances) <
+				    SCALE_SWEEP_KNEE_GAIN * base)) {
+				knee = i;
+				found = true;
+			}
+			prev_rate = rate;
+			prev_instances = scale_counts[i];
+		}
+
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      results:\n");
+		for (i = 0; i < scale_counts_n; i++) {
+			double rate, rate_per_instance, efficiency;
+			const char *mark;
+
+			if (!record->recorded[i])
+				continue;
+			rate = (record->run_time[i] > 0.0) ?
+				(double)record->counter[i] / record->run_time[i] : 0.0;
+			rate_per_instance = rate / (double)scale_counts[i];
+			efficiency = (base > 0.0) ? 100.0 * rate_per_instance / base : 0.0;
+			if (found && (i == knee) && (peak_rate > 0.0) && (i == peak))
+				mark = " knee, peak";
+			else if (found && (i == knee))
+				mark = " knee";
+			else if ((peak_rate > 0.0) && (i == peak))
+				mark = " peak";
+			else
+				mark = "";
+
+			pr_inf("%-13s %9" PRId32 " %12.2f %14.2f %9.2f%%%s\n",
+				munged, scale_counts[i], rate, rate_per_instance,
+				efficiency, mark);
+			pr_yaml(yaml, "        - instances: %" PRId32 "\n", scale_counts[i]);
+			pr_yaml(yaml, "          bogo-ops: %" PRIu64 "\n", record->counter[i]);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", rate);
+			pr_yaml(yaml, "          bogo-ops-per-second-per-instance: %f\n", rate_per_instance);
+			pr_yaml(yaml, "          parallel-efficiency-percent: %f\n", efficiency);
+		}
+		if (peak_rate > 0.0)
+			pr_yaml(yaml, "      peak-instances: %" PRId32 "\n", scale_counts[peak]);
+		if (found)
+			pr_yaml(yaml, "      knee-instances: %" PRId32 "\n", scale_counts[knee]);
+		pr_yaml(yaml, "\n");
+	}
+	if (dumped_heading)
+		pr_block_end();
+}
+
+/*
+ *  stress_scale_sweep_free()
+ *	free the per stressor scale sweep records
+ */
+void stress_scale_sweep_free(void)
+{
+	stress_scale_record_t *record = scale_records;
+
+	while (record) {
+		stress_scale_record_t *next = record->next;
+
+		free(record);
+		record = next;
+	}
+	scale_records = NULL;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_SCALE_H
+#define CORE_SCALE_H
+
+#include "stress-ng.h"
+
+extern int stress_set_scale_sweep(const char *opt);
+extern size_t stress_scale_sweep_counts(void);
+extern int32_t stress_scale_sweep_count(const size_t i);
+extern int32_t stress_scale_sweep_max(void);
+extern void stress_scale_sweep_record(const size_t i, const stress_stressor_t *ss);
+extern void stress_scale_sweep_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_scale_sweep_free(void);
+
+#endif
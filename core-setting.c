@@ -51,6 +51,10 @@ typedef struct stress_setting {
 static stress_setting_t *setting_head;	/* setting list head */
 static stress_setting_t *setting_tail;	/* setting list tail */
 
+static bool setting_profile;		/* true = time setting lookups */
+static uint64_t setting_lookups;	/* setting lookups while profiling */
+static double setting_lookup_time;	/* lookup time while profiling */
+
 /*
  *  stress_settings_free()
  *	free the saved settings
@@ -299,10 +303,10 @@ int stress_set_setting_global(
 
 
 /*
- *  stress_get_setting()
- *	get an existing setting
+ *  stress_get_setting_lookup()
+ *	find an existing setting and fetch its value
  */
-bool stress_get_setting(const char *name, void *value)
+static bool stress_get_setting_lookup(const char *name, void *value)
 {
 	stress_setting_t *setting;
 	bool set = false;
@@ -397,6 +401,50 @@ bool stress_get_setting(const char *name, void *value)
 	return set;
 }
 
+/*
+ *  stress_get_setting()
+ *	get an existing setting, timing the lookup if
+ *	setting profiling is enabled
+ */
+bool stress_get_setting(const char *name, void *value)
+{
+	double t;
+	bool set;
+
+	if (LIKELY(!setting_profile))
+		return stress_get_setting_lookup(name, value);
+
+	t = stress_time_now();
+	set = stress_get_setting_lookup(name, value);
+	setting_lookup_time += stress_time_now() - t;
+	setting_lookups++;
+
+	return set;
+}
+
+/*
+ *  stress_settings_profile_start()
+ *	start counting and timing setting lookups
+ *	made by this process
+ */
+void stress_settings_profile_start(void)
+{
+	setting_lookups = 0;
+	setting_lookup_time = 0.0;
+	setting_profile = true;
+}
+
+/*
+ *  stress_settings_profile_get()
+ *	get the number of setting lookups and the
+ *	time spent in them since profiling started
+ */
+void stress_settings_profile_get(uint64_t *lookups, double *lookup_time)
+{
+	*lookups = setting_lookups;
+	*lookup_time = setting_lookup_time;
+}
+
 /*
  *  stress_set_setting_true()
  *	create a setting of name name to true, ignore opt
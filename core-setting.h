@@ -49,5 +49,7 @@ extern int stress_set_setting_global(const char *name,
 	const stress_type_id_t type_id, const void *value);
 extern bool stress_get_setting(const char *name, void *value);
 extern int stress_set_setting_true(const char *name, const char *opt);
+extern void stress_settings_profile_start(void);
+extern void stress_settings_profile_get(uint64_t *lookups, double *lookup_time);
 
 #endif
@@ -17,22 +17,27 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-hash.h"
 #include "core-lock.h"
 #include "core-madvise.h"
 #include "core-stressors.h"
 #include "core-shared-heap.h"
 
 /*
- *   The max heap size needs to be larger if we can't determine if strings
- *   being dup'd are literal strings. Literal string dups just use the
- *   literal string, non-literals (e.g. stack based) need to be dup'd from
- *   a shared memory heap.
+ *   The heap is reserved up front as shared anonymous memory so it is
+ *   mapped at the same address in all processes, pages are only backed
+ *   by memory once they get used. It is carved into slabs, each slab
+ *   holds blocks of one size class or is the start of a multi-slab span
+ *   for allocations larger than the largest size class.
  */
-#if defined(HAVE_BUILTIN_CONSTANT_P)
-#define STRESS_MAX_SHARED_HEAP_SIZE		(16 * KB)
-#else
-#define STRESS_MAX_SHARED_HEAP_SIZE		(64 * KB)
-#endif
+#define STRESS_SHARED_HEAP_SIZE		(4 * MB)
+#define STRESS_SHARED_HEAP_SLAB		(16 * KB)
+#define STRESS_SHARED_HEAP_MIN_SHIFT	(4)	/* smallest class, 16 bytes */
+#define STRESS_SHARED_HEAP_CLASS_MAX	(1U << (STRESS_SHARED_HEAP_MIN_SHIFT + STRESS_SHARED_HEAP_CLASSES - 1))
+#define STRESS_SHARED_HEAP_BATCH	(16)	/* blocks moved to/from a cache at a time */
+#define STRESS_SHARED_HEAP_MAGIC	(0x5ea9ea90)
+#define STRESS_SHARED_HEAP_LARGE	(~0U)
 
 /* Used just to determine number of stressors via STRESS_MAX */
 enum {
@@ -45,6 +50,51 @@ typedef struct stress_shared_heap_str {
 	char str[];
 } stress_shared_heap_str_t;
 
+/* start of each slab, padded to keep blocks 16 byte aligned */
+typedef struct {
+	uint32_t magic;			/* STRESS_SHARED_HEAP_MAGIC */
+	uint32_t size_class;		/* size class or STRESS_SHARED_HEAP_LARGE */
+	size_t slabs;			/* number of slabs of a large span */
+	void *next;			/* next free large span */
+	uint8_t padding[8];
+} stress_shared_heap_slab_t;
+
+/* free block, linked through its first word */
+typedef struct stress_shared_heap_block {
+	struct stress_shared_heap_block *next;
+} stress_shared_heap_block_t;
+
+/*
+ *  Per process cache of free blocks, this is private memory so forked
+ *  children inherit a stale copy that they must discard; only the
+ *  thread that owns the cache uses it, other threads of a threaded
+ *  instance use the locked global free lists
+ */
+typedef struct {
+	stress_shared_heap_block_t *head;
+	uint32_t count;
+} stress_shared_heap_cache_t;
+
+static stress_shared_heap_cache_t heap_cache[STRESS_SHARED_HEAP_CLASSES];
+static pid_t heap_cache_pid = -1;
+static pid_t heap_cache_tid = -1;
+
+/*
+ *  stress_shared_heap_str_lock_destroy()
+ *	destroy the string hash table bucket locks
+ */
+static void stress_shared_heap_str_lock_destroy(void)
+{
+	size_t i;
+
+	for (i = 0; i < STRESS_SHARED_HEAP_STR_HASH; i++) {
+		if (g_shared->shared_heap.str_lock[i]) {
+			(void)stress_lock_destroy(g_shared->shared_heap.str_lock[i]);
+			g_shared->shared_heap.str_lock[i] = NULL;
+		}
+	}
+}
+
 /*
  *  stress_shared_heap_init()
  *	initialized shared heap
@@ -52,28 +102,41 @@ typedef struct stress_shared_heap_str {
 void *stress_shared_heap_init(void)
 {
 	const size_t page_size = stress_get_page_size();
+	const size_t size = (STRESS_SHARED_HEAP_SIZE + page_size - 1) & ~(page_size - 1);
+	size_t i;
 
-	/* Allocate enough heap for all stressor descriptions with 50% metrics allocated */
-	size_t size = (STRESS_MISC_METRICS_MAX * (32 + sizeof(void *)) * STRESS_MAX) / 2;
-
-	size = STRESS_MINIMUM(size, STRESS_MAX_SHARED_HEAP_SIZE);
 	g_shared->shared_heap.out_of_memory = false;
-	g_shared->shared_heap.heap_size = (size + page_size - 1) & ~(page_size - 1);
-	g_shared->shared_heap.str_list_head = NULL;
-	g_shared->shared_heap.heap = stress_mmap_populate(NULL, size,
-					PROT_READ | PROT_WRITE,
+	g_shared->shared_heap.heap_size = size;
+	g_shared->shared_heap.offset = 0;
+	(void)shim_memset(g_shared->shared_heap.str_hash, 0, sizeof(g_shared->shared_heap.str_hash));
+	(void)shim_memset(g_shared->shared_heap.str_lock, 0, sizeof(g_shared->shared_heap.str_lock));
+	g_shared->shared_heap.large_list = NULL;
+	(void)shim_memset(g_shared->shared_heap.free_list, 0, sizeof(g_shared->shared_heap.free_list));
+	g_shared->shared_heap.heap = mmap(NULL, size, PROT_READ | PROT_WRITE,
 					MAP_ANONYMOUS | MAP_SHARED, -1, 0);
 	if (g_shared->shared_heap.heap == MAP_FAILED) {
+		g_shared->shared_heap.heap = NULL;
 		g_shared->shared_heap.lock = NULL;
 		return NULL;
 	}
 	(void)stress_madvise_mergeable(g_shared->shared_heap.heap, size);
-	g_shared->shared_heap.lock = stress_lock_create();
+	g_shared->shared_heap.lock = stress_lock_create("shared-heap");
 	if (!g_shared->shared_heap.lock) {
 		(void)munmap((void *)g_shared->shared_heap.heap, g_shared->shared_heap.heap_size);
 		g_shared->shared_heap.heap = NULL;
 		return NULL;
 	}
+	for (i = 0; i < STRESS_SHARED_HEAP_STR_HASH; i++) {
+		g_shared->shared_heap.str_lock[i] = stress_lock_create("shared-heap-str");
+		if (!g_shared->shared_heap.str_lock[i]) {
+			stress_shared_heap_str_lock_destroy();
+			(void)stress_lock_destroy(g_shared->shared_heap.lock);
+			g_shared->shared_heap.lock = NULL;
+			(void)munmap((void *)g_shared->shared_heap.heap, g_shared->shared_heap.heap_size);
+			g_shared->shared_heap.heap = NULL;
+			return NULL;
+		}
+	}
 	return g_shared->shared_heap.lock;
 }
 
@@ -84,7 +147,7 @@ void *stress_shared_heap_init(void)
 void stress_shared_heap_deinit(void)
 {
 	if (g_shared->shared_heap.out_of_memory) {
-		pr_inf("shared heap: out of memory duplicating some strings, increase STRESS_MAX_SHARED_HEAP_SIZE to fix this\n");
+		pr_inf("shared heap: out of memory, increase STRESS_SHARED_HEAP_SIZE to fix this\n");
 	}
 #if defined(STRESS_SHARED_HEAD_DEBUG)
 	if (g_shared->shared_heap.offset > 0) {
@@ -99,34 +162,338 @@ void stress_shared_heap_deinit(void)
 		(void)stress_lock_destroy(g_shared->shared_heap.lock);
 		g_shared->shared_heap.lock = NULL;
 	}
+	stress_shared_heap_str_lock_destroy();
 	g_shared->shared_heap.out_of_memory = false;
 }
 
+/*
+ *  stress_shared_heap_slab_alloc()
+ *	allocate n contiguous unused slabs, must be called with the lock held
+ */
+static stress_shared_heap_slab_t *stress_shared_heap_slab_alloc(const size_t n)
+{
+	stress_shared_heap_slab_t *slab;
+	const size_t size = n * STRESS_SHARED_HEAP_SLAB;
+
+	if (g_shared->shared_heap.heap_size - g_shared->shared_heap.offset < size) {
+		g_shared->shared_heap.out_of_memory = true;
+		return NULL;
+	}
+	slab = (stress_shared_heap_slab_t *)((uintptr_t)g_shared->shared_heap.heap + g_shared->shared_heap.offset);
+	g_shared->shared_heap.offset += size;
+	slab->magic = STRESS_SHARED_HEAP_MAGIC;
+	slab->slabs = n;
+	slab->next = NULL;
+
+	return slab;
+}
+
+/*
+ *  stress_shared_heap_slab()
+ *	find the slab a heap allocation belongs to, NULL if not a heap pointer
+ */
+static stress_shared_heap_slab_t *stress_shared_heap_slab(const void *ptr)
+{
+	const uintptr_t heap = (uintptr_t)g_shared->shared_heap.heap;
+	uintptr_t offset;
+	stress_shared_heap_slab_t *slab;
+
+	if (!heap || ((uintptr_t)ptr < heap) || ((uintptr_t)ptr >= heap + g_shared->shared_heap.offset))
+		return NULL;
+	offset = ((uintptr_t)ptr - heap) & ~(uintptr_t)(STRESS_SHARED_HEAP_SLAB - 1);
+	slab = (stress_shared_heap_slab_t *)(heap + offset);
+
+	return (slab->magic == STRESS_SHARED_HEAP_MAGIC) ? slab : NULL;
+}
+
+/*
+ *  stress_shared_heap_refill()
+ *	move up to STRESS_SHARED_HEAP_BATCH free blocks of a size class from
+ *	the global free list onto list, carving a new slab if the free list
+ *	is empty, must be called with the lock held. Returns blocks moved.
+ */
+static uint32_t stress_shared_heap_refill(const uint32_t size_class, stress_shared_heap_block_t **list)
+{
+	stress_shared_heap_block_t **free_list =
+		(stress_shared_heap_block_t **)&g_shared->shared_heap.free_list[size_class];
+	uint32_t n;
+
+	if (!*free_list) {
+		const size_t block_size = (size_t)1 << (size_class + STRESS_SHARED_HEAP_MIN_SHIFT);
+		stress_shared_heap_slab_t *slab = stress_shared_heap_slab_alloc(1);
+		uintptr_t addr, end;
+
+		if (!slab)
+			return 0;
+		slab->size_class = size_class;
+		/* blocks start after the slab header, naturally aligned up to 64 bytes */
+		addr = (uintptr_t)slab + STRESS_MAXIMUM(sizeof(*slab), STRESS_MINIMUM(block_size, 64));
+		end = (uintptr_t)slab + STRESS_SHARED_HEAP_SLAB;
+		for (; addr + block_size <= end; addr += block_size) {
+			stress_shared_heap_block_t *block = (stress_shared_heap_block_t *)addr;
+
+			block->next = *free_list;
+			*free_list = block;
+		}
+	}
+	for (n = 0; (n < STRESS_SHARED_HEAP_BATCH) && *free_list; n++) {
+		stress_shared_heap_block_t *block = *free_list;
+
+		*free_list = block->next;
+		block->next = *list;
+		*list = block;
+	}
+	return n;
+}
+
+/*
+ *  stress_shared_heap_cache()
+ *	get the calling process's cache of a size class, NULL if the
+ *	caller is not the thread that owns the per process caches
+ */
+static stress_shared_heap_cache_t *stress_shared_heap_cache(const uint32_t size_class)
+{
+	const pid_t pid = getpid();
+	int tid = shim_gettid();
+
+	if (tid < 0)
+		tid = (int)pid;
+	if (heap_cache_pid != pid) {
+		/* new process, the inherited cache belongs to the parent */
+		(void)shim_memset(heap_cache, 0, sizeof(heap_cache));
+		heap_cache_pid = pid;
+		heap_cache_tid = (pid_t)tid;
+	}
+	return (heap_cache_tid == (pid_t)tid) ? &heap_cache[size_class] : NULL;
+}
+
+/*
+ *  stress_shared_heap_flush()
+ *	return all the blocks in the calling process's cache to the
+ *	global free lists, stressor instances call this before they
+ *	exit so their cached blocks are not lost with the process
+ */
+void stress_shared_heap_flush(void)
+{
+	uint32_t size_class;
+
+	if (!g_shared->shared_heap.heap ||
+	    (heap_cache_pid != getpid()) ||
+	    !stress_shared_heap_cache(0))
+		return;
+	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
+		return;
+	for (size_class = 0; size_class < STRESS_SHARED_HEAP_CLASSES; size_class++) {
+		stress_shared_heap_cache_t *cache = &heap_cache[size_class];
+		stress_shared_heap_block_t **free_list =
+			(stress_shared_heap_block_t **)&g_shared->shared_heap.free_list[size_class];
+
+		while (cache->head) {
+			stress_shared_heap_block_t *block = cache->head;
+
+			cache->head = block->next;
+			block->next = *free_list;
+			*free_list = block;
+		}
+		cache->count = 0;
+	}
+	(void)stress_lock_release(g_shared->shared_heap.lock);
+}
+
+/*
+ *  stress_shared_heap_free_large()
+ *	put a span of slabs back on the free span list, merging it with
+ *	adjacent free spans and handing it back to the unused end of the
+ *	heap if it is the last span, must be called with the lock held
+ */
+static void stress_shared_heap_free_large(stress_shared_heap_slab_t *slab)
+{
+	stress_shared_heap_slab_t **prev;
+	uintptr_t end;
+
+redo:
+	end = (uintptr_t)slab + (slab->slabs * STRESS_SHARED_HEAP_SLAB);
+	for (prev = (stress_shared_heap_slab_t **)&g_shared->shared_heap.large_list; *prev; prev = (stress_shared_heap_slab_t **)&(*prev)->next) {
+		stress_shared_heap_slab_t *span = *prev;
+		const uintptr_t span_end = (uintptr_t)span + (span->slabs * STRESS_SHARED_HEAP_SLAB);
+
+		if ((span_end == (uintptr_t)slab) || (end == (uintptr_t)span)) {
+			/* unlink the neighbour and retry with the merged span */
+			*prev = (stress_shared_heap_slab_t *)span->next;
+			if (span_end == (uintptr_t)slab) {
+				span->slabs += slab->slabs;
+				slab = span;
+			} else {
+				slab->slabs += span->slabs;
+			}
+			goto redo;
+		}
+	}
+	if (end == (uintptr_t)g_shared->shared_heap.heap + g_shared->shared_heap.offset) {
+		g_shared->shared_heap.offset -= slab->slabs * STRESS_SHARED_HEAP_SLAB;
+		return;
+	}
+	slab->next = g_shared->shared_heap.large_list;
+	g_shared->shared_heap.large_list = (void *)slab;
+}
+
+/*
+ *  stress_shared_heap_malloc_large()
+ *	allocate a span of slabs for an allocation larger than the
+ *	largest size class, free spans are reused first fit and any
+ *	unused slabs of a reused span are split off as a new free span
+ */
+static void *stress_shared_heap_malloc_large(const size_t size)
+{
+	const size_t n = (size + sizeof(stress_shared_heap_slab_t) + STRESS_SHARED_HEAP_SLAB - 1) / STRESS_SHARED_HEAP_SLAB;
+	stress_shared_heap_slab_t *slab, **prev;
+
+	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
+		return NULL;
+	for (prev = (stress_shared_heap_slab_t **)&g_shared->shared_heap.large_list; *prev; prev = (stress_shared_heap_slab_t **)&(*prev)->next) {
+		if ((*prev)->slabs >= n) {
+			slab = *prev;
+			*prev = (stress_shared_heap_slab_t *)slab->next;
+			slab->next = NULL;
+			if (slab->slabs > n) {
+				stress_shared_heap_slab_t *split =
+					(stress_shared_heap_slab_t *)((uintptr_t)slab + (n * STRESS_SHARED_HEAP_SLAB));
+
+				split->magic = STRESS_SHARED_HEAP_MAGIC;
+				split->size_class = STRESS_SHARED_HEAP_LARGE;
+				split->slabs = slab->slabs - n;
+				split->next = *prev;
+				*prev = split;
+				slab->slabs = n;
+			}
+			(void)stress_lock_release(g_shared->shared_heap.lock);
+			return (void *)(slab + 1);
+		}
+	}
+	slab = stress_shared_heap_slab_alloc(n);
+	if (slab)
+		slab->size_class = STRESS_SHARED_HEAP_LARGE;
+	(void)stress_lock_release(g_shared->shared_heap.lock);
+
+	return slab ? (void *)(slab + 1) : NULL;
+}
+
 /*
  *  stress_shared_heap_malloc()
- *	Primitive non-free'ing heap allocator. Just return next allocated chunk from
- *	the shared memory heap. We don't use need a per-object free'ing, so no need
- *	to keep track of holes or do hole coalescing. Keep it simple for now.
+ *	allocate memory from the shared memory heap that is visible to all
+ *	the stressor processes. Allocations up to 4K come from power of 2
+ *	size classes and are taken from a per process cache that is only
+ *	refilled from the global free lists in batches, so the heap lock
+ *	is rarely contended. Memory can be returned with stress_shared_heap_free.
  */
 void *stress_shared_heap_malloc(const size_t size)
 {
-	ssize_t heap_free;
-	void *ptr;
+	stress_shared_heap_cache_t *cache;
+	stress_shared_heap_block_t *block = NULL;
+	uint32_t size_class = 0;
 
-	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
+	if (!g_shared->shared_heap.heap)
 		return NULL;
+	if (size > STRESS_SHARED_HEAP_CLASS_MAX)
+		return stress_shared_heap_malloc_large(size);
 
-	heap_free = g_shared->shared_heap.heap_size - g_shared->shared_heap.offset;
-	if (heap_free < (ssize_t)size) {
-		g_shared->shared_heap.out_of_memory = true;
-		(void)stress_lock_release(g_shared->shared_heap.lock);
+	while (((size_t)1 << (size_class + STRESS_SHARED_HEAP_MIN_SHIFT)) < size)
+		size_class++;
+
+	cache = stress_shared_heap_cache(size_class);
+	if (cache && cache->head) {
+		block = cache->head;
+		cache->head = block->next;
+		cache->count--;
+		return (void *)block;
+	}
+
+	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
 		return NULL;
+	if (cache) {
+		cache->count = stress_shared_heap_refill(size_class, &cache->head);
+		block = cache->head;
+		if (block) {
+			cache->head = block->next;
+			cache->count--;
+		}
+	} else {
+		stress_shared_heap_block_t **free_list =
+			(stress_shared_heap_block_t **)&g_shared->shared_heap.free_list[size_class];
+		stress_shared_heap_block_t *list = NULL;
+
+		/* keep one block, the others go back on the free list */
+		if (stress_shared_heap_refill(size_class, &list)) {
+			block = list;
+			for (list = list->next; list; ) {
+				stress_shared_heap_block_t *next = list->next;
+
+				list->next = *free_list;
+				*free_list = list;
+				list = next;
+			}
+		}
 	}
-	ptr = (void *)((uintptr_t)g_shared->shared_heap.heap + g_shared->shared_heap.offset);
-	g_shared->shared_heap.offset += (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
 	(void)stress_lock_release(g_shared->shared_heap.lock);
 
-	return ptr;
+	return (void *)block;
+}
+
+/*
+ *  stress_shared_heap_free()
+ *	return memory allocated by stress_shared_heap_malloc to the heap,
+ *	blocks go to the per process cache and only go back to the global
+ *	free list once the cache holds more than two batches of blocks
+ */
+void stress_shared_heap_free(void *ptr)
+{
+	stress_shared_heap_slab_t *slab;
+	stress_shared_heap_cache_t *cache;
+	stress_shared_heap_block_t *block = (stress_shared_heap_block_t *)ptr;
+	stress_shared_heap_block_t **free_list;
+
+	if (!ptr)
+		return;
+	slab = stress_shared_heap_slab(ptr);
+	if (!slab) {
+		pr_dbg("shared heap: free of non-heap address %p ignored\n", ptr);
+		return;
+	}
+
+	if (slab->size_class == STRESS_SHARED_HEAP_LARGE) {
+		if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
+			return;
+		stress_shared_heap_free_large(slab);
+		(void)stress_lock_release(g_shared->shared_heap.lock);
+		return;
+	}
+
+	free_list = (stress_shared_heap_block_t **)&g_shared->shared_heap.free_list[slab->size_class];
+	cache = stress_shared_heap_cache(slab->size_class);
+	if (cache) {
+		block->next = cache->head;
+		cache->head = block;
+		cache->count++;
+		if (cache->count <= 2 * STRESS_SHARED_HEAP_BATCH)
+			return;
+	}
+
+	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
+		return;
+	if (cache) {
+		/* hand a batch of cached blocks back to the global free list */
+		while (cache->count > STRESS_SHARED_HEAP_BATCH) {
+			block = cache->head;
+			cache->head = block->next;
+			cache->count--;
+			block->next = *free_list;
+			*free_list = block;
+		}
+	} else {
+		block->next = *free_list;
+		*free_list = block;
+	}
+	(void)stress_lock_release(g_shared->shared_heap.lock);
 }
 
 /*
@@ -135,46 +502,43 @@ void *stress_shared_heap_malloc(const size_t size)
  *	modified as this dup operation re-used existing identical strings
  *	allocated on the shared heap. This is designed for storing metric
  *	descriptions that get allocated per stressor and we want to reduce
- *	duplicated allocations where possible.
+ *	duplicated allocations where possible. Strings are kept in a hash
+ *	table with a lock per bucket so lookups of different strings do
+ *	not contend with each other or with the heap lock.
  */
 char *stress_shared_heap_dup_const(const char *str)
 {
-	size_t len, str_len;
+	size_t str_len;
+	const uint32_t bucket = stress_hash_djb2a(str) % STRESS_SHARED_HEAP_STR_HASH;
+	void *lock = g_shared->shared_heap.str_lock[bucket];
+	stress_shared_heap_str_t **head =
+		(stress_shared_heap_str_t **)&g_shared->shared_heap.str_hash[bucket];
 	stress_shared_heap_str_t *heap_str;
 
-	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
+	if (!lock)
+		return NULL;
+	if (stress_lock_acquire(lock) < 0)
 		return NULL;
 
-	for (heap_str = (stress_shared_heap_str_t *)g_shared->shared_heap.str_list_head; heap_str; heap_str = heap_str->next) {
+	for (heap_str = *head; heap_str; heap_str = heap_str->next) {
 		if (strcmp(str, heap_str->str) == 0) {
-			(void)stress_lock_release(g_shared->shared_heap.lock);
+			(void)stress_lock_release(lock);
 			return heap_str->str;
 		}
 	}
-	(void)stress_lock_release(g_shared->shared_heap.lock);
-	str_len = strlen(str) + 1;
-	len = str_len + sizeof(void *);
-	heap_str = (stress_shared_heap_str_t *)stress_shared_heap_malloc(len);
-	if (!heap_str)
-		return NULL;
-
-	(void)shim_strscpy(heap_str->str, str, str_len);
-	heap_str->next = NULL;
 
 	/*
-	 *  We failed to acquire so we can't add to list, return dup'd string
-	 *  and skip adding it to the list, at least the dup worked!
+	 *  Not found, dup it and save it so it can be re-used, the
+	 *  bucket lock is held so no other process can add it too
 	 */
-	if (stress_lock_acquire(g_shared->shared_heap.lock) < 0)
-		return heap_str->str;
-
-	/*
-	 *  Save a copy so it can be re-used
-	 */
-	heap_str->next = (stress_shared_heap_str_t *)g_shared->shared_heap.str_list_head;
-	g_shared->shared_heap.str_list_head = (void *)heap_str;
+	str_len = strlen(str) + 1;
+	heap_str = (stress_shared_heap_str_t *)stress_shared_heap_malloc(sizeof(*heap_str) + str_len);
+	if (heap_str) {
+		(void)shim_strscpy(heap_str->str, str, str_len);
+		heap_str->next = *head;
+		*head = heap_str;
+	}
+	(void)stress_lock_release(lock);
 
-	(void)stress_lock_release(g_shared->shared_heap.lock);
-	return heap_str->str;
+	return heap_str ? heap_str->str : NULL;
 }
-
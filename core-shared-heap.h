@@ -24,6 +24,8 @@
 extern WARN_UNUSED void *stress_shared_heap_init(void);
 extern void stress_shared_heap_deinit(void);
 extern WARN_UNUSED void *stress_shared_heap_malloc(const size_t size);
+extern void stress_shared_heap_free(void *ptr);
+extern void stress_shared_heap_flush(void);
 extern WARN_UNUSED char *stress_shared_heap_dup_const(const char *str);
 
 #endif
@@ -19,6 +19,51 @@
 #include "stress-ng.h"
 #include "core-sort.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
+#include "core-vecmath.h"
+
+#define STRESS_SORT_MIN_CHUNK	(1024)	/* smallest chunk sorted by a thread */
+#define STRESS_SORT_RUN		(8)	/* elements per sorting network run */
+
+typedef struct {
+	const uint8_t *src;		/* chunk to sort or runs to merge */
+	uint8_t *dst;			/* merged runs */
+	size_t lo;			/* start of first run */
+	size_t mid;			/* start of second run */
+	size_t hi;			/* end of second run */
+	size_t size;			/* element size */
+	stress_sort_cmp_func_t cmp;	/* element comparator */
+	stress_sort_func_t sort_func;	/* chunk sort, NULL for a merge */
+} stress_sort_task_t;
+
+typedef enum {
+	STRESS_SORT_DIST_SORTED = STRESS_SORT_DIST_RANDOM + 1,
+	STRESS_SORT_DIST_REVERSE,
+	STRESS_SORT_DIST_NEARLY,
+	STRESS_SORT_DIST_FEW_UNIQUE,
+	STRESS_SORT_DIST_ZIPF,
+	STRESS_SORT_DIST_ORGAN_PIPE,
+	STRESS_SORT_DIST_EQUAL,
+	STRESS_SORT_DIST_ALL,		/* cycle through all distributions */
+} stress_sort_dist_t;
+
+#define STRESS_SORT_FEW_UNIQUE	(16)	/* distinct values in few-unique data */
+
+static const char * const stress_sort_dist_names[] = {
+	"random",
+	"sorted",
+	"reverse",
+	"nearly",
+	"few-unique",
+	"zipf",
+	"organ-pipe",
+	"equal",
+	"all",
+};
+
+static size_t sort_dist = STRESS_SORT_DIST_RANDOM;
+static bool sort_dist_set = false;	/* --sort-dist given */
+static uint64_t sort_dist_swaps = 0;	/* swaps in nearly sorted data, 0 = 1% */
 
 uint64_t stress_sort_compares ALIGN64;
 
@@ -116,3 +161,525 @@ PRAGMA_UNROLL_N(8)
 		}
 	}
 }
+
+/*
+ *  stress_sort_threads_default()
+ *	default number of parallel sort threads, one per online CPU
+ */
+uint32_t stress_sort_threads_default(void)
+{
+	const int32_t cpus = stress_get_processors_online();
+
+	if (cpus < 1)
+		return 1;
+	return (cpus > STRESS_SORT_THREADS_MAX) ? STRESS_SORT_THREADS_MAX : (uint32_t)cpus;
+}
+
+/*
+ *  stress_sort_merge()
+ *	merge sorted runs src[lo..mid) and src[mid..hi) into dst[lo..hi)
+ */
+static void OPTIMIZE3 stress_sort_merge(const stress_sort_task_t *task)
+{
+	const size_t size = task->size;
+	const stress_sort_cmp_func_t cmp = task->cmp;
+	register const uint8_t *a = task->src + (task->lo * size);
+	register const uint8_t *b = task->src + (task->mid * size);
+	const uint8_t *a_end = b;
+	const uint8_t *b_end = task->src + (task->hi * size);
+	register uint8_t *d = task->dst + (task->lo * size);
+
+	if (size == sizeof(uint32_t)) {
+		while ((a < a_end) && (b < b_end)) {
+			if (cmp(b, a) < 0) {
+				*(uint32_t *)d = *(const uint32_t *)b;
+				b += sizeof(uint32_t);
+			} else {
+				*(uint32_t *)d = *(const uint32_t *)a;
+				a += sizeof(uint32_t);
+			}
+			d += sizeof(uint32_t);
+		}
+	} else {
+		while ((a < a_end) && (b < b_end)) {
+			if (cmp(b, a) < 0) {
+				(void)memcpy(d, b, size);
+				b += size;
+			} else {
+				(void)memcpy(d, a, size);
+				a += size;
+			}
+			d += size;
+		}
+	}
+	(void)memcpy(d, a, (size_t)(a_end - a));
+	d += a_end - a;
+	(void)memcpy(d, b, (size_t)(b_end - b));
+}
+
+static void stress_sort_task(stress_sort_task_t *task)
+{
+	if (task->sort_func)
+		task->sort_func((void *)(task->src + (task->lo * task->size)),
+			task->hi - task->lo, task->size, task->cmp);
+	else
+		stress_sort_merge(task);
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+static void *stress_sort_thread(void *arg)
+{
+	static void *nowt = NULL;
+
+	stress_sort_task((stress_sort_task_t *)arg);
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_sort_run_tasks()
+ *	run tasks concurrently, task 0 is run by the caller and
+ *	tasks that cannot be given a thread are run serially
+ */
+static void stress_sort_run_tasks(stress_sort_task_t *tasks, const size_t n_tasks)
+{
+	size_t i;
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthreads[STRESS_SORT_THREADS_MAX];
+	int rets[STRESS_SORT_THREADS_MAX];
+
+	for (i = 1; i < n_tasks; i++)
+		rets[i] = pthread_create(&pthreads[i], NULL, stress_sort_thread, &tasks[i]);
+	stress_sort_task(&tasks[0]);
+	for (i = 1; i < n_tasks; i++) {
+		if (rets[i] == 0)
+			(void)pthread_join(pthreads[i], NULL);
+		else
+			stress_sort_task(&tasks[i]);
+	}
+#else
+	for (i = 0; i < n_tasks; i++)
+		stress_sort_task(&tasks[i]);
+#endif
+}
+
+/*
+ *  stress_sort_parallel()
+ *	split the data into up to threads chunks, sort each chunk
+ *	with sort_func in its own thread and merge pairs of sorted
+ *	runs in parallel until one run remains. Signals are blocked
+ *	while the threads run so a SIGALRM siglongjmp cannot leave
+ *	threads running on the data. Falls back to a single sort_func
+ *	call if the data is too small or scratch memory is not available.
+ */
+void stress_sort_parallel(
+	void *base,
+	const size_t nmemb,
+	const size_t size,
+	stress_sort_cmp_func_t cmp,
+	stress_sort_func_t sort_func,
+	const uint32_t threads)
+{
+	stress_sort_task_t tasks[STRESS_SORT_THREADS_MAX];
+	size_t bounds[STRESS_SORT_THREADS_MAX + 1];
+	size_t i, chunks, n_runs;
+	uint8_t *src = (uint8_t *)base, *dst, *tmp;
+	sigset_t set, old_set;
+
+	chunks = nmemb / STRESS_SORT_MIN_CHUNK;
+	chunks = STRESS_MINIMUM(chunks, (size_t)threads);
+	chunks = STRESS_MINIMUM(chunks, STRESS_SORT_THREADS_MAX);
+	if (chunks < 2) {
+		sort_func(base, nmemb, size, cmp);
+		return;
+	}
+	tmp = (uint8_t *)malloc(nmemb * size);
+	if (!tmp) {
+		sort_func(base, nmemb, size, cmp);
+		return;
+	}
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, &old_set);
+
+	for (i = 0; i <= chunks; i++)
+		bounds[i] = (nmemb * i) / chunks;
+	for (i = 0; i < chunks; i++) {
+		tasks[i].src = src;
+		tasks[i].dst = NULL;
+		tasks[i].lo = bounds[i];
+		tasks[i].mid = bounds[i];
+		tasks[i].hi = bounds[i + 1];
+		tasks[i].size = size;
+		tasks[i].cmp = cmp;
+		tasks[i].sort_func = sort_func;
+	}
+	stress_sort_run_tasks(tasks, chunks);
+
+	for (n_runs = chunks, dst = tmp; n_runs > 1; ) {
+		size_t n_tasks = 0;
+		uint8_t *swap;
+
+		for (i = 0; i < n_runs; i += 2, n_tasks++) {
+			stress_sort_task_t *task = &tasks[n_tasks];
+
+			task->src = src;
+			task->dst = dst;
+			task->lo = bounds[i];
+			task->mid = bounds[i + 1];
+			/* an odd run out is merged with an empty run, a copy */
+			task->hi = (i + 1 < n_runs) ? bounds[i + 2] : bounds[i + 1];
+			task->sort_func = NULL;
+			/* runs before i have been consumed, reuse their bounds */
+			bounds[n_tasks] = task->lo;
+		}
+		bounds[n_tasks] = nmemb;
+		stress_sort_run_tasks(tasks, n_tasks);
+
+		n_runs = n_tasks;
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != (uint8_t *)base)
+		(void)memcpy(base, src, nmemb * size);
+
+	(void)sigprocmask(SIG_SETMASK, &old_set, NULL);
+	free(tmp);
+}
+
+static void OPTIMIZE3 stress_sort_data_int32_reverse(int32_t *data, const size_t n)
+{
+	register int32_t *p1 = data, *p2 = data + n - 1;
+
+	while (p1 < p2) {
+		register const int32_t v = *p1;
+
+		*(p1++) = *p2;
+		*(p2--) = v;
+	}
+}
+
+/*
+ *  stress_sort_int32_insertion()
+ *	insertion sort of a short run
+ */
+static inline void OPTIMIZE3 stress_sort_int32_insertion(int32_t *data, const size_t n)
+{
+	register size_t i;
+
+	for (i = 1; i < n; i++) {
+		register const int32_t v = data[i];
+		register size_t j = i;
+
+		while ((j > 0) && (data[j - 1] > v)) {
+			data[j] = data[j - 1];
+			j--;
+		}
+		data[j] = v;
+	}
+}
+
+#if defined(HAVE_VECMATH)
+typedef int32_t stress_sort_vint32_t __attribute__ ((vector_size (32)));
+
+/* lane wise compare and exchange, a gets the minima, b the maxima */
+#define STRESS_SORT_VCMPSWAP(a, b)					do {										const stress_sort_vint32_t m = (a < b);					const stress_sort_vint32_t t = (a & m) | (b & ~m);												b = (b & m) | (a & ~m);							a = t;								} while (0)
+
+/*
+ *  stress_sort_int32_network()
+ *	sort 8 runs of 8 elements with the 19 comparator optimal
+ *	sorting network, each comparator operates on 8 lanes at once
+ *	so the network sorts the columns of an 8 x 8 block that is
+ *	then transposed back into rows
+ */
+static inline void OPTIMIZE3 stress_sort_int32_network(int32_t *data)
+{
+	stress_sort_vint32_t v[STRESS_SORT_RUN];
+	int32_t block[STRESS_SORT_RUN][STRESS_SORT_RUN];
+	size_t r, c;
+
+	(void)memcpy(v, data, sizeof(v));
+
+	STRESS_SORT_VCMPSWAP(v[0], v[2]);
+	STRESS_SORT_VCMPSWAP(v[1], v[3]);
+	STRESS_SORT_VCMPSWAP(v[4], v[6]);
+	STRESS_SORT_VCMPSWAP(v[5], v[7]);
+	STRESS_SORT_VCMPSWAP(v[0], v[4]);
+	STRESS_SORT_VCMPSWAP(v[1], v[5]);
+	STRESS_SORT_VCMPSWAP(v[2], v[6]);
+	STRESS_SORT_VCMPSWAP(v[3], v[7]);
+	STRESS_SORT_VCMPSWAP(v[0], v[1]);
+	STRESS_SORT_VCMPSWAP(v[2], v[3]);
+	STRESS_SORT_VCMPSWAP(v[4], v[5]);
+	STRESS_SORT_VCMPSWAP(v[6], v[7]);
+	STRESS_SORT_VCMPSWAP(v[2], v[4]);
+	STRESS_SORT_VCMPSWAP(v[3], v[5]);
+	STRESS_SORT_VCMPSWAP(v[1], v[4]);
+	STRESS_SORT_VCMPSWAP(v[3], v[6]);
+	STRESS_SORT_VCMPSWAP(v[1], v[2]);
+	STRESS_SORT_VCMPSWAP(v[3], v[4]);
+	STRESS_SORT_VCMPSWAP(v[5], v[6]);
+
+	(void)memcpy(block, v, sizeof(block));
+	for (r = 0; r < STRESS_SORT_RUN; r++) {
+		for (c = 0; c < STRESS_SORT_RUN; c++)
+			data[(c * STRESS_SORT_RUN) + r] = block[r][c];
+	}
+}
+
+#undef STRESS_SORT_VCMPSWAP
+#endif
+
+/*
+ *  stress_sort_int32_merge()
+ *	branch free merge of two sorted runs
+ */
+static inline void OPTIMIZE3 stress_sort_int32_merge(
+	register const int32_t *a,
+	const int32_t *a_end,
+	register const int32_t *b,
+	const int32_t *b_end,
+	register int32_t *d)
+{
+	while ((a < a_end) && (b < b_end)) {
+		register const int32_t va = *a;
+		register const int32_t vb = *b;
+		register const bool take_b = (vb < va);
+
+		*(d++) = take_b ? vb : va;
+		b += take_b;
+		a += !take_b;
+	}
+	while (a < a_end)
+		*(d++) = *(a++);
+	while (b < b_end)
+		*(d++) = *(b++);
+}
+
+/*
+ *  stress_sort_int32_simd()
+ *	sort 32 bit integers with a vectorised sorting network into
+ *	runs of 8 followed by branch free merge passes, the sort
+ *	direction is taken from the comparator. Falls back to qsort
+ *	if scratch memory is not available.
+ */
+void OPTIMIZE3 stress_sort_int32_simd(int32_t *data, const size_t n, stress_sort_cmp_func_t cmp)
+{
+	static const int32_t lo = 0, hi = 1;
+	const bool reverse = (cmp(&lo, &hi) > 0);
+	int32_t *tmp, *src, *dst;
+	size_t i = 0, width;
+
+	tmp = (int32_t *)malloc(n * sizeof(*tmp));
+	if (!tmp) {
+		qsort(data, n, sizeof(*data), cmp);
+		return;
+	}
+
+#if defined(HAVE_VECMATH)
+	for (; i + (STRESS_SORT_RUN * STRESS_SORT_RUN) <= n; i += STRESS_SORT_RUN * STRESS_SORT_RUN)
+		stress_sort_int32_network(data + i);
+#endif
+	for (; i < n; i += STRESS_SORT_RUN)
+		stress_sort_int32_insertion(data + i, STRESS_MINIMUM(STRESS_SORT_RUN, n - i));
+
+	for (src = data, dst = tmp, width = STRESS_SORT_RUN; width < n; width *= 2) {
+		int32_t *swap;
+
+		for (i = 0; i < n; i += 2 * width) {
+			const size_t mid = STRESS_MINIMUM(i + width, n);
+			const size_t end = STRESS_MINIMUM(i + (2 * width), n);
+
+			stress_sort_int32_merge(src + i, src + mid, src + mid, src + end, dst + i);
+		}
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != data)
+		(void)memcpy(data, src, n * sizeof(*data));
+	free(tmp);
+
+	if (reverse)
+		stress_sort_data_int32_reverse(data, n);
+}
+
+/*
+ *  stress_sort_int32_libc_rate()
+ *	elements per second of a libc qsort of shuffled data, the
+ *	baseline for sort speedup metrics. The first sort warms up
+ *	the caches and any libc scratch memory and is not timed.
+ */
+double stress_sort_int32_libc_rate(int32_t *data, const size_t n)
+{
+	double t;
+
+	stress_sort_data_int32_shuffle(data, n);
+	qsort(data, n, sizeof(*data), stress_sort_cmp_fwd_int32);
+	stress_sort_data_int32_shuffle(data, n);
+	t = stress_time_now();
+	qsort(data, n, sizeof(*data), stress_sort_cmp_fwd_int32);
+	t = stress_time_now() - t;
+
+	return (t > 0.0) ? (double)n / t : 0.0;
+}
+
+/*
+ *  stress_set_sort_dist()
+ *	parse --sort-dist option
+ */
+int stress_set_sort_dist(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_sort_dist_names); i++) {
+		if (strcmp(opt, stress_sort_dist_names[i]) == 0) {
+			sort_dist = i;
+			sort_dist_set = true;
+			return stress_set_setting_global("sort-dist", TYPE_ID_SIZE_T, &sort_dist);
+		}
+	}
+
+	(void)fprintf(stderr, "sort-dist must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(stress_sort_dist_names); i++)
+		(void)fprintf(stderr, " %s", stress_sort_dist_names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+/*
+ *  stress_set_sort_dist_swaps()
+ *	parse --sort-dist-swaps option
+ */
+int stress_set_sort_dist_swaps(const char *opt)
+{
+	sort_dist_swaps = stress_get_uint64(opt);
+	stress_check_range("sort-dist-swaps", sort_dist_swaps, 1, 4 * MB);
+
+	return stress_set_setting_global("sort-dist-swaps", TYPE_ID_UINT64, &sort_dist_swaps);
+}
+
+/*
+ *  stress_sort_data_int32_dist()
+ *	fill data with the --sort-dist input distribution, with
+ *	--sort-dist all the distribution changes each iteration.
+ *	Returns the distribution used.
+ */
+size_t OPTIMIZE3 stress_sort_data_int32_dist(int32_t *data, const size_t n, const uint64_t iteration)
+{
+	const size_t dist = (sort_dist == STRESS_SORT_DIST_ALL) ?
+		(size_t)(iteration % STRESS_SORT_DIST_MAX) : sort_dist;
+	register size_t i;
+
+	switch (dist) {
+	default:
+	case STRESS_SORT_DIST_RANDOM:
+		/* other distributions overwrite the values, so start afresh */
+		if (sort_dist == STRESS_SORT_DIST_ALL)
+			stress_sort_data_int32_init(data, n);
+		stress_sort_data_int32_shuffle(data, n);
+		break;
+	case STRESS_SORT_DIST_SORTED:
+		stress_sort_data_int32_init(data, n);
+		break;
+	case STRESS_SORT_DIST_REVERSE:
+		stress_sort_data_int32_init(data, n);
+		stress_sort_data_int32_reverse(data, n);
+		break;
+	case STRESS_SORT_DIST_NEARLY: {
+			const uint64_t swaps = sort_dist_swaps ? sort_dist_swaps : (n / 100) + 1;
+			uint64_t j;
+
+			stress_sort_data_int32_init(data, n);
+			for (j = 0; j < swaps; j++) {
+				const size_t i1 = (size_t)stress_mwc32modn((uint32_t)n);
+				const size_t i2 = (size_t)stress_mwc32modn((uint32_t)n);
+				register const int32_t v = data[i1];
+
+				data[i1] = data[i2];
+				data[i2] = v;
+			}
+		}
+		break;
+	case STRESS_SORT_DIST_FEW_UNIQUE:
+		for (i = 0; i < n; i++)
+			data[i] = (int32_t)stress_mwc32modn(STRESS_SORT_FEW_UNIQUE) * 1000;
+		break;
+	case STRESS_SORT_DIST_ZIPF: {
+			/* rank n^u, u uniform in [0, 1), has P(k) ~ 1/k, Zipf with s = 1 */
+			const double log_n = log((double)n);
+
+			for (i = 0; i < n; i++) {
+				const double u = (double)stress_mwc32() / 4294967296.0;
+
+				data[i] = (int32_t)exp(u * log_n);
+			}
+		}
+		break;
+	case STRESS_SORT_DIST_ORGAN_PIPE:
+		for (i = 0; i < n; i++)
+			data[i] = (int32_t)((i < n / 2) ? i : n - 1 - i);
+		break;
+	case STRESS_SORT_DIST_EQUAL: {
+			const int32_t v = (int32_t)stress_mwc32();
+
+			for (i = 0; i < n; i++)
+				data[i] = v;
+		}
+		break;
+	}
+	return dist;
+}
+
+/*
+ *  stress_sort_dist_stats_add()
+ *	account a sort of distribution dist input data
+ */
+void stress_sort_dist_stats_add(
+	stress_sort_dist_stats_t *stats,
+	const size_t dist,
+	const double compares,
+	const size_t n,
+	const double duration)
+{
+	stats[dist].compares += compares;
+	stats[dist].sorted += (double)n;
+	stats[dist].duration += duration;
+}
+
+/*
+ *  stress_sort_dist_metrics()
+ *	with --sort-dist report comparisons per item (if counted) and
+ *	elements sorted per sec for each distribution, using two fixed
+ *	metrics slots per distribution from idx onwards
+ */
+void stress_sort_dist_metrics(
+	stress_args_t *args,
+	const size_t idx,
+	const char *name,
+	const stress_sort_dist_stats_t *stats,
+	const bool counted)
+{
+	size_t i;
+
+	if (!sort_dist_set)
+		return;
+
+	for (i = 0; i < STRESS_SORT_DIST_MAX; i++) {
+		char msg[64];
+
+		if ((stats[i].sorted <= 0.0) || (stats[i].duration <= 0.0))
+			continue;
+		if (counted) {
+			(void)snprintf(msg, sizeof(msg), "%s comparisons per item (%s)",
+				name, stress_sort_dist_names[i]);
+			stress_metrics_set(args, idx + (2 * i), msg,
+				stats[i].compares / stats[i].sorted, STRESS_HARMONIC_MEAN);
+		}
+		(void)snprintf(msg, sizeof(msg), "elements sorted per sec (%s)",
+			stress_sort_dist_names[i]);
+		stress_metrics_set(args, idx + (2 * i) + 1, msg,
+			stats[i].sorted / stats[i].duration, STRESS_HARMONIC_MEAN);
+	}
+}
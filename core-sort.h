@@ -21,12 +21,38 @@
 
 #include <inttypes.h>
 
+#define STRESS_SORT_THREADS_MAX	(64)	/* maximum parallel sort threads */
+
+#define STRESS_SORT_DIST_RANDOM	(0)	/* shuffled data, the default */
+#define STRESS_SORT_DIST_MAX	(8)	/* number of input distributions */
+
+typedef struct {
+	double compares;		/* comparator calls */
+	double sorted;			/* elements sorted */
+	double duration;		/* time spent sorting */
+} stress_sort_dist_stats_t;
+
+typedef int (*stress_sort_cmp_func_t)(const void *p1, const void *p2);
+typedef void (*stress_sort_func_t)(void *base, size_t nmemb, size_t size, stress_sort_cmp_func_t cmp);
+
 extern void stress_sort_data_int32_init(int32_t *data, const size_t n);
 extern void stress_sort_data_int32_shuffle(int32_t *data, const size_t n);
 extern void stress_sort_data_int32_mangle(int32_t *data, const size_t n);
 extern void stress_sort_compare_reset(void);
 extern uint64_t stress_sort_compare_get(void);
 extern uint64_t stress_sort_compares ALIGN64;
+extern void stress_sort_parallel(void *base, const size_t nmemb, const size_t size,
+	stress_sort_cmp_func_t cmp, stress_sort_func_t sort_func, const uint32_t threads);
+extern void stress_sort_int32_simd(int32_t *data, const size_t n, stress_sort_cmp_func_t cmp);
+extern double stress_sort_int32_libc_rate(int32_t *data, const size_t n);
+extern uint32_t stress_sort_threads_default(void);
+extern int stress_set_sort_dist(const char *opt);
+extern int stress_set_sort_dist_swaps(const char *opt);
+extern size_t stress_sort_data_int32_dist(int32_t *data, const size_t n, const uint64_t iteration);
+extern void stress_sort_dist_stats_add(stress_sort_dist_stats_t *stats, const size_t dist,
+	const double compares, const size_t n, const double duration);
+extern void stress_sort_dist_metrics(stress_args_t *args, const size_t idx, const char *name,
+	const stress_sort_dist_stats_t *stats, const bool counted);
 
 static inline int stress_sort_cmp_str(const void *p1, const void *p2)
 {
@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-status.h"
+
+#include <sys/socket.h>
+
+#if defined(HAVE_SYS_UN_H)
+#include <sys/un.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#if defined(HAVE_SYS_UN_H) &&	\
+    defined(HAVE_POLL_H) &&	\
+    defined(AF_UNIX)
+#define STRESS_STATUS_SOCKET	(1)
+#endif
+
+#define STATUS_REQUEST_TIMEOUT_MS	(100)
+
+#if defined(STRESS_STATUS_SOCKET)
+/* per stressor bogo-op rate, updated every second */
+typedef struct {
+	double time;			/* time of previous counter sample */
+	uint64_t counter;		/* sum of instance counters at time */
+	double rate;			/* bogo-op rate over last second */
+} stress_status_rate_t;
+
+static pid_t status_pid = -1;
+static char *status_path;
+static volatile bool status_print;
+
+/*
+ *  stress_status_counter()
+ *	sum of the bogo-op counters of all instances of a stressor
+ */
+static uint64_t stress_status_counter(const stress_stressor_t *ss)
+{
+	uint64_t counter = 0;
+	int32_t j;
+
+	for (j = 0; j < ss->num_instances; j++)
+		counter += ss->stats[j]->args.ci.counter;
+	return counter;
+}
+
+/*
+ *  stress_status_rates()
+ *	update the bogo-op rate of each stressor
+ */
+static void stress_status_rates(
+	stress_stressor_t *stressors_list,
+	stress_status_rate_t *rates,
+	const double now)
+{
+	stress_stressor_t *ss;
+	size_t k;
+
+	for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+		uint64_t counter;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		counter = stress_status_counter(ss);
+		if ((rates[k].time > 0.0) && (now > rates[k].time))
+			rates[k].rate = (double)(counter - rates[k].counter) /
+					(now - rates[k].time);
+		rates[k].time = now;
+		rates[k].counter = counter;
+	}
+}
+
+/*
+ *  stress_status_write()
+ *	write the current state of the run in prometheus text format
+ */
+static void stress_status_write(
+	FILE *fp,
+	stress_stressor_t *stressors_list,
+	const stress_status_rate_t *rates)
+{
+	stress_stressor_t *ss;
+	double min1, min5, min15;
+	size_t shmall, freemem, totalmem, freeswap, totalswap, k;
+	char name[64];
+
+	(void)fprintf(fp, "# HELP stress_ng_run_seconds Seconds since the stressors were started\n");
+	(void)fprintf(fp, "# TYPE stress_ng_run_seconds gauge\n");
+	(void)fprintf(fp, "stress_ng_run_seconds %f\n", stress_time_now() - g_shared->time_started);
+
+	(void)fprintf(fp, "# HELP stress_ng_instances Number of stressor instances in each run phase\n");
+	(void)fprintf(fp, "# TYPE stress_ng_instances counter\n");
+	(void)fprintf(fp, "stress_ng_instances{phase=\"started\"} %" PRIu32 "\n", g_shared->instance_count.started);
+	(void)fprintf(fp, "stress_ng_instances{phase=\"exited\"} %" PRIu32 "\n", g_shared->instance_count.exited);
+	(void)fprintf(fp, "stress_ng_instances{phase=\"reaped\"} %" PRIu32 "\n", g_shared->instance_count.reaped);
+	(void)fprintf(fp, "stress_ng_instances{phase=\"failed\"} %" PRIu32 "\n", g_shared->instance_count.failed);
+	(void)fprintf(fp, "stress_ng_instances{phase=\"alarmed\"} %" PRIu32 "\n", g_shared->instance_count.alarmed);
+
+	if (stress_get_load_avg(&min1, &min5, &min15) == 0) {
+		(void)fprintf(fp, "# HELP stress_ng_load_average System load average\n");
+		(void)fprintf(fp, "# TYPE stress_ng_load_average gauge\n");
+		(void)fprintf(fp, "stress_ng_load_average{period=\"1m\"} %.2f\n", min1);
+		(void)fprintf(fp, "stress_ng_load_average{period=\"5m\"} %.2f\n", min5);
+		(void)fprintf(fp, "stress_ng_load_average{period=\"15m\"} %.2f\n", min15);
+	}
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	(void)fprintf(fp, "# HELP stress_ng_memory_bytes System memory\n");
+	(void)fprintf(fp, "# TYPE stress_ng_memory_bytes gauge\n");
+	(void)fprintf(fp, "stress_ng_memory_bytes{type=\"free\"} %zu\n", freemem);
+	(void)fprintf(fp, "stress_ng_memory_bytes{type=\"total\"} %zu\n", totalmem);
+	(void)fprintf(fp, "stress_ng_memory_bytes{type=\"swap_free\"} %zu\n", freeswap);
+	(void)fprintf(fp, "stress_ng_memory_bytes{type=\"swap_total\"} %zu\n", totalswap);
+
+	(void)fprintf(fp, "# HELP stress_ng_bogo_ops_per_second Bogo-op rate of a stressor over the last second\n");
+	(void)fprintf(fp, "# TYPE stress_ng_bogo_ops_per_second gauge\n");
+	for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+		(void)fprintf(fp, "stress_ng_bogo_ops_per_second{stressor=\"%s\"} %f\n",
+			name, rates[k].rate);
+	}
+
+	(void)fprintf(fp, "# HELP stress_ng_bogo_ops Bogo-op counter of a stressor instance\n");
+	(void)fprintf(fp, "# TYPE stress_ng_bogo_ops counter\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+		for (j = 0; j < ss->num_instances; j++) {
+			(void)fprintf(fp, "stress_ng_bogo_ops{stressor=\"%s\",instance=\"%" PRId32 "\"} %" PRIu64 "\n",
+				name, j, ss->stats[j]->args.ci.counter);
+		}
+	}
+
+	(void)fprintf(fp, "# HELP stress_ng_instance_state Run state of a stressor instance\n");
+	(void)fprintf(fp, "# TYPE stress_ng_instance_state gauge\n");
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *stats = ss->stats[j];
+			const char *state = stress_proc_state_str((int)stats->state);
+
+			/* Not started yet */
+			if ((stats->pid <= 0) && !stats->completed)
+				continue;
+			(void)fprintf(fp, "stress_ng_instance_state{stressor=\"%s\",instance=\"%" PRId32 "\",state=\"%s\"} 1\n",
+				name, j, state ? state : "unknown");
+		}
+	}
+
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+		(void)fprintf(fp, "# HELP stress_ng_perf_counter Perf event counter of a stressor instance at the last sample interval\n");
+		(void)fprintf(fp, "# TYPE stress_ng_perf_counter counter\n");
+		for (ss = stressors_list; ss; ss = ss->next) {
+			int32_t j;
+
+			if (ss->ignore.run || !ss->stats)
+				continue;
+			(void)stress_munge_underscore(name, ss->stressor->name, sizeof(name));
+			for (j = 0; j < ss->num_instances; j++) {
+				uint64_t counters[STRESS_PERF_MAX];
+				char event[64];
+				size_t i;
+
+				if (!stress_perf_sample_last((int32_t)(ss->stats[j] - g_shared->stats), counters))
+					continue;
+				for (i = 0; stress_perf_event_name(i, event, sizeof(event)); i++) {
+					if (counters[i] == STRESS_PERF_INVALID)
+						continue;
+					(void)fprintf(fp, "stress_ng_perf_counter{stressor=\"%s\",instance=\"%" PRId32
+						"\",event=\"%s\"} %" PRIu64 "\n", name, j, event, counters[i]);
+				}
+			}
+		}
+	}
+#endif
+
+#if defined(STRESS_THERMAL_ZONES)
+	if (g_shared->tz_info) {
+		stress_tz_t tz;
+		const stress_tz_info_t *tz_info;
+
+		(void)shim_memset(&tz, 0, sizeof(tz));
+		(void)stress_tz_get_temperatures(&g_shared->tz_info, &tz);
+		(void)fprintf(fp, "# HELP stress_ng_thermal_zone_celsius Thermal zone temperature\n");
+		(void)fprintf(fp, "# TYPE stress_ng_thermal_zone_celsius gauge\n");
+		for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+			(void)fprintf(fp, "stress_ng_thermal_zone_celsius{zone=\"%s\",instance=\"%" PRIu32 "\"} %.2f\n",
+				tz_info->type, tz_info->type_instance,
+				(double)tz.tz_stat[tz_info->index].temperature / 1000.0);
+		}
+	}
+#endif
+}
+
+/*
+ *  stress_status_serve()
+ *	serve a status request on a connected socket, a HTTP GET
+ *	request gets a HTTP response so the socket can be scraped
+ *	with curl --unix-socket, anything else just gets the status
+ */
+static void stress_status_serve(
+	const int fd,
+	stress_stressor_t *stressors_list,
+	const stress_status_rate_t *rates)
+{
+	struct pollfd pfd;
+	char request[1024];
+	ssize_t n = 0;
+	FILE *fp;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, STATUS_REQUEST_TIMEOUT_MS) > 0)
+		n = recv(fd, request, sizeof(request) - 1, 0);
+	request[n > 0 ? n : 0] = '\0';
+
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		(void)close(fd);
+		return;
+	}
+	if (!strncmp(request, "GET ", 4)) {
+		(void)fprintf(fp, "HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Connection: close\r\n\r\n");
+	}
+	stress_status_write(fp, stressors_list, rates);
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_status_handler()
+ *	flag that status should be printed to stdout
+ */
+static void MLOCKED_TEXT stress_status_handler(int signum)
+{
+	(void)signum;
+
+	status_print = true;
+}
+
+/*
+ *  stress_status_listen()
+ *	create the listening status socket, returns -1 on failure
+ */
+static int stress_status_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat statbuf;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		pr_inf("status-socket: path '%s' is too long\n", path);
+		return -1;
+	}
+	/* Only replace a stale socket, never any other file */
+	if (lstat(path, &statbuf) == 0) {
+		if (!S_ISSOCK(statbuf.st_mode)) {
+			pr_inf("status-socket: '%s' exists and is not a socket\n", path);
+			return -1;
+		}
+		(void)shim_unlink(path);
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		pr_inf("status-socket: socket failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		return -1;
+	}
+	(void)shim_memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	(void)shim_strscpy(addr.sun_path, path, sizeof(addr.sun_path));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		pr_inf("status-socket: bind to '%s' failed, errno=%d (%s)\n",
+			path, errno, strerror(errno));
+		(void)close(fd);
+		return -1;
+	}
+	(void)chmod(path, S_IRUSR | S_IWUSR);
+	if (listen(fd, 4) < 0) {
+		pr_inf("status-socket: listen failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		(void)close(fd);
+		(void)shim_unlink(path);
+		return -1;
+	}
+	return fd;
+}
+#endif
+
+/*
+ *  stress_status_start()
+ *	start the status process, this serves the live state of the
+ *	run in prometheus text format on the --status-socket UNIX
+ *	socket and prints the state to stdout on SIGUSR2
+ */
+void stress_status_start(stress_stressor_t *stressors_list)
+{
+#if defined(STRESS_STATUS_SOCKET)
+	stress_stressor_t *ss;
+	stress_status_rate_t *rates;
+	size_t n = 0;
+	double t;
+	int fd;
+
+	if (!stress_get_setting("status-socket", &status_path) || !status_path)
+		return;
+
+	fd = stress_status_listen(status_path);
+	if (fd < 0)
+		return;
+
+	status_pid = fork();
+	if (status_pid < 0) {
+		pr_inf("status-socket: fork failed, errno=%d (%s)\n",
+			errno, strerror(errno));
+		(void)close(fd);
+		(void)shim_unlink(status_path);
+		return;
+	} else if (status_pid > 0) {
+		(void)close(fd);
+		return;
+	}
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [status]");
+	status_pid = -1;
+	if (stress_sighandler("status", SIGUSR2, stress_status_handler, NULL) < 0)
+		_exit(0);
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n++;
+	rates = (stress_status_rate_t *)calloc(n, sizeof(*rates));
+	if (!rates) {
+		pr_inf("status-socket: cannot allocate stressor rates\n");
+		_exit(0);
+	}
+
+	t = stress_time_now();
+	while (stress_continue_flag()) {
+		struct pollfd pfd;
+		int ret;
+		double now;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, 1000);
+		if ((ret > 0) && (pfd.revents & POLLIN)) {
+			const int sfd = accept(fd, NULL, NULL);
+
+			if (sfd >= 0)
+				stress_status_serve(sfd, stressors_list, rates);
+		}
+		now = stress_time_now();
+		if (now - t >= 1.0) {
+			stress_status_rates(stressors_list, rates, now);
+			t = now;
+		}
+		if (status_print) {
+			status_print = false;
+			stress_status_write(stdout, stressors_list, rates);
+			(void)fflush(stdout);
+		}
+	}
+	free(rates);
+	_exit(0);
+#else
+	char *path = NULL;
+
+	(void)stressors_list;
+
+	if (stress_get_setting("status-socket", &path) && path)
+		pr_inf("status-socket: UNIX sockets are not supported on this system\n");
+#endif
+}
+
+/*
+ *  stress_status_stop()
+ *	stop the status process and remove the socket
+ */
+void stress_status_stop(void)
+{
+#if defined(STRESS_STATUS_SOCKET)
+	if (status_pid <= 0)
+		return;
+
+	(void)stress_kill_pid_wait(status_pid, NULL);
+	status_pid = -1;
+	if (status_path)
+		(void)shim_unlink(status_path);
+#endif
+}
+
+/*
+ *  stress_status_notify()
+ *	ask the status process to print the status, this is
+ *	async signal safe, returns false if there is no status
+ *	process
+ */
+bool stress_status_notify(void)
+{
+#if defined(STRESS_STATUS_SOCKET)
+	if (status_pid > 0)
+		return shim_kill(status_pid, SIGUSR2) == 0;
+#endif
+	return false;
+}
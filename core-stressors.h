@@ -180,6 +180,7 @@
 	MACRO(monte_carlo)	\
 	MACRO(mprotect)		\
 	MACRO(mpfr)		\
+	MACRO(mpmc)		\
 	MACRO(mq)		\
 	MACRO(mremap)		\
 	MACRO(msg)		\
@@ -349,6 +350,7 @@
 	MACRO(xattr)		\
 	MACRO(yield)		\
 	MACRO(zero)		\
+	MACRO(zerocopy)		\
 	MACRO(zlib)		\
 	MACRO(zombie)
 
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-lock.h"
+#include "core-sync-start.h"
+
+#define SYNC_START_WAIT_NS	(100000000)	/* futex wait timeout, 100ms */
+#define SYNC_START_WAIT_MAX	(10.0)		/* max seconds to wait at barrier */
+
+static stress_stats_t *sync_stats;	/* instance stats, NULL = not taking part */
+static pid_t sync_pid;			/* instance pid */
+static bool sync_arrived;		/* true once instance reached the barrier */
+
+/*
+ *  stress_sync_start_check()
+ *	release the instances at the barrier once all the
+ *	expected instances have arrived, lock must be held
+ */
+static void stress_sync_start_check(void)
+{
+	if ((g_shared->sync_start.expected > 0) &&
+	    (g_shared->sync_start.arrived >= g_shared->sync_start.expected) &&
+	    !g_shared->sync_start.released) {
+		g_shared->sync_start.released = 1;
+		(void)shim_futex_wake(&g_shared->sync_start.released, INT_MAX);
+	}
+}
+
+/*
+ *  stress_sync_start_init()
+ *	create the --sync-start barrier lock
+ */
+void stress_sync_start_init(void)
+{
+	if (!(g_opt_flags & OPT_FLAGS_SYNC_START))
+		return;
+
+	g_shared->sync_start.lock = stress_lock_create("sync-start");
+	if (!g_shared->sync_start.lock)
+		pr_inf("sync-start: cannot create barrier lock, --sync-start disabled\n");
+}
+
+/*
+ *  stress_sync_start_free()
+ *	destroy the --sync-start barrier lock
+ */
+void stress_sync_start_free(void)
+{
+	if (g_shared->sync_start.lock) {
+		(void)stress_lock_destroy(g_shared->sync_start.lock);
+		g_shared->sync_start.lock = NULL;
+	}
+}
+
+/*
+ *  stress_sync_start_reset()
+ *	reset the barrier before a run of stressors is started
+ */
+void stress_sync_start_reset(void)
+{
+	if (!g_shared->sync_start.lock)
+		return;
+
+	g_shared->sync_start.released = 0;
+	g_shared->sync_start.arrived = 0;
+	g_shared->sync_start.expected = 0;
+}
+
+/*
+ *  stress_sync_start_launched()
+ *	all the instances of the run have been started, the
+ *	barrier releases once this many instances have arrived
+ */
+void stress_sync_start_launched(const uint32_t instances)
+{
+	if (!g_shared->sync_start.lock)
+		return;
+	if (stress_lock_acquire(g_shared->sync_start.lock) < 0)
+		return;
+	g_shared->sync_start.expected = instances;
+	stress_sync_start_check();
+	(void)stress_lock_release(g_shared->sync_start.lock);
+}
+
+/*
+ *  stress_sync_start_attach()
+ *	make the stressor instance in this process take part
+ *	in the barrier
+ */
+void stress_sync_start_attach(stress_stats_t *stats)
+{
+	if (!g_shared->sync_start.lock)
+		return;
+	sync_stats = stats;
+	sync_pid = getpid();
+	sync_arrived = false;
+}
+
+/*
+ *  stress_sync_start_arrive()
+ *	count the instance in at the barrier
+ */
+static void stress_sync_start_arrive(void)
+{
+	sync_arrived = true;
+	if (stress_lock_acquire(g_shared->sync_start.lock) < 0)
+		return;
+	g_shared->sync_start.arrived++;
+	stress_sync_start_check();
+	(void)stress_lock_release(g_shared->sync_start.lock);
+}
+
+/*
+ *  stress_sync_start_wait()
+ *	called when the stressor instance has completed its set up
+ *	and is about to start running, wait for all the instances
+ *	to reach this point and then restart the run time from the
+ *	time the instances were released so that all the instances
+ *	are measured over the same window
+ */
+void stress_sync_start_wait(void)
+{
+	stress_stats_t *stats = sync_stats;
+	double now, t_end;
+
+	/* child processes of the stressor don't take part */
+	if (!stats || sync_arrived || (getpid() != sync_pid))
+		return;
+
+	stress_sync_start_arrive();
+	t_end = stress_time_now() + SYNC_START_WAIT_MAX;
+	while (!g_shared->sync_start.released && stress_continue_flag()) {
+		struct timespec timeout;
+
+		/*
+		 *  An instance that never reaches the barrier, for example
+		 *  one that runs its stressor in a child process, must not
+		 *  hold up the other instances for the entire run
+		 */
+		if (stress_time_now() > t_end) {
+			pr_dbg("%s: sync-start: not all instances reached the barrier "
+				"after %.0f seconds, releasing\n", stats->args.name, SYNC_START_WAIT_MAX);
+			g_shared->sync_start.released = 1;
+			(void)shim_futex_wake(&g_shared->sync_start.released, INT_MAX);
+			break;
+		}
+
+		timeout.tv_sec = 0;
+		timeout.tv_nsec = SYNC_START_WAIT_NS;
+		if ((shim_futex_wait(&g_shared->sync_start.released, 0, &timeout) < 0) &&
+		    (errno == ENOSYS))
+			(void)shim_usleep(SYNC_START_WAIT_NS / 1000);
+	}
+	if (!stress_continue_flag())
+		return;
+
+	now = stress_time_now();
+	stats->start = now;
+	stats->args.time_end = now + (double)g_opt_timeout;
+	if (g_opt_timeout)
+		(void)alarm((unsigned int)g_opt_timeout);
+}
+
+/*
+ *  stress_sync_start_leave()
+ *	stressor instance has finished, count it in at the barrier
+ *	if it finished without reaching it so no other instances
+ *	are left waiting for it
+ */
+void stress_sync_start_leave(void)
+{
+	if (!sync_stats || sync_arrived || (getpid() != sync_pid))
+		return;
+	stress_sync_start_arrive();
+}
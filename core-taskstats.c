@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-taskstats.h"
+
+#include <sys/socket.h>
+
+#if defined(HAVE_LINUX_NETLINK_H)
+#include <linux/netlink.h>
+#endif
+
+#if defined(HAVE_LINUX_GENETLINK_H)
+#include <linux/genetlink.h>
+#endif
+
+#if defined(HAVE_LINUX_TASKSTATS_H)
+#include <linux/taskstats.h>
+#endif
+
+#if defined(__linux__) &&		\
+    defined(HAVE_LINUX_NETLINK_H) &&	\
+    defined(HAVE_LINUX_GENETLINK_H) &&	\
+    defined(HAVE_LINUX_TASKSTATS_H)
+#define STRESS_TASKSTATS
+#endif
+
+/* indices into stress_taskstats_t count and delay_ns arrays */
+#define TASKSTATS_DELAY_CPU		(0)
+#define TASKSTATS_DELAY_BLKIO		(1)
+#define TASKSTATS_DELAY_SWAPIN		(2)
+#define TASKSTATS_DELAY_FREEPAGES	(3)
+#define TASKSTATS_DELAY_THRASHING	(4)
+#define TASKSTATS_DELAY_COMPACT		(5)
+
+static const char * const stress_taskstats_delay_names[STRESS_TASKSTATS_DELAYS] = {
+	"cpu",
+	"blkio",
+	"swapin",
+	"freepages",
+	"thrashing",
+	"compact",
+};
+
+/*
+ *  stress_taskstats_enabled()
+ *	return true if --taskstats is enabled
+ */
+bool stress_taskstats_enabled(void)
+{
+	bool taskstats = false;
+
+	(void)stress_get_setting("taskstats", &taskstats);
+	return taskstats;
+}
+
+#if defined(STRESS_TASKSTATS)
+
+#define NLA_DATA(na)		((void *)((char *)(na) + NLA_HDRLEN))
+#define NLA_PAYLOAD(len)	((len) - NLA_HDRLEN)
+
+#define GENL_MSG_DATA(glh)	((void *)((char *)NLMSG_DATA(glh) + GENL_HDRLEN))
+#define GENL_MSG_PAYLOAD(glh)	(NLMSG_PAYLOAD(glh, 0) - GENL_HDRLEN)
+
+/*
+ *  netlink message with enough payload for a struct taskstats
+ */
+typedef struct {
+	struct nlmsghdr n;
+	struct genlmsghdr g;
+	char data[2048];	/* cppcheck-suppress unusedStructMember */
+} stress_taskstats_nlmsg_t;
+
+/*
+ *  stress_taskstats_sendcmd()
+ *	send a generic netlink command with a single attribute
+ */
+static int stress_taskstats_sendcmd(
+	const int sock,
+	const uint16_t nlmsg_type,
+	const uint8_t cmd,
+	const uint16_t nla_type,
+	const void *nla_data,
+	const uint16_t nla_len)
+{
+	struct nlattr *na;
+	char *nlmsgbuf;
+	ssize_t nlmsgbuf_len;
+	struct sockaddr_nl addr;
+	stress_taskstats_nlmsg_t nlmsg ALIGN64;
+
+	(void)shim_memset(&nlmsg, 0, sizeof(nlmsg));
+	nlmsg.n.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+	nlmsg.n.nlmsg_type = nlmsg_type;
+	nlmsg.n.nlmsg_flags = NLM_F_REQUEST;
+	nlmsg.n.nlmsg_pid = (uint32_t)getpid();
+	nlmsg.n.nlmsg_seq = 0;
+	nlmsg.g.cmd = cmd;
+	nlmsg.g.version = 0x1;
+
+	na = (struct nlattr *)GENL_MSG_DATA(&nlmsg);
+	na->nla_type = nla_type;
+	na->nla_len = nla_len + NLA_HDRLEN;
+	(void)shim_memcpy(NLA_DATA(na), nla_data, (size_t)nla_len);
+	nlmsg.n.nlmsg_len += NLMSG_ALIGN(na->nla_len);
+
+	nlmsgbuf = (char *)&nlmsg;
+	nlmsgbuf_len = nlmsg.n.nlmsg_len;
+
+	(void)shim_memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+
+	while (nlmsgbuf_len > 0) {
+		const ssize_t len = sendto(sock, nlmsgbuf, (size_t)nlmsgbuf_len, 0,
+				(struct sockaddr *)&addr, sizeof(addr));
+		if (len < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			return -1;
+		}
+		nlmsgbuf_len -= len;
+		nlmsgbuf += len;
+	}
+	return 0;
+}
+
+/*
+ *  stress_taskstats_recv()
+ *	receive a generic netlink reply, returns the genetlink
+ *	payload length or -1 on error or a netlink error reply
+ */
+static ssize_t stress_taskstats_recv(const int sock, stress_taskstats_nlmsg_t *nlmsg)
+{
+	ssize_t len;
+
+	(void)shim_memset(nlmsg, 0, sizeof(*nlmsg));
+	do {
+		len = recv(sock, nlmsg, sizeof(*nlmsg), 0);
+	} while ((len < 0) && (errno == EINTR));
+
+	if (len < 0)
+		return -1;
+	if (!NLMSG_OK((&nlmsg->n), (unsigned int)len))
+		return -1;
+	if (nlmsg->n.nlmsg_type == NLMSG_ERROR)
+		return -1;
+	return (ssize_t)GENL_MSG_PAYLOAD(&nlmsg->n);
+}
+
+/*
+ *  stress_taskstats_family_id()
+ *	find the taskstats generic netlink family id
+ */
+static int stress_taskstats_family_id(const int sock, uint16_t *id)
+{
+	static const char name[] = TASKSTATS_GENL_NAME;
+	stress_taskstats_nlmsg_t nlmsg ALIGN64;
+	struct nlattr *na;
+	ssize_t msg_len, len;
+
+	if (stress_taskstats_sendcmd(sock, GENL_ID_CTRL, CTRL_CMD_GETFAMILY,
+			CTRL_ATTR_FAMILY_NAME, (const void *)name, sizeof(name)) < 0)
+		return -1;
+	msg_len = stress_taskstats_recv(sock, &nlmsg);
+	if (msg_len < 0)
+		return -1;
+
+	na = (struct nlattr *)GENL_MSG_DATA(&nlmsg);
+	for (len = 0; len < msg_len; ) {
+		const ssize_t nla_len = NLA_ALIGN(na->nla_len);
+
+		if (nla_len <= 0)
+			break;
+		if (na->nla_type == CTRL_ATTR_FAMILY_ID) {
+			*id = *(uint16_t *)NLA_DATA(na);
+			return 0;
+		}
+		len += nla_len;
+		na = (struct nlattr *)((char *)na + nla_len);
+	}
+	return -1;
+}
+
+/*
+ *  stress_taskstats_copy()
+ *	copy the delay accounting fields from the kernel's struct
+ *	taskstats, newer delay types are only filled in if both the
+ *	build headers and the running kernel provide them
+ */
+static void stress_taskstats_copy(const struct nlattr *na, stress_taskstats_t *taskstats)
+{
+	struct taskstats t;
+	size_t len = (size_t)NLA_PAYLOAD(na->nla_len);
+
+	/* older kernels may return a shorter struct, newer ones a longer one */
+	(void)shim_memset(&t, 0, sizeof(t));
+	if (len > sizeof(t))
+		len = sizeof(t);
+	(void)shim_memcpy(&t, NLA_DATA(na), len);
+
+	taskstats->count[TASKSTATS_DELAY_CPU] = (uint64_t)t.cpu_count;
+	taskstats->delay_ns[TASKSTATS_DELAY_CPU] = (uint64_t)t.cpu_delay_total;
+	taskstats->count[TASKSTATS_DELAY_BLKIO] = (uint64_t)t.blkio_count;
+	taskstats->delay_ns[TASKSTATS_DELAY_BLKIO] = (uint64_t)t.blkio_delay_total;
+	taskstats->count[TASKSTATS_DELAY_SWAPIN] = (uint64_t)t.swapin_count;
+	taskstats->delay_ns[TASKSTATS_DELAY_SWAPIN] = (uint64_t)t.swapin_delay_total;
+	taskstats->count[TASKSTATS_DELAY_FREEPAGES] = (uint64_t)t.freepages_count;
+	taskstats->delay_ns[TASKSTATS_DELAY_FREEPAGES] = (uint64_t)t.freepages_delay_total;
+#if TASKSTATS_VERSION >= 9
+	if (t.version >= 9) {
+		taskstats->count[TASKSTATS_DELAY_THRASHING] = (uint64_t)t.thrashing_count;
+		taskstats->delay_ns[TASKSTATS_DELAY_THRASHING] = (uint64_t)t.thrashing_delay_total;
+	}
+#endif
+#if TASKSTATS_VERSION >= 11
+	if (t.version >= 11) {
+		taskstats->count[TASKSTATS_DELAY_COMPACT] = (uint64_t)t.compact_count;
+		taskstats->delay_ns[TASKSTATS_DELAY_COMPACT] = (uint64_t)t.compact_delay_total;
+	}
+#endif
+	taskstats->valid = true;
+}
+
+/*
+ *  stress_taskstats_parse()
+ *	find the struct taskstats in a TASKSTATS_TYPE_AGGR_TGID reply
+ */
+static int stress_taskstats_parse(
+	struct nlattr *na,
+	const ssize_t msg_len,
+	stress_taskstats_t *taskstats)
+{
+	ssize_t len;
+
+	for (len = 0; len < msg_len; ) {
+		const ssize_t nla_len = NLA_ALIGN(na->nla_len);
+
+		if (nla_len <= 0)
+			break;
+		if ((na->nla_type == TASKSTATS_TYPE_AGGR_TGID) ||
+		    (na->nla_type == TASKSTATS_TYPE_AGGR_PID)) {
+			const ssize_t aggr_len = NLA_PAYLOAD(na->nla_len);
+			struct nlattr *nested = (struct nlattr *)NLA_DATA(na);
+			ssize_t n;
+
+			for (n = 0; n < aggr_len; ) {
+				const ssize_t nested_len = NLA_ALIGN(nested->nla_len);
+
+				if (nested_len <= 0)
+					break;
+				if (nested->nla_type == TASKSTATS_TYPE_STATS) {
+					stress_taskstats_copy(nested, taskstats);
+					return 0;
+				}
+				n += nested_len;
+				nested = (struct nlattr *)((char *)nested + nested_len);
+			}
+		}
+		len += nla_len;
+		na = (struct nlattr *)((char *)na + nla_len);
+	}
+	return -1;
+}
+#endif
+
+/*
+ *  stress_taskstats_get()
+ *	fetch the delay accounting totals of thread group tgid,
+ *	returns 0 if successful, -1 if taskstats are not available
+ */
+int stress_taskstats_get(const pid_t tgid, stress_taskstats_t *taskstats)
+{
+	(void)shim_memset(taskstats, 0, sizeof(*taskstats));
+#if defined(STRESS_TASKSTATS)
+	{
+		stress_taskstats_nlmsg_t nlmsg ALIGN64;
+		struct sockaddr_nl addr;
+		struct timeval tv;
+		uint32_t tgid_data = (uint32_t)tgid;
+		uint16_t id;
+		ssize_t msg_len;
+		int sock, ret = -1;
+
+		sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_GENERIC);
+		if (sock < 0)
+			return -1;
+
+		/* don't let a misbehaving kernel reply stall the instance exit */
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		(void)setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+		(void)shim_memset(&addr, 0, sizeof(addr));
+		addr.nl_family = AF_NETLINK;
+		if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+			goto err;
+		if (stress_taskstats_family_id(sock, &id) < 0)
+			goto err;
+		if (stress_taskstats_sendcmd(sock, id, TASKSTATS_CMD_GET,
+				TASKSTATS_CMD_ATTR_TGID, &tgid_data,
+				(uint16_t)sizeof(tgid_data)) < 0)
+			goto err;
+		msg_len = stress_taskstats_recv(sock, &nlmsg);
+		if (msg_len < 0)
+			goto err;
+		ret = stress_taskstats_parse((struct nlattr *)GENL_MSG_DATA(&nlmsg),
+				msg_len, taskstats);
+err:
+		(void)close(sock);
+		return ret;
+	}
+#else
+	(void)tgid;
+
+	return -1;
+#endif
+}
+
+/*
+ *  stress_taskstats_delayacct_disabled()
+ *	return true if kernel delay accounting is known to be disabled
+ */
+static bool stress_taskstats_delayacct_disabled(void)
+{
+	char buf[16];
+
+	if (stress_system_read("/proc/sys/kernel/task_delayacct", buf, sizeof(buf)) <= 0)
+		return false;
+	return buf[0] == '0';
+}
+
+/*
+ *  stress_taskstats_dump()
+ *	dump the delay accounting totals of each stressor, summed
+ *	over all the instances that managed to fetch their taskstats
+ */
+void stress_taskstats_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool pr_heading = false;
+	bool no_delays = true;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		uint64_t count[STRESS_TASKSTATS_DELAYS];
+		uint64_t delay_ns[STRESS_TASKSTATS_DELAYS];
+		int32_t k, instances = 0;
+		char munged[64];
+		size_t i;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+
+		(void)shim_memset(count, 0, sizeof(count));
+		(void)shim_memset(delay_ns, 0, sizeof(delay_ns));
+		for (k = 0; k < ss->num_instances; k++) {
+			const stress_taskstats_t *taskstats = &ss->stats[k]->taskstats;
+
+			if (!taskstats->valid)
+				continue;
+			for (i = 0; i < STRESS_TASKSTATS_DELAYS; i++) {
+				count[i] += taskstats->count[i];
+				delay_ns[i] += taskstats->delay_ns[i];
+			}
+			instances++;
+		}
+		if (instances == 0)
+			continue;
+
+		if (!pr_heading) {
+			pr_inf("taskstats delay accounting (totals of all instances):\n");
+			pr_inf("%-13s %-10s %12s %14s %12s\n",
+				"stressor", "delay", "count", "total (ms)", "average (us)");
+			pr_yaml(yaml, "taskstats:\n");
+			pr_heading = true;
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      instances: %" PRId32 "\n", instances);
+
+		for (i = 0; i < STRESS_TASKSTATS_DELAYS; i++) {
+			const char *delay_name = stress_taskstats_delay_names[i];
+			const double total_ms = (double)delay_ns[i] / 1000000.0;
+			const double average_us = count[i] ?
+				((double)delay_ns[i] / 1000.0) / (double)count[i] : 0.0;
+
+			if (delay_ns[i])
+				no_delays = false;
+			pr_inf("%-13s %-10s %12" PRIu64 " %14.3f %12.3f\n",
+				munged, delay_name, count[i], total_ms, average_us);
+			pr_yaml(yaml, "      %s-delay-count: %" PRIu64 "\n", delay_name, count[i]);
+			pr_yaml(yaml, "      %s-delay-total-ms: %.3f\n", delay_name, total_ms);
+			pr_yaml(yaml, "      %s-delay-average-us: %.3f\n", delay_name, average_us);
+		}
+		pr_yaml(yaml, "\n");
+	}
+
+	if (!pr_heading) {
+		pr_inf("taskstats: no taskstats delay accounting data available, "
+			"this requires CAP_NET_ADMIN rights and kernel taskstats support\n");
+	} else if (no_delays && stress_taskstats_delayacct_disabled()) {
+		pr_inf("taskstats: all delays are zero, kernel delay accounting "
+			"may be disabled, enable with sysctl kernel.task_delayacct=1\n");
+	}
+}
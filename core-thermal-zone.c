@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-thermal-zone.h"
 
 #if defined(STRESS_THERMAL_ZONES)
@@ -313,4 +314,265 @@ void stress_tz_dump(FILE *yaml, stress_stressor_t *stressors_list)
 	if (no_tz_stats)
 		pr_inf("thermal zone temperatures not available\n");
 }
+
+/* Thermal and power limit throttle counters, summed over CPUs and packages */
+typedef enum {
+	STRESS_THROTTLE_CORE_COUNT = 0,
+	STRESS_THROTTLE_CORE_TIME_MS,
+	STRESS_THROTTLE_PACKAGE_COUNT,
+	STRESS_THROTTLE_PACKAGE_TIME_MS,
+	STRESS_THROTTLE_CORE_POWER_LIMIT,
+	STRESS_THROTTLE_PACKAGE_POWER_LIMIT,
+	STRESS_THROTTLE_COOLING_TRANS,
+	STRESS_THROTTLE_MAX,
+} stress_throttle_counter_t;
+
+typedef struct {
+	const char *file;		/* sysfs file, NULL = not per CPU */
+	bool per_package;		/* true = one counter per package */
+	const char *yaml;		/* YAML key */
+	const char *descr;		/* description */
+} stress_throttle_info_t;
+
+static const stress_throttle_info_t throttle_info[STRESS_THROTTLE_MAX] = {
+	{ "core_throttle_count",		false,	"core-throttle-count",		"core thermal throttle events" },
+	{ "core_throttle_total_time_ms",	false,	"core-throttle-time-ms",	"core thermal throttled time (ms)" },
+	{ "package_throttle_count",		true,	"package-throttle-count",	"package thermal throttle events" },
+	{ "package_throttle_total_time_ms",	true,	"package-throttle-time-ms",	"package thermal throttled time (ms)" },
+	{ "core_power_limit_count",		false,	"core-power-limit-count",	"core power limit events" },
+	{ "package_power_limit_count",		true,	"package-power-limit-count",	"package power limit events" },
+	{ NULL,					false,	"cooling-device-transitions",	"cooling device state changes" },
+};
+
+typedef struct {
+	uint64_t counter[STRESS_THROTTLE_MAX];	/* counter values */
+	bool valid[STRESS_THROTTLE_MAX];	/* true if counter is available */
+} stress_throttle_t;
+
+/* Throttling accrued while a stressor was running */
+typedef struct stress_throttle_record {
+	struct stress_throttle_record *next;	/* next record in list */
+	const stress_stressor_t *ss;		/* stressor */
+	double duration;			/* run duration in seconds */
+	stress_throttle_t delta;		/* counter deltas */
+} stress_throttle_record_t;
+
+static stress_throttle_t throttle_begin;
+static bool throttle_begin_valid;
+static stress_throttle_record_t *throttle_records;
+
+/*
+ *  stress_tz_throttle_read_u64()
+ *	read a uint64_t value from a sysfs file
+ */
+static bool stress_tz_throttle_read_u64(const char *path, uint64_t *val)
+{
+	char buf[64];
+
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return false;
+	return sscanf(buf, "%" SCNu64, val) == 1;
+}
+
+/*
+ *  stress_tz_throttle_read()
+ *	read the x86 per CPU thermal_throttle counters, the package
+ *	counters are only counted once per physical package, and the
+ *	number of thermal cooling device state transitions
+ */
+static void stress_tz_throttle_read(stress_throttle_t *throttle)
+{
+	const int32_t cpus = stress_get_processors_configured();
+	int32_t *packages, n_packages = 0, cpu;
+	DIR *dir;
+	const struct dirent *d;
+
+	(void)shim_memset(throttle, 0, sizeof(*throttle));
+
+	packages = (cpus > 0) ? (int32_t *)calloc((size_t)cpus, sizeof(*packages)) : NULL;
+	for (cpu = 0; packages && (cpu < cpus); cpu++) {
+		char path[PATH_MAX];
+		uint64_t val;
+		bool first_in_package = true;
+		size_t i;
+
+		(void)snprintf(path, sizeof(path),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/topology/physical_package_id", cpu);
+		if (stress_tz_throttle_read_u64(path, &val)) {
+			int32_t j;
+
+			for (j = 0; j < n_packages; j++) {
+				if (packages[j] == (int32_t)val) {
+					first_in_package = false;
+					break;
+				}
+			}
+			if (first_in_package)
+				packages[n_packages++] = (int32_t)val;
+		}
+
+		for (i = 0; i < STRESS_THROTTLE_MAX; i++) {
+			if (!throttle_info[i].file)
+				continue;
+			if (throttle_info[i].per_package && !first_in_package)
+				continue;
+			(void)snprintf(path, sizeof(path),
+				"/sys/devices/system/cpu/cpu%" PRId32 "/thermal_throttle/%s",
+				cpu, throttle_info[i].file);
+			if (stress_tz_throttle_read_u64(path, &val)) {
+				throttle->counter[i] += val;
+				throttle->valid[i] = true;
+			}
+		}
+	}
+	free(packages);
+
+	dir = opendir("/sys/class/thermal");
+	if (!dir)
+		return;
+	while ((d = readdir(dir)) != NULL) {
+		char path[PATH_MAX];
+		uint64_t val;
+
+		if (strncmp(d->d_name, "cooling_device", 14))
+			continue;
+		(void)snprintf(path, sizeof(path),
+			"/sys/class/thermal/%s/stats/total_trans", d->d_name);
+		if (stress_tz_throttle_read_u64(path, &val)) {
+			throttle->counter[STRESS_THROTTLE_COOLING_TRANS] += val;
+			throttle->valid[STRESS_THROTTLE_COOLING_TRANS] = true;
+		}
+	}
+	(void)closedir(dir);
+}
+
+/*
+ *  stress_tz_throttle_begin()
+ *	snapshot the throttle counters at the start of a run
+ */
+void stress_tz_throttle_begin(void)
+{
+	if (!(g_opt_flags & OPT_FLAGS_THERMAL_ZONES))
+		return;
+	stress_tz_throttle_read(&throttle_begin);
+	throttle_begin_valid = true;
+}
+
+/*
+ *  stress_tz_throttle_end()
+ *	add the throttling since stress_tz_throttle_begin() to each
+ *	of the stressors that were run, stressors that run in
+ *	parallel all share the same system wide throttling
+ */
+void stress_tz_throttle_end(const stress_stressor_t *stressors_list, const double duration)
+{
+	const stress_stressor_t *ss;
+	stress_throttle_t end;
+
+	if (!throttle_begin_valid)
+		return;
+	throttle_begin_valid = false;
+	stress_tz_throttle_read(&end);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_throttle_record_t *record;
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (record = throttle_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record) {
+			record = (stress_throttle_record_t *)calloc(1, sizeof(*record));
+			if (!record)
+				continue;
+			record->ss = ss;
+			record->next = throttle_records;
+			throttle_records = record;
+		}
+		record->duration += duration;
+		for (i = 0; i < STRESS_THROTTLE_MAX; i++) {
+			if (!throttle_begin.valid[i] || !end.valid[i])
+				continue;
+			record->delta.valid[i] = true;
+			if (end.counter[i] > throttle_begin.counter[i])
+				record->delta.counter[i] += end.counter[i] - throttle_begin.counter[i];
+		}
+	}
+}
+
+/*
+ *  stress_tz_throttle_dump()
+ *	dump the thermal and power limit throttling of each stressor
+ */
+void stress_tz_throttle_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool dumped_heading = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_throttle_record_t *record;
+		char munged[64];
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+		for (record = throttle_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record)
+			continue;
+		for (i = 0; i < STRESS_THROTTLE_MAX; i++) {
+			if (record->delta.valid[i])
+				break;
+		}
+		if (i == STRESS_THROTTLE_MAX)
+			continue;
+
+		if (!dumped_heading) {
+			dumped_heading = true;
+			pr_inf("thermal throttling:\n");
+			pr_yaml(yaml, "thermal-throttle:\n");
+		}
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("%s:\n", munged);
+		pr_yaml(yaml, "    - stressor: %s\n", munged);
+		pr_yaml(yaml, "      duration: %f\n", record->duration);
+
+		for (i = 0; i < STRESS_THROTTLE_MAX; i++) {
+			const uint64_t val = record->delta.counter[i];
+
+			if (!record->delta.valid[i])
+				continue;
+			pr_inf("%38s %12" PRIu64 " (%.2f per sec)\n", throttle_info[i].descr, val,
+				(record->duration > 0.0) ? (double)val / record->duration : 0.0);
+			pr_yaml(yaml, "      %s: %" PRIu64 "\n", throttle_info[i].yaml, val);
+		}
+	}
+	if (dumped_heading)
+		pr_yaml(yaml, "\n");
+	else
+		pr_inf("thermal throttle counters not available\n");
+}
+
+/*
+ *  stress_tz_throttle_free()
+ *	free the per stressor throttle records
+ */
+void stress_tz_throttle_free(void)
+{
+	stress_throttle_record_t *record = throttle_records;
+
+	while (record) {
+		stress_throttle_record_t *next = record->next;
+
+		free(record);
+		record = next;
+	}
+	throttle_records = NULL;
+}
 #endif
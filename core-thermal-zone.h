@@ -46,6 +46,10 @@ extern void stress_tz_free(stress_tz_info_t **tz_info_list);
 extern int stress_tz_get_temperatures(stress_tz_info_t **tz_info_list,
 	stress_tz_t *tz);
 extern void stress_tz_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_tz_throttle_begin(void);
+extern void stress_tz_throttle_end(const stress_stressor_t *stressors_list, const double duration);
+extern void stress_tz_throttle_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern void stress_tz_throttle_free(void);
 #endif
 
 #endif
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-victim.h"
+
+#define VICTIM_STEPS_DEFAULT	(4)	/* default aggressor ramp steps */
+#define VICTIM_STEPS_MAX	(64)	/* maximum aggressor ramp steps */
+
+/* victim throughput and latency of a step of the aggressor ramp */
+typedef struct {
+	int32_t aggressor_instances;	/* total aggressor instances */
+	uint64_t counter;		/* victim bogo-ops */
+	double run_time;		/* mean victim instance run time */
+	uint64_t latency_count;		/* number of latencies recorded */
+	uint64_t p50;			/* latency percentiles, ns */
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+	bool recorded;			/* true if step has been run */
+} stress_victim_step_t;
+
+static char victim_stressor[64];
+static uint32_t victim_steps = VICTIM_STEPS_DEFAULT;
+static stress_victim_step_t victim_step[VICTIM_STEPS_MAX + 1];
+
+/*
+ *  stress_set_victim()
+ *	set the --victim stressor
+ */
+int stress_set_victim(const char *opt)
+{
+	if (!*opt) {
+		(void)fprintf(stderr, "victim: no stressor name specified\n");
+		_exit(EXIT_FAILURE);
+	}
+	(void)stress_munge_underscore(victim_stressor, opt, sizeof(victim_stressor));
+	return 0;
+}
+
+/*
+ *  stress_set_victim_steps()
+ *	set the number of steps the aggressors are ramped up in
+ */
+int stress_set_victim_steps(const char *opt)
+{
+	victim_steps = stress_get_uint32(opt);
+	stress_check_range("victim-steps", (uint64_t)victim_steps, 1, VICTIM_STEPS_MAX);
+	return 0;
+}
+
+/*
+ *  stress_victim_enabled()
+ *	true if a --victim stressor has been set
+ */
+bool stress_victim_enabled(void)
+{
+	return *victim_stressor != '\0';
+}
+
+/*
+ *  stress_victim_is()
+ *	true if ss is the --victim stressor
+ */
+bool stress_victim_is(const stress_stressor_t *ss)
+{
+	char munged[64];
+
+	if (!*victim_stressor || !ss)
+		return false;
+	(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+	return !strcmp(munged, victim_stressor);
+}
+
+/*
+ *  stress_victim_steps()
+ *	number of aggressor ramp steps, not including the
+ *	first step where the victim is run alone
+ */
+uint32_t stress_victim_steps(void)
+{
+	return victim_steps;
+}
+
+/*
+ *  stress_victim_record()
+ *	record the throughput and the bogo op latency percentiles
+ *	of the victim instances of a step of the aggressor ramp
+ */
+void stress_victim_record(
+	const uint32_t step,
+	const stress_stressor_t *ss,
+	const int32_t aggressor_instances)
+{
+	stress_victim_step_t *vs;
+	stress_latency_t *merged;
+	int32_t j, n = 0;
+	double run_time = 0.0;
+
+	if (step > VICTIM_STEPS_MAX)
+		return;
+
+	vs = &victim_step[step];
+	(void)shim_memset(vs, 0, sizeof(*vs));
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		vs->counter += stats->args.ci.counter;
+		if (stats->completed) {
+			run_time += stats->duration;
+			n++;
+		}
+	}
+	vs->aggressor_instances = aggressor_instances;
+	vs->run_time = n ? run_time / (double)n : 0.0;
+	vs->recorded = true;
+
+	merged = (stress_latency_t *)calloc(1, sizeof(*merged));
+	if (!merged)
+		return;
+	for (j = 0; j < ss->num_instances; j++)
+		stress_latency_merge(merged, &ss->stats[j]->ops_rate.latency);
+	vs->latency_count = merged->count;
+	if (merged->count > 0) {
+		vs->p50 = stress_latency_percentile(merged, 50.0);
+		vs->p99 = stress_latency_percentile(merged, 99.0);
+		vs->p999 = stress_latency_percentile(merged, 99.9);
+		vs->max = merged->max;
+	}
+	free(merged);
+}
+
+/*
+ *  stress_victim_dump()
+ *	report the victim throughput, relative to when it was run
+ *	alone, and its bogo op latencies at each step of the ramp
+ */
+void stress_victim_dump(FILE *yaml)
+{
+	uint32_t k;
+	double alone = 0.0;
+
+	if (!stress_victim_enabled() || !victim_step[0].recorded)
+		return;
+
+	pr_block_begin();
+	pr_inf("victim: %s, aggressors ramped up in %" PRIu32 " step%s\n",
+		victim_stressor, victim_steps, (victim_steps == 1) ? "" : "s");
+	pr_inf("%4s %10s %12s %9s %11s %11s %11s %11s\n", "step", "aggressors",
+		"bogo ops/s", "% alone", "p50 (ns)", "p99 (ns)", "p99.9 (ns)", "max (ns)");
+	pr_yaml(yaml, "victim:\n");
+
+	for (k = 0; k <= victim_steps; k++) {
+		const stress_victim_step_t *vs = &victim_step[k];
+		double rate, percent;
+
+		if (!vs->recorded)
+			continue;
+		rate = (vs->run_time > 0.0) ? (double)vs->counter / vs->run_time : 0.0;
+		if (k == 0)
+			alone = rate;
+		percent = (alone > 0.0) ? 100.0 * rate / alone : 0.0;
+
+		/* stressors that set the bogo-op counter directly record no latencies */
+		if (vs->latency_count > 0) {
+			pr_inf("%4" PRIu32 " %10" PRId32 " %12.2f %9.2f %11" PRIu64 " %11" PRIu64
+				" %11" PRIu64 " %11" PRIu64 "\n",
+				k, vs->aggressor_instances, rate, percent,
+				vs->p50, vs->p99, vs->p999, vs->max);
+		} else {
+			pr_inf("%4" PRIu32 " %10" PRId32 " %12.2f %9.2f %11s %11s %11s %11s\n",
+				k, vs->aggressor_instances, rate, percent, "-", "-", "-", "-");
+		}
+		pr_yaml(yaml, "    - stressor: %s\n", victim_stressor);
+		pr_yaml(yaml, "      step: %" PRIu32 "\n", k);
+		pr_yaml(yaml, "      aggressor-instances: %" PRId32 "\n", vs->aggressor_instances);
+		pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", vs->counter);
+		pr_yaml(yaml, "      bogo-ops-per-second: %f\n", rate);
+		pr_yaml(yaml, "      throughput-percent-of-alone: %f\n", percent);
+		if (vs->latency_count > 0) {
+			pr_yaml(yaml, "      latency-p50-ns: %" PRIu64 "\n", vs->p50);
+			pr_yaml(yaml, "      latency-p99-ns: %" PRIu64 "\n", vs->p99);
+			pr_yaml(yaml, "      latency-p99.9-ns: %" PRIu64 "\n", vs->p999);
+			pr_yaml(yaml, "      latency-max-ns: %" PRIu64 "\n", vs->max);
+		}
+		pr_yaml(yaml, "\n");
+	}
+	pr_block_end();
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_VICTIM_H
+#define CORE_VICTIM_H
+
+#include "stress-ng.h"
+
+extern int stress_set_victim(const char *opt);
+extern int stress_set_victim_steps(const char *opt);
+extern bool stress_victim_enabled(void);
+extern bool stress_victim_is(const stress_stressor_t *ss);
+extern uint32_t stress_victim_steps(void);
+extern void stress_victim_record(const uint32_t step, const stress_stressor_t *ss,
+	const int32_t aggressor_instances);
+extern void stress_victim_dump(FILE *yaml);
+
+#endif
@@ -21,6 +21,7 @@
 #include "core-builtin.h"
 #include "core-killpid.h"
 #include "core-pragma.h"
+#include "core-psi.h"
 #include "core-thermal-zone.h"
 #include "core-vmstat.h"
 
@@ -110,10 +111,29 @@ typedef struct {
 	uint64_t	discard_ticks;	/* total wait time for discard requests */
 } stress_iostat_t;
 
+/* A /proc or /sys stats file kept open and re-read with pread() */
+typedef struct {
+	const char *path;		/* file path */
+	int fd;				/* open file, -1 if not opened */
+	bool failed;			/* true if open failed, don't retry */
+	char *buf;			/* read buffer, grown when too small */
+	size_t size;			/* size of buf */
+} stress_stat_file_t;
+
+/* Cost of the periodic stats sampler, shared with the sampler process */
+typedef struct {
+	uint64_t samples;		/* number of sample intervals */
+	double cpu_time;		/* sampler user + system time, secs */
+} stress_vmstat_cost_t;
+
 static int32_t status_delay = 0;
 static int32_t vmstat_delay = 0;
 static int32_t thermalstat_delay = 0;
 static int32_t iostat_delay = 0;
+static bool iostat_enabled;		/* per stressor device I/O stats */
+static int32_t psistat_delay = 0;
+static stress_vmstat_cost_t *vmstat_cost = MAP_FAILED;
+static double vmstat_time_start;
 
 #if defined(__FreeBSD__)
 /*
@@ -225,9 +245,20 @@ int stress_set_thermalstat(const char *const opt)
  */
 int stress_set_iostat(const char *const opt)
 {
+	iostat_enabled = true;
 	return stress_set_generic_stat(opt, "iostat", &iostat_delay);
 }
 
+/*
+ *  stress_set_psistat()
+ *	parse --psistat option
+ */
+int stress_set_psistat(const char *const opt)
+{
+	stress_psi_enable();
+	return stress_set_generic_stat(opt, "psistat", &psistat_delay);
+}
+
 /*
  *  stress_find_mount_dev()
  *	find the path of the device that the file is located on
@@ -328,6 +359,67 @@ char *stress_find_mount_dev(const char *name)
 #endif
 }
 
+#if defined(__linux__)
+/*
+ *  stress_stat_file_read()
+ *	re-read a stats file from the start into its buffer, the
+ *	file is opened on the first read and kept open so each
+ *	sample is just a pread(), the buffer is only reallocated
+ *	if the file grows, returns NULL if the file is unreadable
+ */
+static char *stress_stat_file_read(stress_stat_file_t *sf)
+{
+	ssize_t n;
+
+	if (sf->failed)
+		return NULL;
+	if (sf->fd < 0) {
+		sf->fd = open(sf->path, O_RDONLY);
+		if (sf->fd < 0) {
+			sf->failed = true;
+			return NULL;
+		}
+	}
+
+	for (;;) {
+		if (!sf->buf) {
+			sf->size = 4096;
+			sf->buf = (char *)malloc(sf->size);
+			if (!sf->buf)
+				return NULL;
+		}
+		n = pread(sf->fd, sf->buf, sf->size - 1, 0);
+		if (n < 0)
+			return NULL;
+		if ((size_t)n < sf->size - 1)
+			break;
+		/* may be truncated, grow buffer and re-read */
+		free(sf->buf);
+		sf->buf = (char *)malloc(sf->size * 2);
+		if (!sf->buf)
+			return NULL;
+		sf->size *= 2;
+	}
+	sf->buf[n] = '\0';
+	return sf->buf;
+}
+
+/*
+ *  stress_stat_file_next_line()
+ *	terminate the line at str, returns the start of
+ *	the next line or NULL if there are no more lines
+ */
+static char *stress_stat_file_next_line(char *str)
+{
+	char *ptr = strchr(str, '\n');
+
+	if (!ptr)
+		return NULL;
+	*ptr++ = '\0';
+	return *ptr ? ptr : NULL;
+}
+#endif
+
 static pid_t vmstat_pid;
 
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
@@ -385,13 +477,15 @@ static char *stress_iostat_iostat_name(
  */
 static void stress_read_iostat(const char *iostat_name, stress_iostat_t *iostat)
 {
-	FILE *fp;
+	static stress_stat_file_t iostat_file = { NULL, -1, false, NULL, 0 };
+	const char *buf;
 
-	fp = fopen(iostat_name, "r");
-	if (fp) {
+	iostat_file.path = iostat_name;
+	buf = stress_stat_file_read(&iostat_file);
+	if (buf) {
 		int ret;
 
-		ret = fscanf(fp,
+		ret = sscanf(buf,
 			    "%" PRIu64 " %" PRIu64
 			    " %" PRIu64 " %" PRIu64
 			    " %" PRIu64 " %" PRIu64
@@ -408,7 +502,6 @@ static void stress_read_iostat(const char *iostat_name, stress_iostat_t *iostat)
 			&iostat->time_in_queue,
 			&iostat->discard_io, &iostat->discard_merges,
 			&iostat->discard_sectors, &iostat->discard_ticks);
-		(void)fclose(fp);
 
 		if (ret != 15)
 			(void)shim_memset(iostat, 0, sizeof(*iostat));
@@ -449,6 +542,249 @@ static void stress_get_iostat(const char *iostat_name, stress_iostat_t *iostat)
 }
 #endif
 
+/* Block device I/O accrued while a stressor was running */
+typedef struct stress_iostat_record {
+	struct stress_iostat_record *next;	/* next record in list */
+	const stress_stressor_t *ss;	/* stressor */
+	double duration;		/* run duration in seconds */
+	stress_iostat_t delta;		/* device stat deltas */
+} stress_iostat_record_t;
+
+static stress_iostat_record_t *iostat_records;
+
+#if defined(HAVE_SYS_SYSMACROS_H) &&	\
+    defined(__linux__)
+static char iostat_record_name[PATH_MAX];
+static bool iostat_record_name_valid;
+static bool iostat_begin_valid;
+static stress_iostat_t iostat_begin;
+
+#define STRESS_IOSTAT_ADD_DELTA(field)					\
+	record->delta.field += ((end.field > iostat_begin.field) ?	\
+		(end.field - iostat_begin.field) : 0)
+
+/*
+ *  stress_iostat_begin()
+ *	snapshot the device stats at the start of a run
+ */
+void stress_iostat_begin(void)
+{
+	if (!iostat_enabled)
+		return;
+	if (!iostat_record_name_valid) {
+		if (!stress_iostat_iostat_name(iostat_record_name, sizeof(iostat_record_name))) {
+			iostat_enabled = false;
+			return;
+		}
+		iostat_record_name_valid = true;
+	}
+	(void)shim_memset(&iostat_begin, 0, sizeof(iostat_begin));
+	stress_read_iostat(iostat_record_name, &iostat_begin);
+	iostat_begin_valid = true;
+}
+
+/*
+ *  stress_iostat_end()
+ *	add the device I/O since stress_iostat_begin() to each of the
+ *	file system and I/O class stressors that were run, stressors
+ *	run in parallel all share the same device I/O
+ */
+void stress_iostat_end(const stress_stressor_t *stressors_list, const double duration)
+{
+	const stress_stressor_t *ss;
+	stress_iostat_t end;
+
+	if (!iostat_begin_valid)
+		return;
+	iostat_begin_valid = false;
+	(void)shim_memset(&end, 0, sizeof(end));
+	stress_read_iostat(iostat_record_name, &end);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		stress_iostat_record_t *record;
+
+		if (ss->ignore.run)
+			continue;
+		if (!(ss->stressor->info->class & (CLASS_FILESYSTEM | CLASS_IO)))
+			continue;
+
+		for (record = iostat_records; record; record = record->next) {
+			if (record->ss == ss)
+				break;
+		}
+		if (!record) {
+			record = (stress_iostat_record_t *)calloc(1, sizeof(*record));
+			if (!record)
+				continue;
+			record->ss = ss;
+			record->next = iostat_records;
+			iostat_records = record;
+		}
+		record->duration += duration;
+		STRESS_IOSTAT_ADD_DELTA(read_io);
+		STRESS_IOSTAT_ADD_DELTA(read_merges);
+		STRESS_IOSTAT_ADD_DELTA(read_sectors);
+		STRESS_IOSTAT_ADD_DELTA(read_ticks);
+		STRESS_IOSTAT_ADD_DELTA(write_io);
+		STRESS_IOSTAT_ADD_DELTA(write_merges);
+		STRESS_IOSTAT_ADD_DELTA(write_sectors);
+		STRESS_IOSTAT_ADD_DELTA(write_ticks);
+		STRESS_IOSTAT_ADD_DELTA(io_ticks);
+		STRESS_IOSTAT_ADD_DELTA(time_in_queue);
+		STRESS_IOSTAT_ADD_DELTA(discard_io);
+		STRESS_IOSTAT_ADD_DELTA(discard_merges);
+		STRESS_IOSTAT_ADD_DELTA(discard_sectors);
+		STRESS_IOSTAT_ADD_DELTA(discard_ticks);
+	}
+}
+#else
+void stress_iostat_begin(void)
+{
+}
+
+void stress_iostat_end(const stress_stressor_t *stressors_list, const double duration)
+{
+	(void)stressors_list;
+	(void)duration;
+}
+#endif
+
+/* Per stressor device figures derived from a record */
+typedef struct {
+	double read_iops;		/* reads per second */
+	double write_iops;		/* writes per second */
+	double read_mb;			/* MB read */
+	double write_mb;		/* MB written */
+	double await_ms;		/* average read + write wait time */
+	double queue_depth;		/* average requests in flight */
+	double util;			/* % of time device was busy */
+	double write_kb_per_op;		/* KB written per bogo-op */
+} stress_iostat_summary_t;
+
+/*
+ *  stress_iostat_record_find()
+ *	find the device I/O record of a stressor, NULL if none
+ */
+static const stress_iostat_record_t *stress_iostat_record_find(const stress_stressor_t *ss)
+{
+	const stress_iostat_record_t *record;
+
+	for (record = iostat_records; record; record = record->next) {
+		if (record->ss == ss)
+			return record;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_iostat_summary()
+ *	convert raw deltas to rates, sectors are 512 bytes and the
+ *	ticks and time_in_queue fields are in milliseconds
+ */
+static void stress_iostat_summary(
+	const stress_iostat_record_t *record,
+	stress_iostat_summary_t *summary)
+{
+	const stress_iostat_t *delta = &record->delta;
+	const double duration = record->duration;
+	const double duration_ms = duration * 1000.0;
+	const double ios = (double)(delta->read_io + delta->write_io);
+	uint64_t bogo_ops = 0;
+	int32_t j;
+
+	for (j = 0; j < record->ss->num_instances; j++) {
+		if (record->ss->stats && record->ss->stats[j])
+			bogo_ops += record->ss->stats[j]->counter_total;
+	}
+
+	summary->read_iops = (duration > 0.0) ? (double)delta->read_io / duration : 0.0;
+	summary->write_iops = (duration > 0.0) ? (double)delta->write_io / duration : 0.0;
+	summary->read_mb = (double)delta->read_sectors * 512.0 / (double)MB;
+	summary->write_mb = (double)delta->write_sectors * 512.0 / (double)MB;
+	summary->await_ms = (ios > 0.0) ?
+		(double)(delta->read_ticks + delta->write_ticks) / ios : 0.0;
+	summary->queue_depth = (duration_ms > 0.0) ?
+		(double)delta->time_in_queue / duration_ms : 0.0;
+	summary->util = (duration_ms > 0.0) ?
+		STRESS_MINIMUM(100.0, 100.0 * (double)delta->io_ticks / duration_ms) : 0.0;
+	summary->write_kb_per_op = (bogo_ops > 0) ?
+		((double)delta->write_sectors * 512.0 / (double)KB) / (double)bogo_ops : 0.0;
+}
+
+/*
+ *  stress_iostat_yaml()
+ *	add the device I/O of a stressor to its YAML metrics block
+ */
+void stress_iostat_yaml(FILE *yaml, const stress_stressor_t *ss)
+{
+	const stress_iostat_record_t *record = stress_iostat_record_find(ss);
+	stress_iostat_summary_t summary;
+
+	if (!record)
+		return;
+	stress_iostat_summary(record, &summary);
+	pr_yaml(yaml, "      device-read-iops: %f\n", summary.read_iops);
+	pr_yaml(yaml, "      device-write-iops: %f\n", summary.write_iops);
+	pr_yaml(yaml, "      device-read-mb: %f\n", summary.read_mb);
+	pr_yaml(yaml, "      device-write-mb: %f\n", summary.write_mb);
+	pr_yaml(yaml, "      device-await-ms: %f\n", summary.await_ms);
+	pr_yaml(yaml, "      device-queue-depth: %f\n", summary.queue_depth);
+	pr_yaml(yaml, "      device-utilization-percent: %f\n", summary.util);
+	pr_yaml(yaml, "      device-write-kb-per-bogo-op: %f\n", summary.write_kb_per_op);
+}
+
+/*
+ *  stress_iostat_dump()
+ *	dump the device I/O issued while each file system and
+ *	I/O stressor was running
+ */
+void stress_iostat_dump(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	bool dumped_heading = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		const stress_iostat_record_t *record;
+		stress_iostat_summary_t summary;
+		char munged[64];
+
+		if (ss->ignore.run)
+			continue;
+		record = stress_iostat_record_find(ss);
+		if (!record)
+			continue;
+		if (!dumped_heading) {
+			dumped_heading = true;
+			pr_inf("device I/O:  %-13s %8s %8s %9s %9s %8s %7s %6s %10s\n",
+				"stressor", "Rd/s", "Wr/s", "Rd MB", "Wr MB",
+				"await ms", "qdepth", "util%", "Wr KB/op");
+		}
+		stress_iostat_summary(record, &summary);
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		pr_inf("device I/O:  %-13s %8.1f %8.1f %9.2f %9.2f %8.3f %7.2f %6.1f %10.3f\n",
+			munged, summary.read_iops, summary.write_iops,
+			summary.read_mb, summary.write_mb, summary.await_ms,
+			summary.queue_depth, summary.util, summary.write_kb_per_op);
+	}
+}
+
+/*
+ *  stress_iostat_free()
+ *	free the per stressor device I/O records
+ */
+void stress_iostat_free(void)
+{
+	stress_iostat_record_t *record = iostat_records;
+
+	while (record) {
+		stress_iostat_record_t *next = record->next;
+
+		free(record);
+		record = next;
+	}
+	iostat_records = NULL;
+}
+
 #if defined(__linux__)
 /*
  *  stress_next_field()
@@ -481,186 +817,182 @@ static bool stress_next_field(char **str)
  */
 static void stress_read_vmstat(stress_vmstat_t *vmstat)
 {
-	FILE *fp;
-	char buffer[1024];
+	static stress_stat_file_t proc_stat = { "/proc/stat", -1, false, NULL, 0 };
+	static stress_stat_file_t proc_meminfo = { "/proc/meminfo", -1, false, NULL, 0 };
+	static stress_stat_file_t proc_vmstat = { "/proc/vmstat", -1, false, NULL, 0 };
+	char *buffer, *next;
+
+	for (buffer = stress_stat_file_read(&proc_stat); buffer; buffer = next) {
+		char *ptr = buffer;
 
-	fp = fopen("/proc/stat", "r");
-	if (fp) {
-		while (fgets(buffer, sizeof(buffer), fp)) {
-			char *ptr = buffer;
+		next = stress_stat_file_next_line(buffer);
 
-			if (!strncmp(buffer, "cpu ", 4))
+		if (!strncmp(buffer, "cpu ", 4))
+			continue;
+		if (!strncmp(buffer, "cpu", 3)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			/* user time */
+			vmstat->user_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
 				continue;
-			if (!strncmp(buffer, "cpu", 3)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* user time */
-				vmstat->user_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
 
-				/* user time nice */
-				vmstat->user_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* user time nice */
+			vmstat->user_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* system time */
-				vmstat->system_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* system time */
+			vmstat->system_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* idle time */
-				vmstat->idle_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* idle time */
+			vmstat->idle_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* iowait time */
-				vmstat->wait_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* iowait time */
+			vmstat->wait_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* irq time, account in system time */
-				vmstat->system_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* irq time, account in system time */
+			vmstat->system_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* soft time, account in system time */
-				vmstat->system_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* soft time, account in system time */
+			vmstat->system_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* stolen time */
-				vmstat->stolen_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* stolen time */
+			vmstat->stolen_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* guest time, add to stolen stats */
-				vmstat->stolen_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
+			/* guest time, add to stolen stats */
+			vmstat->stolen_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
 
-				/* guest_nice time, add to stolen stats */
-				vmstat->stolen_time += (uint64_t)atoll(ptr);
-				if (!stress_next_field(&ptr))
-					continue;
-			}
+			/* guest_nice time, add to stolen stats */
+			vmstat->stolen_time += (uint64_t)atoll(ptr);
+			if (!stress_next_field(&ptr))
+				continue;
+		}
 
-			if (!strncmp(buffer, "intr", 4)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* interrupts */
-				vmstat->interrupt = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "ctxt", 4)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* context switches */
-				vmstat->context_switch = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "procs_running", 13)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* processes running */
-				vmstat->procs_running = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "procs_blocked", 13)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* procesess blocked */
-				vmstat->procs_blocked = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "swap", 4)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				/* swap in */
-				vmstat->swap_in = (uint64_t)atoll(ptr);
+		if (!strncmp(buffer, "intr", 4)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			/* interrupts */
+			vmstat->interrupt = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "ctxt", 4)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			/* context switches */
+			vmstat->context_switch = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "procs_running", 13)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			/* processes running */
+			vmstat->procs_running = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "procs_blocked", 13)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			/* procesess blocked */
+			vmstat->procs_blocked = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "swap", 4)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			/* swap in */
+			vmstat->swap_in = (uint64_t)atoll(ptr);
 
-				if (!stress_next_field(&ptr))
-					continue;
-				/* swap out */
-				vmstat->swap_out = (uint64_t)atoll(ptr);
-			}
+			if (!stress_next_field(&ptr))
+				continue;
+			/* swap out */
+			vmstat->swap_out = (uint64_t)atoll(ptr);
 		}
-		(void)fclose(fp);
 	}
 
-	fp = fopen("/proc/meminfo", "r");
-	if (fp) {
-		while (fgets(buffer, sizeof(buffer), fp)) {
-			char *ptr = buffer;
+	for (buffer = stress_stat_file_read(&proc_meminfo); buffer; buffer = next) {
+		char *ptr = buffer;
 
-			if (!strncmp(buffer, "MemFree", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_free = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "Buffers", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_buff = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "Cached", 6)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_cached = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "KReclaimable", 12)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->memory_reclaimable = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "SwapTotal", 9)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_total = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "SwapFree", 8)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_free = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "SwapUsed", 8)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_used = (uint64_t)atoll(ptr);
-			}
-		}
-		(void)fclose(fp);
+		next = stress_stat_file_next_line(buffer);
 
-		if ((vmstat->swap_used == 0) &&
-		    (vmstat->swap_free > 0) &&
-		    (vmstat->swap_total > 0)) {
-			vmstat->swap_used = vmstat->swap_total - vmstat->swap_free;
+		if (!strncmp(buffer, "MemFree", 7)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->memory_free = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "Buffers", 7)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->memory_buff = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "Cached", 6)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->memory_cached = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "KReclaimable", 12)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->memory_reclaimable = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "SwapTotal", 9)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->swap_total = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "SwapFree", 8)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->swap_free = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "SwapUsed", 8)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->swap_used = (uint64_t)atoll(ptr);
 		}
 	}
 
-	fp = fopen("/proc/vmstat", "r");
-	if (fp) {
-		while (fgets(buffer, sizeof(buffer), fp)) {
-			char *ptr = buffer;
+	if ((vmstat->swap_used == 0) &&
+	    (vmstat->swap_free > 0) &&
+	    (vmstat->swap_total > 0)) {
+		vmstat->swap_used = vmstat->swap_total - vmstat->swap_free;
+	}
 
-			if (!strncmp(buffer, "pgpgin", 6)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->block_in = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "pgpgout", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->block_out = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "pswpin", 6)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_in = (uint64_t)atoll(ptr);
-			}
-			if (!strncmp(buffer, "pswpout", 7)) {
-				if (!stress_next_field(&ptr))
-					continue;
-				vmstat->swap_out = (uint64_t)atoll(ptr);
-			}
+	for (buffer = stress_stat_file_read(&proc_vmstat); buffer; buffer = next) {
+		char *ptr = buffer;
+
+		next = stress_stat_file_next_line(buffer);
+
+		if (!strncmp(buffer, "pgpgin", 6)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->block_in = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "pgpgout", 7)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->block_out = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "pswpin", 6)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->swap_in = (uint64_t)atoll(ptr);
+		}
+		if (!strncmp(buffer, "pswpout", 7)) {
+			if (!stress_next_field(&ptr))
+				continue;
+			vmstat->swap_out = (uint64_t)atoll(ptr);
 		}
-		(void)fclose(fp);
 	}
 }
 #elif defined(__FreeBSD__)
@@ -1112,7 +1444,8 @@ void stress_vmstat_start(void)
 	stress_vmstat_t vmstat;
 	size_t tz_num = 0;
 	stress_tz_info_t *tz_info;
-	int32_t vmstat_sleep, thermalstat_sleep, iostat_sleep, status_sleep;
+	int32_t vmstat_sleep, thermalstat_sleep, iostat_sleep, psistat_sleep, status_sleep;
+	stress_psi_t psi_prev[STRESS_PSI_RESOURCES];
 	double t1, t2, t_start;
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(__linux__)
@@ -1123,14 +1456,26 @@ void stress_vmstat_start(void)
 	if ((vmstat_delay == 0) &&
 	    (thermalstat_delay == 0) &&
 	    (iostat_delay == 0) &&
+	    (psistat_delay == 0) &&
 	    (status_delay == 0))
 		return;
 
 	vmstat_sleep = vmstat_delay;
 	thermalstat_sleep = thermalstat_delay;
 	iostat_sleep = iostat_delay;
+	psistat_sleep = psistat_delay;
 	status_sleep = status_delay;
 
+	/* the sampler reports its own CPU usage to measure its observer effect */
+	vmstat_cost = (stress_vmstat_cost_t *)stress_mmap_populate(NULL,
+		sizeof(*vmstat_cost), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (vmstat_cost != MAP_FAILED) {
+		stress_set_vma_anon_name(vmstat_cost, sizeof(*vmstat_cost), "vmstat-cost");
+		(void)shim_memset(vmstat_cost, 0, sizeof(*vmstat_cost));
+	}
+	vmstat_time_start = stress_time_now();
+
 	vmstat_pid = fork();
 	if ((vmstat_pid < 0) || (vmstat_pid > 0))
 		return;
@@ -1154,6 +1499,12 @@ void stress_vmstat_start(void)
 		stress_get_iostat(iostat_name, &iostat);
 #endif
 
+	if (psistat_delay && (stress_psi_read(psi_prev) < 0)) {
+		pr_inf("psistat: pressure stall information not available\n");
+		psistat_delay = 0;
+		psistat_sleep = 0;
+	}
+
 #if defined(SCHED_DEADLINE)
 	VOID_RET(int, stress_set_sched(getpid(), SCHED_DEADLINE, 99, true));
 #endif
@@ -1174,6 +1525,8 @@ void stress_vmstat_start(void)
 		if (iostat_delay > 0)
 			sleep_delay = STRESS_MINIMUM(iostat_delay, sleep_delay);
 #endif
+		if (psistat_delay > 0)
+			sleep_delay = STRESS_MINIMUM(psistat_delay, sleep_delay);
 		if (status_delay > 0)
 			sleep_delay = STRESS_MINIMUM(status_delay, sleep_delay);
 		t1 += sleep_delay;
@@ -1189,6 +1542,7 @@ void stress_vmstat_start(void)
 		vmstat_sleep -= sleep_delay;
 		thermalstat_sleep -= sleep_delay;
 		iostat_sleep -= sleep_delay;
+		psistat_sleep -= sleep_delay;
 		status_sleep -= sleep_delay;
 
 		if ((vmstat_delay > 0) && (vmstat_sleep <= 0))
@@ -1197,6 +1551,8 @@ void stress_vmstat_start(void)
 			thermalstat_sleep = thermalstat_delay;
 		if ((iostat_delay > 0) && (iostat_sleep <= 0))
 			iostat_sleep = iostat_delay;
+		if ((psistat_delay > 0) && (psistat_sleep <= 0))
+			psistat_sleep = psistat_delay;
 		if ((status_delay > 0) && (status_sleep <= 0))
 			status_sleep = status_delay;
 
@@ -1337,6 +1693,38 @@ void stress_vmstat_start(void)
 				iostat_count = 0;
 		}
 #endif
+		if (psistat_delay == psistat_sleep) {
+			const double ms_scale = 1.0 / (1000.0 * (double)psistat_delay);
+			static uint32_t psistat_count = 0;
+			stress_psi_t psi[STRESS_PSI_RESOURCES];
+			double some[STRESS_PSI_RESOURCES], full[STRESS_PSI_RESOURCES];
+			size_t i;
+
+			(void)stress_psi_read(psi);
+			for (i = 0; i < STRESS_PSI_RESOURCES; i++) {
+				some[i] = (double)(psi[i].some_total - psi_prev[i].some_total) * ms_scale;
+				full[i] = (double)(psi[i].full_total - psi_prev[i].full_total) * ms_scale;
+			}
+			(void)shim_memcpy(psi_prev, psi, sizeof(psi_prev));
+
+			pr_block_begin();
+			if (psistat_count == 0) {
+				pr_inf("psistat: %41s   %41s\n",
+					"avg10 % some/full", "stall ms/s some/full");
+				pr_inf("psistat: %13s %13s %13s   %13s %13s %13s\n",
+					"cpu", "memory", "io", "cpu", "memory", "io");
+			}
+			pr_inf("psistat: %6.2f/%6.2f %6.2f/%6.2f %6.2f/%6.2f   %6.1f/%6.1f %6.1f/%6.1f %6.1f/%6.1f\n",
+				psi[0].some_avg10, psi[0].full_avg10,
+				psi[1].some_avg10, psi[1].full_avg10,
+				psi[2].some_avg10, psi[2].full_avg10,
+				some[0], full[0], some[1], full[1], some[2], full[2]);
+			pr_block_end();
+
+			psistat_count++;
+			if (psistat_count >= 25)
+				psistat_count = 0;
+		}
 		if (status_sleep == status_delay) {
 			const double runtime = round(stress_time_now() - g_shared->time_started);
 
@@ -1348,6 +1736,16 @@ void stress_vmstat_start(void)
 				g_shared->instance_count.alarmed,
 				stress_duration_to_str(runtime, false));
 		}
+		if (vmstat_cost != MAP_FAILED) {
+			struct rusage usage;
+
+			if (getrusage(RUSAGE_SELF, &usage) == 0) {
+				vmstat_cost->cpu_time =
+					stress_timeval_to_double(&usage.ru_utime) +
+					stress_timeval_to_double(&usage.ru_stime);
+				vmstat_cost->samples++;
+			}
+		}
 	}
 	_exit(0);
 }
@@ -1360,4 +1758,17 @@ void stress_vmstat_stop(void)
 {
 	if (vmstat_pid > 0)
 		(void)stress_kill_pid_wait(vmstat_pid, NULL);
+
+	if (vmstat_cost != MAP_FAILED) {
+		const double duration = stress_time_now() - vmstat_time_start;
+
+		if (vmstat_cost->samples > 0)
+			pr_inf("stats: periodic sampler used %.3f secs of CPU time, "
+				"%.2f usecs per sample, %.3f%% of one CPU\n",
+				vmstat_cost->cpu_time,
+				STRESS_DBL_MICROSECOND * vmstat_cost->cpu_time / (double)vmstat_cost->samples,
+				(duration > 0.0) ? 100.0 * vmstat_cost->cpu_time / duration : 0.0);
+		(void)munmap((void *)vmstat_cost, sizeof(*vmstat_cost));
+		vmstat_cost = MAP_FAILED;
+	}
 }
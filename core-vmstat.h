@@ -25,8 +25,14 @@ extern WARN_UNUSED int stress_set_status(const char *const opt);
 extern WARN_UNUSED int stress_set_vmstat(const char *const opt);
 extern WARN_UNUSED int stress_set_thermalstat(const char *const opt);
 extern WARN_UNUSED int stress_set_iostat(const char *const opt);
+extern WARN_UNUSED int stress_set_psistat(const char *const opt);
 extern WARN_UNUSED char *stress_find_mount_dev(const char *name);
 extern void stress_vmstat_start(void);
 extern void stress_vmstat_stop(void);
+extern void stress_iostat_begin(void);
+extern void stress_iostat_end(const stress_stressor_t *stressors_list, const double duration);
+extern void stress_iostat_yaml(FILE *yaml, const stress_stressor_t *ss);
+extern void stress_iostat_dump(stress_stressor_t *stressors_list);
+extern void stress_iostat_free(void);
 
 #endif
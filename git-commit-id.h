@@ -0,0 +1 @@
+#define STRESS_GIT_COMMIT_ID "a79e3b823ca55e6f71facd67ebae3ac34a8081bb"
@@ -31,13 +31,37 @@
 #include <linux/socket.h>
 #endif
 
+#if defined(HAVE_LINUX_AIO_ABI_H)
+#include <linux/aio_abi.h>
+#endif
+
 #define ALLOC_SLOP	(64)
 
+#define STRESS_AF_ALG_MODE_SYNC		(0)	/* send/recv, data copied */
+#define STRESS_AF_ALG_MODE_SPLICE	(1)	/* vmsplice/splice, zero copy */
+#define STRESS_AF_ALG_MODE_AIO		(2)	/* async reads with io_submit */
+
+#define STRESS_AF_ALG_AIO_DEPTH_MAX	(64)
+#define STRESS_AF_ALG_AIO_DEPTH_DEFAULT	(8)
+
+typedef struct {
+	const char *name;
+	const int mode;
+} stress_af_alg_mode_t;
+
+static const stress_af_alg_mode_t af_alg_modes[] = {
+	{ "sync",	STRESS_AF_ALG_MODE_SYNC },
+	{ "splice",	STRESS_AF_ALG_MODE_SPLICE },
+	{ "aio",	STRESS_AF_ALG_MODE_AIO },
+};
+
 static const stress_help_t help[] = {
-	{ NULL,	"af-alg N",	"start N workers that stress AF_ALG socket domain" },
-	{ NULL,	"af-alg-dump",	"dump internal list from /proc/crypto to stdout" },
-	{ NULL,	"af-alg-ops N",	"stop after N af-alg bogo operations" },
-	{ NULL, NULL,		NULL }
+	{ NULL,	"af-alg N",		"start N workers that stress AF_ALG socket domain" },
+	{ NULL,	"af-alg-aio-depth N",	"number of async skcipher requests in flight in aio mode" },
+	{ NULL,	"af-alg-dump",		"dump internal list from /proc/crypto to stdout" },
+	{ NULL,	"af-alg-mode M",	"data path mode M, one of sync, splice or aio" },
+	{ NULL,	"af-alg-ops N",		"stop after N af-alg bogo operations" },
+	{ NULL, NULL,			NULL }
 };
 
 static int stress_set_af_alg_dump(const char *opt)
@@ -45,8 +69,35 @@ static int stress_set_af_alg_dump(const char *opt)
 	return stress_set_setting_true("af-alg-dump", opt);
 }
 
+static int stress_set_af_alg_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(af_alg_modes); i++) {
+		if (!strcmp(opt, af_alg_modes[i].name))
+			return stress_set_setting("af-alg-mode", TYPE_ID_INT, &af_alg_modes[i].mode);
+	}
+	(void)fprintf(stderr, "af-alg-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(af_alg_modes); i++)
+		(void)fprintf(stderr, " %s", af_alg_modes[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+static int stress_set_af_alg_aio_depth(const char *opt)
+{
+	uint32_t af_alg_aio_depth;
+
+	af_alg_aio_depth = stress_get_uint32(opt);
+	stress_check_range("af-alg-aio-depth", (uint64_t)af_alg_aio_depth, 1, STRESS_AF_ALG_AIO_DEPTH_MAX);
+	return stress_set_setting("af-alg-aio-depth", TYPE_ID_UINT32, &af_alg_aio_depth);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_af_alg_aio_depth,	stress_set_af_alg_aio_depth },
 	{ OPT_af_alg_dump,	stress_set_af_alg_dump },
+	{ OPT_af_alg_mode,	stress_set_af_alg_mode },
 	{ 0,			NULL }
 };
 
@@ -61,6 +112,20 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 #define MAX_AF_ALG_RETRIES		(25)
 #define MAX_AF_ALG_RETRIES_BIND		(3)
 
+#if defined(HAVE_VMSPLICE) &&		\
+    defined(HAVE_SPLICE)
+#define STRESS_AF_ALG_SPLICE		(1)
+#endif
+
+#if defined(HAVE_LINUX_AIO_ABI_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_setup) &&		\
+    defined(__NR_io_destroy) &&		\
+    defined(__NR_io_submit) &&		\
+    defined(__NR_io_getevents)
+#define STRESS_AF_ALG_AIO		(1)
+#endif
+
 /* See https://lwn.net/Articles/410833/ */
 
 typedef enum {
@@ -110,11 +175,21 @@ typedef struct stress_crypto_info {
 	bool	ignore;
 	bool	selftest;		/* true if passed */
 	stress_metrics_t metrics;	/* performance metrics */
+	double	bytes;			/* bytes processed in metrics.duration */
 	struct stress_crypto_info *next;
 } stress_crypto_info_t;
 
 static stress_crypto_info_t *crypto_info_list;
 
+typedef struct {
+	int mode;			/* STRESS_AF_ALG_MODE_* data path */
+	uint32_t aio_depth;		/* async requests in flight, aio mode */
+	int pipefds[2];			/* vmsplice/splice pipe, splice mode */
+#if defined(STRESS_AF_ALG_AIO)
+	aio_context_t aio_ctx;		/* kernel AIO context, aio mode */
+#endif
+} stress_af_alg_ctx_t;
+
 /*
  * Provide some predefined/default configs
  * to the list generated from /proc/crypto
@@ -184,8 +259,125 @@ static void stress_af_alg_ignore(
 	info->ignore = true;
 }
 
+/*
+ *  stress_af_alg_ctx_init()
+ *	set up the pipe for splice mode or the AIO context for
+ *	aio mode, fall back to the sync mode if this fails
+ */
+static void stress_af_alg_ctx_init(stress_args_t *args, stress_af_alg_ctx_t *ctx)
+{
+	switch (ctx->mode) {
+	case STRESS_AF_ALG_MODE_SPLICE:
+#if defined(STRESS_AF_ALG_SPLICE)
+		if (pipe(ctx->pipefds) == 0)
+			return;
+		if (args->instance == 0)
+			pr_inf("%s: cannot create pipe, errno=%d (%s), using sync mode\n",
+				args->name, errno, strerror(errno));
+#else
+		if (args->instance == 0)
+			pr_inf("%s: vmsplice/splice not supported, using sync mode\n",
+				args->name);
+#endif
+		break;
+	case STRESS_AF_ALG_MODE_AIO:
+#if defined(STRESS_AF_ALG_AIO)
+		if (syscall(__NR_io_setup, ctx->aio_depth, &ctx->aio_ctx) == 0) {
+			if (args->instance == 0)
+				pr_inf("%s: aio mode applies to skcipher algorithms, "
+					"other algorithms use sync mode\n", args->name);
+			return;
+		}
+		if (args->instance == 0)
+			pr_inf("%s: io_setup failed, errno=%d (%s), using sync mode\n",
+				args->name, errno, strerror(errno));
+#else
+		if (args->instance == 0)
+			pr_inf("%s: asynchronous I/O not supported, using sync mode\n",
+				args->name);
+#endif
+		break;
+	default:
+		return;
+	}
+	ctx->mode = STRESS_AF_ALG_MODE_SYNC;
+}
+
+/*
+ *  stress_af_alg_ctx_deinit()
+ *	free resources allocated by stress_af_alg_ctx_init()
+ */
+static void stress_af_alg_ctx_deinit(stress_af_alg_ctx_t *ctx)
+{
+	if (ctx->pipefds[0] >= 0)
+		(void)close(ctx->pipefds[0]);
+	if (ctx->pipefds[1] >= 0)
+		(void)close(ctx->pipefds[1]);
+#if defined(STRESS_AF_ALG_AIO)
+	if (ctx->mode == STRESS_AF_ALG_MODE_AIO)
+		(void)syscall(__NR_io_destroy, ctx->aio_ctx);
+#endif
+}
+
+/*
+ *  stress_af_alg_splice()
+ *	zero copy len bytes of buf into the socket fd by
+ *	vmsplicing the user pages into a pipe and splicing
+ *	the pipe into the socket, SPLICE_F_MORE is set on
+ *	all but the final chunk when more is false
+ */
+static int stress_af_alg_splice(
+	const stress_af_alg_ctx_t *ctx,
+	const int fd,
+	char *buf,
+	const size_t len,
+	const bool more)
+{
+#if defined(STRESS_AF_ALG_SPLICE)
+	size_t n = len;
+
+	while (n > 0) {
+		struct iovec iov;
+		ssize_t ret;
+		size_t left;
+
+		iov.iov_base = buf;
+		iov.iov_len = n;
+		ret = vmsplice(ctx->pipefds[1], &iov, 1, 0);
+		if (ret <= 0)
+			return -1;
+		buf += ret;
+		n -= (size_t)ret;
+
+		for (left = (size_t)ret; left > 0; ) {
+			unsigned int flags = 0;
+
+#if defined(SPLICE_F_MORE)
+			if (more || (n > 0))
+				flags |= SPLICE_F_MORE;
+#endif
+			ret = splice(ctx->pipefds[0], NULL, fd, NULL, left, flags);
+			if (ret <= 0)
+				return -1;
+			left -= (size_t)ret;
+		}
+	}
+	return 0;
+#else
+	(void)ctx;
+	(void)fd;
+	(void)buf;
+	(void)len;
+	(void)more;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 static int stress_af_alg_hash(
 	stress_args_t *args,
+	const stress_af_alg_ctx_t *ctx,
 	const int sockfd,
 	stress_crypto_info_t *info)
 {
@@ -269,7 +461,21 @@ retry_bind:
 			break;
 
 		t = stress_time_now();
-		if (send(fd, input, j, 0) != (ssize_t)j) {
+		if (ctx->mode == STRESS_AF_ALG_MODE_SPLICE) {
+			if (stress_af_alg_splice(ctx, fd, input, j, false) < 0) {
+				if ((errno == 0) || (errno == ENOKEY) || (errno == ENOENT))
+					continue;
+				if (errno == EINVAL) {
+					stress_af_alg_ignore(args, info);
+					break;
+				}
+				pr_fail("%s: %s: vmsplice/splice failed: errno=%d (%s)\n",
+						args->name, info->name,
+						errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto err_close;
+			}
+		} else if (send(fd, input, j, 0) != (ssize_t)j) {
 			if ((errno == 0) || (errno == ENOKEY) || (errno == ENOENT))
 				continue;
 			if (errno == EINVAL) {
@@ -295,6 +501,7 @@ retry_bind:
 		if (delta > 0.0) {
 			info->metrics.duration += delta;
 			info->metrics.count += 1.0;
+			info->bytes += (double)j;
 		}
 		stress_bogo_inc(args);
 		if (args->max_ops && (stress_bogo_get(args) >= args->max_ops)) {
@@ -313,8 +520,200 @@ err:
 	return rc;
 }
 
+/*
+ *  stress_af_alg_cipher_cmsg()
+ *	set up the msg control data with the cipher operation op and
+ *	the Initialization Vector, a random IV is generated if new_iv
+ *	is true otherwise the IV from the previous call is reused.
+ *	Returns -1 if the control messages could not be filled in.
+ */
+static int stress_af_alg_cipher_cmsg(
+	struct msghdr *msg,
+	char *cbuf,
+	const size_t cbuf_size,
+	const __u32 op,
+	const ssize_t iv_size,
+	const bool new_iv)
+{
+	__u32 *u32ptr;
+	struct cmsghdr *cmsg;
+	struct af_alg_iv *iv;	/* Initialisation Vector */
+
+	(void)shim_memset(msg, 0, sizeof(*msg));
+	if (new_iv)
+		(void)shim_memset(cbuf, 0, cbuf_size);
+
+	msg->msg_control = cbuf;
+	msg->msg_controllen = cbuf_size;
+
+	cmsg = CMSG_FIRSTHDR(msg);
+	/* Keep static analysis happy */
+	if (!cmsg)
+		return -1;
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_OP;
+	cmsg->cmsg_len = CMSG_LEN(4);
+	u32ptr = (__u32 *)(uintptr_t)CMSG_DATA(cmsg);
+	*u32ptr = op;
+
+	cmsg = CMSG_NXTHDR(msg, cmsg);
+	if (!cmsg)
+		return -1;
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_IV;
+	cmsg->cmsg_len = CMSG_LEN(4) + CMSG_LEN(iv_size);
+	iv = (void *)CMSG_DATA(cmsg);
+	iv->ivlen = (uint32_t)iv_size;
+	if (new_iv)
+		stress_rndbuf((char *)iv->iv, (size_t)iv_size);
+
+	return 0;
+}
+
+/*
+ *  stress_af_alg_cipher_send()
+ *	send DATA_LEN bytes of buf with the control data in msg,
+ *	in splice mode only the control data is sent with sendmsg
+ *	and the data is zero copied in with vmsplice/splice
+ */
+static ssize_t stress_af_alg_cipher_send(
+	const stress_af_alg_ctx_t *ctx,
+	const int mode,
+	const int fd,
+	struct msghdr *msg,
+	char *buf)
+{
+	struct iovec iov;
+
+	if (mode == STRESS_AF_ALG_MODE_SPLICE) {
+		msg->msg_iov = NULL;
+		msg->msg_iovlen = 0;
+		if (sendmsg(fd, msg, MSG_MORE) < 0)
+			return -1;
+		if (stress_af_alg_splice(ctx, fd, buf, DATA_LEN, false) < 0)
+			return -1;
+		return DATA_LEN;
+	}
+
+	iov.iov_base = buf;
+	iov.iov_len = DATA_LEN;
+	msg->msg_iov = &iov;
+	msg->msg_iovlen = 1;
+
+	return sendmsg(fd, msg, 0);
+}
+
+/*
+ *  stress_af_alg_cipher_aio()
+ *	encrypt aio_depth * DATA_LEN bytes of input, the data is sent
+ *	in one sendmsg and read back with aio_depth asynchronous reads
+ *	that the skcipher can process concurrently
+ */
+static int stress_af_alg_cipher_aio(
+	stress_args_t *args,
+	const stress_af_alg_ctx_t *ctx,
+	const int fd,
+	stress_crypto_info_t *info,
+	struct msghdr *msg,
+	char *input,
+	char *output)
+{
+#if defined(STRESS_AF_ALG_AIO)
+	struct iocb cbs[STRESS_AF_ALG_AIO_DEPTH_MAX];
+	struct iocb *cbp[STRESS_AF_ALG_AIO_DEPTH_MAX];
+	struct io_event events[STRESS_AF_ALG_AIO_DEPTH_MAX];
+	struct iovec iov;
+	const long int depth = (long int)ctx->aio_depth;
+	long int i, done;
+	double t, delta;
+
+	iov.iov_base = input;
+	iov.iov_len = (size_t)depth * DATA_LEN;
+	msg->msg_iov = &iov;
+	msg->msg_iovlen = 1;
+
+	(void)shim_memset(cbs, 0, sizeof(cbs));
+	for (i = 0; i < depth; i++) {
+		cbs[i].aio_fildes = (uint32_t)fd;
+		cbs[i].aio_lio_opcode = IOCB_CMD_PREAD;
+		cbs[i].aio_buf = (uint64_t)(uintptr_t)(output + (i * DATA_LEN));
+		cbs[i].aio_nbytes = DATA_LEN;
+		cbp[i] = &cbs[i];
+	}
+
+	t = stress_time_now();
+	if (sendmsg(fd, msg, 0) < 0) {
+		if (errno == ENOMEM)
+			return EXIT_SUCCESS;
+		if (errno == EINVAL) {
+			stress_af_alg_ignore(args, info);
+			return EXIT_SUCCESS;
+		}
+		pr_fail("%s: %s: sendmsg failed: errno=%d (%s)\n",
+			args->name, info->name,
+			errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if ((long int)syscall(__NR_io_submit, ctx->aio_ctx, depth, cbp) != depth) {
+		if ((errno == EAGAIN) || (errno == EINTR))
+			return EXIT_SUCCESS;
+		if ((errno == EINVAL) || (errno == EOPNOTSUPP)) {
+			stress_af_alg_ignore(args, info);
+			return EXIT_SUCCESS;
+		}
+		pr_fail("%s: %s: io_submit failed: errno=%d (%s)\n",
+			args->name, info->name,
+			errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	for (done = 0; done < depth; ) {
+		long int ret;
+
+		ret = (long int)syscall(__NR_io_getevents, ctx->aio_ctx, 1, depth - done, events, NULL);
+		if (ret < 0) {
+			/* io_destroy at the end reaps any outstanding requests */
+			if (errno == EINTR)
+				return EXIT_SUCCESS;
+			pr_fail("%s: %s: io_getevents failed: errno=%d (%s)\n",
+				args->name, info->name,
+				errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < ret; i++) {
+			if (events[i].res != DATA_LEN) {
+				pr_fail("%s: %s: async read returned %lld, expected %d bytes\n",
+					args->name, info->name,
+					(long long int)events[i].res, DATA_LEN);
+				return EXIT_FAILURE;
+			}
+		}
+		done += ret;
+	}
+	delta = stress_time_now() - t;
+	if (delta > 0.0) {
+		info->metrics.duration += delta;
+		info->metrics.count += (double)depth;
+		info->bytes += (double)depth * DATA_LEN;
+	}
+	stress_bogo_inc(args);
+
+	return EXIT_SUCCESS;
+#else
+	(void)args;
+	(void)ctx;
+	(void)fd;
+	(void)info;
+	(void)msg;
+	(void)input;
+	(void)output;
+
+	return EXIT_SUCCESS;
+#endif
+}
+
 static int stress_af_alg_cipher(
 	stress_args_t *args,
+	const stress_af_alg_ctx_t *ctx,
 	const int sockfd,
 	stress_crypto_info_t *info)
 {
@@ -324,20 +723,31 @@ static int stress_af_alg_cipher(
 	const ssize_t iv_size = info->iv_size;
 	const size_t cbuf_size = CMSG_SPACE(sizeof(__u32)) +
 				  CMSG_SPACE(4) + CMSG_SPACE(iv_size);
-	char *input, *output, *cbuf;
+	/* AEAD needs the tag appended, keep it on the copying path */
+	const int mode = (info->crypto_type != CRYPTO_AEAD) ? ctx->mode : STRESS_AF_ALG_MODE_SYNC;
+	const size_t buf_len = (mode == STRESS_AF_ALG_MODE_AIO) ?
+				DATA_LEN * (size_t)ctx->aio_depth : DATA_LEN;
+	char *input, *output, *plain, *cbuf;
 	const char *salg_type = (info->crypto_type != CRYPTO_AEAD) ? "skcipher" : "aead";
 	int retries = MAX_AF_ALG_RETRIES_BIND;
 
-	input = malloc(DATA_LEN + ALLOC_SLOP);
+	input = malloc(buf_len + ALLOC_SLOP);
 	if (!input)
 		return EXIT_NO_RESOURCE;
-	output = malloc(DATA_LEN + ALLOC_SLOP);
+	output = malloc(buf_len + ALLOC_SLOP);
 	if (!output) {
 		free(input);
 		return EXIT_NO_RESOURCE;
 	}
+	plain = malloc(DATA_LEN + ALLOC_SLOP);
+	if (!plain) {
+		free(output);
+		free(input);
+		return EXIT_NO_RESOURCE;
+	}
 	cbuf = malloc(cbuf_size);
 	if (!cbuf) {
+		free(plain);
 		free(output);
 		free(input);
 		return EXIT_NO_RESOURCE;
@@ -459,57 +869,34 @@ retry_bind:
 	}
 
 	for (j = 32; j < (ssize_t)DATA_LEN; j += 32) {
-		__u32 *u32ptr;
 		struct msghdr msg;
-		struct cmsghdr *cmsg;
-		struct af_alg_iv *iv;	/* Initialisation Vector */
-		struct iovec iov;
 		double t;
 
 		if (!stress_continue(args))
 			break;
-		(void)shim_memset(&msg, 0, sizeof(msg));
-		(void)shim_memset(cbuf, 0, cbuf_size);
 
-		msg.msg_control = cbuf;
-		msg.msg_controllen = cbuf_size;
-
-		/* Chosen operation - ENCRYPT */
-		cmsg = CMSG_FIRSTHDR(&msg);
-		/* Keep static analysis happy */
-		if (!cmsg) {
+		/* Chosen operation - ENCRYPT, with a random Initialization Vector */
+		if (stress_af_alg_cipher_cmsg(&msg, cbuf, cbuf_size, ALG_OP_ENCRYPT, iv_size, true) < 0) {
 			pr_fail("%s: %s: unexpected null cmsg found\n",
 				args->name, info->name);
 			rc = EXIT_FAILURE;
 			goto err_close;
 		}
-		cmsg->cmsg_level = SOL_ALG;
-		cmsg->cmsg_type = ALG_SET_OP;
-		cmsg->cmsg_len = CMSG_LEN(4);
-		u32ptr = (__u32 *)(uintptr_t)CMSG_DATA(cmsg);
-		*u32ptr = ALG_OP_ENCRYPT;
-
-		/* Set up random Initialization Vector */
-		cmsg = CMSG_NXTHDR(&msg, cmsg);
-		if (!cmsg)
-			break;
-		cmsg->cmsg_level = SOL_ALG;
-		cmsg->cmsg_type = ALG_SET_IV;
-		cmsg->cmsg_len = CMSG_LEN(4) + CMSG_LEN(iv_size);
-		iv = (void *)CMSG_DATA(cmsg);
-		iv->ivlen = (uint32_t)iv_size;
-
-		stress_rndbuf((char *)iv->iv, (size_t)iv_size);
 
 		/* Generate random message to encrypt */
-		stress_rndbuf(input, DATA_LEN);
-		iov.iov_base = input;
-		iov.iov_len = DATA_LEN;
+		stress_rndbuf(input, buf_len);
 
-		msg.msg_iov = &iov;
-		msg.msg_iovlen = 1;
+		if (mode == STRESS_AF_ALG_MODE_AIO) {
+			rc = stress_af_alg_cipher_aio(args, ctx, fd, info, &msg, input, output);
+			if (rc != EXIT_SUCCESS)
+				goto err_close;
+			if (info->ignore)
+				break;
+			continue;
+		}
 
-		if (sendmsg(fd, &msg, 0) < 0) {
+		t = stress_time_now();
+		if (stress_af_alg_cipher_send(ctx, mode, fd, &msg, input) < 0) {
 			if (errno == ENOMEM)
 				break;
 			if (errno == EINVAL) {
@@ -532,35 +919,11 @@ retry_bind:
 			goto err_close;
 		}
 
-		/* Chosen operation - DECRYPT */
-		cmsg = CMSG_FIRSTHDR(&msg);
-		if (!cmsg)
-			break;
-		cmsg->cmsg_level = SOL_ALG;
-		cmsg->cmsg_type = ALG_SET_OP;
-		cmsg->cmsg_len = CMSG_LEN(4);
-		u32ptr = (__u32 *)(uintptr_t)CMSG_DATA(cmsg);
-		*u32ptr = ALG_OP_DECRYPT;
-
-		/* Set up random Initialization Vector */
-		cmsg = CMSG_NXTHDR(&msg, cmsg);
-		if (!cmsg)
+		/* Chosen operation - DECRYPT, reusing the same Initialization Vector */
+		if (stress_af_alg_cipher_cmsg(&msg, cbuf, cbuf_size, ALG_OP_DECRYPT, iv_size, false) < 0)
 			break;
 
-		cmsg->cmsg_level = SOL_ALG;
-		cmsg->cmsg_type = ALG_SET_IV;
-		cmsg->cmsg_len = CMSG_LEN(4) + CMSG_LEN(iv_size);
-		iv = (void *)CMSG_DATA(cmsg);
-		iv->ivlen = (uint32_t)iv_size;
-
-		iov.iov_base = output;
-		iov.iov_len = DATA_LEN;
-
-		msg.msg_iov = &iov;
-		msg.msg_iovlen = 1;
-
-		t = stress_time_now();
-		if (sendmsg(fd, &msg, 0) < 0) {
+		if (stress_af_alg_cipher_send(ctx, mode, fd, &msg, output) < 0) {
 			if (errno == ENOMEM)
 				break;
 			if (errno == EINVAL) {
@@ -573,14 +936,14 @@ retry_bind:
 			rc = EXIT_FAILURE;
 			goto err_close;
 		}
-		if (read(fd, output, DATA_LEN) != DATA_LEN) {
+		if (read(fd, plain, DATA_LEN) != DATA_LEN) {
 			pr_fail("%s: %s: read failed: errno=%d (%s)\n",
 				args->name, info->name,
 				errno, strerror(errno));
 			rc = EXIT_FAILURE;
 			goto err_close;
 		} else {
-			if (shim_memcmp(input, output, DATA_LEN)) {
+			if (shim_memcmp(input, plain, DATA_LEN)) {
 				pr_fail("%s: %s: decrypted data "
 					"different from original data "
 					"(possible kernel bug)\n",
@@ -591,6 +954,7 @@ retry_bind:
 				if (delta > 0.0) {
 					info->metrics.duration += delta;
 					info->metrics.count += 1.0;
+					info->bytes += 2.0 * (double)DATA_LEN;
 				}
 				stress_bogo_inc(args);
 			}
@@ -603,6 +967,7 @@ err_close:
 	(void)close(fd);
 err:
 	free(cbuf);
+	free(plain);
 	free(output);
 	free(input);
 
@@ -683,6 +1048,7 @@ retry_bind:
 		if (delta > 0.0) {
 			info->metrics.duration += delta;
 			info->metrics.count += 1.0;
+			info->bytes += (double)output_size;
 		}
 		stress_bogo_inc(args);
 		if (args->max_ops && (stress_bogo_get(args) >= args->max_ops)) {
@@ -814,10 +1180,19 @@ static int stress_af_alg(stress_args_t *args)
 	size_t proc_count, count, internal, idx;
 	bool af_alg_dump = false;
 	stress_crypto_info_t *info;
+	stress_af_alg_ctx_t ctx;
 
 	stress_af_alg_count_crypto(&proc_count, &internal);
 
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.mode = STRESS_AF_ALG_MODE_SYNC;
+	ctx.aio_depth = STRESS_AF_ALG_AIO_DEPTH_DEFAULT;
+	ctx.pipefds[0] = -1;
+	ctx.pipefds[1] = -1;
+
 	(void)stress_get_setting("af-alg-dump", &af_alg_dump);
+	(void)stress_get_setting("af-alg-mode", &ctx.mode);
+	(void)stress_get_setting("af-alg-aio-depth", &ctx.aio_depth);
 
 	if (af_alg_dump && (args->instance == 0)) {
 		pr_inf("%s: dumping cryptographic algorithms found in /proc/crypto to stdout\n",
@@ -871,6 +1246,8 @@ static int stress_af_alg(stress_args_t *args)
 		(void)shim_usleep(200000);
 	}
 
+	stress_af_alg_ctx_init(args, &ctx);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -881,7 +1258,7 @@ static int stress_af_alg(stress_args_t *args)
 			switch (info->crypto_type) {
 			case CRYPTO_AHASH:
 			case CRYPTO_SHASH:
-				rc = stress_af_alg_hash(args, sockfd, info);
+				rc = stress_af_alg_hash(args, &ctx, sockfd, info);
 				(void)rc;
 				break;
 #if defined(ALG_SET_AEAD_ASSOCLEN)
@@ -890,7 +1267,7 @@ static int stress_af_alg(stress_args_t *args)
 			case CRYPTO_CIPHER:
 			case CRYPTO_AKCIPHER:
 			case CRYPTO_SKCIPHER:
-				rc = stress_af_alg_cipher(args, sockfd, info);
+				rc = stress_af_alg_cipher(args, &ctx, sockfd, info);
 				(void)rc;
 				break;
 			case CRYPTO_RNG:
@@ -908,16 +1285,17 @@ static int stress_af_alg(stress_args_t *args)
 
 	for (idx = 0, info = crypto_info_list; info; info = info->next) {
 		if (info->metrics.duration > 0.0) {
-			const double rate = info->metrics.count / info->metrics.duration;
+			const double rate = info->bytes / (info->metrics.duration * MB);
 			char str[64];
 
-			(void)snprintf(str, sizeof(str), "%s (%s) ops/sec", info->name, info->type),
+			(void)snprintf(str, sizeof(str), "%s (%s) MB/sec", info->name, info->type),
 
 			stress_metrics_set(args, idx, str, rate, STRESS_HARMONIC_MEAN);
 			idx++;
 		}
 	}
 
+	stress_af_alg_ctx_deinit(&ctx);
 	rc = EXIT_SUCCESS;
 	(void)close(sockfd);
 
@@ -1022,6 +1400,7 @@ static bool stress_af_alg_add_crypto(const stress_crypto_info_t *info)
 	*ci = *info;
 	ci->metrics.duration = 0.0;
 	ci->metrics.count = 0.0;
+	ci->bytes = 0.0;
 	ci->next = crypto_info_list;
 	crypto_info_list = ci;
 
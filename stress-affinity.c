@@ -240,7 +240,7 @@ static int stress_affinity(stress_args_t *args)
 	stress_affinity_info_t *info;
 	const size_t info_sz = (sizeof(*info) + args->page_size) & ~(args->page_size - 1);
 
-	counter_lock = stress_lock_create();
+	counter_lock = stress_lock_create("affinity-counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -29,20 +29,73 @@
 #include <poll.h>
 #endif
 
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
 #define MIN_AIO_LINUX_REQUESTS		(1)
 #define MAX_AIO_LINUX_REQUESTS		(4096)
 #define DEFAULT_AIO_LINUX_REQUESTS	(64)
 
+#define MIN_AIO_LINUX_BATCH		(0)
+#define MAX_AIO_LINUX_BATCH		(MAX_AIO_LINUX_REQUESTS)
+
+#define MIN_AIO_LINUX_MIN_NR		(1)
+#define MAX_AIO_LINUX_MIN_NR		(MAX_AIO_LINUX_REQUESTS)
+#define DEFAULT_AIO_LINUX_MIN_NR	(1)
+
 #define BUFFER_SZ			(4096)
 #define DEFAULT_AIO_MAX_NR		(65536)
 
+#define AIO_RING_MAGIC			(0xa10a10a1)
+
 static const stress_help_t help[] = {
 	{ NULL,	"aiol N",	   "start N workers that exercise Linux async I/O" },
+	{ NULL,	"aiol-batch N",	   "submit I/O requests in batches of N per io_submit call" },
+	{ NULL,	"aiol-eventfd",	   "use an eventfd for I/O completion notification" },
+	{ NULL,	"aiol-min-nr N",   "reap at least N completed I/O events per io_getevents call" },
 	{ NULL,	"aiol-ops N",	   "stop after N bogo Linux aio async I/O requests" },
+	{ NULL,	"aiol-poll",	   "issue high priority I/O and busy poll for completions" },
 	{ NULL,	"aiol-requests N", "number of Linux aio async I/O requests per worker" },
 	{ NULL,	NULL,		   NULL }
 };
 
+static int stress_set_aio_linux_batch(const char *opt)
+{
+	uint32_t aio_linux_batch;
+
+	aio_linux_batch = stress_get_uint32(opt);
+	stress_check_range("aiol-batch", aio_linux_batch,
+		MIN_AIO_LINUX_BATCH, MAX_AIO_LINUX_BATCH);
+	return stress_set_setting("aiol-batch", TYPE_ID_UINT32, &aio_linux_batch);
+}
+
+static int stress_set_aio_linux_eventfd(const char *opt)
+{
+	bool aio_linux_eventfd = true;
+	(void)opt;
+
+	return stress_set_setting("aiol-eventfd", TYPE_ID_BOOL, &aio_linux_eventfd);
+}
+
+static int stress_set_aio_linux_min_nr(const char *opt)
+{
+	uint32_t aio_linux_min_nr;
+
+	aio_linux_min_nr = stress_get_uint32(opt);
+	stress_check_range("aiol-min-nr", aio_linux_min_nr,
+		MIN_AIO_LINUX_MIN_NR, MAX_AIO_LINUX_MIN_NR);
+	return stress_set_setting("aiol-min-nr", TYPE_ID_UINT32, &aio_linux_min_nr);
+}
+
+static int stress_set_aio_linux_poll(const char *opt)
+{
+	bool aio_linux_poll = true;
+	(void)opt;
+
+	return stress_set_setting("aiol-poll", TYPE_ID_BOOL, &aio_linux_poll);
+}
+
 static int stress_set_aio_linux_requests(const char *opt)
 {
 	uint32_t aio_linux_requests;
@@ -54,6 +107,10 @@ static int stress_set_aio_linux_requests(const char *opt)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_aiol_batch,	stress_set_aio_linux_batch },
+	{ OPT_aiol_eventfd,	stress_set_aio_linux_eventfd },
+	{ OPT_aiol_min_nr,	stress_set_aio_linux_min_nr },
+	{ OPT_aiol_poll,	stress_set_aio_linux_poll },
 	{ OPT_aiol_requests,	stress_set_aio_linux_requests },
 	{ 0,			NULL }
 };
@@ -67,6 +124,29 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
     defined(__NR_io_submit) &&		\
     defined(__NR_io_getevents)
 
+/* kernel aio completion ring header, mapped at the io_context_t address */
+typedef struct {
+	unsigned int id;
+	unsigned int nr;
+	unsigned int head;
+	unsigned int tail;
+	unsigned int magic;
+	unsigned int compat_features;
+	unsigned int incompat_features;
+	unsigned int header_length;
+} stress_aio_ring_t;
+
+typedef struct {
+	io_context_t ctx;	/* aio context */
+	size_t batch;		/* iocbs per io_submit, 0 = all of them */
+	uint32_t min_nr;	/* minimum events to reap per io_getevents */
+	int efd;		/* completion eventfd, -1 if not used */
+	bool poll;		/* high priority I/O, busy poll for completions */
+	uint64_t syscalls;	/* io_submit, io_getevents and eventfd reads */
+	uint64_t ios;		/* read and write I/Os completed */
+	double duration;	/* time spent submitting and reaping I/O */
+} stress_aiol_io_t;
+
 #if defined(__NR_io_cancel)
 static int shim_io_cancel(
 	io_context_t ctx_id,
@@ -190,36 +270,101 @@ static inline PURE OPTIMIZE3 bool aio_linux_check_buffer(
 	return true;
 }
 
+/*
+ *  stress_aiol_ring_empty()
+ *	peek at the kernel aio completion ring that is mapped
+ *	into user space at the context address, returns false
+ *	if the ring layout is not recognised so the caller
+ *	falls back to io_getevents
+ */
+static inline bool stress_aiol_ring_empty(const io_context_t ctx)
+{
+	const volatile stress_aio_ring_t *ring = (const volatile stress_aio_ring_t *)ctx;
+
+	if (UNLIKELY(!ring || (ring->magic != AIO_RING_MAGIC)))
+		return false;
+	return ring->head == ring->tail;
+}
+
+/*
+ *  stress_aiol_iocb_flags()
+ *	set high priority and eventfd completion flags on iocbs
+ */
+static void stress_aiol_iocb_flags(
+	const stress_aiol_io_t *io,
+	struct iocb *cbs[],
+	const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		struct iocb *cb = cbs[i];
+
+#if defined(HAVE_IOCB_AIO_RW_FLAGS) &&	\
+    defined(RWF_HIPRI)
+		if (io->poll) {
+			switch (cb->aio_lio_opcode) {
+			case IO_CMD_PREAD:
+			case IO_CMD_PWRITE:
+			case IO_CMD_PREADV:
+			case IO_CMD_PWRITEV:
+				cb->aio_rw_flags |= RWF_HIPRI;
+				break;
+			default:
+				break;
+			}
+		}
+#endif
+		if (io->efd >= 0)
+			io_set_eventfd(cb, io->efd);
+	}
+}
+
 /*
  *  stress_aiol_submit()
- *	submit async I/O requests
+ *	submit async I/O requests in batches, returns the
+ *	number of requests submitted or -1 on failure
  */
-static int stress_aiol_submit(
+static ssize_t stress_aiol_submit(
 	stress_args_t *args,
-	const io_context_t ctx,
+	stress_aiol_io_t *io,
 	struct iocb *cbs[],
 	const size_t n,
 	const bool ignore_einval)
 {
-	do {
+	size_t i = 0;
+	const double t = stress_time_now();
+
+	stress_aiol_iocb_flags(io, cbs, n);
+
+	while (i < n) {
+		const size_t batch = ((io->batch == 0) || (io->batch > n - i)) ?
+			n - i : io->batch;
 		int ret;
 
 		errno = 0;
-		ret = shim_io_submit(ctx, (long)n, cbs);
-		if (ret >= 0) {
+		io->syscalls++;
+		ret = shim_io_submit(io->ctx, (long)batch, cbs + i);
+		if (ret > 0) {
+			i += (size_t)ret;
+			continue;
+		} else if (ret == 0) {
 			break;
 		} else {
 			if ((errno == EINVAL) && ignore_einval)
-				return 0;
+				break;
 			if (errno != EAGAIN) {
 				pr_fail("%s: io_submit failed, errno=%d (%s)\n",
 					args->name, errno, strerror(errno));
-				return ret;
+				return -1;
 			}
 		}
-	} while (stress_continue(args));
+		if (!stress_continue(args))
+			break;
+	}
+	io->duration += stress_time_now() - t;
 
-	return 0;
+	return (ssize_t)i;
 }
 
 /*
@@ -228,17 +373,51 @@ static int stress_aiol_submit(
  */
 static ssize_t stress_aiol_wait(
 	stress_args_t *args,
-	const io_context_t ctx,
+	stress_aiol_io_t *io,
 	struct io_event events[],
 	const size_t n)
 {
 	size_t i = 0;
+	const double t = stress_time_now();
 
-	do {
+	while (i < n) {
 		struct timespec timeout, *timeout_ptr;
+		long min_nr = (long)(((size_t)io->min_nr > n - i) ? n - i : (size_t)io->min_nr);
 		int ret;
 
-		if (clock_gettime(CLOCK_REALTIME, &timeout) < 0) {
+		if (io->poll) {
+			/* busy poll the completion ring, no syscall until events land */
+			if (stress_aiol_ring_empty(io->ctx)) {
+				if (UNLIKELY(!stress_continue_flag()))
+					return -1;
+				continue;
+			}
+			min_nr = 0;
+			timeout.tv_sec = 0;
+			timeout.tv_nsec = 0;
+			timeout_ptr = &timeout;
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+		} else if (io->efd >= 0) {
+			uint64_t count;
+
+			/* block until the kernel signals completions on the eventfd */
+			io->syscalls++;
+			if (read(io->efd, &count, sizeof(count)) < 0) {
+				if ((errno == EINTR) && stress_continue_flag())
+					continue;
+				if (errno == EINTR)
+					return -1;
+				pr_fail("%s: eventfd read failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+			min_nr = 0;
+			timeout.tv_sec = 0;
+			timeout.tv_nsec = 0;
+			timeout_ptr = &timeout;
+#endif
+		} else if (clock_gettime(CLOCK_REALTIME, &timeout) < 0) {
 			timeout_ptr = NULL;
 		} else {
 			timeout.tv_nsec += 1000000;
@@ -249,7 +428,8 @@ static ssize_t stress_aiol_wait(
 			timeout_ptr = &timeout;
 		}
 
-		ret = shim_io_getevents_random(ctx, 1, (long)(n - i), events, timeout_ptr);
+		io->syscalls++;
+		ret = shim_io_getevents_random(io->ctx, min_nr, (long)(n - i), events + i, timeout_ptr);
 		if (ret < 0) {
 			if (errno == EINTR) {
 				if (stress_continue_flag()) {
@@ -270,7 +450,8 @@ static ssize_t stress_aiol_wait(
 			/* indicate terminated early */
 			return -1;
 		}
-	} while (i < n);
+	}
+	io->duration += stress_time_now() - t;
 
 	return (ssize_t)i;
 }
@@ -366,7 +547,11 @@ static int stress_aiol(stress_args_t *args)
 	int flags = O_DIRECT;
 	char filename[PATH_MAX];
 	char buf[1];
-	io_context_t ctx = 0;
+	stress_aiol_io_t io;
+	uint32_t aio_linux_batch = 0;
+	uint32_t aio_linux_min_nr = DEFAULT_AIO_LINUX_MIN_NR;
+	bool aio_linux_eventfd = false;
+	bool aio_linux_poll = false;
 	uint32_t aio_linux_requests = DEFAULT_AIO_LINUX_REQUESTS;
 	uint8_t *buffer;
 	struct iocb *cb;
@@ -393,6 +578,30 @@ static int stress_aiol(stress_args_t *args)
 		pr_fail("%s: iol_requests out of range", args->name);
 		return EXIT_FAILURE;
 	}
+	(void)stress_get_setting("aiol-batch", &aio_linux_batch);
+	(void)stress_get_setting("aiol-eventfd", &aio_linux_eventfd);
+	(void)stress_get_setting("aiol-min-nr", &aio_linux_min_nr);
+	(void)stress_get_setting("aiol-poll", &aio_linux_poll);
+
+	(void)shim_memset(&io, 0, sizeof(io));
+	io.batch = (size_t)aio_linux_batch;
+	io.min_nr = aio_linux_min_nr;
+	io.efd = -1;
+	io.poll = aio_linux_poll;
+
+	if (aio_linux_poll && aio_linux_eventfd) {
+		if (args->instance == 0)
+			pr_inf("%s: --aiol-poll busy polls for completions, "
+				"ignoring --aiol-eventfd option\n", args->name);
+		aio_linux_eventfd = false;
+	}
+#if !defined(HAVE_IOCB_AIO_RW_FLAGS) ||	\
+    !defined(RWF_HIPRI)
+	if (aio_linux_poll && (args->instance == 0))
+		pr_inf("%s: RWF_HIPRI iocb flag not supported, "
+			"--aiol-poll will just busy poll for completions\n",
+			args->name);
+#endif
 
 	if (stress_system_read("/proc/sys/fs/aio-max-nr", buf, sizeof(buf)) > 0) {
 		if (sscanf(buf, "%" SCNu32, &aio_max_nr) != 1) {
@@ -424,11 +633,11 @@ static int stress_aiol(stress_args_t *args)
 	 * Exercise invalid io_setup syscall
 	 * on invalid(zero) nr_events
 	 */
-	ret = shim_io_setup(0, &ctx);
+	ret = shim_io_setup(0, &io.ctx);
 	if (ret >= 0)
-		(void)shim_io_destroy(ctx);
+		(void)shim_io_destroy(io.ctx);
 
-	ret = shim_io_setup(aio_linux_requests, &ctx);
+	ret = shim_io_setup(aio_linux_requests, &io.ctx);
 	if (ret < 0) {
 		/*
 		 *  The libaio interface returns -errno in the
@@ -504,6 +713,21 @@ retry_open:
 	}
 	(void)shim_unlink(filename);
 
+	if (aio_linux_eventfd) {
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+		io.efd = eventfd(0, 0);
+		if ((io.efd < 0) && (args->instance == 0))
+			pr_inf("%s: eventfd failed, errno=%d (%s), "
+				"disabling --aiol-eventfd option\n",
+				args->name, errno, strerror(errno));
+#else
+		if (args->instance == 0)
+			pr_inf("%s: eventfd not supported, "
+				"disabling --aiol-eventfd option\n", args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -527,10 +751,13 @@ retry_open:
 			cb[i].u.c.nbytes = BUFFER_SZ;
 			cbs[i] = &cb[i];
 		}
-		if (stress_aiol_submit(args, ctx, cbs, aio_linux_requests, false) < 0)
+		n = stress_aiol_submit(args, &io, cbs, aio_linux_requests, false);
+		if (n < 0)
 			break;
-		if (stress_aiol_wait(args, ctx, events, aio_linux_requests) < 0)
+		n = stress_aiol_wait(args, &io, events, (size_t)n);
+		if (n < 0)
 			break;
+		io.ios += (uint64_t)n;
 		stress_bogo_inc(args);
 		if (!stress_continue(args))
 			break;
@@ -550,12 +777,13 @@ retry_open:
 			cbs[i] = &cb[i];
 		}
 
-		if (stress_aiol_submit(args, ctx, cbs, aio_linux_requests, false) < 0)
+		n = stress_aiol_submit(args, &io, cbs, aio_linux_requests, false);
+		if (n < 0)
 			break;
-
-		n = stress_aiol_wait(args, ctx, events, aio_linux_requests);
+		n = stress_aiol_wait(args, &io, events, (size_t)n);
 		if (n < 0)
 			break;
+		io.ios += (uint64_t)n;
 
 		for (i = 0; i < (size_t)n; i++) {
 			uint8_t pattern;
@@ -595,10 +823,13 @@ retry_open:
 			cb[i].u.c.nbytes = 1;
 			cbs[i] = &cb[i];
 		}
-		if (stress_aiol_submit(args, ctx, cbs, aio_linux_requests, false) < 0)
+		n = stress_aiol_submit(args, &io, cbs, aio_linux_requests, false);
+		if (n < 0)
 			break;
-		if (stress_aiol_wait(args, ctx, events, aio_linux_requests) < 0)
+		n = stress_aiol_wait(args, &io, events, (size_t)n);
+		if (n < 0)
 			break;
+		io.ios += (uint64_t)n;
 		stress_bogo_inc(args);
 		if (!stress_continue(args))
 			break;
@@ -622,10 +853,13 @@ retry_open:
 			cb[i].u.c.nbytes = 1;
 			cbs[i] = &cb[i];
 		}
-		if (stress_aiol_submit(args, ctx, cbs, aio_linux_requests, false) < 0)
+		n = stress_aiol_submit(args, &io, cbs, aio_linux_requests, false);
+		if (n < 0)
 			break;
-		if (stress_aiol_wait(args, ctx, events, aio_linux_requests) < 0)
+		n = stress_aiol_wait(args, &io, events, (size_t)n);
+		if (n < 0)
 			break;
+		io.ios += (uint64_t)n;
 		stress_bogo_inc(args);
 		if (!stress_continue(args))
 			break;
@@ -644,7 +878,7 @@ retry_open:
 
 				cancel = 0;
 
-				VOID_RET(int, shim_io_cancel(ctx, &cb[0], &event));
+				VOID_RET(int, shim_io_cancel(io.ctx, &cb[0], &event));
 
 				/* Exercise with io_cancel invalid context */
 				(void)shim_memset(&bad_ctx, stress_mwc8() | 0x1, sizeof(bad_ctx));
@@ -657,7 +891,7 @@ retry_open:
 				bad_iocb.u.c.buf = NULL;
 				bad_iocb.u.c.offset = 0;
 				bad_iocb.u.c.nbytes = 0;
-				VOID_RET(int, shim_io_cancel(ctx, &bad_iocb, &event));
+				VOID_RET(int, shim_io_cancel(io.ctx, &bad_iocb, &event));
 
 				/* Exercise io_destroy with illegal context, EINVAL */
 				VOID_RET(int, shim_io_destroy(bad_ctx));
@@ -671,18 +905,18 @@ retry_open:
 				/* Exercise io_getevents with illegal min */
 				timeout.tv_sec = 0;
 				timeout.tv_nsec = 100000;
-				VOID_RET(int, shim_io_getevents(ctx, 1, 0, events, &timeout));
-				VOID_RET(int, shim_io_getevents(ctx, -1, 0, events, &timeout));
+				VOID_RET(int, shim_io_getevents(io.ctx, 1, 0, events, &timeout));
+				VOID_RET(int, shim_io_getevents(io.ctx, -1, 0, events, &timeout));
 
 				/* Exercise io_getevents with illegal nr */
 				timeout.tv_sec = 0;
 				timeout.tv_nsec = 100000;
-				VOID_RET(int, shim_io_getevents(ctx, 0, -1, events, &timeout));
+				VOID_RET(int, shim_io_getevents(io.ctx, 0, -1, events, &timeout));
 
 				/* Exercise io_getevents with illegal timeout */
 				timeout.tv_sec = 0;
 				timeout.tv_nsec = ~0L;
-				VOID_RET(int, shim_io_getevents(ctx, 0, 1, events, &timeout));
+				VOID_RET(int, shim_io_getevents(io.ctx, 0, 1, events, &timeout));
 
 				/* Exercise io_setup with illegal nr_events */
 				ret = shim_io_setup(0, &bad_ctx);
@@ -703,11 +937,11 @@ retry_open:
 				VOID_RET(int, shim_io_submit(bad_ctx, 1, bad_iocbs));
 
 				/* Exercise io_submit with useless or illegal nr ios */
-				VOID_RET(int, shim_io_submit(ctx, 0, bad_iocbs));
-				VOID_RET(int, shim_io_submit(ctx, -1, bad_iocbs));
+				VOID_RET(int, shim_io_submit(io.ctx, 0, bad_iocbs));
+				VOID_RET(int, shim_io_submit(io.ctx, -1, bad_iocbs));
 
 				/* Exercise io_submit with illegal iocb */
-				VOID_RET(int, shim_io_submit(ctx, 1, bad_iocbs));
+				VOID_RET(int, shim_io_submit(io.ctx, 1, bad_iocbs));
 			}
 		}
 #else
@@ -731,10 +965,11 @@ retry_open:
 			(void)shim_memset(&cb[i].u.c.nbytes, 0xff, sizeof(cb[i].u.c.nbytes));
 			cbs[i] = &cb[i];
 		}
-		if (stress_aiol_submit(args, ctx, cbs, aio_linux_requests, true) < 0)
+		n = stress_aiol_submit(args, &io, cbs, aio_linux_requests, true);
+		if (n < 0)
 			break;
-		if (errno == 0)
-			(void)stress_aiol_wait(args, ctx, events, aio_linux_requests);
+		if (n > 0)
+			(void)stress_aiol_wait(args, &io, events, (size_t)n);
 		stress_bogo_inc(args);
 		if (!stress_continue(args))
 			break;
@@ -758,9 +993,8 @@ retry_open:
 				cb[0].u.c.offset = 0;
 				cb[0].u.c.nbytes = 0;
 				cbs[0] = &cb[0];
-				(void)stress_aiol_submit(args, ctx, cbs, 1, true);
-				if (errno == 0) {
-					(void)stress_aiol_wait(args, ctx, events, 1);
+				if (stress_aiol_submit(args, &io, cbs, 1, true) > 0) {
+					(void)stress_aiol_wait(args, &io, events, 1);
 				} else {
 					/* Don't try again */
 					do_sync = false;
@@ -772,7 +1006,16 @@ retry_open:
 
 	rc = EXIT_SUCCESS;
 
+	stress_metrics_set(args, 0, "I/Os per sec",
+		(io.duration > 0.0) ? (double)io.ios / io.duration : 0.0,
+		STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "syscalls per I/O",
+		(io.ios > 0) ? (double)io.syscalls / (double)io.ios : 0.0,
+		STRESS_GEOMETRIC_MEAN);
+
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (io.efd >= 0)
+		(void)close(io.efd);
 	(void)close(fds[0]);
 	for (i = 1; i < aio_linux_requests; i++) {
 		if (fds[i] != fds[0])
@@ -780,7 +1023,7 @@ retry_open:
 	}
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	(void)shim_io_destroy(ctx);
+	(void)shim_io_destroy(io.ctx);
 	(void)stress_temp_dir_rm_args(args);
 
 free_memory:
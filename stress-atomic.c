@@ -18,7 +18,13 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-pthread.h"
+
+#if defined(HAVE_SYS_AUXV_H)
+#include <sys/auxv.h>
+#endif
 
 #define STRESS_ATOMIC_STRINGIZE(x)	#x
 
@@ -267,9 +273,20 @@ do {									\
 static const stress_help_t help[] = {
 	{ NULL,	"atomic",	"start N workers exercising GCC atomic operations" },
 	{ NULL, "atomic-ops",	"stop after N bogo atomic bogo operations" },
+	{ NULL, "atomic-sweep",	"measure atomic op cost over thread counts and placements" },
 	{ NULL, NULL,		NULL }
 };
 
+static int stress_set_atomic_sweep(const char *opt)
+{
+	return stress_set_setting_true("atomic-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_atomic_sweep,	stress_set_atomic_sweep },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_ATOMIC_OPS)
 
 #if defined(__sh__)
@@ -385,6 +402,551 @@ static int stress_atomic_exercise(
 	return 0;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_FETCH_ADD_8) &&		\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define STRESS_ATOMIC_SWEEP
+#endif
+
+#if defined(STRESS_ATOMIC_SWEEP)
+
+#define STRESS_ATOMIC_SWEEP_MAX_THREADS	(64)
+#define STRESS_ATOMIC_SWEEP_BLOCK	(1024)	/* ops between stop checks */
+#define STRESS_ATOMIC_SWEEP_PAGE	(4096)	/* separate lines stride */
+
+/* n atomic operations on a 64 bit word */
+typedef void (*stress_atomic_sweep_func_t)(uint64_t *ptr, const size_t n);
+
+/* an implementation of the atomic operations */
+typedef struct {
+	const char *name;
+	stress_atomic_sweep_func_t cas;		/* compare and swap increment loop */
+	stress_atomic_sweep_func_t fetch_add;	/* fetch and add */
+	stress_atomic_sweep_func_t exchange;	/* exchange */
+	bool (*supported)(void);
+} stress_atomic_sweep_impl_t;
+
+/* where each thread's word is placed */
+typedef struct {
+	const char *name;
+	size_t (*offset)(const uint32_t thread);
+} stress_atomic_sweep_placement_t;
+
+typedef struct {
+	pthread_t pthread;
+	stress_atomic_sweep_func_t func;
+	uint64_t *ptr;
+	const bool *start;
+	const bool *stop;
+	uint64_t ops;
+	double duration;
+	int ret;
+} stress_atomic_sweep_thread_t;
+
+static void OPTIMIZE3 stress_atomic_builtin_cas(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t expected = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+
+		while (!__atomic_compare_exchange_n(ptr, &expected, expected + 1, false,
+						    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			;
+	}
+}
+
+static void OPTIMIZE3 stress_atomic_builtin_fetch_add(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		(void)__atomic_fetch_add(ptr, 1, __ATOMIC_SEQ_CST);
+}
+
+static void OPTIMIZE3 stress_atomic_builtin_exchange(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		(void)__atomic_exchange_n(ptr, (uint64_t)i, __ATOMIC_SEQ_CST);
+}
+
+/*
+ *  stress_atomic_load_store()
+ *	non-atomic read-modify-write as a baseline, separately
+ *	atomic load and store so updates can be lost
+ */
+static void OPTIMIZE3 stress_atomic_load_store(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		const uint64_t val = __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+
+		__atomic_store_n(ptr, val + 1, __ATOMIC_RELEASE);
+	}
+}
+
+static bool stress_atomic_always_supported(void)
+{
+	return true;
+}
+
+#if defined(__aarch64__)
+/*
+ *  Arm load-exclusive/store-exclusive loops, these are the
+ *  pre-LSE atomics compilers use without -moutline-atomics
+ *  or -march=armv8.1-a
+ */
+static void OPTIMIZE3 stress_atomic_llsc_cas(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t expected, old;
+		uint32_t status;
+
+		do {
+			expected = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+			__asm__ __volatile__(
+				"1:	ldaxr	%0, [%2]\n"
+				"	cmp	%0, %3\n"
+				"	b.ne	2f\n"
+				"	stlxr	%w1, %4, [%2]\n"
+				"	cbnz	%w1, 1b\n"
+				"2:\n"
+				: "=&r"(old), "=&r"(status)
+				: "r"(ptr), "r"(expected), "r"(expected + 1)
+				: "cc", "memory");
+		} while (old != expected);
+	}
+}
+
+static void OPTIMIZE3 stress_atomic_llsc_fetch_add(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t val;
+		uint32_t status;
+
+		__asm__ __volatile__(
+			"1:	ldaxr	%0, [%2]\n"
+			"	add	%0, %0, #1\n"
+			"	stlxr	%w1, %0, [%2]\n"
+			"	cbnz	%w1, 1b\n"
+			: "=&r"(val), "=&r"(status)
+			: "r"(ptr)
+			: "memory");
+	}
+}
+
+static void OPTIMIZE3 stress_atomic_llsc_exchange(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t old;
+		uint32_t status;
+
+		__asm__ __volatile__(
+			"1:	ldaxr	%0, [%3]\n"
+			"	stlxr	%w1, %2, [%3]\n"
+			"	cbnz	%w1, 1b\n"
+			: "=&r"(old), "=&r"(status)
+			: "r"((uint64_t)i), "r"(ptr)
+			: "memory");
+	}
+}
+
+/*
+ *  Arm v8.1 large system extension single instruction atomics
+ */
+static void OPTIMIZE3 stress_atomic_lse_cas(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t expected, old;
+
+		do {
+			expected = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+			old = expected;
+			__asm__ __volatile__(
+				".arch_extension lse\n"
+				"	casal	%0, %2, [%1]\n"
+				: "+r"(old)
+				: "r"(ptr), "r"(expected + 1)
+				: "memory");
+		} while (old != expected);
+	}
+}
+
+static void OPTIMIZE3 stress_atomic_lse_fetch_add(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t old;
+
+		__asm__ __volatile__(
+			".arch_extension lse\n"
+			"	ldaddal	%1, %0, [%2]\n"
+			: "=r"(old)
+			: "r"((uint64_t)1), "r"(ptr)
+			: "memory");
+	}
+}
+
+static void OPTIMIZE3 stress_atomic_lse_exchange(uint64_t *ptr, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		uint64_t old;
+
+		__asm__ __volatile__(
+			".arch_extension lse\n"
+			"	swpal	%1, %0, [%2]\n"
+			: "=r"(old)
+			: "r"((uint64_t)i), "r"(ptr)
+			: "memory");
+	}
+}
+
+/*
+ *  stress_atomic_lse_supported()
+ *	the hwcap atomics bit indicates LSE support
+ */
+static bool stress_atomic_lse_supported(void)
+{
+#if defined(HAVE_GETAUXVAL) &&	\
+    defined(AT_HWCAP)
+	return !!(getauxval(AT_HWCAP) & (1UL << 8));	/* HWCAP_ATOMICS */
+#else
+	return false;
+#endif
+}
+#endif
+
+static const stress_atomic_sweep_impl_t stress_atomic_sweep_impls[] = {
+	{ "builtin",	stress_atomic_builtin_cas, stress_atomic_builtin_fetch_add,
+			stress_atomic_builtin_exchange, stress_atomic_always_supported },
+#if defined(__aarch64__)
+	{ "llsc",	stress_atomic_llsc_cas, stress_atomic_llsc_fetch_add,
+			stress_atomic_llsc_exchange, stress_atomic_always_supported },
+	{ "lse",	stress_atomic_lse_cas, stress_atomic_lse_fetch_add,
+			stress_atomic_lse_exchange, stress_atomic_lse_supported },
+#endif
+};
+
+static size_t stress_atomic_offset_same_word(const uint32_t thread)
+{
+	(void)thread;
+
+	return 0;
+}
+
+static size_t stress_atomic_offset_same_line(const uint32_t thread)
+{
+	return (size_t)(thread & 7) * sizeof(uint64_t);
+}
+
+static size_t stress_atomic_offset_adjacent_lines(const uint32_t thread)
+{
+	return (size_t)thread * 64;
+}
+
+static size_t stress_atomic_offset_separate_lines(const uint32_t thread)
+{
+	return (size_t)thread * STRESS_ATOMIC_SWEEP_PAGE;
+}
+
+static const stress_atomic_sweep_placement_t stress_atomic_sweep_placements[] = {
+	{ "same-word",	stress_atomic_offset_same_word },
+	{ "same-line",	stress_atomic_offset_same_line },
+	{ "adjacent",	stress_atomic_offset_adjacent_lines },
+	{ "separate",	stress_atomic_offset_separate_lines },
+};
+
+static const char * const stress_atomic_sweep_op_names[] = {
+	"cas",
+	"fetch-add",
+	"exchange",
+	"load-store",
+};
+
+/*
+ *  stress_atomic_sweep_func()
+ *	the function of operation op of an implementation
+ */
+static stress_atomic_sweep_func_t stress_atomic_sweep_func(
+	const stress_atomic_sweep_impl_t *impl,
+	const size_t op)
+{
+	switch (op) {
+	case 0:
+		return impl->cas;
+	case 1:
+		return impl->fetch_add;
+	case 2:
+		return impl->exchange;
+	default:
+		return stress_atomic_load_store;
+	}
+}
+
+static void *stress_atomic_sweep_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_atomic_sweep_thread_t *t = (stress_atomic_sweep_thread_t *)arg;
+	double t_start;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!__atomic_load_n(t->start, __ATOMIC_ACQUIRE))
+		(void)shim_sched_yield();
+
+	t_start = stress_time_now();
+	while (!__atomic_load_n(t->stop, __ATOMIC_RELAXED)) {
+		t->func(t->ptr, STRESS_ATOMIC_SWEEP_BLOCK);
+		t->ops += STRESS_ATOMIC_SWEEP_BLOCK;
+	}
+	t->duration = stress_time_now() - t_start;
+
+	return &nowt;
+}
+
+/*
+ *  stress_atomic_sweep_pass()
+ *	run n_threads threads on an operation and placement for
+ *	duration seconds, returns the mean ns per op per thread,
+ *	0.0 if no threads could be created, -1.0 on a lost update
+ */
+static double stress_atomic_sweep_pass(
+	stress_args_t *args,
+	uint8_t *buf,
+	stress_atomic_sweep_thread_t *threads,
+	const stress_atomic_sweep_impl_t *impl,
+	const size_t op,
+	const stress_atomic_sweep_placement_t *placement,
+	const uint32_t n_threads,
+	const double duration,
+	double *ops_rate)
+{
+	const stress_atomic_sweep_func_t func = stress_atomic_sweep_func(impl, op);
+	bool start = false, stop = false;
+	uint32_t i, n_created = 0;
+	uint64_t ops = 0, sum = 0;
+	double t_start, ns = 0.0, secs = 0.0;
+
+	for (i = 0; i < n_threads; i++)
+		*(uint64_t *)(buf + placement->offset(i)) = 0;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_atomic_sweep_thread_t *t = &threads[i];
+
+		(void)shim_memset(t, 0, sizeof(*t));
+		t->func = func;
+		t->ptr = (uint64_t *)(buf + placement->offset(i));
+		t->start = &start;
+		t->stop = &stop;
+		t->ret = pthread_create(&t->pthread, NULL, stress_atomic_sweep_thread, t);
+		if (t->ret)
+			break;
+		n_created++;
+	}
+	if (n_created == 0)
+		return 0.0;
+
+	t_start = stress_time_now();
+	__atomic_store_n(&start, true, __ATOMIC_RELEASE);
+	while (stress_continue_flag() && ((stress_time_now() - t_start) < duration))
+		(void)shim_usleep(10000);
+	__atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < n_created; i++) {
+		const stress_atomic_sweep_thread_t *t = &threads[i];
+
+		(void)pthread_join(t->pthread, NULL);
+		ops += t->ops;
+		secs += t->duration;
+		if (t->ops > 0)
+			ns += STRESS_DBL_NANOSECOND * t->duration / (double)t->ops;
+	}
+	*ops_rate = (secs > 0.0) ? (double)ops * (double)n_created / secs : 0.0;
+	stress_bogo_add(args, ops / STRESS_ATOMIC_SWEEP_BLOCK);
+
+	/* compare and swap and fetch and add increments must not lose updates */
+	if (op <= 1) {
+		for (i = 0; i < n_created; i++) {
+			const size_t offset = placement->offset(i);
+			uint32_t j;
+
+			/* sum each distinct word once */
+			for (j = 0; j < i; j++) {
+				if (placement->offset(j) == offset)
+					break;
+			}
+			if (j == i)
+				sum += *(uint64_t *)(buf + offset);
+		}
+		if (sum != ops) {
+			pr_fail("%s: %s %s %s increments lost updates, got %" PRIu64
+				", expected %" PRIu64 "\n", args->name, impl->name,
+				stress_atomic_sweep_op_names[op], placement->name, sum, ops);
+			return -1.0;
+		}
+	}
+	return ns / (double)n_created;
+}
+
+/*
+ *  stress_atomic_sweep()
+ *	measure the ns per operation of the atomic operations over
+ *	doubling thread counts and word placements
+ */
+static int stress_atomic_sweep(stress_args_t *args)
+{
+	typedef struct {
+		size_t impl;
+		size_t op;
+		size_t placement;
+		uint32_t threads;
+		double ns;		/* sum of ns per op of the passes */
+		double rate;		/* sum of ops per sec of the passes */
+		uint32_t passes;
+	} stress_atomic_sweep_result_t;
+
+	const int32_t cpus = stress_get_processors_online();
+	const uint32_t max_threads = (uint32_t)STRESS_MINIMUM(STRESS_MAXIMUM(cpus, 2),
+						STRESS_ATOMIC_SWEEP_MAX_THREADS);
+	const size_t buf_sz = (STRESS_ATOMIC_SWEEP_MAX_THREADS + 1) * STRESS_ATOMIC_SWEEP_PAGE;
+	stress_atomic_sweep_thread_t *threads;
+	stress_atomic_sweep_result_t *results, *result;
+	size_t i, j, k, n_results = 0, idx = 0, metric = 0;
+	uint32_t n;
+	uint8_t *buf;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	results = (stress_atomic_sweep_result_t *)calloc(SIZEOF_ARRAY(stress_atomic_sweep_impls) *
+		SIZEOF_ARRAY(stress_atomic_sweep_op_names) *
+		SIZEOF_ARRAY(stress_atomic_sweep_placements) * 8, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	threads = (stress_atomic_sweep_thread_t *)calloc(max_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " threads, skipping stressor\n",
+			args->name, max_threads);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)stress_mmap_populate(NULL, buf_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, buf_sz, errno, strerror(errno));
+		free(threads);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_atomic_sweep_impls); i++) {
+		if (!stress_atomic_sweep_impls[i].supported()) {
+			if (args->instance == 0)
+				pr_inf("%s: %s atomics not supported, skipping them\n",
+					args->name, stress_atomic_sweep_impls[i].name);
+			continue;
+		}
+		for (j = 0; j < SIZEOF_ARRAY(stress_atomic_sweep_op_names); j++) {
+			/* load-store does not depend on the implementation */
+			if ((j == 3) && (i > 0))
+				continue;
+			for (k = 0; k < SIZEOF_ARRAY(stress_atomic_sweep_placements); k++) {
+				for (n = 1; ; n = STRESS_MINIMUM(n * 2, max_threads)) {
+					result = &results[n_results++];
+					result->impl = i;
+					result->op = j;
+					result->placement = k;
+					result->threads = n;
+					if (n == max_threads)
+						break;
+				}
+			}
+		}
+	}
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		double ns, rate = 0.0;
+
+		result = &results[idx];
+		ns = stress_atomic_sweep_pass(args, buf, threads,
+			&stress_atomic_sweep_impls[result->impl], result->op,
+			&stress_atomic_sweep_placements[result->placement],
+			result->threads, slice, &rate);
+		if (ns < 0.0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if (ns > 0.0) {
+			result->ns += ns;
+			result->rate += rate;
+			result->passes++;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-8s %-10s %-10s %7s %10s %12s\n", args->name,
+			"impl", "op", "placement", "threads", "ns per op", "M ops/sec");
+	for (i = 0; i < n_results; i++) {
+		const char *impl_name, *op_name, *placement_name;
+		double ns, rate;
+
+		result = &results[i];
+		if (result->passes == 0)
+			continue;
+		impl_name = stress_atomic_sweep_impls[result->impl].name;
+		op_name = stress_atomic_sweep_op_names[result->op];
+		placement_name = stress_atomic_sweep_placements[result->placement].name;
+		ns = result->ns / (double)result->passes;
+		rate = result->rate / (double)result->passes;
+		if (args->instance == 0)
+			pr_inf("%s: %-8s %-10s %-10s %7" PRIu32 " %10.2f %12.3f\n",
+				args->name, impl_name, op_name, placement_name,
+				result->threads, ns, rate / 1000000.0);
+		/* metrics for the most contended thread count */
+		if ((result->threads == max_threads) && (metric < STRESS_STRESSOR_METRICS_MAX)) {
+			char str[64];
+
+			(void)snprintf(str, sizeof(str), "%s %s %s %" PRIu32 " threads ns per op",
+				impl_name, op_name, placement_name, result->threads);
+			stress_metrics_set(args, metric++, str, ns, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+	(void)munmap((void *)buf, buf_sz);
+	free(threads);
+	free(results);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_atomic()
  *      stress gcc atomic memory ops
@@ -395,6 +957,19 @@ static int stress_atomic(stress_args_t *args)
 	stress_atomic_info_t *atomic_info;
 	const size_t n_atomic_procs = STRESS_ATOMIC_MAX_PROCS + 1;
 	int rc = EXIT_SUCCESS;
+	bool atomic_sweep = false;
+
+	(void)stress_get_setting("atomic-sweep", &atomic_sweep);
+	if (atomic_sweep) {
+#if defined(STRESS_ATOMIC_SWEEP)
+		return stress_atomic_sweep(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: atomic-sweep requires pthreads and 64 bit atomics, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 
 	atomic_info_sz = sizeof(*atomic_info) * n_atomic_procs;
 	atomic_info = (stress_atomic_info_t *)stress_mmap_populate(NULL,
@@ -476,6 +1051,7 @@ static int stress_atomic(stress_args_t *args)
 stressor_info_t stress_atomic_info = {
 	.stressor = stress_atomic,
 	.class = CLASS_CPU | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -484,6 +1060,7 @@ stressor_info_t stress_atomic_info = {
 stressor_info_t stress_atomic_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without gcc __atomic builtin functions"
@@ -43,12 +43,32 @@
 #define STRESS_BIGHEAP_WRITE_HEAP_FULL	(7)
 #define STRESS_BIGHEAP_READ_VERIFY_END	(8)
 #define STRESS_BIGHEAP_READ_VERIFY_FULL	(9)
-#define STRESS_BIGHEAP_FINISHED		(10)
+#define STRESS_BIGHEAP_POPULATE		(10)
+#define STRESS_BIGHEAP_FINISHED		(11)
+
+#define STRESS_BIGHEAP_METHOD_TOUCH		(0)
+#define STRESS_BIGHEAP_METHOD_MAP_POPULATE	(1)
+#define STRESS_BIGHEAP_METHOD_POPULATE_WRITE	(2)
+#define STRESS_BIGHEAP_METHOD_HUGEPAGE		(3)
+#define STRESS_BIGHEAP_METHOD_ALL		(4)
+#define STRESS_BIGHEAP_METHODS			(STRESS_BIGHEAP_METHOD_ALL)
+
+#define STRESS_BIGHEAP_SAMPLES		(4096)	/* per page latency samples per method */
+#define STRESS_BIGHEAP_ALL_STEPS	(256)	/* growth steps per method in all mode */
+
+typedef struct {
+	double	latency[STRESS_BIGHEAP_SAMPLES];	/* reservoir of ns per page samples */
+	uint64_t samples;				/* total number of samples seen */
+	double	pages;					/* total pages grown */
+	double	duration;				/* total grow and touch time */
+	bool	unsupported;				/* method failed at run time */
+} stress_bigheap_stats_t;
 
 static const stress_help_t help[] = {
 	{ "B N","bigheap N",		"start N workers that grow the heap using realloc()" },
 	{ NULL,	"bigheap-bytes N",	"grow heap up to N bytes in total" },
 	{ NULL,	"bigheap-growth N",	"grow heap by N bytes per iteration" },
+	{ NULL,	"bigheap-method M",	"select page population method: touch, map-populate, populate-write, hugepage or all" },
 	{ NULL,	"bigheap-mlock",	"attempt to mlock newly mapped pages" },
 	{ NULL,	"bigheap-ops N",	"stop after N bogo bigheap operations" },
 	{ NULL,	NULL,			NULL }
@@ -59,6 +79,15 @@ static volatile int phase;
 static volatile void *fault_addr;
 static volatile int signo;
 static volatile int sigcode;
+static stress_bigheap_stats_t bigheap_stats[STRESS_BIGHEAP_METHODS];
+
+static const char * const bigheap_methods[] = {
+	"touch",
+	"map-populate",
+	"populate-write",
+	"hugepage",
+	"all",
+};
 
 /*
  *  stress_bigheap_phase()
@@ -77,6 +106,7 @@ static const char *stress_bigheap_phase(void)
 		"write full",
 		"read verify end",
 		"read verify full",
+		"populate",
 		"finished"
 	};
 
@@ -122,6 +152,230 @@ static int stress_set_bigheap_growth(const char *opt)
 	return stress_set_setting("bigheap-growth", TYPE_ID_UINT64, &bigheap_growth);
 }
 
+/*
+ *  stress_set_bigheap_method()
+ *	set the method used to populate newly grown heap pages
+ */
+static int stress_set_bigheap_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(bigheap_methods); i++) {
+		if (!strcmp(bigheap_methods[i], opt))
+			return stress_set_setting("bigheap-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "bigheap-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(bigheap_methods); i++)
+		(void)fprintf(stderr, " %s", bigheap_methods[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_bigheap_alloc()
+ *	grow the heap from old_size to size bytes. The map-populate
+ *	method manages its own mapping with mremap and populates the
+ *	newly grown tail with a MAP_POPULATE mapping, all other methods
+ *	use realloc so the C library decides how the heap grows.
+ */
+static void *stress_bigheap_alloc(
+	const size_t method,
+	void *old_ptr,
+	const size_t old_size,
+	const size_t size)
+{
+#if defined(MAP_POPULATE) &&	\
+    defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_MAYMOVE) &&	\
+    defined(MAP_FIXED)
+	if (method == STRESS_BIGHEAP_METHOD_MAP_POPULATE) {
+		uint8_t *ptr;
+
+		if (!old_ptr) {
+			ptr = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+			return (ptr == MAP_FAILED) ? NULL : ptr;
+		}
+		ptr = (uint8_t *)mremap(old_ptr, old_size, size, MREMAP_MAYMOVE);
+		if (ptr == MAP_FAILED)
+			return NULL;
+		/* replace the unpopulated tail with a pre-faulted mapping */
+		(void)mmap((void *)(ptr + old_size), size - old_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_FIXED, -1, 0);
+		return ptr;
+	}
+#else
+	(void)old_size;
+#endif
+	(void)method;
+
+	return old_ptr ? realloc(old_ptr, size) : malloc(size);
+}
+
+/*
+ *  stress_bigheap_free()
+ *	free a heap allocated by stress_bigheap_alloc()
+ */
+static void stress_bigheap_free(const size_t method, void *ptr, const size_t size)
+{
+	if (!ptr)
+		return;
+#if defined(MAP_POPULATE) &&	\
+    defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_MAYMOVE) &&	\
+    defined(MAP_FIXED)
+	if (method == STRESS_BIGHEAP_METHOD_MAP_POPULATE) {
+		(void)munmap(ptr, size);
+		return;
+	}
+#endif
+	(void)method;
+	(void)size;
+
+	free(ptr);
+}
+
+/*
+ *  stress_bigheap_populate()
+ *	apply the madvise populate method to the page aligned
+ *	part of the newly grown region start..end
+ */
+static void stress_bigheap_populate(
+	stress_args_t *args,
+	const size_t method,
+	uint8_t *start,
+	uint8_t *end)
+{
+	const uintptr_t mask = ~((uintptr_t)args->page_size - 1);
+	const uintptr_t addr = ((uintptr_t)start + args->page_size - 1) & mask;
+	const uintptr_t addr_end = (uintptr_t)end & mask;
+	int advice;
+
+	if (addr >= addr_end)
+		return;
+
+	switch (method) {
+#if defined(MADV_POPULATE_WRITE)
+	case STRESS_BIGHEAP_METHOD_POPULATE_WRITE:
+		advice = MADV_POPULATE_WRITE;
+		break;
+#endif
+#if defined(MADV_HUGEPAGE)
+	case STRESS_BIGHEAP_METHOD_HUGEPAGE:
+		advice = MADV_HUGEPAGE;
+		break;
+#endif
+	case STRESS_BIGHEAP_METHOD_MAP_POPULATE:
+#if defined(MAP_POPULATE) &&	\
+    defined(HAVE_MREMAP) &&	\
+    defined(MREMAP_MAYMOVE) &&	\
+    defined(MAP_FIXED)
+		return;
+#endif
+	default:
+		/* plain touch or method not available at build time */
+		if ((method == STRESS_BIGHEAP_METHOD_TOUCH) || (method >= STRESS_BIGHEAP_METHODS))
+			return;
+		if (!bigheap_stats[method].unsupported) {
+			bigheap_stats[method].unsupported = true;
+			if (args->instance == 0)
+				pr_inf("%s: method %s not supported, falling back to touching pages\n",
+					args->name, bigheap_methods[method]);
+		}
+		return;
+	}
+
+	if ((madvise((void *)addr, (size_t)(addr_end - addr), advice) < 0) &&
+	    !bigheap_stats[method].unsupported) {
+		bigheap_stats[method].unsupported = true;
+		if (args->instance == 0)
+			pr_inf("%s: method %s madvise failed, errno=%d (%s), falling back to touching pages\n",
+				args->name, bigheap_methods[method], errno, strerror(errno));
+	}
+}
+
+/*
+ *  stress_bigheap_stats_add()
+ *	account a grow and touch step of pages pages taking
+ *	duration seconds, keeping a reservoir sample of the
+ *	per page latency
+ */
+static void stress_bigheap_stats_add(
+	const size_t method,
+	const double duration,
+	const double pages)
+{
+	stress_bigheap_stats_t *stats = &bigheap_stats[method];
+	const double ns = (duration * STRESS_DBL_NANOSECOND) / pages;
+
+	if (stats->samples < STRESS_BIGHEAP_SAMPLES) {
+		stats->latency[stats->samples] = ns;
+	} else {
+		const uint64_t i = (uint64_t)stress_mwc32modn((uint32_t)STRESS_MINIMUM(stats->samples + 1, UINT32_MAX));
+
+		if (i < STRESS_BIGHEAP_SAMPLES)
+			stats->latency[i] = ns;
+	}
+	stats->samples++;
+	stats->pages += pages;
+	stats->duration += duration;
+}
+
+static int stress_bigheap_cmp(const void *p1, const void *p2)
+{
+	const double d1 = *(const double *)p1;
+	const double d2 = *(const double *)p2;
+
+	if (d1 < d2)
+		return -1;
+	else if (d1 > d2)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_bigheap_report()
+ *	report per page grow and touch latency percentiles
+ *	for each method that was exercised
+ */
+static void stress_bigheap_report(stress_args_t *args)
+{
+	size_t method, idx = 1;
+	bool header = false;
+
+	for (method = 0; method < STRESS_BIGHEAP_METHODS; method++) {
+		stress_bigheap_stats_t *stats = &bigheap_stats[method];
+		const size_t n = (size_t)STRESS_MINIMUM(stats->samples, STRESS_BIGHEAP_SAMPLES);
+		double p50, p99, rate;
+		char msg[64];
+
+		if (n == 0)
+			continue;
+		qsort(stats->latency, n, sizeof(*stats->latency), stress_bigheap_cmp);
+		p50 = stats->latency[(n * 50) / 100];
+		p99 = stats->latency[(n * 99) / 100];
+		rate = (stats->duration > 0.0) ?
+			(stats->pages * (double)args->page_size) / (stats->duration * (double)MB) : 0.0;
+
+		if (args->instance == 0) {
+			if (!header) {
+				pr_inf("%s: %-15s %10s %12s %12s %10s\n", args->name,
+					"method", "steps", "p50 ns/page", "p99 ns/page", "MB/sec");
+				header = true;
+			}
+			pr_inf("%s: %-15s %10" PRIu64 " %12.1f %12.1f %10.1f%s\n", args->name,
+				bigheap_methods[method], stats->samples, p50, p99, rate,
+				stats->unsupported ? " (touch fallback)" : "");
+		}
+		(void)snprintf(msg, sizeof(msg), "%s ns per page p50", bigheap_methods[method]);
+		stress_metrics_set(args, idx++, msg, p50, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s ns per page p99", bigheap_methods[method]);
+		stress_metrics_set(args, idx++, msg, p99, STRESS_GEOMETRIC_MEAN);
+	}
+}
+
 /*
  *  stress_bigheap_segvhandler()
  *	SEGV handler
@@ -159,6 +413,10 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 	NOCLOBBER size_t size = 0;
 	NOCLOBBER double duration = 0.0, count = 0.0;
 	NOCLOBBER bool segv_reported = false;
+	NOCLOBBER size_t method = STRESS_BIGHEAP_METHOD_TOUCH;
+	NOCLOBBER size_t heap_method = STRESS_BIGHEAP_METHOD_TOUCH;
+	NOCLOBBER uint64_t steps = 0;
+	size_t bigheap_method = STRESS_BIGHEAP_METHOD_TOUCH;
 	const size_t page_size = args->page_size;
 	const size_t stride = page_size;
 	double rate;
@@ -177,6 +435,7 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 
 	(void)stress_get_setting("bigheap-mlock", &bigheap_mlock);
 	(void)stress_get_setting("bigheap-bytes", &bigheap_bytes);
+	(void)stress_get_setting("bigheap-method", &bigheap_method);
 	if (!stress_get_setting("bigheap-growth", &bigheap_growth)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			bigheap_growth = MAX_BIGHEAP_GROWTH;
@@ -189,6 +448,11 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 	/* Round growth size to nearest page size */
 	bigheap_growth &= ~(page_size - 1);
 
+	(void)shim_memset(bigheap_stats, 0, sizeof(bigheap_stats));
+	method = (bigheap_method == STRESS_BIGHEAP_METHOD_ALL) ?
+		STRESS_BIGHEAP_METHOD_TOUCH : bigheap_method;
+	heap_method = method;
+
 	(void)shim_memset(&action, 0, sizeof action);
 	(void)sigemptyset(&action.sa_mask);
 #if defined(SA_SIGINFO)
@@ -229,6 +493,7 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 
 	do {
 		void *old_ptr = ptr;
+		const size_t old_size = size;
 		double t;
 
 		/*
@@ -242,38 +507,46 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 			goto finish;
 
 		phase = STRESS_BIGHEAP_LOWMEM_CHECK;
-		/* Low memory avoidance, re-start */
+		/*
+		 *  Low memory avoidance or all methods mode switching
+		 *  to the next method, re-start
+		 */
 		if ((size > bigheap_bytes) ||
-		    (oom_avoid && stress_low_memory((size_t)bigheap_growth))) {
-			free(old_ptr);
+		    (oom_avoid && stress_low_memory((size_t)bigheap_growth)) ||
+		    ((bigheap_method == STRESS_BIGHEAP_METHOD_ALL) && (steps >= STRESS_BIGHEAP_ALL_STEPS))) {
+			stress_bigheap_free(heap_method, old_ptr, size);
 #if defined(HAVE_MALLOC_TRIM)
 			phase = STRESS_BIGHEAP_MALLOC_TRIM;
 			(void)malloc_trim(0);
 #endif
 			old_ptr = NULL;
+			ptr = NULL;
+			last_ptr = NULL;
 			size = 0;
+			if ((bigheap_method == STRESS_BIGHEAP_METHOD_ALL) && (steps >= STRESS_BIGHEAP_ALL_STEPS)) {
+				method = (method + 1) % STRESS_BIGHEAP_METHODS;
+				steps = 0;
+			}
 		}
+		if (!old_ptr)
+			heap_method = method;
 		size += (size_t)bigheap_growth;
 
 		t = stress_time_now();
-		if (old_ptr) {
-			phase = STRESS_BIGHEAP_REALLOC;
-			ptr = realloc(old_ptr, size);
-		} else {
-			phase = STRESS_BIGHEAP_MALLOC;
-			ptr = malloc(size);
-		}
+		phase = old_ptr ? STRESS_BIGHEAP_REALLOC : STRESS_BIGHEAP_MALLOC;
+		ptr = stress_bigheap_alloc(heap_method, old_ptr, old_ptr ? old_size : 0, size);
 		if (ptr == NULL) {
 			phase = STRESS_BIGHEAP_OUT_OF_MEMORY;
 			pr_dbg("%s: out of memory at %" PRIu64
 				" MB (instance %d)\n",
 				args->name, (uint64_t)(4096ULL * size) >> 20,
 				args->instance);
-			if (old_ptr)
-				free(old_ptr);
+			stress_bigheap_free(heap_method, old_ptr, old_size);
+			last_ptr = NULL;
 			size = 0;
 		} else {
-			uintptr_t *uintptr, *uintptr_end = (uintptr_t *)((uint8_t*)ptr + size);
+			uintptr_t *uintptr, *uintptr_start, *uintptr_end = (uintptr_t *)((uint8_t*)ptr + size);
+			double t_step;
 
 			duration += stress_time_now() - t;
 			count += 1.0;
@@ -289,12 +562,25 @@ static int stress_bigheap_child(stress_args_t *args, void *context)
 				uintptr = (uintptr_t *)ptr;
 				*uintptr = (uintptr_t)uintptr;
 			}
+			uintptr_start = uintptr;
+			if (heap_method != STRESS_BIGHEAP_METHOD_TOUCH) {
+				phase = STRESS_BIGHEAP_POPULATE;
+				stress_bigheap_populate(args, heap_method,
+					(uint8_t *)uintptr, (uint8_t *)uintptr_end);
+			}
 			while (uintptr < uintptr_end) {
 				if (!stress_continue(args))
 					goto finish;
 				*uintptr = (uintptr_t)uintptr;
 				uintptr += stride / sizeof(uintptr_t);
 			}
+			t_step = stress_time_now() - t;
+			if (uintptr_end > uintptr_start) {
+				const double pages = (double)((uint8_t *)uintptr_end - (uint8_t *)uintptr_start) / (double)page_size;
+
+				stress_bigheap_stats_add(heap_method, t_step, pages);
+			}
+			steps++;
 
 			if (verify) {
 				if (last_ptr == ptr) {
@@ -326,8 +612,9 @@ finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	rate = (duration > 0.0) ? count / duration : 0.0;
 	stress_metrics_set(args, 0, "realloc calls per sec", rate, STRESS_HARMONIC_MEAN);
+	stress_bigheap_report(args);
 
-	free(ptr);
+	stress_bigheap_free(heap_method, ptr, size);
 
 	return EXIT_SUCCESS;
 }
@@ -344,6 +631,7 @@ static int stress_bigheap(stress_args_t *args)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_bigheap_bytes,	stress_set_bigheap_bytes },
 	{ OPT_bigheap_growth,	stress_set_bigheap_growth },
+	{ OPT_bigheap_method,	stress_set_bigheap_method },
 	{ OPT_bigheap_mlock,	stress_set_bigheap_mlock },
 	{ 0,			NULL },
 };
@@ -25,6 +25,7 @@
 
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
+static stress_sort_dist_stats_t dist_stats[STRESS_SORT_DIST_MAX];
 static uint64_t bitonic_count;
 
 static const stress_help_t help[] = {
@@ -176,16 +177,19 @@ static int OPTIMIZE3 stress_bitonicsort(stress_args_t *args)
 
 	do {
 		double t;
+		size_t dist;
 
-		stress_sort_data_int32_shuffle(data, n);
+		dist = stress_sort_data_int32_dist(data, n, stress_bogo_get(args));
 
 		/* Sort "random" data */
 		bitonic_count = 0;
 		t = stress_time_now();
 		bitonicsort32_fwd(data, n);
-		duration += stress_time_now() - t;
+		t = stress_time_now() - t;
+		duration += t;
 		count += (double)bitonic_count;
 		sorted += (double)n;
+		stress_sort_dist_stats_add(dist_stats, dist, (double)bitonic_count, n, t);
 
 		if (UNLIKELY(verify)) {
 			register size_t i;
@@ -263,6 +267,7 @@ tidy:
 		rate, STRESS_HARMONIC_MEAN);
 	stress_metrics_set(args, 1, "bitonicsort comparisons per item",
 		count / sorted, STRESS_HARMONIC_MEAN);
+	stress_sort_dist_metrics(args, 4, "bitonicsort", dist_stats, true);
 
 	free(data);
 
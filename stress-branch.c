@@ -19,16 +19,65 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-builtin.h"
+#include "core-perf.h"
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
 
 static const stress_help_t help[] = {
 	{ NULL,	"branch N",	"start N workers that force branch misprediction" },
 	{ NULL,	"branch-ops N",	"stop after N branch misprediction branches" },
+	{ NULL,	"branch-sweep",	"sweep number of branch sites and pattern entropy" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_branch_sweep(const char *opt)
+{
+	return stress_set_setting_true("branch-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_branch_sweep,	stress_set_branch_sweep },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LABEL_AS_VALUE) &&		\
     !defined(HAVE_COMPILER_PCC)
 
+#define STRESS_BRANCH_SITES_MAX		(1024)
+#define STRESS_BRANCH_SITES_SHIFT	(10)
+#define STRESS_BRANCH_STEP_JUMPS	(1ULL << 20)
+#define STRESS_BRANCH_STEPS_MAX		(64)
+
+/*
+ *  Each branch site n jumps forward to site n + 1 + r where r is
+ *  a random value of entropy_bits bits, modulo the number of sites
+ *  in use. Zero entropy bits gives a fixed target per site, the
+ *  maximum entropy bits gives a completely random target.
+ */
+typedef struct {
+	uint32_t sites;			/* number of branch sites, power of 2 */
+	uint32_t entropy_bits;		/* random bits per branch target */
+	uint64_t jumps;			/* branches executed */
+	uint64_t misses;		/* branch misses, perf counter */
+	double duration;		/* time taken executing branches */
+} stress_branch_step_t;
+
+typedef struct {
+	stress_branch_step_t steps[STRESS_BRANCH_STEPS_MAX];
+	size_t n_steps;			/* number of sweep steps */
+	size_t step;			/* current step */
+	uint64_t jumps_start;		/* jumps at start of current step */
+	uint64_t misses_start;		/* branch misses at start of step */
+	double t_start;			/* time at start of current step */
+	uint32_t sites_mask;		/* current step branch sites mask */
+	uint32_t entropy_mask;		/* current step random bits mask */
+	int perf_fd;			/* branch misses perf fd, -1 if none */
+	bool misses_valid;		/* true if branch misses were counted */
+} stress_branch_sweep_t;
+
 #define RESEED_JMP(n)					\
 {							\
 	register const void *label;			\
@@ -36,8 +85,9 @@ static const stress_help_t help[] = {
 	/* count every 64th branch label */		\
 	if ((n & 0x3f) == 0)				\
 		counters[n >> 6]++;			\
+	jumps++;					\
 	seed = (a * seed + c);				\
-	idx = (seed >> 22);				\
+	idx = ((n) + 1 + ((seed >> 22) & entropy_mask)) & sites_mask; \
 	label = label_next;				\
 	label_next = labels[idx];			\
 	goto *label;					\
@@ -45,6 +95,153 @@ static const stress_help_t help[] = {
 
 #define J(n) L ## n:	RESEED_JMP(n)
 
+/*
+ *  stress_branch_sweep_init()
+ *	populate the sweep steps, the number of sites is doubled
+ *	from 2 to 1024 and for each the entropy bits are stepped
+ *	from fully predictable to completely random
+ */
+static void stress_branch_sweep_init(stress_branch_sweep_t *sweep)
+{
+	static const uint32_t entropy_bits[] = { 0, 1, 2, 4, 8 };
+	uint32_t shift;
+
+	(void)shim_memset(sweep, 0, sizeof(*sweep));
+	for (shift = 1; shift <= STRESS_BRANCH_SITES_SHIFT; shift++) {
+		size_t i;
+
+		for (i = 0; i < SIZEOF_ARRAY(entropy_bits); i++) {
+			if (entropy_bits[i] >= shift)
+				break;
+			sweep->steps[sweep->n_steps].sites = 1U << shift;
+			sweep->steps[sweep->n_steps].entropy_bits = entropy_bits[i];
+			sweep->n_steps++;
+		}
+		sweep->steps[sweep->n_steps].sites = 1U << shift;
+		sweep->steps[sweep->n_steps].entropy_bits = shift;
+		sweep->n_steps++;
+	}
+#if defined(STRESS_PERF_STATS)
+	sweep->perf_fd = stress_perf_hw_open(PERF_COUNT_HW_BRANCH_MISSES);
+#else
+	sweep->perf_fd = -1;
+#endif
+	sweep->misses_valid = (sweep->perf_fd >= 0);
+	sweep->sites_mask = sweep->steps[0].sites - 1;
+	sweep->entropy_mask = (1U << sweep->steps[0].entropy_bits) - 1;
+}
+
+/*
+ *  stress_branch_sweep_misses()
+ *	read branch misses, zero if not available
+ */
+static uint64_t stress_branch_sweep_misses(stress_branch_sweep_t *sweep)
+{
+#if defined(STRESS_PERF_STATS)
+	if (sweep->misses_valid) {
+		const uint64_t misses = stress_perf_hw_read(sweep->perf_fd);
+
+		if (misses != STRESS_PERF_INVALID)
+			return misses;
+		sweep->misses_valid = false;
+	}
+#else
+	(void)sweep;
+#endif
+	return 0;
+}
+
+/*
+ *  stress_branch_sweep_begin()
+ *	start accounting for the current sweep step
+ */
+static void stress_branch_sweep_begin(stress_branch_sweep_t *sweep, const uint64_t jumps)
+{
+	sweep->jumps_start = jumps;
+	sweep->misses_start = stress_branch_sweep_misses(sweep);
+	sweep->t_start = stress_time_now();
+}
+
+/*
+ *  stress_branch_sweep_end()
+ *	account for the current sweep step
+ */
+static void stress_branch_sweep_end(stress_branch_sweep_t *sweep, const uint64_t jumps)
+{
+	const double t_end = stress_time_now();
+	const uint64_t misses = stress_branch_sweep_misses(sweep);
+	stress_branch_step_t *step = &sweep->steps[sweep->step];
+
+	step->duration += t_end - sweep->t_start;
+	step->jumps += jumps - sweep->jumps_start;
+	step->misses += misses - sweep->misses_start;
+}
+
+/*
+ *  stress_branch_sweep_next()
+ *	end the current sweep step and start the next one,
+ *	returns the jump count at which the next step ends
+ */
+static uint64_t NOINLINE stress_branch_sweep_next(
+	stress_branch_sweep_t *sweep,
+	const uint64_t jumps)
+{
+	const stress_branch_step_t *step;
+
+	stress_branch_sweep_end(sweep, jumps);
+	sweep->step++;
+	if (sweep->step >= sweep->n_steps)
+		sweep->step = 0;
+	step = &sweep->steps[sweep->step];
+	sweep->sites_mask = step->sites - 1;
+	sweep->entropy_mask = (1U << step->entropy_bits) - 1;
+	stress_branch_sweep_begin(sweep, jumps);
+
+	return jumps + STRESS_BRANCH_STEP_JUMPS;
+}
+
+/*
+ *  stress_branch_sweep_metrics()
+ *	dump the sweep table (instance 0 only) and set the
+ *	predictable and random ns per branch metrics
+ */
+static void stress_branch_sweep_metrics(stress_args_t *args, stress_branch_sweep_t *sweep)
+{
+	size_t i, idx = 0;
+
+	if (args->instance == 0) {
+		pr_inf("%s: %6s %8s %10s %10s\n", args->name,
+			"sites", "entropy", "ns/branch", "miss %");
+	}
+	for (i = 0; i < sweep->n_steps; i++) {
+		const stress_branch_step_t *step = &sweep->steps[i];
+		const double ns = (step->jumps > 0) ?
+			STRESS_DBL_NANOSECOND * step->duration / (double)step->jumps : 0.0;
+		const double miss_pc = (step->jumps > 0) ?
+			100.0 * (double)step->misses / (double)step->jumps : 0.0;
+		char desc[64];
+
+		if (args->instance == 0) {
+			if (sweep->misses_valid) {
+				pr_inf("%s: %6" PRIu32 " %8" PRIu32 " %10.3f %10.2f\n", args->name,
+					step->sites, step->entropy_bits, ns, miss_pc);
+			} else {
+				pr_inf("%s: %6" PRIu32 " %8" PRIu32 " %10.3f %10s\n", args->name,
+					step->sites, step->entropy_bits, ns, "n/a");
+			}
+		}
+		if (step->entropy_bits == 0) {
+			(void)snprintf(desc, sizeof(desc), "ns per branch, %" PRIu32 " sites, predictable", step->sites);
+			stress_metrics_set(args, idx++, desc, ns, STRESS_HARMONIC_MEAN);
+		} else if ((1U << step->entropy_bits) == step->sites) {
+			(void)snprintf(desc, sizeof(desc), "ns per branch, %" PRIu32 " sites, random", step->sites);
+			stress_metrics_set(args, idx++, desc, ns, STRESS_HARMONIC_MEAN);
+		}
+	}
+	if (sweep->perf_fd >= 0)
+		(void)close(sweep->perf_fd);
+}
+
 /*
  *  stress_branch()
  *	stress instruction branch prediction
@@ -202,16 +399,36 @@ static int OPTIMIZE3 stress_branch(stress_args_t *args)
 	};
 
 	static uint64_t counters[SIZEOF_ARRAY(labels) >> 6] ALIGNED(64);
+	static stress_branch_sweep_t sweep;
 	register size_t i;
 	register uint32_t const a = 16843009;
 	register uint32_t const c = 826366247;
 	register uint32_t seed = 123456789;
 	register uint32_t idx = (seed >> 22);
 	register const void *label_next = labels[idx];
+	register uint32_t sites_mask = STRESS_BRANCH_SITES_MAX - 1;
+	register uint32_t entropy_mask = STRESS_BRANCH_SITES_MAX - 1;
+	register uint64_t jumps = 0;
+	uint64_t jumps_next = ~0ULL;
+	bool branch_sweep = false;
+
+	(void)stress_get_setting("branch-sweep", &branch_sweep);
 
 	for (i = 0; i < SIZEOF_ARRAY(counters); i++)
 		counters[i] = 0ULL;
 
+	if (branch_sweep) {
+		stress_branch_sweep_init(&sweep);
+		sites_mask = sweep.sites_mask;
+		entropy_mask = sweep.entropy_mask;
+		label_next = labels[1];
+		if ((args->instance == 0) && !sweep.misses_valid)
+			pr_inf("%s: branch-misses perf counter not available, "
+				"mispredict rate will not be reported\n", args->name);
+		stress_branch_sweep_begin(&sweep, jumps);
+		jumps_next = STRESS_BRANCH_STEP_JUMPS;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	for (;;) {
@@ -223,6 +440,11 @@ L0x000:
 #endif
 		if (!stress_continue(args))
 			break;
+		if (UNLIKELY(jumps >= jumps_next)) {
+			jumps_next = stress_branch_sweep_next(&sweep, jumps);
+			sites_mask = sweep.sites_mask;
+			entropy_mask = sweep.entropy_mask;
+		}
 		RESEED_JMP(0x000)
 
 			 J(0x001) J(0x002) J(0x003) J(0x004) J(0x005) J(0x006) J(0x007)
@@ -371,6 +593,16 @@ L0x000:
 	}
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	if (branch_sweep) {
+		/*
+		 *  sites above the current sweep step are not visited
+		 *  so the per label execution counts are not comparable
+		 */
+		stress_branch_sweep_end(&sweep, jumps);
+		stress_branch_sweep_metrics(args, &sweep);
+		return rc;
+	}
+
 	bogo_counter = stress_bogo_get(args);
 	bogo_thresh = bogo_counter / 10;
 	lo = bogo_counter - bogo_thresh;
@@ -400,6 +632,7 @@ stressor_info_t stress_branch_info = {
 	.stressor = stress_branch,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
@@ -407,6 +640,7 @@ stressor_info_t stress_branch_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without compiler support gcc style 'labels as values' feature"
 };
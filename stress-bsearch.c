@@ -18,8 +18,11 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-cpu-cache.h"
 #include "core-shim.h"
 #include "core-sort.h"
+#include "core-vecmath.h"
 
 #if defined(HAVE_SEARCH_H)
 #include <search.h>
@@ -28,20 +31,43 @@
 typedef void * (*bsearch_func_t)(const void *key, const void *base, size_t nmemb, size_t size,
 			       int (*compare)(const void *p1, const void *p2));
 
+typedef const int32_t * (*bsearch_int32_func_t)(const int32_t key, const int32_t *base, const size_t n);
+typedef void (*bsearch_layout_func_t)(int32_t *layout, const int32_t *data, const size_t n);
+
 typedef struct {
 	const char *name;
-	const bsearch_func_t bsearch_func;
+	const bsearch_func_t bsearch_func;	/* comparator search of the sorted data */
+	const bsearch_int32_func_t int32_func;	/* int32_t search of the data or its layout */
+	const bsearch_layout_func_t layout_func; /* lays out the sorted data, NULL if none */
 } stress_bsearch_method_t;
 
+typedef struct {
+	double duration;			/* time spent searching */
+	double lookups;				/* searches */
+	double compares;			/* comparator calls */
+} stress_bsearch_stats_t;
+
+typedef struct {
+	const char *boundary;			/* cache boundary being probed */
+	size_t n;				/* number of items */
+	stress_bsearch_stats_t stats;		/* search stats for this size */
+} stress_bsearch_sweep_t;
+
 #define MIN_BSEARCH_SIZE	(1 * KB)
 #define MAX_BSEARCH_SIZE	(4 * MB)
 #define DEFAULT_BSEARCH_SIZE	(64 * KB)
 
+#define MAX_BSEARCH_SWEEP	(7)	/* L1..L3 fit and spill + DRAM */
+
+#define STREE_B			(16)	/* keys per 64 byte S-tree node */
+#define STREE_CHILD(k, i)	(((k) * (STREE_B + 1)) + (i) + 1)
+
 static const stress_help_t help[] = {
 	{ NULL,	"bsearch N",	  	"start N workers that exercise a binary search" },
-	{ NULL,	"bsearch-method M",	"select bsearch method [ bsearch-libc | bsearch-nonlibc ]" },
+	{ NULL,	"bsearch-method M",	"select bsearch method [ bsearch-libc | bsearch-nonlibc | branchless | eytzinger | kary-simd ]" },
 	{ NULL,	"bsearch-ops N",  	"stop after N binary search bogo operations" },
 	{ NULL,	"bsearch-size N", 	"number of 32 bit integers to bsearch" },
+	{ NULL,	"bsearch-sweep",	"sweep array sizes across the cache levels" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -59,6 +85,11 @@ static int stress_set_bsearch_size(const char *opt)
 	return stress_set_setting("bsearch-size", TYPE_ID_UINT64, &bsearch_size);
 }
 
+static int stress_set_bsearch_sweep(const char *opt)
+{
+	return stress_set_setting_true("bsearch-sweep", opt);
+}
+
 static void OPTIMIZE3 * bsearch_nonlibc(
 	const void *key,
 	const void *base,
@@ -85,11 +116,168 @@ static void OPTIMIZE3 * bsearch_nonlibc(
 	return NULL;
 }
 
+/*
+ *  bsearch_branchless()
+ *	lower bound search where the compare selects the next
+ *	base with a conditional move rather than a branch
+ */
+static const int32_t * OPTIMIZE3 bsearch_branchless(
+	const int32_t key,
+	const int32_t *base,
+	const size_t n)
+{
+	register size_t len = n;
+
+	while (len > 1) {
+		register const size_t half = len >> 1;
+
+		base += (base[half - 1] < key) ? half : 0;
+		len -= half;
+	}
+	return (*base == key) ? base : NULL;
+}
+
+/*
+ *  bsearch_eytzinger_fill()
+ *	copy sorted data into breadth first (Eytzinger) order,
+ *	node k has children 2k and 2k + 1, index 0 is unused
+ */
+static size_t OPTIMIZE3 bsearch_eytzinger_fill(
+	int32_t *layout,
+	const int32_t *data,
+	size_t i,
+	const size_t k,
+	const size_t n)
+{
+	if (k <= n) {
+		i = bsearch_eytzinger_fill(layout, data, i, 2 * k, n);
+		layout[k] = data[i++];
+		i = bsearch_eytzinger_fill(layout, data, i, (2 * k) + 1, n);
+	}
+	return i;
+}
+
+static void bsearch_eytzinger_layout(int32_t *layout, const int32_t *data, const size_t n)
+{
+	layout[0] = 0;
+	(void)bsearch_eytzinger_fill(layout, data, 0, 1, n);
+}
+
+/*
+ *  bsearch_eytzinger()
+ *	branch free descent of the Eytzinger layout, prefetching
+ *	the 16 great great grandchildren that share a cache line
+ */
+static const int32_t * OPTIMIZE3 bsearch_eytzinger(
+	const int32_t key,
+	const int32_t *layout,
+	const size_t n)
+{
+	register size_t k = 1;
+
+	while (k <= n) {
+		shim_builtin_prefetch(layout + (k * 16));
+		k = (2 * k) + (layout[k] < key);
+	}
+	/* strip the right turns and the final left turn */
+	while (k & 1)
+		k >>= 1;
+	k >>= 1;
+	return ((k > 0) && (layout[k] == key)) ? &layout[k] : NULL;
+}
+
+/*
+ *  bsearch_stree_fill()
+ *	copy sorted data into an implicit static B-tree (S-tree)
+ *	of 16 key nodes, node k has 17 children from STREE_CHILD(k, 0),
+ *	unused keys are padded with INT32_MAX
+ */
+static size_t OPTIMIZE3 bsearch_stree_fill(
+	int32_t *layout,
+	const int32_t *data,
+	size_t t,
+	const size_t k,
+	const size_t n_nodes,
+	const size_t n)
+{
+	if (k < n_nodes) {
+		size_t i;
+
+		for (i = 0; i < STREE_B; i++) {
+			t = bsearch_stree_fill(layout, data, t, STREE_CHILD(k, i), n_nodes, n);
+			layout[(k * STREE_B) + i] = (t < n) ? data[t++] : INT32_MAX;
+		}
+		t = bsearch_stree_fill(layout, data, t, STREE_CHILD(k, STREE_B), n_nodes, n);
+	}
+	return t;
+}
+
+static void bsearch_stree_layout(int32_t *layout, const int32_t *data, const size_t n)
+{
+	const size_t n_nodes = (n + STREE_B - 1) / STREE_B;
+
+	(void)bsearch_stree_fill(layout, data, 0, 0, n_nodes, n);
+}
+
+/*
+ *  bsearch_stree_rank()
+ *	number of keys in a 16 key node less than key, compared
+ *	four at a time with 128 bit vectors where available
+ */
+static inline uint32_t OPTIMIZE3 bsearch_stree_rank(const int32_t *node, const int32_t key)
+{
+#if defined(HAVE_VECMATH)
+	typedef int32_t stress_vint32_t __attribute__ ((vector_size (16)));
+
+	const stress_vint32_t vkey = { key, key, key, key };
+	const stress_vint32_t *v = (const stress_vint32_t *)node;
+	/* true lanes are -1 */
+	const stress_vint32_t sum = (v[0] < vkey) + (v[1] < vkey) +
+				    (v[2] < vkey) + (v[3] < vkey);
+
+	return (uint32_t)-(sum[0] + sum[1] + sum[2] + sum[3]);
+#else
+	register uint32_t i, rank = 0;
+
+	for (i = 0; i < STREE_B; i++)
+		rank += (node[i] < key);
+	return rank;
+#endif
+}
+
+/*
+ *  bsearch_kary_simd()
+ *	17-ary search of the S-tree, each level is one cache line
+ *	compared against the key in a few vector operations
+ */
+static const int32_t * OPTIMIZE3 bsearch_kary_simd(
+	const int32_t key,
+	const int32_t *layout,
+	const size_t n)
+{
+	const size_t n_nodes = (n + STREE_B - 1) / STREE_B;
+	register const int32_t *result = NULL;
+	register size_t k = 0;
+
+	while (k < n_nodes) {
+		const int32_t *node = layout + (k * STREE_B);
+		const uint32_t i = bsearch_stree_rank(node, key);
+
+		if (i < STREE_B)
+			result = &node[i];
+		k = STREE_CHILD(k, i);
+	}
+	return (result && (*result == key)) ? result : NULL;
+}
+
 static const stress_bsearch_method_t stress_bsearch_methods[] = {
 #if defined(HAVE_BSEARCH)
-	{ "bsearch-libc",	bsearch },
+	{ "bsearch-libc",	bsearch,		NULL,			NULL },
 #endif
-	{ "bsearch-nonlibc",	bsearch_nonlibc },
+	{ "bsearch-nonlibc",	bsearch_nonlibc,	NULL,			NULL },
+	{ "branchless",		NULL,			bsearch_branchless,	NULL },
+	{ "eytzinger",		NULL,			bsearch_eytzinger,	bsearch_eytzinger_layout },
+	{ "kary-simd",		NULL,			bsearch_kary_simd,	bsearch_stree_layout },
 };
 
 static int stress_set_bsearch_method(const char *opt)
@@ -111,20 +299,120 @@ static int stress_set_bsearch_method(const char *opt)
 	return -1;
 }
 
+/*
+ *  stress_bsearch_sweep_sizes()
+ *	fill in the array sizes that fit in half and spill to twice
+ *	each cache level and 4 times the largest cache for DRAM,
+ *	returns number of sizes
+ */
+static size_t stress_bsearch_sweep_sizes(stress_bsearch_sweep_t *sweep)
+{
+	static const char * const fit[] = { "L1 fit", "L2 fit", "L3 fit" };
+	static const char * const spill[] = { "L1 spill", "L2 spill", "L3 spill" };
+	size_t level, n_sweep = 0, largest = 0, i;
+	double ws[MAX_BSEARCH_SWEEP];
+
+	for (level = 1; level <= 3; level++) {
+		size_t cache_size, cache_line_size;
+
+		stress_cpu_cache_get_level_size((uint16_t)level, &cache_size, &cache_line_size);
+		if (cache_size == 0)
+			continue;
+		largest = cache_size;
+		sweep[n_sweep].boundary = fit[level - 1];
+		ws[n_sweep++] = (double)cache_size / 2.0;
+		sweep[n_sweep].boundary = spill[level - 1];
+		ws[n_sweep++] = (double)cache_size * 2.0;
+	}
+	if (largest == 0)
+		largest = 8 * MB;
+	sweep[n_sweep].boundary = "DRAM";
+	ws[n_sweep++] = (double)largest * 4.0;
+
+	for (i = 0; i < n_sweep; i++) {
+		size_t n = (size_t)(ws[i] / (double)sizeof(int32_t));
+
+		n = STRESS_MAXIMUM(n, MIN_BSEARCH_SIZE);
+		n = STRESS_MINIMUM(n, MAX_BSEARCH_SIZE);
+		sweep[i].n = n;
+	}
+
+	/* sizes may clamp to the same value, drop duplicates */
+	for (i = 1, level = 1; i < n_sweep; i++) {
+		if (sweep[i].n != sweep[level - 1].n)
+			sweep[level++] = sweep[i];
+	}
+	return level;
+}
+
+/*
+ *  stress_bsearch_iter()
+ *	fill data with n sorted items, lay it out if the method
+ *	needs to and search for every item
+ */
+static void OPTIMIZE3 stress_bsearch_iter(
+	stress_args_t *args,
+	const stress_bsearch_method_t *method,
+	int32_t *data,
+	int32_t *layout,
+	const size_t n,
+	stress_bsearch_stats_t *stats)
+{
+	const bsearch_func_t bsearch_func = method->bsearch_func;
+	const bsearch_int32_func_t int32_func = method->int32_func;
+	const int32_t *base = data;
+	int32_t *ptr;
+	size_t i;
+	double t;
+
+	stress_sort_data_int32_init(data, n);
+	if (method->layout_func) {
+		method->layout_func(layout, data, n);
+		base = layout;
+	}
+	stress_sort_compare_reset();
+	t = stress_time_now();
+	for (ptr = data, i = 0; i < n; i++, ptr++) {
+		const int32_t *result;
+
+		if (bsearch_func)
+			result = bsearch_func(ptr, data, n, sizeof(*ptr), stress_sort_cmp_fwd_int32);
+		else
+			result = int32_func(*ptr, base, n);
+		if (g_opt_flags & OPT_FLAGS_VERIFY) {
+			if (result == NULL)
+				pr_fail("%s: element %zu could not be found\n",
+					args->name, i);
+			else if (*result != *ptr)
+				pr_fail("%s: element %zu "
+					"found %" PRIu32
+					", expecting %" PRIu32 "\n",
+					args->name, i, *result, *ptr);
+		}
+	}
+	stats->duration += stress_time_now() - t;
+	stats->compares += (double)stress_sort_compare_get();
+	stats->lookups += (double)i;
+}
+
 /*
  *  stress_bsearch()
  *	stress bsearch
  */
 static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 {
-	int32_t *data, *ptr;
-	size_t n, n8, i, bsearch_method = 0, data_size;
+	int32_t *data, *layout;
+	size_t n, n_alloc, i, bsearch_method = 0, data_size, n_sweep = 0;
 	uint64_t bsearch_size = DEFAULT_BSEARCH_SIZE;
-	double rate, duration = 0.0, count = 0.0, sorted = 0.0;
-	bsearch_func_t bsearch_func;
+	double rate, slice = 0.0;
+	bool bsearch_sweep = false;
+	stress_bsearch_stats_t stats;
+	stress_bsearch_sweep_t sweep[MAX_BSEARCH_SWEEP];
+	const stress_bsearch_method_t *method;
 
 	(void)stress_get_setting("bsearch-method", &bsearch_method);
-	bsearch_func = stress_bsearch_methods[bsearch_method].bsearch_func;
+	(void)stress_get_setting("bsearch-sweep", &bsearch_sweep);
+	method = &stress_bsearch_methods[bsearch_method];
 
 	if (!stress_get_setting("bsearch-size", &bsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -133,10 +421,27 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 			bsearch_size = MIN_BSEARCH_SIZE;
 	}
 	n = (size_t)bsearch_size;
-	n8 = (n + 7) & ~7UL;
-	data_size = n8 * sizeof(*data);
+	n_alloc = n;
+
+	(void)shim_memset(&stats, 0, sizeof(stats));
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+	if (bsearch_sweep) {
+		n_sweep = stress_bsearch_sweep_sizes(sweep);
+		for (n_alloc = 0, i = 0; i < n_sweep; i++)
+			n_alloc = STRESS_MAXIMUM(n_alloc, sweep[i].n);
+
+		/* spread the run over all sizes, repeating the sweep if time remains */
+		slice = (double)g_opt_timeout / (double)n_sweep;
+		slice = STRESS_MINIMUM(1.0, STRESS_MAXIMUM(0.05, slice));
+	}
 
-	/* allocate in multiples of 8 */
+	/*
+	 *  allocate in multiples of 8, the data is followed by room for
+	 *  a layout of the data with an extra index 0 or padding to a
+	 *  whole S-tree node
+	 */
+	n_alloc = (n_alloc + 7) & ~7UL;
+	data_size = ((2 * n_alloc) + STREE_B) * sizeof(*data);
 	data = (int32_t *)stress_mmap_populate(NULL,
 				data_size, PROT_READ | PROT_WRITE,
 				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
@@ -145,43 +450,68 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 			args->name, data_size, errno, strerror(errno));
 		return EXIT_NO_RESOURCE;
 	}
+	/* n_alloc is a multiple of 8 so the layout is 32 byte aligned */
+	layout = data + n_alloc;
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		double t;
-
-		stress_sort_data_int32_init(data, n);
-		stress_sort_compare_reset();
-		t = stress_time_now();
-		for (ptr = data, i = 0; i < n; i++, ptr++) {
-			int32_t *result;
+		if (n_sweep > 0) {
+			for (i = 0; (i < n_sweep) && stress_continue(args); i++) {
+				const double t_start = stress_time_now();
 
-			result = bsearch_func(ptr, data, n, sizeof(*ptr), stress_sort_cmp_fwd_int32);
-			if (g_opt_flags & OPT_FLAGS_VERIFY) {
-				if (result == NULL)
-					pr_fail("%s: element %zu could not be found\n",
-						args->name, i);
-				else if (*result != *ptr)
-					pr_fail("%s: element %zu "
-						"found %" PRIu32
-						", expecting %" PRIu32 "\n",
-						args->name, i, *result, *ptr);
+				do {
+					stress_bsearch_iter(args, method, data, layout,
+						sweep[i].n, &sweep[i].stats);
+					stress_bogo_inc(args);
+				} while ((stress_time_now() - t_start < slice) && stress_continue(args));
 			}
+		} else {
+			stress_bsearch_iter(args, method, data, layout, n, &stats);
+			stress_bogo_inc(args);
 		}
-		duration += stress_time_now() - t;
-		count += (double)stress_sort_compare_get();
-		sorted += (double)i;
-		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	rate = (duration > 0.0) ? count / duration : 0.0;
-	stress_metrics_set(args, 0, "bsearch comparisons per sec",
-		rate, STRESS_HARMONIC_MEAN);
-	stress_metrics_set(args, 1, "bsearch comparisons per item",
-		count / sorted, STRESS_HARMONIC_MEAN);
+	if (n_sweep > 0) {
+		size_t metric = 0;
+
+		if (args->instance == 0)
+			pr_inf("%s: %-9s %9s %14s %14s\n", args->name,
+				"boundary", "items", "lookups/sec", "ns/lookup");
+		for (i = 0; i < n_sweep; i++) {
+			const stress_bsearch_stats_t *st = &sweep[i].stats;
+			char msg[64];
+
+			if ((st->duration <= 0.0) || (st->lookups <= 0.0))
+				continue;
+			rate = st->lookups / st->duration;
+			if (args->instance == 0)
+				pr_inf("%s: %-9s %9zu %14.0f %14.2f\n", args->name,
+					sweep[i].boundary, sweep[i].n, rate,
+					STRESS_DBL_NANOSECOND / rate);
+			(void)snprintf(msg, sizeof(msg), "%s lookups per sec", sweep[i].boundary);
+			stress_metrics_set(args, metric++, msg, rate, STRESS_HARMONIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "%s nanosecs per lookup", sweep[i].boundary);
+			stress_metrics_set(args, metric++, msg,
+				STRESS_DBL_NANOSECOND / rate, STRESS_GEOMETRIC_MEAN);
+		}
+	} else if (stats.duration > 0.0) {
+		/* only the comparator based searches count comparisons */
+		if (method->bsearch_func) {
+			rate = stats.compares / stats.duration;
+			stress_metrics_set(args, 0, "bsearch comparisons per sec",
+				rate, STRESS_HARMONIC_MEAN);
+			stress_metrics_set(args, 1, "bsearch comparisons per item",
+				stats.compares / stats.lookups, STRESS_HARMONIC_MEAN);
+		}
+		rate = stats.lookups / stats.duration;
+		stress_metrics_set(args, 2, "lookups per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 3, "nanosecs per lookup",
+			STRESS_DBL_NANOSECOND / rate, STRESS_GEOMETRIC_MEAN);
+	}
 
 	(void)munmap((void *)data, data_size);
 	return EXIT_SUCCESS;
@@ -190,6 +520,7 @@ static int OPTIMIZE3 stress_bsearch(stress_args_t *args)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_bsearch_size,	stress_set_bsearch_size },
 	{ OPT_bsearch_method,	stress_set_bsearch_method },
+	{ OPT_bsearch_sweep,	stress_set_bsearch_sweep },
 	{ 0,			NULL }
 };
 
@@ -198,5 +529,6 @@ stressor_info_t stress_bsearch_info = {
 	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
 	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
-	.help = help
+	.help = help,
+	.thread_safe = true
 };
@@ -17,10 +17,12 @@
  *
  */
 #include "stress-ng.h"
+#include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
 #include "core-killpid.h"
 #include "core-lock.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
@@ -45,6 +47,7 @@ do {				\
 static const stress_help_t help[] = {
 	{ NULL,	"cacheline N",		"start N workers that exercise cachelines" },
 	{ NULL,	"cacheline-affinity",	"modify CPU affinity" },
+	{ NULL,	"cacheline-matrix",	"measure cache line round trip latency between all CPU pairs" },
 	{ NULL,	"cacheline-method M",	"use cacheline stressing method M" },
 	{ NULL,	"cacheline-ops N",	"stop after N cacheline bogo operations" },
 	{ NULL,	NULL,			NULL }
@@ -586,6 +589,11 @@ static int stress_set_cacheline_affinity(const char *opt)
  *  stress_set_cacheline_method()
  *	set the default cacheline stress method
  */
+static int stress_set_cacheline_matrix(const char *opt)
+{
+	return stress_set_setting_true("cacheline-matrix", opt);
+}
+
 static int stress_set_cacheline_method(const char *name)
 {
 	size_t i;
@@ -659,6 +667,342 @@ static int stress_cacheline_child(
 	return rc;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_SCHED_GETAFFINITY) &&		\
+    defined(HAVE_SCHED_SETAFFINITY) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(__ATOMIC_ACQ_REL) &&		\
+    defined(__ATOMIC_ACQUIRE)
+#define HAVE_CACHELINE_MATRIX
+
+#define STRESS_CACHELINE_MATRIX_WARMUP	(100)	/* untimed round trips */
+#define STRESS_CACHELINE_MATRIX_ROUNDS	(10000)	/* timed round trips */
+#define STRESS_CACHELINE_MATRIX_SPINS	(1024)	/* spins before yielding */
+#define STRESS_CACHELINE_MATRIX_PAIRS	(8)	/* max CPUs for per pair metrics */
+
+#define STRESS_CACHELINE_CLASS_SMT	(0)
+#define STRESS_CACHELINE_CLASS_LLC	(1)
+#define STRESS_CACHELINE_CLASS_PACKAGE	(2)
+#define STRESS_CACHELINE_CLASS_REMOTE	(3)
+#define STRESS_CACHELINE_CLASSES	(4)
+
+static const char * const cacheline_classes[] = {
+	"SMT sibling",
+	"same LLC",
+	"cross LLC",
+	"cross package",
+};
+
+/* Partner thread that returns the cache line to the main thread */
+typedef struct {
+	volatile uint64_t *line;	/* ping-pong cache line */
+	volatile bool *abort;		/* set if the round trips are abandoned */
+	int32_t cpu;			/* CPU the partner is pinned to */
+	pthread_t pthread;		/* partner thread */
+} stress_cacheline_partner_t;
+
+/*
+ *  stress_cacheline_cas()
+ *	spin until the cache line value changes from expect to expect + 1,
+ *	yield periodically so a pair sharing a CPU can make progress,
+ *	returns false if the ping-pong was aborted
+ */
+static inline bool stress_cacheline_cas(
+	volatile uint64_t *line,
+	const uint64_t expect,
+	volatile bool *abort)
+{
+	uint32_t spins = 0;
+
+	for (;;) {
+		uint64_t expected = expect;
+
+		if (__atomic_compare_exchange_n(line, &expected, expect + 1, false,
+						__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			return true;
+		if (UNLIKELY(++spins >= STRESS_CACHELINE_MATRIX_SPINS)) {
+			if (*abort)
+				return false;
+			(void)shim_sched_yield();
+			spins = 0;
+		}
+	}
+}
+
+/*
+ *  stress_cacheline_partner()
+ *	pinned partner thread, moves the line from odd to even values
+ */
+static void *stress_cacheline_partner(void *arg)
+{
+	static void *nowt = NULL;
+	stress_cacheline_partner_t *partner = (stress_cacheline_partner_t *)arg;
+	const uint64_t rounds = STRESS_CACHELINE_MATRIX_WARMUP + STRESS_CACHELINE_MATRIX_ROUNDS;
+	cpu_set_t mask;
+	sigset_t set;
+	uint64_t i;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	CPU_ZERO(&mask);
+	CPU_SET(partner->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	for (i = 0; i < rounds; i++) {
+		if (!stress_cacheline_cas(partner->line, (i * 2) + 1, partner->abort))
+			break;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_cacheline_round_trip()
+ *	ping-pong a cache line between cpu_a (this thread) and cpu_b
+ *	(a partner thread) with atomic compare and exchange, returns the
+ *	mean round trip time in nanoseconds or a negative value on failure
+ */
+static double stress_cacheline_round_trip(
+	volatile uint64_t *line,
+	const int32_t cpu_a,
+	const int32_t cpu_b)
+{
+	const uint64_t rounds = STRESS_CACHELINE_MATRIX_WARMUP + STRESS_CACHELINE_MATRIX_ROUNDS;
+	stress_cacheline_partner_t partner;
+	volatile bool abort = false;
+	cpu_set_t mask;
+	double t = 0.0;
+	uint64_t i;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu_a, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0)
+		return -1.0;
+
+	*line = 0;
+	partner.line = line;
+	partner.abort = &abort;
+	partner.cpu = cpu_b;
+	if (pthread_create(&partner.pthread, NULL, stress_cacheline_partner, (void *)&partner))
+		return -1.0;
+
+	for (i = 0; i < rounds; i++) {
+		if (i == STRESS_CACHELINE_MATRIX_WARMUP)
+			t = stress_time_now();
+		if (!stress_cacheline_cas(line, i * 2, &abort))
+			break;
+		if (UNLIKELY(((i & 1023) == 0) && !stress_continue_flag())) {
+			abort = true;
+			break;
+		}
+	}
+	t = stress_time_now() - t;
+	(void)pthread_join(partner.pthread, NULL);
+
+	if (abort)
+		return -1.0;
+	return (t * STRESS_DBL_NANOSECOND) / (double)STRESS_CACHELINE_MATRIX_ROUNDS;
+}
+
+/*
+ *  stress_cacheline_class()
+ *	topology class of a pair of CPUs
+ */
+static size_t stress_cacheline_class(
+	const stress_placement_cpu_t *pc_a,
+	const stress_placement_cpu_t *pc_b)
+{
+	if (pc_a->package != pc_b->package)
+		return STRESS_CACHELINE_CLASS_REMOTE;
+	if (pc_a->core == pc_b->core)
+		return STRESS_CACHELINE_CLASS_SMT;
+	if (pc_a->llc == pc_b->llc)
+		return STRESS_CACHELINE_CLASS_LLC;
+	return STRESS_CACHELINE_CLASS_PACKAGE;
+}
+
+/*
+ *  stress_cacheline_matrix()
+ *	measure the cache line round trip time between every
+ *	pair of CPUs the stressor may run on
+ */
+static int stress_cacheline_matrix(stress_args_t *args)
+{
+	cpu_set_t proc_mask;
+	int32_t *cpus;
+	stress_placement_cpu_t *topology;
+	double *sum, *min;
+	uint32_t *count;
+	volatile uint64_t *line;
+	size_t n_cpus = 0, a, b, i, metric = 0;
+	int rc = EXIT_SUCCESS;
+	char *row;
+	const size_t row_len = (CPU_SETSIZE * 8) + 32;
+
+	if (sched_getaffinity(0, sizeof(proc_mask), &proc_mask) < 0) {
+		pr_fail("%s: sched_getaffinity could not get CPU affinity, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (CPU_COUNT(&proc_mask) < 2) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cacheline matrix needs at least 2 CPUs, skipping stressor\n",
+				args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	cpus = (int32_t *)calloc((size_t)CPU_SETSIZE, sizeof(*cpus));
+	topology = (stress_placement_cpu_t *)calloc((size_t)CPU_SETSIZE, sizeof(*topology));
+	row = (char *)malloc(row_len);
+	if (!cpus || !topology || !row) {
+		pr_inf_skip("%s: cannot allocate CPU table, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_cpus;
+	}
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (CPU_ISSET((int)i, &proc_mask)) {
+			cpus[n_cpus] = (int32_t)i;
+			stress_placement_topology(&topology[n_cpus], (int32_t)i);
+			n_cpus++;
+		}
+	}
+
+	sum = (double *)calloc(n_cpus * n_cpus, sizeof(*sum));
+	min = (double *)calloc(n_cpus * n_cpus, sizeof(*min));
+	count = (uint32_t *)calloc(n_cpus * n_cpus, sizeof(*count));
+	/* page aligned so the line does not share a cache line with anything else */
+	line = (volatile uint64_t *)mmap(NULL, args->page_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (!sum || !min || !count || (line == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate %zu x %zu CPU latency matrix, skipping stressor\n",
+			args->name, n_cpus, n_cpus);
+		rc = EXIT_NO_RESOURCE;
+		goto free_matrix;
+	}
+	if (args->instance == 0)
+		pr_inf("%s: measuring cache line round trip latency between %zu CPUs (%zu pairs)\n",
+			args->name, n_cpus, (n_cpus * (n_cpus - 1)) / 2);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (a = 0; a < n_cpus; a++) {
+			for (b = a + 1; b < n_cpus; b++) {
+				const double ns = stress_cacheline_round_trip(line, cpus[a], cpus[b]);
+
+				if (!stress_continue_flag())
+					goto report;
+				if (ns < 0.0)
+					continue;
+				i = (a * n_cpus) + b;
+				sum[i] += ns;
+				if ((count[i] == 0) || (ns < min[i]))
+					min[i] = ns;
+				count[i]++;
+				stress_bogo_inc(args);
+				if (!stress_continue(args))
+					goto report;
+			}
+		}
+	} while (stress_continue(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	/* mirror the upper triangle, the round trip is symmetric */
+	for (a = 0; a < n_cpus; a++) {
+		for (b = a + 1; b < n_cpus; b++) {
+			sum[(b * n_cpus) + a] = sum[(a * n_cpus) + b];
+			min[(b * n_cpus) + a] = min[(a * n_cpus) + b];
+			count[(b * n_cpus) + a] = count[(a * n_cpus) + b];
+		}
+	}
+
+	if (args->instance == 0) {
+		int len;
+
+		len = snprintf(row, row_len, "%6s", "cpu");
+		for (b = 0; (b < n_cpus) && (len > 0) && ((size_t)len < row_len); b++)
+			len += snprintf(row + len, row_len - (size_t)len, " %7" PRId32, cpus[b]);
+		pr_inf("%s: mean round trip ns:\n", args->name);
+		pr_inf("%s: %s\n", args->name, row);
+		for (a = 0; a < n_cpus; a++) {
+			len = snprintf(row, row_len, "%6" PRId32, cpus[a]);
+			for (b = 0; (b < n_cpus) && (len > 0) && ((size_t)len < row_len); b++) {
+				i = (a * n_cpus) + b;
+				if (count[i])
+					len += snprintf(row + len, row_len - (size_t)len, " %7.1f",
+						sum[i] / (double)count[i]);
+				else
+					len += snprintf(row + len, row_len - (size_t)len, " %7s", "-");
+			}
+			pr_inf("%s: %s\n", args->name, row);
+		}
+	}
+
+	/* per topology class round trip, mean over the pairs and best pair */
+	for (i = 0; i < STRESS_CACHELINE_CLASSES; i++) {
+		double class_sum = 0.0, class_min = 0.0;
+		uint32_t pairs = 0;
+		char msg[64];
+
+		for (a = 0; a < n_cpus; a++) {
+			for (b = a + 1; b < n_cpus; b++) {
+				const size_t j = (a * n_cpus) + b;
+
+				if (!count[j] || (stress_cacheline_class(&topology[a], &topology[b]) != i))
+					continue;
+				class_sum += sum[j] / (double)count[j];
+				if ((pairs == 0) || (min[j] < class_min))
+					class_min = min[j];
+				pairs++;
+			}
+		}
+		if (pairs == 0)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %-14s %4" PRIu32 " pairs, mean %.1f ns, min %.1f ns round trip\n",
+				args->name, cacheline_classes[i], pairs, class_sum / (double)pairs, class_min);
+		(void)snprintf(msg, sizeof(msg), "%s round trip ns", cacheline_classes[i]);
+		stress_metrics_set(args, metric++, msg, class_sum / (double)pairs, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s min round trip ns", cacheline_classes[i]);
+		stress_metrics_set(args, metric++, msg, class_min, STRESS_GEOMETRIC_MEAN);
+	}
+
+	/*
+	 *  the matrix is added to the metrics (and YAML) for small systems,
+	 *  pairs that don't fit below the reserved metrics are only logged
+	 */
+	if (n_cpus <= STRESS_CACHELINE_MATRIX_PAIRS) {
+		for (a = 0; a < n_cpus; a++) {
+			for (b = 0; b < n_cpus; b++) {
+				char msg[64];
+
+				i = (a * n_cpus) + b;
+				if ((a == b) || !count[i] || (metric >= STRESS_STRESSOR_METRICS_MAX))
+					continue;
+				(void)snprintf(msg, sizeof(msg), "cpu %" PRId32 " to cpu %" PRId32 " round trip ns",
+					cpus[a], cpus[b]);
+				stress_metrics_set(args, metric++, msg, sum[i] / (double)count[i],
+					STRESS_GEOMETRIC_MEAN);
+			}
+		}
+	}
+
+free_matrix:
+	if (line != MAP_FAILED)
+		(void)munmap((void *)line, args->page_size);
+	free(count);
+	free(min);
+	free(sum);
+free_cpus:
+	free(row);
+	free(topology);
+	free(cpus);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_cacheline_init()
  *	called once by stress-ng, so we can set index to 0
@@ -666,7 +1010,7 @@ static int stress_cacheline_child(
 static void stress_cacheline_init(void)
 {
 	g_shared->cacheline.index = 0;
-	g_shared->cacheline.lock = stress_lock_create();
+	g_shared->cacheline.lock = stress_lock_create("cacheline");
 }
 
 /*
@@ -711,6 +1055,7 @@ static int stress_cacheline(stress_args_t *args)
 	size_t cacheline_method = 0;
 	stress_cacheline_func func;
 	bool cacheline_affinity = false;
+	bool cacheline_matrix = false;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -728,6 +1073,19 @@ static int stress_cacheline(stress_args_t *args)
 
 	(void)stress_get_setting("cacheline-affinity", &cacheline_affinity);
 	(void)stress_get_setting("cacheline-method", &cacheline_method);
+	(void)stress_get_setting("cacheline-matrix", &cacheline_matrix);
+
+	if (cacheline_matrix) {
+#if defined(HAVE_CACHELINE_MATRIX)
+		/* just one instance measures, the others add background noise */
+		if (args->instance == 0)
+			return stress_cacheline_matrix(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --cacheline-matrix is not supported on this system, ignoring option\n",
+				args->name);
+#endif
+	}
 
 	if (args->instance == 0) {
 		pr_dbg("%s: using method '%s'\n", args->name, cacheline_methods[cacheline_method].name);
@@ -768,6 +1126,7 @@ finish:
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_cacheline_affinity,	stress_set_cacheline_affinity },
+	{ OPT_cacheline_matrix,		stress_set_cacheline_matrix },
 	{ OPT_cacheline_method,		stress_set_cacheline_method },
 	{ 0,				NULL },
 };
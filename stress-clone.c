@@ -23,6 +23,7 @@
 #include "core-lock.h"
 #include "core-mincore.h"
 #include "core-out-of-memory.h"
+#include "core-shared-heap.h"
 
 #include <sched.h>
 
@@ -610,14 +611,14 @@ static int stress_clone(stress_args_t *args)
 	stress_clone_shared_t *shared;
 	double average;
 
-	shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
-			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-	if (shared == MAP_FAILED) {
-		pr_inf_skip("%s: failed to memory map %zd bytes, skipping stressor\n",
-			args->name, sizeof(*shared));
+	shared = (stress_clone_shared_t *)stress_shared_heap_malloc(sizeof(*shared));
+	if (!shared) {
+		pr_inf_skip("%s: failed to allocate %zd bytes from the shared heap, "
+			"skipping stressor\n", args->name, sizeof(*shared));
 		return EXIT_NO_RESOURCE;
 	}
-	shared->metrics.lock = stress_lock_create();
+	(void)shim_memset(shared, 0, sizeof(*shared));
+	shared->metrics.lock = stress_lock_create("clone-metrics");
 	shared->metrics.duration = 0.0;
 	shared->metrics.count = 0.0;
 	shared->metrics.t_start = 0.0;
@@ -647,7 +648,9 @@ static int stress_clone(stress_args_t *args)
 	stress_metrics_set(args, 0, "microsecs per clone",
 		average * 1000000, STRESS_HARMONIC_MEAN);
 
-	(void)munmap((void *)shared, sizeof(*shared));
+	if (shared->metrics.lock)
+		(void)stress_lock_destroy(shared->metrics.lock);
+	stress_shared_heap_free(shared);
 
 	return rc;
 }
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 
 #include <sched.h>
 
@@ -27,6 +28,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"cpu-online N",		"start N workers offlining/onlining the CPUs" },
 	{ NULL, "cpu-online-affinity",	"set CPU affinity to the CPU to be offlined" },
 	{ NULL, "cpu-online-all",	"attempt to exercise all CPUs include CPU 0" },
+	{ NULL, "cpu-online-load",	"run a CPU load on all CPUs while offlining/onlining" },
 	{ NULL,	"cpu-online-ops N",	"stop after N offline/online operations" },
 	{ NULL,	NULL,			NULL }
 };
@@ -43,14 +45,133 @@ static int stress_set_cpu_online_all(const char *opt)
 	return stress_set_setting_true("cpu-online-all", opt);
 }
 
+static int stress_set_cpu_online_load(const char *opt)
+{
+	return stress_set_setting_true("cpu-online-load", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_cpu_online_affinity,	stress_set_cpu_online_affinity },
 	{ OPT_cpu_online_all,		stress_set_cpu_online_all },
+	{ OPT_cpu_online_load,		stress_set_cpu_online_load },
 	{ 0,				NULL },
 };
 
 #if defined(__linux__)
 
+/* per CPU transition latencies, allocated on a CPU's first transition */
+typedef struct {
+	stress_latency_t offline;	/* offline transition latencies, ns */
+	stress_latency_t online;	/* online transition latencies, ns */
+} stress_cpu_online_latency_t;
+
+/*
+ *  stress_cpu_online_latency_add()
+ *	record the duration in seconds of a CPU offline or online transition
+ */
+static void stress_cpu_online_latency_add(
+	stress_cpu_online_latency_t **latencies,
+	const uint32_t cpu,
+	const bool offline,
+	const double duration)
+{
+	stress_cpu_online_latency_t *latency = latencies[cpu];
+
+	if (!latency) {
+		latency = calloc(1, sizeof(*latency));
+		if (!latency)
+			return;
+		latencies[cpu] = latency;
+	}
+	stress_latency_add(offline ? &latency->offline : &latency->online,
+		(uint64_t)(duration * STRESS_DBL_NANOSECOND));
+}
+
+/*
+ *  stress_cpu_online_latency_report()
+ *	report per CPU offline and online transition latency
+ *	percentiles in milliseconds and the percentiles of all
+ *	the transitions as metrics
+ */
+static void stress_cpu_online_latency_report(
+	stress_args_t *args,
+	stress_cpu_online_latency_t **latencies,
+	const int32_t cpus)
+{
+	static stress_latency_t offline, online;
+	int32_t i;
+	bool header = false;
+
+	(void)shim_memset(&offline, 0, sizeof(offline));
+	(void)shim_memset(&online, 0, sizeof(online));
+
+	for (i = 0; i < cpus; i++) {
+		const stress_cpu_online_latency_t *latency = latencies[i];
+
+		if (!latency)
+			continue;
+		if (!header) {
+			pr_block_begin();
+			pr_inf("%s: transition latencies in milliseconds:\n", args->name);
+			pr_inf("%s: %5s %8s %8s %8s %8s %8s %8s %8s %8s\n", args->name,
+				"cpu", "offlines", "P50", "P99", "max",
+				"onlines", "P50", "P99", "max");
+			header = true;
+		}
+		pr_inf("%s: %5" PRId32 " %8" PRIu64 " %8.3f %8.3f %8.3f %8" PRIu64 " %8.3f %8.3f %8.3f\n",
+			args->name, i,
+			latency->offline.count,
+			(double)stress_latency_percentile(&latency->offline, 50.0) / STRESS_DBL_MICROSECOND,
+			(double)stress_latency_percentile(&latency->offline, 99.0) / STRESS_DBL_MICROSECOND,
+			(double)latency->offline.max / STRESS_DBL_MICROSECOND,
+			latency->online.count,
+			(double)stress_latency_percentile(&latency->online, 50.0) / STRESS_DBL_MICROSECOND,
+			(double)stress_latency_percentile(&latency->online, 99.0) / STRESS_DBL_MICROSECOND,
+			(double)latency->online.max / STRESS_DBL_MICROSECOND);
+		stress_latency_merge(&offline, &latency->offline);
+		stress_latency_merge(&online, &latency->online);
+	}
+	if (header)
+		pr_block_end();
+
+	if (offline.count) {
+		stress_metrics_set(args, 2, "millisecs offline P50",
+			(double)stress_latency_percentile(&offline, 50.0) / STRESS_DBL_MICROSECOND,
+			STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "millisecs offline P99",
+			(double)stress_latency_percentile(&offline, 99.0) / STRESS_DBL_MICROSECOND,
+			STRESS_GEOMETRIC_MEAN);
+	}
+	if (online.count) {
+		stress_metrics_set(args, 4, "millisecs online P50",
+			(double)stress_latency_percentile(&online, 50.0) / STRESS_DBL_MICROSECOND,
+			STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 5, "millisecs online P99",
+			(double)stress_latency_percentile(&online, 99.0) / STRESS_DBL_MICROSECOND,
+			STRESS_GEOMETRIC_MEAN);
+	}
+}
+
+/*
+ *  stress_cpu_online_load()
+ *	busy CPU load child, unpinned so that the scheduler spreads
+ *	the load children over the CPUs and offlining a CPU has to
+ *	migrate the load off it
+ */
+static void NORETURN stress_cpu_online_load(void)
+{
+	volatile uint64_t counter = 0;
+
+	stress_parent_died_alarm();
+	while (stress_continue_flag()) {
+		register int j;
+
+		for (j = 0; j < 100000; j++)
+			counter++;
+	}
+	_exit(0);
+}
+
 /*
  *  stress_cpu_online_set_affinity(const uint32_t cpu)
  *	try to set cpu affinity
@@ -182,9 +303,14 @@ static int stress_cpu_online(stress_args_t *args)
 	double offline_duration = 0.0, offline_count = 0.0;
 	double online_duration  = 0.0, online_count = 0.0;
 	double rate;
+	stress_cpu_online_latency_t **latencies;
+	bool cpu_online_load = false;
+	pid_t *load_pids = NULL;
+	size_t n_load_pids = 0;
 
 	(void)stress_get_setting("cpu-online-affinity", &cpu_online_affinity);
 	(void)stress_get_setting("cpu-online-all", &cpu_online_all);
+	(void)stress_get_setting("cpu-online-load", &cpu_online_load);
 
 	if (geteuid() != 0) {
 		if (args->instance == 0)
@@ -212,6 +338,13 @@ static int stress_cpu_online(stress_args_t *args)
 			    "skipping stressor\n", args->name, cpus);
 		return EXIT_NO_RESOURCE;
 	}
+	latencies = calloc((size_t)cpus, sizeof(*latencies));
+	if (!latencies) {
+		pr_inf_skip("%s: out of memory allocating %" PRId32 " latency pointers, "
+			    "skipping stressor\n", args->name, cpus);
+		free(cpu_online);
+		return EXIT_NO_RESOURCE;
+	}
 
 	/*
 	 *  Determine how many CPUs we can online/offline via
@@ -231,6 +364,7 @@ static int stress_cpu_online(stress_args_t *args)
 	}
 	if (cpu_online_count == 0) {
 		pr_inf("%s: no CPUs can be set online/offline\n", args->name);
+		free(latencies);
 		free(cpu_online);
 		return EXIT_FAILURE;
 	}
@@ -248,6 +382,29 @@ static int stress_cpu_online(stress_args_t *args)
 			args->name, cpu_online_count + 1);
 	}
 
+	/*
+	 *  Run a busy load child per CPU so that offlining
+	 *  measures the cost of migrating tasks off the CPU
+	 */
+	if (cpu_online_load) {
+		const int32_t n_cpus = stress_get_processors_online();
+
+		load_pids = calloc((size_t)STRESS_MAXIMUM(n_cpus, 1), sizeof(*load_pids));
+		if (load_pids) {
+			for (i = 0; i < n_cpus; i++) {
+				const pid_t load_pid = fork();
+
+				if (load_pid < 0)
+					break;
+				if (load_pid == 0)
+					stress_cpu_online_load();
+				load_pids[n_load_pids++] = load_pid;
+			}
+		}
+		if ((args->instance == 0) && (n_load_pids > 0))
+			pr_inf("%s: running %zu CPU load processes\n", args->name, n_load_pids);
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	/* Use a pipe to send offlined CPU number to child */
@@ -362,8 +519,10 @@ static int stress_cpu_online(stress_args_t *args)
 					pr_inf("%s: set cpu %" PRIu32 " offline, expecting setting to be 0, got %d instead\n",
 						args->name, cpu, setting);
 				} else {
-					offline_duration += stress_time_now() - t;
+					t = stress_time_now() - t;
+					offline_duration += t;
 					offline_count += 1.0;
+					stress_cpu_online_latency_add(latencies, cpu, true, t);
 				}
 			}
 
@@ -377,8 +536,10 @@ static int stress_cpu_online(stress_args_t *args)
 					pr_inf("%s: set cpu %" PRIu32 " offline, expecting setting to be 1, got %d instead\n",
 						args->name, cpu, setting);
 				} else {
-					online_duration += stress_time_now() - t;
+					t = stress_time_now() - t;
+					online_duration += t;
 					online_count += 1.0;
+					stress_cpu_online_latency_add(latencies, cpu, false, t);
 					if (cpu_online_affinity)
 						stress_cpu_online_set_affinity(cpu);
 				}
@@ -400,6 +561,10 @@ static int stress_cpu_online(stress_args_t *args)
 			(void)close(fds[1]);
 		(void)stress_kill_and_wait(args, pid, SIGKILL, false);
 	}
+	if (load_pids) {
+		(void)stress_kill_and_wait_many(args, load_pids, n_load_pids, SIGKILL, false);
+		free(load_pids);
+	}
 
 	/*
 	 *  Force CPUs all back online
@@ -417,6 +582,11 @@ static int stress_cpu_online(stress_args_t *args)
 	stress_metrics_set(args, 1, "millisecs per online action",
 		rate * STRESS_DBL_MILLISECOND, STRESS_HARMONIC_MEAN);
 
+	stress_cpu_online_latency_report(args, latencies, cpus);
+	for (i = 0; i < cpus; i++)
+		free(latencies[i]);
+	free(latencies);
+
 	return rc;
 }
 
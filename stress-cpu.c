@@ -37,6 +37,13 @@
 #include <complex.h>
 #endif
 
+#if defined(STRESS_ARCH_ARM) &&		\
+    defined(__aarch64__) &&		\
+    defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#define HAVE_ARM_SVE
+#endif
+
 /*
  *  S390x on QEMU (and maybe H/W) trips SIGILL for decimal
  *  math with some compilers, so disable this for now
@@ -89,9 +96,12 @@ static const stress_help_t help[] = {
 	{ "c N", "cpu N",		"start N workers that perform CPU only loading" },
 	{ "l P", "cpu-load P",		"load CPU by P %, 0=sleep, 100=full load (see -c)" },
 	{ NULL,	 "cpu-load-slice S",	"specify time slice during busy load" },
+	{ NULL,  "cpu-calibrate F",	"measure each cpu method rate, save the profile to file F" },
 	{ NULL,  "cpu-method M",	"specify stress cpu method M, default is all" },
 	{ NULL,	 "cpu-old-metrics",	"use old CPU metrics instead of normalized metrics" },
 	{ NULL,  "cpu-ops N",		"stop after N cpu bogo operations" },
+	{ NULL,  "cpu-profile F",	"use reference cpu method rates from profile file F" },
+	{ NULL,  "cpu-vector V",	"use explicitly vectorised methods, V = scalar, sse, avx2, avx512, neon, sve" },
 	{ NULL,	 NULL,			NULL }
 };
 
@@ -2872,6 +2882,101 @@ static void stress_cpu_method(size_t method, stress_args_t *args, double *counte
 	stress_bogo_set(args, (uint64_t)*counter);
 }
 
+#define STRESS_CPU_BATCH_SLICE	(0.001)		/* target secs per batch of method calls */
+#define STRESS_CPU_BATCH_MAX	(1U << 20)	/* maximum method calls per batch */
+
+typedef void (*stress_cpu_batch_func)(const char *name, const uint32_t n);
+
+/*
+ *  STRESS_CPU_BATCH()
+ *	specialised run loop calling a cpu method n times directly
+ */
+#define STRESS_CPU_BATCH(method)				\
+static void HOT OPTIMIZE3 stress_cpu_batch_ ## method(		\
+	const char *name,					\
+	const uint32_t n)					\
+{								\
+	register uint32_t i;					\
+								\
+	for (i = 0; i < n; i++)					\
+		stress_cpu_ ## method(name);			\
+}
+
+STRESS_CPU_BATCH(bitops)
+STRESS_CPU_BATCH(gray)
+STRESS_CPU_BATCH(loop)
+STRESS_CPU_BATCH(parity)
+
+typedef struct {
+	const stress_cpu_func func;		/* the cpu method function */
+	const stress_cpu_batch_func batch_func;	/* its specialised run loop */
+} stress_cpu_batch_method_t;
+
+/*
+ *  cheap methods where the indirect call is a noticeable
+ *  fraction of the run time
+ */
+static const stress_cpu_batch_method_t cpu_batch_methods[] = {
+	{ stress_cpu_bitops,	stress_cpu_batch_bitops },
+	{ stress_cpu_gray,	stress_cpu_batch_gray },
+	{ stress_cpu_loop,	stress_cpu_batch_loop },
+	{ stress_cpu_parity,	stress_cpu_batch_parity },
+};
+
+/*
+ *  stress_cpu_method_batched()
+ *	run a single cpu method at full load, calling it in batches
+ *	between bogo counter updates and continue checks. The batch
+ *	size adapts to take about STRESS_CPU_BATCH_SLICE seconds and
+ *	is trimmed so --cpu-ops N is not overshot
+ */
+static void stress_cpu_method_batched(size_t method, stress_args_t *args, double *counter)
+{
+	const stress_cpu_func func = cpu_methods[method].func;
+	const double scale = stress_cpu_counter_scale[method];
+	stress_cpu_batch_func batch_func = NULL;
+	uint32_t batch = 1;
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(cpu_batch_methods); i++) {
+		if (cpu_batch_methods[i].func == func) {
+			batch_func = cpu_batch_methods[i].batch_func;
+			break;
+		}
+	}
+
+	do {
+		uint32_t n = batch;
+		double t;
+
+		if (args->max_ops) {
+			const double remaining = ((double)args->max_ops - *counter) / scale;
+
+			if (remaining < (double)n)
+				n = (remaining < 1.0) ? 1 : (uint32_t)remaining + 1;
+		}
+
+		t = stress_time_now();
+		if (batch_func) {
+			batch_func(args->name, n);
+		} else {
+			register uint32_t j;
+
+			for (j = 0; j < n; j++)
+				func(args->name);
+		}
+		t = stress_time_now() - t;
+
+		*counter += scale * (double)n;
+		stress_bogo_set(args, (uint64_t)*counter);
+
+		if ((t < STRESS_CPU_BATCH_SLICE * 0.5) && (batch < STRESS_CPU_BATCH_MAX))
+			batch <<= 1;
+		else if ((t > STRESS_CPU_BATCH_SLICE * 2.0) && (batch > 1))
+			batch >>= 1;
+	} while (stress_continue(args));
+}
+
 /*
  *  stress_set_cpu_method()
  *	set the default cpu stress method
@@ -2896,6 +3001,471 @@ static int stress_set_cpu_method(const char *name)
 	return -1;
 }
 
+/*
+ *  Explicitly vectorised variants of a few of the float methods,
+ *  each ISA builds the same kernels with GCC/clang vector extensions
+ *  of the native register width and the results are checked against
+ *  an unvectorised scalar reference.
+ */
+#define CPU_VEC_MATRIX_N	(64)
+#define CPU_VEC_CORR_LEN	(4096)
+#define CPU_VEC_CORR_LAGS	(64)
+#define CPU_VEC_SQRT_LEN	(4096)
+#define CPU_VEC_SQRT_LOOPS	(12)
+#define CPU_VEC_RESULT_LEN	(CPU_VEC_MATRIX_N * CPU_VEC_MATRIX_N)
+#define CPU_VEC_TOLERANCE	(1.0E-4)
+
+#if (defined(HAVE_COMPILER_GCC) ||	\
+     defined(HAVE_COMPILER_CLANG) ||	\
+     defined(HAVE_COMPILER_ICX)) &&	\
+    !defined(HAVE_COMPILER_ICC) &&	\
+    !defined(HAVE_COMPILER_PCC) &&	\
+    !defined(HAVE_COMPILER_TCC)
+#define HAVE_CPU_VECTOR
+#endif
+
+typedef struct {
+	float a[CPU_VEC_MATRIX_N][CPU_VEC_MATRIX_N];	/* matrixprod inputs */
+	float b[CPU_VEC_MATRIX_N][CPU_VEC_MATRIX_N];
+	float x[CPU_VEC_CORR_LEN + CPU_VEC_CORR_LAGS];	/* correlate inputs */
+	float y[CPU_VEC_CORR_LEN];
+	float s[CPU_VEC_SQRT_LEN];			/* nsqrt input */
+} stress_cpu_vec_data_t;
+
+typedef void (*stress_cpu_vec_func_t)(const stress_cpu_vec_data_t *d, float *r);
+
+typedef struct {
+	const char *name;			/* method name */
+	const stress_cpu_vec_func_t scalar;	/* scalar reference */
+	const size_t len;			/* number of result floats */
+} stress_cpu_vec_method_t;
+
+typedef struct {
+	const char *name;			/* ISA name */
+	bool (*supported)(void);		/* CPU supports the ISA */
+	const stress_cpu_vec_func_t funcs[3];	/* vectorised methods */
+} stress_cpu_vec_isa_t;
+
+/*
+ *  stress_cpu_vec_matrixprod_scalar()
+ *	scalar reference of the float matrix product
+ */
+static void OPTIMIZE1 stress_cpu_vec_matrixprod_scalar(const stress_cpu_vec_data_t *d, float *r)
+{
+	register size_t i, j, k;
+
+	for (i = 0; i < CPU_VEC_MATRIX_N; i++) {
+		for (j = 0; j < CPU_VEC_MATRIX_N; j++) {
+			float sum = 0.0f;
+
+			for (k = 0; k < CPU_VEC_MATRIX_N; k++)
+				sum += d->a[i][k] * d->b[k][j];
+			r[(i * CPU_VEC_MATRIX_N) + j] = sum;
+		}
+	}
+}
+
+/*
+ *  stress_cpu_vec_correlate_scalar()
+ *	scalar reference of the float cross correlation
+ */
+static void OPTIMIZE1 stress_cpu_vec_correlate_scalar(const stress_cpu_vec_data_t *d, float *r)
+{
+	register size_t i, l;
+
+	for (l = 0; l < CPU_VEC_CORR_LAGS; l++) {
+		float sum = 0.0f;
+
+		for (i = 0; i < CPU_VEC_CORR_LEN; i++)
+			sum += d->x[i + l] * d->y[i];
+		r[l] = sum;
+	}
+}
+
+/*
+ *  stress_cpu_vec_nsqrt_scalar()
+ *	scalar reference of the float Newton-Raphson square root
+ */
+static void OPTIMIZE1 stress_cpu_vec_nsqrt_scalar(const stress_cpu_vec_data_t *d, float *r)
+{
+	register size_t i, j;
+
+	for (i = 0; i < CPU_VEC_SQRT_LEN; i++) {
+		const float s = d->s[i];
+		float v = s;
+
+		for (j = 0; j < CPU_VEC_SQRT_LOOPS; j++)
+			v = 0.5f * (v + (s / v));
+		r[i] = v;
+	}
+}
+
+static const stress_cpu_vec_method_t cpu_vec_methods[] = {
+	{ "matrixprod",	stress_cpu_vec_matrixprod_scalar,	CPU_VEC_MATRIX_N * CPU_VEC_MATRIX_N },
+	{ "correlate",	stress_cpu_vec_correlate_scalar,	CPU_VEC_CORR_LAGS },
+	{ "nsqrt",	stress_cpu_vec_nsqrt_scalar,		CPU_VEC_SQRT_LEN },
+};
+
+#if defined(HAVE_CPU_VECTOR)
+/*
+ *  STRESS_CPU_VEC_FUNCS()
+ *	generate the vectorised matrixprod, correlate and nsqrt
+ *	methods for an ISA of vector width bytes, attr is the
+ *	target attribute to build the ISA specific code with.
+ *	Loads and stores are via memcpy to avoid alignment and
+ *	strict aliasing issues, these compile to vector moves.
+ */
+#define STRESS_CPU_VEC_FUNCS(isa, attr, width)					\
+typedef float stress_cpu_vec_ ## isa ## _t __attribute__((vector_size(width)));	\
+										\
+static void OPTIMIZE3 attr							\
+stress_cpu_vec_matrixprod_ ## isa(const stress_cpu_vec_data_t *d, float *r)	\
+{										\
+	const size_t n = width / sizeof(float);					\
+	register size_t i, j, k;						\
+										\
+	for (i = 0; i < CPU_VEC_MATRIX_N; i++) {				\
+		for (j = 0; j < CPU_VEC_MATRIX_N; j += n) {			\
+			stress_cpu_vec_ ## isa ## _t sum = { 0 };		\
+										\
+			for (k = 0; k < CPU_VEC_MATRIX_N; k++) {		\
+				stress_cpu_vec_ ## isa ## _t b;			\
+										\
+				(void)shim_memcpy(&b, &d->b[k][j], sizeof(b));	\
+				sum += b * d->a[i][k];				\
+			}							\
+			(void)shim_memcpy(&r[(i * CPU_VEC_MATRIX_N) + j],	\
+				&sum, sizeof(sum));				\
+		}								\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 attr							\
+stress_cpu_vec_correlate_ ## isa(const stress_cpu_vec_data_t *d, float *r)	\
+{										\
+	const size_t n = width / sizeof(float);					\
+	register size_t i, l;							\
+										\
+	for (l = 0; l < CPU_VEC_CORR_LAGS; l++) {				\
+		stress_cpu_vec_ ## isa ## _t sum = { 0 };			\
+		float total = 0.0f;						\
+										\
+		for (i = 0; i < CPU_VEC_CORR_LEN; i += n) {			\
+			stress_cpu_vec_ ## isa ## _t x, y;			\
+										\
+			(void)shim_memcpy(&x, &d->x[i + l], sizeof(x));		\
+			(void)shim_memcpy(&y, &d->y[i], sizeof(y));		\
+			sum += x * y;						\
+		}								\
+		for (i = 0; i < n; i++)						\
+			total += sum[i];					\
+		r[l] = total;							\
+	}									\
+}										\
+										\
+static void OPTIMIZE3 attr							\
+stress_cpu_vec_nsqrt_ ## isa(const stress_cpu_vec_data_t *d, float *r)		\
+{										\
+	const size_t n = width / sizeof(float);					\
+	register size_t i, j;							\
+										\
+	for (i = 0; i < CPU_VEC_SQRT_LEN; i += n) {				\
+		stress_cpu_vec_ ## isa ## _t s, v;				\
+										\
+		(void)shim_memcpy(&s, &d->s[i], sizeof(s));			\
+		v = s;								\
+		for (j = 0; j < CPU_VEC_SQRT_LOOPS; j++)			\
+			v = 0.5f * (v + (s / v));				\
+		(void)shim_memcpy(&r[i], &v, sizeof(v));			\
+	}									\
+}
+
+#if defined(STRESS_ARCH_X86_64)
+#define HAVE_CPU_VECTOR_SSE
+STRESS_CPU_VEC_FUNCS(sse, __attribute__((target("sse2"))), 16)
+
+static bool stress_cpu_vec_sse_supported(void)
+{
+	return stress_cpu_x86_has_sse2();
+}
+
+#if defined(HAVE_TARGET_CLONES_AVX2)
+#define HAVE_CPU_VECTOR_AVX2
+STRESS_CPU_VEC_FUNCS(avx2, __attribute__((target("avx2"))), 32)
+#endif
+
+#if defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+#define HAVE_CPU_VECTOR_AVX512
+STRESS_CPU_VEC_FUNCS(avx512, __attribute__((target("avx512f"))), 64)
+#endif
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&		\
+    defined(__aarch64__)
+#define HAVE_CPU_VECTOR_NEON
+STRESS_CPU_VEC_FUNCS(neon, , 16)
+
+static bool stress_cpu_vec_neon_supported(void)
+{
+	/* Advanced SIMD is mandatory on aarch64 */
+	return true;
+}
+#endif
+
+#if defined(HAVE_ARM_SVE)
+/*
+ *  SVE is vector length agnostic so it can't use the fixed width
+ *  vector extension methods, these use the ACLE intrinsics with a
+ *  predicated tail for whatever the hardware vector length is
+ */
+#define HAVE_CPU_VECTOR_SVE
+
+static void OPTIMIZE3 stress_cpu_vec_matrixprod_sve(const stress_cpu_vec_data_t *d, float *r)
+{
+	register uint64_t i, j, k;
+
+	for (i = 0; i < CPU_VEC_MATRIX_N; i++) {
+		for (j = 0; j < CPU_VEC_MATRIX_N; j += svcntw()) {
+			const svbool_t pg = svwhilelt_b32(j, (uint64_t)CPU_VEC_MATRIX_N);
+			svfloat32_t sum = svdup_n_f32(0.0f);
+
+			for (k = 0; k < CPU_VEC_MATRIX_N; k++)
+				sum = svmla_n_f32_x(pg, sum, svld1_f32(pg, &d->b[k][j]), d->a[i][k]);
+			svst1_f32(pg, &r[(i * CPU_VEC_MATRIX_N) + j], sum);
+		}
+	}
+}
+
+static void OPTIMIZE3 stress_cpu_vec_correlate_sve(const stress_cpu_vec_data_t *d, float *r)
+{
+	register uint64_t i, l;
+
+	for (l = 0; l < CPU_VEC_CORR_LAGS; l++) {
+		svfloat32_t sum = svdup_n_f32(0.0f);
+
+		for (i = 0; i < CPU_VEC_CORR_LEN; i += svcntw()) {
+			const svbool_t pg = svwhilelt_b32(i, (uint64_t)CPU_VEC_CORR_LEN);
+
+			/* merging, inactive tail lanes keep their partial sums */
+			sum = svmla_f32_m(pg, sum, svld1_f32(pg, &d->x[i + l]), svld1_f32(pg, &d->y[i]));
+		}
+		r[l] = svaddv_f32(svptrue_b32(), sum);
+	}
+}
+
+static void OPTIMIZE3 stress_cpu_vec_nsqrt_sve(const stress_cpu_vec_data_t *d, float *r)
+{
+	register uint64_t i, j;
+
+	for (i = 0; i < CPU_VEC_SQRT_LEN; i += svcntw()) {
+		const svbool_t pg = svwhilelt_b32(i, (uint64_t)CPU_VEC_SQRT_LEN);
+		const svfloat32_t s = svld1_f32(pg, &d->s[i]);
+		svfloat32_t v = s;
+
+		for (j = 0; j < CPU_VEC_SQRT_LOOPS; j++)
+			v = svmul_n_f32_x(pg, svadd_f32_x(pg, v, svdiv_f32_x(pg, s, v)), 0.5f);
+		svst1_f32(pg, &r[i], v);
+	}
+}
+
+static bool stress_cpu_vec_sve_supported(void)
+{
+	/* built with SVE enabled, so the whole binary needs SVE */
+	return true;
+}
+#endif
+#endif
+
+static bool stress_cpu_vec_scalar_supported(void)
+{
+	return true;
+}
+
+static const stress_cpu_vec_isa_t cpu_vec_isas[] = {
+	{ "scalar",	stress_cpu_vec_scalar_supported,
+		{ stress_cpu_vec_matrixprod_scalar, stress_cpu_vec_correlate_scalar, stress_cpu_vec_nsqrt_scalar } },
+#if defined(HAVE_CPU_VECTOR_SSE)
+	{ "sse",	stress_cpu_vec_sse_supported,
+		{ stress_cpu_vec_matrixprod_sse, stress_cpu_vec_correlate_sse, stress_cpu_vec_nsqrt_sse } },
+#endif
+#if defined(HAVE_CPU_VECTOR_AVX2)
+	{ "avx2",	stress_cpu_x86_has_avx2,
+		{ stress_cpu_vec_matrixprod_avx2, stress_cpu_vec_correlate_avx2, stress_cpu_vec_nsqrt_avx2 } },
+#endif
+#if defined(HAVE_CPU_VECTOR_AVX512)
+	{ "avx512",	stress_cpu_x86_has_avx512_f,
+		{ stress_cpu_vec_matrixprod_avx512, stress_cpu_vec_correlate_avx512, stress_cpu_vec_nsqrt_avx512 } },
+#endif
+#if defined(HAVE_CPU_VECTOR_NEON)
+	{ "neon",	stress_cpu_vec_neon_supported,
+		{ stress_cpu_vec_matrixprod_neon, stress_cpu_vec_correlate_neon, stress_cpu_vec_nsqrt_neon } },
+#endif
+#if defined(HAVE_CPU_VECTOR_SVE)
+	{ "sve",	stress_cpu_vec_sve_supported,
+		{ stress_cpu_vec_matrixprod_sve, stress_cpu_vec_correlate_sve, stress_cpu_vec_nsqrt_sve } },
+#endif
+};
+
+/*
+ *  stress_set_cpu_vector()
+ *	set the ISA of the explicitly vectorised cpu methods
+ */
+static int stress_set_cpu_vector(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(cpu_vec_isas); i++) {
+		if (!strcmp(cpu_vec_isas[i].name, name)) {
+			stress_set_setting("cpu-vector", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "cpu-vector must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(cpu_vec_isas); i++) {
+		(void)fprintf(stderr, " %s", cpu_vec_isas[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_cpu_vec_check()
+ *	check vectorised results against the scalar reference,
+ *	summation order differs so allow a relative tolerance
+ */
+static bool stress_cpu_vec_check(const float *r, const float *ref, const size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		const double diff = fabs((double)r[i] - (double)ref[i]);
+		const double mag = STRESS_MAXIMUM(1.0, fabs((double)ref[i]));
+
+		if (diff > CPU_VEC_TOLERANCE * mag)
+			return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_cpu_vector()
+ *	exercise the explicitly vectorised methods round robin, each
+ *	method's vector results are checked against the scalar reference
+ *	at the start, every 8th round and every round with --verify;
+ *	the scalar runs are also timed to report the vector speedup
+ */
+static int stress_cpu_vector(stress_args_t *args, const size_t isa_index)
+{
+	const stress_cpu_vec_isa_t *isa = &cpu_vec_isas[isa_index];
+	const size_t n_methods = SIZEOF_ARRAY(cpu_vec_methods);
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	stress_cpu_vec_data_t *d;
+	float *r, *ref;
+	double duration[SIZEOF_ARRAY(cpu_vec_methods)];
+	double count[SIZEOF_ARRAY(cpu_vec_methods)];
+	double scalar_duration[SIZEOF_ARRAY(cpu_vec_methods)];
+	double scalar_count[SIZEOF_ARRAY(cpu_vec_methods)];
+	uint32_t round = 0;
+	size_t i, j;
+	int rc = EXIT_SUCCESS;
+
+	if (!isa->supported()) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cpu does not support the %s instruction set, "
+				"skipping stressor\n", args->name, isa->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	d = (stress_cpu_vec_data_t *)calloc(1, sizeof(*d));
+	r = (float *)calloc(CPU_VEC_RESULT_LEN, sizeof(*r));
+	ref = (float *)calloc(CPU_VEC_RESULT_LEN, sizeof(*ref));
+	if (!d || !r || !ref) {
+		pr_inf_skip("%s: cannot allocate vector method data, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_data;
+	}
+
+	for (i = 0; i < CPU_VEC_MATRIX_N; i++) {
+		for (j = 0; j < CPU_VEC_MATRIX_N; j++) {
+			d->a[i][j] = (float)stress_mwc16() / 65536.0f;
+			d->b[i][j] = (float)stress_mwc16() / 65536.0f;
+		}
+	}
+	for (i = 0; i < SIZEOF_ARRAY(d->x); i++)
+		d->x[i] = (float)stress_mwc16() / 65536.0f;
+	for (i = 0; i < SIZEOF_ARRAY(d->y); i++)
+		d->y[i] = (float)stress_mwc16() / 65536.0f;
+	for (i = 0; i < SIZEOF_ARRAY(d->s); i++)
+		d->s[i] = 1.0f + (float)stress_mwc16() / 64.0f;
+
+	for (i = 0; i < n_methods; i++) {
+		duration[i] = 0.0;
+		count[i] = 0.0;
+		scalar_duration[i] = 0.0;
+		scalar_count[i] = 0.0;
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: using %s vectorised methods\n", args->name, isa->name);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		const bool check = verify || ((round & 7) == 0);
+
+		for (i = 0; (i < n_methods) && stress_continue(args); i++) {
+			const stress_cpu_vec_method_t *method = &cpu_vec_methods[i];
+			double t;
+
+			t = stress_time_now();
+			isa->funcs[i](d, r);
+			duration[i] += stress_time_now() - t;
+			count[i] += 1.0;
+			stress_bogo_inc(args);
+
+			if (!check)
+				continue;
+			t = stress_time_now();
+			method->scalar(d, ref);
+			scalar_duration[i] += stress_time_now() - t;
+			scalar_count[i] += 1.0;
+
+			if (!stress_cpu_vec_check(r, ref, method->len)) {
+				pr_fail("%s: %s %s results differ from the scalar reference\n",
+					args->name, isa->name, method->name);
+				rc = EXIT_FAILURE;
+				goto finish;
+			}
+		}
+		round++;
+	} while (stress_continue(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0, j = 0; i < n_methods; i++) {
+		const double rate = (duration[i] > 0.0) ? count[i] / duration[i] : 0.0;
+		const double scalar_rate = (scalar_duration[i] > 0.0) ? scalar_count[i] / scalar_duration[i] : 0.0;
+		char msg[64];
+
+		(void)snprintf(msg, sizeof(msg), "%s %s ops per sec", isa->name, cpu_vec_methods[i].name);
+		stress_metrics_set(args, j++, msg, rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s speedup vs scalar", cpu_vec_methods[i].name);
+		stress_metrics_set(args, j++, msg,
+			(scalar_rate > 0.0) ? rate / scalar_rate : 0.0, STRESS_GEOMETRIC_MEAN);
+	}
+
+free_data:
+	free(ref);
+	free(r);
+	free(d);
+
+	return rc;
+}
+
 /*
  *  stress_per_cpu_time()
  *	try to get accurage CPU time from CPUTIME clock,
@@ -2926,6 +3496,159 @@ static double stress_per_cpu_time(void)
 	return stress_time_now();
 }
 
+/*
+ *  stress_set_cpu_calibrate()
+ *	set the file to save the calibrated per method rates to
+ */
+static int stress_set_cpu_calibrate(const char *opt)
+{
+	return stress_set_setting("cpu-calibrate", TYPE_ID_STR, opt);
+}
+
+/*
+ *  stress_set_cpu_profile()
+ *	set the reference profile file of per method rates
+ */
+static int stress_set_cpu_profile(const char *opt)
+{
+	return stress_set_setting("cpu-profile", TYPE_ID_STR, opt);
+}
+
+/*
+ *  stress_cpu_profile_load()
+ *	load a reference profile of "method ops-per-sec" lines as
+ *	saved by --cpu-calibrate into rates[], methods not in the
+ *	profile keep the built in reference rate, returns number
+ *	of methods loaded or -1 if the file cannot be read
+ */
+static int stress_cpu_profile_load(const char *name, const char *filename, double *rates)
+{
+	FILE *fp;
+	char buf[256];
+	int loaded = 0;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_inf("%s: cannot open cpu profile '%s', errno=%d (%s), "
+			"using built in reference rates\n",
+			name, filename, errno, strerror(errno));
+		return -1;
+	}
+	while (fgets(buf, sizeof(buf), fp)) {
+		char method[64];
+		double rate;
+		size_t i;
+
+		if (buf[0] == '#')
+			continue;
+		if (sscanf(buf, "%63s %lf", method, &rate) != 2)
+			continue;
+		if (rate <= 0.0)
+			continue;
+		for (i = 1; i < SIZEOF_ARRAY(cpu_methods); i++) {
+			if (!strcmp(cpu_methods[i].name, method)) {
+				rates[i] = rate;
+				loaded++;
+				break;
+			}
+		}
+	}
+	(void)fclose(fp);
+
+	return loaded;
+}
+
+/*
+ *  stress_cpu_calibrate()
+ *	measure the rate of each cpu method on this host, methods are
+ *	run round robin for ~10ms slices until the run ends; instance 0
+ *	reports the per method ns per op and the score against the
+ *	reference rates (1.0 = reference machine) and saves the
+ *	measured rates as a profile that can be used with --cpu-profile
+ */
+static int stress_cpu_calibrate(
+	stress_args_t *args,
+	const char *filename,
+	const double *ref_rates,
+	double *counter)
+{
+	const size_t n = SIZEOF_ARRAY(cpu_methods);
+	double *duration, *count;
+	double log_score_sum = 0.0;
+	size_t i, scored = 0;
+
+	duration = (double *)calloc(n, sizeof(*duration));
+	count = (double *)calloc(n, sizeof(*count));
+	if (!duration || !count) {
+		pr_inf_skip("%s: cannot allocate calibration data, skipping stressor\n",
+			args->name);
+		free(count);
+		free(duration);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		/* Skip over stress_cpu_all */
+		for (i = 1; (i < n) && stress_continue(args); i++) {
+			const double t_start = stress_per_cpu_time();
+			const double t_end = t_start + 0.01;
+			double t;
+
+			do {
+				stress_cpu_method(i, args, counter);
+				count[i] += 1.0;
+				t = stress_per_cpu_time();
+			} while ((t < t_end) && stress_continue_flag());
+			duration[i] += t - t_start;
+		}
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		FILE *fp = NULL;
+
+		if (filename) {
+			fp = fopen(filename, "w");
+			if (fp)
+				(void)fprintf(fp, "# stress-ng cpu method profile: method ops-per-sec\n");
+			else
+				pr_inf("%s: cannot create cpu profile '%s', errno=%d (%s)\n",
+					args->name, filename, errno, strerror(errno));
+		}
+
+		pr_inf("%s: %-16s %12s %12s %8s\n", args->name,
+			"method", "ops per sec", "ns per op", "score");
+		for (i = 1; i < n; i++) {
+			double rate, score;
+
+			if ((duration[i] <= 0.0) || (count[i] < 1.0))
+				continue;
+			rate = count[i] / duration[i];
+			score = rate / ref_rates[i];
+			log_score_sum += shim_log(score);
+			scored++;
+
+			pr_inf("%s: %-16s %12.2f %12.2f %8.3f\n", args->name,
+				cpu_methods[i].name, rate, STRESS_DBL_NANOSECOND / rate, score);
+			if (fp)
+				(void)fprintf(fp, "%s %f\n", cpu_methods[i].name, rate);
+		}
+		if (fp)
+			(void)fclose(fp);
+	}
+	if (scored > 0)
+		stress_metrics_set(args, 0, "score vs reference (geomean)",
+			shim_exp(log_score_sum / (double)scored), STRESS_GEOMETRIC_MEAN);
+
+	free(count);
+	free(duration);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_cpu()
  *	stress CPU by doing floating point math ops
@@ -2938,13 +3661,21 @@ static int HOT OPTIMIZE3 stress_cpu(stress_args_t *args)
 	int32_t cpu_load_slice = -64;
 	double counter = 0.0;
 	bool cpu_old_metrics = false;
-	size_t i;
+	size_t i, cpu_vector = 0;
+	char *cpu_calibrate = NULL, *cpu_profile = NULL;
+	bool calibrate;
+	double ref_rates[SIZEOF_ARRAY(cpu_methods)];
 
 	stress_catch_sigill();
 
+	if (stress_get_setting("cpu-vector", &cpu_vector))
+		return stress_cpu_vector(args, cpu_vector);
+
 	(void)stress_get_setting("cpu-load-slice", &cpu_load_slice);
 	(void)stress_get_setting("cpu-old-metrics", &cpu_old_metrics);
 	(void)stress_get_setting("cpu-method", &cpu_method);
+	calibrate = stress_get_setting("cpu-calibrate", &cpu_calibrate);
+	(void)stress_get_setting("cpu-profile", &cpu_profile);
 	if (stress_get_setting("cpu-load", &cpu_load)) {
 		if (cpu_method == 0)
 			pr_inf("%s: for stable load results, select a "
@@ -2953,14 +3684,27 @@ static int HOT OPTIMIZE3 stress_cpu(stress_args_t *args)
 				args->name);
 	}
 
+	for (i = 0; i < SIZEOF_ARRAY(ref_rates); i++)
+		ref_rates[i] = cpu_methods[i].bogo_op_rate;
+	if (cpu_profile) {
+		const int loaded = stress_cpu_profile_load(args->name, cpu_profile, ref_rates);
+
+		if ((loaded >= 0) && (args->instance == 0))
+			pr_dbg("%s: loaded %d method rates from cpu profile '%s'\n",
+				args->name, loaded, cpu_profile);
+	}
+
 	if (cpu_old_metrics) {
 		for (i = 0; i < SIZEOF_ARRAY(stress_cpu_counter_scale); i++)
 			stress_cpu_counter_scale[i] = 1.0;
 	} else {
 		for (i = 0; i < SIZEOF_ARRAY(stress_cpu_counter_scale); i++)
-			stress_cpu_counter_scale[i] = 1484.50 / cpu_methods[i].bogo_op_rate;
+			stress_cpu_counter_scale[i] = 1484.50 / ref_rates[i];
 	}
 
+	if (calibrate)
+		return stress_cpu_calibrate(args, cpu_calibrate, ref_rates, &counter);
+
 	if (args->instance == 0)
 		pr_dbg("%s: using method '%s'\n", args->name, cpu_methods[cpu_method].name);
 
@@ -2981,9 +3725,13 @@ static int HOT OPTIMIZE3 stress_cpu(stress_args_t *args)
 	 * Normal use case, 100% load, simple spinning on CPU
 	 */
 	if (cpu_load == 100) {
-		do {
-			stress_cpu_method(cpu_method, args, &counter);
-		} while (stress_continue(args));
+		if (cpu_method != 0) {
+			stress_cpu_method_batched(cpu_method, args, &counter);
+		} else {
+			do {
+				stress_cpu_method(cpu_method, args, &counter);
+			} while (stress_continue(args));
+		}
 
 		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 		return EXIT_SUCCESS;
@@ -3089,10 +3837,13 @@ static void stress_cpu_set_default(void)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_cpu_calibrate,	stress_set_cpu_calibrate },
 	{ OPT_cpu_load,		stress_set_cpu_load },
 	{ OPT_cpu_load_slice,	stress_set_cpu_load_slice },
 	{ OPT_cpu_method,	stress_set_cpu_method },
 	{ OPT_cpu_old_metrics,	stress_set_cpu_old_metrics },
+	{ OPT_cpu_profile,	stress_set_cpu_profile },
+	{ OPT_cpu_vector,	stress_set_cpu_vector },
 	{ 0,			NULL },
 };
 
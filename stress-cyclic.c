@@ -21,6 +21,8 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-killpid.h"
+#include "core-latency.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
@@ -35,20 +37,27 @@ typedef struct {
 	const char	*opt_name;	/* option name */
 } stress_policy_t;
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_SCHED_GETAFFINITY) &&		\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define HAVE_CYCLIC_SMP
+#endif
+
+/*
+ *  Latency statistics of one measurement thread, every sample is
+ *  recorded in constant memory, the mean and variance are kept
+ *  with Welford's online algorithm
+ */
 typedef struct {
 	int64_t		min_ns;		/* min latency */
 	int64_t		max_ns;		/* max latency */
-	int64_t		*latencies;	/* latency samples */
-	size_t		latencies_size;	/* size of latencies allocation */
-	size_t		cyclic_samples;	/* number of latency samples */
-	size_t		index;		/* index into latencies */
-	size_t		index_reqd;	/* theoretic size of index required for the run */
-	int32_t		min_prio;	/* min priority allowed */
-	int32_t		max_prio;	/* max priority allowed */
-	double		ns;		/* total nanosecond latency */
-	double		latency_mean;	/* average latency */
-	int64_t		latency_mode;	/* first mode */
-	double		std_dev;	/* standard deviation */
+	uint64_t	samples;	/* number of latency samples */
+	double		latency_mean;	/* running mean latency */
+	double		latency_m2;	/* running sum of squared differences from the mean */
+	uint64_t	cyclic_dist;	/* distribution interval, 0 = none */
+	int32_t		cpu;		/* CPU the thread is pinned to, -1 = not pinned */
+	uint64_t	dist[MAX_BUCKETS]; /* --cyclic-dist interval counts */
+	stress_latency_t latency;	/* latency histogram */
 } stress_rt_stats_t;
 
 typedef int (*stress_cyclic_func)(stress_args_t *args, stress_rt_stats_t *rt_stats, uint64_t cyclic_sleep);
@@ -65,8 +74,9 @@ static const stress_help_t help[] = {
 	{ NULL,	"cyclic-ops N",		"stop after N cyclic timing cycles" },
 	{ NULL,	"cyclic-policy P",	"used rr or fifo scheduling policy" },
 	{ NULL,	"cyclic-prio N",	"real time scheduling priority 1..100" },
-	{ NULL, "cyclic-samples N",	"number of latency samples to take" },
+	{ NULL, "cyclic-samples N",	"ignored, all latency samples are recorded" },
 	{ NULL,	"cyclic-sleep N",	"sleep time of real time timer in nanosecs" },
+	{ NULL,	"cyclic-smp",		"run a pinned measurement thread on each CPU" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -130,6 +140,11 @@ static int stress_set_cyclic_dist(const char *opt)
 	return stress_set_setting("cyclic-dist", TYPE_ID_UINT64, &cyclic_dist);
 }
 
+static int stress_set_cyclic_smp(const char *opt)
+{
+	return stress_set_setting_true("cyclic-smp", opt);
+}
+
 static int stress_set_cyclic_samples(const char *opt)
 {
 	size_t cyclic_samples;
@@ -139,6 +154,34 @@ static int stress_set_cyclic_samples(const char *opt)
 	return stress_set_setting("cyclic-samples", TYPE_ID_SIZE_T, &cyclic_samples);
 }
 
+/*
+ *  stress_cyclic_sample()
+ *	record a latency sample
+ */
+static inline void stress_cyclic_sample(
+	stress_rt_stats_t *rt_stats,
+	const int64_t delta_ns)
+{
+	double diff;
+
+	if (delta_ns < rt_stats->min_ns)
+		rt_stats->min_ns = delta_ns;
+	if (delta_ns > rt_stats->max_ns)
+		rt_stats->max_ns = delta_ns;
+	if (rt_stats->cyclic_dist && (delta_ns >= 0)) {
+		const uint64_t i = (uint64_t)delta_ns / rt_stats->cyclic_dist;
+
+		if (i < MAX_BUCKETS)
+			rt_stats->dist[i]++;
+	}
+	stress_latency_add(&rt_stats->latency, (delta_ns > 0) ? (uint64_t)delta_ns : 0);
+
+	rt_stats->samples++;
+	diff = (double)delta_ns - rt_stats->latency_mean;
+	rt_stats->latency_mean += diff / (double)rt_stats->samples;
+	rt_stats->latency_m2 += diff * ((double)delta_ns - rt_stats->latency_mean);
+}
+
 #if (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_NANOSLEEP)) ||	\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_NANOSLEEP)) ||		\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_PSELECT)) ||		\
@@ -155,11 +198,7 @@ static void stress_cyclic_stats(
 		   (t2->tv_nsec - t1->tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < rt_stats->cyclic_samples)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-	rt_stats->index_reqd++;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_sample(rt_stats, delta_ns);
 }
 #else
 	UNEXPECTED
@@ -256,11 +295,7 @@ static int stress_cyclic_poll(
 		if (delta_ns >= (int64_t)cyclic_sleep) {
 			delta_ns -= cyclic_sleep;
 
-			if (rt_stats->index < rt_stats->cyclic_samples)
-				rt_stats->latencies[rt_stats->index++] = delta_ns;
-			rt_stats->index_reqd++;
-
-			rt_stats->ns += (double)delta_ns;
+			stress_cyclic_sample(rt_stats, delta_ns);
 			break;
 		}
 	}
@@ -356,11 +391,7 @@ static int stress_cyclic_itimer(
 		(itimer_time.tv_nsec - t1.tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < rt_stats->cyclic_samples)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-	rt_stats->index_reqd++;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_sample(rt_stats, delta_ns);
 
 	(void)timer_delete(timerid);
 
@@ -419,73 +450,59 @@ static void NORETURN MLOCKED_TEXT stress_rlimit_handler(int signum)
 }
 
 /*
- *  stress_cyclic_cmp()
- *	sort latencies into order, least first
+ *  stress_rt_stats_init()
+ *	reset latency statistics
  */
-static int stress_cyclic_cmp(const void *p1, const void *p2)
+static void stress_rt_stats_init(
+	stress_rt_stats_t *rt_stats,
+	const uint64_t cyclic_dist,
+	const int32_t cpu)
 {
-	const int64_t *i1 = (const int64_t *)p1;
-	const int64_t *i2 = (const int64_t *)p2;
-
-	if (*i1 > *i2)
-		return 1;
-	else if (*i1 < *i2)
-		return -1;
-	return 0;
+	(void)shim_memset(rt_stats, 0, sizeof(*rt_stats));
+	rt_stats->min_ns = INT64_MAX;
+	rt_stats->max_ns = INT64_MIN;
+	rt_stats->cyclic_dist = cyclic_dist;
+	rt_stats->cpu = cpu;
 }
 
 /*
- *  stress_rt_stats()
- *	compute statistics on gathered latencies
+ *  stress_rt_stats_merge()
+ *	add the statistics of src to dst, the means and
+ *	variances are combined with Chan's parallel algorithm
  */
-static void stress_rt_stats(stress_rt_stats_t *rt_stats)
+static void stress_rt_stats_merge(stress_rt_stats_t *dst, const stress_rt_stats_t *src)
 {
+	double n, delta;
 	size_t i;
-	size_t n = 0, best_n = 0;
-	int64_t current;
-	double variance = 0.0;
-
-	rt_stats->latency_mean = 0.0;
-	rt_stats->latency_mode = 0;
 
-	for (i = 0; i < rt_stats->index; i++) {
-		int64_t ns = rt_stats->latencies[i];
-
-		if (ns > rt_stats->max_ns)
-			rt_stats->max_ns = ns;
-		if (ns < rt_stats->min_ns)
-			rt_stats->min_ns = ns;
-
-		rt_stats->latency_mean += (double)ns;
-	}
-	if (rt_stats->index)
-		rt_stats->latency_mean /= (double)rt_stats->index;
-
-	qsort(rt_stats->latencies, rt_stats->index, sizeof(*(rt_stats->latencies)), stress_cyclic_cmp);
-
-	current = rt_stats->latency_mode = rt_stats->latencies[0];
+	if (src->samples == 0)
+		return;
 
-	for (i = 0; i < rt_stats->index; i++) {
-		int64_t ns = rt_stats->latencies[i];
-		double diff;
+	if (src->min_ns < dst->min_ns)
+		dst->min_ns = src->min_ns;
+	if (src->max_ns > dst->max_ns)
+		dst->max_ns = src->max_ns;
+	for (i = 0; i < MAX_BUCKETS; i++)
+		dst->dist[i] += src->dist[i];
+	stress_latency_merge(&dst->latency, &src->latency);
+
+	n = (double)dst->samples + (double)src->samples;
+	delta = src->latency_mean - dst->latency_mean;
+	dst->latency_mean += delta * (double)src->samples / n;
+	dst->latency_m2 += src->latency_m2 +
+		(delta * delta * (double)dst->samples * (double)src->samples / n);
+	dst->samples += src->samples;
+}
 
-		if (ns == current) {
-			n++;
-			if (n > best_n) {
-				rt_stats->latency_mode = current;
-				best_n = n;
-			}
-		} else {
-			current = ns;
-			n = 0;
-		}
-		diff = ((double)ns - rt_stats->latency_mean);
-		variance += (diff * diff);
-	}
-	if (rt_stats->index) {
-		variance /= (double)rt_stats->index;
-		rt_stats->std_dev = sqrt(variance);
-	}
+/*
+ *  stress_rt_std_dev()
+ *	standard deviation of the latencies
+ */
+static double stress_rt_std_dev(const stress_rt_stats_t *rt_stats)
+{
+	if (rt_stats->samples == 0)
+		return 0.0;
+	return sqrt(rt_stats->latency_m2 / (double)rt_stats->samples);
 }
 
 /*
@@ -553,32 +570,19 @@ static int stress_set_cyclic_method(const char *name)
  */
 static void stress_rt_dist(
 	const char *name,
-	stress_rt_stats_t *rt_stats,
+	const stress_rt_stats_t *rt_stats,
 	const int64_t cyclic_dist)
 {
-	const ssize_t dist_max_size = (cyclic_dist > 0) ?
+	const ssize_t dist_max_size = ((cyclic_dist > 0) && (rt_stats->max_ns > 0)) ?
 		((ssize_t)rt_stats->max_ns / (ssize_t)cyclic_dist) + 1 : 1;
 	const ssize_t dist_size = STRESS_MINIMUM(MAX_BUCKETS, dist_max_size);
 	const ssize_t dist_min = STRESS_MINIMUM(5, dist_max_size);
+	const uint64_t *dist = rt_stats->dist;
 	ssize_t i, n;
-	int64_t *dist;
 
 	if (!cyclic_dist)
 		return;
 
-	dist = (int64_t *)calloc(dist_size, sizeof(*dist));
-	if (!dist) {
-		pr_inf("%s: cannot allocate distribution stats buffer, cannot log distribution\n", name);
-		return;
-	}
-
-	for (i = 0; i < (ssize_t)rt_stats->index; i++) {
-		int64_t lat = rt_stats->latencies[i] / cyclic_dist;
-
-		if (lat < (int64_t)dist_size)
-			dist[lat]++;
-	}
-
 	for (n = dist_size; n >= 1; n--) {
 		if (dist[n - 1])
 			break;
@@ -592,7 +596,7 @@ static void stress_rt_dist(
 	pr_inf("%s: (for the first %zd buckets of %zd)\n", name, dist_size, dist_max_size);
 	pr_inf("%s: %12s %10s\n", name, "latency (ns)", "frequency");
 	for (i = 0; i < n; i++) {
-		pr_inf("%s: %12" PRIu64 " %10" PRId64 "\n",
+		pr_inf("%s: %12" PRIu64 " %10" PRIu64 "\n",
 			name, cyclic_dist * i, dist[i]);
 	}
 
@@ -608,7 +612,146 @@ static void stress_rt_dist(
 				name, cyclic_dist * i, (int64_t)0);
 		}
 	}
-	free(dist);
+}
+
+#if defined(HAVE_CYCLIC_SMP)
+/* Per CPU measurement thread, cyclictest -S style */
+typedef struct {
+	stress_args_t *args;		/* stressor args */
+	stress_rt_stats_t *rt_stats;	/* this thread's statistics */
+	stress_cyclic_func func;	/* cyclic method */
+	uint64_t cyclic_sleep;		/* sleep time in nanosecs */
+	double end;			/* time to stop measuring */
+	pthread_t pthread;		/* measurement thread */
+	int ret;			/* pthread_create return */
+} stress_cyclic_thread_t;
+
+/*
+ *  stress_cyclic_thread()
+ *	pin to a CPU and measure latencies until told to stop,
+ *	signals are left to the main thread
+ */
+static void *stress_cyclic_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_cyclic_thread_t *thread = (stress_cyclic_thread_t *)arg;
+	stress_rt_stats_t *rt_stats = thread->rt_stats;
+	cpu_set_t mask;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	CPU_ZERO(&mask);
+	CPU_SET(rt_stats->cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("%s: cannot pin measurement thread to CPU %" PRId32 ", errno=%d (%s)\n",
+			thread->args->name, rt_stats->cpu, errno, strerror(errno));
+		rt_stats->cpu = -1;
+	}
+
+	while (stress_continue_flag() && (stress_time_now() < thread->end))
+		(void)thread->func(thread->args, rt_stats, thread->cyclic_sleep);
+
+	return &nowt;
+}
+
+/*
+ *  stress_cyclic_smp()
+ *	run one pinned measurement thread per CPU in rt_stats[],
+ *	the calling thread tracks the bogo ops and run time
+ */
+static int stress_cyclic_smp(
+	stress_args_t *args,
+	stress_rt_stats_t *rt_stats,
+	const size_t n_stats,
+	const stress_cyclic_func func,
+	const uint64_t cyclic_sleep,
+	const double end)
+{
+	stress_cyclic_thread_t *threads;
+	size_t i, started = 0;
+
+	threads = (stress_cyclic_thread_t *)calloc(n_stats, sizeof(*threads));
+	if (!threads) {
+		pr_inf("%s: cannot allocate %zu measurement threads\n", args->name, n_stats);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = 0; i < n_stats; i++) {
+		threads[i].args = args;
+		threads[i].rt_stats = &rt_stats[i];
+		threads[i].func = func;
+		threads[i].cyclic_sleep = cyclic_sleep;
+		threads[i].end = end;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+						stress_cyclic_thread, (void *)&threads[i]);
+		if (threads[i].ret)
+			pr_inf("%s: cannot create measurement thread for CPU %" PRId32 ", errno=%d (%s)\n",
+				args->name, rt_stats[i].cpu, threads[i].ret, strerror(threads[i].ret));
+		else
+			started++;
+	}
+
+	while (started && stress_continue(args) && (stress_time_now() < end)) {
+		uint64_t samples = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_stats; i++)
+			samples += rt_stats[i].samples;
+		stress_bogo_set(args, samples);
+	}
+	stress_continue_set_flag(false);
+
+	for (i = 0; i < n_stats; i++) {
+		if (threads[i].ret == 0)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+	free(threads);
+
+	return started ? EXIT_SUCCESS : EXIT_NO_RESOURCE;
+}
+#endif
+
+/*
+ *  stress_cyclic_cpus()
+ *	fill cpus[] with the CPUs this process may run on for
+ *	the per CPU mode, returns the number of CPUs, 1 (not
+ *	pinned) if there is no per CPU mode
+ */
+static size_t stress_cyclic_cpus(
+	stress_args_t *args,
+	const bool cyclic_smp,
+	int32_t *cpus)
+{
+#if defined(HAVE_CYCLIC_SMP)
+	cpu_set_t mask;
+	size_t n = 0;
+	int32_t cpu;
+
+	if (!cyclic_smp)
+		goto single;
+
+	if (sched_getaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_inf("%s: sched_getaffinity failed, errno=%d (%s), "
+			"using a single measurement thread\n",
+			args->name, errno, strerror(errno));
+		goto single;
+	}
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &mask))
+			cpus[n++] = cpu;
+	}
+	if (n > 0)
+		return n;
+single:
+#else
+	if (cyclic_smp && (args->instance == 0))
+		pr_inf("%s: --cyclic-smp is not supported on this system, "
+			"using a single measurement thread\n", args->name);
+#endif
+	cpus[0] = -1;
+	return 1;
 }
 
 /*
@@ -626,6 +769,84 @@ static int stress_cyclic_supported(const char *name)
 	return 0;
 }
 
+/*
+ *  stress_rt_report()
+ *	report merged latency statistics, and per CPU
+ *	maxima and p99.99 latencies in the per CPU mode
+ */
+static void stress_rt_report(
+	stress_args_t *args,
+	const stress_rt_stats_t *rt_stats,
+	const size_t n_stats,
+	const stress_rt_stats_t *merged,
+	const char *policy_name,
+	const uint64_t cyclic_sleep,
+	const uint64_t cyclic_dist)
+{
+	size_t i;
+
+	static const double percentiles[] = {
+		25.0,
+		50.0,
+		75.0,
+		90.0,
+		95.40,
+		99.0,
+		99.5,
+		99.9,
+		99.99,
+		99.999,
+	};
+
+	pr_block_begin();
+	pr_inf("%s: sched %s: %" PRIu64 " ns delay, %" PRIu64 " samples\n",
+		args->name,
+		policy_name,
+		cyclic_sleep,
+		merged->samples);
+	pr_inf( "%s:   mean: %.2f ns, mode: %" PRIu64 " ns\n",
+		args->name,
+		merged->latency_mean,
+		stress_latency_mode(&merged->latency));
+	pr_inf("%s:   min: %" PRId64 " ns, max: %" PRId64 " ns, std.dev. %.2f\n",
+		args->name,
+		merged->min_ns,
+		merged->max_ns,
+		stress_rt_std_dev(merged));
+
+	pr_inf("%s: latency percentiles:\n", args->name);
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		pr_inf("%s:   %6.3f%%: %10" PRIu64 " ns\n",
+			args->name,
+			percentiles[i],
+			stress_latency_percentile(&merged->latency, percentiles[i]));
+	}
+
+	if ((n_stats > 1) || (rt_stats[0].cpu >= 0)) {
+		pr_inf("%s: per CPU latencies:\n", args->name);
+		pr_inf("%s: %5s %12s %10s %10s %11s %10s\n", args->name,
+			"CPU", "samples", "min (ns)", "mean (ns)", "p99.99 (ns)", "max (ns)");
+		for (i = 0; i < n_stats; i++) {
+			const stress_rt_stats_t *cpu_stats = &rt_stats[i];
+
+			if (cpu_stats->samples == 0) {
+				pr_inf("%s: %5" PRId32 " %12d %10s %10s %11s %10s\n", args->name,
+					cpu_stats->cpu, 0, "-", "-", "-", "-");
+				continue;
+			}
+			pr_inf("%s: %5" PRId32 " %12" PRIu64 " %10" PRId64 " %10.2f %11" PRIu64 " %10" PRId64 "\n",
+				args->name, cpu_stats->cpu, cpu_stats->samples,
+				cpu_stats->min_ns, cpu_stats->latency_mean,
+				stress_latency_percentile(&cpu_stats->latency, 99.99),
+				cpu_stats->max_ns);
+		}
+	}
+	stress_rt_dist(args->name, merged, (int64_t)cyclic_dist);
+	pr_inf("%s: percentiles and mode are to the nearest ~3%%, mean, min and max are exact\n",
+		args->name);
+	pr_block_end();
+}
+
 static int stress_cyclic(stress_args_t *args)
 {
 	const uint32_t num_instances = args->num_instances;
@@ -636,14 +857,17 @@ static int stress_cyclic(stress_args_t *args)
 	uint64_t cyclic_sleep = DEFAULT_DELAY_NS;
 	uint64_t cyclic_dist = 0;
 	int32_t cyclic_prio = INT32_MAX;
+	int32_t max_prio;
 	size_t cyclic_samples = DEFAULT_SAMPLES;
 	int policy, rc = EXIT_SUCCESS;
 	size_t cyclic_policy = 0;
 	size_t cyclic_method = 0;
+	bool cyclic_smp = false;
 	const double start = stress_time_now();
-	stress_rt_stats_t *rt_stats;
+	stress_rt_stats_t *rt_stats, *merged;
+	int32_t *cpus;
+	size_t i, n_stats, size;
 	const size_t page_size = args->page_size;
-	const size_t size = (sizeof(*rt_stats) + page_size - 1) & (~(page_size - 1));
 	stress_cyclic_func func;
 
 	timeout  = g_opt_timeout;
@@ -653,9 +877,7 @@ static int stress_cyclic(stress_args_t *args)
 	(void)stress_get_setting("cyclic-prio", &cyclic_prio);
 	(void)stress_get_setting("cyclic-samples", &cyclic_samples);
 	(void)stress_get_setting("cyclic-sleep", &cyclic_sleep);
-
-	func = cyclic_methods[cyclic_method].func;
-	policy = policies[cyclic_policy].policy;
+	(void)stress_get_setting("cyclic-smp", &cyclic_smp);
 
 	if (!args->instance) {
 		if (num_policies == 0) {
@@ -666,6 +888,46 @@ static int stress_cyclic(stress_args_t *args)
 		}
 	}
 
+	cpus = (int32_t *)calloc((size_t)CPU_SETSIZE, sizeof(*cpus));
+	if (!cpus) {
+		pr_inf_skip("%s: cannot allocate CPU list, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	n_stats = stress_cyclic_cpus(args, cyclic_smp, cpus);
+	cyclic_smp = (cpus[0] >= 0);
+
+	if (cyclic_smp) {
+		/* itimer signals are process wide, cannot measure per CPU */
+		if (!strcmp(cyclic_methods[cyclic_method].name, "itimer")) {
+			cyclic_method = (cyclic_method == 0) ? 1 : 0;
+			if (cyclic_method >= SIZEOF_ARRAY(cyclic_methods)) {
+				pr_inf_skip("%s: no per CPU cyclic methods available, skipping stressor\n",
+					args->name);
+				free(cpus);
+				return EXIT_NOT_IMPLEMENTED;
+			}
+			if (args->instance == 0)
+				pr_inf("%s: itimer cannot be used with --cyclic-smp, using %s\n",
+					args->name, cyclic_methods[cyclic_method].name);
+		}
+#if defined(SCHED_DEADLINE)
+		/* deadline tasks cannot create threads */
+		if ((policies[cyclic_policy].policy == SCHED_DEADLINE) &&
+		    (num_policies > 1)) {
+			cyclic_policy = 1;
+			if (args->instance == 0)
+				pr_inf("%s: DEADLINE cannot be used with --cyclic-smp, using %s\n",
+					args->name, policies[cyclic_policy].name);
+		}
+#endif
+	}
+	if ((cyclic_samples != DEFAULT_SAMPLES) && (args->instance == 0))
+		pr_inf("%s: --cyclic-samples is ignored, all latency samples are recorded\n",
+			args->name);
+
+	func = cyclic_methods[cyclic_method].func;
+	policy = policies[cyclic_policy].policy;
+
 	if (g_opt_timeout == TIMEOUT_NOT_SET) {
 		timeout = 60;
 		pr_inf("%s: timeout has not been set, forcing timeout to "
@@ -677,49 +939,36 @@ static int stress_cyclic(stress_args_t *args)
 			"this stressor\n", args->name);
 	}
 
+	size = ((n_stats * sizeof(*rt_stats)) + page_size - 1) & (~(page_size - 1));
 	rt_stats = (stress_rt_stats_t *)stress_mmap_populate(NULL, size,
 						PROT_READ | PROT_WRITE,
 						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
 	if (rt_stats == MAP_FAILED) {
 		pr_inf_skip("%s: mmap of shared statistics data failed: %d (%s)\n",
 			args->name, errno, strerror(errno));
+		free(cpus);
 		return EXIT_NO_RESOURCE;
 	}
-	rt_stats->cyclic_samples = cyclic_samples;
-	rt_stats->latencies_size = cyclic_samples * sizeof(*rt_stats->latencies);
-	rt_stats->latencies = (int64_t *)stress_mmap_populate(NULL,
-						rt_stats->latencies_size,
-						PROT_READ | PROT_WRITE,
-						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-	if (rt_stats->latencies == MAP_FAILED) {
-		pr_inf_skip("%s: mmap of %zd samples failed: %d (%s)\n",
-			args->name, cyclic_samples, errno, strerror(errno));
-		(void)munmap((void *)rt_stats, size);
-		return EXIT_NO_RESOURCE;
-	}
-	rt_stats->min_ns = INT64_MAX;
-	rt_stats->max_ns = INT64_MIN;
-	rt_stats->ns = 0.0;
-#if defined(HAVE_SCHED_GET_PRIORITY_MIN)
-	rt_stats->min_prio = sched_get_priority_min(policy);
-#else
-	rt_stats->min_prio = 0;
-#endif
+	for (i = 0; i < n_stats; i++)
+		stress_rt_stats_init(&rt_stats[i], cyclic_dist, cpus[i]);
+	free(cpus);
 
 #if defined(HAVE_SCHED_GET_PRIORITY_MAX)
-	rt_stats->max_prio = sched_get_priority_max(policy);
+	max_prio = sched_get_priority_max(policy);
 #else
-	rt_stats->max_prio = 0;
+	max_prio = 0;
 #endif
 	/* If user has set max priority.. */
 	if (cyclic_prio != INT32_MAX) {
-		if (rt_stats->max_prio > cyclic_prio) {
-			rt_stats->max_prio = cyclic_prio;
+		if (max_prio > cyclic_prio) {
+			max_prio = cyclic_prio;
 		}
 	}
 
 	if (args->instance == 0)
-		pr_dbg("%s: using method '%s'\n", args->name, cyclic_methods[cyclic_method].name);
+		pr_dbg("%s: using method '%s' with %zu measurement thread%s\n",
+			args->name, cyclic_methods[cyclic_method].name,
+			n_stats, (n_stats == 1) ? "" : "s");
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -732,7 +981,6 @@ again:
 			goto finish;
 		pr_inf("%s: cannot fork, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 		(void)munmap((void *)rt_stats, size);
 		return EXIT_NO_RESOURCE;
 	} else if (pid == 0) {
@@ -747,10 +995,11 @@ again:
 		 * We run the stressor as a child so that
 		 * if we the hard time timits the child is
 		 * terminated with a SIGKILL and we can
-		 * catch that with the parent
+		 * catch that with the parent, the CPU limit
+		 * is shared by all the measurement threads
 		 */
-		rlim.rlim_cur = timeout;
-		rlim.rlim_max = timeout;
+		rlim.rlim_cur = timeout * n_stats;
+		rlim.rlim_max = timeout * n_stats;
 		(void)setrlimit(RLIMIT_CPU, &rlim);
 
 #if defined(RLIMIT_RTTIME)
@@ -771,7 +1020,7 @@ again:
 #if defined(SCHED_DEADLINE)
 redo_policy:
 #endif
-		ret = stress_set_sched(mypid, policy, rt_stats->max_prio, true);
+		ret = stress_set_sched(mypid, policy, max_prio, true);
 		if (ret < 0) {
 #if defined(SCHED_DEADLINE)
 			/*
@@ -792,9 +1041,9 @@ redo_policy:
 				}
 				policy = policies[cyclic_policy].policy;
 #if defined(HAVE_SCHED_GET_PRIORITY_MAX)
-				rt_stats->max_prio = sched_get_priority_max(policy);
+				max_prio = sched_get_priority_max(policy);
 #else
-				rt_stats->max_prio = 0;
+				max_prio = 0;
 #endif
 				pr_inf("%s: DEADLINE not supported by kernel, defaulting to %s\n",
 					args->name, policies[cyclic_policy].name);
@@ -814,6 +1063,14 @@ redo_policy:
 			}
 			goto tidy;
 		}
+#endif
+#if defined(HAVE_CYCLIC_SMP)
+		if (cyclic_smp) {
+			/* threads inherit the real time policy and priority */
+			ncrc = stress_cyclic_smp(args, rt_stats, n_stats, func,
+						 cyclic_sleep, start + (double)timeout);
+			goto tidy;
+		}
 #endif
 		do {
 			func(args, rt_stats, cyclic_sleep);
@@ -828,76 +1085,50 @@ tidy_ok:
 		ncrc = EXIT_SUCCESS;
 tidy:
 		(void)fflush(stdout);
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 		(void)munmap((void *)rt_stats, size);
 		_exit(ncrc);
 	} else {
-		VOID_RET(int, stress_set_sched(args->pid, policy, rt_stats->max_prio, true));
+		VOID_RET(int, stress_set_sched(args->pid, policy, max_prio, true));
 
 		(void)pause();
 		stress_force_killed_bogo(args);
 		(void)stress_kill_pid_wait(pid, NULL);
 	}
 
-	stress_rt_stats(rt_stats);
+	merged = (stress_rt_stats_t *)calloc(1, sizeof(*merged));
+	if (!merged) {
+		pr_inf("%s: cannot allocate merged statistics, no latency information available\n",
+			args->name);
+		goto finish;
+	}
+	stress_rt_stats_init(merged, cyclic_dist, -1);
+	for (i = 0; i < n_stats; i++)
+		stress_rt_stats_merge(merged, &rt_stats[i]);
+	stress_latency_merge(args->latency, &merged->latency);
+
+	if (merged->samples) {
+		stress_metrics_set(args, 0, "nanosecs latency p99.99",
+			(double)stress_latency_percentile(&merged->latency, 99.99),
+			STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 1, "nanosecs latency mean",
+			merged->latency_mean, STRESS_GEOMETRIC_MEAN);
+	}
 
 	if (args->instance == 0) {
-		if (rt_stats->index) {
-			size_t i;
-
-			static const double percentiles[] = {
-				25.0,
-				50.0,
-				75.0,
-				90.0,
-				95.40,
-				99.0,
-				99.5,
-				99.9,
-				99.99,
-			};
-
-			pr_block_begin();
-			pr_inf("%s: sched %s: %" PRIu64 " ns delay, %zd samples\n",
-				args->name,
-				policies[cyclic_policy].name,
-				cyclic_sleep,
-				rt_stats->index);
-			pr_inf( "%s:   mean: %.2f ns, mode: %" PRId64 " ns\n",
-				args->name,
-				rt_stats->latency_mean,
-				rt_stats->latency_mode);
-			pr_inf("%s:   min: %" PRId64 " ns, max: %" PRId64 " ns, std.dev. %.2f\n",
-				args->name,
-				rt_stats->min_ns,
-				rt_stats->max_ns,
-				rt_stats->std_dev);
-
-			pr_inf("%s: latency percentiles:\n", args->name);
-			for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
-				size_t j = (size_t)(((double)rt_stats->index * percentiles[i]) / 100.0);
-				pr_inf("%s:   %5.2f%%: %10" PRId64 " ns\n",
-					args->name,
-					percentiles[i],
-					rt_stats->latencies[j]);
-			}
-			stress_rt_dist(args->name, rt_stats, (int64_t)cyclic_dist);
-
-			if (rt_stats->index < rt_stats->index_reqd)
-				pr_inf("%s: Note: --cyclic-samples needed to be %zd to capture all the data for this run\n",
-					args->name, rt_stats->index_reqd);
-			pr_block_end();
+		if (merged->samples) {
+			stress_rt_report(args, rt_stats, n_stats, merged,
+				policies[cyclic_policy].name, cyclic_sleep, cyclic_dist);
 		} else {
 			pr_inf("%s: %10s: no latency information available\n",
 				args->name,
 				policies[cyclic_policy].name);
 		}
 	}
+	free(merged);
 
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 	(void)munmap((void *)rt_stats, size);
 
 	return rc;
@@ -910,6 +1141,7 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_cyclic_prio, 	stress_set_cyclic_prio },
 	{ OPT_cyclic_sleep,	stress_set_cyclic_sleep },
 	{ OPT_cyclic_samples,	stress_set_cyclic_samples },
+	{ OPT_cyclic_smp,	stress_set_cyclic_smp },
 	{ 0,			NULL }
 };
 
@@ -19,14 +19,84 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-pthread.h"
 
 #define MIN_DIRMANY_BYTES     (0)
 #define MAX_DIRMANY_BYTES     (MAX_FILE_LIMIT)
 
+#define MIN_DIRMANY_FILES	(1)
+#define MAX_DIRMANY_FILES	(1000000)
+#define DEFAULT_DIRMANY_FILES	(1000)
+
+#define MIN_DIRMANY_THREADS	(1)
+#define MAX_DIRMANY_THREADS	(32)
+#define DEFAULT_DIRMANY_THREADS	(4)
+
+/*
+ *  thread counts 1, N/4, N/2 and N, 4 counts x 2 layouts x 5 phases
+ *  keeps the metrics below the misc metrics slots
+ */
+#define DIRMANY_THREADS_SWEEP_MAX	(4)
+
+enum {
+	DIRMANY_PHASE_CREATE = 0,
+	DIRMANY_PHASE_STAT,
+	DIRMANY_PHASE_OPEN_CLOSE,
+	DIRMANY_PHASE_RENAME,
+	DIRMANY_PHASE_UNLINK,
+	DIRMANY_PHASES,
+};
+
+enum {
+	DIRMANY_LAYOUT_SHARED = 0,
+	DIRMANY_LAYOUT_UNIQUE,
+	DIRMANY_LAYOUTS,
+};
+
+static const char * const dirmany_phases[DIRMANY_PHASES] = {
+	"create",
+	"stat",
+	"open-close",
+	"rename",
+	"unlink",
+};
+
+static const char * const dirmany_layouts[DIRMANY_LAYOUTS] = {
+	"shared",
+	"per-thread",
+};
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_mutex_t lock;		/* protects ready */
+	size_t ready;			/* threads waiting to start */
+	volatile bool start;		/* release threads */
+	int phase;			/* current metadata phase */
+	uint32_t files;			/* files per thread */
+} stress_dirmany_mdtest_t;
+
+typedef struct {
+	pthread_t pthread;		/* pthread info */
+	int create_ret;			/* return from pthread_create */
+	size_t index;			/* thread index */
+	uint64_t ops;			/* successful operations */
+	stress_dirmany_mdtest_t *md;	/* shared phase state */
+	char path[PATH_MAX];		/* directory to operate in */
+} stress_dirmany_thread_t;
+#endif
+
+typedef struct {
+	double ops;			/* total operations */
+	double duration;		/* total wall clock time */
+} stress_dirmany_stats_t;
+
 static const stress_help_t help[] = {
 	{ NULL,	"dirmany N",		"start N directory file populating stressors" },
 	{ NULL, "dirmany-bytes" ,	"specify size of files (default 0)" },
+	{ NULL, "dirmany-files N",	"specify number of files per thread in mdtest mode" },
+	{ NULL, "dirmany-mdtest",	"time create, stat, open, rename, unlink phases for 1..N threads" },
 	{ NULL,	"dirmany-ops N",	"stop after N directory file bogo operations" },
+	{ NULL, "dirmany-threads N",	"specify maximum number of threads in mdtest mode" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -44,6 +114,43 @@ static int stress_set_dirmany_bytes(const char *opt)
 	return stress_set_setting("dirmany-bytes", TYPE_ID_OFF_T, &dirmany_bytes);
 }
 
+/*
+ *  stress_set_dirmany_files()
+ *      set number of files per thread in mdtest mode
+ */
+static int stress_set_dirmany_files(const char *opt)
+{
+	uint32_t dirmany_files;
+
+	dirmany_files = stress_get_uint32(opt);
+	stress_check_range("dirmany-files", (uint64_t)dirmany_files,
+		MIN_DIRMANY_FILES, MAX_DIRMANY_FILES);
+	return stress_set_setting("dirmany-files", TYPE_ID_UINT32, &dirmany_files);
+}
+
+/*
+ *  stress_set_dirmany_mdtest()
+ *      enable mdtest style metadata phases
+ */
+static int stress_set_dirmany_mdtest(const char *opt)
+{
+	return stress_set_setting_true("dirmany-mdtest", opt);
+}
+
+/*
+ *  stress_set_dirmany_threads()
+ *      set maximum number of threads in mdtest mode
+ */
+static int stress_set_dirmany_threads(const char *opt)
+{
+	size_t dirmany_threads;
+
+	dirmany_threads = (size_t)stress_get_uint32(opt);
+	stress_check_range("dirmany-threads", (uint64_t)dirmany_threads,
+		MIN_DIRMANY_THREADS, MAX_DIRMANY_THREADS);
+	return stress_set_setting("dirmany-threads", TYPE_ID_SIZE_T, &dirmany_threads);
+}
+
 static void stress_dirmany_filename(
 	const char *pathname,
 	const size_t pathname_len,
@@ -158,6 +265,234 @@ static void stress_dirmany_remove(
 	*remove_time += (stress_time_now() - t_now);
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_dirmany_mdtest_thread()
+ *	run one metadata phase over this thread's files
+ */
+static void *stress_dirmany_mdtest_thread(void *ptr)
+{
+	static void *nowt = NULL;
+	stress_dirmany_thread_t *thread = (stress_dirmany_thread_t *)ptr;
+	stress_dirmany_mdtest_t *md = thread->md;
+	uint64_t i;
+
+	(void)pthread_mutex_lock(&md->lock);
+	md->ready++;
+	(void)pthread_mutex_unlock(&md->lock);
+	while (!md->start)
+		(void)shim_sched_yield();
+
+	for (i = 0; i < md->files; i++) {
+		char filename[PATH_MAX + 32], newname[PATH_MAX + 40];
+		struct stat statbuf;
+		int fd;
+
+		/* always unlink everything so the directory can be removed */
+		if ((md->phase != DIRMANY_PHASE_UNLINK) && !stress_continue_flag())
+			break;
+
+		(void)snprintf(filename, sizeof(filename), "%s/f%zu-%" PRIu64,
+			thread->path, thread->index, i);
+		switch (md->phase) {
+		case DIRMANY_PHASE_CREATE:
+			fd = open(filename, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+			if (fd < 0)
+				continue;
+			(void)close(fd);
+			break;
+		case DIRMANY_PHASE_STAT:
+			if (shim_stat(filename, &statbuf) < 0)
+				continue;
+			break;
+		case DIRMANY_PHASE_OPEN_CLOSE:
+			fd = open(filename, O_RDONLY);
+			if (fd < 0)
+				continue;
+			(void)close(fd);
+			break;
+		case DIRMANY_PHASE_RENAME:
+			(void)snprintf(newname, sizeof(newname), "%s.r", filename);
+			if (rename(filename, newname) < 0)
+				continue;
+			break;
+		case DIRMANY_PHASE_UNLINK:
+		default:
+			(void)snprintf(newname, sizeof(newname), "%s.r", filename);
+			if ((shim_unlink(newname) < 0) && (shim_unlink(filename) < 0))
+				continue;
+			break;
+		}
+		thread->ops++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_dirmany_mdtest_phase()
+ *	run a phase on n_threads threads released together, return
+ *	the number of successful operations and the wall clock time
+ */
+static uint64_t stress_dirmany_mdtest_phase(
+	stress_dirmany_mdtest_t *md,
+	stress_dirmany_thread_t *threads,
+	const size_t n_threads,
+	const int phase,
+	double *duration)
+{
+	size_t i, n_created = 0;
+	uint64_t ops = 0;
+	double t;
+
+	md->phase = phase;
+	md->ready = 0;
+	md->start = false;
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].ops = 0;
+		threads[i].md = md;
+		threads[i].create_ret = pthread_create(&threads[i].pthread, NULL,
+						stress_dirmany_mdtest_thread, &threads[i]);
+		if (threads[i].create_ret == 0)
+			n_created++;
+	}
+	for (;;) {
+		size_t ready;
+
+		(void)pthread_mutex_lock(&md->lock);
+		ready = md->ready;
+		(void)pthread_mutex_unlock(&md->lock);
+		if (ready >= n_created)
+			break;
+		(void)shim_sched_yield();
+	}
+	t = stress_time_now();
+	md->start = true;
+	for (i = 0; i < n_threads; i++) {
+		if (threads[i].create_ret == 0) {
+			(void)pthread_join(threads[i].pthread, NULL);
+			ops += threads[i].ops;
+		}
+	}
+	*duration = stress_time_now() - t;
+	return ops;
+}
+
+/*
+ *  stress_dirmany_mdtest()
+ *	mdtest style metadata benchmark, time the create, stat,
+ *	open-close, rename and unlink phases separately for 1,
+ *	N/4, N/2 and N threads in a shared directory and in a
+ *	directory per thread
+ */
+static int stress_dirmany_mdtest(stress_args_t *args, const char *pathname)
+{
+	static stress_dirmany_mdtest_t md;
+	stress_dirmany_thread_t *threads;
+	stress_dirmany_stats_t *stats;
+	size_t thread_counts[DIRMANY_THREADS_SWEEP_MAX];
+	size_t i, n_counts = 0, dirmany_threads = DEFAULT_DIRMANY_THREADS;
+	uint32_t dirmany_files = DEFAULT_DIRMANY_FILES;
+	int layout, phase, metric;
+
+	(void)stress_get_setting("dirmany-files", &dirmany_files);
+	(void)stress_get_setting("dirmany-threads", &dirmany_threads);
+
+	thread_counts[n_counts++] = 1;
+	for (i = 4; i >= 1; i >>= 1) {
+		const size_t n = dirmany_threads / i;
+
+		if (n > thread_counts[n_counts - 1])
+			thread_counts[n_counts++] = n;
+	}
+
+	threads = (stress_dirmany_thread_t *)calloc(dirmany_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %zu thread contexts, skipping stressor\n",
+			args->name, dirmany_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	stats = (stress_dirmany_stats_t *)calloc(n_counts * DIRMANY_LAYOUTS * DIRMANY_PHASES, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: cannot allocate statistics, skipping stressor\n", args->name);
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(&md, 0, sizeof(md));
+	md.files = dirmany_files;
+	(void)pthread_mutex_init(&md.lock, NULL);
+
+	if (args->instance == 0)
+		pr_dbg("%s: mdtest mode, %" PRIu32 " files per thread, up to %zu threads\n",
+			args->name, dirmany_files, dirmany_threads);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (layout = 0; layout < DIRMANY_LAYOUTS; layout++) {
+			for (i = 0; i < n_counts; i++) {
+				const size_t n_threads = thread_counts[i];
+				stress_dirmany_stats_t *s = &stats[((i * DIRMANY_LAYOUTS) + (size_t)layout) * DIRMANY_PHASES];
+				size_t j;
+
+				for (j = 0; j < n_threads; j++) {
+					threads[j].index = j;
+					if (layout == DIRMANY_LAYOUT_SHARED) {
+						(void)shim_strscpy(threads[j].path, pathname, sizeof(threads[j].path));
+					} else {
+						(void)snprintf(threads[j].path, sizeof(threads[j].path),
+							"%s/t%zu", pathname, j);
+						(void)mkdir(threads[j].path, S_IRWXU);
+					}
+				}
+				for (phase = 0; phase < DIRMANY_PHASES; phase++) {
+					double duration;
+					const uint64_t ops = stress_dirmany_mdtest_phase(&md, threads,
+								n_threads, phase, &duration);
+
+					s[phase].ops += (double)ops;
+					s[phase].duration += duration;
+					if (phase == DIRMANY_PHASE_CREATE)
+						stress_bogo_add(args, ops);
+				}
+				if (layout == DIRMANY_LAYOUT_UNIQUE) {
+					for (j = 0; j < n_threads; j++)
+						(void)shim_rmdir(threads[j].path);
+				}
+				if (!stress_continue(args))
+					break;
+			}
+			if (!stress_continue(args))
+				break;
+		}
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (metric = 0, i = 0; i < n_counts; i++) {
+		for (layout = 0; layout < DIRMANY_LAYOUTS; layout++) {
+			const stress_dirmany_stats_t *s = &stats[((i * DIRMANY_LAYOUTS) + (size_t)layout) * DIRMANY_PHASES];
+
+			for (phase = 0; phase < DIRMANY_PHASES; phase++) {
+				char str[64];
+				const double rate = (s[phase].duration > 0.0) ?
+					s[phase].ops / s[phase].duration : 0.0;
+
+				(void)snprintf(str, sizeof(str), "%s dir %zu thread%s %s ops per sec",
+					dirmany_layouts[layout], thread_counts[i],
+					thread_counts[i] > 1 ? "s" : "", dirmany_phases[phase]);
+				stress_metrics_set(args, metric++, str, rate, STRESS_HARMONIC_MEAN);
+			}
+		}
+	}
+
+	(void)pthread_mutex_destroy(&md.lock);
+	free(stats);
+	free(threads);
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_dirmany
  *	stress directory with many empty files
@@ -170,6 +505,7 @@ static int stress_dirmany(stress_args_t *args)
 	double create_time = 0.0, remove_time = 0.0, total_time = 0.0;
 	off_t dirmany_bytes = 0;
 	size_t pathname_len;
+	bool dirmany_mdtest = false;
 
 	stress_temp_dir(pathname, sizeof(pathname), args->name, args->pid, args->instance);
 	pathname_len = strlen(pathname);
@@ -179,6 +515,20 @@ static int stress_dirmany(stress_args_t *args)
 		return stress_exit_status(-ret);
 
 	(void)stress_get_setting("dirmany-bytes", &dirmany_bytes);
+	(void)stress_get_setting("dirmany-mdtest", &dirmany_mdtest);
+
+	if (dirmany_mdtest) {
+#if defined(HAVE_LIB_PTHREAD)
+		ret = stress_dirmany_mdtest(args, pathname);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: mdtest mode requires pthread support, skipping stressor\n",
+				args->name);
+		ret = EXIT_NO_RESOURCE;
+#endif
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+	}
 
 	if (args->instance == 0) {
 		char sz[32];
@@ -239,6 +589,9 @@ static int stress_dirmany(stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_dirmany_bytes,	stress_set_dirmany_bytes },
+	{ OPT_dirmany_files,	stress_set_dirmany_files },
+	{ OPT_dirmany_mdtest,	stress_set_dirmany_mdtest },
+	{ OPT_dirmany_threads,	stress_set_dirmany_threads },
 	{ 0,			NULL }
 };
 
@@ -18,7 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-put.h"
 
 #if defined(HAVE_LIB_DL)
@@ -26,15 +28,39 @@
 #include <gnu/lib-names.h>
 #endif
 
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"dynlib N",	"start N workers exercising dlopen/dlclose" },
 	{ NULL,	"dynlib-ops N",	"stop after N dlopen/dlclose bogo operations" },
+	{ NULL,	"dynlib-sweep",	"time dlopen/dlsym/dlclose of generated libraries of 10 to 100K symbols" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_dynlib_sweep(const char *opt)
+{
+	return stress_set_setting_true("dynlib-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_dynlib_sweep,	stress_set_dynlib_sweep },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LIB_DL) &&	\
     !defined(BUILD_STATIC)
 
+#if defined(HAVE_LINK_H) &&		\
+    defined(STRESS_ARCH_X86_64) &&	\
+    defined(__linux__) &&		\
+    defined(DT_GNU_HASH) &&		\
+    defined(PT_GNU_STACK) &&		\
+    defined(R_X86_64_JUMP_SLOT)
+#define DYNLIB_SWEEP
+#endif
+
 static sigjmp_buf jmp_env;
 
 typedef struct {
@@ -115,6 +141,476 @@ static void NORETURN MLOCKED_TEXT stress_segvhandler(int signum)
 	siglongjmp(jmp_env, 1);
 }
 
+#if defined(DYNLIB_SWEEP)
+/* generated library symbol counts */
+static const size_t dynlib_sweep_syms[] = { 10, 100, 1000, 10000, 100000 };
+
+#define DYNLIB_HASH_GNU		(0)	/* DT_GNU_HASH */
+#define DYNLIB_HASH_SYSV	(1)	/* DT_HASH */
+#define DYNLIB_HASH_MAX		(2)
+
+#define DYNLIB_LAT_OPEN_LAZY	(0)	/* dlopen RTLD_LAZY */
+#define DYNLIB_LAT_OPEN_NOW	(1)	/* dlopen RTLD_NOW */
+#define DYNLIB_LAT_SYM		(2)	/* dlsym */
+#define DYNLIB_LAT_CLOSE_LAZY	(3)	/* dlclose of RTLD_LAZY load */
+#define DYNLIB_LAT_CLOSE_NOW	(4)	/* dlclose of RTLD_NOW load */
+#define DYNLIB_LAT_MAX		(5)
+
+/* dlsym lookups per generated library load */
+#define DYNLIB_SYM_LOOKUPS	(64)
+
+#define DYNLIB_PAGE		(4096)
+#define DYNLIB_ALIGN(n, a)	(((n) + (a) - 1) & ~((size_t)(a) - 1))
+
+typedef struct {
+	uint32_t hash;			/* symbol name hash */
+	uint32_t bucket;		/* hash bucket */
+	size_t id;			/* symbol number */
+} stress_dynlib_sym_t;
+
+static const char * const dynlib_hash_names[] = { "gnu", "sysv" };
+
+/*
+ *  stress_dynlib_sym_name()
+ *	name of generated symbol id
+ */
+static inline void stress_dynlib_sym_name(char *name, const size_t len, const size_t id)
+{
+	(void)snprintf(name, len, "stress_dynlib_sym_%zu", id);
+}
+
+/*
+ *  stress_dynlib_gnu_hash()
+ *	DT_GNU_HASH symbol name hash
+ */
+static uint32_t stress_dynlib_gnu_hash(const char *name)
+{
+	register uint32_t h = 5381;
+
+	while (*name)
+		h = (h << 5) + h + (uint8_t)*name++;
+	return h;
+}
+
+/*
+ *  stress_dynlib_sysv_hash()
+ *	DT_HASH symbol name hash
+ */
+static uint32_t stress_dynlib_sysv_hash(const char *name)
+{
+	register uint32_t h = 0;
+
+	while (*name) {
+		register uint32_t g;
+
+		h = (h << 4) + (uint8_t)*name++;
+		g = h & 0xf0000000;
+		if (g)
+			h ^= g >> 24;
+		h &= ~g;
+	}
+	return h;
+}
+
+static int stress_dynlib_sym_cmp(const void *p1, const void *p2)
+{
+	const stress_dynlib_sym_t *s1 = (const stress_dynlib_sym_t *)p1;
+	const stress_dynlib_sym_t *s2 = (const stress_dynlib_sym_t *)p2;
+
+	if (s1->bucket < s2->bucket)
+		return -1;
+	else if (s1->bucket > s2->bucket)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_dynlib_generate()
+ *	write an x86-64 ELF shared library to path that defines
+ *	n_syms functions and has a R_X86_64_JUMP_SLOT relocation
+ *	for each function, so RTLD_NOW has to look up every symbol
+ *	and RTLD_LAZY just relocates the GOT. The symbol table is
+ *	hashed with DT_GNU_HASH or DT_HASH
+ */
+static int stress_dynlib_generate(const char *path, const size_t n_syms, const int hash_type)
+{
+	const size_t n_buckets = (n_syms / 2) + 1;
+	size_t bloom_size = 1;
+	const uint32_t bloom_shift = 6;
+	stress_dynlib_sym_t *syms;
+	char name[64];
+	size_t i, strsz, hash_size, off_phdr, off_dynsym, off_dynstr, off_hash;
+	size_t off_rela, off_text, off_dynamic, off_got, size;
+	uint8_t *buf;
+	Elf64_Ehdr *ehdr;
+	Elf64_Phdr *phdr;
+	Elf64_Sym *dynsym;
+	Elf64_Rela *rela;
+	Elf64_Dyn *dyn;
+	char *dynstr;
+	ssize_t n;
+	int fd, rc = -1;
+
+	syms = (stress_dynlib_sym_t *)calloc(n_syms, sizeof(*syms));
+	if (!syms)
+		return -1;
+
+	while (bloom_size < n_syms / 32)
+		bloom_size <<= 1;
+
+	strsz = 1;
+	for (i = 0; i < n_syms; i++) {
+		stress_dynlib_sym_name(name, sizeof(name), i);
+		strsz += strlen(name) + 1;
+		syms[i].id = i;
+		if (hash_type == DYNLIB_HASH_GNU) {
+			syms[i].hash = stress_dynlib_gnu_hash(name);
+			syms[i].bucket = syms[i].hash % (uint32_t)n_buckets;
+		} else {
+			syms[i].hash = stress_dynlib_sysv_hash(name);
+			syms[i].bucket = syms[i].hash % (uint32_t)n_buckets;
+		}
+	}
+	/* DT_GNU_HASH requires the hashed symbols to be sorted by bucket */
+	if (hash_type == DYNLIB_HASH_GNU)
+		qsort(syms, n_syms, sizeof(*syms), stress_dynlib_sym_cmp);
+
+	if (hash_type == DYNLIB_HASH_GNU)
+		hash_size = (4 * sizeof(uint32_t)) + (bloom_size * sizeof(uint64_t)) +
+			    ((n_buckets + n_syms) * sizeof(uint32_t));
+	else
+		hash_size = (2 + n_buckets + n_syms + 1) * sizeof(uint32_t);
+
+	/* read only and executable segment, then read-write segment */
+	off_phdr = sizeof(Elf64_Ehdr);
+	off_dynsym = DYNLIB_ALIGN(off_phdr + (4 * sizeof(Elf64_Phdr)), 8);
+	off_dynstr = off_dynsym + ((n_syms + 1) * sizeof(Elf64_Sym));
+	off_hash = DYNLIB_ALIGN(off_dynstr + strsz, 8);
+	off_rela = DYNLIB_ALIGN(off_hash + hash_size, 8);
+	off_text = DYNLIB_ALIGN(off_rela + (n_syms * sizeof(Elf64_Rela)), 16);
+	off_dynamic = DYNLIB_ALIGN(off_text + 16, DYNLIB_PAGE);
+	off_got = off_dynamic + (12 * sizeof(Elf64_Dyn));
+	size = off_got + ((3 + n_syms) * sizeof(uint64_t));
+
+	buf = (uint8_t *)calloc(1, size);
+	if (!buf) {
+		free(syms);
+		return -1;
+	}
+
+	ehdr = (Elf64_Ehdr *)buf;
+	(void)shim_memcpy(ehdr->e_ident, ELFMAG, SELFMAG);
+	ehdr->e_ident[EI_CLASS] = ELFCLASS64;
+	ehdr->e_ident[EI_DATA] = ELFDATA2LSB;
+	ehdr->e_ident[EI_VERSION] = EV_CURRENT;
+	ehdr->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	ehdr->e_type = ET_DYN;
+	ehdr->e_machine = EM_X86_64;
+	ehdr->e_version = EV_CURRENT;
+	ehdr->e_phoff = off_phdr;
+	ehdr->e_ehsize = sizeof(Elf64_Ehdr);
+	ehdr->e_phentsize = sizeof(Elf64_Phdr);
+	ehdr->e_phnum = 4;
+
+	phdr = (Elf64_Phdr *)(buf + off_phdr);
+	phdr[0].p_type = PT_LOAD;
+	phdr[0].p_flags = PF_R | PF_X;
+	phdr[0].p_filesz = off_text + 16;
+	phdr[0].p_memsz = off_text + 16;
+	phdr[0].p_align = DYNLIB_PAGE;
+	phdr[1].p_type = PT_LOAD;
+	phdr[1].p_flags = PF_R | PF_W;
+	phdr[1].p_offset = off_dynamic;
+	phdr[1].p_vaddr = off_dynamic;
+	phdr[1].p_paddr = off_dynamic;
+	phdr[1].p_filesz = size - off_dynamic;
+	phdr[1].p_memsz = size - off_dynamic;
+	phdr[1].p_align = DYNLIB_PAGE;
+	phdr[2].p_type = PT_DYNAMIC;
+	phdr[2].p_flags = PF_R | PF_W;
+	phdr[2].p_offset = off_dynamic;
+	phdr[2].p_vaddr = off_dynamic;
+	phdr[2].p_paddr = off_dynamic;
+	phdr[2].p_filesz = 12 * sizeof(Elf64_Dyn);
+	phdr[2].p_memsz = 12 * sizeof(Elf64_Dyn);
+	phdr[2].p_align = 8;
+	/* non-executable stack */
+	phdr[3].p_type = PT_GNU_STACK;
+	phdr[3].p_flags = PF_R | PF_W;
+	phdr[3].p_align = 16;
+
+	/* ret */
+	buf[off_text] = 0xc3;
+
+	/* symbols, each with a jump slot relocation */
+	dynsym = (Elf64_Sym *)(buf + off_dynsym);
+	dynstr = (char *)(buf + off_dynstr);
+	rela = (Elf64_Rela *)(buf + off_rela);
+	strsz = 1;
+	for (i = 0; i < n_syms; i++) {
+		Elf64_Sym *sym = &dynsym[i + 1];
+
+		stress_dynlib_sym_name(name, sizeof(name), syms[i].id);
+		(void)shim_strscpy(dynstr + strsz, name, strlen(name) + 1);
+		sym->st_name = (Elf64_Word)strsz;
+		sym->st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+		sym->st_other = STV_DEFAULT;
+		sym->st_shndx = 1;
+		sym->st_value = off_text;
+		sym->st_size = 1;
+		strsz += strlen(name) + 1;
+
+		rela[i].r_offset = off_got + ((3 + i) * sizeof(uint64_t));
+		rela[i].r_info = ELF64_R_INFO(i + 1, R_X86_64_JUMP_SLOT);
+		rela[i].r_addend = 0;
+	}
+
+	if (hash_type == DYNLIB_HASH_GNU) {
+		uint32_t *hdr = (uint32_t *)(buf + off_hash);
+		uint64_t *bloom = (uint64_t *)(hdr + 4);
+		uint32_t *buckets = (uint32_t *)(bloom + bloom_size);
+		uint32_t *chain = buckets + n_buckets;
+
+		hdr[0] = (uint32_t)n_buckets;
+		hdr[1] = 1;		/* first hashed symbol index */
+		hdr[2] = (uint32_t)bloom_size;
+		hdr[3] = bloom_shift;
+		for (i = 0; i < n_syms; i++) {
+			const uint32_t h = syms[i].hash;
+			const bool last = (i == n_syms - 1) || (syms[i + 1].bucket != syms[i].bucket);
+
+			bloom[(h / 64) % bloom_size] |= (1ULL << (h % 64)) |
+							(1ULL << ((h >> bloom_shift) % 64));
+			if (buckets[syms[i].bucket] == 0)
+				buckets[syms[i].bucket] = (uint32_t)(i + 1);
+			chain[i] = last ? (h | 1) : (h & ~1U);
+		}
+	} else {
+		uint32_t *hdr = (uint32_t *)(buf + off_hash);
+		uint32_t *buckets = hdr + 2;
+		uint32_t *chain = buckets + n_buckets;
+
+		hdr[0] = (uint32_t)n_buckets;
+		hdr[1] = (uint32_t)(n_syms + 1);
+		for (i = 0; i < n_syms; i++) {
+			const uint32_t idx = (uint32_t)(i + 1);
+
+			chain[idx] = buckets[syms[i].bucket];
+			buckets[syms[i].bucket] = idx;
+		}
+	}
+
+	dyn = (Elf64_Dyn *)(buf + off_dynamic);
+	dyn[0].d_tag = (hash_type == DYNLIB_HASH_GNU) ? DT_GNU_HASH : DT_HASH;
+	dyn[0].d_un.d_ptr = off_hash;
+	dyn[1].d_tag = DT_STRTAB;
+	dyn[1].d_un.d_ptr = off_dynstr;
+	dyn[2].d_tag = DT_SYMTAB;
+	dyn[2].d_un.d_ptr = off_dynsym;
+	dyn[3].d_tag = DT_STRSZ;
+	dyn[3].d_un.d_val = strsz;
+	dyn[4].d_tag = DT_SYMENT;
+	dyn[4].d_un.d_val = sizeof(Elf64_Sym);
+	dyn[5].d_tag = DT_PLTGOT;
+	dyn[5].d_un.d_ptr = off_got;
+	dyn[6].d_tag = DT_PLTRELSZ;
+	dyn[6].d_un.d_val = n_syms * sizeof(Elf64_Rela);
+	dyn[7].d_tag = DT_PLTREL;
+	dyn[7].d_un.d_val = DT_RELA;
+	dyn[8].d_tag = DT_JMPREL;
+	dyn[8].d_un.d_ptr = off_rela;
+	dyn[9].d_tag = DT_NULL;
+
+	fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IXUSR);
+	if (fd >= 0) {
+		n = write(fd, buf, size);
+		(void)close(fd);
+		rc = (n == (ssize_t)size) ? 0 : -1;
+	}
+	free(buf);
+	free(syms);
+
+	return rc;
+}
+
+/*
+ *  stress_dynlib_sweep_load()
+ *	time dlopen with flags, a batch of random dlsym lookups
+ *	and dlclose of the generated library at path, returns
+ *	false if the library cannot be loaded or a symbol is
+ *	not found
+ */
+static bool stress_dynlib_sweep_load(
+	const char *path,
+	const size_t n_syms,
+	const int flags,
+	stress_latency_t *open_lat,
+	stress_latency_t *sym_lat,
+	stress_latency_t *close_lat)
+{
+	void *handle;
+	double t1, t2;
+	size_t i;
+	bool ok = true;
+	char names[DYNLIB_SYM_LOOKUPS][32];
+
+	t1 = stress_time_now();
+	handle = dlopen(path, flags);
+	t2 = stress_time_now();
+	if (!handle)
+		return false;
+	stress_latency_add(open_lat, (uint64_t)((t2 - t1) * STRESS_DBL_NANOSECOND));
+
+	/* lookups are too quick to time individually, time the batch */
+	for (i = 0; i < DYNLIB_SYM_LOOKUPS; i++)
+		stress_dynlib_sym_name(names[i], sizeof(names[i]), (size_t)stress_mwc32modn((uint32_t)n_syms));
+	t1 = stress_time_now();
+	for (i = 0; i < DYNLIB_SYM_LOOKUPS; i++) {
+		if (!dlsym(handle, names[i]))
+			ok = false;
+	}
+	t2 = stress_time_now();
+	stress_latency_add(sym_lat, (uint64_t)((t2 - t1) * STRESS_DBL_NANOSECOND / DYNLIB_SYM_LOOKUPS));
+
+	t1 = stress_time_now();
+	(void)dlclose(handle);
+	t2 = stress_time_now();
+	stress_latency_add(close_lat, (uint64_t)((t2 - t1) * STRESS_DBL_NANOSECOND));
+
+	return ok;
+}
+
+/*
+ *  stress_dynlib_sweep()
+ *	generate libraries with increasing symbol counts with GNU
+ *	and SysV symbol hashing and time dlopen, dlsym and dlclose
+ *	with lazy and immediate binding
+ */
+static int stress_dynlib_sweep(stress_args_t *args)
+{
+	const size_t n_counts = SIZEOF_ARRAY(dynlib_sweep_syms);
+	stress_latency_t *lat;
+	char path[DYNLIB_HASH_MAX][PATH_MAX];
+	double duration;
+	size_t i, metric = 0;
+	int ret, rc = EXIT_SUCCESS;
+
+	lat = (stress_latency_t *)calloc(n_counts * DYNLIB_HASH_MAX * DYNLIB_LAT_MAX, sizeof(*lat));
+	if (!lat) {
+		pr_inf_skip("%s: cannot allocate latency histograms, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(lat);
+		return stress_exit_status(-ret);
+	}
+	for (i = 0; i < DYNLIB_HASH_MAX; i++)
+		(void)stress_temp_filename_args(args, path[i], sizeof(path[i]), stress_mwc32());
+
+	duration = (double)g_opt_timeout / (double)n_counts;
+	if (duration < 1.0)
+		duration = 1.0;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	for (i = 0; (i < n_counts) && stress_continue(args); i++) {
+		stress_latency_t *l = &lat[i * DYNLIB_HASH_MAX * DYNLIB_LAT_MAX];
+		const size_t n_syms = dynlib_sweep_syms[i];
+		double t_end;
+		int h;
+
+		for (h = 0; h < DYNLIB_HASH_MAX; h++) {
+			if (stress_dynlib_generate(path[h], n_syms, h) < 0) {
+				pr_inf_skip("%s: cannot create generated library %s, "
+					"skipping stressor\n", args->name, path[h]);
+				rc = EXIT_NO_RESOURCE;
+				goto tidy;
+			}
+		}
+
+		t_end = stress_time_now() + duration;
+		do {
+			for (h = 0; h < DYNLIB_HASH_MAX; h++) {
+				stress_latency_t *lh = &l[h * DYNLIB_LAT_MAX];
+
+				if (!stress_dynlib_sweep_load(path[h], n_syms, RTLD_LAZY | RTLD_LOCAL,
+						&lh[DYNLIB_LAT_OPEN_LAZY], &lh[DYNLIB_LAT_SYM],
+						&lh[DYNLIB_LAT_CLOSE_LAZY]) ||
+				    !stress_dynlib_sweep_load(path[h], n_syms, RTLD_NOW | RTLD_LOCAL,
+						&lh[DYNLIB_LAT_OPEN_NOW], &lh[DYNLIB_LAT_SYM],
+						&lh[DYNLIB_LAT_CLOSE_NOW])) {
+					pr_inf_skip("%s: cannot load generated library, %s, "
+						"skipping stressor\n", args->name, dlerror());
+					rc = EXIT_NO_RESOURCE;
+					goto tidy;
+				}
+				stress_bogo_inc(args);
+			}
+		} while (stress_continue(args) && (stress_time_now() < t_end));
+
+		for (h = 0; h < DYNLIB_HASH_MAX; h++)
+			(void)shim_unlink(path[h]);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %7s %4s %12s %12s %10s %12s %12s\n", args->name,
+			"symbols", "hash", "lazy open us", "now open us",
+			"dlsym ns", "lazy close us", "now close us");
+	}
+	for (i = 0; i < n_counts; i++) {
+		int h;
+
+		for (h = 0; h < DYNLIB_HASH_MAX; h++) {
+			const stress_latency_t *lh = &lat[((i * DYNLIB_HASH_MAX) + h) * DYNLIB_LAT_MAX];
+			const size_t n_syms = dynlib_sweep_syms[i];
+			const char *hash = dynlib_hash_names[h];
+			char str[64];
+
+			if (lh[DYNLIB_LAT_OPEN_LAZY].count == 0)
+				continue;
+			if (args->instance == 0) {
+				pr_inf("%s: %7zu %4s %12.1f %12.1f %10.1f %12.1f %12.1f\n",
+					args->name, n_syms, hash,
+					(double)stress_latency_percentile(&lh[DYNLIB_LAT_OPEN_LAZY], 50.0) / 1000.0,
+					(double)stress_latency_percentile(&lh[DYNLIB_LAT_OPEN_NOW], 50.0) / 1000.0,
+					(double)stress_latency_percentile(&lh[DYNLIB_LAT_SYM], 50.0),
+					(double)stress_latency_percentile(&lh[DYNLIB_LAT_CLOSE_LAZY], 50.0) / 1000.0,
+					(double)stress_latency_percentile(&lh[DYNLIB_LAT_CLOSE_NOW], 50.0) / 1000.0);
+			}
+			(void)snprintf(str, sizeof(str), "%zu syms %s hash lazy dlopen usec", n_syms, hash);
+			stress_metrics_set(args, metric++, str,
+				(double)stress_latency_percentile(&lh[DYNLIB_LAT_OPEN_LAZY], 50.0) / 1000.0,
+				STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%zu syms %s hash now dlopen usec", n_syms, hash);
+			stress_metrics_set(args, metric++, str,
+				(double)stress_latency_percentile(&lh[DYNLIB_LAT_OPEN_NOW], 50.0) / 1000.0,
+				STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%zu syms %s hash dlsym nanosecs", n_syms, hash);
+			stress_metrics_set(args, metric++, str,
+				(double)stress_latency_percentile(&lh[DYNLIB_LAT_SYM], 50.0),
+				STRESS_GEOMETRIC_MEAN);
+			if (args->latency)
+				stress_latency_merge(args->latency, &lh[DYNLIB_LAT_SYM]);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+tidy:
+	for (i = 0; i < DYNLIB_HASH_MAX; i++)
+		(void)shim_unlink(path[i]);
+	(void)stress_temp_dir_rm_args(args);
+	free(lat);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_dynlib()
  *	stress that does lots of not a lot
@@ -123,7 +619,21 @@ static int stress_dynlib(stress_args_t *args)
 {
 	void *handles[MAX_LIBNAMES];
 	NOCLOBBER double count = 0.0, duration = 0.0;
+	NOCLOBBER double open_count = 0.0, open_duration = 0.0;
+	NOCLOBBER double close_count = 0.0, close_duration = 0.0;
 	double rate;
+	bool dynlib_sweep = false;
+
+	(void)stress_get_setting("dynlib-sweep", &dynlib_sweep);
+	if (dynlib_sweep) {
+#if defined(DYNLIB_SWEEP)
+		return stress_dynlib_sweep(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: generated library sweep is only available on "
+				"x86-64 Linux, using system libraries instead\n", args->name);
+#endif
+	}
 
 	(void)shim_memset(handles, 0, sizeof(handles));
 
@@ -144,13 +654,17 @@ static int stress_dynlib(stress_args_t *args)
 
 		for (i = 0; i < MAX_LIBNAMES; i++) {
 			int flags;
+			double t;
 
 			flags = stress_mwc1() ? RTLD_LAZY : RTLD_NOW;
 #if defined(RTLD_GLOBAL) &&	\
     defined(RTLD_LOCAL)
 			flags |= stress_mwc1() ? RTLD_GLOBAL : RTLD_LOCAL;
 #endif
+			t = stress_time_now();
 			handles[i] = dlopen(libnames[i].library, flags);
+			open_duration += stress_time_now() - t;
+			open_count += 1.0;
 			(void)dlerror();
 		}
 
@@ -175,8 +689,13 @@ static int stress_dynlib(stress_args_t *args)
 		}
 tidy:
 		for (i = 0; i < MAX_LIBNAMES; i++) {
-			if (handles[i])
+			if (handles[i]) {
+				const double t = stress_time_now();
+
 				(void)dlclose(handles[i]);
+				close_duration += stress_time_now() - t;
+				close_count += 1.0;
+			}
 			handles[i] = NULL;
 		}
 		stress_bogo_inc(args);
@@ -185,6 +704,12 @@ tidy:
 	rate = (count > 0.0) ? duration / count : 0.0;
 	stress_metrics_set(args, 0, "nanosecs per dlsym lookup",
 		rate * STRESS_DBL_NANOSECOND, STRESS_HARMONIC_MEAN);
+	rate = (open_count > 0.0) ? open_duration / open_count : 0.0;
+	stress_metrics_set(args, 1, "nanosecs per dlopen call",
+		rate * STRESS_DBL_NANOSECOND, STRESS_HARMONIC_MEAN);
+	rate = (close_count > 0.0) ? close_duration / close_count : 0.0;
+	stress_metrics_set(args, 2, "nanosecs per dlclose call",
+		rate * STRESS_DBL_NANOSECOND, STRESS_HARMONIC_MEAN);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -193,12 +718,14 @@ tidy:
 stressor_info_t stress_dynlib_info = {
 	.stressor = stress_dynlib,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_dynlib_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without dynamic library libdl support"
 };
@@ -25,6 +25,11 @@ double stress_time_now(void);
 
 #if defined(HAVE_EIGEN)
 
+#if defined(HAVE_EIGEN_OPENMP) &&	\
+    defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #include <eigen3/Eigen/Dense>
 using namespace Eigen;
 
@@ -177,6 +182,37 @@ template <typename T> static int eigen_determinant(const size_t size, double *du
 
 extern "C" {
 
+/*
+ *  eigen_set_threads()
+ *	set the number of threads Eigen may use internally,
+ *	returns -1 if Eigen was not built with OpenMP
+ */
+int eigen_set_threads(const int threads)
+{
+#if defined(HAVE_EIGEN_OPENMP) &&	\
+    defined(_OPENMP)
+	Eigen::setNbThreads(threads);
+	return 0;
+#else
+	(void)threads;
+	return -1;
+#endif
+}
+
+/*
+ *  eigen_max_threads()
+ *	maximum number of threads Eigen can use internally
+ */
+int eigen_max_threads(void)
+{
+#if defined(HAVE_EIGEN_OPENMP) &&	\
+    defined(_OPENMP)
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
 int eigen_add_long_double(const size_t size, double *duration, double *count)
 {
 	return eigen_add<long double>(size, duration, count);
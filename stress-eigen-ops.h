@@ -21,6 +21,9 @@
 
 #include <stdlib.h>
 
+extern int eigen_set_threads(const int threads);
+extern int eigen_max_threads(void);
+
 extern int eigen_add_long_double(const size_t size, double *duration, double *count);
 extern int eigen_add_double(const size_t size, double *duration, double *count);
 extern int eigen_add_float(const size_t size, double *duration, double *count);
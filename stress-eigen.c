@@ -17,17 +17,28 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "stress-eigen-ops.h"
 
 #define MIN_MATRIX_SIZE		(2)
 #define MAX_MATRIX_SIZE		(1024)
 #define DEFAULT_MATRIX_SIZE	(32)
+#define DEFAULT_SWEEP_SIZE	(256)
+#define MIN_SWEEP_SIZE		(8)
+
+#define MIN_EIGEN_THREADS	(1)
+#define MAX_EIGEN_THREADS	(256)
+
+#define EIGEN_MAX_SIZES		(12)	/* 8, 16, .. 1024 + non power of 2 */
+#define EIGEN_MAX_THREAD_STEPS	(12)	/* 1, 2, 4, .. 256 + non power of 2 */
 
 static const stress_help_t help[] = {
 	{ NULL,	"eigen N",		"start N workers exercising eigen operations" },
 	{ NULL,	"eigen-method M",	"specify eigen stress method M, default is all" },
 	{ NULL,	"eigen-ops N",		"stop after N maxtrix bogo operations" },
-	{ NULL,	"eigen-size N",	"specify the size of the N x N eigen" },
+	{ NULL,	"eigen-size N",		"specify the size of the N x N eigen" },
+	{ NULL,	"eigen-sweep",		"sweep matrix sizes from 8 x 8 up to the eigen-size" },
+	{ NULL,	"eigen-threads N",	"sweep Eigen internal OpenMP threads from 1 to N" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -41,6 +52,21 @@ static int stress_set_eigen_size(const char *opt)
 	return stress_set_setting("eigen-size", TYPE_ID_SIZE_T, &eigen_size);
 }
 
+static int stress_set_eigen_sweep(const char *opt)
+{
+	return stress_set_setting_true("eigen-sweep", opt);
+}
+
+static int stress_set_eigen_threads(const char *opt)
+{
+	uint32_t eigen_threads;
+
+	eigen_threads = stress_get_uint32(opt);
+	stress_check_range("eigen-threads", (uint64_t)eigen_threads,
+		MIN_EIGEN_THREADS, MAX_EIGEN_THREADS);
+	return stress_set_setting("eigen-threads", TYPE_ID_UINT32, &eigen_threads);
+}
+
 #if defined(HAVE_EIGEN)
 
 /*
@@ -51,64 +77,38 @@ typedef int (*stress_eigen_func_t)(const size_t size, double *duration, double *
 typedef struct {
 	const char			*name;		/* human readable form of stressor */
 	const stress_eigen_func_t	func;		/* method functions */
+	const double			flops_n3;	/* flops per op, n^3 term */
+	const double			flops_n2;	/* flops per op, n^2 term */
 } stress_eigen_method_info_t;
 
 static const char *current_method = NULL;		/* current eigen method */
-static size_t method_all_index;				/* all method index */
-static const stress_eigen_method_info_t eigen_methods[];
 
 /*
- *  stress_eigen_all()
- *	iterate over all cpu stressors
- */
-static int stress_eigen_all();
-
-/*
- * Table of eigen stress methods, ordered x by y and y by x
+ * Table of eigen stress methods, ordered x by y and y by x, the
+ * flop counts are the textbook operation counts, inverse is LU
+ * + triangular solves, determinant is LU and transpose counts
+ * one operation per element moved
  */
 static const stress_eigen_method_info_t eigen_methods[] = {
-	{ "all",			stress_eigen_all },
-	{ "add-longdouble",		eigen_add_long_double, },
-	{ "add-double",			eigen_add_double, },
-	{ "add-float",			eigen_add_float, },
-	{ "determinant-longdouble",	eigen_determinant_long_double, },
-	{ "determinant-double",		eigen_determinant_double, },
-	{ "determinant-float",		eigen_determinant_float, },
-	{ "inverse-longdouble",		eigen_inverse_long_double, },
-	{ "inverse-double",		eigen_inverse_double, },
-	{ "inverse-float",		eigen_inverse_float, },
-	{ "multiply-longdouble",	eigen_multiply_long_double, },
-	{ "multiply-double",		eigen_multiply_double, },
-	{ "multiply-float",		eigen_multiply_float, },
-	{ "transpose-longdouble",	eigen_transpose_long_double, },
-	{ "transpose-double",		eigen_transpose_double, },
-	{ "transpose-float",		eigen_transpose_float, },
+	{ "all",			NULL,				0.0,		0.0 },
+	{ "add-longdouble",		eigen_add_long_double,		0.0,		1.0 },
+	{ "add-double",			eigen_add_double,		0.0,		1.0 },
+	{ "add-float",			eigen_add_float,		0.0,		1.0 },
+	{ "determinant-longdouble",	eigen_determinant_long_double,	2.0 / 3.0,	0.0 },
+	{ "determinant-double",		eigen_determinant_double,	2.0 / 3.0,	0.0 },
+	{ "determinant-float",		eigen_determinant_float,	2.0 / 3.0,	0.0 },
+	{ "inverse-longdouble",		eigen_inverse_long_double,	2.0,		0.0 },
+	{ "inverse-double",		eigen_inverse_double,		2.0,		0.0 },
+	{ "inverse-float",		eigen_inverse_float,		2.0,		0.0 },
+	{ "multiply-longdouble",	eigen_multiply_long_double,	2.0,		-1.0 },
+	{ "multiply-double",		eigen_multiply_double,		2.0,		-1.0 },
+	{ "multiply-float",		eigen_multiply_float,		2.0,		-1.0 },
+	{ "transpose-longdouble",	eigen_transpose_long_double,	0.0,		1.0 },
+	{ "transpose-double",		eigen_transpose_double,		0.0,		1.0 },
+	{ "transpose-float",		eigen_transpose_float,		0.0,		1.0 },
 };
 
-static stress_metrics_t eigen_metrics[SIZEOF_ARRAY(eigen_methods)];
-
-/*
- *  stress_eigen_all()
- *	iterate over all matrix stressors
- */
-static int stress_eigen_all(
-	const size_t size,
-	double *duration,
-	double *count)
-{
-	int rc;
-
-	(void)duration;
-	(void)count;
-
-	current_method = eigen_methods[method_all_index].name;
-
-	rc = eigen_methods[method_all_index].func(size,
-		&eigen_metrics[method_all_index].duration,
-		&eigen_metrics[method_all_index].count);
-
-	return rc;
-}
+static stress_metrics_t eigen_metrics[SIZEOF_ARRAY(eigen_methods)][EIGEN_MAX_SIZES][EIGEN_MAX_THREAD_STEPS];
 
 /*
  *  stress_set_eigen_method()
@@ -133,62 +133,198 @@ static int stress_set_eigen_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_eigen_gflops()
+ *	GFLOP/s rate of method for a given matrix size and metrics
+ */
+static double stress_eigen_gflops(
+	const size_t method,
+	const size_t size,
+	const stress_metrics_t *metrics)
+{
+	const double n = (double)size;
+	const double flops = (eigen_methods[method].flops_n3 * n * n * n) +
+			     (eigen_methods[method].flops_n2 * n * n);
+
+	if (metrics->duration <= 0.0)
+		return 0.0;
+	return (metrics->count * flops) / (metrics->duration * 1.0E9);
+}
+
+/*
+ *  stress_eigen_sizes()
+ *	fill sizes with the matrix sizes to exercise, a single size
+ *	or a sweep of powers of 2 up to the eigen_size
+ */
+static size_t stress_eigen_sizes(
+	size_t sizes[EIGEN_MAX_SIZES],
+	const size_t eigen_size,
+	const bool eigen_sweep)
+{
+	size_t n = 0, size;
+
+	if (!eigen_sweep || (eigen_size <= MIN_SWEEP_SIZE)) {
+		sizes[0] = eigen_size;
+		return 1;
+	}
+	for (size = MIN_SWEEP_SIZE; size < eigen_size; size <<= 1)
+		sizes[n++] = size;
+	sizes[n++] = eigen_size;
+	return n;
+}
+
+/*
+ *  stress_eigen_thread_steps()
+ *	fill threads with the Eigen thread counts to exercise,
+ *	powers of 2 up to eigen_threads
+ */
+static size_t stress_eigen_thread_steps(
+	int threads[EIGEN_MAX_THREAD_STEPS],
+	const uint32_t eigen_threads)
+{
+	size_t n = 0;
+	uint32_t t;
+
+	for (t = 1; t < eigen_threads; t <<= 1)
+		threads[n++] = (int)t;
+	threads[n++] = (int)eigen_threads;
+	return n;
+}
+
+/*
+ *  stress_eigen_dump()
+ *	dump the GFLOP/s for each method, size and thread count
+ */
+static void stress_eigen_dump(
+	stress_args_t *args,
+	const size_t *sizes,
+	const size_t n_sizes,
+	const int *threads,
+	const size_t n_threads)
+{
+	size_t i;
+
+	pr_inf("%s: %-24s %11s %7s %10s\n", args->name,
+		"method", "size", "threads", "GFLOP/s");
+
+	for (i = 1; i < SIZEOF_ARRAY(eigen_methods); i++) {
+		size_t s;
+
+		for (s = 0; s < n_sizes; s++) {
+			size_t t;
+
+			for (t = 0; t < n_threads; t++) {
+				const stress_metrics_t *metrics = &eigen_metrics[i][s][t];
+				char size_str[16];
+
+				if (metrics->duration <= 0.0)
+					continue;
+				(void)snprintf(size_str, sizeof(size_str), "%zd x %zd", sizes[s], sizes[s]);
+				pr_inf("%s: %-24s %11s %7d %10.3f\n", args->name,
+					eigen_methods[i].name, size_str, threads[t],
+					stress_eigen_gflops(i, sizes[s], metrics));
+			}
+		}
+	}
+}
+
 static inline int stress_eigen_exercise(
 	stress_args_t *args,
 	const size_t eigen_method,
-	const size_t eigen_size)
+	const size_t *sizes,
+	const size_t n_sizes,
+	const int *threads,
+	const size_t n_threads,
+	const bool set_threads)
 {
 	int rc = EXIT_SUCCESS;
 	const size_t num_eigen_methods = SIZEOF_ARRAY(eigen_methods);
-	const stress_eigen_func_t func = eigen_methods[eigen_method].func;
-	const char *name = eigen_methods[eigen_method].name;
-
+	const size_t eigen_size = sizes[n_sizes - 1];
+	const size_t t_max = n_threads - 1;
+	size_t method_all_index = 1;
 	register size_t i, j;
-	method_all_index = 1;
 
-	for (i = 0; i < SIZEOF_ARRAY(eigen_metrics); i++) {
-		eigen_metrics[i].duration = 0.0;
-		eigen_metrics[i].count = 0.0;
-	}
-
-	current_method = eigen_methods[eigen_method].name;
+	(void)shim_memset(eigen_metrics, 0, sizeof(eigen_metrics));
 
 	do {
-		int ret;
-		ret = func(eigen_size,
-			&eigen_metrics[eigen_method].duration,
-			&eigen_metrics[eigen_method].count);
-
-		if (ret < 0) {
-			pr_inf("%s: eigen matrix library failure with %s, skipping stressor\n", args->name, name);
-			rc = EXIT_NO_RESOURCE;
-			break;
-		} else {
-			if (ret == EXIT_FAILURE) {
-				pr_fail("%s: eigen matrix operation %s check failed\n", args->name, name);
-				rc = EXIT_FAILURE;
-				break;
+		const size_t method = (eigen_method == 0) ? method_all_index : eigen_method;
+		const stress_eigen_func_t func = eigen_methods[method].func;
+		const char *name = eigen_methods[method].name;
+		size_t s;
+
+		current_method = name;
+
+		for (s = 0; (rc == EXIT_SUCCESS) && (s < n_sizes); s++) {
+			size_t t;
+
+			for (t = 0; t < n_threads; t++) {
+				stress_metrics_t *metrics = &eigen_metrics[method][s][t];
+				int ret;
+
+				if (set_threads)
+					(void)eigen_set_threads(threads[t]);
+				ret = func(sizes[s], &metrics->duration, &metrics->count);
+				if (ret < 0) {
+					pr_inf("%s: eigen matrix library failure with %s, skipping stressor\n", args->name, name);
+					rc = EXIT_NO_RESOURCE;
+					break;
+				} else if (ret == EXIT_FAILURE) {
+					pr_fail("%s: eigen matrix operation %s check failed\n", args->name, name);
+					rc = EXIT_FAILURE;
+					break;
+				}
+				if (UNLIKELY(!stress_continue_flag()))
+					break;
 			}
 		}
+		if (rc != EXIT_SUCCESS)
+			break;
 		stress_bogo_inc(args);
-                if (eigen_method == 0) {
-                        method_all_index++;
-                        if (method_all_index >= SIZEOF_ARRAY(eigen_methods))
-                                method_all_index = 1;
+		if (eigen_method == 0) {
+			method_all_index++;
+			if (method_all_index >= num_eigen_methods)
+				method_all_index = 1;
 		}
 	} while (stress_continue(args));
 
-	/* Dump metrics except for 'all' method */
+	if ((args->instance == 0) && ((n_sizes > 1) || (n_threads > 1)))
+		stress_eigen_dump(args, sizes, n_sizes, threads, n_threads);
+
+	/*
+	 *  Dump metrics except for 'all' method, rates are for the
+	 *  largest matrix size, GFLOP/s are reported for each thread
+	 *  count in the thread sweep
+	 */
 	for (i = 1, j = 0; i < num_eigen_methods; i++) {
-		if (eigen_metrics[i].duration > 0.0) {
+		const stress_metrics_t *metrics = &eigen_metrics[i][n_sizes - 1][t_max];
+		size_t t;
+
+		if (metrics->duration > 0.0) {
 			char msg[64];
-			const double rate = eigen_metrics[i].count / eigen_metrics[i].duration;
+			const double rate = metrics->count / metrics->duration;
 
 			(void)snprintf(msg, sizeof(msg), "%s matrix %zd x %zd ops per sec",
 				eigen_methods[i].name, eigen_size, eigen_size);
 			stress_metrics_set(args, j, msg, rate, STRESS_HARMONIC_MEAN);
 			j++;
 		}
+		for (t = 0; t < n_threads; t++) {
+			char msg[64];
+
+			metrics = &eigen_metrics[i][n_sizes - 1][t];
+			if (metrics->duration <= 0.0)
+				continue;
+			if (n_threads > 1) {
+				(void)snprintf(msg, sizeof(msg), "%s %zd x %zd GFLOP/s, %d threads",
+					eigen_methods[i].name, eigen_size, eigen_size, threads[t]);
+			} else {
+				(void)snprintf(msg, sizeof(msg), "%s matrix %zd x %zd GFLOP/s",
+					eigen_methods[i].name, eigen_size, eigen_size);
+			}
+			stress_metrics_set(args, j, msg,
+				stress_eigen_gflops(i, eigen_size, metrics), STRESS_HARMONIC_MEAN);
+			j++;
+		}
 	}
 
 	return rc;
@@ -202,21 +338,47 @@ static int stress_eigen(stress_args_t *args)
 {
 	size_t eigen_method = 0;	/* All method */
 	size_t eigen_size = DEFAULT_MATRIX_SIZE;
+	size_t sizes[EIGEN_MAX_SIZES], n_sizes;
+	int threads[EIGEN_MAX_THREAD_STEPS];
+	size_t n_threads = 1;
+	uint32_t eigen_threads = 0;
+	bool eigen_sweep = false;
+	bool set_threads;
 	int rc;
 
 	(void)stress_get_setting("eigen-method", &eigen_method);
-	(void)stress_get_setting("eigen-size", &eigen_size);
+	(void)stress_get_setting("eigen-sweep", &eigen_sweep);
+	(void)stress_get_setting("eigen-threads", &eigen_threads);
 
 	if (!stress_get_setting("eigen-size", &eigen_size)) {
+		if (eigen_sweep)
+			eigen_size = DEFAULT_SWEEP_SIZE;
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			eigen_size = MAX_MATRIX_SIZE;
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			eigen_size = MIN_MATRIX_SIZE;
 	}
+	n_sizes = stress_eigen_sizes(sizes, eigen_size, eigen_sweep);
+
+	/*
+	 *  Eigen only threads internally when built with OpenMP,
+	 *  default to single threaded to match non-OpenMP builds
+	 */
+	threads[0] = 1;
+	set_threads = (eigen_set_threads(1) == 0);
+	if (eigen_threads > 0) {
+		if (set_threads) {
+			n_threads = stress_eigen_thread_steps(threads, eigen_threads);
+		} else if (args->instance == 0) {
+			pr_inf("%s: Eigen not built with OpenMP, ignoring "
+				"--eigen-threads option\n", args->name);
+		}
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	rc = stress_eigen_exercise(args, eigen_method, eigen_size);
+	rc = stress_eigen_exercise(args, eigen_method, sizes, n_sizes,
+		threads, n_threads, set_threads);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -226,6 +388,8 @@ static int stress_eigen(stress_args_t *args)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_eigen_method,	stress_set_eigen_method },
 	{ OPT_eigen_size,	stress_set_eigen_size },
+	{ OPT_eigen_sweep,	stress_set_eigen_sweep },
+	{ OPT_eigen_threads,	stress_set_eigen_threads },
 	{ 0,			NULL },
 };
 
@@ -255,6 +419,8 @@ static int stress_set_eigen_method(const char *name)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_eigen_method,	stress_set_eigen_method },
 	{ OPT_eigen_size,	stress_set_eigen_size },
+	{ OPT_eigen_sweep,	stress_set_eigen_sweep },
+	{ OPT_eigen_threads,	stress_set_eigen_threads },
 	{ 0,			NULL },
 };
 
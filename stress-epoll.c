@@ -22,6 +22,7 @@
 #include "core-killpid.h"
 #include "core-net.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_SYS_UN_H)
 #include <sys/un.h>
@@ -40,13 +41,23 @@
 #define MIN_EPOLL_SOCKETS	(64)
 #define MAX_EPOLL_SOCKETS	(100000)
 #define DEFAULT_EPOLL_SOCKETS	(4096)
+#define MIN_EPOLL_THREADS	(1)
+#define MAX_EPOLL_THREADS	(64)
+
+#define EPOLL_SHARD_REUSEPORT	(0)
+#define EPOLL_SHARD_EXCLUSIVE	(1)
+#define EPOLL_SHARD_EVENTS	(64)
+#define EPOLL_SHARD_MSG_SIZE	(64)	/* request and reply size */
+#define EPOLL_SHARD_REQUESTS	(8)	/* requests per connection */
 
 static const stress_help_t help[] = {
 	{ NULL,	"epoll N",	  	"start N workers doing epoll handled socket activity" },
 	{ NULL,	"epoll-domain D", 	"specify socket domain, default is unix" },
 	{ NULL,	"epoll-ops N",	  	"stop after N epoll bogo operations" },
 	{ NULL,	"epoll-port P",	  	"use socket ports P upwards" },
+	{ NULL,	"epoll-shard M",	"run threaded event loops, M is reuseport or exclusive" },
 	{ NULL, "epoll-sockets N",	"specify maximum number of open sockets" },
+	{ NULL,	"epoll-threads N",	"number of event loop threads for epoll-shard" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -68,8 +79,39 @@ typedef void (stress_epoll_func_t)(
 
 static timer_t epoll_timerid;
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_EPOLL_CREATE1) &&	\
+    defined(SO_REUSEPORT) &&		\
+    defined(EPOLLEXCLUSIVE)
+#define STRESS_EPOLL_SHARD
+
+typedef struct {
+	struct sockaddr_storage addr;	/* listening address */
+	socklen_t addr_len;
+	int domain;
+	volatile bool stop;
+} epoll_shard_t;
+
+typedef struct {
+	epoll_shard_t *shard;
+	pthread_t pthread;
+	int efd;			/* server epoll fd */
+	int sfd;			/* server listening socket */
+	uint64_t accepts;		/* connections accepted */
+	uint64_t requests;		/* requests replied to */
+	uint64_t wakeups;		/* epoll_wait returned events */
+	uint64_t herd_wakeups;		/* woken but no work to do */
+	uint64_t connect_fails;		/* client connect failures */
+} epoll_shard_thread_t;
+#endif
+
 #endif
 
+static const char * const epoll_shard_modes[] = {
+	"reuseport",
+	"exclusive",
+};
+
 static int max_servers = 1;
 
 /*
@@ -123,10 +165,46 @@ static int stress_set_epoll_sockets(const char *opt)
         return stress_set_setting("epoll-sockets", TYPE_ID_INT, &epoll_sockets);
 }
 
+/*
+ *  stress_set_epoll_shard()
+ *	set the sharded event loop mode
+ */
+static int stress_set_epoll_shard(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(epoll_shard_modes); i++) {
+		if (!strcmp(epoll_shard_modes[i], opt))
+			return stress_set_setting("epoll-shard", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "epoll-shard must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(epoll_shard_modes); i++)
+		(void)fprintf(stderr, " %s", epoll_shard_modes[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+/*
+ *  stress_set_epoll_threads()
+ *	set the number of sharded event loop threads
+ */
+static int stress_set_epoll_threads(const char *opt)
+{
+	uint32_t epoll_threads;
+
+	epoll_threads = stress_get_uint32(opt);
+	stress_check_range("epoll-threads", (uint64_t)epoll_threads,
+		MIN_EPOLL_THREADS, MAX_EPOLL_THREADS);
+	return stress_set_setting("epoll-threads", TYPE_ID_UINT32, &epoll_threads);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_epoll_domain,	stress_set_epoll_domain },
 	{ OPT_epoll_port,	stress_set_epoll_port },
+	{ OPT_epoll_shard,	stress_set_epoll_shard },
 	{ OPT_epoll_sockets,	stress_set_epoll_sockets },
+	{ OPT_epoll_threads,	stress_set_epoll_threads },
 	{ 0,			NULL }
 };
 
@@ -1006,6 +1084,329 @@ die:
 	_exit(rc);
 }
 
+#if defined(STRESS_EPOLL_SHARD)
+/*
+ *  epoll_shard_server()
+ *	pick an event from the epoll fd and service it, the
+ *	listening socket is accepted until it runs dry and
+ *	connections serve fixed size request/reply pairs
+ */
+static void *epoll_shard_server(void *arg)
+{
+	epoll_shard_thread_t *t = (epoll_shard_thread_t *)arg;
+	epoll_shard_t *shard = t->shard;
+	struct epoll_event events[EPOLL_SHARD_EVENTS];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!shard->stop) {
+		int i, n;
+		bool work = false;
+
+		n = epoll_wait(t->efd, events, EPOLL_SHARD_EVENTS, 100);
+		if (n <= 0)
+			continue;
+		t->wakeups++;
+
+		for (i = 0; i < n; i++) {
+			const int fd = events[i].data.fd;
+
+			if (fd == t->sfd) {
+				for (;;) {
+					const int cfd = accept(t->sfd, NULL, NULL);
+
+					if (cfd < 0)
+						break;
+					if ((epoll_set_fd_nonblock(cfd) < 0) ||
+					    (epoll_ctl_add(t->efd, cfd, EPOLLIN) < 0)) {
+						(void)close(cfd);
+						continue;
+					}
+					t->accepts++;
+					work = true;
+				}
+			} else {
+				char buf[EPOLL_SHARD_MSG_SIZE];
+				ssize_t ret;
+
+				ret = recv(fd, buf, sizeof(buf), 0);
+				if (ret > 0) {
+					if (send(fd, buf, (size_t)ret, MSG_NOSIGNAL) > 0)
+						t->requests++;
+					work = true;
+				} else if ((ret == 0) || (errno != EAGAIN)) {
+					/* closed or reset, epoll drops closed fds */
+					(void)close(fd);
+					work = true;
+				}
+			}
+		}
+		if (!work)
+			t->herd_wakeups++;
+	}
+	return NULL;
+}
+
+/*
+ *  epoll_shard_client()
+ *	connect, send EPOLL_SHARD_REQUESTS requests waiting for
+ *	each reply and close with a reset to avoid TIME_WAIT
+ *	connections filling up the connection table
+ */
+static void *epoll_shard_client(void *arg)
+{
+	epoll_shard_thread_t *t = (epoll_shard_thread_t *)arg;
+	epoll_shard_t *shard = t->shard;
+	char buf[EPOLL_SHARD_MSG_SIZE];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	(void)shim_memset(buf, 'x', sizeof(buf));
+
+	while (!shard->stop) {
+		struct linger lng;
+		struct timeval tv;
+		int fd, i;
+
+		fd = socket(shard->domain, SOCK_STREAM, 0);
+		if (fd < 0) {
+			(void)shim_sched_yield();
+			continue;
+		}
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		if (connect(fd, (struct sockaddr *)&shard->addr, shard->addr_len) < 0) {
+			t->connect_fails++;
+			(void)close(fd);
+			(void)shim_sched_yield();
+			continue;
+		}
+		for (i = 0; (i < EPOLL_SHARD_REQUESTS) && !shard->stop; i++) {
+			if (send(fd, buf, sizeof(buf), MSG_NOSIGNAL) != (ssize_t)sizeof(buf))
+				break;
+			if (recv(fd, buf, sizeof(buf), MSG_WAITALL) != (ssize_t)sizeof(buf))
+				break;
+		}
+		lng.l_onoff = 1;
+		lng.l_linger = 0;
+		(void)setsockopt(fd, SOL_SOCKET, SO_LINGER, &lng, sizeof(lng));
+		(void)close(fd);
+	}
+	return NULL;
+}
+
+/*
+ *  epoll_shard_listener()
+ *	create a non-blocking listening socket
+ */
+static int epoll_shard_listener(stress_args_t *args, epoll_shard_t *shard, const bool reuseport)
+{
+	int sfd, val = 1;
+
+	sfd = socket(shard->domain, SOCK_STREAM, 0);
+	if (sfd < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	(void)setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+	if (reuseport &&
+	    (setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) < 0)) {
+		pr_inf_skip("%s: setsockopt SO_REUSEPORT failed, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		(void)close(sfd);
+		return -2;
+	}
+	if (bind(sfd, (struct sockaddr *)&shard->addr, shard->addr_len) < 0) {
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(sfd);
+		return -1;
+	}
+	if ((epoll_set_fd_nonblock(sfd) < 0) || (listen(sfd, SOMAXCONN) < 0)) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		(void)close(sfd);
+		return -1;
+	}
+	return sfd;
+}
+
+/*
+ *  epoll_shard()
+ *	run epoll_threads event loops in the one process, either
+ *	each with its own SO_REUSEPORT listener or all sharing one
+ *	listener added with EPOLLEXCLUSIVE, driven by the same
+ *	number of client threads
+ */
+static int epoll_shard(
+	stress_args_t *args,
+	const pid_t mypid,
+	const int port,
+	const int epoll_domain,
+	const size_t epoll_shard_mode,
+	const uint32_t epoll_threads)
+{
+	const bool reuseport = (epoll_shard_mode == EPOLL_SHARD_REUSEPORT);
+	epoll_shard_thread_t *servers, *clients;
+	epoll_shard_t shard;
+	struct sockaddr *addr = NULL;
+	uint64_t accepts = 0, requests = 0, wakeups = 0, herd_wakeups = 0;
+	uint64_t connect_fails = 0, accepts_min = UINT64_MAX, accepts_max = 0;
+	uint32_t i, n_servers = 0, n_clients = 0;
+	int shared_sfd = -1, rc = EXIT_SUCCESS;
+	double t_start, duration;
+
+	(void)shim_memset(&shard, 0, sizeof(shard));
+	/* SO_REUSEPORT and EPOLLEXCLUSIVE model TCP servers, so unix maps to ipv4 */
+	shard.domain = (epoll_domain == AF_UNIX) ? AF_INET : epoll_domain;
+	if (stress_set_sockaddr(args->name, args->instance, mypid,
+		shard.domain, port, &addr, &shard.addr_len, NET_ADDR_ANY) < 0)
+		return EXIT_FAILURE;
+	if (shard.addr_len > sizeof(shard.addr))
+		return EXIT_FAILURE;
+	(void)shim_memcpy(&shard.addr, addr, shard.addr_len);
+
+	servers = (epoll_shard_thread_t *)calloc((size_t)epoll_threads, sizeof(*servers));
+	clients = (epoll_shard_thread_t *)calloc((size_t)epoll_threads, sizeof(*clients));
+	if (!servers || !clients) {
+		pr_inf_skip("%s: cannot allocate thread state, skipping stressor\n", args->name);
+		free(clients);
+		free(servers);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < epoll_threads; i++)
+		servers[i].efd = servers[i].sfd = -1;
+
+	if (!reuseport) {
+		shared_sfd = epoll_shard_listener(args, &shard, false);
+		if (shared_sfd < 0) {
+			rc = EXIT_FAILURE;
+			goto free_threads;
+		}
+	}
+	for (i = 0; i < epoll_threads; i++) {
+		epoll_shard_thread_t *t = &servers[i];
+		const uint32_t events = reuseport ? EPOLLIN : EPOLLIN | EPOLLEXCLUSIVE;
+
+		t->shard = &shard;
+		t->sfd = reuseport ? epoll_shard_listener(args, &shard, true) : shared_sfd;
+		if (t->sfd < 0) {
+			rc = (t->sfd == -2) ? EXIT_NO_RESOURCE : EXIT_FAILURE;
+			goto close_fds;
+		}
+		t->efd = epoll_create1(0);
+		if (t->efd < 0) {
+			pr_fail("%s: epoll_create1 failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		if (epoll_ctl_add(t->efd, t->sfd, events) < 0) {
+			if (!reuseport && (errno == EINVAL)) {
+				pr_inf_skip("%s: EPOLLEXCLUSIVE not supported, skipping stressor\n",
+					args->name);
+				rc = EXIT_NO_RESOURCE;
+			} else {
+				pr_fail("%s: epoll_ctl_add failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+			}
+			goto close_fds;
+		}
+	}
+
+	for (i = 0; i < epoll_threads; i++) {
+		if (pthread_create(&servers[i].pthread, NULL, epoll_shard_server, &servers[i]))
+			break;
+		n_servers++;
+	}
+	for (i = 0; (n_servers == epoll_threads) && (i < epoll_threads); i++) {
+		clients[i].shard = &shard;
+		if (pthread_create(&clients[i].pthread, NULL, epoll_shard_client, &clients[i]))
+			break;
+		n_clients++;
+	}
+	if ((n_servers == 0) || (n_clients == 0)) {
+		pr_inf_skip("%s: cannot create server and client threads, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+	}
+
+	t_start = stress_time_now();
+	while ((rc == EXIT_SUCCESS) && stress_continue(args)) {
+		uint64_t total = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_servers; i++)
+			total += servers[i].requests;
+		stress_bogo_set(args, total);
+	}
+	/* stop clients first so no request is left waiting on a server */
+	shard.stop = true;
+	for (i = 0; i < n_clients; i++)
+		(void)pthread_join(clients[i].pthread, NULL);
+	for (i = 0; i < n_servers; i++)
+		(void)pthread_join(servers[i].pthread, NULL);
+	duration = stress_time_now() - t_start;
+
+	for (i = 0; i < n_servers; i++) {
+		const epoll_shard_thread_t *t = &servers[i];
+
+		accepts += t->accepts;
+		requests += t->requests;
+		wakeups += t->wakeups;
+		herd_wakeups += t->herd_wakeups;
+		accepts_min = STRESS_MINIMUM(accepts_min, t->accepts);
+		accepts_max = STRESS_MAXIMUM(accepts_max, t->accepts);
+	}
+	for (i = 0; i < n_clients; i++)
+		connect_fails += clients[i].connect_fails;
+	stress_bogo_set(args, requests);
+
+	if ((rc == EXIT_SUCCESS) && (duration > 0.0)) {
+		const double herd_pct = wakeups ? 100.0 * (double)herd_wakeups / (double)wakeups : 0.0;
+
+		pr_dbg("%s: %s, %" PRIu32 " threads, %" PRIu64 " accepts, %" PRIu64
+			" requests, %" PRIu64 " of %" PRIu64 " wakeups with no work, "
+			"%" PRIu64 " failed connects, per thread accepts %" PRIu64 "..%" PRIu64 "\n",
+			args->name, epoll_shard_modes[epoll_shard_mode], epoll_threads,
+			accepts, requests, herd_wakeups, wakeups, connect_fails,
+			accepts_min, accepts_max);
+		stress_metrics_set(args, 0, "accepted connections per sec",
+			(double)accepts / duration, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "requests per sec",
+			(double)requests / duration, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 2, "wakeups with no work per sec",
+			(double)herd_wakeups / duration, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "% wakeups with no work",
+			herd_pct, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "busiest / idlest thread accepts",
+			accepts_min ? (double)accepts_max / (double)accepts_min : 0.0,
+			STRESS_GEOMETRIC_MEAN);
+	}
+
+close_fds:
+	for (i = 0; i < epoll_threads; i++) {
+		if (servers[i].efd != -1)
+			(void)close(servers[i].efd);
+		if (reuseport && (servers[i].sfd >= 0))
+			(void)close(servers[i].sfd);
+	}
+	if (shared_sfd >= 0)
+		(void)close(shared_sfd);
+free_threads:
+	free(clients);
+	free(servers);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_epoll
  *	stress by heavy socket I/O
@@ -1018,10 +1419,19 @@ static int stress_epoll(stress_args_t *args)
 	int epoll_port = DEFAULT_EPOLL_PORT;
 	int epoll_sockets = DEFAULT_EPOLL_SOCKETS;
 	int start_port, end_port, reserved_port;
+	size_t epoll_shard_mode = EPOLL_SHARD_REUSEPORT;
+	uint32_t epoll_threads;
+	bool epoll_shard_set;
 
 	(void)stress_get_setting("epoll-domain", &epoll_domain);
 	(void)stress_get_setting("epoll-port", &epoll_port);
 	(void)stress_get_setting("epoll-sockets", &epoll_sockets);
+	epoll_shard_set = stress_get_setting("epoll-shard", &epoll_shard_mode);
+	if (!stress_get_setting("epoll-threads", &epoll_threads)) {
+		const int32_t cpus = stress_get_processors_online();
+
+		epoll_threads = (uint32_t)STRESS_MAXIMUM(2, STRESS_MINIMUM(16, cpus));
+	}
 
 	if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0)
 		return EXIT_NO_RESOURCE;
@@ -1063,6 +1473,20 @@ static int stress_epoll(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (epoll_shard_set) {
+#if defined(STRESS_EPOLL_SHARD)
+		rc = epoll_shard(args, mypid, start_port, epoll_domain,
+				epoll_shard_mode, epoll_threads);
+#else
+		pr_inf_skip("%s: epoll-shard requires pthreads, SO_REUSEPORT and "
+			"EPOLLEXCLUSIVE, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+#endif
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		stress_net_release_ports(start_port, end_port);
+		return rc;
+	}
+
 	/*
 	 *  Spawn off servers to handle multi port connections.
 	 *  The (src address, src port, dst address, dst port) tuple
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-event-reap.h"
 #include "core-killpid.h"
 
 #if defined(HAVE_SYS_EVENTFD_H)
@@ -28,18 +29,71 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"eventfd N",		"start N workers stressing eventfd read/writes" },
+	{ NULL,	"eventfd-fds N",	"number of eventfds to reap with eventfd-reap" },
 	{ NULL, "eventfs-nonblock",	"poll with non-blocking I/O on eventfd fd" },
 	{ NULL,	"eventfd-ops N",	"stop eventfd workers after N bogo operations" },
+	{ NULL,	"eventfd-reap M",	"reap eventfd wake-ups in batches using epoll or io-uring" },
 	{ NULL,	NULL,			NULL }
 };
 
+#define MIN_EVENTFD_FDS		(1)
+#define MAX_EVENTFD_FDS		(65536)
+#define DEFAULT_EVENTFD_FDS	(1024)
+
+#define EVENTFD_REAP_NONE	(-1)	/* default, paired read/writes */
+
+typedef struct {
+	const char *name;	/* reap method name */
+	const int method;	/* stress_event_reap_method_t */
+} stress_eventfd_reap_t;
+
+static const stress_eventfd_reap_t eventfd_reaps[] = {
+	{ "epoll",	STRESS_EVENT_REAP_EPOLL },
+	{ "io-uring",	STRESS_EVENT_REAP_IO_URING },
+};
+
+/*
+ *  stress_set_eventfd_fds()
+ *	set number of eventfds used by the batched reap mode
+ */
+static int stress_set_eventfd_fds(const char *opt)
+{
+	int eventfd_fds;
+
+	eventfd_fds = (int)stress_get_uint32(opt);
+	stress_check_range("eventfd-fds", (uint64_t)eventfd_fds,
+		MIN_EVENTFD_FDS, MAX_EVENTFD_FDS);
+	return stress_set_setting("eventfd-fds", TYPE_ID_INT, &eventfd_fds);
+}
+
 static int stress_set_eventfd_nonblock(const char *opt)
 {
 	return stress_set_setting_true("eventfd-nonblock", opt);
 }
 
+/*
+ *  stress_set_eventfd_reap()
+ *	set the batched eventfd wake-up reaping method
+ */
+static int stress_set_eventfd_reap(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(eventfd_reaps); i++) {
+		if (!strcmp(eventfd_reaps[i].name, opt))
+			return stress_set_setting("eventfd-reap", TYPE_ID_INT, &eventfd_reaps[i].method);
+	}
+	(void)fprintf(stderr, "eventfd-reap must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(eventfd_reaps); i++)
+		(void)fprintf(stderr, " %s", eventfd_reaps[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_eventfd_fds,	stress_set_eventfd_fds },
 	{ OPT_eventfd_nonblock,	stress_set_eventfd_nonblock },
+	{ OPT_eventfd_reap,	stress_set_eventfd_reap },
 	{ 0,			NULL }
 };
 
@@ -47,6 +101,148 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
     defined(HAVE_EVENTFD) && \
     NEED_GLIBC(2,8,0)
 
+/*
+ *  stress_eventfd_reap()
+ *	a child writes to randomly chosen eventfds while the parent
+ *	reaps the wake-ups in batches using epoll or io_uring multishot
+ *	polls, report wake-ups per second and the number of wait and
+ *	read syscalls needed per wake-up
+ */
+static int stress_eventfd_reap(stress_args_t *args, const int method)
+{
+	const char *name = eventfd_reaps[method].name;
+	int eventfd_fds = DEFAULT_EVENTFD_FDS;
+	int *fds, *ready, i, n_fds = 0, rc = EXIT_SUCCESS;
+	stress_event_reap_t *reap;
+	uint64_t wakeups = 0, events = 0, reaps = 0, reads = 0;
+	double t_start, duration;
+	pid_t pid;
+
+	(void)stress_get_setting("eventfd-fds", &eventfd_fds);
+
+	fds = (int *)calloc((size_t)eventfd_fds, sizeof(*fds));
+	ready = (int *)calloc((size_t)eventfd_fds, sizeof(*ready));
+	if (!fds || !ready) {
+		pr_inf_skip("%s: cannot allocate %d eventfd file descriptors, "
+			"skipping stressor\n", args->name, eventfd_fds);
+		rc = EXIT_NO_RESOURCE;
+		goto free_fds;
+	}
+	reap = stress_event_reap_create((stress_event_reap_method_t)eventfd_reaps[method].method,
+		(size_t)eventfd_fds);
+	if (!reap) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot create %s reaper, errno=%d (%s), "
+				"skipping stressor\n", args->name, name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto free_fds;
+	}
+
+	for (i = 0; i < eventfd_fds; i++) {
+		/* multishot polls can report an fd that has already been read */
+		fds[n_fds] = eventfd(0, EFD_NONBLOCK);
+		if (fds[n_fds] < 0)
+			break;
+		if (stress_event_reap_add(reap, fds[n_fds]) < 0) {
+			pr_fail("%s: cannot add eventfd to %s reaper, errno=%d (%s)\n",
+				args->name, name, errno, strerror(errno));
+			(void)close(fds[n_fds]);
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		n_fds++;
+	}
+	if (n_fds == 0) {
+		pr_inf_skip("%s: cannot create any eventfds, errno=%d (%s), "
+			"skipping stressor\n", args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto close_fds;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (stress_continue(args))
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		rc = stress_continue(args) ? EXIT_FAILURE : EXIT_SUCCESS;
+		goto close_fds;
+	} else if (pid == 0) {
+		const uint64_t val = 1;
+
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+
+		while (stress_continue_flag()) {
+			const int fd = fds[stress_mwc32modn((uint32_t)n_fds)];
+
+			VOID_RET(ssize_t, write(fd, &val, sizeof(val)));
+		}
+		_exit(EXIT_SUCCESS);
+	}
+
+	t_start = stress_time_now();
+	do {
+		const int n = stress_event_reap_wait(reap, ready, n_fds, 500);
+
+		if (UNLIKELY(n < 0)) {
+			pr_fail("%s: %s reap failed, errno=%d (%s)\n",
+				args->name, name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		reaps++;
+		for (i = 0; i < n; i++) {
+			uint64_t val;
+			ssize_t ret;
+
+			reads++;
+			ret = read(ready[i], &val, sizeof(val));
+			if (UNLIKELY(ret < 0)) {
+				if (errno == EAGAIN)
+					continue;
+				pr_fail("%s: eventfd read failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			wakeups++;
+			events += val;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+done:
+	duration = stress_time_now() - t_start;
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)stress_kill_pid_wait(pid, NULL);
+
+	if (wakeups > 0) {
+		const uint64_t syscalls = stress_event_reap_syscalls(reap) + reads;
+
+		stress_metrics_set(args, 0, "wake-ups per second",
+			duration > 0.0 ? (double)wakeups / duration : 0.0, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "syscalls per wake-up",
+			(double)syscalls / (double)wakeups, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "wake-ups per reap",
+			reaps ? (double)wakeups / (double)reaps : 0.0, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "eventfd writes per wake-up",
+			(double)events / (double)wakeups, STRESS_GEOMETRIC_MEAN);
+	}
+
+close_fds:
+	for (i = 0; i < n_fds; i++)
+		(void)close(fds[i]);
+	stress_event_reap_destroy(reap);
+free_fds:
+	free(ready);
+	free(fds);
+
+	return rc;
+}
+
 /*
  *  stress_eventfd
  *	stress eventfd read/writes
@@ -57,8 +253,12 @@ static int stress_eventfd(stress_args_t *args)
 	int fd1, fd2, test_fd, rc;
 	int flags = 0, parent_cpu;
 	bool eventfd_nonblock = false;
+	int eventfd_reap = EVENTFD_REAP_NONE;
 
 	(void)stress_get_setting("eventfd-nonblock", &eventfd_nonblock);
+	(void)stress_get_setting("eventfd-reap", &eventfd_reap);
+	if (eventfd_reap != EVENTFD_REAP_NONE)
+		return stress_eventfd_reap(args, eventfd_reap);
 
 #if defined(EFD_CLOEXEC)
 	flags |= EFD_CLOEXEC;
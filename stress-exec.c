@@ -18,7 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_SPAWN_H)
@@ -53,6 +55,16 @@ UNEXPECTED
 #define EXEC_FORK_METHOD_RFORK	(0x14)
 #endif
 
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(__linux__) &&		\
+    defined(__NR_clone3) &&		\
+    defined(__NR_execve) &&		\
+    defined(__NR_exit) &&		\
+    defined(CLONE_VM) &&		\
+    defined(CLONE_VFORK)
+#define EXEC_COMPARE_CLONE3
+#endif
+
 #define MAX_ARG_PAGES		(32)
 
 #define CLONE_STACK_SIZE	(8 * 1024)
@@ -85,6 +97,24 @@ typedef struct stress_pid_hash {
 #endif
 } stress_pid_hash_t;
 
+/*
+ *  binary launched by all the --exec-compare launch methods
+ */
+typedef struct {
+	const char *prog;		/* path to program to launch */
+	char **argv;			/* program argv[] */
+	char **env;			/* program env[] */
+#if defined(HAVE_EXECVEAT) &&	\
+    defined(O_PATH)
+	int fdexec;			/* O_PATH fd of program */
+#endif
+} stress_exec_compare_t;
+
+typedef struct {
+	const char *name;		/* launch method name */
+	pid_t (*launch)(const stress_exec_compare_t *cmp);
+} stress_exec_compare_method_t;
+
 static size_t stress_pid_cache_index = 0;
 static size_t stress_pid_cache_items = 0;
 static stress_pid_hash_t *stress_pid_cache;
@@ -123,6 +153,7 @@ static const stress_exec_method_t stress_exec_fork_methods[] = {
 
 static const stress_help_t help[] = {
 	{ NULL,	"exec N",		"start N workers spinning on fork() and exec()" },
+	{ NULL,	"exec-compare",		"compare process launch methods against parent RSS size" },
 	{ NULL,	"exec-fork-method M",	"select exec fork method:"
 #if defined(HAVE_CLONE)
 					" clone"
@@ -216,7 +247,17 @@ static int stress_set_exec_no_pthread(const char *opt)
 	return stress_set_setting_true("exec-no-pthread", opt);
 }
 
+/*
+ *  stress_set_exec_compare()
+ *	set flag to compare launch methods
+ */
+static int stress_set_exec_compare(const char *opt)
+{
+	return stress_set_setting_true("exec-compare", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_exec_compare,	stress_set_exec_compare },
 	{ OPT_exec_max,		stress_set_exec_max },
 	{ OPT_exec_method,	stress_set_exec_method },
 	{ OPT_exec_fork_method,	stress_set_exec_fork_method },
@@ -695,6 +736,408 @@ do_exec:
 	return rc;
 }
 
+/*
+ *  stress_exec_compare_fork()
+ *	fork and execve the comparison binary
+ */
+static pid_t stress_exec_compare_fork(const stress_exec_compare_t *cmp)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid == 0) {
+		(void)execve(cmp->prog, cmp->argv, cmp->env);
+		_exit(EXIT_NOT_SUCCESS);
+	}
+	return pid;
+}
+
+#if defined(HAVE_VFORK)
+/*
+ *  stress_exec_compare_vfork()
+ *	vfork and execve the comparison binary
+ */
+static pid_t stress_exec_compare_vfork(const stress_exec_compare_t *cmp)
+{
+	pid_t pid;
+
+	pid = shim_vfork();
+	if (pid == 0) {
+		(void)execve(cmp->prog, cmp->argv, cmp->env);
+		_exit(EXIT_NOT_SUCCESS);
+	}
+	return pid;
+}
+#endif
+
+#if defined(EXEC_COMPARE_CLONE3)
+/*
+ *  stress_exec_compare_clone3()
+ *	clone3 with CLONE_VM | CLONE_VFORK and execve the comparison
+ *	binary. The child shares the parent's memory and stack so it
+ *	must not touch the stack, hence the child goes straight from
+ *	clone3 to the execve and exit system calls in the same asm
+ */
+static pid_t stress_exec_compare_clone3(const stress_exec_compare_t *cmp)
+{
+	struct shim_clone_args cl_args;
+	register long int rax __asm__("rax") = __NR_clone3;
+	register long int rdi __asm__("rdi") = (long int)&cl_args;
+	register long int rsi __asm__("rsi") = (long int)sizeof(cl_args);
+	register long int r8 __asm__("r8") = (long int)cmp->prog;
+	register long int r9 __asm__("r9") = (long int)cmp->argv;
+	register long int r10 __asm__("r10") = (long int)cmp->env;
+
+	(void)shim_memset(&cl_args, 0, sizeof(cl_args));
+	cl_args.flags = CLONE_VM | CLONE_VFORK;
+	cl_args.exit_signal = SIGCHLD;
+
+	__asm__ __volatile__(
+		"syscall\n\t"
+		"testq %%rax, %%rax\n\t"
+		"jnz 1f\n\t"
+		"movq %%r8, %%rdi\n\t"
+		"movq %%r9, %%rsi\n\t"
+		"movq %%r10, %%rdx\n\t"
+		"movl %[nr_execve], %%eax\n\t"
+		"syscall\n\t"
+		"movl %[status], %%edi\n\t"
+		"movl %[nr_exit], %%eax\n\t"
+		"syscall\n\t"
+		"1:\n\t"
+		: "+r" (rax)
+		: "r" (rdi), "r" (rsi), "r" (r8), "r" (r9), "r" (r10),
+		  [nr_execve] "i" (__NR_execve),
+		  [nr_exit] "i" (__NR_exit),
+		  [status] "i" (EXIT_NOT_SUCCESS)
+		: "rcx", "rdx", "r11", "memory");
+
+	if (rax < 0) {
+		errno = (int)-rax;
+		return -1;
+	}
+	return (pid_t)rax;
+}
+#endif
+
+#if defined(HAVE_SPAWN_H) &&	\
+    defined(HAVE_POSIX_SPAWN)
+/*
+ *  stress_exec_compare_spawn()
+ *	posix_spawn the comparison binary
+ */
+static pid_t stress_exec_compare_spawn(const stress_exec_compare_t *cmp)
+{
+	pid_t pid;
+
+	if (posix_spawn(&pid, cmp->prog, NULL, NULL, cmp->argv, cmp->env) != 0)
+		return -1;
+	return pid;
+}
+#endif
+
+#if defined(HAVE_EXECVEAT) &&	\
+    defined(O_PATH)
+/*
+ *  stress_exec_compare_execveat()
+ *	fork and execveat the comparison binary by its O_PATH fd
+ */
+static pid_t stress_exec_compare_execveat(const stress_exec_compare_t *cmp)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid == 0) {
+		(void)shim_execveat(cmp->fdexec, "", cmp->argv, cmp->env, AT_EMPTY_PATH);
+		_exit(EXIT_NOT_SUCCESS);
+	}
+	return pid;
+}
+#endif
+
+static const stress_exec_compare_method_t stress_exec_compare_methods[] = {
+	{ "fork",	stress_exec_compare_fork },
+#if defined(HAVE_VFORK)
+	{ "vfork",	stress_exec_compare_vfork },
+#endif
+#if defined(EXEC_COMPARE_CLONE3)
+	{ "clone3",	stress_exec_compare_clone3 },
+#endif
+#if defined(HAVE_SPAWN_H) &&	\
+    defined(HAVE_POSIX_SPAWN)
+	{ "spawn",	stress_exec_compare_spawn },
+#endif
+#if defined(HAVE_EXECVEAT) &&	\
+    defined(O_PATH)
+	{ "execveat",	stress_exec_compare_execveat },
+#endif
+};
+
+/*
+ *  stress_exec_compare_tiny()
+ *	write the tiny static binary to path, returns false
+ *	if there is no tiny binary for this architecture
+ */
+static bool stress_exec_compare_tiny(const char *path)
+{
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(__linux__)
+	/* ELF64 header, one PT_LOAD program header and exit(0) code */
+	static const uint8_t tiny[] = {
+		/* e_ident, ELFCLASS64, ELFDATA2LSB, EV_CURRENT */
+		0x7f, 'E',  'L',  'F',  0x02, 0x01, 0x01, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* e_type ET_EXEC, e_machine EM_X86_64, e_version */
+		0x02, 0x00, 0x3e, 0x00, 0x01, 0x00, 0x00, 0x00,
+		/* e_entry 0x400078 */
+		0x78, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* e_phoff 64 */
+		0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* e_shoff 0 */
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* e_flags, e_ehsize 64, e_phentsize 56, e_phnum 1 */
+		0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x38, 0x00,
+		/* e_phnum 1, e_shentsize, e_shnum, e_shstrndx */
+		0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* p_type PT_LOAD, p_flags PF_R | PF_X */
+		0x01, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00,
+		/* p_offset 0 */
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* p_vaddr 0x400000 */
+		0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* p_paddr 0x400000 */
+		0x00, 0x00, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* p_filesz 129 */
+		0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* p_memsz 129 */
+		0x81, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* p_align 4096 */
+		0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* xor %edi, %edi; mov $60, %eax; syscall */
+		0x31, 0xff, 0xb8, 0x3c, 0x00, 0x00, 0x00, 0x0f,
+		0x05,
+	};
+	ssize_t n;
+	int fd;
+
+	fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IXUSR);
+	if (fd < 0)
+		return false;
+	n = write(fd, tiny, sizeof(tiny));
+	(void)close(fd);
+	if (n != (ssize_t)sizeof(tiny)) {
+		(void)shim_unlink(path);
+		return false;
+	}
+	return true;
+#else
+	(void)path;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_exec_compare_launch()
+ *	launch the comparison binary with the given method and
+ *	wait for it to exit, returns the launch to exit time in
+ *	nanoseconds or 0 on failure
+ */
+static uint64_t stress_exec_compare_launch(
+	const stress_exec_compare_method_t *method,
+	const stress_exec_compare_t *cmp)
+{
+	sigset_t set, oldset;
+	double t1, t2;
+	pid_t pid;
+	int status;
+
+	/*
+	 *  vfork and clone3 children share the parent's stack
+	 *  until they exec, so no signal handlers must run in them
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, &oldset);
+	t1 = stress_time_now();
+	pid = method->launch(cmp);
+	(void)sigprocmask(SIG_SETMASK, &oldset, NULL);
+	if (pid < 0)
+		return 0;
+	if (shim_waitpid(pid, &status, 0) < 0)
+		return 0;
+	t2 = stress_time_now();
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+		return 0;
+	return (t2 > t1) ? (uint64_t)((t2 - t1) * STRESS_DBL_NANOSECOND) : 1;
+}
+
+/*
+ *  stress_exec_compare()
+ *	compare the launch to exit latencies of the process
+ *	launch methods launching the same binary as the parent's
+ *	resident set size is stepped up
+ */
+static int stress_exec_compare(
+	stress_args_t *args,
+	char *exec_prog,
+	const char *tiny_prog)
+{
+	static const size_t rss_sizes[] = { 0, 64 * MB, 512 * MB };
+	const size_t n_methods = SIZEOF_ARRAY(stress_exec_compare_methods);
+	stress_exec_compare_t cmp;
+	stress_latency_t *lat;
+	size_t shmall, freemem, totalmem, freeswap, totalswap;
+	size_t rss_max, rss_touched = 0, n_rss, i, j, metric = 0;
+	uint8_t *rss = MAP_FAILED;
+	uint64_t fails = 0;
+	double level_duration;
+	char *argv[3];
+	char *env[1];
+	int rc = EXIT_SUCCESS;
+
+	/* launch the tiny binary if possible, otherwise stress-ng --exec-exit */
+	argv[0] = exec_prog;
+	argv[1] = "--exec-exit";
+	argv[2] = NULL;
+	env[0] = NULL;
+	cmp.prog = exec_prog;
+	cmp.argv = argv;
+	cmp.env = env;
+	if (stress_exec_compare_tiny(tiny_prog)) {
+		cmp.prog = tiny_prog;
+		argv[0] = (char *)tiny_prog;
+		argv[1] = NULL;
+		if (stress_exec_compare_launch(&stress_exec_compare_methods[0], &cmp) == 0) {
+			cmp.prog = exec_prog;
+			argv[0] = exec_prog;
+			argv[1] = "--exec-exit";
+		}
+	}
+	if ((args->instance == 0) && (cmp.prog == exec_prog))
+		pr_inf("%s: cannot run a tiny static binary, launching %s instead\n",
+			args->name, exec_prog);
+#if defined(HAVE_EXECVEAT) &&	\
+    defined(O_PATH)
+	cmp.fdexec = open(cmp.prog, O_PATH);
+	if (cmp.fdexec < 0) {
+		pr_fail("%s: open O_PATH on %s failed, errno=%d (%s)\n",
+			args->name, cmp.prog, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+#endif
+
+	/* limit the parent RSS sizes to a fraction of free memory */
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	rss_max = freemem / 2 / (size_t)STRESS_MAXIMUM(1, args->num_instances);
+	for (n_rss = 1; n_rss < SIZEOF_ARRAY(rss_sizes); n_rss++) {
+		if (rss_sizes[n_rss] > rss_max)
+			break;
+	}
+	if (rss_sizes[n_rss - 1] > 0) {
+		rss = (uint8_t *)mmap(NULL, rss_sizes[n_rss - 1], PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (rss == MAP_FAILED)
+			n_rss = 1;
+	}
+
+	lat = (stress_latency_t *)calloc(n_rss * n_methods, sizeof(*lat));
+	if (!lat) {
+		pr_inf_skip("%s: cannot allocate latency histograms, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto err;
+	}
+
+	level_duration = (double)g_opt_timeout / (double)n_rss;
+	if (level_duration < 1.0)
+		level_duration = 1.0;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	for (i = 0; (i < n_rss) && stress_continue(args); i++) {
+		double t_end;
+
+		/* grow the parent's RSS, unique data per page to defeat merging */
+		for (; rss_touched < rss_sizes[i]; rss_touched += args->page_size) {
+			rss[rss_touched] = 0x5a;
+			*(size_t *)(rss + rss_touched + sizeof(size_t)) = rss_touched;
+		}
+
+		t_end = stress_time_now() + level_duration;
+		do {
+			for (j = 0; j < n_methods; j++) {
+				const uint64_t ns = stress_exec_compare_launch(&stress_exec_compare_methods[j], &cmp);
+
+				if (ns)
+					stress_latency_add(&lat[(i * n_methods) + j], ns);
+				else
+					fails++;
+				stress_bogo_inc(args);
+			}
+		} while (stress_continue(args) && (stress_time_now() < t_end));
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %-8s %7s %10s %10s %10s %10s %10s\n", args->name,
+			"method", "RSS MB", "launch/s", "p50 us", "p90 us",
+			"p99 us", "p99.9 us");
+	}
+	for (i = 0; i < n_rss; i++) {
+		for (j = 0; j < n_methods; j++) {
+			const stress_latency_t *l = &lat[(i * n_methods) + j];
+			const char *name = stress_exec_compare_methods[j].name;
+			const size_t rss_mb = rss_sizes[i] / MB;
+			const double rate = (l->sum > 0.0) ? (double)l->count * STRESS_DBL_NANOSECOND / l->sum : 0.0;
+			char str[64];
+
+			if (l->count == 0)
+				continue;
+			if (args->latency)
+				stress_latency_merge(args->latency, l);
+			if (args->instance == 0) {
+				pr_inf("%s: %-8s %7zu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+					args->name, name, rss_mb, rate,
+					(double)stress_latency_percentile(l, 50.0) / 1000.0,
+					(double)stress_latency_percentile(l, 90.0) / 1000.0,
+					(double)stress_latency_percentile(l, 99.0) / 1000.0,
+					(double)stress_latency_percentile(l, 99.9) / 1000.0);
+			}
+			(void)snprintf(str, sizeof(str), "%s launches per sec at %zuMB RSS", name, rss_mb);
+			stress_metrics_set(args, metric++, str, rate, STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s launch p50 usec at %zuMB RSS", name, rss_mb);
+			stress_metrics_set(args, metric++, str,
+				(double)stress_latency_percentile(l, 50.0) / 1000.0,
+				STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s launch p99 usec at %zuMB RSS", name, rss_mb);
+			stress_metrics_set(args, metric++, str,
+				(double)stress_latency_percentile(l, 99.0) / 1000.0,
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+	if ((fails > 0) && (g_opt_flags & OPT_FLAGS_VERIFY)) {
+		pr_fail("%s: %" PRIu64 " process launches failed\n",
+			args->name, fails);
+		rc = EXIT_FAILURE;
+	}
+	free(lat);
+err:
+	if (rss != MAP_FAILED)
+		(void)munmap((void *)rss, rss_sizes[n_rss - 1]);
+#if defined(HAVE_EXECVEAT) &&	\
+    defined(O_PATH)
+	(void)close(cmp.fdexec);
+#endif
+	(void)shim_unlink(tiny_prog);
+
+	return rc;
+}
+
 /*
  *  stress_exec()
  *	stress by forking and exec'ing
@@ -714,9 +1157,11 @@ static int stress_exec(stress_args_t *args)
 	int exec_method = EXEC_METHOD_ALL;
 	int exec_fork_method = EXEC_FORK_METHOD_FORK;
 	bool exec_no_pthread = false;
+	bool exec_compare = false;
 	size_t arg_max, cache_max;
 	char *str;
 
+	(void)stress_get_setting("exec-compare", &exec_compare);
 	(void)stress_get_setting("exec-max", &exec_max);
 	(void)stress_get_setting("exec-method", &exec_method);
 	(void)stress_get_setting("exec-fork-method", &exec_fork_method);
@@ -777,6 +1222,15 @@ static int stress_exec(stress_args_t *args)
 	(void)stress_temp_filename_args(args,
 		garbage_prog, sizeof(garbage_prog), stress_mwc32());
 
+	if (exec_compare) {
+		char tiny_prog[PATH_MAX];
+
+		(void)stress_temp_filename_args(args,
+			tiny_prog, sizeof(tiny_prog), stress_mwc32());
+		rc = stress_exec_compare(args, exec_prog, tiny_prog);
+		goto tidy;
+	}
+
 #if defined(HAVE_EXECVEAT) &&	\
     defined(O_PATH)
 	fdexec = open(exec_prog, O_PATH);
@@ -945,6 +1399,7 @@ static int stress_exec(stress_args_t *args)
     defined(O_PATH)
 err:
 #endif
+tidy:
 	stress_exec_free_pid();
 
 	if (str)
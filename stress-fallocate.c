@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-extents.h"
 
 #define MIN_FALLOCATE_BYTES	(1 * MB)
 #define MAX_FALLOCATE_BYTES	(MAX_FILE_LIMIT)
@@ -111,6 +112,8 @@ static int stress_fallocate(stress_args_t *args)
 	size_t i, mode_count;
 	const char *fs_type;
 	int count = 0;
+	stress_extents_t extents;
+	bool sample_extents = true;
 
 	for (all_modes = 0, i = 0; i < SIZEOF_ARRAY(modes); i++)
 		all_modes |= modes[i];
@@ -150,6 +153,7 @@ static int stress_fallocate(stress_args_t *args)
 	(void)shim_unlink(filename);
 
 	pipe_ret = pipe(pipe_fds);
+	stress_extents_init(&extents);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -235,6 +239,11 @@ static int stress_fallocate(stress_args_t *args)
 				if (!stress_continue_flag())
 					break;
 			}
+			/* Sample the layout left behind by the random mode operations */
+			if (sample_extents &&
+			    (stress_extents_sample(args, fd, fallocate_bytes, &extents) < 0))
+				sample_extents = false;
+
 			/* Exercise all the mode permutations, most will fail */
 			for (i = 0; i < mode_count; i++) {
 				const off_t offset = (off_t)stress_mwc64modn((uint64_t)fallocate_bytes) & ~0xfff;
@@ -297,6 +306,8 @@ static int stress_fallocate(stress_args_t *args)
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
+	stress_extents_metrics(args, 0, &extents);
+
 	if (ftrunc_errs)
 		pr_dbg("%s: %" PRIu64
 			" ftruncate errors occurred.\n", args->name, ftrunc_errs);
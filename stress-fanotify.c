@@ -21,6 +21,7 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-mounts.h"
 
 #if defined(HAVE_SYS_FANOTIFY_H)
@@ -33,10 +34,48 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"fanotify N",	  "start N workers exercising fanotify events" },
+	{ NULL,	"fanotify-events", "measure event delivery rate, latency and overflows over a mark sweep" },
+	{ NULL,	"fanotify-marks N", "sweep up to N marked directories in the event mode" },
 	{ NULL,	"fanotify-ops N", "stop fanotify workers after N bogo operations" },
+	{ NULL,	"fanotify-rate N", "generate N file events per second in the event mode, 0 = unlimited" },
 	{ NULL,	NULL,		  NULL }
 };
 
+#define MIN_FANOTIFY_MARKS	(1)
+#define MAX_FANOTIFY_MARKS	(65536)
+#define DEFAULT_FANOTIFY_MARKS	(256)
+
+static int stress_set_fanotify_events(const char *opt)
+{
+	return stress_set_setting_true("fanotify-events", opt);
+}
+
+static int stress_set_fanotify_marks(const char *opt)
+{
+	uint32_t fanotify_marks;
+
+	fanotify_marks = stress_get_uint32(opt);
+	stress_check_range("fanotify-marks", (uint64_t)fanotify_marks,
+		MIN_FANOTIFY_MARKS, MAX_FANOTIFY_MARKS);
+	return stress_set_setting("fanotify-marks", TYPE_ID_UINT32, &fanotify_marks);
+}
+
+static int stress_set_fanotify_rate(const char *opt)
+{
+	uint32_t fanotify_rate;
+
+	fanotify_rate = stress_get_uint32(opt);
+	stress_check_range("fanotify-rate", (uint64_t)fanotify_rate, 0, 100000000);
+	return stress_set_setting("fanotify-rate", TYPE_ID_UINT32, &fanotify_rate);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fanotify_events,	stress_set_fanotify_events },
+	{ OPT_fanotify_marks,	stress_set_fanotify_marks },
+	{ OPT_fanotify_rate,	stress_set_fanotify_rate },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_MNTENT_H) &&		\
     defined(HAVE_SYS_SELECT_H) && 	\
     defined(HAVE_SYS_FANOTIFY_H) &&	\
@@ -472,6 +511,392 @@ static void stress_fanotify_read_events(
 	}
 }
 
+#if defined(HAVE_SELECT) &&		\
+    defined(FAN_CLASS_NOTIF) &&		\
+    defined(FAN_NONBLOCK) &&		\
+    defined(FAN_MARK_ADD) &&		\
+    defined(FAN_CLOSE_WRITE) &&		\
+    defined(FAN_EVENT_ON_CHILD) &&	\
+    defined(FAN_Q_OVERFLOW)
+#define STRESS_FANOTIFY_EVENTS
+#endif
+
+#if defined(STRESS_FANOTIFY_EVENTS)
+
+#define FANOTIFY_EVENTS_DURATION	(0.25)		/* secs per sweep point per pass */
+#define FANOTIFY_EVENTS_DRAIN		(0.1)		/* secs to drain queued events */
+#define FANOTIFY_EVENTS_RING		(65536)		/* event timestamp ring entries */
+#define FANOTIFY_EVENTS_BUF_SIZE	(64 * KB)
+#define FANOTIFY_EVENTS_POINTS		(16)
+
+/* event generation time, indexed by event sequence number */
+typedef struct {
+	uint64_t seq;			/* sequence number of the event */
+	uint64_t ns;			/* time the event was generated */
+} stress_fanotify_stamp_t;
+
+/* shared between the event producer and the consumer */
+typedef struct {
+	uint64_t generated;		/* events generated by the producer */
+	double duration;		/* producer run time */
+	stress_fanotify_stamp_t stamps[FANOTIFY_EVENTS_RING];
+} stress_fanotify_events_shared_t;
+
+/* a sweep point and its accumulated results */
+typedef struct {
+	uint32_t marks;			/* number of marked directories */
+	uint64_t generated;		/* events generated */
+	uint64_t delivered;		/* events read from the fanotify fd */
+	uint64_t overflows;		/* FAN_Q_OVERFLOW events */
+	double duration;		/* producer run time of the passes */
+	stress_latency_t latency;	/* event delivery latency */
+} stress_fanotify_events_result_t;
+
+/*
+ *  stress_fanotify_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_fanotify_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_fanotify_events_producer()
+ *	write and close files round-robin across the marked
+ *	directories at the requested rate, each file holds its
+ *	event sequence number to match it with its timestamp
+ */
+static void NORETURN stress_fanotify_events_producer(
+	const char *pathname,
+	const uint32_t marks,
+	const uint32_t rate,
+	stress_fanotify_events_shared_t *shared)
+{
+	const uint64_t t_start = stress_fanotify_now_ns();
+	const uint64_t t_end = t_start + (uint64_t)(FANOTIFY_EVENTS_DURATION * STRESS_DBL_NANOSECOND);
+	uint64_t seq, t_now = t_start;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	for (seq = 0; stress_continue_flag() && (t_now < t_end); seq++) {
+		stress_fanotify_stamp_t *stamp = &shared->stamps[seq % FANOTIFY_EVENTS_RING];
+		char filename[PATH_MAX];
+		int fd;
+
+		if (rate) {
+			/* pace events to the rate, sleeping off any time in hand */
+			const uint64_t t_due = t_start + (seq * STRESS_NANOSECOND) / rate;
+
+			if (t_due >= t_end)
+				break;
+			if (t_due > t_now + 1000)
+				(void)shim_nanosleep_uint64(t_due - t_now);
+		}
+		(void)snprintf(filename, sizeof(filename), "%s/m%" PRIu32 "/e%" PRIu64,
+			pathname, (uint32_t)(seq % marks), seq);
+		fd = creat(filename, S_IRUSR | S_IWUSR);
+		if (fd >= 0) {
+			VOID_RET(ssize_t, write(fd, &seq, sizeof(seq)));
+			stamp->seq = seq;
+			stamp->ns = stress_fanotify_now_ns();
+			(void)close(fd);
+			(void)shim_unlink(filename);
+		}
+		t_now = stress_fanotify_now_ns();
+	}
+	shared->generated = seq;
+	shared->duration = (double)(t_now - t_start) / STRESS_DBL_NANOSECOND;
+	_exit(0);
+}
+
+/*
+ *  stress_fanotify_events_read()
+ *	read and account the queued fanotify events, the sequence
+ *	number is read back from the file the event fd refers to
+ */
+static void stress_fanotify_events_read(
+	const int fan_fd,
+	void *buffer,
+	const stress_fanotify_events_shared_t *shared,
+	stress_fanotify_events_result_t *result)
+{
+	for (;;) {
+		ssize_t len = read(fan_fd, buffer, FANOTIFY_EVENTS_BUF_SIZE);
+		const uint64_t t_now = stress_fanotify_now_ns();
+		struct fanotify_event_metadata *metadata;
+
+		if (len <= 0)
+			break;
+		for (metadata = (struct fanotify_event_metadata *)buffer;
+		     FAN_EVENT_OK(metadata, len);
+		     metadata = FAN_EVENT_NEXT(metadata, len)) {
+			uint64_t seq;
+
+			if (metadata->mask & FAN_Q_OVERFLOW) {
+				result->overflows++;
+				continue;
+			}
+			if ((metadata->fd == FAN_NOFD) || (metadata->fd < 0))
+				continue;
+			if (pread(metadata->fd, &seq, sizeof(seq), 0) == (ssize_t)sizeof(seq)) {
+				const stress_fanotify_stamp_t *stamp = &shared->stamps[seq % FANOTIFY_EVENTS_RING];
+
+				/* the producer may have lapped the ring, only time matching events */
+				if ((stamp->seq == seq) && (t_now >= stamp->ns))
+					stress_latency_add(&result->latency, t_now - stamp->ns);
+			}
+			result->delivered++;
+			(void)close(metadata->fd);
+		}
+	}
+}
+
+/*
+ *  stress_fanotify_events_pass()
+ *	mark the first result->marks directories and read events
+ *	from a producer process for the sweep duration, returns -1
+ *	on a failure, 1 if the marks cannot be added
+ */
+static int stress_fanotify_events_pass(
+	stress_args_t *args,
+	const char *pathname,
+	const uint32_t rate,
+	void *buffer,
+	stress_fanotify_events_shared_t *shared,
+	stress_fanotify_events_result_t *result)
+{
+	const uint64_t delivered = result->delivered;
+	const uint64_t overflows = result->overflows;
+	uint32_t i;
+	int fan_fd, status;
+	pid_t pid;
+	bool reaped = false;
+	double t_drain = 0.0;
+
+	fan_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_NONBLOCK, O_RDONLY);
+	if (fan_fd < 0) {
+		pr_fail("%s: fanotify_init failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < result->marks; i++) {
+		char dirname[PATH_MAX];
+
+		(void)snprintf(dirname, sizeof(dirname), "%s/m%" PRIu32, pathname, i);
+		if (fanotify_mark(fan_fd, FAN_MARK_ADD, FAN_CLOSE_WRITE | FAN_EVENT_ON_CHILD,
+				  AT_FDCWD, dirname) < 0) {
+			(void)close(fan_fd);
+			return 1;
+		}
+	}
+
+	shared->generated = 0;
+	shared->duration = 0.0;
+	pid = fork();
+	if (pid < 0) {
+		(void)close(fan_fd);
+		return 0;
+	} else if (pid == 0) {
+		stress_fanotify_events_producer(pathname, result->marks, rate, shared);
+	}
+
+	for (;;) {
+		struct timeval tv;
+		fd_set rfds;
+
+		tv.tv_sec = 0;
+		tv.tv_usec = 10000;
+		FD_ZERO(&rfds);
+		FD_SET(fan_fd, &rfds);
+		if (select(fan_fd + 1, &rfds, NULL, NULL, &tv) > 0)
+			stress_fanotify_events_read(fan_fd, buffer, shared, result);
+
+		if (!reaped) {
+			if (waitpid(pid, &status, WNOHANG) == pid) {
+				reaped = true;
+				t_drain = stress_time_now() + FANOTIFY_EVENTS_DRAIN;
+			} else if (!stress_continue_flag()) {
+				break;
+			}
+		} else if (stress_time_now() > t_drain) {
+			break;
+		}
+	}
+	if (reaped) {
+		result->generated += shared->generated;
+		result->duration += shared->duration;
+	} else {
+		/*
+		 *  discard the counts of an interrupted pass, SIGALRM
+		 *  stops the producer cleanly so it removes its last file
+		 */
+		(void)shim_kill(pid, SIGALRM);
+		(void)shim_waitpid(pid, &status, 0);
+		result->delivered = delivered;
+		result->overflows = overflows;
+	}
+	(void)close(fan_fd);
+	return 0;
+}
+
+/*
+ *  stress_fanotify_events_report()
+ *	report the event rates, delivery latencies and overflows
+ */
+static void stress_fanotify_events_report(
+	stress_args_t *args,
+	const stress_fanotify_events_result_t *results,
+	const size_t n_results)
+{
+	size_t i, metric = 0;
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %8s %12s %12s %10s %10s %10s %10s %10s\n", args->name,
+			"marks", "generated/s", "delivered/s", "overflows",
+			"lost", "p50 us", "p99 us", "p99.9 us");
+	}
+	for (i = 0; i < n_results; i++) {
+		const stress_fanotify_events_result_t *result = &results[i];
+		const stress_latency_t *l = &result->latency;
+		const uint64_t lost = (result->generated > result->delivered) ?
+			result->generated - result->delivered : 0;
+		double generated_rate, delivered_rate, p99;
+		char str[64];
+
+		if (result->duration <= 0.0)
+			continue;
+		generated_rate = (double)result->generated / result->duration;
+		delivered_rate = (double)result->delivered / result->duration;
+		p99 = (double)stress_latency_percentile(l, 99.0) / 1000.0;
+		if (args->latency)
+			stress_latency_merge(args->latency, l);
+		if (args->instance == 0) {
+			pr_inf("%s: %8" PRIu32 " %12.1f %12.1f %10" PRIu64 " %10" PRIu64
+				" %10.1f %10.1f %10.1f\n", args->name,
+				result->marks, generated_rate, delivered_rate,
+				result->overflows, lost,
+				(double)stress_latency_percentile(l, 50.0) / 1000.0, p99,
+				(double)stress_latency_percentile(l, 99.9) / 1000.0);
+		}
+		if (metric + 2 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(str, sizeof(str), "events delivered per sec, %" PRIu32 " marks", result->marks);
+		stress_metrics_set(args, metric++, str, delivered_rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "event p99 usec, %" PRIu32 " marks", result->marks);
+		stress_metrics_set(args, metric++, str, p99, STRESS_GEOMETRIC_MEAN);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+}
+
+/*
+ *  stress_fanotify_events()
+ *	generate file close-write events at a controlled rate across
+ *	a sweep of marked directory counts and measure the fanotify
+ *	event delivery rate, latency and queue overflows
+ */
+static int stress_fanotify_events(stress_args_t *args, const char *pathname)
+{
+	stress_fanotify_events_result_t *results;
+	stress_fanotify_events_shared_t *shared;
+	uint32_t marks = DEFAULT_FANOTIFY_MARKS, rate = 0, m, i;
+	size_t n_results = 0, idx = 0;
+	int rc = EXIT_SUCCESS;
+	void *buffer;
+
+	(void)stress_get_setting("fanotify-marks", &marks);
+	(void)stress_get_setting("fanotify-rate", &rate);
+
+	results = (stress_fanotify_events_result_t *)calloc(FANOTIFY_EVENTS_POINTS, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	buffer = malloc(FANOTIFY_EVENTS_BUF_SIZE);
+	if (!buffer) {
+		pr_inf_skip("%s: cannot allocate event buffer, skipping stressor\n", args->name);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	shared = (stress_fanotify_events_shared_t *)stress_mmap_populate(NULL, sizeof(*shared),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*shared), errno, strerror(errno));
+		free(buffer);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* mark counts of 1, 4, 16, .. up to and including the maximum */
+	for (m = 1; (m < marks) && (n_results < FANOTIFY_EVENTS_POINTS - 1); m *= 4)
+		results[n_results++].marks = m;
+	results[n_results++].marks = marks;
+
+	for (i = 0; i < marks; i++) {
+		char dirname[PATH_MAX];
+
+		(void)snprintf(dirname, sizeof(dirname), "%s/m%" PRIu32, pathname, i);
+		if ((mkdir(dirname, S_IRWXU) < 0) && (errno != EEXIST)) {
+			pr_inf_skip("%s: cannot create directory %s, errno=%d (%s), "
+				"skipping stressor\n", args->name, dirname, errno, strerror(errno));
+			marks = i;
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		const int ret = stress_fanotify_events_pass(args, pathname, rate,
+						buffer, shared, &results[idx]);
+		if (ret < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		} else if (ret > 0) {
+			/* drop sweep points beyond the fanotify mark limit */
+			if (args->instance == 0)
+				pr_inf("%s: cannot add %" PRIu32 " fanotify marks, check "
+					"/proc/sys/fs/fanotify/max_user_marks\n",
+					args->name, results[idx].marks);
+			n_results = idx;
+			if (n_results == 0) {
+				rc = EXIT_NO_RESOURCE;
+				break;
+			}
+		} else {
+			idx++;
+			stress_bogo_inc(args);
+		}
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_fanotify_events_report(args, results, n_results);
+tidy:
+	for (i = 0; i < marks; i++) {
+		char dirname[PATH_MAX];
+
+		(void)snprintf(dirname, sizeof(dirname), "%s/m%" PRIu32, pathname, i);
+		(void)shim_rmdir(dirname);
+	}
+	(void)munmap((void *)shared, sizeof(*shared));
+	free(buffer);
+	free(results);
+	return rc;
+}
+#endif
+
 /*
  *  stress_fanotify()
  *	stress fanotify
@@ -482,6 +907,25 @@ static int stress_fanotify(stress_args_t *args)
 	pid_t pid;
 	int ret, rc = EXIT_SUCCESS;
 	stress_fanotify_account_t account;
+	bool fanotify_events = false;
+
+	(void)stress_get_setting("fanotify-events", &fanotify_events);
+	if (fanotify_events) {
+#if defined(STRESS_FANOTIFY_EVENTS)
+		stress_temp_dir_args(args, pathname, sizeof(pathname));
+		ret = stress_temp_dir_mk_args(args);
+		if (ret < 0)
+			return stress_exit_status(-ret);
+		rc = stress_fanotify_events(args, pathname);
+		(void)stress_temp_dir_rm_args(args);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --fanotify-events requires FAN_CLASS_NOTIF, FAN_NONBLOCK "
+				"and FAN_EVENT_ON_CHILD support, using the default fanotify "
+				"exercising\n", args->name);
+#endif
+	}
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -742,6 +1186,7 @@ stressor_info_t stress_fanotify_info = {
 	.stressor = stress_fanotify,
 	.supported = stress_fanotify_supported,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -749,6 +1194,7 @@ stressor_info_t stress_fanotify_info = {
 stressor_info_t stress_fanotify_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sys/fanotify.h"
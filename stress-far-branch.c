@@ -21,12 +21,18 @@
 #include "core-asm-ret.h"
 #include "core-builtin.h"
 #include "core-madvise.h"
+#include "core-perf.h"
 #include "core-pragma.h"
 
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"far-branch N",		"start N far branching workers" },
 	{ NULL,	"far-branch-ops N",	"stop after N far branching bogo operations" },
 	{ NULL, "far-branch-pages N",	"number of pages to populate with functions" },
+	{ NULL,	"far-branch-sweep",	"sweep number of functions called and call pattern entropy" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -39,13 +45,35 @@ static int stress_set_far_branch_pages(const char *opt)
 	return stress_set_setting("far-branch-pages", TYPE_ID_SIZE_T, &far_branch_pages);
 }
 
+static int stress_set_far_branch_sweep(const char *opt)
+{
+	return stress_set_setting_true("far-branch-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_far_branch_pages,	stress_set_far_branch_pages },
+	{ OPT_far_branch_sweep,	stress_set_far_branch_sweep },
 	{ 0,			NULL }
 };
 
 #define PAGE_MULTIPLES	(8)
 
+#define STRESS_FAR_BRANCH_STEP_CALLS	(1U << 18)
+#define STRESS_FAR_BRANCH_STEPS_MAX	(128)
+
+/*
+ *  Sweep steps call sites functions, each call is to the function
+ *  1 + r past the previous one where r is a random value of
+ *  entropy_bits bits, modulo the number of functions in use.
+ */
+typedef struct {
+	size_t sites;			/* number of functions, power of 2 */
+	uint32_t entropy_bits;		/* random bits per call target */
+	uint64_t calls;			/* function calls made */
+	uint64_t misses;		/* branch misses, perf counter */
+	double duration;		/* time taken making calls */
+} stress_far_branch_step_t;
+
 #if defined(HAVE_MPROTECT) &&	\
     !defined(__NetBSD__)
 
@@ -249,6 +277,227 @@ static inline void stress_far_branch_shuffle(stress_ret_func_t *funcs, const siz
 	}
 }
 
+/*
+ *  stress_far_branch_calls()
+ *	call all of the functions in funcs in order
+ */
+static inline void stress_far_branch_calls(stress_ret_func_t *funcs, const size_t total_funcs)
+{
+	register size_t i;
+
+	for (i = 0; i < total_funcs; i += 16) {
+		funcs[i + 0x0]();
+		funcs[i + 0x1]();
+		funcs[i + 0x2]();
+		funcs[i + 0x3]();
+		funcs[i + 0x4]();
+		funcs[i + 0x5]();
+		funcs[i + 0x6]();
+		funcs[i + 0x7]();
+		funcs[i + 0x8]();
+		funcs[i + 0x9]();
+		funcs[i + 0xa]();
+		funcs[i + 0xb]();
+		funcs[i + 0xc]();
+		funcs[i + 0xd]();
+		funcs[i + 0xe]();
+		funcs[i + 0xf]();
+	}
+}
+
+#define STRESS_FAR_BRANCH_SWEEP_CALL()				\
+{								\
+	seed = (a * seed + c);					\
+	cur = (cur + 1 + ((seed >> 12) & entropy_mask)) & sites_mask; \
+	funcs[cur]();						\
+}
+
+/*
+ *  stress_far_branch_sweep_calls()
+ *	make STRESS_FAR_BRANCH_STEP_CALLS calls using the call
+ *	pattern of the given sweep step
+ */
+static void stress_far_branch_sweep_calls(
+	stress_ret_func_t *funcs,
+	const stress_far_branch_step_t *step,
+	uint32_t *seedp)
+{
+	register uint32_t const a = 16843009;
+	register uint32_t const c = 826366247;
+	register uint32_t seed = *seedp;
+	register size_t cur = 0;
+	register const size_t sites_mask = step->sites - 1;
+	register const size_t entropy_mask = ((size_t)1 << step->entropy_bits) - 1;
+	register uint32_t i;
+
+	for (i = 0; i < STRESS_FAR_BRANCH_STEP_CALLS; i += 8) {
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+		STRESS_FAR_BRANCH_SWEEP_CALL();
+	}
+	*seedp = seed;
+}
+
+/*
+ *  stress_far_branch_sweep_init()
+ *	populate the sweep steps, the number of functions is
+ *	quadrupled from 16 up to total_funcs and for each the
+ *	entropy bits are stepped from predictable to random
+ */
+static size_t stress_far_branch_sweep_init(
+	stress_far_branch_step_t *steps,
+	const size_t total_funcs)
+{
+	static const uint32_t entropy_bits[] = { 0, 1, 2, 4, 8 };
+	uint32_t shift, max_shift;
+	size_t n_steps = 0;
+
+	for (max_shift = 4; ((size_t)1 << (max_shift + 1)) <= total_funcs; max_shift++)
+		;
+
+	(void)shim_memset(steps, 0, sizeof(*steps) * STRESS_FAR_BRANCH_STEPS_MAX);
+	for (shift = 4; shift <= max_shift; shift += 2) {
+		size_t i;
+
+		/* always include the maximum number of functions */
+		if (shift + 2 > max_shift)
+			shift = max_shift;
+
+		for (i = 0; i < SIZEOF_ARRAY(entropy_bits); i++) {
+			if (entropy_bits[i] >= shift)
+				break;
+			steps[n_steps].sites = (size_t)1 << shift;
+			steps[n_steps].entropy_bits = entropy_bits[i];
+			n_steps++;
+		}
+		steps[n_steps].sites = (size_t)1 << shift;
+		steps[n_steps].entropy_bits = shift;
+		n_steps++;
+	}
+	return n_steps;
+}
+
+/*
+ *  stress_far_branch_sweep_metrics()
+ *	dump the sweep table (instance 0 only) and set the
+ *	predictable and random ns per call metrics
+ */
+static void stress_far_branch_sweep_metrics(
+	stress_args_t *args,
+	const stress_far_branch_step_t *steps,
+	const size_t n_steps,
+	const bool misses_valid)
+{
+	size_t i, idx = 2;
+
+	if (args->instance == 0) {
+		pr_inf("%s: %8s %8s %10s %10s\n", args->name,
+			"funcs", "entropy", "ns/call", "miss %");
+	}
+	for (i = 0; i < n_steps; i++) {
+		const stress_far_branch_step_t *step = &steps[i];
+		const double ns = (step->calls > 0) ?
+			STRESS_DBL_NANOSECOND * step->duration / (double)step->calls : 0.0;
+		const double miss_pc = (step->calls > 0) ?
+			100.0 * (double)step->misses / (double)step->calls : 0.0;
+		char desc[64];
+
+		if (args->instance == 0) {
+			if (misses_valid) {
+				pr_inf("%s: %8zu %8" PRIu32 " %10.3f %10.2f\n", args->name,
+					step->sites, step->entropy_bits, ns, miss_pc);
+			} else {
+				pr_inf("%s: %8zu %8" PRIu32 " %10.3f %10s\n", args->name,
+					step->sites, step->entropy_bits, ns, "n/a");
+			}
+		}
+		if (step->entropy_bits == 0) {
+			(void)snprintf(desc, sizeof(desc), "ns per call, %zu funcs, predictable", step->sites);
+			stress_metrics_set(args, idx++, desc, ns, STRESS_HARMONIC_MEAN);
+		} else if (((size_t)1 << step->entropy_bits) == step->sites) {
+			(void)snprintf(desc, sizeof(desc), "ns per call, %zu funcs, random", step->sites);
+			stress_metrics_set(args, idx++, desc, ns, STRESS_HARMONIC_MEAN);
+		}
+	}
+}
+
+/*
+ *  stress_far_branch_sweep()
+ *	run each sweep step in turn until the stressor is stopped,
+ *	returns the number of calls made
+ */
+static double stress_far_branch_sweep(
+	stress_args_t *args,
+	stress_ret_func_t *funcs,
+	const size_t total_funcs)
+{
+	stress_far_branch_step_t steps[STRESS_FAR_BRANCH_STEPS_MAX];
+	const size_t n_steps = stress_far_branch_sweep_init(steps, total_funcs);
+	uint32_t seed = stress_mwc32();
+	double calls = 0.0;
+	bool misses_valid;
+	int fd;
+	size_t i;
+
+	/* make sure the check function is always in the set of functions called */
+	for (i = 0; i < total_funcs; i++) {
+		if (funcs[i] == stress_far_branch_check) {
+			funcs[i] = funcs[0];
+			funcs[0] = stress_far_branch_check;
+			break;
+		}
+	}
+
+#if defined(STRESS_PERF_STATS)
+	fd = stress_perf_hw_open(PERF_COUNT_HW_BRANCH_MISSES);
+#else
+	fd = -1;
+#endif
+	misses_valid = (fd >= 0);
+	if ((args->instance == 0) && !misses_valid)
+		pr_inf("%s: branch-misses perf counter not available, "
+			"mispredict rate will not be reported\n", args->name);
+
+	do {
+		for (i = 0; (i < n_steps) && stress_continue(args); i++) {
+			stress_far_branch_step_t *step = &steps[i];
+			uint64_t misses_start = 0, misses_end = 0;
+			double t;
+
+#if defined(STRESS_PERF_STATS)
+			if (misses_valid)
+				misses_start = stress_perf_hw_read(fd);
+#endif
+			t = stress_time_now();
+			stress_far_branch_sweep_calls(funcs, step, &seed);
+			step->duration += stress_time_now() - t;
+#if defined(STRESS_PERF_STATS)
+			if (misses_valid) {
+				misses_end = stress_perf_hw_read(fd);
+				if ((misses_start == STRESS_PERF_INVALID) ||
+				    (misses_end == STRESS_PERF_INVALID))
+					misses_valid = false;
+			}
+#endif
+			step->misses += misses_end - misses_start;
+			step->calls += STRESS_FAR_BRANCH_STEP_CALLS;
+			calls += (double)STRESS_FAR_BRANCH_STEP_CALLS;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+
+	if (fd >= 0)
+		(void)close(fd);
+	stress_far_branch_sweep_metrics(args, steps, n_steps, misses_valid);
+
+	return calls;
+}
+
 /*
  *  stress_far_branch()
  *	exercise a broad randomized set of branches to functions
@@ -271,8 +520,10 @@ static int stress_far_branch(stress_args_t *args)
 	NOCLOBBER void **pages = NULL;
 	NOCLOBBER size_t total_funcs = 0;
 	NOCLOBBER double calls = 0.0;
+	bool far_branch_sweep = false;
 
 	(void)stress_get_setting("far-branch-pages", &n_pages);
+	(void)stress_get_setting("far-branch-sweep", &far_branch_sweep);
 	max_funcs = (n_pages * page_size) / stress_ret_opcode.stride;
 
 	ret = sigsetjmp(jmp_env, 1);
@@ -373,28 +624,15 @@ static int stress_far_branch(stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	t_start = stress_time_now();
-	do {
-		for (i = 0; i < total_funcs; i += 16) {
-			funcs[i + 0x0]();
-			funcs[i + 0x1]();
-			funcs[i + 0x2]();
-			funcs[i + 0x3]();
-			funcs[i + 0x4]();
-			funcs[i + 0x5]();
-			funcs[i + 0x6]();
-			funcs[i + 0x7]();
-			funcs[i + 0x8]();
-			funcs[i + 0x9]();
-			funcs[i + 0xa]();
-			funcs[i + 0xb]();
-			funcs[i + 0xc]();
-			funcs[i + 0xd]();
-			funcs[i + 0xe]();
-			funcs[i + 0xf]();
-		}
-		stress_bogo_inc(args);
-		calls += (double)total_funcs;
-	} while (stress_continue(args));
+	if (far_branch_sweep) {
+		calls = stress_far_branch_sweep(args, funcs, total_funcs);
+	} else {
+		do {
+			stress_far_branch_calls(funcs, total_funcs);
+			stress_bogo_inc(args);
+			calls += (double)total_funcs;
+		} while (stress_continue(args));
+	}
 	duration = stress_time_now() - t_start;
 
 
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-extents.h"
 #include "core-killpid.h"
 
 #if defined(HAVE_LINUX_FIEMAP_H)
@@ -68,26 +69,32 @@ static void *counter_lock;	/* Counter lock */
  *  stress_fiemap_writer()
  *	write data in random places and punch holes
  *	in data in random places to try and maximize
- *	extents in the file
+ *	extents in the file, periodically sampling
+ *	the resulting file layout
  */
 static int stress_fiemap_writer(
 	stress_args_t *args,
 	const int fd,
-	const uint64_t fiemap_bytes)
+	const uint64_t fiemap_bytes,
+	stress_extents_t *extents)
 {
 	uint8_t buf[1];
 	const uint64_t len = fiemap_bytes - sizeof(buf);
 	int rc = EXIT_FAILURE;
+	bool sample_extents = true;
 #if defined(FALLOC_FL_PUNCH_HOLE) && \
     defined(FALLOC_FL_KEEP_SIZE)
 	bool punch_hole = true;
 #endif
 
 	*buf = stress_mwc8();
+	stress_extents_init(extents);
 
 	do {
 		uint64_t offset;
 
+		if (sample_extents && (stress_extents_sample(args, fd, (off_t)fiemap_bytes, extents) < 0))
+			sample_extents = false;
 		offset = stress_mwc64modn(len) & ~0x1fffUL;
 		if (lseek(fd, (off_t)offset, SEEK_SET) < 0)
 			break;
@@ -247,13 +254,14 @@ static int stress_fiemap(stress_args_t *args)
 	uint64_t fiemap_bytes = DEFAULT_FIEMAP_SIZE;
 	struct fiemap fiemap;
 	const char *fs_type;
+	stress_extents_t extents;
 #if defined(O_SYNC)
 	const int flags = O_CREAT | O_RDWR | O_SYNC;
 #else
 	const int flags = O_CREAT | O_RDWR;
 #endif
 
-	counter_lock = stress_lock_create();
+	counter_lock = stress_lock_create("fiemap-counter");
 	if (!counter_lock) {
 		pr_err("%s: failed to create counter lock\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -311,7 +319,8 @@ static int stress_fiemap(stress_args_t *args)
 		if (pids[n] < 0)
 			goto reap;
 	}
-	rc = stress_fiemap_writer(args, fd, fiemap_bytes);
+	rc = stress_fiemap_writer(args, fd, fiemap_bytes, &extents);
+	stress_extents_metrics(args, 0, &extents);
 reap:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -18,10 +18,12 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-asm-arm.h"
 #include "core-asm-ppc64.h"
 #include "core-asm-x86.h"
 #include "core-asm-ret.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-cpu-cache.h"
 #include "core-numa.h"
 #include "core-out-of-memory.h"
@@ -29,9 +31,20 @@
 static const stress_help_t help[] = {
 	{ NULL,	"flushcache N",		"start N CPU instruction + data cache flush workers" },
 	{ NULL,	"flushcache-ops N",	"stop after N flush cache bogo operations" },
+	{ NULL,	"flushcache-sweep",	"measure cache line flush cost over region sizes" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_flushcache_sweep(const char *opt)
+{
+	return stress_set_setting_true("flushcache-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_flushcache_sweep,	stress_set_flushcache_sweep },
+	{ 0,			NULL }
+};
+
 #if (defined(STRESS_ARCH_X86) ||		\
      defined(STRESS_ARCH_ARM) ||	\
      defined(STRESS_ARCH_RISCV) ||	\
@@ -282,6 +295,309 @@ static int stress_flushcache_child(stress_args_t *args, void *ctxt)
 	return EXIT_SUCCESS;
 }
 
+#if defined(HAVE_ASM_X86_CLFLUSH) ||	\
+    defined(HAVE_ASM_X86_CLFLUSHOPT) ||	\
+    defined(HAVE_ASM_X86_CLWB) ||	\
+    defined(HAVE_ASM_ARM_DC_CVAC) ||	\
+    defined(HAVE_ASM_ARM_DC_CIVAC) ||	\
+    defined(HAVE_ASM_PPC64_DCBST)
+#define STRESS_FLUSHCACHE_SWEEP
+#endif
+
+#if defined(STRESS_FLUSHCACHE_SWEEP)
+#define FLUSHCACHE_SWEEP_BUF_SIZE	(16 * MB)
+#define FLUSHCACHE_SWEEP_LINES		(65536)	/* lines flushed per sweep pass */
+
+/*
+ *  stress_flushcache_x86_fence()
+ *	order the weakly ordered clflushopt and clwb flushes
+ */
+static inline void ALWAYS_INLINE stress_flushcache_x86_fence(void)
+{
+#if defined(HAVE_ASM_X86_SFENCE)
+	stress_asm_x86_sfence();
+#elif defined(HAVE_ASM_X86_MFENCE)
+	stress_flushcache_x86_fence();
+#endif
+}
+
+typedef void (*stress_flushcache_sweep_func_t)(void *addr, const size_t size, const size_t cl_size);
+
+/* a cache line flush or clean instruction */
+typedef struct {
+	const char *name;
+	stress_flushcache_sweep_func_t flush;
+	bool (*supported)(void);
+} stress_flushcache_sweep_method_t;
+
+/* a sweep point and its accumulated flushes */
+typedef struct {
+	size_t method;
+	size_t size;			/* region size */
+	bool dirty;			/* lines written before the flush */
+	double lines;			/* lines flushed */
+	double duration;		/* time flushing */
+} stress_flushcache_sweep_result_t;
+
+static const size_t stress_flushcache_sweep_sizes[] = {
+	4 * KB, 32 * KB, 256 * KB, 2 * MB, 16 * MB,
+};
+
+#if defined(HAVE_ASM_X86_CLFLUSH)
+static void OPTIMIZE3 stress_flushcache_sweep_clflush(void *addr, const size_t size, const size_t cl_size)
+{
+	register uint8_t *ptr = (uint8_t *)addr;
+	const uint8_t *ptr_end = ptr + size;
+
+	while (ptr < ptr_end) {
+		stress_asm_x86_clflush((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_flushcache_x86_fence();
+}
+#endif
+
+#if defined(HAVE_ASM_X86_CLFLUSHOPT)
+static void OPTIMIZE3 stress_flushcache_sweep_clflushopt(void *addr, const size_t size, const size_t cl_size)
+{
+	register uint8_t *ptr = (uint8_t *)addr;
+	const uint8_t *ptr_end = ptr + size;
+
+	while (ptr < ptr_end) {
+		stress_asm_x86_clflushopt((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_flushcache_x86_fence();
+}
+#endif
+
+#if defined(HAVE_ASM_X86_CLWB)
+static void OPTIMIZE3 stress_flushcache_sweep_clwb(void *addr, const size_t size, const size_t cl_size)
+{
+	register uint8_t *ptr = (uint8_t *)addr;
+	const uint8_t *ptr_end = ptr + size;
+
+	while (ptr < ptr_end) {
+		stress_asm_x86_clwb((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_flushcache_x86_fence();
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CVAC)
+static void OPTIMIZE3 stress_flushcache_sweep_dc_cvac(void *addr, const size_t size, const size_t cl_size)
+{
+	register uint8_t *ptr = (uint8_t *)addr;
+	const uint8_t *ptr_end = ptr + size;
+
+	while (ptr < ptr_end) {
+		stress_asm_arm_dc_cvac((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_asm_arm_dsb_ish();
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CIVAC)
+static void OPTIMIZE3 stress_flushcache_sweep_dc_civac(void *addr, const size_t size, const size_t cl_size)
+{
+	register uint8_t *ptr = (uint8_t *)addr;
+	const uint8_t *ptr_end = ptr + size;
+
+	while (ptr < ptr_end) {
+		stress_asm_arm_dc_civac((void *)ptr);
+		ptr += cl_size;
+	}
+	stress_asm_arm_dsb_ish();
+}
+#endif
+
+#if defined(HAVE_ASM_PPC64_DCBST)
+static void OPTIMIZE3 stress_flushcache_sweep_dcbst(void *addr, const size_t size, const size_t cl_size)
+{
+	register uint8_t *ptr = (uint8_t *)addr;
+	const uint8_t *ptr_end = ptr + size;
+
+	while (ptr < ptr_end) {
+		stress_asm_ppc64_dcbst((void *)ptr);
+		ptr += cl_size;
+	}
+#if defined(HAVE_ASM_PPC64_MSYNC)
+	stress_asm_ppc64_msync();
+#endif
+}
+#endif
+
+#if defined(HAVE_ASM_ARM_DC_CVAC) ||	\
+    defined(HAVE_ASM_ARM_DC_CIVAC) ||	\
+    defined(HAVE_ASM_PPC64_DCBST)
+static bool stress_flushcache_sweep_always(void)
+{
+	return true;
+}
+#endif
+
+static const stress_flushcache_sweep_method_t stress_flushcache_sweep_methods[] = {
+#if defined(HAVE_ASM_X86_CLFLUSH)
+	{ "clflush",	stress_flushcache_sweep_clflush,	stress_cpu_x86_has_clfsh },
+#endif
+#if defined(HAVE_ASM_X86_CLFLUSHOPT)
+	{ "clflushopt",	stress_flushcache_sweep_clflushopt,	stress_cpu_x86_has_clflushopt },
+#endif
+#if defined(HAVE_ASM_X86_CLWB)
+	{ "clwb",	stress_flushcache_sweep_clwb,		stress_cpu_x86_has_clwb },
+#endif
+#if defined(HAVE_ASM_ARM_DC_CVAC)
+	{ "dc-cvac",	stress_flushcache_sweep_dc_cvac,	stress_flushcache_sweep_always },
+#endif
+#if defined(HAVE_ASM_ARM_DC_CIVAC)
+	{ "dc-civac",	stress_flushcache_sweep_dc_civac,	stress_flushcache_sweep_always },
+#endif
+#if defined(HAVE_ASM_PPC64_DCBST)
+	{ "dcbst",	stress_flushcache_sweep_dcbst,		stress_flushcache_sweep_always },
+#endif
+};
+
+/*
+ *  stress_flushcache_sweep_pass()
+ *	read (clean) or write (dirty) every line of the region and
+ *	time flushing it, repeated to flush a fixed number of lines
+ */
+static void OPTIMIZE3 stress_flushcache_sweep_pass(
+	uint8_t *buf,
+	const size_t cl_size,
+	stress_flushcache_sweep_result_t *result)
+{
+	const stress_flushcache_sweep_method_t *method = &stress_flushcache_sweep_methods[result->method];
+	const size_t size = result->size;
+	const size_t lines = size / cl_size;
+	const size_t reps = (lines >= FLUSHCACHE_SWEEP_LINES) ? 1 : FLUSHCACHE_SWEEP_LINES / lines;
+	size_t i;
+
+	for (i = 0; (i < reps) && stress_continue_flag(); i++) {
+		register volatile uint8_t *ptr;
+		const uint8_t *ptr_end = buf + size;
+		double t;
+
+		if (result->dirty) {
+			for (ptr = buf; ptr < ptr_end; ptr += cl_size)
+				*ptr = (uint8_t)i;
+		} else {
+			for (ptr = buf; ptr < ptr_end; ptr += cl_size)
+				(void)*ptr;
+		}
+		t = stress_time_now();
+		method->flush((void *)buf, size, cl_size);
+		result->duration += stress_time_now() - t;
+		result->lines += (double)lines;
+	}
+}
+
+/*
+ *  stress_flushcache_sweep()
+ *	measure the cost per line and flush bandwidth of the cache
+ *	line flush and clean instructions over region sizes with
+ *	clean and dirty lines
+ */
+static int stress_flushcache_sweep(stress_args_t *args, const size_t cl_size)
+{
+	stress_flushcache_sweep_result_t results[SIZEOF_ARRAY(stress_flushcache_sweep_methods) *
+						 SIZEOF_ARRAY(stress_flushcache_sweep_sizes) * 2];
+	size_t i, j, n_results = 0, idx = 0, metric = 0;
+	uint8_t *buf;
+	int dirty;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_flushcache_sweep_methods); i++) {
+		if (!stress_flushcache_sweep_methods[i].supported()) {
+			if (args->instance == 0)
+				pr_inf("%s: %s not supported by the CPU, skipping it\n",
+					args->name, stress_flushcache_sweep_methods[i].name);
+			continue;
+		}
+		for (dirty = 0; dirty <= 1; dirty++) {
+			for (j = 0; j < SIZEOF_ARRAY(stress_flushcache_sweep_sizes); j++) {
+				results[n_results].method = i;
+				results[n_results].size = stress_flushcache_sweep_sizes[j];
+				results[n_results].dirty = (bool)dirty;
+				results[n_results].lines = 0.0;
+				results[n_results].duration = 0.0;
+				n_results++;
+			}
+		}
+	}
+	if (n_results == 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no cache line flush instructions available, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, FLUSHCACHE_SWEEP_BUF_SIZE,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, (size_t)FLUSHCACHE_SWEEP_BUF_SIZE, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	(void)stress_flushcache_nohugepage(buf, FLUSHCACHE_SWEEP_BUF_SIZE);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_flushcache_sweep_pass(buf, cl_size, &results[idx]);
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-10s %-6s %8s %10s %10s\n", args->name,
+			"method", "lines", "region", "ns/line", "GB/sec");
+	for (i = 0; i < n_results; i++) {
+		const stress_flushcache_sweep_result_t *result = &results[i];
+		const char *name = stress_flushcache_sweep_methods[result->method].name;
+		const char *state = result->dirty ? "dirty" : "clean";
+		char size_str[32], str[64];
+		double ns_per_line, gb_rate;
+
+		if ((result->duration <= 0.0) || (result->lines <= 0.0))
+			continue;
+		(void)stress_uint64_to_str(size_str, sizeof(size_str), (uint64_t)result->size);
+		ns_per_line = STRESS_DBL_NANOSECOND * result->duration / result->lines;
+		gb_rate = (result->lines * (double)cl_size / (double)GB) / result->duration;
+		if (args->instance == 0)
+			pr_inf("%s: %-10s %-6s %8s %10.2f %10.3f\n", args->name,
+				name, state, size_str, ns_per_line, gb_rate);
+
+		/* small region cost per line and large region bandwidth */
+		if (metric + 1 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		if (result->size == stress_flushcache_sweep_sizes[0]) {
+			(void)snprintf(str, sizeof(str), "%s %s %s nanosecs per line", name, state, size_str);
+			stress_metrics_set(args, metric++, str, ns_per_line, STRESS_HARMONIC_MEAN);
+		} else if (result->size == stress_flushcache_sweep_sizes[SIZEOF_ARRAY(stress_flushcache_sweep_sizes) - 1]) {
+			(void)snprintf(str, sizeof(str), "%s %s %s GB per sec", name, state, size_str);
+			stress_metrics_set(args, metric++, str, gb_rate, STRESS_HARMONIC_MEAN);
+		}
+	}
+
+	(void)munmap((void *)buf, FLUSHCACHE_SWEEP_BUF_SIZE);
+	return EXIT_SUCCESS;
+}
+#else
+static int stress_flushcache_sweep(stress_args_t *args, const size_t cl_size)
+{
+	(void)cl_size;
+
+	if (args->instance == 0)
+		pr_inf_skip("%s: built without cache line flush instructions, "
+			"skipping stressor\n", args->name);
+	return EXIT_NOT_IMPLEMENTED;
+}
+#endif
+
 /*
  *  stress_flushcache()
  *	I-cache load misses can be observed using:
@@ -292,8 +608,11 @@ static int stress_flushcache(stress_args_t *args)
 	const size_t page_size = args->page_size;
 	const int numa_nodes = stress_numa_nodes();
 	stress_flushcache_context_t context;
+	bool flushcache_sweep = false;
 	int ret;
 
+	(void)stress_get_setting("flushcache-sweep", &flushcache_sweep);
+
 	context.x86_clfsh = stress_cpu_x86_has_clfsh();
 	context.x86_demote = stress_cpu_x86_has_cldemote();
 	context.i_addr = stress_mmap_populate(NULL, page_size,
@@ -314,6 +633,11 @@ static int stress_flushcache(stress_args_t *args)
 		context.d_size = page_size;
 	if (context.cl_size == 0)
 		context.cl_size = 64;
+	if (flushcache_sweep) {
+		ret = stress_flushcache_sweep(args, context.cl_size);
+		(void)munmap(context.i_addr, page_size);
+		return ret;
+	}
 
 	context.d_size *= numa_nodes;
 	if ((args->instance == 0) && (numa_nodes > 1))
@@ -329,6 +653,7 @@ stressor_info_t stress_flushcache_info = {
 	.stressor = stress_flushcache,
 	.class = CLASS_CPU_CACHE,
 	.supported = stress_asm_ret_supported,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
@@ -336,6 +661,7 @@ stressor_info_t stress_flushcache_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU_CACHE,
 	.supported = stress_asm_ret_supported,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without cache flush support"
 };
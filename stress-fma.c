@@ -19,6 +19,8 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-freq.h"
 #include "core-madvise.h"
 #include "core-put.h"
 #include "core-pragma.h"
@@ -26,6 +28,19 @@
 
 #define FMA_ELEMENTS	(512)
 #define FMA_UNROLL	(8)
+#define FMA_MHZ_SAMPLE	(64)	/* sample effective clock every N bogo ops */
+
+#if defined(STRESS_ARCH_X86_64) &&		\
+    defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+#define HAVE_FMA_AVX512
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&			\
+    defined(__aarch64__) &&			\
+    defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#define HAVE_FMA_SVE
+#endif
 
 typedef struct {
 	double  *double_a;
@@ -50,9 +65,15 @@ typedef void (*stress_fma_func)(stress_fma_t *fma);
 static const stress_help_t help[] = {
 	{ NULL,	"fma N",	"start N workers performing floating point multiply-add ops" },
 	{ NULL,	"fma-ops N",	"stop after N floating point multiply-add bogo operations" },
+	{ NULL,	"fma-wide",	"use explicit widest vector (AVX-512 or SVE) multiply-add kernels" },
 	{ NULL,	NULL,		 NULL }
 };
 
+static int stress_set_fma_wide(const char *opt)
+{
+	return stress_set_setting_true("fma-wide", opt);
+}
+
 static inline float stress_fma_rnd_float(void)
 {
 	register const float fhalfpwr32 = (float)1.0 / (float)(0x80000000);
@@ -141,6 +162,95 @@ stress_fma_func stress_fma_funcs[] = {
 	stress_fma_add231_float,
 };
 
+#if defined(HAVE_FMA_AVX512)
+typedef double stress_fma_v8df_t __attribute__ ((vector_size(64)));
+typedef float stress_fma_v16sf_t __attribute__ ((vector_size(64)));
+
+/*
+ *  explicit 512 bit AVX-512 kernels, the same operations as the
+ *  generic kernels using 512 bit vectors so the compiler can not
+ *  fall back to narrower vectors
+ */
+#define STRESS_FMA_AVX512(name, type, vtype, field, expr)	\
+static void __attribute__((target("avx512f,fma"))) OPTIMIZE3	\
+name(stress_fma_t *fma)						\
+{								\
+	register size_t i;					\
+	register type *ptr = fma->field ## _a;			\
+	const vtype b = (vtype){ 0 } + fma->field ## _b;	\
+	const vtype c = (vtype){ 0 } + fma->field ## _c;	\
+								\
+PRAGMA_UNROLL_N(4)						\
+	for (i = 0; i < FMA_ELEMENTS; i += sizeof(vtype) / sizeof(type)) { \
+		vtype a;					\
+								\
+		(void)shim_memcpy(&a, &ptr[i], sizeof(a));	\
+		a = expr;					\
+		(void)shim_memcpy(&ptr[i], &a, sizeof(a));	\
+	}							\
+}
+
+STRESS_FMA_AVX512(stress_fma_add132_double_avx512, double, stress_fma_v8df_t, double, a * c + b)
+STRESS_FMA_AVX512(stress_fma_add132_float_avx512, float, stress_fma_v16sf_t, float, a * c + b)
+STRESS_FMA_AVX512(stress_fma_add213_double_avx512, double, stress_fma_v8df_t, double, b * a + c)
+STRESS_FMA_AVX512(stress_fma_add213_float_avx512, float, stress_fma_v16sf_t, float, b * a + c)
+STRESS_FMA_AVX512(stress_fma_add231_double_avx512, double, stress_fma_v8df_t, double, b * c + a)
+STRESS_FMA_AVX512(stress_fma_add231_float_avx512, float, stress_fma_v16sf_t, float, b * c + a)
+
+static stress_fma_func stress_fma_funcs_wide[] = {
+	stress_fma_add132_double_avx512,
+	stress_fma_add132_float_avx512,
+	stress_fma_add213_double_avx512,
+	stress_fma_add213_float_avx512,
+	stress_fma_add231_double_avx512,
+	stress_fma_add231_float_avx512,
+};
+
+#define FMA_WIDE_NAME		"avx512"
+#define FMA_WIDE_SUPPORTED()	stress_cpu_x86_has_avx512_f()
+
+#elif defined(HAVE_FMA_SVE)
+/*
+ *  vector length agnostic SVE kernels, the same operations as
+ *  the generic kernels with a predicated tail for any vector length
+ */
+#define STRESS_FMA_SVE(name, type, sfx, field, cnt, bits, x, y, z) \
+static void OPTIMIZE3 name(stress_fma_t *fma)			\
+{								\
+	register uint64_t i;					\
+	type ## _t *ptr = fma->field ## _a;			\
+	const sv ## type ## _t b = svdup_n_ ## sfx(fma->field ## _b);	\
+	const sv ## type ## _t c = svdup_n_ ## sfx(fma->field ## _c);	\
+								\
+	for (i = 0; i < FMA_ELEMENTS; i += svcnt ## cnt()) {	\
+		const svbool_t pg = svwhilelt_b ## bits(i, (uint64_t)FMA_ELEMENTS); \
+		const sv ## type ## _t a = svld1_ ## sfx(pg, &ptr[i]);	\
+								\
+		svst1_ ## sfx(pg, &ptr[i], svmla_ ## sfx ## _x(pg, x, y, z)); \
+	}							\
+}
+
+/* svmla(x, y, z) = x + y * z */
+STRESS_FMA_SVE(stress_fma_add132_double_sve, float64, f64, double, d, 64, b, a, c)
+STRESS_FMA_SVE(stress_fma_add132_float_sve, float32, f32, float, w, 32, b, a, c)
+STRESS_FMA_SVE(stress_fma_add213_double_sve, float64, f64, double, d, 64, c, b, a)
+STRESS_FMA_SVE(stress_fma_add213_float_sve, float32, f32, float, w, 32, c, b, a)
+STRESS_FMA_SVE(stress_fma_add231_double_sve, float64, f64, double, d, 64, a, b, c)
+STRESS_FMA_SVE(stress_fma_add231_float_sve, float32, f32, float, w, 32, a, b, c)
+
+static stress_fma_func stress_fma_funcs_wide[] = {
+	stress_fma_add132_double_sve,
+	stress_fma_add132_float_sve,
+	stress_fma_add213_double_sve,
+	stress_fma_add213_float_sve,
+	stress_fma_add231_double_sve,
+	stress_fma_add231_float_sve,
+};
+
+#define FMA_WIDE_NAME		"sve"
+#define FMA_WIDE_SUPPORTED()	(true)
+#endif
+
 static inline void OPTIMIZE3 TARGET_CLONES stress_fma_init(stress_fma_t *fma)
 {
 	register size_t i;
@@ -168,6 +278,28 @@ static int stress_fma(stress_args_t *args)
 	stress_fma_t *fma;
 	register size_t idx_b = 0, idx_c = 0;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	bool fma_wide = false;
+	stress_fma_func *funcs = stress_fma_funcs;
+	const char *funcs_name = "generic";
+	double mhz_sum = 0.0, mhz_count = 0.0;
+	char msg[64];
+
+	(void)stress_get_setting("fma-wide", &fma_wide);
+	if (fma_wide) {
+#if defined(FMA_WIDE_NAME)
+		if (FMA_WIDE_SUPPORTED()) {
+			funcs = stress_fma_funcs_wide;
+			funcs_name = FMA_WIDE_NAME;
+		} else if (args->instance == 0) {
+			pr_inf("%s: CPU does not support %s, ignoring --fma-wide\n",
+				args->name, FMA_WIDE_NAME);
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: no explicit wide vector kernels for this "
+				"architecture, ignoring --fma-wide\n", args->name);
+#endif
+	}
 
 	stress_catch_sigill();
 
@@ -204,10 +336,20 @@ static int stress_fma(stress_args_t *args)
 		fma->float_c = fma->float_a[idx_c];
 
 		for (i = 0; i < SIZEOF_ARRAY(stress_fma_funcs); i++) {
-			stress_fma_funcs[i](fma);
+			funcs[i](fma);
 		}
 		stress_bogo_inc(args);
 
+		/* sample the clock straight after the kernels */
+		if ((stress_bogo_get(args) % FMA_MHZ_SAMPLE) == 1) {
+			const double mhz = stress_freq_effective_mhz();
+
+			if (mhz > 0.0) {
+				mhz_sum += mhz;
+				mhz_count += 1.0;
+			}
+		}
+
 		if (verify) {
 			fma->double_a = fma->double_a2;
 			fma->double_b = fma->double_a[idx_b];
@@ -217,7 +359,7 @@ static int stress_fma(stress_args_t *args)
 			fma->float_c = fma->float_a[idx_c];
 
 			for (i = 0; i < SIZEOF_ARRAY(stress_fma_funcs); i++) {
-				stress_fma_funcs[i](fma);
+				funcs[i](fma);
 			}
 			stress_bogo_inc(args);
 
@@ -230,6 +372,11 @@ static int stress_fma(stress_args_t *args)
 		}
 	} while (stress_continue(args));
 
+	if (mhz_count > 0.0) {
+		(void)snprintf(msg, sizeof(msg), "effective MHz (%s kernels)", funcs_name);
+		stress_metrics_set(args, 0, msg, mhz_sum / mhz_count, STRESS_GEOMETRIC_MEAN);
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	(void)munmap((void *)fma, sizeof(*fma));
@@ -237,9 +384,15 @@ static int stress_fma(stress_args_t *args)
 	return EXIT_SUCCESS;
 }
 
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fma_wide,	stress_set_fma_wide },
+	{ 0,		NULL }
+};
+
 stressor_info_t stress_fma_info = {
 	.stressor = stress_fma,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -19,6 +19,8 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
@@ -36,6 +38,7 @@ static const stress_help_t fork_help[] = {
 	{ "f N","fork N",	"start N workers spinning on fork() and exit()" },
 	{ NULL,	"fork-max P",	"create P forked processes per iteration, default is 1" },
 	{ NULL,	"fork-ops N",	"stop after N fork bogo operations" },
+	{ NULL,	"fork-sweep S",	"sweep fork, COW fault and reap latency over parent sizes up to S" },
 	{ NULL,	"fork-unmap",	"forcibly unmap unused shared library pages (dangerous)" },
 	{ NULL, "fork-vm",	"enable extra virtual memory pressure" },
 	{ NULL,	NULL,		NULL }
@@ -54,6 +57,9 @@ static const stress_help_t vfork_help[] = {
 #define STRESS_REDUCE_MADVISE	(0)
 #define STRESS_REDUCE_REMOVE	(1)
 
+#define FORK_SWEEP_STEPS	(4)		/* size/8, size/4, size/2, size */
+#define FORK_SWEEP_THP_SIZE	((size_t)2 * MB)
+
 /*
  *  stress_fork_shim_exit()
  *	perform _exit(), try and use syscall first to
@@ -254,6 +260,20 @@ static int stress_set_fork_max(const char *opt)
 	return stress_set_setting("fork-max", TYPE_ID_UINT32, &fork_max);
 }
 
+/*
+ *  stress_set_fork_sweep()
+ *	set maximum parent size of the fork latency sweep
+ */
+static int stress_set_fork_sweep(const char *opt)
+{
+	uint64_t fork_sweep;
+
+	fork_sweep = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("fork-sweep", fork_sweep,
+		FORK_SWEEP_THP_SIZE, MAX_MEM_LIMIT);
+	return stress_set_setting("fork-sweep", TYPE_ID_UINT64, &fork_sweep);
+}
+
 /*
  *  stress_set_fork_unmap()
  *	set fork-unmap flag on
@@ -475,6 +495,269 @@ static int stress_fork_fn(
 	return EXIT_SUCCESS;
 }
 
+/* timestamps written by the forked child */
+typedef struct {
+	double cow_ns;			/* first copy-on-write fault time */
+	double t_exit;			/* time just before child exits */
+} stress_fork_sweep_child_t;
+
+/* one parent size and page size configuration */
+typedef struct {
+	size_t size;			/* bytes mapped and touched */
+	bool thp;			/* use transparent huge pages */
+	stress_latency_t fork_lat;	/* latency histograms */
+	stress_latency_t cow_lat;
+	stress_latency_t reap_lat;
+	double fork_total;		/* sums for the means */
+	double cow_total;
+	double reap_total;
+	uint64_t count;			/* forks measured */
+	size_t pte_kb;			/* parent page table size */
+	size_t huge_kb;			/* parent THP backed memory */
+	bool failed;
+} stress_fork_sweep_config_t;
+
+/*
+ *  stress_fork_sweep_lat()
+ *	add t nanoseconds to a latency histogram
+ */
+static inline void stress_fork_sweep_lat(stress_latency_t *lat, const double t)
+{
+	stress_latency_add(lat, (t > 0.0) ? (uint64_t)t : 0);
+}
+
+/*
+ *  stress_fork_sweep_vmpte()
+ *	page table size of this process in KB, 0 if unknown
+ */
+static size_t stress_fork_sweep_vmpte(void)
+{
+	FILE *fp;
+	char buf[256];
+	size_t kb = 0;
+
+	fp = fopen("/proc/self/status", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (strncmp(buf, "VmPTE:", 6) == 0) {
+			if (sscanf(buf + 6, "%zu", &kb) != 1)
+				kb = 0;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	return kb;
+}
+
+/*
+ *  stress_fork_sweep_pass()
+ *	map and touch the configuration's memory then fork children
+ *	that take one copy-on-write fault and exit until the time
+ *	slice expires
+ */
+static void stress_fork_sweep_pass(
+	stress_args_t *args,
+	stress_fork_sweep_config_t *config,
+	volatile stress_fork_sweep_child_t *child,
+	const double duration)
+{
+	uint8_t *mapping = NULL, *buf = NULL;
+	size_t mapping_size = 0;
+	double t_end;
+
+	if (config->size > 0) {
+		size_t i;
+
+		mapping_size = config->size + (config->thp ? FORK_SWEEP_THP_SIZE : 0);
+		mapping = (uint8_t *)mmap(NULL, mapping_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED) {
+			pr_inf("%s: cannot mmap %zu MB, skipping this size, errno=%d (%s)\n",
+				args->name, (size_t)(config->size / MB), errno, strerror(errno));
+			config->failed = true;
+			return;
+		}
+		buf = mapping;
+		if (config->thp) {
+			/* align to a huge page so the whole range can be THP backed */
+			buf = (uint8_t *)(((uintptr_t)mapping + FORK_SWEEP_THP_SIZE - 1) &
+				~(uintptr_t)(FORK_SWEEP_THP_SIZE - 1));
+#if defined(MADV_HUGEPAGE)
+			(void)madvise((void *)buf, config->size, MADV_HUGEPAGE);
+#endif
+		} else {
+#if defined(MADV_NOHUGEPAGE)
+			(void)madvise((void *)buf, config->size, MADV_NOHUGEPAGE);
+#endif
+		}
+		for (i = 0; i < config->size; i += args->page_size)
+			buf[i] = (uint8_t)i;
+		config->pte_kb = stress_fork_sweep_vmpte();
+		config->huge_kb = stress_smaps_field((void *)buf, "AnonHugePages") / KB;
+	} else {
+		config->pte_kb = stress_fork_sweep_vmpte();
+	}
+
+	t_end = stress_time_now() + duration;
+	while (stress_continue(args)) {
+		double t_start, t_fork, t_reap;
+		pid_t pid;
+		int status;
+
+		child->cow_ns = 0.0;
+		child->t_exit = 0.0;
+		t_start = stress_time_now();
+		pid = fork();
+		if (pid < 0) {
+			if (stress_redo_fork(args, errno))
+				continue;
+			break;
+		} else if (pid == 0) {
+			if (buf) {
+				const double t = stress_time_now();
+
+				/* first write to the middle of the parent's memory */
+				buf[config->size / 2] = 0xff;
+				child->cow_ns = (stress_time_now() - t) * STRESS_DBL_NANOSECOND;
+			}
+			child->t_exit = stress_time_now();
+			stress_fork_shim_exit(0);
+		}
+		t_fork = stress_time_now();
+		if (shim_waitpid(pid, &status, 0) < 0) {
+			(void)stress_kill_pid_wait(pid, NULL);
+			break;
+		}
+		t_reap = stress_time_now();
+
+		stress_fork_sweep_lat(&config->fork_lat, (t_fork - t_start) * STRESS_DBL_NANOSECOND);
+		config->fork_total += t_fork - t_start;
+		if (buf) {
+			stress_fork_sweep_lat(&config->cow_lat, child->cow_ns);
+			config->cow_total += child->cow_ns / STRESS_DBL_NANOSECOND;
+		}
+		if (child->t_exit > 0.0) {
+			const double reap = (t_reap > child->t_exit) ? t_reap - child->t_exit : 0.0;
+
+			stress_fork_sweep_lat(&config->reap_lat, reap * STRESS_DBL_NANOSECOND);
+			config->reap_total += reap;
+		}
+		config->count++;
+		stress_bogo_inc(args);
+		if (t_reap >= t_end)
+			break;
+	}
+	if (mapping)
+		(void)munmap((void *)mapping, mapping_size);
+}
+
+/*
+ *  stress_fork_sweep()
+ *	fork latency, first copy-on-write fault latency and exit
+ *	to reap latency against the size of the parent with 4K
+ *	pages and with transparent huge pages
+ */
+static int stress_fork_sweep(stress_args_t *args, const uint64_t fork_sweep)
+{
+	static stress_fork_sweep_config_t configs[1 + (2 * FORK_SWEEP_STEPS)];
+	volatile stress_fork_sweep_child_t *child;
+	size_t shmall, freemem, totalmem, freeswap, totalswap;
+	size_t max_size, n_configs = 0, i, idx = 0, metric = 0;
+	double slice;
+
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	max_size = (size_t)fork_sweep;
+	if (freemem > 0) {
+		/* leave room for other instances and the children's page tables */
+		const size_t limit = freemem / 2 / (size_t)STRESS_MAXIMUM(1, args->num_instances);
+
+		if (max_size > limit) {
+			if (args->instance == 0)
+				pr_inf("%s: reducing --fork-sweep size from %zu MB to %zu MB "
+					"because of free memory\n", args->name,
+					(size_t)(max_size / MB), (size_t)(limit / MB));
+			max_size = limit;
+		}
+	}
+	max_size &= ~(FORK_SWEEP_THP_SIZE - 1);
+
+	child = (volatile stress_fork_sweep_child_t *)mmap(NULL, args->page_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (child == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap child timestamps, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)shim_memset(configs, 0, sizeof(configs));
+	configs[n_configs++].size = 0;
+	for (i = 0; i < 2 * FORK_SWEEP_STEPS; i++) {
+		const size_t size = (max_size >> (FORK_SWEEP_STEPS - 1 - (i % FORK_SWEEP_STEPS))) &
+			~(FORK_SWEEP_THP_SIZE - 1);
+
+		if (size == 0)
+			continue;
+		configs[n_configs].size = size;
+		configs[n_configs].thp = (i >= FORK_SWEEP_STEPS);
+		n_configs++;
+	}
+
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_configs : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		if (!configs[idx].failed)
+			stress_fork_sweep_pass(args, &configs[idx], child, slice);
+		idx++;
+		if (idx >= n_configs)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %5s %8s %8s %8s %10s %10s %10s %10s %10s\n", args->name,
+			"pages", "size MB", "PTE KB", "THP MB", "fork ns", "fork p99",
+			"COW ns", "COW p99", "reap ns");
+	for (i = 0; i < n_configs; i++) {
+		const stress_fork_sweep_config_t *config = &configs[i];
+		const double n = (double)config->count;
+		const char *pages = config->size ? (config->thp ? "thp" : "4K") : "-";
+		char str[64], label[32];
+
+		if (config->count == 0)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %5s %8zu %8zu %8zu %10.0f %10.0f %10.0f %10.0f %10.0f\n", args->name,
+				pages, (size_t)(config->size / MB), config->pte_kb, (size_t)(config->huge_kb / KB),
+				STRESS_DBL_NANOSECOND * config->fork_total / n,
+				(double)stress_latency_percentile(&config->fork_lat, 99.0),
+				STRESS_DBL_NANOSECOND * config->cow_total / n,
+				(double)stress_latency_percentile(&config->cow_lat, 99.0),
+				STRESS_DBL_NANOSECOND * config->reap_total / n);
+		if (metric + 3 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		if (config->size)
+			(void)snprintf(label, sizeof(label), "%s %zu MB", pages, (size_t)(config->size / MB));
+		else
+			(void)snprintf(label, sizeof(label), "0 MB");
+		(void)snprintf(str, sizeof(str), "%s fork latency (ns)", label);
+		stress_metrics_set(args, metric++, str,
+			STRESS_DBL_NANOSECOND * config->fork_total / n, STRESS_GEOMETRIC_MEAN);
+		if (config->size) {
+			(void)snprintf(str, sizeof(str), "%s first COW fault latency (ns)", label);
+			stress_metrics_set(args, metric++, str,
+				STRESS_DBL_NANOSECOND * config->cow_total / n, STRESS_GEOMETRIC_MEAN);
+		}
+		(void)snprintf(str, sizeof(str), "%s exit to reap latency (ns)", label);
+		stress_metrics_set(args, metric++, str,
+			STRESS_DBL_NANOSECOND * config->reap_total / n, STRESS_GEOMETRIC_MEAN);
+	}
+	(void)munmap((void *)child, args->page_size);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_fork()
  *	stress by forking and exiting
@@ -484,8 +767,12 @@ static int stress_fork(stress_args_t *args)
 	uint32_t fork_max = DEFAULT_FORKS;
 	int rc;
 	bool fork_vm = false, fork_unmap = false;
+	uint64_t fork_sweep = 0;
 	pid_t pid;
 
+	if (stress_get_setting("fork-sweep", &fork_sweep))
+		return stress_fork_sweep(args, fork_sweep);
+
 	(void)stress_get_setting("fork-unmap", &fork_unmap);
 	(void)stress_get_setting("fork-vm", &fork_vm);
 
@@ -561,6 +848,7 @@ STRESS_PRAGMA_POP
 
 static const stress_opt_set_func_t fork_opt_set_funcs[] = {
 	{ OPT_fork_max,		stress_set_fork_max },
+	{ OPT_fork_sweep,	stress_set_fork_sweep },
 	{ OPT_fork_unmap,	stress_set_fork_unmap },
 	{ OPT_fork_vm,		stress_set_fork_vm },
 	{ 0,			NULL }
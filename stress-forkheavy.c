@@ -297,7 +297,7 @@ static int stress_forkheavy(stress_args_t *args)
 		free(forkheavy_args.resources);
 		return EXIT_NO_RESOURCE;
 	}
-	metrics->lock = stress_lock_create();
+	metrics->lock = stress_lock_create("forkheavy-metrics");
 	metrics->duration = 0.0;
 	metrics->count = 0.0;
 	metrics->t_start = 0.0;
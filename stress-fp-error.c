@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-attribute.h"
 
 #if defined(HAVE_FENV_H)
 #include <fenv.h>
@@ -28,10 +29,56 @@
 #include <float.h>
 #endif
 
+#define STRESS_FP_ERROR_MODE_NONE	(0x00)
+#define STRESS_FP_ERROR_MODE_THROUGHPUT	(0x01)
+#define STRESS_FP_ERROR_MODE_LATENCY	(0x02)
+#define STRESS_FP_ERROR_MODE_BOTH	(STRESS_FP_ERROR_MODE_THROUGHPUT | STRESS_FP_ERROR_MODE_LATENCY)
+
+#define STRESS_FP_ERROR_TIMING_OPS	(4096)
+#define STRESS_FP_ERROR_CHAINS		(8)
+
 static const stress_help_t help[] = {
-	{ NULL,	"fp-error N",	  "start N workers exercising floating point errors" },
-	{ NULL,	"fp-error-ops N", "stop after N fp-error bogo operations" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"fp-error N",	    "start N workers exercising floating point errors" },
+	{ NULL,	"fp-error-mode M",  "time normal and subnormal multiplies, throughput, latency or both" },
+	{ NULL,	"fp-error-ops N",   "stop after N fp-error bogo operations" },
+	{ NULL,	NULL,		    NULL }
+};
+
+typedef struct {
+	const char *name;
+	const int mode;
+} stress_fp_error_mode_t;
+
+static const stress_fp_error_mode_t stress_fp_error_modes[] = {
+	{ "throughput",	STRESS_FP_ERROR_MODE_THROUGHPUT },
+	{ "latency",	STRESS_FP_ERROR_MODE_LATENCY },
+	{ "both",	STRESS_FP_ERROR_MODE_BOTH },
+};
+
+/*
+ *  stress_set_fp_error_mode()
+ *	set the throughput, latency or both timing mode
+ */
+static int stress_set_fp_error_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_fp_error_modes); i++) {
+		if (strcmp(opt, stress_fp_error_modes[i].name) == 0)
+			return stress_set_setting("fp-error-mode", TYPE_ID_INT, &stress_fp_error_modes[i].mode);
+	}
+
+	(void)fprintf(stderr, "fp-error-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(stress_fp_error_modes); i++) {
+		(void)fprintf(stderr, " %s", stress_fp_error_modes[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fp_error_mode,	stress_set_fp_error_mode },
+	{ 0,			NULL },
 };
 
 #if !defined(__UCLIBC__) &&		\
@@ -115,12 +162,107 @@ static void stress_fp_check(
 #endif
 }
 
+/*
+ *  stress_fp_error_mul_lat()
+ *	single dependent chain of multiplies by one, with
+ *	subnormal values these typically need a microcode assist
+ */
+static double OPTIMIZE3 stress_fp_error_mul_lat(const double val, const double one)
+{
+	register double r = val;
+	register int i;
+
+	for (i = 0; i < STRESS_FP_ERROR_TIMING_OPS; i++)
+		r *= one;
+
+	return r * (double)STRESS_FP_ERROR_CHAINS;
+}
+
+/*
+ *  stress_fp_error_mul_tput()
+ *	independent chains of multiplies by one
+ */
+static double OPTIMIZE3 stress_fp_error_mul_tput(const double val, const double one)
+{
+	register double r0 = val, r1 = val, r2 = val, r3 = val;
+	register double r4 = val, r5 = val, r6 = val, r7 = val;
+	register int i;
+
+	for (i = 0; i < STRESS_FP_ERROR_TIMING_OPS / STRESS_FP_ERROR_CHAINS; i++) {
+		r0 *= one;
+		r1 *= one;
+		r2 *= one;
+		r3 *= one;
+		r4 *= one;
+		r5 *= one;
+		r6 *= one;
+		r7 *= one;
+	}
+	return r0 + r1 + r2 + r3 + r4 + r5 + r6 + r7;
+}
+
+/*
+ *  stress_fp_error_timing()
+ *	time multiplies of normal and subnormal values in the
+ *	selected latency and throughput forms, metrics are stored
+ *	as normal latency, normal throughput, subnormal latency
+ *	and subnormal throughput
+ */
+static void stress_fp_error_timing(
+	stress_args_t *args,
+	const int mode,
+	stress_metrics_t metrics[4])
+{
+	volatile double one, normal, subnormal;
+	size_t i;
+
+	SET_VOLATILE(one, 1.0);
+	SET_VOLATILE(normal, 1.5);
+	SET_VOLATILE(subnormal, DBL_MIN / 4.0);
+
+	for (i = 0; i < 4; i++) {
+		const bool latency = !(i & 1);
+		const double val = (i < 2) ? normal : subnormal;
+		double t, r;
+
+		if (!(mode & (latency ? STRESS_FP_ERROR_MODE_LATENCY : STRESS_FP_ERROR_MODE_THROUGHPUT)))
+			continue;
+
+		t = stress_time_now();
+		r = latency ? stress_fp_error_mul_lat(val, one) : stress_fp_error_mul_tput(val, one);
+		metrics[i].duration += stress_time_now() - t;
+		metrics[i].count += (double)STRESS_FP_ERROR_TIMING_OPS;
+
+		if (r != val * (double)STRESS_FP_ERROR_CHAINS) {
+			pr_fail("%s: %s multiply by 1.0 of %g returned %g, expected %g\n",
+				args->name, latency ? "dependent" : "independent",
+				val, r / (double)STRESS_FP_ERROR_CHAINS, val);
+		}
+	}
+}
+
 /*
  *  stress_fp_error()
  *	stress floating point error handling
  */
 static int stress_fp_error(stress_args_t *args)
 {
+	static const char * const timing_desc[] = {
+		"ns per multiply latency, normal",
+		"ns per multiply throughput, normal",
+		"ns per multiply latency, subnormal",
+		"ns per multiply throughput, subnormal",
+	};
+	stress_metrics_t timing[SIZEOF_ARRAY(timing_desc)];
+	int fp_error_mode = STRESS_FP_ERROR_MODE_NONE;
+	size_t i, j;
+
+	(void)stress_get_setting("fp-error-mode", &fp_error_mode);
+	for (i = 0; i < SIZEOF_ARRAY(timing); i++) {
+		timing[i].duration = 0.0;
+		timing[i].count = 0.0;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -198,17 +340,32 @@ static int stress_fp_error(stress_args_t *args)
 		 */
 		if ((int)fegetround() == -1)
 			pr_fail("%s: fegetround() returned -1\n", args->name);
+		if (fp_error_mode != STRESS_FP_ERROR_MODE_NONE)
+			stress_fp_error_timing(args, fp_error_mode, timing);
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	for (i = 0, j = 0; i < SIZEOF_ARRAY(timing); i++) {
+		if (timing[i].count > 0.0) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "%s", timing_desc[i]);
+			stress_metrics_set(args, j, msg,
+				(1.0E9 * timing[i].duration) / timing[i].count,
+				STRESS_GEOMETRIC_MEAN);
+			j++;
+		}
+	}
+
 	return EXIT_SUCCESS;
 }
 
 stressor_info_t stress_fp_error_info = {
 	.stressor = stress_fp_error,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -216,6 +373,7 @@ stressor_info_t stress_fp_error_info = {
 stressor_info_t stress_fp_error_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without fully functional floating point error support"
@@ -44,9 +44,14 @@
 #define STRESS_FP_TYPE_FLOAT128		(8)
 #define STRESS_FP_TYPE_ALL		(9)
 
+#define STRESS_FP_MODE_THROUGHPUT	(0x01)
+#define STRESS_FP_MODE_LATENCY		(0x02)
+#define STRESS_FP_MODE_BOTH		(STRESS_FP_MODE_THROUGHPUT | STRESS_FP_MODE_LATENCY)
+
 static const stress_help_t help[] = {
 	{ NULL,	"fp N",	 	"start N workers performing floating point math ops" },
 	{ NULL,	"fp-method M",	"select the floating point method to operate with" },
+	{ NULL,	"fp-mode M",	"select throughput, latency or both modes" },
 	{ NULL,	"fp-ops N",	"stop after N floating point math bogo operations" },
 	{ NULL,	NULL,		 NULL }
 };
@@ -268,122 +273,200 @@ static double TARGET_CLONES OPTIMIZE3 name(				\
 	return t2 - t1;							\
 }
 
+/*
+ *  Latency variants, these perform the same operation pairs as
+ *  the throughput variants above but on just one element so that
+ *  every operation depends on the result of the previous one
+ */
+#define STRESS_FP_LATENCY(field, name, op, val, val_rev, do_bogo_ops)	\
+static double TARGET_CLONES OPTIMIZE3 name(				\
+	stress_args_t *args,					\
+	fp_data_t *fp_data,						\
+	const int index)						\
+{									\
+	register int i;							\
+	const int loops = LOOPS_PER_CALL >> 1;				\
+	double t1, t2;							\
+									\
+	for (i = 0; i < FP_ELEMENTS; i++) {				\
+		fp_data[i].field.r[index] = fp_data[i].field.r_init;	\
+	}								\
+									\
+	t1 = stress_time_now();						\
+	for (i = 0; stress_continue_flag() && (i < loops); i++) {	\
+		fp_data[0].field.r[index] op fp_data[0].field.val;	\
+		fp_data[0].field.r[index] op fp_data[0].field.val_rev;	\
+	}								\
+	t2 = stress_time_now();						\
+									\
+	if (do_bogo_ops)						\
+		stress_bogo_inc(args);					\
+	return t2 - t1;							\
+}
+
+#define STRESS_FP_ADD_LAT(field, name, do_bogo_ops)			\
+	STRESS_FP_LATENCY(field, name, +=, add, add_rev, do_bogo_ops)
+#define STRESS_FP_MUL_LAT(field, name, do_bogo_ops)			\
+	STRESS_FP_LATENCY(field, name, *=, mul, mul_rev, do_bogo_ops)
+#define STRESS_FP_DIV_LAT(field, name, do_bogo_ops)			\
+	STRESS_FP_LATENCY(field, name, /=, mul, mul_rev, do_bogo_ops)
+
 STRESS_FP_ADD(ld, stress_fp_ldouble_add, true)
+STRESS_FP_ADD_LAT(ld, stress_fp_ldouble_add_lat, true)
 STRESS_FP_MUL(ld, stress_fp_ldouble_mul, true)
+STRESS_FP_MUL_LAT(ld, stress_fp_ldouble_mul_lat, true)
 STRESS_FP_DIV(ld, stress_fp_ldouble_div, true)
+STRESS_FP_DIV_LAT(ld, stress_fp_ldouble_div_lat, true)
 
 STRESS_FP_ADD(d, stress_fp_double_add, true)
+STRESS_FP_ADD_LAT(d, stress_fp_double_add_lat, true)
 STRESS_FP_MUL(d, stress_fp_double_mul, true)
+STRESS_FP_MUL_LAT(d, stress_fp_double_mul_lat, true)
 STRESS_FP_DIV(d, stress_fp_double_div, true)
+STRESS_FP_DIV_LAT(d, stress_fp_double_div_lat, true)
 
 STRESS_FP_ADD(f, stress_fp_float_add, true)
+STRESS_FP_ADD_LAT(f, stress_fp_float_add_lat, true)
 STRESS_FP_MUL(f, stress_fp_float_mul, true)
+STRESS_FP_MUL_LAT(f, stress_fp_float_mul_lat, true)
 STRESS_FP_DIV(f, stress_fp_float_div, true)
+STRESS_FP_DIV_LAT(f, stress_fp_float_div_lat, true)
 
 #if defined(HAVE_Float16)
 STRESS_FP_ADD(f16, stress_fp_float16_add, false)
+STRESS_FP_ADD_LAT(f16, stress_fp_float16_add_lat, false)
 STRESS_FP_MUL(f16, stress_fp_float16_mul, false)
+STRESS_FP_MUL_LAT(f16, stress_fp_float16_mul_lat, false)
 STRESS_FP_DIV(f16, stress_fp_float16_div, false)
+STRESS_FP_DIV_LAT(f16, stress_fp_float16_div_lat, false)
 #endif
 
 #if defined(HAVE_Float32)
 STRESS_FP_ADD(f32, stress_fp_float32_add, false)
+STRESS_FP_ADD_LAT(f32, stress_fp_float32_add_lat, false)
 STRESS_FP_MUL(f32, stress_fp_float32_mul, false)
+STRESS_FP_MUL_LAT(f32, stress_fp_float32_mul_lat, false)
 STRESS_FP_DIV(f32, stress_fp_float32_div, false)
+STRESS_FP_DIV_LAT(f32, stress_fp_float32_div_lat, false)
 #endif
 
 #if defined(HAVE_Float64)
 STRESS_FP_ADD(f64, stress_fp_float64_add, false)
+STRESS_FP_ADD_LAT(f64, stress_fp_float64_add_lat, false)
 STRESS_FP_MUL(f64, stress_fp_float64_mul, false)
+STRESS_FP_MUL_LAT(f64, stress_fp_float64_mul_lat, false)
 STRESS_FP_DIV(f64, stress_fp_float64_div, false)
+STRESS_FP_DIV_LAT(f64, stress_fp_float64_div_lat, false)
 #endif
 
 #if defined(HAVE__float80)
 STRESS_FP_ADD(f80, stress_fp_float80_add, false)
+STRESS_FP_ADD_LAT(f80, stress_fp_float80_add_lat, false)
 STRESS_FP_MUL(f80, stress_fp_float80_mul, false)
+STRESS_FP_MUL_LAT(f80, stress_fp_float80_mul_lat, false)
 STRESS_FP_DIV(f80, stress_fp_float80_div, false)
+STRESS_FP_DIV_LAT(f80, stress_fp_float80_div_lat, false)
 #endif
 
 #if defined(HAVE__float128) || 	\
     defined(HAVE_Float128)
 STRESS_FP_ADD(f128, stress_fp_float128_add, false)
+STRESS_FP_ADD_LAT(f128, stress_fp_float128_add_lat, false)
 STRESS_FP_MUL(f128, stress_fp_float128_mul, false)
+STRESS_FP_MUL_LAT(f128, stress_fp_float128_mul_lat, false)
 STRESS_FP_DIV(f128, stress_fp_float128_div, false)
+STRESS_FP_DIV_LAT(f128, stress_fp_float128_div_lat, false)
 #endif
 
 typedef struct {
 	const char *name;
 	const char *description;
-	const stress_fp_func_t	fp_func;
+	const stress_fp_func_t	fp_func;	/* independent chains, throughput */
+	const stress_fp_func_t	fp_lat_func;	/* single dependent chain, latency */
 	const int fp_type;
 	double duration;
 	double ops;
+	double lat_duration;
+	double lat_ops;
 } stress_fp_funcs_t;
 
 static stress_fp_funcs_t stress_fp_funcs[] = {
-	{ "all",		"all fp methods",	stress_fp_all,		STRESS_FP_TYPE_ALL,		0.0, 0.0 },
+	{ "all",		"all fp methods",	stress_fp_all,		stress_fp_all,		STRESS_FP_TYPE_ALL,	0.0, 0.0, 0.0, 0.0 },
 
 #if defined(HAVE__float128) ||	\
     defined(HAVE_Float128)
-	{ "float128add",	"float128 add",		stress_fp_float128_add,	STRESS_FP_TYPE_FLOAT128,	0.0, 0.0 },
+	{ "float128add",	"float128 add",		stress_fp_float128_add,	stress_fp_float128_add_lat,	STRESS_FP_TYPE_FLOAT128,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE__float80)
-	{ "float80add",		"float80 add",		stress_fp_float80_add,	STRESS_FP_TYPE_FLOAT80,		0.0, 0.0 },
+	{ "float80add",		"float80 add",		stress_fp_float80_add,	stress_fp_float80_add_lat,	STRESS_FP_TYPE_FLOAT80,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float64)
-	{ "float64add",		"float64 add",		stress_fp_float64_add,	STRESS_FP_TYPE_FLOAT64,		0.0, 0.0 },
+	{ "float64add",		"float64 add",		stress_fp_float64_add,	stress_fp_float64_add_lat,	STRESS_FP_TYPE_FLOAT64,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float32)
-	{ "float32add",		"float32 add",		stress_fp_float32_add,	STRESS_FP_TYPE_FLOAT32,		0.0, 0.0 },
+	{ "float32add",		"float32 add",		stress_fp_float32_add,	stress_fp_float32_add_lat,	STRESS_FP_TYPE_FLOAT32,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float16)
-	{ "float16add",		"float16 add",		stress_fp_float16_add,	STRESS_FP_TYPE_FLOAT16,		0.0, 0.0 },
+	{ "float16add",		"float16 add",		stress_fp_float16_add,	stress_fp_float16_add_lat,	STRESS_FP_TYPE_FLOAT16,	0.0, 0.0, 0.0, 0.0 },
 #endif
-	{ "floatadd",		"float add",		stress_fp_float_add,	STRESS_FP_TYPE_FLOAT,		0.0, 0.0 },
-	{ "doubleadd",		"double add",		stress_fp_double_add,	STRESS_FP_TYPE_DOUBLE,		0.0, 0.0 },
-	{ "ldoubleadd",		"long double add",	stress_fp_ldouble_add,	STRESS_FP_TYPE_LONG_DOUBLE,	0.0, 0.0 },
+	{ "floatadd",		"float add",		stress_fp_float_add,	stress_fp_float_add_lat,	STRESS_FP_TYPE_FLOAT,	0.0, 0.0, 0.0, 0.0 },
+	{ "doubleadd",		"double add",		stress_fp_double_add,	stress_fp_double_add_lat,	STRESS_FP_TYPE_DOUBLE,	0.0, 0.0, 0.0, 0.0 },
+	{ "ldoubleadd",		"long double add",	stress_fp_ldouble_add,	stress_fp_ldouble_add_lat,	STRESS_FP_TYPE_LONG_DOUBLE,	0.0, 0.0, 0.0, 0.0 },
 
 #if defined(HAVE__float128) ||	\
     defined(HAVE_Float128)
-	{ "float128mul",	"float128 multiply",	stress_fp_float128_mul,	STRESS_FP_TYPE_FLOAT128,	0.0, 0.0 },
+	{ "float128mul",	"float128 multiply",	stress_fp_float128_mul,	stress_fp_float128_mul_lat,	STRESS_FP_TYPE_FLOAT128,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE__float80)
-	{ "float80mul",		"float80 multiply",	stress_fp_float80_mul,	STRESS_FP_TYPE_FLOAT80,		0.0, 0.0 },
+	{ "float80mul",		"float80 multiply",	stress_fp_float80_mul,	stress_fp_float80_mul_lat,	STRESS_FP_TYPE_FLOAT80,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float64)
-	{ "float64mul",		"float64 multiply",	stress_fp_float64_mul,	STRESS_FP_TYPE_FLOAT64,		0.0, 0.0 },
+	{ "float64mul",		"float64 multiply",	stress_fp_float64_mul,	stress_fp_float64_mul_lat,	STRESS_FP_TYPE_FLOAT64,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float32)
-	{ "float32mul",		"float32 multiply",	stress_fp_float32_mul,	STRESS_FP_TYPE_FLOAT32,		0.0, 0.0 },
+	{ "float32mul",		"float32 multiply",	stress_fp_float32_mul,	stress_fp_float32_mul_lat,	STRESS_FP_TYPE_FLOAT32,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float16)
-	{ "float16mul",		"float16 multiply",	stress_fp_float16_mul,	STRESS_FP_TYPE_FLOAT16,		0.0, 0.0 },
+	{ "float16mul",		"float16 multiply",	stress_fp_float16_mul,	stress_fp_float16_mul_lat,	STRESS_FP_TYPE_FLOAT16,	0.0, 0.0, 0.0, 0.0 },
 #endif
-	{ "floatmul",		"float multiply",	stress_fp_float_mul,	STRESS_FP_TYPE_FLOAT,		0.0, 0.0 },
-	{ "doublemul",		"double multiply",	stress_fp_double_mul,	STRESS_FP_TYPE_DOUBLE,		0.0, 0.0 },
-	{ "ldoublemul",		"long double multiply",	stress_fp_ldouble_mul,	STRESS_FP_TYPE_LONG_DOUBLE,	0.0, 0.0 },
+	{ "floatmul",		"float multiply",	stress_fp_float_mul,	stress_fp_float_mul_lat,	STRESS_FP_TYPE_FLOAT,	0.0, 0.0, 0.0, 0.0 },
+	{ "doublemul",		"double multiply",	stress_fp_double_mul,	stress_fp_double_mul_lat,	STRESS_FP_TYPE_DOUBLE,	0.0, 0.0, 0.0, 0.0 },
+	{ "ldoublemul",		"long double multiply",	stress_fp_ldouble_mul,	stress_fp_ldouble_mul_lat,	STRESS_FP_TYPE_LONG_DOUBLE,	0.0, 0.0, 0.0, 0.0 },
 
 #if defined(HAVE__float128) || 	\
     defined(HAVE_Float128)
-	{ "float128div",	"float128 divide",	stress_fp_float128_div,	STRESS_FP_TYPE_FLOAT128,	0.0, 0.0 },
+	{ "float128div",	"float128 divide",	stress_fp_float128_div,	stress_fp_float128_div_lat,	STRESS_FP_TYPE_FLOAT128,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE__float80)
-	{ "float80div",		"float80 divide",	stress_fp_float80_div,	STRESS_FP_TYPE_FLOAT80,		0.0, 0.0 },
+	{ "float80div",		"float80 divide",	stress_fp_float80_div,	stress_fp_float80_div_lat,	STRESS_FP_TYPE_FLOAT80,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float64)
-	{ "float64div",		"float64 divide",	stress_fp_float64_div,	STRESS_FP_TYPE_FLOAT64,		0.0, 0.0 },
+	{ "float64div",		"float64 divide",	stress_fp_float64_div,	stress_fp_float64_div_lat,	STRESS_FP_TYPE_FLOAT64,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float32)
-	{ "float32div",		"float32 divide",	stress_fp_float32_div,	STRESS_FP_TYPE_FLOAT32,		0.0, 0.0 },
+	{ "float32div",		"float32 divide",	stress_fp_float32_div,	stress_fp_float32_div_lat,	STRESS_FP_TYPE_FLOAT32,	0.0, 0.0, 0.0, 0.0 },
 #endif
 #if defined(HAVE_Float16)
-	{ "float16div",		"float16 divide",	stress_fp_float16_div,	STRESS_FP_TYPE_FLOAT16,		0.0, 0.0 },
+	{ "float16div",		"float16 divide",	stress_fp_float16_div,	stress_fp_float16_div_lat,	STRESS_FP_TYPE_FLOAT16,	0.0, 0.0, 0.0, 0.0 },
 #endif
-	{ "floatdiv",		"float divide",		stress_fp_float_div,	STRESS_FP_TYPE_FLOAT,		0.0, 0.0 },
-	{ "doublediv",		"double divide",	stress_fp_double_div,	STRESS_FP_TYPE_DOUBLE,		0.0, 0.0 },
-	{ "ldoublediv",		"long double divide",	stress_fp_ldouble_div,	STRESS_FP_TYPE_LONG_DOUBLE,	0.0, 0.0 },
+	{ "floatdiv",		"float divide",		stress_fp_float_div,	stress_fp_float_div_lat,	STRESS_FP_TYPE_FLOAT,	0.0, 0.0, 0.0, 0.0 },
+	{ "doublediv",		"double divide",	stress_fp_double_div,	stress_fp_double_div_lat,	STRESS_FP_TYPE_DOUBLE,	0.0, 0.0, 0.0, 0.0 },
+	{ "ldoublediv",		"long double divide",	stress_fp_ldouble_div,	stress_fp_ldouble_div_lat,	STRESS_FP_TYPE_LONG_DOUBLE,	0.0, 0.0, 0.0, 0.0 },
 };
 
+typedef struct {
+	const char *name;
+	const int mode;
+} stress_fp_mode_t;
+
+static const stress_fp_mode_t stress_fp_modes[] = {
+	{ "throughput",	STRESS_FP_MODE_THROUGHPUT },
+	{ "latency",	STRESS_FP_MODE_LATENCY },
+	{ "both",	STRESS_FP_MODE_BOTH },
+};
+
+static int stress_fp_mode = STRESS_FP_MODE_THROUGHPUT;
+
 typedef struct {
 	const int fp_type;
 	const char *fp_description;
@@ -412,18 +495,28 @@ static const char * PURE stress_fp_type(const int fp_type)
 	return "unknown";
 }
 
-static void stress_fp_call_method(
+/*
+ *  stress_fp_call_func()
+ *	run the throughput or latency variant of a method and
+ *	optionally verify the results
+ */
+static void stress_fp_call_func(
 	stress_args_t *args,
 	fp_data_t *fp_data,
 	const size_t method,
-	const bool verify)
+	const bool verify,
+	const bool latency)
 {
 	double dt;
 	stress_fp_funcs_t *func = &stress_fp_funcs[method];
+	const stress_fp_func_t fp_func = latency ? func->fp_lat_func : func->fp_func;
+	double *duration = latency ? &func->lat_duration : &func->duration;
+	double *ops = latency ? &func->lat_ops : &func->ops;
+	const double ops_per_call = latency ? LOOPS_PER_CALL : (FP_ELEMENTS * LOOPS_PER_CALL);
 
-	dt = func->fp_func(args, fp_data, 0);
-	func->duration += dt;
-	func->ops += (FP_ELEMENTS * LOOPS_PER_CALL);
+	dt = fp_func(args, fp_data, 0);
+	*duration += dt;
+	*ops += ops_per_call;
 
 	if ((method > 0) && (method < SIZEOF_ARRAY(stress_fp_funcs)) && verify) {
 		register size_t i;
@@ -431,9 +524,9 @@ static void stress_fp_call_method(
 		const char *method_name = stress_fp_funcs[method].name;
 		const char *fp_description = stress_fp_type(fp_type);
 
-		dt = func->fp_func(args, fp_data, 1);
-		func->duration += dt;
-		func->ops += (FP_ELEMENTS * LOOPS_PER_CALL);
+		dt = fp_func(args, fp_data, 1);
+		*duration += dt;
+		*ops += ops_per_call;
 
 		/*
 		 *  a SIGALRM during 2nd computation pre-verification can
@@ -504,6 +597,26 @@ static void stress_fp_call_method(
 	}
 }
 
+/*
+ *  stress_fp_call_method()
+ *	run the method for each of the selected fp modes
+ */
+static void stress_fp_call_method(
+	stress_args_t *args,
+	fp_data_t *fp_data,
+	const size_t method,
+	const bool verify)
+{
+	if (method == 0) {
+		(void)stress_fp_all(args, fp_data, 0);
+		return;
+	}
+	if (stress_fp_mode & STRESS_FP_MODE_THROUGHPUT)
+		stress_fp_call_func(args, fp_data, method, verify, false);
+	if (stress_fp_mode & STRESS_FP_MODE_LATENCY)
+		stress_fp_call_func(args, fp_data, method, verify, true);
+}
+
 static double stress_fp_all(
 	stress_args_t *args,
 	fp_data_t *fp_data,
@@ -543,6 +656,89 @@ static int stress_set_fp_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_fp_mode()
+ *	set the throughput, latency or both fp mode
+ */
+static int stress_set_fp_mode(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_fp_modes); i++) {
+		if (!strcmp(stress_fp_modes[i].name, name))
+			return stress_set_setting("fp-mode", TYPE_ID_INT, &stress_fp_modes[i].mode);
+	}
+
+	(void)fprintf(stderr, "fp-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(stress_fp_modes); i++) {
+		(void)fprintf(stderr, " %s", stress_fp_modes[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_fp_ns_per_op()
+ *	nanoseconds per floating point operation
+ */
+static double stress_fp_ns_per_op(const double duration, const double ops)
+{
+	return (ops > 0.0) ? (1.0E9 * duration) / ops : 0.0;
+}
+
+/*
+ *  stress_fp_metrics()
+ *	report the per method rates, the throughput mode reports
+ *	Mfp-ops per sec, the latency and both modes report
+ *	ns per op for each of the selected modes
+ */
+static void stress_fp_metrics(stress_args_t *args)
+{
+	size_t i, j;
+
+	if ((stress_fp_mode == STRESS_FP_MODE_BOTH) && (args->instance == 0)) {
+		pr_inf("%s: %-22s %14s %14s %8s\n", args->name,
+			"method", "latency ns", "throughput ns", "ratio");
+		for (i = 1; i < SIZEOF_ARRAY(stress_fp_funcs); i++) {
+			const double lat = stress_fp_ns_per_op(stress_fp_funcs[i].lat_duration, stress_fp_funcs[i].lat_ops);
+			const double tput = stress_fp_ns_per_op(stress_fp_funcs[i].duration, stress_fp_funcs[i].ops);
+
+			if ((lat > 0.0) && (tput > 0.0))
+				pr_inf("%s: %-22s %14.3f %14.3f %8.2f\n", args->name,
+					stress_fp_funcs[i].description, lat, tput, lat / tput);
+		}
+	}
+
+	for (i = 1, j = 0; i < SIZEOF_ARRAY(stress_fp_funcs); i++) {
+		const stress_fp_funcs_t *func = &stress_fp_funcs[i];
+		char msg[64];
+
+		if (stress_fp_mode == STRESS_FP_MODE_THROUGHPUT) {
+			if ((func->duration > 0.0) && (func->ops > 0.0)) {
+				const double rate = func->ops / func->duration;
+
+				(void)snprintf(msg, sizeof(msg), "Mfp-ops per sec, %-20s", func->description);
+				stress_metrics_set(args, i - 1, msg,
+					rate / 1000000.0, STRESS_HARMONIC_MEAN);
+			}
+			continue;
+		}
+		if ((func->lat_duration > 0.0) && (func->lat_ops > 0.0)) {
+			(void)snprintf(msg, sizeof(msg), "ns per op latency, %-20s", func->description);
+			stress_metrics_set(args, j, msg,
+				stress_fp_ns_per_op(func->lat_duration, func->lat_ops), STRESS_GEOMETRIC_MEAN);
+			j++;
+		}
+		if ((func->duration > 0.0) && (func->ops > 0.0)) {
+			(void)snprintf(msg, sizeof(msg), "ns per op throughput, %-20s", func->description);
+			stress_metrics_set(args, j, msg,
+				stress_fp_ns_per_op(func->duration, func->ops), STRESS_GEOMETRIC_MEAN);
+			j++;
+		}
+	}
+}
+
 static int stress_fp(stress_args_t *args)
 {
 	size_t i, mmap_size;
@@ -564,6 +760,7 @@ static int stress_fp(stress_args_t *args)
 	(void)stress_madvise_mergeable(fp_data, mmap_size);
 
 	(void)stress_get_setting("fp-method", &fp_method);
+	(void)stress_get_setting("fp-mode", &stress_fp_mode);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -711,18 +908,7 @@ static int stress_fp(stress_args_t *args)
 		stress_fp_call_method(args, fp_data, fp_method, verify);
 	} while (stress_continue(args));
 
-	for (i = 1; i < SIZEOF_ARRAY(stress_fp_funcs); i++) {
-		const double ops = stress_fp_funcs[i].ops;
-		const double duration = stress_fp_funcs[i].duration;
-		if ((duration > 0.0) && (ops > 0.0)) {
-			char msg[64];
-			const double rate = stress_fp_funcs[i].ops / stress_fp_funcs[i].duration;
-
-			(void)snprintf(msg, sizeof(msg), "Mfp-ops per sec, %-20s", stress_fp_funcs[i].description);
-			stress_metrics_set(args, i - 1, msg,
-				rate / 1000000.0, STRESS_HARMONIC_MEAN);
-		}
-	}
+	stress_fp_metrics(args);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -733,6 +919,8 @@ static int stress_fp(stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
         { OPT_fp_method,	stress_set_fp_method },
+        { OPT_fp_mode,		stress_set_fp_mode },
+	{ 0,			NULL },
 };
 
 stressor_info_t stress_fp_info = {
@@ -20,6 +20,8 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-latency.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LINUX_FUTEX_H)
 #include <linux/futex.h>
@@ -27,15 +29,544 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"futex N",	"start N workers exercising a fast mutex" },
+	{ NULL,	"futex-method M", "select futex wake latency method M" },
 	{ NULL,	"futex-ops N",	"stop after N fast mutex bogo operations" },
+	{ NULL,	"futex-waiters N", "maximum number of waiters for futex wake latency methods" },
 	{ NULL,	NULL,		NULL }
 };
 
+#define MIN_FUTEX_WAITERS	(1)
+#define MAX_FUTEX_WAITERS	(64)
+#define DEFAULT_FUTEX_WAITERS	(4)
+
+/* default is the original wait/wake stressing, all runs every method */
+static const char * const futex_method_names[] = {
+	"default",
+	"all",
+	"wait-shared",
+	"wait-private",
+	"waitv",
+	"requeue",
+	"requeue-pi",
+};
+
+static int stress_set_futex_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(futex_method_names); i++) {
+		if (!strcmp(futex_method_names[i], opt))
+			return stress_set_setting("futex-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "futex-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(futex_method_names); i++)
+		(void)fprintf(stderr, " %s", futex_method_names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_futex_waiters(const char *opt)
+{
+	uint32_t futex_waiters;
+
+	futex_waiters = stress_get_uint32(opt);
+	stress_check_range("futex-waiters", (uint64_t)futex_waiters,
+		MIN_FUTEX_WAITERS, MAX_FUTEX_WAITERS);
+	return stress_set_setting("futex-waiters", TYPE_ID_UINT32, &futex_waiters);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_futex_method,	stress_set_futex_method },
+	{ OPT_futex_waiters,	stress_set_futex_waiters },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LINUX_FUTEX_H) &&	\
     defined(__NR_futex)
 
 #define THRESHOLD	(100000)
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(FUTEX_WAIT_PRIVATE) &&	\
+    defined(FUTEX_WAKE_PRIVATE) &&	\
+    defined(FUTEX_CMP_REQUEUE_PRIVATE)
+#define STRESS_FUTEX_BENCH
+#endif
+
+#if defined(STRESS_FUTEX_BENCH)
+
+#define FUTEX_WAIT_TIMEOUT_NS	(100000000)	/* 0.1 second */
+
+typedef struct stress_futex_bench stress_futex_bench_t;
+typedef struct stress_futex_waiter stress_futex_waiter_t;
+
+/* a futex wait/wake method */
+typedef struct {
+	const char *name;
+	int (*wait)(stress_futex_waiter_t *w, const uint32_t val);
+	int (*wake)(stress_futex_bench_t *b, const uint32_t val);
+	void (*woken)(stress_futex_waiter_t *w);
+} stress_futex_method_t;
+
+/* state shared between the waker and waiters, in a shared mapping */
+struct stress_futex_bench {
+	uint32_t seq ALIGNED(64);	/* futex waited on, bumped each round */
+	uint32_t target ALIGNED(64);	/* requeue target or PI futex */
+	uint32_t other ALIGNED(64);	/* unchanging second futex_waitv futex */
+	uint32_t ready ALIGNED(64);	/* waiters waiting for the next round */
+	double t_wake;			/* time of the last wake */
+	bool stop;			/* set to stop waiters */
+	bool enosys;			/* method not supported */
+	int err;			/* unexpected errno, 0 if none */
+	const stress_futex_method_t *method;
+};
+
+/* per waiter thread state */
+struct stress_futex_waiter {
+	pthread_t pthread;
+	stress_futex_bench_t *b;
+	pid_t tid;
+	uint64_t wakes;			/* wakes measured */
+	stress_latency_t lat;		/* wake to run latencies */
+};
+
+/* accumulated results of a method and waiter count */
+typedef struct {
+	const stress_futex_method_t *method;
+	uint32_t waiters;
+	bool enosys;
+	double duration;
+	uint64_t wakes;
+	stress_latency_t lat;
+} stress_futex_result_t;
+
+/*
+ *  stress_futex_abs_timeout()
+ *	absolute CLOCK_MONOTONIC timeout for futex_waitv and requeue-pi
+ */
+static void stress_futex_abs_timeout(struct timespec *t)
+{
+	if (clock_gettime(CLOCK_MONOTONIC, t) < 0) {
+		t->tv_sec = 0;
+		t->tv_nsec = 0;
+	}
+	t->tv_nsec += FUTEX_WAIT_TIMEOUT_NS;
+	if (t->tv_nsec >= 1000000000) {
+		t->tv_sec++;
+		t->tv_nsec -= 1000000000;
+	}
+}
+
+static int stress_futex_wait_shared(stress_futex_waiter_t *w, const uint32_t val)
+{
+	struct timespec t = { 0, FUTEX_WAIT_TIMEOUT_NS };
+
+	return (int)syscall(__NR_futex, &w->b->seq, FUTEX_WAIT, val, &t, NULL, 0);
+}
+
+static int stress_futex_wake_shared(stress_futex_bench_t *b, const uint32_t val)
+{
+	(void)val;
+
+	return (int)syscall(__NR_futex, &b->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static int stress_futex_wait_private(stress_futex_waiter_t *w, const uint32_t val)
+{
+	struct timespec t = { 0, FUTEX_WAIT_TIMEOUT_NS };
+
+	return (int)syscall(__NR_futex, &w->b->seq, FUTEX_WAIT_PRIVATE, val, &t, NULL, 0);
+}
+
+static int stress_futex_wake_private(stress_futex_bench_t *b, const uint32_t val)
+{
+	(void)val;
+
+	return (int)syscall(__NR_futex, &b->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/*
+ *  stress_futex_wait_waitv()
+ *	futex2 wait on the round futex and a futex that never changes
+ */
+static int stress_futex_wait_waitv(stress_futex_waiter_t *w, const uint32_t val)
+{
+#if defined(FUTEX_32) &&	\
+    defined(FUTEX_PRIVATE_FLAG)
+	struct shim_futex_waitv waitv[2];
+	struct timespec t;
+	int ret;
+
+	(void)shim_memset(waitv, 0, sizeof(waitv));
+	waitv[0].val = (uint64_t)val;
+	waitv[0].uaddr = (uintptr_t)&w->b->seq;
+	waitv[0].flags = FUTEX_32 | FUTEX_PRIVATE_FLAG;
+	waitv[1].val = 0;
+	waitv[1].uaddr = (uintptr_t)&w->b->other;
+	waitv[1].flags = FUTEX_32 | FUTEX_PRIVATE_FLAG;
+
+	stress_futex_abs_timeout(&t);
+	ret = shim_futex_waitv(waitv, 2, 0, &t, CLOCK_MONOTONIC);
+	/* returns the index of the woken futex on success */
+	return (ret > 0) ? 0 : ret;
+#else
+	(void)w;
+	(void)val;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static int stress_futex_wait_requeue(stress_futex_waiter_t *w, const uint32_t val)
+{
+	return stress_futex_wait_private(w, val);
+}
+
+/*
+ *  stress_futex_wake_requeue()
+ *	wake one waiter and requeue the others onto the target
+ *	futex, then wake the requeued waiters from the target
+ */
+static int stress_futex_wake_requeue(stress_futex_bench_t *b, const uint32_t val)
+{
+	int ret;
+
+	ret = (int)syscall(__NR_futex, &b->seq, FUTEX_CMP_REQUEUE_PRIVATE, 1,
+		(void *)(uintptr_t)INT_MAX, &b->target, val);
+	if (ret < 0)
+		return ret;
+	return (int)syscall(__NR_futex, &b->target, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+#if defined(FUTEX_WAIT_REQUEUE_PI_PRIVATE) &&	\
+    defined(FUTEX_CMP_REQUEUE_PI_PRIVATE) &&	\
+    defined(FUTEX_UNLOCK_PI_PRIVATE) &&		\
+    defined(FUTEX_TID_MASK)
+/*
+ *  stress_futex_wait_requeue_pi()
+ *	wait on the round futex to be requeued onto and acquire
+ *	the PI futex, the condition variable pattern of glibc
+ */
+static int stress_futex_wait_requeue_pi(stress_futex_waiter_t *w, const uint32_t val)
+{
+	struct timespec t;
+
+	stress_futex_abs_timeout(&t);
+	return (int)syscall(__NR_futex, &w->b->seq, FUTEX_WAIT_REQUEUE_PI_PRIVATE,
+		val, &t, &w->b->target, 0);
+}
+
+/*
+ *  stress_futex_wake_requeue_pi()
+ *	wake one waiter, it acquires the PI futex, the others are
+ *	requeued onto the PI futex and acquire it in turn
+ */
+static int stress_futex_wake_requeue_pi(stress_futex_bench_t *b, const uint32_t val)
+{
+	return (int)syscall(__NR_futex, &b->seq, FUTEX_CMP_REQUEUE_PI_PRIVATE, 1,
+		(void *)(uintptr_t)INT_MAX, &b->target, val);
+}
+
+/*
+ *  stress_futex_woken_requeue_pi()
+ *	release the PI futex if the waiter acquired it
+ */
+static void stress_futex_woken_requeue_pi(stress_futex_waiter_t *w)
+{
+	uint32_t tid = (uint32_t)w->tid;
+
+	if ((__atomic_load_n(&w->b->target, __ATOMIC_ACQUIRE) & FUTEX_TID_MASK) != tid)
+		return;
+	/* uncontended, release in user space */
+	if (__atomic_compare_exchange_n(&w->b->target, &tid, 0, false,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		return;
+	VOID_RET(int, (int)syscall(__NR_futex, &w->b->target, FUTEX_UNLOCK_PI_PRIVATE, 0, NULL, NULL, 0));
+}
+#else
+static int stress_futex_wait_requeue_pi(stress_futex_waiter_t *w, const uint32_t val)
+{
+	(void)w;
+	(void)val;
+
+	errno = ENOSYS;
+	return -1;
+}
+
+static int stress_futex_wake_requeue_pi(stress_futex_bench_t *b, const uint32_t val)
+{
+	(void)b;
+	(void)val;
+
+	errno = ENOSYS;
+	return -1;
+}
+
+static void stress_futex_woken_requeue_pi(stress_futex_waiter_t *w)
+{
+	(void)w;
+}
+#endif
+
+static const stress_futex_method_t futex_methods[] = {
+	{ "wait-shared",	stress_futex_wait_shared,     stress_futex_wake_shared,     NULL },
+	{ "wait-private",	stress_futex_wait_private,    stress_futex_wake_private,    NULL },
+	{ "waitv",		stress_futex_wait_waitv,      stress_futex_wake_private,    NULL },
+	{ "requeue",		stress_futex_wait_requeue,    stress_futex_wake_requeue,    NULL },
+	{ "requeue-pi",		stress_futex_wait_requeue_pi, stress_futex_wake_requeue_pi, stress_futex_woken_requeue_pi },
+};
+
+/*
+ *  stress_futex_lat()
+ *	add the time from t_start to t_end to a latency histogram
+ */
+static inline void stress_futex_lat(stress_latency_t *lat, const double t_start, const double t_end)
+{
+	const uint64_t ns = (t_end > t_start) ? (uint64_t)((t_end - t_start) * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(lat, ns);
+}
+
+/*
+ *  stress_futex_waiter()
+ *	wait for each round to be woken and measure the time from
+ *	the wake call to running again
+ */
+static void *stress_futex_waiter(void *arg)
+{
+	static void *nowt = NULL;
+	stress_futex_waiter_t *w = (stress_futex_waiter_t *)arg;
+	stress_futex_bench_t *b = w->b;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	w->tid = (pid_t)shim_gettid();
+
+	while (!__atomic_load_n(&b->stop, __ATOMIC_ACQUIRE)) {
+		const uint32_t val = __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE);
+		double t = 0.0;
+
+		__atomic_fetch_add(&b->ready, 1, __ATOMIC_ACQ_REL);
+		while ((__atomic_load_n(&b->seq, __ATOMIC_ACQUIRE) == val) &&
+		       !__atomic_load_n(&b->stop, __ATOMIC_ACQUIRE)) {
+			const int ret = b->method->wait(w, val);
+
+			t = stress_time_now();
+			if (b->method->woken)
+				b->method->woken(w);
+			if (ret < 0) {
+				if (errno == ENOSYS) {
+					b->enosys = true;
+					__atomic_store_n(&b->stop, true, __ATOMIC_RELEASE);
+				} else if ((errno != EAGAIN) &&
+					   (errno != ETIMEDOUT) &&
+					   (errno != EINTR)) {
+					b->err = errno;
+				}
+			}
+		}
+		if (__atomic_load_n(&b->stop, __ATOMIC_ACQUIRE))
+			break;
+		stress_futex_lat(&w->lat, b->t_wake, t);
+		w->wakes++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_futex_bench_pass()
+ *	wake n_waiters waiter threads of a method for duration
+ *	seconds, one bogo op per round of wakes, returns
+ *	EXIT_FAILURE if a futex operation failed unexpectedly
+ */
+static int stress_futex_bench_pass(
+	stress_args_t *args,
+	stress_futex_bench_t *b,
+	stress_futex_waiter_t *waiters,
+	stress_futex_result_t *result,
+	const double duration)
+{
+	const uint32_t n_waiters = result->waiters;
+	double t_start, t_end;
+	uint32_t i, n_created = 0;
+
+	(void)shim_memset(b, 0, sizeof(*b));
+	b->method = result->method;
+
+	for (i = 0; i < n_waiters; i++) {
+		(void)shim_memset(&waiters[i], 0, sizeof(waiters[i]));
+		waiters[i].b = b;
+		if (pthread_create(&waiters[i].pthread, NULL, stress_futex_waiter, &waiters[i]) != 0)
+			break;
+		n_created++;
+	}
+
+	t_start = stress_time_now();
+	t_end = t_start + duration;
+	while (n_created > 0) {
+		uint32_t val;
+		int ret;
+
+		/* wait for all the waiters to be ready for the next round */
+		while ((__atomic_load_n(&b->ready, __ATOMIC_ACQUIRE) < n_created) &&
+		       !__atomic_load_n(&b->stop, __ATOMIC_ACQUIRE) &&
+		       stress_continue_flag())
+			(void)shim_sched_yield();
+		if (__atomic_load_n(&b->stop, __ATOMIC_ACQUIRE) ||
+		    !stress_continue(args) ||
+		    (stress_time_now() >= t_end))
+			break;
+
+		__atomic_store_n(&b->ready, 0, __ATOMIC_RELEASE);
+		b->t_wake = stress_time_now();
+		val = __atomic_add_fetch(&b->seq, 1, __ATOMIC_ACQ_REL);
+		ret = b->method->wake(b, val);
+		if (ret < 0) {
+			if (errno == ENOSYS) {
+				b->enosys = true;
+				break;
+			}
+			b->err = errno;
+		}
+		stress_bogo_inc(args);
+	}
+	result->duration += stress_time_now() - t_start;
+
+	__atomic_store_n(&b->stop, true, __ATOMIC_RELEASE);
+	(void)__atomic_add_fetch(&b->seq, 1, __ATOMIC_ACQ_REL);
+	for (i = 0; i < n_created; i++) {
+		VOID_RET(int, b->method->wake(b, __atomic_load_n(&b->seq, __ATOMIC_ACQUIRE)));
+		(void)pthread_join(waiters[i].pthread, NULL);
+	}
+	for (i = 0; i < n_created; i++) {
+		result->wakes += waiters[i].wakes;
+		stress_latency_merge(&result->lat, &waiters[i].lat);
+	}
+	if (b->enosys)
+		result->enosys = true;
+	if (b->err && (g_opt_flags & OPT_FLAGS_VERIFY)) {
+		pr_fail("%s: %s futex operation failed, errno=%d (%s)\n",
+			args->name, result->method->name, b->err, strerror(b->err));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_futex_bench()
+ *	measure wake to run latency and wake rate of the futex
+ *	methods over doubling waiter counts up to futex_waiters
+ */
+static int stress_futex_bench(stress_args_t *args, const size_t futex_method, const uint32_t futex_waiters)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	const size_t method_begin = (futex_method == 0) ? 0 : futex_method - 1;
+	const size_t method_end = (futex_method == 0) ? SIZEOF_ARRAY(futex_methods) : futex_method;
+	stress_futex_result_t *results;
+	stress_futex_waiter_t *waiters;
+	stress_futex_bench_t *b;
+	size_t i, n_results = 0, idx = 0, metric = 0;
+	uint32_t n;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	results = (stress_futex_result_t *)calloc(SIZEOF_ARRAY(futex_methods) * 8, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	waiters = (stress_futex_waiter_t *)calloc(futex_waiters, sizeof(*waiters));
+	if (!waiters) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " waiters, skipping stressor\n",
+			args->name, futex_waiters);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	/* a shared mapping so shared futexes are keyed on the mapping */
+	b = (stress_futex_bench_t *)mmap(NULL, sizeof(*b), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (b == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap futex state, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		free(waiters);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = method_begin; i < method_end; i++) {
+		for (n = 1; ; n = STRESS_MINIMUM(n * 2, futex_waiters)) {
+			results[n_results].method = &futex_methods[i];
+			results[n_results].waiters = n;
+			n_results++;
+			if (n == futex_waiters)
+				break;
+		}
+	}
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_futex_result_t *result = &results[idx];
+
+		if (!result->enosys &&
+		    (stress_futex_bench_pass(args, b, waiters, result, slice) != EXIT_SUCCESS))
+			rc = EXIT_FAILURE;
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_inf("%s: %-12s %7s %12s %10s %10s %10s\n", args->name,
+			"method", "waiters", "wakes/sec", "p50 ns", "p99 ns", "p99.9 ns");
+	}
+	for (i = 0; i < n_results; i++) {
+		const stress_futex_result_t *result = &results[i];
+		const double rate = (result->duration > 0.0) ?
+			(double)result->wakes / result->duration : 0.0;
+		char msg[64];
+		size_t j;
+
+		if (args->instance == 0) {
+			if (result->enosys) {
+				pr_inf("%s: %-12s %7" PRIu32 " not supported\n", args->name,
+					result->method->name, result->waiters);
+			} else {
+				pr_inf("%s: %-12s %7" PRIu32 " %12.1f %10.0f %10.0f %10.0f\n",
+					args->name, result->method->name, result->waiters, rate,
+					(double)stress_latency_percentile(&result->lat, 50.0),
+					(double)stress_latency_percentile(&result->lat, 99.0),
+					(double)stress_latency_percentile(&result->lat, 99.9));
+			}
+		}
+		if ((result->wakes == 0) || (metric + 1 + SIZEOF_ARRAY(percentiles) > STRESS_STRESSOR_METRICS_MAX))
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " waiters wakes per sec",
+			result->method->name, result->waiters);
+		stress_metrics_set(args, metric++, msg, rate, STRESS_GEOMETRIC_MEAN);
+		for (j = 0; j < SIZEOF_ARRAY(percentiles); j++) {
+			(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " waiters wake latency p%g (ns)",
+				result->method->name, result->waiters, percentiles[j]);
+			stress_metrics_set(args, metric++, msg,
+				(double)stress_latency_percentile(&result->lat, percentiles[j]),
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+	(void)munmap((void *)b, sizeof(*b));
+	free(waiters);
+	free(results);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_futex_wait()
  *     exercise futex_wait and every 16th time futex_waitv
@@ -97,6 +628,22 @@ static int stress_futex(stress_args_t *args)
 	uint32_t *futex = &g_shared->futex.futex[args->instance];
 	pid_t pid;
 	int parent_cpu;
+	size_t futex_method = 0;
+	uint32_t futex_waiters = DEFAULT_FUTEX_WAITERS;
+
+	(void)stress_get_setting("futex-method", &futex_method);
+	(void)stress_get_setting("futex-waiters", &futex_waiters);
+	if (futex_method > 0) {
+#if defined(STRESS_FUTEX_BENCH)
+		return stress_futex_bench(args, futex_method - 1, futex_waiters);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: futex-method %s requires pthreads and private "
+				"futex support, skipping stressor\n", args->name,
+				futex_method_names[futex_method]);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 again:
@@ -185,6 +732,7 @@ finish:
 stressor_info_t stress_futex_info = {
 	.stressor = stress_futex,
 	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -192,6 +740,7 @@ stressor_info_t stress_futex_info = {
 stressor_info_t stress_futex_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "built without linux/futex.h or futex() system call"
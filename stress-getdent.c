@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 
 #if defined(__NR_getdents)
 #define HAVE_GETDENTS
@@ -27,12 +28,35 @@
 #define HAVE_GETDENTS64
 #endif
 
+#define MIN_GETDENT_ENTRIES		(1000)
+#define MAX_GETDENT_ENTRIES		(1000000)
+
 static const stress_help_t help[] = {
 	{ NULL,	"getdent N",	 "start N workers reading directories using getdents" },
+	{ NULL,	"getdent-entries N", "sweep getdents64 buffer sizes on a directory of N entries" },
 	{ NULL,	"getdent-ops N", "stop after N getdents bogo operations" },
 	{ NULL,	NULL,		 NULL }
 };
 
+/*
+ *  stress_set_getdent_entries()
+ *	set number of directory entries for the buffer size sweep
+ */
+static int stress_set_getdent_entries(const char *opt)
+{
+	uint32_t getdent_entries;
+
+	getdent_entries = stress_get_uint32(opt);
+	stress_check_range("getdent-entries", (uint64_t)getdent_entries,
+		MIN_GETDENT_ENTRIES, MAX_GETDENT_ENTRIES);
+	return stress_set_setting("getdent-entries", TYPE_ID_UINT32, &getdent_entries);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_getdent_entries,	stress_set_getdent_entries },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_GETDENTS64) || defined(HAVE_GETDENTS)
 
 #define BUF_SIZE	(256 * 1024)
@@ -278,6 +302,205 @@ exit_close:
 }
 #endif
 
+#if defined(HAVE_GETDENTS64)
+/* getdents64 buffer sizes swept on the large directory */
+static const size_t getdent_buf_sizes[] = {
+	4 * KB, 16 * KB, 64 * KB, 256 * KB, 1 * MB
+};
+
+typedef struct {
+	double entries;			/* entries read */
+	double duration;		/* time taken */
+} stress_getdent_rate_t;
+
+/*
+ *  stress_getdent_large_filename()
+ *	name of the nth entry in the large directory
+ */
+static inline void stress_getdent_large_filename(
+	char *filename,
+	const size_t filename_len,
+	const char *path,
+	const uint32_t n)
+{
+	(void)snprintf(filename, filename_len, "%s/e%10.10" PRIu32, path, n);
+}
+
+/*
+ *  stress_getdent_large_remove()
+ *	remove the first n entries of the large directory
+ */
+static void stress_getdent_large_remove(const char *path, const uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		char filename[PATH_MAX + 16];
+
+		stress_getdent_large_filename(filename, sizeof(filename), path, i);
+		(void)shim_unlink(filename);
+	}
+}
+
+/*
+ *  stress_getdent_large_getdents64()
+ *	read the whole directory with raw getdents64 calls using
+ *	a buf_sz sized buffer, returns -errno on failure
+ */
+static int stress_getdent_large_getdents64(
+	const char *path,
+	struct shim_linux_dirent64 *buf,
+	const size_t buf_sz,
+	stress_getdent_rate_t *rate)
+{
+	int fd, nread;
+	double t, entries = 0.0;
+
+	fd = open(path, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return -errno;
+
+	t = stress_time_now();
+	while ((nread = shim_getdents64((unsigned int)fd, buf, (unsigned int)buf_sz)) > 0) {
+		struct shim_linux_dirent64 *ptr = buf;
+		const struct shim_linux_dirent64 *end =
+			(struct shim_linux_dirent64 *)stress_gendent_offset((void *)buf, nread);
+
+		while (ptr < end) {
+			entries += 1.0;
+			ptr = (struct shim_linux_dirent64 *)stress_gendent_offset((void *)ptr, ptr->d_reclen);
+		}
+	}
+	rate->duration += stress_time_now() - t;
+	rate->entries += entries;
+	(void)close(fd);
+
+	return (nread < 0) ? -errno : 0;
+}
+
+/*
+ *  stress_getdent_large_readdir()
+ *	read the whole directory with the libc readdir interface
+ */
+static int stress_getdent_large_readdir(const char *path, stress_getdent_rate_t *rate)
+{
+	DIR *dir;
+	double t, entries = 0.0;
+
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+
+	t = stress_time_now();
+	while (readdir(dir) != NULL)
+		entries += 1.0;
+	rate->duration += stress_time_now() - t;
+	rate->entries += entries;
+	(void)closedir(dir);
+
+	return 0;
+}
+
+/*
+ *  stress_getdent_large()
+ *	build a directory of getdent_entries entries on the
+ *	target file system and sweep the getdents64 buffer size,
+ *	comparing the raw system call with readdir
+ */
+static int stress_getdent_large(stress_args_t *args, const uint32_t getdent_entries)
+{
+	stress_getdent_rate_t rates[SIZEOF_ARRAY(getdent_buf_sizes) + 1];
+	const size_t readdir_idx = SIZEOF_ARRAY(getdent_buf_sizes);
+	struct shim_linux_dirent64 *buf;
+	char path[PATH_MAX];
+	uint32_t n;
+	size_t j;
+	int ret, rc = EXIT_SUCCESS;
+	double best_rate = 0.0, readdir_rate;
+
+	buf = (struct shim_linux_dirent64 *)malloc(getdent_buf_sizes[readdir_idx - 1]);
+	if (!buf) {
+		pr_inf_skip("%s: cannot allocate getdents64 buffer, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(buf);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, path, sizeof(path));
+
+	if (args->instance == 0)
+		pr_dbg("%s: creating %" PRIu32 " directory entries\n", args->name, getdent_entries);
+	for (n = 0; (n < getdent_entries) && stress_continue_flag(); n++) {
+		char filename[PATH_MAX + 16];
+		int fd;
+
+		stress_getdent_large_filename(filename, sizeof(filename), path, n);
+		fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			pr_inf_skip("%s: could only create %" PRIu32 " of %" PRIu32
+				" directory entries, errno=%d (%s), skipping stressor\n",
+				args->name, n, getdent_entries, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+		(void)close(fd);
+	}
+	if (n < getdent_entries)
+		goto tidy;
+
+	(void)shim_memset(rates, 0, sizeof(rates));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (j = 0; j < SIZEOF_ARRAY(getdent_buf_sizes); j++) {
+			ret = stress_getdent_large_getdents64(path, buf, getdent_buf_sizes[j], &rates[j]);
+			if (ret < 0) {
+				pr_fail("%s: getdents64 failed, errno=%d (%s)%s\n",
+					args->name, -ret, strerror(-ret), stress_get_fs_type(path));
+				rc = EXIT_FAILURE;
+				break;
+			}
+			stress_bogo_inc(args);
+			if (!stress_continue(args))
+				break;
+		}
+		if (rc != EXIT_SUCCESS)
+			break;
+		if (stress_getdent_large_readdir(path, &rates[readdir_idx]) == 0)
+			stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (j = 0; j < SIZEOF_ARRAY(getdent_buf_sizes); j++) {
+		char str[64];
+		const double rate = (rates[j].duration > 0.0) ?
+			rates[j].entries / rates[j].duration : 0.0;
+
+		if (rate > best_rate)
+			best_rate = rate;
+		(void)snprintf(str, sizeof(str), "getdents64 %zuK buffer entries per sec",
+			(size_t)(getdent_buf_sizes[j] / KB));
+		stress_metrics_set(args, j, str, rate, STRESS_HARMONIC_MEAN);
+	}
+	readdir_rate = (rates[readdir_idx].duration > 0.0) ?
+		rates[readdir_idx].entries / rates[readdir_idx].duration : 0.0;
+	stress_metrics_set(args, readdir_idx, "readdir entries per sec",
+		readdir_rate, STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, readdir_idx + 1, "% readdir overhead vs best getdents64",
+		(readdir_rate > 0.0) ? 100.0 * ((best_rate / readdir_rate) - 1.0) : 0.0,
+		STRESS_GEOMETRIC_MEAN);
+tidy:
+	stress_getdent_large_remove(path, n);
+	(void)stress_temp_dir_rm_args(args);
+	free(buf);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_getdent
  *	stress reading directories
@@ -286,6 +509,18 @@ static int stress_getdent(stress_args_t *args)
 {
 	const int bad_fd = stress_get_bad_fd();
 	double duration = 0.0, count = 0.0, rate;
+	uint32_t getdent_entries = 0;
+
+	if (stress_get_setting("getdent-entries", &getdent_entries)) {
+#if defined(HAVE_GETDENTS64)
+		return stress_getdent_large(args, getdent_entries);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --getdent-entries requires getdents64, skipping stressor\n",
+				args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -322,6 +557,7 @@ stressor_info_t stress_getdent_info = {
 	.stressor = stress_getdent,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
@@ -329,6 +565,7 @@ stressor_info_t stress_getdent_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
 	.verify = VERIFY_ALWAYS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without getdents() or getdents64() support"
 };
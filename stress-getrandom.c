@@ -19,16 +19,49 @@
  */
 #include "stress-ng.h"
 
+#include "core-builtin.h"
+#include "core-pthread.h"
+
 #if defined(HAVE_LINUX_RANDOM_H)
 #include <linux/random.h>
 #endif
 
+#if defined(HAVE_SYS_AUXV_H)
+#include <sys/auxv.h>
+#endif
+
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"getrandom N",	   "start N workers fetching random data via getrandom()" },
 	{ NULL,	"getrandom-ops N", "stop after N getrandom bogo operations" },
+	{ NULL,	"getrandom-sweep", "sweep request sizes over getrandom, /dev/urandom and vDSO getrandom" },
+	{ NULL,	"getrandom-threads N", "use N threads concurrently in the getrandom sweep" },
 	{ NULL, NULL,		   NULL }
 };
 
+static int stress_set_getrandom_sweep(const char *opt)
+{
+	return stress_set_setting_true("getrandom-sweep", opt);
+}
+
+static int stress_set_getrandom_threads(const char *opt)
+{
+	uint32_t getrandom_threads;
+
+	getrandom_threads = stress_get_uint32(opt);
+	stress_check_range("getrandom-threads", (uint64_t)getrandom_threads, 1, 64);
+	return stress_set_setting("getrandom-threads", TYPE_ID_UINT32, &getrandom_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_getrandom_sweep,		stress_set_getrandom_sweep },
+	{ OPT_getrandom_threads,	stress_set_getrandom_threads },
+	{ 0,				NULL }
+};
+
 #if defined(__OpenBSD__) || 	\
     defined(__APPLE__) || 	\
     defined(__FreeBSD__) ||	\
@@ -110,6 +143,493 @@ static const getrandom_flags_t getrandom_flags[] = {
 	GETRANDOM_FLAG_INFO(~0U),
 };
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&	\
+    defined(HAVE_ATOMIC_STORE)
+#define STRESS_GETRANDOM_SWEEP
+#endif
+
+#if defined(STRESS_GETRANDOM_SWEEP)
+
+#if defined(__linux__) &&		\
+    defined(HAVE_SYS_AUXV_H) &&		\
+    defined(HAVE_LINK_H) &&		\
+    defined(HAVE_GETAUXVAL) &&		\
+    defined(AT_SYSINFO_EHDR)
+#define STRESS_GETRANDOM_VDSO
+#endif
+
+#define GETRANDOM_SWEEP_DURATION	(0.1)	/* secs per sweep point per pass */
+#define GETRANDOM_SWEEP_BUF_SIZE	(1 * MB)
+
+typedef ssize_t (*stress_getrandom_vdso_func_t)(void *buf, size_t len,
+	unsigned int flags, void *opaque_state, size_t opaque_len);
+
+/*
+ *  getrandom vDSO opaque state parameters, see linux/random.h
+ */
+typedef struct {
+	uint32_t size_of_opaque_state;
+	uint32_t mmap_prot;
+	uint32_t mmap_flags;
+	uint32_t reserved[13];
+} stress_getrandom_vdso_params_t;
+
+struct stress_getrandom_sweep_thread;
+
+/* a source of random data in the sweep */
+typedef struct {
+	const char *name;
+	ssize_t (*fill)(struct stress_getrandom_sweep_thread *t, const size_t len);
+	bool supported;
+} stress_getrandom_sweep_method_t;
+
+/* a sweep point and its accumulated results */
+typedef struct {
+	size_t method;
+	size_t size;
+	double bytes;			/* bytes returned by all threads */
+	double calls;			/* calls by all threads */
+	double duration;		/* wall clock time of the passes */
+	double call_duration;		/* sum of the thread run times */
+} stress_getrandom_sweep_result_t;
+
+typedef struct stress_getrandom_sweep_thread {
+	pthread_t pthread;
+	const stress_getrandom_sweep_method_t *method;
+	size_t size;			/* bytes per call */
+	uint8_t *buf;			/* per thread buffer */
+	int fd;				/* /dev/urandom, -1 if not open */
+	void *vdso_state;		/* per thread vDSO getrandom state */
+	size_t vdso_mmap_size;		/* size of vdso_state mapping */
+	const bool *start;
+	const bool *stop;
+	double bytes;
+	double calls;
+	double duration;
+	int err;			/* errno of a failed call, 0 if ok */
+	int ret;			/* pthread_create return */
+} stress_getrandom_sweep_thread_t;
+
+static const size_t stress_getrandom_sweep_sizes[] = {
+	1, 16, 64, 256, 4 * KB, 64 * KB, 1 * MB,
+};
+
+static stress_getrandom_vdso_func_t getrandom_vdso;
+static stress_getrandom_vdso_params_t getrandom_vdso_params;
+
+/*
+ *  stress_getrandom_sweep_syscall()
+ *	call the getrandom system call directly, bypassing any
+ *	libc vDSO acceleration
+ */
+static ssize_t stress_getrandom_sweep_syscall(void *buf, const size_t len, const unsigned int flags)
+{
+#if defined(HAVE_SYSCALL) &&	\
+    defined(__NR_getrandom)
+	return (ssize_t)syscall(__NR_getrandom, buf, len, flags);
+#else
+	return (ssize_t)shim_getrandom(buf, len, flags);
+#endif
+}
+
+static ssize_t stress_getrandom_sweep_default(stress_getrandom_sweep_thread_t *t, const size_t len)
+{
+	return stress_getrandom_sweep_syscall(t->buf, len, 0);
+}
+
+#if defined(GRND_NONBLOCK)
+static ssize_t stress_getrandom_sweep_nonblock(stress_getrandom_sweep_thread_t *t, const size_t len)
+{
+	return stress_getrandom_sweep_syscall(t->buf, len, GRND_NONBLOCK);
+}
+#endif
+
+#if defined(GRND_INSECURE)
+static ssize_t stress_getrandom_sweep_insecure(stress_getrandom_sweep_thread_t *t, const size_t len)
+{
+	return stress_getrandom_sweep_syscall(t->buf, len, GRND_INSECURE);
+}
+#endif
+
+static ssize_t stress_getrandom_sweep_libc(stress_getrandom_sweep_thread_t *t, const size_t len)
+{
+	return (ssize_t)shim_getrandom(t->buf, len, 0);
+}
+
+static ssize_t stress_getrandom_sweep_urandom(stress_getrandom_sweep_thread_t *t, const size_t len)
+{
+	return read(t->fd, t->buf, len);
+}
+
+#if defined(STRESS_GETRANDOM_VDSO)
+static ssize_t stress_getrandom_sweep_vdso(stress_getrandom_sweep_thread_t *t, const size_t len)
+{
+	return getrandom_vdso(t->buf, len, 0, t->vdso_state,
+			      getrandom_vdso_params.size_of_opaque_state);
+}
+
+/*
+ *  stress_getrandom_vdso_find()
+ *	find the vDSO getrandom function in the vDSO dynamic
+ *	symbol table, NULL if the kernel does not provide it
+ */
+static stress_getrandom_vdso_func_t stress_getrandom_vdso_find(void)
+{
+	const ElfW(Ehdr) *ehdr = (const ElfW(Ehdr) *)getauxval(AT_SYSINFO_EHDR);
+	const ElfW(Phdr) *phdr;
+	const ElfW(Dyn) *dyn = NULL;
+	const ElfW(Sym) *symtab = NULL;
+	const ElfW(Word) *hash = NULL;
+	const char *strtab = NULL;
+	uintptr_t load_offset = 0;
+	bool loaded = false;
+	ElfW(Word) i;
+
+	if (!ehdr)
+		return NULL;
+	phdr = (const ElfW(Phdr) *)((uintptr_t)ehdr + ehdr->e_phoff);
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if ((phdr[i].p_type == PT_LOAD) && !loaded) {
+			load_offset = (uintptr_t)ehdr + (uintptr_t)phdr[i].p_offset -
+				      (uintptr_t)phdr[i].p_vaddr;
+			loaded = true;
+		} else if (phdr[i].p_type == PT_DYNAMIC) {
+			dyn = (const ElfW(Dyn) *)((uintptr_t)ehdr + (uintptr_t)phdr[i].p_offset);
+		}
+	}
+	if (!loaded || !dyn)
+		return NULL;
+
+	for (; dyn->d_tag != DT_NULL; dyn++) {
+		switch (dyn->d_tag) {
+		case DT_HASH:
+			hash = (const ElfW(Word) *)(dyn->d_un.d_ptr + load_offset);
+			break;
+		case DT_STRTAB:
+			strtab = (const char *)(dyn->d_un.d_ptr + load_offset);
+			break;
+		case DT_SYMTAB:
+			symtab = (const ElfW(Sym) *)(dyn->d_un.d_ptr + load_offset);
+			break;
+		default:
+			break;
+		}
+	}
+	if (!hash || !strtab || !symtab)
+		return NULL;
+
+	/* the hash table nchain is the number of symbols */
+	for (i = 0; i < hash[1]; i++) {
+		const ElfW(Sym) *sym = &symtab[i];
+		const char *name = strtab + sym->st_name;
+		stress_getrandom_vdso_func_t func;
+
+		if ((ELF64_ST_TYPE(sym->st_info) != STT_FUNC) ||
+		    (sym->st_shndx == SHN_UNDEF))
+			continue;
+		if (strcmp(name, "__vdso_getrandom") && strcmp(name, "__kernel_getrandom"))
+			continue;
+		*(void **)(&func) = (void *)(load_offset + (uintptr_t)sym->st_value);
+		return func;
+	}
+	return NULL;
+}
+#endif
+
+static stress_getrandom_sweep_method_t stress_getrandom_sweep_methods[] = {
+	{ "syscall",	stress_getrandom_sweep_default,		false },
+#if defined(GRND_NONBLOCK)
+	{ "nonblock",	stress_getrandom_sweep_nonblock,	false },
+#endif
+#if defined(GRND_INSECURE)
+	{ "insecure",	stress_getrandom_sweep_insecure,	false },
+#endif
+	{ "libc",	stress_getrandom_sweep_libc,		false },
+	{ "urandom",	stress_getrandom_sweep_urandom,		false },
+#if defined(STRESS_GETRANDOM_VDSO)
+	{ "vdso",	stress_getrandom_sweep_vdso,		false },
+#endif
+};
+
+/*
+ *  stress_getrandom_sweep_thread()
+ *	fetch size bytes of random data per call until stopped
+ */
+static void *stress_getrandom_sweep_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_getrandom_sweep_thread_t *t = (stress_getrandom_sweep_thread_t *)arg;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY) && (t->size >= 16);
+	double t_start;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!__atomic_load_n(t->start, __ATOMIC_ACQUIRE))
+		(void)shim_sched_yield();
+
+	t_start = stress_time_now();
+	while (!__atomic_load_n(t->stop, __ATOMIC_RELAXED)) {
+		ssize_t ret;
+
+		if (verify)
+			(void)shim_memset(t->buf, 0, 16);
+		ret = t->method->fill(t, t->size);
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			t->err = errno;
+			break;
+		}
+		t->bytes += (double)ret;
+		t->calls += 1.0;
+		/* 16 zero bytes of random data is vanishingly unlikely */
+		if (verify && (ret >= 16)) {
+			uint8_t bits = 0;
+			int i;
+
+			for (i = 0; i < 16; i++)
+				bits |= t->buf[i];
+			if (!bits) {
+				t->err = EIO;
+				break;
+			}
+		}
+	}
+	t->duration = stress_time_now() - t_start;
+
+	return &nowt;
+}
+
+/*
+ *  stress_getrandom_sweep_pass()
+ *	run n_threads threads fetching random data with the method
+ *	and size of the sweep point for the sweep duration
+ */
+static int stress_getrandom_sweep_pass(
+	stress_args_t *args,
+	stress_getrandom_sweep_thread_t *threads,
+	const uint32_t n_threads,
+	stress_getrandom_sweep_result_t *result)
+{
+	const stress_getrandom_sweep_method_t *method = &stress_getrandom_sweep_methods[result->method];
+	bool start = false, stop = false;
+	uint32_t i, n_created = 0;
+	double t_start, duration;
+	int rc = 0;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_getrandom_sweep_thread_t *t = &threads[i];
+
+		t->method = method;
+		t->size = result->size;
+		t->start = &start;
+		t->stop = &stop;
+		t->bytes = 0.0;
+		t->calls = 0.0;
+		t->duration = 0.0;
+		t->err = 0;
+		t->ret = pthread_create(&t->pthread, NULL, stress_getrandom_sweep_thread, t);
+		if (t->ret)
+			break;
+		n_created++;
+	}
+	if (n_created == 0)
+		return 0;
+
+	t_start = stress_time_now();
+	__atomic_store_n(&start, true, __ATOMIC_RELEASE);
+	while (stress_continue_flag() && ((stress_time_now() - t_start) < GETRANDOM_SWEEP_DURATION))
+		(void)shim_usleep(10000);
+	__atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < n_created; i++) {
+		const stress_getrandom_sweep_thread_t *t = &threads[i];
+
+		(void)pthread_join(t->pthread, NULL);
+		result->bytes += t->bytes;
+		result->calls += t->calls;
+		result->call_duration += t->duration;
+		if (t->err == EIO) {
+			pr_fail("%s: %s returned %zu bytes of zeros\n",
+				args->name, method->name, result->size);
+			rc = -1;
+		} else if (t->err) {
+			pr_fail("%s: %s of %zu bytes failed, errno=%d (%s)\n",
+				args->name, method->name, result->size,
+				t->err, strerror(t->err));
+			rc = -1;
+		}
+	}
+	duration = stress_time_now() - t_start;
+	result->duration += duration;
+	return rc;
+}
+
+/*
+ *  stress_getrandom_sweep()
+ *	measure the throughput and per call cost of getrandom with
+ *	different flags, /dev/urandom reads and the vDSO getrandom
+ *	over request sizes of 1 byte to 1MB with n_threads threads
+ */
+static int stress_getrandom_sweep(stress_args_t *args, const uint32_t n_threads)
+{
+	stress_getrandom_sweep_thread_t *threads;
+	stress_getrandom_sweep_result_t results[SIZEOF_ARRAY(stress_getrandom_sweep_methods) *
+						SIZEOF_ARRAY(stress_getrandom_sweep_sizes)];
+	const size_t page_size = args->page_size;
+	size_t i, j, n_results = 0, idx = 0, metric = 0;
+	uint32_t n;
+	int rc = EXIT_SUCCESS;
+	uint8_t probe[16];
+
+	threads = (stress_getrandom_sweep_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " sweep threads, skipping stressor\n",
+			args->name, n_threads);
+		return EXIT_NO_RESOURCE;
+	}
+
+#if defined(STRESS_GETRANDOM_VDSO)
+	/* a zero length request with ~0 opaque_len fetches the state parameters */
+	getrandom_vdso = stress_getrandom_vdso_find();
+	(void)shim_memset(&getrandom_vdso_params, 0, sizeof(getrandom_vdso_params));
+	if (getrandom_vdso &&
+	    ((getrandom_vdso(NULL, 0, 0, &getrandom_vdso_params, ~0UL) != 0) ||
+	     (getrandom_vdso_params.size_of_opaque_state == 0)))
+		getrandom_vdso = NULL;
+#endif
+	for (n = 0; n < n_threads; n++) {
+		stress_getrandom_sweep_thread_t *t = &threads[n];
+
+		t->fd = -1;
+		t->buf = (uint8_t *)stress_mmap_populate(NULL, GETRANDOM_SWEEP_BUF_SIZE,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (t->buf == MAP_FAILED) {
+			t->buf = NULL;
+			pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+				args->name, (size_t)GETRANDOM_SWEEP_BUF_SIZE, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto free_threads;
+		}
+		t->fd = open("/dev/urandom", O_RDONLY);
+#if defined(STRESS_GETRANDOM_VDSO)
+		if (getrandom_vdso) {
+			t->vdso_mmap_size = (getrandom_vdso_params.size_of_opaque_state + page_size - 1) &
+					    ~(page_size - 1);
+			t->vdso_state = mmap(NULL, t->vdso_mmap_size, (int)getrandom_vdso_params.mmap_prot,
+					     (int)getrandom_vdso_params.mmap_flags, -1, 0);
+			if (t->vdso_state == MAP_FAILED) {
+				t->vdso_state = NULL;
+				getrandom_vdso = NULL;
+			}
+		}
+#else
+		(void)page_size;
+#endif
+	}
+
+	/* probe which methods work on this system */
+	for (i = 0; i < SIZEOF_ARRAY(stress_getrandom_sweep_methods); i++) {
+		stress_getrandom_sweep_method_t *method = &stress_getrandom_sweep_methods[i];
+		stress_getrandom_sweep_thread_t *t = &threads[0];
+
+#if defined(STRESS_GETRANDOM_VDSO)
+		if ((method->fill == stress_getrandom_sweep_vdso) && !getrandom_vdso)
+			continue;
+#endif
+		if ((method->fill == stress_getrandom_sweep_urandom) && (t->fd < 0))
+			continue;
+		method->supported = (method->fill(t, sizeof(probe)) > 0);
+		if (!method->supported) {
+			if (args->instance == 0)
+				pr_inf("%s: %s not supported, skipping it\n", args->name, method->name);
+			continue;
+		}
+		for (j = 0; j < SIZEOF_ARRAY(stress_getrandom_sweep_sizes); j++) {
+			results[n_results].method = i;
+			results[n_results].size = stress_getrandom_sweep_sizes[j];
+			results[n_results].bytes = 0.0;
+			results[n_results].calls = 0.0;
+			results[n_results].duration = 0.0;
+			results[n_results].call_duration = 0.0;
+			n_results++;
+		}
+	}
+#if defined(STRESS_GETRANDOM_VDSO)
+	if (!getrandom_vdso && (args->instance == 0))
+		pr_inf("%s: vDSO getrandom not available, skipping it\n", args->name);
+#endif
+	if (n_results == 0) {
+		pr_inf_skip("%s: no getrandom methods available, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_threads;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		if (stress_getrandom_sweep_pass(args, threads, n_threads, &results[idx]) < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %8s %8s %12s %12s\n", args->name,
+			"method", "size", "threads", "MB/sec", "ns/call");
+	for (i = 0; i < n_results; i++) {
+		const stress_getrandom_sweep_result_t *result = &results[i];
+		const char *name = stress_getrandom_sweep_methods[result->method].name;
+		char size_str[32], str[64];
+		double mb_rate, ns_per_call;
+
+		if ((result->duration <= 0.0) || (result->calls <= 0.0))
+			continue;
+		if (result->size < KB)
+			(void)snprintf(size_str, sizeof(size_str), "%zuB", result->size);
+		else
+			(void)stress_uint64_to_str(size_str, sizeof(size_str), (uint64_t)result->size);
+		mb_rate = (result->bytes / (double)MB) / result->duration;
+		ns_per_call = STRESS_DBL_NANOSECOND * result->call_duration / result->calls;
+		if (args->instance == 0)
+			pr_inf("%s: %-9s %8s %8" PRIu32 " %12.2f %12.1f\n", args->name,
+				name, size_str, n_threads, mb_rate, ns_per_call);
+
+		/* small request cost and large request throughput of each method */
+		if (metric + 1 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		if (result->size == 16) {
+			(void)snprintf(str, sizeof(str), "%s %s nanosecs per call", name, size_str);
+			stress_metrics_set(args, metric++, str, ns_per_call, STRESS_HARMONIC_MEAN);
+		} else if (result->size == 1 * MB) {
+			(void)snprintf(str, sizeof(str), "%s %s MB per sec", name, size_str);
+			stress_metrics_set(args, metric++, str, mb_rate, STRESS_HARMONIC_MEAN);
+		}
+	}
+
+free_threads:
+	for (n = 0; n < n_threads; n++) {
+		stress_getrandom_sweep_thread_t *t = &threads[n];
+
+		if (t->vdso_state)
+			(void)munmap(t->vdso_state, t->vdso_mmap_size);
+		if (t->fd >= 0)
+			(void)close(t->fd);
+		if (t->buf)
+			(void)munmap((void *)t->buf, GETRANDOM_SWEEP_BUF_SIZE);
+	}
+	free(threads);
+	return rc;
+}
+#endif
+
 /*
  *  stress_getrandom
  *	stress reading random values using getrandom()
@@ -117,6 +637,20 @@ static const getrandom_flags_t getrandom_flags[] = {
 static int stress_getrandom(stress_args_t *args)
 {
 	double duration = 0.0, bytes = 0.0, rate;
+	bool getrandom_sweep = false;
+	uint32_t getrandom_threads = 1;
+
+	(void)stress_get_setting("getrandom-sweep", &getrandom_sweep);
+	(void)stress_get_setting("getrandom-threads", &getrandom_threads);
+	if (getrandom_sweep) {
+#if defined(STRESS_GETRANDOM_SWEEP)
+		return stress_getrandom_sweep(args, getrandom_threads);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --getrandom-sweep requires pthread and atomic "
+				"support, using the default getrandom calls\n", args->name);
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -179,6 +713,7 @@ stressor_info_t stress_getrandom_info = {
 	.stressor = stress_getrandom,
 	.supported = stress_getrandom_supported,
 	.class = CLASS_OS | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -186,6 +721,7 @@ stressor_info_t stress_getrandom_info = {
 stressor_info_t stress_getrandom_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_OS | CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without getrandom() support"
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 #include "core-pthread.h"
 
@@ -30,6 +31,9 @@
 #if defined(HAVE_GLES2_H)
 #include <GLES2/gl2.h>
 #endif
+#if defined(HAVE_GLES31_H)
+#include <GLES3/gl31.h>
+#endif
 
 #if defined(HAVE_GBM_H)
 #include <gbm.h>
@@ -39,6 +43,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"gpu N",		"start N GPU worker" },
 	{ NULL,	"gpu-devnode name",	"specify CPU device node name" },
 	{ NULL,	"gpu-frag N",		"specify shader core usage per pixel" },
+	{ NULL,	"gpu-mode M",		"specify mode: render, bandwidth or compute" },
 	{ NULL,	"gpu-ops N",		"stop after N gpu render bogo operations" },
 	{ NULL,	"gpu-tex-size N",	"specify upload texture NxN" },
 	{ NULL,	"gpu-upload N",		"specify upload texture N times per frame" },
@@ -47,6 +52,21 @@ static const stress_help_t help[] = {
 	{ NULL,	NULL,			NULL }
 };
 
+#define STRESS_GPU_MODE_RENDER		(0)	/* draw frames */
+#define STRESS_GPU_MODE_BANDWIDTH	(1)	/* texture and buffer transfers */
+#define STRESS_GPU_MODE_COMPUTE		(2)	/* compute shader FLOPs */
+
+typedef struct {
+	const char *name;	/* gpu-mode option name */
+	const int mode;		/* STRESS_GPU_MODE_* */
+} stress_gpu_mode_t;
+
+static const stress_gpu_mode_t gpu_modes[] = {
+	{ "render",	STRESS_GPU_MODE_RENDER },
+	{ "bandwidth",	STRESS_GPU_MODE_BANDWIDTH },
+	{ "compute",	STRESS_GPU_MODE_COMPUTE },
+};
+
 static int stress_set_gpu_devnode(const char *opt)
 {
 	return stress_set_setting("gpu-devnode", TYPE_ID_STR, opt);
@@ -97,9 +117,27 @@ static int stress_set_gpu_size(const char *opt)
 	return stress_set_gpu_gl(opt, "gpu-tex-size", INT_MAX);
 }
 
+static int stress_set_gpu_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(gpu_modes); i++) {
+		if (!strcmp(gpu_modes[i].name, opt))
+			return stress_set_setting("gpu-mode", TYPE_ID_INT, &gpu_modes[i].mode);
+	}
+
+	(void)fprintf(stderr, "gpu-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(gpu_modes); i++)
+		(void)fprintf(stderr, " %s", gpu_modes[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_gpu_devnode,	stress_set_gpu_devnode },
 	{ OPT_gpu_frag,		stress_set_gpu_frag },
+	{ OPT_gpu_mode,		stress_set_gpu_mode },
 	{ OPT_gpu_uploads,	stress_set_gpu_upload },
 	{ OPT_gpu_size,		stress_set_gpu_size },
 	{ OPT_gpu_xsize,	stress_set_gpu_xsize },
@@ -414,18 +452,15 @@ static int egl_init(
 	stress_args_t *args,
 	const char *gpu_devnode,
 	const uint32_t size_x,
-	const uint32_t size_y)
+	const uint32_t size_y,
+	const EGLint client_version)
 {
 	int ret, fd;
 	EGLConfig config;
-	EGLContext context;
+	EGLContext context = EGL_NO_CONTEXT;
 	EGLint majorVersion;
 	EGLint minorVersion;
-
-	static const EGLint contextAttribs[] = {
-		EGL_CONTEXT_CLIENT_VERSION, 2,
-		EGL_NONE
-	};
+	EGLint version;
 
 	fd = open(gpu_devnode, O_RDWR);
 	if (fd < 0) {
@@ -474,7 +509,15 @@ static int egl_init(
 		return EXIT_NO_RESOURCE;
 	}
 
-	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	/* try the requested client version, fall back to GLES 2 */
+	for (version = client_version; (context == EGL_NO_CONTEXT) && (version >= 2); version--) {
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_CLIENT_VERSION, version,
+			EGL_NONE
+		};
+
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	}
 	if (context == EGL_NO_CONTEXT) {
 		pr_inf("%s: EGL: Failed to create context\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -487,6 +530,404 @@ static int egl_init(
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_gpu_gl_version()
+ *	get the GLES context major.minor version, GLES 2 contexts
+ *	do not support the GL_MAJOR_VERSION query
+ */
+static void stress_gpu_gl_version(GLint *major, GLint *minor)
+{
+	*major = 2;
+	*minor = 0;
+#if defined(HAVE_GLES31_H)
+	glGetIntegerv(GL_MAJOR_VERSION, major);
+	glGetIntegerv(GL_MINOR_VERSION, minor);
+	if (glGetError() != GL_NO_ERROR) {
+		*major = 2;
+		*minor = 0;
+	}
+#endif
+}
+
+#define STRESS_GPU_BW_TEX_UPLOAD	(0)
+#define STRESS_GPU_BW_TEX_READBACK	(1)
+#define STRESS_GPU_BW_BUF_UPLOAD	(2)
+#define STRESS_GPU_BW_BUF_READBACK	(3)
+#define STRESS_GPU_BW_MAX		(4)
+
+typedef struct {
+	const GLsizei size;	/* texture size x size RGBA8 */
+	const char *label;	/* transfer size in bytes */
+} stress_gpu_bw_size_t;
+
+typedef struct {
+	double bytes;		/* total bytes transferred */
+	double duration;	/* total transfer time, seconds */
+} stress_gpu_bw_t;
+
+static const stress_gpu_bw_size_t gpu_bw_sizes[] = {
+	{ 128,	"64K" },
+	{ 512,	"1M" },
+	{ 2048,	"16M" },
+};
+
+static const char * const gpu_bw_transfers[STRESS_GPU_BW_MAX] = {
+	"texture upload",
+	"texture readback",
+	"buffer upload",
+	"buffer readback",
+};
+
+/*
+ *  stress_gpu_bw_transfer()
+ *	perform one type of transfer for slice seconds, accumulating
+ *	the bytes transferred and the time taken, returns false on
+ *	a GL error
+ */
+static bool stress_gpu_bw_transfer(
+	stress_args_t *args,
+	const int transfer,
+	const GLsizei size,
+	const double slice,
+	stress_gpu_bw_t *bw)
+{
+	const size_t bytes = (size_t)size * (size_t)size * 4;
+	const double t_end = stress_time_now() + slice;
+	double t;
+
+	do {
+		const double t_start = stress_time_now();
+#if defined(HAVE_GLES31_H)
+		void *ptr;
+#endif
+
+		switch (transfer) {
+		case STRESS_GPU_BW_TEX_UPLOAD:
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size,
+					GL_RGBA, GL_UNSIGNED_BYTE, teximage);
+			glFinish();
+			break;
+		case STRESS_GPU_BW_TEX_READBACK:
+			glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, teximage);
+			break;
+		case STRESS_GPU_BW_BUF_UPLOAD:
+			glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, teximage);
+			glFinish();
+			break;
+#if defined(HAVE_GLES31_H)
+		case STRESS_GPU_BW_BUF_READBACK:
+			ptr = glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+			if (!ptr)
+				return false;
+			(void)memcpy(teximage, ptr, bytes);
+			(void)glUnmapBuffer(GL_ARRAY_BUFFER);
+			break;
+#endif
+		default:
+			return false;
+		}
+		t = stress_time_now();
+		if (glGetError() != GL_NO_ERROR)
+			return false;
+		bw->bytes += (double)bytes;
+		bw->duration += t - t_start;
+		stress_bogo_inc(args);
+	} while ((t < t_end) && !stress_sigalrm_pending() && stress_continue(args));
+
+	return true;
+}
+
+/*
+ *  stress_gpu_bandwidth()
+ *	measure texture and buffer upload and readback bandwidth
+ *	for a range of transfer sizes, round robin over each transfer
+ *	and size until the run ends
+ */
+static int stress_gpu_bandwidth(stress_args_t *args)
+{
+	stress_gpu_bw_t bw[STRESS_GPU_BW_MAX][SIZEOF_ARRAY(gpu_bw_sizes)];
+	GLuint tex[SIZEOF_ARRAY(gpu_bw_sizes)], buf[SIZEOF_ARRAY(gpu_bw_sizes)];
+	GLuint fbo[SIZEOF_ARRAY(gpu_bw_sizes)];
+	GLint maxsize, major, minor;
+	size_t i, n_sizes;
+	int j, n_transfers, metric = 1, ret = EXIT_SUCCESS;
+	const GLsizei max_size = gpu_bw_sizes[SIZEOF_ARRAY(gpu_bw_sizes) - 1].size;
+
+	(void)memset(bw, 0, sizeof(bw));
+
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxsize);
+	for (n_sizes = 0; n_sizes < SIZEOF_ARRAY(gpu_bw_sizes); n_sizes++) {
+		if (gpu_bw_sizes[n_sizes].size > maxsize)
+			break;
+	}
+	if (n_sizes == 0) {
+		pr_inf_skip("%s: maximum texture size %d too small, skipping stressor\n",
+			args->name, (int)maxsize);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* buffer readback needs glMapBufferRange, GLES 3.0 or later */
+	stress_gpu_gl_version(&major, &minor);
+	n_transfers = (major >= 3) ? STRESS_GPU_BW_MAX : STRESS_GPU_BW_BUF_READBACK;
+
+	teximage = calloc((size_t)max_size * (size_t)max_size, 4);
+	if (!teximage) {
+		pr_inf_skip("%s: failed to allocate transfer buffer, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	glGenTextures((GLsizei)n_sizes, tex);
+	glGenFramebuffers((GLsizei)n_sizes, fbo);
+	glGenBuffers((GLsizei)n_sizes, buf);
+	for (i = 0; i < n_sizes; i++) {
+		const GLsizei size = gpu_bw_sizes[i].size;
+
+		glBindTexture(GL_TEXTURE_2D, tex[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0,
+			     GL_RGBA, GL_UNSIGNED_BYTE, teximage);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+				       GL_TEXTURE_2D, tex[i], 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			pr_inf_skip("%s: %dx%d texture framebuffer incomplete, skipping stressor\n",
+				args->name, (int)size, (int)size);
+			ret = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, buf[i]);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size * size * 4, teximage, GL_DYNAMIC_DRAW);
+	}
+	if (glGetError() != GL_NO_ERROR) {
+		pr_inf_skip("%s: failed to create transfer textures and buffers, skipping stressor\n",
+			args->name);
+		ret = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	do {
+		const double t_left = args->time_end - stress_time_now();
+		double slice = t_left / (double)((size_t)n_transfers * n_sizes);
+
+		slice = STRESS_MINIMUM(slice, 0.5);
+		slice = STRESS_MAXIMUM(slice, 0.01);
+
+		for (j = 0; j < n_transfers; j++) {
+			for (i = 0; i < n_sizes; i++) {
+				glBindTexture(GL_TEXTURE_2D, tex[i]);
+				glBindFramebuffer(GL_FRAMEBUFFER, fbo[i]);
+				glBindBuffer(GL_ARRAY_BUFFER, buf[i]);
+				if (!stress_gpu_bw_transfer(args, j, gpu_bw_sizes[i].size, slice, &bw[j][i])) {
+					pr_fail("%s: %s of %s failed, GL error\n", args->name,
+						gpu_bw_transfers[j], gpu_bw_sizes[i].label);
+					ret = EXIT_FAILURE;
+					goto tidy;
+				}
+				if (stress_sigalrm_pending() || !stress_continue(args))
+					goto report;
+			}
+		}
+	} while (!stress_sigalrm_pending() && stress_continue(args));
+
+report:
+	if (args->instance == 0) {
+		char line[128];
+		size_t len;
+
+		pr_block_begin();
+		len = (size_t)snprintf(line, sizeof(line), "%-16s", "GB/sec");
+		for (i = 0; (i < n_sizes) && (len < sizeof(line)); i++)
+			len += (size_t)snprintf(line + len, sizeof(line) - len, " %9s", gpu_bw_sizes[i].label);
+		pr_inf("%s: %s\n", args->name, line);
+		for (j = 0; j < n_transfers; j++) {
+			len = (size_t)snprintf(line, sizeof(line), "%-16s", gpu_bw_transfers[j]);
+			for (i = 0; (i < n_sizes) && (len < sizeof(line)); i++) {
+				const double rate = (bw[j][i].duration > 0.0) ?
+					bw[j][i].bytes / (bw[j][i].duration * 1.0E9) : 0.0;
+
+				len += (size_t)snprintf(line + len, sizeof(line) - len, " %9.3f", rate);
+			}
+			pr_inf("%s: %s\n", args->name, line);
+		}
+		pr_block_end();
+	}
+	for (j = 0; j < n_transfers; j++) {
+		for (i = 0; i < n_sizes; i++) {
+			char str[64];
+
+			if (bw[j][i].duration <= 0.0)
+				continue;
+			(void)snprintf(str, sizeof(str), "GB/sec %s %s",
+				gpu_bw_transfers[j], gpu_bw_sizes[i].label);
+			stress_metrics_set(args, metric++, str,
+				bw[j][i].bytes / (bw[j][i].duration * 1.0E9),
+				STRESS_HARMONIC_MEAN);
+		}
+	}
+
+tidy:
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers((GLsizei)n_sizes, buf);
+	glDeleteFramebuffers((GLsizei)n_sizes, fbo);
+	glDeleteTextures((GLsizei)n_sizes, tex);
+
+	return ret;
+}
+
+#if defined(HAVE_GLES31_H)
+#define STRESS_GPU_COMPUTE_LOCAL	(64)	/* local_size_x of compute shader */
+#define STRESS_GPU_COMPUTE_GROUPS	(1024)	/* work groups per dispatch */
+#define STRESS_GPU_COMPUTE_FLOPS	(64)	/* FLOPs per shader loop iteration */
+#define STRESS_GPU_COMPUTE_ITERS_MAX	(4096)
+#define STRESS_GPU_COMPUTE_DISPATCH	(0.01)	/* target dispatch time, seconds */
+
+/*
+ *  compute shader, 4 independent chains of 2 vec4 multiply-adds
+ *  per iteration, 8 x 4 x 2 = 64 FLOPs per iteration
+ */
+static const char compute_shader[] =
+    "#version 310 es\n"
+    "layout(local_size_x = 64) in;\n"
+    "layout(std430, binding = 0) buffer out_buf { vec4 data[]; };\n"
+    "uniform int iters;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint id = gl_GlobalInvocationID.x;\n"
+    "    vec4 a0 = vec4(float(id) * 0.000001);\n"
+    "    vec4 a1 = a0 + 0.1;\n"
+    "    vec4 a2 = a0 + 0.2;\n"
+    "    vec4 a3 = a0 + 0.3;\n"
+    "    vec4 m = vec4(0.999999);\n"
+    "    vec4 c = vec4(0.000001);\n"
+    "    for (int i = 0; i < iters; i++) {\n"
+    "        a0 = a0 * m + c;\n"
+    "        a1 = a1 * m + c;\n"
+    "        a2 = a2 * m + c;\n"
+    "        a3 = a3 * m + c;\n"
+    "        a0 = a0 * m + c;\n"
+    "        a1 = a1 * m + c;\n"
+    "        a2 = a2 * m + c;\n"
+    "        a3 = a3 * m + c;\n"
+    "    }\n"
+    "    data[id] = a0 + a1 + a2 + a3;\n"
+    "}\n";
+
+/*
+ *  stress_gpu_compute_dispatch()
+ *	run the compute shader once and wait for it to complete,
+ *	returns the dispatch time in seconds, < 0 on a GL error
+ */
+static double stress_gpu_compute_dispatch(void)
+{
+	const double t = stress_time_now();
+
+	glDispatchCompute(STRESS_GPU_COMPUTE_GROUPS, 1, 1);
+	glFinish();
+	if (glGetError() != GL_NO_ERROR)
+		return -1.0;
+	return stress_time_now() - t;
+}
+
+/*
+ *  stress_gpu_compute()
+ *	measure compute shader GFLOP/sec, needs a GLES 3.1 context
+ */
+static int stress_gpu_compute(stress_args_t *args)
+{
+	GLint major, minor, linked, uiters, iters;
+	GLuint shader, compute, ssbo = 0;
+	double flops = 0.0, duration = 0.0, t;
+	int ret = EXIT_SUCCESS;
+
+	stress_gpu_gl_version(&major, &minor);
+	if ((major < 3) || ((major == 3) && (minor < 1))) {
+		pr_inf_skip("%s: compute mode needs GLES 3.1, got GLES %d.%d, skipping stressor\n",
+			args->name, (int)major, (int)minor);
+		return EXIT_NO_RESOURCE;
+	}
+
+	shader = compile_shader(args, compute_shader, sizeof(compute_shader),
+				GL_COMPUTE_SHADER);
+	if (shader == 0) {
+		pr_inf_skip("%s: failed to compile compute shader, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	compute = glCreateProgram();
+	if (compute == 0) {
+		pr_inf("%s: failed to create the compute shader program\n", args->name);
+		glDeleteShader(shader);
+		return EXIT_NO_RESOURCE;
+	}
+	glAttachShader(compute, shader);
+	glLinkProgram(compute);
+	glGetProgramiv(compute, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		pr_fail("%s: failed to link compute shader program\n", args->name);
+		ret = EXIT_FAILURE;
+		goto tidy;
+	}
+	glUseProgram(compute);
+
+	glGenBuffers(1, &ssbo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,
+		     STRESS_GPU_COMPUTE_GROUPS * STRESS_GPU_COMPUTE_LOCAL * 4 * sizeof(GLfloat),
+		     NULL, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo);
+	uiters = glGetUniformLocation(compute, "iters");
+
+	/*
+	 *  scale loop iterations so that a dispatch takes ~10ms, long
+	 *  enough to amortize dispatch overhead yet short enough to
+	 *  stop promptly at the end of the run
+	 */
+	for (iters = 16; iters < STRESS_GPU_COMPUTE_ITERS_MAX; iters *= 2) {
+		glUniform1i(uiters, iters);
+		t = stress_gpu_compute_dispatch();
+		if (t < 0.0) {
+			pr_fail("%s: compute shader dispatch failed, GL error\n", args->name);
+			ret = EXIT_FAILURE;
+			goto tidy;
+		}
+		if ((t >= STRESS_GPU_COMPUTE_DISPATCH) || stress_sigalrm_pending() || !stress_continue(args))
+			break;
+	}
+	glUniform1i(uiters, iters);
+
+	do {
+		t = stress_gpu_compute_dispatch();
+		if (t < 0.0) {
+			pr_fail("%s: compute shader dispatch failed, GL error\n", args->name);
+			ret = EXIT_FAILURE;
+			goto tidy;
+		}
+		flops += (double)STRESS_GPU_COMPUTE_GROUPS * STRESS_GPU_COMPUTE_LOCAL *
+			 (double)iters * STRESS_GPU_COMPUTE_FLOPS;
+		duration += t;
+		stress_bogo_inc(args);
+	} while (!stress_sigalrm_pending() && stress_continue(args));
+
+	if (duration > 0.0) {
+		const double gflops = flops / (duration * 1.0E9);
+
+		if (args->instance == 0)
+			pr_inf("%s: compute shader %.3f GFLOP/sec, %d loop iterations per invocation\n",
+				args->name, gflops, (int)iters);
+		stress_metrics_set(args, 1, "GFLOP/sec compute shader", gflops, STRESS_HARMONIC_MEAN);
+	}
+tidy:
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (ssbo)
+		glDeleteBuffers(1, &ssbo);
+	glDeleteProgram(compute);
+	glDeleteShader(shader);
+	glUseProgram(program);
+
+	return ret;
+}
+#endif
+
 static int stress_gpu_supported(const char *name)
 {
 	const char *gpu_devnode = default_gpu_devnode;
@@ -546,6 +987,8 @@ static int stress_gpu_child(stress_args_t *args, void *context)
 {
 	int frag_n = 0;
 	int ret;
+	int gpu_mode = STRESS_GPU_MODE_RENDER;
+	volatile int rc = EXIT_SUCCESS;
 	uint32_t size_x = 256;
 	uint32_t size_y = 256;
 	GLsizei texsize = 4096;
@@ -584,12 +1027,16 @@ static int stress_gpu_child(stress_args_t *args, void *context)
 	(void)stress_get_setting("gpu-ysize", &size_y);
 	(void)stress_get_setting("gpu-tex-size", &texsize);
 	(void)stress_get_setting("gpu-upload", &uploads);
+	(void)stress_get_setting("gpu-mode", &gpu_mode);
 
-	ret = egl_init(args, gpu_devnode, size_x, size_y);
+	/* bandwidth and compute modes use GLES 3.x when available */
+	ret = egl_init(args, gpu_devnode, size_x, size_y,
+		       (gpu_mode == STRESS_GPU_MODE_RENDER) ? 2 : 3);
 	if (ret != EXIT_SUCCESS)
 		goto deinit;
 
-	ret = gles2_init(args, size_x, size_y, frag_n, texsize);
+	ret = gles2_init(args, size_x, size_y, frag_n,
+			 (gpu_mode == STRESS_GPU_MODE_RENDER) ? texsize : 0);
 	if (ret != EXIT_SUCCESS)
 		goto deinit;
 
@@ -607,12 +1054,31 @@ static int stress_gpu_child(stress_args_t *args, void *context)
 		goto finish;
 	}
 
-	do {
-		stress_gpu_run(texsize, uploads);
-		if (glGetError() != GL_NO_ERROR)
-			return EXIT_NO_RESOURCE;
-		stress_bogo_inc(args);
-	} while (!stress_sigalrm_pending() && stress_continue(args));
+	switch (gpu_mode) {
+	case STRESS_GPU_MODE_BANDWIDTH:
+		rc = stress_gpu_bandwidth(args);
+		break;
+	case STRESS_GPU_MODE_COMPUTE:
+#if defined(HAVE_GLES31_H)
+		rc = stress_gpu_compute(args);
+#else
+		pr_inf_skip("%s: compute mode needs GLES3/gl31.h, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+#endif
+		break;
+	default:
+		/* frame latencies feed the latency percentile metrics */
+		do {
+			const double t = stress_time_now();
+
+			stress_gpu_run(texsize, uploads);
+			stress_latency_add(args->latency, (uint64_t)((stress_time_now() - t) * STRESS_DBL_NANOSECOND));
+			if (glGetError() != GL_NO_ERROR)
+				return EXIT_NO_RESOURCE;
+			stress_bogo_inc(args);
+		} while (!stress_sigalrm_pending() && stress_continue(args));
+		break;
+	}
 
 finish:
 #if defined(HAVE_LIB_PTHREAD)
@@ -629,7 +1095,7 @@ finish:
 	do_jmp = false;
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 
-	ret = EXIT_SUCCESS;
+	ret = rc;
 deinit:
 	if (teximage)
 		free(teximage);
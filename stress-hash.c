@@ -19,15 +19,33 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-freq.h"
 #include "core-hash.h"
+#include "core-put.h"
 #if defined(HAVE_XXHASH_H)
 #include <xxhash.h>
 #endif
 
+#if defined(HAVE_XXHASH_H) &&		\
+    defined(HAVE_LIB_XXHASH) &&		\
+    defined(XXH_VERSION_NUMBER) &&	\
+    (XXH_VERSION_NUMBER >= 800)
+#define HAVE_HASH_XXH3
+#endif
+
+#define MIN_HASH_BYTES		(1 * KB)
+#define MAX_HASH_BYTES		(1 * GB)
+#define HASH_STREAM_CHUNK	(4 * KB)	/* streaming hash update size */
+#define HASH_MHZ_SAMPLE		(16)		/* sample effective MHz every N buffers */
+
 typedef struct {
 	double_t	duration;
 	double		chi_squared;
 	uint64_t	total;
+	double		bytes;		/* --hash-bytes bytes hashed */
+	double		mhz_sum;	/* --hash-bytes effective MHz samples */
+	double		mhz_count;	/* --hash-bytes number of MHz samples */
 } stress_hash_stats_t;
 
 typedef struct {
@@ -45,13 +63,16 @@ typedef void (*stress_method_func)(const char *name, const struct stress_hash_me
 
 typedef struct stress_hash_method_info {
 	const char		*name;	/* human readable form of stressor */
-	const stress_method_func	func;	/* the hash method function */
+	const stress_method_func	func;	/* the hash method function, NULL = --hash-bytes only */
+	const stress_hash_func	bulk_func;	/* --hash-bytes hash function, NULL = none */
+	bool			(*supported)(void);	/* NULL = always supported */
 	stress_hash_stats_t	*stats;
 } stress_hash_method_info_t;
 
 
 static const stress_help_t help[] = {
 	{ NULL,  "hash N",		"start N workers that exercise various hash functions" },
+	{ NULL,  "hash-bytes N",	"hash N byte buffers and report GB/s and cycles per byte" },
 	{ NULL,  "hash-method M",	"specify stress hash method M, default is all" },
 	{ NULL,  "hash-ops N",		"stop after N hash bogo operations" },
 	{ NULL,	 NULL,			NULL }
@@ -269,9 +290,7 @@ static void stress_hash_method_nhash(
 
 static uint32_t PURE stress_hash_crc32c_wrapper(const char *str, const size_t len)
 {
-	(void)len;
-
-	return stress_hash_crc32c(str);
+	return stress_hash_crc32c_len((const uint8_t *)str, len);
 }
 
 /*
@@ -286,6 +305,40 @@ static void stress_hash_method_crc32c(
 	stress_hash_generic(name, hmi, bucket, stress_hash_crc32c_wrapper, 0x923ab2b3, 0x923ab2b3);
 }
 
+static uint32_t PURE stress_hash_crc32c_hw_wrapper(const char *str, const size_t len)
+{
+	return stress_hash_crc32c_hw((const uint8_t *)str, len);
+}
+
+/*
+ *  stress_hash_method_crc32c_hw()
+ *	stress test crc32c using the SSE4.2 or ARMv8 CRC32C instructions
+ */
+static void stress_hash_method_crc32c_hw(
+	const char *name,
+	const struct stress_hash_method_info *hmi,
+	const stress_bucket_t *bucket)
+{
+	stress_hash_generic(name, hmi, bucket, stress_hash_crc32c_hw_wrapper, 0x923ab2b3, 0x923ab2b3);
+}
+
+static uint32_t PURE stress_hash_crc32c_sw_wrapper(const char *str, const size_t len)
+{
+	return stress_hash_crc32c_sw((const uint8_t *)str, len);
+}
+
+/*
+ *  stress_hash_method_crc32c_sw()
+ *	stress test slicing-by-8 software crc32c
+ */
+static void stress_hash_method_crc32c_sw(
+	const char *name,
+	const struct stress_hash_method_info *hmi,
+	const stress_bucket_t *bucket)
+{
+	stress_hash_generic(name, hmi, bucket, stress_hash_crc32c_sw_wrapper, 0x923ab2b3, 0x923ab2b3);
+}
+
 static uint32_t PURE OPTIMIZE3 stress_hash_xor(const char *str, const size_t len)
 {
 	register uint32_t sum = 0;
@@ -375,18 +428,11 @@ static void stress_hash_method_coffin(
 	stress_hash_generic(name, hmi, bucket, stress_hash_coffin_wrapper, 0xdc02e07b, 0xdc02e07b);
 }
 
-static uint32_t PURE stress_hash_coffin32_wrapper_le(const char *str, const size_t len)
+static uint32_t PURE stress_hash_coffin32_wrapper(const char *str, const size_t len)
 {
-	(void)len;
-
-	return stress_hash_coffin32_le(str, len);	/* Little Endian */
-}
-
-static uint32_t PURE stress_hash_coffin32_wrapper_be(const char *str, const size_t len)
-{
-	(void)len;
-
-	return stress_hash_coffin32_be(str, len);	/* Big Endian */
+	return stress_little_endian() ?
+		stress_hash_coffin32_le(str, len) :
+		stress_hash_coffin32_be(str, len);
 }
 
 /*
@@ -398,11 +444,7 @@ static void stress_hash_method_coffin32(
 	const struct stress_hash_method_info *hmi,
 	const stress_bucket_t *bucket)
 {
-	const stress_hash_func wrapper = stress_little_endian() ?
-		stress_hash_coffin32_wrapper_le :
-		stress_hash_coffin32_wrapper_be;
-
-	stress_hash_generic(name, hmi, bucket, wrapper, 0xdc02e07b, 0xdc02e07b);
+	stress_hash_generic(name, hmi, bucket, stress_hash_coffin32_wrapper, 0xdc02e07b, 0xdc02e07b);
 }
 
 static uint32_t PURE stress_hash_x17_wrapper(const char *str, const size_t len)
@@ -442,6 +484,57 @@ static void stress_hash_method_xxh64(
 {
 	stress_hash_generic(name, hmi, bucket, stress_hash_xxh64_wrapper, 0x5a23bbc6, 0x5a23bbc6);
 }
+/*
+ *  stress_hash_xxh64_stream()
+ *	XXH64 using the streaming interface, fed in
+ *	HASH_STREAM_CHUNK sized pieces
+ */
+static uint32_t stress_hash_xxh64_stream(const char *str, const size_t len)
+{
+	XXH64_state_t *state = XXH64_createState();
+	uint32_t hash;
+	size_t i;
+
+	if (!state)
+		return 0;
+	(void)XXH64_reset(state, 0xf261eab7);
+	for (i = 0; i < len; i += HASH_STREAM_CHUNK) {
+		const size_t n = STRESS_MINIMUM(len - i, HASH_STREAM_CHUNK);
+
+		(void)XXH64_update(state, str + i, n);
+	}
+	hash = (uint32_t)XXH64_digest(state);
+	(void)XXH64_freeState(state);
+
+	return hash;
+}
+#endif
+
+#if defined(HAVE_HASH_XXH3)
+/*
+ *  stress_hash_xxh3_stream()
+ *	64 bit XXH3 using the streaming interface, fed in
+ *	HASH_STREAM_CHUNK sized pieces
+ */
+static uint32_t stress_hash_xxh3_stream(const char *str, const size_t len)
+{
+	XXH3_state_t *state = XXH3_createState();
+	uint32_t hash;
+	size_t i;
+
+	if (!state)
+		return 0;
+	(void)XXH3_64bits_reset_withSeed(state, 0xf261eab7);
+	for (i = 0; i < len; i += HASH_STREAM_CHUNK) {
+		const size_t n = STRESS_MINIMUM(len - i, HASH_STREAM_CHUNK);
+
+		(void)XXH3_64bits_update(state, str + i, n);
+	}
+	hash = (uint32_t)XXH3_64bits_digest(state);
+	(void)XXH3_freeState(state);
+
+	return hash;
+}
 #endif
 
 static uint32_t PURE stress_hash_loselose_wrapper(const char *str, const size_t len)
@@ -574,38 +667,46 @@ static HOT OPTIMIZE3 void stress_hash_all(
  * Table of has stress methods
  */
 static stress_hash_method_info_t hash_methods[] = {
-	{ "all",		stress_hash_all,		NULL },	/* Special "all" test */
-	{ "adler32",		stress_hash_method_adler32,	NULL },
-	{ "coffin",		stress_hash_method_coffin,	NULL },
-	{ "coffin32",		stress_hash_method_coffin32,	NULL },
-	{ "crc32c",		stress_hash_method_crc32c,	NULL },
-	{ "djb2a",		stress_hash_method_djb2a,	NULL },
-	{ "fnv1a",		stress_hash_method_fnv1a,	NULL },
-	{ "jenkin",		stress_hash_method_jenkin,	NULL },
-	{ "kandr",		stress_hash_method_kandr,	NULL },
-	{ "knuth",		stress_hash_method_knuth,	NULL },
-	{ "loselose",		stress_hash_method_loselose,	NULL },
-	{ "mid5",		stress_hash_method_mid5,	NULL },
-	{ "muladd32",		stress_hash_method_muladd32,	NULL },
-	{ "muladd64",		stress_hash_method_muladd64,	NULL },
-	{ "mulxror32",		stress_hash_method_mulxror32,	NULL },
-	{ "mulxror64",		stress_hash_method_mulxror64,	NULL },
-	{ "murmur3_32",		stress_hash_method_murmur3_32,	NULL },
-	{ "nhash",		stress_hash_method_nhash,	NULL },
-	{ "pjw",		stress_hash_method_pjw,		NULL },
-	{ "sdbm",		stress_hash_method_sdbm,	NULL },
-	{ "sedgwick",		stress_hash_method_sedgwick,	NULL },
-	{ "sobel",		stress_hash_method_sobel,	NULL },
-	{ "x17",		stress_hash_method_x17,		NULL },
-	{ "xor",		stress_hash_method_xor,		NULL },
-	{ "xorror32",		stress_hash_method_xorror32,	NULL },
-	{ "xorror64",		stress_hash_method_xorror64,	NULL },
+	{ "all",		stress_hash_all,		NULL,				NULL, NULL },	/* Special "all" test */
+	{ "adler32",		stress_hash_method_adler32,	stress_hash_adler32,		NULL, NULL },
+	{ "coffin",		stress_hash_method_coffin,	stress_hash_coffin_wrapper,	NULL, NULL },
+	{ "coffin32",		stress_hash_method_coffin32,	stress_hash_coffin32_wrapper,	NULL, NULL },
+	{ "crc32c",		stress_hash_method_crc32c,	stress_hash_crc32c_wrapper,	NULL, NULL },
+	{ "crc32c-hw",		stress_hash_method_crc32c_hw,	stress_hash_crc32c_hw_wrapper,	stress_hash_crc32c_hw_available, NULL },
+	{ "crc32c-sw",		stress_hash_method_crc32c_sw,	stress_hash_crc32c_sw_wrapper,	NULL, NULL },
+	{ "djb2a",		stress_hash_method_djb2a,	stress_hash_djb2a_wrapper,	NULL, NULL },
+	{ "fnv1a",		stress_hash_method_fnv1a,	stress_hash_fnv1a_wrapper,	NULL, NULL },
+	{ "jenkin",		stress_hash_method_jenkin,	stress_hash_jenkin_wrapper,	NULL, NULL },
+	{ "kandr",		stress_hash_method_kandr,	stress_hash_kandr_wrapper,	NULL, NULL },
+	{ "knuth",		stress_hash_method_knuth,	stress_hash_knuth,		NULL, NULL },
+	{ "loselose",		stress_hash_method_loselose,	stress_hash_loselose_wrapper,	NULL, NULL },
+	{ "mid5",		stress_hash_method_mid5,	stress_hash_mid5,		NULL, NULL },
+	{ "muladd32",		stress_hash_method_muladd32,	stress_hash_muladd32,		NULL, NULL },
+	{ "muladd64",		stress_hash_method_muladd64,	stress_hash_muladd64,		NULL, NULL },
+	{ "mulxror32",		stress_hash_method_mulxror32,	stress_hash_mulxror32,		NULL, NULL },
+	{ "mulxror64",		stress_hash_method_mulxror64,	stress_hash_mulxror64,		NULL, NULL },
+	{ "murmur3_32",		stress_hash_method_murmur3_32,	stress_hash_murmur3_32_wrapper,	NULL, NULL },
+	{ "nhash",		stress_hash_method_nhash,	stress_hash_nhash_wrapper,	NULL, NULL },
+	{ "pjw",		stress_hash_method_pjw,		stress_hash_pjw_wrapper,	NULL, NULL },
+	{ "sdbm",		stress_hash_method_sdbm,	stress_hash_sdbm_wrapper,	NULL, NULL },
+	{ "sedgwick",		stress_hash_method_sedgwick,	stress_hash_sedgwick_wrapper,	NULL, NULL },
+	{ "sobel",		stress_hash_method_sobel,	stress_hash_sobel_wrapper,	NULL, NULL },
+	{ "x17",		stress_hash_method_x17,		stress_hash_x17_wrapper,	NULL, NULL },
+	{ "xor",		stress_hash_method_xor,		stress_hash_xor,		NULL, NULL },
+	{ "xorror32",		stress_hash_method_xorror32,	stress_hash_xorror32,		NULL, NULL },
+	{ "xorror64",		stress_hash_method_xorror64,	stress_hash_xorror64,		NULL, NULL },
 #if defined(HAVE_XXHASH_H) &&	\
     defined(HAVE_LIB_XXHASH)
-	{ "xxh64",		stress_hash_method_xxh64,	NULL },
+	{ "xxh64",		stress_hash_method_xxh64,	stress_hash_xxh64_wrapper,	NULL, NULL },
+	{ "xxh64-stream",	NULL,				stress_hash_xxh64_stream,	NULL, NULL },
+#endif
+#if defined(HAVE_HASH_XXH3)
+	{ "xxh3-stream",	NULL,				stress_hash_xxh3_stream,	NULL, NULL },
 #endif
 };
 
+static bool hash_method_usable[SIZEOF_ARRAY(hash_methods)];
+
 /*
  *  stress_hash_all()
  *	iterate over all hash stressor methods
@@ -616,10 +717,17 @@ static HOT OPTIMIZE3 void stress_hash_all(
 	const stress_bucket_t *bucket)
 {
 	static size_t i = 1;	/* Skip over stress_hash_all */
-	const struct stress_hash_method_info *h = &hash_methods[i];
+	const struct stress_hash_method_info *h;
 
 	(void)hmi;
 
+	/* skip over --hash-bytes only and unsupported methods */
+	while (!hash_method_usable[i] || !hash_methods[i].func) {
+		i++;
+		if (i >= SIZEOF_ARRAY(hash_methods))
+			i = 1;
+	}
+	h = &hash_methods[i];
 	h->func(name, h, bucket);
 	i++;
 	if (i >= SIZEOF_ARRAY(hash_methods))
@@ -652,6 +760,157 @@ static int stress_set_hash_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_hash_bytes()
+ *	set the --hash-bytes buffer size
+ */
+static int stress_set_hash_bytes(const char *opt)
+{
+	size_t hash_bytes;
+
+	hash_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("hash-bytes", (uint64_t)hash_bytes,
+		MIN_HASH_BYTES, MAX_HASH_BYTES);
+	return stress_set_setting("hash-bytes", TYPE_ID_SIZE_T, &hash_bytes);
+}
+
+/*
+ *  stress_hash_bulk()
+ *	hash a large contiguous buffer with each hash method and
+ *	report the throughput in GB/s and the cost in cycles per byte
+ */
+static int stress_hash_bulk(
+	stress_args_t *args,
+	const size_t hash_method,
+	const size_t hash_bytes)
+{
+	char *buf;
+	size_t i, j, first, last;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const size_t buf_size = hash_bytes + 1;
+
+	buf = (char *)stress_mmap_populate(NULL, buf_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu byte hash buffer, errno=%d (%s), "
+			"skipping stressor\n", args->name, buf_size,
+			errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	/*
+	 *  random data without any zero bytes and zero terminated
+	 *  so the string based hashes also hash the entire buffer
+	 */
+	stress_uint8rnd4((uint8_t *)buf, hash_bytes & ~(size_t)3);
+	for (i = hash_bytes & ~(size_t)3; i < hash_bytes; i++)
+		buf[i] = (char)stress_mwc8();
+	for (i = 0; i < hash_bytes; i++) {
+		if (!buf[i])
+			buf[i] = 1;
+	}
+	buf[hash_bytes] = '\0';
+
+	if (hash_method) {
+		first = hash_method;
+		last = hash_method;
+	} else {
+		first = 1;
+		last = SIZEOF_ARRAY(hash_methods) - 1;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = first; stress_continue(args) && (i <= last); i++) {
+			const stress_hash_method_info_t *hm = &hash_methods[i];
+			stress_hash_stats_t *stats = hm->stats;
+			uint32_t hash;
+			double t;
+
+			if (!hash_method_usable[i] || !hm->bulk_func)
+				continue;
+
+			t = stress_time_now();
+			hash = hm->bulk_func(buf, hash_bytes);
+			stats->duration += stress_time_now() - t;
+			stats->bytes += (double)hash_bytes;
+			stats->total++;
+			stress_uint32_put(hash);
+			stress_bogo_inc(args);
+
+			/* sample the clock straight after the hashing */
+			if ((stats->total % HASH_MHZ_SAMPLE) == 1) {
+				const double mhz = stress_freq_effective_mhz();
+
+				if (mhz > 0.0) {
+					stats->mhz_sum += mhz;
+					stats->mhz_count += 1.0;
+				}
+			}
+
+			if (verify) {
+				const uint32_t hash2 = hm->bulk_func(buf, hash_bytes);
+
+				if (hash != hash2) {
+					pr_fail("%s: %s hash of %zu bytes not repeatable, "
+						"got %" PRIx32 " and %" PRIx32 "\n",
+						args->name, hm->name, hash_bytes, hash, hash2);
+				}
+				if (hm->bulk_func == stress_hash_crc32c_hw_wrapper) {
+					const uint32_t crc = stress_hash_crc32c_sw((const uint8_t *)buf, hash_bytes);
+
+					if (hash != crc) {
+						pr_fail("%s: crc32c-hw hash %" PRIx32 " differs from "
+							"crc32c-sw hash %" PRIx32 "\n",
+							args->name, hash, crc);
+					}
+				}
+			}
+		}
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %12.12s %10s %12s (%zu byte buffer)\n",
+			args->name, "hash", "GB/s", "cycles/byte", hash_bytes);
+	}
+	for (j = 0, i = first; i <= last; i++) {
+		const stress_hash_stats_t *stats = hash_methods[i].stats;
+		const double rate = (stats->duration > 0.0) ?
+			stats->bytes / stats->duration : 0.0;
+		const double mhz = (stats->mhz_count > 0.0) ?
+			stats->mhz_sum / stats->mhz_count : 0.0;
+		const double cpb = (rate > 0.0) ? (mhz * 1000000.0) / rate : 0.0;
+		char msg[64];
+
+		if (rate <= 0.0)
+			continue;
+		if (args->instance == 0) {
+			if (cpb > 0.0)
+				pr_inf("%s: %12.12s %10.3f %12.3f\n",
+					args->name, hash_methods[i].name, rate / 1.0E9, cpb);
+			else
+				pr_inf("%s: %12.12s %10.3f %12s\n",
+					args->name, hash_methods[i].name, rate / 1.0E9, "n/a");
+		}
+		(void)snprintf(msg, sizeof(msg), "%s GB/s", hash_methods[i].name);
+		stress_metrics_set(args, j++, msg, rate / 1.0E9, STRESS_HARMONIC_MEAN);
+		/* too many methods for a cycles/byte metric for each of them */
+		if ((first == last) && (cpb > 0.0))
+			stress_metrics_set(args, j++, "cycles per byte", cpb, STRESS_GEOMETRIC_MEAN);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+	(void)munmap((void *)buf, buf_size);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_hash()
  *	stress CPU by doing floating point math ops
@@ -660,7 +919,7 @@ static int HOT OPTIMIZE3 stress_hash(stress_args_t *args)
 {
 	size_t i;
 	const stress_hash_method_info_t *hm;
-	size_t hash_method = 0;
+	size_t hash_method = 0, hash_bytes = 0;
 	stress_bucket_t bucket;
 	void *buffer;
 
@@ -683,13 +942,37 @@ static int HOT OPTIMIZE3 stress_hash(stress_args_t *args)
 	bucket.buffer = (char *)stress_align_address(buffer, 64);
 
 	(void)stress_get_setting("hash-method", &hash_method);
+	(void)stress_get_setting("hash-bytes", &hash_bytes);
 	hm = &hash_methods[hash_method];
 
 	for (i = 0; i < SIZEOF_ARRAY(hash_methods); i++) {
-		hash_stats[i].duration = 0.0;
-		hash_stats[i].total = false;
-		hash_stats[i].chi_squared = 0.0;
+		(void)shim_memset(&hash_stats[i], 0, sizeof(hash_stats[i]));
 		hash_methods[i].stats = &hash_stats[i];
+		hash_method_usable[i] = !hash_methods[i].supported ||
+					hash_methods[i].supported();
+	}
+
+	if (!hash_method_usable[hash_method] ||
+	    (!hash_bytes && !hm->func)) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: hash method '%s' is not supported%s, skipping stressor\n",
+				args->name, hm->name,
+				hash_method_usable[hash_method] ? " without --hash-bytes" : " by this processor");
+		free(buffer);
+		free(bucket.buckets);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (hash_bytes) {
+		int ret;
+
+		if (args->instance == 0)
+			pr_dbg("%s: using method '%s' on %zu byte buffers\n",
+				args->name, hm->name, hash_bytes);
+		ret = stress_hash_bulk(args, hash_method, hash_bytes);
+		free(buffer);
+		free(bucket.buckets);
+		return ret;
 	}
 
 	if (args->instance == 0)
@@ -734,6 +1017,7 @@ static void stress_hash_set_default(void)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_hash_bytes,	stress_set_hash_bytes },
 	{ OPT_hash_method,	stress_set_hash_method },
 	{ 0,			NULL },
 };
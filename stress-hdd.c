@@ -20,8 +20,18 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-pragma.h"
 #include "core-target-clones.h"
+#include "io-uring.h"
+
+#if defined(HAVE_LINUX_AIO_ABI_H)
+#include <linux/aio_abi.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
 
 #if defined(HAVE_SYS_UIO_H)
 #include <sys/uio.h>
@@ -39,6 +49,16 @@
 #define MAX_HDD_WRITE_SIZE	(4 * MB)
 #define DEFAULT_HDD_WRITE_SIZE	(64 * 1024)
 
+#define MIN_HDD_IODEPTH		(1)
+#define MAX_HDD_IODEPTH		(1024)
+#define DEFAULT_HDD_IODEPTH	(16)
+
+#define HDD_ENGINE_SYNC		(0)
+#define HDD_ENGINE_PSYNC	(1)
+#define HDD_ENGINE_LIBAIO	(2)
+#define HDD_ENGINE_IO_URING	(3)
+#define HDD_ENGINE_MMAP		(4)
+
 #define BUF_ALIGNMENT		(4096)
 #define HDD_IO_VEC_MAX		(16)		/* Must be power of 2 */
 
@@ -80,9 +100,26 @@ typedef struct {
 	const int oflag;	/* open O_* flags */
 } stress_hdd_opts_t;
 
+typedef struct {
+	double bytes;			/* bytes transferred */
+	double duration;		/* time spent in I/O, seconds */
+	stress_latency_t latency;	/* per I/O completion latency, ns */
+} stress_hdd_io_stats_t;
+
+/*
+ *  read, write and sync stats, one set per hdd-opts combination
+ */
+typedef struct {
+	stress_hdd_io_stats_t read;
+	stress_hdd_io_stats_t write;
+	stress_latency_t sync;		/* fsync, fdatasync and syncfs latency, ns */
+} stress_hdd_stats_t;
+
 static const stress_help_t help[] = {
 	{ "d N","hdd N",		"start N workers spinning on write()/unlink()" },
 	{ NULL,	"hdd-bytes N",		"write N bytes per hdd worker (default is 1GB)" },
+	{ NULL,	"hdd-engine E",		"select I/O engine E, [ sync | psync | libaio | io_uring | mmap ]" },
+	{ NULL,	"hdd-iodepth N",	"keep N I/Os in flight with the libaio and io_uring engines" },
 	{ NULL,	"hdd-ops N",		"stop after N hdd bogo operations" },
 	{ NULL,	"hdd-opts list",	"specify list of various stressor options" },
 	{ NULL,	"hdd-write-size N",	"set the default write size to N bytes" },
@@ -203,6 +240,80 @@ static void stress_hdd_utimes(const int fd)
 }
 #endif
 
+/*
+ *  stress_hdd_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_hdd_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_hdd_io_done()
+ *	account a successful I/O started at time t
+ */
+static inline void stress_hdd_io_done(
+	stress_hdd_io_stats_t *io_stats,
+	const uint64_t t,
+	const ssize_t ret)
+{
+	if (ret > 0) {
+		const uint64_t ns = stress_hdd_now_ns() - t;
+
+		io_stats->duration += (double)ns / STRESS_DBL_NANOSECOND;
+		io_stats->bytes += (double)ret;
+		stress_latency_add(&io_stats->latency, ns);
+	}
+}
+
+/*
+ *  stress_hdd_sync()
+ *	fsync, fdatasync and syncfs as per the hdd-opts, timing each
+ */
+static void stress_hdd_sync(
+	const int fd,
+	const int hdd_flags,
+	stress_latency_t *latency)
+{
+#if defined(HAVE_FSYNC)
+	if (hdd_flags & HDD_OPT_FSYNC) {
+		const uint64_t t = stress_hdd_now_ns();
+
+		if (shim_fsync(fd) == 0)
+			stress_latency_add(latency, stress_hdd_now_ns() - t);
+	}
+#else
+	UNEXPECTED
+#endif
+#if defined(HAVE_FDATASYNC)
+	if (hdd_flags & HDD_OPT_FDATASYNC) {
+		const uint64_t t = stress_hdd_now_ns();
+
+		if (shim_fdatasync(fd) == 0)
+			stress_latency_add(latency, stress_hdd_now_ns() - t);
+	}
+#else
+	UNEXPECTED
+#endif
+#if defined(HAVE_SYNCFS)
+	if (hdd_flags & HDD_OPT_SYNCFS) {
+		const uint64_t t = stress_hdd_now_ns();
+
+		if (syncfs(fd) == 0)
+			stress_latency_add(latency, stress_hdd_now_ns() - t);
+	}
+#else
+	UNEXPECTED
+#endif
+}
+
 /*
  *  stress_hdd_write()
  *	write with writev or write depending on mode
@@ -213,11 +324,10 @@ static ssize_t stress_hdd_write(
 	const off_t offset,
 	const uint64_t hdd_write_size,
 	const int hdd_flags,
-	double *hdd_write_bytes,
-	double *hdd_write_duration)
+	stress_hdd_stats_t *stats)
 {
 	ssize_t ret = -1;
-	double t;
+	uint64_t t;
 
 #if defined(HAVE_FUTIMES)
 	if (hdd_flags & HDD_OPT_UTIMES)
@@ -246,84 +356,52 @@ static ssize_t stress_hdd_write(
 		switch (stress_mwc8modn(3)) {
 #if defined(HAVE_PWRITEV2)
 		case 0:
-			t = stress_time_now();
+			t = stress_hdd_now_ns();
 #if defined(RWF_HIPRI)
 			if (hdd_flags & HDD_OPT_O_DIRECT)
 				pwitev2_flag |= RWF_HIPRI;
 #endif
 			ret = pwritev2(fd, iov, HDD_IO_VEC_MAX, offset, pwitev2_flag);
-			if (ret > 0) {
-				(*hdd_write_duration) += stress_time_now() - t;
-				(*hdd_write_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->write, t, ret);
 			break;
 #endif
 #if defined(HAVE_PWRITEV)
 		case 1:
-			t = stress_time_now();
+			t = stress_hdd_now_ns();
 			ret = pwritev(fd, iov, HDD_IO_VEC_MAX, offset);
-			if (ret > 0) {
-				(*hdd_write_duration) += stress_time_now() - t;
-				(*hdd_write_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->write, t, ret);
 			break;
 #endif
 		default:
-			t = stress_time_now();
+			t = stress_hdd_now_ns();
 			if (lseek(fd, offset, SEEK_SET) < 0) {
 				ret = -1;
 			} else {
 				ret = writev(fd, iov, HDD_IO_VEC_MAX);
-				if (ret > 0) {
-					(*hdd_write_duration) += stress_time_now() - t;
-					(*hdd_write_bytes) += (double)ret;
-				}
+				stress_hdd_io_done(&stats->write, t, ret);
 			}
 			break;
 		}
 #else
-		t = stress_time_now();
+		t = stress_hdd_now_ns();
 		if (lseek(fd, offset, SEEK_SET) < 0) {
 			ret = -1;
 		} else {
 			ret = write(fd, buf, (size_t)hdd_write_size);
-			if (ret > 0) {
-				(*hdd_write_duration) += stress_time_now() - t;
-				(*hdd_write_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->write, t, ret);
 		}
 #endif
 	} else {
-		t = stress_time_now();
+		t = stress_hdd_now_ns();
 		if (lseek(fd, offset, SEEK_SET) < 0) {
 			ret = -1;
 		} else {
 			ret = write(fd, buf, (size_t)hdd_write_size);
-			if (ret > 0) {
-				(*hdd_write_duration) += stress_time_now() - t;
-				(*hdd_write_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->write, t, ret);
 		}
 	}
 
-#if defined(HAVE_FSYNC)
-	if (hdd_flags & HDD_OPT_FSYNC)
-		(void)shim_fsync(fd);
-#else
-	UNEXPECTED
-#endif
-#if defined(HAVE_FDATASYNC)
-	if (hdd_flags & HDD_OPT_FDATASYNC)
-		(void)shim_fdatasync(fd);
-#else
-	UNEXPECTED
-#endif
-#if defined(HAVE_SYNCFS)
-	if (hdd_flags & HDD_OPT_SYNCFS)
-		(void)syncfs(fd);
-#else
-	UNEXPECTED
-#endif
+	stress_hdd_sync(fd, hdd_flags, &stats->sync);
 
 	return ret;
 }
@@ -338,11 +416,10 @@ static ssize_t stress_hdd_read(
 	const off_t offset,
 	const uint64_t hdd_read_size,
 	const int hdd_flags,
-	double *hdd_read_bytes,
-	double *hdd_read_duration)
+	stress_hdd_stats_t *stats)
 {
 	ssize_t ret = -1;
-	double t;
+	uint64_t t;
 
 #if defined(HAVE_FUTIMES)
 	if (hdd_flags & HDD_OPT_UTIMES)
@@ -368,55 +445,40 @@ static ssize_t stress_hdd_read(
 		switch (stress_mwc8modn(3)) {
 #if defined(HAVE_PREADV2)
 		case 0:
-			t = stress_time_now();
+			t = stress_hdd_now_ns();
 			ret = preadv2(fd, iov, HDD_IO_VEC_MAX, offset, 0);
-			if (ret > 0) {
-				(*hdd_read_duration) += stress_time_now() - t;
-				(*hdd_read_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->read, t, ret);
 			return ret;
 #endif
 #if defined(HAVE_PREADV)
 		case 1:
-			t = stress_time_now();
+			t = stress_hdd_now_ns();
 			ret = preadv(fd, iov, HDD_IO_VEC_MAX, offset);
-			if (ret > 0) {
-				(*hdd_read_duration) += stress_time_now() - t;
-				(*hdd_read_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->read, t, ret);
 			return ret;
 #endif
 		default:
-			t = stress_time_now();
+			t = stress_hdd_now_ns();
 			if (lseek(fd, offset, SEEK_SET) < 0)
 				return -1;
 			ret = readv(fd, iov, HDD_IO_VEC_MAX);
-			if (ret > 0) {
-				(*hdd_read_duration) += stress_time_now() - t;
-				(*hdd_read_bytes) += (double)ret;
-			}
+			stress_hdd_io_done(&stats->read, t, ret);
 			return ret;
 		}
 #else
-		t = stress_time_now();
+		t = stress_hdd_now_ns();
 		if (lseek(fd, offset, SEEK_SET) < 0)
 			return -1;
 		ret = read(fd, buf, (size_t)hdd_read_size);
-		if (ret > 0) {
-			(*hdd_read_duration) += stress_time_now() - t;
-			(*hdd_read_bytes) += (double)ret;
-		}
+		stress_hdd_io_done(&stats->read, t, ret);
 		return ret;
 #endif
 	} else {
-		t = stress_time_now();
+		t = stress_hdd_now_ns();
 		if (lseek(fd, offset, SEEK_SET) < 0)
 			return -1;
 		ret = read(fd, buf, (size_t)hdd_read_size);
-		if (ret > 0) {
-			(*hdd_read_duration) += stress_time_now() - t;
-			(*hdd_read_bytes) += (double)ret;
-		}
+		stress_hdd_io_done(&stats->read, t, ret);
 		return ret;
 	}
 	return ret;
@@ -653,6 +715,828 @@ static void OPTIMIZE3 TARGET_CLONES hdd_fill_buf(
 	}
 }
 
+#if defined(HAVE_LINUX_AIO_ABI_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_setup) &&		\
+    defined(__NR_io_destroy) &&		\
+    defined(__NR_io_submit) &&		\
+    defined(__NR_io_getevents)
+#define HAVE_HDD_ENGINE_LIBAIO
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_uring_setup) &&	\
+    defined(__NR_io_uring_enter) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES) &&		\
+    defined(HAVE_IORING_OP_READ) &&	\
+    defined(HAVE_IORING_OP_WRITE)
+#define HAVE_HDD_ENGINE_IO_URING
+#endif
+
+/*
+ *  per stressor instance I/O engine state, each of the iodepth
+ *  slots has its own buffer so that iodepth I/Os can be in flight
+ */
+typedef struct {
+	stress_args_t *args;
+	int fd;				/* file being exercised */
+	int hdd_flags;			/* HDD_OPT_* flags */
+	uint32_t iodepth;		/* maximum I/Os in flight */
+	size_t io_size;			/* size of each I/O */
+	size_t slot_size;		/* io_size rounded up to BUF_ALIGNMENT */
+	uint64_t file_size;		/* size of file being exercised */
+	uint8_t *bufs;			/* iodepth slot buffers */
+	uint64_t *offsets;		/* per slot file offset */
+	uint64_t *t_submit;		/* per slot submit time, ns */
+	uint32_t *free_slots;		/* stack of free slots */
+	uint32_t n_free;		/* number of free slots */
+	uint32_t *done_slots;		/* completed slots, filled in by reap */
+	ssize_t *done_res;		/* completed slot results or -errno */
+	uint32_t n_done;		/* number of completed slots */
+	uint8_t *map;			/* mmap engine file mapping */
+#if defined(HAVE_HDD_ENGINE_LIBAIO)
+	aio_context_t aio_ctx;		/* libaio engine context */
+	struct iocb *iocbs;		/* per slot iocbs */
+	struct iocb **iocbps;		/* iocbs to submit */
+	struct io_event *events;	/* completion events */
+#endif
+#if defined(HAVE_HDD_ENGINE_IO_URING)
+	int ring_fd;			/* io_uring engine ring */
+	void *sq_mmap;			/* submission queue ring mapping */
+	void *cq_mmap;			/* completion queue ring mapping */
+	size_t sq_size;			/* size of sq_mmap */
+	size_t cq_size;			/* size of cq_mmap */
+	struct io_uring_sqe *sqes;	/* submission queue entries */
+	size_t sqes_size;		/* size of sqes mapping */
+	unsigned *sq_tail;		/* submission ring pointers */
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;		/* completion ring pointers */
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+#endif
+} stress_hdd_ctx_t;
+
+/*
+ *  I/O engine, init and deinit are called once per run, open and
+ *  close once per test file, submit queues n slot I/Os and reap
+ *  waits for at least min completions and adds them to done_slots
+ */
+typedef struct {
+	const char *name;		/* --hdd-engine name */
+	const bool async;		/* honours --hdd-iodepth */
+	int (*init)(stress_hdd_ctx_t *ctx);
+	void (*deinit)(stress_hdd_ctx_t *ctx);
+	int (*open)(stress_hdd_ctx_t *ctx);
+	void (*close)(stress_hdd_ctx_t *ctx);
+	int (*submit)(stress_hdd_ctx_t *ctx, const bool write, const uint32_t *slots, const uint32_t n);
+	int (*reap)(stress_hdd_ctx_t *ctx, const uint32_t min);
+} stress_hdd_engine_t;
+
+static inline uint8_t *stress_hdd_slot_buf(const stress_hdd_ctx_t *ctx, const uint32_t slot)
+{
+	return ctx->bufs + ((size_t)slot * ctx->slot_size);
+}
+
+static inline void stress_hdd_done(stress_hdd_ctx_t *ctx, const uint32_t slot, const ssize_t res)
+{
+	ctx->done_slots[ctx->n_done] = slot;
+	ctx->done_res[ctx->n_done] = res;
+	ctx->n_done++;
+}
+
+/*
+ *  stress_hdd_psync_submit()
+ *	psync engine, pread/pwrite each I/O there and then
+ */
+static int stress_hdd_psync_submit(
+	stress_hdd_ctx_t *ctx,
+	const bool write,
+	const uint32_t *slots,
+	const uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		const uint32_t slot = slots[i];
+		uint8_t *buf = stress_hdd_slot_buf(ctx, slot);
+		const off_t offset = (off_t)ctx->offsets[slot];
+		ssize_t ret;
+
+		ret = write ? pwrite(ctx->fd, buf, ctx->io_size, offset) :
+			      pread(ctx->fd, buf, ctx->io_size, offset);
+		stress_hdd_done(ctx, slot, (ret < 0) ? -errno : ret);
+	}
+	return 0;
+}
+
+/*
+ *  stress_hdd_sync_reap()
+ *	synchronous engines complete I/O at submit time
+ */
+static int stress_hdd_sync_reap(stress_hdd_ctx_t *ctx, const uint32_t min)
+{
+	(void)ctx;
+	(void)min;
+
+	return 0;
+}
+
+#if defined(HAVE_MSYNC)
+/*
+ *  stress_hdd_mmap_open()
+ *	mmap engine, map the whole test file shared
+ */
+static int stress_hdd_mmap_open(stress_hdd_ctx_t *ctx)
+{
+	void *map;
+
+	map = mmap(NULL, (size_t)ctx->file_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, ctx->fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	ctx->map = (uint8_t *)map;
+	return 0;
+}
+
+static void stress_hdd_mmap_close(stress_hdd_ctx_t *ctx)
+{
+	if (ctx->map) {
+		(void)munmap((void *)ctx->map, (size_t)ctx->file_size);
+		ctx->map = NULL;
+	}
+}
+
+/*
+ *  stress_hdd_mmap_submit()
+ *	mmap engine, copy to or from the mapping, with any of the
+ *	sync options writes are flushed with msync
+ */
+static int stress_hdd_mmap_submit(
+	stress_hdd_ctx_t *ctx,
+	const bool write,
+	const uint32_t *slots,
+	const uint32_t n)
+{
+	const bool sync = !!(ctx->hdd_flags & (HDD_OPT_O_SYNC | HDD_OPT_O_DSYNC |
+					       HDD_OPT_FSYNC | HDD_OPT_FDATASYNC));
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		const uint32_t slot = slots[i];
+		uint8_t *buf = stress_hdd_slot_buf(ctx, slot);
+		uint8_t *ptr = ctx->map + ctx->offsets[slot];
+		ssize_t res = (ssize_t)ctx->io_size;
+
+		if (write) {
+			(void)shim_memcpy(ptr, buf, ctx->io_size);
+			if (sync) {
+				uint8_t *page = (uint8_t *)((uintptr_t)ptr & ~(uintptr_t)(BUF_ALIGNMENT - 1));
+
+				if (shim_msync((void *)page, ctx->io_size + (size_t)(ptr - page), MS_SYNC) < 0)
+					res = -errno;
+			}
+		} else {
+			(void)shim_memcpy(buf, ptr, ctx->io_size);
+		}
+		stress_hdd_done(ctx, slot, res);
+	}
+	return 0;
+}
+#endif
+
+#if defined(HAVE_HDD_ENGINE_LIBAIO)
+/*
+ *  stress_hdd_libaio_init()
+ *	libaio engine, Linux native AIO context for iodepth I/Os
+ */
+static int stress_hdd_libaio_init(stress_hdd_ctx_t *ctx)
+{
+	ctx->iocbs = (struct iocb *)calloc((size_t)ctx->iodepth, sizeof(*ctx->iocbs));
+	ctx->iocbps = (struct iocb **)calloc((size_t)ctx->iodepth, sizeof(*ctx->iocbps));
+	ctx->events = (struct io_event *)calloc((size_t)ctx->iodepth, sizeof(*ctx->events));
+	if (!ctx->iocbs || !ctx->iocbps || !ctx->events) {
+		errno = ENOMEM;
+		return -1;
+	}
+	ctx->aio_ctx = 0;
+	if (syscall(__NR_io_setup, ctx->iodepth, &ctx->aio_ctx) < 0)
+		return -1;
+	return 0;
+}
+
+static void stress_hdd_libaio_deinit(stress_hdd_ctx_t *ctx)
+{
+	if (ctx->aio_ctx)
+		(void)syscall(__NR_io_destroy, ctx->aio_ctx);
+	free(ctx->events);
+	free(ctx->iocbps);
+	free(ctx->iocbs);
+}
+
+/*
+ *  stress_hdd_libaio_submit()
+ *	libaio engine, submit n pread/pwrite iocbs with one io_submit
+ */
+static int stress_hdd_libaio_submit(
+	stress_hdd_ctx_t *ctx,
+	const bool write,
+	const uint32_t *slots,
+	const uint32_t n)
+{
+	uint32_t i, submitted = 0;
+
+	for (i = 0; i < n; i++) {
+		const uint32_t slot = slots[i];
+		struct iocb *cb = &ctx->iocbs[slot];
+
+		(void)shim_memset(cb, 0, sizeof(*cb));
+		cb->aio_data = (uint64_t)slot;
+		cb->aio_lio_opcode = write ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+		cb->aio_fildes = (uint32_t)ctx->fd;
+		cb->aio_buf = (uint64_t)(uintptr_t)stress_hdd_slot_buf(ctx, slot);
+		cb->aio_nbytes = (uint64_t)ctx->io_size;
+		cb->aio_offset = (int64_t)ctx->offsets[slot];
+		ctx->iocbps[i] = cb;
+	}
+	while (submitted < n) {
+		const long int ret = (long int)syscall(__NR_io_submit, ctx->aio_ctx,
+					(long int)(n - submitted), &ctx->iocbps[submitted]);
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR))
+				continue;
+			return -1;
+		}
+		submitted += (uint32_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_hdd_libaio_reap()
+ *	libaio engine, wait for at least min completions
+ */
+static int stress_hdd_libaio_reap(stress_hdd_ctx_t *ctx, const uint32_t min)
+{
+	long int i, ret;
+
+	ret = (long int)syscall(__NR_io_getevents, ctx->aio_ctx, (long int)min,
+				(long int)ctx->iodepth, ctx->events, NULL);
+	if (ret < 0)
+		return (errno == EINTR) ? 0 : -1;
+	for (i = 0; i < ret; i++)
+		stress_hdd_done(ctx, (uint32_t)ctx->events[i].data, (ssize_t)ctx->events[i].res);
+	return 0;
+}
+#endif
+
+#if defined(HAVE_HDD_ENGINE_IO_URING)
+/*
+ *  stress_hdd_io_uring_init()
+ *	io_uring engine, ring with iodepth submission queue entries
+ */
+static int stress_hdd_io_uring_init(stress_hdd_ctx_t *ctx)
+{
+	struct io_uring_params p;
+	void *ptr;
+
+	ctx->ring_fd = -1;
+	ctx->sq_mmap = MAP_FAILED;
+	ctx->cq_mmap = MAP_FAILED;
+	ctx->sqes = MAP_FAILED;
+
+	(void)shim_memset(&p, 0, sizeof(p));
+	ctx->ring_fd = (int)syscall(__NR_io_uring_setup, ctx->iodepth, &p);
+	if (ctx->ring_fd < 0)
+		return -1;
+
+	ctx->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ctx->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ctx->cq_size > ctx->sq_size)
+			ctx->sq_size = ctx->cq_size;
+		ctx->cq_size = ctx->sq_size;
+	}
+	ctx->sq_mmap = mmap(NULL, ctx->sq_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ctx->ring_fd, IORING_OFF_SQ_RING);
+	if (ctx->sq_mmap == MAP_FAILED)
+		return -1;
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		ctx->cq_mmap = ctx->sq_mmap;
+	} else {
+		ctx->cq_mmap = mmap(NULL, ctx->cq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ctx->ring_fd, IORING_OFF_CQ_RING);
+		if (ctx->cq_mmap == MAP_FAILED)
+			return -1;
+	}
+	ctx->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ptr = mmap(NULL, ctx->sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ctx->ring_fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED)
+		return -1;
+	ctx->sqes = (struct io_uring_sqe *)ptr;
+
+	ctx->sq_tail = (unsigned *)((uint8_t *)ctx->sq_mmap + p.sq_off.tail);
+	ctx->sq_mask = (unsigned *)((uint8_t *)ctx->sq_mmap + p.sq_off.ring_mask);
+	ctx->sq_array = (unsigned *)((uint8_t *)ctx->sq_mmap + p.sq_off.array);
+	ctx->cq_head = (unsigned *)((uint8_t *)ctx->cq_mmap + p.cq_off.head);
+	ctx->cq_tail = (unsigned *)((uint8_t *)ctx->cq_mmap + p.cq_off.tail);
+	ctx->cq_mask = (unsigned *)((uint8_t *)ctx->cq_mmap + p.cq_off.ring_mask);
+	ctx->cqes = (struct io_uring_cqe *)((uint8_t *)ctx->cq_mmap + p.cq_off.cqes);
+	return 0;
+}
+
+static void stress_hdd_io_uring_deinit(stress_hdd_ctx_t *ctx)
+{
+	if (ctx->sqes != MAP_FAILED)
+		(void)munmap((void *)ctx->sqes, ctx->sqes_size);
+	if ((ctx->cq_mmap != MAP_FAILED) && (ctx->cq_mmap != ctx->sq_mmap))
+		(void)munmap(ctx->cq_mmap, ctx->cq_size);
+	if (ctx->sq_mmap != MAP_FAILED)
+		(void)munmap(ctx->sq_mmap, ctx->sq_size);
+	if (ctx->ring_fd >= 0)
+		(void)close(ctx->ring_fd);
+}
+
+/*
+ *  stress_hdd_io_uring_submit()
+ *	io_uring engine, queue n read/write sqes and submit them
+ *	with one io_uring_enter call
+ */
+static int stress_hdd_io_uring_submit(
+	stress_hdd_ctx_t *ctx,
+	const bool write,
+	const uint32_t *slots,
+	const uint32_t n)
+{
+	unsigned tail = *ctx->sq_tail;
+	uint32_t i, submitted = 0;
+
+	for (i = 0; i < n; i++) {
+		const uint32_t slot = slots[i];
+		const unsigned index = tail & *ctx->sq_mask;
+		struct io_uring_sqe *sqe = &ctx->sqes[index];
+
+		(void)shim_memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+		sqe->fd = ctx->fd;
+		sqe->addr = (uint64_t)(uintptr_t)stress_hdd_slot_buf(ctx, slot);
+		sqe->len = (uint32_t)ctx->io_size;
+		sqe->off = ctx->offsets[slot];
+		sqe->user_data = (uint64_t)slot;
+		ctx->sq_array[index] = index;
+		tail++;
+	}
+	stress_asm_mb();
+	*ctx->sq_tail = tail;
+	stress_asm_mb();
+
+	while (submitted < n) {
+		const int ret = (int)syscall(__NR_io_uring_enter, ctx->ring_fd,
+					     n - submitted, 0, 0, NULL, 0);
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR) || (errno == EBUSY))
+				continue;
+			return -1;
+		}
+		submitted += (uint32_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_hdd_io_uring_reap()
+ *	io_uring engine, wait for at least min completions
+ */
+static int stress_hdd_io_uring_reap(stress_hdd_ctx_t *ctx, const uint32_t min)
+{
+	unsigned head;
+
+	stress_asm_mb();
+	if ((min > 0) && (*ctx->cq_head == *ctx->cq_tail)) {
+		if (syscall(__NR_io_uring_enter, ctx->ring_fd, 0, min,
+			    IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+			return (errno == EINTR) ? 0 : -1;
+	}
+	head = *ctx->cq_head;
+	for (;;) {
+		const struct io_uring_cqe *cqe;
+
+		stress_asm_mb();
+		if (head == *ctx->cq_tail)
+			break;
+		cqe = &ctx->cqes[head & *ctx->cq_mask];
+		stress_hdd_done(ctx, (uint32_t)cqe->user_data, (ssize_t)cqe->res);
+		head++;
+	}
+	*ctx->cq_head = head;
+	stress_asm_mb();
+	return 0;
+}
+#endif
+
+/* must match order of HDD_ENGINE_*, unsupported engines have no submit */
+static const stress_hdd_engine_t hdd_engines[] = {
+	{ "sync",	false,	NULL, NULL, NULL, NULL, NULL, NULL },
+	{ "psync",	false,	NULL, NULL, NULL, NULL,
+	  stress_hdd_psync_submit, stress_hdd_sync_reap },
+#if defined(HAVE_HDD_ENGINE_LIBAIO)
+	{ "libaio",	true,	stress_hdd_libaio_init, stress_hdd_libaio_deinit, NULL, NULL,
+	  stress_hdd_libaio_submit, stress_hdd_libaio_reap },
+#else
+	{ "libaio",	true,	NULL, NULL, NULL, NULL, NULL, NULL },
+#endif
+#if defined(HAVE_HDD_ENGINE_IO_URING)
+	{ "io_uring",	true,	stress_hdd_io_uring_init, stress_hdd_io_uring_deinit, NULL, NULL,
+	  stress_hdd_io_uring_submit, stress_hdd_io_uring_reap },
+#else
+	{ "io_uring",	true,	NULL, NULL, NULL, NULL, NULL, NULL },
+#endif
+#if defined(HAVE_MSYNC)
+	{ "mmap",	false,	NULL, NULL, stress_hdd_mmap_open, stress_hdd_mmap_close,
+	  stress_hdd_mmap_submit, stress_hdd_sync_reap },
+#else
+	{ "mmap",	false,	NULL, NULL, NULL, NULL, NULL, NULL },
+#endif
+};
+
+/*
+ *  stress_set_hdd_engine()
+ *	set the I/O engine
+ */
+static int stress_set_hdd_engine(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(hdd_engines); i++) {
+		if (!strcmp(hdd_engines[i].name, opt)) {
+			const int hdd_engine = (int)i;
+
+			return stress_set_setting("hdd-engine", TYPE_ID_INT, &hdd_engine);
+		}
+	}
+
+	(void)fprintf(stderr, "hdd-engine must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(hdd_engines); i++)
+		(void)fprintf(stderr, " %s", hdd_engines[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_hdd_iodepth(const char *opt)
+{
+	uint32_t hdd_iodepth;
+
+	hdd_iodepth = stress_get_uint32(opt);
+	stress_check_range("hdd-iodepth", (uint64_t)hdd_iodepth,
+		MIN_HDD_IODEPTH, MAX_HDD_IODEPTH);
+	return stress_set_setting("hdd-iodepth", TYPE_ID_UINT32, &hdd_iodepth);
+}
+
+/*
+ *  stress_hdd_engine_verify()
+ *	count bad bytes in a read, if the file was written sequentially
+ *	all of it must match, otherwise unwritten blocks read as zero
+ */
+static uint64_t stress_hdd_engine_verify(
+	const uint8_t *buf,
+	const uint64_t offset,
+	const size_t len,
+	const uint32_t instance,
+	const bool strict)
+{
+	uint64_t baddata = 0;
+	size_t j;
+
+	for (j = 0; j < len; j++) {
+		register const uint8_t v = data_value(offset, j, instance);
+
+		baddata += strict ? (buf[j] != v) : ((buf[j] != 0) && (buf[j] != v));
+	}
+	return baddata;
+}
+
+/*
+ *  stress_hdd_engine_pass()
+ *	one sequential or random, read or write pass over the file,
+ *	keeping up to iodepth I/Os in flight
+ */
+static int stress_hdd_engine_pass(
+	stress_hdd_ctx_t *ctx,
+	const stress_hdd_engine_t *engine,
+	const bool write,
+	const bool random,
+	stress_hdd_stats_t *stats)
+{
+	stress_args_t *args = ctx->args;
+	stress_hdd_io_stats_t *io_stats = write ? &stats->write : &stats->read;
+	const uint64_t n_blocks = ctx->file_size / ctx->io_size;
+	const bool verify = !write && !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const bool strict = !!(ctx->hdd_flags & HDD_OPT_WR_SEQ);
+	uint64_t issued = 0, to_issue = n_blocks, misreads = 0, baddata = 0;
+	uint32_t i, *slots = ctx->done_slots + ctx->iodepth, inflight = 0;
+	int rc = EXIT_SUCCESS;
+	const uint64_t t = stress_hdd_now_ns();
+
+	while ((issued < to_issue) || inflight) {
+		uint32_t n = 0;
+		uint64_t now;
+
+		if (!stress_continue(args))
+			to_issue = issued;
+
+		ctx->n_done = 0;
+		while (ctx->n_free && (issued < to_issue)) {
+			const uint32_t slot = ctx->free_slots[--ctx->n_free];
+			const uint64_t block = random ? stress_mwc64modn(n_blocks) : issued;
+
+			ctx->offsets[slot] = block * ctx->io_size;
+			if (write)
+				hdd_fill_buf(stress_hdd_slot_buf(ctx, slot), ctx->io_size,
+					ctx->offsets[slot], args->instance);
+			slots[n++] = slot;
+			issued++;
+		}
+		if (n) {
+			now = stress_hdd_now_ns();
+			for (i = 0; i < n; i++)
+				ctx->t_submit[slots[i]] = now;
+			if (engine->submit(ctx, write, slots, n) < 0) {
+				pr_fail("%s: %s engine %s submit failed, errno=%d (%s)\n",
+					args->name, engine->name, write ? "write" : "read",
+					errno, strerror(errno));
+				/* the slots are still on the free stack */
+				ctx->n_free += n;
+				to_issue = issued;
+				rc = EXIT_FAILURE;
+			} else {
+				inflight += n;
+			}
+		}
+		if (!inflight)
+			continue;
+		if (engine->reap(ctx, 1) < 0) {
+			pr_fail("%s: %s engine reap failed, errno=%d (%s)\n",
+				args->name, engine->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		now = stress_hdd_now_ns();
+		for (i = 0; i < ctx->n_done; i++) {
+			const uint32_t slot = ctx->done_slots[i];
+			const ssize_t res = ctx->done_res[i];
+
+			ctx->free_slots[ctx->n_free++] = slot;
+			inflight--;
+			if (res < 0) {
+				if ((res == -EAGAIN) || (res == -EINTR))
+					continue;
+				to_issue = issued;
+				if (res == -ENOSPC)
+					continue;
+				pr_fail("%s: %s engine %s failed, errno=%d (%s)\n",
+					args->name, engine->name, write ? "write" : "read",
+					(int)-res, strerror((int)-res));
+				rc = EXIT_FAILURE;
+				continue;
+			}
+			io_stats->bytes += (double)res;
+			stress_latency_add(&io_stats->latency, now - ctx->t_submit[slot]);
+			stress_bogo_inc(args);
+			if ((size_t)res != ctx->io_size)
+				misreads++;
+			if (verify)
+				baddata += stress_hdd_engine_verify(stress_hdd_slot_buf(ctx, slot),
+					ctx->offsets[slot], (size_t)res, args->instance, strict);
+		}
+	}
+	io_stats->duration += (double)(stress_hdd_now_ns() - t) / STRESS_DBL_NANOSECOND;
+
+	if (write)
+		stress_hdd_sync(ctx->fd, ctx->hdd_flags, &stats->sync);
+	if (misreads)
+		pr_dbg("%s: %" PRIu64 " incomplete %s %ss\n",
+			args->name, misreads, random ? "random" : "sequential",
+			write ? "write" : "read");
+	if (baddata) {
+		pr_fail("%s: incorrect data found %" PRIu64 " times\n",
+			args->name, baddata);
+		rc = EXIT_FAILURE;
+	}
+	return rc;
+}
+
+/*
+ *  stress_hdd_engine_run()
+ *	exercise the file with the same write then read passes as
+ *	the sync engine, but through the selected I/O engine
+ */
+static int stress_hdd_engine_run(
+	stress_hdd_ctx_t *ctx,
+	const stress_hdd_engine_t *engine,
+	stress_hdd_stats_t *stats)
+{
+	stress_args_t *args = ctx->args;
+	int rc = EXIT_SUCCESS;
+
+	/* full size file, so reads of unwritten blocks and the mmap engine work */
+	if (ftruncate(ctx->fd, (off_t)ctx->file_size) < 0) {
+		if (errno == ENOSPC)
+			return EXIT_SUCCESS;
+		pr_fail("%s: ftruncate failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (engine->open && (engine->open(ctx) < 0)) {
+		pr_fail("%s: %s engine failed to open file, errno=%d (%s)\n",
+			args->name, engine->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if ((rc == EXIT_SUCCESS) && (ctx->hdd_flags & HDD_OPT_WR_RND))
+		rc = stress_hdd_engine_pass(ctx, engine, true, true, stats);
+	if ((rc == EXIT_SUCCESS) && (ctx->hdd_flags & HDD_OPT_WR_SEQ))
+		rc = stress_hdd_engine_pass(ctx, engine, true, false, stats);
+	if ((rc == EXIT_SUCCESS) && (ctx->hdd_flags & HDD_OPT_RD_SEQ))
+		rc = stress_hdd_engine_pass(ctx, engine, false, false, stats);
+	if ((rc == EXIT_SUCCESS) && (ctx->hdd_flags & HDD_OPT_RD_RND))
+		rc = stress_hdd_engine_pass(ctx, engine, false, true, stats);
+	if (engine->close)
+		engine->close(ctx);
+	return rc;
+}
+
+static void stress_hdd_engine_free(stress_hdd_ctx_t *ctx)
+{
+	free(ctx->bufs);
+	free(ctx->done_res);
+	free(ctx->done_slots);
+	free(ctx->free_slots);
+	free(ctx->t_submit);
+	free(ctx->offsets);
+}
+
+/*
+ *  stress_hdd_engine_init()
+ *	allocate the iodepth slots and set up the engine
+ */
+static int stress_hdd_engine_init(
+	stress_hdd_ctx_t *ctx,
+	const stress_hdd_engine_t *engine)
+{
+	stress_args_t *args = ctx->args;
+	uint32_t i;
+	int ret;
+
+	if (!engine->submit) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: %s engine is not supported on this system, "
+				"skipping stressor\n", args->name, engine->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	ctx->slot_size = (ctx->io_size + BUF_ALIGNMENT - 1) & ~(size_t)(BUF_ALIGNMENT - 1);
+	ctx->offsets = (uint64_t *)calloc((size_t)ctx->iodepth, sizeof(*ctx->offsets));
+	ctx->t_submit = (uint64_t *)calloc((size_t)ctx->iodepth, sizeof(*ctx->t_submit));
+	ctx->free_slots = (uint32_t *)calloc((size_t)ctx->iodepth, sizeof(*ctx->free_slots));
+	/* done_slots is followed by the slots to submit scratch array */
+	ctx->done_slots = (uint32_t *)calloc((size_t)ctx->iodepth * 2, sizeof(*ctx->done_slots));
+	ctx->done_res = (ssize_t *)calloc((size_t)ctx->iodepth, sizeof(*ctx->done_res));
+#if defined(HAVE_POSIX_MEMALIGN)
+	ret = posix_memalign((void **)&ctx->bufs, BUF_ALIGNMENT, (size_t)ctx->iodepth * ctx->slot_size);
+	if (ret)
+		ctx->bufs = NULL;
+#else
+	ctx->bufs = NULL;
+#endif
+	if (!ctx->offsets || !ctx->t_submit || !ctx->free_slots || !ctx->done_slots || !ctx->done_res || !ctx->bufs) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " %s engine I/O slots, "
+			"skipping stressor\n", args->name, ctx->iodepth, engine->name);
+		stress_hdd_engine_free(ctx);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < ctx->iodepth; i++)
+		ctx->free_slots[i] = i;
+	ctx->n_free = ctx->iodepth;
+
+	if (engine->init && (engine->init(ctx) < 0)) {
+		ret = errno;
+
+		if (args->instance == 0)
+			pr_inf_skip("%s: %s engine setup failed, errno=%d (%s), "
+				"skipping stressor\n", args->name, engine->name,
+				ret, strerror(ret));
+		if (engine->deinit)
+			engine->deinit(ctx);
+		stress_hdd_engine_free(ctx);
+		return ((ret == ENOSYS) || (ret == EINVAL) || (ret == EPERM)) ?
+			EXIT_NOT_IMPLEMENTED : EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: using %s engine, %" PRIu32 " I/Os in flight\n",
+			args->name, engine->name, ctx->iodepth);
+	return EXIT_SUCCESS;
+}
+
+static void stress_hdd_engine_deinit(
+	stress_hdd_ctx_t *ctx,
+	const stress_hdd_engine_t *engine)
+{
+	if (engine->deinit)
+		engine->deinit(ctx);
+	stress_hdd_engine_free(ctx);
+}
+
+/*
+ *  stress_hdd_stats_merge()
+ *	accumulate src stats into dst
+ */
+static void stress_hdd_stats_merge(stress_hdd_stats_t *dst, const stress_hdd_stats_t *src)
+{
+	dst->read.bytes += src->read.bytes;
+	dst->read.duration += src->read.duration;
+	stress_latency_merge(&dst->read.latency, &src->read.latency);
+	dst->write.bytes += src->write.bytes;
+	dst->write.duration += src->write.duration;
+	stress_latency_merge(&dst->write.latency, &src->write.latency);
+	stress_latency_merge(&dst->sync, &src->sync);
+}
+
+static inline double stress_hdd_iops(const stress_hdd_io_stats_t *io_stats)
+{
+	return (io_stats->duration > 0.0) ?
+		(double)io_stats->latency.count / io_stats->duration : 0.0;
+}
+
+/*
+ *  stress_hdd_latency_metrics()
+ *	add p50, p99, p99.9 and max latency metrics of one operation type
+ */
+static void stress_hdd_latency_metrics(
+	stress_args_t *args,
+	const stress_latency_t *latency,
+	const char *type_name,
+	size_t *metric)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9, 100.0 };
+	static const char * const percentile_names[] = { "p50", "p99", "p99.9", "max" };
+	size_t i;
+
+	if (latency->count == 0)
+		return;
+
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		char description[64];
+
+		(void)snprintf(description, sizeof(description),
+			"nanosecs %s latency %s", type_name, percentile_names[i]);
+		stress_metrics_set(args, *metric, description,
+			(double)stress_latency_percentile(latency, percentiles[i]),
+			STRESS_GEOMETRIC_MEAN);
+		(*metric)++;
+	}
+}
+
+/*
+ *  stress_hdd_stats_report()
+ *	per hdd-opts combination IOPS and latencies of the aggressive
+ *	mode, too many to report as metrics
+ */
+static void stress_hdd_stats_report(
+	stress_args_t *args,
+	const stress_hdd_stats_t *stats_all,
+	const size_t n_stats)
+{
+	size_t i;
+
+	if (args->instance != 0)
+		return;
+
+	pr_inf("%s: %-14s %10s %10s %10s %10s %10s %10s %10s %10s\n", args->name,
+		"hdd-opts", "read IOPS", "p50 ns", "p99 ns", "p99.9 ns",
+		"write IOPS", "p50 ns", "p99 ns", "p99.9 ns");
+	for (i = 0; i < n_stats; i++) {
+		const stress_hdd_stats_t *stats = &stats_all[i];
+
+		if ((stats->read.latency.count == 0) && (stats->write.latency.count == 0))
+			continue;
+		pr_inf("%s: %-14s %10.0f %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+			" %10.0f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+			args->name, hdd_opts[i].opt,
+			stress_hdd_iops(&stats->read),
+			stress_latency_percentile(&stats->read.latency, 50.0),
+			stress_latency_percentile(&stats->read.latency, 99.0),
+			stress_latency_percentile(&stats->read.latency, 99.9),
+			stress_hdd_iops(&stats->write),
+			stress_latency_percentile(&stats->write.latency, 50.0),
+			stress_latency_percentile(&stats->write.latency, 99.0),
+			stress_latency_percentile(&stats->write.latency, 99.9));
+	}
+}
+
 /*
  *  stress_hdd
  *	stress I/O via writes
@@ -672,14 +1556,21 @@ static int stress_hdd(stress_args_t *args)
 	int hdd_flags = 0, hdd_oflags = 0;
 	int flags, fadvise_flags;
 	bool opts_set = false;
-	double hdd_read_bytes = 0.0, hdd_read_duration = 0.0;
-	double hdd_write_bytes = 0.0, hdd_write_duration = 0.0;
 	double hdd_rdwr_bytes, hdd_rdwr_duration;
 	double rate;
+	stress_hdd_stats_t *stats_all, *stats, *total;
+	size_t n_stats, metric = 0;
+	uint32_t hdd_iodepth = DEFAULT_HDD_IODEPTH;
+	int hdd_engine = HDD_ENGINE_SYNC;
+	const stress_hdd_engine_t *engine;
+	stress_hdd_ctx_t ctx;
 
 	(void)stress_get_setting("hdd-flags", &hdd_flags);
 	(void)stress_get_setting("hdd-oflags", &hdd_oflags);
 	(void)stress_get_setting("hdd-opts-set", &opts_set);
+	(void)stress_get_setting("hdd-engine", &hdd_engine);
+	(void)stress_get_setting("hdd-iodepth", &hdd_iodepth);
+	engine = &hdd_engines[hdd_engine];
 
 	flags = O_CREAT | O_RDWR | O_TRUNC | hdd_oflags;
 	fadvise_flags = hdd_flags & HDD_OPT_FADV_MASK;
@@ -763,10 +1654,43 @@ static int stress_hdd(stress_args_t *args)
 	}
 	buf = (uint8_t *)stress_align_address(alloc_buf, BUF_ALIGNMENT);
 #endif
-	(void)shim_memset(buf, stress_mwc8(), hdd_write_size);
+	stress_mwc_fill(buf, hdd_write_size);
+
+	/*
+	 *  one set of stats per hdd-opts combination, the aggressive
+	 *  mode works through them all, the last set is the total
+	 */
+	n_stats = (!opts_set && (g_opt_flags & OPT_FLAGS_AGGRESSIVE)) ?
+		SIZEOF_ARRAY(hdd_opts) : 1;
+	stats_all = (stress_hdd_stats_t *)calloc(n_stats + 1, sizeof(*stats_all));
+	if (!stats_all) {
+		pr_inf_skip("%s: cannot allocate I/O statistics, skipping stressor\n",
+			args->name);
+		free(alloc_buf);
+		(void)stress_temp_dir_rm_args(args);
+		return EXIT_NO_RESOURCE;
+	}
+	stats = &stats_all[0];
+	total = &stats_all[n_stats];
 	(void)stress_temp_filename_args(args,
 		filename, sizeof(filename), stress_mwc32());
 
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	if (hdd_engine != HDD_ENGINE_SYNC) {
+		ctx.args = args;
+		ctx.iodepth = engine->async ? hdd_iodepth : 1;
+		ctx.io_size = (size_t)hdd_write_size;
+		ctx.file_size = (hdd_bytes / hdd_write_size) * hdd_write_size;
+		rc = stress_hdd_engine_init(&ctx, engine);
+		if (rc != EXIT_SUCCESS) {
+			free(stats_all);
+			free(alloc_buf);
+			(void)stress_temp_dir_rm_args(args);
+			return rc;
+		}
+		rc = EXIT_FAILURE;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -790,6 +1714,7 @@ static int stress_hdd(stress_args_t *args)
 				hdd_flags |= HDD_OPT_WR_SEQ;
 			if ((hdd_flags & HDD_OPT_RD_MASK) == 0)
 				hdd_flags |= HDD_OPT_RD_SEQ;
+			stats = &stats_all[opt_index];
 		}
 
 		if ((fd = open(filename, flags, S_IRUSR | S_IWUSR)) < 0) {
@@ -853,6 +1778,16 @@ static int stress_hdd(stress_args_t *args)
 		stress_hdd_invalid_write(fd, buf);
 		stress_hdd_invalid_read(fd, buf);
 
+		if (hdd_engine != HDD_ENGINE_SYNC) {
+			ctx.fd = fd;
+			ctx.hdd_flags = hdd_flags;
+			ret = stress_hdd_engine_run(&ctx, engine, stats);
+			(void)close(fd);
+			if (ret != EXIT_SUCCESS)
+				goto finish;
+			continue;
+		}
+
 		/* Random Write */
 		if (hdd_flags & HDD_OPT_WR_RND) {
 			uint32_t w, z;
@@ -875,7 +1810,7 @@ rnd_wr_retry:
 
 				ret = stress_hdd_write(fd, buf, (off_t)offset,
 					hdd_write_size, hdd_flags,
-					&hdd_write_bytes, &hdd_write_duration);
+					stats);
 				if (ret <= 0) {
 					if ((errno == EAGAIN) || (errno == EINTR))
 						goto rnd_wr_retry;
@@ -909,7 +1844,7 @@ seq_wr_retry:
 				errno = 0;
 				ret = stress_hdd_write(fd, buf, (off_t)i,
 					hdd_write_size, hdd_flags,
-					&hdd_write_bytes, &hdd_write_duration);
+					stats);
 				if (ret <= 0) {
 					if ((errno == EAGAIN) || (errno == EINTR))
 						goto seq_wr_retry;
@@ -946,7 +1881,7 @@ seq_rd_retry:
 				}
 				ret = stress_hdd_read(fd, buf, (off_t)i,
 					hdd_write_size, hdd_flags,
-					&hdd_read_bytes, &hdd_read_duration);
+					stats);
 				if (ret <= 0) {
 					if ((errno == EAGAIN) || (errno == EINTR))
 						goto seq_rd_retry;
@@ -1019,7 +1954,7 @@ rnd_rd_retry:
 				}
 				ret = stress_hdd_read(fd, buf, (off_t)offset,
 					hdd_write_size, hdd_flags,
-					&hdd_read_bytes, &hdd_read_duration);
+					stats);
 				if (ret <= 0) {
 					if ((errno == EAGAIN) || (errno == EINTR))
 						goto rnd_rd_retry;
@@ -1072,20 +2007,37 @@ yielded:
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	rate = (hdd_read_duration > 0.0) ? hdd_read_bytes / hdd_read_duration : 0.0;
-	stress_metrics_set(args, 0, "MB/sec read rate",
+	for (i = 0; i < n_stats; i++)
+		stress_hdd_stats_merge(total, &stats_all[i]);
+
+	rate = (total->read.duration > 0.0) ? total->read.bytes / total->read.duration : 0.0;
+	stress_metrics_set(args, metric++, "MB/sec read rate",
 		rate / (double)MB, STRESS_HARMONIC_MEAN);
-	rate = (hdd_write_duration > 0.0) ? hdd_write_bytes / hdd_write_duration : 0.0;
-	stress_metrics_set(args, 1, "MB/sec write rate",
+	rate = (total->write.duration > 0.0) ? total->write.bytes / total->write.duration : 0.0;
+	stress_metrics_set(args, metric++, "MB/sec write rate",
 		rate / (double)MB, STRESS_HARMONIC_MEAN);
 
-	hdd_rdwr_duration = hdd_read_duration + hdd_write_duration;
-	hdd_rdwr_bytes = hdd_read_bytes + hdd_write_bytes;
+	hdd_rdwr_duration = total->read.duration + total->write.duration;
+	hdd_rdwr_bytes = total->read.bytes + total->write.bytes;
 
 	rate = (hdd_rdwr_duration > 0.0) ? hdd_rdwr_bytes / hdd_rdwr_duration : 0.0;
-	stress_metrics_set(args, 2, "MB/sec read/write combined rate",
+	stress_metrics_set(args, metric++, "MB/sec read/write combined rate",
 		rate / (double)MB, STRESS_HARMONIC_MEAN);
-
+	stress_metrics_set(args, metric++, "read IOPS",
+		stress_hdd_iops(&total->read), STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, metric++, "write IOPS",
+		stress_hdd_iops(&total->write), STRESS_HARMONIC_MEAN);
+	stress_hdd_latency_metrics(args, &total->read.latency, "read", &metric);
+	stress_hdd_latency_metrics(args, &total->write.latency, "write", &metric);
+	stress_hdd_latency_metrics(args, &total->sync, "sync", &metric);
+	stress_latency_merge(args->latency, &total->read.latency);
+	stress_latency_merge(args->latency, &total->write.latency);
+	if (n_stats > 1)
+		stress_hdd_stats_report(args, stats_all, n_stats);
+
+	if (hdd_engine != HDD_ENGINE_SYNC)
+		stress_hdd_engine_deinit(&ctx, engine);
+	free(stats_all);
 	free(alloc_buf);
 	(void)stress_temp_dir_rm_args(args);
 	return rc;
@@ -1093,6 +2045,8 @@ finish:
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_hdd_bytes,	stress_set_hdd_bytes },
+	{ OPT_hdd_engine,	stress_set_hdd_engine },
+	{ OPT_hdd_iodepth,	stress_set_hdd_iodepth },
 	{ OPT_hdd_opts,		stress_set_hdd_opts },
 	{ OPT_hdd_write_size,	stress_set_hdd_write_size },
 	{ 0,			NULL },
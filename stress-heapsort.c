@@ -26,12 +26,14 @@
 
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
+static stress_sort_dist_stats_t dist_stats[STRESS_SORT_DIST_MAX];
 
 static const stress_help_t help[] = {
 	{ NULL,	"heapsort N",	   	"start N workers heap sorting 32 bit random integers" },
-	{ NULL, "heapsort-method M",	"select sort method [ heapsort-libc | heapsort-nonlibc" },
+	{ NULL, "heapsort-method M",	"select sort method [ heapsort-libc | heapsort-nonlibc | heapsort-parallel ]" },
 	{ NULL,	"heapsort-ops N",	"stop after N heap sort bogo operations" },
 	{ NULL,	"heapsort-size N",	"number of 32 bit integers to sort" },
+	{ NULL,	"heapsort-threads N",	"number of threads for the heapsort-parallel method" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -40,8 +42,11 @@ typedef int (*heapsort_func_t)(void *base, size_t nmemb, size_t size, int (*comp
 typedef struct {
 	const char *name;
 	const heapsort_func_t heapsort_func;
+	const bool counted;		/* comparator calls are counted */
 } stress_heapsort_method_t;
 
+static uint32_t heapsort_threads;
+
 static inline OPTIMIZE3 void heapsort_swap(void *p1, void *p2, register size_t size)
 {
 	switch (size) {
@@ -185,11 +190,27 @@ static int heapsort_nonlibc(
 	return 0;
 }
 
+static void heapsort_nonlibc_chunk(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
+{
+	(void)heapsort_nonlibc(base, nmemb, size, compar);
+}
+
+/*
+ *  heapsort_parallel()
+ *	non-libc heapsort of a chunk per thread followed by parallel merges
+ */
+static int heapsort_parallel(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
+{
+	stress_sort_parallel(base, nmemb, size, compar, heapsort_nonlibc_chunk, heapsort_threads);
+	return 0;
+}
+
 static const stress_heapsort_method_t stress_heapsort_methods[] = {
 #if defined(HAVE_LIB_BSD)
-	{ "heapsort-libc",		heapsort },
+	{ "heapsort-libc",		heapsort,		true },
 #endif
-	{ "heapsort-nonlibc",		heapsort_nonlibc },
+	{ "heapsort-nonlibc",		heapsort_nonlibc,	true },
+	{ "heapsort-parallel",		heapsort_parallel,	false },
 };
 
 static int stress_set_heapsort_method(const char *opt)
@@ -225,9 +246,24 @@ static int stress_set_heapsort_size(const char *opt)
 	return stress_set_setting("heapsort-size", TYPE_ID_UINT64, &heapsort_size);
 }
 
+/*
+ *  stress_set_heapsort_threads()
+ *	set number of heapsort-parallel threads
+ */
+static int stress_set_heapsort_threads(const char *opt)
+{
+	uint32_t threads;
+
+	threads = stress_get_uint32(opt);
+	stress_check_range("heapsort-threads", (uint64_t)threads,
+		1, STRESS_SORT_THREADS_MAX);
+	return stress_set_setting("heapsort-threads", TYPE_ID_UINT32, &threads);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_heapsort_size,	stress_set_heapsort_size },
 	{ OPT_heapsort_method,	stress_set_heapsort_method },
+	{ OPT_heapsort_threads,	stress_set_heapsort_threads },
 	{ 0,				NULL }
 };
 
@@ -258,9 +294,12 @@ static int stress_heapsort(stress_args_t *args)
 	int ret;
 	double rate;
 	NOCLOBBER double duration = 0.0, count = 0.0, sorted = 0.0;
+	NOCLOBBER double libc_rate;
 	heapsort_func_t heapsort_func;
 
 	(void)stress_get_setting("heapsort-method", &heapsort_method);
+	heapsort_threads = stress_sort_threads_default();
+	(void)stress_get_setting("heapsort-threads", &heapsort_threads);
 
 	heapsort_func = stress_heapsort_methods[heapsort_method].heapsort_func;
 	if (args->instance == 0)
@@ -297,12 +336,14 @@ static int stress_heapsort(stress_args_t *args)
 	}
 
 	stress_sort_data_int32_init(data, n);
+	libc_rate = stress_sort_int32_libc_rate(data, n);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
 		double t;
+		size_t dist;
 
-		stress_sort_data_int32_shuffle(data, n);
+		dist = stress_sort_data_int32_dist(data, n, stress_bogo_get(args));
 
 		/* Sort "random" data */
 		stress_sort_compare_reset();
@@ -311,8 +352,11 @@ static int stress_heapsort(stress_args_t *args)
 			pr_fail("%s: heapsort of random data failed: %d (%s)\n",
 				args->name, errno, strerror(errno));
 		} else {
-			duration += stress_time_now() - t;
+			t = stress_time_now() - t;
+			duration += t;
 			count += (double)stress_sort_compare_get();
+			stress_sort_dist_stats_add(dist_stats, dist,
+				(double)stress_sort_compare_get(), n, t);
 			sorted += (double)n;
 			if (g_opt_flags & OPT_FLAGS_VERIFY) {
 				for (ptr = data, i = 0; i < n - 1; i++, ptr++) {
@@ -386,11 +430,24 @@ static int stress_heapsort(stress_args_t *args)
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 tidy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	rate = (duration > 0.0) ? count / duration : 0.0;
-	stress_metrics_set(args, 0, "heapsort comparisons per sec",
+	if (stress_heapsort_methods[heapsort_method].counted) {
+		rate = (duration > 0.0) ? count / duration : 0.0;
+		stress_metrics_set(args, 0, "heapsort comparisons per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "heapsort comparisons per item",
+			count / sorted, STRESS_HARMONIC_MEAN);
+	}
+	rate = (duration > 0.0) ? sorted / duration : 0.0;
+	stress_metrics_set(args, 2, "elements sorted per sec",
 		rate, STRESS_HARMONIC_MEAN);
-	stress_metrics_set(args, 1, "heapsort comparisons per item",
-		count / sorted, STRESS_HARMONIC_MEAN);
+	/* compare the random data sorts with the libc qsort baseline */
+	if ((libc_rate > 0.0) && (dist_stats[STRESS_SORT_DIST_RANDOM].duration > 0.0))
+		stress_metrics_set(args, 3, "speedup over libc qsort",
+			(dist_stats[STRESS_SORT_DIST_RANDOM].sorted /
+			 dist_stats[STRESS_SORT_DIST_RANDOM].duration) / libc_rate,
+			STRESS_GEOMETRIC_MEAN);
+	stress_sort_dist_metrics(args, 4, "heapsort", dist_stats,
+		stress_heapsort_methods[heapsort_method].counted);
 
 	free(data);
 
@@ -197,7 +197,7 @@ static int stress_hrtimers(stress_args_t *args)
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
-	lock = stress_lock_create();
+	lock = stress_lock_create("hrtimers");
 	if (!lock) {
 		pr_inf("%s: cannot create lock, skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-open-hash.h"
 
 #if defined(HAVE_SEARCH_H) && 	\
      defined(HAVE_HSEARCH)
@@ -42,19 +43,25 @@ typedef struct {
 typedef int (*hcreate_func_t)(size_t nel);
 typedef ENTRY *(*hsearch_func_t)(ENTRY item, ACTION action);
 typedef void (*hdestroy_func_t)(void);
+typedef bool (*hdelete_func_t)(char *key);
+typedef size_t (*hbytes_func_t)(void);
 
 typedef struct {
 	const char *name;
 	hcreate_func_t hcreate;
 	hsearch_func_t hsearch;
 	hdestroy_func_t hdestroy;
+	hdelete_func_t hdelete;	/* NULL if items cannot be deleted */
+	hbytes_func_t hbytes;	/* NULL if table size is not known */
 } stress_hsearch_method_t;
 
 static const stress_help_t help[] = {
-	{ NULL,	"hsearch N",	  "start N workers that exercise a hash table search" },
-	{ NULL,	"hsearch-ops N",  "stop after N hash search bogo operations" },
-	{ NULL,	"hsearch-size N", "number of integers to insert into hash table" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"hsearch N",	    "start N workers that exercise a hash table search" },
+	{ NULL,	"hsearch-method M", "select hash table method: hsearch-libc, hsearch-nonlibc, "
+				    "hsearch-robinhood, hsearch-swiss" },
+	{ NULL,	"hsearch-ops N",    "stop after N hash search bogo operations" },
+	{ NULL,	"hsearch-size N",   "number of integers to insert into hash table" },
+	{ NULL,	NULL,		    NULL }
 };
 
 typedef struct {
@@ -90,6 +97,11 @@ static void hdestroy_nonlibc(void)
 	htable_size = 0;
 }
 
+static size_t hbytes_nonlibc(void)
+{
+	return htable_size * sizeof(*htable);
+}
+
 static ENTRY OPTIMIZE3 *hsearch_nonlibc(ENTRY entry, ACTION action)
 {
 	register uint32_t idx, idx_start;
@@ -134,12 +146,91 @@ static ENTRY OPTIMIZE3 *hsearch_nonlibc(ENTRY entry, ACTION action)
 	return NULL;
 }
 
+static stress_open_hash_t *open_htable;
+
+/*
+ *  open_hash_str_hash()
+ *	64 bit FNV-1a hash of a key string
+ */
+static uint64_t OPTIMIZE3 open_hash_str_hash(const uint64_t key)
+{
+	register const uint8_t *ptr = (const uint8_t *)(uintptr_t)key;
+	register uint64_t hash = 0xcbf29ce484222325ULL;
+
+	while (*ptr) {
+		hash ^= *(ptr++);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static bool OPTIMIZE3 open_hash_str_eq(const uint64_t key1, const uint64_t key2)
+{
+	return strcmp((const char *)(uintptr_t)key1, (const char *)(uintptr_t)key2) == 0;
+}
+
+static int hcreate_open_hash(const stress_open_hash_type_t type, size_t nel)
+{
+	open_htable = stress_open_hash_create(type, nel, open_hash_str_hash, open_hash_str_eq);
+	if (!open_htable) {
+		errno = ENOMEM;
+		return 0;
+	}
+	return 1;
+}
+
+static int hcreate_robinhood(size_t nel)
+{
+	return hcreate_open_hash(STRESS_OPEN_HASH_ROBINHOOD, nel);
+}
+
+static int hcreate_swiss(size_t nel)
+{
+	return hcreate_open_hash(STRESS_OPEN_HASH_SWISS, nel);
+}
+
+static void hdestroy_open_hash(void)
+{
+	stress_open_hash_destroy(open_htable);
+	open_htable = NULL;
+}
+
+static bool hdelete_open_hash(char *key)
+{
+	return stress_open_hash_del(open_htable, (uint64_t)(uintptr_t)key);
+}
+
+static size_t hbytes_open_hash(void)
+{
+	return stress_open_hash_bytes(open_htable);
+}
+
+static ENTRY OPTIMIZE3 *hsearch_open_hash(ENTRY entry, ACTION action)
+{
+	static ENTRY found;
+	const uint64_t key = (uint64_t)(uintptr_t)entry.key;
+	uint64_t *value;
+
+	if (action == FIND) {
+		value = stress_open_hash_get(open_htable, key);
+	} else {
+		value = stress_open_hash_put(open_htable, key, (uint64_t)(uintptr_t)entry.data);
+	}
+	if (!value)
+		return NULL;
+	found.key = entry.key;
+	found.data = (void *)(uintptr_t)*value;
+	return &found;
+}
+
 static const stress_hsearch_method_t stress_hsearch_methods[] = {
 #if defined(HAVE_SEARCH_H) &&	\
     defined(HAVE_HSEARCH)
-	{ "hsearch-libc",	hcreate,	 hsearch,	hdestroy },
+	{ "hsearch-libc",	hcreate,	   hsearch,	      hdestroy,		  NULL,		     NULL },
 #endif
-	{ "hsearch-nonlibc",	hcreate_nonlibc, hsearch_nonlibc, hdestroy_nonlibc },
+	{ "hsearch-nonlibc",	hcreate_nonlibc,   hsearch_nonlibc,   hdestroy_nonlibc,	  NULL,		     hbytes_nonlibc },
+	{ "hsearch-robinhood",	hcreate_robinhood, hsearch_open_hash, hdestroy_open_hash, hdelete_open_hash, hbytes_open_hash },
+	{ "hsearch-swiss",	hcreate_swiss,	   hsearch_open_hash, hdestroy_open_hash, hdelete_open_hash, hbytes_open_hash },
 };
 
 
@@ -196,12 +287,16 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 	hsearch_func_t hsearch_func;
 	hcreate_func_t hcreate_func;
 	hdestroy_func_t hdestroy_func;
+	hdelete_func_t hdelete_func;
 	size_t hsearch_method = 0;
+	double t, put_duration = 0.0, get_duration = 0.0, del_duration = 0.0, rate;
+	uint64_t put_ops = 0, get_ops = 0, del_ops = 0;
 
 	(void)stress_get_setting("hsearch-method", &hsearch_method);
 	hcreate_func = stress_hsearch_methods[hsearch_method].hcreate;
 	hsearch_func = stress_hsearch_methods[hsearch_method].hsearch;
 	hdestroy_func = stress_hsearch_methods[hsearch_method].hdestroy;
+	hdelete_func = stress_hsearch_methods[hsearch_method].hdelete;
 	if (!stress_get_setting("hsearch-size", &hsearch_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			hsearch_size = MAX_HSEARCH_SIZE;
@@ -223,10 +318,8 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 		goto free_hash;
 	}
 
-	/* Populate hash, make it 100% full for worst performance */
 	for (i = 0; i < max; i++) {
 		char buffer[32];
-		ENTRY e;
 
 		(void)snprintf(buffer, sizeof(buffer), "%zu", i);
 		keys[i] = strdup(buffer);
@@ -234,6 +327,12 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 			pr_err("%s: cannot allocate key\n", args->name);
 			goto free_all;
 		}
+	}
+
+	/* Populate hash, make it 100% full for worst performance */
+	t = stress_time_now();
+	for (i = 0; i < max; i++) {
+		ENTRY e;
 
 		e.key = keys[i];
 		e.data = (void *)i;
@@ -243,10 +342,13 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 			goto free_all;
 		}
 	}
+	put_duration += stress_time_now() - t;
+	put_ops += max;
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
+		t = stress_time_now();
 		for (i = 0; stress_continue_flag() && (i < max); i++) {
 			ENTRY e, *ep;
 
@@ -263,9 +365,50 @@ static int OPTIMIZE3 stress_hsearch(stress_args_t *args)
 				}
 			}
 		}
+		get_duration += stress_time_now() - t;
+		get_ops += i;
+
+		/* Empty and re-populate the hash if items can be deleted */
+		if (hdelete_func && stress_continue_flag()) {
+			t = stress_time_now();
+			for (i = 0; i < max; i++) {
+				if (!hdelete_func(keys[i]) && verify)
+					pr_fail("%s: cannot delete key %s\n", args->name, keys[i]);
+			}
+			del_duration += stress_time_now() - t;
+			del_ops += max;
+
+			t = stress_time_now();
+			for (i = 0; i < max; i++) {
+				ENTRY e;
+
+				e.key = keys[i];
+				e.data = (void *)i;
+
+				if (hsearch_func(e, ENTER) == NULL) {
+					pr_fail("%s: cannot re-add hash item %s\n", args->name, keys[i]);
+					goto free_all;
+				}
+			}
+			put_duration += stress_time_now() - t;
+			put_ops += max;
+		}
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
+	rate = (put_duration > 0.0) ? (double)put_ops / put_duration : 0.0;
+	stress_metrics_set(args, 0, "puts per sec", rate, STRESS_HARMONIC_MEAN);
+	rate = (get_duration > 0.0) ? (double)get_ops / get_duration : 0.0;
+	stress_metrics_set(args, 1, "gets per sec", rate, STRESS_HARMONIC_MEAN);
+	if (hdelete_func) {
+		rate = (del_duration > 0.0) ? (double)del_ops / del_duration : 0.0;
+		stress_metrics_set(args, 2, "deletes per sec", rate, STRESS_HARMONIC_MEAN);
+	}
+	if (stress_hsearch_methods[hsearch_method].hbytes) {
+		rate = (double)stress_hsearch_methods[hsearch_method].hbytes() / (double)max;
+		stress_metrics_set(args, 3, "bytes per entry", rate, STRESS_GEOMETRIC_MEAN);
+	}
+
 	ret = EXIT_SUCCESS;
 
 free_all:
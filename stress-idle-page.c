@@ -23,12 +23,39 @@
 
 static const char bitmap_file[] = "/sys/kernel/mm/page_idle/bitmap";
 
+#define MIN_IDLE_PAGE_INTERVAL	(10)		/* milliseconds */
+#define MAX_IDLE_PAGE_INTERVAL	(60000)
+#define DEFAULT_IDLE_PAGE_INTERVAL (1000)
+
 static const stress_help_t help[] = {
 	{ NULL,	"idle-page N",	   "start N idle page scanning workers" },
+	{ NULL,	"idle-page-interval N", "working set sampling interval in milliseconds" },
 	{ NULL,	"idle-page-ops N", "stop after N idle page scan bogo operations" },
+	{ NULL,	"idle-page-wss S", "estimate the hot working set of stressor S" },
 	{ NULL, NULL,		   NULL }
 };
 
+static int stress_set_idle_page_interval(const char *opt)
+{
+	uint64_t idle_page_interval;
+
+	idle_page_interval = stress_get_uint64(opt);
+	stress_check_range("idle-page-interval", idle_page_interval,
+		MIN_IDLE_PAGE_INTERVAL, MAX_IDLE_PAGE_INTERVAL);
+	return stress_set_setting("idle-page-interval", TYPE_ID_UINT64, &idle_page_interval);
+}
+
+static int stress_set_idle_page_wss(const char *opt)
+{
+	return stress_set_setting("idle-page-wss", TYPE_ID_STR, opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_idle_page_interval,	stress_set_idle_page_interval },
+	{ OPT_idle_page_wss,		stress_set_idle_page_wss },
+	{ 0,				NULL }
+};
+
 /*
  *  stress_idle_page_supported()
  *      check if we can run this as root
@@ -61,6 +88,312 @@ static int stress_idle_page_supported(const char *name)
 #define BITMAP_BYTES	(8)
 #define PAGES_TO_SCAN	(64)
 
+#define IDLE_PAGE_MAX_PIDS	(256)		/* max monitored processes */
+#define IDLE_PAGE_MAX_SAMPLES	(4096)		/* max time series samples */
+#define IDLE_PAGE_MAX_PFNS	(64 * 1024 * 1024)	/* max tracked pages */
+#define IDLE_PAGE_PAGEMAP_BATCH	(512)		/* pagemap entries per read */
+
+#define PAGEMAP_PRESENT		(1ULL << 63)
+#define PAGEMAP_PFN_MASK	((1ULL << 55) - 1)
+
+/* a working set sample */
+typedef struct {
+	double time;		/* time since start of monitoring */
+	uint32_t pids;		/* processes monitored */
+	uint64_t resident;	/* resident pages */
+	uint64_t hot;		/* pages accessed in the interval */
+} stress_idle_page_sample_t;
+
+/* page frame numbers of the resident pages of the monitored processes */
+typedef struct {
+	uint64_t *pfns;		/* page frame numbers */
+	size_t n;		/* number of pfns */
+	size_t size;		/* allocated size of pfns */
+} stress_idle_page_pfns_t;
+
+/*
+ *  stress_idle_page_pfn_add()
+ *	add a page frame number, returns -1 if out of memory or full
+ */
+static int stress_idle_page_pfn_add(stress_idle_page_pfns_t *p, const uint64_t pfn)
+{
+	if (p->n >= p->size) {
+		uint64_t *pfns;
+		size_t size = p->size ? p->size * 2 : 65536;
+
+		if (size > IDLE_PAGE_MAX_PFNS)
+			return -1;
+		pfns = (uint64_t *)realloc(p->pfns, size * sizeof(*pfns));
+		if (!pfns)
+			return -1;
+		p->pfns = pfns;
+		p->size = size;
+	}
+	p->pfns[p->n++] = pfn;
+	return 0;
+}
+
+/*
+ *  stress_idle_page_pfn_cmp()
+ *	qsort comparison on page frame number
+ */
+static int stress_idle_page_pfn_cmp(const void *p1, const void *p2)
+{
+	const uint64_t pfn1 = *(const uint64_t *)p1;
+	const uint64_t pfn2 = *(const uint64_t *)p2;
+
+	return (pfn1 < pfn2) ? -1 : (pfn1 > pfn2);
+}
+
+/*
+ *  stress_idle_page_pids()
+ *	find the processes of the named stressor, these are the
+ *	descendants of the stress-ng parent with a matching name
+ */
+static size_t stress_idle_page_pids(const char *stressor, pid_t *pids)
+{
+	const pid_t self = getpid();
+	const pid_t parent = getppid();
+	char comm_name[64];
+	size_t n = 0, len;
+	DIR *dir;
+	struct dirent *d;
+
+	(void)snprintf(comm_name, sizeof(comm_name), "%s-%s", g_app_name, stressor);
+	/* the kernel comm field is truncated to 15 chars */
+	len = STRESS_MINIMUM(strlen(comm_name), (size_t)15);
+
+	dir = opendir("/proc");
+	if (!dir)
+		return 0;
+	while (((d = readdir(dir)) != NULL) && (n < IDLE_PAGE_MAX_PIDS)) {
+		char path[PATH_MAX], buf[256];
+		pid_t pid, ppid;
+		int depth;
+		char *ptr;
+
+		if (!isdigit((unsigned char)d->d_name[0]))
+			continue;
+		pid = (pid_t)atoi(d->d_name);
+		if (pid == self)
+			continue;
+		(void)snprintf(path, sizeof(path), "/proc/%d/comm", (int)pid);
+		if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+			continue;
+		if (strncmp(buf, comm_name, len))
+			continue;
+
+		/* the process must descend from our stress-ng parent */
+		for (ppid = pid, depth = 0; (depth < 8) && (ppid > 1); depth++) {
+			(void)snprintf(path, sizeof(path), "/proc/%d/stat", (int)ppid);
+			if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+				break;
+			/* skip past the comm, it may contain spaces */
+			ptr = strrchr(buf, ')');
+			if (!ptr || (sscanf(ptr + 1, " %*c %d", &ppid) != 1))
+				break;
+			if (ppid == parent) {
+				pids[n++] = pid;
+				break;
+			}
+		}
+	}
+	(void)closedir(dir);
+
+	return n;
+}
+
+/*
+ *  stress_idle_page_resident()
+ *	add the page frame numbers of the resident pages of a process
+ */
+static void stress_idle_page_resident(
+	const pid_t pid,
+	const size_t page_size,
+	stress_idle_page_pfns_t *p)
+{
+	char path[PATH_MAX], buf[512];
+	FILE *fp;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "/proc/%d/pagemap", (int)pid);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	(void)snprintf(path, sizeof(path), "/proc/%d/maps", (int)pid);
+	fp = fopen(path, "r");
+	if (!fp) {
+		(void)close(fd);
+		return;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		uint64_t begin, end, addr;
+
+		if (sscanf(buf, "%" SCNx64 "-%" SCNx64, &begin, &end) != 2)
+			continue;
+		/* vsyscall is not in the page tables */
+		if (strstr(buf, "[vsyscall]"))
+			continue;
+
+		for (addr = begin; addr < end; ) {
+			uint64_t entries[IDLE_PAGE_PAGEMAP_BATCH];
+			const size_t n = STRESS_MINIMUM((size_t)((end - addr) / page_size),
+						(size_t)IDLE_PAGE_PAGEMAP_BATCH);
+			const off_t offset = (off_t)((addr / page_size) * sizeof(uint64_t));
+			ssize_t ret;
+			size_t i;
+
+			if (n == 0)
+				break;
+			ret = pread(fd, entries, n * sizeof(uint64_t), offset);
+			if (ret <= 0)
+				break;
+			for (i = 0; i < (size_t)ret / sizeof(uint64_t); i++) {
+				const uint64_t pfn = entries[i] & PAGEMAP_PFN_MASK;
+
+				if ((entries[i] & PAGEMAP_PRESENT) && pfn) {
+					if (stress_idle_page_pfn_add(p, pfn) < 0)
+						goto done;
+				}
+			}
+			addr += n * page_size;
+		}
+	}
+done:
+	(void)fclose(fp);
+	(void)close(fd);
+}
+
+/*
+ *  stress_idle_page_mark()
+ *	set the idle bits of the sorted page frame numbers
+ */
+static void stress_idle_page_mark(const int fd, const stress_idle_page_pfns_t *p)
+{
+	size_t i = 0;
+
+	while (i < p->n) {
+		const uint64_t word = p->pfns[i] / 64;
+		uint64_t bits = 0;
+
+		for (; (i < p->n) && (p->pfns[i] / 64 == word); i++)
+			bits |= 1ULL << (p->pfns[i] & 63);
+		VOID_RET(ssize_t, pwrite(fd, &bits, sizeof(bits), (off_t)(word * sizeof(bits))));
+	}
+}
+
+/*
+ *  stress_idle_page_hot()
+ *	count the sorted page frame numbers that are no longer idle
+ */
+static uint64_t stress_idle_page_hot(const int fd, const stress_idle_page_pfns_t *p)
+{
+	uint64_t hot = 0;
+	size_t i = 0;
+
+	while (i < p->n) {
+		const uint64_t word = p->pfns[i] / 64;
+		uint64_t bits = ~0ULL;
+
+		if (pread(fd, &bits, sizeof(bits), (off_t)(word * sizeof(bits))) != (ssize_t)sizeof(bits))
+			bits = ~0ULL;
+		for (; (i < p->n) && (p->pfns[i] / 64 == word); i++)
+			hot += !(bits & (1ULL << (p->pfns[i] & 63)));
+	}
+	return hot;
+}
+
+/*
+ *  stress_idle_page_wss()
+ *	estimate the hot working set of the processes of another
+ *	stressor using idle page tracking, every interval the resident
+ *	pages are marked idle and the pages accessed since are counted
+ */
+static int stress_idle_page_wss(stress_args_t *args, const int fd, const char *stressor)
+{
+	const size_t page_size = args->page_size;
+	const double mb = (double)page_size / (double)MB;
+	uint64_t idle_page_interval = DEFAULT_IDLE_PAGE_INTERVAL;
+	stress_idle_page_sample_t *samples;
+	stress_idle_page_pfns_t pfns;
+	pid_t pids[IDLE_PAGE_MAX_PIDS];
+	size_t n_samples = 0, i;
+	double t_start, hot_sum = 0.0, hot_max = 0.0, resident_sum = 0.0;
+	bool warned = false;
+
+	(void)stress_get_setting("idle-page-interval", &idle_page_interval);
+
+	samples = (stress_idle_page_sample_t *)calloc(IDLE_PAGE_MAX_SAMPLES, sizeof(*samples));
+	if (!samples) {
+		pr_inf_skip("%s: cannot allocate working set samples, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(&pfns, 0, sizeof(pfns));
+
+	pr_inf("%s: estimating the hot working set of the %s stressor every %" PRIu64 " ms\n",
+		args->name, stressor, idle_page_interval);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
+	do {
+		stress_idle_page_sample_t *sample = &samples[n_samples];
+		const size_t n_pids = stress_idle_page_pids(stressor, pids);
+
+		pfns.n = 0;
+		for (i = 0; i < n_pids; i++)
+			stress_idle_page_resident(pids[i], page_size, &pfns);
+		if ((n_pids > 0) && (pfns.n == 0) && !warned) {
+			pr_inf("%s: no page frame numbers in /proc/pid/pagemap, "
+				"CAP_SYS_ADMIN is required\n", args->name);
+			warned = true;
+		}
+		qsort(pfns.pfns, pfns.n, sizeof(*pfns.pfns), stress_idle_page_pfn_cmp);
+		stress_idle_page_mark(fd, &pfns);
+
+		(void)shim_nanosleep_uint64(idle_page_interval * 1000000ULL);
+		if (!stress_continue_flag())
+			break;
+
+		sample->time = stress_time_now() - t_start;
+		sample->pids = (uint32_t)n_pids;
+		sample->resident = pfns.n;
+		sample->hot = stress_idle_page_hot(fd, &pfns);
+		hot_sum += (double)sample->hot;
+		resident_sum += (double)sample->resident;
+		if ((double)sample->hot > hot_max)
+			hot_max = (double)sample->hot;
+		n_samples++;
+		stress_bogo_inc(args);
+	} while ((n_samples < IDLE_PAGE_MAX_SAMPLES) && stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	pr_inf("%s: %10s %6s %12s %12s %7s\n", args->name,
+		"time (s)", "pids", "resident MB", "hot MB", "hot %");
+	for (i = 0; i < n_samples; i++) {
+		const stress_idle_page_sample_t *sample = &samples[i];
+
+		pr_inf("%s: %10.2f %6" PRIu32 " %12.2f %12.2f %7.2f\n", args->name,
+			sample->time, sample->pids, (double)sample->resident * mb,
+			(double)sample->hot * mb, sample->resident ?
+			100.0 * (double)sample->hot / (double)sample->resident : 0.0);
+	}
+	if (n_samples > 0) {
+		stress_metrics_set(args, 0, "MB mean hot working set",
+			(hot_sum * mb) / (double)n_samples, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 1, "MB max hot working set",
+			hot_max * mb, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "MB mean resident set",
+			(resident_sum * mb) / (double)n_samples, STRESS_GEOMETRIC_MEAN);
+	}
+
+	free(pfns.pfns);
+	free(samples);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_idle_page
  *	stress page scanning
@@ -70,6 +403,7 @@ static int stress_idle_page(stress_args_t *args)
 	int fd;
 	off_t posn = 0, last_posn = ~(off_t)7;
 	uint64_t bitmap_set[PAGES_TO_SCAN] ALIGNED(8);
+	char *idle_page_wss = NULL;
 
 	fd = open(bitmap_file, O_RDWR);
 	if (fd < 0) {
@@ -79,6 +413,15 @@ static int stress_idle_page(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
+	/* just the first instance measures, the others scan as normal */
+	(void)stress_get_setting("idle-page-wss", &idle_page_wss);
+	if (idle_page_wss && (args->instance == 0)) {
+		const int rc = stress_idle_page_wss(args, fd, idle_page_wss);
+
+		(void)close(fd);
+		return rc;
+	}
+
 	(void)shim_memset(bitmap_set, 0xff, sizeof(bitmap_set));
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -130,6 +473,7 @@ stressor_info_t stress_idle_page_info = {
 	.stressor = stress_idle_page,
 	.supported = stress_idle_page_supported,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
@@ -137,6 +481,7 @@ stressor_info_t stress_idle_page_info = {
 	.stressor = stress_unimplemented,
 	.supported = stress_idle_page_supported,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "only supported on Linux"
 };
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 
 #if defined(HAVE_SYS_EPOLL_H)
 #include <sys/epoll.h>
@@ -35,10 +36,48 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"inotify N",	 "start N workers exercising inotify events" },
+	{ NULL,	"inotify-events", "measure event delivery rate, latency and overflows over a watch sweep" },
 	{ NULL,	"inotify-ops N", "stop inotify workers after N bogo operations" },
+	{ NULL,	"inotify-rate N", "generate N file events per second in the event mode, 0 = unlimited" },
+	{ NULL,	"inotify-watches N", "sweep up to N watched directories in the event mode" },
 	{ NULL, NULL,		 NULL }
 };
 
+#define MIN_INOTIFY_WATCHES	(1)
+#define MAX_INOTIFY_WATCHES	(65536)
+#define DEFAULT_INOTIFY_WATCHES	(256)
+
+static int stress_set_inotify_events(const char *opt)
+{
+	return stress_set_setting_true("inotify-events", opt);
+}
+
+static int stress_set_inotify_rate(const char *opt)
+{
+	uint32_t inotify_rate;
+
+	inotify_rate = stress_get_uint32(opt);
+	stress_check_range("inotify-rate", (uint64_t)inotify_rate, 0, 100000000);
+	return stress_set_setting("inotify-rate", TYPE_ID_UINT32, &inotify_rate);
+}
+
+static int stress_set_inotify_watches(const char *opt)
+{
+	uint32_t inotify_watches;
+
+	inotify_watches = stress_get_uint32(opt);
+	stress_check_range("inotify-watches", (uint64_t)inotify_watches,
+		MIN_INOTIFY_WATCHES, MAX_INOTIFY_WATCHES);
+	return stress_set_setting("inotify-watches", TYPE_ID_UINT32, &inotify_watches);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_inotify_events,	stress_set_inotify_events },
+	{ OPT_inotify_rate,	stress_set_inotify_rate },
+	{ OPT_inotify_watches,	stress_set_inotify_watches },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_INOTIFY) &&		\
     defined(HAVE_INOTIFY1) &&		\
     defined(HAVE_SYS_INOTIFY_H) &&	\
@@ -942,6 +981,382 @@ static const stress_inotify_t inotify_stressors[] = {
 	{ NULL,				NULL }
 };
 
+#if defined(IN_CREATE) &&	\
+    defined(IN_NONBLOCK) &&	\
+    defined(IN_Q_OVERFLOW)
+#define STRESS_INOTIFY_EVENTS
+#endif
+
+#if defined(STRESS_INOTIFY_EVENTS)
+
+#define INOTIFY_EVENTS_DURATION	(0.25)		/* secs per sweep point per pass */
+#define INOTIFY_EVENTS_DRAIN	(0.1)		/* secs to drain queued events */
+#define INOTIFY_EVENTS_RING	(65536)		/* event timestamp ring entries */
+#define INOTIFY_EVENTS_BUF_SIZE	(64 * KB)
+#define INOTIFY_EVENTS_POINTS	(16)
+
+/* event generation time, indexed by event sequence number */
+typedef struct {
+	uint64_t seq;			/* sequence number of the event */
+	uint64_t ns;			/* time the event was generated */
+} stress_inotify_stamp_t;
+
+/* shared between the event producer and the consumer */
+typedef struct {
+	uint64_t generated;		/* events generated by the producer */
+	double duration;		/* producer run time */
+	stress_inotify_stamp_t stamps[INOTIFY_EVENTS_RING];
+} stress_inotify_events_shared_t;
+
+/* a sweep point and its accumulated results */
+typedef struct {
+	uint32_t watches;		/* number of watched directories */
+	uint64_t generated;		/* events generated */
+	uint64_t delivered;		/* events read from the inotify fd */
+	uint64_t overflows;		/* IN_Q_OVERFLOW events */
+	double duration;		/* producer run time of the passes */
+	stress_latency_t latency;	/* event delivery latency */
+} stress_inotify_events_result_t;
+
+/*
+ *  stress_inotify_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_inotify_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_inotify_events_producer()
+ *	create and remove files round-robin across the watched
+ *	directories at the requested rate, the file name carries
+ *	the event sequence number to match it with its timestamp
+ */
+static void NORETURN stress_inotify_events_producer(
+	const char *pathname,
+	const uint32_t watches,
+	const uint32_t rate,
+	stress_inotify_events_shared_t *shared)
+{
+	const uint64_t t_start = stress_inotify_now_ns();
+	const uint64_t t_end = t_start + (uint64_t)(INOTIFY_EVENTS_DURATION * STRESS_DBL_NANOSECOND);
+	uint64_t seq, t_now = t_start;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	for (seq = 0; stress_continue_flag() && (t_now < t_end); seq++) {
+		stress_inotify_stamp_t *stamp = &shared->stamps[seq % INOTIFY_EVENTS_RING];
+		char filename[PATH_MAX];
+		int fd;
+
+		if (rate) {
+			/* pace events to the rate, sleeping off any time in hand */
+			const uint64_t t_due = t_start + (seq * STRESS_NANOSECOND) / rate;
+
+			if (t_due >= t_end)
+				break;
+			if (t_due > t_now + 1000)
+				(void)shim_nanosleep_uint64(t_due - t_now);
+		}
+		(void)snprintf(filename, sizeof(filename), "%s/w%" PRIu32 "/e%" PRIu64,
+			pathname, (uint32_t)(seq % watches), seq);
+		stamp->seq = seq;
+		stamp->ns = stress_inotify_now_ns();
+		fd = creat(filename, FILE_FLAGS);
+		if (fd >= 0) {
+			(void)close(fd);
+			(void)shim_unlink(filename);
+		}
+		t_now = stress_inotify_now_ns();
+	}
+	shared->generated = seq;
+	shared->duration = (double)(t_now - t_start) / STRESS_DBL_NANOSECOND;
+	_exit(0);
+}
+
+/*
+ *  stress_inotify_events_read()
+ *	read and account the queued inotify events
+ */
+static void stress_inotify_events_read(
+	const int fd,
+	char *buffer,
+	const stress_inotify_events_shared_t *shared,
+	stress_inotify_events_result_t *result)
+{
+	for (;;) {
+		const ssize_t len = read(fd, buffer, INOTIFY_EVENTS_BUF_SIZE);
+		const uint64_t t_now = stress_inotify_now_ns();
+		ssize_t i;
+
+		if (len <= 0)
+			break;
+		for (i = 0; i < len; ) {
+			const struct inotify_event *event = (struct inotify_event *)(buffer + i);
+
+			i += (ssize_t)(sizeof(*event) + event->len);
+			if (event->mask & IN_Q_OVERFLOW) {
+				result->overflows++;
+				continue;
+			}
+			if ((event->len > 1) && (event->name[0] == 'e')) {
+				const uint64_t seq = (uint64_t)strtoull(event->name + 1, NULL, 10);
+				const stress_inotify_stamp_t *stamp = &shared->stamps[seq % INOTIFY_EVENTS_RING];
+
+				/* the producer may have lapped the ring, only time matching events */
+				if ((stamp->seq == seq) && (t_now >= stamp->ns))
+					stress_latency_add(&result->latency, t_now - stamp->ns);
+				result->delivered++;
+			}
+		}
+	}
+}
+
+/*
+ *  stress_inotify_events_pass()
+ *	watch the first result->watches directories and read events
+ *	from a producer process for the sweep duration, returns -1
+ *	on a failure, 1 if the watches cannot be added
+ */
+static int stress_inotify_events_pass(
+	stress_args_t *args,
+	const char *pathname,
+	const uint32_t rate,
+	char *buffer,
+	stress_inotify_events_shared_t *shared,
+	stress_inotify_events_result_t *result)
+{
+	const uint64_t delivered = result->delivered;
+	const uint64_t overflows = result->overflows;
+	uint32_t i;
+	int fd, status;
+	pid_t pid;
+	bool reaped = false;
+	double t_drain = 0.0;
+
+	fd = inotify_init1(IN_NONBLOCK);
+	if (fd < 0) {
+		pr_fail("%s: inotify_init1 failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < result->watches; i++) {
+		char dirname[PATH_MAX];
+
+		(void)snprintf(dirname, sizeof(dirname), "%s/w%" PRIu32, pathname, i);
+		if (inotify_add_watch(fd, dirname, IN_CREATE) < 0) {
+			(void)close(fd);
+			return 1;
+		}
+	}
+
+	shared->generated = 0;
+	shared->duration = 0.0;
+	pid = fork();
+	if (pid < 0) {
+		(void)close(fd);
+		return 0;
+	} else if (pid == 0) {
+		stress_inotify_events_producer(pathname, result->watches, rate, shared);
+	}
+
+	for (;;) {
+		struct timeval tv;
+		fd_set rfds;
+
+		tv.tv_sec = 0;
+		tv.tv_usec = 10000;
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		if (select(fd + 1, &rfds, NULL, NULL, &tv) > 0)
+			stress_inotify_events_read(fd, buffer, shared, result);
+
+		if (!reaped) {
+			if (waitpid(pid, &status, WNOHANG) == pid) {
+				reaped = true;
+				t_drain = stress_time_now() + INOTIFY_EVENTS_DRAIN;
+			} else if (!stress_continue_flag()) {
+				break;
+			}
+		} else if (stress_time_now() > t_drain) {
+			break;
+		}
+	}
+	if (reaped) {
+		result->generated += shared->generated;
+		result->duration += shared->duration;
+	} else {
+		/*
+		 *  discard the counts of an interrupted pass, SIGALRM
+		 *  stops the producer cleanly so it removes its last file
+		 */
+		(void)shim_kill(pid, SIGALRM);
+		(void)shim_waitpid(pid, &status, 0);
+		result->delivered = delivered;
+		result->overflows = overflows;
+	}
+	(void)close(fd);
+	return 0;
+}
+
+/*
+ *  stress_inotify_events_report()
+ *	report the event rates, delivery latencies and overflows
+ */
+static void stress_inotify_events_report(
+	stress_args_t *args,
+	const stress_inotify_events_result_t *results,
+	const size_t n_results)
+{
+	size_t i, metric = 0;
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %8s %12s %12s %10s %10s %10s %10s %10s\n", args->name,
+			"watches", "generated/s", "delivered/s", "overflows",
+			"lost", "p50 us", "p99 us", "p99.9 us");
+	}
+	for (i = 0; i < n_results; i++) {
+		const stress_inotify_events_result_t *result = &results[i];
+		const stress_latency_t *l = &result->latency;
+		const uint64_t lost = (result->generated > result->delivered) ?
+			result->generated - result->delivered : 0;
+		double generated_rate, delivered_rate, p99;
+		char str[64];
+
+		if (result->duration <= 0.0)
+			continue;
+		generated_rate = (double)result->generated / result->duration;
+		delivered_rate = (double)result->delivered / result->duration;
+		p99 = (double)stress_latency_percentile(l, 99.0) / 1000.0;
+		if (args->latency)
+			stress_latency_merge(args->latency, l);
+		if (args->instance == 0) {
+			pr_inf("%s: %8" PRIu32 " %12.1f %12.1f %10" PRIu64 " %10" PRIu64
+				" %10.1f %10.1f %10.1f\n", args->name,
+				result->watches, generated_rate, delivered_rate,
+				result->overflows, lost,
+				(double)stress_latency_percentile(l, 50.0) / 1000.0, p99,
+				(double)stress_latency_percentile(l, 99.9) / 1000.0);
+		}
+		if (metric + 2 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(str, sizeof(str), "events delivered per sec, %" PRIu32 " watches", result->watches);
+		stress_metrics_set(args, metric++, str, delivered_rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "event p99 usec, %" PRIu32 " watches", result->watches);
+		stress_metrics_set(args, metric++, str, p99, STRESS_GEOMETRIC_MEAN);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+}
+
+/*
+ *  stress_inotify_events()
+ *	generate file creation events at a controlled rate across a
+ *	sweep of watched directory counts and measure the inotify
+ *	event delivery rate, latency and queue overflows
+ */
+static int stress_inotify_events(stress_args_t *args, const char *pathname)
+{
+	stress_inotify_events_result_t *results;
+	stress_inotify_events_shared_t *shared;
+	uint32_t watches = DEFAULT_INOTIFY_WATCHES, rate = 0, w, i;
+	size_t n_results = 0, idx = 0;
+	int rc = EXIT_SUCCESS;
+	char *buffer;
+
+	(void)stress_get_setting("inotify-watches", &watches);
+	(void)stress_get_setting("inotify-rate", &rate);
+
+	results = (stress_inotify_events_result_t *)calloc(INOTIFY_EVENTS_POINTS, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	buffer = (char *)malloc(INOTIFY_EVENTS_BUF_SIZE);
+	if (!buffer) {
+		pr_inf_skip("%s: cannot allocate event buffer, skipping stressor\n", args->name);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	shared = (stress_inotify_events_shared_t *)stress_mmap_populate(NULL, sizeof(*shared),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*shared), errno, strerror(errno));
+		free(buffer);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* watch counts of 1, 4, 16, .. up to and including the maximum */
+	for (w = 1; (w < watches) && (n_results < INOTIFY_EVENTS_POINTS - 1); w *= 4)
+		results[n_results++].watches = w;
+	results[n_results++].watches = watches;
+
+	for (i = 0; i < watches; i++) {
+		char dirname[PATH_MAX];
+
+		(void)snprintf(dirname, sizeof(dirname), "%s/w%" PRIu32, pathname, i);
+		if ((mkdir(dirname, DIR_FLAGS) < 0) && (errno != EEXIST)) {
+			pr_inf_skip("%s: cannot create directory %s, errno=%d (%s), "
+				"skipping stressor\n", args->name, dirname, errno, strerror(errno));
+			watches = i;
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		const int ret = stress_inotify_events_pass(args, pathname, rate,
+						buffer, shared, &results[idx]);
+		if (ret < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		} else if (ret > 0) {
+			/* drop sweep points beyond the inotify watch limit */
+			if (args->instance == 0)
+				pr_inf("%s: cannot add %" PRIu32 " inotify watches, check "
+					"/proc/sys/fs/inotify/max_user_watches\n",
+					args->name, results[idx].watches);
+			n_results = idx;
+			if (n_results == 0) {
+				rc = EXIT_NO_RESOURCE;
+				break;
+			}
+		} else {
+			idx++;
+			stress_bogo_inc(args);
+		}
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_inotify_events_report(args, results, n_results);
+tidy:
+	for (i = 0; i < watches; i++) {
+		char dirname[PATH_MAX];
+
+		(void)snprintf(dirname, sizeof(dirname), "%s/w%" PRIu32, pathname, i);
+		(void)shim_rmdir(dirname);
+	}
+	(void)munmap((void *)shared, sizeof(*shared));
+	free(buffer);
+	free(results);
+	return rc;
+}
+#endif
+
 /*
  *  stress_inotify()
  *	stress inotify
@@ -951,12 +1366,27 @@ static int stress_inotify(stress_args_t *args)
 	char pathname[PATH_MAX - 16];
 	int ret, i;
 	const int bad_fd = stress_get_bad_fd();
+	bool inotify_events = false;
 
 	stress_temp_dir_args(args, pathname, sizeof(pathname));
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
 		return stress_exit_status(-ret);
 
+	(void)stress_get_setting("inotify-events", &inotify_events);
+	if (inotify_events) {
+#if defined(STRESS_INOTIFY_EVENTS)
+		ret = stress_inotify_events(args, pathname);
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --inotify-events requires IN_CREATE, IN_NONBLOCK and "
+				"IN_Q_OVERFLOW support, using the default inotify "
+				"exercising\n", args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -974,6 +1404,7 @@ static int stress_inotify(stress_args_t *args)
 stressor_info_t stress_inotify_info = {
 	.stressor = stress_inotify,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -981,6 +1412,7 @@ stressor_info_t stress_inotify_info = {
 stressor_info_t stress_inotify_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "built without sys/epoll.h, sys/inotify.h, inotify(), inotify1() or select() support"
@@ -19,9 +19,15 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
 #include "io-uring.h"
 
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
 #define SQE_SET_OPTIMIZE	(1)
 
 #if defined(HAVE_LINUX_IO_URING_H)
@@ -38,10 +44,33 @@
 #define O_DSYNC		(0)
 #endif
 
+#define STRESS_IO_URING_MODE_MIXED	(0)
+#define STRESS_IO_URING_MODE_RW		(1)
+#define STRESS_IO_URING_MODE_FIXED	(2)
+#define STRESS_IO_URING_MODE_SQPOLL	(3)
+#define STRESS_IO_URING_MODE_COOP	(4)
+#define STRESS_IO_URING_MODE_NET	(5)
+
+#define MIN_IO_URING_QD			(1)
+#define MAX_IO_URING_QD			(1024)
+#define DEFAULT_IO_URING_QD		(32)
+
+/* must match order of STRESS_IO_URING_MODE_* */
+static const char * const io_uring_modes[] = {
+	"mixed",
+	"rw",
+	"fixed",
+	"sqpoll",
+	"coop",
+	"net",
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"io-uring N",		"start N workers that issue io-uring I/O requests" },
 	{ NULL, "io-uring-entries N",	"specify number if io-uring ring entries" },
+	{ NULL,	"io-uring-mode M",	"select mode M, [ mixed | rw | fixed | sqpoll | coop | net ]" },
 	{ NULL,	"io-uring-ops N",	"stop after N bogo io-uring I/O requests" },
+	{ NULL,	"io-uring-qd N",	"sweep queue depths 1, 2, 4 .. N in the throughput modes" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -54,8 +83,43 @@ static int stress_set_io_uring_entries(const char *opt)
         return stress_set_setting("io-uring-entries", TYPE_ID_UINT32, &io_uring_entries);
 }
 
+/*
+ *  stress_set_io_uring_mode()
+ *	set the io-uring submission mode
+ */
+static int stress_set_io_uring_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(io_uring_modes); i++) {
+		if (!strcmp(io_uring_modes[i], opt)) {
+			const int io_uring_mode = (int)i;
+
+			return stress_set_setting("io-uring-mode", TYPE_ID_INT, &io_uring_mode);
+		}
+	}
+
+	(void)fprintf(stderr, "io-uring-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(io_uring_modes); i++)
+		(void)fprintf(stderr, " %s", io_uring_modes[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_io_uring_qd(const char *opt)
+{
+	uint32_t io_uring_qd;
+
+	io_uring_qd = stress_get_uint32(opt);
+	stress_check_range("io-uring-qd", (uint64_t)io_uring_qd,
+		MIN_IO_URING_QD, MAX_IO_URING_QD);
+	return stress_set_setting("io-uring-qd", TYPE_ID_UINT32, &io_uring_qd);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_io_uring_entries,	stress_set_io_uring_entries },
+	{ OPT_io_uring_mode,	stress_set_io_uring_mode },
+	{ OPT_io_uring_qd,	stress_set_io_uring_qd },
 	{ 0,			NULL },
 };
 
@@ -178,6 +242,21 @@ static inline int shim_io_uring_enter(
 		min_complete, flags, NULL, 0);
 }
 
+#if defined(__NR_io_uring_register)
+/*
+ *  shim_io_uring_register
+ *	wrapper for io_uring_register()
+ */
+static inline int shim_io_uring_register(
+	int fd,
+	unsigned int opcode,
+	void *arg,
+	unsigned int nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+#endif
+
 /*
  *  stress_io_uring_unmap_iovecs()
  *	free uring file iovecs
@@ -212,6 +291,7 @@ static void stress_io_uring_unmap_iovecs(stress_io_uring_file_t *io_uring_file)
 static int stress_setup_io_uring(
 	stress_args_t *args,
 	const uint32_t io_uring_entries,
+	const uint32_t flags,
 	stress_io_uring_submit_t *submit)
 {
 	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
@@ -219,6 +299,7 @@ static int stress_setup_io_uring(
 	struct io_uring_params p;
 
 	(void)shim_memset(&p, 0, sizeof(p));
+	p.flags = flags;
 	/*
 	 *  16 is plenty, with too many we end up with lots of cache
 	 *  misses, with too few we end up with ring filling. This
@@ -237,6 +318,12 @@ static int stress_setup_io_uring(
 				args->name);
 			return EXIT_NO_RESOURCE;
 		}
+		if (flags && ((errno == EINVAL) || (errno == EPERM))) {
+			pr_inf_skip("%s: io-uring setup flags 0x%" PRIx32 " not supported "
+				"or not permitted, errno=%d (%s), skipping stressor\n",
+				args->name, flags, errno, strerror(errno));
+			return EXIT_NOT_IMPLEMENTED;
+		}
 		if (errno == EINVAL) {
 			pr_inf_skip("%s: io-uring failed, EINVAL, possibly %"
 				PRIu32 " io-uring-entries too large, "
@@ -1069,6 +1156,933 @@ static const char *stress_io_uring_opcode_name(const uint8_t opcode)
 	return "unknown";
 }
 
+#if defined(HAVE_IORING_OP_READ) &&	\
+    defined(HAVE_IORING_OP_WRITE)
+#define HAVE_IO_URING_THROUGHPUT
+
+#if defined(HAVE_IORING_OP_READ_FIXED) &&	\
+    defined(HAVE_IORING_OP_WRITE_FIXED) &&	\
+    defined(IOSQE_FIXED_FILE) &&		\
+    defined(__NR_io_uring_register)
+#define HAVE_IO_URING_FIXED
+#endif
+
+#define IO_URING_TP_BLOCKS	(1024)	/* blocks in the throughput test file */
+#define IO_URING_TP_BLOCK_SIZE	(4096)	/* throughput I/O size */
+
+/*
+ *  throughput mode state, one in flight slot (and buffer) per
+ *  queue depth entry
+ */
+typedef struct {
+	int fd;				/* test file */
+	bool fixed;			/* registered buffers and file */
+	bool sqpoll;			/* kernel SQ polling thread submits */
+	uint8_t *bufs;			/* qd_max I/O buffers */
+	size_t bufs_size;		/* size of bufs mapping */
+	uint64_t *t_submit;		/* per slot submission time, ns */
+	uint32_t *free_slots;		/* stack of free slots */
+	uint32_t n_free;		/* number of free slots */
+	uint64_t ios;			/* completed I/Os at this depth */
+	uint64_t enters;		/* io_uring_enter calls at this depth */
+	uint64_t rw;			/* read/write alternation counter */
+	stress_latency_t *latency;	/* completion latencies at this depth */
+} stress_io_uring_tp_t;
+
+/*
+ *  stress_io_uring_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_io_uring_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_io_uring_tp_prep()
+ *	setup a random block read or write sqe for slot
+ */
+static inline void stress_io_uring_tp_prep(
+	stress_io_uring_tp_t *tp,
+	struct io_uring_sqe *sqe,
+	const uint32_t slot)
+{
+	const bool write = (tp->rw++ & 1);
+
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sqe->addr = (uintptr_t)(tp->bufs + ((size_t)slot * IO_URING_TP_BLOCK_SIZE));
+	sqe->len = IO_URING_TP_BLOCK_SIZE;
+	sqe->off = (uint64_t)stress_mwc32modn(IO_URING_TP_BLOCKS) * IO_URING_TP_BLOCK_SIZE;
+	sqe->user_data = (uint64_t)slot;
+#if defined(HAVE_IO_URING_FIXED)
+	if (tp->fixed) {
+		sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->fd = 0;	/* registered file index */
+		sqe->flags = IOSQE_FIXED_FILE;
+		sqe->buf_index = (uint16_t)slot;
+		return;
+	}
+#endif
+	sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+	sqe->fd = tp->fd;
+}
+
+/*
+ *  stress_io_uring_tp_reap()
+ *	reap completions, recording their latency and freeing their slots
+ */
+static int stress_io_uring_tp_reap(
+	stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_tp_t *tp,
+	uint32_t *inflight)
+{
+	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
+	unsigned head = *cring->head;
+	const uint64_t now = stress_io_uring_now_ns();
+	int ret = EXIT_SUCCESS;
+
+	for (;;) {
+		const struct io_uring_cqe *cqe;
+		uint32_t slot;
+
+		stress_asm_mb();
+		if (head == *cring->tail)
+			break;
+
+		cqe = &cring->cqes[head & *cring->ring_mask];
+		slot = (uint32_t)cqe->user_data;
+		if (UNLIKELY(cqe->res < 0)) {
+			const int err = -cqe->res;
+
+			if ((err != ENOSPC) && (err != EINTR) && (err != EAGAIN)) {
+				pr_fail("%s: %s completion failed, error=%d (%s)\n",
+					args->name, tp->fixed ? "fixed read/write" : "read/write",
+					err, strerror(err));
+				ret = EXIT_FAILURE;
+			}
+		}
+		stress_latency_add(tp->latency, now - tp->t_submit[slot]);
+		tp->free_slots[tp->n_free++] = slot;
+		tp->ios++;
+		(*inflight)--;
+		head++;
+	}
+	*cring->head = head;
+	stress_asm_mb();
+
+	return ret;
+}
+
+/*
+ *  stress_io_uring_tp_enter()
+ *	submit to_submit sqes and wait for min_complete completions,
+ *	with SQPOLL the kernel thread submits, so only wake it if it
+ *	has gone idle and only enter if there are no completions yet
+ */
+static int stress_io_uring_tp_enter(
+	stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_tp_t *tp,
+	unsigned *to_submit)
+{
+	int ret;
+
+	if (tp->sqpoll) {
+		stress_asm_mb();
+		if (*submit->sq_ring.flags & IORING_SQ_NEED_WAKEUP) {
+			(void)shim_io_uring_enter(submit->io_uring_fd, 0, 0, IORING_ENTER_SQ_WAKEUP);
+			tp->enters++;
+		}
+		*to_submit = 0;
+		stress_asm_mb();
+		if (*submit->cq_ring.head != *submit->cq_ring.tail)
+			return EXIT_SUCCESS;
+		ret = shim_io_uring_enter(submit->io_uring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+	} else {
+		ret = shim_io_uring_enter(submit->io_uring_fd, *to_submit, 1, IORING_ENTER_GETEVENTS);
+		if (ret > 0)
+			*to_submit -= (unsigned)ret;
+	}
+	tp->enters++;
+	if (UNLIKELY(ret < 0)) {
+		if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+			return EXIT_SUCCESS;
+		pr_fail("%s: io_uring_enter failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_io_uring_tp_depth()
+ *	keep qd random block reads and writes in flight until end,
+ *	submitting all the free slots in one batch each time round
+ */
+static int stress_io_uring_tp_depth(
+	stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_tp_t *tp,
+	const uint32_t qd,
+	const double end)
+{
+	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
+	uint32_t i, inflight = 0;
+	unsigned to_submit = 0;
+	int rc = EXIT_SUCCESS;
+
+	tp->n_free = qd;
+	for (i = 0; i < qd; i++)
+		tp->free_slots[i] = i;
+	tp->ios = 0;
+	tp->enters = 0;
+	(void)shim_memset(tp->latency, 0, sizeof(*tp->latency));
+
+	while (stress_continue(args) && (stress_time_now() < end)) {
+		const uint64_t before = tp->ios;
+		unsigned tail = *sring->tail;
+		const uint64_t now = stress_io_uring_now_ns();
+		uint32_t n = 0;
+
+		while (tp->n_free > 0) {
+			const uint32_t slot = tp->free_slots[--tp->n_free];
+			const unsigned index = tail & *sring->ring_mask;
+
+			stress_io_uring_tp_prep(tp, &submit->sqes_mmap[index], slot);
+			sring->array[index] = index;
+			tp->t_submit[slot] = now;
+			tail++;
+			n++;
+		}
+		if (n) {
+			stress_asm_mb();
+			*sring->tail = tail;
+			stress_asm_mb();
+			inflight += n;
+			to_submit += n;
+		}
+		rc = stress_io_uring_tp_enter(args, submit, tp, &to_submit);
+		if (rc != EXIT_SUCCESS)
+			break;
+		rc = stress_io_uring_tp_reap(args, submit, tp, &inflight);
+		if (rc != EXIT_SUCCESS)
+			break;
+		stress_bogo_add(args, tp->ios - before);
+	}
+
+	/* drain so the next depth starts with an empty ring */
+	for (i = 0; inflight && (i < 1000); i++) {
+		if (stress_io_uring_tp_enter(args, submit, tp, &to_submit) != EXIT_SUCCESS)
+			break;
+		(void)stress_io_uring_tp_reap(args, submit, tp, &inflight);
+	}
+	return rc;
+}
+
+/*
+ *  stress_io_uring_throughput()
+ *	measure IOPS, io_uring_enter calls per I/O and completion
+ *	latency of batched random 4K reads and writes over a sweep
+ *	of queue depths 1, 2, 4 .. io-uring-qd
+ */
+static int stress_io_uring_throughput(
+	stress_args_t *args,
+	const int mode,
+	const uint32_t qd_max)
+{
+	char filename[PATH_MAX];
+	stress_io_uring_submit_t submit;
+	stress_io_uring_tp_t tp;
+	uint32_t qd, setup_flags = 0, n_depths = 0;
+	size_t i, metric = 0;
+	double duration;
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&tp, 0, sizeof(tp));
+	(void)shim_memset(&submit, 0, sizeof(submit));
+	submit.io_uring_fd = -1;
+	tp.fd = -1;
+
+	switch (mode) {
+	case STRESS_IO_URING_MODE_RW:
+		break;
+	case STRESS_IO_URING_MODE_FIXED:
+		tp.fixed = true;
+		break;
+	case STRESS_IO_URING_MODE_SQPOLL:
+		tp.fixed = true;
+		tp.sqpoll = true;
+		setup_flags = IORING_SETUP_SQPOLL;
+		break;
+	case STRESS_IO_URING_MODE_COOP:
+#if defined(IORING_SETUP_COOP_TASKRUN) &&	\
+    defined(IORING_SETUP_SINGLE_ISSUER)
+		tp.fixed = true;
+		setup_flags = IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER;
+		break;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: io-uring-mode coop needs IORING_SETUP_COOP_TASKRUN and "
+				"IORING_SETUP_SINGLE_ISSUER, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+#if !defined(HAVE_IO_URING_FIXED)
+	if (tp.fixed) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: io-uring-mode %s needs fixed buffer read/write and "
+				"io_uring_register support, skipping stressor\n",
+				args->name, io_uring_modes[mode]);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+
+	tp.latency = (stress_latency_t *)calloc(1, sizeof(*tp.latency));
+	tp.t_submit = (uint64_t *)calloc((size_t)qd_max, sizeof(*tp.t_submit));
+	tp.free_slots = (uint32_t *)calloc((size_t)qd_max, sizeof(*tp.free_slots));
+	tp.bufs_size = (size_t)qd_max * IO_URING_TP_BLOCK_SIZE;
+	tp.bufs = (uint8_t *)stress_mmap_populate(NULL, tp.bufs_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (!tp.latency || !tp.t_submit || !tp.free_slots || (tp.bufs == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " I/O slots, skipping stressor\n",
+			args->name, qd_max);
+		if (tp.bufs == MAP_FAILED)
+			tp.bufs = NULL;
+		rc = EXIT_NO_RESOURCE;
+		goto free_tp;
+	}
+	(void)shim_memset(tp.bufs, stress_mwc8(), tp.bufs_size);
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto free_tp;
+	}
+	(void)stress_temp_filename_args(args,
+		filename, sizeof(filename), stress_mwc32());
+	tp.fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (tp.fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open on %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto rm_dir;
+	}
+	(void)shim_unlink(filename);
+	for (i = 0; i < IO_URING_TP_BLOCKS; i++) {
+		if (pwrite(tp.fd, tp.bufs, IO_URING_TP_BLOCK_SIZE,
+			   (off_t)i * IO_URING_TP_BLOCK_SIZE) < 0) {
+			rc = stress_exit_status(errno);
+			pr_inf_skip("%s: cannot populate %s, errno=%d (%s), skipping stressor\n",
+				args->name, filename, errno, strerror(errno));
+			goto close_fd;
+		}
+	}
+
+	rc = stress_setup_io_uring(args, qd_max, setup_flags, &submit);
+	if (rc != EXIT_SUCCESS)
+		goto close_fd;
+
+#if defined(HAVE_IO_URING_FIXED)
+	if (tp.fixed) {
+		struct iovec *iovecs;
+
+		iovecs = (struct iovec *)calloc((size_t)qd_max, sizeof(*iovecs));
+		if (!iovecs) {
+			pr_inf_skip("%s: cannot allocate %" PRIu32 " iovecs, skipping stressor\n",
+				args->name, qd_max);
+			rc = EXIT_NO_RESOURCE;
+			goto close_ring;
+		}
+		for (qd = 0; qd < qd_max; qd++) {
+			iovecs[qd].iov_base = tp.bufs + ((size_t)qd * IO_URING_TP_BLOCK_SIZE);
+			iovecs[qd].iov_len = IO_URING_TP_BLOCK_SIZE;
+		}
+		ret = shim_io_uring_register(submit.io_uring_fd, IORING_REGISTER_BUFFERS,
+					     iovecs, qd_max);
+		free(iovecs);
+		if (ret < 0) {
+			pr_inf_skip("%s: io_uring_register of %" PRIu32 " buffers failed, "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, qd_max, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_ring;
+		}
+		ret = shim_io_uring_register(submit.io_uring_fd, IORING_REGISTER_FILES,
+					     &tp.fd, 1);
+		if (ret < 0) {
+			pr_inf_skip("%s: io_uring_register of file failed, "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_ring;
+		}
+	}
+#endif
+
+	for (qd = 1; qd < qd_max; qd <<= 1)
+		n_depths++;
+	n_depths++;
+	duration = (g_opt_timeout > 0) ?
+		(double)g_opt_timeout / (double)n_depths : 60.0;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	for (qd = 1; stress_continue(args); qd = ((qd << 1) > qd_max) ? qd_max : (qd << 1)) {
+		const double t_start = stress_time_now();
+		double t;
+
+		rc = stress_io_uring_tp_depth(args, &submit, &tp, qd, t_start + duration);
+		t = stress_time_now() - t_start;
+		stress_latency_merge(args->latency, tp.latency);
+
+		if ((tp.ios > 0) && (t > 0.0)) {
+			const double iops = (double)tp.ios / t;
+			const double enters = (double)tp.enters / (double)tp.ios;
+			const uint64_t p99 = stress_latency_percentile(tp.latency, 99.0);
+			char description[64];
+
+			if (args->instance == 0)
+				pr_inf("%s: %s qd %4" PRIu32 ": %10.0f IOPS, %6.3f enter calls per I/O, "
+					"completion latency p50 %" PRIu64 ", p99 %" PRIu64
+					", p99.9 %" PRIu64 " ns\n",
+					args->name, io_uring_modes[mode], qd, iops, enters,
+					stress_latency_percentile(tp.latency, 50.0), p99,
+					stress_latency_percentile(tp.latency, 99.9));
+			(void)snprintf(description, sizeof(description), "IOPS at queue depth %" PRIu32, qd);
+			stress_metrics_set(args, metric++, description, iops, STRESS_HARMONIC_MEAN);
+			(void)snprintf(description, sizeof(description), "enter calls per I/O at queue depth %" PRIu32, qd);
+			stress_metrics_set(args, metric++, description, enters, STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(description, sizeof(description), "nanosecs p99 latency at queue depth %" PRIu32, qd);
+			stress_metrics_set(args, metric++, description, (double)p99, STRESS_GEOMETRIC_MEAN);
+		}
+		if ((rc != EXIT_SUCCESS) || (qd == qd_max))
+			break;
+	}
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+#if defined(HAVE_IO_URING_FIXED)
+close_ring:
+#endif
+	stress_close_io_uring(&submit);
+close_fd:
+	(void)close(tp.fd);
+rm_dir:
+	(void)stress_temp_dir_rm_args(args);
+free_tp:
+	if (tp.bufs)
+		(void)munmap((void *)tp.bufs, tp.bufs_size);
+	free(tp.free_slots);
+	free(tp.t_submit);
+	free(tp.latency);
+
+	return rc;
+}
+#endif
+
+#if defined(HAVE_IORING_OP_ACCEPT) &&	\
+    defined(HAVE_IORING_OP_RECV) &&	\
+    defined(HAVE_IORING_OP_SEND_ZC) &&	\
+    defined(HAVE_IORING_OP_SEND) &&	\
+    defined(IORING_ACCEPT_MULTISHOT) &&	\
+    defined(IORING_RECV_MULTISHOT) &&	\
+    defined(IORING_CQE_F_MORE) &&	\
+    defined(IORING_CQE_F_NOTIF) &&	\
+    defined(IORING_CQE_F_BUFFER) &&	\
+    defined(IOSQE_BUFFER_SELECT) &&	\
+    defined(__NR_io_uring_register) &&	\
+    defined(AF_INET) &&			\
+    defined(SOCK_STREAM)
+#define HAVE_IO_URING_NET
+
+#define IO_URING_NET_CONNS	(4)	/* client connections */
+#define IO_URING_NET_MSG_SIZE	(4096)	/* echoed message size */
+#define IO_URING_NET_BUFS	(64)	/* provided buffers, power of 2 */
+#define IO_URING_NET_BUF_SIZE	(16384)	/* provided buffer size */
+#define IO_URING_NET_BGID	(0)	/* provided buffer group id */
+#define IO_URING_NET_ENTRIES	(256)	/* ring entries */
+
+#define IO_URING_NET_ACCEPT	(1ULL)	/* user_data operation tags */
+#define IO_URING_NET_RECV	(2ULL)
+#define IO_URING_NET_SEND	(3ULL)
+
+#define IO_URING_NET_TAG(op, idx)	(((op) << 32) | (uint64_t)(idx))
+#define IO_URING_NET_OP(user_data)	((user_data) >> 32)
+#define IO_URING_NET_IDX(user_data)	((uint32_t)(user_data))
+
+/*
+ *  network mode state, echo server side
+ */
+typedef struct {
+	int listen_fd;			/* loopback listener */
+	int conn_fd[IO_URING_NET_CONNS];/* accepted connections */
+	uint32_t conns;			/* number of accepted connections */
+	bool zc;			/* send with IORING_OP_SEND_ZC */
+	struct io_uring_buf_ring *br;	/* provided buffer ring */
+	size_t br_size;			/* size of br mapping */
+	uint8_t *bufs;			/* provided buffers */
+	size_t bufs_size;		/* size of bufs mapping */
+	uint16_t br_tail;		/* local copy of buffer ring tail */
+	uint64_t bytes;			/* bytes echoed back */
+	uint64_t zc_notifs;		/* zero copy notifications */
+	unsigned to_submit;		/* sqes queued but not submitted */
+} stress_io_uring_net_t;
+
+/*
+ *  stress_io_uring_net_client()
+ *	keep one message in flight on each connection to the echo
+ *	server using plain blocking send and recv, as per stress-sock
+ */
+static int stress_io_uring_net_client(
+	stress_args_t *args,
+	const struct sockaddr_in *addr)
+{
+	int fds[IO_URING_NET_CONNS];
+	char msg[IO_URING_NET_MSG_SIZE];
+	size_t i, n = 0;
+	int rc = EXIT_SUCCESS;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	(void)shim_memset(msg, 'x', sizeof(msg));
+	for (n = 0; n < IO_URING_NET_CONNS; n++) {
+		fds[n] = socket(AF_INET, SOCK_STREAM, 0);
+		if (fds[n] < 0) {
+			pr_fail("%s: client socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		if (connect(fds[n], (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+			pr_fail("%s: client connect failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			(void)close(fds[n]);
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+	}
+
+	while (stress_continue_flag()) {
+		for (i = 0; i < n; i++) {
+			if (send(fds[i], msg, sizeof(msg), 0) < 0)
+				goto close_fds;
+		}
+		for (i = 0; i < n; i++) {
+			if (recv(fds[i], msg, sizeof(msg), MSG_WAITALL) <= 0)
+				goto close_fds;
+		}
+	}
+
+close_fds:
+	for (i = 0; i < n; i++)
+		(void)close(fds[i]);
+	return rc;
+}
+
+/*
+ *  stress_io_uring_net_sqe()
+ *	get the next free sqe, NULL if the submission ring is full
+ */
+static struct io_uring_sqe *stress_io_uring_net_sqe(
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_net_t *net)
+{
+	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
+	const unsigned tail = *sring->tail;
+	unsigned index;
+	struct io_uring_sqe *sqe;
+
+	stress_asm_mb();
+	if (tail - *sring->head >= *sring->ring_entries)
+		return NULL;
+	index = tail & *sring->ring_mask;
+	sqe = &submit->sqes_mmap[index];
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sring->array[index] = index;
+	stress_asm_mb();
+	*sring->tail = tail + 1;
+	stress_asm_mb();
+	net->to_submit++;
+
+	return sqe;
+}
+
+/*
+ *  stress_io_uring_net_accept()
+ *	arm a multishot accept on the listener
+ */
+static void stress_io_uring_net_accept(
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_net_t *net)
+{
+	struct io_uring_sqe *sqe = stress_io_uring_net_sqe(submit, net);
+
+	if (UNLIKELY(!sqe))
+		return;
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = net->listen_fd;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->user_data = IO_URING_NET_TAG(IO_URING_NET_ACCEPT, 0);
+}
+
+/*
+ *  stress_io_uring_net_recv()
+ *	arm a multishot recv on connection idx, the kernel picks
+ *	a buffer from the provided buffer ring for each message
+ */
+static void stress_io_uring_net_recv(
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_net_t *net,
+	const uint32_t idx)
+{
+	struct io_uring_sqe *sqe = stress_io_uring_net_sqe(submit, net);
+
+	if (UNLIKELY(!sqe))
+		return;
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = net->conn_fd[idx];
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = IO_URING_NET_BGID;
+	sqe->user_data = IO_URING_NET_TAG(IO_URING_NET_RECV, idx);
+}
+
+/*
+ *  stress_io_uring_net_buf_recycle()
+ *	hand buffer bid back to the kernel via the provided buffer ring
+ */
+static void stress_io_uring_net_buf_recycle(
+	stress_io_uring_net_t *net,
+	const uint16_t bid)
+{
+	struct io_uring_buf *buf = &net->br->bufs[net->br_tail & (IO_URING_NET_BUFS - 1)];
+
+	buf->addr = (uintptr_t)(net->bufs + ((size_t)bid * IO_URING_NET_BUF_SIZE));
+	buf->len = IO_URING_NET_BUF_SIZE;
+	buf->bid = bid;
+	net->br_tail++;
+	stress_asm_mb();
+	*(volatile uint16_t *)&net->br->tail = net->br_tail;
+}
+
+/*
+ *  stress_io_uring_net_send()
+ *	echo len bytes in buffer bid back on connection idx, the
+ *	buffer is recycled once the send (and with zero copy, the
+ *	notification that the kernel has released it) completes
+ */
+static void stress_io_uring_net_send(
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_net_t *net,
+	const uint32_t idx,
+	const uint16_t bid,
+	const uint32_t len)
+{
+	struct io_uring_sqe *sqe = stress_io_uring_net_sqe(submit, net);
+
+	if (UNLIKELY(!sqe)) {
+		stress_io_uring_net_buf_recycle(net, bid);
+		return;
+	}
+	sqe->opcode = net->zc ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+	sqe->fd = net->conn_fd[idx];
+	sqe->addr = (uintptr_t)(net->bufs + ((size_t)bid * IO_URING_NET_BUF_SIZE));
+	sqe->len = len;
+	sqe->user_data = IO_URING_NET_TAG(IO_URING_NET_SEND, bid);
+}
+
+/*
+ *  stress_io_uring_net_reap()
+ *	handle accept, recv and send completions
+ */
+static int stress_io_uring_net_reap(
+	stress_args_t *args,
+	stress_io_uring_submit_t *submit,
+	stress_io_uring_net_t *net)
+{
+	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
+	unsigned head = *cring->head;
+	int rc = EXIT_SUCCESS;
+
+	for (;;) {
+		const struct io_uring_cqe *cqe;
+		uint64_t user_data;
+		uint32_t idx, flags;
+		int32_t res;
+
+		stress_asm_mb();
+		if (head == *cring->tail)
+			break;
+
+		cqe = &cring->cqes[head & *cring->ring_mask];
+		user_data = cqe->user_data;
+		res = cqe->res;
+		flags = cqe->flags;
+		idx = IO_URING_NET_IDX(user_data);
+		head++;
+		*cring->head = head;
+
+		switch (IO_URING_NET_OP(user_data)) {
+		case IO_URING_NET_ACCEPT:
+			if (res < 0) {
+				if (res == -EINVAL) {
+					pr_inf_skip("%s: multishot accept not supported, "
+						"skipping stressor\n", args->name);
+					return EXIT_NOT_IMPLEMENTED;
+				}
+				if ((res != -EINTR) && (res != -EAGAIN)) {
+					pr_fail("%s: accept failed, error=%d (%s)\n",
+						args->name, -res, strerror(-res));
+					return EXIT_FAILURE;
+				}
+			} else if (net->conns < IO_URING_NET_CONNS) {
+				net->conn_fd[net->conns] = res;
+				stress_io_uring_net_recv(submit, net, net->conns);
+				net->conns++;
+			} else {
+				(void)close(res);
+			}
+			if (!(flags & IORING_CQE_F_MORE) && (net->conns < IO_URING_NET_CONNS))
+				stress_io_uring_net_accept(submit, net);
+			break;
+		case IO_URING_NET_RECV:
+			if (res > 0) {
+				if (flags & IORING_CQE_F_BUFFER)
+					stress_io_uring_net_send(submit, net, idx,
+						(uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT), (uint32_t)res);
+			} else if (res == 0) {
+				/* client closed the connection */
+				break;
+			} else if (res == -EINVAL) {
+				pr_inf_skip("%s: multishot recv with provided buffer rings not "
+					"supported, skipping stressor\n", args->name);
+				return EXIT_NOT_IMPLEMENTED;
+			} else if ((res != -ENOBUFS) && (res != -EINTR) && (res != -EAGAIN)) {
+				if (res != -ECONNRESET) {
+					pr_fail("%s: recv failed, error=%d (%s)\n",
+						args->name, -res, strerror(-res));
+					rc = EXIT_FAILURE;
+				}
+				break;
+			}
+			/* multishot recv ends when the buffer ring runs dry, so re-arm */
+			if (!(flags & IORING_CQE_F_MORE))
+				stress_io_uring_net_recv(submit, net, idx);
+			break;
+		case IO_URING_NET_SEND:
+			if (flags & IORING_CQE_F_NOTIF) {
+				net->zc_notifs++;
+			} else if (res >= 0) {
+				net->bytes += (uint64_t)res;
+			} else if (net->zc && ((res == -EINVAL) || (res == -EOPNOTSUPP))) {
+				if (args->instance == 0)
+					pr_inf("%s: zero copy send not supported, "
+						"using regular send\n", args->name);
+				net->zc = false;
+			} else if ((res != -EPIPE) && (res != -ECONNRESET) && (res != -EINTR)) {
+				pr_fail("%s: %s failed, error=%d (%s)\n",
+					args->name, net->zc ? "send_zc" : "send",
+					-res, strerror(-res));
+				rc = EXIT_FAILURE;
+			}
+			/* the buffer is free once no more cqes are due */
+			if (!(flags & IORING_CQE_F_MORE))
+				stress_io_uring_net_buf_recycle(net, (uint16_t)idx);
+			break;
+		default:
+			break;
+		}
+	}
+	stress_asm_mb();
+
+	return rc;
+}
+
+/*
+ *  stress_io_uring_cpu_ns()
+ *	user and system CPU time consumed so far, ns
+ */
+static uint64_t stress_io_uring_cpu_ns(void)
+{
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) == 0) {
+		return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * STRESS_NANOSECOND +
+		       ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+	}
+#endif
+	return 0;
+}
+
+/*
+ *  stress_io_uring_net()
+ *	loopback TCP echo server driven by a multishot accept,
+ *	multishot recvs into a provided buffer ring and zero copy
+ *	sends, reporting messages per second and CPU per message
+ *	for comparison with the socket stressors
+ */
+static int stress_io_uring_net(stress_args_t *args)
+{
+	stress_io_uring_submit_t submit;
+	stress_io_uring_net_t net;
+	struct io_uring_buf_reg reg;
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	const int one = 1;
+	pid_t pid;
+	uint32_t i;
+	uint64_t cpu_start, cpu_used, msgs;
+	double t_start, duration;
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&net, 0, sizeof(net));
+	(void)shim_memset(&submit, 0, sizeof(submit));
+	submit.io_uring_fd = -1;
+	net.zc = true;
+	for (i = 0; i < IO_URING_NET_CONNS; i++)
+		net.conn_fd[i] = -1;
+
+	net.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (net.listen_fd < 0) {
+		pr_inf_skip("%s: socket failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	(void)setsockopt(net.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	(void)shim_memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;	/* ephemeral port, no clashes between instances */
+	if ((bind(net.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+	    (getsockname(net.listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) ||
+	    (listen(net.listen_fd, IO_URING_NET_CONNS) < 0)) {
+		pr_inf_skip("%s: cannot listen on loopback, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto close_listen;
+	}
+
+	net.br_size = IO_URING_NET_BUFS * sizeof(struct io_uring_buf);
+	net.br = (struct io_uring_buf_ring *)stress_mmap_populate(NULL, net.br_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	net.bufs_size = (size_t)IO_URING_NET_BUFS * IO_URING_NET_BUF_SIZE;
+	net.bufs = (uint8_t *)stress_mmap_populate(NULL, net.bufs_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if ((net.br == MAP_FAILED) || (net.bufs == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot mmap provided buffers, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_bufs;
+	}
+
+	rc = stress_setup_io_uring(args, IO_URING_NET_ENTRIES, 0, &submit);
+	if (rc != EXIT_SUCCESS)
+		goto unmap_bufs;
+
+	(void)shim_memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uintptr_t)net.br;
+	reg.ring_entries = IO_URING_NET_BUFS;
+	reg.bgid = IO_URING_NET_BGID;
+	ret = shim_io_uring_register(submit.io_uring_fd, IORING_REGISTER_PBUF_RING, &reg, 1);
+	if (ret < 0) {
+		pr_inf_skip("%s: io_uring_register of provided buffer ring failed, "
+			"errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NOT_IMPLEMENTED;
+		goto close_ring;
+	}
+	for (i = 0; i < IO_URING_NET_BUFS; i++)
+		stress_io_uring_net_buf_recycle(&net, (uint16_t)i);
+
+	stress_io_uring_net_accept(&submit, &net);
+
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (!stress_continue(args))
+			goto close_ring;
+		pr_inf_skip("%s: fork failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto close_ring;
+	} else if (pid == 0) {
+		stress_close_io_uring(&submit);
+		(void)close(net.listen_fd);
+		_exit(stress_io_uring_net_client(args, &addr));
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
+	cpu_start = stress_io_uring_cpu_ns();
+
+	while (stress_continue(args)) {
+		const uint64_t before = net.bytes / IO_URING_NET_MSG_SIZE;
+
+		ret = shim_io_uring_enter(submit.io_uring_fd, net.to_submit, 1, IORING_ENTER_GETEVENTS);
+		if (ret < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+				continue;
+			pr_fail("%s: io_uring_enter failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		net.to_submit -= (unsigned)ret;
+		rc = stress_io_uring_net_reap(args, &submit, &net);
+		if (rc != EXIT_SUCCESS)
+			break;
+		stress_bogo_add(args, (net.bytes / IO_URING_NET_MSG_SIZE) - before);
+	}
+
+	duration = stress_time_now() - t_start;
+	cpu_used = stress_io_uring_cpu_ns() - cpu_start;
+	(void)stress_kill_and_wait(args, pid, SIGKILL, false);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	msgs = net.bytes / IO_URING_NET_MSG_SIZE;
+	if ((msgs > 0) && (duration > 0.0)) {
+		const double rate = (double)msgs / duration;
+		const double cpu_per_msg = (double)cpu_used / (double)msgs;
+
+		if (args->instance == 0)
+			pr_inf("%s: net: %.0f %d byte messages echoed per sec, %.0f CPU nanosecs "
+				"per message, %s sends\n", args->name, rate, IO_URING_NET_MSG_SIZE,
+				cpu_per_msg, net.zc ? "zero copy" : "regular");
+		stress_metrics_set(args, 0, "messages per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "server CPU nanosecs per message",
+			cpu_per_msg, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "zero copy notifications per message",
+			(double)net.zc_notifs / (double)msgs, STRESS_GEOMETRIC_MEAN);
+	}
+
+close_ring:
+	stress_close_io_uring(&submit);
+	for (i = 0; i < net.conns; i++)
+		(void)close(net.conn_fd[i]);
+unmap_bufs:
+	if (net.bufs != MAP_FAILED)
+		(void)munmap((void *)net.bufs, net.bufs_size);
+	if (net.br != MAP_FAILED)
+		(void)munmap((void *)net.br, net.br_size);
+close_listen:
+	(void)close(net.listen_fd);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_io_uring
  *	stress asynchronous I/O
@@ -1087,9 +2101,36 @@ static int stress_io_uring_child(stress_args_t *args, void *context)
 	uint32_t io_uring_entries;
 	stress_io_uring_user_data_t user_data[SIZEOF_ARRAY(stress_io_uring_setups)];
 	const int32_t cpus = stress_get_processors_online();
+	int io_uring_mode = STRESS_IO_URING_MODE_MIXED;
+	uint32_t io_uring_qd = DEFAULT_IO_URING_QD;
 
 	(void)context;
 
+	(void)stress_get_setting("io-uring-mode", &io_uring_mode);
+	(void)stress_get_setting("io-uring-qd", &io_uring_qd);
+	if (io_uring_mode == STRESS_IO_URING_MODE_NET) {
+#if defined(HAVE_IO_URING_NET)
+		return stress_io_uring_net(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: io-uring-mode net needs multishot accept and recv, "
+				"provided buffer rings and zero copy send support, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+	if (io_uring_mode != STRESS_IO_URING_MODE_MIXED) {
+#if defined(HAVE_IO_URING_THROUGHPUT)
+		return stress_io_uring_throughput(args, io_uring_mode, io_uring_qd);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: io-uring-mode %s needs read and write opcode "
+				"support, skipping stressor\n",
+				args->name, io_uring_modes[io_uring_mode]);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	}
+
 	/* Minor tweaking based on empirical testing */
 	if (cpus > 128)
 		io_uring_entries = 22;
@@ -1152,7 +2193,7 @@ static int stress_io_uring_child(stress_args_t *args, void *context)
 
 	io_uring_file.filename = filename;
 
-	rc = stress_setup_io_uring(args, io_uring_entries, &submit);
+	rc = stress_setup_io_uring(args, io_uring_entries, 0, &submit);
 	if (rc != EXIT_SUCCESS)
 		goto clean;
 
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-put.h"
 
 #if defined(HAVE_LINUX_FS_H)
@@ -33,12 +34,49 @@
 #define MAX_IOMIX_BYTES		(MAX_FILE_LIMIT)
 #define DEFAULT_IOMIX_BYTES	(1 * GB)
 
+#define IOMIX_PROFILE_CLASSES_MAX	(8)
+#define IOMIX_PROFILE_BSIZES_MAX	(8)
+#define IOMIX_PROFILE_BSIZE_MAX		(16 * MB)
+#define IOMIX_PROFILE_WORKERS_MAX	(32)
+#define IOMIX_PROFILE_WORKERS_DEFAULT	(4)
+
 typedef void (*stress_iomix_func)(stress_args_t *args, const int fd, const char *fs_type, const off_t iomix_bytes);
 
+/* an I/O class of an iomix profile */
+typedef struct {
+	char name[32];			/* class name used in the metrics */
+	uint32_t weight;		/* relative share of the I/Os */
+	uint32_t read_pct;		/* percentage of reads, remainder are writes */
+	uint32_t think_us;		/* think time after each I/O */
+	bool random;			/* random or sequential offsets */
+	size_t n_bsizes;		/* number of block sizes */
+	size_t bsizes[IOMIX_PROFILE_BSIZES_MAX];	/* block sizes */
+	uint32_t bsize_weights[IOMIX_PROFILE_BSIZES_MAX]; /* block size weights */
+	uint32_t bsize_weight_total;	/* sum of block size weights */
+} stress_iomix_class_t;
+
+typedef struct {
+	stress_iomix_class_t classes[IOMIX_PROFILE_CLASSES_MAX];
+	size_t n_classes;		/* number of I/O classes */
+	uint32_t weight_total;		/* sum of class weights */
+	uint32_t workers;		/* number of I/O worker processes */
+	off_t file_size;		/* file size, 0 = use iomix-bytes */
+	size_t bsize_max;		/* largest block size */
+} stress_iomix_profile_t;
+
+/* per worker, per class stats, in shared memory */
+typedef struct {
+	uint64_t reads;			/* successful reads */
+	uint64_t writes;		/* successful writes */
+	uint64_t bytes;			/* bytes read and written */
+	stress_latency_t latency;	/* I/O latency histogram */
+} stress_iomix_class_stats_t;
+
 static const stress_help_t help[] = {
 	{ NULL,	"iomix N",	 "start N workers that have a mix of I/O operations" },
 	{ NULL,	"iomix-bytes N", "write N bytes per iomix worker (default is 1GB)" },
 	{ NULL,	"iomix-ops N",	 "stop iomix workers after N iomix bogo operations" },
+	{ NULL,	"iomix-profile F", "replay the I/O mix described in profile file F" },
 	{ NULL, NULL,		 NULL }
 };
 
@@ -54,6 +92,11 @@ static int stress_set_iomix_bytes(const char *opt)
 	return stress_set_setting("iomix-bytes", TYPE_ID_OFF_T, &iomix_bytes);
 }
 
+static int stress_set_iomix_profile(const char *opt)
+{
+	return stress_set_setting("iomix-profile", TYPE_ID_STR, opt);
+}
+
 /*
  *  stress_iomix_rnd_offset()
  *	generate a random offset between 0..max-1
@@ -1042,6 +1085,351 @@ static stress_iomix_func iomix_funcs[] = {
 #endif
 };
 
+/*
+ *  stress_iomix_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_iomix_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_iomix_profile_size()
+ *	parse a size with an optional k, m or g suffix
+ */
+static bool stress_iomix_profile_size(const char *str, uint64_t *size)
+{
+	char *end;
+	uint64_t val;
+
+	errno = 0;
+	val = (uint64_t)strtoull(str, &end, 10);
+	if ((errno != 0) || (end == str))
+		return false;
+	switch (tolower((unsigned char)*end)) {
+	case '\0':
+		break;
+	case 'k':
+		val <<= 10;
+		end++;
+		break;
+	case 'm':
+		val <<= 20;
+		end++;
+		break;
+	case 'g':
+		val <<= 30;
+		end++;
+		break;
+	default:
+		return false;
+	}
+	if (*end != '\0')
+		return false;
+	*size = val;
+	return true;
+}
+
+/*
+ *  stress_iomix_profile_bsizes()
+ *	parse a comma separated block size distribution of
+ *	size[:weight] items, the weight defaults to 1
+ */
+static bool stress_iomix_profile_bsizes(char *str, stress_iomix_class_t *cls)
+{
+	char *tok, *saveptr = NULL;
+
+	cls->n_bsizes = 0;
+	cls->bsize_weight_total = 0;
+
+	for (tok = strtok_r(str, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+		char *colon = strchr(tok, ':');
+		uint64_t bsize, weight = 1;
+
+		if (cls->n_bsizes >= IOMIX_PROFILE_BSIZES_MAX)
+			return false;
+		if (colon) {
+			*colon = '\0';
+			if (!stress_iomix_profile_size(colon + 1, &weight) ||
+			    (weight < 1) || (weight > UINT16_MAX))
+				return false;
+		}
+		if (!stress_iomix_profile_size(tok, &bsize) ||
+		    (bsize < 1) || (bsize > IOMIX_PROFILE_BSIZE_MAX))
+			return false;
+		cls->bsizes[cls->n_bsizes] = (size_t)bsize;
+		cls->bsize_weights[cls->n_bsizes] = (uint32_t)weight;
+		cls->bsize_weight_total += (uint32_t)weight;
+		cls->n_bsizes++;
+	}
+	return cls->n_bsizes > 0;
+}
+
+/*
+ *  stress_iomix_profile_load()
+ *	load an I/O mix profile, lines are:
+ *	  file-size N
+ *	  workers N
+ *	  class name weight read-percent random|seq think-usecs bsize[:weight],..
+ *	returns the number of classes loaded or -1 on error
+ */
+static int stress_iomix_profile_load(
+	const char *name,
+	const char *filename,
+	stress_iomix_profile_t *profile)
+{
+	FILE *fp;
+	char buf[512];
+	int line = 0;
+
+	(void)shim_memset(profile, 0, sizeof(*profile));
+	profile->workers = IOMIX_PROFILE_WORKERS_DEFAULT;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_inf("%s: cannot open iomix profile '%s', errno=%d (%s)\n",
+			name, filename, errno, strerror(errno));
+		return -1;
+	}
+	while (fgets(buf, sizeof(buf), fp)) {
+		char keyword[32], str[256], pattern[16];
+		stress_iomix_class_t *cls;
+		uint64_t size;
+		uint32_t val;
+
+		line++;
+		if (sscanf(buf, "%31s", keyword) != 1)
+			continue;
+		if (keyword[0] == '#')
+			continue;
+
+		if (!strcmp(keyword, "file-size")) {
+			if ((sscanf(buf, "%*s %255s", str) != 1) ||
+			    !stress_iomix_profile_size(str, &size) ||
+			    (size < MIN_IOMIX_BYTES) || (size > MAX_IOMIX_BYTES))
+				goto err;
+			profile->file_size = (off_t)size;
+		} else if (!strcmp(keyword, "workers")) {
+			if ((sscanf(buf, "%*s %" SCNu32, &val) != 1) ||
+			    (val < 1) || (val > IOMIX_PROFILE_WORKERS_MAX))
+				goto err;
+			profile->workers = val;
+		} else if (!strcmp(keyword, "class")) {
+			size_t i;
+
+			if (profile->n_classes >= IOMIX_PROFILE_CLASSES_MAX)
+				goto err;
+			cls = &profile->classes[profile->n_classes];
+			if (sscanf(buf, "%*s %31s %" SCNu32 " %" SCNu32 " %15s %" SCNu32 " %255s",
+				   cls->name, &cls->weight, &cls->read_pct, pattern,
+				   &cls->think_us, str) != 6)
+				goto err;
+			if ((cls->weight < 1) || (cls->weight > UINT16_MAX) || (cls->read_pct > 100))
+				goto err;
+			if (!strcmp(pattern, "random"))
+				cls->random = true;
+			else if (!strcmp(pattern, "seq"))
+				cls->random = false;
+			else
+				goto err;
+			if (!stress_iomix_profile_bsizes(str, cls))
+				goto err;
+			for (i = 0; i < cls->n_bsizes; i++) {
+				if (cls->bsizes[i] > profile->bsize_max)
+					profile->bsize_max = cls->bsizes[i];
+			}
+			profile->weight_total += cls->weight;
+			profile->n_classes++;
+		} else {
+			goto err;
+		}
+	}
+	(void)fclose(fp);
+
+	if (profile->n_classes == 0) {
+		pr_inf("%s: no I/O classes in iomix profile '%s'\n", name, filename);
+		return -1;
+	}
+	return (int)profile->n_classes;
+
+err:
+	pr_inf("%s: invalid iomix profile '%s' line %d: %s", name, filename, line, buf);
+	(void)fclose(fp);
+	return -1;
+}
+
+/*
+ *  stress_iomix_profile_class()
+ *	pick an I/O class by weight
+ */
+static const stress_iomix_class_t *stress_iomix_profile_class(const stress_iomix_profile_t *profile)
+{
+	uint32_t w = stress_mwc32modn(profile->weight_total);
+	size_t i;
+
+	for (i = 0; i < profile->n_classes - 1; i++) {
+		if (w < profile->classes[i].weight)
+			break;
+		w -= profile->classes[i].weight;
+	}
+	return &profile->classes[i];
+}
+
+/*
+ *  stress_iomix_profile_bsize()
+ *	pick a block size of an I/O class by weight
+ */
+static size_t stress_iomix_profile_bsize(const stress_iomix_class_t *cls)
+{
+	uint32_t w = stress_mwc32modn(cls->bsize_weight_total);
+	size_t i;
+
+	for (i = 0; i < cls->n_bsizes - 1; i++) {
+		if (w < cls->bsize_weights[i])
+			break;
+		w -= cls->bsize_weights[i];
+	}
+	return cls->bsizes[i];
+}
+
+/*
+ *  stress_iomix_profile_worker()
+ *	issue I/Os from the profile classes, each worker accounts
+ *	per class I/O counts and latencies into its own stats slots
+ */
+static void stress_iomix_profile_worker(
+	stress_args_t *args,
+	const int fd,
+	const char *fs_type,
+	const off_t iomix_bytes,
+	const stress_iomix_profile_t *profile,
+	stress_iomix_class_stats_t *stats)
+{
+	uint8_t *buffer;
+	off_t posn[IOMIX_PROFILE_CLASSES_MAX];
+	size_t i;
+
+	buffer = (uint8_t *)malloc(profile->bsize_max);
+	if (!buffer) {
+		pr_inf("%s: cannot allocate %zu byte I/O buffer\n",
+			args->name, profile->bsize_max);
+		return;
+	}
+	stress_rndbuf(buffer, profile->bsize_max);
+
+	/* sequential streams start at different offsets in each worker */
+	for (i = 0; i < profile->n_classes; i++)
+		posn[i] = stress_iomix_rnd_offset(iomix_bytes);
+
+	do {
+		const stress_iomix_class_t *cls = stress_iomix_profile_class(profile);
+		const size_t c = (size_t)(cls - profile->classes);
+		size_t bsize = stress_iomix_profile_bsize(cls);
+		const bool rd = stress_mwc32modn(100) < cls->read_pct;
+		off_t offset;
+		ssize_t ret;
+		uint64_t t;
+
+		if ((off_t)bsize > iomix_bytes)
+			bsize = (size_t)iomix_bytes;
+		if (cls->random) {
+			offset = (off_t)stress_mwc64modn((uint64_t)(iomix_bytes / (off_t)bsize)) * (off_t)bsize;
+		} else {
+			if (posn[c] + (off_t)bsize > iomix_bytes)
+				posn[c] = 0;
+			offset = posn[c];
+			posn[c] += (off_t)bsize;
+		}
+
+		t = stress_iomix_now_ns();
+		ret = rd ? pread(fd, buffer, bsize, offset) :
+			   pwrite(fd, buffer, bsize, offset);
+		if (ret < 0) {
+			if (errno == EINTR)
+				break;
+			if ((errno != EPERM) && (errno != ENOSPC)) {
+				pr_fail("%s: %s failed, errno=%d (%s)%s\n",
+					args->name, rd ? "pread" : "pwrite",
+					errno, strerror(errno), fs_type);
+				break;
+			}
+		} else {
+			stress_iomix_class_stats_t *s = &stats[c];
+
+			stress_latency_add(&s->latency, stress_iomix_now_ns() - t);
+			if (rd)
+				s->reads++;
+			else
+				s->writes++;
+			s->bytes += (uint64_t)ret;
+		}
+		if (cls->think_us)
+			(void)shim_usleep(cls->think_us);
+	} while (stress_bogo_inc_lock(args, counter_lock, true));
+
+	free(buffer);
+}
+
+/*
+ *  stress_iomix_profile_metrics()
+ *	merge the per worker stats and report per class
+ *	throughput and latency
+ */
+static void stress_iomix_profile_metrics(
+	stress_args_t *args,
+	const stress_iomix_profile_t *profile,
+	const stress_iomix_class_stats_t *stats,
+	const double duration)
+{
+	static const double percentiles[] = { 50.0, 99.0, 100.0 };
+	static const char * const percentile_names[] = { "p50", "p99", "max" };
+	size_t c, metric = 0;
+
+	for (c = 0; c < profile->n_classes; c++) {
+		const stress_iomix_class_t *cls = &profile->classes[c];
+		stress_iomix_class_stats_t total;
+		char description[64];
+		uint32_t w;
+		size_t i;
+
+		(void)shim_memset(&total, 0, sizeof(total));
+		for (w = 0; w < profile->workers; w++) {
+			const stress_iomix_class_stats_t *s = &stats[(w * profile->n_classes) + c];
+
+			total.reads += s->reads;
+			total.writes += s->writes;
+			total.bytes += s->bytes;
+			stress_latency_merge(&total.latency, &s->latency);
+		}
+		stress_latency_merge(args->latency, &total.latency);
+
+		(void)snprintf(description, sizeof(description), "%s MB per sec", cls->name);
+		stress_metrics_set(args, metric++, description,
+			(duration > 0.0) ? ((double)total.bytes / duration) / (double)MB : 0.0,
+			STRESS_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description), "%s I/Os per sec", cls->name);
+		stress_metrics_set(args, metric++, description,
+			(duration > 0.0) ? (double)(total.reads + total.writes) / duration : 0.0,
+			STRESS_HARMONIC_MEAN);
+		if (total.latency.count == 0)
+			continue;
+		for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+			(void)snprintf(description, sizeof(description),
+				"nanosecs %s latency %s", cls->name, percentile_names[i]);
+			stress_metrics_set(args, metric++, description,
+				(double)stress_latency_percentile(&total.latency, percentiles[i]),
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+}
+
 /*
  *  stress_iomix
  *	stress I/O via random mix of io ops
@@ -1052,11 +1440,16 @@ static int stress_iomix(stress_args_t *args)
 	char filename[PATH_MAX];
 	off_t iomix_bytes = DEFAULT_IOMIX_BYTES;
 	const size_t page_size = args->page_size;
-	size_t i;
-	pid_t pids[SIZEOF_ARRAY(iomix_funcs)];
+	size_t i, n_pids = SIZEOF_ARRAY(iomix_funcs);
+	pid_t pids[STRESS_MAXIMUM(SIZEOF_ARRAY(iomix_funcs), IOMIX_PROFILE_WORKERS_MAX)];
 	const char *fs_type;
 	int oflags = O_CREAT | O_RDWR;
 	bool iomix_bytes_shrunk = false;
+	char *iomix_profile = NULL;
+	static stress_iomix_profile_t profile;
+	stress_iomix_class_stats_t *stats = NULL;
+	size_t stats_size = 0;
+	double t_start;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -1065,7 +1458,7 @@ static int stress_iomix(stress_args_t *args)
 	oflags |= O_SYNC;
 #endif
 
-	counter_lock = stress_lock_create();
+	counter_lock = stress_lock_create("iomix-counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -1078,6 +1471,32 @@ static int stress_iomix(stress_args_t *args)
 			iomix_bytes = MIN_IOMIX_BYTES;
 	}
 	iomix_bytes /= args->num_instances;
+
+	(void)stress_get_setting("iomix-profile", &iomix_profile);
+	if (iomix_profile) {
+		if (stress_iomix_profile_load(args->name, iomix_profile, &profile) < 0) {
+			pr_inf_skip("%s: cannot use iomix profile '%s', skipping stressor\n",
+				args->name, iomix_profile);
+			ret = EXIT_NO_RESOURCE;
+			goto lock_destroy;
+		}
+		if (profile.file_size > 0)
+			iomix_bytes = profile.file_size;
+		n_pids = (size_t)profile.workers;
+
+		stats_size = n_pids * profile.n_classes * sizeof(*stats);
+		stats = (stress_iomix_class_stats_t *)stress_mmap_populate(NULL,
+			stats_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if (stats == MAP_FAILED) {
+			pr_inf_skip("%s: cannot mmap %zu bytes for I/O stats, "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, stats_size, errno, strerror(errno));
+			ret = EXIT_NO_RESOURCE;
+			goto lock_destroy;
+		}
+		stress_set_vma_anon_name(stats, stats_size, "iomix-stats");
+	}
 	if (iomix_bytes < (off_t)MIN_IOMIX_BYTES)
 		iomix_bytes = (off_t)MIN_IOMIX_BYTES;
 	if (iomix_bytes < (off_t)page_size)
@@ -1139,14 +1558,19 @@ static int stress_iomix(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	for (i = 0; i < SIZEOF_ARRAY(iomix_funcs); i++) {
+	t_start = stress_time_now();
+	for (i = 0; i < n_pids; i++) {
 		pids[i] = fork();
 		if (pids[i] < 0) {
 			goto reap;
 		} else if (pids[i] == 0) {
 			/* Child */
 			(void)sched_settings_apply(true);
-			iomix_funcs[i](args, fd, fs_type, iomix_bytes);
+			if (stats)
+				stress_iomix_profile_worker(args, fd, fs_type, iomix_bytes,
+					&profile, &stats[i * profile.n_classes]);
+			else
+				iomix_funcs[i](args, fd, fs_type, iomix_bytes);
 			_exit(EXIT_SUCCESS);
 		}
 	}
@@ -1157,13 +1581,17 @@ static int stress_iomix(stress_args_t *args)
 
 	ret = EXIT_SUCCESS;
 reap:
-	stress_kill_and_wait_many(args, pids, SIZEOF_ARRAY(iomix_funcs), SIGALRM, true);
+	stress_kill_and_wait_many(args, pids, n_pids, SIGALRM, true);
+	if (stats)
+		stress_iomix_profile_metrics(args, &profile, stats, stress_time_now() - t_start);
 tidy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	(void)close(fd);
 	(void)stress_temp_dir_rm_args(args);
 lock_destroy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (stats)
+		(void)munmap((void *)stats, stats_size);
 	(void)stress_lock_destroy(counter_lock);
 
 	return ret;
@@ -1171,6 +1599,7 @@ lock_destroy:
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_iomix_bytes,	stress_set_iomix_bytes },
+	{ OPT_iomix_profile,	stress_set_iomix_profile },
 	{ 0,			NULL }
 };
 
@@ -56,10 +56,12 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"ipsec-mb N",		"start N workers exercising the IPSec MB encoding" },
+	{ NULL,	"ipsec-mb-burst N",	"submit jobs in bursts of N jobs using the burst API" },
 	{ NULL, "ipsec-mb-feature F",	"specify CPU feature F" },
 	{ NULL,	"ipsec-mb-jobs N",	"specify number of jobs to run per round (default 1)" },
 	{ NULL,	"ipsec-mb-method M",	"specify crypto/integrity method" },
 	{ NULL,	"ipsec-mb-ops N",	"stop after N ipsec bogo encoding operations" },
+	{ NULL,	"ipsec-mb-sweep",	"sweep burst sizes and buffer lengths, report GB/s" },
 	{ NULL,	NULL,		  	NULL }
 };
 
@@ -79,10 +81,30 @@ static int stress_set_ipsec_mb_jobs(const char *opt)
 	return stress_set_setting("ipsec-mb-jobs", TYPE_ID_INT, &ipsec_mb_jobs);
 }
 
+/*
+ *  stress_set_ipsec_mb_burst()
+ *      set number of jobs per burst API submission
+ */
+static int stress_set_ipsec_mb_burst(const char *opt)
+{
+	uint32_t ipsec_mb_burst;
+
+	ipsec_mb_burst = stress_get_uint32(opt);
+	stress_check_range("ipsec-mb-burst", (uint64_t)ipsec_mb_burst, 1, 128);
+	return stress_set_setting("ipsec-mb-burst", TYPE_ID_UINT32, &ipsec_mb_burst);
+}
+
+static int stress_set_ipsec_mb_sweep(const char *opt)
+{
+	return stress_set_setting_true("ipsec-mb-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_ipsec_mb_burst,	stress_set_ipsec_mb_burst },
 	{ OPT_ipsec_mb_feature,	stress_set_ipsec_mb_feature },
 	{ OPT_ipsec_mb_jobs,	stress_set_ipsec_mb_jobs },
 	{ OPT_ipsec_mb_method,	stress_set_ipsec_mb_method },
+	{ OPT_ipsec_mb_sweep,	stress_set_ipsec_mb_sweep },
 	{ 0,                    NULL }
 };
 
@@ -96,12 +118,71 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
     defined(IMB_FEATURE_AVX2) &&	\
     defined(IMB_FEATURE_AVX512_SKX)
 
+/* burst API macros, manager members and library symbols checked at config time */
+#if defined(HAVE_LIB_IPSEC_MB_BURST) &&	\
+    defined(IMB_GET_NEXT_BURST) &&	\
+    defined(IMB_SUBMIT_BURST) &&	\
+    defined(IMB_FLUSH_BURST)
+#define STRESS_IPSEC_BURST	(1)
+#if defined(IMB_MAX_BURST_SIZE)
+#define STRESS_IPSEC_BURST_MAX	(IMB_MAX_BURST_SIZE)
+#else
+#define STRESS_IPSEC_BURST_MAX	(128)
+#endif
+#endif
+
+#define STRESS_IPSEC_DATA_SIZE	(8192)
+
+/* burst sizes, 0 = job API, and buffer lengths to sweep */
+static const uint32_t stress_ipsec_bursts[] = {
+	0, 1, 2, 4, 8, 16, 32, 64, 128
+};
+
+static const size_t stress_ipsec_lens[] = {
+	64, 256, 1024, 4096, STRESS_IPSEC_DATA_SIZE
+};
+
+#define STRESS_IPSEC_BURSTS	(SIZEOF_ARRAY(stress_ipsec_bursts))
+#define STRESS_IPSEC_LENS	(SIZEOF_ARRAY(stress_ipsec_lens))
+
+typedef struct {
+	double	bytes;
+	double	duration;
+} stress_ipsec_rate_t;
+
+struct stress_ipsec_ctx;
+
+typedef void (*ipsec_job_init_func_t)(
+	struct IMB_JOB *job,
+	const struct stress_ipsec_ctx *ctx,
+	uint8_t *dst);
+
+/* per method job settings shared by all the jobs of a round */
+typedef struct stress_ipsec_ctx {
+	ipsec_job_init_func_t init;	/* method job setup */
+	const uint8_t *data;		/* source data */
+	size_t data_len;		/* source data length */
+	uint8_t *output;		/* per job output buffers */
+	size_t output_len;		/* per job output buffer size */
+	const void *enc_keys;		/* cipher encryption keys */
+	const void *dec_keys;		/* cipher decryption keys */
+	uint64_t key_len;		/* cipher key length */
+	const uint8_t *iv;		/* cipher initialization vector */
+	uint64_t iv_len;		/* cipher iv length */
+	const void *skey1;		/* CMAC sub key 1 */
+	const void *skey2;		/* CMAC sub key 2 */
+	const uint8_t *ipad_hash;	/* HMAC hashed key xor ipad */
+	const uint8_t *opad_hash;	/* HMAC hashed key xor opad */
+	int hash_alg;			/* HMAC hash algorithm */
+} stress_ipsec_ctx_t;
+
 typedef void (*ipsec_func_t)(
         stress_args_t *args,
         struct IMB_MGR *mb_mgr,
         const uint8_t *data,
         const size_t data_len,
-        const int jobs);
+        const int jobs,
+        const uint32_t burst);
 
 typedef void (*init_func_t)(IMB_MGR *p_mgr);
 
@@ -300,108 +381,247 @@ static void *stress_alloc_aligned(const size_t nmemb, const size_t size, const s
 	return NULL;
 }
 
-#define SHA_DIGEST_SIZE		(64)
+/*
+ *  stress_ipsec_job_init()
+ *	fill in the method specific fields of a zero'd job, dst is the
+ *	per job output buffer
+ */
+static inline void stress_ipsec_job_init(
+	struct IMB_JOB *job,
+	const stress_ipsec_ctx_t *ctx,
+	uint8_t *dst)
+{
+	ctx->init(job, ctx, dst);
+}
 
-static void stress_ipsec_sha(
+/*
+ *  stress_ipsec_jobs_single()
+ *	submit jobs one at a time with the job API
+ */
+static void stress_ipsec_jobs_single(
 	stress_args_t *args,
 	struct IMB_MGR *mb_mgr,
-	const uint8_t *data,
-	const size_t data_len,
-	const int jobs)
+	const char *name,
+	const stress_ipsec_ctx_t *ctx,
+	const int jobs,
+	int *jobs_done)
 {
-	int j, jobs_done = 0;
+	int j;
+	uint8_t *dst;
 	struct IMB_JOB *job;
-	uint8_t padding[16];
-	const size_t alloc_len = SHA_DIGEST_SIZE + (sizeof(padding) * 2);
-	uint8_t *auth;
-	uint8_t *auth_data;
-	static const char name[] = "sha";
-
-	auth_data = (uint8_t *)stress_alloc_aligned((size_t)jobs, alloc_len, 16);
-	if (!auth_data)
-		return;
-
-	stress_job_empty(mb_mgr);
 
-	for (auth = auth_data, j = 0; j < jobs; j++, auth += alloc_len) {
+	for (dst = ctx->output, j = 0; j < jobs; j++, dst += ctx->output_len) {
 		job = stress_job_get_next(mb_mgr);
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_HASH_CIPHER;
-		job->auth_tag_output = auth + sizeof(padding);
-		job->auth_tag_output_len_in_bytes = SHA_DIGEST_SIZE;
-		job->src = data;
-		job->msg_len_to_hash_in_bytes = data_len;
-		job->cipher_mode = IMB_CIPHER_NULL;
-		job->hash_alg = IMB_AUTH_SHA_512;
-		job->user_data = auth;
+		stress_ipsec_job_init(job, ctx, dst);
 		job = IMB_SUBMIT_JOB(mb_mgr);
 		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
+			stress_job_check_status(args, name, job, jobs_done);
 	}
 
 	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
+		stress_job_check_status(args, name, job, jobs_done);
+}
 
+#if defined(STRESS_IPSEC_BURST)
+/*
+ *  stress_ipsec_jobs_burst()
+ *	submit jobs burst jobs at a time with the burst API
+ */
+static void stress_ipsec_jobs_burst(
+	stress_args_t *args,
+	struct IMB_MGR *mb_mgr,
+	const char *name,
+	const stress_ipsec_ctx_t *ctx,
+	const int jobs,
+	const uint32_t burst,
+	int *jobs_done)
+{
+	struct IMB_JOB *burst_jobs[STRESS_IPSEC_BURST_MAX];
+	uint8_t *dst = ctx->output;
+	uint32_t i, n, done;
+	int j;
+
+	for (j = 0; j < jobs; j += (int)n) {
+		n = ((uint32_t)(jobs - j) < burst) ? (uint32_t)(jobs - j) : burst;
+
+		/* not enough free jobs, flush some through to make space */
+		while (IMB_GET_NEXT_BURST(mb_mgr, n, burst_jobs) < n) {
+			done = IMB_FLUSH_BURST(mb_mgr, STRESS_IPSEC_BURST_MAX, burst_jobs);
+			if (!done) {
+				pr_err("%s: %s: cannot get %" PRIu32 " burst jobs\n",
+					args->name, name, n);
+				return;
+			}
+			for (i = 0; i < done; i++)
+				stress_job_check_status(args, name, burst_jobs[i], jobs_done);
+		}
+		for (i = 0; i < n; i++, dst += ctx->output_len) {
+			(void)shim_memset(burst_jobs[i], 0, sizeof(*burst_jobs[i]));
+			stress_ipsec_job_init(burst_jobs[i], ctx, dst);
+		}
+		done = IMB_SUBMIT_BURST(mb_mgr, n, burst_jobs);
+		for (i = 0; i < done; i++)
+			stress_job_check_status(args, name, burst_jobs[i], jobs_done);
+	}
+
+	while ((done = IMB_FLUSH_BURST(mb_mgr, STRESS_IPSEC_BURST_MAX, burst_jobs)) > 0) {
+		for (i = 0; i < done; i++)
+			stress_job_check_status(args, name, burst_jobs[i], jobs_done);
+	}
+}
+#endif
+
+/*
+ *  stress_ipsec_jobs()
+ *	run jobs using the job API if burst is zero, otherwise
+ *	use the burst API with up to burst jobs per submission
+ */
+static void stress_ipsec_jobs(
+	stress_args_t *args,
+	struct IMB_MGR *mb_mgr,
+	const char *name,
+	const stress_ipsec_ctx_t *ctx,
+	const int jobs,
+	const uint32_t burst)
+{
+	int jobs_done = 0;
+
+	stress_job_empty(mb_mgr);
+#if defined(STRESS_IPSEC_BURST)
+	if (burst > 0)
+		stress_ipsec_jobs_burst(args, mb_mgr, name, ctx, jobs, burst, &jobs_done);
+	else
+		stress_ipsec_jobs_single(args, mb_mgr, name, ctx, jobs, &jobs_done);
+#else
+	(void)burst;
+
+	stress_ipsec_jobs_single(args, mb_mgr, name, ctx, jobs, &jobs_done);
+#endif
 	stress_jobs_done(args, name, jobs, jobs_done);
 	stress_job_empty(mb_mgr);
-	free(auth_data);
 }
 
-static void stress_ipsec_des(
+#define SHA_DIGEST_SIZE		(64)
+#define SHA_PADDING_SIZE	(16)
+
+static void stress_ipsec_sha_job(
+	struct IMB_JOB *job,
+	const stress_ipsec_ctx_t *ctx,
+	uint8_t *dst)
+{
+	job->cipher_direction = IMB_DIR_ENCRYPT;
+	job->chain_order = IMB_ORDER_HASH_CIPHER;
+	job->auth_tag_output = dst + SHA_PADDING_SIZE;
+	job->auth_tag_output_len_in_bytes = SHA_DIGEST_SIZE;
+	job->src = ctx->data;
+	job->msg_len_to_hash_in_bytes = ctx->data_len;
+	job->cipher_mode = IMB_CIPHER_NULL;
+	job->hash_alg = IMB_AUTH_SHA_512;
+	job->user_data = dst;
+}
+
+static void stress_ipsec_sha(
 	stress_args_t *args,
 	struct IMB_MGR *mb_mgr,
 	const uint8_t *data,
 	const size_t data_len,
-	const int jobs)
+	const int jobs,
+	const uint32_t burst)
 {
-	int j, jobs_done = 0;
-	struct IMB_JOB *job;
+	stress_ipsec_ctx_t ctx;
+	static const char name[] = "sha";
+
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_sha_job;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = SHA_DIGEST_SIZE + (SHA_PADDING_SIZE * 2);
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, ctx.output_len, 16);
+	if (!ctx.output)
+		return;
+
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
+}
 
-	uint8_t *encoded;
+static void stress_ipsec_des_job(
+	struct IMB_JOB *job,
+	const stress_ipsec_ctx_t *ctx,
+	uint8_t *dst)
+{
+	job->cipher_direction = IMB_DIR_ENCRYPT;
+	job->chain_order = IMB_ORDER_CIPHER_HASH;
+	job->src = ctx->data;
+	job->dst = dst;
+	job->cipher_mode = IMB_CIPHER_CBC;
+	job->enc_keys = ctx->enc_keys;
+	job->dec_keys = ctx->dec_keys;
+	job->key_len_in_bytes = ctx->key_len;
+	job->iv = ctx->iv;
+	job->iv_len_in_bytes = ctx->iv_len;
+	job->cipher_start_src_offset_in_bytes = 0;
+	job->msg_len_to_cipher_in_bytes = ctx->data_len;
+	job->user_data = dst;
+	job->user_data2 = (void *)((uintptr_t)(dst - ctx->output) / ctx->output_len);
+	job->hash_alg = IMB_AUTH_NULL;
+}
+
+static void stress_ipsec_des(
+	stress_args_t *args,
+	struct IMB_MGR *mb_mgr,
+	const uint8_t *data,
+	const size_t data_len,
+	const int jobs,
+	const uint32_t burst)
+{
+	stress_ipsec_ctx_t ctx;
 	uint8_t k[32] ALIGNED(16);
 	uint8_t iv[16] ALIGNED(16);
 	uint32_t enc_keys[15 * 4] ALIGNED(16);
 	uint32_t dec_keys[15 * 4] ALIGNED(16);
-	uint8_t *dst;
 	static const char name[] = "des";
 
-	encoded = (uint8_t *)stress_alloc_aligned((size_t)jobs, data_len, 16);
-	if (!encoded)
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_des_job;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = data_len;
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, ctx.output_len, 16);
+	if (!ctx.output)
 		return;
 
 	stress_rnd_fill(k, sizeof(k));
 	stress_rnd_fill(iv, sizeof(iv));
 	stress_job_empty(mb_mgr);
 	IMB_AES_KEYEXP_256(mb_mgr, k, enc_keys, dec_keys);
+	ctx.enc_keys = enc_keys;
+	ctx.dec_keys = dec_keys;
+	ctx.key_len = sizeof(k);
+	ctx.iv = iv;
+	ctx.iv_len = sizeof(iv);
+
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
+}
 
-	for (dst = encoded, j = 0; j < jobs; j++, dst += data_len) {
-		job = stress_job_get_next(mb_mgr);
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_CIPHER_HASH;
-		job->src = data;
-		job->dst = dst;
-		job->cipher_mode = IMB_CIPHER_CBC;
-		job->enc_keys = enc_keys;
-		job->dec_keys = dec_keys;
-		job->key_len_in_bytes = sizeof(k);
-		job->iv = iv;
-		job->iv_len_in_bytes = sizeof(iv);
-		job->cipher_start_src_offset_in_bytes = 0;
-		job->msg_len_to_cipher_in_bytes = data_len;
-		job->user_data = dst;
-		job->user_data2 = (void *)((uint64_t)j);
-		job->hash_alg = IMB_AUTH_NULL;
-		job = IMB_SUBMIT_JOB(mb_mgr);
-		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
-	}
-
-	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
-
-	stress_jobs_done(args, name, jobs, jobs_done);
-	stress_job_empty(mb_mgr);
-	free(encoded);
+static void stress_ipsec_cmac_job(
+	struct IMB_JOB *job,
+	const stress_ipsec_ctx_t *ctx,
+	uint8_t *dst)
+{
+	job->cipher_direction = IMB_DIR_ENCRYPT;
+	job->chain_order = IMB_ORDER_HASH_CIPHER;
+	job->cipher_mode = IMB_CIPHER_NULL;
+	job->hash_alg = IMB_AUTH_AES_CMAC;
+	job->src = ctx->data;
+	job->hash_start_src_offset_in_bytes = 0;
+	job->msg_len_to_hash_in_bytes = ctx->data_len;
+	job->auth_tag_output = dst;
+	job->auth_tag_output_len_in_bytes = 16;
+	job->u.CMAC._key_expanded = ctx->enc_keys;
+	job->u.CMAC._skey1 = ctx->skey1;
+	job->u.CMAC._skey2 = ctx->skey2;
+	job->user_data = dst;
 }
 
 static void stress_ipsec_cmac(
@@ -409,54 +629,54 @@ static void stress_ipsec_cmac(
 	struct IMB_MGR *mb_mgr,
 	const uint8_t *data,
 	const size_t data_len,
-	const int jobs)
+	const int jobs,
+	const uint32_t burst)
 {
-	int j, jobs_done = 0;
-	struct IMB_JOB *job;
-
+	stress_ipsec_ctx_t ctx;
 	uint8_t key[16] ALIGNED(16);
 	uint32_t expkey[4 * 15] ALIGNED(16);
 	uint32_t dust[4 * 15] ALIGNED(16);
 	uint32_t skey1[4], skey2[4];
-	uint8_t *output;
 	static const char name[] = "cmac";
-	uint8_t *dst;
 
-	output = (uint8_t *)stress_alloc_aligned((size_t)jobs, data_len, 16);
-	if (!output)
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_cmac_job;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = 16;
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, data_len, 16);
+	if (!ctx.output)
 		return;
 
 	stress_rnd_fill(key, sizeof(key));
 	IMB_AES_KEYEXP_128(mb_mgr, key, expkey, dust);
 	IMB_AES_CMAC_SUBKEY_GEN_128(mb_mgr, expkey, skey1, skey2);
-	stress_job_empty(mb_mgr);
+	ctx.enc_keys = expkey;
+	ctx.skey1 = skey1;
+	ctx.skey2 = skey2;
 
-	for (dst = output, j = 0; j < jobs; j++, dst += 16) {
-		job = stress_job_get_next(mb_mgr);
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_HASH_CIPHER;
-		job->cipher_mode = IMB_CIPHER_NULL;
-		job->hash_alg = IMB_AUTH_AES_CMAC;
-		job->src = data;
-		job->hash_start_src_offset_in_bytes = 0;
-		job->msg_len_to_hash_in_bytes = data_len;
-		job->auth_tag_output = dst;
-		job->auth_tag_output_len_in_bytes = 16;
-		job->u.CMAC._key_expanded = expkey;
-		job->u.CMAC._skey1 = skey1;
-		job->u.CMAC._skey2 = skey2;
-		job->user_data = dst;
-		job = IMB_SUBMIT_JOB(mb_mgr);
-		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
-	}
-
-	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
+}
 
-	stress_jobs_done(args, name, jobs, jobs_done);
-	stress_job_empty(mb_mgr);
-	free(output);
+static void stress_ipsec_ctr_job(
+	struct IMB_JOB *job,
+	const stress_ipsec_ctx_t *ctx,
+	uint8_t *dst)
+{
+	job->cipher_direction = IMB_DIR_ENCRYPT;
+	job->chain_order = IMB_ORDER_CIPHER_HASH;
+	job->cipher_mode = IMB_CIPHER_CNTR;
+	job->hash_alg = IMB_AUTH_NULL;
+	job->src = ctx->data;
+	job->dst = dst;
+	job->enc_keys = ctx->enc_keys;
+	job->dec_keys = ctx->dec_keys;
+	job->key_len_in_bytes = ctx->key_len;
+	job->iv = ctx->iv;
+	job->iv_len_in_bytes = ctx->iv_len;
+	job->cipher_start_src_offset_in_bytes = 0;
+	job->msg_len_to_cipher_in_bytes = ctx->data_len;
 }
 
 static void stress_ipsec_ctr(
@@ -464,54 +684,67 @@ static void stress_ipsec_ctr(
 	struct IMB_MGR *mb_mgr,
 	const uint8_t *data,
 	const size_t data_len,
-	const int jobs)
+	const int jobs,
+	const uint32_t burst)
 {
-	int j, jobs_done = 0;
-	struct IMB_JOB *job;
-
-	uint8_t *encoded;
+	stress_ipsec_ctx_t ctx;
 	uint8_t key[32] ALIGNED(16);
 	uint8_t iv[12] ALIGNED(16);		/* 4 byte nonce + 8 byte IV */
 	uint32_t expkey[4 * 15] ALIGNED(16);
 	uint32_t dust[4 * 15] ALIGNED(16);
-	uint8_t *dst;
 	static const char name[] = "ctr";
 
-	encoded = (uint8_t *)stress_alloc_aligned((size_t)jobs, data_len, 16);
-	if (!encoded)
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_ctr_job;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = data_len;
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, ctx.output_len, 16);
+	if (!ctx.output)
 		return;
 
 	stress_rnd_fill(key, sizeof(key));
 	stress_rnd_fill(iv, sizeof(iv));
 	IMB_AES_KEYEXP_256(mb_mgr, key, expkey, dust);
-	stress_job_empty(mb_mgr);
-
-	for (dst = encoded, j = 0; j < jobs; j++, dst += data_len) {
-		job = stress_job_get_next(mb_mgr);
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_CIPHER_HASH;
-		job->cipher_mode = IMB_CIPHER_CNTR;
-		job->hash_alg = IMB_AUTH_NULL;
-		job->src = data;
-		job->dst = dst;
-		job->enc_keys = expkey;
-		job->dec_keys = expkey;
-		job->key_len_in_bytes = sizeof(key);
-		job->iv = iv;
-		job->iv_len_in_bytes = sizeof(iv);
-		job->cipher_start_src_offset_in_bytes = 0;
-		job->msg_len_to_cipher_in_bytes = data_len;
-		job = IMB_SUBMIT_JOB(mb_mgr);
-		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
-	}
-
-	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
+	ctx.enc_keys = expkey;
+	ctx.dec_keys = expkey;
+	ctx.key_len = sizeof(key);
+	ctx.iv = iv;
+	ctx.iv_len = sizeof(iv);
+
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
+}
 
-	stress_jobs_done(args, name, jobs, jobs_done);
-	stress_job_empty(mb_mgr);
-	free(encoded);
+/*
+ *  stress_ipsec_hmac_job()
+ *	common HMAC job setup, ctx->hash_alg selects the HMAC hash
+ */
+static void stress_ipsec_hmac_job(
+	struct IMB_JOB *job,
+	const stress_ipsec_ctx_t *ctx,
+	uint8_t *dst)
+{
+	job->enc_keys = NULL;
+	job->dec_keys = NULL;
+	job->cipher_direction = IMB_DIR_ENCRYPT;
+	job->chain_order = IMB_ORDER_HASH_CIPHER;
+	job->dst = NULL;
+	job->key_len_in_bytes = 0;
+	job->auth_tag_output = dst;
+	job->auth_tag_output_len_in_bytes = ctx->output_len;
+	job->iv = NULL;
+	job->iv_len_in_bytes = 0;
+	job->src = ctx->data;
+	job->cipher_start_src_offset_in_bytes = 0;
+	job->msg_len_to_cipher_in_bytes = 0;
+	job->hash_start_src_offset_in_bytes = 0;
+	job->msg_len_to_hash_in_bytes = ctx->data_len;
+	job->u.HMAC._hashed_auth_key_xor_ipad = ctx->ipad_hash;
+	job->u.HMAC._hashed_auth_key_xor_opad = ctx->opad_hash;
+	job->cipher_mode = IMB_CIPHER_NULL;
+	job->hash_alg = ctx->hash_alg;
+	job->user_data = dst;
 }
 
 #define HMAC_MD5_DIGEST_SIZE	(16)
@@ -522,22 +755,25 @@ static void stress_ipsec_hmac_md5(
 	struct IMB_MGR *mb_mgr,
 	const uint8_t *data,
 	const size_t data_len,
-	const int jobs)
+	const int jobs,
+	const uint32_t burst)
 {
-	int j, jobs_done = 0;
 	size_t i;
-	struct IMB_JOB *job;
-
+	stress_ipsec_ctx_t ctx;
 	uint8_t key[MMAC_MD5_BLOCK_SIZE] ALIGNED(16);
 	uint8_t buf[MMAC_MD5_BLOCK_SIZE] ALIGNED(16);
 	uint8_t ipad_hash[HMAC_MD5_DIGEST_SIZE] ALIGNED(16);
 	uint8_t opad_hash[HMAC_MD5_DIGEST_SIZE] ALIGNED(16);
-	uint8_t *output;
-	uint8_t *dst;
 	static const char name[] = "hmac_md5";
 
-	output = (uint8_t *)stress_alloc_aligned((size_t)jobs, HMAC_MD5_DIGEST_SIZE, 16);
-	if (!output)
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_hmac_job;
+	ctx.hash_alg = IMB_AUTH_MD5;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = HMAC_MD5_DIGEST_SIZE;
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, ctx.output_len, 16);
+	if (!ctx.output)
 		return;
 
 	stress_rnd_fill(key, sizeof(key));
@@ -547,42 +783,11 @@ static void stress_ipsec_hmac_md5(
 	for (i = 0; i < sizeof(key); i++)
 		buf[i] = key[i] ^ 0x5c;
 	IMB_MD5_ONE_BLOCK(mb_mgr, buf, opad_hash);
+	ctx.ipad_hash = ipad_hash;
+	ctx.opad_hash = opad_hash;
 
-	stress_job_empty(mb_mgr);
-
-	for (dst = output, j = 0; j < jobs; j++, dst += HMAC_MD5_DIGEST_SIZE) {
-		job = stress_job_get_next(mb_mgr);
-		job->enc_keys = NULL;
-		job->dec_keys = NULL;
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_HASH_CIPHER;
-		job->dst = NULL;
-		job->key_len_in_bytes = 0;
-		job->auth_tag_output = dst;
-		job->auth_tag_output_len_in_bytes = HMAC_MD5_DIGEST_SIZE;
-		job->iv = NULL;
-		job->iv_len_in_bytes = 0;
-		job->src = data;
-		job->cipher_start_src_offset_in_bytes = 0;
-		job->msg_len_to_cipher_in_bytes = 0;
-		job->hash_start_src_offset_in_bytes = 0;
-		job->msg_len_to_hash_in_bytes = data_len;
-		job->u.HMAC._hashed_auth_key_xor_ipad = ipad_hash;
-		job->u.HMAC._hashed_auth_key_xor_opad = opad_hash;
-		job->cipher_mode = IMB_CIPHER_NULL;
-		job->hash_alg = IMB_AUTH_MD5;
-		job->user_data = dst;
-		job = IMB_SUBMIT_JOB(mb_mgr);
-		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
-	}
-
-	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
-
-	stress_jobs_done(args, name, jobs, jobs_done);
-	stress_job_empty(mb_mgr);
-	free(output);
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
 }
 
 #define HMAC_SHA1_DIGEST_SIZE	(20)
@@ -593,22 +798,25 @@ static void stress_ipsec_hmac_sha1(
 	struct IMB_MGR *mb_mgr,
 	const uint8_t *data,
 	const size_t data_len,
-	const int jobs)
+	const int jobs,
+	const uint32_t burst)
 {
-	int j, jobs_done = 0;
 	size_t i;
-	struct IMB_JOB *job;
-
+	stress_ipsec_ctx_t ctx;
 	uint8_t key[HMAC_SHA1_BLOCK_SIZE] ALIGNED(16);
 	uint8_t buf[HMAC_SHA1_BLOCK_SIZE] ALIGNED(16);
 	uint8_t ipad_hash[HMAC_SHA1_DIGEST_SIZE] ALIGNED(16);
 	uint8_t opad_hash[HMAC_SHA1_DIGEST_SIZE] ALIGNED(16);
-	uint8_t *output;
-	uint8_t *dst;
 	static const char name[] = "hmac_sha1";
 
-	output = (uint8_t *)stress_alloc_aligned((size_t)jobs, HMAC_SHA1_DIGEST_SIZE, 16);
-	if (!output)
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_hmac_job;
+	ctx.hash_alg = IMB_AUTH_HMAC_SHA_1;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = HMAC_SHA1_DIGEST_SIZE;
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, ctx.output_len, 16);
+	if (!ctx.output)
 		return;
 
 	stress_rnd_fill(key, sizeof(key));
@@ -618,42 +826,11 @@ static void stress_ipsec_hmac_sha1(
 	for (i = 0; i < sizeof(key); i++)
 		buf[i] = key[i] ^ 0x5c;
 	IMB_MD5_ONE_BLOCK(mb_mgr, buf, opad_hash);
+	ctx.ipad_hash = ipad_hash;
+	ctx.opad_hash = opad_hash;
 
-	stress_job_empty(mb_mgr);
-
-	for (dst = output, j = 0; j < jobs; j++, dst += HMAC_SHA1_DIGEST_SIZE) {
-		job = stress_job_get_next(mb_mgr);
-		job->enc_keys = NULL;
-		job->dec_keys = NULL;
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_HASH_CIPHER;
-		job->dst = NULL;
-		job->key_len_in_bytes = 0;
-		job->auth_tag_output = dst;
-		job->auth_tag_output_len_in_bytes = HMAC_SHA1_DIGEST_SIZE;
-		job->iv = NULL;
-		job->iv_len_in_bytes = 0;
-		job->src = data;
-		job->cipher_start_src_offset_in_bytes = 0;
-		job->msg_len_to_cipher_in_bytes = 0;
-		job->hash_start_src_offset_in_bytes = 0;
-		job->msg_len_to_hash_in_bytes = data_len;
-		job->u.HMAC._hashed_auth_key_xor_ipad = ipad_hash;
-		job->u.HMAC._hashed_auth_key_xor_opad = opad_hash;
-		job->cipher_mode = IMB_CIPHER_NULL;
-		job->hash_alg = IMB_AUTH_HMAC_SHA_1;
-		job->user_data = dst;
-		job = IMB_SUBMIT_JOB(mb_mgr);
-		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
-	}
-
-	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
-
-	stress_jobs_done(args, name, jobs, jobs_done);
-	stress_job_empty(mb_mgr);
-	free(output);
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
 }
 
 static void stress_ipsec_hmac_sha512(
@@ -661,23 +838,26 @@ static void stress_ipsec_hmac_sha512(
 	struct IMB_MGR *mb_mgr,
 	const uint8_t *data,
 	const size_t data_len,
-	const int jobs)
+	const int jobs,
+	const uint32_t burst)
 {
-	int j, jobs_done = 0;
 	size_t i;
-	struct IMB_JOB *job;
-
+	stress_ipsec_ctx_t ctx;
 	uint8_t rndkey[IMB_SHA_512_BLOCK_SIZE] ALIGNED(16);
 	uint8_t key[IMB_SHA_512_BLOCK_SIZE] ALIGNED(16);
 	uint8_t buf[IMB_SHA_512_BLOCK_SIZE] ALIGNED(16);
 	uint8_t ipad_hash[IMB_SHA512_DIGEST_SIZE_IN_BYTES] ALIGNED(16);
 	uint8_t opad_hash[IMB_SHA512_DIGEST_SIZE_IN_BYTES] ALIGNED(16);
-	uint8_t *output;
-	uint8_t *dst;
 	static const char name[] = "hmac_sha512";
 
-	output = (uint8_t *)stress_alloc_aligned((size_t)jobs, IMB_SHA512_DIGEST_SIZE_IN_BYTES, 16);
-	if (!output)
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.init = stress_ipsec_hmac_job;
+	ctx.hash_alg = IMB_AUTH_HMAC_SHA_512;
+	ctx.data = data;
+	ctx.data_len = data_len;
+	ctx.output_len = IMB_SHA512_DIGEST_SIZE_IN_BYTES;
+	ctx.output = (uint8_t *)stress_alloc_aligned((size_t)jobs, ctx.output_len, 16);
+	if (!ctx.output)
 		return;
 
 	stress_rnd_fill(rndkey, sizeof(rndkey));
@@ -691,53 +871,15 @@ static void stress_ipsec_hmac_sha512(
 	for (i = 0; i < sizeof(key); i++)
 		buf[i] = key[i] ^ 0x5c;
 	IMB_SHA512_ONE_BLOCK(mb_mgr, buf, opad_hash);
+	ctx.ipad_hash = ipad_hash;
+	ctx.opad_hash = opad_hash;
 
-	stress_job_empty(mb_mgr);
-
-	for (dst = output, j = 0; j < jobs; j++, dst += IMB_SHA512_DIGEST_SIZE_IN_BYTES) {
-		job = stress_job_get_next(mb_mgr);
-		job->enc_keys = NULL;
-		job->dec_keys = NULL;
-		job->cipher_direction = IMB_DIR_ENCRYPT;
-		job->chain_order = IMB_ORDER_HASH_CIPHER;
-		job->dst = NULL;
-		job->key_len_in_bytes = 0;
-		job->auth_tag_output = dst;
-		job->auth_tag_output_len_in_bytes = IMB_SHA512_DIGEST_SIZE_IN_BYTES;
-		job->iv = NULL;
-		job->iv_len_in_bytes = 0;
-		job->src = data;
-		job->cipher_start_src_offset_in_bytes = 0;
-		job->msg_len_to_cipher_in_bytes = 0;
-		job->hash_start_src_offset_in_bytes = 0;
-		job->msg_len_to_hash_in_bytes = data_len;
-		job->u.HMAC._hashed_auth_key_xor_ipad = ipad_hash;
-		job->u.HMAC._hashed_auth_key_xor_opad = opad_hash;
-		job->cipher_mode = IMB_CIPHER_NULL;
-		job->hash_alg = IMB_AUTH_HMAC_SHA_512;
-		job->user_data = dst;
-		job = IMB_SUBMIT_JOB(mb_mgr);
-		if (job)
-			stress_job_check_status(args, name, job, &jobs_done);
-	}
-
-	while ((job = IMB_FLUSH_JOB(mb_mgr)) != NULL)
-		stress_job_check_status(args, name, job, &jobs_done);
-
-	stress_jobs_done(args, name, jobs, jobs_done);
-	stress_job_empty(mb_mgr);
-	free(output);
+	stress_ipsec_jobs(args, mb_mgr, name, &ctx, jobs, burst);
+	free(ctx.output);
 }
 
-static void stress_ipsec_all(
-	stress_args_t *args,
-	struct IMB_MGR *mb_mgr,
-	const uint8_t *data,
-	const size_t data_len,
-	const int jobs);
-
 static stress_ipsec_funcs_t stress_ipsec_funcs[] = {
-	{ stress_ipsec_all,		"all",		},
+	{ NULL,				"all",		},
 	{ stress_ipsec_cmac,		"cmac",		},
 	{ stress_ipsec_ctr,		"ctr",		},
 	{ stress_ipsec_des,		"des",		},
@@ -747,50 +889,59 @@ static stress_ipsec_funcs_t stress_ipsec_funcs[] = {
 	{ stress_ipsec_sha,		"sha",		},
 };
 
+#define STRESS_IPSEC_METHODS	(SIZEOF_ARRAY(stress_ipsec_funcs))
+#define STRESS_IPSEC_FEATURES	(SIZEOF_ARRAY(mb_features))
+
+/* bytes processed per feature, method, burst size and buffer length */
+static stress_ipsec_rate_t ipsec_rates[STRESS_IPSEC_FEATURES][STRESS_IPSEC_METHODS]
+				      [STRESS_IPSEC_BURSTS][STRESS_IPSEC_LENS];
+
+/*
+ *  stress_ipsec_call_func()
+ *	run a method, or all methods for the "all" method, on
+ *	each of the supported features
+ */
 static void stress_ipsec_call_func(
-        stress_args_t *args,
-        struct IMB_MGR *mb_mgr,
-        const uint8_t *data,
-        const size_t data_len,
-        const int jobs,
+	stress_args_t *args,
+	struct IMB_MGR *mb_mgr,
+	const uint8_t *data,
+	const int jobs,
+	const size_t burst_index,
+	const size_t len_index,
 	const size_t func_index)
 {
+	const size_t data_len = stress_ipsec_lens[len_index];
+	const uint32_t burst = stress_ipsec_bursts[burst_index];
 	size_t i;
 
-	for (i = 0; i < SIZEOF_ARRAY(mb_features); i++) {
+	if (!stress_ipsec_funcs[func_index].func) {
+		for (i = 1; stress_continue(args) && (i < STRESS_IPSEC_METHODS); i++)
+			stress_ipsec_call_func(args, mb_mgr, data, jobs, burst_index, len_index, i);
+		return;
+	}
+
+	for (i = 0; i < STRESS_IPSEC_FEATURES; i++) {
 		if (mb_features[i].supported) {
-			double t;
+			stress_ipsec_rate_t *rate = &ipsec_rates[i][func_index][burst_index][len_index];
+			double t, duration, ops;
 			uint64_t c;
 
 			c = stress_bogo_get(args);
 			t = stress_time_now();
 
 			mb_features[i].init_func(mb_mgr);
-			stress_ipsec_funcs[func_index].func(args, mb_mgr, data, data_len, jobs);
-
-			mb_features[i].stats.duration += (stress_time_now() - t);
-			mb_features[i].stats.ops += (double)(stress_bogo_get(args) - c);
+			stress_ipsec_funcs[func_index].func(args, mb_mgr, data, data_len, jobs, burst);
+
+			duration = stress_time_now() - t;
+			ops = (double)(stress_bogo_get(args) - c);
+			mb_features[i].stats.duration += duration;
+			mb_features[i].stats.ops += ops;
+			rate->duration += duration;
+			rate->bytes += ops * (double)data_len;
 		}
 	}
 }
 
-/*
- *  stress_ipsec_all()
- *	exercise all
- */
-static void stress_ipsec_all(
-	stress_args_t *args,
-	struct IMB_MGR *mb_mgr,
-	const uint8_t *data,
-	const size_t data_len,
-	const int jobs)
-{
-	size_t i;
-
-	for (i = 1; stress_continue(args) && (i < SIZEOF_ARRAY(stress_ipsec_funcs)); i++)
-		stress_ipsec_call_func(args, mb_mgr, data, data_len, jobs, i);
-}
-
 static int stress_set_ipsec_mb_method(const char *opt)
 {
 	size_t i;
@@ -809,6 +960,60 @@ static int stress_set_ipsec_mb_method(const char *opt)
 	return -1;
 }
 
+/*
+ *  stress_ipsec_rate_gbs()
+ *	GB/s of a rate, 0.0 if nothing was measured
+ */
+static inline double stress_ipsec_rate_gbs(const stress_ipsec_rate_t *rate)
+{
+	return (rate->duration > 0.0) ? rate->bytes / (rate->duration * 1.0E9) : 0.0;
+}
+
+/*
+ *  stress_ipsec_sweep_dump()
+ *	dump GB/s for each burst size and buffer length of each
+ *	feature and method that was exercised
+ */
+static void stress_ipsec_sweep_dump(
+	stress_args_t *args,
+	const size_t n_bursts,
+	const size_t n_lens)
+{
+	size_t f, m, b, l;
+
+	for (f = 0; f < STRESS_IPSEC_FEATURES; f++) {
+		for (m = 1; m < STRESS_IPSEC_METHODS; m++) {
+			char buf[128], *ptr;
+			bool used = false;
+
+			for (b = 0; b < n_bursts; b++)
+				for (l = 0; l < n_lens; l++)
+					used |= (ipsec_rates[f][m][b][l].duration > 0.0);
+			if (!used)
+				continue;
+
+			ptr = buf;
+			ptr += snprintf(ptr, sizeof(buf), "%6s", "burst");
+			for (l = 0; l < n_lens; l++)
+				ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), " %6zuB", stress_ipsec_lens[l]);
+			pr_inf("%s: %s %s GB/s:\n", args->name, mb_features[f].name, stress_ipsec_funcs[m].name);
+			pr_inf("%s: %s\n", args->name, buf);
+
+			for (b = 0; b < n_bursts; b++) {
+				ptr = buf;
+				if (stress_ipsec_bursts[b])
+					ptr += snprintf(ptr, sizeof(buf), "%6" PRIu32, stress_ipsec_bursts[b]);
+				else
+					ptr += snprintf(ptr, sizeof(buf), "%6s", "job");
+				for (l = 0; l < n_lens; l++)
+					ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), " %7.3f",
+						stress_ipsec_rate_gbs(&ipsec_rates[f][m][b][l]));
+				pr_inf("%s: %s\n", args->name, buf);
+			}
+		}
+	}
+}
+
 /*
  *  stress_ipsec_mb()
  *      stress Intel ipsec_mb instruction
@@ -817,15 +1022,21 @@ static int stress_ipsec_mb(stress_args_t *args)
 {
 	IMB_MGR *mb_mgr = NULL;
 	uint64_t features;
-	uint8_t data[8192] ALIGNED(64);
-	size_t i, j;
+	uint8_t data[STRESS_IPSEC_DATA_SIZE] ALIGNED(64);
+	size_t i, j, b, l;
 	bool got_features = false;
 	size_t ipsec_mb_feature = 0;
 	size_t ipsec_mb_method = 0;
 	int ipsec_mb_jobs = 128;
+	uint32_t ipsec_mb_burst = 0;
+	bool ipsec_mb_sweep = false;
+	size_t burst_index = 0, len_index = STRESS_IPSEC_LENS - 1;
+	size_t n_bursts = 1, n_lens = 1;
 
 	(void)stress_get_setting("ipsec-mb-jobs", &ipsec_mb_jobs);
 	(void)stress_get_setting("ipsec-mb-method", &ipsec_mb_method);
+	(void)stress_get_setting("ipsec-mb-burst", &ipsec_mb_burst);
+	(void)stress_get_setting("ipsec-mb-sweep", &ipsec_mb_sweep);
 
 	if (imb_get_version() < IMB_VERSION(0, 51, 0)) {
 		if (args->instance == 0)
@@ -834,6 +1045,33 @@ static int stress_ipsec_mb(stress_args_t *args)
 		return EXIT_NOT_IMPLEMENTED;
 	}
 
+#if defined(STRESS_IPSEC_BURST)
+	if (ipsec_mb_burst > STRESS_IPSEC_BURST_MAX)
+		ipsec_mb_burst = STRESS_IPSEC_BURST_MAX;
+	/* burst sizes up to the number of jobs per round */
+	for (n_bursts = 1; n_bursts < STRESS_IPSEC_BURSTS; n_bursts++) {
+		if ((stress_ipsec_bursts[n_bursts] > (uint32_t)ipsec_mb_jobs) ||
+		    (stress_ipsec_bursts[n_bursts] > STRESS_IPSEC_BURST_MAX))
+			break;
+	}
+#else
+	if (ipsec_mb_burst && (args->instance == 0))
+		pr_inf("%s: IPSec MB library has no burst API, using the job API\n", args->name);
+	ipsec_mb_burst = 0;
+#endif
+	/* use the largest burst size that is not more than the requested size */
+	for (i = 0; i < n_bursts; i++) {
+		if (stress_ipsec_bursts[i] <= ipsec_mb_burst)
+			burst_index = i;
+	}
+	if (ipsec_mb_sweep) {
+		n_lens = STRESS_IPSEC_LENS;
+		burst_index = 0;
+		len_index = 0;
+	} else {
+		n_bursts = 1;
+	}
+
 	mb_mgr = alloc_mb_mgr(0);
 	if (!mb_mgr) {
 		if (args->instance == 0)
@@ -876,14 +1114,21 @@ static int stress_ipsec_mb(stress_args_t *args)
 			pr_inf("%s: using just feature '%s'\n", args->name, feature_name);
 	}
 
+	(void)shim_memset(ipsec_rates, 0, sizeof(ipsec_rates));
 	stress_rnd_fill(data, sizeof(data));
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	b = burst_index;
+	l = len_index;
 	do {
-		for (i = 0; i < SIZEOF_ARRAY(mb_features); i++) {
-			if (mb_features[i].supported) {
-				mb_features[i].init_func(mb_mgr);
-				stress_ipsec_call_func(args, mb_mgr, data, sizeof(data), ipsec_mb_jobs, ipsec_mb_method);
+		stress_ipsec_call_func(args, mb_mgr, data, ipsec_mb_jobs, b, l, ipsec_mb_method);
+		if (ipsec_mb_sweep) {
+			l++;
+			if (l >= n_lens) {
+				l = 0;
+				b++;
+				if (b >= n_bursts)
+					b = 0;
 			}
 		}
 	} while (stress_continue(args));
@@ -905,6 +1150,30 @@ static int stress_ipsec_mb(stress_args_t *args)
 			j++;
 		}
 	}
+	for (i = 0; i < STRESS_IPSEC_FEATURES; i++) {
+		size_t m;
+
+		for (m = 1; m < STRESS_IPSEC_METHODS; m++) {
+			stress_ipsec_rate_t total = { 0.0, 0.0 };
+			char tmp[64];
+
+			for (b = 0; b < STRESS_IPSEC_BURSTS; b++) {
+				for (l = 0; l < STRESS_IPSEC_LENS; l++) {
+					total.bytes += ipsec_rates[i][m][b][l].bytes;
+					total.duration += ipsec_rates[i][m][b][l].duration;
+				}
+			}
+			if (total.duration <= 0.0)
+				continue;
+			(void)snprintf(tmp, sizeof(tmp), "%s %s GB/s",
+				mb_features[i].name, stress_ipsec_funcs[m].name);
+			stress_metrics_set(args, j, tmp,
+				stress_ipsec_rate_gbs(&total), STRESS_HARMONIC_MEAN);
+			j++;
+		}
+	}
+	if (ipsec_mb_sweep && (args->instance == 0))
+		stress_ipsec_sweep_dump(args, n_bursts, n_lens);
 	pr_block_end();
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -18,12 +18,23 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-hash.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LIBJPEG_H)
 #include <jpeglib.h>
 #endif
 
+#define MAX_JPEG_THREADS	(64)
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_LIBJPEG_H) &&		\
+    (defined(MEM_SRCDST_SUPPORTED) ||	\
+     (JPEG_LIB_VERSION >= 80))
+#define HAVE_JPEG_TILES
+#endif
+
 #define JPEG_IMAGE_PLASMA	(0x00)
 #define JPEG_IMAGE_NOISE	(0x01)
 #define JPEG_IMAGE_GRADIENT	(0x02)
@@ -38,10 +49,12 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"jpeg N",		"start N workers that burn cycles with no-ops" },
+	{ NULL,	"jpeg-decode",		"decode the compressed image tiles again" },
 	{ NULL,	"jpeg-height N",	"image height in pixels "},
 	{ NULL,	"jpeg-image type",	"image type: one of brown, flat, gradient, noise, plasma or xstripes" },
 	{ NULL,	"jpeg-ops N",		"stop after N jpeg bogo no-op operations" },
 	{ NULL,	"jpeg-quality Q",	"compression quality 1 (low) .. 100 (high)" },
+	{ NULL,	"jpeg-threads N",	"encode image tiles in parallel with N threads per worker" },
 	{ NULL,	"jpeg-width N",		"image width in pixels "},
 	{ NULL,	NULL,			NULL }
 };
@@ -115,11 +128,31 @@ static int stress_set_jpeg_image(const char *opt)
 	return -1;
 }
 
+/*
+ *  stress_set_jpeg_threads()
+ *      set number of tile encode threads, 0 = encode whole image
+ */
+static int stress_set_jpeg_threads(const char *opt)
+{
+	uint32_t jpeg_threads;
+
+	jpeg_threads = stress_get_uint32(opt);
+	stress_check_range("jpeg-threads", (uint64_t)jpeg_threads, 0, MAX_JPEG_THREADS);
+	return stress_set_setting("jpeg-threads", TYPE_ID_UINT32, &jpeg_threads);
+}
+
+static int stress_set_jpeg_decode(const char *opt)
+{
+	return stress_set_setting_true("jpeg-decode", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_jpeg_decode,	stress_set_jpeg_decode },
 	{ OPT_jpeg_height,	stress_set_jpeg_height },
 	{ OPT_jpeg_image,	stress_set_jpeg_image },
 	{ OPT_jpeg_width,	stress_set_jpeg_width },
 	{ OPT_jpeg_quality,	stress_set_jpeg_quality },
+	{ OPT_jpeg_threads,	stress_set_jpeg_threads },
 	{ 0,			NULL }
 };
 
@@ -372,6 +405,395 @@ PRAGMA_UNROLL_N(8)
 	return (int)size;
 }
 
+#if defined(HAVE_JPEG_TILES)
+typedef struct {
+	int32_t		y;		/* first row of the tile */
+	int32_t		rows;		/* rows in the tile */
+	unsigned char	*jpeg;		/* compressed tile */
+	unsigned long	jpeg_size;	/* compressed tile size */
+	bool		failed;		/* compress or decompress failed */
+} stress_jpeg_tile_t;
+
+typedef struct {
+	pthread_mutex_t		lock;		/* protects the fields below */
+	pthread_cond_t		start;		/* new phase for the threads */
+	pthread_cond_t		done;		/* all threads completed the phase */
+	uint64_t		generation;	/* phase number */
+	size_t			remaining;	/* threads still busy */
+	size_t			next;		/* next tile to process */
+	bool			decode;		/* decode or encode phase */
+	bool			stop;		/* threads should exit */
+	size_t			n_tiles;	/* number of tiles */
+	stress_jpeg_tile_t	*tiles;		/* tiles to process */
+	uint8_t			*rgb;		/* source image */
+	uint8_t			*decoded;	/* decoded image */
+	int32_t			x_max;		/* image width */
+	int32_t			quality;	/* compression quality */
+} stress_jpeg_tiles_t;
+
+typedef struct {
+	stress_jpeg_tiles_t	*tiles;		/* shared tile state */
+	pthread_t		pthread;	/* thread handle */
+	int			ret;		/* pthread_create return */
+	JSAMPROW		*row_pointer;	/* rows of the current tile */
+} stress_jpeg_thread_t;
+
+/*
+ *  stress_jpeg_tile_encode()
+ *	compress the rows of a tile into a jpeg in memory
+ */
+static void stress_jpeg_tile_encode(
+	const stress_jpeg_tiles_t *tiles,
+	stress_jpeg_tile_t *tile,
+	JSAMPROW *row_pointer)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	const int row_stride = tiles->x_max * 3;
+	int32_t y;
+
+	free(tile->jpeg);
+	tile->jpeg = NULL;
+	tile->jpeg_size = 0;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+	jpeg_mem_dest(&cinfo, &tile->jpeg, &tile->jpeg_size);
+
+	cinfo.image_width = (JDIMENSION)tiles->x_max;
+	cinfo.image_height = (JDIMENSION)tile->rows;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, (int)tiles->quality, TRUE);
+	jpeg_start_compress(&cinfo, TRUE);
+
+	for (y = 0; y < tile->rows; y++)
+		row_pointer[y] = tiles->rgb + ((size_t)(tile->y + y) * (size_t)row_stride);
+	(void)jpeg_write_scanlines(&cinfo, row_pointer, (JDIMENSION)tile->rows);
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	tile->failed = (tile->jpeg == NULL) || (tile->jpeg_size == 0);
+}
+
+/*
+ *  stress_jpeg_tile_decode()
+ *	decompress a tile jpeg into its rows of the decoded image
+ */
+static void stress_jpeg_tile_decode(
+	const stress_jpeg_tiles_t *tiles,
+	stress_jpeg_tile_t *tile)
+{
+	struct jpeg_decompress_struct dinfo;
+	struct jpeg_error_mgr jerr;
+	const int row_stride = tiles->x_max * 3;
+
+	dinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_decompress(&dinfo);
+	jpeg_mem_src(&dinfo, tile->jpeg, tile->jpeg_size);
+	if (jpeg_read_header(&dinfo, TRUE) != JPEG_HEADER_OK) {
+		tile->failed = true;
+		goto tidy;
+	}
+	dinfo.out_color_space = JCS_RGB;
+	(void)jpeg_start_decompress(&dinfo);
+	if ((dinfo.output_width != (JDIMENSION)tiles->x_max) ||
+	    (dinfo.output_height != (JDIMENSION)tile->rows) ||
+	    (dinfo.output_components != 3)) {
+		tile->failed = true;
+		jpeg_abort_decompress(&dinfo);
+		goto tidy;
+	}
+	while (dinfo.output_scanline < dinfo.output_height) {
+		JSAMPROW row = tiles->decoded +
+			((size_t)(tile->y + (int32_t)dinfo.output_scanline) * (size_t)row_stride);
+
+		if (jpeg_read_scanlines(&dinfo, &row, 1) != 1) {
+			tile->failed = true;
+			jpeg_abort_decompress(&dinfo);
+			goto tidy;
+		}
+	}
+	(void)jpeg_finish_decompress(&dinfo);
+tidy:
+	jpeg_destroy_decompress(&dinfo);
+}
+
+/*
+ *  stress_jpeg_tile_thread()
+ *	encode or decode tiles until there are none left
+ *	in the current phase
+ */
+static void *stress_jpeg_tile_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_jpeg_thread_t *thread = (stress_jpeg_thread_t *)arg;
+	stress_jpeg_tiles_t *tiles = thread->tiles;
+	uint64_t generation = 0;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	for (;;) {
+		bool decode;
+
+		(void)pthread_mutex_lock(&tiles->lock);
+		while (!tiles->stop && (tiles->generation == generation))
+			(void)pthread_cond_wait(&tiles->start, &tiles->lock);
+		if (tiles->stop) {
+			(void)pthread_mutex_unlock(&tiles->lock);
+			break;
+		}
+		generation = tiles->generation;
+		decode = tiles->decode;
+		(void)pthread_mutex_unlock(&tiles->lock);
+
+		for (;;) {
+			stress_jpeg_tile_t *tile;
+			size_t idx;
+
+			(void)pthread_mutex_lock(&tiles->lock);
+			idx = tiles->next++;
+			(void)pthread_mutex_unlock(&tiles->lock);
+			if (idx >= tiles->n_tiles)
+				break;
+
+			tile = &tiles->tiles[idx];
+			if (decode) {
+				if (!tile->failed)
+					stress_jpeg_tile_decode(tiles, tile);
+			} else {
+				stress_jpeg_tile_encode(tiles, tile, thread->row_pointer);
+			}
+		}
+
+		(void)pthread_mutex_lock(&tiles->lock);
+		tiles->remaining--;
+		if (tiles->remaining == 0)
+			(void)pthread_cond_signal(&tiles->done);
+		(void)pthread_mutex_unlock(&tiles->lock);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_jpeg_tiles_phase()
+ *	run an encode or decode phase across all the threads,
+ *	returns the wall clock time of the phase
+ */
+static double stress_jpeg_tiles_phase(
+	stress_jpeg_tiles_t *tiles,
+	const size_t n_threads,
+	const bool decode)
+{
+	const double t = stress_time_now();
+
+	(void)pthread_mutex_lock(&tiles->lock);
+	tiles->decode = decode;
+	tiles->next = 0;
+	tiles->remaining = n_threads;
+	tiles->generation++;
+	(void)pthread_cond_broadcast(&tiles->start);
+	while (tiles->remaining > 0)
+		(void)pthread_cond_wait(&tiles->done, &tiles->lock);
+	(void)pthread_mutex_unlock(&tiles->lock);
+
+	return stress_time_now() - t;
+}
+
+/*
+ *  stress_jpeg_tiles()
+ *	split the image into horizontal tiles that n_threads threads
+ *	encode as independent jpegs, optionally decoding them again
+ */
+static int stress_jpeg_tiles(
+	stress_args_t *args,
+	uint8_t *rgb,
+	const int32_t x_max,
+	const int32_t y_max,
+	const int32_t quality,
+	const size_t n_threads,
+	const bool decode)
+{
+	const size_t rgb_size = (size_t)x_max * (size_t)y_max * 3;
+	const double pixels = (double)x_max * (double)y_max;
+	stress_jpeg_tiles_t tiles;
+	stress_jpeg_thread_t *threads;
+	int32_t tile_rows;
+	size_t i, started = 0;
+	double t_encode = 0.0, t_decode = 0.0, rounds = 0.0;
+	double size_compressed = 0.0, rate, ratio;
+	uint32_t encode_crc = 0, decode_crc = 0;
+	int ret = EXIT_NO_RESOURCE;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	/* two tiles per thread, multiple of the 16 row MCU height */
+	if (n_threads > 1) {
+		tile_rows = (y_max / (int32_t)(n_threads * 2)) & ~15;
+		if (tile_rows < 16)
+			tile_rows = 16;
+	} else {
+		tile_rows = y_max;
+	}
+
+	(void)shim_memset(&tiles, 0, sizeof(tiles));
+	tiles.n_tiles = (size_t)((y_max + tile_rows - 1) / tile_rows);
+	tiles.rgb = rgb;
+	tiles.x_max = x_max;
+	tiles.quality = quality;
+
+	tiles.tiles = (stress_jpeg_tile_t *)calloc(tiles.n_tiles, sizeof(*tiles.tiles));
+	if (!tiles.tiles) {
+		pr_inf_skip("%s: failed to allocate %zu tiles, skipping stressor\n",
+			args->name, tiles.n_tiles);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < tiles.n_tiles; i++) {
+		tiles.tiles[i].y = (int32_t)i * tile_rows;
+		tiles.tiles[i].rows = STRESS_MINIMUM(tile_rows, y_max - tiles.tiles[i].y);
+	}
+	threads = (stress_jpeg_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: failed to allocate %zu threads, skipping stressor\n",
+			args->name, n_threads);
+		goto tidy_tiles;
+	}
+	for (i = 0; i < n_threads; i++) {
+		threads[i].tiles = &tiles;
+		threads[i].row_pointer = (JSAMPROW *)calloc((size_t)tile_rows, sizeof(JSAMPROW));
+		if (!threads[i].row_pointer) {
+			pr_inf_skip("%s: failed to allocate row pointers, skipping stressor\n",
+				args->name);
+			goto tidy_row_pointers;
+		}
+	}
+	if (decode) {
+		tiles.decoded = (uint8_t *)stress_mmap_populate(NULL, rgb_size,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (tiles.decoded == MAP_FAILED) {
+			tiles.decoded = NULL;
+			pr_inf_skip("%s: cannot allocate decode buffer of %zu bytes, skipping stressor\n",
+				args->name, rgb_size);
+			goto tidy_row_pointers;
+		}
+	}
+
+	(void)pthread_mutex_init(&tiles.lock, NULL);
+	(void)pthread_cond_init(&tiles.start, NULL);
+	(void)pthread_cond_init(&tiles.done, NULL);
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_jpeg_tile_thread, (void *)&threads[i]);
+		if (threads[i].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, threads[i].ret, strerror(threads[i].ret));
+			goto tidy_threads;
+		}
+		started++;
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: %zu threads encoding%s %zu tiles of %" PRId32 " x %" PRId32 " pixels\n",
+			args->name, n_threads, decode ? " and decoding" : "",
+			tiles.n_tiles, x_max, tile_rows);
+
+	ret = EXIT_SUCCESS;
+	do {
+		uint32_t crc = 0;
+
+		t_encode += stress_jpeg_tiles_phase(&tiles, n_threads, false);
+		if (decode)
+			t_decode += stress_jpeg_tiles_phase(&tiles, n_threads, true);
+
+		for (i = 0; i < tiles.n_tiles; i++) {
+			const stress_jpeg_tile_t *tile = &tiles.tiles[i];
+
+			if (tile->failed) {
+				pr_fail("%s: failed to %s tile %zu of %" PRId32 " rows at row %" PRId32 "\n",
+					args->name, decode ? "encode or decode" : "encode",
+					i, tile->rows, tile->y);
+				ret = EXIT_FAILURE;
+				break;
+			}
+			size_compressed += (double)tile->jpeg_size;
+			if (verify)
+				crc = shim_ror32(crc) ^ stress_hash_crc32c_len(tile->jpeg, (size_t)tile->jpeg_size);
+		}
+		if (ret != EXIT_SUCCESS)
+			break;
+
+		/* the image does not change, so neither should the jpegs */
+		if (verify) {
+			if (rounds < 1.0) {
+				encode_crc = crc;
+			} else if (crc != encode_crc) {
+				pr_fail("%s: encoded tiles checksum 0x%8.8" PRIx32 " differs from "
+					"the first round checksum 0x%8.8" PRIx32 "\n",
+					args->name, crc, encode_crc);
+				ret = EXIT_FAILURE;
+				break;
+			}
+			if (decode) {
+				crc = stress_hash_crc32c_len(tiles.decoded, rgb_size);
+				if (rounds < 1.0) {
+					decode_crc = crc;
+				} else if (crc != decode_crc) {
+					pr_fail("%s: decoded image checksum 0x%8.8" PRIx32 " differs from "
+						"the first round checksum 0x%8.8" PRIx32 "\n",
+						args->name, crc, decode_crc);
+					ret = EXIT_FAILURE;
+					break;
+				}
+			}
+		}
+		rounds += 1.0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	rate = (t_encode > 0.0) ? (rounds * pixels) / t_encode : 0.0;
+	stress_metrics_set(args, 0, "megapixels compressed per sec",
+		rate / 1000000.0, STRESS_HARMONIC_MEAN);
+	ratio = (rounds > 0.0) ? 100.0 * size_compressed / (rounds * (double)rgb_size) : 0.0;
+	stress_metrics_set(args, 1, "% compression ratio",
+		ratio, STRESS_HARMONIC_MEAN);
+	if (decode) {
+		rate = (t_decode > 0.0) ? (rounds * pixels) / t_decode : 0.0;
+		stress_metrics_set(args, 2, "megapixels decompressed per sec",
+			rate / 1000000.0, STRESS_HARMONIC_MEAN);
+	}
+
+tidy_threads:
+	(void)pthread_mutex_lock(&tiles.lock);
+	tiles.stop = true;
+	(void)pthread_cond_broadcast(&tiles.start);
+	(void)pthread_mutex_unlock(&tiles.lock);
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	(void)pthread_cond_destroy(&tiles.done);
+	(void)pthread_cond_destroy(&tiles.start);
+	(void)pthread_mutex_destroy(&tiles.lock);
+	if (tiles.decoded)
+		(void)munmap((void *)tiles.decoded, rgb_size);
+tidy_row_pointers:
+	for (i = 0; i < n_threads; i++)
+		free(threads[i].row_pointer);
+	free(threads);
+tidy_tiles:
+	for (i = 0; i < tiles.n_tiles; i++)
+		free(tiles.tiles[i].jpeg);
+	free(tiles.tiles);
+
+	return ret;
+}
+#endif
+
 /*
  *  stress_jpeg()
  *	stress jpeg compression
@@ -392,11 +814,25 @@ static int stress_jpeg(stress_args_t *args)
 	int jpeg_image = JPEG_IMAGE_PLASMA;
 	double total_pixels = 0.0, t_start, duration, rate, ratio;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	uint32_t jpeg_threads = 0;
+	bool jpeg_decode = false;
 
 	(void)stress_get_setting("jpeg-width", &x_max);
 	(void)stress_get_setting("jpeg-height", &y_max);
 	(void)stress_get_setting("jpeg-quality", &jpeg_quality);
 	(void)stress_get_setting("jpeg-image", &jpeg_image);
+	(void)stress_get_setting("jpeg-threads", &jpeg_threads);
+	(void)stress_get_setting("jpeg-decode", &jpeg_decode);
+
+#if !defined(HAVE_JPEG_TILES)
+	if ((jpeg_threads > 0) || jpeg_decode) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: pthreads or in memory jpeg support not available, "
+				"cannot use --jpeg-threads or --jpeg-decode, skipping stressor\n",
+				args->name);
+		return EXIT_NO_RESOURCE;
+	}
+#endif
 
 	rgb_size = (size_t)x_max * (size_t)y_max * 3;
 	rgb = stress_mmap_populate(NULL, rgb_size,
@@ -444,6 +880,21 @@ static int stress_jpeg(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+#if defined(HAVE_JPEG_TILES)
+	if ((jpeg_threads > 0) || jpeg_decode) {
+		int ret;
+
+		ret = stress_jpeg_tiles(args, rgb, x_max, y_max, jpeg_quality,
+			jpeg_threads > 0 ? (size_t)jpeg_threads : 1, jpeg_decode);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+		(void)munmap((void *)row_pointer, row_pointer_size);
+		(void)munmap((void *)rgb, rgb_size);
+
+		return ret;
+	}
+#endif
+
 	t_jpeg = 0.0;
 	t_start = stress_time_now();
 	pixels = (uint64_t)x_max * (uint64_t)y_max;
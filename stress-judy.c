@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-art.h"
+#include "core-open-hash.h"
 
 #if defined(HAVE_JUDY_H)
 #include <Judy.h>
@@ -32,8 +34,41 @@
 #define JUDY_OP_DELETE		(2)
 #define JUDY_OP_MAX		(3)
 
+#define JUDY_KEYS_CLUSTERED	(0)
+#define JUDY_KEYS_DENSE		(1)
+#define JUDY_KEYS_SPARSE	(2)
+
+#if defined(HAVE_JUDY_H) && \
+    defined(HAVE_LIB_JUDY)
+#define HAVE_JUDY	(1)
+#endif
+
+typedef struct {
+	double duration[JUDY_OP_MAX];	/* time spent on each op */
+	double count[JUDY_OP_MAX];	/* number of each op */
+	double bytes;			/* memory used when fully populated */
+	double bytes_count;		/* number of memory measurements */
+} stress_judy_stats_t;
+
+typedef int (*stress_judy_func_t)(stress_args_t *args, const size_t n,
+	const size_t keys, stress_judy_stats_t *stats);
+
+typedef struct {
+	const char *name;		/* method name */
+	const char *label;		/* metrics label */
+	const stress_judy_func_t func;	/* populate, find and delete */
+} stress_judy_method_t;
+
+static const char * const judy_keys[] = {
+	"clustered",
+	"dense",
+	"sparse",
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"judy N",	"start N workers that exercise a judy array search" },
+	{ NULL,	"judy-keys K",	"select key set: clustered, dense, sparse" },
+	{ NULL,	"judy-method M", "select array method: art, judy" },
 	{ NULL,	"judy-ops N",	"stop after N judy array search bogo operations" },
 	{ NULL,	"judy-size N",	"number of 32 bit integers to insert into judy array" },
 	{ NULL,	NULL,		NULL }
@@ -53,34 +88,258 @@ static int stress_set_judy_size(const char *opt)
 	return stress_set_setting("judy-size", TYPE_ID_UINT64, &judy_size);
 }
 
-static const stress_opt_set_func_t opt_set_funcs[] = {
-	{ OPT_judy_size,	stress_set_judy_size },
-	{ 0,			NULL }
+/*
+ *  stress_set_judy_keys()
+ *      set the key set to insert
+ */
+static int stress_set_judy_keys(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(judy_keys); i++) {
+		if (!strcmp(judy_keys[i], opt)) {
+			stress_set_setting("judy-keys", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "judy-keys must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(judy_keys); i++)
+		(void)fprintf(stderr, " %s", judy_keys[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  generate a unique index position from a known small
+ *  index for the given key set
+ */
+static inline OPTIMIZE3 uint64_t gen_index(const size_t keys, const uint64_t idx)
+{
+	switch (keys) {
+	case JUDY_KEYS_DENSE:
+		return idx;
+	case JUDY_KEYS_SPARSE:
+		/* bijective mixes keep the keys unique */
+		if (sizeof(unsigned long) < sizeof(uint64_t))
+			return (uint32_t)(idx * 0x9e3779b1U);
+		return stress_open_hash_mix64(idx);
+	default:
+		return ((~idx & 0xff) << 24) | (idx & 0x00ffffff);
+	}
+}
+
+#if defined(HAVE_JUDY)
+/*
+ *  stress_judy_judy()
+ *	populate, find and delete n keys in a Judy array
+ */
+static int OPTIMIZE3 stress_judy_judy(
+	stress_args_t *args,
+	const size_t n,
+	const size_t keys,
+	stress_judy_stats_t *stats)
+{
+	Pvoid_t PJLArray = (Pvoid_t)NULL;
+	Word_t *pvalue, mem_used;
+	register Word_t i, j;
+	int rc;
+	double t;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	/* Step #1, populate Judy array in index order */
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		Word_t idx = (Word_t)gen_index(keys, i);
+
+		JLI(pvalue, PJLArray, idx);
+		if (UNLIKELY((pvalue == NULL) || (pvalue == PJERR))) {
+			pr_err("%s: cannot allocate new "
+				"judy node\n", args->name);
+			for (j = 0; j < n; j++) {
+				idx = (Word_t)gen_index(keys, j);
+				JLD(rc, PJLArray, idx);
+			}
+			return -1;
+		}
+		*pvalue = i;
+	}
+	stats->duration[JUDY_OP_INSERT] += stress_time_now() - t;
+	stats->count[JUDY_OP_INSERT] += n;
+
+	JLMU(mem_used, PJLArray);
+	stats->bytes += (double)mem_used;
+	stats->bytes_count += 1.0;
+
+	/* Step #2, find */
+	t = stress_time_now();
+	for (i = 0; stress_continue_flag() && (i < n); i++) {
+		Word_t idx = (Word_t)gen_index(keys, i);
+
+		JLG(pvalue, PJLArray, idx);
+		if (UNLIKELY(verify)) {
+			if (UNLIKELY(!pvalue)) {
+				pr_fail("%s: element %" PRIu32
+					"could not be found\n",
+					args->name, (uint32_t)idx);
+			} else {
+				if (UNLIKELY((uint32_t)*pvalue != i))
+					pr_fail("%s: element "
+						"%" PRIu32 " found %" PRIu32
+						", expecting %" PRIu32 "\n",
+						args->name, (uint32_t)idx,
+						(uint32_t)*pvalue, (uint32_t)i);
+			}
+		}
+	}
+	stats->duration[JUDY_OP_FIND] += stress_time_now() - t;
+	stats->count[JUDY_OP_FIND] += n;
+
+	/* Step #3, delete, reverse index order */
+	t = stress_time_now();
+	for (j = n -1, i = 0; i < n; i++, j--) {
+		Word_t idx = (Word_t)gen_index(keys, j);
+
+		JLD(rc, PJLArray, idx);
+		if (UNLIKELY(verify && (rc != 1)))
+			pr_fail("%s: element %" PRIu32 " could not "
+				"be found\n", args->name, (uint32_t)idx);
+	}
+	stats->duration[JUDY_OP_DELETE] += stress_time_now() - t;
+	stats->count[JUDY_OP_DELETE] += n;
+
+	return 0;
+}
+#endif
+
+/*
+ *  stress_judy_art()
+ *	populate, find and delete n keys in an adaptive radix tree
+ */
+static int OPTIMIZE3 stress_judy_art(
+	stress_args_t *args,
+	const size_t n,
+	const size_t keys,
+	stress_judy_stats_t *stats)
+{
+	stress_art_t art;
+	register uint64_t i, j;
+	uint64_t *pvalue;
+	double t;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	stress_art_init(&art);
+
+	/* Step #1, populate tree in index order */
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		const uint64_t idx = gen_index(keys, i);
+
+		if (UNLIKELY(!stress_art_insert(&art, idx, i))) {
+			pr_err("%s: cannot allocate new "
+				"adaptive radix tree node\n", args->name);
+			stress_art_free(&art);
+			return -1;
+		}
+	}
+	stats->duration[JUDY_OP_INSERT] += stress_time_now() - t;
+	stats->count[JUDY_OP_INSERT] += n;
+
+	stats->bytes += (double)art.bytes;
+	stats->bytes_count += 1.0;
+
+	/* Step #2, find */
+	t = stress_time_now();
+	for (i = 0; stress_continue_flag() && (i < n); i++) {
+		const uint64_t idx = gen_index(keys, i);
+
+		pvalue = stress_art_get(&art, idx);
+		if (UNLIKELY(verify)) {
+			if (UNLIKELY(!pvalue)) {
+				pr_fail("%s: element %" PRIu64
+					" could not be found\n",
+					args->name, idx);
+			} else {
+				if (UNLIKELY(*pvalue != i))
+					pr_fail("%s: element "
+						"%" PRIu64 " found %" PRIu64
+						", expecting %" PRIu64 "\n",
+						args->name, idx, *pvalue, i);
+			}
+		}
+	}
+	stats->duration[JUDY_OP_FIND] += stress_time_now() - t;
+	stats->count[JUDY_OP_FIND] += n;
+
+	/* Step #3, delete, reverse index order */
+	t = stress_time_now();
+	for (j = n - 1, i = 0; i < n; i++, j--) {
+		const uint64_t idx = gen_index(keys, j);
+
+		if (UNLIKELY(!stress_art_delete(&art, idx) && verify))
+			pr_fail("%s: element %" PRIu64 " could not "
+				"be found\n", args->name, idx);
+	}
+	stats->duration[JUDY_OP_DELETE] += stress_time_now() - t;
+	stats->count[JUDY_OP_DELETE] += n;
+
+	if (UNLIKELY(verify && (art.root || art.bytes))) {
+		pr_fail("%s: adaptive radix tree not empty after deleting "
+			"all elements, %zu bytes still allocated\n",
+			args->name, art.bytes);
+		stress_art_free(&art);
+	}
+	return 0;
+}
+
+static const stress_judy_method_t judy_methods[] = {
+#if defined(HAVE_JUDY)
+	{ "judy",	"Judy",	stress_judy_judy },
+#endif
+	{ "art",	"ART",	stress_judy_art },
 };
 
-#if defined(HAVE_JUDY_H) && \
-    defined(HAVE_LIB_JUDY)
 /*
- *  generate a unique large index position into a Judy array
- *  from a known small index
+ *  stress_set_judy_method()
+ *      set the array implementation
  */
-static inline OPTIMIZE3 Word_t gen_index(const Word_t idx)
+static int stress_set_judy_method(const char *opt)
 {
-	return ((~idx & 0xff) << 24) | (idx & 0x00ffffff);
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(judy_methods); i++) {
+		if (!strcmp(judy_methods[i].name, opt)) {
+			stress_set_setting("judy-method", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "judy-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(judy_methods); i++)
+		(void)fprintf(stderr, " %s", judy_methods[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
 }
 
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_judy_keys,	stress_set_judy_keys },
+	{ OPT_judy_method,	stress_set_judy_method },
+	{ OPT_judy_size,	stress_set_judy_size },
+	{ 0,			NULL }
+};
+
 /*
  *  stress_judy()
- *	stress a judy array, exercises cache/memory
+ *	stress a judy array or adaptive radix tree, exercises cache/memory
  */
 static int OPTIMIZE3 stress_judy(stress_args_t *args)
 {
 	uint64_t judy_size = DEFAULT_JUDY_SIZE;
-	size_t n;
-	register Word_t i, j;
-	double duration[JUDY_OP_MAX], count[JUDY_OP_MAX];
-	size_t k;
-	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t n, k, judy_method = 0, keys = JUDY_KEYS_CLUSTERED;
+	const stress_judy_method_t *method;
+	stress_judy_stats_t stats;
 
 	static const char * const judy_ops[] = {
 		"insert",
@@ -94,88 +353,35 @@ static int OPTIMIZE3 stress_judy(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			judy_size = MIN_JUDY_SIZE;
 	}
+	(void)stress_get_setting("judy-method", &judy_method);
+	(void)stress_get_setting("judy-keys", &keys);
 	n = (size_t)judy_size;
+	method = &judy_methods[judy_method];
 
-	for (k = 0; k < JUDY_OP_MAX; k++) {
-		duration[k] = 0.0;
-		count[k] = 0.0;
-	}
+	(void)memset(&stats, 0, sizeof(stats));
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		Pvoid_t PJLArray = (Pvoid_t)NULL;
-		Word_t *pvalue;
-		int rc;
-		double t;
-
-		/* Step #1, populate Judy array in sparse index order */
-		t = stress_time_now();
-		for (i = 0; i < n; i++) {
-			Word_t idx = gen_index(i);
-
-			JLI(pvalue, PJLArray, idx);
-			if (UNLIKELY((pvalue == NULL) || (pvalue == PJERR))) {
-				pr_err("%s: cannot allocate new "
-					"judy node\n", args->name);
-				for (j = 0; j < n; j++) {
-					JLD(rc, PJLArray, idx);
-				}
-				goto abort;
-			}
-			*pvalue = i;
-		}
-		duration[JUDY_OP_INSERT] += stress_time_now() - t;
-		count[JUDY_OP_INSERT] += n;
-
-		/* Step #2, find */
-		t = stress_time_now();
-		for (i = 0; stress_continue_flag() && (i < n); i++) {
-			Word_t idx = gen_index(i);
-
-			JLG(pvalue, PJLArray, idx);
-			if (UNLIKELY(verify)) {
-				if (UNLIKELY(!pvalue)) {
-					pr_fail("%s: element %" PRIu32
-						"could not be found\n",
-						args->name, (uint32_t)idx);
-				} else {
-					if (UNLIKELY((uint32_t)*pvalue != i))
-						pr_fail("%s: element "
-							"%" PRIu32 " found %" PRIu32
-							", expecting %" PRIu32 "\n",
-							args->name, (uint32_t)idx,
-							(uint32_t)*pvalue, (uint32_t)i);
-				}
-			}
-		}
-		duration[JUDY_OP_FIND] += stress_time_now() - t;
-		count[JUDY_OP_FIND] += n;
-
-		/* Step #3, delete, reverse index order */
-		t = stress_time_now();
-		for (j = n -1, i = 0; i < n; i++, j--) {
-			Word_t idx = gen_index(j);
-
-			JLD(rc, PJLArray, idx);
-			if (UNLIKELY(verify && (rc != 1)))
-				pr_fail("%s: element %" PRIu32 " could not "
-					"be found\n", args->name, (uint32_t)idx);
-		}
-		duration[JUDY_OP_DELETE] += stress_time_now() - t;
-		count[JUDY_OP_DELETE] += n;
-
+		if (method->func(args, n, keys, &stats) < 0)
+			break;
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
-abort:
 	for (k = 0; k < JUDY_OP_MAX; k++) {
 		char msg[64];
-		const double rate = (duration[k] > 0.0) ? count[k] / duration[k] : 0.0;
+		const double rate = (stats.duration[k] > 0.0) ? stats.count[k] / stats.duration[k] : 0.0;
 
-		(void)snprintf(msg, sizeof(msg), "Judy %s operations per sec", judy_ops[k]);
+		(void)snprintf(msg, sizeof(msg), "%s %s operations per sec", method->label, judy_ops[k]);
 		stress_metrics_set(args, k, msg, rate, STRESS_HARMONIC_MEAN);
 	}
+	if (stats.bytes_count > 0.0) {
+		char msg[64];
+
+		(void)snprintf(msg, sizeof(msg), "%s bytes per %s key", method->label, judy_keys[keys]);
+		stress_metrics_set(args, JUDY_OP_MAX, msg,
+			stats.bytes / (stats.bytes_count * (double)n), STRESS_GEOMETRIC_MEAN);
+	}
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	return EXIT_SUCCESS;
@@ -188,13 +394,3 @@ stressor_info_t stress_judy_info = {
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
-#else
-stressor_info_t stress_judy_info = {
-	.stressor = stress_unimplemented,
-	.class = CLASS_CPU_CACHE | CLASS_CPU | CLASS_MEMORY,
-	.opt_set_funcs = opt_set_funcs,
-	.verify = VERIFY_OPTIONAL,
-	.help = help,
-	.unimplemented_reason = "built without Judy.h or Judy library support"
-};
-#endif
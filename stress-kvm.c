@@ -18,6 +18,7 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
 #include "core-madvise.h"
 
@@ -27,10 +28,21 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"kvm N",	"start N workers exercising /dev/kvm" },
+	{ NULL,	"kvm-exits",	"measure VM exit round trip times of port I/O, MMIO, HLT, CPUID and hypercalls" },
 	{ NULL, "kvm-ops N",	"stop after N kvm create/run/destroy operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_kvm_exits(const char *opt)
+{
+	return stress_set_setting_true("kvm-exits", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_kvm_exits,	stress_set_kvm_exits },
+	{ 0,			NULL },
+};
+
 #if defined(__linux__)	&&			\
     defined(HAVE_LINUX_KVM_H) && 		\
     defined(KVM_CREATE_VM) &&			\
@@ -61,6 +73,377 @@ static const uint8_t kvm_x86_kernel[] = {
 	0xeb, 0xf1,  /* jmp    0 <_start> */
 };
 
+#if defined(KVM_EXIT_HLT) &&			\
+    defined(KVM_EXIT_MMIO)
+#define STRESS_KVM_EXITS
+
+#define STRESS_KVM_EXIT_LOOPS		(1024)		/* exits per guest loop */
+#define STRESS_KVM_EXIT_MEM_SIZE	(64 * KB)	/* guest memory, code at 0 */
+#define STRESS_KVM_EXIT_MMIO_ADDR	(0x10000)	/* unbacked guest address */
+#define STRESS_KVM_EXIT_PIO_PORT	(0x80)		/* port I/O exit port */
+#define STRESS_KVM_EXIT_DONE_PORT	(0xf1)		/* end of guest loop port */
+#define STRESS_KVM_EXIT_SLICE		(0.1)		/* secs per exit type per turn */
+#define STRESS_KVM_EXIT_WATCHDOG	(250000)	/* usecs of CPU time, interrupts KVM_RUN */
+#define STRESS_KVM_EXIT_STUCK		(1.0)		/* secs without a complete guest loop */
+
+/*
+ *  Real mode guest instructions that trigger a VM exit, the
+ *  guest executes the instruction STRESS_KVM_EXIT_LOOPS times and
+ *  then signals the end of the loop with an out to port
+ *  STRESS_KVM_EXIT_DONE_PORT. Port I/O, MMIO and HLT exits return to
+ *  user space, CPUID and hypercalls are handled in the kernel.
+ */
+typedef struct {
+	const char *name;	/* exit type name */
+	const uint8_t insn[8];	/* guest instruction(s) */
+	const size_t insn_len;	/* length of insn in bytes */
+	const bool user;	/* true if exit returns to user space */
+} stress_kvm_exit_t;
+
+static const stress_kvm_exit_t kvm_exits[] = {
+	/* out %al,$0x80 */
+	{ "pio",	{ 0xe6, STRESS_KVM_EXIT_PIO_PORT }, 2, true },
+	/* mov %al,%ds:0x0, ds base is STRESS_KVM_EXIT_MMIO_ADDR */
+	{ "mmio",	{ 0xa2, 0x00, 0x00 }, 3, true },
+	/* hlt */
+	{ "hlt",	{ 0xf4 }, 1, true },
+	/* xor %eax,%eax; cpuid */
+	{ "cpuid",	{ 0x66, 0x31, 0xc0, 0x0f, 0xa2 }, 5, false },
+	/* xor %eax,%eax; vmcall, unknown hypercall 0 returns -KVM_ENOSYS */
+	{ "hypercall",	{ 0x66, 0x31, 0xc0, 0x0f, 0x01, 0xc1 }, 6, false },
+};
+
+/*
+ *  A minimal single vCPU VM to run the exit guest code in
+ */
+typedef struct {
+	int vm_fd;		/* VM fd */
+	int vcpu_fd;		/* vCPU fd */
+	void *mem;		/* guest memory */
+	struct kvm_run *run;	/* vCPU run state */
+	size_t run_size;	/* size of run mapping */
+} stress_kvm_vm_t;
+
+/*
+ *  stress_kvm_exit_code()
+ *	generate real mode guest code that loops STRESS_KVM_EXIT_LOOPS
+ *	times over the exit instruction, returns code size in bytes
+ */
+static size_t stress_kvm_exit_code(const stress_kvm_exit_t *exit_type, uint8_t *code)
+{
+	uint8_t *ptr = code, *loop;
+	uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+	*ptr++ = 0xbe;				/* mov $STRESS_KVM_EXIT_LOOPS,%si */
+	*ptr++ = (uint8_t)(STRESS_KVM_EXIT_LOOPS & 0xff);
+	*ptr++ = (uint8_t)(STRESS_KVM_EXIT_LOOPS >> 8);
+	loop = ptr;
+	(void)shim_memcpy(ptr, exit_type->insn, exit_type->insn_len);
+	ptr += exit_type->insn_len;
+	*ptr++ = 0x4e;				/* dec %si */
+	ptr[0] = 0x75;				/* jnz loop */
+	ptr[1] = (uint8_t)(loop - (ptr + 2));
+	ptr += 2;
+	*ptr++ = 0xe6;				/* out %al,$STRESS_KVM_EXIT_DONE_PORT */
+	*ptr++ = STRESS_KVM_EXIT_DONE_PORT;
+	ptr[0] = 0xeb;				/* jmp code */
+	ptr[1] = (uint8_t)(code - (ptr + 2));
+	ptr += 2;
+
+	/* AMD uses vmmcall rather than vmcall, avoid KVM patching the guest */
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+	if (!strcmp(exit_type->name, "hypercall") &&
+	    ((shim_memcmp(&ebx, "Auth", 4) == 0) || (shim_memcmp(&ebx, "Hygo", 4) == 0)))
+		code[3 + exit_type->insn_len - 1] = 0xd9;
+
+	return (size_t)(ptr - code);
+}
+
+/*
+ *  stress_kvm_vm_destroy()
+ *	destroy an exit VM
+ */
+static void stress_kvm_vm_destroy(stress_kvm_vm_t *vm)
+{
+	if (vm->run != MAP_FAILED)
+		(void)munmap((void *)vm->run, vm->run_size);
+	if (vm->vcpu_fd >= 0)
+		(void)close(vm->vcpu_fd);
+	if (vm->mem != MAP_FAILED)
+		(void)munmap(vm->mem, STRESS_KVM_EXIT_MEM_SIZE);
+	if (vm->vm_fd >= 0)
+		(void)close(vm->vm_fd);
+}
+
+/*
+ *  stress_kvm_vm_create()
+ *	create a real mode VM running code, returns 0 if successful
+ */
+static int stress_kvm_vm_create(
+	stress_args_t *args,
+	const int kvm_fd,
+	const uint8_t *code,
+	const size_t code_len,
+	stress_kvm_vm_t *vm)
+{
+	struct kvm_userspace_memory_region kvm_mem;
+	struct kvm_sregs sregs;
+	struct kvm_regs regs;
+	ssize_t run_size;
+
+	vm->vcpu_fd = -1;
+	vm->mem = MAP_FAILED;
+	vm->run = MAP_FAILED;
+
+	vm->vm_fd = ioctl(kvm_fd, KVM_CREATE_VM, 0);
+	if (vm->vm_fd < 0) {
+		pr_fail("%s: ioctl KVM_CREATE_VM failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	vm->mem = stress_mmap_populate(NULL, STRESS_KVM_EXIT_MEM_SIZE,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (vm->mem == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes of guest memory, skipping stressor\n",
+			args->name, (size_t)STRESS_KVM_EXIT_MEM_SIZE);
+		goto err;
+	}
+	(void)shim_memcpy(vm->mem, code, code_len);
+
+	/* only the first 64K is backed, STRESS_KVM_EXIT_MMIO_ADDR is MMIO */
+	(void)shim_memset(&kvm_mem, 0, sizeof(kvm_mem));
+	kvm_mem.slot = 0;
+	kvm_mem.guest_phys_addr = 0;
+	kvm_mem.memory_size = STRESS_KVM_EXIT_MEM_SIZE;
+	kvm_mem.userspace_addr = (uintptr_t)vm->mem;
+	if (ioctl(vm->vm_fd, KVM_SET_USER_MEMORY_REGION, &kvm_mem) < 0) {
+		pr_fail("%s: ioctl KVM_SET_USER_MEMORY_REGION failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+
+	vm->vcpu_fd = ioctl(vm->vm_fd, KVM_CREATE_VCPU, 0);
+	if (vm->vcpu_fd < 0) {
+		pr_fail("%s: ioctl KVM_CREATE_VCPU failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	if (ioctl(vm->vcpu_fd, KVM_GET_SREGS, &sregs) < 0) {
+		pr_fail("%s: ioctl KVM_GET_SREGS failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	sregs.cs.selector = 0;
+	sregs.cs.base = 0;
+	sregs.ds.selector = 0;
+	sregs.ds.base = STRESS_KVM_EXIT_MMIO_ADDR;
+	sregs.es.selector = 0;
+	sregs.es.base = 0;
+	sregs.ss.selector = 0;
+	sregs.ss.base = 0;
+	if (ioctl(vm->vcpu_fd, KVM_SET_SREGS, &sregs) < 0) {
+		pr_fail("%s: ioctl KVM_SET_SREGS failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	(void)shim_memset(&regs, 0, sizeof(regs));
+	regs.rflags = 2;
+	regs.rip = 0;
+	if (ioctl(vm->vcpu_fd, KVM_SET_REGS, &regs) < 0) {
+		pr_fail("%s: ioctl KVM_SET_REGS failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+
+	run_size = (ssize_t)ioctl(kvm_fd, KVM_GET_VCPU_MMAP_SIZE, 0);
+	if (run_size < 0) {
+		pr_fail("%s: ioctl KVM_GET_VCPU_MMAP_SIZE failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	vm->run_size = (size_t)run_size;
+	vm->run = (struct kvm_run *)stress_mmap_populate(NULL, vm->run_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, vm->vcpu_fd, 0);
+	if (vm->run == MAP_FAILED) {
+		pr_fail("%s: mmap on vcpu_fd failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto err;
+	}
+	return 0;
+
+err:
+	stress_kvm_vm_destroy(vm);
+	vm->vm_fd = -1;
+	return -1;
+}
+
+/*
+ *  stress_kvm_exit_run()
+ *	run the exit guest code for STRESS_KVM_EXIT_SLICE seconds, accumulating
+ *	the time of complete guest loops and number of exits, returns
+ *	0 if successful, 1 if the guest is stuck and -1 if the guest
+ *	misbehaved or KVM_RUN failed
+ */
+static int stress_kvm_exit_run(
+	stress_args_t *args,
+	const stress_kvm_exit_t *exit_type,
+	stress_kvm_vm_t *vm,
+	double *duration,
+	uint64_t *exits)
+{
+	const double t_start = stress_time_now();
+	double t_loop = t_start;
+
+	for (;;) {
+		struct kvm_run *run = vm->run;
+
+		if (ioctl(vm->vcpu_fd, KVM_RUN, 0) < 0) {
+			if (errno == EINTR) {
+				/*
+				 *  The SIGPROF watchdog interrupts guests that
+				 *  spin without exiting, e.g. some nested hypervisors
+				 *  never complete a hypercall
+				 */
+				if (!stress_continue(args))
+					return 0;
+				if ((stress_time_now() - t_loop) > STRESS_KVM_EXIT_STUCK)
+					return 1;
+				continue;
+			}
+			pr_fail("%s: ioctl KVM_RUN failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		switch (run->exit_reason) {
+		case KVM_EXIT_IO:
+			if (run->io.port == STRESS_KVM_EXIT_DONE_PORT) {
+				const double t_now = stress_time_now();
+
+				*duration += t_now - t_loop;
+				*exits += STRESS_KVM_EXIT_LOOPS;
+				t_loop = t_now;
+				stress_bogo_inc(args);
+				if (((t_now - t_start) >= STRESS_KVM_EXIT_SLICE) || !stress_continue(args))
+					return 0;
+			}
+			break;
+		case KVM_EXIT_MMIO:
+		case KVM_EXIT_HLT:
+			break;
+		default:
+			pr_fail("%s: %s guest unexpected exit reason %" PRIu32 "\n",
+				args->name, exit_type->name, (uint32_t)run->exit_reason);
+			return -1;
+		}
+	}
+}
+
+/*
+ *  stress_kvm_exits()
+ *	measure the VM exit round trip time of each kvm_exits[] exit
+ *	type, a VM per exit type is run for STRESS_KVM_EXIT_SLICE seconds in
+ *	turn until the end of the run
+ */
+static int stress_kvm_exits(stress_args_t *args)
+{
+	stress_kvm_vm_t vms[SIZEOF_ARRAY(kvm_exits)];
+	double duration[SIZEOF_ARRAY(kvm_exits)];
+	uint64_t exits[SIZEOF_ARRAY(kvm_exits)];
+	bool stuck[SIZEOF_ARRAY(kvm_exits)];
+	struct itimerval timer;
+	int kvm_fd, rc = EXIT_SUCCESS;
+	size_t i, n_vms = 0;
+
+	if (stress_sighandler(args->name, SIGPROF, stress_sighandler_nop, NULL) < 0)
+		return EXIT_NO_RESOURCE;
+
+	if ((kvm_fd = open("/dev/kvm", O_RDWR)) < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: /dev/kvm not available, errno=%d (%s), "
+				"skipping stress test\n", args->name, errno, strerror(errno));
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(kvm_exits); i++) {
+		uint8_t code[64];
+		const size_t code_len = stress_kvm_exit_code(&kvm_exits[i], code);
+
+		if (stress_kvm_vm_create(args, kvm_fd, code, code_len, &vms[i]) < 0) {
+			rc = (vms[i].mem == MAP_FAILED) ? EXIT_NO_RESOURCE : EXIT_FAILURE;
+			goto tidy_vms;
+		}
+		n_vms++;
+		duration[i] = 0.0;
+		exits[i] = 0;
+		stuck[i] = false;
+	}
+
+	(void)shim_memset(&timer, 0, sizeof(timer));
+	timer.it_value.tv_usec = STRESS_KVM_EXIT_WATCHDOG;
+	timer.it_interval.tv_usec = STRESS_KVM_EXIT_WATCHDOG;
+	if (setitimer(ITIMER_PROF, &timer, NULL) < 0) {
+		pr_inf_skip("%s: setitimer failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_vms;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < SIZEOF_ARRAY(kvm_exits)) && stress_continue(args); i++) {
+			int ret;
+
+			if (stuck[i])
+				continue;
+			ret = stress_kvm_exit_run(args, &kvm_exits[i], &vms[i], &duration[i], &exits[i]);
+			if (ret < 0) {
+				rc = EXIT_FAILURE;
+				goto tidy_timer;
+			} else if (ret > 0) {
+				if (args->instance == 0)
+					pr_inf("%s: %s guest made no progress in %.1f seconds, "
+						"not measuring %s exits\n", args->name,
+						kvm_exits[i].name, STRESS_KVM_EXIT_STUCK, kvm_exits[i].name);
+				stuck[i] = true;
+			}
+		}
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %-10s %-6s %12s %14s\n", args->name,
+			"exit", "to", "exits", "round trip ns");
+	}
+	for (i = 0; i < SIZEOF_ARRAY(kvm_exits); i++) {
+		const char *to = kvm_exits[i].user ? "user" : "kernel";
+		double ns;
+		char str[64];
+
+		if (exits[i] == 0)
+			continue;
+		ns = (duration[i] * (double)STRESS_NANOSECOND) / (double)exits[i];
+		if (args->instance == 0)
+			pr_inf("%s: %-10s %-6s %12" PRIu64 " %14.1f\n", args->name,
+				kvm_exits[i].name, to, exits[i], ns);
+		(void)snprintf(str, sizeof(str), "nanosecs per %s exit round trip", kvm_exits[i].name);
+		stress_metrics_set(args, i, str, ns, STRESS_HARMONIC_MEAN);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+tidy_timer:
+	(void)shim_memset(&timer, 0, sizeof(timer));
+	(void)setitimer(ITIMER_PROF, &timer, NULL);
+tidy_vms:
+	for (i = 0; i < n_vms; i++)
+		stress_kvm_vm_destroy(&vms[i]);
+	(void)close(kvm_fd);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_kvm
  *	stress /dev/kvm
@@ -68,6 +451,18 @@ static const uint8_t kvm_x86_kernel[] = {
 static int stress_kvm(stress_args_t *args)
 {
 	bool pr_version = false;
+	bool kvm_exits_mode = false;
+
+	(void)stress_get_setting("kvm-exits", &kvm_exits_mode);
+	if (kvm_exits_mode) {
+#if defined(STRESS_KVM_EXITS)
+		return stress_kvm_exits(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --kvm-exits is not available, KVM_EXIT_HLT or KVM_EXIT_MMIO not "
+				"defined, using default method\n", args->name);
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -289,6 +684,7 @@ tidy_kvm_fd:
 stressor_info_t stress_kvm_info = {
 	.stressor = stress_kvm,
 	.class = CLASS_DEV | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -296,6 +692,7 @@ stressor_info_t stress_kvm_info = {
 stressor_info_t stress_kvm_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_DEV | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built on non-x86-64 without linux/kvm.h"
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-attribute.h"
+#include "core-builtin.h"
 #include "core-cpu-cache.h"
 #include "core-madvise.h"
 
@@ -29,6 +30,7 @@ static const stress_help_t help[] = {
 	{ NULL, "l1cache-line-size N",	"specify level 1 cache line size" },
 	{ NULL,	"l1cache-method M",	"l1 cache thrashing method: forward, reverse, random" },
 	{ NULL,	"l1cache-mlock",	"attempt to mlock memory" },
+	{ NULL,	"l1cache-probe",	"infer level 1 cache geometry from load latencies" },
 	{ NULL, "l1cache-sets N",	"specify level 1 cache sets" },
 	{ NULL, "l1cache-size N",	"specify level 1 cache size" },
 	{ NULL,	"l1cache-ways N",	"only fill specified number of cache ways" },
@@ -71,6 +73,11 @@ static int stress_l1cache_set_mlock(const char *opt)
 	return stress_set_setting_true("l1cache-mlock", opt);
 }
 
+static int stress_l1cache_set_probe(const char *opt)
+{
+	return stress_set_setting_true("l1cache-probe", opt);
+}
+
 #if DEBUG_TAG_INFO
 /*
  *  stress_l1cache_ln2()
@@ -142,6 +149,47 @@ static int stress_l1cache_info_check(
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_l1cache_sysfs_info()
+ *	get the level 1 cache size, line size and ways reported
+ *	by the kernel, returns false if they are not available
+ */
+static bool stress_l1cache_sysfs_info(
+	uint32_t *size,
+	uint32_t *line_size,
+	uint32_t *ways)
+{
+#if defined(__linux__)
+	stress_cpu_cache_cpus_t *cpu_caches;
+	const stress_cpu_cache_t *cache;
+
+	cpu_caches = stress_cpu_cache_get_all_details();
+	if (!cpu_caches)
+		return false;
+
+	if (stress_cpu_cache_get_max_level(cpu_caches) < 1) {
+		stress_free_cpu_caches(cpu_caches);
+		return false;
+	}
+	cache = stress_cpu_cache_get(cpu_caches, 1);
+	if (!cache) {
+		stress_free_cpu_caches(cpu_caches);
+		return false;
+	}
+	*size = (uint32_t)cache->size;
+	*line_size = cache->line_size;
+	*ways = cache->ways;
+	stress_free_cpu_caches(cpu_caches);
+	return true;
+#else
+	(void)size;
+	(void)line_size;
+	(void)ways;
+
+	return false;
+#endif
+}
+
 static int stress_l1cache_info_ok(
 	stress_args_t *args,
 	uint32_t *ways,
@@ -150,10 +198,7 @@ static int stress_l1cache_info_ok(
 	uint32_t *line_size)
 {
 	int ret;
-#if defined(__linux__)
-	stress_cpu_cache_cpus_t *cpu_caches;
-	stress_cpu_cache_t *cache = NULL;
-#endif
+	uint32_t sysfs_size = 0, sysfs_line_size = 0, sysfs_ways = 0;
 
 	if ((*ways > 0) && (*size > 0) && (*sets > 0) && (*line_size > 0)) {
 		return stress_l1cache_info_check(args, *ways, *size, *sets, *line_size);
@@ -175,33 +220,22 @@ static int stress_l1cache_info_ok(
 		return stress_l1cache_info_check(args, *ways, *size, *sets, *line_size);
 	}
 
-#if defined(__linux__)
 	/*
 	 *  User didn't provide cache info, try and figure it
 	 *  out
 	 */
-	cpu_caches = stress_cpu_cache_get_all_details();
-	if (!cpu_caches)
+	if (!stress_l1cache_sysfs_info(&sysfs_size, &sysfs_line_size, &sysfs_ways))
 		goto bad_cache;
 
-	if (stress_cpu_cache_get_max_level(cpu_caches) < 1)
-		goto bad_cache_free;
-
-	cache = stress_cpu_cache_get(cpu_caches, 1);
-	if (!cache)
-		goto bad_cache_free;
-
 	if (*size == 0)
-		*size = (uint32_t)cache->size;
+		*size = sysfs_size;
 	if (*line_size == 0)
-		*line_size = cache->line_size;
+		*line_size = sysfs_line_size;
 	if (*ways == 0)
-		*ways = cache->ways;
+		*ways = sysfs_ways;
 	if ((*sets == 0) && (*ways > 0) && (*line_size > 0))
 		*sets = *size / (*ways * *line_size);
 
-	stress_free_cpu_caches(cpu_caches);
-#endif
 	if ((*size == 0) && (*line_size == 0) && (*ways == 0) && (*sets == 0))
 		goto bad_cache;
 	ret = stress_l1cache_info_check(args, *ways, *size, *sets, *line_size);
@@ -209,10 +243,6 @@ static int stress_l1cache_info_ok(
 		goto bad_cache;
 	return ret;
 
-#if defined(__linux__)
-bad_cache_free:
-	stress_free_cpu_caches(cpu_caches);
-#endif
 bad_cache:
 	pr_inf_skip("%s: skipping stressor, cannot determine "
 		"cache level 1 information from kernel\n",
@@ -509,10 +539,358 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_l1cache_line_size, stress_l1cache_set_line_size },
 	{ OPT_l1cache_method,	 stress_l1cache_set_method },
 	{ OPT_l1cache_mlock,	 stress_l1cache_set_mlock },
+	{ OPT_l1cache_probe,	 stress_l1cache_set_probe },
 	{ OPT_l1cache_ways,	 stress_l1cache_set_ways },
 	{ 0,			NULL }
 };
 
+#define L1CACHE_PROBE_LOADS	(1U << 18)	/* pointer chase loads per timing */
+#define L1CACHE_PROBE_REPEATS	(3)		/* timings per point, fastest is used */
+#define L1CACHE_PROBE_THRESHOLD	(1.3)		/* latency ratio of an L1 miss */
+#define L1CACHE_PROBE_BLOCK	(512)		/* line size probe block size */
+#define L1CACHE_PROBE_BLOCKS	(4096)		/* line size probe blocks */
+#define L1CACHE_PROBE_WAYS_MAX	(32)
+#define L1CACHE_PROBE_NODES_MAX	(8192)		/* capacity probe nodes */
+#define L1CACHE_PROBE_BUF_SIZE	(L1CACHE_PROBE_WAYS_MAX * 512 * KB)
+
+/* working set sizes, in 1.5x and 2x steps, to find the capacity */
+static const size_t stress_l1cache_probe_sizes[] = {
+	4 * KB, 8 * KB, 12 * KB, 16 * KB, 24 * KB, 32 * KB,
+	48 * KB, 64 * KB, 96 * KB, 128 * KB, 192 * KB, 256 * KB,
+};
+
+/* offsets of the second access in a block to find the line size */
+static const size_t stress_l1cache_probe_strides[] = {
+	8, 16, 32, 64, 128, 256,
+};
+
+/* votes for each inferred value over all the probes */
+typedef struct {
+	uint64_t line_size[SIZEOF_ARRAY(stress_l1cache_probe_strides) + 1];
+	uint64_t size[SIZEOF_ARRAY(stress_l1cache_probe_sizes) + 1];
+	uint64_t ways[L1CACHE_PROBE_WAYS_MAX + 1];
+	double hit_ns;			/* sum of L1 hit load latencies */
+	double miss_ns;			/* sum of L1 miss load latencies */
+	uint64_t probes;
+} stress_l1cache_probe_t;
+
+static void * volatile stress_l1cache_probe_sink;
+
+/*
+ *  stress_l1cache_probe_chase()
+ *	follow a chain of dependent pointer loads, each load
+ *	address is the result of the previous load so the
+ *	loads cannot overlap and prefetchers cannot predict them
+ */
+static void * OPTIMIZE3 stress_l1cache_probe_chase(void **ptr, const size_t loads)
+{
+	register void **p = ptr;
+	register size_t i;
+
+	for (i = 0; i < loads; i += 4) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	return (void *)p;
+}
+
+/*
+ *  stress_l1cache_probe_time()
+ *	nanoseconds per load to chase the chain from ptr,
+ *	the fastest of a few repeats after a warm up chase
+ */
+static double stress_l1cache_probe_time(void **ptr)
+{
+	double best = -1.0;
+	int i;
+
+	stress_l1cache_probe_sink = stress_l1cache_probe_chase(ptr, L1CACHE_PROBE_LOADS >> 2);
+	for (i = 0; i < L1CACHE_PROBE_REPEATS; i++) {
+		double t, ns;
+
+		t = stress_time_now();
+		stress_l1cache_probe_sink = stress_l1cache_probe_chase(ptr, L1CACHE_PROBE_LOADS);
+		ns = (stress_time_now() - t) * STRESS_DBL_NANOSECOND / (double)L1CACHE_PROBE_LOADS;
+		if ((best < 0.0) || (ns < best))
+			best = ns;
+	}
+	return best;
+}
+
+/*
+ *  stress_l1cache_probe_shuffle()
+ *	fill idx with a random permutation of 0..n-1
+ */
+static void stress_l1cache_probe_shuffle(uint32_t *idx, const uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++)
+		idx[i] = i;
+	for (i = n - 1; i > 0; i--) {
+		const uint32_t j = stress_mwc32modn(i + 1);
+		const uint32_t tmp = idx[i];
+
+		idx[i] = idx[j];
+		idx[j] = tmp;
+	}
+}
+
+/*
+ *  stress_l1cache_probe_line_size()
+ *	chase a random order of blocks that touches the start of a
+ *	block and then stride bytes into it, once the stride reaches
+ *	the line size the second load misses too and the time per
+ *	block jumps, returns 0 if no jump is seen
+ */
+static uint32_t stress_l1cache_probe_line_size(uint8_t *buf, uint32_t *idx)
+{
+	double base = 0.0;
+	size_t i;
+	uint32_t j;
+
+	stress_l1cache_probe_shuffle(idx, L1CACHE_PROBE_BLOCKS);
+	for (i = 0; i < SIZEOF_ARRAY(stress_l1cache_probe_strides); i++) {
+		const size_t stride = stress_l1cache_probe_strides[i];
+		double ns;
+
+		for (j = 0; j < L1CACHE_PROBE_BLOCKS; j++) {
+			uint8_t *block = buf + ((size_t)idx[j] * L1CACHE_PROBE_BLOCK);
+			uint8_t *next = buf + ((size_t)idx[(j + 1) % L1CACHE_PROBE_BLOCKS] * L1CACHE_PROBE_BLOCK);
+
+			*(void **)block = (void *)(block + stride);
+			*(void **)(block + stride) = (void *)next;
+		}
+		ns = stress_l1cache_probe_time((void **)(buf + ((size_t)idx[0] * L1CACHE_PROBE_BLOCK)));
+		if (i == 0)
+			base = ns;
+		else if (ns > base * L1CACHE_PROBE_THRESHOLD)
+			return (uint32_t)stride;
+	}
+	return 0;
+}
+
+/*
+ *  stress_l1cache_probe_size()
+ *	chase a random order of lines over working sets of increasing
+ *	size, the capacity is the largest size before the load latency
+ *	jumps, returns the index of the size, or the number of sizes if
+ *	no jump is seen
+ */
+static size_t stress_l1cache_probe_size(
+	uint8_t *buf,
+	uint32_t *idx,
+	const uint32_t line_size,
+	double *hit_ns,
+	double *miss_ns)
+{
+	double base = 0.0;
+	size_t i;
+	uint32_t j;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_l1cache_probe_sizes); i++) {
+		const uint32_t n = (uint32_t)(stress_l1cache_probe_sizes[i] / line_size);
+		double ns;
+
+		if (n > L1CACHE_PROBE_NODES_MAX)
+			break;
+		stress_l1cache_probe_shuffle(idx, n);
+		for (j = 0; j < n; j++)
+			*(void **)(buf + ((size_t)idx[j] * line_size)) =
+				(void *)(buf + ((size_t)idx[(j + 1) % n] * line_size));
+		ns = stress_l1cache_probe_time((void **)(buf + ((size_t)idx[0] * line_size)));
+		if (i == 0) {
+			base = ns;
+			*hit_ns = ns;
+		} else if (ns > base * L1CACHE_PROBE_THRESHOLD) {
+			*miss_ns = ns;
+			return i - 1;
+		}
+	}
+	return SIZEOF_ARRAY(stress_l1cache_probe_sizes);
+}
+
+/*
+ *  stress_l1cache_probe_ways()
+ *	cycle through k lines that are a power of 2 multiple of the
+ *	capacity plus a page apart, so they all map to the same set
+ *	of a virtually indexed cache but to different TLB sets, the
+ *	loads keep hitting until k exceeds the associativity, returns
+ *	0 if no jump is seen
+ */
+static uint32_t stress_l1cache_probe_ways(
+	uint8_t *buf,
+	const size_t size,
+	const size_t page_size)
+{
+	size_t spacing = 4 * KB;
+	double base = 0.0;
+	uint32_t k, i;
+
+	while (spacing < size)
+		spacing <<= 1;
+	spacing += page_size;
+	if (spacing * L1CACHE_PROBE_WAYS_MAX > L1CACHE_PROBE_BUF_SIZE)
+		return 0;
+
+	for (k = 1; k <= L1CACHE_PROBE_WAYS_MAX; k++) {
+		double ns;
+
+		for (i = 0; i < k; i++)
+			*(void **)(buf + (i * spacing)) = (void *)(buf + (((i + 1) % k) * spacing));
+		ns = stress_l1cache_probe_time((void **)buf);
+		if (k == 1)
+			base = ns;
+		else if (ns > base * L1CACHE_PROBE_THRESHOLD)
+			return k - 1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_l1cache_probe_vote()
+ *	index of the most voted for value, 0 if there are no votes
+ */
+static size_t stress_l1cache_probe_vote(const uint64_t *votes, const size_t n)
+{
+	size_t i, best = 0;
+
+	for (i = 1; i < n; i++) {
+		if (votes[i] > votes[best])
+			best = i;
+	}
+	return best;
+}
+
+/*
+ *  stress_l1cache_probe_report()
+ *	report the measured geometry next to the sysfs values
+ */
+static void stress_l1cache_probe_report(
+	stress_args_t *args,
+	const stress_l1cache_probe_t *probe)
+{
+	const size_t n_strides = SIZEOF_ARRAY(stress_l1cache_probe_strides);
+	const size_t n_sizes = SIZEOF_ARRAY(stress_l1cache_probe_sizes);
+	const size_t line_idx = stress_l1cache_probe_vote(probe->line_size, n_strides + 1);
+	const size_t size_idx = stress_l1cache_probe_vote(probe->size, n_sizes + 1);
+	const uint32_t line_size = (line_idx < n_strides) ?
+		(uint32_t)stress_l1cache_probe_strides[line_idx] : 0;
+	const uint32_t size = (size_idx < n_sizes) ?
+		(uint32_t)stress_l1cache_probe_sizes[size_idx] : 0;
+	const uint32_t ways = (uint32_t)stress_l1cache_probe_vote(probe->ways, L1CACHE_PROBE_WAYS_MAX + 1);
+	const uint32_t sets = (line_size && ways) ? size / (ways * line_size) : 0;
+	uint32_t sysfs_size = 0, sysfs_line_size = 0, sysfs_ways = 0, sysfs_sets = 0;
+	char str[32], sysfs_str[32];
+	const double n = (double)probe->probes;
+
+	if (probe->probes == 0)
+		return;
+	if (stress_l1cache_sysfs_info(&sysfs_size, &sysfs_line_size, &sysfs_ways) &&
+	    (sysfs_ways > 0) && (sysfs_line_size > 0))
+		sysfs_sets = sysfs_size / (sysfs_ways * sysfs_line_size);
+
+	if (args->instance == 0) {
+		pr_inf("%s: %-10s %10s %10s\n", args->name, "l1cache", "measured", "sysfs");
+		pr_inf("%s: %-10s %10" PRIu32 " %10" PRIu32 "\n", args->name,
+			"line size", line_size, sysfs_line_size);
+		pr_inf("%s: %-10s %10" PRIu32 " %10" PRIu32 "\n", args->name,
+			"ways", ways, sysfs_ways);
+		pr_inf("%s: %-10s %10" PRIu32 " %10" PRIu32 "\n", args->name,
+			"sets", sets, sysfs_sets);
+		(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)size);
+		(void)stress_uint64_to_str(sysfs_str, sizeof(sysfs_str), (uint64_t)sysfs_size);
+		pr_inf("%s: %-10s %10s %10s\n", args->name, "size",
+			size ? str : "0", sysfs_size ? sysfs_str : "0");
+		pr_inf("%s: load latency %.2f ns L1 hit, %.2f ns L1 miss, "
+			"%" PRIu64 " probes, 0 = could not be determined\n", args->name,
+			probe->hit_ns / n, probe->miss_ns / n, probe->probes);
+		if (sysfs_size && size &&
+		    ((size != sysfs_size) || (line_size != sysfs_line_size) || (ways != sysfs_ways)))
+			pr_inf("%s: measured level 1 cache geometry differs from sysfs, "
+				"use --l1cache-size, --l1cache-line-size and --l1cache-ways "
+				"to override it\n", args->name);
+	}
+	stress_metrics_set(args, 0, "measured L1 line size bytes",
+		(double)line_size, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 1, "measured L1 ways",
+		(double)ways, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 2, "measured L1 size KB",
+		(double)size / (double)KB, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "L1 hit nanosecs per load",
+		probe->hit_ns / n, STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, 4, "L1 miss nanosecs per load",
+		probe->miss_ns / n, STRESS_HARMONIC_MEAN);
+}
+
+/*
+ *  stress_l1cache_probe()
+ *	infer the level 1 cache line size, capacity and associativity
+ *	from pointer chase load latencies, each bogo op is one probe
+ *	of all three, the most common results are reported
+ */
+static int stress_l1cache_probe(stress_args_t *args)
+{
+	stress_l1cache_probe_t probe;
+	uint8_t *buf;
+	uint32_t *idx;
+	size_t i;
+
+	(void)shim_memset(&probe, 0, sizeof(probe));
+	idx = (uint32_t *)calloc(L1CACHE_PROBE_NODES_MAX, sizeof(*idx));
+	if (!idx) {
+		pr_inf_skip("%s: cannot allocate probe index, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)stress_mmap_populate(NULL, L1CACHE_PROBE_BUF_SIZE,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes probe buffer, skipping stressor, errno=%d (%s)\n",
+			args->name, (size_t)L1CACHE_PROBE_BUF_SIZE, errno, strerror(errno));
+		free(idx);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		uint32_t line_size, ways;
+		size_t size_idx;
+		double hit_ns = 0.0, miss_ns = 0.0;
+
+		line_size = stress_l1cache_probe_line_size(buf, idx);
+		for (i = 0; i < SIZEOF_ARRAY(stress_l1cache_probe_strides); i++) {
+			if (stress_l1cache_probe_strides[i] == line_size)
+				break;
+		}
+		probe.line_size[i]++;
+
+		/* chase whole lines, assume 64 bytes if the line size is unknown */
+		size_idx = stress_l1cache_probe_size(buf, idx, line_size ? line_size : 64,
+						     &hit_ns, &miss_ns);
+		probe.size[size_idx]++;
+		if (!stress_continue(args))
+			break;
+
+		ways = stress_l1cache_probe_ways(buf, (size_idx < SIZEOF_ARRAY(stress_l1cache_probe_sizes)) ?
+			stress_l1cache_probe_sizes[size_idx] : 64 * KB, args->page_size);
+		probe.ways[ways]++;
+		probe.hit_ns += hit_ns;
+		probe.miss_ns += miss_ns;
+		probe.probes++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_l1cache_probe_report(args, &probe);
+
+	(void)munmap((void *)buf, L1CACHE_PROBE_BUF_SIZE);
+	free(idx);
+
+	return EXIT_SUCCESS;
+}
+
 static int stress_l1cache(stress_args_t *args)
 {
 	int ret;
@@ -527,7 +905,11 @@ static int stress_l1cache(stress_args_t *args)
 	size_t l1cache_method = 0;	/* Default forward */
 	const size_t verify = (g_opt_flags & OPT_FLAGS_VERIFY) ? 1 : 0;
 	l1cache_func_t stress_l1cache_func;
-	bool l1cache_mlock = false;
+	bool l1cache_mlock = false, l1cache_probe = false;
+
+	(void)stress_get_setting("l1cache-probe", &l1cache_probe);
+	if (l1cache_probe)
+		return stress_l1cache_probe(args);
 
 	(void)stress_get_setting("l1cache-ways", &l1cache_ways);
 	(void)stress_get_setting("l1cache-size", &l1cache_size);
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
 
 #if defined(HAVE_SYS_QUEUE_H)
 #include <sys/queue.h>
@@ -28,11 +29,19 @@
 #define MAX_LIST_SIZE		(1000000)
 #define DEFAULT_LIST_SIZE	(5000)
 
+#define LIST_LAYOUT_SEQUENTIAL	(0)	/* nodes in list order in memory */
+#define LIST_LAYOUT_SHUFFLED	(1)	/* nodes in random order in memory */
+#define LIST_LAYOUT_SPREAD	(2)	/* consecutive nodes on different pages */
+
+#define LIST_SPREAD_STRIDE	(64)	/* one node per cache line when spread */
+#define LIST_PREFETCH_DIST	(8)	/* jump pointer prefetch distance */
+#define LIST_CHUNK_ITEMS	(14)	/* items per unrolled list chunk */
+
 struct list_entry;
 
 typedef void (*stress_list_func)(stress_args_t *args,
-				 struct list_entry *entries,
-				 const struct list_entry *entries_end,
+				 struct list_entry **nodes,
+				 const size_t n,
 				 stress_metrics_t *metrics);
 
 typedef struct {
@@ -44,7 +53,9 @@ static const stress_list_method_info_t list_methods[];
 
 static const stress_help_t help[] = {
 	{ NULL,	"list N",	 "start N workers that exercise list structures" },
-	{ NULL,	"list-method M", "select list method: all, circleq, list, slist, slistt, stailq, tailq" },
+	{ NULL,	"list-layout L", "select node layout: sequential, shuffled, spread" },
+	{ NULL,	"list-method M", "select list method: all, chunked, circleq, list, slist, slistt, "
+				 "slistt-prefetch, stailq, tailq" },
 	{ NULL,	"list-ops N",	 "stop after N bogo list operations" },
 	{ NULL,	"list-size N",	 "N is the number of items in the list" },
 	{ NULL,	NULL,		 NULL }
@@ -137,9 +148,31 @@ struct list_entry {
 		TAILQ_ENTRY(list_entry) tailq_entries;
 #endif
 		struct list_entry *next;
+		struct {
+			struct list_entry *next;
+			struct list_entry *jump;	/* node to prefetch */
+		} pf;
 	} u;
 };
 
+/*
+ *  Unrolled list, each chunk holds pointers to up to LIST_CHUNK_ITEMS
+ *  nodes so a traversal follows one link per LIST_CHUNK_ITEMS nodes
+ */
+typedef struct list_chunk {
+	struct list_chunk *next;
+	size_t n;
+	struct list_entry *items[LIST_CHUNK_ITEMS];
+} list_chunk_t;
+
+static list_chunk_t *list_chunks;
+
+static const char *list_layouts[] = {
+	"sequential",
+	"shuffled",
+	"spread",
+};
+
 /*
  *  stress_set_list_size()
  *	set list size
@@ -170,25 +203,28 @@ static void MLOCKED_TEXT stress_list_handler(int signum)
 
 static void OPTIMIZE3 stress_list_slistt(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register struct list_entry *entry, *head, *tail;
+	register size_t i;
 	bool found = false;
 	double t;
 
-	head = entries;
-	tail = entries;
-	for (entry = entries + 1; entry < entries_end; entry++) {
-		tail->u.next = entry;
-		tail = entry;
+	head = nodes[0];
+	tail = head;
+	for (i = 1; i < n; i++) {
+		tail->u.next = nodes[i];
+		tail = nodes[i];
 	}
+	tail->u.next = NULL;
 
 	t = stress_time_now();
-	for (entry = head; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register struct list_entry *find;
 
+		entry = nodes[i];
 		for (find = head; find; find = find->u.next) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -197,11 +233,11 @@ static void OPTIMIZE3 stress_list_slistt(
 		}
 
 		if (UNLIKELY(!found))
-			pr_fail("%s: slistt entry #%zd not found\n",
-				args->name, entry - entries);
+			pr_fail("%s: slistt entry #%zu not found\n",
+				args->name, i);
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while (head) {
 		register struct list_entry *next = head->u.next;
@@ -211,14 +247,112 @@ static void OPTIMIZE3 stress_list_slistt(
 	}
 }
 
+/*
+ *  stress_list_slistt_prefetch()
+ *	singly linked list where each node also points to the node
+ *	LIST_PREFETCH_DIST nodes ahead, this is prefetched on each step
+ *	so that the cache miss latency is overlapped with the traversal
+ */
+static void OPTIMIZE3 stress_list_slistt_prefetch(
+	stress_args_t *args,
+	struct list_entry **nodes,
+	const size_t n,
+	stress_metrics_t *metrics)
+{
+	register struct list_entry *entry, *head;
+	register size_t i;
+	bool found = false;
+	double t;
+
+	head = nodes[0];
+	for (i = 0; i < n; i++) {
+		nodes[i]->u.pf.next = (i + 1 < n) ? nodes[i + 1] : NULL;
+		nodes[i]->u.pf.jump = (i + LIST_PREFETCH_DIST < n) ? nodes[i + LIST_PREFETCH_DIST] : NULL;
+	}
+
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		register struct list_entry *find;
+
+		entry = nodes[i];
+		for (find = head; find; find = find->u.pf.next) {
+			shim_builtin_prefetch(find->u.pf.jump);
+			if (UNLIKELY(find == entry)) {
+				found = true;
+				break;
+			}
+		}
+
+		if (UNLIKELY(!found))
+			pr_fail("%s: slistt-prefetch entry #%zu not found\n",
+				args->name, i);
+	}
+	metrics->duration += stress_time_now() - t;
+	metrics->count += (double)i;
+
+	for (i = 0; i < n; i++) {
+		nodes[i]->u.pf.next = NULL;
+		nodes[i]->u.pf.jump = NULL;
+	}
+}
+
+/*
+ *  stress_list_chunked()
+ *	unrolled linked list, chunks of node pointers are searched
+ *	as arrays and only the chunks are linked
+ */
+static void OPTIMIZE3 stress_list_chunked(
+	stress_args_t *args,
+	struct list_entry **nodes,
+	const size_t n,
+	stress_metrics_t *metrics)
+{
+	register list_chunk_t *chunk, *head = list_chunks;
+	register size_t i;
+	bool found = false;
+	double t;
+
+	for (i = 0, chunk = head; i < n; chunk++) {
+		const size_t items = STRESS_MINIMUM(n - i, LIST_CHUNK_ITEMS);
+
+		(void)memcpy(chunk->items, &nodes[i], items * sizeof(*chunk->items));
+		chunk->n = items;
+		i += items;
+		chunk->next = (i < n) ? chunk + 1 : NULL;
+	}
+
+	t = stress_time_now();
+	for (i = 0; i < n; i++) {
+		register const struct list_entry *entry = nodes[i];
+
+		for (chunk = head; chunk; chunk = chunk->next) {
+			register size_t j;
+
+			for (j = 0; j < chunk->n; j++) {
+				if (UNLIKELY(chunk->items[j] == entry)) {
+					found = true;
+					goto next;
+				}
+			}
+		}
+next:
+		if (UNLIKELY(!found))
+			pr_fail("%s: chunked entry #%zu not found\n",
+				args->name, i);
+	}
+	metrics->duration += stress_time_now() - t;
+	metrics->count += (double)i;
+}
+
 #if defined(HAVE_SYS_QUEUE_LIST)
 static void OPTIMIZE3 stress_list_list(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register struct list_entry *entry;
+	register size_t i;
 	struct listhead head;
 	bool found = false;
 	double t;
@@ -226,14 +360,16 @@ static void OPTIMIZE3 stress_list_list(
 	(void)shim_memset(&head, 0, sizeof(head));
 	LIST_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		LIST_INSERT_HEAD(&head, entry, u.list_entries);
+	for (i = 0; i < n; i++) {
+		LIST_INSERT_HEAD(&head, nodes[i], u.list_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register struct list_entry *find;
 
+		entry = nodes[i];
+
 		LIST_FOREACH(find, &head, u.list_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -242,11 +378,11 @@ static void OPTIMIZE3 stress_list_list(
 		}
 
 		if (UNLIKELY(!found))
-			pr_fail("%s: list entry #%zd not found\n",
-				args->name, entry - entries);
+			pr_fail("%s: list entry #%zu not found\n",
+				args->name, i);
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while (!LIST_EMPTY(&head)) {
 		entry = (struct list_entry *)LIST_FIRST(&head);
@@ -259,11 +395,12 @@ static void OPTIMIZE3 stress_list_list(
 #if defined(HAVE_SYS_QUEUE_SLIST)
 static void OPTIMIZE3 stress_list_slist(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register struct list_entry *entry;
+	register size_t i;
 	struct slisthead head;
 	bool found = false;
 	double t;
@@ -271,14 +408,16 @@ static void OPTIMIZE3 stress_list_slist(
 	(void)shim_memset(&head, 0, sizeof(head));
 	SLIST_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		SLIST_INSERT_HEAD(&head, entry, u.slist_entries);
+	for (i = 0; i < n; i++) {
+		SLIST_INSERT_HEAD(&head, nodes[i], u.slist_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register struct list_entry *find;
 
+		entry = nodes[i];
+
 		SLIST_FOREACH(find, &head, u.slist_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -287,11 +426,11 @@ static void OPTIMIZE3 stress_list_slist(
 		}
 
 		if (UNLIKELY(!found))
-			pr_fail("%s: slist entry #%zd not found\n",
-				args->name, entry - entries);
+			pr_fail("%s: slist entry #%zu not found\n",
+				args->name, i);
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while (!SLIST_EMPTY(&head)) {
 		SLIST_REMOVE_HEAD(&head, u.slist_entries);
@@ -303,11 +442,12 @@ static void OPTIMIZE3 stress_list_slist(
 #if defined(HAVE_SYS_QUEUE_CIRCLEQ)
 static void OPTIMIZE3 stress_list_circleq(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register struct list_entry *entry;
+	register size_t i;
 	struct circleqhead head;
 	bool found = false;
 	double t;
@@ -315,14 +455,16 @@ static void OPTIMIZE3 stress_list_circleq(
 	(void)shim_memset(&head, 0, sizeof(head));
 	CIRCLEQ_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		CIRCLEQ_INSERT_TAIL(&head, entry, u.circleq_entries);
+	for (i = 0; i < n; i++) {
+		CIRCLEQ_INSERT_TAIL(&head, nodes[i], u.circleq_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register struct list_entry *find;
 
+		entry = nodes[i];
+
 		CIRCLEQ_FOREACH(find, &head, u.circleq_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -331,11 +473,11 @@ static void OPTIMIZE3 stress_list_circleq(
 		}
 
 		if (UNLIKELY(!found))
-			pr_fail("%s: circleq entry #%zd not found\n",
-				args->name, entry - entries);
+			pr_fail("%s: circleq entry #%zu not found\n",
+				args->name, i);
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while ((entry = (struct list_entry *)CIRCLEQ_FIRST(&head)) != (struct list_entry *)&head) {
 		CIRCLEQ_REMOVE(&head, entry, u.circleq_entries);
@@ -347,11 +489,12 @@ static void OPTIMIZE3 stress_list_circleq(
 #if defined(HAVE_SYS_QUEUE_STAILQ)
 static void OPTIMIZE3 stress_list_stailq(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register struct list_entry *entry;
+	register size_t i;
 	struct stailhead head;
 	bool found = false;
 	double t;
@@ -359,14 +502,16 @@ static void OPTIMIZE3 stress_list_stailq(
 	(void)shim_memset(&head, 0, sizeof(head));
 	STAILQ_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		STAILQ_INSERT_TAIL(&head, entry, u.stailq_entries);
+	for (i = 0; i < n; i++) {
+		STAILQ_INSERT_TAIL(&head, nodes[i], u.stailq_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register struct list_entry *find;
 
+		entry = nodes[i];
+
 		STAILQ_FOREACH(find, &head, u.stailq_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -375,11 +520,11 @@ static void OPTIMIZE3 stress_list_stailq(
 		}
 
 		if (UNLIKELY(!found))
-			pr_fail("%s: stailq entry #%zd not found\n",
-				args->name, entry - entries);
+			pr_fail("%s: stailq entry #%zu not found\n",
+				args->name, i);
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while ((entry = (struct list_entry *)STAILQ_FIRST(&head)) != NULL) {
 		STAILQ_REMOVE(&head, entry, list_entry, u.stailq_entries);
@@ -391,11 +536,12 @@ static void OPTIMIZE3 stress_list_stailq(
 #if defined(HAVE_SYS_QUEUE_TAILQ)
 static void OPTIMIZE3 stress_list_tailq(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	register struct list_entry *entry;
+	register size_t i;
 	struct tailhead head;
 	bool found = false;
 	double t;
@@ -403,14 +549,16 @@ static void OPTIMIZE3 stress_list_tailq(
 	(void)shim_memset(&head, 0, sizeof(head));
 	TAILQ_INIT(&head);
 
-	for (entry = entries; entry < entries_end; entry++) {
-		TAILQ_INSERT_TAIL(&head, entry, u.tailq_entries);
+	for (i = 0; i < n; i++) {
+		TAILQ_INSERT_TAIL(&head, nodes[i], u.tailq_entries);
 	}
 
 	t = stress_time_now();
-	for (entry = entries; entry < entries_end; entry++) {
+	for (i = 0; i < n; i++) {
 		register struct list_entry *find;
 
+		entry = nodes[i];
+
 		TAILQ_FOREACH(find, &head, u.tailq_entries) {
 			if (UNLIKELY(find == entry)) {
 				found = true;
@@ -419,11 +567,11 @@ static void OPTIMIZE3 stress_list_tailq(
 		}
 
 		if (!found)
-			pr_fail("%s: tailq entry #%zd not found\n",
-				args->name, entry - entries);
+			pr_fail("%s: tailq entry #%zu not found\n",
+				args->name, i);
 	}
 	metrics->duration += stress_time_now() - t;
-	metrics->count += (double)(entry - entries);
+	metrics->count += (double)i;
 
 	while ((entry = (struct list_entry *)TAILQ_FIRST(&head)) != NULL) {
 		TAILQ_REMOVE(&head, entry, u.tailq_entries);
@@ -434,8 +582,8 @@ static void OPTIMIZE3 stress_list_tailq(
 
 static void stress_list_all(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics);
 
 
@@ -444,6 +592,7 @@ static void stress_list_all(
  */
 static const stress_list_method_info_t list_methods[] = {
 	{ "all",	stress_list_all },
+	{ "chunked",	stress_list_chunked },
 #if defined(HAVE_SYS_QUEUE_CIRCLEQ)
 	{ "circleq",	stress_list_circleq },
 #endif
@@ -454,6 +603,7 @@ static const stress_list_method_info_t list_methods[] = {
 	{ "slist",	stress_list_slist },
 #endif
 	{ "slistt",	stress_list_slistt },
+	{ "slistt-prefetch", stress_list_slistt_prefetch },
 #if defined(HAVE_SYS_QUEUE_STAILQ)
 	{ "stailq",	stress_list_stailq },
 #endif
@@ -464,13 +614,13 @@ static const stress_list_method_info_t list_methods[] = {
 
 static void stress_list_all(
 	stress_args_t *args,
-	struct list_entry *entries,
-	const struct list_entry *entries_end,
+	struct list_entry **nodes,
+	const size_t n,
 	stress_metrics_t *metrics)
 {
 	static size_t index = 1;
 
-	list_methods[index].func(args, entries, entries_end, &metrics[index]);
+	list_methods[index].func(args, nodes, n, &metrics[index]);
 	index++;
 	if (index >= SIZEOF_ARRAY(list_methods))
 		index = 1;
@@ -500,7 +650,85 @@ static int stress_set_list_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_list_layout()
+ *	set the memory layout of the list nodes
+ */
+static int stress_set_list_layout(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(list_layouts); i++) {
+		if (!strcmp(list_layouts[i], name)) {
+			stress_set_setting("list-layout", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "list-layout must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(list_layouts); i++) {
+		(void)fprintf(stderr, " %s", list_layouts[i]);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_list_nodes_layout()
+ *	allocate n nodes and fill nodes[] in list order with the
+ *	node addresses laid out in memory as given by layout
+ */
+static struct list_entry NOINLINE *stress_list_nodes_layout(
+	struct list_entry **nodes,
+	const size_t n,
+	const size_t layout,
+	size_t *region_size)
+{
+	const size_t page_size = stress_get_page_size();
+	uint8_t *region;
+	size_t i;
+
+	if (layout == LIST_LAYOUT_SPREAD) {
+		const size_t stride = STRESS_MAXIMUM(LIST_SPREAD_STRIDE, sizeof(struct list_entry));
+		const size_t per_page = STRESS_MAXIMUM(page_size / stride, 1);
+		const size_t n_pages = (n + per_page - 1) / per_page;
+
+		*region_size = n_pages * STRESS_MAXIMUM(page_size, stride);
+		region = (uint8_t *)calloc(1, *region_size);
+		if (!region)
+			return NULL;
+		/* consecutive list nodes are placed on consecutive pages */
+		for (i = 0; i < n; i++) {
+			const size_t page = i % n_pages;
+			const size_t slot = i / n_pages;
+
+			nodes[i] = (struct list_entry *)(region +
+				(page * STRESS_MAXIMUM(page_size, stride)) + (slot * stride));
+		}
+		return (struct list_entry *)region;
+	}
+
+	*region_size = n * sizeof(struct list_entry);
+	region = (uint8_t *)calloc(n, sizeof(struct list_entry));
+	if (!region)
+		return NULL;
+	for (i = 0; i < n; i++)
+		nodes[i] = (struct list_entry *)region + i;
+	if (layout == LIST_LAYOUT_SHUFFLED) {
+		for (i = n - 1; i > 0; i--) {
+			const size_t j = (size_t)stress_mwc32modn((uint32_t)(i + 1));
+			struct list_entry *tmp = nodes[i];
+
+			nodes[i] = nodes[j];
+			nodes[j] = tmp;
+		}
+	}
+	return (struct list_entry *)region;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_list_layout,	stress_set_list_layout },
 	{ OPT_list_method,	stress_set_list_method },
 	{ OPT_list_size,	stress_set_list_size },
 	{ 0,			NULL }
@@ -513,8 +741,8 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 static int stress_list(stress_args_t *args)
 {
 	uint64_t v, list_size = DEFAULT_LIST_SIZE;
-	struct list_entry *entries, *entry, *entries_end;
-	size_t n, i, j, bit, list_method = 0;
+	struct list_entry *entries, **nodes;
+	size_t n, i, j, bit, list_method = 0, list_layout = LIST_LAYOUT_SEQUENTIAL, region_size;
 	struct sigaction old_action;
 	int ret;
 	stress_metrics_t *metrics, list_metrics[SIZEOF_ARRAY(list_methods)];
@@ -526,6 +754,7 @@ static int stress_list(stress_args_t *args)
 	}
 
 	(void)stress_get_setting("list-method", &list_method);
+	(void)stress_get_setting("list-layout", &list_layout);
 	func = list_methods[list_method].func;
 	metrics = &list_metrics[list_method];
 
@@ -537,13 +766,32 @@ static int stress_list(stress_args_t *args)
 	}
 	n = (size_t)list_size;
 
-	entries = calloc(n, sizeof(*entries));
+	nodes = (struct list_entry **)calloc(n, sizeof(*nodes));
+	if (!nodes) {
+		pr_inf_skip("%s: malloc failed allocating %zu list node pointers, "
+			"out of memory, skipping stressor\n", args->name, n);
+		return EXIT_NO_RESOURCE;
+	}
+	entries = stress_list_nodes_layout(nodes, n, list_layout, &region_size);
 	if (!entries) {
 		pr_inf_skip("%s: malloc failed allocating %zu list entries, "
 			"out of memory, skipping stressor\n", args->name, n);
+		free(nodes);
 		return EXIT_NO_RESOURCE;
 	}
-	entries_end = entries + n;
+	list_chunks = (list_chunk_t *)calloc((n + LIST_CHUNK_ITEMS - 1) / LIST_CHUNK_ITEMS,
+		sizeof(*list_chunks));
+	if (!list_chunks) {
+		pr_inf_skip("%s: malloc failed allocating %zu list chunks, "
+			"out of memory, skipping stressor\n", args->name,
+			(n + LIST_CHUNK_ITEMS - 1) / LIST_CHUNK_ITEMS);
+		free(entries);
+		free(nodes);
+		return EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: %zu nodes in %s layout using %zu bytes\n", args->name,
+			n, list_layouts[list_layout], region_size);
 
 	ret = sigsetjmp(jmp_env, 1);
 	if (ret) {
@@ -554,12 +802,16 @@ static int stress_list(stress_args_t *args)
 		goto tidy;
 	}
 	if (stress_sighandler(args->name, SIGALRM, stress_list_handler, &old_action) < 0) {
+		free(list_chunks);
 		free(entries);
+		free(nodes);
 		return EXIT_FAILURE;
 	}
 
 	v = 0;
-	for (entry = entries, bit = 0; entry < entries_end; entry++) {
+	for (i = 0, bit = 0; i < n; i++) {
+		struct list_entry *entry = nodes[i];
+
 		if (!bit) {
 			v = stress_mwc64();
 			bit = 1;
@@ -576,13 +828,13 @@ static int stress_list(stress_args_t *args)
 	do {
 		uint64_t rnd;
 
-		func(args, entries, entries_end, metrics);
+		func(args, nodes, n, metrics);
 
 		rnd = stress_mwc64();
-		for (entry = entries; entry < entries_end; entry++) {
-			register uint64_t value = entry->value ^ rnd;
+		for (i = 0; i < n; i++) {
+			register uint64_t value = nodes[i]->value ^ rnd;
 
-			entry->value = shim_ror64(value);
+			nodes[i]->value = shim_ror64(value);
 		}
 
 		stress_bogo_inc(args);
@@ -595,16 +847,26 @@ tidy:
 		if ((list_metrics[i].duration > 0.0) && (list_metrics[i].count > 0.0)) {
 			char msg[64];
 			const double rate = list_metrics[i].count / list_metrics[i].duration;
+			/* the searches visit 1..n nodes, (n + 1) / 2 on average */
+			const double visited = list_metrics[i].count * (double)(n + 1) / 2.0;
 
 			(void)snprintf(msg, sizeof(msg), "%s searches per second", list_methods[i].name);
 			stress_metrics_set(args, j, msg,
 				rate, STRESS_HARMONIC_MEAN);
 			j++;
+			(void)snprintf(msg, sizeof(msg), "%s nanosecs per node visited", list_methods[i].name);
+			stress_metrics_set(args, j, msg,
+				STRESS_DBL_NANOSECOND * list_metrics[i].duration / visited,
+				STRESS_GEOMETRIC_MEAN);
+			j++;
 		}
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(list_chunks);
+	list_chunks = NULL;
 	free(entries);
+	free(nodes);
 
 	return EXIT_SUCCESS;
 }
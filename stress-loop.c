@@ -28,10 +28,37 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"loop N",	"start N workers exercising loopback devices" },
+	{ NULL,	"loop-bytes N",	"size of the loop device backing file in the loop sweep" },
 	{ NULL,	"loop-ops N",	"stop after N bogo loopback operations" },
+	{ NULL,	"loop-sweep",	"sweep direct and buffered loop I/O throughput against the raw file" },
 	{ NULL,	NULL,		NULL }
 };
 
+#define MIN_LOOP_BYTES		(1 * MB)
+#define MAX_LOOP_BYTES		(4 * GB)
+#define DEFAULT_LOOP_BYTES	(64 * MB)
+
+static int stress_set_loop_bytes(const char *opt)
+{
+	uint64_t loop_bytes;
+
+	loop_bytes = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("loop-bytes", loop_bytes,
+		MIN_LOOP_BYTES, MAX_LOOP_BYTES);
+	return stress_set_setting("loop-bytes", TYPE_ID_UINT64, &loop_bytes);
+}
+
+static int stress_set_loop_sweep(const char *opt)
+{
+	return stress_set_setting_true("loop-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_loop_bytes,	stress_set_loop_bytes },
+	{ OPT_loop_sweep,	stress_set_loop_sweep },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LINUX_LOOP_H) && \
     defined(LOOP_CTL_GET_FREE) && \
     defined(LOOP_SET_FD) && \
@@ -78,6 +105,354 @@ static const char * const loop_attr[] = {
 	"dio"
 };
 
+#if defined(LOOP_SET_DIRECT_IO) &&	\
+    defined(LOOP_GET_STATUS64) &&	\
+    defined(O_DIRECT)
+#define STRESS_LOOP_SWEEP
+#endif
+
+#if defined(STRESS_LOOP_SWEEP)
+
+#define LOOP_SWEEP_DURATION	(0.1)	/* secs per sweep point per pass */
+#define LOOP_SWEEP_BUF_SIZE	(1 * MB)
+
+/* I/O targets, the raw backing file and the loop device without and with dio */
+#define LOOP_SWEEP_FILE		(0)
+#define LOOP_SWEEP_LOOP		(1)
+#define LOOP_SWEEP_LOOP_DIO	(2)
+
+static const char * const stress_loop_sweep_targets[] = {
+	"file",
+	"loop",
+	"loop-dio",
+};
+
+typedef struct {
+	const char *name;
+	bool write;		/* true = pwrite, false = pread */
+	bool random;		/* true = random offsets, false = sequential */
+} stress_loop_sweep_pattern_t;
+
+static const stress_loop_sweep_pattern_t stress_loop_sweep_patterns[] = {
+	{ "seq-read",	false,	false },
+	{ "seq-write",	true,	false },
+	{ "rand-read",	false,	true },
+	{ "rand-write",	true,	true },
+};
+
+static const size_t stress_loop_sweep_sizes[] = {
+	4 * KB, 16 * KB, 64 * KB, 1 * MB,
+};
+
+/* a sweep point and its accumulated results */
+typedef struct {
+	size_t target;
+	size_t pattern;
+	size_t size;
+	double bytes;		/* bytes read or written */
+	double ops;		/* number of I/O operations */
+	double duration;	/* time of the passes, including the final sync */
+} stress_loop_sweep_result_t;
+
+/*
+ *  stress_loop_sweep_set_dio()
+ *	turn loop device direct I/O on or off, returns true if
+ *	the loop device is now in the requested mode
+ */
+static bool stress_loop_sweep_set_dio(const int loop_dev, const bool dio)
+{
+	struct loop_info64 info64;
+	const unsigned long arg = dio ? 1 : 0;
+
+	if (ioctl(loop_dev, LOOP_SET_DIRECT_IO, arg) < 0)
+		return false;
+	if (ioctl(loop_dev, LOOP_GET_STATUS64, &info64) < 0)
+		return false;
+	return !!(info64.lo_flags & LO_FLAGS_DIRECT_IO) == dio;
+}
+
+/*
+ *  stress_loop_sweep_pass()
+ *	run the I/O pattern of a sweep point on fd for the sweep
+ *	duration, writes are synced before the pass is timed
+ */
+static int stress_loop_sweep_pass(
+	stress_args_t *args,
+	const int fd,
+	uint8_t *buf,
+	const uint64_t loop_bytes,
+	stress_loop_sweep_result_t *result)
+{
+	const stress_loop_sweep_pattern_t *pattern = &stress_loop_sweep_patterns[result->pattern];
+	const size_t size = result->size;
+	const uint64_t blocks = loop_bytes / size;
+	const double t_start = stress_time_now();
+	double t_now;
+	off_t offset = 0;
+
+	do {
+		ssize_t ret;
+
+		if (pattern->random)
+			offset = (off_t)(stress_mwc64modn(blocks) * size);
+		ret = pattern->write ? pwrite(fd, buf, size, offset) :
+				       pread(fd, buf, size, offset);
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				break;
+			pr_fail("%s: %s %s of %zu bytes failed, errno=%d (%s)\n",
+				args->name, stress_loop_sweep_targets[result->target],
+				pattern->name, size, errno, strerror(errno));
+			return -1;
+		}
+		result->bytes += (double)ret;
+		result->ops += 1.0;
+		if (!pattern->random) {
+			offset += (off_t)size;
+			if ((uint64_t)offset + size > loop_bytes)
+				offset = 0;
+		}
+		t_now = stress_time_now();
+	} while (stress_continue_flag() && ((t_now - t_start) < LOOP_SWEEP_DURATION));
+
+	if (pattern->write)
+		(void)shim_fdatasync(fd);
+	result->duration += stress_time_now() - t_start;
+	return 0;
+}
+
+/*
+ *  stress_loop_sweep_report()
+ *	report MB/s and IOPS of each sweep point and add the
+ *	4K IOPS and 1M MB/s of each target and pattern as metrics
+ */
+static void stress_loop_sweep_report(
+	stress_args_t *args,
+	const stress_loop_sweep_result_t *results,
+	const size_t n_results)
+{
+	size_t i, metric = 0;
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %-10s %8s %12s %12s\n", args->name,
+			"target", "pattern", "size", "MB/sec", "IOPS");
+	for (i = 0; i < n_results; i++) {
+		const stress_loop_sweep_result_t *result = &results[i];
+		const char *target = stress_loop_sweep_targets[result->target];
+		const char *pattern = stress_loop_sweep_patterns[result->pattern].name;
+		char size_str[32], str[64];
+		double mb_rate, iops;
+
+		if ((result->duration <= 0.0) || (result->ops <= 0.0))
+			continue;
+		(void)stress_uint64_to_str(size_str, sizeof(size_str), (uint64_t)result->size);
+		mb_rate = (result->bytes / (double)MB) / result->duration;
+		iops = result->ops / result->duration;
+		if (args->instance == 0)
+			pr_inf("%s: %-9s %-10s %8s %12.2f %12.1f\n", args->name,
+				target, pattern, size_str, mb_rate, iops);
+
+		if (metric + 1 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		if (result->size == 4 * KB) {
+			(void)snprintf(str, sizeof(str), "%s %s %s IOPS", target, pattern, size_str);
+			stress_metrics_set(args, metric++, str, iops, STRESS_HARMONIC_MEAN);
+		} else if (result->size == 1 * MB) {
+			(void)snprintf(str, sizeof(str), "%s %s %s MB per sec", target, pattern, size_str);
+			stress_metrics_set(args, metric++, str, mb_rate, STRESS_HARMONIC_MEAN);
+		}
+	}
+}
+
+/*
+ *  stress_loop_sweep()
+ *	measure sequential and random read and write throughput of
+ *	a loop device with direct I/O on and off and of the raw
+ *	backing file it sits on over several I/O block sizes
+ */
+static int stress_loop_sweep(stress_args_t *args)
+{
+	stress_loop_sweep_result_t results[SIZEOF_ARRAY(stress_loop_sweep_targets) *
+					   SIZEOF_ARRAY(stress_loop_sweep_patterns) *
+					   SIZEOF_ARRAY(stress_loop_sweep_sizes)];
+	char backing_file[PATH_MAX], dev_name[PATH_MAX];
+	uint64_t loop_bytes = DEFAULT_LOOP_BYTES, written;
+	int ret, rc = EXIT_FAILURE;
+	int backing_fd, raw_fd, ctrl_dev = -1, loop_dev = -1;
+	long int dev_num = -1;
+	bool dio = false, attached = false;
+	size_t i, j, k, n_results = 0, idx = 0;
+	uint8_t *buf;
+
+	(void)stress_get_setting("loop-bytes", &loop_bytes);
+	loop_bytes &= ~(uint64_t)(MB - 1);
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, LOOP_SWEEP_BUF_SIZE,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, (size_t)LOOP_SWEEP_BUF_SIZE, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_rndbuf(buf, LOOP_SWEEP_BUF_SIZE);
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto unmap_buf;
+	}
+	(void)stress_temp_filename_args(args,
+		backing_file, sizeof(backing_file), stress_mwc32());
+
+	if ((backing_fd = open(backing_file, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR)) < 0) {
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, backing_file, errno, strerror(errno));
+		goto tidy_dir;
+	}
+	/* the raw file is read and written with O_DIRECT, same as the loop device */
+	raw_fd = open(backing_file, O_RDWR | O_DIRECT);
+	(void)shim_unlink(backing_file);
+	if (raw_fd < 0) {
+		pr_inf_skip("%s: backing file system does not support O_DIRECT, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto close_backing;
+	}
+
+	/* fill the backing file so reads don't hit holes */
+	for (written = 0; stress_continue_flag() && (written < loop_bytes); ) {
+		ssize_t n = write(backing_fd, buf, LOOP_SWEEP_BUF_SIZE);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_inf_skip("%s: cannot write %" PRIu64 " byte backing file, "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, loop_bytes, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_raw;
+		}
+		written += (uint64_t)n;
+	}
+	(void)shim_fsync(backing_fd);
+
+	ctrl_dev = open("/dev/loop-control", O_RDWR);
+	if (ctrl_dev < 0) {
+		pr_fail("%s: cannot open /dev/loop-control: %d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_raw;
+	}
+
+	/*
+	 *  Other instances may race for the same free loop
+	 *  device, so retry if it is grabbed before we attach
+	 */
+	for (i = 0; (i < 100) && !attached && stress_continue_flag(); i++) {
+		dev_num = ioctl(ctrl_dev, LOOP_CTL_GET_FREE);
+		if (dev_num < 0)
+			break;
+		(void)snprintf(dev_name, sizeof(dev_name), "/dev/loop%ld", dev_num);
+		loop_dev = open(dev_name, O_RDWR | O_DIRECT);
+		if (loop_dev < 0) {
+			(void)shim_usleep(1000);
+			continue;
+		}
+		if (ioctl(loop_dev, LOOP_SET_FD, backing_fd) == 0) {
+			attached = true;
+			break;
+		}
+		(void)close(loop_dev);
+		loop_dev = -1;
+		(void)shim_usleep(1000);
+	}
+	if (!attached) {
+		pr_inf_skip("%s: cannot attach a loop device to the backing file, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto close_ctrl;
+	}
+
+	dio = stress_loop_sweep_set_dio(loop_dev, true);
+	if (!dio && (args->instance == 0))
+		pr_inf("%s: loop device direct I/O not supported, skipping loop-dio\n",
+			args->name);
+	for (i = 0; i < SIZEOF_ARRAY(stress_loop_sweep_targets); i++) {
+		if ((i == LOOP_SWEEP_LOOP_DIO) && !dio)
+			continue;
+		for (j = 0; j < SIZEOF_ARRAY(stress_loop_sweep_patterns); j++) {
+			for (k = 0; k < SIZEOF_ARRAY(stress_loop_sweep_sizes); k++) {
+				stress_loop_sweep_result_t *result = &results[n_results++];
+
+				result->target = i;
+				result->pattern = j;
+				result->size = stress_loop_sweep_sizes[k];
+				result->bytes = 0.0;
+				result->ops = 0.0;
+				result->duration = 0.0;
+			}
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	rc = EXIT_SUCCESS;
+	do {
+		stress_loop_sweep_result_t *result = &results[idx];
+		int fd = loop_dev;
+
+		switch (result->target) {
+		case LOOP_SWEEP_FILE:
+			fd = raw_fd;
+			break;
+		case LOOP_SWEEP_LOOP:
+			if (dio && !stress_loop_sweep_set_dio(loop_dev, false))
+				goto next;
+			dio = false;
+			break;
+		case LOOP_SWEEP_LOOP_DIO:
+			if (!dio && !stress_loop_sweep_set_dio(loop_dev, true))
+				goto next;
+			dio = true;
+			break;
+		}
+		if (stress_loop_sweep_pass(args, fd, buf, loop_bytes, result) < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+next:
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_loop_sweep_report(args, results, n_results);
+
+	/*
+	 *  Disassociate backing store from loop device
+	 */
+	for (i = 0; i < 1000; i++) {
+		ret = ioctl(loop_dev, LOOP_CLR_FD, backing_fd);
+		if ((ret < 0) && (errno == EBUSY))
+			(void)shim_usleep(10);
+		else
+			break;
+	}
+	(void)close(loop_dev);
+close_ctrl:
+	(void)close(ctrl_dev);
+close_raw:
+	(void)close(raw_fd);
+close_backing:
+	(void)close(backing_fd);
+tidy_dir:
+	(void)stress_temp_dir_rm_args(args);
+unmap_buf:
+	(void)munmap((void *)buf, LOOP_SWEEP_BUF_SIZE);
+	return rc;
+}
+#endif
+
 /*
  *  stress_loot_supported()
  *      check if we can run this as root
@@ -103,6 +478,18 @@ static int stress_loop(stress_args_t *args)
 	char backing_file[PATH_MAX];
 	size_t backing_size = 2 * MB;
 	const int bad_fd = stress_get_bad_fd();
+	bool loop_sweep = false;
+
+	(void)stress_get_setting("loop-sweep", &loop_sweep);
+	if (loop_sweep) {
+#if defined(STRESS_LOOP_SWEEP)
+		return stress_loop_sweep(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --loop-sweep requires loop direct I/O and O_DIRECT "
+				"support, using the default loop device exercising\n", args->name);
+#endif
+	}
 
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
@@ -401,6 +788,7 @@ stressor_info_t stress_loop_info = {
 	.stressor = stress_loop,
 	.supported = stress_loop_supported,
 	.class = CLASS_OS | CLASS_DEV,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -416,6 +804,7 @@ stressor_info_t stress_loop_info = {
 	.stressor = stress_unimplemented,
 	.supported = stress_loop_supported,
 	.class = CLASS_OS | CLASS_DEV,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without linux/loop.h or loop ioctl() commands"
 };
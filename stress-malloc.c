@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-latency.h"
 #include "core-mincore.h"
 #include "core-out-of-memory.h"
 #include "core-pthread.h"
@@ -28,6 +29,12 @@
 #include <malloc.h>
 #endif
 
+#if defined(HAVE_LIB_DL) &&	\
+    !defined(BUILD_STATIC)
+#include <dlfcn.h>
+#define HAVE_MALLOC_ALLOCATOR_DL
+#endif
+
 #define MIN_MALLOC_BYTES	(1 * KB)
 #define MAX_MALLOC_BYTES	(MAX_MEM_LIMIT)
 #define DEFAULT_MALLOC_BYTES	(64 * KB)
@@ -44,16 +51,111 @@
 
 #define MK_ALIGN(x)	(1U << (3 + ((x) & 7)))
 
+#define MALLOC_RSS_SAMPLE	(65536)		/* loops between RSS samples */
+#define MALLOC_SIZES_MAX	(4096)		/* maximum size file histogram entries */
+
 typedef struct {
 	uintptr_t *addr;		/* Address of allocation */
 	size_t len;			/* Allocation length */
 } stress_malloc_info_t;
 
+/* the allocator, libc or a dlopen'd replacement such as jemalloc */
+typedef struct {
+	const char *name;
+	void *(*malloc_fn)(size_t size);
+	void *(*calloc_fn)(size_t nmemb, size_t size);
+	void *(*realloc_fn)(void *ptr, size_t size);
+	void (*free_fn)(void *ptr);
+	int (*posix_memalign_fn)(void **memptr, size_t alignment, size_t size);	/* optional */
+	void *(*aligned_alloc_fn)(size_t alignment, size_t size);		/* optional */
+	void *(*memalign_fn)(size_t alignment, size_t size);			/* optional */
+	void *(*valloc_fn)(size_t size);					/* optional */
+} stress_malloc_allocator_t;
+
+typedef enum {
+	STRESS_MALLOC_SIZE_UNIFORM = 0,	/* uniform random sizes up to malloc-bytes */
+	STRESS_MALLOC_SIZE_FIXED,	/* always malloc-bytes */
+	STRESS_MALLOC_SIZE_POWER,	/* bounded power law, many small and few large */
+	STRESS_MALLOC_SIZE_REPLAY,	/* sizes drawn from a --malloc-size-file histogram */
+} stress_malloc_size_profile_t;
+
+static const struct {
+	const char *name;
+	const stress_malloc_size_profile_t profile;
+} malloc_size_profiles[] = {
+	{ "uniform",	STRESS_MALLOC_SIZE_UNIFORM },
+	{ "fixed",	STRESS_MALLOC_SIZE_FIXED },
+	{ "power",	STRESS_MALLOC_SIZE_POWER },
+	{ "replay",	STRESS_MALLOC_SIZE_REPLAY },
+};
+
+enum {
+	STRESS_MALLOC_LAT_MALLOC = 0,
+	STRESS_MALLOC_LAT_REALLOC,
+	STRESS_MALLOC_LAT_FREE,
+	STRESS_MALLOC_LAT_MAX,
+};
+
+static const char * const malloc_lat_names[STRESS_MALLOC_LAT_MAX] = {
+	"malloc",
+	"realloc",
+	"free",
+};
+
+static stress_malloc_allocator_t malloc_allocator = {
+	"libc",
+	malloc,
+	calloc,
+	realloc,
+	free,
+#if defined(HAVE_POSIX_MEMALIGN)
+	posix_memalign,
+#else
+	NULL,
+#endif
+#if defined(HAVE_ALIGNED_ALLOC) &&	\
+    !defined(__OpenBSD__)
+	aligned_alloc,
+#else
+	NULL,
+#endif
+#if defined(HAVE_MEMALIGN)
+	memalign,
+#else
+	NULL,
+#endif
+#if defined(HAVE_VALLOC)
+	valloc,
+#else
+	NULL,
+#endif
+};
+
+#if defined(HAVE_MALLOC_ALLOCATOR_DL)
+static const struct {
+	const char *name;
+	const char *libs[3];
+} malloc_allocator_libs[] = {
+	{ "jemalloc",	{ "libjemalloc.so.2", "libjemalloc.so", NULL } },
+	{ "mimalloc",	{ "libmimalloc.so.2", "libmimalloc.so", NULL } },
+	{ "tcmalloc",	{ "libtcmalloc.so.4", "libtcmalloc_minimal.so.4", "libtcmalloc.so" } },
+};
+#endif
+
+/* --malloc-size-file histogram, sizes and cumulative counts */
+static size_t malloc_sizes[MALLOC_SIZES_MAX];
+static uint64_t malloc_sizes_cumulative[MALLOC_SIZES_MAX];
+static size_t malloc_sizes_n;
+
 static bool malloc_mlock;		/* True = mlock all future allocs */
 static bool malloc_touch;		/* True = will touch allocate pages */
 static bool malloc_trim_opt;		/* True = periodically trim malloc arena */
 static size_t malloc_max;		/* Maximum number of allocations */
 static size_t malloc_bytes;		/* Maximum per-allocation size */
+static size_t malloc_fixed_bytes;	/* Fixed size profile allocation size */
+static stress_malloc_size_profile_t malloc_size_profile;
+static bool malloc_zerofree;		/* True = zero memory before free */
+static bool malloc_latency;		/* True = time allocations and frees */
 static void *counter_lock;		/* Counter lock */
 static const char *alloc_action = NULL;
 static size_t alloc_size = 0;
@@ -63,8 +165,6 @@ static sigjmp_buf jmp_env;		/* SIGSEGV jmp environment */
 static volatile bool keep_thread_running_flag;	/* False to stop pthreads */
 #endif
 
-static void (*free_func)(void *ptr, size_t len);
-
 #if defined(HAVE_LIB_PTHREAD)
 /* per pthread data */
 typedef struct {
@@ -76,15 +176,27 @@ typedef struct {
 typedef struct {
 	stress_args_t *args;	/* args info */
 	size_t instance;		/* per thread instance number */
+	size_t live;			/* bytes currently allocated */
+	double rss_ratio;		/* sum of RSS per live byte samples */
+	double rss_samples;		/* number of RSS samples */
+	stress_latency_t lat[STRESS_MALLOC_LAT_MAX];	/* latency histograms */
 } stress_malloc_args_t;
 
+static stress_malloc_args_t *malloc_args_all;	/* all the per thread args */
+static size_t malloc_args_n;			/* number of per thread args */
+static size_t malloc_rss_base;			/* RSS before allocating */
+
 static const stress_help_t help[] = {
 	{ NULL,	"malloc N",		"start N workers exercising malloc/realloc/free" },
+	{ NULL,	"malloc-allocator A",	"use allocator A, libc, jemalloc, mimalloc, tcmalloc or a .so path" },
 	{ NULL,	"malloc-bytes N",	"allocate up to N bytes per allocation" },
+	{ NULL,	"malloc-latency",	"report allocation latency percentiles and RSS per live byte" },
 	{ NULL,	"malloc-max N",		"keep up to N allocations at a time" },
 	{ NULL,	"malloc-mlock",		"attempt to mlock pages into memory" },
 	{ NULL,	"malloc-ops N",		"stop after N malloc bogo operations" },
 	{ NULL, "malloc-pthreads N",	"number of pthreads to run concurrently" },
+	{ NULL,	"malloc-size-file F",	"replay allocation sizes from a size count histogram file" },
+	{ NULL,	"malloc-size-profile P", "allocation sizes, uniform, fixed, power or replay" },
 	{ NULL,	"malloc-thresh N",	"threshold where malloc uses mmap instead of sbrk" },
 	{ NULL, "malloc-touch",		"touch pages force pages to be populated" },
 	{ NULL,	"malloc-zerofree",	"zero free'd memory" },
@@ -98,6 +210,51 @@ static inline ALWAYS_INLINE void stress_alloc_action(const char *str, const size
 	alloc_size = size;
 }
 
+/*
+ *  stress_malloc_lat()
+ *	add the time since t_start to a latency histogram
+ */
+static inline void stress_malloc_lat(stress_malloc_args_t *malloc_args, const int type, const double t_start)
+{
+	const double t = stress_time_now();
+	const uint64_t ns = (t > t_start) ? (uint64_t)((t - t_start) * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(&malloc_args->lat[type], ns);
+}
+
+/*
+ *  stress_malloc_rss()
+ *	resident set size in bytes, 0 if it cannot be read
+ */
+static size_t stress_malloc_rss(const size_t page_size)
+{
+	char buf[128];
+	unsigned long size, resident;
+
+	if (stress_system_read("/proc/self/statm", buf, sizeof(buf)) <= 0)
+		return 0;
+	if (sscanf(buf, "%lu %lu", &size, &resident) != 2)
+		return 0;
+	return (size_t)resident * page_size;
+}
+
+/*
+ *  stress_malloc_rss_sample()
+ *	sample the RSS growth per byte allocated by all the threads
+ */
+static void stress_malloc_rss_sample(stress_malloc_args_t *malloc_args, const size_t page_size)
+{
+	const size_t rss = stress_malloc_rss(page_size);
+	size_t i, live = 0;
+
+	for (i = 0; i < malloc_args_n; i++)
+		live += malloc_args_all[i].live;
+	if ((rss <= malloc_rss_base) || (live == 0))
+		return;
+	malloc_args->rss_ratio += (double)(rss - malloc_rss_base) / (double)live;
+	malloc_args->rss_samples += 1.0;
+}
+
 static int stress_set_malloc_mlock(const char *opt)
 {
 	return stress_set_setting_true("malloc-mlock", opt);
@@ -158,38 +315,213 @@ static int stress_set_malloc_zerofree(const char *opt)
 	return stress_set_setting_true("malloc-zerofree", opt);
 }
 
+static int stress_set_malloc_latency(const char *opt)
+{
+	return stress_set_setting_true("malloc-latency", opt);
+}
+
+static int stress_set_malloc_size_profile(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(malloc_size_profiles); i++) {
+		if (!strcmp(malloc_size_profiles[i].name, opt))
+			return stress_set_setting("malloc-size-profile", TYPE_ID_INT, &malloc_size_profiles[i].profile);
+	}
+	(void)fprintf(stderr, "malloc-size-profile must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(malloc_size_profiles); i++)
+		(void)fprintf(stderr, " %s", malloc_size_profiles[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 /*
- *  stress_malloc_free()
- *	standard free, ignore length
+ *  stress_set_malloc_size_file()
+ *	load a histogram of allocation sizes, one "size count" pair
+ *	per line, blank lines and lines starting with # are ignored
  */
-static void stress_malloc_free(void *ptr, size_t len)
+static int stress_set_malloc_size_file(const char *opt)
 {
-	(void)len;
+	FILE *fp;
+	char buf[256];
+	uint64_t total = 0;
+	size_t line = 0;
+
+	fp = fopen(opt, "r");
+	if (!fp) {
+		(void)fprintf(stderr, "malloc-size-file: cannot open %s, errno=%d (%s)\n",
+			opt, errno, strerror(errno));
+		return -1;
+	}
+	malloc_sizes_n = 0;
+	while (fgets(buf, sizeof(buf), fp)) {
+		unsigned long long size, count;
+		char *ptr = buf;
+
+		line++;
+		while (isspace((unsigned char)*ptr))
+			ptr++;
+		if ((*ptr == '#') || (*ptr == '\0'))
+			continue;
+		if ((sscanf(ptr, "%llu %llu", &size, &count) != 2) ||
+		    (size < 1) || (size > MAX_MALLOC_BYTES)) {
+			(void)fprintf(stderr, "malloc-size-file: %s: invalid size count pair at line %zu\n",
+				opt, line);
+			(void)fclose(fp);
+			return -1;
+		}
+		if (count == 0)
+			continue;
+		if (malloc_sizes_n >= MALLOC_SIZES_MAX) {
+			(void)fprintf(stderr, "malloc-size-file: %s: more than %d sizes\n",
+				opt, MALLOC_SIZES_MAX);
+			(void)fclose(fp);
+			return -1;
+		}
+		total += (uint64_t)count;
+		malloc_sizes[malloc_sizes_n] = (size_t)size;
+		malloc_sizes_cumulative[malloc_sizes_n] = total;
+		malloc_sizes_n++;
+	}
+	(void)fclose(fp);
 
-	free(ptr);
+	if (malloc_sizes_n == 0) {
+		(void)fprintf(stderr, "malloc-size-file: %s: no sizes found\n", opt);
+		return -1;
+	}
+	return stress_set_setting("malloc-size-file", TYPE_ID_STR, opt);
 }
 
+#if defined(HAVE_MALLOC_ALLOCATOR_DL)
 /*
- *  stress_malloc_zerofree()
- *	zero memory and free
+ *  stress_set_malloc_allocator()
+ *	use libc, dlopen a named allocator or a shared object path,
+ *	the library is opened RTLD_LOCAL so it only serves the
+ *	stressor's allocations and not those of stress-ng itself
  */
-static void stress_malloc_zerofree(void *ptr, size_t len)
+static int stress_set_malloc_allocator(const char *opt)
+{
+	void *handle = NULL;
+	size_t i, j;
+
+	if (!strcmp(opt, "libc"))
+		return stress_set_setting("malloc-allocator", TYPE_ID_STR, opt);
+
+	for (i = 0; i < SIZEOF_ARRAY(malloc_allocator_libs); i++) {
+		if (strcmp(malloc_allocator_libs[i].name, opt))
+			continue;
+		for (j = 0; !handle && (j < SIZEOF_ARRAY(malloc_allocator_libs[i].libs)); j++) {
+			if (malloc_allocator_libs[i].libs[j])
+				handle = dlopen(malloc_allocator_libs[i].libs[j], RTLD_NOW | RTLD_LOCAL);
+		}
+		break;
+	}
+	if (!handle && (i == SIZEOF_ARRAY(malloc_allocator_libs)))
+		handle = dlopen(opt, RTLD_NOW | RTLD_LOCAL);
+	if (!handle) {
+		(void)fprintf(stderr, "malloc-allocator: cannot load %s: %s\n", opt, dlerror());
+		return -1;
+	}
+
+	malloc_allocator.malloc_fn = (void *(*)(size_t))dlsym(handle, "malloc");
+	malloc_allocator.calloc_fn = (void *(*)(size_t, size_t))dlsym(handle, "calloc");
+	malloc_allocator.realloc_fn = (void *(*)(void *, size_t))dlsym(handle, "realloc");
+	malloc_allocator.free_fn = (void (*)(void *))dlsym(handle, "free");
+	/* a library without its own malloc resolves to the libc one */
+	if (!malloc_allocator.malloc_fn || !malloc_allocator.calloc_fn ||
+	    !malloc_allocator.realloc_fn || !malloc_allocator.free_fn ||
+	    (malloc_allocator.malloc_fn == malloc)) {
+		(void)fprintf(stderr, "malloc-allocator: %s does not provide malloc, calloc, realloc and free\n", opt);
+		(void)dlclose(handle);
+		return -1;
+	}
+	malloc_allocator.posix_memalign_fn = (int (*)(void **, size_t, size_t))dlsym(handle, "posix_memalign");
+	malloc_allocator.aligned_alloc_fn = (void *(*)(size_t, size_t))dlsym(handle, "aligned_alloc");
+	malloc_allocator.memalign_fn = (void *(*)(size_t, size_t))dlsym(handle, "memalign");
+	malloc_allocator.valloc_fn = (void *(*)(size_t))dlsym(handle, "valloc");
+	malloc_allocator.name = opt;
+
+	/* the handle is kept open, the allocator is used by all instances */
+	return stress_set_setting("malloc-allocator", TYPE_ID_STR, opt);
+}
+#else
+static int stress_set_malloc_allocator(const char *opt)
 {
-	if (len)
+	if (!strcmp(opt, "libc"))
+		return stress_set_setting("malloc-allocator", TYPE_ID_STR, opt);
+	(void)fprintf(stderr, "malloc-allocator: only libc is supported, "
+		"built without dlopen support or as a static image\n");
+	return -1;
+}
+#endif
+
+/*
+ *  stress_malloc_free()
+ *	free an allocation, zeroing it first for --malloc-zerofree,
+ *	only the allocator free is timed
+ */
+static void stress_malloc_free(stress_malloc_args_t *malloc_args, void *ptr, const size_t len)
+{
+	double t = 0.0;
+
+	if (!ptr)
+		return;
+	if (malloc_zerofree && len)
 		(void)shim_memset(ptr, 0, len);
-	free(ptr);
+	if (malloc_latency)
+		t = stress_time_now();
+	malloc_allocator.free_fn(ptr);
+	if (malloc_latency)
+		stress_malloc_lat(malloc_args, STRESS_MALLOC_LAT_FREE, t);
+	malloc_args->live -= len;
 }
 
 /*
  *  stress_alloc_size()
- *	get a new allocation size, ensuring
- *	it is never zero bytes.
+ *	get a new allocation size from the size profile,
+ *	ensuring it is never less than a uintptr_t
  */
 static inline size_t stress_alloc_size(const size_t size)
 {
-	const size_t len = stress_mwc64modn(size);
 	const size_t min_size = sizeof(uintptr_t);
-
+	size_t len;
+
+	switch (malloc_size_profile) {
+	case STRESS_MALLOC_SIZE_FIXED:
+		len = malloc_fixed_bytes;
+		break;
+	case STRESS_MALLOC_SIZE_POWER:
+		{
+			/* bounded Pareto, shape 1, between min_size and size */
+			const double u = (double)stress_mwc32() / 4294967296.0;
+			const double lo = (double)min_size;
+
+			len = (size_t)(lo / (1.0 - u * (1.0 - lo / (double)size)));
+		}
+		break;
+	case STRESS_MALLOC_SIZE_REPLAY:
+		{
+			const uint64_t r = stress_mwc64modn(malloc_sizes_cumulative[malloc_sizes_n - 1]);
+			size_t lo = 0, hi = malloc_sizes_n - 1;
+
+			/* first cumulative count greater than r */
+			while (lo < hi) {
+				const size_t mid = (lo + hi) / 2;
+
+				if (malloc_sizes_cumulative[mid] > r)
+					hi = mid;
+				else
+					lo = mid + 1;
+			}
+			len = malloc_sizes[lo];
+		}
+		break;
+	case STRESS_MALLOC_SIZE_UNIFORM:
+	default:
+		len = stress_mwc64modn(size);
+		break;
+	}
 	return (len >= min_size) ? len : min_size;
 }
 
@@ -212,7 +544,7 @@ static void stress_malloc_page_touch(
 
 static void *stress_malloc_loop(void *ptr)
 {
-	const stress_malloc_args_t *malloc_args = (stress_malloc_args_t *)ptr;
+	stress_malloc_args_t *malloc_args = (stress_malloc_args_t *)ptr;
 	register stress_malloc_info_t *info;
 	stress_args_t *args = malloc_args->args;
 	const size_t page_size = args->page_size;
@@ -220,6 +552,8 @@ static void *stress_malloc_loop(void *ptr)
 	static void *nowt = NULL;
 	size_t j;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const bool rss_sampler = malloc_latency && (malloc_args->instance == 0);
+	register uint32_t rss_counter = 0;
 #if defined(HAVE_MALLOC_TRIM)
 	register uint16_t trim_counter = 0;
 #endif
@@ -246,6 +580,7 @@ static void *stress_malloc_loop(void *ptr)
 		const bool action = (rnd >> 12) & 1;
 		const unsigned int do_calloc = (rnd >> 14) & 0x1f;
 		const bool low_mem = ((g_opt_flags & OPT_FLAGS_OOM_AVOID) && stress_low_memory(malloc_bytes / 2));
+		double t = 0.0;
 
 		shim_builtin_prefetch(&info[i]);
 
@@ -271,7 +606,7 @@ static void *stress_malloc_loop(void *ptr)
 						args->name, (void *)info[i].addr);
 				}
 				stress_alloc_action("free", info[i].len);
-				free_func(info[i].addr, info[i].len);
+				stress_malloc_free(malloc_args, info[i].addr, info[i].len);
 				info[i].addr = NULL;
 				info[i].len = 0;
 
@@ -282,8 +617,13 @@ static void *stress_malloc_loop(void *ptr)
 				const size_t len = stress_alloc_size(malloc_bytes);
 
 				stress_alloc_action("realloc", len);
-				tmp = realloc(info[i].addr, len);
+				if (malloc_latency)
+					t = stress_time_now();
+				tmp = malloc_allocator.realloc_fn(info[i].addr, len);
+				if (malloc_latency)
+					stress_malloc_lat(malloc_args, STRESS_MALLOC_LAT_REALLOC, t);
 				if (tmp) {
+					malloc_args->live += len - info[i].len;
 					info[i].addr = tmp;
 					info[i].len = len;
 
@@ -302,6 +642,8 @@ static void *stress_malloc_loop(void *ptr)
 			if (action && !low_mem) {
 				size_t n, len = stress_alloc_size(malloc_bytes);
 
+				if (malloc_latency)
+					t = stress_time_now();
 				switch (do_calloc) {
 				case 0:
 					n = ((rnd >> 15) % 17) + 1;
@@ -309,54 +651,71 @@ static void *stress_malloc_loop(void *ptr)
 					if (len < (n * sizeof(uintptr_t)))
 						len = n * sizeof(uintptr_t);
 					stress_alloc_action("calloc", len);
-					info[i].addr = calloc(n, len / n);
+					info[i].addr = malloc_allocator.calloc_fn(n, len / n);
 					len = n * (len / n);
 					break;
-#if defined(HAVE_POSIX_MEMALIGN)
 				case 1:
 					/* POSIX.1-2001 and POSIX.1-2008 */
-					stress_alloc_action("posix_memalign", len);
-					if (posix_memalign((void **)&info[i].addr, MK_ALIGN(i), len) != 0)
-						info[i].addr = NULL;
+					if (malloc_allocator.posix_memalign_fn) {
+						stress_alloc_action("posix_memalign", len);
+						if (malloc_allocator.posix_memalign_fn((void **)&info[i].addr, MK_ALIGN(i), len) != 0)
+							info[i].addr = NULL;
+					} else {
+						stress_alloc_action("malloc", len);
+						info[i].addr = malloc_allocator.malloc_fn(len);
+					}
 					break;
-#endif
-#if defined(HAVE_ALIGNED_ALLOC) &&	\
-    !defined(__OpenBSD__)
+#if !defined(__OpenBSD__)
 				case 2:
 					/* C11 aligned allocation */
-					stress_alloc_action("aligned_alloc", len);
-					info[i].addr = aligned_alloc(MK_ALIGN(i), len);
+					if (malloc_allocator.aligned_alloc_fn) {
+						stress_alloc_action("aligned_alloc", len);
+						info[i].addr = malloc_allocator.aligned_alloc_fn(MK_ALIGN(i), len);
+					} else {
+						stress_alloc_action("malloc", len);
+						info[i].addr = malloc_allocator.malloc_fn(len);
+					}
 					break;
 #endif
-#if defined(HAVE_MEMALIGN)
 				case 3:
 					/* SunOS 4.1.3 */
-					stress_alloc_action("memalign", len);
-					info[i].addr = memalign(MK_ALIGN(i), len);
-					break;
-#endif
-#if defined(HAVE_VALLOC) &&	\
-    !defined(HAVE_LIB_PTHREAD)
-				case 4:
-					stress_alloc_action("valloc", len);
-					info[i].addr = valloc(len);
+					if (malloc_allocator.memalign_fn) {
+						stress_alloc_action("memalign", len);
+						info[i].addr = malloc_allocator.memalign_fn(MK_ALIGN(i), len);
+					} else {
+						stress_alloc_action("malloc", len);
+						info[i].addr = malloc_allocator.malloc_fn(len);
+					}
 					break;
-#elif defined(HAVE_MEMALIGN)
 				case 4:
-					stress_alloc_action("memalign", len);
-					info[i].addr = memalign(page_size, len);
-					break;
+#if !defined(HAVE_LIB_PTHREAD)
+					if (malloc_allocator.valloc_fn) {
+						stress_alloc_action("valloc", len);
+						info[i].addr = malloc_allocator.valloc_fn(len);
+						break;
+					}
 #endif
+					if (malloc_allocator.memalign_fn) {
+						stress_alloc_action("memalign", len);
+						info[i].addr = malloc_allocator.memalign_fn(page_size, len);
+					} else {
+						stress_alloc_action("malloc", len);
+						info[i].addr = malloc_allocator.malloc_fn(len);
+					}
+					break;
 				default:
 					stress_alloc_action("malloc", len);
-					info[i].addr = malloc(len);
+					info[i].addr = malloc_allocator.malloc_fn(len);
 					break;
 				}
+				if (malloc_latency)
+					stress_malloc_lat(malloc_args, STRESS_MALLOC_LAT_MALLOC, t);
 				if (LIKELY(info[i].addr != NULL)) {
 					stress_alloc_action("malloc", len);
 					stress_malloc_page_touch((void *)info[i].addr, len, page_size);
 					*info[i].addr = (uintptr_t)info[i].addr;	/* stash address */
 					info[i].len = len;
+					malloc_args->live += len;
 					if (UNLIKELY(!stress_bogo_inc_lock(args, counter_lock, true)))
 						break;
 				} else {
@@ -370,7 +729,13 @@ static void *stress_malloc_loop(void *ptr)
 			(void)malloc_trim(0);
 		}
 #endif
+		if (rss_sampler && (++rss_counter >= MALLOC_RSS_SAMPLE)) {
+			rss_counter = 0;
+			stress_malloc_rss_sample(malloc_args, page_size);
+		}
 	}
+	if (rss_sampler)
+		stress_malloc_rss_sample(malloc_args, page_size);
 
 	for (j = 0; j < malloc_max; j++) {
 		if (verify && info[j].addr && ((uintptr_t)info[j].addr != *info[j].addr)) {
@@ -378,7 +743,7 @@ static void *stress_malloc_loop(void *ptr)
 				args->name, (void *)info[j].addr);
 		}
 		stress_alloc_action("free", info[j].len);
-		free_func(info[j].addr, info[j].len);
+		stress_malloc_free(malloc_args, info[j].addr, info[j].len);
 	}
 	stress_alloc_action("munmap", info_size);
 	(void)munmap((void *)info, info_size);
@@ -396,6 +761,74 @@ static void MLOCKED_TEXT stress_malloc_sigsegv_handler(int signum)
 	}
 }
 
+/*
+ *  stress_malloc_report()
+ *	merge the per thread latency histograms, dump the percentiles
+ *	with the RSS per live byte and add them as metrics
+ */
+static void stress_malloc_report(stress_args_t *args, const size_t malloc_pthreads)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	stress_latency_t *lat;
+	double rss_ratio = 0.0, rss_samples = 0.0;
+	size_t i, j, k, metric = 0;
+	uint64_t count = 0;
+
+	lat = (stress_latency_t *)calloc(STRESS_MALLOC_LAT_MAX, sizeof(*lat));
+	if (!lat)
+		return;
+	for (i = 0; i < malloc_args_n; i++) {
+		for (j = 0; j < STRESS_MALLOC_LAT_MAX; j++)
+			stress_latency_merge(&lat[j], &malloc_args_all[i].lat[j]);
+		rss_ratio += malloc_args_all[i].rss_ratio;
+		rss_samples += malloc_args_all[i].rss_samples;
+	}
+	for (j = 0; j < STRESS_MALLOC_LAT_MAX; j++)
+		count += lat[j].count;
+	if (count == 0) {
+		free(lat);
+		return;
+	}
+
+	if (args->instance == 0) {
+		pr_inf("%s: allocator %s, %s sizes, %zu pthread%s\n", args->name,
+			malloc_allocator.name, malloc_size_profiles[malloc_size_profile].name,
+			malloc_pthreads, malloc_pthreads == 1 ? "" : "s");
+		pr_inf("%s: %12s %10s %10s %10s\n", args->name, "latency (ns)",
+			malloc_lat_names[0], malloc_lat_names[1], malloc_lat_names[2]);
+		for (k = 0; k < SIZEOF_ARRAY(percentiles); k++) {
+			char name[16];
+
+			(void)snprintf(name, sizeof(name), "p%g", percentiles[k]);
+			pr_inf("%s: %12s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+				args->name, name,
+				stress_latency_percentile(&lat[0], percentiles[k]),
+				stress_latency_percentile(&lat[1], percentiles[k]),
+				stress_latency_percentile(&lat[2], percentiles[k]));
+		}
+		pr_inf("%s: %12s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+			args->name, "max", lat[0].max, lat[1].max, lat[2].max);
+	}
+	for (j = 0; j < STRESS_MALLOC_LAT_MAX; j++) {
+		if (!lat[j].count)
+			continue;
+		for (k = 0; k < SIZEOF_ARRAY(percentiles); k++) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "%s latency p%g (ns)", malloc_lat_names[j], percentiles[k]);
+			stress_metrics_set(args, metric++, msg,
+				(double)stress_latency_percentile(&lat[j], percentiles[k]), STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	free(lat);
+	if (rss_samples > 0.0) {
+		if (args->instance == 0)
+			pr_inf("%s: %.3f RSS bytes per live allocated byte\n", args->name, rss_ratio / rss_samples);
+		stress_metrics_set(args, metric++, "RSS bytes per live byte",
+			rss_ratio / rss_samples, STRESS_GEOMETRIC_MEAN);
+	}
+}
+
 static int stress_malloc_child(stress_args_t *args, void *context)
 {
 	int ret;
@@ -403,7 +836,7 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 	 *  pthread instance 0 is actually the main child process,
 	 *  insances 1..N are pthreads 0..N-1
 	 */
-	stress_malloc_args_t malloc_args[MAX_MALLOC_PTHREADS + 1];
+	static stress_malloc_args_t malloc_args[MAX_MALLOC_PTHREADS + 1];
 	size_t malloc_pthreads = 0;
 #if defined(HAVE_LIB_PTHREAD)
 	stress_pthread_info_t pthreads[MAX_MALLOC_PTHREADS];
@@ -433,6 +866,11 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 
 	malloc_args[0].args = args;
 	malloc_args[0].instance = 0;
+	malloc_args_all = malloc_args;
+	malloc_args_n = malloc_pthreads + 1;
+	/* exclude the per thread address buffers from the RSS growth */
+	malloc_rss_base = stress_malloc_rss(args->page_size) +
+		malloc_args_n * malloc_max * sizeof(stress_malloc_info_t);
 
 	(void)context;
 
@@ -445,14 +883,14 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 		malloc_args[j + 1].args = args;
 		malloc_args[j + 1].instance = j + 1;
 		pthreads[j].ret = pthread_create(&pthreads[j].pthread, NULL,
-			stress_malloc_loop, (void *)&malloc_args);
+			stress_malloc_loop, (void *)&malloc_args[j + 1]);
 	}
 #else
 	if ((args->instance == 0) && (malloc_pthreads > 0))
 		pr_inf("%s: pthreads not supported, ignoring the "
 			"--malloc-pthreads option\n", args->name);
 #endif
-	stress_malloc_loop(&malloc_args);
+	stress_malloc_loop(&malloc_args[0]);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 #if defined(HAVE_LIB_PTHREAD)
@@ -468,6 +906,9 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 		}
 	}
 #endif
+	if (malloc_latency)
+		stress_malloc_report(args, malloc_pthreads);
+
 	return EXIT_SUCCESS;
 }
 
@@ -479,11 +920,22 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 static int stress_malloc(stress_args_t *args)
 {
 	int ret;
-	bool malloc_zerofree = false;
+	char *malloc_size_file = NULL;
 
 	stress_alloc_action("<unknown>", 0);
 
-	counter_lock = stress_lock_create();
+	malloc_size_profile = STRESS_MALLOC_SIZE_UNIFORM;
+	(void)stress_get_setting("malloc-size-file", &malloc_size_file);
+	if (!stress_get_setting("malloc-size-profile", &malloc_size_profile) && malloc_size_file)
+		malloc_size_profile = STRESS_MALLOC_SIZE_REPLAY;
+	if ((malloc_size_profile == STRESS_MALLOC_SIZE_REPLAY) && (malloc_sizes_n == 0)) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: the replay size profile needs a --malloc-size-file, skipping stressor\n",
+				args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	counter_lock = stress_lock_create("malloc-counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -496,6 +948,7 @@ static int stress_malloc(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			malloc_bytes = MIN_MALLOC_BYTES;
 	}
+	malloc_fixed_bytes = malloc_bytes;
 	malloc_bytes /= args->num_instances;
 	if (malloc_bytes < MIN_MALLOC_BYTES)
 		malloc_bytes = MIN_MALLOC_BYTES;
@@ -514,7 +967,9 @@ static int stress_malloc(stress_args_t *args)
 	{
 		size_t malloc_threshold = DEFAULT_MALLOC_THRESHOLD;
 
-		if (stress_get_setting("malloc-threshold", &malloc_threshold))
+		/* mallopt only tunes the libc allocator */
+		if (stress_get_setting("malloc-threshold", &malloc_threshold) &&
+		    (malloc_allocator.malloc_fn == malloc))
 			(void)mallopt(M_MMAP_THRESHOLD, (int)malloc_threshold);
 	}
 #endif
@@ -523,10 +978,15 @@ static int stress_malloc(stress_args_t *args)
 	(void)stress_get_setting("malloc-touch", &malloc_touch);
 	malloc_trim_opt = false;
 	(void)stress_get_setting("malloc-trim", &malloc_trim_opt);
+	/* malloc_trim only trims the libc allocator */
+	if (malloc_allocator.malloc_fn != malloc)
+		malloc_trim_opt = false;
 	malloc_mlock = false;
 	(void)stress_get_setting("malloc-mlock", &malloc_mlock);
+	malloc_zerofree = false;
 	(void)stress_get_setting("malloc-zerofree", &malloc_zerofree);
-	free_func = malloc_zerofree ? stress_malloc_zerofree : stress_malloc_free;
+	malloc_latency = false;
+	(void)stress_get_setting("malloc-latency", &malloc_latency);
 
 	ret = stress_oomable_child(args, NULL, stress_malloc_child, STRESS_OOMABLE_NORMAL);
 
@@ -536,10 +996,14 @@ static int stress_malloc(stress_args_t *args)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_malloc_allocator,	stress_set_malloc_allocator },
 	{ OPT_malloc_bytes,	stress_set_malloc_bytes },
+	{ OPT_malloc_latency,	stress_set_malloc_latency },
 	{ OPT_malloc_max,	stress_set_malloc_max },
 	{ OPT_malloc_mlock,	stress_set_malloc_mlock },
 	{ OPT_malloc_pthreads,	stress_set_malloc_pthreads },
+	{ OPT_malloc_size_file,	stress_set_malloc_size_file },
+	{ OPT_malloc_size_profile, stress_set_malloc_size_profile },
 	{ OPT_malloc_threshold,	stress_set_malloc_threshold },
 	{ OPT_malloc_touch,	stress_set_malloc_touch },
 	{ OPT_malloc_trim,	stress_set_malloc_trim },
@@ -18,20 +18,39 @@
  *
  */
 #include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-bitops.h"
 #include "core-builtin.h"
+#include "core-numa.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 #include "core-put.h"
 #include "core-target-clones.h"
 
 #define MIN_MATRIX3D_SIZE	(16)
 #define MAX_MATRIX3D_SIZE	(1024)
 #define DEFAULT_MATRIX3D_SIZE	(128)
+#define MAX_MATRIX3D_THREADS	(256)
+
+#if defined(HAVE_LIB_PTHREAD)
+#define HAVE_MATRIX_3D_THREADS
+#endif
+
+#if defined(HAVE_MATRIX_3D_THREADS) &&	\
+    defined(HAVE_LINUX_MEMPOLICY_H) &&	\
+    defined(__NR_mbind)
+#include <linux/mempolicy.h>
+#define HAVE_MATRIX_3D_NUMA
+#define NUMA_LONG_BITS		(sizeof(unsigned long) * 8)
+#endif
 
 static const stress_help_t help[] = {
 	{ NULL,	"matrix-3d N",		"start N workers exercising 3D matrix operations" },
 	{ NULL,	"matrix-3d-method M",	"specify 3D matrix stress method M, default is all" },
+	{ NULL,	"matrix-3d-numa",	"bind the thread slabs to NUMA nodes with --matrix-3d-threads" },
 	{ NULL,	"matrix-3d-ops N",	"stop after N 3D maxtrix bogo operations" },
 	{ NULL,	"matrix-3d-size N",	"specify the size of the N x N x N matrix" },
+	{ NULL,	"matrix-3d-threads K",	"K threads per instance jointly compute one add, mult or trans" },
 	{ NULL,	"matrix-3d-zyx",	"matrix operation is z by y by x instead of x by y by z" },
 	{ NULL,	NULL,			NULL }
 };
@@ -70,6 +89,21 @@ static int stress_set_matrix_3d_size(const char *opt)
 	return stress_set_setting("matrix-3d-size", TYPE_ID_SIZE_T, &matrix_3d_size);
 }
 
+static int stress_set_matrix_3d_numa(const char *opt)
+{
+	return stress_set_setting_true("matrix-3d-numa", opt);
+}
+
+static int stress_set_matrix_3d_threads(const char *opt)
+{
+	size_t matrix_3d_threads;
+
+	matrix_3d_threads = stress_get_uint64(opt);
+	stress_check_range("matrix-3d-threads", matrix_3d_threads,
+		1, MAX_MATRIX3D_THREADS);
+	return stress_set_setting("matrix-3d-threads", TYPE_ID_SIZE_T, &matrix_3d_threads);
+}
+
 static int stress_set_matrix_3d_zyx(const char *opt)
 {
 	size_t matrix_3d_zyx = 1;
@@ -986,6 +1020,489 @@ tidy_ret:
 	return ret;
 }
 
+/*
+ *  stress_matrix_3d_method_index()
+ *	find index of a named matrix-3d method
+ */
+static inline size_t stress_matrix_3d_method_index(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(matrix_3d_methods); i++) {
+		if (!strcmp(matrix_3d_methods[i].name, name))
+			return i;
+	}
+	return 0;
+}
+
+#if defined(HAVE_MATRIX_3D_THREADS)
+/*
+ *  Cooperative mode, --matrix-3d-threads K threads of an instance
+ *  jointly compute one large operation on shared matrices, each
+ *  thread computing the x slab [lo, hi) of the result
+ */
+typedef void (*stress_matrix_3d_slab_func_t)(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n],
+	const size_t lo,
+	const size_t hi);
+
+typedef struct {
+	const char			*name;		/* method name */
+	const stress_matrix_3d_slab_func_t func;	/* slab function */
+	const double			flops;		/* flops per element */
+} stress_matrix_3d_coop_method_t;
+
+typedef struct {
+	pthread_mutex_t			lock;		/* protects the fields below */
+	pthread_cond_t			start;		/* new op for the threads */
+	pthread_cond_t			done;		/* all slabs completed */
+	uint64_t			generation;	/* op number */
+	size_t				remaining;	/* slabs still to complete */
+	size_t				method;		/* coop method of the op */
+	bool				stop;		/* threads should exit */
+	size_t				n;		/* matrix size */
+	stress_matrix_3d_type_t		*a, *b, *r;	/* shared matrices */
+} stress_matrix_3d_coop_t;
+
+typedef struct {
+	stress_matrix_3d_coop_t		*coop;		/* shared op state */
+	pthread_t			pthread;	/* thread handle */
+	int				ret;		/* pthread_create return */
+	size_t				lo, hi;		/* x slab of the thread */
+	int				node;		/* NUMA node, -1 = any */
+	double				busy;		/* time of the last slab */
+} stress_matrix_3d_thread_t;
+
+/*
+ *  stress_matrix_3d_slab_add()
+ *	matrix addition of an x slab
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_slab_add(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n],
+	const size_t lo,
+	const size_t hi)
+{
+	register size_t i;
+
+	for (i = lo; i < hi; i++) {
+		register size_t j;
+
+		for (j = 0; j < n; j++) {
+			register size_t k;
+
+PRAGMA_UNROLL_N(8)
+			for (k = 0; k < n; k++) {
+				r[i][j][k] = a[i][j][k] + b[i][j][k];
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_3d_slab_mult()
+ *	matrix scalar multiply of an x slab
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_slab_mult(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],
+	stress_matrix_3d_type_t r[RESTRICT n][n][n],
+	const size_t lo,
+	const size_t hi)
+{
+	register size_t i;
+	stress_matrix_3d_type_t v = b[0][0][0];
+
+	for (i = lo; i < hi; i++) {
+		register size_t j;
+
+		for (j = 0; j < n; j++) {
+			register size_t k;
+
+PRAGMA_UNROLL_N(8)
+			for (k = 0; k < n; k++) {
+				r[i][j][k] = v * a[i][j][k];
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_3d_slab_trans()
+ *	matrix transpose of an x slab, this reads
+ *	from the slabs of all the other threads
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_3d_slab_trans(
+	const size_t n,
+	stress_matrix_3d_type_t a[RESTRICT n][n][n],
+	stress_matrix_3d_type_t b[RESTRICT n][n][n],	/* Ignored */
+	stress_matrix_3d_type_t r[RESTRICT n][n][n],
+	const size_t lo,
+	const size_t hi)
+{
+	register size_t i;
+
+	(void)b;
+
+	for (i = lo; i < hi; i++) {
+		register size_t j;
+
+		for (j = 0; j < n; j++) {
+			register size_t k;
+
+			for (k = 0; k < n; k++) {
+				r[i][j][k] = a[k][j][i];
+			}
+		}
+	}
+}
+
+static const stress_matrix_3d_coop_method_t matrix_3d_coop_methods[] = {
+	{ "add",	stress_matrix_3d_slab_add,	1.0 },
+	{ "mult",	stress_matrix_3d_slab_mult,	1.0 },
+	{ "trans",	stress_matrix_3d_slab_trans,	0.0 },
+};
+
+/*
+ *  stress_matrix_3d_coop_thread()
+ *	wait for each new op and compute this thread's slab of it
+ */
+static void *stress_matrix_3d_coop_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_matrix_3d_thread_t *thread = (stress_matrix_3d_thread_t *)arg;
+	stress_matrix_3d_coop_t *coop = thread->coop;
+	const size_t n = coop->n;
+	uint64_t generation = 0;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	if (thread->node >= 0)
+		(void)stress_node_affinity_set(thread->node);
+
+	for (;;) {
+		size_t method;
+		double t;
+
+		(void)pthread_mutex_lock(&coop->lock);
+		while (!coop->stop && (coop->generation == generation))
+			(void)pthread_cond_wait(&coop->start, &coop->lock);
+		if (coop->stop) {
+			(void)pthread_mutex_unlock(&coop->lock);
+			break;
+		}
+		generation = coop->generation;
+		method = coop->method;
+		(void)pthread_mutex_unlock(&coop->lock);
+
+		t = stress_time_now();
+		matrix_3d_coop_methods[method].func(n,
+			(stress_matrix_3d_type_t (*)[n][n])coop->a,
+			(stress_matrix_3d_type_t (*)[n][n])coop->b,
+			(stress_matrix_3d_type_t (*)[n][n])coop->r,
+			thread->lo, thread->hi);
+		thread->busy = stress_time_now() - t;
+
+		(void)pthread_mutex_lock(&coop->lock);
+		coop->remaining--;
+		if (coop->remaining == 0)
+			(void)pthread_cond_signal(&coop->done);
+		(void)pthread_mutex_unlock(&coop->lock);
+	}
+	return &nowt;
+}
+
+#if defined(HAVE_MATRIX_3D_NUMA)
+/*
+ *  stress_matrix_3d_coop_numa()
+ *	move the pages of each thread's slabs to the NUMA node
+ *	of the thread, neighbouring slabs share a node
+ */
+static int stress_matrix_3d_coop_numa(
+	stress_args_t *args,
+	stress_matrix_3d_coop_t *coop,
+	stress_matrix_3d_thread_t *threads,
+	const size_t n_threads)
+{
+	unsigned long max_node = 0, *node_mask;
+	size_t node_mask_size, t;
+	const size_t slice = sizeof(stress_matrix_3d_type_t) * coop->n * coop->n;
+	const int nodes = stress_numa_count_mem_nodes(&max_node);
+
+	if ((nodes < 2) || (max_node < 1)) {
+		if (args->instance == 0)
+			pr_inf("%s: fewer than 2 NUMA nodes, ignoring --matrix-3d-numa\n", args->name);
+		return 0;
+	}
+	node_mask_size = (size_t)((max_node + NUMA_LONG_BITS - 1) / NUMA_LONG_BITS) * sizeof(*node_mask);
+	node_mask = (unsigned long *)calloc(1, node_mask_size);
+	if (!node_mask)
+		return 0;
+
+	for (t = 0; t < n_threads; t++) {
+		stress_matrix_3d_type_t *matrices[3] = { coop->a, coop->b, coop->r };
+		size_t i;
+
+		threads[t].node = (int)((t * (size_t)nodes) / n_threads);
+		if (threads[t].hi <= threads[t].lo)
+			continue;
+		(void)shim_memset(node_mask, 0, node_mask_size);
+		STRESS_SETBIT(node_mask, (unsigned long)threads[t].node);
+
+		for (i = 0; i < SIZEOF_ARRAY(matrices); i++) {
+			const uintptr_t start = ((uintptr_t)matrices[i] + (threads[t].lo * slice)) &
+				~(uintptr_t)(args->page_size - 1);
+			const uintptr_t end = (uintptr_t)matrices[i] + (threads[t].hi * slice);
+
+			(void)shim_mbind((void *)start, (unsigned long)(end - start), MPOL_PREFERRED,
+				node_mask, max_node, MPOL_MF_MOVE);
+		}
+	}
+	free(node_mask);
+
+	return nodes;
+}
+#endif
+
+/*
+ *  stress_matrix_3d_coop()
+ *	K threads jointly compute the add, mult and trans ops on one
+ *	set of shared matrices, partitioned into x slabs, report the
+ *	aggregate GFLOP/s (GB/s for trans) and the per thread imbalance,
+ *	the ratio of the slowest slab to the mean slab time of each op
+ */
+static int stress_matrix_3d_coop(
+	stress_args_t *args,
+	const size_t matrix_3d_method,
+	const size_t n,
+	const size_t n_threads,
+	const bool numa)
+{
+	stress_matrix_3d_coop_t coop;
+	stress_matrix_3d_thread_t *threads;
+	const size_t matrix_3d_size = sizeof(stress_matrix_3d_type_t) * n * n * n;
+	const size_t matrix_3d_mmap_size = round_up(args->page_size, matrix_3d_size);
+	const size_t n_methods = SIZEOF_ARRAY(matrix_3d_coop_methods);
+	const stress_matrix_3d_type_t v = 65535 / (stress_matrix_3d_type_t)((uint64_t)~0);
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	double duration[SIZEOF_ARRAY(matrix_3d_coop_methods)];
+	double count[SIZEOF_ARRAY(matrix_3d_coop_methods)];
+	double imbalance[SIZEOF_ARRAY(matrix_3d_coop_methods)];
+	stress_matrix_3d_type_t *s = NULL;
+	size_t i, method = 0, started = 0, metric = 0;
+	int ret = EXIT_NO_RESOURCE, nodes = 0;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_POPULATE)
+	flags |= MAP_POPULATE;
+#endif
+
+	/* a specific method is used if it is one of the coop methods */
+	if (matrix_3d_method != 0) {
+		for (method = 0; method < n_methods; method++) {
+			if (!strcmp(matrix_3d_coop_methods[method].name,
+				    matrix_3d_methods[matrix_3d_method].name))
+				break;
+		}
+		if (method >= n_methods) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: --matrix-3d-threads only supports the add, mult "
+					"and trans methods, skipping stressor\n", args->name);
+			return EXIT_NO_RESOURCE;
+		}
+	}
+
+	for (i = 0; i < n_methods; i++) {
+		duration[i] = 0.0;
+		count[i] = 0.0;
+		imbalance[i] = 0.0;
+	}
+
+	(void)shim_memset(&coop, 0, sizeof(coop));
+	coop.n = n;
+	coop.a = (stress_matrix_3d_type_t *)stress_mmap_populate(NULL, matrix_3d_mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (coop.a == MAP_FAILED) {
+		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	coop.b = (stress_matrix_3d_type_t *)stress_mmap_populate(NULL, matrix_3d_mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (coop.b == MAP_FAILED) {
+		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+		goto tidy_a;
+	}
+	coop.r = (stress_matrix_3d_type_t *)stress_mmap_populate(NULL, matrix_3d_mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (coop.r == MAP_FAILED) {
+		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+		goto tidy_b;
+	}
+	if (verify) {
+		s = (stress_matrix_3d_type_t *)stress_mmap_populate(NULL, matrix_3d_mmap_size,
+			PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (s == MAP_FAILED) {
+			pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+			goto tidy_r;
+		}
+	}
+	threads = (stress_matrix_3d_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate thread data, skipping stressor\n", args->name);
+		goto tidy_s;
+	}
+
+	for (i = 0; i < n * n * n; i++) {
+		coop.a[i] = stress_matrix_data(v);
+		coop.b[i] = stress_matrix_data(v);
+		coop.r[i] = 0.0;
+	}
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].coop = &coop;
+		threads[i].lo = (i * n) / n_threads;
+		threads[i].hi = ((i + 1) * n) / n_threads;
+		threads[i].node = -1;
+	}
+#if defined(HAVE_MATRIX_3D_NUMA)
+	if (numa)
+		nodes = stress_matrix_3d_coop_numa(args, &coop, threads, n_threads);
+#else
+	if (numa && (args->instance == 0))
+		pr_inf("%s: NUMA memory binding not supported, ignoring --matrix-3d-numa\n",
+			args->name);
+#endif
+
+	(void)pthread_mutex_init(&coop.lock, NULL);
+	(void)pthread_cond_init(&coop.start, NULL);
+	(void)pthread_cond_init(&coop.done, NULL);
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_matrix_3d_coop_thread, (void *)&threads[i]);
+		if (threads[i].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, threads[i].ret, strerror(threads[i].ret));
+			goto tidy_threads;
+		}
+		started++;
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: %zu threads cooperating on %zu x %zu x %zu matrices%s\n",
+			args->name, n_threads, n, n, n, nodes > 1 ? ", NUMA partitioned" : "");
+
+	do {
+		double t, max_busy = 0.0, sum_busy = 0.0;
+
+		current_method = matrix_3d_coop_methods[method].name;
+
+		t = stress_time_now();
+		(void)pthread_mutex_lock(&coop.lock);
+		coop.method = method;
+		coop.remaining = n_threads;
+		coop.generation++;
+		(void)pthread_cond_broadcast(&coop.start);
+		while (coop.remaining > 0)
+			(void)pthread_cond_wait(&coop.done, &coop.lock);
+		(void)pthread_mutex_unlock(&coop.lock);
+		duration[method] += stress_time_now() - t;
+		count[method] += 1.0;
+		stress_bogo_inc(args);
+
+		for (i = 0; i < n_threads; i++) {
+			max_busy = STRESS_MAXIMUM(max_busy, threads[i].busy);
+			sum_busy += threads[i].busy;
+		}
+		if (sum_busy > 0.0)
+			imbalance[method] += max_busy / (sum_busy / (double)n_threads);
+
+		if (verify) {
+			const size_t full = matrix_3d_method ? matrix_3d_method :
+				stress_matrix_3d_method_index(matrix_3d_coop_methods[method].name);
+
+			matrix_3d_methods[full].func[0](n,
+				(stress_matrix_3d_type_t (*)[n][n])coop.a,
+				(stress_matrix_3d_type_t (*)[n][n])coop.b,
+				(stress_matrix_3d_type_t (*)[n][n])s);
+			if (shim_memcmp(coop.r, s, matrix_3d_size)) {
+				pr_fail("%s: %s: data difference between threaded and "
+					"single threaded matrix-3d computations\n",
+					args->name, current_method);
+			}
+		}
+		if (matrix_3d_method == 0) {
+			method++;
+			if (method >= n_methods)
+				method = 0;
+		}
+	} while (stress_continue(args));
+
+	for (i = 0; i < n_methods; i++) {
+		const double ops = (double)(n * n * n);
+		char msg[64];
+		double rate;
+
+		if ((duration[i] <= 0.0) || (count[i] < 1.0))
+			continue;
+		rate = count[i] / duration[i];
+		if (matrix_3d_coop_methods[i].flops > 0.0) {
+			(void)snprintf(msg, sizeof(msg), "%s aggregate GFLOP/s",
+				matrix_3d_coop_methods[i].name);
+			stress_metrics_set(args, metric++, msg,
+				rate * ops * matrix_3d_coop_methods[i].flops / 1.0E9,
+				STRESS_HARMONIC_MEAN);
+		} else {
+			/* read a, write r */
+			(void)snprintf(msg, sizeof(msg), "%s aggregate GB/s",
+				matrix_3d_coop_methods[i].name);
+			stress_metrics_set(args, metric++, msg,
+				rate * 2.0 * (double)matrix_3d_size / 1.0E9,
+				STRESS_HARMONIC_MEAN);
+		}
+		(void)snprintf(msg, sizeof(msg), "%s thread imbalance (max/mean)",
+			matrix_3d_coop_methods[i].name);
+		stress_metrics_set(args, metric++, msg,
+			imbalance[i] / count[i], STRESS_GEOMETRIC_MEAN);
+	}
+	ret = EXIT_SUCCESS;
+
+tidy_threads:
+	(void)pthread_mutex_lock(&coop.lock);
+	coop.stop = true;
+	(void)pthread_cond_broadcast(&coop.start);
+	(void)pthread_mutex_unlock(&coop.lock);
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	(void)pthread_cond_destroy(&coop.done);
+	(void)pthread_cond_destroy(&coop.start);
+	(void)pthread_mutex_destroy(&coop.lock);
+	free(threads);
+tidy_s:
+	if (verify)
+		(void)munmap((void *)s, matrix_3d_mmap_size);
+tidy_r:
+	(void)munmap((void *)coop.r, matrix_3d_mmap_size);
+tidy_b:
+	(void)munmap((void *)coop.b, matrix_3d_mmap_size);
+tidy_a:
+	(void)munmap((void *)coop.a, matrix_3d_mmap_size);
+
+	return ret;
+}
+#endif
+
 /*
  *  stress_matrix_3d()
  *	stress CPU by doing floating point math ops
@@ -995,11 +1512,15 @@ static int stress_matrix_3d(stress_args_t *args)
 	size_t matrix_3d_method = 0; 	/* All method */
 	size_t matrix_3d_size = DEFAULT_MATRIX3D_SIZE;
 	size_t matrix_3d_zyx = 0;
+	size_t matrix_3d_threads = 0;
+	bool matrix_3d_numa = false;
 	int rc;
 
 	stress_catch_sigill();
 
 	(void)stress_get_setting("matrix-3d-method", &matrix_3d_method);
+	(void)stress_get_setting("matrix-3d-numa", &matrix_3d_numa);
+	(void)stress_get_setting("matrix-3d-threads", &matrix_3d_threads);
 	(void)stress_get_setting("matrix-3d-zyx", &matrix_3d_zyx);
 
 	if (args->instance == 0)
@@ -1015,6 +1536,23 @@ static int stress_matrix_3d(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (matrix_3d_threads > 0) {
+#if defined(HAVE_MATRIX_3D_THREADS)
+		/* slabs are along x, a thread per x plane at most */
+		matrix_3d_threads = STRESS_MINIMUM(matrix_3d_threads, matrix_3d_size);
+		rc = stress_matrix_3d_coop(args, matrix_3d_method, matrix_3d_size,
+			matrix_3d_threads, matrix_3d_numa);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: pthreads not supported, cannot use "
+				"--matrix-3d-threads, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+#endif
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+		return rc;
+	}
+
 	rc = stress_matrix_3d_exercise(args, matrix_3d_method, matrix_3d_zyx, matrix_3d_size);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -1029,7 +1567,9 @@ static void stress_matrix_3d_set_default(void)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_matrix_3d_method,	stress_set_matrix_3d_method },
+	{ OPT_matrix_3d_numa,	stress_set_matrix_3d_numa },
 	{ OPT_matrix_3d_size,	stress_set_matrix_3d_size },
+	{ OPT_matrix_3d_threads, stress_set_matrix_3d_threads },
 	{ OPT_matrix_3d_zyx,	stress_set_matrix_3d_zyx },
 	{ 0,			NULL }
 };
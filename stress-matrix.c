@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
 #include "core-pragma.h"
 #include "core-put.h"
 #include "core-target-clones.h"
@@ -26,12 +27,14 @@
 #define MIN_MATRIX_SIZE		(16)
 #define MAX_MATRIX_SIZE		(8192)
 #define DEFAULT_MATRIX_SIZE	(128)
+#define MAX_MATRIX_SWEEP_SIZE	(4096)
 
 static const stress_help_t help[] = {
 	{ NULL,	"matrix N",		"start N workers exercising matrix operations" },
 	{ NULL,	"matrix-method M",	"specify matrix stress method M, default is all" },
 	{ NULL,	"matrix-ops N",		"stop after N maxtrix bogo operations" },
 	{ NULL,	"matrix-size N",	"specify the size of the N x N matrix" },
+	{ NULL,	"matrix-sweep",		"sweep matrix sizes across the cache levels, report GFLOP/s" },
 	{ NULL,	"matrix-yx",		"matrix operation is y by x instead of x by y" },
 	{ NULL,	NULL,			NULL }
 };
@@ -52,10 +55,20 @@ typedef void (*stress_matrix_func_t)(
 typedef struct {
 	const char			*name;		/* human readable form of stressor */
 	const stress_matrix_func_t	func[2];	/* method functions, x by y, y by x */
+	const double			flops;		/* flops per op = flops * n^order */
+	const int			order;
 } stress_matrix_method_info_t;
 
+typedef struct {
+	const char			*boundary;	/* cache boundary being probed */
+	size_t				n;		/* matrix size */
+	double				count[2];	/* ops per sweep method */
+	double				duration[2];	/* run time per sweep method */
+} stress_matrix_sweep_t;
+
 static const char *current_method = NULL;		/* current matrix method */
 static size_t method_all_index;				/* all method index */
+static size_t matrix_tile = 32;				/* blocked method tile size */
 
 static const stress_matrix_method_info_t matrix_methods[];
 
@@ -69,6 +82,11 @@ static int stress_set_matrix_size(const char *opt)
 	return stress_set_setting("matrix-size", TYPE_ID_SIZE_T, &matrix_size);
 }
 
+static int stress_set_matrix_sweep(const char *opt)
+{
+	return stress_set_setting_true("matrix-sweep", opt);
+}
+
 static int stress_set_matrix_yx(const char *opt)
 {
 	size_t matrix_yx = 1;
@@ -752,6 +770,227 @@ static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_square(
 	}
 }
 
+/*
+ *  stress_matrix_xy_prod_blocked()
+ *	matrix product, cache blocked into matrix_tile sized tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_prod_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t t = matrix_tile;
+	size_t ii;
+
+	for (ii = 0; ii < n; ii += t) {
+		const size_t i_end = STRESS_MINIMUM(ii + t, n);
+		size_t kk;
+
+		for (kk = 0; kk < n; kk += t) {
+			const size_t k_end = STRESS_MINIMUM(kk + t, n);
+			size_t jj;
+
+			for (jj = 0; jj < n; jj += t) {
+				const size_t j_end = STRESS_MINIMUM(jj + t, n);
+				register size_t i;
+
+				for (i = ii; i < i_end; i++) {
+					register size_t k;
+
+					for (k = kk; k < k_end; k++) {
+						const stress_matrix_type_t aik = a[i][k];
+						register size_t j;
+
+PRAGMA_UNROLL_N(8)
+						for (j = jj; j < j_end; j++) {
+							r[i][j] += aik * b[k][j];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_yx_prod_blocked()
+ *	matrix product, cache blocked into matrix_tile sized tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_prod_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t t = matrix_tile;
+	size_t jj;
+
+	for (jj = 0; jj < n; jj += t) {
+		const size_t j_end = STRESS_MINIMUM(jj + t, n);
+		size_t kk;
+
+		for (kk = 0; kk < n; kk += t) {
+			const size_t k_end = STRESS_MINIMUM(kk + t, n);
+			size_t ii;
+
+			for (ii = 0; ii < n; ii += t) {
+				const size_t i_end = STRESS_MINIMUM(ii + t, n);
+				register size_t i;
+
+				for (i = ii; i < i_end; i++) {
+					register size_t k;
+
+					for (k = kk; k < k_end; k++) {
+						const stress_matrix_type_t aik = a[i][k];
+						register size_t j;
+
+						for (j = jj; j < j_end; j++) {
+							r[i][j] += aik * b[k][j];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_xy_trans_blocked()
+ *	matrix transpose, cache blocked into matrix_tile sized tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_trans_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],	/* Ignored */
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t t = matrix_tile;
+	size_t ii;
+
+	(void)b;
+
+	for (ii = 0; ii < n; ii += t) {
+		const size_t i_end = STRESS_MINIMUM(ii + t, n);
+		size_t jj;
+
+		for (jj = 0; jj < n; jj += t) {
+			const size_t j_end = STRESS_MINIMUM(jj + t, n);
+			register size_t i;
+
+			for (i = ii; i < i_end; i++) {
+				register size_t j;
+
+PRAGMA_UNROLL_N(8)
+				for (j = jj; j < j_end; j++) {
+					r[i][j] = a[j][i];
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_yx_trans_blocked()
+ *	matrix transpose, cache blocked into matrix_tile sized tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_trans_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],	/* Ignored */
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t t = matrix_tile;
+	size_t jj;
+
+	(void)b;
+
+	for (jj = 0; jj < n; jj += t) {
+		const size_t j_end = STRESS_MINIMUM(jj + t, n);
+		size_t ii;
+
+		for (ii = 0; ii < n; ii += t) {
+			const size_t i_end = STRESS_MINIMUM(ii + t, n);
+			register size_t j;
+
+			for (j = jj; j < j_end; j++) {
+				register size_t i;
+
+				for (i = ii; i < i_end; i++) {
+					r[i][j] = a[j][i];
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_xy_mult_blocked()
+ *	matrix scalar multiply, cache blocked into matrix_tile sized tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_xy_mult_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t t = matrix_tile;
+	const stress_matrix_type_t v = b[0][0];
+	size_t ii;
+
+	for (ii = 0; ii < n; ii += t) {
+		const size_t i_end = STRESS_MINIMUM(ii + t, n);
+		size_t jj;
+
+		for (jj = 0; jj < n; jj += t) {
+			const size_t j_end = STRESS_MINIMUM(jj + t, n);
+			register size_t i;
+
+			for (i = ii; i < i_end; i++) {
+				register size_t j;
+
+PRAGMA_UNROLL_N(8)
+				for (j = jj; j < j_end; j++) {
+					r[i][j] = v * a[i][j];
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_yx_mult_blocked()
+ *	matrix scalar multiply, cache blocked into matrix_tile sized tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_mult_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t t = matrix_tile;
+	const stress_matrix_type_t v = b[0][0];
+	size_t jj;
+
+	for (jj = 0; jj < n; jj += t) {
+		const size_t j_end = STRESS_MINIMUM(jj + t, n);
+		size_t ii;
+
+		for (ii = 0; ii < n; ii += t) {
+			const size_t i_end = STRESS_MINIMUM(ii + t, n);
+			register size_t j;
+
+			for (j = jj; j < j_end; j++) {
+				register size_t i;
+
+				for (i = ii; i < i_end; i++) {
+					r[i][j] = v * a[i][j];
+				}
+			}
+		}
+	}
+}
+
 /*
  *  stress_matrix_xy_all()
  *	iterate over all matrix stressors
@@ -776,22 +1015,25 @@ static void OPTIMIZE3 stress_matrix_yx_all(
  * Table of matrix stress methods, ordered x by y and y by x
  */
 static const stress_matrix_method_info_t matrix_methods[] = {
-	{ "all",		{ stress_matrix_xy_all,		stress_matrix_yx_all } },/* Special "all" test */
-
-	{ "add",		{ stress_matrix_xy_add,		stress_matrix_yx_add } },
-	{ "copy",		{ stress_matrix_xy_copy,	stress_matrix_yx_copy } },
-	{ "div",		{ stress_matrix_xy_div,		stress_matrix_yx_div } },
-	{ "frobenius",		{ stress_matrix_xy_frobenius,	stress_matrix_yx_frobenius } },
-	{ "hadamard",		{ stress_matrix_xy_hadamard,	stress_matrix_yx_hadamard } },
-	{ "identity",		{ stress_matrix_xy_identity,	stress_matrix_yx_identity } },
-	{ "mean",		{ stress_matrix_xy_mean,	stress_matrix_yx_mean } },
-	{ "mult",		{ stress_matrix_xy_mult,	stress_matrix_yx_mult } },
-	{ "negate",		{ stress_matrix_xy_negate,	stress_matrix_yx_negate } },
-	{ "prod",		{ stress_matrix_xy_prod,	stress_matrix_yx_prod } },
-	{ "sub",		{ stress_matrix_xy_sub,		stress_matrix_yx_sub } },
-	{ "square",		{ stress_matrix_xy_square,	stress_matrix_yx_square } },
-	{ "trans",		{ stress_matrix_xy_trans,	stress_matrix_yx_trans } },
-	{ "zero",		{ stress_matrix_xy_zero,	stress_matrix_yx_zero } },
+	{ "all",		{ stress_matrix_xy_all,		stress_matrix_yx_all },		0.0, 0 },/* Special "all" test */
+
+	{ "add",		{ stress_matrix_xy_add,		stress_matrix_yx_add },		1.0, 2 },
+	{ "copy",		{ stress_matrix_xy_copy,	stress_matrix_yx_copy },	0.0, 2 },
+	{ "div",		{ stress_matrix_xy_div,		stress_matrix_yx_div },		1.0, 2 },
+	{ "frobenius",		{ stress_matrix_xy_frobenius,	stress_matrix_yx_frobenius },	2.0, 2 },
+	{ "hadamard",		{ stress_matrix_xy_hadamard,	stress_matrix_yx_hadamard },	1.0, 2 },
+	{ "identity",		{ stress_matrix_xy_identity,	stress_matrix_yx_identity },	0.0, 2 },
+	{ "mean",		{ stress_matrix_xy_mean,	stress_matrix_yx_mean },	2.0, 2 },
+	{ "mult",		{ stress_matrix_xy_mult,	stress_matrix_yx_mult },	1.0, 2 },
+	{ "mult-blocked",	{ stress_matrix_xy_mult_blocked, stress_matrix_yx_mult_blocked }, 1.0, 2 },
+	{ "negate",		{ stress_matrix_xy_negate,	stress_matrix_yx_negate },	1.0, 2 },
+	{ "prod",		{ stress_matrix_xy_prod,	stress_matrix_yx_prod },	2.0, 3 },
+	{ "prod-blocked",	{ stress_matrix_xy_prod_blocked, stress_matrix_yx_prod_blocked }, 2.0, 3 },
+	{ "sub",		{ stress_matrix_xy_sub,		stress_matrix_yx_sub },		1.0, 2 },
+	{ "square",		{ stress_matrix_xy_square,	stress_matrix_yx_square },	2.0, 3 },
+	{ "trans",		{ stress_matrix_xy_trans,	stress_matrix_yx_trans },	0.0, 2 },
+	{ "trans-blocked",	{ stress_matrix_xy_trans_blocked, stress_matrix_yx_trans_blocked }, 0.0, 2 },
+	{ "zero",		{ stress_matrix_xy_zero,	stress_matrix_yx_zero },	0.0, 2 },
 };
 
 static stress_metrics_t matrix_metrics[SIZEOF_ARRAY(matrix_methods)];
@@ -1004,6 +1246,246 @@ tidy_ret:
 	return ret;
 }
 
+/*
+ *  stress_matrix_tile_size()
+ *	tile size for the blocked methods, the largest power of 2
+ *	tile where one tile of each of the 3 matrices fits in the
+ *	L1 cache, assume a 32K L1 cache if the size is not known
+ */
+static size_t stress_matrix_tile_size(void)
+{
+	size_t l1_size, cache_line_size, tile = 8;
+
+	stress_cpu_cache_get_level_size(1, &l1_size, &cache_line_size);
+	if (l1_size == 0)
+		l1_size = 32 * KB;
+
+	while ((tile < 256) &&
+	       ((tile * 2) * (tile * 2) * sizeof(stress_matrix_type_t) * 3 <= l1_size))
+		tile *= 2;
+
+	return tile;
+}
+
+/*
+ *  stress_matrix_method_index()
+ *	find index of a named matrix method
+ */
+static size_t stress_matrix_method_index(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(matrix_methods); i++) {
+		if (!strcmp(matrix_methods[i].name, name))
+			return i;
+	}
+	return 0;
+}
+
+/*
+ *  stress_matrix_sweep_n()
+ *	matrix size where the 3 matrices use about ws bytes,
+ *	rounded down to a multiple of 16
+ */
+static size_t stress_matrix_sweep_n(const double ws)
+{
+	size_t n = (size_t)sqrt(ws / (3.0 * sizeof(stress_matrix_type_t)));
+
+	n &= ~(size_t)15;
+	if (n < MIN_MATRIX_SIZE)
+		n = MIN_MATRIX_SIZE;
+	if (n > MAX_MATRIX_SWEEP_SIZE)
+		n = MAX_MATRIX_SWEEP_SIZE;
+	return n;
+}
+
+/*
+ *  stress_matrix_sweep_sizes()
+ *	fill in the matrix sizes that fit in half and spill
+ *	to twice each cache level and 4 times the largest cache
+ *	for DRAM, returns number of sizes
+ */
+static size_t stress_matrix_sweep_sizes(stress_matrix_sweep_t *sweep)
+{
+	static const char * const fit[] = { "L1 fit", "L2 fit", "L3 fit" };
+	static const char * const spill[] = { "L1 spill", "L2 spill", "L3 spill" };
+	size_t level, n_sweep = 0, largest = 0, i;
+
+	for (level = 1; level <= 3; level++) {
+		size_t cache_size, cache_line_size;
+
+		stress_cpu_cache_get_level_size((uint16_t)level, &cache_size, &cache_line_size);
+		if (cache_size == 0)
+			continue;
+		largest = cache_size;
+		sweep[n_sweep].boundary = fit[level - 1];
+		sweep[n_sweep++].n = stress_matrix_sweep_n((double)cache_size / 2.0);
+		sweep[n_sweep].boundary = spill[level - 1];
+		sweep[n_sweep++].n = stress_matrix_sweep_n((double)cache_size * 2.0);
+	}
+	if (largest == 0)
+		largest = 8 * MB;
+	sweep[n_sweep].boundary = "DRAM";
+	sweep[n_sweep++].n = stress_matrix_sweep_n((double)largest * 4.0);
+
+	/* larger cache levels may clamp to the same size, drop duplicates */
+	for (i = 1, level = 1; i < n_sweep; i++) {
+		if (sweep[i].n != sweep[level - 1].n)
+			sweep[level++] = sweep[i];
+	}
+	return level;
+}
+
+/*
+ *  stress_matrix_sweep()
+ *	run the method (or prod and prod-blocked for the default
+ *	all method) over matrix sizes that step across the cache
+ *	level boundaries and report the GFLOP/s for each size
+ */
+static int stress_matrix_sweep(
+	stress_args_t *args,
+	const size_t matrix_method,
+	const size_t matrix_yx)
+{
+	stress_matrix_sweep_t sweep[7];
+	size_t methods[2], n_methods, n_sweep, max_n = 0, i, j, k;
+	size_t mmap_size, metric = 0, op_n[2] = { 0, 0 };
+	double op_time[2] = { 0.0, 0.0 };
+	stress_matrix_type_t *a, *b, *r;
+	const stress_matrix_type_t v = 65535 / (stress_matrix_type_t)((uint64_t)~0);
+	double slice;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_POPULATE)
+	flags |= MAP_POPULATE;
+#endif
+
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+	n_sweep = stress_matrix_sweep_sizes(sweep);
+	for (i = 0; i < n_sweep; i++)
+		max_n = STRESS_MAXIMUM(max_n, sweep[i].n);
+
+	if (matrix_method == 0) {
+		methods[0] = stress_matrix_method_index("prod");
+		methods[1] = stress_matrix_method_index("prod-blocked");
+		n_methods = 2;
+	} else {
+		methods[0] = matrix_method;
+		n_methods = 1;
+	}
+
+	mmap_size = round_up(args->page_size, sizeof(stress_matrix_type_t) * max_n * max_n);
+	a = (stress_matrix_type_t *)stress_mmap_populate(NULL, mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (a == MAP_FAILED) {
+		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	b = (stress_matrix_type_t *)stress_mmap_populate(NULL, mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (b == MAP_FAILED) {
+		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+		(void)munmap((void *)a, mmap_size);
+		return EXIT_NO_RESOURCE;
+	}
+	r = (stress_matrix_type_t *)stress_mmap_populate(NULL, mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (r == MAP_FAILED) {
+		pr_fail("%s: matrix allocation failed, out of memory\n", args->name);
+		(void)munmap((void *)b, mmap_size);
+		(void)munmap((void *)a, mmap_size);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < max_n * max_n; i++) {
+		a[i] = stress_matrix_data(v);
+		b[i] = stress_matrix_data(v);
+		r[i] = 0.0;
+	}
+
+	/* spread the run over all sizes, repeating the sweep if time remains */
+	slice = (double)g_opt_timeout / (double)(n_sweep * n_methods);
+	slice = STRESS_MINIMUM(1.0, STRESS_MAXIMUM(0.05, slice));
+
+	do {
+		for (i = 0; (i < n_sweep) && stress_continue(args); i++) {
+			const size_t n = sweep[i].n;
+
+			for (j = 0; (j < n_methods) && stress_continue(args); j++) {
+				const stress_matrix_method_info_t *method = &matrix_methods[methods[j]];
+				const stress_matrix_func_t func = method->func[matrix_yx];
+				double t_start, t;
+
+				/*
+				 *  skip sizes where a single op, scaled up from the
+				 *  previous size, would take far longer than the slice
+				 */
+				if (op_n[j] > 0) {
+					double predicted = op_time[j];
+
+					for (k = 0; k < (size_t)method->order; k++)
+						predicted *= (double)n / (double)op_n[j];
+					if ((predicted > 1.0) && (predicted > 2.0 * slice))
+						continue;
+				}
+
+				current_method = method->name;
+				t_start = stress_time_now();
+				do {
+					func(n, (stress_matrix_type_t (*)[n])a,
+						(stress_matrix_type_t (*)[n])b,
+						(stress_matrix_type_t (*)[n])r);
+					sweep[i].count[j] += 1.0;
+					stress_bogo_inc(args);
+					t = stress_time_now();
+				} while ((t - t_start < slice) && stress_continue(args));
+				sweep[i].duration[j] += t - t_start;
+				op_time[j] = sweep[i].duration[j] / sweep[i].count[j];
+				op_n[j] = n;
+			}
+		}
+	} while (stress_continue(args));
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %6s %10s %-14s %12s %10s\n", args->name,
+			"boundary", "size", "set (KB)", "method", "ops per sec", "GFLOP/s");
+
+	for (i = 0; i < n_sweep; i++) {
+		const size_t n = sweep[i].n;
+		const double ws = 3.0 * (double)(sizeof(stress_matrix_type_t) * n * n);
+
+		for (j = 0; j < n_methods; j++) {
+			const stress_matrix_method_info_t *method = &matrix_methods[methods[j]];
+			double rate, flops = method->flops, gflops;
+			char msg[64];
+
+			if (sweep[i].duration[j] <= 0.0)
+				continue;
+			rate = sweep[i].count[j] / sweep[i].duration[j];
+			for (k = 0; k < (size_t)method->order; k++)
+				flops *= (double)n;
+			gflops = rate * flops / 1.0E9;
+
+			if (args->instance == 0)
+				pr_inf("%s: %-9s %6zu %10.0f %-14s %12.2f %10.3f\n", args->name,
+					sweep[i].boundary, n, ws / (double)KB, method->name, rate, gflops);
+
+			/* data movement only methods report GB/s of working set instead */
+			if (method->flops > 0.0)
+				(void)snprintf(msg, sizeof(msg), "%s n=%zu GFLOP/s", method->name, n);
+			else
+				(void)snprintf(msg, sizeof(msg), "%s n=%zu GB/s", method->name, n);
+			stress_metrics_set(args, metric++, msg,
+				(method->flops > 0.0) ? gflops : rate * ws / 1.0E9,
+				STRESS_HARMONIC_MEAN);
+		}
+	}
+
+	(void)munmap((void *)r, mmap_size);
+	(void)munmap((void *)b, mmap_size);
+	(void)munmap((void *)a, mmap_size);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_matrix()
  *	stress CPU by doing floating point math ops
@@ -1013,16 +1495,28 @@ static int stress_matrix(stress_args_t *args)
 	size_t matrix_method = 0;	/* All method */
 	size_t matrix_size = DEFAULT_MATRIX_SIZE;
 	size_t matrix_yx = 0;
+	bool matrix_sweep = false;
 	int rc;
 
 	stress_catch_sigill();
 
 	(void)stress_get_setting("matrix-method", &matrix_method);
+	(void)stress_get_setting("matrix-sweep", &matrix_sweep);
 	(void)stress_get_setting("matrix-yx", &matrix_yx);
 
+	matrix_tile = stress_matrix_tile_size();
 	if (args->instance == 0)
-		pr_dbg("%s: using method '%s' (%s)\n", args->name, matrix_methods[matrix_method].name,
-			matrix_yx ? "y by x" : "x by y");
+		pr_dbg("%s: using method '%s' (%s), %zu x %zu blocked tiles\n", args->name,
+			matrix_methods[matrix_method].name,
+			matrix_yx ? "y by x" : "x by y", matrix_tile, matrix_tile);
+
+	if (matrix_sweep) {
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_matrix_sweep(args, matrix_method, matrix_yx);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+		return rc;
+	}
 
 	if (!stress_get_setting("matrix-size", &matrix_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -1048,6 +1542,7 @@ static void stress_matrix_set_default(void)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_matrix_method,	stress_set_matrix_method },
 	{ OPT_matrix_size,	stress_set_matrix_size },
+	{ OPT_matrix_sweep,	stress_set_matrix_sweep },
 	{ OPT_matrix_yx,	stress_set_matrix_yx },
 	{ 0,			NULL },
 };
@@ -22,14 +22,30 @@
 #include "core-asm-x86.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-perf.h"
 #include "core-pthread.h"
 
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"mcontend N",	  "start N workers that produce memory contention" },
+	{ NULL,	"mcontend-false-sharing", "compare packed and padded contended words" },
 	{ NULL,	"mcontend-ops N", "stop memory contention workers after N bogo-ops" },
 	{ NULL,	NULL,		  NULL }
 };
 
+static int stress_set_mcontend_false_sharing(const char *opt)
+{
+	return stress_set_setting_true("mcontend-false-sharing", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_mcontend_false_sharing,	stress_set_mcontend_false_sharing },
+	{ 0,				NULL }
+};
+
 #if defined(HAVE_LIB_PTHREAD)
 
 static sigset_t set;
@@ -335,6 +351,371 @@ static void *stress_memory_contend_thread(void *arg)
 	return &nowt;
 }
 
+/*
+ *  False sharing comparison, each contention pattern is run by a set of
+ *  pinned threads each hammering its own 64 bit word, first with the
+ *  words packed into one cache line and then with the words padded apart
+ */
+#define STRESS_MCONTEND_FS_THREADS	(8)	/* max threads, 8 words fill a line */
+#define STRESS_MCONTEND_FS_PAD		(128)	/* padding, defeats adjacent line prefetch */
+#define STRESS_MCONTEND_FS_LOOPS	(1024)	/* ops between stop checks */
+
+#define STRESS_MCONTEND_FS_PACKED	(0)
+#define STRESS_MCONTEND_FS_PADDED	(1)
+
+#define STRESS_MCONTEND_FS_STORE	(0)
+#define STRESS_MCONTEND_FS_STORE_MB	(1)
+#define STRESS_MCONTEND_FS_RMW		(2)
+#define STRESS_MCONTEND_FS_ATOMIC	(3)
+
+static const char * const mcontend_fs_patterns[] = {
+	"store",
+	"store-mfence",
+	"read-modify-write",
+#if defined(HAVE_ATOMIC_FETCH_ADD) &&	\
+    defined(__ATOMIC_RELAXED)
+	"atomic-add",
+#endif
+};
+
+typedef struct {
+	double duration;	/* accumulated run time */
+	uint64_t ops;		/* accumulated ops over all threads */
+	uint64_t misses;	/* accumulated L1D read misses */
+	bool misses_valid;	/* all threads had a miss counter */
+} stress_mcontend_fs_result_t;
+
+typedef struct {
+	volatile uint64_t *word;	/* word this thread contends on */
+	volatile bool *start;		/* set to start all threads */
+	volatile bool *stop;		/* set to stop all threads */
+	size_t pattern;			/* STRESS_MCONTEND_FS_* pattern */
+	int32_t cpu;			/* CPU to pin to, -1 for none */
+	uint64_t ops;			/* ops performed */
+	uint64_t misses;		/* L1D read misses */
+	bool misses_valid;		/* misses counter was readable */
+	pthread_t pthread;		/* thread */
+	int ret;			/* pthread_create return */
+} stress_mcontend_fs_thread_t;
+
+/*
+ *  stress_mcontend_fs_ops()
+ *	do STRESS_MCONTEND_FS_LOOPS ops of a contention pattern on a word
+ */
+static inline HOT OPTIMIZE3 void stress_mcontend_fs_ops(
+	volatile uint64_t *word,
+	const size_t pattern)
+{
+	register int i;
+
+	switch (pattern) {
+	default:
+	case STRESS_MCONTEND_FS_STORE:
+		for (i = 0; i < STRESS_MCONTEND_FS_LOOPS; i++)
+			*word = (uint64_t)i;
+		break;
+	case STRESS_MCONTEND_FS_STORE_MB:
+		for (i = 0; i < STRESS_MCONTEND_FS_LOOPS; i++) {
+			*word = (uint64_t)i;
+			shim_mfence();
+		}
+		break;
+	case STRESS_MCONTEND_FS_RMW:
+		for (i = 0; i < STRESS_MCONTEND_FS_LOOPS; i++)
+			(*word)++;
+		break;
+#if defined(HAVE_ATOMIC_FETCH_ADD) &&	\
+    defined(__ATOMIC_RELAXED)
+	case STRESS_MCONTEND_FS_ATOMIC:
+		for (i = 0; i < STRESS_MCONTEND_FS_LOOPS; i++)
+			__atomic_fetch_add(word, 1, __ATOMIC_RELAXED);
+		break;
+#endif
+	}
+}
+
+/*
+ *  stress_mcontend_fs_misses_open()
+ *	open a user space L1D read miss counter on the
+ *	calling thread, -1 if not available or not --perf
+ */
+static int stress_mcontend_fs_misses_open(void)
+{
+#if defined(STRESS_PERF_STATS)
+	if (!(g_opt_flags & OPT_FLAGS_PERF_STATS))
+		return -1;
+	return stress_perf_hw_cache_open(PERF_COUNT_HW_CACHE_L1D |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+	return -1;
+#endif
+}
+
+/*
+ *  stress_mcontend_fs_misses_read()
+ *	read a L1D miss counter, returns false if not available
+ */
+static bool stress_mcontend_fs_misses_read(const int fd, uint64_t *misses)
+{
+#if defined(STRESS_PERF_STATS)
+	*misses = stress_perf_hw_read(fd);
+	return *misses != STRESS_PERF_INVALID;
+#else
+	(void)fd;
+	*misses = 0;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_mcontend_fs_thread()
+ *	pinned contention thread, runs a pattern until told to stop
+ */
+static void *stress_mcontend_fs_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_mcontend_fs_thread_t *thread = (stress_mcontend_fs_thread_t *)arg;
+	sigset_t mask;
+	uint64_t ops = 0, misses_start = 0, misses_end = 0;
+	int fd;
+	bool valid;
+
+	(void)sigfillset(&mask);
+	(void)sigprocmask(SIG_BLOCK, &mask, NULL);
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+	if (thread->cpu >= 0) {
+		cpu_set_t cpu_mask;
+
+		CPU_ZERO(&cpu_mask);
+		CPU_SET(thread->cpu, &cpu_mask);
+		(void)sched_setaffinity(0, sizeof(cpu_mask), &cpu_mask);
+	}
+#endif
+	fd = stress_mcontend_fs_misses_open();
+
+	while (!*thread->start && !*thread->stop)
+		shim_sched_yield();
+
+	valid = stress_mcontend_fs_misses_read(fd, &misses_start);
+	while (!*thread->stop) {
+		stress_mcontend_fs_ops(thread->word, thread->pattern);
+		ops += STRESS_MCONTEND_FS_LOOPS;
+	}
+	valid &= stress_mcontend_fs_misses_read(fd, &misses_end);
+	if (fd >= 0)
+		(void)close(fd);
+
+	thread->ops = ops;
+	thread->misses = valid ? misses_end - misses_start : 0;
+	thread->misses_valid = valid;
+
+	return &nowt;
+}
+
+/*
+ *  stress_mcontend_fs_run()
+ *	run a pattern for duration seconds with the threads
+ *	words packed into one cache line or padded apart
+ */
+static int stress_mcontend_fs_run(
+	stress_args_t *args,
+	uint8_t *buf,
+	const int32_t *cpus,
+	const size_t n_cpus,
+	const size_t n_threads,
+	const size_t pattern,
+	const size_t layout,
+	const double duration,
+	stress_mcontend_fs_result_t *result)
+{
+	stress_mcontend_fs_thread_t threads[STRESS_MCONTEND_FS_THREADS];
+	const size_t stride = (layout == STRESS_MCONTEND_FS_PACKED) ?
+		sizeof(uint64_t) : STRESS_MCONTEND_FS_PAD;
+	volatile bool start = false, stop = false;
+	size_t i, started;
+	uint64_t ops = 0, misses = 0;
+	bool misses_valid = true;
+	double t;
+
+	for (started = 0; started < n_threads; started++) {
+		stress_mcontend_fs_thread_t *thread = &threads[started];
+
+		thread->word = (volatile uint64_t *)(buf + (started * stride));
+		thread->start = &start;
+		thread->stop = &stop;
+		thread->pattern = pattern;
+		thread->cpu = n_cpus ? cpus[started % n_cpus] : -1;
+		thread->ops = 0;
+		thread->misses = 0;
+		thread->misses_valid = false;
+		thread->ret = pthread_create(&thread->pthread, NULL,
+			stress_mcontend_fs_thread, (void *)thread);
+		if (thread->ret) {
+			pr_inf("%s: pthread_create failed, errno=%d (%s)\n",
+				args->name, thread->ret, strerror(thread->ret));
+			break;
+		}
+	}
+
+	if (started == n_threads) {
+		t = stress_time_now();
+		start = true;
+		(void)shim_nanosleep_uint64((uint64_t)(duration * STRESS_DBL_NANOSECOND));
+		stop = true;
+		t = stress_time_now() - t;
+	} else {
+		stop = true;
+		t = 0.0;
+	}
+
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		ops += threads[i].ops;
+		misses += threads[i].misses;
+		misses_valid &= threads[i].misses_valid;
+	}
+	if (started != n_threads)
+		return -1;
+
+	result->duration += t;
+	result->ops += ops;
+	result->misses += misses;
+	result->misses_valid = misses_valid;
+
+	return 0;
+}
+
+/*
+ *  stress_mcontend_false_sharing()
+ *	compare the throughput of each contention pattern with the
+ *	contended words packed into one cache line against the words
+ *	padded apart and report the false sharing cost
+ */
+static int stress_mcontend_false_sharing(stress_args_t *args)
+{
+	const size_t n_patterns = SIZEOF_ARRAY(mcontend_fs_patterns);
+	stress_mcontend_fs_result_t results[SIZEOF_ARRAY(mcontend_fs_patterns)][2];
+	int32_t cpus[STRESS_MCONTEND_FS_THREADS];
+	size_t n_cpus = 0, n_threads, p, metric = 0;
+	const size_t buf_size = STRESS_MCONTEND_FS_THREADS * STRESS_MCONTEND_FS_PAD;
+	double slice;
+	uint8_t *buf;
+	bool perf_valid = true;
+	int rc = EXIT_SUCCESS;
+
+#if defined(HAVE_SCHED_GETAFFINITY)
+	{
+		cpu_set_t proc_mask;
+		int cpu;
+
+		if (sched_getaffinity(0, sizeof(proc_mask), &proc_mask) == 0) {
+			for (cpu = 0; (cpu < CPU_SETSIZE) && (n_cpus < STRESS_MCONTEND_FS_THREADS); cpu++) {
+				if (CPU_ISSET(cpu, &proc_mask))
+					cpus[n_cpus++] = (int32_t)cpu;
+			}
+		}
+	}
+#endif
+	/* one thread per CPU, at least 2 so there is contention */
+	n_threads = STRESS_MAXIMUM(n_cpus, (size_t)2);
+
+	buf = (uint8_t *)mmap(NULL, STRESS_MAXIMUM(buf_size, args->page_size),
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, skipping stressor\n",
+			args->name, buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(buf, 0, buf_size);
+	(void)shim_memset(results, 0, sizeof(results));
+
+	slice = g_opt_timeout ? (double)g_opt_timeout / (double)(n_patterns * 2) : 1.0;
+	if (slice > 2.0)
+		slice = 2.0;
+	if (slice < 0.1)
+		slice = 0.1;
+
+	if (args->instance == 0)
+		pr_inf("%s: comparing packed and padded contended words with %zu threads%s\n",
+			args->name, n_threads, (n_cpus < 2) ? " on 1 CPU" : "");
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (p = 0; p < n_patterns; p++) {
+			if ((stress_mcontend_fs_run(args, buf, cpus, n_cpus, n_threads, p,
+					STRESS_MCONTEND_FS_PACKED, slice, &results[p][0]) < 0) ||
+			    (stress_mcontend_fs_run(args, buf, cpus, n_cpus, n_threads, p,
+					STRESS_MCONTEND_FS_PADDED, slice, &results[p][1]) < 0)) {
+				rc = EXIT_NO_RESOURCE;
+				goto report;
+			}
+			stress_bogo_inc(args);
+			if (!stress_continue(args))
+				goto report;
+		}
+	} while (stress_continue(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-18s %12s %12s %8s %12s %12s\n", args->name, "pattern",
+			"packed Mop/s", "padded Mop/s", "ratio", "packed miss", "padded miss");
+	for (p = 0; p < n_patterns; p++) {
+		const stress_mcontend_fs_result_t *packed = &results[p][0];
+		const stress_mcontend_fs_result_t *padded = &results[p][1];
+		double packed_rate, padded_rate, ratio, packed_miss = 0.0, padded_miss = 0.0;
+		bool misses_valid;
+		char msg[64];
+
+		if ((packed->duration <= 0.0) || (padded->duration <= 0.0) ||
+		    (packed->ops == 0) || (padded->ops == 0))
+			continue;
+		packed_rate = (double)packed->ops / packed->duration;
+		padded_rate = (double)padded->ops / padded->duration;
+		ratio = padded_rate / packed_rate;
+		misses_valid = packed->misses_valid && padded->misses_valid;
+		if (misses_valid) {
+			packed_miss = (double)packed->misses / (double)packed->ops;
+			padded_miss = (double)padded->misses / (double)padded->ops;
+		} else {
+			perf_valid = false;
+		}
+		if (args->instance == 0) {
+			if (misses_valid)
+				pr_inf("%s: %-18s %12.2f %12.2f %8.2f %12.4f %12.4f\n", args->name,
+					mcontend_fs_patterns[p], packed_rate / 1000000.0,
+					padded_rate / 1000000.0, ratio, packed_miss, padded_miss);
+			else
+				pr_inf("%s: %-18s %12.2f %12.2f %8.2f %12s %12s\n", args->name,
+					mcontend_fs_patterns[p], packed_rate / 1000000.0,
+					padded_rate / 1000000.0, ratio, "-", "-");
+		}
+		(void)snprintf(msg, sizeof(msg), "%s packed M ops per sec", mcontend_fs_patterns[p]);
+		stress_metrics_set(args, metric++, msg, packed_rate / 1000000.0, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s padded M ops per sec", mcontend_fs_patterns[p]);
+		stress_metrics_set(args, metric++, msg, padded_rate / 1000000.0, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s false sharing cost (padded/packed)", mcontend_fs_patterns[p]);
+		stress_metrics_set(args, metric++, msg, ratio, STRESS_GEOMETRIC_MEAN);
+		if (misses_valid) {
+			(void)snprintf(msg, sizeof(msg), "%s packed L1D misses per op", mcontend_fs_patterns[p]);
+			stress_metrics_set(args, metric++, msg, packed_miss, STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "%s padded L1D misses per op", mcontend_fs_patterns[p]);
+			stress_metrics_set(args, metric++, msg, padded_miss, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	if ((g_opt_flags & OPT_FLAGS_PERF_STATS) && !perf_valid && (args->instance == 0))
+		pr_inf("%s: L1D read miss perf counter not available, "
+			"no misses per op reported\n", args->name);
+
+	(void)munmap((void *)buf, STRESS_MAXIMUM(buf_size, args->page_size));
+
+	return rc;
+}
+
 /*
  *  stress_mcontend
  *	memory contention stress
@@ -348,6 +729,11 @@ static int stress_mcontend(stress_args_t *args)
 	char filename[PATH_MAX];
 	stress_pthread_args_t pa;
 	int fd, rc;
+	bool mcontend_false_sharing = false;
+
+	(void)stress_get_setting("mcontend-false-sharing", &mcontend_false_sharing);
+	if (mcontend_false_sharing)
+		return stress_mcontend_false_sharing(args);
 
 	rc = stress_temp_dir_mk_args(args);
 	if (rc < 0)
@@ -438,12 +824,14 @@ static int stress_mcontend(stress_args_t *args)
 stressor_info_t stress_mcontend_info = {
 	.stressor = stress_mcontend,
 	.class = CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_mcontend_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without pthread support"
 };
@@ -19,17 +19,27 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-cpu-cache.h"
+#include "core-nt-store.h"
 #include "core-target-clones.h"
+#include "core-vecmath.h"
 
 #define ALIGN_SIZE	(64)
 #define MEMCPY_MEMSIZE	(2048)
 #define MEMCPY_LOOPS	(1024)
 
+#define MEMCPY_SWEEP_MIN	(8)		/* smallest sweep copy size */
+#define MEMCPY_SWEEP_MAX	(64 * MB)	/* largest sweep copy size */
+#define MEMCPY_SWEEP_SIZES	(40)
+#define MEMCPY_SWEEP_SMALL	(4 * KB)	/* 1.5 x 2^n steps up to here */
+#define MEMCPY_SWEEP_BATCH	(256 * KB)	/* bytes copied per timing batch */
 
 static const stress_help_t help[] = {
 	{ NULL,	"memcpy N",	   "start N workers performing memory copies" },
 	{ NULL,	"memcpy-method M", "set memcpy method (M = all, libc, builtin, naive..)" },
 	{ NULL,	"memcpy-ops N",	   "stop after N memcpy bogo operations" },
+	{ NULL,	"memcpy-sweep",	   "sweep copy sizes and alignments, report GB/s per method" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -38,13 +48,31 @@ static char *s_method_name = "";
 
 typedef void (*stress_memcpy_func)(uint8_t *str1, uint8_t *str2, uint8_t *str3);
 
+typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
+typedef void * (*memmove_func_t)(void *dest, const void *src, size_t n);
+
 typedef struct {
 	const char *name;
 	const stress_memcpy_func func;
+	const memcpy_func_t memcpy_func;	/* raw memcpy used by the sweep */
+	bool (*supported)(void);
 } stress_memcpy_method_info_t;
 
-typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
-typedef void * (*memmove_func_t)(void *dest, const void *src, size_t n);
+/* source and destination offsets from 64 byte alignment used by the sweep */
+static const struct {
+	const size_t src;
+	const size_t dst;
+} memcpy_sweep_align[] = {
+	{ 0,	0 },
+	{ 1,	0 },
+	{ 0,	1 },
+	{ 33,	7 },
+};
+
+typedef struct {
+	double bytes;		/* total bytes copied */
+	double duration;	/* total time copying */
+} stress_memcpy_sweep_t;
 
 typedef void * (*memcpy_check_func_t)(memcpy_func_t func, void *dest, const void *src, size_t n);
 typedef void * (*memmove_check_func_t)(memmove_func_t func, void *dest, const void *src, size_t n);
@@ -132,6 +160,278 @@ TEST_NAIVE_MEMMOVE(test_naive_memmove_o1, NOINLINE OPTIMIZE1)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o2, NOINLINE OPTIMIZE2)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o3, NOINLINE OPTIMIZE3)
 
+/*
+ *  stress_memcpy_small()
+ *	copy n < 64 bytes using overlapping head and tail loads, all
+ *	loads are done before the stores so this is also memmove safe
+ */
+static inline ALWAYS_INLINE void stress_memcpy_small(uint8_t *d, const uint8_t *s, const size_t n)
+{
+	if (n >= 32) {
+		uint64_t h[4], t[4];
+
+		(void)shim_memcpy(h, s, sizeof(h));
+		(void)shim_memcpy(t, s + n - sizeof(t), sizeof(t));
+		(void)shim_memcpy(d, h, sizeof(h));
+		(void)shim_memcpy(d + n - sizeof(t), t, sizeof(t));
+	} else if (n >= 16) {
+		uint64_t h[2], t[2];
+
+		(void)shim_memcpy(h, s, sizeof(h));
+		(void)shim_memcpy(t, s + n - sizeof(t), sizeof(t));
+		(void)shim_memcpy(d, h, sizeof(h));
+		(void)shim_memcpy(d + n - sizeof(t), t, sizeof(t));
+	} else if (n >= 8) {
+		uint64_t h, t;
+
+		(void)shim_memcpy(&h, s, sizeof(h));
+		(void)shim_memcpy(&t, s + n - sizeof(t), sizeof(t));
+		(void)shim_memcpy(d, &h, sizeof(h));
+		(void)shim_memcpy(d + n - sizeof(t), &t, sizeof(t));
+	} else if (n >= 4) {
+		uint32_t h, t;
+
+		(void)shim_memcpy(&h, s, sizeof(h));
+		(void)shim_memcpy(&t, s + n - sizeof(t), sizeof(t));
+		(void)shim_memcpy(d, &h, sizeof(h));
+		(void)shim_memcpy(d + n - sizeof(t), &t, sizeof(t));
+	} else if (n >= 2) {
+		uint16_t h, t;
+
+		(void)shim_memcpy(&h, s, sizeof(h));
+		(void)shim_memcpy(&t, s + n - sizeof(t), sizeof(t));
+		(void)shim_memcpy(d, &h, sizeof(h));
+		(void)shim_memcpy(d + n - sizeof(t), &t, sizeof(t));
+	} else if (n) {
+		*d = *s;
+	}
+}
+
+#if defined(HAVE_ASM_X86_REP_MOVSB) &&	\
+    !defined(__ILP32__)
+#define HAVE_MEMCPY_REP_MOVSB
+/*
+ *  test_rep_movsb_memcpy()
+ *	rep movsb copy, fast on CPUs with ERMS and for short
+ *	copies on CPUs with FSRM
+ */
+static NOINLINE void *test_rep_movsb_memcpy(void *dest, const void *src, size_t n)
+{
+	void *d = dest;
+
+	__asm__ __volatile__(
+		"rep movsb\n"
+		: "+D" (d),
+		  "+S" (src),
+		  "+c" (n)
+		:
+		: "memory");
+	return dest;
+}
+
+/*
+ *  test_rep_movsb_memmove()
+ *	rep movsb move, overlapping moves to higher addresses
+ *	copy backwards with the direction flag set
+ */
+static NOINLINE void *test_rep_movsb_memmove(void *dest, const void *src, size_t n)
+{
+	void *d;
+
+	if ((uintptr_t)dest - (uintptr_t)src >= n)
+		return test_rep_movsb_memcpy(dest, src, n);
+	if (!n)
+		return dest;
+
+	d = (void *)((uint8_t *)dest + n - 1);
+	src = (const void *)((const uint8_t *)src + n - 1);
+	__asm__ __volatile__(
+		"std\n"
+		"rep movsb\n"
+		"cld\n"
+		: "+D" (d),
+		  "+S" (src),
+		  "+c" (n)
+		:
+		: "memory");
+	return dest;
+}
+
+static bool stress_memcpy_rep_movsb_supported(void)
+{
+	return true;
+}
+#endif
+
+#if defined(HAVE_VECMATH)
+typedef uint8_t stress_memcpy_vec_t __attribute__ ((vector_size(64)));
+
+/*
+ *  STRESS_MEMCPY_VEC()
+ *	64 byte vector copy and move, 4 x unrolled, the remaining
+ *	bytes are copied with stress_memcpy_small; memmove copies
+ *	forwards or backwards depending on the overlap direction
+ */
+#define STRESS_MEMCPY_VEC(isa, attr)						\
+static NOINLINE attr OPTIMIZE3 void *test_## isa ##_memcpy(			\
+	void *dest,								\
+	const void *src,							\
+	size_t n)								\
+{										\
+	register uint8_t *d = (uint8_t *)dest;					\
+	register const uint8_t *s = (const uint8_t *)src;			\
+										\
+	while (n >= 4 * sizeof(stress_memcpy_vec_t)) {				\
+		stress_memcpy_vec_t v0, v1, v2, v3;				\
+										\
+		(void)shim_memcpy(&v0, s + 0 * sizeof(v0), sizeof(v0));	\
+		(void)shim_memcpy(&v1, s + 1 * sizeof(v1), sizeof(v1));	\
+		(void)shim_memcpy(&v2, s + 2 * sizeof(v2), sizeof(v2));	\
+		(void)shim_memcpy(&v3, s + 3 * sizeof(v3), sizeof(v3));	\
+		(void)shim_memcpy(d + 0 * sizeof(v0), &v0, sizeof(v0));	\
+		(void)shim_memcpy(d + 1 * sizeof(v1), &v1, sizeof(v1));	\
+		(void)shim_memcpy(d + 2 * sizeof(v2), &v2, sizeof(v2));	\
+		(void)shim_memcpy(d + 3 * sizeof(v3), &v3, sizeof(v3));	\
+		d += 4 * sizeof(v0);						\
+		s += 4 * sizeof(v0);						\
+		n -= 4 * sizeof(v0);						\
+	}									\
+	while (n >= sizeof(stress_memcpy_vec_t)) {				\
+		stress_memcpy_vec_t v;						\
+										\
+		(void)shim_memcpy(&v, s, sizeof(v));				\
+		(void)shim_memcpy(d, &v, sizeof(v));				\
+		d += sizeof(v);							\
+		s += sizeof(v);							\
+		n -= sizeof(v);							\
+	}									\
+	stress_memcpy_small(d, s, n);						\
+	return dest;								\
+}										\
+										\
+static NOINLINE attr OPTIMIZE3 void *test_## isa ##_memmove(			\
+	void *dest,								\
+	const void *src,							\
+	size_t n)								\
+{										\
+	register uint8_t *d = (uint8_t *)dest;					\
+	register const uint8_t *s = (const uint8_t *)src;			\
+										\
+	if ((uintptr_t)dest - (uintptr_t)src >= n)				\
+		return test_## isa ##_memcpy(dest, src, n);			\
+										\
+	d += n;									\
+	s += n;									\
+	while (n >= sizeof(stress_memcpy_vec_t)) {				\
+		stress_memcpy_vec_t v;						\
+										\
+		d -= sizeof(v);							\
+		s -= sizeof(v);							\
+		n -= sizeof(v);							\
+		(void)shim_memcpy(&v, s, sizeof(v));				\
+		(void)shim_memcpy(d, &v, sizeof(v));				\
+	}									\
+	stress_memcpy_small((uint8_t *)dest, (const uint8_t *)src, n);		\
+	return dest;								\
+}
+
+#define HAVE_MEMCPY_VECTOR
+STRESS_MEMCPY_VEC(vector, )
+
+static bool stress_memcpy_vector_supported(void)
+{
+	return true;
+}
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_TARGET_CLONES_AVX2)
+#define HAVE_MEMCPY_AVX2
+STRESS_MEMCPY_VEC(avx2, __attribute__((target("avx2"))))
+#endif
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+#define HAVE_MEMCPY_AVX512
+STRESS_MEMCPY_VEC(avx512, __attribute__((target("avx512f"))))
+#endif
+#endif
+
+#if defined(HAVE_NT_STORE128)
+#define HAVE_MEMCPY_NT_STORE
+/*
+ *  test_nt_store_memcpy()
+ *	copy with cached loads and non-temporal 128 bit stores that
+ *	bypass the cache, the unaligned destination head and the tail
+ *	are copied with normal stores
+ */
+static NOINLINE OPTIMIZE3 void *test_nt_store_memcpy(void *dest, const void *src, size_t n)
+{
+	register uint8_t *d = (uint8_t *)dest;
+	register const uint8_t *s = (const uint8_t *)src;
+	const size_t head = (sizeof(__uint128_t) - ((uintptr_t)d & (sizeof(__uint128_t) - 1))) &
+				(sizeof(__uint128_t) - 1);
+
+	if (n < head + 4 * sizeof(__uint128_t)) {
+		while (n >= 32) {
+			stress_memcpy_small(d, s, 32);
+			d += 32;
+			s += 32;
+			n -= 32;
+		}
+		stress_memcpy_small(d, s, n);
+		return dest;
+	}
+	stress_memcpy_small(d, s, head);
+	d += head;
+	s += head;
+	n -= head;
+
+	while (n >= 4 * sizeof(__uint128_t)) {
+		__uint128_t v0, v1, v2, v3;
+
+		(void)shim_memcpy(&v0, s + 0 * sizeof(v0), sizeof(v0));
+		(void)shim_memcpy(&v1, s + 1 * sizeof(v1), sizeof(v1));
+		(void)shim_memcpy(&v2, s + 2 * sizeof(v2), sizeof(v2));
+		(void)shim_memcpy(&v3, s + 3 * sizeof(v3), sizeof(v3));
+		stress_nt_store128((__uint128_t *)(d + 0 * sizeof(v0)), v0);
+		stress_nt_store128((__uint128_t *)(d + 1 * sizeof(v1)), v1);
+		stress_nt_store128((__uint128_t *)(d + 2 * sizeof(v2)), v2);
+		stress_nt_store128((__uint128_t *)(d + 3 * sizeof(v3)), v3);
+		d += 4 * sizeof(v0);
+		s += 4 * sizeof(v0);
+		n -= 4 * sizeof(v0);
+	}
+	while (n >= 32) {
+		stress_memcpy_small(d, s, 32);
+		d += 32;
+		s += 32;
+		n -= 32;
+	}
+	stress_memcpy_small(d, s, n);
+	/* non-temporal stores are weakly ordered */
+	shim_mfence();
+	return dest;
+}
+
+/*
+ *  test_nt_store_memmove()
+ *	non-temporal stores for non-overlapping moves, libc
+ *	memmove for overlapping moves
+ */
+static NOINLINE void *test_nt_store_memmove(void *dest, const void *src, size_t n)
+{
+	if (((uintptr_t)dest - (uintptr_t)src >= n) &&
+	    ((uintptr_t)src - (uintptr_t)dest >= n))
+		return test_nt_store_memcpy(dest, src, n);
+	return memmove(dest, src, n);
+}
+
+static bool stress_memcpy_nt_store_supported(void)
+{
+	return true;
+}
+#endif
+
 static NOINLINE void stress_memcpy_libc(
 	uint8_t *str1,
 	uint8_t *str2,
@@ -208,7 +508,7 @@ static NOINLINE void stress_memcpy_builtin(
 #endif
 }
 
-#define STRESS_MEMCPY_NAIVE(method, name, cpy, move)				\
+#define STRESS_MEMCPY_METHOD(method, name, cpy, move)				\
 static NOINLINE void name(							\
 	uint8_t *str1,								\
 	uint8_t *str2,								\
@@ -230,52 +530,68 @@ static NOINLINE void name(							\
 	}									\
 }
 
-STRESS_MEMCPY_NAIVE("naive", stress_memcpy_naive, test_naive_memcpy, test_naive_memmove)
-STRESS_MEMCPY_NAIVE("naive_o0", stress_memcpy_naive_o0, test_naive_memcpy_o0, test_naive_memmove_o0)
-STRESS_MEMCPY_NAIVE("naive_o1", stress_memcpy_naive_o1, test_naive_memcpy_o1, test_naive_memmove_o1)
-STRESS_MEMCPY_NAIVE("naive_o2", stress_memcpy_naive_o2, test_naive_memcpy_o2, test_naive_memmove_o2)
-STRESS_MEMCPY_NAIVE("naive_o3", stress_memcpy_naive_o3, test_naive_memcpy_o3, test_naive_memmove_o3)
+STRESS_MEMCPY_METHOD("naive", stress_memcpy_naive, test_naive_memcpy, test_naive_memmove)
+STRESS_MEMCPY_METHOD("naive_o0", stress_memcpy_naive_o0, test_naive_memcpy_o0, test_naive_memmove_o0)
+STRESS_MEMCPY_METHOD("naive_o1", stress_memcpy_naive_o1, test_naive_memcpy_o1, test_naive_memmove_o1)
+STRESS_MEMCPY_METHOD("naive_o2", stress_memcpy_naive_o2, test_naive_memcpy_o2, test_naive_memmove_o2)
+STRESS_MEMCPY_METHOD("naive_o3", stress_memcpy_naive_o3, test_naive_memcpy_o3, test_naive_memmove_o3)
 
-static NOINLINE void stress_memcpy_all(
-	uint8_t *str1,
-	uint8_t *str2,
-	uint8_t *str3)
-{
-	static int whence;
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+STRESS_MEMCPY_METHOD("rep_movsb", stress_memcpy_rep_movsb, test_rep_movsb_memcpy, test_rep_movsb_memmove)
+#endif
+#if defined(HAVE_MEMCPY_VECTOR)
+STRESS_MEMCPY_METHOD("vector", stress_memcpy_vector, test_vector_memcpy, test_vector_memmove)
+#endif
+#if defined(HAVE_MEMCPY_AVX2)
+STRESS_MEMCPY_METHOD("avx2", stress_memcpy_avx2, test_avx2_memcpy, test_avx2_memmove)
+#endif
+#if defined(HAVE_MEMCPY_AVX512)
+STRESS_MEMCPY_METHOD("avx512", stress_memcpy_avx512, test_avx512_memcpy, test_avx512_memmove)
+#endif
+#if defined(HAVE_MEMCPY_NT_STORE)
+STRESS_MEMCPY_METHOD("nt_store", stress_memcpy_nt_store, test_nt_store_memcpy, test_nt_store_memmove)
+#endif
 
-	switch (whence) {
-	case 0:
-		whence++;
-		stress_memcpy_libc(str1, str2, str3);
-		return;
-	case 1:
-		whence++;
-		stress_memcpy_builtin(str1, str2, str3);
-		return;
-	case 2:
-		whence++;
-		stress_memcpy_naive(str1, str2, str3);
-		return;
-	case 3:
-		whence++;
-		stress_memcpy_naive_o0(str1, str2, str3);
-		return;
-	default:
-		stress_memcpy_naive_o3(str1, str2, str3);
-		whence = 0;
-		return;
-	}
+static bool stress_memcpy_always_supported(void)
+{
+	return true;
 }
 
+#if defined(HAVE_BUILTIN_MEMCPY) &&	\
+    defined(HAVE_BUILTIN_MEMMOVE)
+#define MEMCPY_BUILTIN	stress_builtin_memcpy_wrapper
+#else
+#define MEMCPY_BUILTIN	memcpy
+#endif
+
+/*
+ *  "all" is cycled through by stress_memcpy, it skips
+ *  methods the CPU does not support
+ */
 static const stress_memcpy_method_info_t stress_memcpy_methods[] = {
-	{ "all",	stress_memcpy_all },
-	{ "libc",	stress_memcpy_libc },
-	{ "builtin",	stress_memcpy_builtin },
-	{ "naive",      stress_memcpy_naive },
-	{ "naive_o0",	stress_memcpy_naive_o0 },
-	{ "naive_o1",	stress_memcpy_naive_o1 },
-	{ "naive_o2",	stress_memcpy_naive_o2 },
-	{ "naive_o3",	stress_memcpy_naive_o3 },
+	{ "all",	NULL,			NULL,			stress_memcpy_always_supported },
+	{ "libc",	stress_memcpy_libc,	memcpy,			stress_memcpy_always_supported },
+	{ "builtin",	stress_memcpy_builtin,	MEMCPY_BUILTIN,		stress_memcpy_always_supported },
+	{ "naive",      stress_memcpy_naive,	test_naive_memcpy,	stress_memcpy_always_supported },
+	{ "naive_o0",	stress_memcpy_naive_o0,	test_naive_memcpy_o0,	stress_memcpy_always_supported },
+	{ "naive_o1",	stress_memcpy_naive_o1,	test_naive_memcpy_o1,	stress_memcpy_always_supported },
+	{ "naive_o2",	stress_memcpy_naive_o2,	test_naive_memcpy_o2,	stress_memcpy_always_supported },
+	{ "naive_o3",	stress_memcpy_naive_o3,	test_naive_memcpy_o3,	stress_memcpy_always_supported },
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+	{ "rep_movsb",	stress_memcpy_rep_movsb, test_rep_movsb_memcpy,	stress_memcpy_rep_movsb_supported },
+#endif
+#if defined(HAVE_MEMCPY_VECTOR)
+	{ "vector",	stress_memcpy_vector,	test_vector_memcpy,	stress_memcpy_vector_supported },
+#endif
+#if defined(HAVE_MEMCPY_AVX2)
+	{ "avx2",	stress_memcpy_avx2,	test_avx2_memcpy,	stress_cpu_x86_has_avx2 },
+#endif
+#if defined(HAVE_MEMCPY_AVX512)
+	{ "avx512",	stress_memcpy_avx512,	test_avx512_memcpy,	stress_cpu_x86_has_avx512_f },
+#endif
+#if defined(HAVE_MEMCPY_NT_STORE)
+	{ "nt_store",	stress_memcpy_nt_store,	test_nt_store_memcpy,	stress_memcpy_nt_store_supported },
+#endif
 };
 
 /*
@@ -307,6 +623,229 @@ static void stress_memcpy_set_default(void)
 	stress_set_memcpy_method("all");
 }
 
+/*
+ *  stress_set_memcpy_sweep()
+ *      set memcpy size and alignment sweep mode setting
+ */
+static int stress_set_memcpy_sweep(const char *opt)
+{
+	return stress_set_setting_true("memcpy-sweep", opt);
+}
+
+/*
+ *  stress_memcpy_rate_gbs()
+ *	GB/s of a sweep result, 0.0 if nothing was measured
+ */
+static inline double stress_memcpy_rate_gbs(const stress_memcpy_sweep_t *sweep)
+{
+	return (sweep->duration > 0.0) ? sweep->bytes / (sweep->duration * 1.0E9) : 0.0;
+}
+
+/*
+ *  stress_memcpy_sweep_metric()
+ *	set a sweep metric, all methods give more metrics
+ *	than there are stressor metrics slots so drop the excess
+ */
+static void stress_memcpy_sweep_metric(
+	stress_args_t *args,
+	size_t *metric,
+	char *msg,
+	const stress_memcpy_sweep_t *sweep)
+{
+	if (*metric >= STRESS_STRESSOR_METRICS_MAX)
+		return;
+	stress_metrics_set(args, *metric, msg,
+		stress_memcpy_rate_gbs(sweep), STRESS_GEOMETRIC_MEAN);
+	(*metric)++;
+}
+
+/*
+ *  stress_memcpy_sweep_dump()
+ *	dump GB/s for each copy size and alignment of each method
+ *	and add metrics for some common size classes
+ */
+static void stress_memcpy_sweep_dump(
+	stress_args_t *args,
+	const stress_memcpy_sweep_t *sweep,
+	const size_t *methods,
+	const size_t n_methods,
+	const size_t *sizes,
+	const size_t n_sizes)
+{
+	const size_t n_aligns = SIZEOF_ARRAY(memcpy_sweep_align);
+	size_t i, j, k, metric = 0;
+
+	for (i = 0; i < n_methods; i++) {
+		const char *name = stress_memcpy_methods[methods[i]].name;
+		char buf[128], *ptr;
+
+		/* skip methods the run ended before reaching */
+		if (sweep[i * n_sizes * n_aligns].duration <= 0.0)
+			continue;
+		if (args->instance == 0) {
+			ptr = buf;
+			ptr += snprintf(ptr, sizeof(buf), "%10s", "size");
+			for (k = 0; k < n_aligns; k++)
+				ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), " %4zu/%-3zu",
+					memcpy_sweep_align[k].src, memcpy_sweep_align[k].dst);
+			pr_inf("%s: %s GB/s (source/destination offset):\n", args->name, name);
+			pr_inf("%s: %s\n", args->name, buf);
+		}
+		for (j = 0; j < n_sizes; j++) {
+			const stress_memcpy_sweep_t *row = &sweep[(i * n_sizes + j) * n_aligns];
+			char msg[64];
+
+			if (args->instance == 0) {
+				ptr = buf;
+				ptr += snprintf(ptr, sizeof(buf), "%10zu", sizes[j]);
+				for (k = 0; k < n_aligns; k++)
+					ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), " %8.3f",
+						stress_memcpy_rate_gbs(&row[k]));
+				pr_inf("%s: %s\n", args->name, buf);
+			}
+
+			/* small, page and large copies only, there are too few metrics slots for all */
+			switch (sizes[j]) {
+			case 64:
+				(void)snprintf(msg, sizeof(msg), "%s GB/s at 64B", name);
+				stress_memcpy_sweep_metric(args, &metric, msg, &row[0]);
+				(void)snprintf(msg, sizeof(msg), "%s GB/s at 64B misaligned", name);
+				stress_memcpy_sweep_metric(args, &metric, msg, &row[1]);
+				break;
+			case 4 * KB:
+				(void)snprintf(msg, sizeof(msg), "%s GB/s at 4K", name);
+				stress_memcpy_sweep_metric(args, &metric, msg, &row[0]);
+				break;
+			case MB:
+				(void)snprintf(msg, sizeof(msg), "%s GB/s at 1M", name);
+				stress_memcpy_sweep_metric(args, &metric, msg, &row[0]);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+}
+
+/*
+ *  stress_memcpy_sweep()
+ *	sweep copy sizes from 8 bytes to 64MB, in 1.5 x 2^n steps
+ *	for the small copy sizes, with a range of source and destination
+ *	offsets for the selected method (or every supported method for
+ *	all) and report GB/s for each method, size and alignment
+ */
+static int stress_memcpy_sweep(stress_args_t *args, const size_t memcpy_method)
+{
+	const size_t n_aligns = SIZEOF_ARRAY(memcpy_sweep_align);
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t methods[SIZEOF_ARRAY(stress_memcpy_methods)];
+	size_t sizes[MEMCPY_SWEEP_SIZES];
+	size_t n_methods = 0, n_sizes = 0, max_size, buf_size, size, i, j, k;
+	stress_memcpy_sweep_t *sweep;
+	uint8_t *buf, *src, *dst;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	for (i = 1; i < SIZEOF_ARRAY(stress_memcpy_methods); i++) {
+		if (((memcpy_method == 0) || (memcpy_method == i)) &&
+		    stress_memcpy_methods[i].supported())
+			methods[n_methods++] = i;
+	}
+
+	/* shrink the largest copy size until the buffers can be mapped */
+	for (max_size = MEMCPY_SWEEP_MAX; ; max_size >>= 1) {
+		buf_size = max_size + args->page_size;
+		buf = (uint8_t *)stress_mmap_populate(NULL, 2 * buf_size,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1 , 0);
+		if (buf != MAP_FAILED)
+			break;
+		if (max_size <= MB) {
+			pr_inf_skip("%s: cannot allocate %zu byte sweep buffers, skipping stressor\n",
+				args->name, 2 * buf_size);
+			return EXIT_NO_RESOURCE;
+		}
+	}
+	src = buf;
+	/* offset the destination so source and destination do not 4K alias */
+	dst = buf + buf_size + (2 * ALIGN_SIZE);
+
+	for (size = MEMCPY_SWEEP_MIN; (size <= max_size) && (n_sizes < MEMCPY_SWEEP_SIZES - 1); size <<= 1) {
+		sizes[n_sizes++] = size;
+		if (size < MEMCPY_SWEEP_SMALL)
+			sizes[n_sizes++] = size + (size / 2);
+	}
+
+	sweep = (stress_memcpy_sweep_t *)calloc(n_methods * n_sizes * n_aligns, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		(void)munmap((void *)buf, 2 * buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_rndbuf(src, max_size + ALIGN_SIZE);
+
+	if (args->instance == 0)
+		pr_dbg("%s: sweeping %zu methods, %zu sizes from %zu to %zu bytes, %zu alignments%s%s\n",
+			args->name, n_methods, n_sizes, sizes[0], sizes[n_sizes - 1], n_aligns,
+			stress_cpu_x86_has_erms() ? ", cpu has erms" : "",
+			stress_cpu_x86_has_fsrm() ? ", cpu has fsrm" : "");
+
+	/* spread the run over all the measurements, repeating the sweep if time remains */
+	slice = (double)g_opt_timeout / (double)(n_methods * n_sizes * n_aligns);
+	slice = STRESS_MINIMUM(0.1, STRESS_MAXIMUM(0.001, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_methods) && stress_continue(args); i++) {
+			const memcpy_func_t func = stress_memcpy_methods[methods[i]].memcpy_func;
+
+			for (j = 0; (j < n_sizes) && stress_continue_flag(); j++) {
+				const size_t n = sizes[j];
+				const size_t batch = STRESS_MAXIMUM(1, MEMCPY_SWEEP_BATCH / n);
+
+				for (k = 0; k < n_aligns; k++) {
+					stress_memcpy_sweep_t *cell = &sweep[(i * n_sizes + j) * n_aligns + k];
+					uint8_t *s = src + memcpy_sweep_align[k].src;
+					uint8_t *d = dst + memcpy_sweep_align[k].dst;
+					double t_start, t;
+
+					/* warm up, bring cache sized buffers into the caches and TLBs */
+					if (n < MEMCPY_SWEEP_BATCH)
+						(void)func(d, s, n);
+
+					t_start = stress_time_now();
+					do {
+						register size_t l;
+
+						for (l = 0; l < batch; l++)
+							(void)func(d, s, n);
+						t = stress_time_now();
+						cell->bytes += (double)n * (double)batch;
+					} while ((t - t_start < slice) && stress_continue_flag());
+					cell->duration += t - t_start;
+
+					if (verify && shim_memcmp(d, s, n)) {
+						pr_fail("%s: %s: %zu byte copy with source offset %zu and "
+							"destination offset %zu is different than expected\n",
+							args->name, stress_memcpy_methods[methods[i]].name, n,
+							memcpy_sweep_align[k].src, memcpy_sweep_align[k].dst);
+						rc = EXIT_FAILURE;
+					}
+				}
+			}
+			stress_bogo_inc(args);
+		}
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_memcpy_sweep_dump(args, sweep, methods, n_methods, sizes, n_sizes);
+
+	free(sweep);
+	(void)munmap((void *)buf, 2 * buf_size);
+
+	return rc;
+}
+
 /*
  *  stress_memcpy()
  *	stress memory copies
@@ -314,8 +853,22 @@ static void stress_memcpy_set_default(void)
 static int stress_memcpy(stress_args_t *args)
 {
 	uint8_t *buf, *str1, *str2, *str3;
-	size_t memcpy_method = 0;
-	stress_memcpy_func func;
+	size_t memcpy_method = 0, all = 0;
+	bool memcpy_sweep = false;
+
+	(void)stress_get_setting("memcpy-method", &memcpy_method);
+	(void)stress_get_setting("memcpy-sweep", &memcpy_sweep);
+	if (!stress_memcpy_methods[memcpy_method].supported()) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cpu does not support the %s memcpy method, "
+				"skipping stressor\n", args->name, stress_memcpy_methods[memcpy_method].name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	s_args_name = args->name;
+
+	if (memcpy_sweep)
+		return stress_memcpy_sweep(args, memcpy_method);
 
 	buf = (uint8_t *)stress_mmap_populate(NULL, 3 * MEMCPY_MEMSIZE,
 				PROT_READ | PROT_WRITE,
@@ -329,8 +882,6 @@ static int stress_memcpy(stress_args_t *args)
 	str2 = str1 + MEMCPY_MEMSIZE;
 	str3 = str2 + MEMCPY_MEMSIZE;
 
-	s_args_name = args->name;
-
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		memcpy_check = memcpy_check_func;
 		memmove_check = memmove_check_func;
@@ -339,13 +890,19 @@ static int stress_memcpy(stress_args_t *args)
 		memmove_check = memmove_no_check_func;
 	}
 
-	(void)stress_get_setting("memcpy-method", &memcpy_method);
-	func = stress_memcpy_methods[memcpy_method].func;
 	stress_rndbuf(str3, ALIGN_SIZE);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		func(str1, str2, str3);
+		if (memcpy_method == 0) {
+			/* all, cycle through the supported methods */
+			do {
+				all = (all + 1) % SIZEOF_ARRAY(stress_memcpy_methods);
+			} while (!all || !stress_memcpy_methods[all].supported());
+			stress_memcpy_methods[all].func(str1, str2, str3);
+		} else {
+			stress_memcpy_methods[memcpy_method].func(str1, str2, str3);
+		}
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
@@ -358,6 +915,7 @@ static int stress_memcpy(stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_memcpy_method,	stress_set_memcpy_method },
+	{ OPT_memcpy_sweep,	stress_set_memcpy_sweep },
 	{ 0,			NULL }
 };
 
@@ -23,6 +23,8 @@
 #include "core-madvise.h"
 #include "core-nt-store.h"
 #include "core-out-of-memory.h"
+#include "core-put.h"
+#include "core-pthread.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
 
@@ -36,6 +38,25 @@
 
 #define STRESS_PTR_MINIMUM(a, b)	STRESS_MINIMUM((uintptr_t)a, (uintptr_t)b)
 
+#define MAX_MEMRATE_LATENCY_THREADS	(1024)
+#define MEMRATE_LATENCY_CHUNK		(1 * MB)	/* traffic kernel pass size */
+#define MEMRATE_LATENCY_PROBE_MIN	(64 * MB)	/* minimum pointer chase buffer size */
+#define MEMRATE_LATENCY_LOADS		(16384)		/* pointer chase loads per sample */
+
+#if defined(HAVE_LIB_PTHREAD)
+#define HAVE_MEMRATE_LATENCY
+#endif
+
+/*
+ *  loaded latency steps, as a percentage of the peak bandwidth,
+ *  0% is the idle latency and 100% the unthrottled read traffic
+ */
+static const uint32_t memrate_latency_pct[] = {
+	100, 0, 10, 25, 50, 75, 90
+};
+
+#define MEMRATE_LATENCY_STEPS		(SIZEOF_ARRAY(memrate_latency_pct))
+
 static const stress_help_t help[] = {
 	{ NULL,	"memrate N",		"start N workers exercised memory read/writes" },
 	{ NULL,	"memrate-bytes N",	"size of memory buffer being exercised" },
@@ -43,6 +64,8 @@ static const stress_help_t help[] = {
 	{ NULL,	"memrate-rd-mbs N",	"read rate from buffer in megabytes per second" },
 	{ NULL,	"memrate-wr-mbs N",	"write rate to buffer in megabytes per second" },
 	{ NULL,	"memrate-flush",	"flush cache before each iteration" },
+	{ NULL,	"memrate-latency",	"measure pointer chase latency at stepped read bandwidths" },
+	{ NULL,	"memrate-latency-threads N", "number of read traffic threads in latency mode" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -61,14 +84,24 @@ typedef struct {
 	bool		valid;
 } stress_memrate_stats_t;
 
+/* Loaded latency result of a bandwidth step */
+typedef struct {
+	double		mbs;		/* achieved read bandwidth, MB/sec */
+	double		ns;		/* pointer chase latency, ns per load */
+	bool		valid;
+} stress_memrate_latency_t;
+
 typedef struct {
 	stress_memrate_stats_t *stats;
+	stress_memrate_latency_t *latency;
+	uint32_t memrate_latency_threads;
 	uint64_t memrate_bytes;
 	uint64_t memrate_rd_mbs;
 	uint64_t memrate_wr_mbs;
 	void *start;
 	void *end;
 	bool memrate_flush;
+	bool memrate_latency;
 } stress_memrate_context_t;
 
 typedef uint64_t (*stress_memrate_func_t)(const stress_memrate_context_t *context, bool *valid);
@@ -121,6 +154,21 @@ static int stress_set_memrate_flush(const char *opt)
 	return stress_set_setting_true("memrate-flush", opt);
 }
 
+static int stress_set_memrate_latency(const char *opt)
+{
+	return stress_set_setting_true("memrate-latency", opt);
+}
+
+static int stress_set_memrate_latency_threads(const char *opt)
+{
+	uint32_t memrate_latency_threads;
+
+	memrate_latency_threads = stress_get_uint32(opt);
+	stress_check_range("memrate-latency-threads", (uint64_t)memrate_latency_threads,
+		1, MAX_MEMRATE_LATENCY_THREADS);
+	return stress_set_setting("memrate-latency-threads", TYPE_ID_UINT32, &memrate_latency_threads);
+}
+
 static uint64_t stress_memrate_loops(
 	const stress_memrate_context_t *context,
 	const size_t size)
@@ -991,6 +1039,296 @@ static inline uint64_t stress_memrate_dispatch(
 	return info->func_rate(context, valid);
 }
 
+#if defined(HAVE_MEMRATE_LATENCY)
+/* Read traffic generating thread of the loaded latency mode */
+typedef struct {
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	const stress_memrate_info_t *info; /* read kernel */
+	uint8_t *buf;			/* traffic buffer */
+	size_t buf_size;		/* size of buf */
+	uint64_t rd_mbs;		/* per thread read rate, ~0ULL unthrottled */
+	volatile bool *stop;		/* threads should stop */
+	double kbytes;			/* KB read */
+	double duration;		/* time reading */
+} stress_memrate_traffic_t;
+
+/*
+ *  stress_memrate_traffic()
+ *	read the traffic buffer MEMRATE_LATENCY_CHUNK bytes at a
+ *	time with the read kernel at the rate of the thread
+ */
+static void *stress_memrate_traffic(void *arg)
+{
+	static void *nowt = NULL;
+	stress_memrate_traffic_t *traffic = (stress_memrate_traffic_t *)arg;
+	stress_memrate_context_t context;
+	size_t offset = 0;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	(void)shim_memset(&context, 0, sizeof(context));
+	context.memrate_bytes = MEMRATE_LATENCY_CHUNK;
+	context.memrate_rd_mbs = traffic->rd_mbs;
+	context.memrate_wr_mbs = ~0ULL;
+
+	while (!*traffic->stop) {
+		bool valid = false;
+		uint64_t kbytes;
+		double t;
+
+		context.start = traffic->buf + offset;
+		context.end = (uint8_t *)context.start + MEMRATE_LATENCY_CHUNK;
+		t = stress_time_now();
+		kbytes = stress_memrate_dispatch(traffic->info, &context, &valid);
+		traffic->duration += stress_time_now() - t;
+		traffic->kbytes += (double)kbytes;
+		offset += MEMRATE_LATENCY_CHUNK;
+		if (offset + MEMRATE_LATENCY_CHUNK > traffic->buf_size)
+			offset = 0;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_memrate_chase_init()
+ *	link the cache lines of buf into a single random cycle so
+ *	each load depends on the previous one and defeats the
+ *	hardware prefetchers
+ */
+static void stress_memrate_chase_init(void **buf, const size_t lines)
+{
+	const size_t stride = 64 / sizeof(*buf);
+	size_t i, *perm;
+
+	perm = (size_t *)calloc(lines, sizeof(*perm));
+	if (!perm) {
+		/* fall back to a sequential cycle */
+		for (i = 0; i < lines; i++)
+			buf[i * stride] = &buf[((i + 1) % lines) * stride];
+		return;
+	}
+	for (i = 0; i < lines; i++)
+		perm[i] = i;
+	/* Sattolo's algorithm, a random permutation with a single cycle */
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i);
+		const size_t tmp = perm[i];
+
+		perm[i] = perm[j];
+		perm[j] = tmp;
+	}
+	for (i = 0; i < lines; i++)
+		buf[perm[i] * stride] = &buf[perm[(i + 1) % lines] * stride];
+	free(perm);
+}
+
+/*
+ *  stress_memrate_chase()
+ *	dependent pointer chasing loads, returns the end pointer
+ *	so the loads cannot be optimized away
+ */
+static void * OPTIMIZE3 stress_memrate_chase(void *ptr, const uint32_t loads)
+{
+	register void **p = (void **)ptr;
+	register uint32_t i;
+
+	for (i = 0; i < loads; i += 8) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	return (void *)p;
+}
+
+/*
+ *  stress_memrate_latency_step()
+ *	run the traffic threads at rd_mbs each and measure the
+ *	pointer chase latency for duration seconds, n_threads is
+ *	zero for the idle latency step
+ */
+static int stress_memrate_latency_step(
+	stress_args_t *args,
+	stress_memrate_traffic_t *traffic,
+	const uint32_t n_threads,
+	const uint64_t rd_mbs,
+	void **chase,
+	const double duration,
+	stress_memrate_latency_t *latency)
+{
+	volatile bool stop = false;
+	double t_start, t, chase_dt = 0.0, loads = 0.0, traffic_mbs = 0.0;
+	uint32_t i, started = 0;
+	void *ptr = (void *)chase;
+
+	for (i = 0; i < n_threads; i++) {
+		traffic[i].rd_mbs = rd_mbs;
+		traffic[i].stop = &stop;
+		traffic[i].kbytes = 0.0;
+		traffic[i].duration = 0.0;
+		traffic[i].ret = pthread_create(&traffic[i].pthread, NULL,
+			stress_memrate_traffic, (void *)&traffic[i]);
+		if (traffic[i].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, traffic[i].ret, strerror(traffic[i].ret));
+			break;
+		}
+		started++;
+	}
+
+	t_start = stress_time_now();
+	if (started == n_threads) {
+		do {
+			t = stress_time_now();
+			ptr = stress_memrate_chase(ptr, MEMRATE_LATENCY_LOADS);
+			chase_dt += stress_time_now() - t;
+			loads += (double)MEMRATE_LATENCY_LOADS;
+		} while ((stress_time_now() - t_start < duration) && stress_continue_flag());
+	}
+	stress_void_ptr_put(ptr);
+
+	stop = true;
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(traffic[i].pthread, NULL);
+		if (traffic[i].duration > 0.0)
+			traffic_mbs += traffic[i].kbytes / (traffic[i].duration * KB);
+	}
+	if (started < n_threads)
+		return -1;
+
+	latency->mbs += traffic_mbs;
+	latency->ns += (loads > 0.0) ? STRESS_DBL_NANOSECOND * chase_dt / loads : 0.0;
+	latency->valid = (loads > 0.0);
+	return 0;
+}
+
+/*
+ *  stress_memrate_latency()
+ *	loaded latency, read traffic threads run at stepped rates
+ *	while the pointer chase latency is measured, the first step
+ *	is unthrottled to find the peak bandwidth and the other
+ *	steps are percentages of this peak
+ */
+static int stress_memrate_latency(
+	stress_args_t *args,
+	stress_memrate_context_t *context)
+{
+	const stress_memrate_info_t *info = NULL;
+	stress_memrate_latency_t results[MEMRATE_LATENCY_STEPS];
+	stress_memrate_traffic_t *traffic;
+	const uint32_t n_threads = context->memrate_latency_threads;
+	size_t i, llc_size, cache_line_size, probe_size, traffic_size;
+	uint8_t *traffic_buf;
+	void **chase;
+	uint32_t counts[MEMRATE_LATENCY_STEPS];
+	double slice, peak_mbs = 0.0;
+	int rc = EXIT_SUCCESS;
+
+	for (i = 0; i < memrate_items; i++) {
+		if (!strcmp(memrate_info[i].name, "read64")) {
+			info = &memrate_info[i];
+			break;
+		}
+	}
+	if (!info)
+		return EXIT_NOT_IMPLEMENTED;
+
+	/* the pointer chase buffer must be well beyond the LLC */
+	stress_cpu_cache_get_llc_size(&llc_size, &cache_line_size);
+	probe_size = STRESS_MAXIMUM(llc_size * 4, MEMRATE_LATENCY_PROBE_MIN);
+
+	/* each thread gets a slice of the buffer, a multiple of the chunk size */
+	traffic_size = (size_t)(context->memrate_bytes / n_threads) & ~(MEMRATE_LATENCY_CHUNK - 1);
+	if (traffic_size < MEMRATE_LATENCY_CHUNK)
+		traffic_size = MEMRATE_LATENCY_CHUNK;
+
+	chase = (void **)stress_memrate_mmap(args, probe_size);
+	if (chase == MAP_FAILED)
+		return EXIT_NO_RESOURCE;
+	traffic_buf = (uint8_t *)stress_memrate_mmap(args, traffic_size * n_threads);
+	if (traffic_buf == MAP_FAILED) {
+		(void)munmap((void *)chase, probe_size);
+		return EXIT_NO_RESOURCE;
+	}
+	traffic = (stress_memrate_traffic_t *)calloc(n_threads, sizeof(*traffic));
+	if (!traffic) {
+		pr_inf_skip("%s: cannot allocate thread data, skipping stressor\n", args->name);
+		(void)munmap((void *)traffic_buf, traffic_size * n_threads);
+		(void)munmap((void *)chase, probe_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_memrate_init_data(traffic_buf, traffic_buf + (traffic_size * n_threads));
+	stress_memrate_chase_init(chase, probe_size / 64);
+	for (i = 0; i < n_threads; i++) {
+		traffic[i].info = info;
+		traffic[i].buf = traffic_buf + (i * traffic_size);
+		traffic[i].buf_size = traffic_size;
+	}
+	(void)shim_memset(results, 0, sizeof(results));
+	(void)shim_memset(counts, 0, sizeof(counts));
+
+	/* spread the run over all steps, repeating if time remains */
+	slice = (double)g_opt_timeout / (double)MEMRATE_LATENCY_STEPS;
+	slice = STRESS_MINIMUM(5.0, STRESS_MAXIMUM(0.5, slice));
+
+	if (args->instance == 0)
+		pr_dbg("%s: %" PRIu32 " read traffic threads with %zuK buffers, %zuK pointer chase buffer\n",
+			args->name, n_threads, (size_t)(traffic_size / KB), (size_t)(probe_size / KB));
+
+	do {
+		for (i = 0; (i < MEMRATE_LATENCY_STEPS) && stress_continue(args); i++) {
+			const uint32_t pct = memrate_latency_pct[i];
+			uint64_t rd_mbs;
+
+			if (pct == 100) {
+				rd_mbs = ~0ULL;
+			} else {
+				if (peak_mbs <= 0.0)
+					break;
+				rd_mbs = (uint64_t)((peak_mbs * (double)pct) / (100.0 * (double)n_threads));
+				if (rd_mbs < 1)
+					rd_mbs = 1;
+			}
+			if (stress_memrate_latency_step(args, traffic, pct ? n_threads : 0,
+					rd_mbs, chase, slice, &results[i]) < 0) {
+				rc = EXIT_NO_RESOURCE;
+				goto tidy;
+			}
+			counts[i]++;
+			if ((pct == 100) && (counts[i] == 1))
+				peak_mbs = results[i].mbs;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+
+	/* average over the passes of each step */
+	for (i = 0; i < MEMRATE_LATENCY_STEPS; i++) {
+		if (!results[i].valid || !counts[i])
+			continue;
+		context->latency[i].mbs = results[i].mbs / (double)counts[i];
+		context->latency[i].ns = results[i].ns / (double)counts[i];
+		context->latency[i].valid = true;
+	}
+tidy:
+	free(traffic);
+	(void)munmap((void *)traffic_buf, traffic_size * n_threads);
+	(void)munmap((void *)chase, probe_size);
+
+	return rc;
+}
+#endif
+
 static int stress_memrate_child(stress_args_t *args, void *ctxt)
 {
 	stress_memrate_context_t *context = (stress_memrate_context_t *)ctxt;
@@ -998,6 +1336,11 @@ static int stress_memrate_child(stress_args_t *args, void *ctxt)
 
 	stress_catch_sigill();
 
+#if defined(HAVE_MEMRATE_LATENCY)
+	if (context->memrate_latency)
+		return stress_memrate_latency(args, context);
+#endif
+
 	buffer = stress_memrate_mmap(args, context->memrate_bytes);
 	if (buffer == MAP_FAILED)
 		return EXIT_NO_RESOURCE;
@@ -1057,13 +1400,34 @@ static int stress_memrate(stress_args_t *args)
 	context.memrate_rd_mbs = ~0ULL;
 	context.memrate_wr_mbs = ~0ULL;
 	context.memrate_flush = false;
+	context.memrate_latency = false;
+	context.memrate_latency_threads = 0;
+	context.latency = NULL;
 
 	(void)stress_get_setting("memrate-bytes", &context.memrate_bytes);
 	(void)stress_get_setting("memrate-flush", &context.memrate_flush);
+	(void)stress_get_setting("memrate-latency", &context.memrate_latency);
+	(void)stress_get_setting("memrate-latency-threads", &context.memrate_latency_threads);
 	(void)stress_get_setting("memrate-rd-mbs", &context.memrate_rd_mbs);
 	(void)stress_get_setting("memrate-wr-mbs", &context.memrate_wr_mbs);
 
-	stats_size = memrate_items * sizeof(*context.stats);
+#if !defined(HAVE_MEMRATE_LATENCY)
+	if (context.memrate_latency) {
+		if (args->instance == 0)
+			pr_inf("%s: pthreads not supported, ignoring --memrate-latency\n", args->name);
+		context.memrate_latency = false;
+	}
+#endif
+	if (context.memrate_latency && !context.memrate_latency_threads) {
+		/* all the other CPUs generate traffic for the probe */
+		const int32_t cpus = stress_get_processors_online();
+
+		context.memrate_latency_threads = (cpus > 1) ? (uint32_t)(cpus - 1) : 1;
+	}
+
+	/* the stats and loaded latency results shared with the child */
+	stats_size = memrate_items * sizeof(*context.stats) +
+		     MEMRATE_LATENCY_STEPS * sizeof(*context.latency);
 	stats_size = (stats_size + args->page_size - 1) & ~(args->page_size - 1);
 
 	context.stats = (stress_memrate_stats_t *)stress_mmap_populate(NULL, stats_size,
@@ -1078,6 +1442,9 @@ static int stress_memrate(stress_args_t *args)
 		context.stats[i].kbytes = 0.0;
 		context.stats[i].valid = false;
 	}
+	context.latency = (stress_memrate_latency_t *)(context.stats + memrate_items);
+	for (i = 0; i < MEMRATE_LATENCY_STEPS; i++)
+		context.latency[i].valid = false;
 
 	context.memrate_bytes = (context.memrate_bytes + 1023) & ~(1023ULL);
 	if (args->instance == 0) {
@@ -1087,7 +1454,7 @@ static int stress_memrate(stress_args_t *args)
 		if ((context.memrate_bytes > MB) && (context.memrate_bytes & MB)) {
 			pr_inf("%s: for optimal speed, use multiples of 1 MB for --memrate-bytes\n", args->name);
 		}
-		if (!context.memrate_flush)
+		if (!context.memrate_flush && !context.memrate_latency)
 			pr_inf("%s: cache flushing can be enabled with --memrate-flush option\n", args->name);
 	}
 
@@ -1097,6 +1464,36 @@ static int stress_memrate(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	if (context.memrate_latency) {
+		size_t metric = 0;
+
+		if (args->instance == 0)
+			pr_inf("%s: %8s %12s %12s\n", args->name,
+				"load %", "read MB/s", "latency ns");
+		/* the steps are run peak first, report in order of load */
+		for (i = 1; i <= MEMRATE_LATENCY_STEPS; i++) {
+			const size_t j = i % MEMRATE_LATENCY_STEPS;
+			const stress_memrate_latency_t *latency = &context.latency[j];
+			char tmp[64];
+
+			if (!latency->valid)
+				continue;
+			if (args->instance == 0)
+				pr_inf("%s: %8" PRIu32 " %12.2f %12.2f\n", args->name,
+					memrate_latency_pct[j], latency->mbs, latency->ns);
+			if (memrate_latency_pct[j]) {
+				(void)snprintf(tmp, sizeof(tmp), "MB per sec read at %" PRIu32 "%% load",
+					memrate_latency_pct[j]);
+				stress_metrics_set(args, metric++, tmp, latency->mbs, STRESS_HARMONIC_MEAN);
+			}
+			(void)snprintf(tmp, sizeof(tmp), "ns per load latency at %" PRIu32 "%% load",
+				memrate_latency_pct[j]);
+			stress_metrics_set(args, metric++, tmp, latency->ns, STRESS_GEOMETRIC_MEAN);
+		}
+		(void)munmap((void *)context.stats, stats_size);
+		return rc;
+	}
+
 	pr_block_begin();
 	for (i = 0; i < memrate_items; i++) {
 		if (!context.stats[i].valid)
@@ -1123,6 +1520,8 @@ static int stress_memrate(stress_args_t *args)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_memrate_bytes,	stress_set_memrate_bytes },
 	{ OPT_memrate_flush,	stress_set_memrate_flush },
+	{ OPT_memrate_latency,	stress_set_memrate_latency },
+	{ OPT_memrate_latency_threads, stress_set_memrate_latency_threads },
 	{ OPT_memrate_rd_mbs,	stress_set_memrate_rd_mbs },
 	{ OPT_memrate_wr_mbs,	stress_set_memrate_wr_mbs },
 	{ 0,			NULL }
@@ -41,6 +41,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"memthrash N",		"start N workers thrashing a 16MB memory buffer" },
 	{ NULL,	"memthrash-method M",	"specify memthrash method M, default is all" },
+	{ NULL,	"memthrash-numa-compare", "compare method throughput on the local and farthest NUMA node" },
 	{ NULL,	"memthrash-ops N",	"stop after N memthrash bogo operations" },
 	{ NULL,	NULL,			NULL }
 };
@@ -67,6 +68,7 @@ typedef struct {
 	unsigned long *numa_node_mask;
 	size_t numa_node_mask_size;
 #endif
+	bool numa_compare;	/* --memthrash-numa-compare mode */
 } stress_memthrash_context_t;
 
 typedef void (*stress_memthrash_func_t)(const stress_memthrash_context_t *context, size_t mem_size);
@@ -742,6 +744,15 @@ static int stress_set_memthrash_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_memthrash_numa_compare()
+ *	set the local vs remote NUMA node compare mode
+ */
+static int stress_set_memthrash_numa_compare(const char *opt)
+{
+	return stress_set_setting_true("memthrash-numa-compare", opt);
+}
+
 static void stress_memthrash_find_primes(void)
 {
 	size_t i;
@@ -791,6 +802,153 @@ static void *stress_memthrash_func(void *ctxt)
 	return &nowt;
 }
 
+#if defined(HAVE_MEMTHRASH_NUMA)
+typedef struct {
+	double ops;		/* method calls over the whole buffer */
+	double duration;	/* time spent in the method */
+} stress_memthrash_rate_t;
+
+/*
+ *  stress_memthrash_numa_comparable()
+ *	true if method i is run by the NUMA compare mode, the numa
+ *	method moves pages itself and random and all are not methods
+ */
+static bool stress_memthrash_numa_comparable(const size_t i, const size_t memthrash_method)
+{
+	const stress_memthrash_func_t func = memthrash_methods[i].func;
+
+	if ((memthrash_method != 0) && (memthrash_method != i))
+		return false;
+	/* numa is a target clone, match it by name as its address may not compare equal */
+	return (func != stress_memthrash_all) &&
+	       (func != stress_memthrash_random) &&
+	       strcmp(memthrash_methods[i].name, "numa");
+}
+
+/*
+ *  stress_memthrash_numa_bind()
+ *	bind the buffer to a node and migrate the populated pages
+ */
+static int stress_memthrash_numa_bind(const stress_memthrash_context_t *context, const unsigned long node)
+{
+	(void)shim_memset(context->numa_node_mask, 0, context->numa_node_mask_size);
+	STRESS_SETBIT(context->numa_node_mask, node);
+
+	return (int)shim_mbind(mem, MEM_SIZE, MPOL_BIND, context->numa_node_mask,
+		context->max_numa_nodes, MPOL_MF_MOVE);
+}
+
+/*
+ *  stress_memthrash_numa_compare()
+ *	run each method with the buffer bound to the local node and
+ *	then to the farthest node and report the local to remote
+ *	throughput ratio, patterns with a high ratio are sensitive
+ *	to the cross socket latency
+ */
+static int stress_memthrash_numa_compare(stress_args_t *args, const stress_memthrash_context_t *context)
+{
+	static const char * const sides[] = { "local", "remote" };
+	stress_memthrash_rate_t rates[SIZEOF_ARRAY(memthrash_methods)][2];
+	const size_t memthrash_method = (size_t)(context->memthrash_method - memthrash_methods);
+	unsigned int cpu = 0, node = 0;
+	unsigned long nodes[2];
+	size_t i, n_methods = 0, metric = 0, side;
+	long remote;
+	double slice;
+
+	if ((context->numa_nodes < 1) || !context->numa_node_mask) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no NUMA memory nodes, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (shim_getcpu(&cpu, &node, NULL) < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot determine the NUMA node of the CPU, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+#if defined(HAVE_SCHED_SETAFFINITY)
+	{
+		cpu_set_t mask;
+
+		/* stay on the CPU so local and remote do not change */
+		CPU_ZERO(&mask);
+		CPU_SET((int)cpu, &mask);
+		(void)sched_setaffinity(0, sizeof(mask), &mask);
+	}
+#endif
+	remote = stress_numa_farthest_node((unsigned long)node);
+	if (remote < 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no remote NUMA node for node %u, skipping stressor\n", args->name, node);
+		return EXIT_NO_RESOURCE;
+	}
+	nodes[0] = (unsigned long)node;
+	nodes[1] = (unsigned long)remote;
+
+	for (i = 0; i < SIZEOF_ARRAY(memthrash_methods); i++)
+		n_methods += stress_memthrash_numa_comparable(i, memthrash_method);
+	if (n_methods == 0) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: method '%s' cannot be NUMA compared, skipping stressor\n",
+				args->name, context->memthrash_method->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: comparing %zu methods on CPU %u with local node %u and remote node %ld\n",
+			args->name, n_methods, cpu, node, remote);
+
+	/* spread the run over both nodes for all methods, repeating if time remains */
+	slice = (double)g_opt_timeout / (double)(2 * n_methods);
+	slice = STRESS_MINIMUM(2.0, STRESS_MAXIMUM(0.05, slice));
+	(void)shim_memset(rates, 0, sizeof(rates));
+
+	do {
+		for (side = 0; (side < SIZEOF_ARRAY(sides)) && !thread_terminate && stress_continue(args); side++) {
+			if (stress_memthrash_numa_bind(context, nodes[side]) < 0) {
+				if (args->instance == 0)
+					pr_inf_skip("%s: cannot bind buffer to node %lu, errno=%d (%s), skipping stressor\n",
+						args->name, nodes[side], errno, strerror(errno));
+				return EXIT_NO_RESOURCE;
+			}
+			for (i = 0; (i < SIZEOF_ARRAY(memthrash_methods)) && !thread_terminate && stress_continue(args); i++) {
+				double t_start, t;
+
+				if (!stress_memthrash_numa_comparable(i, memthrash_method))
+					continue;
+				t_start = stress_time_now();
+				do {
+					memthrash_methods[i].func(context, MEM_SIZE);
+					rates[i][side].ops += 1.0;
+					stress_bogo_inc(args);
+					t = stress_time_now();
+				} while ((t - t_start < slice) && !thread_terminate && stress_continue(args));
+				rates[i][side].duration += t - t_start;
+			}
+		}
+	} while (!thread_terminate && stress_continue(args));
+
+	if (args->instance == 0)
+		pr_inf("%s: %-12s %14s %14s %8s (local node %u, remote node %ld)\n",
+			args->name, "method", "local ops/s", "remote ops/s", "ratio", node, remote);
+	for (i = 0; i < SIZEOF_ARRAY(memthrash_methods); i++) {
+		double rate[2], ratio;
+		char msg[64];
+
+		if ((rates[i][0].duration <= 0.0) || (rates[i][1].duration <= 0.0))
+			continue;
+		for (side = 0; side < SIZEOF_ARRAY(sides); side++)
+			rate[side] = rates[i][side].ops / rates[i][side].duration;
+		ratio = (rate[1] > 0.0) ? rate[0] / rate[1] : 0.0;
+		if (args->instance == 0)
+			pr_inf("%s: %-12s %14.3f %14.3f %8.3f\n", args->name,
+				memthrash_methods[i].name, rate[0], rate[1], ratio);
+		(void)snprintf(msg, sizeof(msg), "%s local/remote throughput ratio", memthrash_methods[i].name);
+		stress_metrics_set(args, metric++, msg, ratio, STRESS_GEOMETRIC_MEAN);
+	}
+	return EXIT_SUCCESS;
+}
+#endif
+
 static inline uint32_t stress_memthrash_max(
 	const uint32_t instances,
 	const uint32_t total_cpus)
@@ -835,7 +993,7 @@ static int stress_memthrash_child(stress_args_t *args, void *ctxt)
 	stress_memthrash_context_t *context = (stress_memthrash_context_t *)ctxt;
 	const uint32_t max_threads = context->max_threads;
 	uint32_t i;
-	int ret;
+	int ret, rc = EXIT_SUCCESS;
 	stress_pthread_info_t *pthread_info;
 
 	pthread_info = calloc(max_threads, sizeof(*pthread_info));
@@ -865,6 +1023,13 @@ mmap_retry:
 	}
 	(void)stress_madvise_mergeable(mem, MEM_SIZE);
 
+#if defined(HAVE_MEMTHRASH_NUMA)
+	if (context->numa_compare) {
+		rc = stress_memthrash_numa_compare(args, context);
+		goto reap_mem;
+	}
+#endif
+
 	for (i = 0; i < max_threads; i++) {
 		pthread_info[i].ret = pthread_create(&pthread_info[i].pthread,
 						NULL, stress_memthrash_func,
@@ -901,7 +1066,7 @@ reap_mem:
 	(void)munmap(mem, MEM_SIZE);
 	free(pthread_info);
 
-	return EXIT_SUCCESS;
+	return rc;
 }
 
 
@@ -921,6 +1086,15 @@ static int stress_memthrash(stress_args_t *args)
 	stress_memthrash_find_primes();
 
 	context.args = args;
+	context.numa_compare = false;
+	(void)stress_get_setting("memthrash-numa-compare", &context.numa_compare);
+#if !defined(HAVE_MEMTHRASH_NUMA)
+	if (context.numa_compare) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: NUMA memory binding not supported, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
 	context.total_cpus = (uint32_t)stress_get_processors_online();
 	context.max_threads = stress_memthrash_max(args->num_instances, context.total_cpus);
 #if defined(HAVE_MEMTHRASH_NUMA)
@@ -959,7 +1133,7 @@ static int stress_memthrash(stress_args_t *args)
 	(void)stress_get_setting("memthrash-method", &memthrash_method);
 	context.memthrash_method = &memthrash_methods[memthrash_method];
 
-	if (args->instance == 0) {
+	if ((args->instance == 0) && !context.numa_compare) {
 		pr_dbg("%s: using method '%s'\n", args->name, context.memthrash_method->name);
 		pr_inf("%s: starting %" PRIu32 " thread%s on each of the %"
 			PRIu32 " stressors on a %" PRIu32 " CPU system\n",
@@ -989,6 +1163,7 @@ static int stress_memthrash(stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_memthrash_method,	stress_set_memthrash_method },
+	{ OPT_memthrash_numa_compare, stress_set_memthrash_numa_compare },
 	{ 0,			NULL }
 };
 
@@ -1008,8 +1183,17 @@ static int stress_set_memthrash_method(const char *name)
 	return 0;
 }
 
+static int stress_set_memthrash_numa_compare(const char *opt)
+{
+	(void)opt;
+
+	(void)pr_inf("warning: --memthrash-numa-compare not available on this system\n");
+	return 0;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_memthrash_method,	stress_set_memthrash_method },
+	{ OPT_memthrash_numa_compare, stress_set_memthrash_numa_compare },
 	{ 0,			NULL }
 };
 
@@ -27,22 +27,27 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"mergesort N",		"start N workers merge sorting 32 bit random integers" },
-	{ NULL,	"mergesort-method M",	"select sort method [ method-libc | method-nonlibc" },
+	{ NULL,	"mergesort-method M",	"select sort method [ mergesort-libc | mergesort-nonlibc | mergesort-parallel | mergesort-simd ]" },
 	{ NULL,	"mergesort-ops N",	"stop after N merge sort bogo operations" },
 	{ NULL,	"mergesort-size N",	"number of 32 bit integers to sort" },
+	{ NULL,	"mergesort-threads N",	"number of threads for the mergesort-parallel method" },
 	{ NULL,	NULL,			NULL }
 };
 
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
+static stress_sort_dist_stats_t dist_stats[STRESS_SORT_DIST_MAX];
 
 typedef int (*mergesort_func_t)(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *));
 
 typedef struct {
 	const char *name;
 	const mergesort_func_t mergesort_func;
+	const bool counted;		/* comparator calls are counted */
 } stress_mergesort_method_t;
 
+static uint32_t mergesort_threads;
+
 #define IDX(base, idx, size)	((base) + ((idx) * (size)))
 
 static inline ALWAYS_INLINE void mergesort_copy(uint8_t *RESTRICT p1, uint8_t *RESTRICT p2, register size_t size)
@@ -220,11 +225,40 @@ static int mergesort_nonlibc(
 	return 0;
 }
 
+static void mergesort_nonlibc_chunk(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
+{
+	(void)mergesort_nonlibc(base, nmemb, size, compar);
+}
+
+/*
+ *  mergesort_parallel()
+ *	non-libc mergesort of a chunk per thread followed by parallel merges
+ */
+static int mergesort_parallel(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
+{
+	stress_sort_parallel(base, nmemb, size, compar, mergesort_nonlibc_chunk, mergesort_threads);
+	return 0;
+}
+
+/*
+ *  mergesort_simd()
+ *	vectorised sorting network and merge sort, 32 bit integers only
+ */
+static int mergesort_simd(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *))
+{
+	(void)size;
+
+	stress_sort_int32_simd((int32_t *)base, nmemb, compar);
+	return 0;
+}
+
 static const stress_mergesort_method_t stress_mergesort_methods[] = {
 #if defined(HAVE_LIB_BSD)
-	{ "mergesort-libc",	mergesort },
+	{ "mergesort-libc",	mergesort,		true },
 #endif
-	{ "mergesort-nonlibc",	mergesort_nonlibc },
+	{ "mergesort-nonlibc",	mergesort_nonlibc,	true },
+	{ "mergesort-parallel",	mergesort_parallel,	false },
+	{ "mergesort-simd",	mergesort_simd,		false },
 };
 
 static int stress_set_mergesort_method(const char *opt)
@@ -260,9 +294,24 @@ static int stress_set_mergesort_size(const char *opt)
 	return stress_set_setting("mergesort-size", TYPE_ID_UINT64, &mergesort_size);
 }
 
+/*
+ *  stress_set_mergesort_threads()
+ *	set number of mergesort-parallel threads
+ */
+static int stress_set_mergesort_threads(const char *opt)
+{
+	uint32_t threads;
+
+	threads = stress_get_uint32(opt);
+	stress_check_range("mergesort-threads", (uint64_t)threads,
+		1, STRESS_SORT_THREADS_MAX);
+	return stress_set_setting("mergesort-threads", TYPE_ID_UINT32, &threads);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mergesort_size,	stress_set_mergesort_size },
 	{ OPT_mergesort_method,	stress_set_mergesort_method },
+	{ OPT_mergesort_threads,	stress_set_mergesort_threads },
 	{ 0,			NULL }
 };
 
@@ -296,9 +345,12 @@ static int stress_mergesort(stress_args_t *args)
 	int ret;
 	double rate;
 	NOCLOBBER double duration = 0.0, count = 0.0, sorted = 0.0;
+	NOCLOBBER double libc_rate;
 	mergesort_func_t mergesort_func;
 
 	(void)stress_get_setting("mergesort-method", &mergesort_method);
+	mergesort_threads = stress_sort_threads_default();
+	(void)stress_get_setting("mergesort-threads", &mergesort_threads);
 
 	mergesort_func = stress_mergesort_methods[mergesort_method].mergesort_func;
 	if (args->instance == 0)
@@ -337,12 +389,14 @@ static int stress_mergesort(stress_args_t *args)
 #endif
 
 	stress_sort_data_int32_init(data, n);
+	libc_rate = stress_sort_int32_libc_rate(data, n);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
 		double t;
+		size_t dist;
 
-		stress_sort_data_int32_shuffle(data, n);
+		dist = stress_sort_data_int32_dist(data, n, stress_bogo_get(args));
 
 		stress_sort_compare_reset();
 		t = stress_time_now();
@@ -351,8 +405,11 @@ static int stress_mergesort(stress_args_t *args)
 			pr_fail("%s: mergesort of random data failed: %d (%s)\n",
 				args->name, errno, strerror(errno));
 		} else {
-			duration += stress_time_now() - t;
+			t = stress_time_now() - t;
+			duration += t;
 			count += (double)stress_sort_compare_get();
+			stress_sort_dist_stats_add(dist_stats, dist,
+				(double)stress_sort_compare_get(), n, t);
 			sorted += (double)n;
 
 			if (g_opt_flags & OPT_FLAGS_VERIFY) {
@@ -431,11 +488,24 @@ static int stress_mergesort(stress_args_t *args)
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 tidy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	rate = (duration > 0.0) ? count / duration : 0.0;
-	stress_metrics_set(args, 0, "mergesort comparisons per sec",
+	if (stress_mergesort_methods[mergesort_method].counted) {
+		rate = (duration > 0.0) ? count / duration : 0.0;
+		stress_metrics_set(args, 0, "mergesort comparisons per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "mergesort comparisons per item",
+			count / sorted, STRESS_HARMONIC_MEAN);
+	}
+	rate = (duration > 0.0) ? sorted / duration : 0.0;
+	stress_metrics_set(args, 2, "elements sorted per sec",
 		rate, STRESS_HARMONIC_MEAN);
-	stress_metrics_set(args, 1, "mergesort comparisons per item",
-		count / sorted, STRESS_HARMONIC_MEAN);
+	/* compare the random data sorts with the libc qsort baseline */
+	if ((libc_rate > 0.0) && (dist_stats[STRESS_SORT_DIST_RANDOM].duration > 0.0))
+		stress_metrics_set(args, 3, "speedup over libc qsort",
+			(dist_stats[STRESS_SORT_DIST_RANDOM].sorted /
+			 dist_stats[STRESS_SORT_DIST_RANDOM].duration) / libc_rate,
+			STRESS_GEOMETRIC_MEAN);
+	stress_sort_dist_metrics(args, 4, "mergesort", dist_stats,
+		stress_mergesort_methods[mergesort_method].counted);
 
 	free(data);
 
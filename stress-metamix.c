@@ -132,7 +132,7 @@ static int stress_metamix_file(
 		 *  number in the checksum for read sort ordering
 		 */
 		if (verify)
-			file_info[n].checksum = stress_hash_jenkin(buf, data_len);
+			file_info[n].checksum = stress_hash_crc32c_len(buf, data_len);
 		else
 			file_info[n].checksum = stress_mwc32();
 
@@ -266,7 +266,7 @@ static int stress_metamix_file(
 		}
 
 		if (verify) {
-			checksum = stress_hash_jenkin(buf, data_len);
+			checksum = stress_hash_crc32c_len(buf, data_len);
 			if (checksum != file_info[i].checksum) {
 				pr_fail("%s: read failure, expected checksum 0x%" PRIx32 ", got 0x%" PRIx32 "\n",
 					args->name, file_info[i].checksum, checksum);
@@ -282,7 +282,7 @@ static int stress_metamix_file(
 			ptr = stress_mmap_populate(NULL, args->page_size, PROT_READ, MAP_PRIVATE, fd, file_info[i].offset);
 			if (ptr != MAP_FAILED) {
 				if (verify && (data_len < args->page_size)) {
-					checksum = stress_hash_jenkin(ptr, data_len);
+					checksum = stress_hash_crc32c_len(ptr, data_len);
 					(void)munmap(ptr, args->page_size);
 
 					if (checksum != file_info[i].checksum) {
@@ -337,7 +337,7 @@ static int stress_metamix(stress_args_t *args)
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
-	counter_lock = stress_lock_create();
+	counter_lock = stress_lock_create("metamix-counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -20,10 +20,12 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-mmap.h"
 #include "core-out-of-memory.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_SYS_PRCTL_H)
 #include <sys/prctl.h>
@@ -37,12 +39,19 @@
 #define MAX_MMAP_BYTES		(MAX_MEM_LIMIT)
 #define DEFAULT_MMAP_BYTES	(256 * MB)
 
+#define MIN_MMAP_THREADS	(0)
+#define MAX_MMAP_THREADS	(1024)
+
+#define MMAP_LAT_CYCLES		(64)	/* timed cycles per bogo op */
+#define MMAP_THREADS_SWEEP_MAX	(12)	/* 1, 2, 4 .. 1024 threads */
+
 static const stress_help_t help[] = {
 	{ NULL,	"mmap N",	     "start N workers stressing mmap and munmap" },
 	{ NULL,	"mmap-async",	     "using asynchronous msyncs for file based mmap" },
 	{ NULL,	"mmap-bytes N",	     "mmap and munmap N bytes for each stress iteration" },
 	{ NULL, "mmap-stressful",    "enable most stressful mmap options (and slowest)" },
 	{ NULL,	"mmap-file",	     "mmap onto a file using synchronous msyncs" },
+	{ NULL, "mmap-latency",	     "report mmap, first touch, mprotect and munmap latencies" },
 	{ NULL, "mmap-madvise",	     "enable random madvise on mmap'd region" },
 	{ NULL,	"mmap-mergeable",    "where possible, flag mmap'd pages as mergeable" },
 	{ NULL,	"mmap-mlock",	     "attempt to mlock mmap'd pages" },
@@ -52,6 +61,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"mmap-ops N",	     "stop after N mmap bogo operations" },
 	{ NULL, "mmap-osync",	     "enable O_SYNC on file" },
 	{ NULL,	"mmap-slow-munmap",  "munmap pages inefficiently one at a time" },
+	{ NULL,	"mmap-threads N",    "sweep 1 to N threads mapping and unmapping in one mm" },
 	{ NULL,	"mmap-write-check", "set check value in each page and perform sanity read check" },
 	{ NULL,	NULL,		     NULL }
 };
@@ -71,6 +81,8 @@ typedef struct {
 	bool mmap_mprotect;
 	bool mmap_slow_munmap;
 	bool mmap_write_check;
+	bool mmap_latency;
+	uint32_t mmap_threads;
 	mmap_func_t mmap;
 	size_t mmap_prot_count;
 	int *mmap_prot_perms;
@@ -80,6 +92,26 @@ typedef struct {
 
 #define NO_MEM_RETRIES_MAX	(65536)
 
+enum {
+	STRESS_MMAP_LAT_MMAP = 0,
+	STRESS_MMAP_LAT_TOUCH,
+	STRESS_MMAP_LAT_MPROTECT,
+	STRESS_MMAP_LAT_MUNMAP,
+	STRESS_MMAP_LAT_MAX,
+};
+
+static const char * const mmap_lat_names[STRESS_MMAP_LAT_MAX] = {
+	"mmap",
+	"touch",
+	"mprotect",
+	"munmap",
+};
+
+typedef struct {
+	stress_latency_t lat[STRESS_MMAP_LAT_MAX];	/* latency histograms */
+	uint64_t cycles;				/* map..unmap cycles */
+} stress_mmap_lat_t;
+
 static sigjmp_buf jmp_env;
 static bool jmp_env_set;
 
@@ -306,6 +338,21 @@ static int stress_set_mmap_slow_munmap(const char *opt)
 	return stress_set_setting_true("mmap-slow-munmap", opt);
 }
 
+static int stress_set_mmap_latency(const char *opt)
+{
+	return stress_set_setting_true("mmap-latency", opt);
+}
+
+static int stress_set_mmap_threads(const char *opt)
+{
+	uint32_t mmap_threads;
+
+	mmap_threads = stress_get_uint32(opt);
+	stress_check_range("mmap-threads", (uint64_t)mmap_threads,
+		MIN_MMAP_THREADS, MAX_MMAP_THREADS);
+	return stress_set_setting("mmap-threads", TYPE_ID_UINT32, &mmap_threads);
+}
+
 static int stress_set_mmap_stressful(const char *opt)
 {
 	return stress_set_setting_true("mmap-mergeable", opt) |
@@ -511,6 +558,273 @@ static void stress_mmap_slow_munmap(
 	(void)memset(mapped, 0, pages);
 }
 
+/*
+ *  stress_mmap_lat_add()
+ *	add the time from t_start to t_end to a latency histogram
+ */
+static inline void stress_mmap_lat_add(stress_latency_t *lat, const double t_start, const double t_end)
+{
+	const uint64_t ns = (t_end > t_start) ? (uint64_t)((t_end - t_start) * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(lat, ns);
+}
+
+/*
+ *  stress_mmap_lat_cycle()
+ *	map a page, fault it in, make it read-only and unmap it,
+ *	timing each step. Returns false if the mmap failed.
+ */
+static bool stress_mmap_lat_cycle(stress_mmap_lat_t *lat, const size_t page_size)
+{
+	double t0, t1, t2, t3, t4;
+	volatile uint8_t *ptr;
+
+	t0 = stress_time_now();
+	ptr = (volatile uint8_t *)mmap(NULL, page_size, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	t1 = stress_time_now();
+	if (ptr == MAP_FAILED)
+		return false;
+	*ptr = 0xa5;
+	t2 = stress_time_now();
+#if defined(HAVE_MPROTECT)
+	(void)mprotect((void *)ptr, page_size, PROT_READ);
+#endif
+	t3 = stress_time_now();
+	(void)munmap((void *)ptr, page_size);
+	t4 = stress_time_now();
+
+	stress_mmap_lat_add(&lat->lat[STRESS_MMAP_LAT_MMAP], t0, t1);
+	stress_mmap_lat_add(&lat->lat[STRESS_MMAP_LAT_TOUCH], t1, t2);
+#if defined(HAVE_MPROTECT)
+	stress_mmap_lat_add(&lat->lat[STRESS_MMAP_LAT_MPROTECT], t2, t3);
+#endif
+	stress_mmap_lat_add(&lat->lat[STRESS_MMAP_LAT_MUNMAP], t3, t4);
+	lat->cycles++;
+
+	return true;
+}
+
+/*
+ *  stress_mmap_lat_report()
+ *	dump the latency percentiles and add them as metrics
+ */
+static void stress_mmap_lat_report(stress_args_t *args, const stress_mmap_lat_t *lat)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	size_t j, k, metric = 0;
+
+	if (lat->cycles == 0)
+		return;
+
+	if (args->instance == 0) {
+		pr_inf("%s: %12s %10s %10s %10s %10s\n", args->name, "latency (ns)",
+			mmap_lat_names[0], mmap_lat_names[1], mmap_lat_names[2], mmap_lat_names[3]);
+		for (k = 0; k < SIZEOF_ARRAY(percentiles); k++) {
+			char name[16];
+
+			(void)snprintf(name, sizeof(name), "p%g", percentiles[k]);
+			pr_inf("%s: %12s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+				args->name, name,
+				stress_latency_percentile(&lat->lat[0], percentiles[k]),
+				stress_latency_percentile(&lat->lat[1], percentiles[k]),
+				stress_latency_percentile(&lat->lat[2], percentiles[k]),
+				stress_latency_percentile(&lat->lat[3], percentiles[k]));
+		}
+		pr_inf("%s: %12s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+			args->name, "max", lat->lat[0].max, lat->lat[1].max,
+			lat->lat[2].max, lat->lat[3].max);
+	}
+	for (j = 0; j < STRESS_MMAP_LAT_MAX; j++) {
+		if (!lat->lat[j].count)
+			continue;
+		for (k = 0; k < SIZEOF_ARRAY(percentiles); k++) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "%s latency p%g (ns)", mmap_lat_names[j], percentiles[k]);
+			stress_metrics_set(args, metric++, msg,
+				(double)stress_latency_percentile(&lat->lat[j], percentiles[k]), STRESS_GEOMETRIC_MEAN);
+		}
+	}
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  Threaded mode, --mmap-threads N sweeps 1, 2, 4 .. N threads
+ *  concurrently mapping, faulting, protecting and unmapping pages
+ *  in the one mm to measure mmap_lock (or per-VMA lock) scalability
+ */
+typedef struct {
+	pthread_t		pthread;	/* thread handle */
+	int			ret;		/* pthread_create return */
+	volatile bool		*run;		/* set when all threads are created */
+	volatile bool		*stop;		/* set at the end of the round */
+	size_t			page_size;	/* page size */
+	stress_mmap_lat_t	lat;		/* per thread latencies and cycles */
+} stress_mmap_thread_t;
+
+typedef struct {
+	uint32_t		threads;	/* number of threads */
+	double			duration;	/* total round time */
+	stress_mmap_lat_t	lat;		/* merged thread latencies */
+} stress_mmap_sweep_t;
+
+/*
+ *  stress_mmap_thread()
+ *	map/unmap cycle until told to stop
+ */
+static void *stress_mmap_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_mmap_thread_t *thread = (stress_mmap_thread_t *)arg;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!*thread->run && !*thread->stop)
+		shim_sched_yield();
+
+	while (!*thread->stop) {
+		if (!stress_mmap_lat_cycle(&thread->lat, thread->page_size))
+			shim_sched_yield();
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_mmap_threads_round()
+ *	run n_threads threads for slice seconds, merge the
+ *	thread latencies and cycles into sweep
+ */
+static int stress_mmap_threads_round(
+	stress_args_t *args,
+	stress_mmap_thread_t *thread,
+	stress_mmap_sweep_t *sweep,
+	const double slice)
+{
+	volatile bool run = false, stop = false;
+	size_t i, j, started;
+	double t_start, t_end;
+	int rc = EXIT_SUCCESS;
+
+	for (started = 0; started < (size_t)sweep->threads; started++) {
+		(void)shim_memset(&thread[started], 0, sizeof(thread[started]));
+		thread[started].run = &run;
+		thread[started].stop = &stop;
+		thread[started].page_size = args->page_size;
+		thread[started].ret = pthread_create(&thread[started].pthread, NULL,
+			stress_mmap_thread, (void *)&thread[started]);
+		if (thread[started].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, thread[started].ret, strerror(thread[started].ret));
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+	}
+
+	t_start = stress_time_now();
+	t_end = t_start + slice;
+	run = true;
+	while ((rc == EXIT_SUCCESS) && stress_continue(args)) {
+		const double now = stress_time_now();
+
+		if (now >= t_end)
+			break;
+		(void)shim_usleep((uint64_t)(STRESS_MINIMUM(t_end - now, 0.1) * 1000000.0));
+	}
+	stop = true;
+	for (i = 0; i < started; i++)
+		(void)pthread_join(thread[i].pthread, NULL);
+	sweep->duration += stress_time_now() - t_start;
+
+	for (i = 0; i < started; i++) {
+		for (j = 0; j < STRESS_MMAP_LAT_MAX; j++)
+			stress_latency_merge(&sweep->lat.lat[j], &thread[i].lat.lat[j]);
+		sweep->lat.cycles += thread[i].lat.cycles;
+		stress_bogo_add(args, thread[i].lat.cycles);
+	}
+	return rc;
+}
+
+/*
+ *  stress_mmap_threads()
+ *	sweep over 1, 2, 4 .. mmap_threads threads, repeating
+ *	the sweep until the run completes and report the map/unmap
+ *	cycle rate and latencies for each thread count
+ */
+static int stress_mmap_threads(stress_args_t *args, const uint32_t mmap_threads, const bool mmap_latency)
+{
+	static stress_mmap_sweep_t sweep[MMAP_THREADS_SWEEP_MAX];
+	stress_mmap_thread_t *thread;
+	size_t i, n = 0, metric = 0;
+	double slice;
+	uint32_t t;
+	int rc = EXIT_SUCCESS;
+
+	thread = (stress_mmap_thread_t *)calloc((size_t)mmap_threads, sizeof(*thread));
+	if (!thread) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread structures, skipping stressor\n",
+			args->name, mmap_threads);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+	for (t = 1; (t < mmap_threads) && (n < MMAP_THREADS_SWEEP_MAX - 1); t <<= 1)
+		sweep[n++].threads = t;
+	sweep[n++].threads = mmap_threads;
+
+	slice = (double)g_opt_timeout / (double)n;
+	slice = STRESS_MINIMUM(2.0, STRESS_MAXIMUM(0.1, slice));
+
+	do {
+		for (i = 0; (i < n) && stress_continue(args); i++) {
+			rc = stress_mmap_threads_round(args, thread, &sweep[i], slice);
+			if (rc != EXIT_SUCCESS)
+				goto err;
+		}
+	} while (stress_continue(args));
+
+	for (i = 0; i < n; i++) {
+		const double rate = (sweep[i].duration > 0.0) ? (double)sweep[i].lat.cycles / sweep[i].duration : 0.0;
+		const double rate1 = (sweep[0].duration > 0.0) ? (double)sweep[0].lat.cycles / sweep[0].duration : 0.0;
+		const double scaling = (rate1 > 0.0) ? 100.0 * rate / (rate1 * (double)sweep[i].threads) : 0.0;
+		const double mmap_p99 = (double)stress_latency_percentile(&sweep[i].lat.lat[STRESS_MMAP_LAT_MMAP], 99.0);
+		const double munmap_p99 = (double)stress_latency_percentile(&sweep[i].lat.lat[STRESS_MMAP_LAT_MUNMAP], 99.0);
+		const double touch_p99 = (double)stress_latency_percentile(&sweep[i].lat.lat[STRESS_MMAP_LAT_TOUCH], 99.0);
+		char msg[64];
+
+		if (sweep[i].duration <= 0.0)
+			continue;
+		if (args->instance == 0) {
+			if (i == 0)
+				pr_inf("%s: %7s %14s %14s %8s %12s %12s %12s\n", args->name,
+					"threads", "cycles/sec", "per thread", "scaling",
+					"mmap p99", "touch p99", "munmap p99");
+			pr_inf("%s: %7" PRIu32 " %14.1f %14.1f %7.1f%% %12.0f %12.0f %12.0f\n",
+				args->name, sweep[i].threads, rate, rate / (double)sweep[i].threads,
+				scaling, mmap_p99, touch_p99, munmap_p99);
+		}
+		(void)snprintf(msg, sizeof(msg), "map/unmap cycles per sec, %" PRIu32 " threads", sweep[i].threads);
+		stress_metrics_set(args, metric++, msg, rate, STRESS_GEOMETRIC_MEAN);
+		if (mmap_latency) {
+			(void)snprintf(msg, sizeof(msg), "mmap latency p99 (ns), %" PRIu32 " threads", sweep[i].threads);
+			stress_metrics_set(args, metric++, msg, mmap_p99, STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(msg, sizeof(msg), "munmap latency p99 (ns), %" PRIu32 " threads", sweep[i].threads);
+			stress_metrics_set(args, metric++, msg, munmap_p99, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+err:
+	free(thread);
+
+	return rc;
+}
+#endif
+
 static int stress_mmap_child(stress_args_t *args, void *ctxt)
 {
 	stress_mmap_context_t *context = (stress_mmap_context_t *)ctxt;
@@ -528,9 +842,21 @@ static int stress_mmap_child(stress_args_t *args, void *ctxt)
 	int ret;
 	NOCLOBBER int mask = ~0;
 	static const char mmap_name[] = "stress-mmap";
+	static stress_mmap_lat_t lat;
 
 	VOID_RET(int, stress_sighandler(args->name, SIGBUS, stress_mmap_sighandler, NULL));
 
+	if (context->mmap_threads > 0) {
+#if defined(HAVE_LIB_PTHREAD)
+		return stress_mmap_threads(args, context->mmap_threads, context->mmap_latency);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --mmap-threads needs pthread support, ignoring option\n",
+				args->name);
+#endif
+	}
+	(void)shim_memset(&lat, 0, sizeof(lat));
+
 	mapped = (uint8_t *)mmap(NULL, pages * sizeof(*mapped),
 				PROT_READ | PROT_WRITE,
 				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
@@ -938,10 +1264,21 @@ cleanup:
 			(void)stress_munmap_retry_enomem((void *)buf64, page_size);
 		}
 #endif
+		/*
+		 *  Step #11, timed map, first touch, mprotect and unmap cycles
+		 */
+		if (context->mmap_latency) {
+			for (n = 0; n < MMAP_LAT_CYCLES; n++) {
+				if (!stress_mmap_lat_cycle(&lat, page_size))
+					break;
+			}
+		}
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
 	jmp_env_set = false;
+	if (context->mmap_latency)
+		stress_mmap_lat_report(args, &lat);
 
 	(void)munmap((void *)index, pages * sizeof(*index));
 	(void)munmap((void *)mappings, pages * sizeof(*mappings));
@@ -976,6 +1313,10 @@ static int stress_mmap(stress_args_t *args)
 	context.mmap_mergeable = false;
 	context.mmap_mlock = false;
 	context.mmap_mprotect = false;
+	context.mmap_slow_munmap = false;
+	context.mmap_write_check = false;
+	context.mmap_latency = false;
+	context.mmap_threads = 0;
 	context.flags = MAP_PRIVATE | MAP_ANONYMOUS;
 #if defined(MAP_POPULATE)
 	context.flags |= MAP_POPULATE;
@@ -992,6 +1333,8 @@ static int stress_mmap(stress_args_t *args)
 	(void)stress_get_setting("mmap-mprotect", &context.mmap_mprotect);
 	(void)stress_get_setting("mmap-slow-munmap", &context.mmap_slow_munmap);
 	(void)stress_get_setting("mmap-write-check", &context.mmap_write_check);
+	(void)stress_get_setting("mmap-latency", &context.mmap_latency);
+	(void)stress_get_setting("mmap-threads", &context.mmap_threads);
 
 	for (all_flags = 0, i = 0; i < SIZEOF_ARRAY(mmap_prot); i++)
 		all_flags |= mmap_prot[i];
@@ -1124,6 +1467,7 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mmap_async,	stress_set_mmap_async },
 	{ OPT_mmap_bytes,	stress_set_mmap_bytes },
 	{ OPT_mmap_file,	stress_set_mmap_file },
+	{ OPT_mmap_latency,	stress_set_mmap_latency },
 	{ OPT_mmap_madvise,	stress_set_mmap_madvise },
 	{ OPT_mmap_mergeable,	stress_set_mmap_mergeable },
 	{ OPT_mmap_mlock,	stress_set_mmap_mlock },
@@ -1133,6 +1477,7 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mmap_osync,	stress_set_mmap_osync },
 	{ OPT_mmap_slow_munmap,	stress_set_mmap_slow_munmap },
 	{ OPT_mmap_stressful,	stress_set_mmap_stressful },
+	{ OPT_mmap_threads,	stress_set_mmap_threads },
 	{ OPT_mmap_write_check,	stress_set_mmap_write_check },
 	{ 0,			NULL }
 };
@@ -17,6 +17,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-out-of-memory.h"
 #include "core-put.h"
 
@@ -24,17 +25,50 @@ static const stress_help_t help[] = {
 	{ NULL,	"mmapfiles N",		"start N workers stressing many mmaps and munmaps" },
 	{ NULL,	"mmapfiles-ops N",	"stop after N mmapfiles bogo operations" },
 	{ NULL, "mmapfiles-populate",	"populate memory mappings" },
+	{ NULL, "mmapfiles-read",	"compare mmap, pread and preadv2 read paths over the file set" },
 	{ NULL, "mmapfiles-shared",	"enable shared mappings instead of private mappings" },
 	{ NULL,	NULL,		  	NULL }
 };
 
 #define MMAP_MAX	(512 * 1024)
 
+#define MMAPFILES_READ_FILES_MAX	(4096)
+#define MMAPFILES_READ_BYTES_MAX	(64 * MB)
+#define MMAPFILES_READ_BUF_SIZE		(128 * KB)
+
+enum {
+	MMAPFILES_READ_MMAP = 0,
+	MMAPFILES_READ_MMAP_POPULATE,
+	MMAPFILES_READ_MMAP_SEQ,
+	MMAPFILES_READ_PREAD,
+	MMAPFILES_READ_PREADV2_NOWAIT,
+	MMAPFILES_READ_METHODS,
+};
+
+static const char * const mmapfiles_read_methods[MMAPFILES_READ_METHODS] = {
+	"mmap",
+	"mmap-populate",
+	"mmap-seq",
+	"pread",
+	"preadv2-nowait",
+};
+
 typedef struct {
 	void *addr;
 	size_t len;
 } stress_mapping_t;
 
+typedef struct {
+	char *name;
+	size_t len;
+} stress_mmapfiles_file_t;
+
+typedef struct {
+	double bytes;
+	double duration;
+	double faults;
+} stress_mmapfiles_read_stats_t;
+
 typedef struct {
 	double mmap_page_count;
 	double mmap_count;
@@ -42,6 +76,7 @@ typedef struct {
 	double munmap_page_count;
 	double munmap_count;
 	double munmap_duration;
+	stress_mmapfiles_read_stats_t read[MMAPFILES_READ_METHODS];
 } stress_mmapfile_info_t;
 
 /*
@@ -53,6 +88,15 @@ static int stress_set_mmapfiles_populate(const char *opt)
         return stress_set_setting_true("mmapfiles-populate", opt);
 }
 
+/*
+ *  stress_set_mmapfiles_read()
+ *      set mmapfiles_read flag
+ */
+static int stress_set_mmapfiles_read(const char *opt)
+{
+        return stress_set_setting_true("mmapfiles-read", opt);
+}
+
 /*
  *  stress_set_mmapfiles_shared()
  *      set mmapfiles_shared flag
@@ -64,6 +108,7 @@ static int stress_set_mmapfiles_shared(const char *opt)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mmapfiles_populate,	stress_set_mmapfiles_populate },
+	{ OPT_mmapfiles_read,		stress_set_mmapfiles_read },
 	{ OPT_mmapfiles_shared,		stress_set_mmapfiles_shared },
 	{ 0, 				NULL },
 };
@@ -162,6 +207,253 @@ static size_t stress_mmapfiles_dir(
 	return n_mappings;
 }
 
+/*
+ *  stress_mmapfiles_read_dir()
+ *	gather regular files for the read path comparison, capped
+ *	by file count and total size
+ */
+static size_t stress_mmapfiles_read_dir(
+	const char *path,
+	stress_mmapfiles_file_t *files,
+	size_t n_files,
+	size_t *total)
+{
+	DIR *dir;
+	struct dirent *d;
+
+	dir = opendir(path);
+	if (!dir)
+		return n_files;
+
+	while ((d = readdir(dir)) != NULL) {
+		char filename[PATH_MAX];
+		unsigned char type;
+
+		if (n_files >= MMAPFILES_READ_FILES_MAX)
+			break;
+		if (*total >= MMAPFILES_READ_BYTES_MAX)
+			break;
+		if (!stress_continue_flag())
+			break;
+		if (stress_is_dot_filename(d->d_name))
+			continue;
+		(void)snprintf(filename, sizeof(filename), "%s/%s", path, d->d_name);
+		type = shim_dirent_type(path, d);
+		if (type == SHIM_DT_DIR) {
+			n_files = stress_mmapfiles_read_dir(filename, files, n_files, total);
+		} else if (type == SHIM_DT_REG) {
+			struct stat statbuf;
+			size_t len;
+
+			if (stat(filename, &statbuf) < 0)
+				continue;
+			len = (size_t)statbuf.st_size;
+			if ((len == 0) || (*total + len > MMAPFILES_READ_BYTES_MAX))
+				continue;
+			if (access(filename, R_OK) < 0)
+				continue;
+			files[n_files].name = strdup(filename);
+			if (!files[n_files].name)
+				break;
+			files[n_files].len = len;
+			*total += len;
+			n_files++;
+		}
+	}
+	(void)closedir(dir);
+	return n_files;
+}
+
+/*
+ *  stress_mmapfiles_sum()
+ *	consume all the data so each read path touches every byte
+ */
+static uint64_t OPTIMIZE3 stress_mmapfiles_sum(const uint8_t *ptr, const size_t len)
+{
+	register const uint64_t *ptr64 = (const uint64_t *)ptr;
+	register const uint64_t *end64 = (const uint64_t *)(ptr + (len & ~(size_t)7));
+	register const uint8_t *ptr8;
+	register uint64_t sum = 0;
+
+	while (ptr64 < end64)
+		sum += *ptr64++;
+	for (ptr8 = (const uint8_t *)ptr64; ptr8 < ptr + len; ptr8++)
+		sum += *ptr8;
+	return sum;
+}
+
+/*
+ *  stress_mmapfiles_faults()
+ *	minor + major page faults of this process so far
+ */
+static double stress_mmapfiles_faults(void)
+{
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return (double)usage.ru_minflt + (double)usage.ru_majflt;
+}
+
+/*
+ *  stress_mmapfiles_read_file()
+ *	read all of a file using the given read method
+ */
+static int stress_mmapfiles_read_file(
+	const stress_mmapfiles_file_t *file,
+	const int method,
+	uint8_t *buf,
+	uint64_t *sum)
+{
+	int fd, flags = MAP_PRIVATE;
+	uint8_t *ptr;
+	off_t offset;
+	ssize_t ret;
+
+	fd = open(file->name, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	switch (method) {
+	case MMAPFILES_READ_MMAP_POPULATE:
+#if defined(MAP_POPULATE)
+		flags |= MAP_POPULATE;
+#endif
+		goto do_mmap;
+	case MMAPFILES_READ_MMAP:
+	case MMAPFILES_READ_MMAP_SEQ:
+do_mmap:
+		ptr = (uint8_t *)mmap(NULL, file->len, PROT_READ, flags, fd, 0);
+		if (ptr == MAP_FAILED) {
+			(void)close(fd);
+			return -1;
+		}
+#if defined(MADV_SEQUENTIAL)
+		if (method == MMAPFILES_READ_MMAP_SEQ)
+			(void)shim_madvise((void *)ptr, file->len, MADV_SEQUENTIAL);
+#endif
+		*sum += stress_mmapfiles_sum(ptr, file->len);
+		(void)munmap((void *)ptr, file->len);
+		break;
+	case MMAPFILES_READ_PREADV2_NOWAIT:
+#if defined(HAVE_PREADV2) &&	\
+    defined(RWF_NOWAIT)
+		for (offset = 0; offset < (off_t)file->len; offset += ret) {
+			struct iovec iov;
+
+			iov.iov_base = (void *)buf;
+			iov.iov_len = MMAPFILES_READ_BUF_SIZE;
+			ret = preadv2(fd, &iov, 1, offset, RWF_NOWAIT);
+			if (ret < 0) {
+				/* not in the page cache, fall back to a blocking read */
+				if ((errno != EAGAIN) && (errno != EOPNOTSUPP))
+					break;
+				ret = pread(fd, buf, MMAPFILES_READ_BUF_SIZE, offset);
+			}
+			if (ret <= 0)
+				break;
+			*sum += stress_mmapfiles_sum(buf, (size_t)ret);
+		}
+		break;
+#endif
+	case MMAPFILES_READ_PREAD:
+	default:
+		for (offset = 0; offset < (off_t)file->len; offset += ret) {
+			ret = pread(fd, buf, MMAPFILES_READ_BUF_SIZE, offset);
+			if (ret <= 0)
+				break;
+			*sum += stress_mmapfiles_sum(buf, (size_t)ret);
+		}
+		break;
+	}
+	(void)close(fd);
+	return 0;
+}
+
+/*
+ *  stress_mmapfiles_read()
+ *	read the same file set through each read path and account
+ *	the throughput and page faults per path
+ */
+static int stress_mmapfiles_read(
+	stress_args_t *args,
+	stress_mmapfile_info_t *mmapfile_info,
+	const char * const *dirs,
+	const size_t n_dirs)
+{
+	stress_mmapfiles_file_t *files;
+	uint8_t *buf;
+	size_t i, n_files = 0, total = 0;
+	uint64_t sum = 0;
+	int rc = EXIT_SUCCESS;
+
+	files = (stress_mmapfiles_file_t *)calloc((size_t)MMAPFILES_READ_FILES_MAX, sizeof(*files));
+	if (!files) {
+		pr_inf_skip("%s: cannot allocate file list, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)stress_mmap_populate(NULL, MMAPFILES_READ_BUF_SIZE,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte read buffer, skipping stressor\n",
+			args->name, (size_t)MMAPFILES_READ_BUF_SIZE);
+		free(files);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, MMAPFILES_READ_BUF_SIZE, "read-buffer");
+
+	for (i = 0; i < n_dirs; i++) {
+		/* pseudo files in /sys and /proc do not have a meaningful data path */
+		if (!strcmp(dirs[i], "/sys") || !strcmp(dirs[i], "/proc"))
+			continue;
+		n_files = stress_mmapfiles_read_dir(dirs[i], files, n_files, &total);
+	}
+	if (n_files == 0) {
+		pr_inf_skip("%s: no readable files found, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: read path comparison using %zu files, %.2f MB\n",
+			args->name, n_files, (double)total / (double)MB);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		int method;
+
+		for (method = 0; method < MMAPFILES_READ_METHODS; method++) {
+			stress_mmapfiles_read_stats_t *stats = &mmapfile_info->read[method];
+			double t, faults, bytes = 0.0;
+
+			faults = stress_mmapfiles_faults();
+			t = stress_time_now();
+			for (i = 0; i < n_files; i++) {
+				if (stress_mmapfiles_read_file(&files[i], method, buf, &sum) == 0)
+					bytes += (double)files[i].len;
+				if (!stress_continue_flag())
+					break;
+			}
+			stats->duration += stress_time_now() - t;
+			stats->faults += stress_mmapfiles_faults() - faults;
+			stats->bytes += bytes;
+			stress_bogo_inc(args);
+			if (!stress_continue(args))
+				break;
+		}
+	} while (stress_continue(args));
+
+	stress_uint64_put(sum);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+tidy:
+	(void)munmap((void *)buf, MMAPFILES_READ_BUF_SIZE);
+	for (i = 0; i < n_files; i++)
+		free(files[i].name);
+	free(files);
+	return rc;
+}
+
 static int stress_mmapfiles_child(stress_args_t *args, void *context)
 {
 	size_t idx = 0;
@@ -182,9 +474,14 @@ static int stress_mmapfiles_child(stress_args_t *args, void *context)
 	};
 	bool mmap_populate = false;
 	bool mmap_shared = false;
+	bool mmap_read = false;
 
 	(void)stress_get_setting("mmapfiles-populate", &mmap_populate);
 	(void)stress_get_setting("mmapfiles-shared", &mmap_shared);
+	(void)stress_get_setting("mmapfiles-read", &mmap_read);
+
+	if (mmap_read)
+		return stress_mmapfiles_read(args, mmapfile_info, dirs, SIZEOF_ARRAY(dirs));
 
 	mappings = calloc((size_t)MMAP_MAX, sizeof(*mappings));
 	if (!mappings) {
@@ -241,7 +538,9 @@ static int stress_mmapfiles(stress_args_t *args)
 {
 	stress_mmapfile_info_t *mmapfile_info;
 	int ret;
+	size_t i;
 	double metric;
+	bool mmap_read = false;
 
 	mmapfile_info = (stress_mmapfile_info_t *)stress_mmap_populate(NULL, sizeof(*mmapfile_info),
 				PROT_READ | PROT_WRITE,
@@ -259,9 +558,29 @@ static int stress_mmapfiles(stress_args_t *args)
 	mmapfile_info->munmap_page_count = 0.0;
 	mmapfile_info->munmap_count = 0.0;
 	mmapfile_info->munmap_duration = 0.0;
+	(void)shim_memset(mmapfile_info->read, 0, sizeof(mmapfile_info->read));
+
+	(void)stress_get_setting("mmapfiles-read", &mmap_read);
 
 	ret = stress_oomable_child(args, (void *)mmapfile_info, stress_mmapfiles_child, STRESS_OOMABLE_NORMAL);
 
+	if (mmap_read) {
+		for (i = 0; i < MMAPFILES_READ_METHODS; i++) {
+			const stress_mmapfiles_read_stats_t *stats = &mmapfile_info->read[i];
+			const double mbytes = stats->bytes / (double)MB;
+			char str[64];
+
+			metric = (stats->duration > 0.0) ? (stats->bytes / (double)GB) / stats->duration : 0.0;
+			(void)snprintf(str, sizeof(str), "%s GB per sec", mmapfiles_read_methods[i]);
+			stress_metrics_set(args, i * 2, str, metric, STRESS_HARMONIC_MEAN);
+			metric = (mbytes > 0.0) ? stats->faults / mbytes : 0.0;
+			(void)snprintf(str, sizeof(str), "%s faults per MB", mmapfiles_read_methods[i]);
+			stress_metrics_set(args, (i * 2) + 1, str, metric, STRESS_GEOMETRIC_MEAN);
+		}
+		(void)munmap((void *)mmapfile_info, sizeof(*mmapfile_info));
+		return ret;
+	}
+
 	metric = (mmapfile_info->mmap_duration > 0.0) ? mmapfile_info->mmap_count / mmapfile_info->mmap_duration : 0.0;
 	stress_metrics_set(args, 0, "file mmaps per sec ", metric, STRESS_HARMONIC_MEAN);
 	metric = (mmapfile_info->munmap_duration > 0.0) ? mmapfile_info->munmap_count / mmapfile_info->munmap_duration : 0.0;
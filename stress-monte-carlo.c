@@ -22,6 +22,7 @@
 #include "core-asm-x86.h"
 #include "core-asm-ppc64.h"
 #include "core-cpu.h"
+#include "core-target-clones.h"
 
 /* Don't use HAVE_ASM_X86_RDRAND for now, it is too slow */
 #undef HAVE_ASM_X86_RDRAND
@@ -31,6 +32,7 @@ typedef struct {
 	double	(*rand)(void);
 	void	(*seed)(void);
 	bool	(*supported)(void);
+	void	(*fill)(double *buf);	/* multi-lane batch fill, NULL = use rand */
 } stress_monte_carlo_rand_info_t;
 
 typedef struct {
@@ -47,7 +49,7 @@ typedef struct {
 static const stress_help_t help[] = {
 	{ NULL,	"monte-carlo N",	"start N workers performing monte-carlo computations" },
 	{ NULL,	"monte-carlo-ops N",	"stop after N monte-carlo operations" },
-	{ NULL, "monte-carlo-rand R",	"select random number generator [ all | drand48 | getrandom | lcg | pcg32 | mwc32 | mwc64 | random | xorshift ]" },
+	{ NULL, "monte-carlo-rand R",	"select random number generator [ all | drand48 | getrandom | lcg | pcg32 | philox4x32 | mwc32 | mwc64 | random | xorshift | xorshift128p ]" },
 	{ NULL,	"monte-carlo-samples N","specify number of samples for each computation" },
 	{ NULL,	"monte-carlo-method M",	"select computation method [ pi | e | exp | sin | sqrt ]" },
 	{ NULL,	NULL,			NULL }
@@ -270,34 +272,326 @@ static bool stress_mc_supported(void)
 	return true;
 }
 
+#if defined(HAVE_VECMATH)
+/*
+ *  multi-lane generators, these fill a batch of samples per call
+ *  using 8 lane vectors so the per-sample call overhead goes away
+ */
+#define HAVE_MC_BATCH
+#define STRESS_MC_LANES		(8)
+#define STRESS_MC_BATCH		(1024)	/* multiple of 4 x STRESS_MC_LANES */
+
+typedef uint64_t stress_mc_v8u64_t __attribute__ ((vector_size(STRESS_MC_LANES * sizeof(uint64_t))));
+typedef double stress_mc_v8f64_t __attribute__ ((vector_size(STRESS_MC_LANES * sizeof(double))));
+
+/*
+ *  put 52 random bits into the mantissa of 1.0 <= x < 2.0 and
+ *  return x - 1.0, avoids a u64 to double conversion that is
+ *  not vectorizable on many targets
+ */
+#define STRESS_MC_U52_TO_DOUBLE(u52)	\
+	((stress_mc_v8f64_t)((u52) | 0x3ff0000000000000ULL) - 1.0)
+
+static stress_mc_v8u64_t stress_mc_xorshift128p_s0 = {
+	0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL, 0x2545f4914f6cdd1dULL,
+	0xf761bb789a2436c9ULL, 0x5851f42d4c957f2dULL, 0x14057b7ef767814fULL, 0xda942042e4dd58b5ULL,
+};
+static stress_mc_v8u64_t stress_mc_xorshift128p_s1 = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL,
+};
+
+/*
+ *  stress_mc_xorshift128p_fill()
+ *	8 independent lanes of Vigna's xorshift128+
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_mc_xorshift128p_fill(double *buf)
+{
+	register stress_mc_v8u64_t s0 = stress_mc_xorshift128p_s0;
+	register stress_mc_v8u64_t s1 = stress_mc_xorshift128p_s1;
+	stress_mc_v8f64_t *ptr = (stress_mc_v8f64_t *)buf;
+	const stress_mc_v8f64_t *end = (stress_mc_v8f64_t *)(buf + STRESS_MC_BATCH);
+
+	while (ptr < end) {
+		register stress_mc_v8u64_t x = s0;
+		register const stress_mc_v8u64_t y = s1;
+
+		s0 = y;
+		x ^= x << 23;
+		s1 = x ^ y ^ (x >> 17) ^ (y >> 26);
+		*ptr++ = STRESS_MC_U52_TO_DOUBLE((s1 + y) >> 12);
+	}
+	stress_mc_xorshift128p_s0 = s0;
+	stress_mc_xorshift128p_s1 = s1;
+}
+
+static void stress_mc_xorshift128p_seed(void)
+{
+	size_t i;
+
+	for (i = 0; i < STRESS_MC_LANES; i++) {
+		stress_mc_xorshift128p_s0[i] = stress_mwc64() | 1;
+		stress_mc_xorshift128p_s1[i] = stress_mwc64();
+	}
+}
+
+#define PHILOX_M0	(0xd2511f53ULL)
+#define PHILOX_M1	(0xcd9e8d57ULL)
+#define PHILOX_W0	(0x9e3779b9UL)
+#define PHILOX_W1	(0xbb67ae85UL)
+#define PHILOX_MASK	(0xffffffffULL)
+
+static uint64_t stress_mc_philox_counter;
+static uint32_t stress_mc_philox_key[2] = { 0xa4093822UL, 0x299f31d0UL };
+
+/*
+ *  stress_mc_philox4x32_block()
+ *	Salmon et al. Philox4x32-10 counter based generator on 8 counters
+ *	at once, each lane holds a 32 bit word in a 64 bit element so the
+ *	32 x 32 -> 64 bit multiplies map onto vector multiplies
+ */
+static inline ALWAYS_INLINE void stress_mc_philox4x32_block(
+	stress_mc_v8u64_t c[4],
+	const uint32_t key[2])
+{
+	register uint32_t k0 = key[0], k1 = key[1];
+	register int r;
+
+	for (r = 0; r < 10; r++) {
+		/* masking lets the compiler use 32 x 32 -> 64 bit multiplies */
+		const stress_mc_v8u64_t p0 = (c[0] & PHILOX_MASK) * PHILOX_M0;
+		const stress_mc_v8u64_t p1 = (c[2] & PHILOX_MASK) * PHILOX_M1;
+
+		c[0] = (p1 >> 32) ^ c[1] ^ (uint64_t)k0;
+		c[1] = p1 & PHILOX_MASK;
+		c[2] = (p0 >> 32) ^ c[3] ^ (uint64_t)k1;
+		c[3] = p0 & PHILOX_MASK;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+}
+
+/*
+ *  stress_mc_philox4x32_fill()
+ *	four 32 bit random words per counter, eight counters per block
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_mc_philox4x32_fill(double *buf)
+{
+	static const stress_mc_v8u64_t lanes = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	register uint64_t counter = stress_mc_philox_counter;
+	stress_mc_v8f64_t *ptr = (stress_mc_v8f64_t *)buf;
+	const stress_mc_v8f64_t *end = (stress_mc_v8f64_t *)(buf + STRESS_MC_BATCH);
+
+	while (ptr < end) {
+		const stress_mc_v8u64_t ctr = counter + lanes;
+		stress_mc_v8u64_t c[4];
+
+		c[0] = ctr & PHILOX_MASK;
+		c[1] = ctr >> 32;
+		c[2] = c[0] ^ c[0];
+		c[3] = c[2];
+		stress_mc_philox4x32_block(c, stress_mc_philox_key);
+
+		/* 32 random bits in the top of the 52 bit mantissa */
+		*ptr++ = STRESS_MC_U52_TO_DOUBLE(c[0] << 20);
+		*ptr++ = STRESS_MC_U52_TO_DOUBLE(c[1] << 20);
+		*ptr++ = STRESS_MC_U52_TO_DOUBLE(c[2] << 20);
+		*ptr++ = STRESS_MC_U52_TO_DOUBLE(c[3] << 20);
+		counter += STRESS_MC_LANES;
+	}
+	stress_mc_philox_counter = counter;
+}
+
+static void stress_mc_philox4x32_seed(void)
+{
+	stress_mc_philox_counter = 0;
+	stress_mc_philox_key[0] = stress_mwc32();
+	stress_mc_philox_key[1] = stress_mwc32();
+}
+#endif
+
 static const stress_monte_carlo_rand_info_t rand_info[] = {
-	{ "all",	NULL,				NULL,				stress_mc_supported },
+	{ "all",	NULL,				NULL,				stress_mc_supported,	NULL },
 #if defined(HAVE_ARC4RANDOM)
-	{ "arc4",	stress_mc_arc4_rand,		stress_mc_no_seed,		stress_mc_supported },
+	{ "arc4",	stress_mc_arc4_rand,		stress_mc_no_seed,		stress_mc_supported,	NULL },
 #endif
 #if defined(STRESS_ARCH_PPC64) &&	\
     defined(HAVE_ASM_PPC64_DARN)
-	{ "darn",	stress_mc_darn_rand,		stress_mc_no_seed,		stress_mc_darn_supported },
+	{ "darn",	stress_mc_darn_rand,		stress_mc_no_seed,		stress_mc_darn_supported,	NULL },
 #endif
 #if defined(HAVE_DRAND48)
-	{ "drand48",	stress_mc_drand48_rand,		stress_mc_drand48_seed,		stress_mc_supported },
+	{ "drand48",	stress_mc_drand48_rand,		stress_mc_drand48_seed,		stress_mc_supported,	NULL },
 #endif
 #if defined(HAVE_GETRANDOM) &&	\
     !defined(__sun__)
-	{ "getrandom",	stress_mc_getrandom_rand,	stress_mc_no_seed,		stress_mc_supported },
+	{ "getrandom",	stress_mc_getrandom_rand,	stress_mc_no_seed,		stress_mc_supported,	NULL },
 #endif
-	{ "lcg",	stress_mc_lcg_rand,		stress_mc_lcg_seed,		stress_mc_supported },
-	{ "pcg32",	stress_mc_pcg32_rand,		stress_mc_pcg32_seed,		stress_mc_supported },
-	{ "mwc32",	stress_mc_mwc32_rand,		stress_mc_mwc_seed,		stress_mc_supported },
-	{ "mwc64",	stress_mc_mwc64_rand,		stress_mc_mwc_seed,		stress_mc_supported },
-	{ "random",	stress_mc_random_rand,		stress_mc_random_seed,		stress_mc_supported },
+	{ "lcg",	stress_mc_lcg_rand,		stress_mc_lcg_seed,		stress_mc_supported,	NULL },
+#if defined(HAVE_MC_BATCH)
+	{ "philox4x32",	NULL,				stress_mc_philox4x32_seed,	stress_mc_supported,	stress_mc_philox4x32_fill },
+#endif
+	{ "pcg32",	stress_mc_pcg32_rand,		stress_mc_pcg32_seed,		stress_mc_supported,	NULL },
+	{ "mwc32",	stress_mc_mwc32_rand,		stress_mc_mwc_seed,		stress_mc_supported,	NULL },
+	{ "mwc64",	stress_mc_mwc64_rand,		stress_mc_mwc_seed,		stress_mc_supported,	NULL },
+	{ "random",	stress_mc_random_rand,		stress_mc_random_seed,		stress_mc_supported,	NULL },
 #if defined(STRESS_ARCH_X86) &&	\
     defined(HAVE_ASM_X86_RDRAND)
-	{ "rdrand",	stress_mc_rdrand_rand,		stress_mc_no_seed,		stress_mc_rdrand_supported },
+	{ "rdrand",	stress_mc_rdrand_rand,		stress_mc_no_seed,		stress_mc_rdrand_supported,	NULL },
+#endif
+	{ "xorshift",	stress_mc_xorshift_rand,	stress_mc_xorshift_seed,	stress_mc_supported,	NULL },
+#if defined(HAVE_MC_BATCH)
+	{ "xorshift128p", NULL,				stress_mc_xorshift128p_seed,	stress_mc_supported,	stress_mc_xorshift128p_fill },
 #endif
-	{ "xorshift",	stress_mc_xorshift_rand,	stress_mc_xorshift_seed,	stress_mc_supported },
 };
 
+#if defined(HAVE_MC_BATCH)
+static double ALIGN64 stress_mc_batch_buf[STRESS_MC_BATCH];
+
+/*
+ *  stress_monte_carlo_pi_batch()
+ *	compute pi based on area of a circle, batched samples,
+ *	first half of a batch are x, second half are y values
+ */
+static double OPTIMIZE3 OPTIMIZE_FAST_MATH stress_monte_carlo_pi_batch(
+	const stress_monte_carlo_rand_info_t *info,
+	const uint32_t samples)
+{
+	register uint64_t pi_count = 0;
+	register uint32_t i = samples;
+	const double *x = stress_mc_batch_buf;
+	const double *y = stress_mc_batch_buf + (STRESS_MC_BATCH / 2);
+
+	while (i > 0) {
+		register uint32_t j;
+		register const uint32_t n = STRESS_MINIMUM(i, STRESS_MC_BATCH / 2);
+
+		info->fill(stress_mc_batch_buf);
+		for (j = 0; j < n; j++)
+			pi_count += ((x[j] * x[j]) + (y[j] * y[j]) <= 1.0);
+		i -= n;
+		if (!stress_continue_flag())
+			break;
+	}
+	return ((double)pi_count) * 4.0 / (double)(samples - i);
+}
+
+/*
+ *  stress_monte_carlo_e_batch
+ *	Euler's number e, batched samples
+ */
+static double OPTIMIZE3 stress_monte_carlo_e_batch(
+	const stress_monte_carlo_rand_info_t *info,
+	const uint32_t samples)
+{
+	register uint64_t count = 0;
+	register uint32_t i = samples;
+	register size_t idx = STRESS_MC_BATCH;
+
+	while (i > 0) {
+		register uint32_t j;
+		register const uint32_t n = STRESS_MINIMUM(i, 16384);
+
+		for (j = 0; j < n; j++) {
+			double sum = 0.0;
+
+			while (sum < 1.0)  {
+				if (UNLIKELY(idx >= STRESS_MC_BATCH)) {
+					info->fill(stress_mc_batch_buf);
+					idx = 0;
+				}
+				sum += stress_mc_batch_buf[idx++];
+				count++;
+			}
+		}
+		i -= j;
+		if (!stress_continue_flag())
+			break;
+	}
+	return (double)count / (double)(samples - i);
+}
+
+/*
+ *  stress_monte_carlo_sin_batch()
+ *	integral of sin(x) for x = 0 to pi, batched samples
+ */
+static double OPTIMIZE3 OPTIMIZE_FAST_MATH stress_monte_carlo_sin_batch(
+	const stress_monte_carlo_rand_info_t *info,
+	const uint32_t samples)
+{
+	register uint32_t i = samples;
+	double sum = 0.0;
+
+	while (i > 0) {
+		register uint32_t j;
+		register const uint32_t n = STRESS_MINIMUM(i, STRESS_MC_BATCH);
+
+		info->fill(stress_mc_batch_buf);
+		for (j = 0; j < n; j++)
+			sum += sin(stress_mc_batch_buf[j] * M_PI);
+		i -= n;
+		if (!stress_continue_flag())
+			break;
+	}
+	return M_PI * (double)sum / (double)(samples - i);
+}
+
+/*
+ *  stress_monte_carlo_exp_batch()
+ *	integral of exp(x * x) for x = 0..1, batched samples
+ */
+static double OPTIMIZE3 OPTIMIZE_FAST_MATH stress_monte_carlo_exp_batch(
+	const stress_monte_carlo_rand_info_t *info,
+	const uint32_t samples)
+{
+	register uint32_t i = samples;
+	double sum = 0.0;
+
+	while (i > 0) {
+		register uint32_t j;
+		register const uint32_t n = STRESS_MINIMUM(i, STRESS_MC_BATCH);
+
+		info->fill(stress_mc_batch_buf);
+		for (j = 0; j < n; j++) {
+			const double x = stress_mc_batch_buf[j];
+
+			sum += exp(x * x);
+		}
+		i -= n;
+		if (!stress_continue_flag())
+			break;
+	}
+	return (double)sum / (double)(samples - i);
+}
+
+/*
+ *  stress_monte_carlo_sqrt_batch()
+ *	integral of sqrt(1 + (x * x * x * x)) for x = 0..1, batched samples
+ */
+static double OPTIMIZE3 OPTIMIZE_FAST_MATH stress_monte_carlo_sqrt_batch(
+	const stress_monte_carlo_rand_info_t *info,
+	const uint32_t samples)
+{
+	register uint32_t i = samples;
+	double sum = 0.0;
+
+	while (i > 0) {
+		register uint32_t j;
+		register const uint32_t n = STRESS_MINIMUM(i, STRESS_MC_BATCH);
+
+		info->fill(stress_mc_batch_buf);
+		for (j = 0; j < n; j++) {
+			const double x = stress_mc_batch_buf[j];
+
+			sum += sqrt(1.0 + (x * x * x * x));
+		}
+		i -= n;
+		if (!stress_continue_flag())
+			break;
+	}
+	return (double)sum / (double)(samples - i);
+}
+#endif
+
 /*
  *  stress_monte_carlo_pi()
  *	compute pi based on area of a circle
@@ -309,6 +603,11 @@ static double OPTIMIZE3 stress_monte_carlo_pi(
 	register uint64_t pi_count = 0;
 	register uint32_t i = samples;
 
+#if defined(HAVE_MC_BATCH)
+	if (info->fill)
+		return stress_monte_carlo_pi_batch(info, samples);
+#endif
+
 	while (i > 0) {
 		register uint32_t j;
 		register const uint32_t n = (i > 16384) ? 16384 : (i & 16383);
@@ -339,6 +638,11 @@ static double OPTIMIZE3 stress_monte_carlo_e(
 	register uint64_t count = 0;
 	register uint32_t i = samples;
 
+#if defined(HAVE_MC_BATCH)
+	if (info->fill)
+		return stress_monte_carlo_e_batch(info, samples);
+#endif
+
 	while (i > 0) {
 		register uint32_t j;
 		register const uint32_t n = (i > 16384) ? 16384 : (i & 16383);
@@ -369,6 +673,11 @@ static double OPTIMIZE3 stress_monte_carlo_sin(
 	register uint32_t i = samples;
 	double sum = 0.0;
 
+#if defined(HAVE_MC_BATCH)
+	if (info->fill)
+		return stress_monte_carlo_sin_batch(info, samples);
+#endif
+
 	while (i > 0) {
 		register uint32_t j;
 		register const uint32_t n = (i > 16384) ? 16384 : (i & 16383);
@@ -395,6 +704,11 @@ static double OPTIMIZE3 stress_monte_carlo_exp(
 	register uint32_t i = samples;
 	double sum = 0.0;
 
+#if defined(HAVE_MC_BATCH)
+	if (info->fill)
+		return stress_monte_carlo_exp_batch(info, samples);
+#endif
+
 	while (i > 0) {
 		register uint32_t j;
 		register const uint32_t n = (i > 16384) ? 16384 : (i & 16383);
@@ -422,6 +736,11 @@ static double OPTIMIZE3 stress_monte_carlo_sqrt(
 	register uint32_t i = samples;
 	double sum = 0.0;
 
+#if defined(HAVE_MC_BATCH)
+	if (info->fill)
+		return stress_monte_carlo_sqrt_batch(info, samples);
+#endif
+
 	while (i > 0) {
 		register uint32_t j;
 		register const uint32_t n = (i > 16384) ? 16384 : (i & 16383);
@@ -604,19 +923,41 @@ static int stress_monte_carlo(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	for (idx = 0, i = 1; i < METHODS_MAX; i++) {
-		for (j = 1; j < RANDS_MAX; j++) {
+	if ((monte_carlo_method == 0) && (monte_carlo_rand == 0)) {
+		/*
+		 *  too many method and generator combinations for the
+		 *  metrics slots, report each generator over all methods
+		 */
+		for (idx = 0, j = 1; j < RANDS_MAX; j++) {
+			double count = 0.0, duration = 0.0;
 			char buf[64];
 
-			if (metrics[i][j].duration > 0.0) {
-				const double rate = metrics[i][j].count / metrics[i][j].duration;
-
-				(void)snprintf(buf, sizeof(buf), "samples/sec, %s using %s",
-					stress_monte_carlo_methods[i].name, rand_info[j].name);
-				stress_metrics_set(args, idx, buf, rate, STRESS_GEOMETRIC_MEAN);
+			for (i = 1; i < METHODS_MAX; i++) {
+				count += metrics[i][j].count;
+				duration += metrics[i][j].duration;
+			}
+			if (duration > 0.0) {
+				(void)snprintf(buf, sizeof(buf), "samples/sec, all methods using %s",
+					rand_info[j].name);
+				stress_metrics_set(args, idx, buf, count / duration, STRESS_GEOMETRIC_MEAN);
 				idx++;
 			}
 		}
+	} else {
+		for (idx = 0, i = 1; i < METHODS_MAX; i++) {
+			for (j = 1; j < RANDS_MAX; j++) {
+				char buf[64];
+
+				if (metrics[i][j].duration > 0.0) {
+					const double rate = metrics[i][j].count / metrics[i][j].duration;
+
+					(void)snprintf(buf, sizeof(buf), "samples/sec, %s using %s",
+						stress_monte_carlo_methods[i].name, rand_info[j].name);
+					stress_metrics_set(args, idx, buf, rate, STRESS_GEOMETRIC_MEAN);
+					idx++;
+				}
+			}
+		}
 	}
 
 	if (args->instance == 0) {
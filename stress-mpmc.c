@@ -0,0 +1,811 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-asm-arm.h"
+#include "core-asm-x86.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-pthread.h"
+
+#define MIN_MPMC_SIZE		(16)
+#define MAX_MPMC_SIZE		(1024 * 1024)
+#define DEFAULT_MPMC_SIZE	(1024)
+
+#define MIN_MPMC_THREADS	(1)
+#define MAX_MPMC_THREADS	(32)
+#define DEFAULT_MPMC_THREADS	(16)
+
+static const stress_help_t help[] = {
+	{ NULL,	"mpmc N",		"start N workers exercising lock-free MPMC queues" },
+	{ NULL,	"mpmc-method M",	"select queue: all, ring or list" },
+	{ NULL,	"mpmc-ops N",		"stop after N bogo queue operations" },
+	{ NULL,	"mpmc-size N",		"number of ring queue slots, rounded up to a power of 2" },
+	{ NULL,	"mpmc-threads N",	"maximum number of producers and of consumers" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const mpmc_method_names[] = {
+	"all",
+	"ring",
+	"list",
+};
+
+static int stress_set_mpmc_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(mpmc_method_names); i++) {
+		if (!strcmp(mpmc_method_names[i], opt))
+			return stress_set_setting("mpmc-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "mpmc-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(mpmc_method_names); i++)
+		(void)fprintf(stderr, " %s", mpmc_method_names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_mpmc_size(const char *opt)
+{
+	uint32_t mpmc_size;
+
+	mpmc_size = stress_get_uint32(opt);
+	stress_check_range("mpmc-size", (uint64_t)mpmc_size,
+		MIN_MPMC_SIZE, MAX_MPMC_SIZE);
+	return stress_set_setting("mpmc-size", TYPE_ID_UINT32, &mpmc_size);
+}
+
+static int stress_set_mpmc_threads(const char *opt)
+{
+	uint32_t mpmc_threads;
+
+	mpmc_threads = stress_get_uint32(opt);
+	stress_check_range("mpmc-threads", (uint64_t)mpmc_threads,
+		MIN_MPMC_THREADS, MAX_MPMC_THREADS);
+	return stress_set_setting("mpmc-threads", TYPE_ID_UINT32, &mpmc_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_mpmc_method,	stress_set_mpmc_method },
+	{ OPT_mpmc_size,	stress_set_mpmc_size },
+	{ OPT_mpmc_threads,	stress_set_mpmc_threads },
+	{ 0,			NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_FETCH_ADD)
+
+#define MPMC_LIST_CHUNK_SHIFT	(12)
+#define MPMC_LIST_CHUNK		(1U << MPMC_LIST_CHUNK_SHIFT)	/* nodes per chunk */
+#define MPMC_LIST_CHUNKS_MAX	(1024)		/* up to 4M queued nodes */
+#define MPMC_LAT_SAMPLE		(64)		/* time one in N operations */
+#define MPMC_PRODUCER_SHIFT	(40)		/* value is producer << 40 | seq */
+
+/* Vyukov bounded MPMC ring cell */
+typedef struct {
+	uint64_t seq;
+	uint64_t value;
+} stress_mpmc_cell_t;
+
+/* Vyukov bounded MPMC ring */
+typedef struct {
+	stress_mpmc_cell_t *cells;
+	uint64_t mask;
+	uint64_t enqueue_pos ALIGN64;
+	uint64_t dequeue_pos ALIGN64;
+} stress_mpmc_ring_t;
+
+/*
+ *  Michael-Scott queue node, links are node indices tagged with
+ *  a modification count in the top 32 bits to avoid ABA when
+ *  nodes are recycled through the free list
+ */
+typedef struct {
+	uint64_t next;			/* tagged queue link */
+	uint64_t free_next;		/* tagged free list link */
+	uint64_t value;
+} stress_mpmc_node_t;
+
+/* Michael-Scott unbounded linked queue */
+typedef struct {
+	stress_mpmc_node_t *chunks[MPMC_LIST_CHUNKS_MAX];
+	uint32_t n_chunks;
+	pthread_mutex_t grow_lock;
+	uint64_t head ALIGN64;
+	uint64_t tail ALIGN64;
+	uint64_t free_top ALIGN64;
+} stress_mpmc_list_t;
+
+/* per thread state */
+typedef struct {
+	stress_pthread_args_t pargs;
+	pthread_t pthread;
+	uint32_t id;			/* producer or consumer number */
+	bool producer;
+	uint64_t ops;			/* successful enqueues or dequeues */
+	uint64_t cas_fails;		/* failed compare and swaps */
+	uint64_t stalls;		/* queue full or empty */
+	uint64_t order_errors;		/* per-producer FIFO order violations */
+	uint64_t last[MAX_MPMC_THREADS];/* last sequence seen per producer */
+	stress_latency_t latency;	/* sampled per op latency */
+} stress_mpmc_thread_t;
+
+typedef struct stress_mpmc stress_mpmc_t;
+
+typedef struct {
+	const char *name;
+	int (*init)(stress_mpmc_t *mpmc);
+	void (*reset)(stress_mpmc_t *mpmc);
+	bool (*enqueue)(stress_mpmc_t *mpmc, stress_mpmc_thread_t *t, const uint64_t value);
+	bool (*dequeue)(stress_mpmc_t *mpmc, stress_mpmc_thread_t *t, uint64_t *value);
+	void (*deinit)(stress_mpmc_t *mpmc);
+} stress_mpmc_method_t;
+
+struct stress_mpmc {
+	stress_args_t *args;
+	const stress_mpmc_method_t *method;
+	uint32_t ring_size;
+	stress_mpmc_ring_t ring;
+	stress_mpmc_list_t *list;
+	volatile bool start;
+	volatile bool stop;
+};
+
+/* results of one queue, producer and consumer count */
+typedef struct {
+	const stress_mpmc_method_t *method;
+	uint32_t producers;
+	uint32_t consumers;
+	uint64_t ops;
+	uint64_t cas_fails;
+	double duration;
+	stress_latency_t latency;
+	bool failed;
+} stress_mpmc_result_t;
+
+/*
+ *  stress_mpmc_relax()
+ *	spin wait hint, yield now and again so a preempted
+ *	thread can make progress when threads outnumber CPUs
+ */
+static inline void ALWAYS_INLINE stress_mpmc_relax(uint64_t *stalls)
+{
+#if defined(HAVE_ASM_X86_PAUSE)
+	stress_asm_x86_pause();
+#elif defined(HAVE_ASM_ARM_YIELD)
+	stress_asm_arm_yield();
+#endif
+	if (UNLIKELY((++(*stalls) & 63) == 0))
+		(void)shim_sched_yield();
+}
+
+/*
+ *  stress_mpmc_now_ns()
+ *	monotonic time in nanoseconds, stress_time_now() is wall
+ *	clock time in a double which cannot resolve short queue ops
+ */
+static inline uint64_t ALWAYS_INLINE stress_mpmc_now_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+static int stress_mpmc_ring_init(stress_mpmc_t *mpmc)
+{
+	stress_mpmc_ring_t *ring = &mpmc->ring;
+
+	ring->cells = (stress_mpmc_cell_t *)calloc((size_t)mpmc->ring_size, sizeof(*ring->cells));
+	if (!ring->cells)
+		return -1;
+	ring->mask = (uint64_t)mpmc->ring_size - 1;
+	return 0;
+}
+
+static void stress_mpmc_ring_reset(stress_mpmc_t *mpmc)
+{
+	stress_mpmc_ring_t *ring = &mpmc->ring;
+	uint64_t i;
+
+	for (i = 0; i <= ring->mask; i++)
+		ring->cells[i].seq = i;
+	ring->enqueue_pos = 0;
+	ring->dequeue_pos = 0;
+}
+
+static bool stress_mpmc_ring_enqueue(stress_mpmc_t *mpmc, stress_mpmc_thread_t *t, const uint64_t value)
+{
+	stress_mpmc_ring_t *ring = &mpmc->ring;
+	stress_mpmc_cell_t *cell;
+	uint64_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+
+	for (;;) {
+		int64_t diff;
+
+		cell = &ring->cells[pos & ring->mask];
+		diff = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+			t->cas_fails++;
+		} else if (diff < 0) {
+			return false;	/* full */
+		} else {
+			pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+	cell->value = value;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static bool stress_mpmc_ring_dequeue(stress_mpmc_t *mpmc, stress_mpmc_thread_t *t, uint64_t *value)
+{
+	stress_mpmc_ring_t *ring = &mpmc->ring;
+	stress_mpmc_cell_t *cell;
+	uint64_t pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+
+	for (;;) {
+		int64_t diff;
+
+		cell = &ring->cells[pos & ring->mask];
+		diff = (int64_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&ring->dequeue_pos, &pos, pos + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+			t->cas_fails++;
+		} else if (diff < 0) {
+			return false;	/* empty */
+		} else {
+			pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+		}
+	}
+	*value = cell->value;
+	__atomic_store_n(&cell->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static void stress_mpmc_ring_deinit(stress_mpmc_t *mpmc)
+{
+	free(mpmc->ring.cells);
+}
+
+#define MPMC_IDX(tagged)		((uint32_t)((tagged) & 0xffffffffULL))
+#define MPMC_TAG(tagged)		((uint32_t)((tagged) >> 32))
+#define MPMC_TAGGED(idx, tag)		(((uint64_t)(tag) << 32) | (uint64_t)(idx))
+
+/*
+ *  stress_mpmc_list_node()
+ *	map a node index, 1 upwards, to the node
+ */
+static inline stress_mpmc_node_t *stress_mpmc_list_node(stress_mpmc_list_t *list, const uint32_t idx)
+{
+	const uint32_t i = idx - 1;
+
+	return &list->chunks[i >> MPMC_LIST_CHUNK_SHIFT][i & (MPMC_LIST_CHUNK - 1)];
+}
+
+/*
+ *  stress_mpmc_list_free()
+ *	push a node on the free list
+ */
+static void stress_mpmc_list_free(stress_mpmc_list_t *list, const uint32_t idx)
+{
+	stress_mpmc_node_t *node = stress_mpmc_list_node(list, idx);
+	uint64_t top = __atomic_load_n(&list->free_top, __ATOMIC_ACQUIRE);
+
+	do {
+		__atomic_store_n(&node->free_next, MPMC_TAGGED(MPMC_IDX(top), 0), __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&list->free_top, &top,
+			MPMC_TAGGED(idx, MPMC_TAG(top) + 1), true,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+}
+
+/*
+ *  stress_mpmc_list_grow()
+ *	add a chunk of nodes to the free list, false when the
+ *	queue has reached its maximum size
+ */
+static bool stress_mpmc_list_grow(stress_mpmc_list_t *list)
+{
+	stress_mpmc_node_t *chunk;
+	uint32_t i, base;
+
+	(void)pthread_mutex_lock(&list->grow_lock);
+	if (MPMC_IDX(__atomic_load_n(&list->free_top, __ATOMIC_ACQUIRE)) != 0) {
+		/* another thread grew the list */
+		(void)pthread_mutex_unlock(&list->grow_lock);
+		return true;
+	}
+	if (list->n_chunks >= MPMC_LIST_CHUNKS_MAX) {
+		(void)pthread_mutex_unlock(&list->grow_lock);
+		return false;
+	}
+	chunk = (stress_mpmc_node_t *)calloc(MPMC_LIST_CHUNK, sizeof(*chunk));
+	if (!chunk) {
+		(void)pthread_mutex_unlock(&list->grow_lock);
+		return false;
+	}
+	__atomic_store_n(&list->chunks[list->n_chunks], chunk, __ATOMIC_RELEASE);
+	base = (list->n_chunks * MPMC_LIST_CHUNK) + 1;
+	list->n_chunks++;
+	(void)pthread_mutex_unlock(&list->grow_lock);
+
+	for (i = 0; i < MPMC_LIST_CHUNK; i++)
+		stress_mpmc_list_free(list, base + i);
+	return true;
+}
+
+/*
+ *  stress_mpmc_list_alloc()
+ *	pop a node off the free list, 0 if the queue is at its limit
+ */
+static uint32_t stress_mpmc_list_alloc(stress_mpmc_list_t *list, stress_mpmc_thread_t *t)
+{
+	for (;;) {
+		uint64_t top = __atomic_load_n(&list->free_top, __ATOMIC_ACQUIRE);
+
+		while (MPMC_IDX(top) != 0) {
+			const stress_mpmc_node_t *node = stress_mpmc_list_node(list, MPMC_IDX(top));
+			const uint64_t next = __atomic_load_n(&node->free_next, __ATOMIC_RELAXED);
+
+			if (__atomic_compare_exchange_n(&list->free_top, &top,
+					MPMC_TAGGED(MPMC_IDX(next), MPMC_TAG(top) + 1), true,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				return MPMC_IDX(top);
+			t->cas_fails++;
+		}
+		if (!stress_mpmc_list_grow(list))
+			return 0;
+	}
+}
+
+static int stress_mpmc_list_init(stress_mpmc_t *mpmc)
+{
+	mpmc->list = (stress_mpmc_list_t *)calloc(1, sizeof(*mpmc->list));
+	if (!mpmc->list)
+		return -1;
+	if (pthread_mutex_init(&mpmc->list->grow_lock, NULL)) {
+		free(mpmc->list);
+		mpmc->list = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+static void stress_mpmc_list_reset(stress_mpmc_t *mpmc)
+{
+	stress_mpmc_list_t *list = mpmc->list;
+	stress_mpmc_thread_t t;
+	stress_mpmc_node_t *dummy;
+	uint32_t i, idx;
+
+	/* all threads are idle, put every node back on the free list */
+	list->free_top = 0;
+	for (i = list->n_chunks * MPMC_LIST_CHUNK; i > 0; i--)
+		stress_mpmc_list_free(list, i);
+
+	(void)shim_memset(&t, 0, sizeof(t));
+	idx = stress_mpmc_list_alloc(list, &t);
+	dummy = stress_mpmc_list_node(list, idx);
+	dummy->next = MPMC_TAGGED(0, MPMC_TAG(dummy->next) + 1);
+	list->head = MPMC_TAGGED(idx, 0);
+	list->tail = MPMC_TAGGED(idx, 0);
+}
+
+static bool stress_mpmc_list_enqueue(stress_mpmc_t *mpmc, stress_mpmc_thread_t *t, const uint64_t value)
+{
+	stress_mpmc_list_t *list = mpmc->list;
+	const uint32_t idx = stress_mpmc_list_alloc(list, t);
+	stress_mpmc_node_t *node;
+	uint64_t tail;
+
+	if (!idx)
+		return false;	/* at the maximum queue size */
+	node = stress_mpmc_list_node(list, idx);
+	node->value = value;
+	__atomic_store_n(&node->next, MPMC_TAGGED(0, MPMC_TAG(node->next) + 1), __ATOMIC_RELAXED);
+
+	for (;;) {
+		stress_mpmc_node_t *tail_node;
+		uint64_t next;
+
+		tail = __atomic_load_n(&list->tail, __ATOMIC_ACQUIRE);
+		tail_node = stress_mpmc_list_node(list, MPMC_IDX(tail));
+		next = __atomic_load_n(&tail_node->next, __ATOMIC_ACQUIRE);
+		if (tail != __atomic_load_n(&list->tail, __ATOMIC_ACQUIRE))
+			continue;
+		if (MPMC_IDX(next) == 0) {
+			if (__atomic_compare_exchange_n(&tail_node->next, &next,
+					MPMC_TAGGED(idx, MPMC_TAG(next) + 1), false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+				break;
+			t->cas_fails++;
+		} else {
+			/* tail is lagging, help move it on */
+			(void)__atomic_compare_exchange_n(&list->tail, &tail,
+				MPMC_TAGGED(MPMC_IDX(next), MPMC_TAG(tail) + 1), false,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		}
+	}
+	(void)__atomic_compare_exchange_n(&list->tail, &tail,
+		MPMC_TAGGED(idx, MPMC_TAG(tail) + 1), false,
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	return true;
+}
+
+static bool stress_mpmc_list_dequeue(stress_mpmc_t *mpmc, stress_mpmc_thread_t *t, uint64_t *value)
+{
+	stress_mpmc_list_t *list = mpmc->list;
+	uint64_t head;
+
+	for (;;) {
+		uint64_t tail, next;
+		stress_mpmc_node_t *head_node;
+
+		head = __atomic_load_n(&list->head, __ATOMIC_ACQUIRE);
+		tail = __atomic_load_n(&list->tail, __ATOMIC_ACQUIRE);
+		head_node = stress_mpmc_list_node(list, MPMC_IDX(head));
+		next = __atomic_load_n(&head_node->next, __ATOMIC_ACQUIRE);
+		if (head != __atomic_load_n(&list->head, __ATOMIC_ACQUIRE))
+			continue;
+		if (MPMC_IDX(head) == MPMC_IDX(tail)) {
+			if (MPMC_IDX(next) == 0)
+				return false;	/* empty */
+			(void)__atomic_compare_exchange_n(&list->tail, &tail,
+				MPMC_TAGGED(MPMC_IDX(next), MPMC_TAG(tail) + 1), false,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+		} else {
+			/* read before the CAS, the node may be recycled after it */
+			const uint64_t val = __atomic_load_n(&stress_mpmc_list_node(list, MPMC_IDX(next))->value,
+				__ATOMIC_RELAXED);
+
+			if (__atomic_compare_exchange_n(&list->head, &head,
+					MPMC_TAGGED(MPMC_IDX(next), MPMC_TAG(head) + 1), false,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				*value = val;
+				break;
+			}
+			t->cas_fails++;
+		}
+	}
+	/* the old dummy node can now be recycled */
+	stress_mpmc_list_free(list, MPMC_IDX(head));
+	return true;
+}
+
+static void stress_mpmc_list_deinit(stress_mpmc_t *mpmc)
+{
+	stress_mpmc_list_t *list = mpmc->list;
+	uint32_t i;
+
+	if (!list)
+		return;
+	for (i = 0; i < list->n_chunks; i++)
+		free(list->chunks[i]);
+	(void)pthread_mutex_destroy(&list->grow_lock);
+	free(list);
+}
+
+static const stress_mpmc_method_t stress_mpmc_methods[] = {
+	{ "ring",	stress_mpmc_ring_init, stress_mpmc_ring_reset,
+			stress_mpmc_ring_enqueue, stress_mpmc_ring_dequeue,
+			stress_mpmc_ring_deinit },
+	{ "list",	stress_mpmc_list_init, stress_mpmc_list_reset,
+			stress_mpmc_list_enqueue, stress_mpmc_list_dequeue,
+			stress_mpmc_list_deinit },
+};
+
+static stress_mpmc_t *stress_mpmc_ctxt;
+
+/*
+ *  stress_mpmc_thread()
+ *	enqueue or dequeue until told to stop, timing one in
+ *	MPMC_LAT_SAMPLE operations and checking that each
+ *	producer's values are dequeued in FIFO order
+ */
+static void *stress_mpmc_thread(void *arg)
+{
+	stress_mpmc_thread_t *t = (stress_mpmc_thread_t *)arg;
+	stress_mpmc_t *mpmc = stress_mpmc_ctxt;
+	const stress_mpmc_method_t *method = mpmc->method;
+	const uint64_t value_base = (uint64_t)t->id << MPMC_PRODUCER_SHIFT;
+	const uint64_t seq_mask = (1ULL << MPMC_PRODUCER_SHIFT) - 1;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!mpmc->start)
+		shim_sched_yield();
+
+	while (!mpmc->stop) {
+		const bool timed = ((t->ops & (MPMC_LAT_SAMPLE - 1)) == 0);
+		const uint64_t t_start = timed ? stress_mpmc_now_ns() : 0;
+		uint64_t value = 0;
+
+		if (t->producer) {
+			if (!method->enqueue(mpmc, t, value_base | t->ops)) {
+				stress_mpmc_relax(&t->stalls);
+				continue;
+			}
+		} else {
+			uint64_t producer, seq;
+
+			if (!method->dequeue(mpmc, t, &value)) {
+				stress_mpmc_relax(&t->stalls);
+				continue;
+			}
+			producer = value >> MPMC_PRODUCER_SHIFT;
+			seq = value & seq_mask;
+			if (producer < MAX_MPMC_THREADS) {
+				if ((t->last[producer] != UINT64_MAX) && (seq <= t->last[producer]))
+					t->order_errors++;
+				t->last[producer] = seq;
+			} else {
+				t->order_errors++;
+			}
+		}
+		if (timed)
+			stress_latency_add(&t->latency, stress_mpmc_now_ns() - t_start);
+		t->ops++;
+	}
+	return NULL;
+}
+
+/*
+ *  stress_mpmc_pass()
+ *	run producers and consumers on a queue for duration seconds
+ */
+static int stress_mpmc_pass(
+	stress_mpmc_t *mpmc,
+	stress_mpmc_thread_t *threads,
+	stress_mpmc_result_t *result,
+	const double duration)
+{
+	stress_args_t *args = mpmc->args;
+	const uint32_t n_threads = result->producers + result->consumers;
+	uint64_t enqueued = 0, dequeued = 0, remaining = 0, order_errors = 0, value;
+	uint32_t i, started = 0;
+	stress_mpmc_thread_t drain;
+	double t_start, t_end;
+	int rc = 0;
+
+	mpmc->method = result->method;
+	mpmc->method->reset(mpmc);
+	mpmc->start = false;
+	mpmc->stop = false;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_mpmc_thread_t *t = &threads[i];
+
+		(void)shim_memset(t, 0, sizeof(*t));
+		(void)shim_memset(t->last, 0xff, sizeof(t->last));
+		t->pargs.args = args;
+		t->pargs.data = (void *)mpmc;
+		t->producer = (i < result->producers);
+		t->id = t->producer ? i : i - result->producers;
+		if (pthread_create(&t->pthread, NULL, stress_mpmc_thread, t))
+			break;
+		started++;
+	}
+	t_start = stress_time_now();
+	mpmc->start = true;
+	if (started == n_threads)
+		(void)shim_nanosleep_uint64((uint64_t)(duration * STRESS_DBL_NANOSECOND));
+	mpmc->stop = true;
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	t_end = stress_time_now();
+
+	if (started != n_threads) {
+		pr_inf("%s: could only start %" PRIu32 " of %" PRIu32 " threads\n",
+			args->name, started, n_threads);
+		return -1;
+	}
+
+	for (i = 0; i < n_threads; i++) {
+		const stress_mpmc_thread_t *t = &threads[i];
+
+		if (t->producer)
+			enqueued += t->ops;
+		else
+			dequeued += t->ops;
+		order_errors += t->order_errors;
+		result->cas_fails += t->cas_fails;
+		stress_latency_merge(&result->latency, &t->latency);
+		if (args->latency)
+			stress_latency_merge(args->latency, &t->latency);
+	}
+	(void)shim_memset(&drain, 0, sizeof(drain));
+	while (mpmc->method->dequeue(mpmc, &drain, &value))
+		remaining++;
+
+	if (enqueued != dequeued + remaining) {
+		pr_fail("%s: %s queue lost items, %" PRIu64 " enqueued, %" PRIu64
+			" dequeued and %" PRIu64 " left on the queue\n",
+			args->name, mpmc->method->name, enqueued, dequeued, remaining);
+		rc = -1;
+	}
+	if (order_errors) {
+		pr_fail("%s: %s queue returned %" PRIu64 " items out of producer order\n",
+			args->name, mpmc->method->name, order_errors);
+		rc = -1;
+	}
+	result->ops += enqueued + dequeued;
+	result->duration += t_end - t_start;
+	stress_bogo_add(args, enqueued + dequeued);
+
+	return rc;
+}
+
+/*
+ *  stress_mpmc()
+ *	stress lock-free multi-producer multi-consumer queues
+ *	over a range of producer and consumer counts
+ */
+static int stress_mpmc(stress_args_t *args)
+{
+	const int32_t cpus = stress_get_processors_online();
+	uint32_t mpmc_size = DEFAULT_MPMC_SIZE, mpmc_threads = DEFAULT_MPMC_THREADS;
+	uint32_t counts[3], n_counts = 0, i, j, k;
+	size_t mpmc_method = 0, n_results = 0, idx = 0, metric = 0;
+	stress_mpmc_result_t *results;
+	stress_mpmc_thread_t *threads;
+	stress_mpmc_t mpmc;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("mpmc-method", &mpmc_method);
+	(void)stress_get_setting("mpmc-size", &mpmc_size);
+	if (!stress_get_setting("mpmc-threads", &mpmc_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			mpmc_threads = MAX_MPMC_THREADS;
+		else if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			mpmc_threads = MIN_MPMC_THREADS;
+		else
+			mpmc_threads = (uint32_t)STRESS_MAXIMUM(2,
+				STRESS_MINIMUM(DEFAULT_MPMC_THREADS, cpus));
+	}
+
+	/* 1, half and all of the threads, for producers and for consumers */
+	counts[n_counts++] = 1;
+	if ((mpmc_threads / 2) > 1)
+		counts[n_counts++] = mpmc_threads / 2;
+	if (mpmc_threads > 1)
+		counts[n_counts++] = mpmc_threads;
+
+	(void)shim_memset(&mpmc, 0, sizeof(mpmc));
+	mpmc.args = args;
+	for (mpmc.ring_size = MIN_MPMC_SIZE; mpmc.ring_size < mpmc_size; mpmc.ring_size <<= 1)
+		;
+
+	results = (stress_mpmc_result_t *)calloc(SIZEOF_ARRAY(stress_mpmc_methods) * n_counts * n_counts,
+		sizeof(*results));
+	threads = (stress_mpmc_thread_t *)calloc(2 * (size_t)mpmc_threads, sizeof(*threads));
+	if (!results || !threads) {
+		pr_inf_skip("%s: cannot allocate thread state, skipping stressor\n", args->name);
+		free(threads);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(stress_mpmc_methods); i++) {
+		const stress_mpmc_method_t *method = &stress_mpmc_methods[i];
+
+		if ((mpmc_method != 0) && strcmp(method->name, mpmc_method_names[mpmc_method]))
+			continue;
+		if (method->init(&mpmc) < 0) {
+			pr_inf_skip("%s: cannot allocate %s queue, skipping stressor\n",
+				args->name, method->name);
+			rc = EXIT_NO_RESOURCE;
+			goto deinit;
+		}
+		for (j = 0; j < n_counts; j++) {
+			for (k = 0; k < n_counts; k++) {
+				results[n_results].method = method;
+				results[n_results].producers = counts[j];
+				results[n_results].consumers = counts[k];
+				n_results++;
+			}
+		}
+	}
+	stress_mpmc_ctxt = &mpmc;
+
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_mpmc_result_t *result = &results[idx];
+
+		if (!result->failed && (stress_mpmc_pass(&mpmc, threads, result, slice) < 0)) {
+			result->failed = true;
+			rc = EXIT_FAILURE;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-5s %4s %4s %10s %8s %8s %10s\n", args->name,
+			"queue", "P", "C", "Mops/sec", "p50 ns", "p99 ns", "CAS fail%");
+	for (i = 0; i < n_results; i++) {
+		const stress_mpmc_result_t *result = &results[i];
+		double rate, cas_rate;
+		char str[64];
+
+		if ((result->ops == 0) || (result->duration <= 0.0))
+			continue;
+		rate = (double)result->ops / result->duration;
+		cas_rate = 100.0 * (double)result->cas_fails /
+			(double)(result->ops + result->cas_fails);
+		if (args->instance == 0)
+			pr_inf("%s: %-5s %4" PRIu32 " %4" PRIu32 " %10.2f %8" PRIu64 " %8" PRIu64 " %10.3f\n",
+				args->name, result->method->name,
+				result->producers, result->consumers, rate / 1000000.0,
+				stress_latency_percentile(&result->latency, 50.0),
+				stress_latency_percentile(&result->latency, 99.0), cas_rate);
+		if (metric >= STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(str, sizeof(str), "%s P%" PRIu32 " C%" PRIu32 " M ops per sec",
+			result->method->name, result->producers, result->consumers);
+		stress_metrics_set(args, metric++, str, rate / 1000000.0, STRESS_HARMONIC_MEAN);
+	}
+
+deinit:
+	for (i = 0; i < SIZEOF_ARRAY(stress_mpmc_methods); i++) {
+		const stress_mpmc_method_t *method = &stress_mpmc_methods[i];
+
+		if ((mpmc_method == 0) || !strcmp(method->name, mpmc_method_names[mpmc_method]))
+			method->deinit(&mpmc);
+	}
+	free(threads);
+	free(results);
+
+	return rc;
+}
+
+stressor_info_t stress_mpmc_info = {
+	.stressor = stress_mpmc,
+	.class = CLASS_CPU | CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_ALWAYS,
+	.help = help
+};
+#else
+stressor_info_t stress_mpmc_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_CPU | CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
+	.verify = VERIFY_ALWAYS,
+	.help = help,
+	.unimplemented_reason = "built without pthread or atomic compare and exchange support"
+};
+#endif
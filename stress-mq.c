@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-ipc-sweep.h"
 #include "core-killpid.h"
 
 #if defined(HAVE_MQUEUE_H)
@@ -36,6 +37,7 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"mq N",		"start N workers passing messages using POSIX messages" },
+	{ NULL,	"mq-ipc-sweep",	"sweep stream and ping-pong message sizes 8B..1MB" },
 	{ NULL,	"mq-ops N",	"stop mq workers after N bogo messages" },
 	{ NULL,	"mq-size N",	"specify the size of the POSIX message queue" },
 	{ NULL,	NULL,		NULL }
@@ -52,9 +54,15 @@ static int stress_set_mq_size(const char *opt)
 	return stress_set_setting("mq-size", TYPE_ID_INT, &mq_size);
 }
 
+static int stress_set_mq_ipc_sweep(const char *opt)
+{
+	return stress_set_setting_true("mq-ipc-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
-	{ OPT_mq_size,	stress_set_mq_size },
-	{ 0,		NULL }
+	{ OPT_mq_ipc_sweep,	stress_set_mq_ipc_sweep },
+	{ OPT_mq_size,		stress_set_mq_size },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_MQUEUE_H) &&	\
@@ -92,6 +100,97 @@ static void stress_mq_invalid_open(
 	}
 }
 
+/* a message queue per direction for the IPC sweep */
+typedef struct {
+	mqd_t mq[2];
+	size_t msgsize;
+} stress_mq_ipc_t;
+
+static int stress_mq_ipc_open(stress_args_t *args, void *ctxt, size_t *max_chunk)
+{
+	stress_mq_ipc_t *ipc = (stress_mq_ipc_t *)ctxt;
+	char buf[64];
+	unsigned long int msgsize_max = 8192;
+	int i;
+
+	if (stress_system_read("/proc/sys/fs/mqueue/msgsize_max", buf, sizeof(buf)) > 0) {
+		if ((sscanf(buf, "%lu", &msgsize_max) != 1) || (msgsize_max < 64))
+			msgsize_max = 8192;
+	}
+	/* a power of 2 so whole messages always fit the sweep buffer */
+	for (ipc->msgsize = 64; ipc->msgsize < 1 * MB; ipc->msgsize <<= 1) {
+		if ((ipc->msgsize << 1) > (size_t)msgsize_max)
+			break;
+	}
+
+	for (i = 0; i < 2; i++) {
+		char mq_name[64];
+
+		(void)snprintf(mq_name, sizeof(mq_name), "/%s-ipc-%" PRIdMAX "-%" PRIu32 "-%d",
+			args->name, (intmax_t)args->pid, args->instance, i);
+		for (;;) {
+			struct mq_attr attr;
+
+			attr.mq_flags = 0;
+			attr.mq_maxmsg = DEFAULT_MQ_SIZE;
+			attr.mq_msgsize = (long int)ipc->msgsize;
+			attr.mq_curmsgs = 0;
+			ipc->mq[i] = mq_open(mq_name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR, &attr);
+			if (ipc->mq[i] >= 0)
+				break;
+			/* large messages may exceed RLIMIT_MSGQUEUE, try smaller ones */
+			if ((i > 0) || (ipc->msgsize <= 64) ||
+			    ((errno != EINVAL) && (errno != ENOMEM) && (errno != EMFILE))) {
+				pr_inf_skip("%s: mq_open failed, errno=%d (%s), skipping stressor\n",
+					args->name, errno, strerror(errno));
+				if (i > 0)
+					(void)mq_close(ipc->mq[0]);
+				return -1;
+			}
+			ipc->msgsize >>= 1;
+		}
+		/* the child inherits the descriptors, the name is not needed */
+		(void)mq_unlink(mq_name);
+	}
+	*max_chunk = ipc->msgsize;
+	return 0;
+}
+
+static void stress_mq_ipc_close(void *ctxt)
+{
+	stress_mq_ipc_t *ipc = (stress_mq_ipc_t *)ctxt;
+
+	(void)mq_close(ipc->mq[STRESS_IPC_TO_CHILD]);
+	(void)mq_close(ipc->mq[STRESS_IPC_TO_PARENT]);
+}
+
+static ssize_t stress_mq_ipc_send(void *ctxt, const int dir, const void *buf, const size_t len)
+{
+	stress_mq_ipc_t *ipc = (stress_mq_ipc_t *)ctxt;
+
+	if (mq_send(ipc->mq[dir], (const char *)buf, len, 0) < 0)
+		return -1;
+	return (ssize_t)len;
+}
+
+static ssize_t stress_mq_ipc_recv(void *ctxt, const int dir, void *buf, const size_t len)
+{
+	stress_mq_ipc_t *ipc = (stress_mq_ipc_t *)ctxt;
+
+	(void)len;
+
+	/* buffers are at least the message size, as mq_receive requires */
+	return mq_receive(ipc->mq[dir], (char *)buf, ipc->msgsize, NULL);
+}
+
+static const stress_ipc_transport_t stress_mq_ipc_transport = {
+	"mq",
+	stress_mq_ipc_open,
+	stress_mq_ipc_close,
+	stress_mq_ipc_send,
+	stress_mq_ipc_recv,
+};
+
 /*
  *  stress_mq
  *	stress POSIX message queues
@@ -108,6 +207,14 @@ static int stress_mq(stress_args_t *args)
 	time_t time_start;
 	struct timespec abs_timeout;
 	unsigned int max_prio = UINT_MAX;
+	bool mq_ipc_sweep = false;
+
+	(void)stress_get_setting("mq-ipc-sweep", &mq_ipc_sweep);
+	if (mq_ipc_sweep) {
+		stress_mq_ipc_t ipc;
+
+		return stress_ipc_sweep(args, &stress_mq_ipc_transport, &ipc);
+	}
 
 #if defined(SIGUSR2)
 	if (stress_sighandler(args->name, SIGUSR2, stress_sighandler_nop, NULL) < 0)
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-mmap.h"
@@ -32,6 +33,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"mremap-bytes N", "mremap N bytes maximum for each stress iteration" },
 	{ NULL, "mremap-mlock",	  "mlock remap pages, force pages to be unswappable" },
 	{ NULL,	"mremap-ops N",	  "stop after N mremap bogo operations" },
+	{ NULL,	"mremap-sweep",	  "move large regions with 4K, PMD and THP layouts, report GB/s" },
 	{ NULL,	NULL,		  NULL }
 };
 
@@ -50,9 +52,15 @@ static int stress_set_mremap_mlock(const char *opt)
 	return stress_set_setting_true("mremap-mlock", opt);
 }
 
+static int stress_set_mremap_sweep(const char *opt)
+{
+	return stress_set_setting_true("mremap-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mremap_bytes,	stress_set_mremap_bytes },
 	{ OPT_mremap_mlock,	stress_set_mremap_mlock },
+	{ OPT_mremap_sweep,	stress_set_mremap_sweep },
 	{ 0,			NULL }
 };
 
@@ -208,12 +216,239 @@ static int try_remap(
 	return -1;
 }
 
+#if defined(MREMAP_FIXED) &&	\
+    defined(MREMAP_MAYMOVE)
+#define MREMAP_SWEEP_PMD_SIZE	(2 * MB)
+#define MREMAP_SWEEP_MOVES	(16)	/* moves per sweep point per pass */
+
+/* how the moved region is laid out */
+typedef enum {
+	MREMAP_SWEEP_4K,		/* 4K pages, source and destination not PMD co-aligned */
+	MREMAP_SWEEP_PMD,		/* 4K pages, source and destination PMD aligned */
+	MREMAP_SWEEP_THP,		/* transparent huge pages, PMD aligned */
+	MREMAP_SWEEP_DONTUNMAP,		/* PMD aligned, MREMAP_DONTUNMAP moves */
+} stress_mremap_sweep_layout_t;
+
+/* a sweep point and its accumulated moves */
+typedef struct {
+	stress_mremap_sweep_layout_t layout;
+	size_t size;			/* bytes moved per mremap call */
+	double bytes;			/* total bytes moved */
+	double duration;		/* total time in mremap calls */
+	double calls;			/* number of mremap calls */
+	double max;			/* slowest mremap call, secs */
+	bool unsupported;		/* layout not supported by the kernel */
+} stress_mremap_sweep_result_t;
+
+static const char * const stress_mremap_sweep_layouts[] = {
+	"4k",
+	"pmd",
+	"thp",
+	"dontunmap",
+};
+
+static const size_t stress_mremap_sweep_sizes[] = {
+	2 * MB, 16 * MB, 128 * MB, 1 * GB,
+};
+
+/*
+ *  stress_mremap_sweep_pass()
+ *	map a region of the sweep point's size and layout and
+ *	move it back and forth between two fixed addresses
+ */
+static int stress_mremap_sweep_pass(
+	stress_args_t *args,
+	stress_mremap_sweep_result_t *result)
+{
+	const size_t page_size = args->page_size;
+	const size_t size = result->size;
+	const size_t offset = (result->layout == MREMAP_SWEEP_4K) ? page_size : 0;
+	const size_t reserve_sz = (2 * size) + (3 * MREMAP_SWEEP_PMD_SIZE);
+	uint8_t *reserve, *base, *from, *to;
+	int flags = MREMAP_MAYMOVE | MREMAP_FIXED;
+	int i, rc = 0;
+
+	if (result->unsupported)
+		return 0;
+#if defined(MREMAP_DONTUNMAP)
+	if (result->layout == MREMAP_SWEEP_DONTUNMAP)
+		flags |= MREMAP_DONTUNMAP;
+#else
+	if (result->layout == MREMAP_SWEEP_DONTUNMAP) {
+		result->unsupported = true;
+		return 0;
+	}
+#endif
+
+	/* reserve the address space of the source and destination */
+	reserve = (uint8_t *)mmap(NULL, reserve_sz, PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (reserve == MAP_FAILED)
+		return 0;
+	base = (uint8_t *)(((uintptr_t)reserve + MREMAP_SWEEP_PMD_SIZE - 1) &
+			   ~(uintptr_t)(MREMAP_SWEEP_PMD_SIZE - 1));
+	/* only the 4K layout source is offset so the two are never PMD co-aligned */
+	from = base + offset;
+	to = base + size + MREMAP_SWEEP_PMD_SIZE;
+
+	if (mmap((void *)from, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+		goto unmap;
+#if defined(MADV_HUGEPAGE) &&	\
+    defined(MADV_NOHUGEPAGE)
+	(void)shim_madvise((void *)from, size,
+		(result->layout == MREMAP_SWEEP_THP) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#endif
+	if (g_opt_flags & OPT_FLAGS_VERIFY)
+		stress_mmap_set(from, size, page_size);
+	else
+		(void)shim_memset(from, 0x5a, size);
+
+	for (i = 0; i < MREMAP_SWEEP_MOVES; i++) {
+		uint8_t *ptr, *tmp;
+		double t, dt;
+
+		t = stress_time_now();
+		ptr = (uint8_t *)mremap((void *)from, size, size, flags, (void *)to);
+		dt = stress_time_now() - t;
+		if (ptr == MAP_FAILED) {
+			if ((errno == EINVAL) && (result->layout == MREMAP_SWEEP_DONTUNMAP)) {
+				/* pre-5.7 kernels do not support MREMAP_DONTUNMAP */
+				result->unsupported = true;
+				break;
+			}
+			if ((errno == ENOMEM) || (errno == EAGAIN))
+				break;
+			pr_fail("%s: mremap of %zu bytes failed, errno=%d (%s)\n",
+				args->name, size, errno, strerror(errno));
+			rc = -1;
+			break;
+		}
+		result->bytes += (double)size;
+		result->duration += dt;
+		result->calls += 1.0;
+		if (dt > result->max)
+			result->max = dt;
+
+		/* the source is left mapped and empty with MREMAP_DONTUNMAP */
+		if (result->layout == MREMAP_SWEEP_DONTUNMAP)
+			(void)stress_munmap_retry_enomem((void *)from, size);
+		tmp = from;
+		from = to;
+		to = tmp;
+		if (!stress_continue_flag())
+			break;
+	}
+	if ((rc == 0) && (g_opt_flags & OPT_FLAGS_VERIFY) &&
+	    (stress_mmap_check(from, size, page_size) < 0)) {
+		pr_fail("%s: mremap'd region of %zu bytes does not contain expected data\n",
+			args->name, size);
+		rc = -1;
+	}
+unmap:
+	(void)stress_munmap_retry_enomem((void *)reserve, reserve_sz);
+	return rc;
+}
+
+/*
+ *  stress_mremap_sweep()
+ *	measure the throughput and per call latency of moving large
+ *	regions with 4K page, PMD aligned, transparent huge page and
+ *	MREMAP_DONTUNMAP layouts, PMD aligned moves can move page
+ *	tables at PMD granularity rather than one PTE at a time
+ */
+static int stress_mremap_sweep(stress_args_t *args, const size_t mremap_bytes)
+{
+	stress_mremap_sweep_result_t results[SIZEOF_ARRAY(stress_mremap_sweep_layouts) *
+					     SIZEOF_ARRAY(stress_mremap_sweep_sizes)];
+	size_t i, j, n_results = 0, idx = 0, metric = 0;
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(results, 0, sizeof(results));
+	for (i = 0; i < SIZEOF_ARRAY(stress_mremap_sweep_layouts); i++) {
+		for (j = 0; j < SIZEOF_ARRAY(stress_mremap_sweep_sizes); j++) {
+			const size_t size = stress_mremap_sweep_sizes[j];
+
+			if ((j > 0) && (size > mremap_bytes))
+				break;
+			results[n_results].layout = (stress_mremap_sweep_layout_t)i;
+			results[n_results].size = size;
+			n_results++;
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		if (stress_mremap_sweep_pass(args, &results[idx]) < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-10s %8s %10s %12s %12s %8s\n", args->name,
+			"layout", "size", "GB/sec", "ns/call", "max us/call", "vs 4k");
+	for (i = 0; i < n_results; i++) {
+		const stress_mremap_sweep_result_t *result = &results[i];
+		const char *layout = stress_mremap_sweep_layouts[result->layout];
+		char size_str[32], vs_str[16], str[64];
+		double gb_rate, ns_per_call;
+		bool last;
+
+		if (result->unsupported) {
+			if ((args->instance == 0) && ((i == 0) || (results[i - 1].layout != result->layout)))
+				pr_inf("%s: %-10s not supported\n", args->name, layout);
+			continue;
+		}
+		if ((result->duration <= 0.0) || (result->calls <= 0.0))
+			continue;
+		(void)stress_uint64_to_str(size_str, sizeof(size_str), (uint64_t)result->size);
+		gb_rate = (result->bytes / (double)GB) / result->duration;
+		ns_per_call = STRESS_DBL_NANOSECOND * result->duration / result->calls;
+
+		/* speedup over moving the same size with 4K non-PMD aligned pages */
+		(void)shim_strscpy(vs_str, "-", sizeof(vs_str));
+		for (j = 0; j < n_results; j++) {
+			const stress_mremap_sweep_result_t *base = &results[j];
+
+			if ((result->layout != MREMAP_SWEEP_4K) &&
+			    (base->layout == MREMAP_SWEEP_4K) &&
+			    (base->size == result->size) &&
+			    (base->bytes > 0.0) && (base->duration > 0.0)) {
+				(void)snprintf(vs_str, sizeof(vs_str), "%.2fx",
+					gb_rate / ((base->bytes / (double)GB) / base->duration));
+				break;
+			}
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %-10s %8s %10.3f %12.1f %12.1f %8s\n", args->name,
+				layout, size_str, gb_rate, ns_per_call,
+				result->max * STRESS_DBL_MICROSECOND, vs_str);
+
+		/* metrics for the largest size of each layout */
+		last = (i + 1 >= n_results) || (results[i + 1].layout != result->layout);
+		if (!last || (metric + 2 > STRESS_STRESSOR_METRICS_MAX))
+			continue;
+		(void)snprintf(str, sizeof(str), "%s %s GB per sec moved", layout, size_str);
+		stress_metrics_set(args, metric++, str, gb_rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s %s nanosecs per mremap call", layout, size_str);
+		stress_metrics_set(args, metric++, str, ns_per_call, STRESS_HARMONIC_MEAN);
+	}
+	return rc;
+}
+#endif
+
 static int stress_mremap_child(stress_args_t *args, void *context)
 {
 	size_t new_sz, sz, mremap_bytes = DEFAULT_MREMAP_BYTES;
 	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
 	const size_t page_size = args->page_size;
-	bool mremap_mlock = false;
+	bool mremap_mlock = false, mremap_sweep = false;
 	double duration = 0.0, count = 0.0, rate;
 	int ret = EXIT_SUCCESS;
 
@@ -236,6 +471,18 @@ static int stress_mremap_child(stress_args_t *args, void *context)
 	new_sz = sz = mremap_bytes & ~(page_size - 1);
 
 	(void)stress_get_setting("mremap-mlock", &mremap_mlock);
+	(void)stress_get_setting("mremap-sweep", &mremap_sweep);
+
+	if (mremap_sweep) {
+#if defined(MREMAP_FIXED) &&	\
+    defined(MREMAP_MAYMOVE)
+		return stress_mremap_sweep(args, mremap_bytes);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --mremap-sweep requires MREMAP_FIXED and MREMAP_MAYMOVE, "
+				"using the default remapping\n", args->name);
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
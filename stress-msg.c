@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-ipc-sweep.h"
 #include "core-killpid.h"
 
 #if defined(HAVE_SYS_IPC_H)
@@ -40,6 +41,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"msg-ops N",	"stop msg workers after N bogo messages" },
 	{ NULL, "msg-types N",	"enable N different message types" },
 	{ NULL, "msg-bytes N",	"set the message size 4..8192" },
+	{ NULL,	"msg-ipc-sweep","sweep stream and ping-pong message sizes 8B..1MB" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -61,9 +63,15 @@ static int stress_set_msg_types(const char *opt) {
 	return stress_set_setting("msg-types", TYPE_ID_INT32, &msg_types);
 }
 
+static int stress_set_msg_ipc_sweep(const char *opt)
+{
+	return stress_set_setting_true("msg-ipc-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_msg_types,	stress_set_msg_types },
 	{ OPT_msg_bytes,	stress_set_msg_bytes },
+	{ OPT_msg_ipc_sweep,	stress_set_msg_ipc_sweep },
 	{ 0,                    NULL },
 };
 
@@ -385,6 +393,90 @@ resend:
 
 }
 
+/* a message queue per direction for the IPC sweep */
+typedef struct {
+	int msgq_id[2];
+	size_t msgsize;
+	long int *msg;		/* mtype followed by the message text */
+} stress_msg_ipc_t;
+
+static int stress_msg_ipc_open(stress_args_t *args, void *ctxt, size_t *max_chunk)
+{
+	stress_msg_ipc_t *ipc = (stress_msg_ipc_t *)ctxt;
+	char buf[64];
+	unsigned long int msgmax = MAX_MSG_BYTES;
+	int i;
+
+	if (stress_system_read("/proc/sys/kernel/msgmax", buf, sizeof(buf)) > 0) {
+		if ((sscanf(buf, "%lu", &msgmax) != 1) || (msgmax < 64))
+			msgmax = MAX_MSG_BYTES;
+	}
+	/* a power of 2 so whole messages always fit the sweep buffer */
+	for (ipc->msgsize = 64; ipc->msgsize < 1 * MB; ipc->msgsize <<= 1) {
+		if ((ipc->msgsize << 1) > (size_t)msgmax)
+			break;
+	}
+	ipc->msg = (long int *)malloc(sizeof(*ipc->msg) + ipc->msgsize);
+	if (!ipc->msg) {
+		pr_inf_skip("%s: cannot allocate message buffer, skipping stressor\n", args->name);
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		ipc->msgq_id[i] = msgget(IPC_PRIVATE, S_IRUSR | S_IWUSR | IPC_CREAT | IPC_EXCL);
+		if (ipc->msgq_id[i] < 0) {
+			pr_inf_skip("%s: msgget failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			if (i > 0)
+				(void)msgctl(ipc->msgq_id[0], IPC_RMID, NULL);
+			free(ipc->msg);
+			return -1;
+		}
+	}
+	*max_chunk = ipc->msgsize;
+	return 0;
+}
+
+static void stress_msg_ipc_close(void *ctxt)
+{
+	stress_msg_ipc_t *ipc = (stress_msg_ipc_t *)ctxt;
+
+	(void)msgctl(ipc->msgq_id[STRESS_IPC_TO_CHILD], IPC_RMID, NULL);
+	(void)msgctl(ipc->msgq_id[STRESS_IPC_TO_PARENT], IPC_RMID, NULL);
+	free(ipc->msg);
+}
+
+static ssize_t stress_msg_ipc_send(void *ctxt, const int dir, const void *buf, const size_t len)
+{
+	stress_msg_ipc_t *ipc = (stress_msg_ipc_t *)ctxt;
+
+	ipc->msg[0] = 1;
+	(void)shim_memcpy((void *)&ipc->msg[1], buf, len);
+	if (msgsnd(ipc->msgq_id[dir], (void *)ipc->msg, len, 0) < 0)
+		return -1;
+	return (ssize_t)len;
+}
+
+static ssize_t stress_msg_ipc_recv(void *ctxt, const int dir, void *buf, const size_t len)
+{
+	stress_msg_ipc_t *ipc = (stress_msg_ipc_t *)ctxt;
+	ssize_t ret;
+
+	(void)len;
+
+	ret = msgrcv(ipc->msgq_id[dir], (void *)ipc->msg, ipc->msgsize, 0, 0);
+	if (ret > 0)
+		(void)shim_memcpy(buf, (void *)&ipc->msg[1], (size_t)ret);
+	return ret;
+}
+
+static const stress_ipc_transport_t stress_msg_ipc_transport = {
+	"msg",
+	stress_msg_ipc_open,
+	stress_msg_ipc_close,
+	stress_msg_ipc_send,
+	stress_msg_ipc_recv,
+};
+
 /*
  *  stress_msg
  *	stress by message queues
@@ -398,7 +490,14 @@ static int stress_msg(stress_args_t *args)
 	int *msgq_ids;
 	stress_msg_t ALIGN64 msg;
 	size_t j, n, msg_bytes = sizeof(msg.u.value);
+	bool msg_ipc_sweep = false;
 
+	(void)stress_get_setting("msg-ipc-sweep", &msg_ipc_sweep);
+	if (msg_ipc_sweep) {
+		stress_msg_ipc_t ipc;
+
+		return stress_ipc_sweep(args, &stress_msg_ipc_transport, &ipc);
+	}
 	(void)stress_get_setting("msg-types", &msg_types);
 	(void)stress_get_setting("msg-bytes", &msg_bytes);
 
@@ -17,9 +17,16 @@
  *
  */
 #include "stress-ng.h"
+#include "core-asm-arm.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-pthread.h"
 
+#if defined(HAVE_LINUX_FUTEX_H)
+#include <linux/futex.h>
+#endif
+
 #if defined(HAVE_PTHREAD_NP_H)
 #include <pthread_np.h>
 #endif
@@ -28,9 +35,17 @@
 #define MAX_MUTEX_PROCS		(64)
 #define DEFAULT_MUTEX_PROCS	(2)
 
+#define MIN_MUTEX_WORK		(0)
+#define MAX_MUTEX_WORK		(1000000)
+#define DEFAULT_MUTEX_CS_WORK	(100)
+#define DEFAULT_MUTEX_NCS_WORK	(100)
+
 static const stress_help_t help[] = {
 	{ NULL,	"mutex N",		"start N workers exercising mutex operations" },
 	{ NULL, "mutex-affinity",	"change CPU affinity randomly across locks" },
+	{ NULL, "mutex-cs-work N",	"select N loops of critical section work" },
+	{ NULL, "mutex-method M",	"select lock algorithm method M" },
+	{ NULL, "mutex-ncs-work N",	"select N loops of non-critical section work" },
 	{ NULL,	"mutex-ops N",		"stop after N mutex bogo operations" },
 	{ NULL, "mutex-procs N",	"select the number of concurrent processes" },
 	{ NULL,	NULL,		NULL }
@@ -41,6 +56,53 @@ static int stress_set_mutex_affinity(const char *opt)
 	return stress_set_setting_true("mutex-affinity", opt);
 }
 
+static int stress_set_mutex_cs_work(const char *opt)
+{
+	uint32_t mutex_cs_work;
+
+	mutex_cs_work = stress_get_uint32(opt);
+	stress_check_range("mutex-cs-work", (uint64_t)mutex_cs_work,
+		MIN_MUTEX_WORK, MAX_MUTEX_WORK);
+	return stress_set_setting("mutex-cs-work", TYPE_ID_UINT32, &mutex_cs_work);
+}
+
+/* pthread is the original priority changing mutex stressing */
+static const char * const mutex_method_names[] = {
+	"pthread",
+	"all",
+	"ticket",
+	"mcs",
+	"clh",
+	"qspinlock",
+	"adaptive",
+};
+
+static int stress_set_mutex_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(mutex_method_names); i++) {
+		if (!strcmp(mutex_method_names[i], opt))
+			return stress_set_setting("mutex-method", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "mutex-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(mutex_method_names); i++)
+		(void)fprintf(stderr, " %s", mutex_method_names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_mutex_ncs_work(const char *opt)
+{
+	uint32_t mutex_ncs_work;
+
+	mutex_ncs_work = stress_get_uint32(opt);
+	stress_check_range("mutex-ncs-work", (uint64_t)mutex_ncs_work,
+		MIN_MUTEX_WORK, MAX_MUTEX_WORK);
+	return stress_set_setting("mutex-ncs-work", TYPE_ID_UINT32, &mutex_ncs_work);
+}
+
 static int stress_set_mutex_procs(const char *opt)
 {
 	uint64_t mutex_procs;
@@ -53,6 +115,9 @@ static int stress_set_mutex_procs(const char *opt)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_mutex_affinity,	stress_set_mutex_affinity },
+	{ OPT_mutex_cs_work,	stress_set_mutex_cs_work },
+	{ OPT_mutex_method,	stress_set_mutex_method },
+	{ OPT_mutex_ncs_work,	stress_set_mutex_ncs_work },
 	{ OPT_mutex_procs,	stress_set_mutex_procs },
 	{ 0,			NULL }
 };
@@ -187,6 +252,506 @@ static void OPTIMIZE3 *mutex_exercise(void *arg)
 	return &nowt;
 }
 
+#define MUTEX_ADAPTIVE_SPINS	(100)		/* spins before futex wait */
+#define MUTEX_HANDOFF_SAMPLE	(16)		/* sample every 16th release */
+
+/* MCS, CLH and qspinlock queue node, one per cache line */
+typedef struct stress_mutex_node {
+	struct stress_mutex_node *next ALIGNED(64);
+	uint32_t locked;
+} stress_mutex_node_t;
+
+/* lock state and the data protected by the lock */
+typedef struct {
+	uint32_t ticket_next ALIGNED(64);	/* ticket lock next ticket */
+	uint32_t ticket_owner ALIGNED(64);	/* ticket lock now serving */
+	stress_mutex_node_t *tail ALIGNED(64);	/* MCS, CLH and qspinlock queue tail */
+	uint32_t word ALIGNED(64);		/* qspinlock and adaptive lock word */
+	uint64_t data[8] ALIGNED(64);		/* critical section data */
+	uint32_t in_cs;				/* non-zero when lock is held */
+	uint32_t last_owner;			/* thread that last held the lock */
+	double t_release;			/* sampled release time, 0.0 if none */
+	bool start;				/* set to start the threads */
+	bool stop;				/* set to stop the threads */
+	bool broken;				/* mutual exclusion failed */
+	stress_mutex_node_t nodes[MAX_MUTEX_PROCS + 1];
+} stress_mutex_lock_t;
+
+/* per thread state */
+typedef struct {
+	pthread_t pthread;
+	stress_mutex_lock_t *lock;
+	const struct stress_mutex_method *method;
+	stress_mutex_node_t *node;		/* queue node, CLH node in use */
+	stress_mutex_node_t *pred;		/* CLH predecessor node */
+	uint32_t id;				/* thread number */
+	uint32_t cs_work;			/* critical section work loops */
+	uint32_t ncs_work;			/* non-critical section work loops */
+	uint64_t acquires;			/* lock acquisitions */
+	stress_latency_t lat;			/* handoff latencies */
+	uint64_t local[8];			/* non-critical section data */
+	int ret;
+} stress_mutex_thread_t;
+
+typedef struct stress_mutex_method {
+	const char *name;
+	void (*lock)(stress_mutex_lock_t *l, stress_mutex_thread_t *t);
+	void (*unlock)(stress_mutex_lock_t *l, stress_mutex_thread_t *t);
+} stress_mutex_method_t;
+
+/* accumulated results of a method and thread count */
+typedef struct {
+	const stress_mutex_method_t *method;
+	uint32_t threads;
+	double duration;
+	uint64_t acquires;
+	double min_share;	/* least thread share of fair share */
+	double max_share;	/* most thread share of fair share */
+	stress_latency_t lat;
+} stress_mutex_result_t;
+
+/*
+ *  stress_mutex_relax()
+ *	spin wait hint, yield now and again so a preempted
+ *	lock holder can run when threads outnumber CPUs
+ */
+static inline void ALWAYS_INLINE stress_mutex_relax(uint32_t *spins)
+{
+#if defined(HAVE_ASM_X86_PAUSE)
+	stress_asm_x86_pause();
+#elif defined(HAVE_ASM_ARM_YIELD)
+	stress_asm_arm_yield();
+#endif
+	if (UNLIKELY((++(*spins) & 1023) == 0))
+		(void)shim_sched_yield();
+}
+
+/*
+ *  ticket lock, FIFO order by taking a ticket and
+ *  spinning until it is being served
+ */
+static void stress_mutex_ticket_lock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	const uint32_t ticket = __atomic_fetch_add(&l->ticket_next, 1, __ATOMIC_RELAXED);
+	uint32_t spins = 0;
+
+	(void)t;
+	while (__atomic_load_n(&l->ticket_owner, __ATOMIC_ACQUIRE) != ticket)
+		stress_mutex_relax(&spins);
+}
+
+static void stress_mutex_ticket_unlock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	(void)t;
+	__atomic_store_n(&l->ticket_owner, l->ticket_owner + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ *  MCS lock, waiters queue and spin on their own node
+ */
+static inline void stress_mutex_mcs_acquire(stress_mutex_node_t **tail, stress_mutex_node_t *node)
+{
+	stress_mutex_node_t *pred;
+	uint32_t spins = 0;
+
+	node->next = NULL;
+	__atomic_store_n(&node->locked, 1, __ATOMIC_RELAXED);
+	pred = __atomic_exchange_n(tail, node, __ATOMIC_ACQ_REL);
+	if (!pred)
+		return;
+	__atomic_store_n(&pred->next, node, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+		stress_mutex_relax(&spins);
+}
+
+static inline void stress_mutex_mcs_release(stress_mutex_node_t **tail, stress_mutex_node_t *node)
+{
+	stress_mutex_node_t *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+	uint32_t spins = 0;
+
+	if (!next) {
+		stress_mutex_node_t *expected = node;
+
+		if (__atomic_compare_exchange_n(tail, &expected, NULL, false,
+						__ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			return;
+		/* a successor is between the exchange and linking in */
+		while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)))
+			stress_mutex_relax(&spins);
+	}
+	__atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+static void stress_mutex_mcs_lock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	stress_mutex_mcs_acquire(&l->tail, t->node);
+}
+
+static void stress_mutex_mcs_unlock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	stress_mutex_mcs_release(&l->tail, t->node);
+}
+
+/*
+ *  CLH lock, waiters queue and spin on the predecessor's
+ *  node and recycle it on release
+ */
+static void stress_mutex_clh_lock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	uint32_t spins = 0;
+
+	__atomic_store_n(&t->node->locked, 1, __ATOMIC_RELAXED);
+	t->pred = __atomic_exchange_n(&l->tail, t->node, __ATOMIC_ACQ_REL);
+	while (__atomic_load_n(&t->pred->locked, __ATOMIC_ACQUIRE))
+		stress_mutex_relax(&spins);
+}
+
+static void stress_mutex_clh_unlock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	stress_mutex_node_t *node = t->node;
+
+	(void)l;
+	t->node = t->pred;
+	__atomic_store_n(&node->locked, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ *  qspinlock style hybrid, an uncontended compare and swap
+ *  fast path, contending threads queue on an MCS lock and
+ *  only the queue head spins on the lock word
+ */
+static void stress_mutex_qspinlock_lock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	uint32_t expected = 0, spins = 0;
+
+	if (__atomic_compare_exchange_n(&l->word, &expected, 1, false,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	stress_mutex_mcs_acquire(&l->tail, t->node);
+	for (;;) {
+		expected = 0;
+		if ((__atomic_load_n(&l->word, __ATOMIC_RELAXED) == 0) &&
+		    __atomic_compare_exchange_n(&l->word, &expected, 1, false,
+						__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+		stress_mutex_relax(&spins);
+	}
+	stress_mutex_mcs_release(&l->tail, t->node);
+}
+
+static void stress_mutex_qspinlock_unlock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	(void)t;
+	__atomic_store_n(&l->word, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ *  adaptive lock, spin briefly then sleep on a futex, the lock
+ *  word is 0 unlocked, 1 locked, 2 locked with sleeping waiters
+ */
+static void stress_mutex_adaptive_lock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	uint32_t expected, spins = 0;
+	int i;
+
+	(void)t;
+	for (i = 0; i < MUTEX_ADAPTIVE_SPINS; i++) {
+		expected = 0;
+		if ((__atomic_load_n(&l->word, __ATOMIC_RELAXED) == 0) &&
+		    __atomic_compare_exchange_n(&l->word, &expected, 1, false,
+						__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+		stress_mutex_relax(&spins);
+	}
+	while (__atomic_exchange_n(&l->word, 2, __ATOMIC_ACQUIRE) != 0) {
+#if defined(HAVE_LINUX_FUTEX_H)
+		if (shim_futex_wait(&l->word, 2, NULL) < 0)
+			stress_mutex_relax(&spins);
+#else
+		(void)shim_sched_yield();
+#endif
+	}
+}
+
+static void stress_mutex_adaptive_unlock(stress_mutex_lock_t *l, stress_mutex_thread_t *t)
+{
+	(void)t;
+	if (__atomic_fetch_sub(&l->word, 1, __ATOMIC_RELEASE) != 1) {
+		__atomic_store_n(&l->word, 0, __ATOMIC_RELEASE);
+#if defined(HAVE_LINUX_FUTEX_H)
+		(void)shim_futex_wake(&l->word, 1);
+#endif
+	}
+}
+
+static const stress_mutex_method_t mutex_methods[] = {
+	{ "ticket",	stress_mutex_ticket_lock,	stress_mutex_ticket_unlock },
+	{ "mcs",	stress_mutex_mcs_lock,		stress_mutex_mcs_unlock },
+	{ "clh",	stress_mutex_clh_lock,		stress_mutex_clh_unlock },
+	{ "qspinlock",	stress_mutex_qspinlock_lock,	stress_mutex_qspinlock_unlock },
+	{ "adaptive",	stress_mutex_adaptive_lock,	stress_mutex_adaptive_unlock },
+};
+
+/*
+ *  stress_mutex_lat()
+ *	add the time from t_start to t_end to a latency histogram
+ */
+static inline void stress_mutex_lat(stress_latency_t *lat, const double t_start, const double t_end)
+{
+	const uint64_t ns = (t_end > t_start) ? (uint64_t)((t_end - t_start) * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(lat, ns);
+}
+
+/*
+ *  stress_mutex_bench_thread()
+ *	lock, do the critical section work, unlock and do the
+ *	non-critical section work until told to stop
+ */
+static void *stress_mutex_bench_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_mutex_thread_t *t = (stress_mutex_thread_t *)arg;
+	stress_mutex_lock_t *l = t->lock;
+	const stress_mutex_method_t *method = t->method;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!__atomic_load_n(&l->start, __ATOMIC_ACQUIRE) &&
+	       !__atomic_load_n(&l->stop, __ATOMIC_ACQUIRE))
+		(void)shim_sched_yield();
+
+	while (!__atomic_load_n(&l->stop, __ATOMIC_RELAXED)) {
+		volatile uint64_t *data;
+		uint32_t i;
+
+		method->lock(l, t);
+		if (UNLIKELY(l->in_cs))
+			l->broken = true;
+		l->in_cs = 1;
+		if (l->t_release > 0.0) {
+			if (l->last_owner != t->id)
+				stress_mutex_lat(&t->lat, l->t_release, stress_time_now());
+			l->t_release = 0.0;
+		}
+		data = l->data;
+		for (i = 0; i < t->cs_work; i++)
+			data[i & 7] += i;
+		t->acquires++;
+		l->last_owner = t->id;
+		if ((t->acquires & (MUTEX_HANDOFF_SAMPLE - 1)) == 0)
+			l->t_release = stress_time_now();
+		l->in_cs = 0;
+		method->unlock(l, t);
+
+		data = t->local;
+		for (i = 0; i < t->ncs_work; i++)
+			data[i & 7] += i;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_mutex_bench_pass()
+ *	run result->threads threads contending on a lock method
+ *	for duration seconds
+ */
+static int stress_mutex_bench_pass(
+	stress_args_t *args,
+	stress_mutex_lock_t *l,
+	stress_mutex_thread_t *threads,
+	stress_mutex_result_t *result,
+	const uint32_t cs_work,
+	const uint32_t ncs_work,
+	const double duration)
+{
+	uint32_t i, n_created = 0;
+	uint64_t acquires = 0, min_acquires = ~0ULL, max_acquires = 0;
+	double t_start;
+
+	(void)shim_memset(l, 0, sizeof(*l));
+	/* CLH starts with a free dummy node at the tail */
+	l->tail = (result->method->lock == stress_mutex_clh_lock) ? &l->nodes[0] : NULL;
+
+	for (i = 0; i < result->threads; i++) {
+		stress_mutex_thread_t *t = &threads[i];
+
+		(void)shim_memset(t, 0, sizeof(*t));
+		t->lock = l;
+		t->method = result->method;
+		t->node = &l->nodes[i + 1];
+		t->id = i + 1;
+		t->cs_work = cs_work;
+		t->ncs_work = ncs_work;
+		t->ret = pthread_create(&t->pthread, NULL, stress_mutex_bench_thread, t);
+		if (t->ret)
+			break;
+		n_created++;
+	}
+	if (n_created == 0)
+		return EXIT_NO_RESOURCE;
+
+	t_start = stress_time_now();
+	__atomic_store_n(&l->start, true, __ATOMIC_RELEASE);
+	while (stress_continue_flag() && (stress_time_now() - t_start < duration))
+		(void)shim_usleep(10000);
+	__atomic_store_n(&l->stop, true, __ATOMIC_RELEASE);
+
+	for (i = 0; i < n_created; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	result->duration += stress_time_now() - t_start;
+
+	for (i = 0; i < n_created; i++) {
+		const stress_mutex_thread_t *t = &threads[i];
+
+		acquires += t->acquires;
+		min_acquires = STRESS_MINIMUM(min_acquires, t->acquires);
+		max_acquires = STRESS_MAXIMUM(max_acquires, t->acquires);
+		stress_latency_merge(&result->lat, &t->lat);
+	}
+	result->acquires += acquires;
+	if (acquires > 0) {
+		const double fair = (double)acquires / (double)n_created;
+
+		/* keep the least fair share seen over all the passes */
+		if ((result->min_share == 0.0) || ((double)min_acquires / fair < result->min_share))
+			result->min_share = (double)min_acquires / fair;
+		if ((double)max_acquires / fair > result->max_share)
+			result->max_share = (double)max_acquires / fair;
+	}
+	stress_bogo_add(args, acquires);
+
+	if (l->broken) {
+		pr_fail("%s: %s lock failed to provide mutual exclusion\n",
+			args->name, result->method->name);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_mutex_bench()
+ *	compare the throughput, fairness and handoff latency of
+ *	user space lock algorithms over doubling thread counts
+ */
+static int stress_mutex_bench(
+	stress_args_t *args,
+	const size_t mutex_method,
+	const uint32_t mutex_procs,
+	const uint32_t cs_work,
+	const uint32_t ncs_work)
+{
+	const size_t method_begin = (mutex_method == 0) ? 0 : mutex_method - 1;
+	const size_t method_end = (mutex_method == 0) ? SIZEOF_ARRAY(mutex_methods) : mutex_method;
+	stress_mutex_result_t *results;
+	stress_mutex_thread_t *threads;
+	stress_mutex_lock_t *l;
+	size_t i, n_results = 0, idx = 0, metric = 0;
+	uint32_t n;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	results = (stress_mutex_result_t *)calloc(SIZEOF_ARRAY(mutex_methods) * 8, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	threads = (stress_mutex_thread_t *)calloc(mutex_procs, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " threads, skipping stressor\n",
+			args->name, mutex_procs);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	/* page aligned so the cache line alignment of the lock holds */
+	l = (stress_mutex_lock_t *)mmap(NULL, sizeof(*l), PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (l == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap lock state, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		free(threads);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (i = method_begin; i < method_end; i++) {
+		for (n = 1; ; n = STRESS_MINIMUM(n * 2, mutex_procs)) {
+			results[n_results].method = &mutex_methods[i];
+			results[n_results].threads = n;
+			n_results++;
+			if (n == mutex_procs)
+				break;
+		}
+	}
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		const int ret = stress_mutex_bench_pass(args, l, threads, &results[idx],
+					cs_work, ncs_work, slice);
+
+		if (ret == EXIT_FAILURE) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		if ((ret == EXIT_NO_RESOURCE) && (idx == 0)) {
+			pr_inf_skip("%s: cannot create any pthreads, skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_inf("%s: critical section work %" PRIu32 ", non-critical section work %" PRIu32 "\n",
+			args->name, cs_work, ncs_work);
+		pr_inf("%s: %-10s %7s %14s %9s %9s %12s %12s\n", args->name,
+			"method", "threads", "M acquire/sec", "min share", "max share",
+			"handoff p50", "handoff p99");
+	}
+	for (i = 0; i < n_results; i++) {
+		const stress_mutex_result_t *result = &results[i];
+		const double rate = (result->duration > 0.0) ?
+			(double)result->acquires / result->duration : 0.0;
+		char msg[64];
+
+		if (result->acquires == 0)
+			continue;
+		if (args->instance == 0) {
+			pr_inf("%s: %-10s %7" PRIu32 " %14.3f %9.3f %9.3f %12.0f %12.0f\n",
+				args->name, result->method->name, result->threads,
+				rate / 1000000.0, result->min_share, result->max_share,
+				(double)stress_latency_percentile(&result->lat, 50.0),
+				(double)stress_latency_percentile(&result->lat, 99.0));
+		}
+		if (metric + 3 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " threads M acquires per sec",
+			result->method->name, result->threads);
+		stress_metrics_set(args, metric++, msg, rate / 1000000.0, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " threads min fair share",
+			result->method->name, result->threads);
+		stress_metrics_set(args, metric++, msg, result->min_share, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s %" PRIu32 " threads handoff p50 (ns)",
+			result->method->name, result->threads);
+		stress_metrics_set(args, metric++, msg,
+			(double)stress_latency_percentile(&result->lat, 50.0), STRESS_GEOMETRIC_MEAN);
+	}
+
+	(void)munmap((void *)l, sizeof(*l));
+	free(threads);
+	free(results);
+
+	return rc;
+}
+
 /*
  *  stress_mutex()
  *	stress system with priority changing mutex lock/unlocks
@@ -200,6 +765,9 @@ static int stress_mutex(stress_args_t *args)
 	uint64_t mutex_procs = DEFAULT_MUTEX_PROCS;
 	bool mutex_affinity = false;
 	double duration = 0.0, count = 0.0, rate;
+	size_t mutex_method = 0;
+	uint32_t mutex_cs_work = DEFAULT_MUTEX_CS_WORK;
+	uint32_t mutex_ncs_work = DEFAULT_MUTEX_NCS_WORK;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -211,6 +779,13 @@ static int stress_mutex(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			mutex_procs = MIN_MUTEX_PROCS;
 	}
+	(void)stress_get_setting("mutex-method", &mutex_method);
+	if (mutex_method > 0) {
+		(void)stress_get_setting("mutex-cs-work", &mutex_cs_work);
+		(void)stress_get_setting("mutex-ncs-work", &mutex_ncs_work);
+		return stress_mutex_bench(args, mutex_method - 1, (uint32_t)mutex_procs,
+			mutex_cs_work, mutex_ncs_work);
+	}
 
 	(void)shim_memset(&pthread_info, 0, sizeof(pthread_info));
 
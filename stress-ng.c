@@ -20,35 +20,65 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-attribute.h"
+#include "core-benchmark.h"
 #include "core-bitops.h"
 #include "core-builtin.h"
+#include "core-cgroup.h"
 #include "core-clocksource.h"
+#include "core-cluster.h"
+#include "core-compare.h"
 #include "core-cpuidle.h"
+#include "core-cycles.h"
+#include "core-energy.h"
+#include "core-event-reap.h"
+#include "core-freq.h"
 #include "core-config-check.h"
 #include "core-ftrace.h"
+#include "core-harness-profile.h"
 #include "core-hash.h"
 #include "core-ignite-cpu.h"
+#include "core-huge-text.h"
+#include "core-interference.h"
 #include "core-interrupts.h"
 #include "core-io-priority.h"
 #include "core-job.h"
+#include "core-jsonl.h"
+#include "core-killpid.h"
 #include "core-klog.h"
+#include "core-ksm.h"
+#include "core-latency.h"
 #include "core-limit.h"
 #include "core-mlock.h"
 #include "core-numa.h"
+#include "core-ops-rate.h"
+#include "core-profile.h"
 #include "core-opts.h"
 #include "core-out-of-memory.h"
 #include "core-perf.h"
 #include "core-pragma.h"
+#include "core-psi.h"
+#include "core-resctrl.h"
+#include "core-sampler.h"
+#include "core-scale.h"
+#include "core-status.h"
 #include "core-shared-heap.h"
 #include "core-smart.h"
+#include "core-sort.h"
+#include "core-sync-start.h"
+#include "core-taskstats.h"
 #include "core-stressors.h"
 #include "core-syslog.h"
 #include "core-thermal-zone.h"
 #include "core-thrash.h"
+#include "core-victim.h"
 #include "core-vmstat.h"
 
 #include <sched.h>
 
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+
 #if defined(HAVE_SYS_UTSNAME_H)
 #include <sys/utsname.h>
 #endif
@@ -63,6 +93,13 @@
 
 #include <float.h>
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_GETRUSAGE) &&		\
+    defined(RUSAGE_THREAD)
+#include <pthread.h>
+#define STRESS_INSTANCE_THREADS
+#endif
+
 #define MIN_SEQUENTIAL		(0)
 #define MAX_SEQUENTIAL		(1000000)
 #define DEFAULT_SEQUENTIAL	(0)	/* Disabled */
@@ -70,6 +107,12 @@
 #define DEFAULT_TIMEOUT		(60 * 60 * 24)
 #define DEFAULT_BACKOFF		(0)
 #define DEFAULT_CACHE_LEVEL     (3)
+#define MAX_LAUNCHERS		(1024)
+#define BOGO_OVERHEAD_LOOPS	(1000000)
+
+/* --instance-model modes */
+#define INSTANCE_MODEL_PROCESS	(0)	/* one process per instance */
+#define INSTANCE_MODEL_THREAD	(1)	/* one thread per instance */
 
 /* stress_stressor_info ignore value. 2 bits */
 #define STRESS_STRESSOR_NOT_IGNORED		(0)
@@ -129,11 +172,19 @@ stress_sigalrm_info_t sigalrm_info;
 static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_abort,		OPT_FLAGS_ABORT },
 	{ OPT_aggressive,	OPT_FLAGS_AGGRESSIVE_MASK },
+	{ OPT_cgroup_stats,	OPT_FLAGS_CGROUP_STATS },
 	{ OPT_change_cpu,	OPT_FLAGS_CHANGE_CPU },
+	{ OPT_cstate_stats,	OPT_FLAGS_CSTATE_STATS },
 	{ OPT_dry_run,		OPT_FLAGS_DRY_RUN },
+	{ OPT_energy,		OPT_FLAGS_ENERGY },
+	{ OPT_freq_stats,	OPT_FLAGS_FREQ_STATS },
 	{ OPT_ftrace,		OPT_FLAGS_FTRACE },
+	{ OPT_huge_text,	OPT_FLAGS_HUGE_TEXT },
 	{ OPT_ignite_cpu,	OPT_FLAGS_IGNITE_CPU },
+	{ OPT_ignite_cpu_ramp,	OPT_FLAGS_IGNITE_CPU_RAMP },
+	{ OPT_interference,	OPT_FLAGS_INTERFERENCE },
 	{ OPT_interrupts,	OPT_FLAGS_INTERRUPTS },
+	{ OPT_irq_stats,	OPT_FLAGS_IRQ_STATS },
 	{ OPT_keep_files, 	OPT_FLAGS_KEEP_FILES },
 	{ OPT_keep_name, 	OPT_FLAGS_KEEP_NAME },
 	{ OPT_klog_check,	OPT_FLAGS_KLOG_CHECK },
@@ -155,6 +206,7 @@ static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_perf_stats,	OPT_FLAGS_PERF_STATS },
 #endif
 	{ OPT_progress,		OPT_FLAGS_PROGRESS },
+	{ OPT_resctrl_stats,	OPT_FLAGS_RESCTRL_STATS },
 	{ OPT_settings,		OPT_FLAGS_SETTINGS },
 	{ OPT_skip_silent,	OPT_FLAGS_SKIP_SILENT },
 	{ OPT_smart,		OPT_FLAGS_SMART },
@@ -162,6 +214,7 @@ static const stress_opt_flag_t opt_flags[] = {
 	{ OPT_sock_nodelay,	OPT_FLAGS_SOCKET_NODELAY },
 	{ OPT_stderr,		OPT_FLAGS_STDERR },
 	{ OPT_stdout,		OPT_FLAGS_STDOUT },
+	{ OPT_sync_start,	OPT_FLAGS_SYNC_START },
 #if defined(HAVE_SYSLOG_H)
 	{ OPT_syslog,		OPT_FLAGS_SYSLOG },
 #endif
@@ -285,27 +338,49 @@ static const stress_class_info_t stress_classes[] = {
  */
 static const stress_help_t help_generic[] = {
 	{ NULL,		"abort",		"abort all stressors if any stressor fails" },
+	{ NULL,		"agent [A:]P",		"serve cluster controller jobs on TCP port P" },
 	{ NULL,		"aggressive",		"enable all aggressive options" },
 	{ "a N",	"all N",		"start N workers of each stress test" },
 	{ "b N",	"backoff N",		"wait of N microseconds before work starts" },
+	{ NULL,		"benchmark P",		"run the fixed stressors of benchmark profile P and score them" },
+	{ NULL,		"bogo-overhead",	"measure and report the bogo-op counter update overhead" },
+	{ NULL,		"cgroup-cpu-max N",	"limit each stressor's cgroup to N CPUs, implies --cgroup-stats" },
+	{ NULL,		"cgroup-memory-max N",	"limit each stressor's cgroup to N bytes, implies --cgroup-stats" },
+	{ NULL,		"cgroup-stats",		"run each stressor in a cgroup v2 group and report its usage" },
 	{ NULL,		"change-cpu",		"force child processes to use different CPU to that of parent" },
 	{ NULL,		"class name",		"specify a class of stressors, use with --sequential" },
+	{ NULL,		"cluster-secret file",	"read the cluster agent/controller shared secret from file" },
+	{ NULL,		"compare file",		"compare metrics against a baseline YAML file" },
+	{ NULL,		"compare-threshold P",	"regression threshold in percent for --compare" },
+	{ NULL,		"controller H,...",	"run the --job file on cluster agents H in sync" },
+	{ NULL,		"cstate-stats",		"report C-state residency on the CPUs each stressor ran on" },
 	{ "n",		"dry-run",		"do not run" },
+	{ NULL,		"energy",		"report RAPL and hwmon energy, watts and bogo ops per joule" },
+	{ NULL,		"freq-stats",		"report effective CPU GHz and bogo ops/s per GHz of each instance" },
 	{ NULL,		"ftrace",		"enable kernel function call tracing" },
+	{ NULL,		"harness-profile",	"report the time and CPU used by stress-ng harness phases" },
 	{ "h",		"help",			"show help" },
+	{ NULL,		"huge-text",		"remap the stress-ng text segment onto 2MB huge pages" },
 	{ NULL,		"ignite-cpu",		"alter kernel controls to make CPU run hot" },
+	{ NULL,		"ignite-cpu-ramp",	"measure idle to peak CPU frequency ramp times" },
+	{ NULL,		"instance-model M",	"run instances as processes or threads (process, thread)" },
+	{ NULL,		"interference",		"with --permute, run stressors alone and in pairs and report slowdowns" },
 	{ NULL,		"interrupts",		"check for error interrupts" },
 	{ NULL,		"ionice-class C",	"specify ionice class (idle, besteffort, realtime)" },
 	{ NULL,		"ionice-level L",	"specify ionice level (0 max, 7 min)" },
 	{ NULL,		"iostate S",		"show I/O statistics every S seconds" },
+	{ NULL,		"irq-stats",		"report per CPU hard IRQ and softirq counts of each stressor" },
 	{ "j",		"job jobfile",		"run the named jobfile" },
+	{ NULL,		"jsonl file",		"append JSON lines results to file while running" },
 	{ NULL,		"keep-files",		"do not remove files or directories" },
 	{ "k",		"keep-name",		"keep stress worker names to be 'stress-ng'" },
 	{ NULL,		"klog-check",		"check kernel message log for errors" },
 	{ NULL,		"ksm",			"enable kernel samepage merging" },
+	{ NULL,		"launcher N",		"spawn stressor instances from N parallel launcher processes" },
 	{ NULL,		"log-brief",		"less verbose log messages" },
 	{ NULL,		"log-file filename",	"log messages to a log file" },
 	{ NULL,		"log-lockless",		"log messages without message locking" },
+	{ NULL,		"log-ring",		"log stressor messages via per instance rings" },
 	{ NULL,		"maximize",		"enable maximum stress options" },
 	{ NULL,		"max-fd N",		"set maximum file descriptor limit" },
 	{ NULL,		"mbind",		"set NUMA memory binding to specific nodes" },
@@ -315,19 +390,29 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"no-madvise",		"don't use random madvise options for each mmap" },
 	{ NULL,		"no-oom-adjust",	"disable all forms of out-of-memory score adjustments" },
 	{ NULL,		"no-rand-seed",		"seed random numbers with the same constant" },
+	{ NULL,		"numa-policy P",	"set per instance NUMA memory policy local, interleave, remote or nodeN" },
 	{ NULL,		"oom-avoid",		"Try to avoid stressors from being OOM'd" },
 	{ NULL,		"oom-avoid-bytes N",	"Number of bytes free to stop further memory allocations" },
 	{ NULL,		"oomable",		"Do not respawn a stressor if it gets OOM'd" },
+	{ NULL,		"ops-rate N",		"pace each stressor instance to N bogo ops per second" },
 	{ NULL,		"page-in",		"touch allocated pages that are not in core" },
 	{ NULL,		"parallel N",		"synonym for 'all N'" },
 	{ NULL,		"pathological",		"enable stressors that are known to hang a machine" },
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ NULL,		"perf",			"display perf statistics" },
+	{ NULL,		"perf-events list",	"gather only the comma separated list of perf events" },
+	{ NULL,		"perf-metric N=expr",	"add perf metric N derived from perf event expression expr" },
 #endif
 	{ NULL,		"permute N",		"run permutations of stressors with N stressors per permutation" },
+	{ NULL,		"placement policy",	"pin instances using compact, scatter, per-llc, per-numa or smt-pair" },
+	{ NULL,		"psistat S",		"show pressure stall information every S seconds" },
 	{ "q",		"quiet",		"quiet output" },
 	{ "r",		"random N",		"start N random workers" },
+	{ NULL,		"resctrl S:L,...",	"run stressor S in a resctrl group with schemata lines L" },
+	{ NULL,		"resctrl-stats",	"report per stressor resctrl LLC occupancy and DRAM bandwidth" },
+	{ NULL,		"sample-interval S",	"sample bogo-op counters every S seconds" },
+	{ NULL,		"scale-sweep L",	"run stressors with each instance count in list L, report scaling" },
 	{ NULL,		"sched type",		"set scheduler type" },
 	{ NULL,		"sched-prio N",		"set scheduler priority level N" },
 	{ NULL,		"sched-period N",	"set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
@@ -339,14 +424,19 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"skip-silent",		"silently skip unimplemented stressors" },
 	{ NULL,		"smart",		"show changes in S.M.A.R.T. data" },
 	{ NULL,		"sn",			"use scientific notation for metrics" },
+	{ NULL,		"sort-dist D",		"sort stressor input distribution, random, sorted, reverse, nearly, ..." },
+	{ NULL,		"sort-dist-swaps K",	"number of swaps in nearly sorted data for --sort-dist nearly" },
 	{ NULL,		"status S",		"show stress-ng progress status every S seconds" },
+	{ NULL,		"status-socket P",	"serve live status in prometheus format on UNIX socket P" },
 	{ NULL,		"stderr",		"all output to stderr" },
 	{ NULL,		"stdout",		"all output to stdout (now the default)" },
 	{ NULL,		"stressors",		"show available stress tests" },
+	{ NULL,		"sync-start",		"start all instances together once they are set up" },
 #if defined(HAVE_SYSLOG_H)
 	{ NULL,		"syslog",		"log messages to the syslog" },
 #endif
 	{ NULL,		"taskset",		"use specific CPUs (set CPU affinity)" },
+	{ NULL,		"taskstats",		"report per stressor taskstats delay accounting (Linux only)" },
 	{ NULL,		"temp-path path",	"specify path for temporary directories and files" },
 	{ NULL,		"thermalstat S",	"show CPU and thermal load stats every S seconds" },
 	{ NULL,		"thrash",		"force all pages in causing swap thrashing" },
@@ -357,11 +447,17 @@ static const stress_help_t help_generic[] = {
 #if defined(STRESS_THERMAL_ZONES)
 	{ NULL,		"tz",			"collect temperatures from thermal zones (Linux only)" },
 #endif
+	{ NULL,		"until-stable P",	"stop stressors once bogo-op rate varies by less than P%" },
+	{ NULL,		"until-stable-window N","use last N bogo-op rate samples for --until-stable" },
 	{ "v",		"verbose",		"verbose output" },
 	{ NULL,		"verify",		"verify results (not available on all tests)" },
 	{ NULL,		"verifiable",		"show stressors that enable verification via --verify" },
 	{ "V",		"version",		"show version" },
+	{ NULL,		"victim S",		"measure stressor S alone and with the other stressors ramped up" },
+	{ NULL,		"victim-steps N",	"ramp the --victim aggressor stressors up in N steps" },
+	{ NULL,		"victim-taskset L",	"run the --victim stressor on CPUs L and the aggressors on the rest" },
 	{ NULL,		"vmstat S",		"show memory and process statistics every S seconds" },
+	{ NULL,		"warmup N",		"exclude the first N seconds of each instance from the metrics" },
 	{ "x",		"exclude list",		"list of stressors to exclude (not run)" },
 	{ NULL,		"with list",		"list of stressors to invoke (use with --seq or --all)" },
 	{ "Y",		"yaml file",		"output results to YAML formatted file" },
@@ -374,7 +470,7 @@ static const stress_help_t help_generic[] = {
  */
 static inline void stress_hash_checksum(stress_checksum_t *checksum)
 {
-	checksum->hash = stress_hash_jenkin((uint8_t *)&checksum->data,
+	checksum->hash = stress_hash_crc32c_len((uint8_t *)&checksum->data,
 				sizeof(checksum->data));
 }
 
@@ -645,6 +741,10 @@ static void MLOCKED_TEXT stress_stats_handler(int signum)
 
 	(void)signum;
 
+	/* The status process can print the full status safely */
+	if (stress_status_notify())
+		return;
+
 	*ptr = '\0';
 
 	if (stress_get_load_avg(&min1, &min5, &min15) == 0) {
@@ -658,12 +758,11 @@ static void MLOCKED_TEXT stress_stats_handler(int signum)
 	}
 	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
 
-	(void)snprintf(ptr, (size_t)(buffer - ptr),
-		"MemFree: %zu MB, MemTotal: %zu MB",
+	(void)snprintf(ptr, (size_t)(sizeof(buffer) - (size_t)(ptr - buffer)),
+		"MemFree: %zu MB, MemTotal: %zu MB\n",
 		freemem / (size_t)MB, totalmem / (size_t)MB);
-	/* Really shouldn't do this in a signal handler */
-	(void)fprintf(stdout, "%s\n", buffer);
-	(void)fflush(stdout);
+	/* Avoid stdio in a signal handler, write directly */
+	VOID_RET(ssize_t, write(STDOUT_FILENO, buffer, strlen(buffer)));
 }
 #endif
 
@@ -915,16 +1014,189 @@ static const char * PURE stress_exit_status_to_string(const int status)
 	return "unknown";
 }
 
+/*
+ *  Event driven stressor reaping, a pidfd per stressor process
+ *  becomes readable when the process exits so the parent sleeps
+ *  in epoll_wait and reaps each instance in exit order with an
+ *  exact exit timestamp rather than waiting in list order
+ */
+typedef struct {
+	stress_stressor_t *ss;		/* stressor */
+	stress_stats_t *stats;		/* instance stats */
+	int32_t instance;		/* instance number */
+} stress_wait_pidfd_t;
+
+typedef struct {
+	stress_event_reap_t *reap;	/* epoll reaper, NULL if not used */
+	stress_wait_pidfd_t *fd_map;	/* instance info indexed by pidfd */
+	int *ready;			/* ready pidfds */
+	int max_fd;			/* fd_map size */
+	size_t pending;			/* pidfds still to be reaped */
+} stress_wait_pidfds_t;
+
+static void stress_wait_pid(stress_stressor_t *ss, const pid_t pid,
+	const char *stressor_name, stress_stats_t *stats, const double exited,
+	bool *success, bool *resource_success, bool *metrics_success);
+
+/*
+ *  stress_wait_pidfds_deinit()
+ *	close remaining pidfds and free the reaper
+ */
+static void stress_wait_pidfds_deinit(stress_wait_pidfds_t *w)
+{
+	int fd;
+
+	if (w->fd_map) {
+		for (fd = 0; fd < w->max_fd; fd++) {
+			if (w->fd_map[fd].stats)
+				(void)close(fd);
+		}
+	}
+	stress_event_reap_destroy(w->reap);
+	free(w->fd_map);
+	free(w->ready);
+	(void)shim_memset(w, 0, sizeof(*w));
+}
+
+/*
+ *  stress_wait_pidfds_init()
+ *	open a pidfd for each stressor process and add them to an
+ *	epoll reaper, processes without a pidfd (e.g. no pidfd_open
+ *	support or out of file descriptors) are left for the list
+ *	order waitpid reaping. Returns false if nothing is watched.
+ */
+static bool stress_wait_pidfds_init(
+	stress_wait_pidfds_t *w,
+	stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t n = 0;
+
+	(void)shim_memset(w, 0, sizeof(*w));
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		n += (size_t)(ss->threaded ? 1 : ss->num_instances);
+	}
+	if (n == 0)
+		return false;
+	w->reap = stress_event_reap_create(STRESS_EVENT_REAP_EPOLL, n);
+	if (!w->reap)
+		return false;
+	w->ready = (int *)calloc(n, sizeof(*w->ready));
+	if (!w->ready)
+		goto err;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		for (j = 0; j < (ss->threaded ? 1 : ss->num_instances); j++) {
+			stress_stats_t *const stats = ss->stats[j];
+			int pidfd;
+
+			if (!stats->pid)
+				continue;
+			pidfd = shim_pidfd_open(stats->pid, 0);
+			if (pidfd < 0) {
+				if (errno == ENOSYS)
+					goto err;
+				continue;
+			}
+			if (pidfd >= w->max_fd) {
+				const int max_fd = STRESS_MAXIMUM(pidfd + 1, w->max_fd * 2);
+				stress_wait_pidfd_t *fd_map;
+
+				fd_map = (stress_wait_pidfd_t *)realloc(w->fd_map, (size_t)max_fd * sizeof(*fd_map));
+				if (!fd_map) {
+					(void)close(pidfd);
+					goto err;
+				}
+				(void)shim_memset(fd_map + w->max_fd, 0,
+					(size_t)(max_fd - w->max_fd) * sizeof(*fd_map));
+				w->fd_map = fd_map;
+				w->max_fd = max_fd;
+			}
+			if (stress_event_reap_add(w->reap, pidfd) < 0) {
+				(void)close(pidfd);
+				continue;
+			}
+			w->fd_map[pidfd].ss = ss;
+			w->fd_map[pidfd].stats = stats;
+			w->fd_map[pidfd].instance = j;
+			w->pending++;
+		}
+	}
+	if (w->pending)
+		return true;
+err:
+	stress_wait_pidfds_deinit(w);
+	return false;
+}
+
+/*
+ *  stress_wait_pidfds_reap()
+ *	wait up to timeout_ms milliseconds (-1 to wait) for stressor
+ *	processes to exit and reap them
+ */
+static void stress_wait_pidfds_reap(
+	stress_wait_pidfds_t *w,
+	const int timeout_ms,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	int i, n;
+	double exited;
+
+	if (!w->pending)
+		return;
+	n = stress_event_reap_wait(w->reap, w->ready, (int)w->pending, timeout_ms);
+	if (n < 0) {
+		/* fall back to list order waitpid reaping */
+		stress_wait_pidfds_deinit(w);
+		return;
+	}
+	exited = stress_time_now();
+
+	for (i = 0; i < n; i++) {
+		const int pidfd = w->ready[i];
+		stress_wait_pidfd_t *const info = &w->fd_map[pidfd];
+		stress_stats_t *const stats = info->stats;
+		const pid_t pid = stats->pid;
+		char munged[64];
+
+		/* closing the pidfd removes it from the epoll set */
+		(void)close(pidfd);
+		info->stats = NULL;
+		w->pending--;
+
+		if (!pid)
+			continue;
+		(void)stress_munge_underscore(munged, info->ss->stressor->name, sizeof(munged));
+		stress_wait_pid(info->ss, pid, munged, stats, exited,
+			success, resource_success, metrics_success);
+		stress_clean_dir(munged, pid, (uint32_t)info->instance);
+	}
+}
+
 #if defined(HAVE_SCHED_GETAFFINITY) &&	\
     NEED_GLIBC(2,3,0)
 /*
  *  stress_wait_aggressive()
  *	while waiting for stressors to complete add some aggressive
- *	CPU affinity changing to exercise the scheduler placement
+ *	CPU affinity changing to exercise the scheduler placement,
+ *	exited stressors are reaped between the affinity changes
+ *	when pidfds are being used
  */
 static void stress_wait_aggressive(
 	const int32_t ticks_per_sec,
-	stress_stressor_t *stressors_list)
+	stress_stressor_t *stressors_list,
+	stress_wait_pidfds_t *w,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
 {
 	stress_stressor_t *ss;
 	cpu_set_t proc_mask;
@@ -944,7 +1216,11 @@ static void stress_wait_aggressive(
 		if (!CPU_COUNT(&proc_mask))	/* Highly unlikely */
 			return;
 
-		(void)shim_usleep(usec_sleep);
+		if (w->reap)
+			stress_wait_pidfds_reap(w, (int)((usec_sleep + 999) / 1000),
+				success, resource_success, metrics_success);
+		else
+			(void)shim_usleep(usec_sleep);
 
 		for (ss = stressors_list; ss; ss = ss->next) {
 			int32_t j;
@@ -956,11 +1232,25 @@ static void stress_wait_aggressive(
 				if (pid) {
 					cpu_set_t mask;
 					int32_t cpu_num;
+#if defined(HAVE_WAITID) &&	\
+    defined(WNOWAIT)
+					siginfo_t info;
+
+					/* check for exit without reaping the exit status */
+					(void)shim_memset(&info, 0, sizeof(info));
+					if (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG | WNOWAIT) < 0) {
+						if (errno == ECHILD)
+							continue;
+					} else if (info.si_pid == pid) {
+						continue;
+					}
+#else
 					int status, ret;
 
 					ret = waitpid(pid, &status, WNOHANG);
 					if ((ret < 0) && (errno == ESRCH))
 						continue;
+#endif
 					procs_alive = true;
 
 					do {
@@ -989,6 +1279,7 @@ static void stress_wait_pid(
 	const pid_t pid,
 	const char *stressor_name,
 	stress_stats_t *stats,
+	const double exited,
 	bool *success,
 	bool *resource_success,
 	bool *metrics_success)
@@ -1001,6 +1292,9 @@ redo:
 	if (ret > 0) {
 		int wexit_status = WEXITSTATUS(status);
 
+		/* exit time from the pidfd wake-up, otherwise when waitpid returned */
+		stats->exited = (exited > 0.0) ? exited : stress_time_now();
+
 		if (WIFSIGNALED(status)) {
 #if defined(WTERMSIG)
 			const int wterm_signal = WTERMSIG(status);
@@ -1093,9 +1387,10 @@ wexit_status_default:
 		}
 
 		stress_stressor_finished(&stats->pid);
-		pr_dbg("%s: [%d] terminated (%s)\n",
+		pr_dbg("%s: [%d] terminated (%s) after %.3f secs\n",
 			stressor_name, ret,
-			stress_exit_status_to_string(wexit_status));
+			stress_exit_status_to_string(wexit_status),
+			stats->exited - stats->start);
 	} else if (ret == -1) {
 		/* Somebody interrupted the wait */
 		if (errno == EINTR)
@@ -1106,6 +1401,34 @@ wexit_status_default:
 	}
 }
 
+/*
+ *  stress_wait_thread()
+ *	account for a stressor instance that was run as a thread,
+ *	the process running the threads has already been waited
+ *	for by instance 0 so the outcome is taken from the stats
+ */
+static void stress_wait_thread(
+	stress_stressor_t *ss,
+	const char *stressor_name,
+	stress_stats_t *stats,
+	const int32_t instance,
+	bool *success,
+	bool *resource_success)
+{
+	if (!stats->completed) {
+		ss->status[STRESS_STRESSOR_STATUS_SKIPPED]++;
+		*resource_success = false;
+	} else if (stats->args.ci.run_ok) {
+		ss->status[STRESS_STRESSOR_STATUS_PASSED]++;
+	} else {
+		ss->status[STRESS_STRESSOR_STATUS_FAILED]++;
+		pr_err("%s: instance %" PRId32 " thread terminated with an error\n",
+			stressor_name, instance);
+		*success = false;
+	}
+	stress_stressor_finished(&stats->pid);
+}
+
 /*
  *  stress_wait_stressors()
  * 	wait for stressor child processes
@@ -1118,7 +1441,12 @@ static void stress_wait_stressors(
 	bool *metrics_success)
 {
 	stress_stressor_t *ss;
+	stress_wait_pidfds_t w;
+	const bool harness_profile = stress_harness_profile_enabled();
 
+	if (harness_profile)
+		stress_harness_profile_parent_begin();
+	(void)stress_wait_pidfds_init(&w, stressors_list);
 #if defined(HAVE_SCHED_GETAFFINITY) &&	\
     NEED_GLIBC(2,3,0)
 	/*
@@ -1128,10 +1456,17 @@ static void stress_wait_stressors(
 	 *  try to thrash the system when in aggressive mode
 	 */
 	if (g_opt_flags & OPT_FLAGS_AGGRESSIVE)
-		stress_wait_aggressive(ticks_per_sec, stressors_list);
+		stress_wait_aggressive(ticks_per_sec, stressors_list, &w,
+			success, resource_success, metrics_success);
 #else
 	(void)ticks_per_sec;
 #endif
+	/* reap stressor processes in exit order */
+	while (w.reap && w.pending)
+		stress_wait_pidfds_reap(&w, -1, success, resource_success, metrics_success);
+	stress_wait_pidfds_deinit(&w);
+
+	/* reap any remaining processes and account for threaded instances */
 	for (ss = stressors_list; ss; ss = ss->next) {
 		int32_t j;
 
@@ -1146,13 +1481,18 @@ static void stress_wait_stressors(
 				char munged[64];
 
 				(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
-				stress_wait_pid(ss, pid, munged, stats, success, resource_success, metrics_success);
+				if (ss->threaded && (j > 0))
+					stress_wait_thread(ss, munged, stats, j, success, resource_success);
+				else
+					stress_wait_pid(ss, pid, munged, stats, 0.0, success, resource_success, metrics_success);
 				stress_clean_dir(munged, pid, (uint32_t)j);
 			}
 		}
 	}
 	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU)
 		stress_ignite_cpu_stop();
+	if (harness_profile)
+		stress_harness_profile_parent_end();
 }
 
 /*
@@ -1335,22 +1675,45 @@ static void stress_getrusage(const int who, stress_stats_t *stats)
 #else
 		stats->rusage_maxrss = 0;	/* Not available */
 #endif
+		stats->rusage_counts.nvcsw += (uint64_t)usage.ru_nvcsw;
+		stats->rusage_counts.nivcsw += (uint64_t)usage.ru_nivcsw;
+		stats->rusage_counts.minflt += (uint64_t)usage.ru_minflt;
+		stats->rusage_counts.majflt += (uint64_t)usage.ru_majflt;
 	}
 }
 #endif
 
-static void stress_get_usage_stats(const int32_t ticks_per_sec, stress_stats_t *stats)
+/*
+ *  stress_get_usage_stats()
+ *	get user and system time of a stressor instance, threaded
+ *	instances only account for the time of the calling thread
+ */
+static void stress_get_usage_stats(
+	const int32_t ticks_per_sec,
+	stress_stats_t *stats,
+	const bool threaded)
 {
 #if defined(HAVE_GETRUSAGE)
 	(void)ticks_per_sec;
 
 	stats->rusage_utime = 0.0;
 	stats->rusage_stime = 0.0;
-	stress_getrusage(RUSAGE_SELF, stats);
-	stress_getrusage(RUSAGE_CHILDREN, stats);
+	(void)shim_memset(&stats->rusage_counts, 0, sizeof(stats->rusage_counts));
+#if defined(STRESS_INSTANCE_THREADS)
+	if (threaded) {
+		stress_getrusage(RUSAGE_THREAD, stats);
+	} else
+#else
+	(void)threaded;
+#endif
+	{
+		stress_getrusage(RUSAGE_SELF, stats);
+		stress_getrusage(RUSAGE_CHILDREN, stats);
+	}
 #else
 	struct tms t;
 
+	(void)threaded;
 	stats->rusage_utime = 0.0;
 	stats->rusage_stime = 0.0;
 	(void)shim_memset(&t, 0, sizeof(t));
@@ -1365,6 +1728,247 @@ static void stress_get_usage_stats(const int32_t ticks_per_sec, stress_stats_t *
 	stats->rusage_stime_total += stats->rusage_stime;
 }
 
+/*
+ *  stress_rusage_counts_sub()
+ *	subtract the --warmup snapshot counts from the counts of the
+ *	last run and from the totals, clamped to avoid wrapping
+ */
+static void stress_rusage_counts_sub(
+	stress_rusage_counts_t *counts,
+	stress_rusage_counts_t *total,
+	const stress_rusage_counts_t *snapshot)
+{
+	const uint64_t nvcsw = STRESS_MINIMUM(snapshot->nvcsw, counts->nvcsw);
+	const uint64_t nivcsw = STRESS_MINIMUM(snapshot->nivcsw, counts->nivcsw);
+	const uint64_t minflt = STRESS_MINIMUM(snapshot->minflt, counts->minflt);
+	const uint64_t majflt = STRESS_MINIMUM(snapshot->majflt, counts->majflt);
+
+	counts->nvcsw -= nvcsw;
+	counts->nivcsw -= nivcsw;
+	counts->minflt -= minflt;
+	counts->majflt -= majflt;
+	total->nvcsw -= nvcsw;
+	total->nivcsw -= nivcsw;
+	total->minflt -= minflt;
+	total->majflt -= majflt;
+}
+
+/*
+ *  stress_run_instance()
+ *	set up the stressor arguments and invoke the
+ *	stressor for the given instance
+ */
+static int MLOCKED_TEXT stress_run_instance(
+	const char *name,
+	stress_stats_t *const stats,
+	stress_checksum_t *const checksum,
+	const int32_t instance,
+	const pid_t pid,
+	const size_t page_size)
+{
+	int rc;
+
+	stats->args.name = name,
+	stats->args.max_ops = g_stressor_current->bogo_ops,
+	stats->args.instance = (uint32_t)instance,
+	stats->args.num_instances = (uint32_t)g_stressor_current->num_instances,
+	stats->args.pid = pid,
+	stats->args.page_size = page_size,
+	stats->args.time_end = stress_time_now() + (double)g_opt_timeout,
+	stats->args.mapped = &g_shared->mapped,
+	stats->args.metrics = &stats->metrics,
+	stats->args.latency = &stats->latency,
+	stats->args.ops_rate = stress_ops_rate_init(&stats->ops_rate,
+		stress_victim_is(g_stressor_current)),
+	stats->args.info = g_stressor_current->stressor->info;
+
+	stress_set_oom_adjustment(&stats->args, false);
+
+	(void)shim_memset(checksum, 0, sizeof(*checksum));
+	(void)shim_memset(&stats->warmup, 0, sizeof(stats->warmup));
+	stats->start = stress_time_now();
+	stats->cycles = stress_cycles_get();
+	rc = g_stressor_current->stressor->info->stressor(&stats->args);
+	stats->cycles = stress_cycles_get() -
+		((stats->warmup.time > 0.0) ? stats->warmup.cycles : stats->cycles);
+
+	return rc;
+}
+
+/*
+ *  stress_finish_instance()
+ *	mark a stressor instance as completed, check the
+ *	bogo-ops counter state and checksum the counter
+ */
+static void MLOCKED_TEXT stress_finish_instance(
+	const char *name,
+	stress_stats_t *const stats,
+	stress_checksum_t *const checksum,
+	int *const rc)
+{
+	bool ok;
+
+	pr_fail_check(rc);
+	stats->completed = true;
+	ok = (*rc == EXIT_SUCCESS);
+	stats->args.ci.run_ok = ok;
+	checksum->data.ci.run_ok = ok;
+	/* Ensure reserved padding is zero to not confuse checksum */
+	(void)shim_memset(checksum->data.pad, 0, sizeof(checksum->data.pad));
+
+	stress_set_proc_state(name, STRESS_STATE_STOP);
+	/*
+	 *  Bogo ops counter should be OK for reading,
+	 *  if not then flag up that the counter may
+	 *  be untrustyworthy
+	 */
+	if ((!stats->args.ci.counter_ready) && (!stats->args.ci.force_killed)) {
+		pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
+			"metrics are untrustworthy (process may have been "
+			"terminated prematurely)\n",
+			name);
+		*rc = EXIT_METRICS_UNTRUSTWORTHY;
+	}
+	checksum->data.ci.counter = stats->args.ci.counter;
+	stress_hash_checksum(checksum);
+}
+
+/*
+ *  stress_account_instance()
+ *	accumulate run time, bogo-ops and usage totals
+ *	of a stressor instance, if a --warmup snapshot was
+ *	taken only the run after the snapshot is accounted
+ */
+static void stress_account_instance(
+	const int32_t ticks_per_sec,
+	stress_stats_t *const stats,
+	const double finish,
+	const bool threaded)
+{
+	const stress_warmup_t *warmup = &stats->warmup;
+	const bool warm = (warmup->time > stats->start) && (warmup->time < finish);
+
+	stats->duration = finish - stats->start;
+	stats->counter_total += stats->args.ci.counter - (warm ? warmup->counter : 0);
+	stats->cycles_total += stats->cycles;
+	stats->duration_total += warm ? finish - warmup->time : stats->duration;
+
+	stress_get_usage_stats(ticks_per_sec, stats, threaded);
+	stats->rusage_counts_total.nvcsw += stats->rusage_counts.nvcsw;
+	stats->rusage_counts_total.nivcsw += stats->rusage_counts.nivcsw;
+	stats->rusage_counts_total.minflt += stats->rusage_counts.minflt;
+	stats->rusage_counts_total.majflt += stats->rusage_counts.majflt;
+
+	/* the snapshot CPU times are per process, so can't be used for threads */
+	if (warm && !threaded) {
+		const double utime = STRESS_MINIMUM(warmup->utime, stats->rusage_utime);
+		const double stime = STRESS_MINIMUM(warmup->stime, stats->rusage_stime);
+
+		stats->rusage_utime -= utime;
+		stats->rusage_stime -= stime;
+		stats->rusage_utime_total -= utime;
+		stats->rusage_stime_total -= stime;
+		stress_rusage_counts_sub(&stats->rusage_counts,
+			&stats->rusage_counts_total, &warmup->counts);
+	}
+}
+
+#if defined(STRESS_INSTANCE_THREADS)
+/* Per instance thread information */
+typedef struct {
+	pthread_t pthread;		/* instance thread */
+	const char *name;		/* munged stressor name */
+	stress_stats_t *stats;		/* instance stats */
+	int32_t instance;		/* instance number */
+	int32_t ticks_per_sec;		/* clock ticks per second */
+	pid_t pid;			/* pid of process running the threads */
+	size_t page_size;		/* page size */
+	int rc;				/* instance return code */
+} stress_instance_thread_t;
+
+/*
+ *  stress_instance_thread()
+ *	run a stressor instance in a pthread
+ */
+static void *stress_instance_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_instance_thread_t *thread = (stress_instance_thread_t *)arg;
+	stress_stats_t *const stats = thread->stats;
+
+	pr_dbg("%s: [%d] started (instance %" PRIu32 " as a thread on CPU %u)\n",
+		thread->name, (int)thread->pid, thread->instance, stress_get_cpu());
+	thread->rc = stress_run_instance(thread->name, stats, stats->checksum,
+			thread->instance, thread->pid, thread->page_size);
+	stress_block_signals();
+	stress_finish_instance(thread->name, stats, stats->checksum, &thread->rc);
+	stress_account_instance(thread->ticks_per_sec, stats, stress_time_now(), true);
+
+	return &nowt;
+}
+
+/*
+ *  stress_run_instance_threads()
+ *	run all the instances of the current stressor as
+ *	pthreads in this process, each thread updates the
+ *	stats of its own instance. Returns the return code
+ *	of instance 0, the parent accounts for the other
+ *	instances from their stats.
+ */
+static int MLOCKED_TEXT stress_run_instance_threads(
+	const char *name,
+	const pid_t pid,
+	const int32_t ticks_per_sec,
+	const size_t page_size)
+{
+	const int32_t n = g_stressor_current->num_instances;
+	stress_instance_thread_t *threads;
+	int32_t j, started;
+	int rc;
+
+	threads = (stress_instance_thread_t *)calloc((size_t)n, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRId32 " instance threads, skipping stressor\n",
+			name, n);
+		return EXIT_NO_RESOURCE;
+	}
+
+	for (started = 0; started < n; started++) {
+		stress_instance_thread_t *const thread = &threads[started];
+		int ret;
+
+		thread->name = name;
+		thread->stats = g_stressor_current->stats[started];
+		thread->instance = started;
+		thread->ticks_per_sec = ticks_per_sec;
+		thread->pid = pid;
+		thread->page_size = page_size;
+		thread->rc = EXIT_NO_RESOURCE;
+
+		ret = pthread_create(&thread->pthread, NULL, stress_instance_thread, thread);
+		if (ret) {
+			pr_inf("%s: cannot create thread for instance %" PRId32 ", errno=%d (%s)\n",
+				name, started, ret, strerror(ret));
+			break;
+		}
+	}
+	for (j = 0; j < started; j++)
+		(void)pthread_join(threads[j].pthread, NULL);
+	rc = threads[0].rc;
+	free(threads);
+
+	stress_block_signals();
+	(void)alarm(0);
+	if (g_opt_flags & OPT_FLAGS_INTERRUPTS) {
+		stress_interrupts_stop(g_stressor_current->stats[0]->interrupts);
+		stress_interrupts_check_failure(name, g_stressor_current->stats[0]->interrupts, 0, &rc);
+	}
+	if (g_opt_flags & OPT_FLAGS_CSTATE_STATS)
+		stress_cpuidle_stats_stop(&g_stressor_current->stats[0]->cstates);
+	return rc;
+}
+#endif
+
 /*
  *  stress_run_child()
  *	invoke a stressor in a child process
@@ -1384,11 +1988,22 @@ static int MLOCKED_TEXT stress_run_child(
 	pid_t child_pid;
 	char name[64];
 	int rc = EXIT_SUCCESS;
-	bool ok;
 	double finish, run_duration;
-
+	stress_harness_profile_t *const harness = &stats->harness;
+	const bool harness_profile = stress_harness_profile_enabled();
+	double run_end = 0.0, run_end_cpu = 0.0;
+
+	stats->spawn_latency = stress_time_now() - fork_time_start;
+	harness->valid = false;
+	harness->checksum = 0.0;
+	if (harness_profile)
+		stress_settings_profile_start();
 	sigalarmed = &stats->sigalarmed;
 	child_pid = getpid();
+	/* threaded instances share a process so can't share a single producer ring */
+	if (!g_stressor_current->threaded)
+		pr_ring_attach((int32_t)(stats - g_shared->stats));
+	stress_set_proc_state_shared(&stats->state);
 
 	(void)stress_munge_underscore(name, g_stressor_current->stressor->name, sizeof(name));
 	stress_set_proc_state(name, STRESS_STATE_START);
@@ -1412,6 +2027,15 @@ static int MLOCKED_TEXT stress_run_child(
 	stress_mwc_reseed();
 	stress_set_max_limits();
 	stress_set_iopriority(ionice_class, ionice_level);
+	stress_placement_set(name, instance);
+	if (stress_victim_enabled())
+		stress_victim_taskset_set(name, stress_victim_is(g_stressor_current));
+	stress_numa_policy_apply(name);
+	if (!g_stressor_current->threaded) {
+		stress_cgroup_attach(g_stressor_current);
+		stress_sync_start_attach(stats);
+	}
+	stress_resctrl_attach(g_stressor_current);
 	(void)umask(0077);
 
 	pr_dbg("%s: [%d] started (instance %" PRIu32 " on CPU %u)\n",
@@ -1419,6 +2043,8 @@ static int MLOCKED_TEXT stress_run_child(
 
 	if (g_opt_flags & OPT_FLAGS_INTERRUPTS)
 		stress_interrupts_start(stats->interrupts);
+	if (g_opt_flags & OPT_FLAGS_CSTATE_STATS)
+		stress_cpuidle_stats_start(&stats->cstates);
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
@@ -1432,32 +2058,38 @@ static int MLOCKED_TEXT stress_run_child(
 #endif
 	stress_yield_sleep_ms();
 	stats->start = stress_time_now();
+	if (harness_profile) {
+		harness->setup = stats->start - fork_time_start;
+		harness->setup_cpu = stress_harness_profile_cpu_time();
+	}
 	if (g_opt_timeout)
 		(void)alarm((unsigned int)g_opt_timeout);
 	if (stress_continue_flag() && !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
-		stats->args.name = name,
-		stats->args.max_ops = g_stressor_current->bogo_ops,
-		stats->args.instance = (uint32_t)instance,
-		stats->args.num_instances = (uint32_t)g_stressor_current->num_instances,
-		stats->args.pid = child_pid,
-		stats->args.page_size = page_size,
-		stats->args.time_end = stress_time_now() + (double)g_opt_timeout,
-		stats->args.mapped = &g_shared->mapped,
-		stats->args.metrics = &stats->metrics,
-		stats->args.info = g_stressor_current->stressor->info;
-
-		stress_set_oom_adjustment(&stats->args, false);
-
-		(void)shim_memset(*checksum, 0, sizeof(**checksum));
-		stats->start = stress_time_now();
-		rc = g_stressor_current->stressor->info->stressor(&stats->args);
+#if defined(STRESS_INSTANCE_THREADS)
+		if (g_stressor_current->threaded) {
+			rc = stress_run_instance_threads(name, child_pid,
+					ticks_per_sec, page_size);
+			if (harness_profile) {
+				run_end = stress_time_now();
+				run_end_cpu = stress_harness_profile_cpu_time();
+			}
+			goto instances_done;
+		}
+#endif
+		rc = stress_run_instance(name, stats, *checksum,
+				instance, child_pid, page_size);
+		if (harness_profile) {
+			run_end = stress_time_now();
+			run_end_cpu = stress_harness_profile_cpu_time();
+		}
 		stress_block_signals();
 		(void)alarm(0);
 		if (g_opt_flags & OPT_FLAGS_INTERRUPTS) {
 			stress_interrupts_stop(stats->interrupts);
 			stress_interrupts_check_failure(name, stats->interrupts, instance, &rc);
 		}
-		pr_fail_check(&rc);
+		if (g_opt_flags & OPT_FLAGS_CSTATE_STATS)
+			stress_cpuidle_stats_stop(&stats->cstates);
 #if defined(SA_SIGINFO) &&	\
     defined(SI_USER)
 		/*
@@ -1480,29 +2112,18 @@ static int MLOCKED_TEXT stress_run_child(
 			}
 		}
 #endif
-		stats->completed = true;
-		ok = (rc == EXIT_SUCCESS);
-		stats->args.ci.run_ok = ok;
-		(*checksum)->data.ci.run_ok = ok;
-		/* Ensure reserved padding is zero to not confuse checksum */
-		(void)shim_memset((*checksum)->data.pad, 0, sizeof((*checksum)->data.pad));
+		if (harness_profile) {
+			const double t = stress_time_now();
 
-		stress_set_proc_state(name, STRESS_STATE_STOP);
-		/*
-		 *  Bogo ops counter should be OK for reading,
-		 *  if not then flag up that the counter may
-		 *  be untrustyworthy
-		 */
-		if ((!stats->args.ci.counter_ready) && (!stats->args.ci.force_killed)) {
-			pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
-				"metrics are untrustworthy (process may have been "
-				"terminated prematurely)\n",
-				name);
-			rc = EXIT_METRICS_UNTRUSTWORTHY;
+			stress_finish_instance(name, stats, *checksum, &rc);
+			harness->checksum = stress_time_now() - t;
+		} else {
+			stress_finish_instance(name, stats, *checksum, &rc);
 		}
-		(*checksum)->data.ci.counter = stats->args.ci.counter;
-		stress_hash_checksum(*checksum);
 	}
+#if defined(STRESS_INSTANCE_THREADS)
+instances_done:
+#endif
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
@@ -1514,12 +2135,19 @@ static int MLOCKED_TEXT stress_run_child(
 	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
 		(void)stress_tz_get_temperatures(&g_shared->tz_info, &stats->tz);
 #endif
+	if (stress_taskstats_enabled())
+		(void)stress_taskstats_get(child_pid, &stats->taskstats);
+	stress_sync_start_leave();
 	finish = stress_time_now();
-	stats->duration = finish - stats->start;
-	stats->counter_total += stats->args.ci.counter;
-	stats->duration_total += stats->duration;
+	if (!g_stressor_current->threaded) {
+		stress_account_instance(ticks_per_sec, stats, finish, false);
+		stress_jsonl_instance(g_stressor_current, instance);
+	} else {
+		int32_t j;
 
-	stress_get_usage_stats(ticks_per_sec, stats);
+		for (j = 0; j < g_stressor_current->num_instances; j++)
+			stress_jsonl_instance(g_stressor_current, j);
+	}
 	pr_dbg("%s: [%d] exited (instance %" PRIu32 " on CPU %d)\n",
 		name, (int)child_pid, instance, stress_get_cpu());
 
@@ -1532,6 +2160,7 @@ static int MLOCKED_TEXT stress_run_child(
 	 */
 	if (stats->args.ci.run_ok &&
 	    (g_shared && !g_shared->caught_sigint) &&
+	    !stress_sampler_until_stable() &&
 	    (run_duration < (double)g_opt_timeout) &&
 	    (!(g_stressor_current->bogo_ops && stats->args.ci.counter >= g_stressor_current->bogo_ops))) {
 
@@ -1557,69 +2186,370 @@ child_exit:
 	if (rc == EXIT_FAILURE)
 		g_shared->instance_count.failed++;
 
+	stress_shared_heap_flush();
+
+	/* run_end is only set if the stressor was actually run */
+	if (harness_profile && (run_end > 0.0)) {
+		harness->end = stress_time_now();
+		harness->run = run_end - stats->start;
+		harness->teardown = harness->end - run_end;
+		harness->teardown_cpu = stress_harness_profile_cpu_time() - run_end_cpu;
+		stress_settings_profile_get(&harness->setting_lookups, &harness->setting_time);
+		harness->valid = true;
+	}
 	return rc;
 }
 
+#if defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(PR_SET_CHILD_SUBREAPER)
 /*
- *  stress_run()
- *	kick off and run stressors
+ *  stress_run_launchers()
+ *	spawn the stressor instances from launcher processes, each
+ *	launcher forks an interleaved share of all the instances so
+ *	that instances of all the stressors are started in parallel
+ *	batches rather than one at a time from the main process. The
+ *	main process is made a child subreaper so the instances are
+ *	re-parented to it when the launchers exit and can then be
+ *	waited for as normal. Returns the number of instances started
+ *	or -1 if launchers cannot be used.
  */
-static void MLOCKED_TEXT stress_run(
-	const int32_t ticks_per_sec,
+static int32_t stress_run_launchers(
 	stress_stressor_t *stressors_list,
-	double *duration,
-	bool *success,
-	bool *resource_success,
-	bool *metrics_success,
-	stress_checksum_t **checksum)
+	const int32_t launchers,
+	stress_checksum_t **checksum,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const size_t page_size)
 {
-	double time_start, time_finish;
-	int32_t started_instances = 0;
-	const size_t page_size = stress_get_page_size();
-	int64_t backoff = DEFAULT_BACKOFF;
-	int32_t ionice_class = UNDEFINED;
-	int32_t ionice_level = UNDEFINED;
-	bool handler_set = false;
+	typedef struct {
+		stress_stressor_t *ss;		/* stressor */
+		stress_checksum_t *checksum;	/* instance checksum */
+		int32_t instance;		/* instance number */
+	} stress_launch_t;
 
-	wait_flag = true;
-	time_start = stress_time_now();
-	pr_dbg("starting stressors\n");
+	stress_stressor_t *ss;
+	stress_launch_t *launch;
+	pid_t *pids;
+	int32_t i, n = 0, num_launchers, started_instances = 0;
+	const double t_start = stress_time_now();
 
-	(void)stress_get_setting("backoff", &backoff);
-	(void)stress_get_setting("ionice-class", &ionice_class);
-	(void)stress_get_setting("ionice-level", &ionice_level);
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		n += ss->num_instances;
+	}
+	if (n == 0)
+		return 0;
 
-	/*
-	 *  Work through the list of stressors to run
-	 */
-	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
+	launch = (stress_launch_t *)calloc((size_t)n, sizeof(*launch));
+	if (!launch)
+		return -1;
+	num_launchers = STRESS_MINIMUM(launchers, n);
+	pids = (pid_t *)calloc((size_t)num_launchers, sizeof(*pids));
+	if (!pids) {
+		free(launch);
+		return -1;
+	}
+	if (prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) < 0) {
+		pr_dbg("launcher: cannot make stress-ng a child subreaper, "
+			"errno=%d (%s), spawning instances directly\n",
+			errno, strerror(errno));
+		free(pids);
+		free(launch);
+		return -1;
+	}
+
+	for (i = 0, ss = stressors_list; ss; ss = ss->next) {
 		int32_t j;
 
-		if (g_stressor_current->ignore.run || g_stressor_current->ignore.permute)
+		if (ss->ignore.run || ss->ignore.permute)
 			continue;
 
-		/*
-		 *  Each stressor has 1 or more instances to run
-		 */
-		for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++) {
-			double fork_time_start;
-			pid_t pid;
-			int rc;
-			stress_stats_t *const stats = g_stressor_current->stats[j];
+		for (j = 0; j < ss->num_instances; j++, i++, (*checksum)++) {
+			stress_stats_t *const stats = ss->stats[j];
 
-#if defined(STRESS_TERMINATE_PREMATURELY)
-			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
-				goto abort;
-#endif
-			stats->pid = -1;
+			stats->pid = 0;
+			stats->signalled = false;
 			stats->args.ci.counter_ready = true;
 			stats->args.ci.counter = 0;
 			stats->checksum = *checksum;
-again:
-			if (!stress_continue_flag())
-				break;
-			fork_time_start = stress_time_now();
-			pid = fork();
+			launch[i].ss = ss;
+			launch[i].checksum = *checksum;
+			launch[i].instance = j;
+		}
+	}
+
+	for (i = 0; i < num_launchers; i++) {
+		int32_t k;
+
+		if (!stress_continue_flag())
+			break;
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			pr_err("launcher: cannot fork, errno=%d (%s)\n",
+				errno, strerror(errno));
+			break;
+		} else if (pids[i] > 0) {
+			continue;
+		}
+
+		/* Launcher */
+		stress_set_proc_name("launcher");
+		for (k = i; (k < n) && stress_continue_flag(); k += num_launchers) {
+			stress_stats_t *const stats = launch[k].ss->stats[launch[k].instance];
+			double fork_time_start;
+			pid_t pid;
+again:
+			fork_time_start = stress_time_now();
+			pid = fork();
+			if (pid == 0) {
+				int rc;
+
+				g_stressor_current = launch[k].ss;
+				rc = stress_run_child(&launch[k].checksum,
+						stats, fork_time_start,
+						backoff, ticks_per_sec,
+						ionice_class, ionice_level,
+						launch[k].instance, k / num_launchers,
+						page_size);
+				_exit(rc);
+			} else if (pid < 0) {
+				if (errno == EAGAIN) {
+					(void)shim_usleep(100000);
+					goto again;
+				}
+				pr_err("launcher: cannot fork, errno=%d (%s)\n",
+					errno, strerror(errno));
+				break;
+			}
+			stats->pid = pid;
+		}
+		_exit(EXIT_SUCCESS);
+	}
+
+	/* Once the launchers have exited all the instances are our children */
+	for (i = 0; i < num_launchers; i++) {
+		int status;
+
+		if (pids[i] <= 0)
+			continue;
+		while ((shim_waitpid(pids[i], &status, 0) < 0) && (errno == EINTR))
+			;
+	}
+	(void)prctl(PR_SET_CHILD_SUBREAPER, 0, 0, 0, 0);
+
+	for (i = 0; i < n; i++) {
+		const stress_stats_t *const stats = launch[i].ss->stats[launch[i].instance];
+
+		if (stats->pid > 0) {
+			started_instances++;
+			stress_ftrace_add_pid(stats->pid);
+		}
+	}
+	pr_dbg("launcher: %" PRId32 " launcher%s spawned %" PRId32 " instance%s in %.3f secs\n",
+		num_launchers, num_launchers == 1 ? "" : "s",
+		started_instances, started_instances == 1 ? "" : "s",
+		stress_time_now() - t_start);
+
+	free(pids);
+	free(launch);
+
+	return started_instances;
+}
+#endif
+
+#if defined(STRESS_INSTANCE_THREADS)
+/*
+ *  stress_run_threaded()
+ *	fork a single process that runs all the instances of
+ *	a thread safe stressor as pthreads, all the instances
+ *	share the pid of this process. Returns the pid or -1
+ *	if the process could not be forked.
+ */
+static pid_t stress_run_threaded(
+	stress_stressor_t *ss,
+	stress_checksum_t **checksum,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const int32_t started_instances,
+	const size_t page_size)
+{
+	int32_t j;
+	double fork_time_start;
+	pid_t pid;
+
+	for (j = 0; j < ss->num_instances; j++, (*checksum)++) {
+		stress_stats_t *const stats = ss->stats[j];
+
+		stats->pid = -1;
+		stats->args.ci.counter_ready = true;
+		stats->args.ci.counter = 0;
+		stats->checksum = *checksum;
+		stats->spawn_latency = 0.0;
+	}
+	ss->threaded = true;
+again:
+	fork_time_start = stress_time_now();
+	pid = fork();
+	switch (pid) {
+	case -1:
+		if (errno == EAGAIN) {
+			(void)shim_usleep(100000);
+			goto again;
+		}
+		pr_err("Cannot fork: errno=%d (%s)\n",
+			errno, strerror(errno));
+		return -1;
+	case 0:
+		/* Child, instance 0 stats hold the process wide stats */
+		_exit(stress_run_child(&ss->stats[0]->checksum,
+				ss->stats[0], fork_time_start,
+				backoff, ticks_per_sec,
+				ionice_class, ionice_level,
+				0, started_instances,
+				page_size));
+	default:
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			stats->pid = pid;
+			stats->signalled = false;
+		}
+		stress_ftrace_add_pid(pid);
+		break;
+	}
+	return pid;
+}
+#endif
+
+/*
+ *  stress_run()
+ *	kick off and run stressors
+ */
+static void MLOCKED_TEXT stress_run(
+	const int32_t ticks_per_sec,
+	stress_stressor_t *stressors_list,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success,
+	stress_checksum_t **checksum)
+{
+	double time_start, time_finish;
+	int32_t started_instances = 0;
+	uint32_t sync_instances = 0;
+	const size_t page_size = stress_get_page_size();
+	int64_t backoff = DEFAULT_BACKOFF;
+	int32_t ionice_class = UNDEFINED;
+	int32_t ionice_level = UNDEFINED;
+	int32_t launchers = 0;
+	int32_t instance_model = INSTANCE_MODEL_PROCESS;
+	bool handler_set = false;
+
+	wait_flag = true;
+	time_start = stress_time_now();
+	stress_energy_begin();
+	stress_psi_begin();
+	stress_interrupts_irq_begin();
+#if defined(STRESS_THERMAL_ZONES)
+	stress_tz_throttle_begin();
+#endif
+	stress_iostat_begin();
+	stress_sync_start_reset();
+	pr_dbg("starting stressors\n");
+
+	(void)stress_get_setting("backoff", &backoff);
+	(void)stress_get_setting("ionice-class", &ionice_class);
+	(void)stress_get_setting("ionice-level", &ionice_level);
+	(void)stress_get_setting("launcher", &launchers);
+	(void)stress_get_setting("instance-model", &instance_model);
+
+#if defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(PR_SET_CHILD_SUBREAPER)
+	if (launchers > 0) {
+		if (instance_model == INSTANCE_MODEL_THREAD)
+			pr_inf("--instance-model thread is ignored when using --launcher\n");
+		started_instances = stress_run_launchers(stressors_list,
+					launchers, checksum, backoff,
+					ticks_per_sec, ionice_class,
+					ionice_level, page_size);
+		if (started_instances >= 0) {
+			sync_instances = (uint32_t)started_instances;
+			if (!stress_continue_flag()) {
+				pr_dbg("abort signal during startup, cleaning up\n");
+				stress_kill_stressors(SIGALRM, true);
+				goto wait_for_stressors;
+			}
+			goto started;
+		}
+		started_instances = 0;
+	}
+#else
+	(void)launchers;
+#endif
+
+	/*
+	 *  Work through the list of stressors to run
+	 */
+	for (g_stressor_current = stressors_list; g_stressor_current; g_stressor_current = g_stressor_current->next) {
+		int32_t j;
+
+		if (g_stressor_current->ignore.run || g_stressor_current->ignore.permute)
+			continue;
+
+		g_stressor_current->threaded = false;
+#if defined(STRESS_INSTANCE_THREADS)
+		if ((instance_model == INSTANCE_MODEL_THREAD) &&
+		    (g_stressor_current->num_instances > 1)) {
+			if (g_stressor_current->stressor->info->thread_safe) {
+				if (stress_run_threaded(g_stressor_current, checksum,
+						backoff, ticks_per_sec,
+						ionice_class, ionice_level,
+						started_instances, page_size) < 0) {
+					stress_kill_stressors(SIGALRM, false);
+					goto wait_for_stressors;
+				}
+				started_instances += g_stressor_current->num_instances;
+
+				/* Forced early abort during startup? */
+				if (!stress_continue_flag()) {
+					pr_dbg("abort signal during startup, cleaning up\n");
+					stress_kill_stressors(SIGALRM, true);
+					goto wait_for_stressors;
+				}
+				continue;
+			}
+			pr_dbg("%s: stressor is not thread safe, running instances as processes\n",
+				g_stressor_current->stressor->name);
+		}
+#endif
+
+		/*
+		 *  Each stressor has 1 or more instances to run
+		 */
+		for (j = 0; j < g_stressor_current->num_instances; j++, (*checksum)++) {
+			double fork_time_start;
+			pid_t pid;
+			int rc;
+			stress_stats_t *const stats = g_stressor_current->stats[j];
+
+#if defined(STRESS_TERMINATE_PREMATURELY)
+			if (g_opt_timeout && (stress_time_now() - time_start > (double)g_opt_timeout))
+				goto abort;
+#endif
+			stats->pid = -1;
+			stats->args.ci.counter_ready = true;
+			stats->args.ci.counter = 0;
+			stats->checksum = *checksum;
+again:
+			if (!stress_continue_flag())
+				break;
+			fork_time_start = stress_time_now();
+			pid = fork();
 			switch (pid) {
 			case -1:
 				if (errno == EAGAIN) {
@@ -1644,6 +2574,7 @@ again:
 					stats->pid = pid;
 					stats->signalled = false;
 					started_instances++;
+					sync_instances++;
 					stress_ftrace_add_pid(pid);
 				}
 
@@ -1657,6 +2588,11 @@ again:
 			}
 		}
 	}
+#if defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(PR_SET_CHILD_SUBREAPER)
+started:
+#endif
+	stress_sync_start_launched(sync_instances);
 	if (!handler_set) {
 		(void)stress_set_handler("stress-ng", false);
 		handler_set = true;
@@ -1678,6 +2614,13 @@ wait_for_stressors:
 #endif
 	stress_wait_stressors(ticks_per_sec, stressors_list, success, resource_success, metrics_success);
 	time_finish = stress_time_now();
+	stress_energy_end(stressors_list, time_finish - time_start);
+	stress_psi_end(stressors_list, time_finish - time_start);
+	stress_interrupts_irq_end(stressors_list, time_finish - time_start);
+#if defined(STRESS_THERMAL_ZONES)
+	stress_tz_throttle_end(stressors_list, time_finish - time_start);
+#endif
+	stress_iostat_end(stressors_list, time_finish - time_start);
 
 	*duration += time_finish - time_start;
 }
@@ -1868,28 +2811,155 @@ static void stress_metrics_check(bool *success)
 	}
 }
 
-static char *stess_description_yamlify(const char *description)
+/*
+ *  per bogo-op cost metrics, these use the misc metrics
+ *  slots below those used by stress_freq_metrics()
+ */
+#define STRESS_RUSAGE_METRICS_BASE				\
+	(STRESS_MISC_METRICS_MAX - STRESS_LATENCY_METRICS -	\
+	 STRESS_OPS_RATE_METRICS - STRESS_CYCLES_METRICS -	\
+	 STRESS_FREQ_METRICS - STRESS_RUSAGE_METRICS)
+
+/*
+ *  stress_rusage_metrics()
+ *	set the voluntary and involuntary context switches, minor
+ *	and major page faults and, with --perf, system calls per
+ *	bogo-op of all the completed instances of a stressor
+ */
+static void stress_rusage_metrics(stress_stressor_t *ss)
 {
-	static char yamlified[40];
-	char *dst;
-	const char *src, *end = yamlified + sizeof(yamlified);
+	static char * const descriptions[STRESS_RUSAGE_METRICS] = {
+		"voluntary ctx switches per bogo op",
+		"involuntary ctx switches per bogo op",
+		"minor page faults per bogo op",
+		"major page faults per bogo op",
+		"system calls per bogo op",
+	};
+	double values[STRESS_RUSAGE_METRICS];
+	stress_rusage_counts_t counts;
+	uint64_t bogo_ops = 0;
+#if defined(STRESS_PERF_STATS)
+	uint64_t syscalls = 0, syscall_bogo_ops = 0;
+	bool syscalls_valid = false;
+#endif
+	size_t i, n = STRESS_RUSAGE_METRICS - 1;
+	int32_t j;
+
+	if (!ss->stats)
+		return;
 
-	for (dst = yamlified, src = description; *src; src++) {
-		register int ch = (int)*src;
+	(void)shim_memset(&counts, 0, sizeof(counts));
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
 
-		if (isalpha(ch)) {
-			*(dst++) = (char)tolower(ch);
-		} else if (isdigit(ch)) {
-			*(dst++) = (char)ch;
-		} else if (ch == ' ') {
-			*(dst++) = '-';
+		if (!stats->completed)
+			continue;
+		bogo_ops += stats->counter_total;
+		counts.nvcsw += stats->rusage_counts_total.nvcsw;
+		counts.nivcsw += stats->rusage_counts_total.nivcsw;
+		counts.minflt += stats->rusage_counts_total.minflt;
+		counts.majflt += stats->rusage_counts_total.majflt;
+#if defined(STRESS_PERF_STATS)
+		if (g_opt_flags & OPT_FLAGS_PERF_STATS) {
+			const uint64_t count = stress_perf_stat_syscalls(&stats->sp);
+
+			/* perf counts the entire run, so ignore any --warmup */
+			if (count != STRESS_PERF_INVALID) {
+				syscalls += count;
+				syscall_bogo_ops += stats->args.ci.counter;
+				syscalls_valid = true;
+			}
 		}
-		if (dst >= end - 1)
-			break;
+#endif
 	}
-	*dst = '\0';
+	if (bogo_ops == 0)
+		return;
+
+	values[0] = (double)counts.nvcsw / (double)bogo_ops;
+	values[1] = (double)counts.nivcsw / (double)bogo_ops;
+	values[2] = (double)counts.minflt / (double)bogo_ops;
+	values[3] = (double)counts.majflt / (double)bogo_ops;
+#if defined(STRESS_PERF_STATS)
+	if (syscalls_valid && (syscall_bogo_ops > 0)) {
+		values[4] = (double)syscalls / (double)syscall_bogo_ops;
+		n++;
+	}
+#endif
+
+	for (j = 0; j < ss->num_instances; j++) {
+		stress_stats_t *const stats = ss->stats[j];
+
+		if (!stats->completed)
+			continue;
+		for (i = 0; i < n; i++)
+			stress_metrics_set(&stats->args, STRESS_RUSAGE_METRICS_BASE + i,
+				descriptions[i], values[i], STRESS_MERGED_VALUE);
+	}
+}
+
+/*
+ *  stress_metrics_mean()
+ *	mean of misc metric idx over the completed instances
+ *	of a stressor using the metric's mean type
+ */
+double stress_metrics_mean(const stress_stressor_t *ss, const size_t idx)
+{
+	int32_t j;
+	int64_t exponent = 0;
+	double mantissa = 1.0, sum = 0.0, n = 0.0, mean;
+
+	if (idx >= STRESS_MISC_METRICS_MAX)
+		return 0.0;
+
+	switch (ss->stats[0]->metrics.items[idx].mean_type) {
+	case STRESS_GEOMETRIC_MEAN:
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+			const double value = stats->metrics.items[idx].value;
+
+			if (stats->completed && ((value > 0.0) || (value < 0.0))) {
+				int e;
+				const double f = frexp(value, &e);
 
-	return yamlified;
+				mantissa *= f;
+				exponent += e;
+				n += 1.0;
+			}
+		}
+		if (n > 0.0) {
+			const double inverse_n = 1.0 / (double)n;
+
+			return pow(mantissa, inverse_n) * pow(2.0, (double)exponent * inverse_n);
+		}
+		return 0.0;
+	case STRESS_HARMONIC_MEAN:
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+			const double value = stats->metrics.items[idx].value;
+
+			if (stats->completed && ((value > 0.0) || (value < 0.0))) {
+				sum += 1.0 / value;
+				n += 1.0;
+			}
+		}
+		if (n > 0.0) {
+			mean = sum / n;
+			if ((mean > 0.0) || (mean < 0.0))
+				return 1.0 / mean;
+		}
+		return 0.0;
+	case STRESS_MERGED_VALUE:
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if (stats->completed)
+				return stats->metrics.items[idx].value;
+		}
+		return 0.0;
+	default:
+		break;
+	}
+	return 0.0;
 }
 
 /*
@@ -1925,11 +2995,14 @@ static void stress_metrics_dump(FILE *yaml)
 	for (ss = stressors_head; ss; ss = ss->next) {
 		uint64_t c_total = 0;
 		double   r_total = 0.0, u_total = 0.0, s_total = 0.0;
+		double   spawn_total = 0.0, spawn_max = 0.0, spawn_mean;
 		long int maxrss = 0;
 		int32_t  j;
 		size_t i;
 		char munged[64];
 		double u_time, s_time, t_time, bogo_rate_r_time, bogo_rate, cpu_usage;
+		double rate_mean, rate_stddev;
+		int32_t rate_n;
 		bool run_ok = false;
 
 		if (ss->ignore.run || ss->ignore.permute)
@@ -1938,6 +3011,11 @@ static void stress_metrics_dump(FILE *yaml)
 			continue;
 
 		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		stress_latency_metrics(ss);
+		stress_ops_rate_metrics(ss);
+		stress_cycles_metrics(ss);
+		stress_freq_metrics(ss);
+		stress_rusage_metrics(ss);
 
 		for (j = 0; j < ss->num_instances; j++)
 			ss->completed_instances = 0;
@@ -1957,6 +3035,9 @@ static void stress_metrics_dump(FILE *yaml)
 				maxrss = stats->rusage_maxrss;
 #endif
 			r_total += stats->duration_total;
+			spawn_total += stats->spawn_latency;
+			if (spawn_max < stats->spawn_latency)
+				spawn_max = stats->spawn_latency;
 		}
 		/* Real time in terms of average wall clock time of all procs */
 		r_total = ss->completed_instances ?
@@ -1966,6 +3047,8 @@ static void stress_metrics_dump(FILE *yaml)
 		    (c_total == 0) && (!run_ok))
 			continue;
 
+		spawn_mean = (ss->num_instances > 0) ?
+			spawn_total / (double)ss->num_instances : 0.0;
 		u_time = u_total;
 		s_time = s_total;
 		t_time = u_time + s_time;
@@ -1980,6 +3063,7 @@ static void stress_metrics_dump(FILE *yaml)
 
 		cpu_usage = (r_total > 0) ? 100.0 * t_time / r_total : 0.0;
 		cpu_usage = ss->completed_instances ? cpu_usage / ss->completed_instances : 0.0;
+		stress_compare_instance_rate(ss, &rate_mean, &rate_stddev, &rate_n);
 
 		if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF) {
 			if (g_opt_flags & OPT_FLAGS_SN) {
@@ -2038,6 +3122,10 @@ static void stress_metrics_dump(FILE *yaml)
 			pr_yaml(yaml, "      system-time: %e\n", s_time);
 			pr_yaml(yaml, "      cpu-usage-per-instance: %e\n", cpu_usage);
 			pr_yaml(yaml, "      max-rss: %ld\n", maxrss);
+			pr_yaml(yaml, "      spawn-latency-mean: %e\n", spawn_mean);
+			pr_yaml(yaml, "      spawn-latency-max: %e\n", spawn_max);
+			pr_yaml(yaml, "      instances: %" PRId32 "\n", rate_n);
+			pr_yaml(yaml, "      bogo-ops-per-second-real-time-instance-stddev: %e\n", rate_stddev);
 		} else {
 			pr_yaml(yaml, "    - stressor: %s\n", munged);
 			pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", c_total);
@@ -2048,29 +3136,29 @@ static void stress_metrics_dump(FILE *yaml)
 			pr_yaml(yaml, "      system-time: %f\n", s_time);
 			pr_yaml(yaml, "      cpu-usage-per-instance: %f\n", cpu_usage);
 			pr_yaml(yaml, "      max-rss: %ld\n", maxrss);
+			pr_yaml(yaml, "      spawn-latency-mean: %f\n", spawn_mean);
+			pr_yaml(yaml, "      spawn-latency-max: %f\n", spawn_max);
+			pr_yaml(yaml, "      instances: %" PRId32 "\n", rate_n);
+			pr_yaml(yaml, "      bogo-ops-per-second-real-time-instance-stddev: %f\n", rate_stddev);
 		}
+		stress_iostat_yaml(yaml, ss);
 
 		for (i = 0; i < SIZEOF_ARRAY(ss->stats[0]->metrics.items); i++) {
 			item = &ss->stats[0]->metrics.items[i];
 			description = item->description;
 
 			if (description) {
-				double metric, total = 0.0;
+				const double metric = stress_metrics_mean(ss, i);
 
 				misc_metrics = true;
-				for (j = 0; j < ss->num_instances; j++) {
-					const stress_stats_t *const stats = ss->stats[j];
-
-					total += stats->metrics.items[i].value;
-				}
-				metric = ss->completed_instances ? total / ss->completed_instances : 0.0;
 				if (g_opt_flags & OPT_FLAGS_SN) {
-					pr_yaml(yaml, "      %s: %e\n", stess_description_yamlify(description), metric);
+					pr_yaml(yaml, "      %s: %e\n", stress_description_yamlify(description), metric);
 				} else {
-					pr_yaml(yaml, "      %s: %f\n", stess_description_yamlify(description), metric);
+					pr_yaml(yaml, "      %s: %f\n", stress_description_yamlify(description), metric);
 				}
 			}
 		}
+		stress_sampler_dump(yaml, ss);
 		pr_yaml(yaml, "\n");
 	}
 
@@ -2078,7 +3166,6 @@ static void stress_metrics_dump(FILE *yaml)
 		pr_metrics("miscellaneous metrics:\n");
 		for (ss = stressors_head; ss; ss = ss->next) {
 			size_t i;
-			int32_t j;
 			char munged[64];
 
 			if (ss->ignore.run)
@@ -2097,82 +3184,31 @@ static void stress_metrics_dump(FILE *yaml)
 				description = item->description;
 
 				if (description) {
-					int64_t exponent;
-					double geometric_mean, harmonic_mean, mantissa;
-					double n, sum;
+					const double mean = stress_metrics_mean(ss, i);
 					const char *plural = (ss->completed_instances > 1) ? "s" : "";
+					const char *mean_type;
 
-					switch (ss->stats[0]->metrics.items[i].mean_type) {
+					switch (item->mean_type) {
 					case STRESS_GEOMETRIC_MEAN:
-						exponent = 0;
-						mantissa = 1.0;
-						n = 0.0;
-
-						for (j = 0; j < ss->num_instances; j++) {
-							int e;
-							const stress_stats_t *const stats = ss->stats[j];
-
-							item = &stats->metrics.items[i];
-							if ((item->value > 0.0) || (item->value < 0.0)) {
-								const double f = frexp(item->value, &e);
-
-								mantissa *= f;
-								exponent += e;
-								n += 1.0;
-							}
-						}
-						if (n > 0.0) {
-							const double inverse_n = 1.0 / (double)n;
-
-							geometric_mean = pow(mantissa, inverse_n) * pow(2.0, (double)exponent * inverse_n);
-						} else {
-							geometric_mean = 0.0;
-						}
-						if (g_opt_flags & OPT_FLAGS_SN) {
-							pr_metrics("%-13s %13.2e %s (geometric mean of %" PRIu32 " instance%s)\n",
-								munged, geometric_mean, description,
-								ss->completed_instances, plural);
-						} else {
-							pr_metrics("%-13s %13.2f %s (geometric mean of %" PRIu32 " instance%s)\n",
-								munged, geometric_mean, description,
-								ss->completed_instances, plural);
-						}
+						mean_type = "geometric mean of";
 						break;
 					case STRESS_HARMONIC_MEAN:
-						sum = 0.0;
-						n = 0.0;
-
-						for (j = 0; j < ss->num_instances; j++) {
-							const stress_stats_t *const stats = ss->stats[j];
-
-							item = &stats->metrics.items[i];
-							if ((item->value > 0.0) || (item->value < 0.0)) {
-								const double reciprocal = 1.0 / item->value;
-
-								sum += reciprocal;
-								n += 1.0;
-							}
-						}
-						if (n > 0.0) {
-							harmonic_mean = sum / n;
-							if ((harmonic_mean > 0.0) || (harmonic_mean < 0.0)) {
-								harmonic_mean = 1.0 / harmonic_mean;
-							} else {
-								harmonic_mean = 0.0;
-							}
-						} else {
-							harmonic_mean = 0.0;
-						}
-						if (g_opt_flags & OPT_FLAGS_SN) {
-							pr_metrics("%-13s %13.2e %s (harmonic mean of %" PRIu32 " instance%s)\n",
-								munged, harmonic_mean, description,
-								ss->completed_instances, plural);
-						} else {
-							pr_metrics("%-13s %13.2f %s (harmonic mean of %" PRIu32 " instance%s)\n",
-								munged, harmonic_mean, description,
-								ss->completed_instances, plural);
-						}
+						mean_type = "harmonic mean of";
 						break;
+					case STRESS_MERGED_VALUE:
+						mean_type = "merged from";
+						break;
+					default:
+						continue;
+					}
+					if (g_opt_flags & OPT_FLAGS_SN) {
+						pr_metrics("%-13s %13.2e %s (%s %" PRIu32 " instance%s)\n",
+							munged, mean, description, mean_type,
+							ss->completed_instances, plural);
+					} else {
+						pr_metrics("%-13s %13.2f %s (%s %" PRIu32 " instance%s)\n",
+							munged, mean, description, mean_type,
+							ss->completed_instances, plural);
 					}
 				}
 			}
@@ -2349,6 +3385,81 @@ static void *stress_map_page(int prot, char *prot_str, size_t page_size)
 	return ptr;
 }
 
+/*
+ *  stress_bogo_overhead_loop()
+ *	time BOGO_OVERHEAD_LOOPS bogo-op counter increments,
+ *	returns the time per increment in nanoseconds
+ */
+static double stress_bogo_overhead_loop(stress_args_t *args)
+{
+	double t1, t2, t3;
+	register int i;
+
+	t1 = stress_time_now();
+	for (i = 0; i < BOGO_OVERHEAD_LOOPS; i++)
+		stress_bogo_inc(args);
+	t2 = stress_time_now();
+	/* subtract the loop and barrier overhead */
+	for (i = 0; i < BOGO_OVERHEAD_LOOPS; i++)
+		stress_asm_mb();
+	t3 = stress_time_now();
+
+	return STRESS_MAXIMUM(0.0, ((t2 - t1) - (t3 - t2)) * STRESS_DBL_NANOSECOND / BOGO_OVERHEAD_LOOPS);
+}
+
+/*
+ *  stress_bogo_overhead()
+ *	measure the overhead of stress_bogo_inc() on the shared
+ *	stats counter of the first instance, and if there is a
+ *	second instance measure it again with a child process
+ *	busy incrementing the neighbouring instance's counter
+ *	to check for false sharing between the counters
+ */
+static void stress_bogo_overhead(const int32_t num_instances)
+{
+	stress_args_t *args;
+	double t_quiet, t_busy;
+	pid_t pid;
+
+	if (num_instances < 1)
+		return;
+
+	args = &g_shared->stats[0].args;
+	pr_dbg("bogo-overhead: counter at %p is %scacheline aligned, stats size %zd bytes\n",
+		(void *)&args->ci,
+		((uintptr_t)&args->ci & (STRESS_CACHELINE_MAX - 1)) ? "not " : "",
+		sizeof(stress_stats_t));
+
+	t_quiet = stress_bogo_overhead_loop(args);
+	pr_inf("bogo-overhead: stress_bogo_inc() takes %.2f ns per call\n", t_quiet);
+
+	/* neighbour test needs a second CPU to run the busy child on */
+	if ((num_instances < 2) || (stress_get_processors_online() < 2))
+		goto reset;
+
+	pid = fork();
+	if (pid < 0) {
+		pr_dbg("bogo-overhead: cannot fork, errno=%d (%s), skipping neighbour test\n",
+			errno, strerror(errno));
+		goto reset;
+	} else if (pid == 0) {
+		stress_args_t *neighbour = &g_shared->stats[1].args;
+
+		stress_parent_died_alarm();
+		for (;;)
+			stress_bogo_inc(neighbour);
+	}
+	t_busy = stress_bogo_overhead_loop(args);
+	(void)stress_kill_pid_wait(pid, NULL);
+	pr_inf("bogo-overhead: stress_bogo_inc() takes %.2f ns per call with neighbouring counter busy\n",
+		t_busy);
+	g_shared->stats[1].args.ci.counter = 0;
+	g_shared->stats[1].args.ci.counter_ready = true;
+reset:
+	args->ci.counter = 0;
+	args->ci.counter_ready = true;
+}
+
 /*
  *  stress_shared_map()
  *	mmap shared region, with an extra page at the end
@@ -2382,6 +3493,7 @@ static inline void stress_shared_map(const int32_t num_procs)
 	g_shared->instance_count.reaped = 0;
 	g_shared->instance_count.failed = 0;
 	g_shared->instance_count.alarmed = 0;
+	g_shared->instance_count.total = (uint32_t)num_procs;
 	g_shared->time_started = stress_time_now();
 
 	/*
@@ -2421,9 +3533,12 @@ STRESS_PRAGMA_POP
 	/*
 	 *  copy of checksums and run data in a different shared
 	 *  memory segment so that we can sanity check these for
-	 *  any form of corruption
+	 *  any form of corruption, --interference runs keep a
+	 *  second copy, see stress_checksum_move()
 	 */
 	len = sizeof(stress_checksum_t) * (size_t)num_procs;
+	if (g_opt_flags & OPT_FLAGS_INTERFERENCE)
+		len <<= 1;
 	sz = (len + page_size) & ~(page_size - 1);
 	g_shared->checksum.checksums = (stress_checksum_t *)mmap(NULL, sz,
 		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
@@ -2834,6 +3949,27 @@ static void stress_enable_classes(const uint32_t class)
 	}
 }
 
+/*
+ *  stress_get_instance_model()
+ *	parse --instance-model mode, process or thread
+ */
+static int32_t stress_get_instance_model(const char *const str)
+{
+	if (!strcmp("process", str))
+		return INSTANCE_MODEL_PROCESS;
+	if (!strcmp("thread", str)) {
+#if defined(STRESS_INSTANCE_THREADS)
+		return INSTANCE_MODEL_THREAD;
+#else
+		(void)fprintf(stderr, "instance-model thread is not supported on this system, using process\n");
+		return INSTANCE_MODEL_PROCESS;
+#endif
+	}
+	(void)fprintf(stderr, "Invalid instance-model option: %s\n", str);
+	(void)fprintf(stderr, "Available options are: process thread\n");
+	longjmp(g_error_env, 1);
+	return INSTANCE_MODEL_PROCESS;
+}
 
 /*
  *  stress_parse_opts
@@ -2851,6 +3987,7 @@ int stress_parse_opts(int argc, char **argv, const bool jobmode)
 		int16_t i16;
 		int c, option_index, ret;
 		size_t i;
+		bool b;
 
 		opterr = (!jobmode) ? opterr : 0;
 next_opt:
@@ -2924,6 +4061,14 @@ next_opt:
 			i64 = (int64_t)stress_get_uint64(optarg);
 			stress_set_setting_global("backoff", TYPE_ID_INT64, &i64);
 			break;
+		case OPT_benchmark:
+			if (stress_set_benchmark(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_bogo_overhead:
+			b = true;
+			stress_set_setting_global("bogo-overhead", TYPE_ID_BOOL, &b);
+			break;
 		case OPT_cache_level:
 			/*
 			 * Note: Overly high values will be caught in the
@@ -2959,6 +4104,10 @@ next_opt:
 		case OPT_help:
 			stress_usage();
 			break;
+		case OPT_instance_model:
+			i32 = stress_get_instance_model(optarg);
+			stress_set_setting_global("instance-model", TYPE_ID_INT32, &i32);
+			break;
 		case OPT_ionice_class:
 			i32 = stress_get_opt_ionice_class(optarg);
 			stress_set_setting("ionice-class", TYPE_ID_INT32, &i32);
@@ -2967,9 +4116,30 @@ next_opt:
 			i32 = stress_get_int32(optarg);
 			stress_set_setting("ionice-level", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_agent:
+			stress_set_setting_global("agent", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_controller:
+			stress_set_setting_global("controller", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_cluster_secret:
+			stress_set_setting_global("cluster-secret", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_job:
 			stress_set_setting_global("job", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_jsonl:
+			stress_set_setting_global("jsonl", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_launcher:
+			i32 = stress_get_int32(optarg);
+			stress_check_range("launcher", (uint64_t)i32, 0, MAX_LAUNCHERS);
+			stress_set_setting_global("launcher", TYPE_ID_INT32, &i32);
+			break;
+		case OPT_log_ring:
+			b = true;
+			stress_set_setting_global("log-ring", TYPE_ID_BOOL, &b);
+			break;
 		case OPT_log_file:
 			stress_set_setting_global("log-file", TYPE_ID_STR, (void *)optarg);
 			break;
@@ -3019,6 +4189,53 @@ next_opt:
 			stress_check_max_stressors("random", i32);
 			stress_set_setting("random", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_compare:
+			stress_set_setting_global("compare", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_compare_threshold:
+			if (stress_set_compare_threshold(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_until_stable:
+			if (stress_set_until_stable(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_until_stable_window:
+			if (stress_set_until_stable_window(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_cpu_max:
+			if (stress_set_cgroup_cpu_max(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_cgroup_memory_max:
+			if (stress_set_cgroup_memory_max(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_resctrl:
+			if (stress_set_resctrl(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_warmup:
+			if (stress_set_warmup(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_sample_interval:
+			if (stress_set_sample_interval(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_sort_dist:
+			if (stress_set_sort_dist(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_sort_dist_swaps:
+			if (stress_set_sort_dist_swaps(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_scale_sweep:
+			if (stress_set_scale_sweep(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_sched:
 			i32 = stress_get_opt_sched(optarg);
 			stress_set_setting_global("sched", TYPE_ID_INT32, &i32);
@@ -3064,9 +4281,32 @@ next_opt:
 			if (stress_set_status(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_status_socket:
+			stress_set_setting_global("status-socket", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_stressors:
 			stress_show_stressor_names();
 			exit(EXIT_SUCCESS);
+		case OPT_numa_policy:
+			if (stress_set_numa_policy(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_ops_rate:
+			if (stress_set_ops_rate(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_placement:
+			if (stress_set_placement(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_harness_profile:
+			b = true;
+			stress_set_setting_global("harness-profile", TYPE_ID_BOOL, &b);
+			break;
+		case OPT_taskstats:
+			b = true;
+			stress_set_setting_global("taskstats", TYPE_ID_BOOL, &b);
+			break;
 		case OPT_taskset:
 			if (stress_set_cpu_affinity(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3087,6 +4327,18 @@ next_opt:
 		case OPT_verifiable:
 			stress_verifiable();
 			exit(EXIT_SUCCESS);
+		case OPT_victim:
+			if (stress_set_victim(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_victim_steps:
+			if (stress_set_victim_steps(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_victim_taskset:
+			if (stress_set_victim_taskset(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_vmstat:
 			if (stress_set_vmstat(optarg) < 0)
 				exit(EXIT_FAILURE);
@@ -3095,10 +4347,25 @@ next_opt:
 			if (stress_set_thermalstat(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+		case OPT_perf_events:
+			if (stress_set_perf_events(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_perf_metric:
+			if (stress_set_perf_metric(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+#endif
 		case OPT_iostat:
 			if (stress_set_iostat(optarg) < 0)
 				exit(EXIT_FAILURE);
 			break;
+		case OPT_psistat:
+			if (stress_set_psistat(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
 		case OPT_with:
 			g_opt_flags |= (OPT_FLAGS_WITH | OPT_FLAGS_SET);
 			stress_set_setting_global("with", TYPE_ID_STR, (void *)optarg);
@@ -3212,6 +4479,26 @@ static void stress_setup_parallel(const uint32_t class, const int32_t instances)
 	}
 }
 
+/*
+ *  stress_setup_scale_sweep()
+ *	setup for --scale-sweep mode stressors, the stats are
+ *	allocated for the largest instance count to sweep
+ */
+static void stress_setup_scale_sweep(void)
+{
+	stress_stressor_t *ss;
+
+	stress_set_default_timeout(DEFAULT_TIMEOUT);
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (ss->ignore.run)
+			continue;
+		ss->num_instances = stress_scale_sweep_max();
+		ss->bogo_ops = (ss->bogo_ops + (ss->num_instances - 1)) / ss->num_instances;
+		stress_alloc_proc_resources(&ss->stats, ss->num_instances);
+	}
+}
+
 /*
  *  stress_run_sequential()
  *	run stressors sequentially
@@ -3276,6 +4563,99 @@ static inline void stress_run_sequential(
 	}
 }
 
+/*
+ *  stress_run_scale_sweep()
+ *	run each stressor on its own with each of the --scale-sweep
+ *	instance counts, the stressor instance stats are allocated
+ *	for the largest count, see stress_setup_scale_sweep()
+ */
+static inline void stress_run_scale_sweep(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_checksum_t *checksum_base = g_shared->checksum.checksums;
+	const size_t counts = stress_scale_sweep_counts();
+
+	for (ss = stressors_head; ss && stress_continue_flag(); ss = ss->next) {
+		stress_stressor_t *next = ss->next;
+		const int32_t max_instances = ss->num_instances;
+		size_t i;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (i = 0; (i < counts) && stress_continue_flag(); i++) {
+			const int32_t instances = stress_scale_sweep_count(i);
+			/* each stressor keeps its own checksum slots over the sweep */
+			stress_checksum_t *checksum = checksum_base;
+			int32_t j;
+
+			if (instances > max_instances)
+				break;
+			pr_inf("scale-sweep: %s with %" PRId32 " instance%s\n",
+				ss->stressor->name, instances, (instances == 1) ? "" : "s");
+			for (j = 0; j < max_instances; j++)
+				ss->stats[j]->completed = false;
+			ss->num_instances = instances;
+			ss->next = NULL;
+			stress_run(ticks_per_sec, ss, duration, success, resource_success,
+				metrics_success, &checksum);
+			ss->next = next;
+			stress_scale_sweep_record(i, ss);
+		}
+		ss->num_instances = max_instances;
+		checksum_base += max_instances;
+	}
+}
+
+/*
+ *  stress_run_benchmark()
+ *	run each of the --benchmark profile stressors on its own,
+ *	pinned to one CPU, for the warm-up runs and then the scored
+ *	runs, each run stops after the profile's fixed bogo-ops count
+ */
+static inline void stress_run_benchmark(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	stress_checksum_t *checksum_base = g_shared->checksum.checksums;
+	const uint32_t runs = stress_benchmark_runs();
+
+	stress_benchmark_pin();
+	for (ss = stressors_head; ss && stress_continue_flag(); ss = ss->next) {
+		stress_stressor_t *next = ss->next;
+		uint32_t run;
+
+		if (ss->ignore.run)
+			continue;
+
+		for (run = 0; (run < runs) && stress_continue_flag(); run++) {
+			stress_checksum_t *checksum = checksum_base;
+			int32_t j;
+
+			pr_inf("benchmark: %s run %" PRIu32 " of %" PRIu32 "\n",
+				ss->stressor->name, run + 1, runs);
+			for (j = 0; j < ss->num_instances; j++)
+				ss->stats[j]->completed = false;
+			ss->next = NULL;
+			stress_run(ticks_per_sec, ss, duration, success, resource_success,
+				metrics_success, &checksum);
+			ss->next = next;
+			stress_benchmark_record(run, ss);
+		}
+		checksum_base += ss->num_instances;
+	}
+	stress_benchmark_unpin();
+}
+
 /*
  *  stress_run_parallel()
  *	run stressors in parallel
@@ -3350,6 +4730,218 @@ static inline void stress_run_permute(
 	}
 }
 
+/*
+ *  stress_checksum_move()
+ *	each run of a subset of the stressors reuses the checksums
+ *	at the start of the checksum region, so move the checksums
+ *	of a stressor that has just been run to its own slots so
+ *	that later runs can't clobber them before the metrics check
+ */
+static void stress_checksum_move(stress_stressor_t *ss, stress_checksum_t *checksum)
+{
+	int32_t j;
+
+	for (j = 0; j < ss->num_instances; j++, checksum++) {
+		stress_stats_t *const stats = ss->stats[j];
+
+		if (!stats->checksum)
+			continue;
+		*checksum = *stats->checksum;
+		stats->checksum = checksum;
+	}
+}
+
+/*
+ *  stress_run_interference()
+ *	run each of the permute stressors alone to get a baseline
+ *	bogo-op rate and then every pair of them together to get
+ *	the slowdown each stressor causes to each of the others
+ */
+static inline void stress_run_interference(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss, *stressors[STRESS_INTERFERENCE_MAX];
+	stress_checksum_t *checksums[STRESS_INTERFERENCE_MAX];
+	stress_checksum_t *checksum = g_shared->checksum.checksums +
+		stress_get_total_num_instances(stressors_head);
+	size_t i, j, n, run = 0, total_runs;
+
+	for (n = 0, ss = stressors_head; ss; ss = ss->next) {
+		ss->ignore.permute = true;
+		if (ss->ignore.run)
+			continue;
+		if (n >= STRESS_INTERFERENCE_MAX) {
+			pr_inf("interference: limiting to first %d stressors\n",
+				STRESS_INTERFERENCE_MAX);
+			break;
+		}
+		checksums[n] = checksum;
+		checksum += ss->num_instances;
+		stressors[n++] = ss;
+	}
+	if (stress_interference_init(stressors, n) < 0)
+		return;
+
+	total_runs = n + ((n * (n - 1)) / 2);
+	for (i = 0; stress_continue_flag() && (i < n); i++) {
+		for (j = i; stress_continue_flag() && (j < n); j++) {
+			stressors[i]->ignore.permute = false;
+			stressors[j]->ignore.permute = false;
+			if (i == j)
+				pr_inf("interference: %s alone\n", stressors[i]->stressor->name);
+			else
+				pr_inf("interference: %s with %s\n", stressors[i]->stressor->name,
+					stressors[j]->stressor->name);
+
+			stress_run_parallel(ticks_per_sec, duration, success, resource_success, metrics_success);
+			stress_interference_record(i, j);
+			stress_interference_record(j, i);
+			stress_checksum_move(stressors[i], checksums[i]);
+			if (i != j)
+				stress_checksum_move(stressors[j], checksums[j]);
+			stressors[i]->ignore.permute = true;
+			stressors[j]->ignore.permute = true;
+			run++;
+			pr_inf("interference: %.2f%% complete\n", 100.0 * (double)run / (double)total_runs);
+		}
+	}
+	for (ss = stressors_head; ss; ss = ss->next) {
+		ss->ignore.permute = false;
+	}
+}
+
+/*
+ *  stress_run_victim()
+ *	run the --victim stressor alone and then in parallel with the
+ *	other (aggressor) stressors, ramping the number of aggressor
+ *	instances up in --victim-steps steps, and record the victim
+ *	throughput and bogo op latencies of each step
+ */
+static inline void stress_run_victim(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss, *victim = NULL;
+	const uint32_t steps = stress_victim_steps();
+	int32_t *max_instances;
+	uint32_t step;
+	size_t n, k;
+
+	for (n = 0, ss = stressors_head; ss; ss = ss->next, n++) {
+		if (!ss->ignore.run && stress_victim_is(ss))
+			victim = ss;
+	}
+	if (!victim) {
+		pr_inf("victim: victim stressor is not being run\n");
+		return;
+	}
+	max_instances = (int32_t *)calloc(n, sizeof(*max_instances));
+	if (!max_instances) {
+		pr_inf("victim: cannot allocate instance counts, skipping victim run\n");
+		return;
+	}
+	for (k = 0, ss = stressors_head; ss; ss = ss->next, k++)
+		max_instances[k] = ss->num_instances;
+
+	for (step = 0; stress_continue_flag() && (step <= steps); step++) {
+		int32_t aggressor_instances = 0;
+
+		for (k = 0, ss = stressors_head; ss; ss = ss->next, k++) {
+			int32_t j, instances;
+
+			for (j = 0; j < max_instances[k]; j++)
+				ss->stats[j]->completed = false;
+			if ((ss == victim) || ss->ignore.run)
+				continue;
+			/* ramp up to all the aggressor instances in the last step */
+			instances = (int32_t)(((uint64_t)max_instances[k] * step + steps - 1) / steps);
+			if ((step > 0) && (instances < 1))
+				instances = 1;
+			ss->ignore.permute = (instances == 0);
+			ss->num_instances = (instances > 0) ? instances : max_instances[k];
+			if (instances > 0)
+				aggressor_instances += instances;
+		}
+		pr_inf("victim: step %" PRIu32 " of %" PRIu32 ", %s with %" PRId32 " aggressor instance%s\n",
+			step, steps, victim->stressor->name, aggressor_instances,
+			(aggressor_instances == 1) ? "" : "s");
+
+		stress_run_parallel(ticks_per_sec, duration, success, resource_success, metrics_success);
+		stress_victim_record(step, victim, aggressor_instances);
+	}
+	for (k = 0, ss = stressors_head; ss; ss = ss->next, k++) {
+		ss->num_instances = max_instances[k];
+		ss->ignore.permute = false;
+	}
+	free(max_instances);
+}
+
+/*
+ *  stress_run_profile()
+ *	run the stressors in parallel once per job file load profile
+ *	phase, varying the number of instances or the duty cycle load
+ *	of the profiled stressor and recording the results per phase
+ */
+static inline void stress_run_profile(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	stress_stressor_t *ss;
+	const uint64_t timeout = g_opt_timeout;
+	const size_t phases = stress_profile_phases();
+	int32_t max_instances;
+	size_t i;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		char munged[64];
+
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		if (!ss->ignore.run && !strcmp(munged, stress_profile_stressor()))
+			break;
+	}
+	if (!ss) {
+		pr_inf("profile: stressor %s is not being run\n", stress_profile_stressor());
+		return;
+	}
+	max_instances = ss->num_instances;
+
+	for (i = 0; stress_continue_flag() && (i < phases); i++) {
+		int32_t instances, j;
+		uint64_t phase_duration;
+		double load;
+
+		stress_profile_phase(i, &instances, &phase_duration, &load);
+		if ((instances <= 0) || (instances > max_instances))
+			instances = max_instances;
+
+		pr_inf("profile: phase %zu of %zu, %" PRId32 " %s instance%s, %.2f%% load, %s\n",
+			i + 1, phases, instances, ss->stressor->name,
+			(instances == 1) ? "" : "s", load,
+			stress_duration_to_str((double)phase_duration, false));
+		for (j = 0; j < max_instances; j++)
+			ss->stats[j]->completed = false;
+		ss->num_instances = instances;
+		g_opt_timeout = phase_duration;
+
+		stress_profile_duty_start(ss, instances, load, phase_duration);
+		stress_run_parallel(ticks_per_sec, duration, success, resource_success, metrics_success);
+		stress_profile_duty_stop();
+		stress_profile_record(i, ss, instances);
+	}
+	ss->num_instances = max_instances;
+	g_opt_timeout = timeout;
+}
+
 /*
  *  stress_mlock_executable()
  *	try to mlock image into memory so it
@@ -3402,10 +4994,12 @@ int main(int argc, char **argv, char **envp)
 	bool success = true;
 	bool resource_success = true;
 	bool metrics_success = true;
+	volatile bool compare_success = true;	/* live across setjmp */
 	FILE *yaml;				/* YAML output file */
 	char *yaml_filename = NULL;		/* YAML file name */
 	char *log_filename;			/* log filename */
 	char *job_filename = NULL;		/* job filename */
+	char *cluster_opt = NULL;		/* cluster agent or controller hosts */
 	int32_t ticks_per_sec;			/* clock ticks per second (jiffies) */
 	int32_t ionice_class = UNDEFINED;	/* ionice class */
 	int32_t ionice_level = UNDEFINED;	/* ionice level */
@@ -3415,6 +5009,8 @@ int main(int argc, char **argv, char **envp)
 	const uint32_t cpus_configured = (uint32_t)stress_get_processors_configured();
 	int ret;
 	bool unsupported = false;		/* true if stressors are unsupported */
+	bool bogo_overhead = false;		/* true = measure bogo-op counter overhead */
+	bool log_ring = false;			/* true = log via per instance rings */
 
 	main_pid = getpid();
 
@@ -3481,10 +5077,26 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_KSM)
 		stress_ksm_memory_merge(1);
 
+	(void)stress_get_setting("job", &job_filename);
+
+	/*
+	 *  Cluster agents run jobs sent by a controller, the
+	 *  controller runs the job file on the agents, both
+	 *  never run any stressors locally
+	 */
+	if (stress_get_setting("agent", &cluster_opt)) {
+		ret = stress_cluster_agent(cluster_opt);
+		goto exit_stressors_free;
+	}
+	if (stress_get_setting("controller", &cluster_opt)) {
+		(void)stress_get_setting("yaml", &yaml_filename);
+		ret = stress_cluster_controller(cluster_opt, job_filename, yaml_filename);
+		goto exit_stressors_free;
+	}
+
 	/*
 	 *  Load in job file options
 	 */
-	(void)stress_get_setting("job", &job_filename);
 	if (stress_parse_jobfile(argc, argv, job_filename) < 0) {
 		ret = EXIT_FAILURE;
 		goto exit_stressors_free;
@@ -3540,6 +5152,59 @@ int main(int argc, char **argv, char **envp)
 		goto exit_stressors_free;
 	}
 
+	/*
+	 *  Sanity check --victim options
+	 */
+	if (stress_victim_enabled() &&
+	    (g_opt_flags & (OPT_FLAGS_SEQUENTIAL | OPT_FLAGS_PERMUTE))) {
+		(void)fprintf(stderr, "the --victim option cannot be used with the --seq or --permute options\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
+	/*
+	 *  Sanity check --scale-sweep option
+	 */
+	if ((stress_scale_sweep_counts() > 0) &&
+	    ((g_opt_flags & (OPT_FLAGS_SEQUENTIAL | OPT_FLAGS_PERMUTE)) ||
+	     stress_victim_enabled() || stress_profile_enabled())) {
+		(void)fprintf(stderr, "the --scale-sweep option cannot be used with the --seq, "
+			"--permute, --victim or job file profile options\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
+	/*
+	 *  Sanity check --benchmark option, the profile
+	 *  declares the stressors that are run
+	 */
+	if (stress_benchmark_enabled()) {
+		if ((g_opt_flags & (OPT_FLAGS_SET | OPT_FLAGS_RANDOM | OPT_FLAGS_SEQUENTIAL |
+				    OPT_FLAGS_ALL | OPT_FLAGS_PERMUTE)) ||
+		    (stress_scale_sweep_counts() > 0) ||
+		    stress_victim_enabled() || stress_profile_enabled()) {
+			(void)fprintf(stderr, "the --benchmark option cannot be used with other stressors "
+				"or the --random, --seq, --all, --permute, --scale-sweep, --victim "
+				"or job file profile options\n");
+			ret = EXIT_FAILURE;
+			goto exit_stressors_free;
+		}
+		if (stress_benchmark_stressors() < 0) {
+			ret = EXIT_FAILURE;
+			goto exit_stressors_free;
+		}
+	}
+
+	/*
+	 *  Sanity check --interference option
+	 */
+	if ((g_opt_flags & OPT_FLAGS_INTERFERENCE) &&
+	    !(g_opt_flags & OPT_FLAGS_PERMUTE)) {
+		(void)fprintf(stderr, "the --interference option also requires the --permute option\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
 	stress_cpuidle_init();
 
 	/*
@@ -3615,7 +5280,17 @@ int main(int argc, char **argv, char **envp)
 	(void)stress_get_setting("ionice-level", &ionice_level);
 	stress_set_iopriority(ionice_class, ionice_level);
 	(void)stress_get_setting("yaml", &yaml_filename);
+	if (stress_compare_load() < 0) {
+		ret = EXIT_FAILURE;
+		goto exit_logging_close;
+	}
+	if (stress_placement_init() < 0) {
+		ret = EXIT_FAILURE;
+		goto exit_logging_close;
+	}
 
+	if (g_opt_flags & OPT_FLAGS_HUGE_TEXT)
+		stress_huge_text_remap();
 	stress_mlock_executable();
 
 	/*
@@ -3643,6 +5318,8 @@ int main(int argc, char **argv, char **envp)
 		stress_setup_sequential(class, g_opt_sequential);
 	} else if (g_opt_flags & OPT_FLAGS_PERMUTE) {
 		stress_setup_sequential(class, g_opt_permute);
+	} else if (stress_scale_sweep_counts() > 0) {
+		stress_setup_scale_sweep();
 	} else {
 		stress_setup_parallel(class, g_opt_parallel);
 	}
@@ -3686,20 +5363,20 @@ int main(int argc, char **argv, char **envp)
 	 */
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
-	g_shared->perf.lock = stress_lock_create();
+	g_shared->perf.lock = stress_lock_create("perf");
 	if (!g_shared->perf.lock) {
 		pr_err("failed to create perf lock\n");
 		ret = EXIT_FAILURE;
 		goto exit_shared_unmap;
 	}
 #endif
-	g_shared->warn_once.lock = stress_lock_create();
+	g_shared->warn_once.lock = stress_lock_create("warn-once");
 	if (!g_shared->warn_once.lock) {
 		pr_err("failed to create warn_once lock\n");
 		ret = EXIT_FAILURE;
 		goto exit_destroy_perf_lock;
 	}
-	g_shared->net_port_map.lock = stress_lock_create();
+	g_shared->net_port_map.lock = stress_lock_create("net-port-map");
 	if (!g_shared->net_port_map.lock) {
 		pr_err("failed to create net_port_map lock\n");
 		ret = EXIT_FAILURE;
@@ -3733,6 +5410,9 @@ int main(int argc, char **argv, char **envp)
 		goto exit_shared_unmap;
 	}
 
+	if (stress_get_setting("bogo-overhead", &bogo_overhead) && bogo_overhead)
+		stress_bogo_overhead(stress_get_total_num_instances(stressors_head));
+
 #if defined(STRESS_THERMAL_ZONES)
 	/*
 	 *  Setup thermal zone data
@@ -3741,23 +5421,48 @@ int main(int argc, char **argv, char **envp)
 		stress_tz_init(&g_shared->tz_info);
 #endif
 
+	stress_energy_init();
+	stress_sync_start_init();
 	stress_clear_warn_once();
 	stress_stressors_init();
+	stress_cgroup_init(stressors_head);
+	stress_resctrl_init(stressors_head);
 
 	/* Start thrasher process if required */
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_start();
 
+	if (stress_get_setting("log-ring", &log_ring) && log_ring &&
+	    (pr_ring_init(stress_get_total_num_instances(stressors_head)) == 0))
+		pr_ring_start();
+	stress_jsonl_open();
 	stress_vmstat_start();
+	stress_sampler_start(stressors_head, stress_get_total_num_instances(stressors_head));
+	stress_resctrl_stats_start();
+	stress_ksm_stats_start();
+	stress_energy_start();
+	stress_status_start(stressors_head);
 	stress_smart_start();
 	stress_klog_start();
 	stress_clocksource_check();
+	if (g_opt_flags & OPT_FLAGS_IGNITE_CPU_RAMP)
+		stress_ignite_cpu_ramp();
 
 	if (g_opt_flags & OPT_FLAGS_METRICS)
 		stress_config_check();
 
-	if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+	if (stress_profile_enabled()) {
+		stress_run_profile(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (stress_benchmark_enabled()) {
+		stress_run_benchmark(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (stress_scale_sweep_counts() > 0) {
+		stress_run_scale_sweep(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (stress_victim_enabled()) {
+		stress_run_victim(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
 		stress_run_sequential(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	} else if (g_opt_flags & OPT_FLAGS_INTERFERENCE) {
+		stress_run_interference(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
 	} else if (g_opt_flags & OPT_FLAGS_PERMUTE) {
 		stress_run_permute(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
 	} else {
@@ -3765,6 +5470,13 @@ int main(int argc, char **argv, char **envp)
 	}
 
 	stress_clocksource_check();
+	stress_status_stop();
+	stress_energy_stop();
+	stress_sampler_stop(stress_get_total_num_instances(stressors_head));
+	stress_resctrl_stats_stop();
+	stress_ksm_stats_stop();
+	stress_jsonl_close(duration);
+	pr_ring_stop();
 
 	/* Stop alarms */
 	(void)alarm(0);
@@ -3782,8 +5494,26 @@ int main(int argc, char **argv, char **envp)
 		stress_metrics_dump(yaml);
 
 	stress_metrics_check(&success);
+	stress_numa_pages_dump(yaml, stressors_head);
+	stress_profile_dump(yaml);
+	stress_interference_dump(yaml);
+	stress_victim_dump(yaml);
+	stress_scale_sweep_dump(yaml, stressors_head);
+	stress_benchmark_dump(yaml);
+	stress_scale_sweep_free();
+	stress_interference_free();
+	if (stress_compare_dump(yaml, stressors_head))
+		compare_success = false;
 	if (g_opt_flags & OPT_FLAGS_INTERRUPTS)
 		stress_interrupts_dump(yaml, stressors_head);
+	stress_interrupts_irq_dump(yaml, stressors_head);
+	stress_interrupts_irq_free();
+	if (g_opt_flags & OPT_FLAGS_CSTATE_STATS)
+		stress_cpuidle_stats_dump(yaml, stressors_head);
+	if (stress_taskstats_enabled())
+		stress_taskstats_dump(yaml, stressors_head);
+	if (stress_harness_profile_enabled())
+		stress_harness_profile_dump(yaml, stressors_head);
 
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
@@ -3798,11 +5528,27 @@ int main(int argc, char **argv, char **envp)
 	/*
 	 *  Dump thermal zone measurements
 	 */
-	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES)
+	if (g_opt_flags & OPT_FLAGS_THERMAL_ZONES) {
 		stress_tz_dump(yaml, stressors_head);
+		stress_tz_throttle_dump(yaml, stressors_head);
+	}
+	stress_tz_throttle_free();
 	if (g_opt_flags & OPT_FLAGS_TZ_INFO)
 		stress_tz_free(&g_shared->tz_info);
 #endif
+	stress_energy_dump(yaml, stressors_head);
+	stress_energy_free();
+	stress_psi_dump(yaml, stressors_head);
+	stress_psi_free();
+	stress_iostat_dump(stressors_head);
+	stress_iostat_free();
+	stress_sync_start_free();
+	stress_cgroup_dump(yaml, stressors_head);
+	stress_cgroup_free();
+	stress_resctrl_dump(yaml, stressors_head);
+	stress_resctrl_free();
+	stress_ksm_stats_dump(yaml);
+
 	/*
 	 *  Dump run times
 	 */
@@ -3829,6 +5575,7 @@ int main(int argc, char **argv, char **envp)
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	(void)stress_lock_destroy(g_shared->perf.lock);
+	stress_perf_sample_free();
 #endif
 
 	stress_shared_heap_deinit();
@@ -3836,6 +5583,9 @@ int main(int argc, char **argv, char **envp)
 	stress_stressors_free();
 	stress_cpuidle_free();
 	stress_cache_free();
+	stress_compare_free();
+	stress_placement_free();
+	pr_ring_free();
 	stress_shared_unmap();
 	stress_settings_free();
 	stress_temp_path_free();
@@ -3856,6 +5606,8 @@ int main(int argc, char **argv, char **envp)
 		exit(EXIT_NO_RESOURCE);
 	if (!metrics_success)
 		exit(EXIT_METRICS_UNTRUSTWORTHY);
+	if (!compare_success)
+		exit(EXIT_METRICS_REGRESSION);
 	exit(EXIT_SUCCESS);
 
 exit_destroy_warn_once_lock:
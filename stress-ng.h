@@ -169,6 +169,31 @@
  */
 #define STRESS_MISC_METRICS_MAX			(64)
 
+/*
+ *  Misc metrics slots at the top of the table used by the harness,
+ *  from the top down: stress_latency_metrics(), stress_ops_rate_metrics(),
+ *  stress_cycles_metrics(), stress_freq_metrics() and the per bogo-op
+ *  rusage metrics. Stressor metrics must use the slots below
+ *  STRESS_STRESSOR_METRICS_MAX.
+ */
+#define STRESS_LATENCY_METRICS			(5)
+#define STRESS_OPS_RATE_METRICS			(5)
+#define STRESS_CYCLES_METRICS			(2)
+#define STRESS_FREQ_METRICS			(2)
+#define STRESS_RUSAGE_METRICS			(5)
+#define STRESS_STRESSOR_METRICS_MAX				\
+	(STRESS_MISC_METRICS_MAX - STRESS_LATENCY_METRICS -	\
+	 STRESS_OPS_RATE_METRICS - STRESS_CYCLES_METRICS -	\
+	 STRESS_FREQ_METRICS - STRESS_RUSAGE_METRICS)
+
+/*
+ *  Bogo-op counters are updated in tight loops, so the counter info
+ *  is kept in a cacheline of its own at the start of each instance's
+ *  stats to avoid false sharing with fields polled by the parent
+ *  or with counters of neighbouring instances.
+ */
+#define STRESS_CACHELINE_MAX			(128)
+
 typedef struct {
 	uint64_t counter;		/* bogo-op counter */
 	bool counter_ready;		/* ready flag */
@@ -196,9 +221,11 @@ typedef struct {
 
 /* stressor args */
 typedef struct {
+	stress_counter_info_t ci;	/* counter info struct, must be first */
+	uint8_t ci_pad[STRESS_CACHELINE_MAX - sizeof(stress_counter_info_t)];
+					/* padding, keep ci in its own cacheline */
 	const char *name;		/* stressor name */
 	uint64_t max_ops;		/* max number of bogo ops */
-	stress_counter_info_t ci;	/* counter info struct */
 	uint32_t instance;		/* stressor instance # */
 	uint32_t num_instances;		/* number of instances */
 	pid_t pid;			/* stressor pid */
@@ -206,6 +233,8 @@ typedef struct {
 	double time_end;		/* when to end */
 	stress_mapped_t *mapped;	/* mmap'd pages, addr of g_shared mapped */
 	stress_metrics_data_t *metrics;	/* misc per stressor metrics */
+	struct stress_latency *latency;	/* latency histogram */
+	struct stress_ops_rate *ops_rate; /* --ops-rate pacing, NULL if disabled */
 	const struct stressor_info *info; /* stressor info */
 } stress_args_t;
 
@@ -223,6 +252,7 @@ typedef struct stress_stressor_info {
 	int32_t completed_instances;	/* count of completed instances */
 	int32_t num_instances;		/* number of instances per stressor */
 	uint64_t bogo_ops;		/* number of bogo ops */
+	bool threaded;			/* instances run as threads in one process */
 	uint32_t status[STRESS_STRESSOR_STATUS_MAX];
 					/* number of instances that passed/failed/skipped */
 	struct {
@@ -278,6 +308,7 @@ do {				\
 #define EXIT_SIGNALED			(5)
 #define EXIT_BY_SYS_EXIT		(6)
 #define EXIT_METRICS_UNTRUSTWORTHY	(7)
+#define EXIT_METRICS_REGRESSION		(8)
 
 /*
  *  Stressor run states
@@ -425,6 +456,7 @@ typedef struct stressor_info {
 	const stress_class_t class;	/* stressor class */
 	const stress_verify_t verify;	/* verification mode */
 	const char *unimplemented_reason;	/* unsupported reason message */
+	const bool thread_safe;		/* instances can run as pthreads */
 } stressor_info_t;
 
 /* gcc 4.7 and later support vector ops */
@@ -518,17 +550,134 @@ typedef struct {
 	uint64_t count_stop;
 } stress_interrupts_t;
 
+/*
+ *  Per stressor bogo-op counter samples, see core-sampler.c
+ */
+#define STRESS_SAMPLES_MAX		(128)
+
+typedef struct {
+	double time;			/* time since instance started */
+	uint64_t counter;		/* bogo-op counter at time of sample */
+} stress_sample_t;
+
+typedef struct {
+	uint32_t head;			/* next sample ring slot to write to */
+	uint32_t count;			/* total number of samples taken */
+	bool final;			/* true if end of run sample taken */
+	stress_sample_t item[STRESS_SAMPLES_MAX]; /* ring of samples */
+} stress_samples_t;
+
+/*
+ *  Log-linear latency histogram, values below STRESS_LATENCY_SUB_BUCKETS
+ *  nanoseconds have a bucket each, above that each power of 2 is split
+ *  into STRESS_LATENCY_SUB_BUCKETS linear buckets, giving ~3% precision
+ *  up to 2^36 ns (~68 seconds), larger values land in the last bucket
+ */
+#define STRESS_LATENCY_SUB_BITS		(5)
+#define STRESS_LATENCY_SUB_BUCKETS	(1U << STRESS_LATENCY_SUB_BITS)
+#define STRESS_LATENCY_BUCKETS		(1024)
+
+typedef struct stress_latency {
+	uint64_t count;			/* number of latencies recorded */
+	uint64_t min;			/* minimum latency in ns */
+	uint64_t max;			/* maximum latency in ns */
+	double sum;			/* sum of latencies in ns */
+	uint64_t bucket[STRESS_LATENCY_BUCKETS]; /* histogram buckets */
+} stress_latency_t;
+
+/* Open loop --ops-rate pacing state, one per stressor instance */
+typedef struct stress_ops_rate {
+	double start;			/* time of first scheduled bogo op, last op if unpaced */
+	double interval;		/* scheduled time between bogo ops, 0 = unpaced */
+	uint64_t ops;			/* bogo ops completed so far */
+	stress_latency_t latency;	/* completion time - scheduled start time */
+} stress_ops_rate_t;
+
+/* rusage context switch and page fault counts */
+typedef struct {
+	uint64_t nvcsw;			/* voluntary context switches */
+	uint64_t nivcsw;		/* involuntary context switches */
+	uint64_t minflt;		/* minor page faults */
+	uint64_t majflt;		/* major page faults */
+} stress_rusage_counts_t;
+
+/* --warmup snapshot of an instance, taken once the warm-up time has elapsed */
+typedef struct {
+	double time;			/* time of snapshot, 0 = not taken */
+	uint64_t counter;		/* bogo-op counter at snapshot */
+	uint64_t cycles;		/* cycle counter at snapshot */
+	double utime;			/* user time at snapshot */
+	double stime;			/* system time at snapshot */
+	stress_rusage_counts_t counts;	/* faults and context switches at snapshot */
+} stress_warmup_t;
+
+/* Effective CPU frequency samples, weighted by CPU ticks used */
+typedef struct {
+	double ghz_sum;			/* sum of GHz * ticks of each sample */
+	double ticks_sum;		/* sum of ticks of each sample */
+	uint64_t ticks;			/* utime + stime ticks at last sample */
+} stress_freq_t;
+
+/* C-states tracked for --cstate-stats residency reporting */
+#define STRESS_CSTATES_MAX		(16)
+
+typedef struct {
+	double when_start;		/* time of start snapshot, 0 = not taken */
+	double when_stop;		/* time of stop snapshot */
+	uint32_t cpus;			/* number of CPUs with C-states sampled */
+	uint64_t time_start[STRESS_CSTATES_MAX];  /* usecs in C-state at start */
+	uint64_t time_stop[STRESS_CSTATES_MAX];   /* usecs in C-state at stop */
+	uint64_t usage_start[STRESS_CSTATES_MAX]; /* C-state entries at start */
+	uint64_t usage_stop[STRESS_CSTATES_MAX];  /* C-state entries at stop */
+} stress_cstates_t;
+
+/* Delay accounting types tracked for --taskstats reporting */
+#define STRESS_TASKSTATS_DELAYS		(6)
+
+typedef struct {
+	bool valid;			/* true if taskstats were fetched */
+	uint64_t count[STRESS_TASKSTATS_DELAYS];    /* number of delays */
+	uint64_t delay_ns[STRESS_TASKSTATS_DELAYS]; /* total delay in nanoseconds */
+} stress_taskstats_t;
+
+/* --harness-profile per instance harness phase timings */
+typedef struct {
+	bool valid;			/* true if the phases were timed */
+	double setup;			/* fork to start of measured run */
+	double run;			/* measured run time */
+	double teardown;		/* end of run to child exit */
+	double end;			/* child exit time, for reap latency */
+	double checksum;		/* counter state check and checksum time */
+	double setup_cpu;		/* child CPU time used in set-up */
+	double teardown_cpu;		/* child CPU time used in teardown */
+	uint64_t setting_lookups;	/* setting lookups made by the child */
+	double setting_time;		/* time spent in setting lookups */
+} stress_harness_profile_t;
+
+/* NUMA nodes tracked for --numa-policy resident page reporting */
+#define STRESS_NUMA_NODES_MAX		(16)
+
+typedef struct {
+	uint64_t total;			/* resident pages of all nodes */
+	uint64_t node[STRESS_NUMA_NODES_MAX]; /* resident pages per node */
+} stress_numa_pages_t;
+
 /* Per stressor statistics and accounting info */
 typedef struct stress_stats {
-	stress_args_t args;		/* stressor args */
+	stress_args_t args ALIGN128;	/* stressor args, hot counter first */
 	double start;			/* wall clock start time */
 	double duration;		/* finish - start */
+	double spawn_latency;		/* fork to child start time */
+	double exited;			/* parent observed exit time */
 	uint64_t counter_total;		/* counter total */
+	uint64_t cycles;		/* cycle counter ticks of last run */
+	uint64_t cycles_total;		/* cycle counter ticks total */
 	double duration_total;		/* wall clock duration */
 	pid_t pid;			/* stressor pid */
 	bool sigalarmed;		/* set true if signalled with SIGALRM */
 	bool signalled;			/* set true if signalled with a kill */
 	bool completed;			/* true if stressor completed */
+	uint8_t state;			/* STRESS_STATE_* run state */
 #if defined(STRESS_PERF_STATS)
 	stress_perf_t sp;		/* perf counters */
 #endif
@@ -538,19 +687,38 @@ typedef struct stress_stats {
 	stress_checksum_t *checksum;	/* pointer to checksum data */
 	stress_interrupts_t interrupts[STRESS_INTERRUPTS_MAX];
 	stress_metrics_data_t metrics;	/* misc metrics */
+	stress_samples_t samples;	/* bogo-op counter samples */
+	stress_latency_t latency;	/* latency histogram */
+	stress_ops_rate_t ops_rate;	/* --ops-rate pacing and schedule latency */
+	stress_numa_pages_t numa_pages;	/* peak --numa-policy resident pages */
+	stress_freq_t freq;		/* --freq-stats effective CPU frequency */
+	stress_cstates_t cstates;	/* --cstate-stats C-state residency */
+	stress_taskstats_t taskstats;	/* --taskstats delay accounting */
+	stress_harness_profile_t harness; /* --harness-profile phase timings */
+	stress_warmup_t warmup;		/* --warmup snapshot */
 	double rusage_utime;		/* rusage user time */
 	double rusage_stime;		/* rusage system time */
 	double rusage_utime_total;	/* rusage user time */
 	double rusage_stime_total;	/* rusage system time */
 	long int rusage_maxrss;		/* rusage max RSS, 0 = unused */
+	stress_rusage_counts_t rusage_counts; /* rusage faults and context switches */
+	stress_rusage_counts_t rusage_counts_total; /* total rusage faults and context switches */
 } stress_stats_t;
 
+/* Shared heap size classes, 16 bytes to 4K in powers of 2 */
+#define STRESS_SHARED_HEAP_CLASSES	(9)
+/* Shared heap string hash table buckets */
+#define STRESS_SHARED_HEAP_STR_HASH	(16)
+
 typedef struct shared_heap {
-	void *str_list_head;		/* list of heap strings */
+	void *str_hash[STRESS_SHARED_HEAP_STR_HASH]; /* hashed lists of heap strings */
+	void *str_lock[STRESS_SHARED_HEAP_STR_HASH]; /* per hash bucket string locks */
 	void *lock;			/* heap global lock */
 	void *heap;			/* mmap'd heap */
 	size_t heap_size;		/* heap size */
-	size_t offset;			/* next free offset in current slab */
+	size_t offset;			/* next unused slab offset */
+	void *free_list[STRESS_SHARED_HEAP_CLASSES]; /* free blocks per size class */
+	void *large_list;		/* free multi-slab spans */
 	bool out_of_memory;		/* true if allocation failed */
 } shared_heap_t;
 
@@ -579,6 +747,7 @@ typedef struct {
 		uint32_t reaped;	/* Number of stressors reaped */
 		uint32_t failed;	/* Number of stressors failed */
 		uint32_t alarmed;	/* Number of stressors got SIGALRM */
+		uint32_t total;		/* Total number of stressor instances */
 	} instance_count;
 	struct {
 		uint8_t	*buffer;	/* Shared memory cache buffer */
@@ -634,6 +803,12 @@ typedef struct {
 	struct {
 		uint32_t ready;		/* incremented when rawsock stressor is ready */
 	} rawsock;
+	struct {
+		uint32_t released ALIGNED(4);	/* futex, non-zero once released */
+		uint32_t arrived;	/* instances that reached the barrier */
+		uint32_t expected;	/* instances expected, 0 = not yet known */
+		void *lock;		/* lock on arrived, expected updates */
+	} sync_start;			/* --sync-start barrier */
 	stress_stats_t stats[];		/* Shared statistics */
 } stress_shared_t;
 
@@ -675,6 +850,8 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_continue_set_flag(const bool s
 	g_stress_continue_flag = setting;
 }
 
+extern void stress_ops_rate_pace(struct stress_ops_rate *ops_rate, const uint64_t inc);
+
 /*
  *  stress_bogo_add()
  *	add inc to the stessor bogo ops counter
@@ -690,6 +867,8 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_add(stress_args_t *args,
 	args->ci.counter += inc;
 	stress_asm_mb();
 	args->ci.counter_ready = true;
+	if (UNLIKELY(args->ops_rate != NULL))
+		stress_ops_rate_pace(args->ops_rate, inc);
 }
 
 /*
@@ -707,6 +886,8 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_inc(stress_args_t *args)
 	args->ci.counter++;
 	stress_asm_mb();
 	args->ci.counter_ready = true;
+	if (UNLIKELY(args->ops_rate != NULL))
+		stress_ops_rate_pace(args->ops_rate, 1);
 }
 
 /*
@@ -805,11 +986,13 @@ static inline bool stress_bogo_inc_lock(stress_args_t *args, void *lock, const b
 
 #define STRESS_GEOMETRIC_MEAN	(1)
 #define STRESS_HARMONIC_MEAN	(2)
+#define STRESS_MERGED_VALUE	(3)	/* same value set on all instances */
 
 extern WARN_UNUSED int stress_parse_opts(int argc, char **argv, const bool jobmode);
 extern void stress_shared_readonly(void);
 extern void stress_shared_unmap(void);
 extern void stress_log_system_mem_info(void);
+extern double stress_metrics_mean(const stress_stressor_t *ss, const size_t idx);
 extern void stress_metrics_set_const_check(stress_args_t *args,
 	const size_t idx, char *description, const bool const_description, const double value, const int mean_type);
 #if defined(HAVE_BUILTIN_CONSTANT_P)
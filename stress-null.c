@@ -207,5 +207,6 @@ stressor_info_t stress_null_info = {
 	.class = CLASS_DEV | CLASS_MEMORY | CLASS_OS,
 	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
-	.help = help
+	.help = help,
+	.thread_safe = true
 };
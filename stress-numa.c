@@ -35,6 +35,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"numa N",		"start N workers stressing NUMA interfaces" },
 	{ NULL,	"numa-bytes N",		"size of memory region to be exercised" },
+	{ NULL,	"numa-migrate-sweep",	"measure 4K and THP page migration throughput over move_pages batch sizes" },
 	{ NULL,	"numa-ops N",		"stop after N NUMA bogo operations" },
 	{ NULL,	"numa-shuffle-addr",	"shuffle page addresses to move to numa nodes" },
 	{ NULL,	"numa-shuffle-node",	"shuffle numa nodes on numa pages moves" },
@@ -51,6 +52,11 @@ static int stress_set_numa_bytes(const char *opt)
 	return stress_set_setting("numa-bytes", TYPE_ID_SIZE_T, &numa_bytes);
 }
 
+static int stress_set_numa_migrate_sweep(const char *opt)
+{
+	return stress_set_setting_true("numa-migrate-sweep", opt);
+}
+
 static int stress_set_numa_shuffle_addr(const char *opt)
 {
 	return stress_set_setting_true("numa-shuffle-addr", opt);
@@ -63,8 +69,10 @@ static int stress_set_numa_shuffle_node(const char *opt)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_numa_bytes,		stress_set_numa_bytes },
+	{ OPT_numa_migrate_sweep,	stress_set_numa_migrate_sweep },
 	{ OPT_numa_shuffle_addr,	stress_set_numa_shuffle_addr },
 	{ OPT_numa_shuffle_node,	stress_set_numa_shuffle_node },
+	{ 0,				NULL },
 };
 
 #if defined(__NR_get_mempolicy) &&	\
@@ -135,12 +143,57 @@ typedef struct stress_node {
 
 #define STRESS_NUMA_STAT_NUMA_HIT	(0)
 #define STRESS_NUMA_STAT_NUMA_MISS	(1)
-#define STRESS_NUMA_STAT_MAX		(2)
+#define STRESS_NUMA_STAT_PGMIGRATE	(2)
+#define STRESS_NUMA_STAT_THP_MIGRATE	(3)
+#define STRESS_NUMA_STAT_MAX		(4)
+
+#define STRESS_NUMA_THP_SIZE		(2 * MB)
+#define STRESS_NUMA_SWEEP_4K		(0)
+#define STRESS_NUMA_SWEEP_THP		(1)
+#define STRESS_NUMA_SWEEP_KINDS		(2)
+
+/* move_pages batch sizes, in pages per system call */
+static const size_t numa_sweep_batches[] = {
+	1, 8, 64, 512, 4096
+};
+
+typedef struct {
+	double pages;		/* pages (or THPs) migrated */
+	double bytes;		/* bytes migrated */
+	double duration;	/* time spent in move_pages */
+} stress_numa_sweep_t;
 
 typedef struct {
 	uint64_t value[STRESS_NUMA_STAT_MAX];
 } stress_numa_stats_t;
 
+/*
+ *  stress_numa_vmstat_field()
+ *	read a /proc/vmstat counter, 0 if not available
+ */
+static uint64_t stress_numa_vmstat_field(const char *field)
+{
+	FILE *fp;
+	char buffer[256];
+	const size_t len = strlen(field);
+	uint64_t val = 0;
+
+	fp = fopen("/proc/vmstat", "r");
+	if (!fp)
+		return 0;
+
+	while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+		if ((strncmp(buffer, field, len) == 0) && (buffer[len] == ' ')) {
+			if (sscanf(buffer + len + 1, "%" SCNu64, &val) != 1)
+				val = 0;
+			break;
+		}
+	}
+	(void)fclose(fp);
+
+	return val;
+}
+
 static void stress_numa_stats_read(stress_numa_stats_t *stats)
 {
 	DIR *dir;
@@ -194,6 +247,12 @@ static void stress_numa_stats_read(stress_numa_stats_t *stats)
 		(void)fclose(fp);
 	}
 	(void)closedir(dir);
+
+	/* system wide page migration counters */
+	stats->value[STRESS_NUMA_STAT_PGMIGRATE] =
+		stress_numa_vmstat_field("pgmigrate_success");
+	stats->value[STRESS_NUMA_STAT_THP_MIGRATE] =
+		stress_numa_vmstat_field("thp_migration_success");
 }
 
 /*
@@ -313,6 +372,165 @@ static inline void stress_set_numa_array(void *array, uint8_t val, size_t nmemb,
 	(void)shim_memset(array, val, n);
 }
 
+/*
+ *  stress_numa_migrate()
+ *	move nr entries of pages to node in batches of batch pages
+ *	per move_pages call, return the number of entries that ended
+ *	up on node or -1 on failure. The move_pages time is added to
+ *	duration.
+ */
+static long stress_numa_migrate(
+	stress_args_t *args,
+	void **pages,
+	int *dest_nodes,
+	int *status,
+	const size_t nr,
+	const size_t batch,
+	const int node,
+	double *duration)
+{
+	size_t i;
+	long migrated = 0;
+	double t;
+
+	for (i = 0; i < nr; i++) {
+		dest_nodes[i] = node;
+		status[i] = -1;
+	}
+
+	t = stress_time_now();
+	for (i = 0; i < nr; i += batch) {
+		const size_t count = STRESS_MINIMUM(batch, nr - i);
+		const long lret = shim_move_pages(args->pid, count, pages + i,
+			dest_nodes + i, status + i, MPOL_MF_MOVE);
+
+		if (UNLIKELY(lret < 0)) {
+			if (errno != ENOSYS) {
+				pr_fail("%s: move_pages failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			}
+			return -1;
+		}
+	}
+	*duration += stress_time_now() - t;
+
+	for (i = 0; i < nr; i++)
+		migrated += (status[i] == node);
+
+	return migrated;
+}
+
+/*
+ *  stress_numa_migrate_sweep()
+ *	migrate a 4K page and a THP backed buffer between NUMA nodes
+ *	using a range of move_pages batch sizes, report the migration
+ *	throughput for each page kind and batch size
+ */
+static int stress_numa_migrate_sweep(
+	stress_args_t *args,
+	stress_node_t *n,
+	uint8_t *buf,
+	const size_t numa_bytes,
+	void **pages,
+	int *dest_nodes,
+	int *status)
+{
+	static const char * const kinds[STRESS_NUMA_SWEEP_KINDS] = { "4K", "THP" };
+	stress_numa_sweep_t sweep[STRESS_NUMA_SWEEP_KINDS][SIZEOF_ARRAY(numa_sweep_batches)];
+	const size_t page_size = args->page_size;
+	const size_t thp_bytes = STRESS_MAXIMUM(numa_bytes & ~(STRESS_NUMA_THP_SIZE - 1), STRESS_NUMA_THP_SIZE);
+	uint8_t *thp_mmap, *thp_buf;
+	size_t kind, i, nr[STRESS_NUMA_SWEEP_KINDS], idx = 2;
+	bool thp_backed = false;
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+
+	/* over allocate so the THP buffer can be 2MB aligned */
+	thp_mmap = (uint8_t *)mmap(NULL, thp_bytes + STRESS_NUMA_THP_SIZE, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (thp_mmap == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for THP buffer, errno=%d (%s), skipping stressor\n",
+			args->name, thp_bytes, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	thp_buf = (uint8_t *)(((uintptr_t)thp_mmap + STRESS_NUMA_THP_SIZE - 1) & ~((uintptr_t)STRESS_NUMA_THP_SIZE - 1));
+#if defined(MADV_HUGEPAGE)
+	(void)madvise((void *)thp_buf, thp_bytes, MADV_HUGEPAGE);
+#endif
+#if defined(MADV_NOHUGEPAGE)
+	(void)madvise((void *)buf, numa_bytes, MADV_NOHUGEPAGE);
+#endif
+	(void)stress_mmap_set_light(thp_buf, thp_bytes, page_size);
+	thp_backed = stress_smaps_field((void *)thp_buf, "AnonHugePages") > 0;
+	if ((args->instance == 0) && !thp_backed)
+		pr_inf("%s: THP buffer is not backed by transparent huge pages, THP results are for 4K pages\n",
+			args->name);
+
+	nr[STRESS_NUMA_SWEEP_4K] = numa_bytes / page_size;
+	nr[STRESS_NUMA_SWEEP_THP] = thp_bytes / STRESS_NUMA_THP_SIZE;
+
+	do {
+		for (kind = 0; kind < STRESS_NUMA_SWEEP_KINDS; kind++) {
+			uint8_t *ptr = (kind == STRESS_NUMA_SWEEP_4K) ? buf : thp_buf;
+			const size_t stride = (kind == STRESS_NUMA_SWEEP_4K) ? page_size : STRESS_NUMA_THP_SIZE;
+			double duration = 0.0;
+
+			for (i = 0; i < nr[kind]; i++)
+				pages[i] = ptr + (i * stride);
+
+			/* untimed move so each timed move starts on a different node */
+			if (stress_numa_migrate(args, pages, dest_nodes, status, nr[kind],
+						nr[kind], (int)n->node_id, &duration) < 0) {
+				rc = EXIT_FAILURE;
+				goto unmap;
+			}
+			for (i = 0; (i < SIZEOF_ARRAY(numa_sweep_batches)) && stress_continue(args); i++) {
+				const size_t batch = STRESS_MINIMUM(numa_sweep_batches[i], nr[kind]);
+				long migrated;
+
+				n = n->next;
+				duration = 0.0;
+				migrated = stress_numa_migrate(args, pages, dest_nodes, status, nr[kind],
+						batch, (int)n->node_id, &duration);
+				if (migrated < 0) {
+					rc = EXIT_FAILURE;
+					goto unmap;
+				}
+				sweep[kind][i].pages += (double)migrated;
+				sweep[kind][i].bytes += (double)migrated * (double)stride;
+				sweep[kind][i].duration += duration;
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	for (kind = 0; kind < STRESS_NUMA_SWEEP_KINDS; kind++) {
+		for (i = 0; i < SIZEOF_ARRAY(numa_sweep_batches); i++) {
+			const stress_numa_sweep_t *s = &sweep[kind][i];
+			const double pages_rate = (s->duration > 0.0) ? s->pages / s->duration : 0.0;
+			const double gb_rate = (s->duration > 0.0) ? s->bytes / (s->duration * (double)GB) : 0.0;
+			char msg[64];
+
+			if ((args->instance == 0) && (s->duration > 0.0)) {
+				if ((kind == 0) && (i == 0))
+					pr_inf("%s: %-4s %6s %16s %12s\n", args->name,
+						"page", "batch", "pages per sec", "GB per sec");
+				pr_inf("%s: %-4s %6zu %16.1f %12.3f\n", args->name,
+					kinds[kind], numa_sweep_batches[i], pages_rate, gb_rate);
+			}
+			(void)snprintf(msg, sizeof(msg), "%s migrate GB per sec, batch %zu",
+				kinds[kind], numa_sweep_batches[i]);
+			stress_metrics_set(args, idx++, msg, gb_rate, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+unmap:
+	(void)munmap((void *)thp_mmap, thp_bytes + STRESS_NUMA_THP_SIZE);
+
+	return rc;
+}
+
 /*
  *  stress_numa()
  *	stress the Linux NUMA interfaces
@@ -331,13 +549,14 @@ static int stress_numa(stress_args_t *args)
 	void **pages;
 	size_t mask_elements, k;
 	unsigned long *node_mask, *old_node_mask;
-	bool numa_shuffle_addr, numa_shuffle_node;
+	bool numa_shuffle_addr = false, numa_shuffle_node = false, numa_migrate_sweep = false;
 	stress_numa_stats_t stats_begin, stats_end;
-	double t, duration, rate;
+	double t, duration, rate, migrate_duration = 0.0;
 
 	(void)stress_get_setting("numa-bytes", &numa_bytes);
 	(void)stress_get_setting("numa-shuffle-addr", &numa_shuffle_addr);
 	(void)stress_get_setting("numa-shuffle-node", &numa_shuffle_node);
+	(void)stress_get_setting("numa-migrate-sweep", &numa_migrate_sweep);
 
 	if (numa_bytes == 0) {
 		numa_bytes = DEFAULT_NUMA_MMAP_BYTES;
@@ -422,11 +641,27 @@ static int stress_numa(stress_args_t *args)
 	stress_numa_stats_read(&stats_begin);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (numa_migrate_sweep) {
+		if (numa_nodes < 2) {
+			if (!args->instance)
+				pr_inf("%s: --numa-migrate-sweep needs at least 2 NUMA nodes, "
+					"ignoring option\n", args->name);
+		} else {
+			t = stress_time_now();
+			rc = stress_numa_migrate_sweep(args, n, buf, numa_bytes,
+				pages, dest_nodes, status);
+			duration = stress_time_now() - t;
+			stress_numa_stats_read(&stats_end);
+			goto metrics;
+		}
+	}
+
 	k = 0;
 	t = stress_time_now();
 	do {
 		int j, mode, ret;
 		long lret;
+		double t_migrate;
 		unsigned long i;
 		uint8_t *ptr;
 		stress_node_t *n_tmp;
@@ -670,8 +905,10 @@ static int stress_numa(stress_args_t *args)
 		/*
 	 	 *  Ignore any failures, this is not strictly important
 		 */
+		t_migrate = stress_time_now();
 		VOID_RET(long, shim_migrate_pages(args->pid, max_nodes,
 			old_node_mask, node_mask));
+		migrate_duration += stress_time_now() - t_migrate;
 
 		/*
 		 *  Exercise illegal pid
@@ -729,8 +966,10 @@ static int stress_numa(stress_args_t *args)
 				k = 0;
 
 			stress_set_numa_array(status, 0x00, num_pages, sizeof(*status));
+			t_migrate = stress_time_now();
 			lret = shim_move_pages(args->pid, num_pages, pages,
 				dest_nodes, status, MPOL_MF_MOVE);
+			migrate_duration += stress_time_now() - t_migrate;
 			if (UNLIKELY(lret < 0)) {
 				if (errno != ENOSYS) {
 					pr_fail("%s: move_pages failed, errno=%d (%s)\n",
@@ -792,6 +1031,20 @@ static int stress_numa(stress_args_t *args)
 	duration = stress_time_now() - t;
 	stress_numa_stats_read(&stats_end);
 
+	/*
+	 *  pgmigrate_success and thp_migration_success are system wide,
+	 *  so rates are per time spent in migrate_pages and move_pages
+	 */
+	rate = (migrate_duration > 0.0) ? ((double)stats_end.value[STRESS_NUMA_STAT_PGMIGRATE] -
+				 (double)stats_begin.value[STRESS_NUMA_STAT_PGMIGRATE]) / migrate_duration : 0.0;
+	stress_metrics_set(args, 2, "pages migrated per sec", rate, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 3, "migrated GB per sec", rate * (double)page_size / (double)GB, STRESS_GEOMETRIC_MEAN);
+	rate = (migrate_duration > 0.0) ? ((double)stats_end.value[STRESS_NUMA_STAT_THP_MIGRATE] -
+				 (double)stats_begin.value[STRESS_NUMA_STAT_THP_MIGRATE]) / migrate_duration : 0.0;
+	stress_metrics_set(args, 4, "THPs migrated per sec", rate, STRESS_GEOMETRIC_MEAN);
+	rc = EXIT_SUCCESS;
+
+metrics:
 	rate = (duration > 0) ? ((double)stats_end.value[STRESS_NUMA_STAT_NUMA_HIT] -
 				 (double)stats_begin.value[STRESS_NUMA_STAT_NUMA_HIT]) / duration : 0.0;
 	stress_metrics_set(args, 0, "NUMA hits per sec", rate, STRESS_GEOMETRIC_MEAN);
@@ -800,7 +1053,6 @@ static int stress_numa(stress_args_t *args)
 				 (double)stats_begin.value[STRESS_NUMA_STAT_NUMA_MISS]) / duration : 0.0;
 	stress_metrics_set(args, 1, "NUMA misses per sec", rate, STRESS_GEOMETRIC_MEAN);
 
-	rc = EXIT_SUCCESS;
 err:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	(void)munmap(buf, numa_bytes);
@@ -20,10 +20,12 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-ipc-sweep.h"
 
 static const stress_help_t help[] = {
 	{ "p N", "pipe N",		"start N workers exercising pipe I/O" },
 	{ NULL,	"pipe-data-size N",	"set pipe size of each pipe write to N bytes" },
+	{ NULL,	"pipe-ipc-sweep",	"sweep stream and ping-pong message sizes 8B..1MB" },
 	{ NULL,	"pipe-ops N",		"stop after N pipe I/O bogo operations" },
 #if defined(F_SETPIPE_SZ)
 	{ NULL,	"pipe-size N",		"set pipe size to N bytes" },
@@ -36,6 +38,11 @@ static const stress_help_t help[] = {
 #define PIPE_BUF	(4096)
 #endif
 
+static int stress_set_pipe_ipc_sweep(const char *opt)
+{
+	return stress_set_setting_true("pipe-ipc-sweep", opt);
+}
+
 static int stress_set_pipe_vmsplice(const char *opt)
 {
 	return stress_set_setting_true("pipe-vmsplice", opt);
@@ -551,6 +558,63 @@ static int stress_pipe_write_splice_verify(
 }
 #endif
 
+/* a pipe per direction for the IPC sweep */
+typedef struct {
+	int fds[2][2];
+} stress_pipe_ipc_t;
+
+static int stress_pipe_ipc_open(stress_args_t *args, void *ctxt, size_t *max_chunk)
+{
+	stress_pipe_ipc_t *ipc = (stress_pipe_ipc_t *)ctxt;
+
+	if (pipe(ipc->fds[STRESS_IPC_TO_CHILD]) < 0) {
+		pr_inf_skip("%s: pipe failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	if (pipe(ipc->fds[STRESS_IPC_TO_PARENT]) < 0) {
+		pr_inf_skip("%s: pipe failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		(void)close(ipc->fds[STRESS_IPC_TO_CHILD][0]);
+		(void)close(ipc->fds[STRESS_IPC_TO_CHILD][1]);
+		return -1;
+	}
+	*max_chunk = SIZE_MAX;
+	return 0;
+}
+
+static void stress_pipe_ipc_close(void *ctxt)
+{
+	stress_pipe_ipc_t *ipc = (stress_pipe_ipc_t *)ctxt;
+
+	(void)close(ipc->fds[STRESS_IPC_TO_CHILD][0]);
+	(void)close(ipc->fds[STRESS_IPC_TO_CHILD][1]);
+	(void)close(ipc->fds[STRESS_IPC_TO_PARENT][0]);
+	(void)close(ipc->fds[STRESS_IPC_TO_PARENT][1]);
+}
+
+static ssize_t stress_pipe_ipc_send(void *ctxt, const int dir, const void *buf, const size_t len)
+{
+	stress_pipe_ipc_t *ipc = (stress_pipe_ipc_t *)ctxt;
+
+	return write(ipc->fds[dir][1], buf, len);
+}
+
+static ssize_t stress_pipe_ipc_recv(void *ctxt, const int dir, void *buf, const size_t len)
+{
+	stress_pipe_ipc_t *ipc = (stress_pipe_ipc_t *)ctxt;
+
+	return read(ipc->fds[dir][0], buf, len);
+}
+
+static const stress_ipc_transport_t stress_pipe_ipc_transport = {
+	"pipe",
+	stress_pipe_ipc_open,
+	stress_pipe_ipc_close,
+	stress_pipe_ipc_send,
+	stress_pipe_ipc_recv,
+};
+
 /*
  *  stress_pipe
  *	stress by heavy pipe I/O
@@ -566,8 +630,14 @@ static int stress_pipe(stress_args_t *args)
 	const uint32_t val = stress_mwc32();
 	double duration = 0.0, rate;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
-	bool pipe_vmsplice = false;
+	bool pipe_vmsplice = false, pipe_ipc_sweep = false;
+
+	(void)stress_get_setting("pipe-ipc-sweep", &pipe_ipc_sweep);
+	if (pipe_ipc_sweep) {
+		stress_pipe_ipc_t ipc;
 
+		return stress_ipc_sweep(args, &stress_pipe_ipc_transport, &ipc);
+	}
 	(void)stress_get_setting("pipe-vmsplice", &pipe_vmsplice);
 	(void)stress_get_setting("pipe-data-size", &pipe_data_size);
 
@@ -739,6 +809,7 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_pipe_size,	stress_set_pipe_size },
 #endif
 	{ OPT_pipe_data_size,	stress_set_pipe_data_size },
+	{ OPT_pipe_ipc_sweep,	stress_set_pipe_ipc_sweep },
 	{ OPT_pipe_vmsplice,	stress_set_pipe_vmsplice },
 	{ 0,			NULL }
 };
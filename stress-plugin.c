@@ -38,17 +38,44 @@ static const stress_help_t help[] = {
     defined(HAVE_LIB_DL) &&	\
     !defined(BUILD_STATIC)
 
+#define STRESS_PLUGIN_V2_SYMBOL	"stress_plugin_v2_methods"
+#define STRESS_PLUGIN_BATCH_MAX		(1ULL << 24)	/* maximum ops per run(n) call */
+#define STRESS_PLUGIN_BATCH_TIME	(0.001)		/* target run(n) call time, seconds */
+#define STRESS_PLUGIN_METRICS_MAX	(32)		/* plugin defined metrics */
+
 typedef int (*stress_plugin_func)(void);
 
+/*
+ *  plugin v2 API, a plugin exports a table of methods named
+ *  stress_plugin_v2_methods terminated by a NULL name. init and
+ *  deinit are optional and called once per worker, run(n) performs
+ *  n bogo-ops per call and the metric callback passed to init
+ *  publishes named plugin metrics
+ */
+typedef void (*stress_plugin_metric_func)(const char *description, const double value);
+
+typedef struct {
+	const char *name;				/* method name */
+	int (*init)(stress_plugin_metric_func metric);	/* optional, 0 = success */
+	int (*run)(const uint64_t n);			/* perform n bogo-ops, 0 = success */
+	void (*deinit)(void);				/* optional */
+} stress_plugin_v2_t;
+
 typedef struct {
 	const char *name;
-	stress_plugin_func func;
+	stress_plugin_func func;		/* v1 method, NULL for v2 methods */
+	const stress_plugin_v2_t *v2;		/* v2 method, NULL for v1 methods */
 } stress_plugin_method_info_t;
 
 static stress_plugin_method_info_t *stress_plugin_methods;
 static size_t stress_plugin_methods_num;
+static bool stress_plugin_has_v2;
 static void *stress_plugin_so;
 
+static stress_args_t *stress_plugin_args;	/* args for plugin metric callback */
+static const char *stress_plugin_metric_names[STRESS_PLUGIN_METRICS_MAX];
+static size_t stress_plugin_metric_count;
+
 typedef struct {
 	const int signum;	/* Signal number */
 	const bool report;	/* true - report signal being handled */
@@ -134,13 +161,124 @@ static int stress_plugin_method_all(void)
 	register int ret = 0;
 
 	for (i = 1; stress_continue_flag() && (i < stress_plugin_methods_num); i++) {
-		ret = stress_plugin_methods[i].func();
+		const stress_plugin_method_info_t *method = &stress_plugin_methods[i];
+
+		ret = method->func ? method->func() : method->v2->run(1);
 		if (ret)
 			break;
 	}
 	return ret;
 }
 
+/*
+ *  stress_plugin_metric()
+ *	plugin v2 metric callback, metrics are indexed by
+ *	description in the order the plugin first publishes them,
+ *	metric 0 is the harness measured time per bogo-op
+ */
+static void stress_plugin_metric(const char *description, const double value)
+{
+	size_t i;
+
+	if (!stress_plugin_args || !description)
+		return;
+
+	for (i = 0; i < stress_plugin_metric_count; i++) {
+		if (!strcmp(stress_plugin_metric_names[i], description))
+			break;
+	}
+	if (i == stress_plugin_metric_count) {
+		if (stress_plugin_metric_count >= STRESS_PLUGIN_METRICS_MAX)
+			return;
+		stress_plugin_metric_names[stress_plugin_metric_count++] = description;
+	}
+	stress_metrics_set(stress_plugin_args, i + 1, (char *)description,
+		value, STRESS_GEOMETRIC_MEAN);
+}
+
+/*
+ *  stress_plugin_v2_init()
+ *	call the init function of v2 plugin methods, all v2 methods
+ *	if method is NULL, returns non-zero on failure
+ */
+static int stress_plugin_v2_init(const stress_plugin_method_info_t *method)
+{
+	size_t i;
+
+	if (method)
+		return method->v2->init ? method->v2->init(stress_plugin_metric) : 0;
+
+	for (i = 1; i < stress_plugin_methods_num; i++) {
+		const stress_plugin_v2_t *v2 = stress_plugin_methods[i].v2;
+
+		if (v2 && v2->init && v2->init(stress_plugin_metric))
+			return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_plugin_v2_deinit()
+ *	call the deinit function of v2 plugin methods, all v2
+ *	methods if method is NULL
+ */
+static void stress_plugin_v2_deinit(const stress_plugin_method_info_t *method)
+{
+	size_t i;
+
+	if (method) {
+		if (method->v2->deinit)
+			method->v2->deinit();
+		return;
+	}
+
+	for (i = 1; i < stress_plugin_methods_num; i++) {
+		const stress_plugin_v2_t *v2 = stress_plugin_methods[i].v2;
+
+		if (v2 && v2->deinit)
+			v2->deinit();
+	}
+}
+
+/*
+ *  stress_plugin_v2_run()
+ *	call a v2 plugin method run(n) in batches, the batch size
+ *	doubles until a call takes ~1ms to amortize the call and
+ *	harness loop overhead over many bogo-ops
+ */
+static void stress_plugin_v2_run(stress_args_t *args, const stress_plugin_v2_t *v2)
+{
+	uint64_t batch = 1;
+	double duration = 0.0, ops = 0.0;
+
+	do {
+		uint64_t n = batch;
+		double t;
+
+		if (args->max_ops) {
+			const uint64_t done = stress_bogo_get(args);
+
+			if (done >= args->max_ops)
+				break;
+			n = STRESS_MINIMUM(n, args->max_ops - done);
+		}
+		t = stress_time_now();
+		if (v2->run(n))
+			break;
+		t = stress_time_now() - t;
+		stress_bogo_add(args, n);
+		duration += t;
+		ops += (double)n;
+
+		if ((t < STRESS_PLUGIN_BATCH_TIME) && (batch < STRESS_PLUGIN_BATCH_MAX))
+			batch <<= 1;
+	} while (stress_continue(args));
+
+	if (ops > 0.0)
+		stress_metrics_set(args, 0, "nanosecs per bogo-op",
+			(duration * STRESS_DBL_NANOSECOND) / ops, STRESS_HARMONIC_MEAN);
+}
+
 /*
  *  stress_set_plugin_so()
  *     set default plugin shared object file
@@ -152,7 +290,8 @@ static int stress_set_plugin_so(const char *opt)
 	ElfW(Dyn) *section;
 	char * strtab = NULL;
 	unsigned long symentries = 0;
-	size_t i, size, n_funcs;
+	size_t i, size, n_funcs, n_v2;
+	const stress_plugin_v2_t *v2;
 
 	stress_plugin_methods = NULL;
 	stress_plugin_methods_num = 0;
@@ -202,14 +341,25 @@ static int stress_set_plugin_so(const char *opt)
 				n_funcs++;
 		}
 	}
-	if (!n_funcs) {
+
+	/* optional v2 method table */
+	v2 = (const stress_plugin_v2_t *)dlsym(stress_plugin_so, STRESS_PLUGIN_V2_SYMBOL);
+	for (n_v2 = 0; v2 && v2[n_v2].name; n_v2++) {
+		if (!v2[n_v2].run) {
+			fprintf(stderr, "plugin-so: %s method %s has no run function\n",
+				STRESS_PLUGIN_V2_SYMBOL, v2[n_v2].name);
+			return -1;
+		}
+	}
+
+	if (!n_funcs && !n_v2) {
 		fprintf(stderr, "plugin-so: cannot find any function symbols in file %s\n", opt);
 		return -1;
 	}
 
-	stress_plugin_methods = calloc(n_funcs + 1, sizeof(*stress_plugin_methods));
+	stress_plugin_methods = calloc(n_funcs + n_v2 + 1, sizeof(*stress_plugin_methods));
 	if (!stress_plugin_methods) {
-		fprintf(stderr, "plugin-so: cannot allocate %zu plugin methods\n", n_funcs);
+		fprintf(stderr, "plugin-so: cannot allocate %zu plugin methods\n", n_funcs + n_v2);
 		return -1;
 	}
 
@@ -234,7 +384,13 @@ static int stress_set_plugin_so(const char *opt)
 			}
 		}
 	}
+	for (i = 0; i < n_v2; i++) {
+		stress_plugin_methods[n_funcs].name = v2[i].name;
+		stress_plugin_methods[n_funcs].v2 = &v2[i];
+		n_funcs++;
+	}
 	stress_plugin_methods_num = n_funcs;
+	stress_plugin_has_v2 = (n_v2 > 0);
 
 	return 0;
 }
@@ -281,7 +437,7 @@ static int stress_plugin(stress_args_t *args)
 	int rc;
 	size_t i;
 	size_t plugin_method = 0;
-	stress_plugin_func func;
+	const stress_plugin_method_info_t *method;
 	const size_t sig_count_size = MAX_SIGS * sizeof(*sig_count);
 	bool report_sigs;
 
@@ -317,9 +473,9 @@ static int stress_plugin(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
-	func = stress_plugin_methods[plugin_method].func;
+	method = &stress_plugin_methods[plugin_method];
 	if (args->instance == 0)
-		pr_dbg("%s: exercising plugin method '%s'\n", args->name, stress_plugin_methods[plugin_method].name);
+		pr_dbg("%s: exercising plugin method '%s'\n", args->name, method->name);
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -353,14 +509,33 @@ again:
 					_exit(EXIT_FAILURE);
 			}
 
+			/*
+			 *  v2 plugins stop on SIGALRM rather than exiting so
+			 *  that deinit can publish the plugin metrics
+			 */
+			if (stress_plugin_has_v2 &&
+			    (stress_sighandler(args->name, SIGALRM, stress_handle_stop_stressing, NULL) < 0))
+				_exit(EXIT_FAILURE);
+
 			/* Disable stack smashing messages */
 			stress_set_stack_smash_check_flag(false);
 
-			do {
-				if (func())
-					break;
-				stress_bogo_inc(args);
-			} while (stress_continue(args));
+			stress_plugin_args = args;
+			if (stress_plugin_v2_init(method->v2 ? method : NULL))
+				_exit(EXIT_NO_RESOURCE);
+
+			if (method->v2) {
+				stress_plugin_v2_run(args, method->v2);
+			} else {
+				stress_plugin_func func = method->func;
+
+				do {
+					if (func())
+						break;
+					stress_bogo_inc(args);
+				} while (stress_continue(args));
+			}
+			stress_plugin_v2_deinit(method->v2 ? method : NULL);
 			_exit(0);
 		}
 		if (pid > 0) {
@@ -373,6 +548,11 @@ again:
 						args->name, errno, strerror(errno));
 				stress_force_killed_bogo(args);
 				(void)stress_kill_pid_wait(pid, NULL);
+			} else if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_NO_RESOURCE)) {
+				pr_inf_skip("%s: plugin method '%s' failed to initialize, skipping stressor\n",
+					args->name, method->name);
+				rc = EXIT_NO_RESOURCE;
+				goto err;
 			}
 		}
 	} while (stress_continue(args));
@@ -38,6 +38,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"prefetch-l3-size N",	"specify the L3 cache size of the CPU" },
 	{ NULL, "prefetch-method M",	"specify the prefetch method" },
 	{ NULL,	"prefetch-ops N",	"stop after N bogo prefetching operations" },
+	{ NULL,	"prefetch-sweep",	"sweep prefetch distance and stride for all methods" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -126,6 +127,11 @@ static int stress_set_prefetch_method(const char *opt)
 	return -1;
 }
 
+static int stress_set_prefetch_sweep(const char *opt)
+{
+	return stress_set_setting_true("prefetch-sweep", opt);
+}
+
 static inline uint64_t get_prefetch_L3_size(stress_args_t *args)
 {
 	uint64_t cache_size = DEFAULT_PREFETCH_L3_SIZE;
@@ -355,6 +361,250 @@ static uint64_t stress_prefetch_data_set(uint64_t *l3_data, const uint64_t *l3_d
 	return checksum;
 }
 
+/*
+ *  Prefetch distance sweep, for each working set size and read stride
+ *  (in cache lines) every available method is timed at prefetch distances
+ *  of 0 (no prefetch) up to STRESS_PREFETCH_SWEEP_MAX_DIST strides ahead
+ */
+#define STRESS_PREFETCH_SWEEP_SIZES	(4)
+#define STRESS_PREFETCH_SWEEP_MAX_DIST	(64)
+#define STRESS_PREFETCH_SWEEP_MAX_STRIDE (4)
+
+static const size_t prefetch_sweep_dists[] = {
+	0, 1, 2, 4, 8, 16, 32, STRESS_PREFETCH_SWEEP_MAX_DIST
+};
+
+static const size_t prefetch_sweep_strides[] = {
+	1, 2, STRESS_PREFETCH_SWEEP_MAX_STRIDE
+};
+
+typedef struct {
+	double bytes;		/* cache line bytes read */
+	double duration;	/* time taken to read them */
+} stress_prefetch_sweep_t;
+
+#define STRESS_PREFETCH_SWEEP_LOOP(func)				\
+	while (ptr < end) {						\
+		func((void *)(ptr + pre_off));				\
+		sum += *ptr;						\
+		ptr += step;						\
+	}
+
+/*
+ *  stress_prefetch_sweep_pass()
+ *	read one 64 bit word every stride cache lines from data to end
+ *	prefetching dist strides ahead, returns the read duration
+ */
+static double OPTIMIZE3 stress_prefetch_sweep_pass(
+	const size_t prefetch_method,
+	uint64_t *data,
+	const uint64_t *end,
+	const size_t stride,
+	const size_t dist)
+{
+	const size_t step = stride * (STRESS_CACHE_LINE_SIZE / sizeof(uint64_t));
+	const size_t pre_off = dist * step;
+	volatile uint64_t *ptr = data;
+	register uint64_t sum = 0;
+	double t;
+
+	shim_cacheflush((char *)data, (int)((uintptr_t)end - (uintptr_t)data), SHIM_DCACHE);
+
+	t = stress_time_now();
+	if (dist == 0) {
+		STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_none);
+	} else {
+		switch (prefetch_method) {
+		default:
+		case STRESS_PREFETCH_BUILTIN:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_builtin);
+			break;
+		case STRESS_PREFETCH_BUILTIN_L0:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_builtin_locality0);
+			break;
+		case STRESS_PREFETCH_BUILTIN_L3:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_prefetch_builtin_locality3);
+			break;
+#if defined(HAVE_ASM_X86_PREFETCHT0)
+		case STRESS_PREFETCH_X86_PREFETCHT0:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetcht0);
+			break;
+#endif
+#if defined(HAVE_ASM_X86_PREFETCHT1)
+		case STRESS_PREFETCH_X86_PREFETCHT1:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetcht1);
+			break;
+#endif
+#if defined(HAVE_ASM_X86_PREFETCHT2)
+		case STRESS_PREFETCH_X86_PREFETCHT2:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetcht2);
+			break;
+#endif
+#if defined(HAVE_ASM_X86_PREFETCHNTA)
+		case STRESS_PREFETCH_X86_PREFETCHNTA:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_asm_x86_prefetchnta);
+			break;
+#endif
+#if defined(HAVE_ASM_PPC64_DCBT)
+		case STRESS_PREFETCH_PPC64_DCBT:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_asm_ppc64_dcbt);
+			break;
+#endif
+#if defined(HAVE_ASM_PPC64_DCBTST)
+		case STRESS_PREFETCH_PPC64_DCBTST:
+			STRESS_PREFETCH_SWEEP_LOOP(stress_asm_ppc64_dcbtst);
+			break;
+#endif
+		}
+	}
+	t = stress_time_now() - t;
+	stress_uint64_put(sum);
+
+	return t;
+}
+
+/*
+ *  stress_prefetch_sweep()
+ *	sweep prefetch distance and read stride for all the available
+ *	methods over working sets from 1/64th to twice the L3 size and
+ *	report the best distance and speedup over no prefetching
+ */
+static int stress_prefetch_sweep(stress_args_t *args, const size_t l3_data_size)
+{
+	const size_t n_methods = SIZEOF_ARRAY(prefetch_methods);
+	const size_t n_strides = SIZEOF_ARRAY(prefetch_sweep_strides);
+	const size_t n_dists = SIZEOF_ARRAY(prefetch_sweep_dists);
+	const size_t n_results = n_methods * STRESS_PREFETCH_SWEEP_SIZES * n_strides * n_dists;
+	const size_t slack = STRESS_PREFETCH_SWEEP_MAX_DIST * STRESS_PREFETCH_SWEEP_MAX_STRIDE * STRESS_CACHE_LINE_SIZE;
+	size_t sizes[STRESS_PREFETCH_SWEEP_SIZES];
+	size_t i, m, s, st, d, mmap_size, metric = 0;
+	stress_prefetch_sweep_t *results;
+	uint64_t *data;
+
+	for (s = 0; s < STRESS_PREFETCH_SWEEP_SIZES; s++) {
+		/* l3 / 64, l3 / 8, l3, l3 * 2 */
+		sizes[s] = (s < STRESS_PREFETCH_SWEEP_SIZES - 1) ?
+			l3_data_size >> (3 * (STRESS_PREFETCH_SWEEP_SIZES - 2 - s)) : l3_data_size * 2;
+		sizes[s] = STRESS_MAXIMUM(sizes[s], (size_t)MIN_PREFETCH_L3_SIZE);
+	}
+	mmap_size = sizes[STRESS_PREFETCH_SWEEP_SIZES - 1] + slack;
+
+	results = (stress_prefetch_sweep_t *)calloc(n_results, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate prefetch sweep results, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	data = (uint64_t *)mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+#if defined(MAP_POPULATE)
+		MAP_POPULATE |
+#endif
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate %zu bytes for prefetch sweep, skipping stressor\n",
+			args->name, mmap_size);
+		free(results);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)stress_prefetch_data_set(data, (uint64_t *)((uintptr_t)data + mmap_size));
+
+	if (args->instance == 0)
+		pr_inf("%s: sweeping prefetch distance and stride over %zu KB to %zu KB working sets\n",
+			args->name, sizes[0] >> 10, sizes[STRESS_PREFETCH_SWEEP_SIZES - 1] >> 10);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	/* each pass sweeps one method, rotating through the available methods */
+	m = 0;
+	do {
+		if (prefetch_methods[m].available()) {
+			for (s = 0; s < STRESS_PREFETCH_SWEEP_SIZES; s++) {
+				const uint64_t *end = (uint64_t *)((uintptr_t)data + sizes[s]);
+
+				/* untimed warm up so the first timed pass is not penalised */
+				(void)stress_prefetch_sweep_pass(STRESS_PREFETCH_BUILTIN, data, end, 1, 0);
+				for (st = 0; st < n_strides; st++) {
+					const size_t stride = prefetch_sweep_strides[st];
+					const double bytes = (double)(sizes[s] / (stride * STRESS_CACHE_LINE_SIZE)) *
+						STRESS_CACHE_LINE_SIZE;
+
+					for (d = 0; d < n_dists; d++) {
+						stress_prefetch_sweep_t *r;
+
+						i = (((m * STRESS_PREFETCH_SWEEP_SIZES) + s) * n_strides + st) * n_dists + d;
+						r = &results[i];
+						r->duration += stress_prefetch_sweep_pass(prefetch_methods[m].method,
+							data, end, stride, prefetch_sweep_dists[d]);
+						r->bytes += bytes;
+					}
+					if (!stress_continue_flag())
+						goto report;
+				}
+			}
+		}
+		stress_bogo_inc(args);
+		m = (m + 1) % n_methods;
+	} while (stress_continue(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_inf("%s: %-12s %10s %6s %10s %10s %10s %8s\n", args->name,
+			"method", "size KB", "stride", "dist lines", "none GB/s", "best GB/s", "speedup");
+	}
+	for (m = 0; m < n_methods; m++) {
+		for (s = 0; s < STRESS_PREFETCH_SWEEP_SIZES; s++) {
+			double best_speedup = 0.0;
+
+			for (st = 0; st < n_strides; st++) {
+				const size_t base = (((m * STRESS_PREFETCH_SWEEP_SIZES) + s) * n_strides + st) * n_dists;
+				double none_rate, best_rate = 0.0, speedup;
+				size_t best = 0;
+
+				if (results[base].duration <= 0.0)
+					continue;
+				none_rate = results[base].bytes / results[base].duration;
+				for (d = 1; d < n_dists; d++) {
+					const stress_prefetch_sweep_t *r = &results[base + d];
+					double rate;
+
+					if (r->duration <= 0.0)
+						continue;
+					rate = r->bytes / r->duration;
+					if (rate > best_rate) {
+						best_rate = rate;
+						best = d;
+					}
+				}
+				if (best_rate <= 0.0)
+					continue;
+				speedup = best_rate / none_rate;
+				best_speedup = STRESS_MAXIMUM(best_speedup, speedup);
+				if (args->instance == 0) {
+					pr_inf("%s: %-12s %10zu %6zu %10zu %10.2f %10.2f %8.2f\n", args->name,
+						prefetch_methods[m].name, sizes[s] >> 10,
+						prefetch_sweep_strides[st], prefetch_sweep_dists[best] *
+						prefetch_sweep_strides[st], none_rate / (double)GB,
+						best_rate / (double)GB, speedup);
+				}
+			}
+			if ((best_speedup > 0.0) && (metric < STRESS_STRESSOR_METRICS_MAX)) {
+				char msg[64];
+
+				(void)snprintf(msg, sizeof(msg), "%s %zu KB best prefetch speedup",
+					prefetch_methods[m].name, sizes[s] >> 10);
+				stress_metrics_set(args, metric++, msg, best_speedup, STRESS_GEOMETRIC_MEAN);
+			}
+		}
+	}
+
+	(void)munmap((void *)data, mmap_size);
+	free(results);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_prefetch()
  *	stress cache/memory/CPU with stream stressors
@@ -369,6 +619,7 @@ static int stress_prefetch(stress_args_t *args)
 	double best_rate, ns, non_prefetch_rate;
 	bool success = true;
 	bool check_prefetch_rate;
+	bool prefetch_sweep = false;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 
 	(void)stress_get_setting("prefetch-method", &prefetch_method);
@@ -387,6 +638,9 @@ static int stress_prefetch(stress_args_t *args)
 	(void)stress_get_setting("prefetch-L3-size", &l3_data_size);
 	if (l3_data_size == 0)
 		l3_data_size = get_prefetch_L3_size(args);
+	(void)stress_get_setting("prefetch-sweep", &prefetch_sweep);
+	if (prefetch_sweep)
+		return stress_prefetch_sweep(args, l3_data_size);
 
 	l3_data_mmap_size = l3_data_size + (STRESS_PREFETCH_OFFSETS * STRESS_CACHE_LINE_SIZE);
 
@@ -480,6 +734,7 @@ static int stress_prefetch(stress_args_t *args)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_prefetch_l3_size,	stress_set_prefetch_L3_size },
 	{ OPT_prefetch_method,	stress_set_prefetch_method  },
+	{ OPT_prefetch_sweep,	stress_set_prefetch_sweep },
 	{ 0,			NULL }
 };
 
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-path-latency.h"
 #include "core-pthread.h"
 #include "core-put.h"
 
@@ -36,9 +37,31 @@
 #endif
 
 static const stress_help_t help[] = {
-	{ NULL,	"procfs N",	"start N workers reading portions of /proc" },
-	{ NULL,	"procfs-ops N",	"stop procfs workers after N bogo read operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"procfs N",		"start N workers reading portions of /proc" },
+	{ NULL,	"procfs-latency N",	"report the N /proc paths with the slowest read times" },
+	{ NULL,	"procfs-ops N",		"stop procfs workers after N bogo read operations" },
+	{ NULL,	"procfs-yaml F",	"write per /proc path read times to YAML file F" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_procfs_latency(const char *opt)
+{
+	uint32_t procfs_latency;
+
+	procfs_latency = stress_get_uint32(opt);
+	stress_check_range("procfs-latency", (uint64_t)procfs_latency, 1, 1000);
+	return stress_set_setting("procfs-latency", TYPE_ID_UINT32, &procfs_latency);
+}
+
+static int stress_set_procfs_yaml(const char *opt)
+{
+	return stress_set_setting("procfs-yaml", TYPE_ID_STR, opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_procfs_latency,	stress_set_procfs_latency },
+	{ OPT_procfs_yaml,	stress_set_procfs_yaml },
+	{ 0,			NULL },
 };
 
 #if defined(HAVE_LIB_PTHREAD) &&	\
@@ -78,6 +101,7 @@ static sigset_t set;
 static shim_pthread_spinlock_t lock;
 static char proc_path[PATH_MAX];
 static uint32_t mixup;
+static stress_path_latency_t *procfs_latency;	/* NULL = not recording */
 
 /*
  *  stress_dirent_proc_prune()
@@ -155,6 +179,47 @@ static int mixup_sort(const struct dirent **d1, const struct dirent **d2)
 	return (s1 < s2) ? -1 : 1;
 }
 
+/*
+ *  stress_procfs_latency_add()
+ *	record the time to open and read a /proc path, the
+ *	process and thread IDs in the path are replaced with
+ *	PID and TID so the same file of all processes is merged
+ */
+static void stress_procfs_latency_add(const char *path, const double duration)
+{
+	char tmp[PATH_MAX], *dst = tmp;
+	const char *src = path;
+	int component = 0;
+
+	if (!procfs_latency)
+		return;
+
+	while (*src && (dst < tmp + sizeof(tmp) - 4)) {
+		if ((*src == '/') && isdigit((int)src[1])) {
+			const char *ptr = src + 1;
+
+			while (isdigit((int)*ptr))
+				ptr++;
+			if ((*ptr == '/') || (*ptr == '\0')) {
+				/* /proc/N and /proc/N/task/N */
+				if ((component == 1) ||
+				    ((component == 3) && (dst - tmp >= 5) && !strncmp(dst - 5, "/task", 5))) {
+					(void)shim_strscpy(dst, (component == 1) ? "/PID" : "/TID", 5);
+					dst += 4;
+					src = ptr;
+					component++;
+					continue;
+				}
+			}
+		}
+		if (*src == '/')
+			component++;
+		*dst++ = *src++;
+	}
+	*dst = '\0';
+	stress_path_latency_add(procfs_latency, tmp, duration);
+}
+
 /*
  *  stress_proc_self_mem()
  *	check if /proc/self/mem can be mmap'd and read and values
@@ -267,7 +332,7 @@ static inline void stress_proc_rw(
 	off_t pos;
 
 	while ((loops == -1) || (loops > 0)) {
-		double t_start;
+		double t_start, t_open, t_read;
 		bool timeout = false;
 		uint8_t *ptr;
 		struct stat statbuf;
@@ -295,8 +360,11 @@ static inline void stress_proc_rw(
 		if ((fd = open(path, O_RDONLY | O_NONBLOCK)) < 0)
 			return;
 
-		if ((stress_time_now() - t_start) > threshold)
+		t_open = stress_time_now() - t_start;
+		if (t_open > threshold) {
+			stress_procfs_latency_add(path, t_open);
 			goto timeout_close;
+		}
 		/*
 		 *  Check if there any special features to exercise
 		 */
@@ -354,6 +422,7 @@ static inline void stress_proc_rw(
 		/*
 		 *  Multiple randomly sized reads
 		 */
+		t_read = stress_time_now();
 		for (i = 0; i < 4096 * PROC_BUF_SZ; i++) {
 			const ssize_t sz = 1 + stress_mwc32modn((uint32_t)sizeof(buffer));
 
@@ -366,9 +435,12 @@ static inline void stress_proc_rw(
 				break;
 			i += sz;
 
-			if ((stress_time_now() - t_start) > threshold)
+			if ((stress_time_now() - t_start) > threshold) {
+				stress_procfs_latency_add(path, t_open + stress_time_now() - t_read);
 				goto timeout_close;
+			}
 		}
+		stress_procfs_latency_add(path, t_open + stress_time_now() - t_read);
 		(void)close(fd);
 
 		/* Multiple 1 char sized reads */
@@ -740,6 +812,32 @@ static char *stress_random_pid(void)
 	return path;
 }
 
+/*
+ *  stress_procfs_init()
+ *	create the per path read time table shared by all
+ *	the instances for --procfs-latency and --procfs-yaml
+ */
+static void stress_procfs_init(void)
+{
+	uint32_t top_n = 0;
+	char *yaml_filename = NULL;
+
+	(void)stress_get_setting("procfs-latency", &top_n);
+	(void)stress_get_setting("procfs-yaml", &yaml_filename);
+	if (top_n || yaml_filename)
+		procfs_latency = stress_path_latency_create("procfs-latency");
+}
+
+/*
+ *  stress_procfs_deinit()
+ *	free the per path read time table
+ */
+static void stress_procfs_deinit(void)
+{
+	stress_path_latency_destroy(procfs_latency);
+	procfs_latency = NULL;
+}
+
 /*
  *  stress_procfs_no_entries()
  *	report when no /proc entries are found
@@ -847,18 +945,31 @@ static int stress_procfs(stress_args_t *args)
 
 	stress_dirent_list_free(dlist, n);
 
+	if (procfs_latency) {
+		uint32_t top_n = 0;
+		char *yaml_filename = NULL;
+
+		(void)stress_get_setting("procfs-latency", &top_n);
+		(void)stress_get_setting("procfs-yaml", &yaml_filename);
+		stress_path_latency_report(args, procfs_latency, top_n ? top_n : 10, yaml_filename);
+	}
+
 	return EXIT_SUCCESS;
 }
 
 stressor_info_t stress_procfs_info = {
 	.stressor = stress_procfs,
+	.init = stress_procfs_init,
+	.deinit = stress_procfs_deinit,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_procfs_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without librt or only supported on Linux"
 };
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_MODIFY_LDT)
@@ -34,6 +35,8 @@
 #include <sys/prctl.h>
 #endif
 
+#include <sched.h>
+
 #define MIN_PTHREAD		(1)
 #define MAX_PTHREAD		(30000)
 #define DEFAULT_PTHREAD		(1024)
@@ -52,6 +55,7 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"pthread N",	 "start N workers that create multiple threads" },
+	{ NULL,	"pthread-compare", "compare pthread create, reused stacks, clone and a thread pool" },
 	{ NULL,	"pthread-max P", "create P threads at a time by each worker" },
 	{ NULL,	"pthread-ops N", "stop pthread workers after N bogo threads created" },
 	{ NULL,	NULL,		 NULL }
@@ -91,7 +95,13 @@ static int stress_set_pthread_max(const char *opt)
 	return stress_set_setting("pthread-max", TYPE_ID_UINT64, &pthread_max);
 }
 
+static int stress_set_pthread_compare(const char *opt)
+{
+	return stress_set_setting_true("pthread-compare", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_pthread_compare,	stress_set_pthread_compare },
 	{ OPT_pthread_max,	stress_set_pthread_max },
 	{ 0,			NULL }
 };
@@ -437,6 +447,504 @@ die:
  *  stress_pthread()
  *	stress by creating pthreads
  */
+#define PTHREAD_COMPARE_WORKERS_MAX	(64)
+#define PTHREAD_COMPARE_TASK_LOOPS	(256)
+#define PTHREAD_COMPARE_STACK_SIZE	(64 * KB)
+
+/* per task dispatch timestamps and result */
+typedef struct {
+	double t_dispatch;		/* time task was handed out */
+	volatile double t_start;	/* time task started running */
+	volatile uint32_t result;	/* micro-task result */
+	volatile bool done;		/* task completed */
+} stress_pthread_task_t;
+
+/* per worker task queue of the work stealing pool */
+typedef struct {
+	shim_pthread_spinlock_t lock;	/* queue lock */
+	size_t head;			/* steal end */
+	size_t tail;			/* owner end */
+	size_t *slots;			/* task indices */
+} stress_pthread_queue_t;
+
+/* task dispatch strategy state */
+typedef struct {
+	stress_args_t *args;
+	stress_pthread_task_t *tasks;	/* tasks of the current batch */
+	size_t n_tasks;			/* tasks per batch */
+	size_t stack_size;		/* size of each reused stack */
+	uint8_t *stacks;		/* reused stacks, one per task */
+	/* pool state */
+	pthread_t *workers;		/* persistent pool workers */
+	size_t n_workers;		/* number of workers started */
+	stress_pthread_queue_t *queues;	/* per worker queues */
+	pthread_mutex_t pool_mutex;	/* idle worker sleep lock */
+	pthread_cond_t pool_cond;	/* idle workers wait on this */
+	pthread_cond_t done_cond;	/* dispatcher waits on this */
+	size_t pending;			/* queued tasks not yet taken */
+	size_t completed;		/* tasks completed in batch */
+	bool pool_stop;			/* workers exit when set */
+} stress_pthread_compare_t;
+
+/* per worker argument */
+typedef struct {
+	stress_pthread_compare_t *cmp;
+	size_t id;
+} stress_pthread_worker_t;
+
+typedef struct {
+	const char *name;
+	int (*batch)(stress_pthread_compare_t *cmp);
+} stress_pthread_strategy_t;
+
+typedef struct {
+	stress_latency_t lat;			/* dispatch latency */
+	uint64_t tasks;				/* tasks completed */
+	double duration;			/* time spent in batches */
+	bool failed;
+} stress_pthread_result_t;
+
+/*
+ *  stress_pthread_task()
+ *	the micro-task run by each dispatch strategy
+ */
+static void stress_pthread_task(stress_pthread_task_t *task)
+{
+	uint32_t i, val = 0x9e3779b9;
+
+	task->t_start = stress_time_now();
+	for (i = 0; i < PTHREAD_COMPARE_TASK_LOOPS; i++) {
+		val ^= val << 13;
+		val ^= val >> 17;
+		val ^= val << 5;
+	}
+	task->result = val;
+	__atomic_store_n(&task->done, true, __ATOMIC_RELEASE);
+}
+
+static void *stress_pthread_task_func(void *arg)
+{
+	stress_pthread_task((stress_pthread_task_t *)arg);
+	return NULL;
+}
+
+/*
+ *  stress_pthread_batch_create()
+ *	create and join a pthread per task, libc allocates the stacks
+ */
+static int stress_pthread_batch_create(stress_pthread_compare_t *cmp)
+{
+	pthread_t pthreads_batch[PTHREAD_COMPARE_WORKERS_MAX];
+	size_t i, n;
+	int ret = 0;
+
+	for (n = 0; n < cmp->n_tasks; n++) {
+		cmp->tasks[n].t_dispatch = stress_time_now();
+		ret = pthread_create(&pthreads_batch[n], NULL,
+			stress_pthread_task_func, &cmp->tasks[n]);
+		if (ret)
+			break;
+	}
+	for (i = 0; i < n; i++)
+		(void)pthread_join(pthreads_batch[i], NULL);
+	if (ret && (ret != EAGAIN)) {
+		pr_fail("%s: pthread_create failed, errno=%d (%s)\n",
+			cmp->args->name, ret, strerror(ret));
+		return -1;
+	}
+	return (int)n;
+}
+
+#if defined(HAVE_PTHREAD_ATTR_SETSTACK)
+/*
+ *  stress_pthread_batch_create_stack()
+ *	create and join a pthread per task on pre-allocated stacks
+ *	that are reused by each batch
+ */
+static int stress_pthread_batch_create_stack(stress_pthread_compare_t *cmp)
+{
+	pthread_t pthreads_batch[PTHREAD_COMPARE_WORKERS_MAX];
+	size_t i, n;
+	int ret = 0;
+
+	for (n = 0; n < cmp->n_tasks; n++) {
+		pthread_attr_t attr;
+
+		ret = pthread_attr_init(&attr);
+		if (ret)
+			break;
+		ret = pthread_attr_setstack(&attr, cmp->stacks + (n * cmp->stack_size), cmp->stack_size);
+		if (ret) {
+			(void)pthread_attr_destroy(&attr);
+			break;
+		}
+		cmp->tasks[n].t_dispatch = stress_time_now();
+		ret = pthread_create(&pthreads_batch[n], &attr,
+			stress_pthread_task_func, &cmp->tasks[n]);
+		(void)pthread_attr_destroy(&attr);
+		if (ret)
+			break;
+	}
+	for (i = 0; i < n; i++)
+		(void)pthread_join(pthreads_batch[i], NULL);
+	if (ret && (ret != EAGAIN)) {
+		pr_fail("%s: pthread_create with reused stack failed, errno=%d (%s)\n",
+			cmp->args->name, ret, strerror(ret));
+		return -1;
+	}
+	return (int)n;
+}
+#endif
+
+#if defined(HAVE_CLONE) &&	\
+    defined(CLONE_VM) &&	\
+    defined(CLONE_FS) &&	\
+    defined(CLONE_FILES) &&	\
+    defined(__linux__)
+#define STRESS_PTHREAD_CLONE_VM
+
+static int stress_pthread_clone_func(void *arg)
+{
+	stress_pthread_task((stress_pthread_task_t *)arg);
+	return 0;
+}
+
+/*
+ *  stress_pthread_batch_clone_vm()
+ *	clone a raw CLONE_VM task per work item on the reused
+ *	stacks, no libc thread setup, and reap them
+ */
+static int stress_pthread_batch_clone_vm(stress_pthread_compare_t *cmp)
+{
+	pid_t pids[PTHREAD_COMPARE_WORKERS_MAX];
+	size_t i, n;
+	int err = 0;
+
+	for (n = 0; n < cmp->n_tasks; n++) {
+		char *stack_top = (char *)stress_get_stack_top(
+			(void *)(cmp->stacks + (n * cmp->stack_size)), cmp->stack_size);
+
+		cmp->tasks[n].t_dispatch = stress_time_now();
+		pids[n] = clone(stress_pthread_clone_func, stress_align_stack(stack_top),
+			CLONE_VM | CLONE_FS | CLONE_FILES | SIGCHLD, &cmp->tasks[n]);
+		if (pids[n] < 0) {
+			err = errno;
+			break;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		int status;
+
+		(void)shim_waitpid(pids[i], &status, 0);
+	}
+	if (err && (err != EAGAIN) && (err != ENOMEM)) {
+		pr_fail("%s: clone with CLONE_VM failed, errno=%d (%s)\n",
+			cmp->args->name, err, strerror(err));
+		return -1;
+	}
+	return (int)n;
+}
+#endif
+
+/*
+ *  stress_pthread_pool_take()
+ *	pop a task from the worker's own queue, else steal the
+ *	oldest task from another worker's queue
+ */
+static bool stress_pthread_pool_take(stress_pthread_compare_t *cmp, const size_t id, size_t *task)
+{
+	size_t i;
+
+	for (i = 0; i < cmp->n_workers; i++) {
+		stress_pthread_queue_t *q = &cmp->queues[(id + i) % cmp->n_workers];
+		bool found = false;
+
+		if (__atomic_load_n(&q->head, __ATOMIC_RELAXED) ==
+		    __atomic_load_n(&q->tail, __ATOMIC_RELAXED))
+			continue;
+		(void)shim_pthread_spin_lock(&q->lock);
+		if (q->head != q->tail) {
+			if (i == 0) {
+				q->tail--;
+				*task = q->slots[q->tail];
+			} else {
+				*task = q->slots[q->head];
+				q->head++;
+			}
+			found = true;
+		}
+		(void)shim_pthread_spin_unlock(&q->lock);
+		if (found)
+			return true;
+	}
+	return false;
+}
+
+/*
+ *  stress_pthread_pool_worker()
+ *	persistent pool worker, runs queued tasks and sleeps
+ *	when there is no more work to take or steal
+ */
+static void *stress_pthread_pool_worker(void *arg)
+{
+	const stress_pthread_worker_t *worker = (const stress_pthread_worker_t *)arg;
+	stress_pthread_compare_t *cmp = worker->cmp;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	for (;;) {
+		size_t task;
+
+		while (stress_pthread_pool_take(cmp, worker->id, &task)) {
+			stress_pthread_task(&cmp->tasks[task]);
+			(void)pthread_mutex_lock(&cmp->pool_mutex);
+			cmp->pending--;
+			cmp->completed++;
+			if (cmp->completed == cmp->n_tasks)
+				(void)pthread_cond_signal(&cmp->done_cond);
+			(void)pthread_mutex_unlock(&cmp->pool_mutex);
+		}
+		(void)pthread_mutex_lock(&cmp->pool_mutex);
+		while (!cmp->pool_stop && (cmp->pending == 0))
+			(void)pthread_cond_wait(&cmp->pool_cond, &cmp->pool_mutex);
+		if (cmp->pool_stop) {
+			(void)pthread_mutex_unlock(&cmp->pool_mutex);
+			break;
+		}
+		(void)pthread_mutex_unlock(&cmp->pool_mutex);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_pthread_batch_pool()
+ *	hand the batch to the persistent workers round robin
+ *	and wait for all the tasks to complete
+ */
+static int stress_pthread_batch_pool(stress_pthread_compare_t *cmp)
+{
+	size_t i;
+
+	if (cmp->n_workers == 0)
+		return -1;
+
+	(void)pthread_mutex_lock(&cmp->pool_mutex);
+	cmp->completed = 0;
+	for (i = 0; i < cmp->n_tasks; i++) {
+		stress_pthread_queue_t *q = &cmp->queues[i % cmp->n_workers];
+
+		cmp->tasks[i].t_dispatch = stress_time_now();
+		(void)shim_pthread_spin_lock(&q->lock);
+		q->slots[q->tail] = i;
+		q->tail++;
+		(void)shim_pthread_spin_unlock(&q->lock);
+	}
+	cmp->pending = cmp->n_tasks;
+	(void)pthread_cond_broadcast(&cmp->pool_cond);
+	while (cmp->completed < cmp->n_tasks)
+		(void)pthread_cond_wait(&cmp->done_cond, &cmp->pool_mutex);
+	(void)pthread_mutex_unlock(&cmp->pool_mutex);
+
+	/* queues are drained, rewind them for the next batch */
+	for (i = 0; i < cmp->n_workers; i++) {
+		stress_pthread_queue_t *q = &cmp->queues[i];
+
+		(void)shim_pthread_spin_lock(&q->lock);
+		q->head = 0;
+		q->tail = 0;
+		(void)shim_pthread_spin_unlock(&q->lock);
+	}
+	return (int)cmp->n_tasks;
+}
+
+static const stress_pthread_strategy_t stress_pthread_strategies[] = {
+	{ "create",		stress_pthread_batch_create },
+#if defined(HAVE_PTHREAD_ATTR_SETSTACK)
+	{ "create-stack",	stress_pthread_batch_create_stack },
+#endif
+#if defined(STRESS_PTHREAD_CLONE_VM)
+	{ "clone-vm",		stress_pthread_batch_clone_vm },
+#endif
+	{ "pool",		stress_pthread_batch_pool },
+};
+
+/*
+ *  stress_pthread_pool_stop()
+ *	stop and join the pool workers
+ */
+static void stress_pthread_pool_stop(stress_pthread_compare_t *cmp)
+{
+	size_t i;
+
+	(void)pthread_mutex_lock(&cmp->pool_mutex);
+	cmp->pool_stop = true;
+	(void)pthread_cond_broadcast(&cmp->pool_cond);
+	(void)pthread_mutex_unlock(&cmp->pool_mutex);
+	for (i = 0; i < cmp->n_workers; i++)
+		(void)pthread_join(cmp->workers[i], NULL);
+	for (i = 0; i < cmp->n_tasks; i++)
+		(void)shim_pthread_spin_destroy(&cmp->queues[i].lock);
+}
+
+/*
+ *  stress_pthread_compare()
+ *	dispatch batches of the same micro-task with pthread_create,
+ *	pthread_create on reused stacks, raw CLONE_VM clones and
+ *	a persistent work stealing pool, rotating the strategies
+ *	and reporting tasks per second and dispatch latency
+ */
+static int stress_pthread_compare(stress_args_t *args)
+{
+	const size_t n_strategies = SIZEOF_ARRAY(stress_pthread_strategies);
+	const int32_t cpus = stress_get_processors_online();
+	stress_pthread_compare_t cmp;
+	stress_pthread_worker_t *worker_args;
+	static stress_pthread_result_t results[SIZEOF_ARRAY(stress_pthread_strategies)];
+	size_t i, idx = 0, metric = 0;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&cmp, 0, sizeof(cmp));
+	(void)shim_memset(results, 0, sizeof(results));
+	cmp.args = args;
+	cmp.n_tasks = (size_t)STRESS_MAXIMUM(2, STRESS_MINIMUM(PTHREAD_COMPARE_WORKERS_MAX, cpus));
+	cmp.stack_size = STRESS_MAXIMUM(PTHREAD_COMPARE_STACK_SIZE, stress_get_min_pthread_stack_size());
+	cmp.stack_size = (cmp.stack_size + args->page_size - 1) & ~(args->page_size - 1);
+
+	cmp.tasks = (stress_pthread_task_t *)calloc(cmp.n_tasks, sizeof(*cmp.tasks));
+	cmp.workers = (pthread_t *)calloc(cmp.n_tasks, sizeof(*cmp.workers));
+	cmp.queues = (stress_pthread_queue_t *)calloc(cmp.n_tasks, sizeof(*cmp.queues));
+	worker_args = (stress_pthread_worker_t *)calloc(cmp.n_tasks, sizeof(*worker_args));
+	if (!cmp.tasks || !cmp.workers || !cmp.queues || !worker_args) {
+		pr_inf_skip("%s: cannot allocate task tables, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_tables;
+	}
+	cmp.stacks = (uint8_t *)mmap(NULL, cmp.n_tasks * cmp.stack_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (cmp.stacks == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu task stacks, skipping stressor\n",
+			args->name, cmp.n_tasks);
+		rc = EXIT_NO_RESOURCE;
+		goto free_tables;
+	}
+	for (i = 0; i < cmp.n_tasks; i++) {
+		cmp.queues[i].slots = (size_t *)calloc(cmp.n_tasks, sizeof(size_t));
+		if (!cmp.queues[i].slots) {
+			pr_inf_skip("%s: cannot allocate pool queues, skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto free_stacks;
+		}
+		(void)shim_pthread_spin_init(&cmp.queues[i].lock, SHIM_PTHREAD_PROCESS_PRIVATE);
+	}
+	(void)pthread_mutex_init(&cmp.pool_mutex, NULL);
+	(void)pthread_cond_init(&cmp.pool_cond, NULL);
+	(void)pthread_cond_init(&cmp.done_cond, NULL);
+
+	for (i = 0; i < cmp.n_tasks; i++) {
+		worker_args[i].cmp = &cmp;
+		worker_args[i].id = i;
+		if (pthread_create(&cmp.workers[i], NULL, stress_pthread_pool_worker, &worker_args[i]))
+			break;
+		cmp.n_workers++;
+	}
+
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_strategies : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		const stress_pthread_strategy_t *strategy = &stress_pthread_strategies[idx];
+		stress_pthread_result_t *result = &results[idx];
+		const double t_end = stress_time_now() + slice;
+
+		while (!result->failed && stress_continue(args)) {
+			const double t_start = stress_time_now();
+			double t;
+			int n;
+
+			(void)shim_memset(cmp.tasks, 0, cmp.n_tasks * sizeof(*cmp.tasks));
+			n = strategy->batch(&cmp);
+			t = stress_time_now();
+			if (n < 0) {
+				result->failed = true;
+				if (strcmp(strategy->name, "pool") || (cmp.n_workers > 0))
+					rc = EXIT_FAILURE;
+				break;
+			}
+			result->duration += t - t_start;
+			for (i = 0; i < (size_t)n; i++) {
+				const stress_pthread_task_t *task = &cmp.tasks[i];
+				uint64_t ns;
+
+				if (!task->done) {
+					pr_fail("%s: %s task %zu did not complete\n",
+						args->name, strategy->name, i);
+					result->failed = true;
+					rc = EXIT_FAILURE;
+					break;
+				}
+				ns = (task->t_start > task->t_dispatch) ?
+					(uint64_t)((task->t_start - task->t_dispatch) * STRESS_DBL_NANOSECOND) : 0;
+				stress_latency_add(&result->lat, ns);
+				result->tasks++;
+				stress_bogo_inc(args);
+			}
+			if (t >= t_end)
+				break;
+		}
+		idx++;
+		if (idx >= n_strategies)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_pthread_pool_stop(&cmp);
+	(void)pthread_cond_destroy(&cmp.done_cond);
+	(void)pthread_cond_destroy(&cmp.pool_cond);
+	(void)pthread_mutex_destroy(&cmp.pool_mutex);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-13s %12s %10s %10s %10s (%zu tasks per batch)\n", args->name,
+			"strategy", "tasks/sec", "p50 ns", "p99 ns", "p99.9 ns", cmp.n_tasks);
+	for (i = 0; i < n_strategies; i++) {
+		const stress_pthread_result_t *result = &results[i];
+		const char *name = stress_pthread_strategies[i].name;
+		const double rate = (result->duration > 0.0) ? (double)result->tasks / result->duration : 0.0;
+		char str[64];
+
+		if (result->tasks == 0)
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %-13s %12.0f %10.0f %10.0f %10.0f\n", args->name, name, rate,
+				(double)stress_latency_percentile(&result->lat, 50.0),
+				(double)stress_latency_percentile(&result->lat, 99.0),
+				(double)stress_latency_percentile(&result->lat, 99.9));
+		(void)snprintf(str, sizeof(str), "%s tasks per sec", name);
+		stress_metrics_set(args, metric++, str, rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s dispatch p50 (ns)", name);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&result->lat, 50.0), STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s dispatch p99 (ns)", name);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&result->lat, 99.0), STRESS_GEOMETRIC_MEAN);
+	}
+
+free_stacks:
+	for (i = 0; i < cmp.n_tasks; i++)
+		free(cmp.queues[i].slots);
+	(void)munmap((void *)cmp.stacks, cmp.n_tasks * cmp.stack_size);
+free_tables:
+	free(worker_args);
+	free(cmp.queues);
+	free(cmp.workers);
+	free(cmp.tasks);
+
+	return rc;
+}
+
 static int stress_pthread(stress_args_t *args)
 {
 	char msg[64];
@@ -447,6 +955,7 @@ static int stress_pthread(stress_args_t *args)
 	stress_pthread_args_t pargs = { args, NULL, 0 };
 	sigset_t set;
 	double count = 0.0, duration = 0.0, average;
+	bool pthread_compare = false;
 #if defined(HAVE_PTHREAD_ATTR_SETSTACK)
 	const size_t stack_size = STRESS_MAXIMUM(DEFAULT_STACK_MIN, stress_get_min_pthread_stack_size());
 #endif
@@ -459,6 +968,10 @@ static int stress_pthread(stress_args_t *args)
 	bool mutex_attr_init;
 #endif
 
+	(void)stress_get_setting("pthread-compare", &pthread_compare);
+	if (pthread_compare)
+		return stress_pthread_compare(args);
+
 	keep_running_flag = true;
 
 	/*
@@ -30,23 +30,28 @@
 
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
+static stress_sort_dist_stats_t dist_stats[STRESS_SORT_DIST_MAX];
 
 typedef int (*comp_func_t)(const void *v1, const void *v2);
 typedef void (*qsort_func_t)(void *base, size_t nmemb, size_t size, comp_func_t cmp);
 
 static const stress_help_t help[] = {
 	{ "Q N", "qsort N",		"start N workers qsorting 32 bit random integers" },
-	{ NULL,	"qsort-method M",	"select qsort method [ qsort-libc | qsort_bm ]" },
+	{ NULL,	"qsort-method M",	"select qsort method [ qsort-libc | qsort-bm | qsort-parallel | qsort-simd ]" },
 	{ NULL,	"qsort-ops N",		"stop after N qsort bogo operations" },
 	{ NULL,	"qsort-size N",		"number of 32 bit integers to sort" },
+	{ NULL,	"qsort-threads N",	"number of threads for the qsort-parallel method" },
 	{ NULL,	NULL,			NULL }
 };
 
 typedef struct {
 	const char *name;
 	const qsort_func_t qsort_func;
+	const bool counted;		/* comparator calls are counted */
 } stress_qsort_method_t;
 
+static uint32_t qsort_threads;
+
 /*
  *  stress_qsort_handler()
  *	SIGALRM generic handler
@@ -75,6 +80,20 @@ static int stress_set_qsort_size(const char *opt)
 	return stress_set_setting("qsort-size", TYPE_ID_UINT64, &qsort_size);
 }
 
+/*
+ *  stress_set_qsort_threads()
+ *	set number of qsort-parallel threads
+ */
+static int stress_set_qsort_threads(const char *opt)
+{
+	uint32_t threads;
+
+	threads = stress_get_uint32(opt);
+	stress_check_range("qsort-threads", (uint64_t)threads,
+		1, STRESS_SORT_THREADS_MAX);
+	return stress_set_setting("qsort-threads", TYPE_ID_UINT32, &threads);
+}
+
 typedef uint32_t qsort_swap_type_t;
 
 static inline size_t qsort_bm_minimum(const size_t x, const size_t y)
@@ -217,9 +236,31 @@ static void TARGET_CLONES OPTIMIZE3 qsort_bm(void *base, size_t n, size_t es, co
 		qsort_bm(pn - s, s / es, es, cmp);
 }
 
+/*
+ *  qsort_parallel()
+ *	libc qsort of a chunk per thread followed by parallel merges
+ */
+static void qsort_parallel(void *base, size_t nmemb, size_t size, comp_func_t cmp)
+{
+	stress_sort_parallel(base, nmemb, size, cmp, qsort, qsort_threads);
+}
+
+/*
+ *  qsort_simd()
+ *	vectorised sorting network and merge sort, 32 bit integers only
+ */
+static void qsort_simd(void *base, size_t nmemb, size_t size, comp_func_t cmp)
+{
+	(void)size;
+
+	stress_sort_int32_simd((int32_t *)base, nmemb, cmp);
+}
+
 static const stress_qsort_method_t stress_qsort_methods[] = {
-	{ "qsort-libc",		qsort },
-	{ "qsort-bm",		qsort_bm },
+	{ "qsort-libc",		qsort,		true },
+	{ "qsort-bm",		qsort_bm,	true },
+	{ "qsort-parallel",	qsort_parallel,	false },
+	{ "qsort-simd",		qsort_simd,	false },
 };
 
 static int stress_set_qsort_method(const char *opt)
@@ -312,11 +353,14 @@ static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 	int ret;
 	double rate;
 	NOCLOBBER double duration = 0.0, count = 0.0, sorted = 0.0;
+	NOCLOBBER double libc_rate;
 	qsort_func_t qsort_func;
 
 	stress_catch_sigill();
 
 	(void)stress_get_setting("qsort-method", &qsort_method);
+	qsort_threads = stress_sort_threads_default();
+	(void)stress_get_setting("qsort-threads", &qsort_threads);
 	if (!stress_get_setting("qsort-size", &qsort_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			qsort_size = MAX_QSORT_SIZE;
@@ -350,6 +394,7 @@ static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 
 
 	stress_sort_data_int32_init(data, n);
+	libc_rate = stress_sort_int32_libc_rate(data, n);
 
 	qsort_func = stress_qsort_methods[qsort_method].qsort_func;
 	if (args->instance == 0)
@@ -360,15 +405,19 @@ static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 
 	do {
 		double t;
+		size_t dist;
 
-		stress_sort_data_int32_shuffle(data, n);
+		dist = stress_sort_data_int32_dist(data, n, stress_bogo_get(args));
 
 		stress_sort_compare_reset();
 		t = stress_time_now();
 		/* Sort "random" data */
 		qsort_func(data, n, sizeof(*data), stress_sort_cmp_fwd_int32);
-		duration += stress_time_now() - t;
+		t = stress_time_now() - t;
+		duration += t;
 		count += (double)stress_sort_compare_get();
+		stress_sort_dist_stats_add(dist_stats, dist,
+			(double)stress_sort_compare_get(), n, t);
 		sorted += (double)n;
 
 		if (!stress_qsort_verify_forward(args, data, n))
@@ -417,11 +466,24 @@ static int OPTIMIZE3 stress_qsort(stress_args_t *args)
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 tidy:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	rate = (duration > 0.0) ? count / duration : 0.0;
-	stress_metrics_set(args, 0, "qsort comparisons per sec",
+	if (stress_qsort_methods[qsort_method].counted) {
+		rate = (duration > 0.0) ? count / duration : 0.0;
+		stress_metrics_set(args, 0, "qsort comparisons per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "qsort comparisons per item",
+			count / sorted, STRESS_HARMONIC_MEAN);
+	}
+	rate = (duration > 0.0) ? sorted / duration : 0.0;
+	stress_metrics_set(args, 2, "elements sorted per sec",
 		rate, STRESS_HARMONIC_MEAN);
-	stress_metrics_set(args, 1, "qsort comparisons per item",
-		count / sorted, STRESS_HARMONIC_MEAN);
+	/* compare the random data sorts with the libc qsort baseline */
+	if ((libc_rate > 0.0) && (dist_stats[STRESS_SORT_DIST_RANDOM].duration > 0.0))
+		stress_metrics_set(args, 3, "speedup over libc qsort",
+			(dist_stats[STRESS_SORT_DIST_RANDOM].sorted /
+			 dist_stats[STRESS_SORT_DIST_RANDOM].duration) / libc_rate,
+			STRESS_GEOMETRIC_MEAN);
+	stress_sort_dist_metrics(args, 4, "qsort", dist_stats,
+		stress_qsort_methods[qsort_method].counted);
 
 	(void)munmap((void *)data, data_size);
 
@@ -431,6 +493,7 @@ tidy:
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_qsort_integers,	stress_set_qsort_size },
 	{ OPT_qsort_method,	stress_set_qsort_method },
+	{ OPT_qsort_threads,	stress_set_qsort_threads },
 	{ 0,			NULL }
 };
 
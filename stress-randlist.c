@@ -29,10 +29,39 @@
 #define STRESS_RANDLIST_ALLOC_HEAP	(0)
 #define STRESS_RANDLIST_ALLOC_MMAP	(1)
 
+#define STRESS_RANDLIST_ORDER_RANDOM	(0)	/* any line to any line */
+#define STRESS_RANDLIST_ORDER_PAGE	(1)	/* all lines of a page before the next page */
+
+#define STRESS_RANDLIST_LAT_MIN		(4 * KB)	/* smallest latency working set */
+#define STRESS_RANDLIST_LAT_MAX		(256 * MB)	/* minimum largest working set */
+#define STRESS_RANDLIST_LAT_SIZES	(64)
+#define STRESS_RANDLIST_LAT_LOADS	(65536)		/* loads per timed chase */
+#define STRESS_RANDLIST_HUGE_SIZE	(2 * MB)
+
+typedef struct {
+	const char *name;
+	const int order;
+} stress_randlist_order_t;
+
+static const stress_randlist_order_t randlist_orders[] = {
+	{ "random",	STRESS_RANDLIST_ORDER_RANDOM },
+	{ "page",	STRESS_RANDLIST_ORDER_PAGE },
+};
+
+/* Latency of a working set size */
+typedef struct {
+	size_t size;		/* working set size in bytes */
+	double duration;	/* time chasing */
+	double loads;		/* number of dependent loads */
+} stress_randlist_lat_t;
+
 static const stress_help_t help[] = {
 	{ NULL,	"randlist N",		"start N workers that exercise random ordered list" },
 	{ NULL, "randlist-compact",	"reduce mmap and malloc overheads" },
 	{ NULL, "randlist-items N",	"number of items in the random ordered list" },
+	{ NULL, "randlist-latency",	"sweep working set sizes and report ns per dependent load" },
+	{ NULL, "randlist-latency-huge", "back the latency mode list with 2MB huge pages" },
+	{ NULL, "randlist-latency-order O", "latency mode link order, random or page" },
 	{ NULL,	"randlist-ops N",	"stop after N randlist bogo no-op operations" },
 	{ NULL, "randlist-size N",	"size of data in each item in the list" },
 	{ NULL,	NULL,			NULL }
@@ -69,6 +98,44 @@ static int stress_set_randlist_items(const char *opt)
 	return stress_set_setting("randlist-items", TYPE_ID_SIZE_T, &randlist_items);
 }
 
+/*
+ *  stress_set_randlist_latency()
+ *      set randlist latency mode setting
+ */
+static int stress_set_randlist_latency(const char *opt)
+{
+	return stress_set_setting_true("randlist-latency", opt);
+}
+
+/*
+ *  stress_set_randlist_latency_huge()
+ *      set randlist latency mode huge page setting
+ */
+static int stress_set_randlist_latency_huge(const char *opt)
+{
+	return stress_set_setting_true("randlist-latency-huge", opt);
+}
+
+/*
+ *  stress_set_randlist_latency_order()
+ *      set randlist latency mode list order
+ */
+static int stress_set_randlist_latency_order(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(randlist_orders); i++) {
+		if (!strcmp(opt, randlist_orders[i].name))
+			return stress_set_setting("randlist-latency-order", TYPE_ID_INT, &randlist_orders[i].order);
+	}
+	(void)fprintf(stderr, "randlist-latency-order must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(randlist_orders); i++)
+		(void)fprintf(stderr, " %s", randlist_orders[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 /*
  *  stress_set_randlist_size()
  *      set randlist size from given option string
@@ -168,6 +235,240 @@ static inline void OPTIMIZE3 stress_randlist_exercise(
 	}
 }
 
+/*
+ *  stress_randlist_shuffle()
+ *	Sattolo's algorithm, shuffle idx into a random
+ *	permutation that forms a single cycle
+ */
+static void stress_randlist_shuffle(size_t *idx, const size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		idx[i] = i;
+	for (i = n - 1; (n > 1) && (i > 0); i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i);
+		const size_t tmp = idx[i];
+
+		idx[i] = idx[j];
+		idx[j] = tmp;
+	}
+}
+
+/*
+ *  stress_randlist_latency_link()
+ *	link the lines of the first size bytes of buf into a cycle,
+ *	random order links any line to any line, page order visits
+ *	the lines of each page in random order and then moves to a
+ *	random next page so TLB misses are amortized over the page.
+ *	Returns the head of the cycle.
+ */
+static void **stress_randlist_latency_link(
+	uint8_t *buf,
+	const size_t size,
+	const size_t line_size,
+	const size_t page_size,
+	const int order,
+	size_t *lines_perm,
+	size_t *pages_perm)
+{
+	const size_t lines = size / line_size;
+	const size_t lines_per_page = (order == STRESS_RANDLIST_ORDER_PAGE) ?
+		STRESS_MINIMUM(page_size / line_size, lines) : lines;
+	const size_t pages = lines / lines_per_page;
+	size_t i, j, prev = 0, head = 0;
+	bool first = true;
+
+	stress_randlist_shuffle(pages_perm, pages);
+	for (i = 0; i < pages; i++) {
+		const size_t page = pages_perm[i];
+
+		stress_randlist_shuffle(lines_perm, lines_per_page);
+		for (j = 0; j < lines_per_page; j++) {
+			const size_t line = (page * lines_per_page) + lines_perm[j];
+
+			if (first)
+				head = line;
+			else
+				*(void **)(buf + (prev * line_size)) = (void *)(buf + (line * line_size));
+			first = false;
+			prev = line;
+		}
+	}
+	/* close the cycle */
+	*(void **)(buf + (prev * line_size)) = (void *)(buf + (head * line_size));
+
+	return (void **)(buf + (head * line_size));
+}
+
+/*
+ *  stress_randlist_latency_chase()
+ *	single dependent pointer chase, each load depends on the
+ *	result of the previous load
+ */
+static void ** OPTIMIZE3 stress_randlist_latency_chase(void **ptr, const size_t loads)
+{
+	register void **p = ptr;
+	register size_t i;
+
+	for (i = 0; i < loads; i += 16) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	return p;
+}
+
+/*
+ *  stress_randlist_latency()
+ *	lat_mem_rd style latency profile, sweep the working set in
+ *	steps of 2^n and 1.5 x 2^n from 4K to the larger of 256MB
+ *	and 8 x LLC size and report ns per dependent load for each
+ *	size, the steps in the curve show the L1, L2, L3, DRAM and
+ *	TLB reach
+ */
+static int stress_randlist_latency(stress_args_t *args)
+{
+	stress_randlist_lat_t lat[STRESS_RANDLIST_LAT_SIZES];
+	const char *order_name = "random";
+	int order = STRESS_RANDLIST_ORDER_RANDOM;
+	bool huge = false, huge_backed = false;
+	size_t llc_size, line_size, max_size, mmap_size, n_sizes = 0, size, i, metric = 0;
+	size_t *lines_perm, *pages_perm;
+	uint8_t *buf;
+	double slice;
+	void *mapping;
+
+	(void)stress_get_setting("randlist-latency-huge", &huge);
+	(void)stress_get_setting("randlist-latency-order", &order);
+	for (i = 0; i < SIZEOF_ARRAY(randlist_orders); i++) {
+		if (randlist_orders[i].order == order)
+			order_name = randlist_orders[i].name;
+	}
+
+	stress_cpu_cache_get_llc_size(&llc_size, &line_size);
+	if ((line_size < sizeof(void *)) || (line_size > args->page_size))
+		line_size = 64;
+	max_size = STRESS_MAXIMUM(STRESS_RANDLIST_LAT_MAX, llc_size * 8);
+
+	(void)shim_memset(lat, 0, sizeof(lat));
+	for (size = STRESS_RANDLIST_LAT_MIN; (size <= max_size) && (n_sizes < STRESS_RANDLIST_LAT_SIZES - 1); size *= 2) {
+		lat[n_sizes++].size = size;
+		if ((size + (size / 2) <= max_size) && (size >= 8 * KB))
+			lat[n_sizes++].size = size + (size / 2);
+	}
+	max_size = lat[n_sizes - 1].size;
+
+	/* over allocate so the list can be aligned to a huge page */
+	mmap_size = max_size + STRESS_RANDLIST_HUGE_SIZE;
+	mapping = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) {
+		stress_randlist_enomem(args);
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)(((uintptr_t)mapping + STRESS_RANDLIST_HUGE_SIZE - 1) &
+		~(uintptr_t)(STRESS_RANDLIST_HUGE_SIZE - 1));
+	if (huge) {
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_HUGEPAGE)
+		huge_backed = (madvise((void *)buf, max_size, MADV_HUGEPAGE) == 0);
+#endif
+		if (!huge_backed && (args->instance == 0))
+			pr_inf("%s: cannot madvise huge pages, using default page size\n", args->name);
+	} else {
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_NOHUGEPAGE)
+		/* keep small pages so the TLB reach is visible in the curve */
+		(void)madvise((void *)buf, max_size, MADV_NOHUGEPAGE);
+#endif
+	}
+	(void)shim_memset(buf, 0, max_size);
+
+	lines_perm = (size_t *)calloc(max_size / line_size, sizeof(*lines_perm));
+	pages_perm = (size_t *)calloc(max_size / line_size, sizeof(*pages_perm));
+	if (!lines_perm || !pages_perm) {
+		free(pages_perm);
+		free(lines_perm);
+		(void)munmap(mapping, mmap_size);
+		stress_randlist_enomem(args);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: latency sweep of %zu sizes from %zuK to %zuK, %s order, %zu byte lines%s\n",
+			args->name, n_sizes, (size_t)(lat[0].size / KB), (size_t)(max_size / KB),
+			order_name, line_size, huge_backed ? ", huge pages" : "");
+
+	/* spread the run over all sizes, repeating the sweep if time remains */
+	slice = (double)g_opt_timeout / (double)n_sizes;
+	slice = STRESS_MINIMUM(1.0, STRESS_MAXIMUM(0.05, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_sizes) && stress_continue(args); i++) {
+			const size_t page_size = huge_backed ? STRESS_RANDLIST_HUGE_SIZE : args->page_size;
+			void **ptr;
+			double t_start, t;
+
+			ptr = stress_randlist_latency_link(buf, lat[i].size, line_size,
+				page_size, order, lines_perm, pages_perm);
+			/* warm up, bring the working set into the caches and TLBs */
+			ptr = stress_randlist_latency_chase(ptr, lat[i].size / line_size);
+
+			t_start = stress_time_now();
+			do {
+				t = stress_time_now();
+				ptr = stress_randlist_latency_chase(ptr, STRESS_RANDLIST_LAT_LOADS);
+				lat[i].duration += stress_time_now() - t;
+				lat[i].loads += (double)STRESS_RANDLIST_LAT_LOADS;
+			} while ((t - t_start < slice) && stress_continue_flag());
+			stress_void_ptr_put((void *)ptr);
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %12s %14s (%s order%s)\n", args->name, "size (KB)", "ns per access",
+			order_name, huge_backed ? ", huge pages" : "");
+	for (i = 0; i < n_sizes; i++) {
+		double ns;
+
+		if (lat[i].loads <= 0.0)
+			continue;
+		ns = STRESS_DBL_NANOSECOND * lat[i].duration / lat[i].loads;
+		if (args->instance == 0)
+			pr_inf("%s: %12zu %14.2f\n", args->name, (size_t)(lat[i].size / KB), ns);
+		/* powers of 2 only in the metrics, there are too few slots for all sizes */
+		if ((lat[i].size & (lat[i].size - 1)) == 0) {
+			char msg[64];
+
+			(void)snprintf(msg, sizeof(msg), "ns per access at %zuK", (size_t)(lat[i].size / KB));
+			stress_metrics_set(args, metric++, msg, ns, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+	free(pages_perm);
+	free(lines_perm);
+	(void)munmap(mapping, mmap_size);
+
+	return EXIT_SUCCESS;
+}
+
 /*
  *  stress_randlist()
  *	stress a list containing random values
@@ -185,6 +486,11 @@ static int stress_randlist(stress_args_t *args)
 	size_t randlist_size = STRESS_RANDLIST_DEFAULT_SIZE;
 	size_t heap_allocs = 0;
 	size_t mmap_allocs = 0;
+	bool randlist_latency = false;
+
+	(void)stress_get_setting("randlist-latency", &randlist_latency);
+	if (randlist_latency)
+		return stress_randlist_latency(args);
 
 	(void)stress_get_setting("randlist-compact", &randlist_compact);
 	(void)stress_get_setting("randlist-items", &randlist_items);
@@ -311,6 +617,9 @@ retry:
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_randlist_compact,	stress_set_randlist_compact },
 	{ OPT_randlist_items,	stress_set_randlist_items },
+	{ OPT_randlist_latency,	stress_set_randlist_latency },
+	{ OPT_randlist_latency_huge, stress_set_randlist_latency_huge },
+	{ OPT_randlist_latency_order, stress_set_randlist_latency_order },
 	{ OPT_randlist_size,	stress_set_randlist_size },
 	{ 0,                    NULL }
 };
@@ -18,7 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-vmstat.h"
+#include "io-uring.h"
 
 #if defined(HAVE_SYS_SYSMACROS_H)
 #include <sys/sysmacros.h>
@@ -28,8 +30,13 @@
 #include <sys/mount.h>
 #endif
 
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"rawdev N",	   "start N workers that read a raw device" },
+	{ NULL,	"rawdev-iosweep",  "sweep O_DIRECT random reads over block sizes and queue depths" },
 	{ NULL,	"rawdev-method M", "specify the rawdev read method to use" },
 	{ NULL,	"rawdev-ops N",	   "stop after N rawdev read operations" },
 	{ NULL,	NULL,		   NULL }
@@ -39,6 +46,10 @@ static const stress_help_t help[] = {
 #define	MIN_BLKSZ	((int)512)
 #define	MAX_BLKSZ	((int)(128 * KB))
 
+#define RAWDEV_IOSWEEP_SLICE	(0.2)		/* seconds per sweep point */
+#define RAWDEV_IOSWEEP_QD_MAX	(128)		/* deepest queue depth */
+#define RAWDEV_IOSWEEP_BUF_SIZE	(16 * MB)	/* read buffers, shared by slots */
+
 #if defined(HAVE_SYS_SYSMACROS_H) &&	\
     defined(BLKGETSIZE) && 		\
     defined(BLKSSZGET)
@@ -300,6 +311,450 @@ static int stress_rawdev_burst(
 	return 0;
 }
 
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_uring_setup) &&	\
+    defined(__NR_io_uring_enter) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES) &&		\
+    defined(HAVE_IORING_OP_READ)
+#define HAVE_RAWDEV_IO_URING
+#endif
+
+static const size_t rawdev_iosweep_bs[] = {
+	4 * KB, 16 * KB, 64 * KB, 256 * KB, 1 * MB
+};
+
+static const uint32_t rawdev_iosweep_qd[] = {
+	1, 2, 4, 8, 16, 32, 64, RAWDEV_IOSWEEP_QD_MAX
+};
+
+/*
+ *  per block size and queue depth sweep point totals
+ */
+typedef struct {
+	double ios;			/* completed reads */
+	double bytes;			/* bytes read */
+	double duration;		/* time spent at this point */
+} stress_rawdev_point_t;
+
+/*
+ *  state shared by all the sweep points
+ */
+typedef struct {
+	stress_args_t *args;
+	int fd;				/* O_DIRECT raw device */
+	uint64_t dev_size;		/* device size in bytes */
+	uint8_t *bufs;			/* read buffers */
+	bool use_ring;			/* io_uring is usable */
+#if defined(HAVE_RAWDEV_IO_URING)
+	int ring_fd;			/* io_uring ring */
+	void *sq_mmap;			/* submission queue ring mapping */
+	void *cq_mmap;			/* completion queue ring mapping */
+	size_t sq_size;			/* size of sq_mmap */
+	size_t cq_size;			/* size of cq_mmap */
+	struct io_uring_sqe *sqes;	/* submission queue entries */
+	size_t sqes_size;		/* size of sqes mapping */
+	unsigned *sq_tail;		/* submission ring pointers */
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;		/* completion ring pointers */
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+#endif
+} stress_rawdev_iosweep_t;
+
+/*
+ *  stress_rawdev_iosweep_offset()
+ *	random bs aligned offset on the device
+ */
+static inline off_t stress_rawdev_iosweep_offset(
+	const stress_rawdev_iosweep_t *sw,
+	const size_t bs)
+{
+	return (off_t)(stress_mwc64modn(sw->dev_size / bs) * bs);
+}
+
+/*
+ *  stress_rawdev_iosweep_buf()
+ *	read buffer for an I/O slot, deep queues of large
+ *	reads share buffers as the data is never looked at
+ */
+static inline uint8_t *stress_rawdev_iosweep_buf(
+	const stress_rawdev_iosweep_t *sw,
+	const size_t bs,
+	const uint32_t slot)
+{
+	const size_t nbufs = RAWDEV_IOSWEEP_BUF_SIZE / bs;
+
+	return sw->bufs + ((slot % nbufs) * bs);
+}
+
+#if defined(HAVE_RAWDEV_IO_URING)
+/*
+ *  stress_rawdev_ring_init()
+ *	create an io_uring ring deep enough for the deepest sweep point
+ */
+static int stress_rawdev_ring_init(stress_rawdev_iosweep_t *sw)
+{
+	struct io_uring_params p;
+	void *ptr;
+
+	sw->ring_fd = -1;
+	sw->sq_mmap = MAP_FAILED;
+	sw->cq_mmap = MAP_FAILED;
+	sw->sqes = MAP_FAILED;
+
+	(void)shim_memset(&p, 0, sizeof(p));
+	sw->ring_fd = (int)syscall(__NR_io_uring_setup, RAWDEV_IOSWEEP_QD_MAX, &p);
+	if (sw->ring_fd < 0)
+		return -1;
+
+	sw->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	sw->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (sw->cq_size > sw->sq_size)
+			sw->sq_size = sw->cq_size;
+		sw->cq_size = sw->sq_size;
+	}
+	sw->sq_mmap = mmap(NULL, sw->sq_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, sw->ring_fd, IORING_OFF_SQ_RING);
+	if (sw->sq_mmap == MAP_FAILED)
+		return -1;
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		sw->cq_mmap = sw->sq_mmap;
+	} else {
+		sw->cq_mmap = mmap(NULL, sw->cq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, sw->ring_fd, IORING_OFF_CQ_RING);
+		if (sw->cq_mmap == MAP_FAILED)
+			return -1;
+	}
+	sw->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	ptr = mmap(NULL, sw->sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, sw->ring_fd, IORING_OFF_SQES);
+	if (ptr == MAP_FAILED)
+		return -1;
+	sw->sqes = (struct io_uring_sqe *)ptr;
+
+	sw->sq_tail = (unsigned *)((uint8_t *)sw->sq_mmap + p.sq_off.tail);
+	sw->sq_mask = (unsigned *)((uint8_t *)sw->sq_mmap + p.sq_off.ring_mask);
+	sw->sq_array = (unsigned *)((uint8_t *)sw->sq_mmap + p.sq_off.array);
+	sw->cq_head = (unsigned *)((uint8_t *)sw->cq_mmap + p.cq_off.head);
+	sw->cq_tail = (unsigned *)((uint8_t *)sw->cq_mmap + p.cq_off.tail);
+	sw->cq_mask = (unsigned *)((uint8_t *)sw->cq_mmap + p.cq_off.ring_mask);
+	sw->cqes = (struct io_uring_cqe *)((uint8_t *)sw->cq_mmap + p.cq_off.cqes);
+	return 0;
+}
+
+static void stress_rawdev_ring_deinit(stress_rawdev_iosweep_t *sw)
+{
+	if (sw->sqes != MAP_FAILED)
+		(void)munmap((void *)sw->sqes, sw->sqes_size);
+	if ((sw->cq_mmap != MAP_FAILED) && (sw->cq_mmap != sw->sq_mmap))
+		(void)munmap(sw->cq_mmap, sw->cq_size);
+	if (sw->sq_mmap != MAP_FAILED)
+		(void)munmap(sw->sq_mmap, sw->sq_size);
+	if (sw->ring_fd >= 0)
+		(void)close(sw->ring_fd);
+}
+
+/*
+ *  stress_rawdev_ring_submit()
+ *	queue n random reads of bs bytes and submit them with
+ *	one io_uring_enter call, optionally waiting for at least
+ *	one completion in the same call
+ */
+static int stress_rawdev_ring_submit(
+	stress_rawdev_iosweep_t *sw,
+	const size_t bs,
+	const uint32_t n,
+	uint32_t *slot,
+	const bool wait)
+{
+	unsigned tail = *sw->sq_tail;
+	const unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	uint32_t i, submitted = 0;
+
+	for (i = 0; i < n; i++) {
+		const unsigned index = tail & *sw->sq_mask;
+		struct io_uring_sqe *sqe = &sw->sqes[index];
+
+		(void)shim_memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = sw->fd;
+		sqe->addr = (uint64_t)(uintptr_t)stress_rawdev_iosweep_buf(sw, bs, *slot);
+		sqe->len = (uint32_t)bs;
+		sqe->off = (uint64_t)stress_rawdev_iosweep_offset(sw, bs);
+		sw->sq_array[index] = index;
+		(*slot)++;
+		tail++;
+	}
+	stress_asm_mb();
+	*sw->sq_tail = tail;
+	stress_asm_mb();
+
+	do {
+		const int ret = (int)syscall(__NR_io_uring_enter, sw->ring_fd,
+					     n - submitted, wait ? 1 : 0, flags, NULL, 0);
+		if (ret < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR) || (errno == EBUSY))
+				continue;
+			return -1;
+		}
+		submitted += (uint32_t)ret;
+	} while (submitted < n);
+	return 0;
+}
+
+/*
+ *  stress_rawdev_ring_reap()
+ *	gather completions into the sweep point, returns the number
+ *	of completions, the first failed read errno is kept in *err
+ */
+static int stress_rawdev_ring_reap(
+	stress_rawdev_iosweep_t *sw,
+	stress_rawdev_point_t *point,
+	const bool wait,
+	int *err)
+{
+	unsigned head;
+	int n = 0;
+
+	stress_asm_mb();
+	if (wait && (*sw->cq_head == *sw->cq_tail)) {
+		if ((syscall(__NR_io_uring_enter, sw->ring_fd, 0, 1,
+			     IORING_ENTER_GETEVENTS, NULL, 0) < 0) && (errno != EINTR))
+			return -1;
+	}
+	head = *sw->cq_head;
+	for (;;) {
+		const struct io_uring_cqe *cqe;
+
+		stress_asm_mb();
+		if (head == *sw->cq_tail)
+			break;
+		cqe = &sw->cqes[head & *sw->cq_mask];
+		if (cqe->res < 0) {
+			if (*err == 0)
+				*err = -cqe->res;
+		} else {
+			point->ios += 1.0;
+			point->bytes += (double)cqe->res;
+		}
+		head++;
+		n++;
+	}
+	*sw->cq_head = head;
+	stress_asm_mb();
+	return n;
+}
+#endif
+
+/*
+ *  stress_rawdev_iosweep_point()
+ *	keep qd random reads of bs bytes in flight for a time slice,
+ *	without io_uring only queue depth 1 using pread is possible
+ */
+static int stress_rawdev_iosweep_point(
+	stress_rawdev_iosweep_t *sw,
+	const size_t bs,
+	const uint32_t qd,
+	stress_rawdev_point_t *point)
+{
+	stress_args_t *args = sw->args;
+	const double t_start = stress_time_now();
+	const double t_end = t_start + RAWDEV_IOSWEEP_SLICE;
+	uint32_t slot = 0;
+
+#if defined(HAVE_RAWDEV_IO_URING)
+	if (sw->use_ring) {
+		const double ios = point->ios;
+		uint32_t inflight = 0;
+		int err = 0;
+
+		while ((err == 0) && stress_continue(args) && (stress_time_now() < t_end)) {
+			int n;
+
+			if (UNLIKELY(stress_rawdev_ring_submit(sw, bs, qd - inflight, &slot, true) < 0)) {
+				err = errno;
+				break;
+			}
+			inflight = qd;
+			n = stress_rawdev_ring_reap(sw, point, false, &err);
+			if (UNLIKELY(n < 0)) {
+				err = errno;
+				break;
+			}
+			inflight -= (uint32_t)n;
+		}
+		/* drain, every read has to complete before the next point */
+		while (inflight > 0) {
+			const int n = stress_rawdev_ring_reap(sw, point, true, &err);
+
+			if (UNLIKELY(n < 0)) {
+				if (err == 0)
+					err = errno;
+				break;
+			}
+			inflight -= (uint32_t)n;
+		}
+		point->duration += stress_time_now() - t_start;
+		stress_bogo_add(args, (uint64_t)(point->ios - ios));
+		if (err) {
+			pr_fail("%s: io_uring read of %zu bytes failed, errno=%d (%s)\n",
+				args->name, bs, err, strerror(err));
+			return -1;
+		}
+		return 0;
+	}
+#endif
+	if (qd > 1)
+		return 0;
+
+	while (stress_continue(args) && (stress_time_now() < t_end)) {
+		const off_t offset = stress_rawdev_iosweep_offset(sw, bs);
+		const ssize_t ret = pread(sw->fd, stress_rawdev_iosweep_buf(sw, bs, slot), bs, offset);
+
+		if (UNLIKELY(ret < 0)) {
+			if (errno != EINTR) {
+				pr_fail("%s: pread of %zu bytes at %ju failed, errno=%d (%s)\n",
+					args->name, bs, (intmax_t)offset, errno, strerror(errno));
+				return -1;
+			}
+			continue;
+		}
+		point->ios += 1.0;
+		point->bytes += (double)ret;
+		stress_bogo_inc(args);
+	}
+	point->duration += stress_time_now() - t_start;
+	return 0;
+}
+
+/*
+ *  stress_rawdev_iosweep()
+ *	read only O_DIRECT device characterisation, random reads over
+ *	block sizes of 4K..1M at queue depths of 1..128
+ */
+static int stress_rawdev_iosweep(
+	stress_args_t *args,
+	const int fd,
+	const size_t blks,
+	const char *devpath)
+{
+	static stress_rawdev_point_t points[SIZEOF_ARRAY(rawdev_iosweep_bs)][SIZEOF_ARRAY(rawdev_iosweep_qd)];
+	stress_rawdev_iosweep_t sw;
+	size_t i, j, idx;
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&sw, 0, sizeof(sw));
+	(void)shim_memset(points, 0, sizeof(points));
+	sw.args = args;
+	sw.fd = fd;
+	sw.dev_size = (uint64_t)blks << 9;	/* BLKGETSIZE is in 512 byte sectors */
+
+	sw.bufs = stress_mmap_populate(NULL, RAWDEV_IOSWEEP_BUF_SIZE,
+			PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (sw.bufs == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate %zu MB of read buffers, skipping stressor\n",
+			args->name, (size_t)(RAWDEV_IOSWEEP_BUF_SIZE / MB));
+		return EXIT_NO_RESOURCE;
+	}
+#if defined(HAVE_RAWDEV_IO_URING)
+	sw.use_ring = (stress_rawdev_ring_init(&sw) == 0);
+	if (!sw.use_ring)
+		stress_rawdev_ring_deinit(&sw);
+#endif
+	if ((args->instance == 0) && !sw.use_ring)
+		pr_inf("%s: io_uring not available, only sweeping queue depth 1 with pread\n",
+			args->name);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < SIZEOF_ARRAY(rawdev_iosweep_bs); i++) {
+			const size_t bs = rawdev_iosweep_bs[i];
+
+			if (bs > sw.dev_size)
+				continue;
+			for (j = 0; (j < SIZEOF_ARRAY(rawdev_iosweep_qd)) && stress_continue(args); j++) {
+				if (stress_rawdev_iosweep_point(&sw, bs, rawdev_iosweep_qd[j], &points[i][j]) < 0) {
+					rc = EXIT_FAILURE;
+					goto done;
+				}
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		char buf[256];
+		int len;
+
+		pr_inf("%s: %s random O_DIRECT reads, %s\n", args->name, devpath,
+			sw.use_ring ? "io_uring" : "pread");
+		len = snprintf(buf, sizeof(buf), "%-10s", "QD");
+		for (j = 0; j < SIZEOF_ARRAY(rawdev_iosweep_qd); j++)
+			len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9" PRIu32, rawdev_iosweep_qd[j]);
+		pr_inf("%s: %s\n", args->name, buf);
+
+		for (i = 0; i < SIZEOF_ARRAY(rawdev_iosweep_bs); i++) {
+			const size_t kb = rawdev_iosweep_bs[i] / KB;
+
+			len = snprintf(buf, sizeof(buf), "%5zuK IOPS", kb);
+			for (j = 0; j < SIZEOF_ARRAY(rawdev_iosweep_qd); j++) {
+				const stress_rawdev_point_t *pt = &points[i][j];
+
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9.0f",
+					pt->duration > 0.0 ? pt->ios / pt->duration : 0.0);
+			}
+			pr_inf("%s: %s\n", args->name, buf);
+
+			len = snprintf(buf, sizeof(buf), "%5zuK MB/s", kb);
+			for (j = 0; j < SIZEOF_ARRAY(rawdev_iosweep_qd); j++) {
+				const stress_rawdev_point_t *pt = &points[i][j];
+
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9.2f",
+					pt->duration > 0.0 ? pt->bytes / (pt->duration * (double)MB) : 0.0);
+			}
+			pr_inf("%s: %s\n", args->name, buf);
+		}
+	}
+
+	/* queue depth 1 and deepest queue depth for each block size */
+	for (idx = 0, i = 0; i < SIZEOF_ARRAY(rawdev_iosweep_bs); i++) {
+		const size_t kb = rawdev_iosweep_bs[i] / KB;
+
+		for (j = 0; j < SIZEOF_ARRAY(rawdev_iosweep_qd); j += SIZEOF_ARRAY(rawdev_iosweep_qd) - 1) {
+			const stress_rawdev_point_t *pt = &points[i][j];
+			char str[64];
+
+			if (pt->duration <= 0.0)
+				continue;
+			(void)snprintf(str, sizeof(str), "%zuK QD %" PRIu32 " reads per sec",
+				kb, rawdev_iosweep_qd[j]);
+			stress_metrics_set(args, idx++, str,
+				pt->ios / pt->duration, STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%zuK QD %" PRIu32 " MB per sec",
+				kb, rawdev_iosweep_qd[j]);
+			stress_metrics_set(args, idx++, str,
+				pt->bytes / (pt->duration * (double)MB), STRESS_HARMONIC_MEAN);
+		}
+	}
+
+#if defined(HAVE_RAWDEV_IO_URING)
+	if (sw.use_ring)
+		stress_rawdev_ring_deinit(&sw);
+#endif
+	(void)munmap((void *)sw.bufs, RAWDEV_IOSWEEP_BUF_SIZE);
+
+	return rc;
+}
+
 static int stress_rawdev_all(
 	stress_args_t *args,
 	const int fd,
@@ -384,7 +839,17 @@ static int stress_set_rawdev_method(const char *name)
 }
 #endif
 
+/*
+ *  stress_set_rawdev_iosweep()
+ *	enable the block size and queue depth read sweep
+ */
+static int stress_set_rawdev_iosweep(const char *opt)
+{
+	return stress_set_setting_true("rawdev-iosweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_rawdev_iosweep,	stress_set_rawdev_iosweep },
 	{ OPT_rawdev_method,	stress_set_rawdev_method },
 	{ 0,			NULL }
 };
@@ -401,6 +866,7 @@ static int stress_rawdev(stress_args_t *args)
 	size_t blks, blksz = 0, mmapsz;
 	size_t i, j, rawdev_method = 0;
 	const size_t page_size = args->page_size;
+	bool rawdev_iosweep = false;
 	stress_rawdev_func func;
 	stress_metrics_t *metrics;
 
@@ -430,6 +896,7 @@ static int stress_rawdev(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
+	(void)stress_get_setting("rawdev-iosweep", &rawdev_iosweep);
 	(void)stress_get_setting("rawdev-method", &rawdev_method);
 	func = rawdev_methods[rawdev_method].func;
 
@@ -488,6 +955,14 @@ static int stress_rawdev(stress_args_t *args)
 		pr_dbg("%s: exercising %s (%zd blocks of size %zd bytes)\n",
 			args->name, devpath, blks, blksz);
 
+	if (rawdev_iosweep) {
+		ret = stress_rawdev_iosweep(args, fd, blks, devpath);
+		(void)munmap((void *)buffer, mmapsz);
+		(void)close(fd);
+		free(metrics);
+		return ret;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
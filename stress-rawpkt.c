@@ -21,6 +21,7 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-cycles.h"
 #include "core-killpid.h"
 #include "core-net.h"
 
@@ -32,6 +33,10 @@
 #include <linux/if_tun.h>
 #endif
 
+#if defined(HAVE_LINUX_IF_XDP_H)
+#include <linux/if_xdp.h>
+#endif
+
 #if defined(HAVE_LINUX_SOCKIOS_H)
 #include <linux/sockios.h>
 #endif
@@ -61,11 +66,52 @@
 #endif
 #define PACKET_SIZE	(2048)
 
+#if !defined(AF_XDP)
+#define AF_XDP		(44)
+#endif
+#if !defined(SOL_XDP)
+#define SOL_XDP		(283)
+#endif
+
+#define RAWPKT_XDP_OFF		(0)
+#define RAWPKT_XDP_COPY		(1)
+#define RAWPKT_XDP_ZEROCOPY	(2)
+
+#define RAWPKT_BATCH		(64)	/* packets queued per TX ring kick */
+#define RAWPKT_XDP_FRAMES	(2048)	/* UMEM frames, also the ring sizes */
+
+#if defined(HAVE_LINUX_IF_XDP_H) &&		\
+    defined(XDP_USE_NEED_WAKEUP) &&		\
+    defined(XDP_RING_NEED_WAKEUP) &&		\
+    defined(XDP_UMEM_PGOFF_FILL_RING) &&	\
+    defined(XDP_UMEM_PGOFF_COMPLETION_RING)
+#define HAVE_RAWPKT_XDP
+#endif
+
+#if defined(PACKET_TX_RING) &&	\
+    defined(PACKET_VERSION) &&	\
+    defined(HAVE_TPACKET_REQ3)
+#define HAVE_RAWPKT_TX_RING
+#endif
+
+typedef struct {
+	const char *name;
+	const int mode;
+} stress_rawpkt_xdp_mode_t;
+
+static const stress_rawpkt_xdp_mode_t rawpkt_xdp_modes[] = {
+	{ "copy",	RAWPKT_XDP_COPY },
+	{ "zerocopy",	RAWPKT_XDP_ZEROCOPY },
+};
+
 static const stress_help_t help[] = {
 	{ NULL, "rawpkt N",		"start N workers exercising raw packets" },
+	{ NULL,	"rawpkt-if I",		"use network interface I, default is lo" },
 	{ NULL,	"rawpkt-ops N",		"stop after N raw packet bogo operations" },
 	{ NULL,	"rawpkt-port P",	"use raw packet ports P to P + number of workers - 1" },
 	{ NULL, "rawpkt-rxring N",	"setup raw packets with RX ring with N number of blocks, this selects TPACKET_V3"},
+	{ NULL, "rawpkt-txring N",	"send raw packets with a TPACKET_V3 TX ring of N number of blocks"},
+	{ NULL, "rawpkt-xdp M",		"send raw packets with an AF_XDP socket, M is copy or zerocopy"},
 	{ NULL,	NULL,			NULL }
 };
 
@@ -112,9 +158,55 @@ static int stress_set_rxring(const char *opt)
 	return stress_set_setting("rawpkt-rxring", TYPE_ID_INT, &ival);
 }
 
+/*
+ *  stress_set_rawpkt_txring()
+ *  set TX ring to use
+ */
+static int stress_set_txring(const char *opt)
+{
+	const uint64_t val = stress_get_uint64(opt);
+	int ival;
+
+	stress_check_power_of_2("rawpkt-txring", val, (uint64_t)1, (uint64_t)16);
+	ival = (int)val;
+	return stress_set_setting("rawpkt-txring", TYPE_ID_INT, &ival);
+}
+
+/*
+ *  stress_set_rawpkt_if()
+ *  set network interface to use
+ */
+static int stress_set_if(const char *opt)
+{
+	return stress_set_setting("rawpkt-if", TYPE_ID_STR, opt);
+}
+
+/*
+ *  stress_set_rawpkt_xdp()
+ *  set AF_XDP bind mode
+ */
+static int stress_set_xdp(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(rawpkt_xdp_modes); i++) {
+		if (!strcmp(opt, rawpkt_xdp_modes[i].name))
+			return stress_set_setting("rawpkt-xdp", TYPE_ID_INT, &rawpkt_xdp_modes[i].mode);
+	}
+	(void)fprintf(stderr, "rawpkt-xdp must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(rawpkt_xdp_modes); i++)
+		(void)fprintf(stderr, " %s", rawpkt_xdp_modes[i].name);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_rawpkt_if,	stress_set_if },
 	{ OPT_rawpkt_port,	stress_set_port },
 	{ OPT_rawpkt_rxring,	stress_set_rxring },
+	{ OPT_rawpkt_txring,	stress_set_txring },
+	{ OPT_rawpkt_xdp,	stress_set_xdp },
 	{ 0,			NULL }
 };
 
@@ -271,6 +363,340 @@ static void stress_rawpkt_sockopts(const int fd)
 	}
 }
 
+/*
+ *  client side send rate and CPU cost tracking
+ */
+typedef struct {
+	double t_start;			/* wall clock start */
+	double t_report;		/* time of next metrics update */
+	uint64_t cycles_start;		/* cycle counter start */
+	uint64_t cpu_start;		/* CPU ns start */
+	uint64_t pkts;			/* packets sent */
+} stress_rawpkt_tx_t;
+
+/*
+ *  stress_rawpkt_cpu_ns()
+ *	user and system CPU time consumed so far, ns
+ */
+static uint64_t stress_rawpkt_cpu_ns(void)
+{
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) == 0) {
+		return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * STRESS_NANOSECOND +
+		       ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+	}
+#endif
+	return 0;
+}
+
+/*
+ *  stress_rawpkt_tx_metrics()
+ *	report the send rate and CPU cost per packet about once a
+ *	second, the client is killed by the server so it cannot
+ *	just report at the end
+ */
+static void stress_rawpkt_tx_metrics(stress_args_t *args, stress_rawpkt_tx_t *tx)
+{
+	double now, duration, cpu_secs;
+	uint64_t cycles;
+
+	now = stress_time_now();
+	if (now < tx->t_report)
+		return;
+	tx->t_report = now + 1.0;
+
+	duration = now - tx->t_start;
+	if ((duration <= 0.0) || (tx->pkts == 0))
+		return;
+	cpu_secs = (double)(stress_rawpkt_cpu_ns() - tx->cpu_start) / STRESS_DBL_NANOSECOND;
+	cycles = stress_cycles_get() - tx->cycles_start;
+
+	stress_metrics_set(args, 2, "Mpps sent",
+		(double)tx->pkts / (duration * 1.0E6), STRESS_HARMONIC_MEAN);
+	if (stress_cycles_supported()) {
+		stress_metrics_set(args, 3, "CPU cycles per packet sent",
+			(cpu_secs * ((double)cycles / duration)) / (double)tx->pkts,
+			STRESS_GEOMETRIC_MEAN);
+	} else {
+		stress_metrics_set(args, 3, "CPU nanosecs per packet sent",
+			(cpu_secs * STRESS_DBL_NANOSECOND) / (double)tx->pkts,
+			STRESS_GEOMETRIC_MEAN);
+	}
+}
+
+/*
+ *  stress_rawpkt_fill()
+ *	copy the packet template and give it a new IP id and checksum
+ */
+static inline void OPTIMIZE3 stress_rawpkt_fill(
+	void *pkt,
+	const void *tmpl,
+	const size_t len,
+	const uint16_t id)
+{
+	struct iphdr *ip = (struct iphdr *)((uintptr_t)pkt + sizeof(struct ethhdr));
+
+	(void)shim_memcpy(pkt, tmpl, len);
+	ip->id = htons(id);
+	ip->check = 0;
+	ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(struct iphdr) + sizeof(struct udphdr));
+}
+
+#if defined(HAVE_RAWPKT_TX_RING)
+/*
+ *  stress_rawpkt_txring_send()
+ *	send packets by filling in frames in a TPACKET_V3 PACKET_TX_RING
+ *	and kicking the ring with a zero length sendto, returns -1 if
+ *	the ring cannot be set up so the caller can fall back to sendto
+ */
+static int OPTIMIZE3 stress_rawpkt_txring_send(
+	stress_args_t *args,
+	const int fd,
+	const struct sockaddr_ll *sadr,
+	const void *tmpl,
+	const size_t len,
+	const int blocknr,
+	stress_rawpkt_tx_t *tx)
+{
+	struct tpacket_req3 tp;
+	const size_t page_size = stress_get_page_size();
+	const size_t block_size = STRESS_MAXIMUM(page_size, 65536);
+	const size_t data_off = TPACKET_ALIGN(sizeof(struct tpacket3_hdr));
+	const size_t ring_size = block_size * (size_t)blocknr;
+	size_t frame = 0, frame_nr;
+	uint16_t id = 12345;
+	uint8_t *ring;
+	int val = TPACKET_V3, rc = EXIT_SUCCESS;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &val, sizeof(val)) < 0)
+		return -1;
+	(void)shim_memset(&tp, 0, sizeof(tp));
+	tp.tp_block_size = (unsigned int)block_size;
+	tp.tp_block_nr = (unsigned int)blocknr;
+	tp.tp_frame_size = PACKET_SIZE;
+	tp.tp_frame_nr = (unsigned int)((block_size / PACKET_SIZE) * (size_t)blocknr);
+	frame_nr = (size_t)tp.tp_frame_nr;
+	if (setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &tp, sizeof(tp)) < 0)
+		return -1;
+	ring = (uint8_t *)mmap(NULL, ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED)
+		return -1;
+
+	do {
+		uint32_t queued = 0;
+		ssize_t n;
+
+		while (queued < RAWPKT_BATCH) {
+			struct tpacket3_hdr *hdr = (struct tpacket3_hdr *)(ring + (frame * PACKET_SIZE));
+			const uint32_t status = *(volatile uint32_t *)&hdr->tp_status;
+
+			if (UNLIKELY(status == TP_STATUS_WRONG_FORMAT)) {
+				pr_fail("%s: TX ring frame rejected as malformed\n", args->name);
+				rc = EXIT_FAILURE;
+				goto unmap;
+			}
+			if (status != TP_STATUS_AVAILABLE)
+				break;
+			stress_rawpkt_fill((uint8_t *)hdr + data_off, tmpl, len, id++);
+			hdr->tp_len = (uint32_t)len;
+			hdr->tp_next_offset = 0;
+			stress_asm_mb();
+			hdr->tp_status = TP_STATUS_SEND_REQUEST;
+			frame = (frame + 1 >= frame_nr) ? 0 : frame + 1;
+			queued++;
+		}
+
+		/* a blocking kick returns once all the queued frames are sent */
+		n = sendto(fd, NULL, 0, 0, (const struct sockaddr *)sadr, sizeof(*sadr));
+		if (UNLIKELY(n < 0)) {
+			if ((errno == EINTR) || (errno == ENOBUFS) || (errno == EAGAIN))
+				continue;
+			pr_fail("%s: TX ring sendto failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		tx->pkts += queued;
+		stress_rawpkt_tx_metrics(args, tx);
+	} while (stress_continue(args));
+unmap:
+	(void)munmap((void *)ring, ring_size);
+
+	return rc;
+}
+#endif
+
+#if defined(HAVE_RAWPKT_XDP)
+/*
+ *  stress_rawpkt_xdp_send()
+ *	send packets from an AF_XDP socket bound to queue 0 of the
+ *	interface, packets are written into UMEM frames, posted on the
+ *	TX ring and the frames are recycled from the completion ring.
+ *	The fill ring is mandatory for the UMEM but is left empty as
+ *	there is no XDP program redirecting packets to this socket.
+ *	Returns -1 if AF_XDP cannot be set up so the caller can fall
+ *	back to sendto
+ */
+static int OPTIMIZE3 stress_rawpkt_xdp_send(
+	stress_args_t *args,
+	const int ifindex,
+	const int xdp_mode,
+	const void *tmpl,
+	const size_t len,
+	stress_rawpkt_tx_t *tx)
+{
+	struct xdp_umem_reg mr;
+	struct xdp_mmap_offsets off;
+	struct sockaddr_xdp sxdp;
+	socklen_t optlen = sizeof(off);
+	const size_t umem_size = (size_t)RAWPKT_XDP_FRAMES * PACKET_SIZE;
+	size_t fr_size = 0, tx_size = 0, cr_size = 0;
+	uint8_t *umem, *tx_map = MAP_FAILED, *cr_map = MAP_FAILED, *fr_map = MAP_FAILED;
+	volatile uint32_t *tx_prod, *tx_flags, *cr_prod, *cr_cons;
+	struct xdp_desc *tx_desc;
+	uint32_t tx_head = 0, completed = 0;
+	int fd, ring_size = RAWPKT_XDP_FRAMES, rc = -1;
+	bool zerocopy = (xdp_mode == RAWPKT_XDP_ZEROCOPY);
+	uint16_t id = 12345;
+	size_t i;
+
+	fd = socket(AF_XDP, SOCK_RAW, 0);
+	if (fd < 0)
+		return -1;
+	umem = (uint8_t *)stress_mmap_populate(NULL, umem_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (umem == MAP_FAILED)
+		goto close_fd;
+	stress_set_vma_anon_name(umem, umem_size, "rawpkt-umem");
+	for (i = 0; i < RAWPKT_XDP_FRAMES; i++)
+		(void)shim_memcpy(umem + (i * PACKET_SIZE), tmpl, len);
+
+	(void)shim_memset(&mr, 0, sizeof(mr));
+	mr.addr = (uint64_t)(uintptr_t)umem;
+	mr.len = (uint64_t)umem_size;
+	mr.chunk_size = PACKET_SIZE;
+	mr.headroom = 0;
+	if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &mr, sizeof(mr)) < 0)
+		goto unmap_umem;
+	if (setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) < 0)
+		goto unmap_umem;
+	if (setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) < 0)
+		goto unmap_umem;
+	if (setsockopt(fd, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) < 0)
+		goto unmap_umem;
+	(void)shim_memset(&off, 0, sizeof(off));
+	if (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0)
+		goto unmap_umem;
+
+	fr_size = off.fr.desc + RAWPKT_XDP_FRAMES * sizeof(uint64_t);
+	fr_map = (uint8_t *)mmap(NULL, fr_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, XDP_UMEM_PGOFF_FILL_RING);
+	if (fr_map == MAP_FAILED)
+		goto unmap_umem;
+	cr_size = off.cr.desc + RAWPKT_XDP_FRAMES * sizeof(uint64_t);
+	cr_map = (uint8_t *)mmap(NULL, cr_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, XDP_UMEM_PGOFF_COMPLETION_RING);
+	if (cr_map == MAP_FAILED)
+		goto unmap_rings;
+	tx_size = off.tx.desc + RAWPKT_XDP_FRAMES * sizeof(struct xdp_desc);
+	tx_map = (uint8_t *)mmap(NULL, tx_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, XDP_PGOFF_TX_RING);
+	if (tx_map == MAP_FAILED)
+		goto unmap_rings;
+
+	tx_prod = (volatile uint32_t *)(tx_map + off.tx.producer);
+	tx_flags = (volatile uint32_t *)(tx_map + off.tx.flags);
+	tx_desc = (struct xdp_desc *)(tx_map + off.tx.desc);
+	cr_prod = (volatile uint32_t *)(cr_map + off.cr.producer);
+	cr_cons = (volatile uint32_t *)(cr_map + off.cr.consumer);
+
+	(void)shim_memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = (uint32_t)ifindex;
+	sxdp.sxdp_queue_id = 0;
+	sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP | (zerocopy ? XDP_ZEROCOPY : XDP_COPY);
+	if (bind(fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+		if (!zerocopy)
+			goto unmap_rings;
+		/* drivers without AF_XDP support can only do copy mode */
+		if (args->instance == 0)
+			pr_inf("%s: AF_XDP zero copy bind failed, errno=%d (%s), "
+				"using copy mode instead\n",
+				args->name, errno, strerror(errno));
+		zerocopy = false;
+		sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP | XDP_COPY;
+		if (bind(fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0)
+			goto unmap_rings;
+	}
+
+	rc = EXIT_SUCCESS;
+	do {
+		const uint32_t cr_head = *cr_cons;
+		const uint32_t done = *cr_prod - cr_head;
+		uint32_t queued = 0;
+
+		/* completed frames are free to be reused */
+		if (done) {
+			stress_asm_mb();
+			*cr_cons = cr_head + done;
+			completed += done;
+			tx->pkts += done;
+		}
+
+		while ((queued < RAWPKT_BATCH) &&
+		       ((tx_head - completed) < RAWPKT_XDP_FRAMES)) {
+			const uint32_t slot = tx_head & (RAWPKT_XDP_FRAMES - 1);
+			struct iphdr *ip = (struct iphdr *)(umem + ((size_t)slot * PACKET_SIZE) + sizeof(struct ethhdr));
+
+			ip->id = htons(id++);
+			ip->check = 0;
+			ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(struct iphdr) + sizeof(struct udphdr));
+			tx_desc[slot].addr = (uint64_t)slot * PACKET_SIZE;
+			tx_desc[slot].len = (uint32_t)len;
+			tx_desc[slot].options = 0;
+			tx_head++;
+			queued++;
+		}
+		if (queued) {
+			stress_asm_mb();
+			*tx_prod = tx_head;
+		}
+
+		/* copy mode only transmits from inside sendto */
+		if (!zerocopy || (*tx_flags & XDP_RING_NEED_WAKEUP)) {
+			if (UNLIKELY(sendto(fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0)) {
+				if ((errno != EAGAIN) && (errno != EBUSY) &&
+				    (errno != ENOBUFS) && (errno != EINTR)) {
+					pr_fail("%s: AF_XDP sendto failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					rc = EXIT_FAILURE;
+					break;
+				}
+			}
+		}
+		stress_rawpkt_tx_metrics(args, tx);
+	} while (stress_continue(args));
+
+unmap_rings:
+	if (tx_map != MAP_FAILED)
+		(void)munmap((void *)tx_map, tx_size);
+	if (cr_map != MAP_FAILED)
+		(void)munmap((void *)cr_map, cr_size);
+	if (fr_map != MAP_FAILED)
+		(void)munmap((void *)fr_map, fr_size);
+unmap_umem:
+	(void)munmap((void *)umem, umem_size);
+close_fd:
+	(void)close(fd);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_rawpkt_client()
  *	client sender
@@ -280,7 +706,9 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 	struct ifreq *hwaddr,
 	struct ifreq *ifaddr,
 	const struct ifreq *idx,
-	const int port)
+	const int port,
+	const int txring,
+	const int xdp_mode)
 {
 	int rc = EXIT_FAILURE;
 	uint16_t id = 12345;
@@ -289,6 +717,8 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 	struct iphdr *ip = (struct iphdr *)((uintptr_t)buf + sizeof(struct ethhdr));
 	struct udphdr *udp = (struct udphdr *)((uintptr_t)buf + sizeof(struct ethhdr) + sizeof(struct iphdr));
 	struct sockaddr_ll sadr;
+	stress_rawpkt_tx_t tx;
+	size_t len;
 	int fd;
 
 	stress_parent_died_alarm();
@@ -318,22 +748,76 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 	sadr.sll_halen = ETH_ALEN;
 	(void)shim_memcpy(&sadr.sll_addr, eth->h_dest, sizeof(eth->h_dest));
 
+	len = sizeof(struct ethhdr) + ip->tot_len;
+	(void)shim_memset(&tx, 0, sizeof(tx));
+	tx.t_start = stress_time_now();
+	tx.t_report = tx.t_start + 1.0;
+	tx.cycles_start = stress_cycles_get();
+	tx.cpu_start = stress_rawpkt_cpu_ns();
+
+	if (xdp_mode != RAWPKT_XDP_OFF) {
+#if defined(HAVE_RAWPKT_XDP)
+		rc = stress_rawpkt_xdp_send(args, idx->ifr_ifindex, xdp_mode, buf, len, &tx);
+		if (rc != -1)
+			goto err;
+		if (args->instance == 0)
+			pr_inf("%s: cannot set up AF_XDP socket on %s, errno=%d (%s), "
+				"using sendto instead\n", args->name, idx->ifr_name,
+				errno, strerror(errno));
+#else
+		if (args->instance == 0)
+			pr_inf("%s: AF_XDP is not supported, using sendto instead\n",
+				args->name);
+#endif
+		rc = EXIT_FAILURE;
+	}
+
 	if ((fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0) {
 		pr_fail("%s: socket failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		goto err;
 	}
 
+	if (txring && (xdp_mode == RAWPKT_XDP_OFF)) {
+#if defined(HAVE_RAWPKT_TX_RING)
+		rc = stress_rawpkt_txring_send(args, fd, &sadr, buf, len, txring, &tx);
+		if (rc != -1) {
+			stress_rawpkt_sockopts(fd);
+			(void)close(fd);
+			goto err;
+		}
+		if (args->instance == 0)
+			pr_inf("%s: cannot set up TPACKET_V3 TX ring, errno=%d (%s), "
+				"using sendto instead\n", args->name, errno, strerror(errno));
+		/* the socket cannot be reused once PACKET_VERSION is changed */
+		(void)close(fd);
+		if ((fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL))) < 0) {
+			rc = EXIT_FAILURE;
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto err;
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: TPACKET_V3 TX ring is not supported, using sendto instead\n",
+				args->name);
+#endif
+		rc = EXIT_FAILURE;
+	}
+
 	do {
 		ssize_t n;
 
 		ip->id = htons(id++);
+		ip->check = 0;
 		ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(struct iphdr) + sizeof(struct udphdr));
 
-		n = sendto(fd, buf, sizeof(struct ethhdr) + ip->tot_len, 0, (struct sockaddr *)&sadr, sizeof(sadr));
+		n = sendto(fd, buf, len, 0, (struct sockaddr *)&sadr, sizeof(sadr));
 		if (UNLIKELY(n < 0)) {
 			pr_fail("%s: raw socket sendto failed on port %d, errno=%d (%s)\n",
 				args->name, port, errno, strerror(errno));
+		} else {
+			tx.pkts++;
 		}
 #if defined(SIOCOUTQ)
 		/* Occasionally exercise SIOCOUTQ */
@@ -343,6 +827,8 @@ static void NORETURN OPTIMIZE3 stress_rawpkt_client(
 			VOID_RET(int, ioctl(fd, SIOCOUTQ, &queued));
 		}
 #endif
+		if (UNLIKELY((id & 0xff) == 0))
+			stress_rawpkt_tx_metrics(args, &tx);
 	} while (stress_continue(args));
 
 	stress_rawpkt_sockopts(fd);
@@ -444,6 +930,9 @@ static int OPTIMIZE3 stress_rawpkt_server(
 	rate = (duration > 0.0) ? bytes / duration : 0.0;
 	stress_metrics_set(args, 0, "MB recv'd per sec",
 		rate / (double)MB, STRESS_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)stress_bogo_get(args) / duration : 0.0;
+	stress_metrics_set(args, 1, "Mpps recv'd",
+		rate / 1.0E6, STRESS_HARMONIC_MEAN);
 
 	stress_rawpkt_sockopts(fd);
 #if defined(PACKET_RX_RING) &&	\
@@ -476,12 +965,30 @@ static int stress_rawpkt(stress_args_t *args)
 	int fd, rc = EXIT_FAILURE, parent_cpu;
 	struct ifreq hwaddr, ifaddr, idx;
 	int rawpkt_rxring = 0;
+	int rawpkt_txring = 0;
+	int rawpkt_xdp = RAWPKT_XDP_OFF;
+	char *rawpkt_if = NULL;
+	const char *if_name;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
 	(void)stress_get_setting("rawpkt-port", &rawpkt_port);
 	(void)stress_get_setting("rawpkt-rxring", &rawpkt_rxring);
+	(void)stress_get_setting("rawpkt-txring", &rawpkt_txring);
+	(void)stress_get_setting("rawpkt-xdp", &rawpkt_xdp);
+	(void)stress_get_setting("rawpkt-if", &rawpkt_if);
+
+	if (rawpkt_if) {
+		struct sockaddr if_addr;
+
+		if (stress_net_interface_exists(rawpkt_if, AF_INET, &if_addr) < 0) {
+			pr_inf("%s: interface '%s' is not enabled for AF_INET, "
+				"defaulting to using lo\n", args->name, rawpkt_if);
+			rawpkt_if = NULL;
+		}
+	}
+	if_name = rawpkt_if ? rawpkt_if : "lo";
 
 	rawpkt_port += args->instance;
 
@@ -497,28 +1004,28 @@ static int stress_rawpkt(stress_args_t *args)
 		return EXIT_FAILURE;
 	}
 	(void)shim_memset(&hwaddr, 0, sizeof(hwaddr));
-	(void)shim_strscpy(hwaddr.ifr_name, "lo", sizeof(hwaddr.ifr_name));
+	(void)shim_strscpy(hwaddr.ifr_name, if_name, sizeof(hwaddr.ifr_name));
 	if (ioctl(fd, SIOCGIFHWADDR, &hwaddr) < 0) {
-		pr_fail("%s: ioctl SIOCGIFHWADDR on lo failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
+		pr_fail("%s: ioctl SIOCGIFHWADDR on %s failed, errno=%d (%s)\n",
+			args->name, if_name, errno, strerror(errno));
 		(void)close(fd);
 		return EXIT_FAILURE;
 	}
 
 	(void)shim_memset(&ifaddr, 0, sizeof(ifaddr));
-	(void)shim_strscpy(ifaddr.ifr_name, "lo", sizeof(ifaddr.ifr_name));
+	(void)shim_strscpy(ifaddr.ifr_name, if_name, sizeof(ifaddr.ifr_name));
 	if (ioctl(fd, SIOCGIFADDR, &ifaddr) < 0) {
-		pr_fail("%s: ioctl SIOCGIFADDR on lo failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
+		pr_fail("%s: ioctl SIOCGIFADDR on %s failed, errno=%d (%s)\n",
+			args->name, if_name, errno, strerror(errno));
 		(void)close(fd);
 		return EXIT_FAILURE;
 	}
 
 	(void)shim_memset(&idx, 0, sizeof(idx));
-	(void)shim_strscpy(idx.ifr_name, "lo", sizeof(idx.ifr_name));
+	(void)shim_strscpy(idx.ifr_name, if_name, sizeof(idx.ifr_name));
 	if (ioctl(fd, SIOCGIFINDEX, &idx) < 0) {
-		pr_fail("%s: ioctl SIOCGIFINDEX on lo failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
+		pr_fail("%s: ioctl SIOCGIFINDEX on %s failed, errno=%d (%s)\n",
+			args->name, if_name, errno, strerror(errno));
 		(void)close(fd);
 		return EXIT_FAILURE;
 	}
@@ -540,7 +1047,8 @@ again:
 		return rc;
 	} else if (pid == 0) {
 		(void)stress_change_cpu(args, parent_cpu);
-		stress_rawpkt_client(args, &hwaddr, &ifaddr, &idx, rawpkt_port);
+		stress_rawpkt_client(args, &hwaddr, &ifaddr, &idx, rawpkt_port,
+			rawpkt_txring, rawpkt_xdp);
 	} else {
 		rc = stress_rawpkt_server(args, &ifaddr, rawpkt_port, rawpkt_rxring);
 		(void)stress_kill_pid_wait(pid, NULL);
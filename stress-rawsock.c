@@ -86,7 +86,7 @@ static void MLOCKED_TEXT rawsock_sigalrm_handler(int signum)
 
 static void stress_rawsock_init(void)
 {
-	rawsock_lock = stress_lock_create();
+	rawsock_lock = stress_lock_create("rawsock");
 	stop_rawsock = false;
 }
 
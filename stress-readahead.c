@@ -18,8 +18,13 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-pragma.h"
 
+#if defined(HAVE_SYS_SYSMACROS_H)
+#include <sys/sysmacros.h>
+#endif
+
 #define MIN_READAHEAD_BYTES	(1 * MB)
 #define MAX_READAHEAD_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_READAHEAD_BYTES	(64 * MB)
@@ -28,9 +33,18 @@
 #define BUF_SIZE		(4096)
 #define MAX_OFFSETS		(16)
 
+#define READAHEAD_MODE_RANDOM	(0)
+#define READAHEAD_MODE_SWEEP	(1)
+
+static const char * const readahead_modes[] = {
+	"random",
+	"sweep",
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"readahead N",		"start N workers exercising file readahead" },
 	{ NULL,	"readahead-bytes N",	"size of file to readahead on (default is 1GB)" },
+	{ NULL,	"readahead-mode M",	"select mode M, [ random | sweep ]" },
 	{ NULL,	"readahead-ops N",	"stop after N readahead bogo operations" },
 	{ NULL,	NULL,			NULL }
 };
@@ -45,8 +59,28 @@ static int stress_set_readahead_bytes(const char *opt)
 	return stress_set_setting("readahead-bytes", TYPE_ID_UINT64, &readahead_bytes);
 }
 
+static int stress_set_readahead_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(readahead_modes); i++) {
+		if (!strcmp(readahead_modes[i], opt)) {
+			const int readahead_mode = (int)i;
+
+			return stress_set_setting("readahead-mode", TYPE_ID_INT, &readahead_mode);
+		}
+	}
+
+	(void)fprintf(stderr, "readahead-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(readahead_modes); i++)
+		(void)fprintf(stderr, " %s", readahead_modes[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_readahead_bytes,	stress_set_readahead_bytes },
+	{ OPT_readahead_mode,	stress_set_readahead_mode },
 	{ 0,			NULL }
 };
 
@@ -91,6 +125,301 @@ static int do_readahead(
 	return 0;
 }
 
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED) &&	\
+    defined(POSIX_FADV_NORMAL)
+#define HAVE_READAHEAD_SWEEP
+
+typedef enum {
+	STRESS_RA_FADVISE,	/* pread scan with a posix_fadvise hint */
+	STRESS_RA_EXPLICIT,	/* pread scan with readahead() a window ahead */
+	STRESS_RA_MMAP,		/* mmap scan with a madvise hint */
+	STRESS_RA_BDEV,		/* pread scan with a block device read_ahead_kb */
+} stress_readahead_method_t;
+
+typedef struct {
+	const char *name;		/* name used in the metrics */
+	stress_readahead_method_t method; /* how the file is scanned */
+	int advice;			/* fadvise or madvise advice */
+	uint32_t kb;			/* readahead window or read_ahead_kb */
+} stress_readahead_sweep_t;
+
+typedef struct {
+	double bytes;			/* bytes scanned */
+	double duration;		/* time scanning */
+	uint64_t majflt;		/* major page faults while scanning */
+} stress_readahead_result_t;
+
+static const stress_readahead_sweep_t readahead_sweeps[] = {
+	{ "fadv-normal",	STRESS_RA_FADVISE,	POSIX_FADV_NORMAL,	0 },
+#if defined(POSIX_FADV_SEQUENTIAL)
+	{ "fadv-sequential",	STRESS_RA_FADVISE,	POSIX_FADV_SEQUENTIAL,	0 },
+#endif
+#if defined(POSIX_FADV_RANDOM)
+	{ "fadv-random",	STRESS_RA_FADVISE,	POSIX_FADV_RANDOM,	0 },
+	{ "readahead-128k",	STRESS_RA_EXPLICIT,	POSIX_FADV_RANDOM,	128 },
+	{ "readahead-1m",	STRESS_RA_EXPLICIT,	POSIX_FADV_RANDOM,	1024 },
+	{ "readahead-4m",	STRESS_RA_EXPLICIT,	POSIX_FADV_RANDOM,	4096 },
+#endif
+#if defined(HAVE_MADVISE) &&		\
+    defined(MADV_NORMAL)
+	{ "mmap-normal",	STRESS_RA_MMAP,		MADV_NORMAL,		0 },
+#endif
+#if defined(HAVE_MADVISE) &&		\
+    defined(MADV_SEQUENTIAL)
+	{ "mmap-sequential",	STRESS_RA_MMAP,		MADV_SEQUENTIAL,	0 },
+#endif
+	{ "read-ahead-kb-0",	STRESS_RA_BDEV,		POSIX_FADV_NORMAL,	0 },
+	{ "read-ahead-kb-128",	STRESS_RA_BDEV,		POSIX_FADV_NORMAL,	128 },
+	{ "read-ahead-kb-512",	STRESS_RA_BDEV,		POSIX_FADV_NORMAL,	512 },
+	{ "read-ahead-kb-2048",	STRESS_RA_BDEV,		POSIX_FADV_NORMAL,	2048 },
+	{ "read-ahead-kb-8192",	STRESS_RA_BDEV,		POSIX_FADV_NORMAL,	8192 },
+};
+
+/*
+ *  stress_readahead_majflt()
+ *	major page faults of this process
+ */
+static uint64_t stress_readahead_majflt(void)
+{
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0;
+	return (uint64_t)usage.ru_majflt;
+}
+
+/*
+ *  stress_readahead_bdev_path()
+ *	find the read_ahead_kb sysfs file of the block device
+ *	the file lives on, returns false if there is none
+ */
+static bool stress_readahead_bdev_path(const int fd, char *path, const size_t path_len)
+{
+#if defined(HAVE_SYS_SYSMACROS_H)
+	struct stat statbuf;
+	char buf[32];
+
+	if (shim_fstat(fd, &statbuf) < 0)
+		return false;
+
+	(void)snprintf(path, path_len, "/sys/dev/block/%u:%u/queue/read_ahead_kb",
+		major(statbuf.st_dev), minor(statbuf.st_dev));
+	if (stress_system_read(path, buf, sizeof(buf)) > 0)
+		return true;
+	/* partitions use the queue of the parent device */
+	(void)snprintf(path, path_len, "/sys/dev/block/%u:%u/../queue/read_ahead_kb",
+		major(statbuf.st_dev), minor(statbuf.st_dev));
+	if (stress_system_read(path, buf, sizeof(buf)) > 0)
+		return true;
+#else
+	(void)fd;
+	(void)path;
+	(void)path_len;
+#endif
+	return false;
+}
+
+/*
+ *  stress_readahead_verify()
+ *	check a block read back has the data it was written with
+ */
+static bool OPTIMIZE3 stress_readahead_verify(const buffer_t *buf, const off_t offset)
+{
+	register size_t j;
+	const off_t o = offset / BUF_SIZE;
+
+PRAGMA_UNROLL_N(8)
+	for (j = 0; j < (BUF_SIZE / sizeof(*buf)); j++) {
+		if (UNLIKELY(buf[j] != (buffer_t)o + j))
+			return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_readahead_scan()
+ *	drop the file's pages from the page cache and time a
+ *	cold cache sequential scan of the whole file
+ */
+static int stress_readahead_scan(
+	stress_args_t *args,
+	const int fd,
+	const char *fs_type,
+	buffer_t *buf,
+	const uint64_t size,
+	const stress_readahead_sweep_t *sweep,
+	stress_readahead_result_t *result)
+{
+	const size_t page_size = args->page_size;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	uint64_t majflt, bytes = 0;
+	double t;
+	int rc = 0;
+
+	(void)shim_fdatasync(fd);
+	(void)posix_fadvise(fd, 0, (off_t)size, POSIX_FADV_DONTNEED);
+	(void)posix_fadvise(fd, 0, 0, (sweep->method == STRESS_RA_MMAP) ?
+		POSIX_FADV_NORMAL : sweep->advice);
+
+	majflt = stress_readahead_majflt();
+	t = stress_time_now();
+
+	if (sweep->method == STRESS_RA_MMAP) {
+#if defined(HAVE_MADVISE)
+		uint8_t *ptr;
+		volatile uint8_t sum = 0;
+
+		ptr = (uint8_t *)mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+		if (ptr == MAP_FAILED) {
+			pr_fail("%s: mmap of %" PRIu64 " bytes failed, errno=%d (%s)%s\n",
+				args->name, size, errno, strerror(errno), fs_type);
+			return -1;
+		}
+		(void)madvise((void *)ptr, (size_t)size, sweep->advice);
+		for (bytes = 0; bytes < size; bytes += page_size) {
+			sum += ptr[bytes];
+			if ((bytes & (BUF_SIZE - 1)) == 0) {
+				stress_bogo_inc(args);
+				if (!stress_continue(args))
+					break;
+			}
+		}
+		(void)sum;
+		(void)munmap((void *)ptr, (size_t)size);
+#endif
+	} else {
+		const uint64_t window = (uint64_t)sweep->kb * KB;
+		uint64_t ra_next = 0;
+
+		if ((sweep->method == STRESS_RA_EXPLICIT) && (window > 0)) {
+			(void)readahead(fd, 0, (size_t)window);
+			ra_next = window;
+		}
+		while (bytes < size) {
+			ssize_t pret;
+
+			/* keep explicit readahead() a window ahead of the reader */
+			if ((ra_next > 0) && (ra_next < size) && (bytes + window >= ra_next)) {
+				(void)readahead(fd, (off_t)ra_next, (size_t)(window >> 1));
+				ra_next += window >> 1;
+			}
+			pret = pread(fd, buf, BUF_SIZE, (off_t)bytes);
+			if (UNLIKELY(pret <= 0)) {
+				if ((errno == EAGAIN) || (errno == EINTR)) {
+					if (!stress_continue(args))
+						break;
+					continue;
+				}
+				pr_fail("%s: read failed, errno=%d (%s)%s\n",
+					args->name, errno, strerror(errno), fs_type);
+				rc = -1;
+				break;
+			}
+			if (verify && (pret == BUF_SIZE) &&
+			    UNLIKELY(!stress_readahead_verify(buf, (off_t)bytes))) {
+				pr_fail("%s: error in data between 0x%" PRIx64 " and 0x%" PRIx64 "\n",
+					args->name, bytes, bytes + BUF_SIZE - 1);
+				rc = -1;
+				break;
+			}
+			bytes += (uint64_t)pret;
+			stress_bogo_inc(args);
+			if (!stress_continue(args))
+				break;
+		}
+	}
+
+	result->duration += stress_time_now() - t;
+	result->bytes += (double)bytes;
+	result->majflt += stress_readahead_majflt() - majflt;
+	(void)posix_fadvise(fd, 0, 0, POSIX_FADV_NORMAL);
+
+	return rc;
+}
+
+/*
+ *  stress_readahead_sweep()
+ *	repeatedly scan the file with each of the readahead sweep
+ *	settings and report the MB/s and major faults of each
+ */
+static int stress_readahead_sweep(
+	stress_args_t *args,
+	const int fd,
+	const char *fs_type,
+	buffer_t *buf,
+	const uint64_t size)
+{
+	stress_readahead_result_t results[SIZEOF_ARRAY(readahead_sweeps)];
+	char path[PATH_MAX], ra_kb_orig[32];
+	bool bdev = false;
+	size_t i, metric = 0;
+	int rc = EXIT_SUCCESS;
+
+	/*
+	 *  read_ahead_kb is device wide, so only sweep it when it is
+	 *  writable and no other instance is scanning the same device
+	 */
+	if (stress_readahead_bdev_path(fd, path, sizeof(path)) &&
+	    (stress_system_read(path, ra_kb_orig, sizeof(ra_kb_orig)) > 0) &&
+	    (stress_system_write(path, ra_kb_orig, strlen(ra_kb_orig)) > 0)) {
+		if (args->num_instances == 1)
+			bdev = true;
+		else if (args->instance == 0)
+			pr_inf("%s: read_ahead_kb sweep is only performed with one instance\n",
+				args->name);
+	} else if (args->instance == 0) {
+		pr_inf("%s: no writable block device read_ahead_kb, "
+			"skipping read_ahead_kb sweep\n", args->name);
+	}
+
+	(void)shim_memset(results, 0, sizeof(results));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < SIZEOF_ARRAY(readahead_sweeps)) && stress_continue(args); i++) {
+			const stress_readahead_sweep_t *sweep = &readahead_sweeps[i];
+
+			if (sweep->method == STRESS_RA_BDEV) {
+				char kb[16];
+
+				if (!bdev)
+					continue;
+				(void)snprintf(kb, sizeof(kb), "%" PRIu32 "\n", sweep->kb);
+				if (stress_system_write(path, kb, strlen(kb)) < 0)
+					continue;
+			}
+			if (stress_readahead_scan(args, fd, fs_type, buf, size, sweep, &results[i]) < 0) {
+				rc = EXIT_FAILURE;
+				break;
+			}
+		}
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	if (bdev)
+		(void)stress_system_write(path, ra_kb_orig, strlen(ra_kb_orig));
+
+	for (i = 0; i < SIZEOF_ARRAY(readahead_sweeps); i++) {
+		const stress_readahead_result_t *result = &results[i];
+		char description[64];
+
+		if (result->bytes <= 0.0)
+			continue;
+		(void)snprintf(description, sizeof(description),
+			"%s MB per sec", readahead_sweeps[i].name);
+		stress_metrics_set(args, metric++, description,
+			(result->duration > 0.0) ? (result->bytes / result->duration) / (double)MB : 0.0,
+			STRESS_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description),
+			"%s major faults per MB", readahead_sweeps[i].name);
+		stress_metrics_set(args, metric++, description,
+			(double)result->majflt / (result->bytes / (double)MB),
+			STRESS_GEOMETRIC_MEAN);
+	}
+	return rc;
+}
+#endif
+
 /*
  *  stress_readahead
  *	stress file system cache via readahead calls
@@ -110,6 +439,7 @@ static int stress_readahead(stress_args_t *args)
 	const char *fs_type;
 	off_t offsets[MAX_OFFSETS] ALIGN64;
 	int generate_offsets = 0;
+	int readahead_mode = READAHEAD_MODE_RANDOM;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 
 	if (!stress_get_setting("readahead-bytes", &readahead_bytes)) {
@@ -122,6 +452,16 @@ static int stress_readahead(stress_args_t *args)
 	if (readahead_bytes < MIN_READAHEAD_BYTES)
 		readahead_bytes = MIN_READAHEAD_BYTES;
 
+	(void)stress_get_setting("readahead-mode", &readahead_mode);
+#if !defined(HAVE_READAHEAD_SWEEP)
+	if (readahead_mode == READAHEAD_MODE_SWEEP) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: readahead-mode sweep needs posix_fadvise, "
+				"skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
 		return stress_exit_status(-rc);
@@ -213,6 +553,13 @@ PRAGMA_UNROLL_N(8)
 	rounded_readahead_bytes = (uint64_t)statbuf.st_size -
 		(uint64_t)(statbuf.st_size % BUF_SIZE);
 
+#if defined(HAVE_READAHEAD_SWEEP)
+	if (readahead_mode == READAHEAD_MODE_SWEEP) {
+		rc = stress_readahead_sweep(args, fd, fs_type, buf, rounded_readahead_bytes);
+		goto close_finish;
+	}
+#endif
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	stress_readahead_generate_offsets(offsets, rounded_readahead_bytes);
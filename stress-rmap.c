@@ -184,7 +184,7 @@ static int stress_rmap(stress_args_t *args)
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
-	counter_lock = stress_lock_create();
+	counter_lock = stress_lock_create("rmap-counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -22,6 +22,7 @@
 #include "core-helper.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LINUX_RSEQ_H)
 #include <linux/rseq.h>
@@ -32,10 +33,21 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"rseq N",	"start N workers that exercise restartable sequences" },
+	{ NULL,	"rseq-bench",	"compare rseq per-CPU counters and freelists with atomics and mutexes" },
 	{ NULL,	"rseq-ops N",	"stop after N bogo restartable sequence operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_rseq_bench(const char *opt)
+{
+	return stress_set_setting_true("rseq-bench", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_rseq_bench,	stress_set_rseq_bench },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_LINUX_RSEQ_H) &&		\
     defined(HAVE_ASM_NOP) &&			\
     defined(__NR_rseq) &&			\
@@ -176,6 +188,531 @@ static int stress_rseq_supported(const char *name)
 	return 0;
 }
 
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_LIB_PTHREAD)
+#define STRESS_RSEQ_BENCH
+
+#define RSEQ_BENCH_THREADS_MAX	(64)
+#define RSEQ_BENCH_NODES	(64)	/* freelist nodes per CPU */
+#define RSEQ_BENCH_BATCH	(1024)	/* ops between stop checks */
+
+/* cache line sized per-CPU counter */
+typedef struct {
+	uint64_t count;
+	uint8_t pad[64 - sizeof(uint64_t)];
+} ALIGN64 stress_rseq_percpu_t;
+
+typedef struct stress_rseq_node {
+	struct stress_rseq_node *next;
+	uint64_t payload;
+	uint8_t pad[64 - sizeof(void *) - sizeof(uint64_t)];
+} ALIGN64 stress_rseq_node_t;
+
+/* cache line sized per-CPU freelist head */
+typedef struct {
+	stress_rseq_node_t *head;
+	uint8_t pad[64 - sizeof(void *)];
+} ALIGN64 stress_rseq_list_t;
+
+/* per thread counts */
+typedef struct {
+	pthread_t pthread;
+	uint64_t ops;
+	uint64_t aborts;
+	uint64_t empty;
+	int ret;
+} ALIGN64 stress_rseq_thread_t;
+
+typedef struct stress_rseq_bench stress_rseq_bench_t;
+
+typedef struct {
+	const char *name;
+	void (*op)(stress_rseq_bench_t *bench, stress_rseq_thread_t *thread);
+	bool percpu;		/* per-CPU rather than shared data */
+	bool freelist;		/* freelist rather than counter */
+} stress_rseq_method_t;
+
+struct stress_rseq_bench {
+	const stress_rseq_method_t *method;
+	uint32_t n_cpus;			/* per-CPU array size */
+	stress_rseq_percpu_t *counters;		/* rseq per-CPU counters */
+	stress_rseq_list_t *lists;		/* rseq per-CPU freelists */
+	stress_rseq_node_t *nodes;		/* all freelist nodes */
+	uint64_t counter ALIGN64;		/* shared counter */
+	stress_rseq_node_t *shared_head;	/* mutex protected freelist */
+	pthread_mutex_t mutex;
+	volatile bool start;
+	volatile bool stop;
+};
+
+/*
+ *  stress_rseq_counter_inc()
+ *	increment this CPU's counter in a restartable sequence,
+ *	the add is the commit instruction. returns false if the
+ *	sequence was aborted by preemption, migration or a signal
+ */
+static inline bool stress_rseq_counter_inc(struct rseq *rs, stress_rseq_percpu_t *counters)
+{
+	const uint32_t cpu = STRESS_ACCESS_ONCE(rs->cpu_id_start);
+	uint64_t *count = &counters[cpu].count;
+
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n"
+		".balign 32\n"
+		"3:\n"
+		".long 0x0, 0x0\n"
+		".quad 1f, (2f - 1f), 4f\n"
+		".popsection\n"
+		"leaq 3b(%%rip), %%rax\n"
+		"movq %%rax, %[rseq_cs]\n"
+		"1:\n"
+		"cmpl %[cpu_id], %[current_cpu_id]\n"
+		"jnz 4f\n"
+		"addq $1, %[count]\n"
+		"2:\n"
+		".pushsection __rseq_failure, \"ax\"\n"
+		".byte 0x0f, 0xb9, 0x3d\n"
+		".long %c[sig]\n"
+		"4:\n"
+		"jmp %l[abort]\n"
+		".popsection\n"
+		:
+		: [cpu_id] "r" (cpu),
+		  [current_cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "m" (rs->rseq_cs),
+		  [count] "m" (*count),
+		  [sig] "i" (RSEQ_SIG)
+		: "memory", "cc", "rax"
+		: abort);
+	return true;
+abort:
+	return false;
+}
+
+/*
+ *  stress_rseq_list_pop()
+ *	pop a node off this CPU's freelist in a restartable sequence,
+ *	the store of the new head is the commit instruction. returns
+ *	1 on success, 0 if the list is empty, -1 if aborted
+ */
+static inline int stress_rseq_list_pop(struct rseq *rs, stress_rseq_list_t *lists, stress_rseq_node_t **node)
+{
+	const uint32_t cpu = STRESS_ACCESS_ONCE(rs->cpu_id_start);
+	stress_rseq_node_t **head = &lists[cpu].head;
+
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n"
+		".balign 32\n"
+		"3:\n"
+		".long 0x0, 0x0\n"
+		".quad 1f, (2f - 1f), 4f\n"
+		".popsection\n"
+		"leaq 3b(%%rip), %%rax\n"
+		"movq %%rax, %[rseq_cs]\n"
+		"1:\n"
+		"cmpl %[cpu_id], %[current_cpu_id]\n"
+		"jnz 4f\n"
+		"movq %[head], %%rbx\n"
+		"testq %%rbx, %%rbx\n"
+		"jz %l[empty]\n"
+		"movq %%rbx, %[node]\n"
+		"movq (%%rbx), %%rcx\n"
+		"movq %%rcx, %[head]\n"
+		"2:\n"
+		".pushsection __rseq_failure, \"ax\"\n"
+		".byte 0x0f, 0xb9, 0x3d\n"
+		".long %c[sig]\n"
+		"4:\n"
+		"jmp %l[abort]\n"
+		".popsection\n"
+		:
+		: [cpu_id] "r" (cpu),
+		  [current_cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "m" (rs->rseq_cs),
+		  [head] "m" (*head),
+		  [node] "m" (*node),
+		  [sig] "i" (RSEQ_SIG)
+		: "memory", "cc", "rax", "rbx", "rcx"
+		: abort, empty);
+	return 1;
+abort:
+	return -1;
+empty:
+	return 0;
+}
+
+/*
+ *  stress_rseq_list_push()
+ *	push a node onto this CPU's freelist in a restartable
+ *	sequence, the store of the new head is the commit
+ *	instruction. returns false if aborted
+ */
+static inline bool stress_rseq_list_push(struct rseq *rs, stress_rseq_list_t *lists, stress_rseq_node_t *node)
+{
+	const uint32_t cpu = STRESS_ACCESS_ONCE(rs->cpu_id_start);
+	stress_rseq_node_t **head = &lists[cpu].head;
+
+	__asm__ __volatile__ goto (
+		".pushsection __rseq_cs, \"aw\"\n"
+		".balign 32\n"
+		"3:\n"
+		".long 0x0, 0x0\n"
+		".quad 1f, (2f - 1f), 4f\n"
+		".popsection\n"
+		"leaq 3b(%%rip), %%rax\n"
+		"movq %%rax, %[rseq_cs]\n"
+		"1:\n"
+		"cmpl %[cpu_id], %[current_cpu_id]\n"
+		"jnz 4f\n"
+		"movq %[head], %%rbx\n"
+		"movq %%rbx, (%[node])\n"
+		"movq %[node], %[head]\n"
+		"2:\n"
+		".pushsection __rseq_failure, \"ax\"\n"
+		".byte 0x0f, 0xb9, 0x3d\n"
+		".long %c[sig]\n"
+		"4:\n"
+		"jmp %l[abort]\n"
+		".popsection\n"
+		:
+		: [cpu_id] "r" (cpu),
+		  [current_cpu_id] "m" (rs->cpu_id),
+		  [rseq_cs] "m" (rs->rseq_cs),
+		  [head] "m" (*head),
+		  [node] "r" (node),
+		  [sig] "i" (RSEQ_SIG)
+		: "memory", "cc", "rax", "rbx"
+		: abort);
+	return true;
+abort:
+	return false;
+}
+
+static void stress_rseq_op_rseq_counter(stress_rseq_bench_t *bench, stress_rseq_thread_t *thread)
+{
+	struct rseq *rs = stress_rseq_get_area();
+	int i;
+
+	for (i = 0; i < RSEQ_BENCH_BATCH; i++) {
+		while (!stress_rseq_counter_inc(rs, bench->counters))
+			thread->aborts++;
+	}
+	thread->ops += RSEQ_BENCH_BATCH;
+}
+
+static void stress_rseq_op_atomic_counter(stress_rseq_bench_t *bench, stress_rseq_thread_t *thread)
+{
+	int i;
+
+	for (i = 0; i < RSEQ_BENCH_BATCH; i++)
+		(void)__atomic_fetch_add(&bench->counter, 1, __ATOMIC_RELAXED);
+	thread->ops += RSEQ_BENCH_BATCH;
+}
+
+static void stress_rseq_op_mutex_counter(stress_rseq_bench_t *bench, stress_rseq_thread_t *thread)
+{
+	int i;
+
+	for (i = 0; i < RSEQ_BENCH_BATCH; i++) {
+		(void)pthread_mutex_lock(&bench->mutex);
+		bench->counter++;
+		(void)pthread_mutex_unlock(&bench->mutex);
+	}
+	thread->ops += RSEQ_BENCH_BATCH;
+}
+
+static void stress_rseq_op_rseq_freelist(stress_rseq_bench_t *bench, stress_rseq_thread_t *thread)
+{
+	struct rseq *rs = stress_rseq_get_area();
+	int i;
+
+	for (i = 0; i < RSEQ_BENCH_BATCH; i++) {
+		stress_rseq_node_t *node = NULL;
+		int ret;
+
+		while ((ret = stress_rseq_list_pop(rs, bench->lists, &node)) < 0)
+			thread->aborts++;
+		if (ret == 0) {
+			/* this CPU's nodes are all held by preempted threads */
+			thread->empty++;
+			continue;
+		}
+		node->payload++;
+		/* push back to whichever CPU we are on now */
+		while (!stress_rseq_list_push(rs, bench->lists, node))
+			thread->aborts++;
+		thread->ops++;
+	}
+}
+
+static void stress_rseq_op_mutex_freelist(stress_rseq_bench_t *bench, stress_rseq_thread_t *thread)
+{
+	int i;
+
+	for (i = 0; i < RSEQ_BENCH_BATCH; i++) {
+		stress_rseq_node_t *node;
+
+		(void)pthread_mutex_lock(&bench->mutex);
+		node = bench->shared_head;
+		if (node)
+			bench->shared_head = node->next;
+		(void)pthread_mutex_unlock(&bench->mutex);
+		if (!node) {
+			thread->empty++;
+			continue;
+		}
+		node->payload++;
+		(void)pthread_mutex_lock(&bench->mutex);
+		node->next = bench->shared_head;
+		bench->shared_head = node;
+		(void)pthread_mutex_unlock(&bench->mutex);
+		thread->ops++;
+	}
+}
+
+static const stress_rseq_method_t stress_rseq_methods[] = {
+	{ "rseq-counter",	stress_rseq_op_rseq_counter,	true,	false },
+	{ "atomic-counter",	stress_rseq_op_atomic_counter,	false,	false },
+	{ "mutex-counter",	stress_rseq_op_mutex_counter,	false,	false },
+	{ "rseq-freelist",	stress_rseq_op_rseq_freelist,	true,	true },
+	{ "mutex-freelist",	stress_rseq_op_mutex_freelist,	false,	true },
+};
+
+static stress_rseq_bench_t *stress_rseq_bench_ctxt;
+
+static void *stress_rseq_bench_thread(void *arg)
+{
+	stress_rseq_thread_t *thread = (stress_rseq_thread_t *)arg;
+	stress_rseq_bench_t *bench = stress_rseq_bench_ctxt;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!bench->start)
+		shim_sched_yield();
+	while (!bench->stop)
+		bench->method->op(bench, thread);
+	return NULL;
+}
+
+/*
+ *  stress_rseq_bench_reset()
+ *	zero the counters and put RSEQ_BENCH_NODES nodes per CPU
+ *	either on each CPU's freelist or on the shared freelist
+ */
+static void stress_rseq_bench_reset(stress_rseq_bench_t *bench)
+{
+	const size_t n_nodes = (size_t)bench->n_cpus * RSEQ_BENCH_NODES;
+	size_t i;
+
+	(void)shim_memset(bench->counters, 0, bench->n_cpus * sizeof(*bench->counters));
+	(void)shim_memset(bench->lists, 0, bench->n_cpus * sizeof(*bench->lists));
+	bench->counter = 0;
+	bench->shared_head = NULL;
+	for (i = 0; i < n_nodes; i++) {
+		stress_rseq_node_t **head = bench->method->percpu ?
+			&bench->lists[i / RSEQ_BENCH_NODES].head : &bench->shared_head;
+		stress_rseq_node_t *node = &bench->nodes[i];
+
+		node->next = *head;
+		*head = node;
+		node->payload = 0;
+	}
+}
+
+/*
+ *  stress_rseq_bench_check()
+ *	check no counts or freelist nodes were lost
+ */
+static int stress_rseq_bench_check(
+	stress_args_t *args,
+	stress_rseq_bench_t *bench,
+	const uint64_t ops)
+{
+	const size_t n_nodes = (size_t)bench->n_cpus * RSEQ_BENCH_NODES;
+	uint64_t total = 0;
+	size_t i, found = 0;
+	const stress_rseq_method_t *method = bench->method;
+
+	if (!method->freelist) {
+		if (method->percpu) {
+			for (i = 0; i < bench->n_cpus; i++)
+				total += bench->counters[i].count;
+		} else {
+			total = bench->counter;
+		}
+	} else {
+		const size_t n_lists = method->percpu ? bench->n_cpus : 1;
+
+		for (i = 0; i < n_lists; i++) {
+			const stress_rseq_node_t *node = method->percpu ?
+				bench->lists[i].head : bench->shared_head;
+
+			while (node && (found <= n_nodes)) {
+				found++;
+				node = node->next;
+			}
+		}
+		for (i = 0; i < n_nodes; i++)
+			total += bench->nodes[i].payload;
+		if (found != n_nodes) {
+			pr_fail("%s: %s has %zu nodes on the freelists, expected %zu\n",
+				args->name, method->name, found, n_nodes);
+			return -1;
+		}
+	}
+	if (total != ops) {
+		pr_fail("%s: %s counted %" PRIu64 " operations, expected %" PRIu64 "\n",
+			args->name, method->name, total, ops);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_rseq_bench()
+ *	compare rseq per-CPU counters and freelists with atomic
+ *	and mutex protected shared equivalents over a range of
+ *	thread counts, reporting ops per second and rseq abort rates
+ */
+static int stress_rseq_bench(stress_args_t *args)
+{
+	typedef struct {
+		uint64_t ops;
+		uint64_t aborts;
+		double duration;
+	} stress_rseq_result_t;
+
+	const int32_t cpus_online = stress_get_processors_online();
+	const int32_t cpus_configured = stress_get_processors_configured();
+	const size_t n_methods = SIZEOF_ARRAY(stress_rseq_methods);
+	const size_t max_threads = (size_t)STRESS_MAXIMUM(2,
+		STRESS_MINIMUM(RSEQ_BENCH_THREADS_MAX, 2 * STRESS_MAXIMUM(1, cpus_online)));
+	size_t thread_counts[8], n_counts = 0, n_configs, i, idx = 0, metric = 0;
+	stress_rseq_result_t *results;
+	stress_rseq_thread_t *threads;
+	stress_rseq_bench_t *bench;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	/* 1, 2, 4.. threads up to twice the CPUs to oversubscribe and force aborts */
+	for (i = 1; (i < max_threads) && (n_counts < SIZEOF_ARRAY(thread_counts) - 1); i <<= 1)
+		thread_counts[n_counts++] = i;
+	thread_counts[n_counts++] = max_threads;
+	n_configs = n_methods * n_counts;
+
+	bench = (stress_rseq_bench_t *)calloc(1, sizeof(*bench));
+	threads = (stress_rseq_thread_t *)calloc(max_threads, sizeof(*threads));
+	results = (stress_rseq_result_t *)calloc(n_configs, sizeof(*results));
+	if (!bench || !threads || !results) {
+		pr_inf_skip("%s: cannot allocate benchmark state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_state;
+	}
+	bench->n_cpus = (uint32_t)STRESS_MAXIMUM(1, STRESS_MAXIMUM(cpus_configured, cpus_online));
+	bench->counters = (stress_rseq_percpu_t *)calloc(bench->n_cpus, sizeof(*bench->counters));
+	bench->lists = (stress_rseq_list_t *)calloc(bench->n_cpus, sizeof(*bench->lists));
+	bench->nodes = (stress_rseq_node_t *)calloc((size_t)bench->n_cpus * RSEQ_BENCH_NODES,
+		sizeof(*bench->nodes));
+	if (!bench->counters || !bench->lists || !bench->nodes) {
+		pr_inf_skip("%s: cannot allocate per-CPU data, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_percpu;
+	}
+	(void)pthread_mutex_init(&bench->mutex, NULL);
+	stress_rseq_bench_ctxt = bench;
+
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_configs : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		const size_t n_threads = thread_counts[idx % n_counts];
+		stress_rseq_result_t *result = &results[idx];
+		uint64_t ops = 0, aborts = 0;
+		size_t started = 0;
+		double t_start, t_end;
+
+		bench->method = &stress_rseq_methods[idx / n_counts];
+		stress_rseq_bench_reset(bench);
+		bench->start = false;
+		bench->stop = false;
+		(void)shim_memset(threads, 0, max_threads * sizeof(*threads));
+		for (i = 0; i < n_threads; i++) {
+			threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+				stress_rseq_bench_thread, &threads[i]);
+			if (threads[i].ret)
+				break;
+			started++;
+		}
+		t_start = stress_time_now();
+		bench->start = true;
+		(void)shim_nanosleep_uint64((uint64_t)(slice * STRESS_DBL_NANOSECOND));
+		bench->stop = true;
+		for (i = 0; i < started; i++)
+			(void)pthread_join(threads[i].pthread, NULL);
+		t_end = stress_time_now();
+
+		for (i = 0; i < started; i++) {
+			ops += threads[i].ops;
+			aborts += threads[i].aborts;
+		}
+		if ((started == n_threads) && (stress_rseq_bench_check(args, bench, ops) < 0))
+			rc = EXIT_FAILURE;
+		if (started == n_threads) {
+			result->ops += ops;
+			result->aborts += aborts;
+			result->duration += t_end - t_start;
+		}
+		stress_bogo_add(args, ops / RSEQ_BENCH_BATCH);
+
+		idx++;
+		if (idx >= n_configs)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-15s %7s %12s %14s\n", args->name,
+			"method", "threads", "Mops/sec", "aborts/Mops");
+	for (i = 0; i < n_configs; i++) {
+		const stress_rseq_result_t *result = &results[i];
+		const char *name = stress_rseq_methods[i / n_counts].name;
+		const size_t n_threads = thread_counts[i % n_counts];
+		double rate, abort_rate;
+		char str[64];
+
+		if ((result->ops == 0) || (result->duration <= 0.0))
+			continue;
+		rate = (double)result->ops / result->duration;
+		abort_rate = (double)result->aborts * 1000000.0 / (double)result->ops;
+		if (args->instance == 0)
+			pr_inf("%s: %-15s %7zu %12.2f %14.2f\n", args->name,
+				name, n_threads, rate / 1000000.0, abort_rate);
+		/* metrics for one thread and for the oversubscribed count */
+		if ((n_threads != 1) && (n_threads != max_threads))
+			continue;
+		if (metric + 1 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(str, sizeof(str), "%s %zu threads M ops per sec", name, n_threads);
+		stress_metrics_set(args, metric++, str, rate / 1000000.0, STRESS_HARMONIC_MEAN);
+	}
+	(void)pthread_mutex_destroy(&bench->mutex);
+
+free_percpu:
+	free(bench->nodes);
+	free(bench->lists);
+	free(bench->counters);
+free_state:
+	free(results);
+	free(threads);
+	free(bench);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_rseq()
  *	exercise restartable sequences rseq
@@ -218,6 +755,19 @@ static int stress_rseq(stress_args_t *args)
 {
 	int ret;
 	double rate;
+	bool rseq_bench = false;
+
+	(void)stress_get_setting("rseq-bench", &rseq_bench);
+	if (rseq_bench) {
+#if defined(STRESS_RSEQ_BENCH)
+		return stress_rseq_bench(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --rseq-bench is only implemented for x86-64, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 
 	/*
 	 *  rseq_info is in a shared page to avoid losing the
@@ -256,12 +806,14 @@ stressor_info_t stress_rseq_info = {
 	.stressor = stress_rseq,
 	.supported = stress_rseq_supported,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_rseq_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without Linux restartable sequences support"
 };
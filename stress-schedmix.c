@@ -21,6 +21,9 @@
 #include "core-builtin.h"
 #include "core-capabilities.h"
 #include "core-killpid.h"
+#include "core-latency.h"
+#include "core-pthread.h"
+#include "core-put.h"
 
 #include <sched.h>
 
@@ -50,8 +53,12 @@
 #define MAX_SCHEDMIX_PROCS	(64)
 #define DEFAULT_SCHEDMIX_PROCS	(16)
 
+#define SCHEDMIX_LAT_MSGS_MAX		(4)
+#define SCHEDMIX_LAT_REQUEST_LOOPS	(10000)
+
 static const stress_help_t help[] = {
 	{ NULL,	"schedmix N",		"start N workers that exercise a mix of scheduling loads" },
+	{ NULL,	"schedmix-latency",	"measure wakeup latency of message woken worker threads" },
 	{ NULL,	"schedmix-ops N",	"stop after N schedmix bogo operations" },
 	{ NULL, "schedmix-procs N",	"select number of schedmix child processes 1..64" },
 	{ NULL,	NULL,			NULL }
@@ -71,7 +78,13 @@ static int stress_set_schedmix_procs(const char *opt)
 	return stress_set_setting("schedmix-procs", TYPE_ID_SIZE_T, &schedmix_procs);
 }
 
+static int stress_set_schedmix_latency(const char *opt)
+{
+	return stress_set_setting_true("schedmix-latency", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+        { OPT_schedmix_latency,	stress_set_schedmix_latency },
         { OPT_schedmix_procs,	stress_set_schedmix_procs },
         { 0,			NULL }
 };
@@ -91,6 +104,50 @@ typedef struct {
 static stress_schedmix_sem_t *schedmix_sem;
 #endif
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC) &&		\
+    defined(__linux__)
+#define STRESS_SCHEDMIX_LATENCY
+
+typedef struct stress_schedmix_lat_msg stress_schedmix_lat_msg_t;
+
+/* state shared by all threads of a latency pass */
+typedef struct {
+	int policy;			/* scheduling policy under test */
+	volatile bool stop;
+} stress_schedmix_lat_t;
+
+/* worker thread, woken by its message thread */
+typedef struct {
+	stress_schedmix_lat_msg_t *msg;
+	uint32_t state ALIGN64;		/* futex, 1 = woken */
+	uint64_t wake_ns;		/* time the message thread woke us */
+	uint64_t requests;
+	stress_latency_t wakeup;	/* wakeup to running */
+	stress_latency_t request;	/* wakeup to request complete */
+} stress_schedmix_lat_worker_t;
+
+/* message thread, wakes n_workers workers and waits for them */
+struct stress_schedmix_lat_msg {
+	stress_schedmix_lat_t *lat;
+	stress_schedmix_lat_worker_t *workers;
+	uint32_t n_workers;
+	uint32_t pending ALIGN64;	/* futex, workers yet to complete */
+	bool policy_failed;
+};
+
+/* results of a scheduling policy and worker count */
+typedef struct {
+	int policy;
+	uint32_t workers;		/* workers per message thread */
+	uint64_t requests;
+	bool skipped;
+	stress_latency_t wakeup;
+	stress_latency_t request;
+} stress_schedmix_lat_result_t;
+#endif
+
 static const int policies[] = {
 #if defined(SCHED_IDLE)
 	SCHED_IDLE,
@@ -469,12 +526,320 @@ case_sched_fifo:
 	return EXIT_SUCCESS;
 }
 
+#if defined(STRESS_SCHEDMIX_LATENCY)
+/*
+ *  stress_schedmix_lat_now()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_schedmix_lat_now(void)
+{
+	struct timespec ts;
+
+	if (UNLIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) < 0))
+		return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+	return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  stress_schedmix_lat_policy()
+ *	set the calling thread's scheduling policy, the
+ *	real time policies use their lowest priority
+ */
+static int stress_schedmix_lat_policy(const int policy)
+{
+	struct sched_param param;
+
+	(void)shim_memset(&param, 0, sizeof(param));
+#if defined(SCHED_FIFO) || defined(SCHED_RR)
+	if (0
+#if defined(SCHED_FIFO)
+	    || (policy == SCHED_FIFO)
+#endif
+#if defined(SCHED_RR)
+	    || (policy == SCHED_RR)
+#endif
+	    ) {
+		param.sched_priority = sched_get_priority_min(policy);
+		if (param.sched_priority < 0)
+			return -1;
+	}
+#endif
+	return sched_setscheduler(0, policy, &param);
+}
+
+/*
+ *  stress_schedmix_lat_request()
+ *	the work done per request, a short burst of
+ *	cache resident integer arithmetic, not inlined so
+ *	it cannot be moved outside of the timed region
+ */
+static uint64_t NOINLINE OPTIMIZE3 stress_schedmix_lat_request(const uint64_t seed)
+{
+	register uint64_t x = seed | 1;
+	register int i;
+
+	for (i = 0; i < SCHEDMIX_LAT_REQUEST_LOOPS; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+	}
+	return x;
+}
+
+/*
+ *  stress_schedmix_lat_worker()
+ *	sleep until woken by the message thread, record the
+ *	wakeup to running latency, do a request and record the
+ *	wakeup to request completion latency
+ */
+static void *stress_schedmix_lat_worker(void *arg)
+{
+	stress_schedmix_lat_worker_t *w = (stress_schedmix_lat_worker_t *)arg;
+	stress_schedmix_lat_msg_t *msg = w->msg;
+	stress_schedmix_lat_t *lat = msg->lat;
+	const struct timespec timeout = { 0, 100000000 };
+	sigset_t set;
+	uint64_t x = (uint64_t)(uintptr_t)w;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	if (stress_schedmix_lat_policy(lat->policy) < 0)
+		msg->policy_failed = true;
+
+	while (!lat->stop) {
+		uint64_t t_run, t_done;
+
+		if (__atomic_load_n(&w->state, __ATOMIC_ACQUIRE) == 0) {
+			(void)shim_futex_wait(&w->state, 0, &timeout);
+			continue;
+		}
+		t_run = stress_schedmix_lat_now();
+		x = stress_schedmix_lat_request(x);
+		t_done = stress_schedmix_lat_now();
+		stress_latency_add(&w->wakeup, t_run - w->wake_ns);
+		stress_latency_add(&w->request, t_done - w->wake_ns);
+		w->requests++;
+
+		__atomic_store_n(&w->state, 0, __ATOMIC_RELEASE);
+		if (__atomic_sub_fetch(&msg->pending, 1, __ATOMIC_ACQ_REL) == 0)
+			(void)shim_futex_wake(&msg->pending, 1);
+	}
+	stress_uint64_put(x);
+	return NULL;
+}
+
+/*
+ *  stress_schedmix_lat_message()
+ *	wake all workers of this message thread, then sleep
+ *	until they have all completed their request
+ */
+static void *stress_schedmix_lat_message(void *arg)
+{
+	stress_schedmix_lat_msg_t *msg = (stress_schedmix_lat_msg_t *)arg;
+	stress_schedmix_lat_t *lat = msg->lat;
+	const struct timespec timeout = { 0, 100000000 };
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	if (stress_schedmix_lat_policy(lat->policy) < 0)
+		msg->policy_failed = true;
+
+	while (!lat->stop) {
+		uint32_t i, pending;
+
+		__atomic_store_n(&msg->pending, msg->n_workers, __ATOMIC_RELEASE);
+		for (i = 0; i < msg->n_workers; i++) {
+			stress_schedmix_lat_worker_t *w = &msg->workers[i];
+
+			w->wake_ns = stress_schedmix_lat_now();
+			__atomic_store_n(&w->state, 1, __ATOMIC_RELEASE);
+			(void)shim_futex_wake(&w->state, 1);
+		}
+		while (!lat->stop &&
+		       ((pending = __atomic_load_n(&msg->pending, __ATOMIC_ACQUIRE)) != 0))
+			(void)shim_futex_wait(&msg->pending, (int)pending, &timeout);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_schedmix_lat_pass()
+ *	run message and worker threads with a given policy for
+ *	duration seconds, returns -1 if the policy is not permitted
+ */
+static int stress_schedmix_lat_pass(
+	stress_args_t *args,
+	stress_schedmix_lat_result_t *result,
+	const uint32_t n_msgs,
+	const double duration)
+{
+	stress_schedmix_lat_t lat;
+	stress_schedmix_lat_msg_t msgs[SCHEDMIX_LAT_MSGS_MAX];
+	stress_schedmix_lat_worker_t *workers;
+	const uint32_t n_workers = n_msgs * result->workers;
+	uint32_t i, j, n_threads = 0;
+	uint64_t requests = 0;
+	pthread_t *pthreads;
+	bool policy_failed = false;
+	int rc = 0;
+
+	workers = (stress_schedmix_lat_worker_t *)calloc((size_t)n_workers, sizeof(*workers));
+	pthreads = (pthread_t *)calloc((size_t)(n_workers + n_msgs), sizeof(*pthreads));
+	if (!workers || !pthreads) {
+		free(pthreads);
+		free(workers);
+		return 0;
+	}
+	(void)shim_memset(&lat, 0, sizeof(lat));
+	(void)shim_memset(msgs, 0, sizeof(msgs));
+	lat.policy = result->policy;
+
+	for (i = 0; i < n_msgs; i++) {
+		msgs[i].lat = &lat;
+		msgs[i].workers = &workers[i * result->workers];
+		msgs[i].n_workers = result->workers;
+		for (j = 0; j < result->workers; j++) {
+			msgs[i].workers[j].msg = &msgs[i];
+			if (pthread_create(&pthreads[n_threads], NULL,
+					stress_schedmix_lat_worker, &msgs[i].workers[j]))
+				goto stop;
+			n_threads++;
+		}
+	}
+	for (i = 0; i < n_msgs; i++) {
+		if (pthread_create(&pthreads[n_threads], NULL,
+				stress_schedmix_lat_message, &msgs[i]))
+			goto stop;
+		n_threads++;
+	}
+	(void)shim_nanosleep_uint64((uint64_t)(duration * STRESS_DBL_NANOSECOND));
+stop:
+	lat.stop = true;
+	for (i = 0; i < n_threads; i++)
+		(void)pthread_join(pthreads[i], NULL);
+
+	for (i = 0; i < n_msgs; i++)
+		policy_failed |= msgs[i].policy_failed;
+	if (policy_failed) {
+		rc = -1;
+	} else {
+		for (i = 0; i < n_workers; i++) {
+			const stress_schedmix_lat_worker_t *w = &workers[i];
+
+			stress_latency_merge(&result->wakeup, &w->wakeup);
+			stress_latency_merge(&result->request, &w->request);
+			if (args->latency)
+				stress_latency_merge(args->latency, &w->wakeup);
+			requests += w->requests;
+		}
+		result->requests += requests;
+		stress_bogo_add(args, requests);
+	}
+	free(pthreads);
+	free(workers);
+
+	return rc;
+}
+
+/*
+ *  stress_schedmix_latency()
+ *	schbench style wakeup latency benchmark, message threads
+ *	wake worker threads for each scheduling policy over a
+ *	sweep of workers per message thread
+ */
+static int stress_schedmix_latency(stress_args_t *args, const size_t schedmix_procs)
+{
+	const int32_t cpus = stress_get_processors_online();
+	const uint32_t n_msgs = (uint32_t)STRESS_MAXIMUM(1,
+		STRESS_MINIMUM(SCHEDMIX_LAT_MSGS_MAX, cpus / 4));
+	stress_schedmix_lat_result_t *results;
+	size_t i, n_results = 0, idx = 0, metric = 0, n_skipped = 0;
+	uint32_t workers;
+	double slice;
+
+	results = (stress_schedmix_lat_result_t *)calloc(
+		SIZEOF_ARRAY(policies) * 8, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate latency results, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < SIZEOF_ARRAY(policies); i++) {
+#if defined(SCHED_DEADLINE)
+		/* deadline needs runtime parameters, not a like for like test */
+		if (policies[i] == SCHED_DEADLINE)
+			continue;
+#endif
+		for (workers = 1; workers <= (uint32_t)schedmix_procs; workers <<= 1) {
+			results[n_results].policy = policies[i];
+			results[n_results].workers = workers;
+			n_results++;
+		}
+	}
+	if (n_results == 0) {
+		free(results);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_schedmix_lat_result_t *result = &results[idx];
+
+		if (!result->skipped && (stress_schedmix_lat_pass(args, result, n_msgs, slice) < 0))
+			result->skipped = true;
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-8s %4s %5s %10s %10s %10s %10s\n", args->name,
+			"policy", "msg", "work", "wake p50", "wake p99", "wake p99.9", "req p99");
+	for (i = 0; i < n_results; i++) {
+		const stress_schedmix_lat_result_t *result = &results[i];
+		const char *name = stress_get_sched_name(result->policy);
+		const double w50 = (double)stress_latency_percentile(&result->wakeup, 50.0) / 1000.0;
+		const double w99 = (double)stress_latency_percentile(&result->wakeup, 99.0) / 1000.0;
+		const double w999 = (double)stress_latency_percentile(&result->wakeup, 99.9) / 1000.0;
+		const double r99 = (double)stress_latency_percentile(&result->request, 99.0) / 1000.0;
+		char str[64];
+
+		n_skipped += result->skipped;
+		if (result->skipped || (result->requests == 0))
+			continue;
+		if (args->instance == 0)
+			pr_inf("%s: %-8s %4" PRIu32 " %5" PRIu32 " %10.2f %10.2f %10.2f %10.2f\n",
+				args->name, name, n_msgs, result->workers, w50, w99, w999, r99);
+		if (metric + 1 >= STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(str, sizeof(str), "%s W%" PRIu32 " wakeup p99 usec",
+			name, result->workers);
+		stress_metrics_set(args, metric++, str, w99, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s W%" PRIu32 " wakeup p99.9 usec",
+			name, result->workers);
+		stress_metrics_set(args, metric++, str, w999, STRESS_GEOMETRIC_MEAN);
+	}
+	if ((args->instance == 0) && (n_skipped > 0))
+		pr_inf("%s: some scheduling policies could not be set and were skipped\n",
+			args->name);
+	free(results);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 static int stress_schedmix(stress_args_t *args)
 {
 	pid_t pids[MAX_SCHEDMIX_PROCS];
 	size_t i;
 	size_t schedmix_procs = DEFAULT_SCHEDMIX_PROCS;
 	const int parent_cpu = stress_get_cpu();
+	bool schedmix_latency = false;
 
 	if (SIZEOF_ARRAY(policies) == (0)) {
 		if (args->instance == 0) {
@@ -501,6 +866,25 @@ static int stress_schedmix(stress_args_t *args)
 #endif
 
 	(void)stress_get_setting("schedmix-procs", &schedmix_procs);
+	(void)stress_get_setting("schedmix-latency", &schedmix_latency);
+
+	if (schedmix_latency) {
+#if defined(STRESS_SCHEDMIX_LATENCY)
+		int rc = stress_schedmix_latency(args, schedmix_procs);
+#else
+		int rc = EXIT_NOT_IMPLEMENTED;
+
+		pr_inf_skip("%s: schedmix-latency requires pthreads and a monotonic clock, "
+			"skipping stressor\n", args->name);
+#endif
+#if defined(HAVE_SCHEDMIX_SEM)
+		if (schedmix_sem) {
+			(void)sem_destroy(&schedmix_sem->sem);
+			(void)munmap((void *)schedmix_sem, sizeof(*schedmix_sem));
+		}
+#endif
+		return rc;
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
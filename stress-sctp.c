@@ -47,6 +47,17 @@ UNEXPECTED
 
 #define SOCKET_BUF		(8192)	/* Socket I/O buffer size */
 
+#define MIN_SCTP_STREAMS	(1)
+#define MAX_SCTP_STREAMS	(1024)
+#define DEFAULT_SCTP_STREAMS	(1)
+
+#define MIN_SCTP_BATCH		(1)
+#define MAX_SCTP_BATCH		(64)
+
+#define SCTP_SWEEP_MIN_SIZE	(64)	/* Smallest sweep message size */
+#define SCTP_SWEEP_SIZES	(8)	/* 64, 128, .. SOCKET_BUF bytes */
+#define SCTP_SWEEP_MSGS		(64)	/* Messages per size per association */
+
 typedef struct {
 	const int	sched_type;
 	const char 	*name;
@@ -58,7 +69,10 @@ static const stress_help_t help[] = {
 	{ NULL,	"sctp-if I",	 "use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"sctp-ops N",	 "stop after N SCTP bogo operations" },
 	{ NULL,	"sctp-port P",	 "use SCTP ports P to P + number of workers - 1" },
+	{ NULL,	"sctp-batch N",	 "send N messages per sendmmsg call using SCTP_SNDINFO" },
 	{ NULL, "sctp-sched S",	 "specify sctp scheduler" },
+	{ NULL,	"sctp-streams N", "use N outbound streams per association" },
+	{ NULL,	"sctp-sweep",	 "sweep message sizes from 64 to 8192 bytes" },
 	{ NULL,	NULL, 		 NULL }
 };
 
@@ -69,6 +83,18 @@ static const stress_help_t help[] = {
 #define LOCALTIME_STREAM        0
 #endif
 
+#if defined(HAVE_SENDMMSG) &&		\
+    defined(HAVE_SCTP_SNDINFO) &&	\
+    defined(SCTP_SNDINFO)
+#define STRESS_SCTP_BATCH
+#endif
+
+typedef struct {
+	double msgs;		/* messages sent */
+	double bytes;		/* bytes sent */
+	double duration;	/* time spent sending */
+} stress_sctp_stats_t;
+
 static uint64_t	sigpipe_count;
 #else
 UNEXPECTED
@@ -145,11 +171,47 @@ static int stress_set_sctp_if(const char *name)
         return stress_set_setting("sctp-if", TYPE_ID_STR, name);
 }
 
+/*
+ *  stress_set_sctp_streams()
+ *	set number of outbound streams per association
+ */
+static int stress_set_sctp_streams(const char *opt)
+{
+	uint32_t sctp_streams;
+
+	sctp_streams = stress_get_uint32(opt);
+	stress_check_range("sctp-streams", (uint64_t)sctp_streams,
+		MIN_SCTP_STREAMS, MAX_SCTP_STREAMS);
+	return stress_set_setting("sctp-streams", TYPE_ID_UINT32, &sctp_streams);
+}
+
+/*
+ *  stress_set_sctp_batch()
+ *	set number of messages per sendmmsg call
+ */
+static int stress_set_sctp_batch(const char *opt)
+{
+	uint32_t sctp_batch;
+
+	sctp_batch = stress_get_uint32(opt);
+	stress_check_range("sctp-batch", (uint64_t)sctp_batch,
+		MIN_SCTP_BATCH, MAX_SCTP_BATCH);
+	return stress_set_setting("sctp-batch", TYPE_ID_UINT32, &sctp_batch);
+}
+
+static int stress_set_sctp_sweep(const char *opt)
+{
+	return stress_set_setting_true("sctp-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sctp_batch,	stress_set_sctp_batch },
 	{ OPT_sctp_domain,	stress_set_sctp_domain },
 	{ OPT_sctp_if,		stress_set_sctp_if },
 	{ OPT_sctp_port,	stress_set_sctp_port },
 	{ OPT_sctp_sched,	stress_set_sctp_sched },
+	{ OPT_sctp_streams,	stress_set_sctp_streams },
+	{ OPT_sctp_sweep,	stress_set_sctp_sweep },
 	{ 0,			NULL }
 };
 
@@ -382,6 +444,135 @@ static void stress_sctp_sockopts(const int fd)
 #endif
 }
 
+/*
+ *  stress_sctp_initmsg()
+ *	request sctp_streams inbound and outbound streams on
+ *	associations set up by fd
+ */
+static void stress_sctp_initmsg(const int fd, const uint32_t sctp_streams)
+{
+#if defined(SCTP_INITMSG) &&	\
+    defined(HAVE_SCTP_INITMSG)
+	struct sctp_initmsg initmsg;
+
+	if (sctp_streams <= 1)
+		return;
+	(void)shim_memset(&initmsg, 0, sizeof(initmsg));
+	initmsg.sinit_num_ostreams = (uint16_t)sctp_streams;
+	initmsg.sinit_max_instreams = (uint16_t)sctp_streams;
+	(void)setsockopt(fd, IPPROTO_SCTP, SCTP_INITMSG, &initmsg, sizeof(initmsg));
+#else
+	(void)fd;
+	(void)sctp_streams;
+#endif
+}
+
+/*
+ *  stress_sctp_outstreams()
+ *	number of outbound streams negotiated on an association,
+ *	the peer may grant fewer than were asked for
+ */
+static uint16_t stress_sctp_outstreams(const int fd, const uint32_t sctp_streams)
+{
+#if defined(SCTP_STATUS) &&	\
+    defined(HAVE_SCTP_STATUS)
+	struct sctp_status status;
+	socklen_t len = sizeof(status);
+
+	(void)shim_memset(&status, 0, sizeof(status));
+	if ((getsockopt(fd, IPPROTO_SCTP, SCTP_STATUS, &status, &len) == 0) &&
+	    (status.sstat_outstrms > 0) &&
+	    (status.sstat_outstrms < sctp_streams))
+		return status.sstat_outstrms;
+#else
+	(void)fd;
+#endif
+	return (uint16_t)sctp_streams;
+}
+
+/*
+ *  stress_sctp_send()
+ *	send count messages of size bytes, round-robin across
+ *	nstreams streams, either one sctp_sendmsg call per message
+ *	or sctp_batch messages per sendmmsg call with a SCTP_SNDINFO
+ *	control message selecting the stream. Returns messages sent
+ */
+static size_t OPTIMIZE3 stress_sctp_send(
+	const int fd,
+	char *buf,
+	const size_t size,
+	const size_t count,
+	uint16_t *stream,
+	const uint16_t nstreams,
+	const uint32_t sctp_batch)
+{
+	size_t sent = 0;
+
+#if defined(STRESS_SCTP_BATCH)
+	if (sctp_batch > 0) {
+		struct mmsghdr msgs[MAX_SCTP_BATCH];
+		union {
+			char buf[CMSG_SPACE(sizeof(struct sctp_sndinfo))];
+			struct cmsghdr align;
+		} cmsgs[MAX_SCTP_BATCH];
+		struct iovec iov;
+
+		iov.iov_base = buf;
+		iov.iov_len = size;
+
+		while (sent < count) {
+			const size_t n = STRESS_MINIMUM(count - sent, (size_t)sctp_batch);
+			size_t i;
+			int ret;
+
+			for (i = 0; i < n; i++) {
+				struct msghdr *msg = &msgs[i].msg_hdr;
+				struct cmsghdr *cmsg;
+				struct sctp_sndinfo *sndinfo;
+
+				(void)shim_memset(msg, 0, sizeof(*msg));
+				(void)shim_memset(cmsgs[i].buf, 0, sizeof(cmsgs[i].buf));
+				msg->msg_iov = &iov;
+				msg->msg_iovlen = 1;
+				msg->msg_control = cmsgs[i].buf;
+				msg->msg_controllen = sizeof(cmsgs[i].buf);
+				msgs[i].msg_len = 0;
+
+				cmsg = CMSG_FIRSTHDR(msg);
+				cmsg->cmsg_level = IPPROTO_SCTP;
+				cmsg->cmsg_type = SCTP_SNDINFO;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(*sndinfo));
+				sndinfo = (struct sctp_sndinfo *)CMSG_DATA(cmsg);
+				sndinfo->snd_sid = *stream;
+
+				(*stream)++;
+				if (*stream >= nstreams)
+					*stream = 0;
+			}
+			ret = sendmmsg(fd, msgs, (unsigned int)n, 0);
+			if (UNLIKELY(ret <= 0))
+				break;
+			sent += (size_t)ret;
+			if ((size_t)ret < n)
+				break;
+		}
+		return sent;
+	}
+#else
+	(void)sctp_batch;
+#endif
+	while (sent < count) {
+		if (UNLIKELY(sctp_sendmsg(fd, buf, size, NULL, 0, 0, 0,
+					  *stream, 0, 0) < 0))
+			break;
+		sent++;
+		(*stream)++;
+		if (*stream >= nstreams)
+			*stream = 0;
+	}
+	return sent;
+}
+
 /*
  *  stress_sctp_client()
  *	client reader
@@ -392,7 +583,8 @@ static int OPTIMIZE3 stress_sctp_client(
 	const int sctp_port,
 	const int sctp_domain,
 	const int sctp_sched,
-	const char *sctp_if)
+	const char *sctp_if,
+	const uint32_t sctp_streams)
 {
 	struct sockaddr *addr;
 	int rc = EXIT_SUCCESS;
@@ -432,6 +624,7 @@ retry:
 			(void)close(fd);
 			return EXIT_FAILURE;
 		}
+		stress_sctp_initmsg(fd, sctp_streams);
 		if (UNLIKELY(connect(fd, addr, addr_len) < 0)) {
 			const int save_errno = errno;
 
@@ -518,9 +711,17 @@ static int OPTIMIZE3 stress_sctp_server(
 	const int sctp_port,
 	const int sctp_domain,
 	const int sctp_sched,
-	const char *sctp_if)
+	const char *sctp_if,
+	const uint32_t sctp_streams,
+	const uint32_t sctp_batch,
+	const bool sctp_sweep)
 {
 	char ALIGN64 buf[SOCKET_BUF];
+	char str[64];
+	stress_sctp_stats_t total, sweep[SCTP_SWEEP_SIZES];
+	uint16_t stream = LOCALTIME_STREAM;
+	double rate;
+	size_t j;
 	int fd;
 	int so_reuseaddr = 1;
 	socklen_t addr_len = 0;
@@ -530,6 +731,9 @@ static int OPTIMIZE3 stress_sctp_server(
 
 	(void)sctp_sched;
 
+	(void)shim_memset(&total, 0, sizeof(total));
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+
 	if (stress_sig_stop_stressing(args->name, SIGALRM)) {
 		rc = EXIT_FAILURE;
 		goto die;
@@ -566,6 +770,7 @@ static int OPTIMIZE3 stress_sctp_server(
 			args->name, errno, strerror(errno));
 		goto die_close;
 	}
+	stress_sctp_initmsg(fd, sctp_streams);
 	if (listen(fd, 10) < 0) {
 		pr_fail("%s: listen failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
@@ -609,24 +814,77 @@ static int OPTIMIZE3 stress_sctp_server(
 		if (LIKELY(sfd >= 0)) {
 			size_t i;
 			const int c = stress_ascii32[index++ & 0x1f];
+			const uint16_t nstreams = stress_sctp_outstreams(sfd, sctp_streams);
 			pid_t *pidptr = (pid_t *)buf;
 
 			(void)shim_memset(buf, c, sizeof(buf));
 			*pidptr = mypid;
-			for (i = 16; i < sizeof(buf); i += 16) {
-				ssize_t ret = sctp_sendmsg(sfd, buf, i,
-						NULL, 0, 0, 0,
-						LOCALTIME_STREAM, 0, 0);
-				if (UNLIKELY(ret < 0))
-					break;
-
-				stress_bogo_inc(args);
+			if (stream >= nstreams)
+				stream = 0;
+
+			if (sctp_sweep) {
+				for (j = 0; j < SCTP_SWEEP_SIZES; j++) {
+					const size_t size = SCTP_SWEEP_MIN_SIZE << j;
+					double t;
+					size_t n;
+
+					t = stress_time_now();
+					n = stress_sctp_send(sfd, buf, size, SCTP_SWEEP_MSGS,
+							     &stream, nstreams, sctp_batch);
+					sweep[j].duration += stress_time_now() - t;
+					sweep[j].msgs += (double)n;
+					sweep[j].bytes += (double)(n * size);
+					stress_bogo_add(args, (uint64_t)n);
+					if (UNLIKELY(n < SCTP_SWEEP_MSGS))
+						break;
+				}
+			} else {
+				const size_t count = sctp_batch ? (size_t)sctp_batch : 1;
+				const double t = stress_time_now();
+
+				for (i = 16; i < sizeof(buf); i += 16) {
+					const size_t n = stress_sctp_send(sfd, buf, i, count,
+							     &stream, nstreams, sctp_batch);
+
+					total.msgs += (double)n;
+					total.bytes += (double)(n * i);
+					stress_bogo_add(args, (uint64_t)n);
+					if (UNLIKELY(n < count))
+						break;
+				}
+				total.duration += stress_time_now() - t;
 			}
 			stress_sctp_sockopts(sfd);
 			(void)close(sfd);
 		}
 	} while (stress_continue(args));
 
+	for (j = 0; j < SCTP_SWEEP_SIZES; j++) {
+		total.msgs += sweep[j].msgs;
+		total.bytes += sweep[j].bytes;
+		total.duration += sweep[j].duration;
+	}
+	rate = (total.duration > 0.0) ? total.msgs / total.duration : 0.0;
+	(void)snprintf(str, sizeof(str), "msgs per sec (%" PRIu32 " streams)", sctp_streams);
+	stress_metrics_set(args, 0, str, rate, STRESS_HARMONIC_MEAN);
+	rate = (total.duration > 0.0) ? total.bytes / total.duration : 0.0;
+	(void)snprintf(str, sizeof(str), "MB per sec (%" PRIu32 " streams)", sctp_streams);
+	stress_metrics_set(args, 1, str, rate / (double)MB, STRESS_HARMONIC_MEAN);
+
+	if (sctp_sweep) {
+		for (j = 0; j < SCTP_SWEEP_SIZES; j++) {
+			const size_t size = SCTP_SWEEP_MIN_SIZE << j;
+			const double duration = sweep[j].duration;
+
+			rate = (duration > 0.0) ? sweep[j].msgs / duration : 0.0;
+			(void)snprintf(str, sizeof(str), "msgs per sec for %zu byte msgs", size);
+			stress_metrics_set(args, 2 + (2 * j), str, rate, STRESS_HARMONIC_MEAN);
+			rate = (duration > 0.0) ? sweep[j].bytes / duration : 0.0;
+			(void)snprintf(str, sizeof(str), "MB per sec for %zu byte msgs", size);
+			stress_metrics_set(args, 3 + (2 * j), str, rate / (double)MB, STRESS_HARMONIC_MEAN);
+		}
+	}
+
 die_close:
 	(void)close(fd);
 die:
@@ -662,6 +920,9 @@ static int stress_sctp(stress_args_t *args)
 	int sctp_sched = -1;	/* Undefined */
 	int ret, reserved_port, parent_cpu;
 	char *sctp_if = NULL;
+	uint32_t sctp_streams = DEFAULT_SCTP_STREAMS;
+	uint32_t sctp_batch = 0;
+	bool sctp_sweep = false;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -670,6 +931,15 @@ static int stress_sctp(stress_args_t *args)
 	(void)stress_get_setting("sctp-if", &sctp_if);
 	(void)stress_get_setting("sctp-port", &sctp_port);
 	(void)stress_get_setting("sctp-sched", &sctp_sched);
+	(void)stress_get_setting("sctp-streams", &sctp_streams);
+	(void)stress_get_setting("sctp-batch", &sctp_batch);
+	(void)stress_get_setting("sctp-sweep", &sctp_sweep);
+
+#if !defined(STRESS_SCTP_BATCH)
+	if ((sctp_batch > 0) && (args->instance == 0))
+		pr_inf("%s: sendmmsg or SCTP_SNDINFO not available, ignoring --sctp-batch\n",
+			args->name);
+#endif
 
 	if (sctp_if) {
 		struct sockaddr if_addr;
@@ -712,12 +982,15 @@ again:
 		return EXIT_FAILURE;
 	} else if (pid == 0) {
 		 (void)stress_change_cpu(args, parent_cpu);
-		ret = stress_sctp_client(args, mypid, sctp_port, sctp_domain, sctp_sched, sctp_if);
+		ret = stress_sctp_client(args, mypid, sctp_port, sctp_domain,
+					 sctp_sched, sctp_if, sctp_streams);
 		_exit(ret);
 	} else {
 		int status;
 
-		ret = stress_sctp_server(args, mypid, sctp_port, sctp_domain, sctp_sched, sctp_if);
+		ret = stress_sctp_server(args, mypid, sctp_port, sctp_domain,
+					 sctp_sched, sctp_if, sctp_streams,
+					 sctp_batch, sctp_sweep);
 		(void)stress_kill_pid_wait(pid, &status);
 		if (WIFEXITED(status)) {
 			if (WEXITSTATUS(status) != EXIT_SUCCESS) {
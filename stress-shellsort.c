@@ -26,6 +26,7 @@
 
 static volatile bool do_jmp = true;
 static sigjmp_buf jmp_env;
+static stress_sort_dist_stats_t dist_stats[STRESS_SORT_DIST_MAX];
 
 static const stress_help_t help[] = {
 	{ NULL,	"shellsort N",	   "start N workers shell sorting 32 bit random integers" },
@@ -137,16 +138,19 @@ static int OPTIMIZE3 stress_shellsort(stress_args_t *args)
 
 	do {
 		double t;
+		size_t dist;
 
-		stress_sort_data_int32_shuffle(data, n);
+		dist = stress_sort_data_int32_dist(data, n, stress_bogo_get(args));
 
 		/* Sort "random" data */
 		stress_sort_compare_reset();
 		t = stress_time_now();
 		shellsort32(data, n, stress_sort_cmp_fwd_int32);
-		duration += stress_time_now() - t;
+		t = stress_time_now() - t;
+		duration += t;
 		count += (double)stress_sort_compare_get();
 		sorted += (double)n;
+		stress_sort_dist_stats_add(dist_stats, dist, (double)stress_sort_compare_get(), n, t);
 
 		if (UNLIKELY(verify)) {
 			register size_t i;
@@ -225,6 +229,7 @@ tidy:
 		rate, STRESS_HARMONIC_MEAN);
 	stress_metrics_set(args, 1, "shellsort comparisons per item",
 		count / sorted, STRESS_HARMONIC_MEAN);
+	stress_sort_dist_metrics(args, 4, "shellsort", dist_stats, true);
 
 	free(data);
 
@@ -18,8 +18,11 @@
  *
  */
 #include "stress-ng.h"
+#include "core-asm-arm.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-out-of-memory.h"
@@ -34,6 +37,10 @@
 
 #define SHM_NAME_LEN		(128)
 
+#define MIN_SHM_RING_PRODUCERS	(1)
+#define MAX_SHM_RING_PRODUCERS	(16)
+#define DEFAULT_SHM_RING_PRODUCERS (1)
+
 typedef struct {
 	ssize_t	index;
 	char	shm_name[SHM_NAME_LEN];
@@ -45,6 +52,8 @@ static const stress_help_t help[] = {
 	{ NULL,	"shm-mlock",	"attempt to mlock pages into memory" },
 	{ NULL,	"shm-objs N",	"allocate N POSIX shared memory objects per iteration" },
 	{ NULL,	"shm-ops N",	"stop after N POSIX shared memory bogo operations" },
+	{ NULL,	"shm-ring",	"exchange messages through a lock-free ring in shared memory" },
+	{ NULL,	"shm-ring-producers N", "number of shm-ring producers, 1 = SPSC, more = MPSC" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -73,10 +82,27 @@ static int stress_set_shm_posix_objects(const char *opt)
 	return stress_set_setting("shm-objs", TYPE_ID_SIZE_T, &shm_posix_objects);
 }
 
+static int stress_set_shm_ring(const char *opt)
+{
+	return stress_set_setting_true("shm-ring", opt);
+}
+
+static int stress_set_shm_ring_producers(const char *opt)
+{
+	uint32_t shm_ring_producers;
+
+	shm_ring_producers = stress_get_uint32(opt);
+	stress_check_range("shm-ring-producers", (uint64_t)shm_ring_producers,
+		MIN_SHM_RING_PRODUCERS, MAX_SHM_RING_PRODUCERS);
+	return stress_set_setting("shm-ring-producers", TYPE_ID_UINT32, &shm_ring_producers);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_shm_bytes,	stress_set_shm_posix_bytes },
 	{ OPT_shm_mlock,	stress_set_shm_mlock },
 	{ OPT_shm_objects,	stress_set_shm_posix_objects },
+	{ OPT_shm_ring,		stress_set_shm_ring },
+	{ OPT_shm_ring_producers, stress_set_shm_ring_producers },
 	{ 0,			NULL }
 };
 
@@ -360,6 +386,512 @@ reap:
 	return rc;
 }
 
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_FETCH_ADD) &&		\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define STRESS_SHM_RING
+
+#define SHM_RING_SLOTS		(256)		/* ring slots, a power of 2 */
+#define SHM_RING_MSG_MAX	(4096)		/* largest message size */
+#define SHM_RING_WAIT_NS	(10000000)	/* futex wait timeout, 10ms */
+
+typedef enum {
+	SHM_RING_WAIT_POLL,		/* busy poll, yield now and again */
+	SHM_RING_WAIT_FUTEX,		/* sleep on a futex when empty or full */
+	SHM_RING_WAIT_MAX,
+} stress_shm_ring_wait_t;
+
+static const char * const shm_ring_waits[] = {
+	"poll",
+	"futex",
+};
+
+static const size_t shm_ring_msg_sizes[] = {
+	64, 256, 1024, SHM_RING_MSG_MAX,
+};
+
+/* a ring slot, the message follows the 64 byte header */
+typedef struct {
+	uint64_t seq;			/* MPSC slot sequence number */
+	uint64_t sent_ns;		/* producer send timestamp */
+	uint64_t msg_seq;		/* per producer message number */
+	uint32_t producer;		/* producer number */
+	uint32_t len;			/* message length */
+	uint8_t pad[32];
+	uint8_t data[SHM_RING_MSG_MAX];	/* message */
+} stress_shm_ring_slot_t;
+
+/* the ring, mapped from a POSIX shared memory object */
+typedef struct {
+	uint64_t head ALIGN64;		/* next slot to enqueue */
+	uint64_t tail ALIGN64;		/* next slot to dequeue */
+	uint32_t data_futex ALIGN64;	/* bumped when a message is sent */
+	uint32_t consumer_waiting;	/* consumer sleeping on data_futex */
+	uint32_t space_futex ALIGN64;	/* bumped when a message is received */
+	uint32_t producers_waiting;	/* producers sleeping on space_futex */
+	uint32_t stop ALIGN64;		/* producers should exit */
+	stress_shm_ring_slot_t slots[SHM_RING_SLOTS] ALIGN64;
+} stress_shm_ring_t;
+
+/* throughput and latency of a wait variant and message size */
+typedef struct {
+	uint64_t msgs;			/* messages received */
+	double duration;		/* time receiving */
+	stress_latency_t latency;	/* send to receive latency */
+} stress_shm_ring_result_t;
+
+/*
+ *  stress_shm_ring_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t ALWAYS_INLINE stress_shm_ring_now_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_shm_ring_relax()
+ *	spin wait hint, yield now and again so a preempted
+ *	process can make progress when processes outnumber CPUs
+ */
+static inline void ALWAYS_INLINE stress_shm_ring_relax(uint32_t *spins)
+{
+#if defined(HAVE_ASM_X86_PAUSE)
+	stress_asm_x86_pause();
+#elif defined(HAVE_ASM_ARM_YIELD)
+	stress_asm_arm_yield();
+#endif
+	if (UNLIKELY((++(*spins) & 63) == 0))
+		(void)shim_sched_yield();
+}
+
+/*
+ *  stress_shm_ring_sleep()
+ *	sleep on a futex word until it changes, waiting is the count
+ *	of sleepers the waker checks after making its change, the
+ *	caller re-checks the ring after announcing itself as waiting
+ */
+static void stress_shm_ring_sleep(
+	uint32_t *futex,
+	uint32_t *waiting,
+	const uint32_t val)
+{
+	struct timespec ts;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = SHM_RING_WAIT_NS;
+	(void)shim_futex_wait(futex, (int)val, &ts);
+	(void)__atomic_fetch_sub(waiting, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ *  stress_shm_ring_wake()
+ *	wake sleepers on a futex word if there are any
+ */
+static inline void ALWAYS_INLINE stress_shm_ring_wake(
+	uint32_t *futex,
+	uint32_t *waiting,
+	const int n)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(waiting, __ATOMIC_RELAXED)) {
+		(void)__atomic_fetch_add(futex, 1, __ATOMIC_SEQ_CST);
+		(void)shim_futex_wake(futex, n);
+	}
+}
+
+/*
+ *  stress_shm_ring_claim()
+ *	claim the next free slot, single producers own the head,
+ *	multiple producers claim slots with a compare and swap on
+ *	the head and the slot sequence numbers, NULL if full
+ */
+static inline stress_shm_ring_slot_t * ALWAYS_INLINE stress_shm_ring_claim(
+	stress_shm_ring_t *ring,
+	const bool spsc,
+	uint64_t *pos)
+{
+	stress_shm_ring_slot_t *slot;
+	uint64_t head;
+
+	if (spsc) {
+		head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= SHM_RING_SLOTS)
+			return NULL;
+		*pos = head;
+		return &ring->slots[head & (SHM_RING_SLOTS - 1)];
+	}
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	for (;;) {
+		int64_t diff;
+
+		slot = &ring->slots[head & (SHM_RING_SLOTS - 1)];
+		diff = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - head);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&ring->head, &head, head + 1,
+					true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			return NULL;
+		} else {
+			head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		}
+	}
+	*pos = head;
+	return slot;
+}
+
+/*
+ *  stress_shm_ring_publish()
+ *	make a claimed and filled in slot visible to the consumer
+ */
+static inline void ALWAYS_INLINE stress_shm_ring_publish(
+	stress_shm_ring_t *ring,
+	stress_shm_ring_slot_t *slot,
+	const bool spsc,
+	const uint64_t pos)
+{
+	if (spsc)
+		__atomic_store_n(&ring->head, pos + 1, __ATOMIC_RELEASE);
+	else
+		__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ *  stress_shm_ring_peek()
+ *	the oldest message, NULL if the ring is empty
+ */
+static inline stress_shm_ring_slot_t * ALWAYS_INLINE stress_shm_ring_peek(
+	stress_shm_ring_t *ring,
+	const bool spsc)
+{
+	const uint64_t tail = ring->tail;
+	stress_shm_ring_slot_t *slot = &ring->slots[tail & (SHM_RING_SLOTS - 1)];
+
+	if (spsc) {
+		if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+			return NULL;
+	} else {
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != tail + 1)
+			return NULL;
+	}
+	return slot;
+}
+
+/*
+ *  stress_shm_ring_release()
+ *	hand the slot of the message just received back to the producers
+ */
+static inline void ALWAYS_INLINE stress_shm_ring_release(
+	stress_shm_ring_t *ring,
+	stress_shm_ring_slot_t *slot,
+	const bool spsc)
+{
+	const uint64_t tail = ring->tail;
+
+	if (!spsc)
+		__atomic_store_n(&slot->seq, tail + SHM_RING_SLOTS, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ *  stress_shm_ring_producer()
+ *	send timestamped messages of len bytes until told to stop
+ */
+static void NORETURN stress_shm_ring_producer(
+	stress_shm_ring_t *ring,
+	const uint32_t producer,
+	const bool spsc,
+	const stress_shm_ring_wait_t wait,
+	const size_t len)
+{
+	uint64_t msg_seq = 0;
+	uint32_t spins = 0;
+
+	stress_parent_died_alarm();
+
+	while (!__atomic_load_n(&ring->stop, __ATOMIC_RELAXED) && stress_continue_flag()) {
+		stress_shm_ring_slot_t *slot;
+		uint64_t pos;
+
+		slot = stress_shm_ring_claim(ring, spsc, &pos);
+		if (!slot) {
+			if (wait == SHM_RING_WAIT_FUTEX) {
+				const uint32_t val = __atomic_load_n(&ring->space_futex, __ATOMIC_ACQUIRE);
+
+				(void)__atomic_fetch_add(&ring->producers_waiting, 1, __ATOMIC_SEQ_CST);
+				slot = stress_shm_ring_claim(ring, spsc, &pos);
+				if (!slot) {
+					stress_shm_ring_sleep(&ring->space_futex, &ring->producers_waiting, val);
+					continue;
+				}
+				(void)__atomic_fetch_sub(&ring->producers_waiting, 1, __ATOMIC_SEQ_CST);
+			} else {
+				stress_shm_ring_relax(&spins);
+				continue;
+			}
+		}
+		slot->producer = producer;
+		slot->msg_seq = msg_seq;
+		slot->len = (uint32_t)len;
+		(void)shim_memset(slot->data, (int)((producer + msg_seq) & 0xff), len);
+		slot->sent_ns = stress_shm_ring_now_ns();
+		stress_shm_ring_publish(ring, slot, spsc, pos);
+		msg_seq++;
+		if (wait == SHM_RING_WAIT_FUTEX)
+			stress_shm_ring_wake(&ring->data_futex, &ring->consumer_waiting, 1);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_shm_ring_round()
+ *	fork the producers and receive their messages for
+ *	duration seconds, returns -1 on a verification failure
+ */
+static int stress_shm_ring_round(
+	stress_args_t *args,
+	stress_shm_ring_t *ring,
+	const uint32_t producers,
+	const stress_shm_ring_wait_t wait,
+	const size_t len,
+	const double duration,
+	stress_shm_ring_result_t *result)
+{
+	const bool spsc = (producers == 1);
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	pid_t pids[MAX_SHM_RING_PRODUCERS];
+	uint64_t expected[MAX_SHM_RING_PRODUCERS];
+	uint64_t now, t_start, t_end, msgs = 0;
+	uint32_t i, spins = 0;
+	size_t n_pids = 0;
+	int rc = 0;
+
+	(void)shim_memset(ring, 0, offsetof(stress_shm_ring_t, slots));
+	for (i = 0; i < SHM_RING_SLOTS; i++)
+		ring->slots[i].seq = i;
+	(void)shim_memset(expected, 0, sizeof(expected));
+
+	for (i = 0; i < producers; i++) {
+		pid_t pid;
+again:
+		pid = fork();
+		if (pid < 0) {
+			if (stress_redo_fork(args, errno))
+				goto again;
+			if (!stress_continue(args))
+				goto reap;
+			pr_fail("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = -1;
+			goto reap;
+		} else if (pid == 0) {
+			stress_shm_ring_producer(ring, i, spsc, wait, len);
+		}
+		pids[n_pids++] = pid;
+	}
+
+	t_start = stress_shm_ring_now_ns();
+	t_end = t_start + (uint64_t)(duration * STRESS_DBL_NANOSECOND);
+	now = t_start;
+	while ((now < t_end) && stress_continue_flag()) {
+		stress_shm_ring_slot_t *slot = stress_shm_ring_peek(ring, spsc);
+
+		if (!slot) {
+			if (wait == SHM_RING_WAIT_FUTEX) {
+				const uint32_t val = __atomic_load_n(&ring->data_futex, __ATOMIC_ACQUIRE);
+
+				(void)__atomic_fetch_add(&ring->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+				slot = stress_shm_ring_peek(ring, spsc);
+				if (!slot) {
+					stress_shm_ring_sleep(&ring->data_futex, &ring->consumer_waiting, val);
+					now = stress_shm_ring_now_ns();
+					continue;
+				}
+				(void)__atomic_fetch_sub(&ring->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+			} else {
+				stress_shm_ring_relax(&spins);
+				now = stress_shm_ring_now_ns();
+				continue;
+			}
+		}
+		now = stress_shm_ring_now_ns();
+		stress_latency_add(&result->latency, now - slot->sent_ns);
+
+		if (UNLIKELY(verify)) {
+			const uint32_t producer = slot->producer;
+			const uint8_t val = (uint8_t)((producer + slot->msg_seq) & 0xff);
+
+			if ((producer >= producers) || (slot->len != len) ||
+			    (slot->msg_seq != expected[producer]) ||
+			    (slot->data[0] != val) || (slot->data[len - 1] != val)) {
+				pr_fail("%s: unexpected message from producer %" PRIu32
+					", message %" PRIu64 ", expected message %" PRIu64 "\n",
+					args->name, producer, slot->msg_seq,
+					(producer < producers) ? expected[producer] : 0);
+				rc = -1;
+				break;
+			}
+			expected[producer]++;
+		}
+		stress_shm_ring_release(ring, slot, spsc);
+		msgs++;
+		if (wait == SHM_RING_WAIT_FUTEX)
+			stress_shm_ring_wake(&ring->space_futex, &ring->producers_waiting, INT_MAX);
+	}
+	result->duration += (double)(now - t_start) / STRESS_DBL_NANOSECOND;
+	result->msgs += msgs;
+	stress_bogo_add(args, msgs);
+
+reap:
+	__atomic_store_n(&ring->stop, 1, __ATOMIC_RELEASE);
+	(void)__atomic_fetch_add(&ring->space_futex, 1, __ATOMIC_SEQ_CST);
+	(void)shim_futex_wake(&ring->space_futex, INT_MAX);
+	(void)stress_kill_and_wait_many(args, pids, n_pids, SIGKILL, false);
+
+	return rc;
+}
+
+/*
+ *  stress_shm_ring()
+ *	exchange messages between producer processes and the
+ *	consumer through a lock-free ring in a POSIX shared memory
+ *	object, with single producer (SPSC) or multiple producer
+ *	(MPSC) slot claiming, busy polling or futex waits and a
+ *	range of message sizes, reporting the message rate and the
+ *	send to receive latency percentiles of each
+ */
+static int stress_shm_ring(stress_args_t *args)
+{
+	stress_shm_ring_t *ring;
+	stress_shm_ring_result_t *results;
+	const size_t n_sizes = SIZEOF_ARRAY(shm_ring_msg_sizes);
+	const size_t n_results = SHM_RING_WAIT_MAX * n_sizes;
+	const size_t results_sz = n_results * sizeof(*results);
+	uint32_t producers = DEFAULT_SHM_RING_PRODUCERS;
+	char shm_name[SHM_NAME_LEN];
+	size_t i, j;
+	int fd, metric = 0, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("shm-ring-producers", &producers);
+
+	(void)snprintf(shm_name, sizeof(shm_name), "/stress-ng-%d-%" PRIu32 "-ring",
+		(int)args->pid, args->instance);
+	fd = shm_open(shm_name, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_inf_skip("%s: shm_open %s failed, errno=%d (%s), skipping stressor\n",
+			args->name, shm_name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	if (ftruncate(fd, (off_t)sizeof(*ring)) < 0) {
+		pr_inf_skip("%s: ftruncate of %s to %zu bytes failed, errno=%d (%s), "
+			"skipping stressor\n", args->name, shm_name, sizeof(*ring),
+			errno, strerror(errno));
+		(void)close(fd);
+		(void)shm_unlink(shm_name);
+		return EXIT_NO_RESOURCE;
+	}
+	ring = (stress_shm_ring_t *)mmap(NULL, sizeof(*ring), PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	(void)close(fd);
+	/* the producers are forked with the ring already mapped */
+	(void)shm_unlink(shm_name);
+	if (ring == MAP_FAILED) {
+		pr_inf_skip("%s: mmap of %zu bytes failed, errno=%d (%s), skipping stressor\n",
+			args->name, sizeof(*ring), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	results = (stress_shm_ring_result_t *)mmap(NULL, results_sz, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (results == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for results, errno=%d (%s), "
+			"skipping stressor\n", args->name, results_sz, errno, strerror(errno));
+		(void)munmap((void *)ring, sizeof(*ring));
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(results, 0, results_sz);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		const double t_left = args->time_end - stress_time_now();
+		double slice = t_left / (double)n_results;
+
+		slice = STRESS_MINIMUM(slice, 1.0);
+		slice = STRESS_MAXIMUM(slice, 0.05);
+
+		for (i = 0; i < SHM_RING_WAIT_MAX; i++) {
+			for (j = 0; j < n_sizes; j++) {
+				if (stress_shm_ring_round(args, ring, producers,
+						(stress_shm_ring_wait_t)i, shm_ring_msg_sizes[j],
+						slice, &results[(i * n_sizes) + j]) < 0) {
+					rc = EXIT_FAILURE;
+					goto report;
+				}
+				if (!stress_continue(args))
+					goto report;
+			}
+		}
+	} while (stress_continue(args));
+
+report:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %s ring, %" PRIu32 " producer%s, latency in microseconds:\n",
+			args->name, (producers == 1) ? "SPSC" : "MPSC", producers,
+			(producers == 1) ? "" : "s");
+		pr_inf("%s: %-6s %6s %12s %10s %8s %8s %8s %8s\n", args->name,
+			"wait", "size", "msgs/sec", "MB/sec", "P50", "P90", "P99", "max");
+	}
+	for (i = 0; i < SHM_RING_WAIT_MAX; i++) {
+		for (j = 0; j < n_sizes; j++) {
+			const stress_shm_ring_result_t *result = &results[(i * n_sizes) + j];
+			const stress_latency_t *latency = &result->latency;
+			double rate, p50, p99;
+			char str[64];
+
+			if ((result->msgs == 0) || (result->duration <= 0.0))
+				continue;
+			rate = (double)result->msgs / result->duration;
+			p50 = (double)stress_latency_percentile(latency, 50.0) / 1000.0;
+			p99 = (double)stress_latency_percentile(latency, 99.0) / 1000.0;
+			if (args->instance == 0) {
+				pr_inf("%s: %-6s %6zu %12.0f %10.2f %8.2f %8.2f %8.2f %8.2f\n",
+					args->name, shm_ring_waits[i], shm_ring_msg_sizes[j], rate,
+					rate * (double)shm_ring_msg_sizes[j] / (double)MB, p50,
+					(double)stress_latency_percentile(latency, 90.0) / 1000.0,
+					p99, (double)latency->max / 1000.0);
+			}
+			(void)snprintf(str, sizeof(str), "%s %zu byte msgs per sec",
+				shm_ring_waits[i], shm_ring_msg_sizes[j]);
+			stress_metrics_set(args, metric++, str, rate, STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s %zu byte P50 latency usecs",
+				shm_ring_waits[i], shm_ring_msg_sizes[j]);
+			stress_metrics_set(args, metric++, str, p50, STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s %zu byte P99 latency usecs",
+				shm_ring_waits[i], shm_ring_msg_sizes[j]);
+			stress_metrics_set(args, metric++, str, p99, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+	(void)munmap((void *)results, results_sz);
+	(void)munmap((void *)ring, sizeof(*ring));
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_shm()
  *	stress POSIX shared memory
@@ -377,8 +909,10 @@ static int stress_shm(stress_args_t *args)
 	uint32_t restarts = 0;
 	size_t shm_posix_bytes = DEFAULT_SHM_POSIX_BYTES;
 	size_t shm_posix_objects = DEFAULT_SHM_POSIX_OBJECTS;
+	bool shm_ring = false;
 
 	(void)stress_get_setting("shm-mlock", &shm_mlock);
+	(void)stress_get_setting("shm-ring", &shm_ring);
 
 	if (!stress_get_setting("shm-bytes", &shm_posix_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -411,6 +945,16 @@ static int stress_shm(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 #endif
+	if (shm_ring) {
+#if defined(STRESS_SHM_RING)
+		return stress_shm_ring(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: shm-ring needs atomic compare and exchange, "
+				"skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	while (stress_continue_flag() && retry) {
@@ -21,13 +21,35 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
+
+#include <sched.h>
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#if defined(HAVE_SYS_SIGNALFD_H)
+#include <sys/signalfd.h>
+#endif
 
 static const stress_help_t help[] = {
 	{ NULL,	"sigq N",	"start N workers sending sigqueue signals" },
+	{ NULL,	"sigq-latency",	"measure handler, signalfd and sigwaitinfo delivery latency" },
 	{ NULL,	"sigq-ops N",	"stop after N sigqueue bogo operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+static int stress_set_sigq_latency(const char *opt)
+{
+	return stress_set_setting_true("sigq-latency", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sigq_latency,	stress_set_sigq_latency },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_SIGQUEUE) && \
     defined(HAVE_SIGWAITINFO) && \
     defined(SA_SIGINFO)
@@ -52,6 +74,341 @@ static void MLOCKED_TEXT stress_sigq_chld_handler(int sig)
 	}
 }
 
+#if defined(HAVE_SYS_SIGNALFD_H) &&	\
+    defined(HAVE_SIGNALFD) &&		\
+    defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE1)
+#define STRESS_SIGQ_LAT_SIGNALFD_EPOLL
+#endif
+
+#define STRESS_SIGQ_LAT_HANDLER		(0)	/* SA_SIGINFO async handler */
+#define STRESS_SIGQ_LAT_SIGNALFD	(1)	/* signalfd read after epoll_wait */
+#define STRESS_SIGQ_LAT_SIGWAITINFO	(2)	/* sigwaitinfo */
+#define STRESS_SIGQ_LAT_MECH_MAX	(3)
+#define STRESS_SIGQ_LAT_PLACEMENTS	(2)	/* same and different CPUs */
+
+static const char * const sigq_lat_mechs[STRESS_SIGQ_LAT_MECH_MAX] = {
+	"handler",
+	"signalfd",
+	"sigwaitinfo",
+};
+
+static const char * const sigq_lat_placements[STRESS_SIGQ_LAT_PLACEMENTS] = {
+	"same-cpu",
+	"other-cpu",
+};
+
+/* delivery latencies, shared with the receiver child */
+typedef struct {
+	volatile bool stop;		/* receiver should exit */
+	stress_latency_t latency[STRESS_SIGQ_LAT_PLACEMENTS][STRESS_SIGQ_LAT_MECH_MAX];
+} stress_sigq_lat_t;
+
+static stress_latency_t *sigq_lat_handler_latency;
+
+/*
+ *  stress_sigq_lat_ns()
+ *	CLOCK_MONOTONIC time in nanoseconds, as a uintptr_t to be
+ *	sent as a sigqueue pointer payload, this is truncated to 32
+ *	bits on 32 bit systems which is more than enough for deltas
+ */
+static inline uintptr_t stress_sigq_lat_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uintptr_t)(((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec);
+}
+
+static void MLOCKED_TEXT stress_sigq_lat_handler(
+	int sig,
+	siginfo_t *info,
+	void *ucontext)
+{
+	const uintptr_t now = stress_sigq_lat_ns();
+
+	(void)sig;
+	(void)ucontext;
+
+	stress_latency_add(sigq_lat_handler_latency,
+		(uint64_t)(now - (uintptr_t)info->si_value.sival_ptr));
+}
+
+/*
+ *  stress_sigq_lat_set_cpu()
+ *	pin the calling process to a CPU
+ */
+static void stress_sigq_lat_set_cpu(const int cpu)
+{
+#if defined(HAVE_SCHED_SETAFFINITY)
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	VOID_RET(int, sched_setaffinity(0, sizeof(mask), &mask));
+#else
+	(void)cpu;
+#endif
+}
+
+/*
+ *  stress_sigq_lat_receiver()
+ *	receive SIGUSR1 signals using one delivery mechanism, record
+ *	the latency from the sender timestamp payload and write an
+ *	ack so that only one signal is in flight at a time
+ */
+static void NORETURN stress_sigq_lat_receiver(
+	stress_sigq_lat_t *lat,
+	const int mech,
+	stress_latency_t *latency,
+	const int cpu,
+	const int ack_fd)
+{
+	sigset_t mask, old_mask;
+	struct sigaction sa;
+	const char ack = 0;
+#if defined(STRESS_SIGQ_LAT_SIGNALFD_EPOLL)
+	int sfd = -1, efd = -1;
+#endif
+
+	stress_parent_died_alarm();
+	stress_sigq_lat_set_cpu(cpu);
+
+	(void)sigemptyset(&mask);
+	(void)sigaddset(&mask, SIGUSR1);
+	if (sigprocmask(SIG_BLOCK, &mask, &old_mask) < 0)
+		_exit(EXIT_FAILURE);
+	(void)sigdelset(&old_mask, SIGUSR1);
+
+	switch (mech) {
+	case STRESS_SIGQ_LAT_HANDLER:
+		sigq_lat_handler_latency = latency;
+		(void)shim_memset(&sa, 0, sizeof(sa));
+		sa.sa_sigaction = stress_sigq_lat_handler;
+		sa.sa_flags = SA_SIGINFO;
+		if (sigaction(SIGUSR1, &sa, NULL) < 0)
+			_exit(EXIT_FAILURE);
+		break;
+#if defined(STRESS_SIGQ_LAT_SIGNALFD_EPOLL)
+	case STRESS_SIGQ_LAT_SIGNALFD: {
+		struct epoll_event ev;
+
+		sfd = signalfd(-1, &mask, 0);
+		if (sfd < 0)
+			_exit(EXIT_NO_RESOURCE);
+		efd = epoll_create1(0);
+		if (efd < 0)
+			_exit(EXIT_NO_RESOURCE);
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = sfd;
+		if (epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &ev) < 0)
+			_exit(EXIT_NO_RESOURCE);
+		break;
+	}
+#endif
+	case STRESS_SIGQ_LAT_SIGWAITINFO:
+		break;
+	default:
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	/* ready for the first signal */
+	if (write(ack_fd, &ack, sizeof(ack)) < 0)
+		_exit(EXIT_FAILURE);
+
+	while (!lat->stop) {
+		uintptr_t sent = 0, now;
+		siginfo_t info;
+
+		switch (mech) {
+		case STRESS_SIGQ_LAT_HANDLER:
+			/* latency is recorded by the handler */
+			(void)sigsuspend(&old_mask);
+			break;
+#if defined(STRESS_SIGQ_LAT_SIGNALFD_EPOLL)
+		case STRESS_SIGQ_LAT_SIGNALFD: {
+			struct epoll_event ev;
+			struct signalfd_siginfo fdsi;
+
+			if (epoll_wait(efd, &ev, 1, -1) < 1)
+				continue;
+			if (read(sfd, &fdsi, sizeof(fdsi)) != (ssize_t)sizeof(fdsi))
+				continue;
+			now = stress_sigq_lat_ns();
+			sent = (uintptr_t)fdsi.ssi_ptr;
+			stress_latency_add(latency, (uint64_t)(now - sent));
+			break;
+		}
+#endif
+		default:
+			(void)shim_memset(&info, 0, sizeof(info));
+			if (sigwaitinfo(&mask, &info) < 0)
+				continue;
+			now = stress_sigq_lat_ns();
+			sent = (uintptr_t)info.si_value.sival_ptr;
+			stress_latency_add(latency, (uint64_t)(now - sent));
+			break;
+		}
+		if (write(ack_fd, &ack, sizeof(ack)) < 0)
+			break;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_sigq_lat_round()
+ *	measure the delivery latency of one mechanism for duration
+ *	seconds with the receiver on the given CPU and the sender on
+ *	sender_cpu, returns EXIT_SUCCESS or EXIT_NO_RESOURCE
+ */
+static int stress_sigq_lat_round(
+	stress_args_t *args,
+	stress_sigq_lat_t *lat,
+	const int mech,
+	const int placement,
+	const int sender_cpu,
+	const int receiver_cpu,
+	const double duration)
+{
+	int fds[2], status;
+	pid_t pid;
+	char ack;
+	double t_end;
+
+	if (pipe(fds) < 0)
+		return EXIT_NO_RESOURCE;
+
+	lat->stop = false;
+	pid = fork();
+	if (pid < 0) {
+		(void)close(fds[0]);
+		(void)close(fds[1]);
+		return EXIT_NO_RESOURCE;
+	} else if (pid == 0) {
+		(void)close(fds[0]);
+		stress_sigq_lat_receiver(lat, mech, &lat->latency[placement][mech],
+			receiver_cpu, fds[1]);
+	}
+	(void)close(fds[1]);
+	stress_sigq_lat_set_cpu(sender_cpu);
+
+	t_end = stress_time_now() + duration;
+	while (stress_continue(args)) {
+		union sigval s;
+
+		/* wait for the receiver to be ready */
+		if (read(fds[0], &ack, sizeof(ack)) != (ssize_t)sizeof(ack))
+			break;
+		if (stress_time_now() >= t_end)
+			break;
+		s.sival_ptr = (void *)stress_sigq_lat_ns();
+		if (sigqueue(pid, SIGUSR1, s) < 0)
+			break;
+		stress_bogo_inc(args);
+	}
+	lat->stop = true;
+	(void)close(fds[0]);
+	(void)stress_kill_pid_wait(pid, &status);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_sigq_latency()
+ *	measure sigqueue delivery latency through an async handler,
+ *	signalfd with epoll and sigwaitinfo with the sender and
+ *	receiver on the same CPU and on different CPUs
+ */
+static int stress_sigq_latency(stress_args_t *args)
+{
+	stress_sigq_lat_t *lat;
+	const int32_t cpus = stress_get_processors_online();
+	const int sender_cpu = (int)stress_get_cpu();
+	const int other_cpu = (sender_cpu + 1) % (int)STRESS_MAXIMUM(cpus, 1);
+	const int n_placements = (other_cpu != sender_cpu) ? STRESS_SIGQ_LAT_PLACEMENTS : 1;
+	int mech, placement, metric = 0;
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+	cpu_set_t orig_mask;
+	const bool restore = (sched_getaffinity(0, sizeof(orig_mask), &orig_mask) == 0);
+#endif
+
+	lat = (stress_sigq_lat_t *)stress_mmap_populate(NULL, sizeof(*lat),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (lat == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for latencies, errno=%d (%s), "
+			"skipping stressor\n", args->name, sizeof(*lat), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(lat, sizeof(*lat), "sigq-latencies");
+	if ((args->instance == 0) && (n_placements == 1))
+		pr_inf("%s: only 1 CPU online, measuring same CPU latencies only\n", args->name);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		const double t_left = args->time_end - stress_time_now();
+		double slice = t_left / (double)(STRESS_SIGQ_LAT_MECH_MAX * n_placements);
+
+		slice = STRESS_MINIMUM(slice, 1.0);
+		slice = STRESS_MAXIMUM(slice, 0.05);
+
+		for (placement = 0; placement < n_placements; placement++) {
+			for (mech = 0; mech < STRESS_SIGQ_LAT_MECH_MAX; mech++) {
+				(void)stress_sigq_lat_round(args, lat, mech, placement, sender_cpu,
+					placement ? other_cpu : sender_cpu, slice);
+				if (!stress_continue(args))
+					goto report;
+			}
+		}
+	} while (stress_continue(args));
+
+report:
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+	if (restore)
+		(void)sched_setaffinity(0, sizeof(orig_mask), &orig_mask);
+#endif
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: sigqueue delivery latency in microseconds:\n", args->name);
+		pr_inf("%s: %-12s %-10s %10s %8s %8s %8s %8s %8s\n", args->name,
+			"mechanism", "placement", "signals", "min", "P50", "P90", "P99", "max");
+	}
+	for (placement = 0; placement < n_placements; placement++) {
+		for (mech = 0; mech < STRESS_SIGQ_LAT_MECH_MAX; mech++) {
+			const stress_latency_t *latency = &lat->latency[placement][mech];
+			const double p50 = (double)stress_latency_percentile(latency, 50.0) / 1000.0;
+			const double p99 = (double)stress_latency_percentile(latency, 99.0) / 1000.0;
+			char str[64];
+
+			if (latency->count == 0)
+				continue;
+			if (args->instance == 0) {
+				pr_inf("%s: %-12s %-10s %10" PRIu64 " %8.2f %8.2f %8.2f %8.2f %8.2f\n",
+					args->name, sigq_lat_mechs[mech], sigq_lat_placements[placement],
+					latency->count, (double)latency->min / 1000.0, p50,
+					(double)stress_latency_percentile(latency, 90.0) / 1000.0,
+					p99, (double)latency->max / 1000.0);
+			}
+			(void)snprintf(str, sizeof(str), "%s %s P50 latency usecs",
+				sigq_lat_mechs[mech], sigq_lat_placements[placement]);
+			stress_metrics_set(args, metric++, str, p50, STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s %s P99 latency usecs",
+				sigq_lat_mechs[mech], sigq_lat_placements[placement]);
+			stress_metrics_set(args, metric++, str, p99, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)lat, sizeof(*lat));
+
+	return EXIT_SUCCESS;
+}
+
 #if defined(__NR_rt_sigqueueinfo) &&	\
     defined(HAVE_SYSCALL)
 #define HAVE_RT_SIGQUEUEINFO
@@ -75,10 +432,15 @@ static int stress_sigq(stress_args_t *args)
 #endif
 	int rc = EXIT_SUCCESS, parent_cpu;
 	int val = stress_mwc32();
+	bool sigq_latency = false;
 
 	if (val == 0)
 		val++;
 
+	(void)stress_get_setting("sigq-latency", &sigq_latency);
+	if (sigq_latency)
+		return stress_sigq_latency(args);
+
 	handled_sigchld = false;
 
 	if (stress_sighandler(args->name, SIGCHLD, stress_sigq_chld_handler, NULL) < 0)
@@ -216,6 +578,7 @@ finish:
 stressor_info_t stress_sigq_info = {
 	.stressor = stress_sigq,
 	.class = CLASS_INTERRUPT | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -223,6 +586,7 @@ stressor_info_t stress_sigq_info = {
 stressor_info_t stress_sigq_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_SIGNAL | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sigqueue() or sigwaitinfo() or defined SA_SIGINFO"
@@ -54,7 +54,7 @@ static int stress_sigsuspend(stress_args_t *args)
 	if (stress_sighandler(args->name, SIGCHLD, stress_sigsuspend_chld_handler, NULL) < 0)
 		return EXIT_FAILURE;
 
-	counter_lock = stress_lock_create();
+	counter_lock = stress_lock_create("sigsuspend-counter");
 	if (!counter_lock) {
 		pr_inf_skip("%s: failed to create counter lock. skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
@@ -18,11 +18,21 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-pthread.h"
 
 #define MIN_SKIPLIST_SIZE	(1 * KB)
 #define MAX_SKIPLIST_SIZE	(4 * MB)
 #define DEFAULT_SKIPLIST_SIZE	(1 * KB)
 
+#define MIN_SKIPLIST_THREADS	(0)
+#define MAX_SKIPLIST_THREADS	(64)
+#define DEFAULT_SKIPLIST_THREADS (0)
+
+#define MIN_SKIPLIST_READ_PCT	(0)
+#define MAX_SKIPLIST_READ_PCT	(100)
+#define DEFAULT_SKIPLIST_READ_PCT (80)
+
 typedef struct skip_node {
 	unsigned long value;
 	struct skip_node *skip_nodes[1];
@@ -37,7 +47,9 @@ typedef struct {
 static const stress_help_t help[] = {
 	{ NULL,	"skiplist N",	  "start N workers that exercise a skiplist search" },
 	{ NULL,	"skiplist-ops N", "stop after N skiplist search bogo operations" },
+	{ NULL,	"skiplist-read-pct P", "percentage of concurrent skiplist operations that are searches" },
 	{ NULL,	"skiplist-size N", "number of 32 bit integers to add to skiplist" },
+	{ NULL,	"skiplist-threads N", "use N threads on a lock-free skiplist, 0 = single threaded" },
 	{ NULL,	NULL,		  NULL }
 };
 
@@ -55,6 +67,34 @@ static int stress_set_skiplist_size(const char *opt)
 	return stress_set_setting("skiplist-size", TYPE_ID_UINT64, &skiplist_size);
 }
 
+/*
+ *  stress_set_skiplist_threads()
+ *	set number of concurrent skiplist threads
+ */
+static int stress_set_skiplist_threads(const char *opt)
+{
+	uint32_t skiplist_threads;
+
+	skiplist_threads = stress_get_uint32(opt);
+	stress_check_range("skiplist-threads", (uint64_t)skiplist_threads,
+		MIN_SKIPLIST_THREADS, MAX_SKIPLIST_THREADS);
+	return stress_set_setting("skiplist-threads", TYPE_ID_UINT32, &skiplist_threads);
+}
+
+/*
+ *  stress_set_skiplist_read_pct()
+ *	set percentage of concurrent operations that are searches
+ */
+static int stress_set_skiplist_read_pct(const char *opt)
+{
+	uint32_t skiplist_read_pct;
+
+	skiplist_read_pct = stress_get_uint32(opt);
+	stress_check_range("skiplist-read-pct", (uint64_t)skiplist_read_pct,
+		MIN_SKIPLIST_READ_PCT, MAX_SKIPLIST_READ_PCT);
+	return stress_set_setting("skiplist-read-pct", TYPE_ID_UINT32, &skiplist_read_pct);
+}
+
 /*
  *  skip_list_random_level()
  *	generate a quasi-random skip list level
@@ -214,6 +254,541 @@ static void skip_list_free(skip_list_t *list)
 		free(skip_node);
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define HAVE_LF_SKIPLIST	(1)
+
+#define LF_SKIPLIST_LEVEL_MAX	(32)
+#define LF_SKIPLIST_OPS_SCALE	(16)	/* ops per thread per pass = size * scale */
+#define LF_MARK			((uintptr_t)1)
+#define LF_IS_MARKED(p)		((p) & LF_MARK)
+#define LF_NODE(p)		((lf_skip_node_t *)((p) & ~LF_MARK))
+
+/*
+ *  Lock-free skip list, Fraser / Herlihy-Shavit style. A node is
+ *  deleted by setting the mark bit in its next pointers, top level
+ *  down, the level 0 mark is the linearization point. Searches that
+ *  find marked nodes unlink them with a compare and swap. Nodes are
+ *  not freed until all the threads have finished so a thread never
+ *  follows a pointer to freed memory.
+ */
+typedef struct lf_skip_node {
+	uint64_t key;
+	size_t levels;
+	struct lf_skip_node *alloc_next;	/* per thread allocation list */
+	uintptr_t next[1];			/* marked next pointers */
+} lf_skip_node_t;
+
+typedef struct {
+	lf_skip_node_t *head;
+	lf_skip_node_t *tail;
+	size_t max_level;
+	volatile bool start;
+} lf_skip_list_t;
+
+/* per thread state */
+typedef struct {
+	stress_pthread_args_t pargs;
+	pthread_t pthread;
+	lf_skip_list_t *list;
+	lf_skip_node_t *nodes;		/* nodes allocated by this thread */
+	uint64_t rnd;			/* xorshift random state */
+	uint64_t key_range;		/* keys are 1..key_range */
+	uint64_t max_ops;		/* ops to perform */
+	uint32_t read_pct;		/* percentage of searches */
+	uint64_t ops;			/* completed operations */
+	uint64_t inserts;		/* successful inserts */
+	uint64_t deletes;		/* successful deletes */
+	uint64_t cas_fails;		/* failed compare and swaps */
+	double t_start;
+	double t_end;
+	bool alloc_failed;
+} lf_skip_thread_t;
+
+/* results of concurrent passes with a given number of threads */
+typedef struct {
+	uint64_t ops;
+	uint64_t cas_fails;
+	double duration;
+} lf_skip_result_t;
+
+static inline uint64_t OPTIMIZE3 lf_skip_rand(lf_skip_thread_t *t)
+{
+	t->rnd ^= t->rnd << 13;
+	t->rnd ^= t->rnd >> 7;
+	t->rnd ^= t->rnd << 17;
+	return t->rnd;
+}
+
+static inline size_t OPTIMIZE3 lf_skip_random_level(lf_skip_thread_t *t, const size_t max_level)
+{
+	register uint64_t r = lf_skip_rand(t);
+	register size_t level = 1;
+
+	while ((r & 1) && (level < max_level)) {
+		r >>= 1;
+		level++;
+	}
+	return level;
+}
+
+static inline bool lf_skip_cas(uintptr_t *ptr, uintptr_t expected, const uintptr_t desired)
+{
+	return __atomic_compare_exchange_n(ptr, &expected, desired, false,
+		__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/*
+ *  lf_skip_node_alloc()
+ *	allocate a node, it is added to the allocator's list so
+ *	that it can be freed once all the threads have stopped
+ */
+static lf_skip_node_t *lf_skip_node_alloc(
+	lf_skip_node_t **nodes,
+	const uint64_t key,
+	const size_t levels)
+{
+	const size_t sz = sizeof(lf_skip_node_t) + (levels * sizeof(uintptr_t));
+	lf_skip_node_t *node;
+
+	node = (lf_skip_node_t *)calloc(1, sz);
+	if (UNLIKELY(!node))
+		return NULL;
+	node->key = key;
+	node->levels = levels;
+	node->alloc_next = *nodes;
+	*nodes = node;
+	return node;
+}
+
+static void lf_skip_nodes_free(lf_skip_node_t *nodes)
+{
+	while (nodes) {
+		lf_skip_node_t *next = nodes->alloc_next;
+
+		free(nodes);
+		nodes = next;
+	}
+}
+
+/*
+ *  lf_skip_find()
+ *	find the predecessors and successors of key on each level,
+ *	unlinking any marked nodes on the way
+ */
+static bool OPTIMIZE3 lf_skip_find(
+	lf_skip_list_t *list,
+	const uint64_t key,
+	lf_skip_node_t **preds,
+	lf_skip_node_t **succs,
+	uint64_t *cas_fails)
+{
+	lf_skip_node_t *pred, *curr;
+	uintptr_t succ;
+	size_t level;
+
+retry:
+	pred = list->head;
+	curr = list->tail;
+	for (level = list->max_level; level-- > 0; ) {
+		curr = LF_NODE(__atomic_load_n(&pred->next[level], __ATOMIC_ACQUIRE));
+		for (;;) {
+			succ = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			while (LF_IS_MARKED(succ)) {
+				if (!lf_skip_cas(&pred->next[level], (uintptr_t)curr, (uintptr_t)LF_NODE(succ))) {
+					(*cas_fails)++;
+					goto retry;
+				}
+				curr = LF_NODE(succ);
+				succ = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			}
+			if (curr->key >= key)
+				break;
+			pred = curr;
+			curr = LF_NODE(succ);
+		}
+		preds[level] = pred;
+		succs[level] = curr;
+	}
+	return curr->key == key;
+}
+
+/*
+ *  lf_skip_contains()
+ *	wait-free search, skips over marked nodes without unlinking them
+ */
+static bool OPTIMIZE3 lf_skip_contains(lf_skip_list_t *list, const uint64_t key)
+{
+	lf_skip_node_t *pred = list->head, *curr = NULL;
+	uintptr_t succ;
+	size_t level;
+
+	for (level = list->max_level; level-- > 0; ) {
+		curr = LF_NODE(__atomic_load_n(&pred->next[level], __ATOMIC_ACQUIRE));
+		for (;;) {
+			succ = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			while (LF_IS_MARKED(succ)) {
+				curr = LF_NODE(succ);
+				succ = __atomic_load_n(&curr->next[level], __ATOMIC_ACQUIRE);
+			}
+			if (curr->key >= key)
+				break;
+			pred = curr;
+			curr = LF_NODE(succ);
+		}
+	}
+	return curr && (curr->key == key);
+}
+
+/*
+ *  lf_skip_insert()
+ *	insert key, returns 1 if inserted, 0 if already present,
+ *	-1 if out of memory
+ */
+static int OPTIMIZE3 lf_skip_insert(lf_skip_thread_t *t, const uint64_t key)
+{
+	lf_skip_list_t *list = t->list;
+	lf_skip_node_t *preds[LF_SKIPLIST_LEVEL_MAX], *succs[LF_SKIPLIST_LEVEL_MAX];
+	lf_skip_node_t *node = NULL;
+	const size_t levels = lf_skip_random_level(t, list->max_level);
+	size_t level;
+
+	for (;;) {
+		if (lf_skip_find(list, key, preds, succs, &t->cas_fails))
+			return 0;
+		/* an unpublished node from a failed attempt is reused */
+		if (!node) {
+			node = lf_skip_node_alloc(&t->nodes, key, levels);
+			if (UNLIKELY(!node))
+				return -1;
+		}
+		for (level = 0; level < levels; level++)
+			__atomic_store_n(&node->next[level], (uintptr_t)succs[level], __ATOMIC_RELAXED);
+		if (lf_skip_cas(&preds[0]->next[0], (uintptr_t)succs[0], (uintptr_t)node))
+			break;
+		t->cas_fails++;
+	}
+
+	/* node is now in the list, link in the higher levels */
+	for (level = 1; level < levels; level++) {
+		for (;;) {
+			const uintptr_t next = __atomic_load_n(&node->next[level], __ATOMIC_ACQUIRE);
+
+			/* node is being deleted, stop linking it in */
+			if (LF_IS_MARKED(next))
+				return 1;
+			if ((LF_NODE(next) != succs[level]) &&
+			    !lf_skip_cas(&node->next[level], next, (uintptr_t)succs[level])) {
+				t->cas_fails++;
+				continue;
+			}
+			if (lf_skip_cas(&preds[level]->next[level], (uintptr_t)succs[level], (uintptr_t)node))
+				break;
+			t->cas_fails++;
+			(void)lf_skip_find(list, key, preds, succs, &t->cas_fails);
+			/* deleted and unlinked from level 0 in the meantime */
+			if (succs[0] != node)
+				return 1;
+		}
+	}
+	return 1;
+}
+
+/*
+ *  lf_skip_delete()
+ *	delete key, returns true if this thread deleted it
+ */
+static bool OPTIMIZE3 lf_skip_delete(lf_skip_thread_t *t, const uint64_t key)
+{
+	lf_skip_list_t *list = t->list;
+	lf_skip_node_t *preds[LF_SKIPLIST_LEVEL_MAX], *succs[LF_SKIPLIST_LEVEL_MAX];
+	lf_skip_node_t *victim;
+	uintptr_t next;
+	size_t level;
+
+	if (!lf_skip_find(list, key, preds, succs, &t->cas_fails))
+		return false;
+	victim = succs[0];
+
+	for (level = victim->levels - 1; level > 0; level--) {
+		next = __atomic_load_n(&victim->next[level], __ATOMIC_ACQUIRE);
+		while (!LF_IS_MARKED(next)) {
+			if (lf_skip_cas(&victim->next[level], next, next | LF_MARK))
+				break;
+			t->cas_fails++;
+			next = __atomic_load_n(&victim->next[level], __ATOMIC_ACQUIRE);
+		}
+	}
+	next = __atomic_load_n(&victim->next[0], __ATOMIC_ACQUIRE);
+	for (;;) {
+		/* another thread marked it first */
+		if (LF_IS_MARKED(next))
+			return false;
+		if (lf_skip_cas(&victim->next[0], next, next | LF_MARK)) {
+			/* unlink it */
+			(void)lf_skip_find(list, key, preds, succs, &t->cas_fails);
+			return true;
+		}
+		t->cas_fails++;
+		next = __atomic_load_n(&victim->next[0], __ATOMIC_ACQUIRE);
+	}
+}
+
+/*
+ *  lf_skip_thread()
+ *	perform a mix of searches, inserts and deletes on random keys
+ */
+static void *lf_skip_thread(void *arg)
+{
+	lf_skip_thread_t *t = (lf_skip_thread_t *)arg;
+	lf_skip_list_t *list = t->list;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!list->start)
+		shim_sched_yield();
+
+	t->t_start = stress_time_now();
+	for (t->ops = 0; (t->ops < t->max_ops) && stress_continue_flag(); t->ops++) {
+		const uint64_t r = lf_skip_rand(t);
+		const uint64_t key = ((r >> 8) % t->key_range) + 1;
+		const uint32_t pct = (uint32_t)(r & 0xff) % 100;
+
+		if (pct < t->read_pct) {
+			(void)lf_skip_contains(list, key);
+		} else if ((r >> 7) & 1) {
+			const int ret = lf_skip_insert(t, key);
+
+			if (UNLIKELY(ret < 0)) {
+				t->alloc_failed = true;
+				break;
+			}
+			t->inserts += (uint64_t)ret;
+		} else {
+			t->deletes += lf_skip_delete(t, key);
+		}
+	}
+	t->t_end = stress_time_now();
+	return NULL;
+}
+
+/*
+ *  lf_skip_list_init()
+ *	create an empty list with head and tail sentinels
+ */
+static int lf_skip_list_init(lf_skip_list_t *list, lf_skip_node_t **nodes, const size_t max_level)
+{
+	size_t level;
+
+	list->max_level = max_level;
+	list->start = false;
+	list->tail = lf_skip_node_alloc(nodes, UINT64_MAX, max_level);
+	if (!list->tail)
+		return -1;
+	list->head = lf_skip_node_alloc(nodes, 0, max_level);
+	if (!list->head)
+		return -1;
+	for (level = 0; level < max_level; level++)
+		list->head->next[level] = (uintptr_t)list->tail;
+	return 0;
+}
+
+/*
+ *  lf_skip_list_check()
+ *	check each level is in strictly ascending key order and
+ *	return the number of unmarked nodes on level 0
+ */
+static uint64_t lf_skip_list_check(stress_args_t *args, lf_skip_list_t *list, bool *ok)
+{
+	uint64_t count = 0;
+	size_t level;
+
+	for (level = 0; level < list->max_level; level++) {
+		lf_skip_node_t *node = LF_NODE(list->head->next[level]);
+		uint64_t prev = 0;
+
+		while (node != list->tail) {
+			if (node->key <= prev) {
+				pr_fail("%s: lock-free skiplist level %zu out of order, key %" PRIu64
+					" follows %" PRIu64 "\n", args->name, level, node->key, prev);
+				*ok = false;
+				return count;
+			}
+			prev = node->key;
+			if ((level == 0) && !LF_IS_MARKED(node->next[0]))
+				count++;
+			node = LF_NODE(node->next[level]);
+		}
+	}
+	return count;
+}
+
+/*
+ *  lf_skip_pass()
+ *	populate a list with every other key and run n_threads on it,
+ *	returns -1 on failure
+ */
+static int lf_skip_pass(
+	stress_args_t *args,
+	lf_skip_thread_t *threads,
+	const uint32_t n_threads,
+	const uint64_t n,
+	const size_t max_level,
+	const uint32_t read_pct,
+	lf_skip_result_t *result)
+{
+	lf_skip_list_t list;
+	lf_skip_thread_t *t0 = &threads[0];
+	lf_skip_node_t *list_nodes = NULL;
+	uint64_t i, count, expected = n;
+	uint32_t j, started = 0;
+	double t_start = 0.0, t_end = 0.0;
+	bool ok = true;
+	int rc = 0;
+
+	(void)shim_memset(threads, 0, sizeof(*threads) * n_threads);
+	if (lf_skip_list_init(&list, &list_nodes, max_level) < 0) {
+		lf_skip_nodes_free(list_nodes);
+		return -1;
+	}
+
+	/* populate list with odd keys using thread 0's state */
+	t0->list = &list;
+	t0->rnd = stress_mwc64() | 1;
+	for (i = 0; i < n; i++) {
+		if (lf_skip_insert(t0, (i * 2) + 1) < 0) {
+			rc = -1;
+			goto free_nodes;
+		}
+	}
+
+	for (j = 0; j < n_threads; j++) {
+		lf_skip_thread_t *t = &threads[j];
+
+		t->pargs.args = args;
+		t->list = &list;
+		t->rnd = stress_mwc64() | 1;
+		t->key_range = n * 2;
+		t->max_ops = n * LF_SKIPLIST_OPS_SCALE;
+		t->read_pct = read_pct;
+		/* discount the populating inserts made by thread 0 */
+		t->cas_fails = 0;
+		t->inserts = 0;
+		if (pthread_create(&t->pthread, NULL, lf_skip_thread, t))
+			break;
+		started++;
+	}
+	list.start = true;
+	for (j = 0; j < started; j++)
+		(void)pthread_join(threads[j].pthread, NULL);
+
+	if (started != n_threads) {
+		pr_inf("%s: could only start %" PRIu32 " of %" PRIu32 " threads\n",
+			args->name, started, n_threads);
+		rc = -1;
+	}
+
+	for (j = 0; j < started; j++) {
+		const lf_skip_thread_t *t = &threads[j];
+
+		if (t->alloc_failed)
+			rc = -1;
+		if ((j == 0) || (t->t_start < t_start))
+			t_start = t->t_start;
+		if ((j == 0) || (t->t_end > t_end))
+			t_end = t->t_end;
+		result->ops += t->ops;
+		result->cas_fails += t->cas_fails;
+		expected += t->inserts;
+		expected -= t->deletes;
+	}
+	if (t_end > t_start)
+		result->duration += t_end - t_start;
+
+	count = lf_skip_list_check(args, &list, &ok);
+	if (!ok) {
+		rc = -1;
+	} else if (count != expected) {
+		pr_fail("%s: lock-free skiplist has %" PRIu64 " keys, expected %" PRIu64 "\n",
+			args->name, count, expected);
+		rc = -1;
+	}
+
+free_nodes:
+	lf_skip_nodes_free(list_nodes);
+	for (j = 0; j < n_threads; j++)
+		lf_skip_nodes_free(threads[j].nodes);
+	return rc;
+}
+
+/*
+ *  stress_skiplist_concurrent()
+ *	exercise a lock-free skiplist with concurrent threads, a single
+ *	threaded pass is run first as a baseline for scaling efficiency
+ */
+static int stress_skiplist_concurrent(
+	stress_args_t *args,
+	const uint64_t n,
+	const size_t ln2n,
+	const uint32_t n_threads,
+	const uint32_t read_pct)
+{
+	const size_t max_level = STRESS_MINIMUM(ln2n, LF_SKIPLIST_LEVEL_MAX);
+	lf_skip_thread_t *threads;
+	lf_skip_result_t baseline, result;
+	int rc = EXIT_SUCCESS;
+
+	threads = (lf_skip_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread states, skipping stressor\n",
+			args->name, n_threads);
+		return EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " threads on a lock-free skiplist, %" PRIu32 "%% searches\n",
+			args->name, n_threads, read_pct);
+
+	(void)shim_memset(&baseline, 0, sizeof(baseline));
+	(void)shim_memset(&result, 0, sizeof(result));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	if (lf_skip_pass(args, threads, 1, n, max_level, read_pct, &baseline) < 0) {
+		rc = EXIT_FAILURE;
+		goto deinit;
+	}
+	do {
+		if (lf_skip_pass(args, threads, n_threads, n, max_level, read_pct, &result) < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	if ((result.duration > 0.0) && (baseline.duration > 0.0) && (baseline.ops > 0)) {
+		const double rate = (double)result.ops / result.duration;
+		const double baseline_rate = (double)baseline.ops / baseline.duration;
+
+		stress_metrics_set(args, 0, "ops per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "ops per sec per thread",
+			rate / (double)n_threads, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 2, "% scaling efficiency",
+			100.0 * rate / (baseline_rate * (double)n_threads), STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "CAS failures per op",
+			(double)result.cas_fails / (double)result.ops, STRESS_GEOMETRIC_MEAN);
+	}
+deinit:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(threads);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_skiplist()
  *	stress skiplist
@@ -222,6 +797,8 @@ static int OPTIMIZE3 stress_skiplist(stress_args_t *args)
 {
 	unsigned long n, i, ln2n;
 	uint64_t skiplist_size = DEFAULT_SKIPLIST_SIZE;
+	uint32_t skiplist_threads = DEFAULT_SKIPLIST_THREADS;
+	uint32_t skiplist_read_pct = DEFAULT_SKIPLIST_READ_PCT;
 	int rc = EXIT_FAILURE;
 
 	if (!stress_get_setting("skiplist-size", &skiplist_size)) {
@@ -230,6 +807,8 @@ static int OPTIMIZE3 stress_skiplist(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			skiplist_size = MIN_SKIPLIST_SIZE;
 	}
+	(void)stress_get_setting("skiplist-threads", &skiplist_threads);
+	(void)stress_get_setting("skiplist-read-pct", &skiplist_read_pct);
 	n = (unsigned long)skiplist_size;
 	ln2n = skip_list_ln2(n);
 
@@ -244,6 +823,17 @@ static int OPTIMIZE3 stress_skiplist(stress_args_t *args)
 		goto finish;
 	}
 
+	if (skiplist_threads > 0) {
+#if defined(HAVE_LF_SKIPLIST)
+		return stress_skiplist_concurrent(args, (uint64_t)n, (size_t)ln2n,
+			skiplist_threads, skiplist_read_pct);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: lock-free skiplist threads not supported, "
+				"using single threaded skiplist\n", args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -286,7 +876,9 @@ finish:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_skiplist_read_pct,stress_set_skiplist_read_pct },
 	{ OPT_skiplist_size,	stress_set_skiplist_size },
+	{ OPT_skiplist_threads,	stress_set_skiplist_threads },
 	{ 0,			NULL },
 };
 
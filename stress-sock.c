@@ -21,7 +21,9 @@
 #include "core-affinity.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cycles.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-net.h"
 
@@ -43,6 +45,22 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_ERRQUEUE_H)
+#include <linux/errqueue.h>
+#endif
+
+#if defined(HAVE_LINUX_TLS_H)
+#include <linux/tls.h>
+#endif
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
 #if defined(HAVE_SYS_UN_H)
 #include <sys/un.h>
 #else
@@ -69,6 +87,30 @@ UNEXPECTED
 #define MMAP_BUF_SIZE		(65536)
 #define MMAP_IO_SIZE		(8192)	/* Must be less or equal to 8192 */
 
+#define MIN_SOCKET_CONNS	(1)
+#define MAX_SOCKET_CONNS	(1024)
+
+#define STREAM_IO_SIZE		(64 * KB)	/* per send in --sock-conns mode */
+#define STREAM_RX_MAP_SIZE	(256 * KB)	/* per connection zerocopy rx mapping */
+#define STREAM_ZC_RING		(256)		/* zerocopy sends awaiting completion */
+#define STREAM_SENDS_PER_WAKE	(16)
+#define STREAM_FILE_SIZE	(1 * MB)	/* sendfile source in --sock-ktls mode */
+#define STREAM_PHASE_SECS	(1.0)		/* plaintext/kTLS alternation period */
+
+#define SOCKET_KTLS_OFF		(0)
+#define SOCKET_KTLS_SEND	(1)	/* send() through the tls ULP */
+#define SOCKET_KTLS_SENDFILE	(2)	/* sendfile() through the tls ULP */
+
+#define SOCKET_RR_OFF		(0)
+#define SOCKET_RR_RR		(1)	/* transactions on one connection */
+#define SOCKET_RR_CRR		(2)	/* connect, transaction, close */
+
+#define MIN_SOCKET_RR_SIZE	(1)
+#define MAX_SOCKET_RR_SIZE	(MMAP_BUF_SIZE)
+#define MIN_SOCKET_RR_DEPTH	(1)
+#define MAX_SOCKET_RR_DEPTH	(64)
+#define MAX_SOCKET_RR_INFLIGHT	(1 * MB)	/* pipelined bytes each way */
+
 #define SOCKET_OPT_SEND		(0x00)
 #define SOCKET_OPT_SENDMSG	(0x01)
 #define SOCKET_OPT_SENDMMSG	(0x02)
@@ -93,14 +135,20 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ "S N", "sock N",		"start N workers exercising socket I/O" },
+	{ NULL,	"sock-conns N",		"stream over N epoll multiplexed connections per worker" },
 	{ NULL,	"sock-domain D",	"specify socket domain, default is ipv4" },
 	{ NULL,	"sock-if I",		"use network interface I, e.g. lo, eth0, etc." },
+	{ NULL,	"sock-ktls M",		"compare kernel TLS to plaintext streams, M is send or sendfile" },
 	{ NULL,	"sock-msgs N",		"number of messages to send per connection" },
 	{ NULL,	"sock-nodelay",		"disable Nagle algorithm, send data immediately" },
 	{ NULL,	"sock-ops N",		"stop after N socket bogo operations" },
 	{ NULL,	"sock-opts option", 	"socket options [send|sendmsg|sendmmsg]" },
 	{ NULL,	"sock-port P",		"use socket ports P to P + number of workers - 1" },
 	{ NULL, "sock-protocol",	"use socket protocol P, default is tcp, can be mptcp" },
+	{ NULL,	"sock-rr M",		"request/response latency mode M, rr or crr" },
+	{ NULL,	"sock-rr-depth N",	"keep N pipelined requests in flight in rr mode" },
+	{ NULL,	"sock-rr-req N",	"request size in bytes for rr and crr modes" },
+	{ NULL,	"sock-rr-resp N",	"response size in bytes for rr and crr modes" },
 	{ NULL,	"sock-type T",		"socket type (stream, seqpacket)" },
 	{ NULL, "sock-zerocopy",	"enable zero copy sends" },
 	{ NULL,	NULL,			NULL }
@@ -190,6 +238,20 @@ static int stress_set_sock_type(const char *opt)
 	return stress_set_sock_option("sock-type", sock_types, opt);
 }
 
+/*
+ *  stress_set_sock_conns()
+ *	set number of concurrent streaming connections
+ */
+static int stress_set_sock_conns(const char *opt)
+{
+	uint32_t sock_conns;
+
+	sock_conns = stress_get_uint32(opt);
+	stress_check_range("sock-conns", (uint64_t)sock_conns,
+		MIN_SOCKET_CONNS, MAX_SOCKET_CONNS);
+	return stress_set_setting("sock-conns", TYPE_ID_UINT32, &sock_conns);
+}
+
 /*
  *  stress_set_sock_msgs()
  *	set number of messages to send per connection
@@ -239,6 +301,77 @@ static int stress_set_sock_protocol(const char *opt)
 	return stress_set_sock_option("sock-protocol", sock_protocols, opt);
 }
 
+/*
+ *  stress_set_sock_ktls()
+ *	parse --sock-ktls
+ */
+static int stress_set_sock_ktls(const char *opt)
+{
+	static const stress_sock_options_t sock_ktls_modes[] = {
+		{ "send",	SOCKET_KTLS_SEND },
+		{ "sendfile",	SOCKET_KTLS_SENDFILE },
+		{ NULL,		0 }
+	};
+
+	return stress_set_sock_option("sock-ktls", sock_ktls_modes, opt);
+}
+
+/*
+ *  stress_set_sock_rr()
+ *	parse --sock-rr
+ */
+static int stress_set_sock_rr(const char *opt)
+{
+	static const stress_sock_options_t sock_rr_modes[] = {
+		{ "rr",		SOCKET_RR_RR },
+		{ "crr",	SOCKET_RR_CRR },
+		{ NULL,		0 }
+	};
+
+	return stress_set_sock_option("sock-rr", sock_rr_modes, opt);
+}
+
+/*
+ *  stress_set_sock_rr_depth()
+ *	set number of pipelined requests in rr mode
+ */
+static int stress_set_sock_rr_depth(const char *opt)
+{
+	uint32_t sock_rr_depth;
+
+	sock_rr_depth = stress_get_uint32(opt);
+	stress_check_range("sock-rr-depth", (uint64_t)sock_rr_depth,
+		MIN_SOCKET_RR_DEPTH, MAX_SOCKET_RR_DEPTH);
+	return stress_set_setting("sock-rr-depth", TYPE_ID_UINT32, &sock_rr_depth);
+}
+
+/*
+ *  stress_set_sock_rr_req()
+ *	set request size in rr and crr modes
+ */
+static int stress_set_sock_rr_req(const char *opt)
+{
+	size_t sock_rr_req;
+
+	sock_rr_req = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("sock-rr-req", (uint64_t)sock_rr_req,
+		MIN_SOCKET_RR_SIZE, MAX_SOCKET_RR_SIZE);
+	return stress_set_setting("sock-rr-req", TYPE_ID_SIZE_T, &sock_rr_req);
+}
+
+/*
+ *  stress_set_sock_rr_resp()
+ *	set response size in rr and crr modes
+ */
+static int stress_set_sock_rr_resp(const char *opt)
+{
+	size_t sock_rr_resp;
+
+	sock_rr_resp = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("sock-rr-resp", (uint64_t)sock_rr_resp,
+		MIN_SOCKET_RR_SIZE, MAX_SOCKET_RR_SIZE);
+	return stress_set_setting("sock-rr-resp", TYPE_ID_SIZE_T, &sock_rr_resp);
+}
 
 /*
  *  stress_set_sock_domain()
@@ -1004,6 +1137,24 @@ static bool stress_send_error(const int err)
 		(err != ECONNRESET));
 }
 
+/*
+ *  stress_sock_cpu_ns()
+ *	user and system CPU time consumed so far, ns
+ */
+static uint64_t stress_sock_cpu_ns(void)
+{
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) == 0) {
+		return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * STRESS_NANOSECOND +
+		       ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+	}
+#endif
+	return 0;
+}
+
 /*
  *  stress_sock_server()
  *	server writer
@@ -1033,7 +1184,7 @@ static int OPTIMIZE3 stress_sock_server(
 	const pid_t self = getpid();
 	int sendflag = 0;
 	double t, duration, metric;
-	uint64_t outq_bytes = 0, outq_samples = 0;
+	uint64_t outq_bytes = 0, outq_samples = 0, cpu_start;
 	size_t sock_msgs = DEFAULT_SOCKET_MSGS;
 #if defined(SIOCOUTQ)
 	uint32_t count = 0;
@@ -1126,6 +1277,7 @@ static int OPTIMIZE3 stress_sock_server(
 		(void)stress_madvise_mergeable(ptr, page_size);
 
 	t = stress_time_now();
+	cpu_start = stress_sock_cpu_ns();
 	do {
 		int sfd;
 
@@ -1349,6 +1501,9 @@ retry_sendmmsg:
 	metric = (outq_samples > 0) ? (double)outq_bytes / (double)outq_samples : 0.0;
 	stress_metrics_set(args, 1, "byte average out queue length",
 		metric, STRESS_HARMONIC_MEAN);
+	metric = (msgs > 0) ? (double)(stress_sock_cpu_ns() - cpu_start) / (double)msgs : 0.0;
+	stress_metrics_set(args, 3, "server CPU nanosecs per message",
+		metric, STRESS_GEOMETRIC_MEAN);
 
 die_close:
 	(void)close(fd);
@@ -1368,109 +1523,1393 @@ die:
 	return rc;
 }
 
-static void stress_sock_sigpipe_handler(int signum)
+#if defined(HAVE_SYS_EPOLL_H) &&	\
+    defined(HAVE_EPOLL_CREATE)
+#define HAVE_SOCK_STREAM_CONNS
+#endif
+
+#if defined(HAVE_SOCK_STREAM_CONNS) &&	\
+    defined(MSG_ZEROCOPY) &&		\
+    defined(SO_ZEROCOPY) &&		\
+    defined(MSG_ERRQUEUE) &&		\
+    defined(HAVE_LINUX_ERRQUEUE_H) &&	\
+    defined(SO_EE_ORIGIN_ZEROCOPY) &&	\
+    defined(SO_EE_CODE_ZEROCOPY_COPIED)
+#define HAVE_SOCK_STREAM_ZEROCOPY_TX
+#endif
+
+#if defined(HAVE_SOCK_STREAM_CONNS) &&	\
+    defined(TCP_ZEROCOPY_RECEIVE)
+#define HAVE_SOCK_STREAM_ZEROCOPY_RX
+#endif
+
+#if defined(HAVE_SOCK_STREAM_CONNS) &&	\
+    defined(HAVE_LINUX_TLS_H) &&	\
+    defined(SOL_TLS) &&			\
+    defined(TCP_ULP) &&			\
+    defined(TLS_TX) &&			\
+    defined(TLS_RX) &&			\
+    defined(TLS_1_2_VERSION) &&		\
+    defined(TLS_CIPHER_AES_GCM_128)
+#define HAVE_SOCK_STREAM_KTLS
+#endif
+
+#if defined(HAVE_SOCK_STREAM_KTLS) &&	\
+    defined(HAVE_SENDFILE) &&		\
+    defined(HAVE_SYS_SENDFILE_H)
+#define HAVE_SOCK_STREAM_SENDFILE
+#endif
+
+#if defined(HAVE_SOCK_STREAM_CONNS)
+/*
+ *  per connection state in --sock-conns streaming mode
+ */
+typedef struct {
+	int fd;				/* connection, -1 when closed */
+	void *rx_map;			/* TCP_ZEROCOPY_RECEIVE mapping */
+	uint32_t zc_next;		/* next zerocopy send id */
+	uint32_t zc_done;		/* zerocopy send ids completed */
+	uint32_t zc_size[STREAM_ZC_RING]; /* bytes of each zerocopy send */
+	off_t sf_off;			/* sendfile offset in --sock-ktls mode */
+	bool tls;			/* connection uses the tls ULP */
+} stress_sock_conn_t;
+
+/*
+ *  per end totals in --sock-conns streaming mode
+ */
+typedef struct {
+	double t_start;			/* wall clock start */
+	uint64_t cycles_start;		/* cycle counter start */
+	uint64_t cpu_start;		/* CPU ns start */
+	uint64_t bytes;			/* total bytes sent/received */
+	uint64_t zc_bytes;		/* bytes sent/received without a copy */
+	uint64_t zc_copied;		/* zerocopy bytes the kernel had to copy */
+} stress_sock_stream_t;
+
+/*
+ *  counters at the start of a plaintext or kTLS phase in --sock-ktls
+ *  mode, or the totals accumulated over all phases of one kind
+ */
+typedef struct {
+	double time;			/* wall clock seconds */
+	uint64_t cpu_ns;		/* CPU ns */
+	uint64_t cycles;		/* cycle counter */
+	uint64_t bytes;			/* bytes sent */
+} stress_sock_phase_t;
+
+static void stress_sock_stream_begin(stress_sock_stream_t *st)
 {
-	(void)signum;
+	(void)shim_memset(st, 0, sizeof(*st));
+	st->t_start = stress_time_now();
+	st->cycles_start = stress_cycles_get();
+	st->cpu_start = stress_sock_cpu_ns();
+}
 
-	stress_continue_set_flag(false);
+/*
+ *  stress_sock_stream_metrics()
+ *	report Gbit/s, the CPU cost per byte and the zero copy share
+ *	at one end of the streams, CPU time is scaled by the cycle
+ *	counter rate to give cycles, or nanoseconds without a counter
+ */
+static void stress_sock_stream_metrics(
+	stress_args_t *args,
+	const size_t idx,
+	const char *end,
+	const stress_sock_stream_t *st,
+	const bool zerocopy)
+{
+	const double duration = stress_time_now() - st->t_start;
+	const double cpu_secs = (double)(stress_sock_cpu_ns() - st->cpu_start) / STRESS_DBL_NANOSECOND;
+	const double bytes = (double)st->bytes;
+	const uint64_t cycles = stress_cycles_get() - st->cycles_start;
+	char str[64];
+
+	if ((duration <= 0.0) || (st->bytes == 0))
+		return;
+
+	(void)snprintf(str, sizeof(str), "%s Gbit per sec", end);
+	stress_metrics_set(args, idx, str,
+		(bytes * 8.0) / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+	if (stress_cycles_supported()) {
+		(void)snprintf(str, sizeof(str), "%s CPU cycles per byte", end);
+		stress_metrics_set(args, idx + 1, str,
+			(cpu_secs * ((double)cycles / duration)) / bytes, STRESS_GEOMETRIC_MEAN);
+	} else {
+		(void)snprintf(str, sizeof(str), "%s CPU nanosecs per byte", end);
+		stress_metrics_set(args, idx + 1, str,
+			(cpu_secs * STRESS_DBL_NANOSECOND) / bytes, STRESS_GEOMETRIC_MEAN);
+	}
+	if (zerocopy) {
+		(void)snprintf(str, sizeof(str), "%% bytes %s without a copy", end);
+		stress_metrics_set(args, idx + 2, str,
+			100.0 * (double)st->zc_bytes / bytes, STRESS_GEOMETRIC_MEAN);
+	}
 }
 
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_TX)
 /*
- *  stress_sock_kernel_rt()
- * 	return true if kernel is PREEMPT_RT, true if
- * 	not sure, false if definitely not PREEMPT_RT.
+ *  stress_sock_stream_zc_reap()
+ *	gather MSG_ZEROCOPY completion notifications from the error
+ *	queue, a notification covers a range of send ids and flags
+ *	if the kernel fell back to copying the data
  */
-static bool stress_sock_kernel_rt(void)
+static void stress_sock_stream_zc_reap(stress_sock_conn_t *conn, stress_sock_stream_t *st)
 {
-#if defined(HAVE_UNAME) &&	\
-    defined(HAVE_SYS_UTSNAME_H)
-	struct utsname buf;
+	for (;;) {
+		struct msghdr msg;
+		char control[128];
+		struct cmsghdr *cm;
 
-	if (uname(&buf) < 0)
-		return true;	/* Not sure, assume rt */
+		(void)shim_memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(conn->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
 
-	if (strstr(buf.version, "PREEMPT_RT"))
-		return true;	/* Definitely rt */
+		for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			struct sock_extended_err serr;
+			uint32_t id, bytes = 0;
+
+			(void)shim_memcpy(&serr, CMSG_DATA(cm), sizeof(serr));
+			if ((serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY) || (serr.ee_errno != 0))
+				continue;
+			for (id = serr.ee_info; id != serr.ee_data + 1; id++)
+				bytes += conn->zc_size[id % STREAM_ZC_RING];
+			if (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				st->zc_copied += bytes;
+			else
+				st->zc_bytes += bytes;
+			conn->zc_done = serr.ee_data + 1;
+		}
+	}
+}
+#endif
 
-	/* probably not RT */
-	return false;
+/*
+ *  stress_sock_stream_send()
+ *	fill the socket send buffer of a writable connection,
+ *	returns -1 when the connection has gone
+ */
+static int stress_sock_stream_send(
+	stress_args_t *args,
+	stress_sock_conn_t *conn,
+	stress_sock_stream_t *st,
+	const char *buf,
+	const int sf_fd,
+	const bool zerocopy)
+{
+	int i;
+
+	for (i = 0; i < STREAM_SENDS_PER_WAKE; i++) {
+		int flags = MSG_DONTWAIT;
+		ssize_t n;
+
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_TX)
+		if (zerocopy) {
+			if ((conn->zc_next - conn->zc_done) >= STREAM_ZC_RING)
+				stress_sock_stream_zc_reap(conn, st);
+			if ((conn->zc_next - conn->zc_done) < STREAM_ZC_RING)
+				flags |= MSG_ZEROCOPY;
+		}
 #else
-	return true;		/* Not sure, assume rt */
+		(void)zerocopy;
+#endif
+#if defined(HAVE_SOCK_STREAM_SENDFILE)
+		if (sf_fd >= 0) {
+			n = sendfile(conn->fd, sf_fd, &conn->sf_off, STREAM_IO_SIZE);
+			if (conn->sf_off >= (off_t)STREAM_FILE_SIZE)
+				conn->sf_off = 0;
+		} else
+#else
+		(void)sf_fd;
+#endif
+		{
+			n = send(conn->fd, buf, STREAM_IO_SIZE, flags);
+		}
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS))
+				return 0;
+			if (stress_send_error(errno))
+				pr_fail("%s: send failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			return -1;
+		}
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_TX)
+		if (flags & MSG_ZEROCOPY) {
+			conn->zc_size[conn->zc_next % STREAM_ZC_RING] = (uint32_t)n;
+			conn->zc_next++;
+		}
+#endif
+		st->bytes += (uint64_t)n;
+		stress_bogo_inc(args);
+		if ((size_t)n < STREAM_IO_SIZE)
+			return 0;
+	}
+	return 0;
+}
+
+/*
+ *  stress_sock_stream_recv()
+ *	drain a readable connection, with zerocopy the payload is
+ *	mapped into rx_map with TCP_ZEROCOPY_RECEIVE and only the
+ *	unmappable remainder is copied, returns -1 at end of stream
+ */
+static int stress_sock_stream_recv(
+	stress_args_t *args,
+	stress_sock_conn_t *conn,
+	stress_sock_stream_t *st,
+	char *buf)
+{
+	for (;;) {
+		ssize_t n;
+		size_t len = MMAP_BUF_SIZE;
+
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_RX)
+		if (conn->rx_map) {
+			struct tcp_zerocopy_receive zc;
+			socklen_t zc_len = sizeof(zc);
+
+			(void)shim_memset(&zc, 0, sizeof(zc));
+			zc.address = (uint64_t)(uintptr_t)conn->rx_map;
+			zc.length = STREAM_RX_MAP_SIZE;
+			if (getsockopt(conn->fd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zc, &zc_len) < 0) {
+				if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+					return 0;
+				/* not supported on this socket, copy from now on */
+				(void)munmap(conn->rx_map, STREAM_RX_MAP_SIZE);
+				conn->rx_map = NULL;
+				continue;
+			}
+			st->bytes += zc.length;
+			st->zc_bytes += zc.length;
+			if ((zc.length == 0) && (zc.recv_skip_hint == 0)) {
+				/* nothing mappable, recv checks for end of stream */
+			} else if (zc.recv_skip_hint == 0) {
+				continue;
+			} else {
+				len = STRESS_MINIMUM(len, (size_t)zc.recv_skip_hint);
+			}
+		}
 #endif
+		n = recv(conn->fd, buf, len, MSG_DONTWAIT);
+		if (n == 0)
+			return -1;
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+				return 0;
+			if (errno != ECONNRESET)
+				pr_fail("%s: recv failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			return -1;
+		}
+		st->bytes += (uint64_t)n;
+	}
 }
 
+#if defined(HAVE_SOCK_STREAM_KTLS)
 /*
- *  stress_sock
- *	stress by heavy socket I/O
+ *  stress_sock_ktls_set()
+ *	attach the tls ULP and install a fixed AES-GCM-128 key for
+ *	the TLS_TX or TLS_RX direction, both ends use the same key
+ *	and start at record sequence zero so no handshake is needed
  */
-static int stress_sock(stress_args_t *args)
+static int stress_sock_ktls_set(const int fd, const int dir)
 {
-	pid_t pid, mypid = getpid();
-	int sock_opts = SOCKET_OPT_SEND;
-	int sock_domain = AF_INET;
-	int sock_type = SOCK_STREAM;
-	int sock_port = DEFAULT_SOCKET_PORT;
-	int sock_protocol = 0;
-	int sock_zerocopy = false;
-	int rc = EXIT_SUCCESS, reserved_port, parent_cpu;
-	const bool rt = stress_sock_kernel_rt();
-	char *mmap_buffer;
-	char *sock_if = NULL;
+	static const uint8_t key[TLS_CIPHER_AES_GCM_128_KEY_SIZE] = {
+		0x73, 0x74, 0x72, 0x65, 0x73, 0x73, 0x2d, 0x6e,
+		0x67, 0x20, 0x6b, 0x54, 0x4c, 0x53, 0x20, 0x31,
+	};
+	static const uint8_t iv[TLS_CIPHER_AES_GCM_128_IV_SIZE] = {
+		0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+	};
+	static const uint8_t salt[TLS_CIPHER_AES_GCM_128_SALT_SIZE] = {
+		0x0a, 0x0b, 0x0c, 0x0d,
+	};
+	struct tls12_crypto_info_aes_gcm_128 info;
+
+	if (setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) < 0)
+		return -1;
+
+	(void)shim_memset(&info, 0, sizeof(info));
+	info.info.version = TLS_1_2_VERSION;
+	info.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+	(void)shim_memcpy(info.key, key, sizeof(info.key));
+	(void)shim_memcpy(info.iv, iv, sizeof(info.iv));
+	(void)shim_memcpy(info.salt, salt, sizeof(info.salt));
+	return setsockopt(fd, SOL_TLS, dir, &info, sizeof(info));
+}
 
-	if (stress_sigchld_set_handler(args) < 0)
-		return EXIT_NO_RESOURCE;
+/*
+ *  stress_sock_ktls_phase()
+ *	only poll the plaintext or only the kTLS connections
+ *	for writability
+ */
+static void stress_sock_ktls_phase(
+	const int efd,
+	const stress_sock_conn_t *conns,
+	const uint32_t n_conns,
+	const bool tls)
+{
+	uint32_t i;
 
-	(void)stress_get_setting("sock-if", &sock_if);
-	(void)stress_get_setting("sock-domain", &sock_domain);
-	(void)stress_get_setting("sock-type", &sock_type);
-	(void)stress_get_setting("sock-protocol", &sock_protocol);
-	(void)stress_get_setting("sock-port", &sock_port);
-	(void)stress_get_setting("sock-opts", &sock_opts);
-	(void)stress_get_setting("sock-zerocopy", &sock_zerocopy);
+	for (i = 0; i < n_conns; i++) {
+		struct epoll_event ev;
 
-	if (sock_if) {
-		int ret;
-		struct sockaddr if_addr;
+		if (conns[i].fd < 0)
+			continue;
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		ev.events = (conns[i].tls == tls) ? EPOLLOUT : 0;
+		ev.data.u32 = i;
+		(void)epoll_ctl(efd, EPOLL_CTL_MOD, conns[i].fd, &ev);
+	}
+}
 
-		ret = stress_net_interface_exists(sock_if, sock_domain, &if_addr);
-		if (ret < 0) {
-			pr_inf("%s: interface '%s' is not enabled for domain '%s', defaulting to using loopback\n",
-				args->name, sock_if, stress_net_domain(sock_domain));
-			sock_if = NULL;
+/*
+ *  stress_sock_ktls_account()
+ *	add the counters since mark to total and restart mark
+ */
+static void stress_sock_ktls_account(
+	stress_sock_phase_t *total,
+	stress_sock_phase_t *mark,
+	const uint64_t bytes)
+{
+	const double t = stress_time_now();
+	const uint64_t cpu_ns = stress_sock_cpu_ns();
+	const uint64_t cycles = stress_cycles_get();
+
+	if (total) {
+		total->time += t - mark->time;
+		total->cpu_ns += cpu_ns - mark->cpu_ns;
+		total->cycles += cycles - mark->cycles;
+		total->bytes += bytes - mark->bytes;
+	}
+	mark->time = t;
+	mark->cpu_ns = cpu_ns;
+	mark->cycles = cycles;
+	mark->bytes = bytes;
+}
+
+/*
+ *  stress_sock_ktls_metrics()
+ *	report sender Gbit/s and CPU cost per byte for the plaintext
+ *	and kTLS phases and the kTLS to plaintext CPU cost ratio
+ */
+static void stress_sock_ktls_metrics(stress_args_t *args, const stress_sock_phase_t phases[2])
+{
+	static const char * const names[2] = { "plaintext", "kTLS" };
+	double per_byte[2] = { 0.0, 0.0 };
+	size_t i;
+
+	for (i = 0; i < 2; i++) {
+		const double duration = phases[i].time;
+		const double bytes = (double)phases[i].bytes;
+		const double cpu_secs = (double)phases[i].cpu_ns / STRESS_DBL_NANOSECOND;
+		char str[64];
+
+		if ((duration <= 0.0) || (phases[i].bytes == 0))
+			return;
+		(void)snprintf(str, sizeof(str), "%s sent Gbit per sec", names[i]);
+		stress_metrics_set(args, 7 + (2 * i), str,
+			(bytes * 8.0) / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+		if (stress_cycles_supported()) {
+			per_byte[i] = (cpu_secs * ((double)phases[i].cycles / duration)) / bytes;
+			(void)snprintf(str, sizeof(str), "%s sent CPU cycles per byte", names[i]);
+		} else {
+			per_byte[i] = (cpu_secs * STRESS_DBL_NANOSECOND) / bytes;
+			(void)snprintf(str, sizeof(str), "%s sent CPU nanosecs per byte", names[i]);
 		}
+		stress_metrics_set(args, 8 + (2 * i), str, per_byte[i], STRESS_GEOMETRIC_MEAN);
 	}
-	sock_port += args->instance;
-	reserved_port = stress_net_reserve_ports(sock_port, sock_port);
-	if (reserved_port < 0) {
-		pr_inf_skip("%s: cannot reserve port %d, skipping stressor\n",
-			args->name, sock_port);
-		return EXIT_NO_RESOURCE;
+	if (per_byte[0] > 0.0)
+		stress_metrics_set(args, 11, "kTLS to plaintext CPU per byte ratio",
+			per_byte[1] / per_byte[0], STRESS_GEOMETRIC_MEAN);
+}
+#endif
+
+#if defined(HAVE_SOCK_STREAM_SENDFILE)
+/*
+ *  stress_sock_stream_file()
+ *	create an unlinked STREAM_FILE_SIZE file filled from buf
+ *	as the sendfile source, returns -1 if it cannot be made
+ */
+static int stress_sock_stream_file(stress_args_t *args, const char *buf)
+{
+	char filename[PATH_MAX];
+	size_t i;
+	int fd, ret;
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0)
+		return -1;
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_inf("%s: cannot create sendfile source %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		(void)stress_temp_dir_rm_args(args);
+		return -1;
 	}
-	sock_port = reserved_port;
+	(void)shim_unlink(filename);
+	for (i = 0; i < STREAM_FILE_SIZE; i += MMAP_BUF_SIZE) {
+		if (write(fd, buf, MMAP_BUF_SIZE) != (ssize_t)MMAP_BUF_SIZE) {
+			pr_inf("%s: cannot write sendfile source, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			(void)close(fd);
+			(void)stress_temp_dir_rm_args(args);
+			return -1;
+		}
+	}
+	return fd;
+}
+#endif
 
-	pr_dbg("%s: process [%d] using socket port %d\n",
-		args->name, (int)args->pid, sock_port);
+/*
+ *  stress_sock_stream_close()
+ *	close all the streaming connections
+ */
+static void stress_sock_stream_close(stress_sock_conn_t *conns, const uint32_t n_conns)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_conns; i++) {
+		if (conns[i].rx_map)
+			(void)munmap(conns[i].rx_map, STREAM_RX_MAP_SIZE);
+		if (conns[i].fd >= 0) {
+			(void)shutdown(conns[i].fd, SHUT_RDWR);
+			(void)close(conns[i].fd);
+		}
+	}
+	free(conns);
+}
 
-	if (stress_sighandler(args->name, SIGPIPE, stress_sock_sigpipe_handler, NULL) < 0)
+/*
+ *  stress_sock_stream_client()
+ *	open sock_conns connections to the server and receive
+ *	from whichever are readable until the server closes them
+ */
+static int stress_sock_stream_client(
+	stress_args_t *args,
+	char *buf,
+	const pid_t mypid,
+	const int sock_domain,
+	const int sock_type,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if,
+	const uint32_t sock_conns,
+	const int sock_ktls,
+	const bool sock_zerocopy)
+{
+	stress_sock_conn_t *conns;
+	stress_sock_stream_t st;
+	struct epoll_event *events;
+	uint32_t i, open_conns = 0;
+	int efd, rc = EXIT_FAILURE;
+	double t_report;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	conns = (stress_sock_conn_t *)calloc(sock_conns, sizeof(*conns));
+	events = (struct epoll_event *)calloc(sock_conns, sizeof(*events));
+	if (!conns || !events) {
+		pr_inf("%s: cannot allocate %" PRIu32 " connections\n", args->name, sock_conns);
+		free(events);
+		free(conns);
 		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < sock_conns; i++)
+		conns[i].fd = -1;
 
-	mmap_buffer = (char *)stress_mmap_populate(NULL, MMAP_BUF_SIZE,
-				PROT_READ | PROT_WRITE,
-				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-	if (mmap_buffer == MAP_FAILED) {
-		pr_inf("%s: cannot mmap I/O buffer, errno=%d (%s)\n",
+	efd = epoll_create(sock_conns);
+	if (efd < 0) {
+		pr_fail("%s: epoll_create failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
-		return EXIT_NO_RESOURCE;
+		free(events);
+		stress_sock_stream_close(conns, sock_conns);
+		return EXIT_FAILURE;
 	}
 
-	stress_set_proc_state(args->name, STRESS_STATE_RUN);
-again:
-	parent_cpu = stress_get_cpu();
-	pid = fork();
-	if (pid < 0) {
-		if (stress_redo_fork(args, errno))
-			goto again;
-		if (!stress_continue(args)) {
+	for (i = 0; i < sock_conns; i++) {
+		struct sockaddr *addr;
+		socklen_t addr_len = 0;
+		struct epoll_event ev;
+		int retries = 0;
+
+		for (;;) {
+			if (!stress_continue_flag())
+				goto done;
+			conns[i].fd = socket(sock_domain, sock_type, sock_protocol);
+			if (conns[i].fd < 0) {
+				pr_fail("%s: socket failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				goto done;
+			}
+			if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+					sock_domain, sock_port, sock_if,
+					&addr, &addr_len, NET_ADDR_ANY) < 0)
+				goto done;
+			if (connect(conns[i].fd, addr, addr_len) == 0)
+				break;
+			(void)close(conns[i].fd);
+			conns[i].fd = -1;
+			(void)shim_usleep(10000);
+			if (++retries > 100) {
+				pr_fail("%s: connect failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				goto done;
+			}
+		}
+#if defined(HAVE_SOCK_STREAM_KTLS)
+		if (sock_ktls != SOCKET_KTLS_OFF) {
+			char marker = 'P';
+
+			/*
+			 *  the second half of the connections are kTLS, the
+			 *  marker tells the server if the receive key is in
+			 *  place, it is sent before any data can arrive
+			 */
+			if ((i >= sock_conns / 2) &&
+			    (stress_sock_ktls_set(conns[i].fd, TLS_RX) == 0)) {
+				conns[i].tls = true;
+				marker = 'T';
+			}
+			if (send(conns[i].fd, &marker, sizeof(marker), 0) != (ssize_t)sizeof(marker)) {
+				pr_fail("%s: send failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				goto done;
+			}
+		}
+#else
+		(void)sock_ktls;
+#endif
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_RX)
+		if (sock_zerocopy && ((sock_domain == AF_INET) || (sock_domain == AF_INET6))) {
+			conns[i].rx_map = mmap(NULL, STREAM_RX_MAP_SIZE, PROT_READ,
+					MAP_SHARED, conns[i].fd, 0);
+			if (conns[i].rx_map == MAP_FAILED) {
+				conns[i].rx_map = NULL;
+				if ((args->instance == 0) && (i == 0))
+					pr_inf("%s: cannot mmap socket for TCP_ZEROCOPY_RECEIVE, "
+						"errno=%d (%s)\n", args->name, errno, strerror(errno));
+			}
+		}
+#else
+		(void)sock_zerocopy;
+#endif
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		if (epoll_ctl(efd, EPOLL_CTL_ADD, conns[i].fd, &ev) < 0) {
+			pr_fail("%s: epoll_ctl failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto done;
+		}
+		open_conns++;
+	}
+
+	stress_sock_stream_begin(&st);
+	t_report = st.t_start + 1.0;
+	while (open_conns > 0) {
+		int j, n;
+		double t;
+
+		n = epoll_wait(efd, events, (int)sock_conns, 100);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_fail("%s: epoll_wait failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto done;
+		}
+		for (j = 0; j < n; j++) {
+			stress_sock_conn_t *conn = &conns[events[j].data.u32];
+
+			if (stress_sock_stream_recv(args, conn, &st, buf) < 0) {
+				(void)epoll_ctl(efd, EPOLL_CTL_DEL, conn->fd, NULL);
+				(void)close(conn->fd);
+				conn->fd = -1;
+				open_conns--;
+			}
+		}
+		/* the server kills the client when done, so report as we go */
+		t = stress_time_now();
+		if (t >= t_report) {
+			stress_sock_stream_metrics(args, 3, "received", &st, sock_zerocopy);
+			t_report = t + 1.0;
+		}
+		if (!stress_continue_flag())
+			break;
+	}
+	stress_sock_stream_metrics(args, 3, "received", &st, sock_zerocopy);
+	rc = EXIT_SUCCESS;
+done:
+	(void)close(efd);
+	free(events);
+	stress_sock_stream_close(conns, sock_conns);
+	return rc;
+}
+
+/*
+ *  stress_sock_stream_server()
+ *	accept sock_conns connections and keep all of them
+ *	streaming, epoll picks the writable connections
+ */
+static int stress_sock_stream_server(
+	stress_args_t *args,
+	char *buf,
+	const pid_t pid,
+	const pid_t ppid,
+	const int sock_domain,
+	const int sock_type,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if,
+	const uint32_t sock_conns,
+	const int sock_ktls,
+	const bool sock_zerocopy)
+{
+	stress_sock_conn_t *conns = NULL;
+	stress_sock_stream_t st;
+	struct epoll_event *events = NULL;
+	struct sockaddr *addr = NULL;
+	socklen_t addr_len = 0;
+	uint32_t i, open_conns = 0;
+	int fd, efd = -1, sf_fd = -1, so_reuseaddr = 1, rc = EXIT_FAILURE;
+	bool zerocopy = sock_zerocopy;
+#if defined(HAVE_SOCK_STREAM_KTLS)
+	stress_sock_phase_t phases[2], mark;
+	uint32_t n_tls = 0;
+	bool tls = false;
+	double t_phase = 0.0;
+
+	(void)shim_memset(phases, 0, sizeof(phases));
+	(void)shim_memset(&mark, 0, sizeof(mark));
+#else
+	(void)sock_ktls;
+#endif
+
+	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0)
+		goto die;
+
+	fd = socket(sock_domain, sock_type, sock_protocol);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die;
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+		&so_reuseaddr, sizeof(so_reuseaddr)) < 0) {
+		pr_fail("%s: setsockopt failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die_close;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, ppid,
+			sock_domain, sock_port, sock_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0)
+		goto die_close;
+	if (bind(fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed on port %d, errno=%d (%s)\n",
+			args->name, sock_port, errno, strerror(errno));
+		goto die_close;
+	}
+	if (listen(fd, (int)sock_conns) < 0) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die_close;
+	}
+
+	conns = (stress_sock_conn_t *)calloc(sock_conns, sizeof(*conns));
+	events = (struct epoll_event *)calloc(sock_conns, sizeof(*events));
+	if (!conns || !events) {
+		pr_inf("%s: cannot allocate %" PRIu32 " connections\n", args->name, sock_conns);
+		rc = EXIT_NO_RESOURCE;
+		goto die_close;
+	}
+	for (i = 0; i < sock_conns; i++)
+		conns[i].fd = -1;
+
+	efd = epoll_create(sock_conns);
+	if (efd < 0) {
+		pr_fail("%s: epoll_create failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die_close;
+	}
+
+	(void)shim_memset(buf, stress_ascii64[args->instance & 63], MMAP_BUF_SIZE);
+#if defined(HAVE_SOCK_STREAM_SENDFILE)
+	if (sock_ktls == SOCKET_KTLS_SENDFILE)
+		sf_fd = stress_sock_stream_file(args, buf);
+#endif
+
+	for (i = 0; i < sock_conns; i++) {
+		struct epoll_event ev;
+
+		do {
+			conns[i].fd = accept(fd, (struct sockaddr *)NULL, NULL);
+		} while ((conns[i].fd < 0) && (errno == EINTR) && stress_continue(args));
+		if (conns[i].fd < 0) {
+			if (stress_continue(args))
+				pr_fail("%s: accept failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+			else
+				rc = EXIT_SUCCESS;
+			goto die_close;
+		}
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_TX)
+		if (zerocopy) {
+			int so_zerocopy = 1;
+
+			if (setsockopt(conns[i].fd, SOL_SOCKET, SO_ZEROCOPY,
+				       &so_zerocopy, sizeof(so_zerocopy)) < 0) {
+				if (args->instance == 0)
+					pr_inf("%s: cannot enable zerocopy on data being sent\n", args->name);
+				zerocopy = false;
+			}
+		}
+#endif
+#if defined(HAVE_SOCK_STREAM_KTLS)
+		if (sock_ktls != SOCKET_KTLS_OFF) {
+			char marker;
+
+			if (recv(conns[i].fd, &marker, sizeof(marker), MSG_WAITALL) != (ssize_t)sizeof(marker)) {
+				pr_fail("%s: recv failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				goto die_close;
+			}
+			if (marker == 'T') {
+				if (stress_sock_ktls_set(conns[i].fd, TLS_TX) < 0) {
+					if ((args->instance == 0) && (n_tls == 0))
+						pr_inf("%s: cannot set kTLS transmit key, errno=%d (%s)\n",
+							args->name, errno, strerror(errno));
+					/* the client expects records, drop the connection */
+					(void)close(conns[i].fd);
+					conns[i].fd = -1;
+					continue;
+				}
+				conns[i].tls = true;
+				n_tls++;
+			}
+			if (sf_fd >= 0)
+				(void)fcntl(conns[i].fd, F_SETFL, O_NONBLOCK);
+		}
+#endif
+		(void)shim_memset(&ev, 0, sizeof(ev));
+		/* kTLS connections wait for their first phase */
+		ev.events = conns[i].tls ? 0 : EPOLLOUT;
+		ev.data.u32 = i;
+		if (epoll_ctl(efd, EPOLL_CTL_ADD, conns[i].fd, &ev) < 0) {
+			pr_fail("%s: epoll_ctl failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto die_close;
+		}
+		open_conns++;
+	}
+
+#if defined(HAVE_SOCK_STREAM_KTLS)
+	if ((sock_ktls != SOCKET_KTLS_OFF) && (n_tls == 0) && (args->instance == 0))
+		pr_inf("%s: kernel TLS not available, only streaming plaintext\n", args->name);
+#endif
+	stress_sock_stream_begin(&st);
+#if defined(HAVE_SOCK_STREAM_KTLS)
+	stress_sock_ktls_account(NULL, &mark, 0);
+	t_phase = mark.time + STREAM_PHASE_SECS;
+#endif
+	while ((open_conns > 0) && stress_continue(args)) {
+		int j, n;
+
+		n = epoll_wait(efd, events, (int)sock_conns, 100);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pr_fail("%s: epoll_wait failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto die_close;
+		}
+		for (j = 0; j < n; j++) {
+			stress_sock_conn_t *conn = &conns[events[j].data.u32];
+
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_TX)
+			if (zerocopy)
+				stress_sock_stream_zc_reap(conn, &st);
+#endif
+			if (stress_sock_stream_send(args, conn, &st, buf, sf_fd, zerocopy) < 0) {
+				(void)epoll_ctl(efd, EPOLL_CTL_DEL, conn->fd, NULL);
+				(void)close(conn->fd);
+				conn->fd = -1;
+				open_conns--;
+			}
+		}
+#if defined(HAVE_SOCK_STREAM_KTLS)
+		/* alternate between plaintext and kTLS to compare like for like */
+		if ((n_tls > 0) && (stress_time_now() >= t_phase)) {
+			stress_sock_ktls_account(&phases[tls], &mark, st.bytes);
+			tls = !tls;
+			stress_sock_ktls_phase(efd, conns, sock_conns, tls);
+			t_phase = mark.time + STREAM_PHASE_SECS;
+		}
+#endif
+	}
+#if defined(HAVE_SOCK_STREAM_KTLS)
+	if (sock_ktls != SOCKET_KTLS_OFF) {
+		stress_sock_ktls_account(&phases[tls], &mark, st.bytes);
+		stress_sock_ktls_metrics(args, phases);
+	}
+#endif
+#if defined(HAVE_SOCK_STREAM_ZEROCOPY_TX)
+	/* late completions, the data is in flight so do not wait long */
+	if (zerocopy) {
+		for (i = 0; i < sock_conns; i++) {
+			if (conns[i].fd >= 0)
+				stress_sock_stream_zc_reap(&conns[i], &st);
+		}
+	}
+#endif
+	stress_sock_stream_metrics(args, 0, "sent", &st, zerocopy);
+	if (zerocopy && (st.zc_bytes + st.zc_copied > 0)) {
+		stress_metrics_set(args, 6, "% zerocopy sent bytes copied by kernel",
+			100.0 * (double)st.zc_copied / (double)(st.zc_bytes + st.zc_copied),
+			STRESS_GEOMETRIC_MEAN);
+	}
+	rc = EXIT_SUCCESS;
+
+die_close:
+	if (efd >= 0)
+		(void)close(efd);
+	free(events);
+	if (conns)
+		stress_sock_stream_close(conns, sock_conns);
+	if (sf_fd >= 0) {
+		(void)close(sf_fd);
+		(void)stress_temp_dir_rm_args(args);
+	}
+	(void)close(fd);
+die:
+#if defined(AF_UNIX) &&		\
+    defined(HAVE_SOCKADDR_UN)
+	if (addr && (sock_domain == AF_UNIX)) {
+		const struct sockaddr_un *addr_un = (struct sockaddr_un *)addr;
+
+		(void)shim_unlink(addr_un->sun_path);
+	}
+#endif
+	if (pid)
+		(void)stress_kill_pid_wait(pid, NULL);
+	return rc;
+}
+#endif
+
+/*
+ *  stress_sock_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_sock_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+#if defined(MSG_NOSIGNAL)
+#define SOCK_RR_SEND_FLAGS	(MSG_NOSIGNAL)
+#else
+#define SOCK_RR_SEND_FLAGS	(0)
+#endif
+
+/*
+ *  stress_sock_rr_xfer()
+ *	send or receive exactly size bytes, returns -1 on
+ *	error, errno is zero if the peer closed the connection
+ */
+static int stress_sock_rr_xfer(const int fd, char *buf, const size_t size, const bool do_send)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		const ssize_t n = do_send ?
+			send(fd, buf + done, size - done, SOCK_RR_SEND_FLAGS) :
+			recv(fd, buf + done, size - done, 0);
+
+		if (UNLIKELY(n <= 0)) {
+			if (n == 0) {
+				errno = 0;
+				return -1;
+			}
+			if ((errno == EINTR) && stress_continue_flag())
+				continue;
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ *  stress_sock_rr_nodelay()
+ *	small requests and responses must not wait for Nagle
+ */
+static void stress_sock_rr_nodelay(const int fd, const int sock_domain)
+{
+#if defined(TCP_NODELAY)
+	if ((sock_domain == AF_INET) || (sock_domain == AF_INET6)) {
+		int one = 1;
+
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+#else
+	(void)fd;
+	(void)sock_domain;
+#endif
+}
+
+/*
+ *  stress_sock_rr_connect()
+ *	connect to the rr server, retrying while it starts up
+ *	or while ephemeral ports are short in crr mode
+ */
+static int stress_sock_rr_connect(
+	stress_args_t *args,
+	const pid_t mypid,
+	const int sock_domain,
+	const int sock_type,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if)
+{
+	int retries = 0;
+
+	while (stress_continue(args)) {
+		struct sockaddr *addr;
+		socklen_t addr_len = 0;
+		int fd;
+
+		fd = socket(sock_domain, sock_type, sock_protocol);
+		if (fd < 0) {
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+				sock_domain, sock_port, sock_if,
+				&addr, &addr_len, NET_ADDR_ANY) < 0) {
+			(void)close(fd);
+			return -1;
+		}
+		if (connect(fd, addr, addr_len) == 0) {
+			stress_sock_rr_nodelay(fd, sock_domain);
+			return fd;
+		}
+		(void)close(fd);
+		(void)shim_usleep(10000);
+		if (++retries > 100) {
+			pr_fail("%s: connect failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+	}
+	return -1;
+}
+
+/*
+ *  stress_sock_rr_close()
+ *	close with an abortive RST in crr mode so that the client
+ *	does not run out of ports with connections in TIME_WAIT
+ */
+static void stress_sock_rr_close(const int fd, const int sock_rr)
+{
+#if defined(SO_LINGER)
+	if (sock_rr == SOCKET_RR_CRR) {
+		struct linger lin;
+
+		lin.l_onoff = 1;
+		lin.l_linger = 0;
+		(void)setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+	}
+#else
+	(void)sock_rr;
+#endif
+	(void)close(fd);
+}
+
+/*
+ *  stress_sock_rr_server()
+ *	answer each request of req_size bytes with resp_size
+ *	bytes until the client closes the connection
+ */
+static int stress_sock_rr_server(
+	stress_args_t *args,
+	char *buf,
+	const pid_t ppid,
+	const int sock_domain,
+	const int sock_type,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if,
+	const size_t req_size,
+	const size_t resp_size)
+{
+	struct sockaddr *addr;
+	socklen_t addr_len = 0;
+	int fd, so_reuseaddr = 1, rc = EXIT_FAILURE;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	fd = socket(sock_domain, sock_type, sock_protocol);
+	if (fd < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+		&so_reuseaddr, sizeof(so_reuseaddr)) < 0) {
+		pr_fail("%s: setsockopt failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die_close;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, ppid,
+			sock_domain, sock_port, sock_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0)
+		goto die_close;
+	if (bind(fd, addr, addr_len) < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: bind failed on port %d, errno=%d (%s)\n",
+			args->name, sock_port, errno, strerror(errno));
+		goto die_close;
+	}
+	if (listen(fd, 64) < 0) {
+		pr_fail("%s: listen failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto die_close;
+	}
+
+	(void)shim_memset(buf, stress_ascii64[args->instance & 63], resp_size);
+	while (stress_continue_flag()) {
+		const int sfd = accept(fd, (struct sockaddr *)NULL, NULL);
+
+		if (sfd < 0) {
+			if ((errno == EINTR) || (errno == ECONNABORTED))
+				continue;
+			pr_fail("%s: accept failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto die_close;
+		}
+		stress_sock_rr_nodelay(sfd, sock_domain);
+		while (stress_continue_flag()) {
+			if (stress_sock_rr_xfer(sfd, buf, req_size, false) < 0)
+				break;
+			if (stress_sock_rr_xfer(sfd, buf, resp_size, true) < 0)
+				break;
+		}
+		(void)close(sfd);
+	}
+	rc = EXIT_SUCCESS;
+
+die_close:
+	(void)close(fd);
+	return rc;
+}
+
+/*
+ *  stress_sock_rr_client()
+ *	issue requests and time each round trip to the end of its
+ *	response, rr keeps depth requests in flight on one connection,
+ *	crr also times the connect and close of each transaction
+ */
+static int stress_sock_rr_client(
+	stress_args_t *args,
+	char *buf,
+	const pid_t pid,
+	const pid_t mypid,
+	const int sock_domain,
+	const int sock_type,
+	const int sock_protocol,
+	const int sock_port,
+	const char *sock_if,
+	const int sock_rr,
+	const size_t req_size,
+	const size_t resp_size,
+	const uint32_t depth)
+{
+	uint64_t t_sent[MAX_SOCKET_RR_DEPTH];
+	uint64_t transactions = 0;
+	uint32_t head = 0, i;
+	double t_start, duration;
+	int fd = -1, rc = EXIT_FAILURE;
+
+	t_start = stress_time_now();
+	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0)
+		goto done;
+	(void)shim_memset(buf, stress_ascii64[args->instance & 63], req_size);
+
+	if (sock_rr == SOCKET_RR_CRR) {
+		while (stress_continue(args)) {
+			const uint64_t t = stress_sock_now_ns();
+
+			fd = stress_sock_rr_connect(args, mypid, sock_domain,
+				sock_type, sock_protocol, sock_port, sock_if);
+			if (fd < 0) {
+				if (!stress_continue(args))
+					break;
+				goto done;
+			}
+			if ((stress_sock_rr_xfer(fd, buf, req_size, true) < 0) ||
+			    (stress_sock_rr_xfer(fd, buf, resp_size, false) < 0))
+				goto xfer_fail;
+			stress_sock_rr_close(fd, sock_rr);
+			fd = -1;
+			stress_latency_add(args->latency, stress_sock_now_ns() - t);
+			transactions++;
+			stress_bogo_inc(args);
+		}
+	} else {
+		fd = stress_sock_rr_connect(args, mypid, sock_domain,
+			sock_type, sock_protocol, sock_port, sock_if);
+		if (fd < 0) {
+			if (!stress_continue(args))
+				rc = EXIT_SUCCESS;
+			goto done;
+		}
+		for (i = 0; i < depth; i++) {
+			t_sent[i] = stress_sock_now_ns();
+			if (stress_sock_rr_xfer(fd, buf, req_size, true) < 0)
+				goto xfer_fail;
+		}
+		while (stress_continue(args)) {
+			if (stress_sock_rr_xfer(fd, buf, resp_size, false) < 0)
+				goto xfer_fail;
+			stress_latency_add(args->latency, stress_sock_now_ns() - t_sent[head]);
+			transactions++;
+			stress_bogo_inc(args);
+
+			/* responses arrive in order, reuse the completed slot */
+			t_sent[head] = stress_sock_now_ns();
+			if (stress_sock_rr_xfer(fd, buf, req_size, true) < 0)
+				goto xfer_fail;
+			head = (head + 1 < depth) ? head + 1 : 0;
+		}
+		stress_sock_rr_close(fd, sock_rr);
+		fd = -1;
+	}
+	rc = EXIT_SUCCESS;
+	goto done;
+
+xfer_fail:
+	if (stress_continue(args) && (errno != EINTR)) {
+		pr_fail("%s: request/response failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+	} else {
+		rc = EXIT_SUCCESS;
+	}
+	if (fd >= 0)
+		(void)close(fd);
+done:
+	duration = stress_time_now() - t_start;
+	stress_metrics_set(args, 0, "transactions per sec",
+		(duration > 0.0) ? (double)transactions / duration : 0.0,
+		STRESS_HARMONIC_MEAN);
+#if defined(AF_UNIX) &&		\
+    defined(HAVE_SOCKADDR_UN)
+	if (sock_domain == AF_UNIX) {
+		struct sockaddr *addr;
+		socklen_t addr_len = 0;
+
+		if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+				sock_domain, sock_port, sock_if,
+				&addr, &addr_len, NET_ADDR_ANY) == 0) {
+			const struct sockaddr_un *addr_un = (struct sockaddr_un *)addr;
+
+			(void)shim_unlink(addr_un->sun_path);
+		}
+	}
+#endif
+	if (pid)
+		(void)stress_kill_pid_wait(pid, NULL);
+	return rc;
+}
+
+static void stress_sock_sigpipe_handler(int signum)
+{
+	(void)signum;
+
+	stress_continue_set_flag(false);
+}
+
+/*
+ *  stress_sock_kernel_rt()
+ * 	return true if kernel is PREEMPT_RT, true if
+ * 	not sure, false if definitely not PREEMPT_RT.
+ */
+static bool stress_sock_kernel_rt(void)
+{
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	struct utsname buf;
+
+	if (uname(&buf) < 0)
+		return true;	/* Not sure, assume rt */
+
+	if (strstr(buf.version, "PREEMPT_RT"))
+		return true;	/* Definitely rt */
+
+	/* probably not RT */
+	return false;
+#else
+	return true;		/* Not sure, assume rt */
+#endif
+}
+
+/*
+ *  stress_sock
+ *	stress by heavy socket I/O
+ */
+static int stress_sock(stress_args_t *args)
+{
+	pid_t pid, mypid = getpid();
+	int sock_opts = SOCKET_OPT_SEND;
+	int sock_domain = AF_INET;
+	int sock_type = SOCK_STREAM;
+	int sock_port = DEFAULT_SOCKET_PORT;
+	int sock_protocol = 0;
+	int sock_zerocopy = false;
+	uint32_t sock_conns = 0, sock_rr_depth = 1;
+	size_t sock_rr_req = 1, sock_rr_resp = 1;
+	int sock_rr = SOCKET_RR_OFF;
+	int sock_ktls = SOCKET_KTLS_OFF;
+	int rc = EXIT_SUCCESS, reserved_port, parent_cpu;
+	const bool rt = stress_sock_kernel_rt();
+	char *mmap_buffer;
+	char *sock_if = NULL;
+
+	if (stress_sigchld_set_handler(args) < 0)
+		return EXIT_NO_RESOURCE;
+
+	(void)stress_get_setting("sock-if", &sock_if);
+	(void)stress_get_setting("sock-domain", &sock_domain);
+	(void)stress_get_setting("sock-type", &sock_type);
+	(void)stress_get_setting("sock-protocol", &sock_protocol);
+	(void)stress_get_setting("sock-port", &sock_port);
+	(void)stress_get_setting("sock-opts", &sock_opts);
+	(void)stress_get_setting("sock-zerocopy", &sock_zerocopy);
+	(void)stress_get_setting("sock-conns", &sock_conns);
+	(void)stress_get_setting("sock-rr", &sock_rr);
+	(void)stress_get_setting("sock-rr-depth", &sock_rr_depth);
+	(void)stress_get_setting("sock-rr-req", &sock_rr_req);
+	(void)stress_get_setting("sock-rr-resp", &sock_rr_resp);
+	(void)stress_get_setting("sock-ktls", &sock_ktls);
+
+	if (sock_rr != SOCKET_RR_OFF) {
+		const size_t max_size = STRESS_MAXIMUM(sock_rr_req, sock_rr_resp);
+		const uint32_t max_depth = (uint32_t)(MAX_SOCKET_RR_INFLIGHT / max_size);
+
+		if (sock_type != SOCK_STREAM) {
+			if (args->instance == 0)
+				pr_inf("%s: --sock-rr needs the stream socket type, ignoring it\n",
+					args->name);
+			sock_rr = SOCKET_RR_OFF;
+		}
+		/* blocking pipelined I/O must fit in the socket buffers */
+		if (sock_rr_depth > max_depth) {
+			if (args->instance == 0)
+				pr_inf("%s: limiting --sock-rr-depth to %" PRIu32 " for %zu byte messages\n",
+					args->name, max_depth, max_size);
+			sock_rr_depth = max_depth;
+		}
+		sock_conns = 0;
+		sock_ktls = SOCKET_KTLS_OFF;
+	}
+
+	if (sock_ktls != SOCKET_KTLS_OFF) {
+#if defined(HAVE_SOCK_STREAM_KTLS)
+		if ((sock_domain != AF_INET) && (sock_domain != AF_INET6)) {
+			if (args->instance == 0)
+				pr_inf("%s: --sock-ktls needs the ipv4 or ipv6 domain, ignoring it\n",
+					args->name);
+			sock_ktls = SOCKET_KTLS_OFF;
+		} else {
+			/* half plaintext and half kTLS streaming connections */
+			sock_conns = STRESS_MAXIMUM(sock_conns, 1) * 2;
+			sock_zerocopy = false;
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --sock-ktls needs linux/tls.h and epoll, ignoring it\n",
+				args->name);
+		sock_ktls = SOCKET_KTLS_OFF;
+#endif
+	}
+
+	if (sock_conns > 0) {
+#if defined(HAVE_SOCK_STREAM_CONNS)
+		const size_t max_conns = stress_get_file_limit() / 2;
+
+		if (sock_type != SOCK_STREAM) {
+			if (args->instance == 0)
+				pr_inf("%s: --sock-conns needs the stream socket type, ignoring it\n",
+					args->name);
+			sock_conns = 0;
+		} else if ((size_t)sock_conns > max_conns) {
+			if (args->instance == 0)
+				pr_inf("%s: file descriptor limit allows only %zu connections\n",
+					args->name, max_conns);
+			sock_conns = (uint32_t)STRESS_MAXIMUM(max_conns, 1);
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --sock-conns needs epoll, ignoring it\n", args->name);
+		sock_conns = 0;
+#endif
+	}
+
+	if (sock_if) {
+		int ret;
+		struct sockaddr if_addr;
+
+		ret = stress_net_interface_exists(sock_if, sock_domain, &if_addr);
+		if (ret < 0) {
+			pr_inf("%s: interface '%s' is not enabled for domain '%s', defaulting to using loopback\n",
+				args->name, sock_if, stress_net_domain(sock_domain));
+			sock_if = NULL;
+		}
+	}
+	sock_port += args->instance;
+	reserved_port = stress_net_reserve_ports(sock_port, sock_port);
+	if (reserved_port < 0) {
+		pr_inf_skip("%s: cannot reserve port %d, skipping stressor\n",
+			args->name, sock_port);
+		return EXIT_NO_RESOURCE;
+	}
+	sock_port = reserved_port;
+
+	pr_dbg("%s: process [%d] using socket port %d\n",
+		args->name, (int)args->pid, sock_port);
+
+	if (stress_sighandler(args->name, SIGPIPE, stress_sock_sigpipe_handler, NULL) < 0)
+		return EXIT_NO_RESOURCE;
+
+	mmap_buffer = (char *)stress_mmap_populate(NULL, MMAP_BUF_SIZE,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (mmap_buffer == MAP_FAILED) {
+		pr_inf("%s: cannot mmap I/O buffer, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+again:
+	parent_cpu = stress_get_cpu();
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (!stress_continue(args)) {
 			rc = EXIT_SUCCESS;
 			(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
 			goto finish;
@@ -1482,15 +2921,44 @@ again:
 	} else if (pid == 0) {
 		(void)stress_change_cpu(args, parent_cpu);
 
-		rc = stress_sock_client(args, mmap_buffer, mypid, sock_opts,
-			sock_domain, sock_type, sock_protocol,
-			sock_port, sock_if, rt, sock_zerocopy);
+		if (sock_rr != SOCKET_RR_OFF) {
+			rc = stress_sock_rr_server(args, mmap_buffer, mypid,
+				sock_domain, sock_type, sock_protocol,
+				sock_port, sock_if, sock_rr_req, sock_rr_resp);
+			(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
+			_exit(rc);
+		}
+#if defined(HAVE_SOCK_STREAM_CONNS)
+		if (sock_conns > 0)
+			rc = stress_sock_stream_client(args, mmap_buffer, mypid,
+				sock_domain, sock_type, sock_protocol,
+				sock_port, sock_if, sock_conns, sock_ktls,
+				sock_zerocopy);
+		else
+#endif
+			rc = stress_sock_client(args, mmap_buffer, mypid, sock_opts,
+				sock_domain, sock_type, sock_protocol,
+				sock_port, sock_if, rt, sock_zerocopy);
 		(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
 		_exit(rc);
 	} else {
-		rc = stress_sock_server(args, mmap_buffer, pid, mypid, sock_opts,
-			sock_domain, sock_type, sock_protocol,
-			sock_port, sock_if, rt, sock_zerocopy);
+		if (sock_rr != SOCKET_RR_OFF)
+			rc = stress_sock_rr_client(args, mmap_buffer, pid, mypid,
+				sock_domain, sock_type, sock_protocol,
+				sock_port, sock_if, sock_rr, sock_rr_req,
+				sock_rr_resp, sock_rr_depth);
+		else
+#if defined(HAVE_SOCK_STREAM_CONNS)
+		if (sock_conns > 0)
+			rc = stress_sock_stream_server(args, mmap_buffer, pid, mypid,
+				sock_domain, sock_type, sock_protocol,
+				sock_port, sock_if, sock_conns, sock_ktls,
+				sock_zerocopy);
+		else
+#endif
+			rc = stress_sock_server(args, mmap_buffer, pid, mypid, sock_opts,
+				sock_domain, sock_type, sock_protocol,
+				sock_port, sock_if, rt, sock_zerocopy);
 		(void)munmap((void *)mmap_buffer, MMAP_BUF_SIZE);
 
 	}
@@ -1502,13 +2970,19 @@ finish:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sock_conns,	stress_set_sock_conns },
 	{ OPT_sock_domain,	stress_set_sock_domain },
 	{ OPT_sock_if,		stress_set_sock_if },
+	{ OPT_sock_ktls,	stress_set_sock_ktls },
 	{ OPT_sock_msgs,	stress_set_sock_msgs },
 	{ OPT_sock_opts,	stress_set_sock_opts },
 	{ OPT_sock_type,	stress_set_sock_type },
 	{ OPT_sock_port,	stress_set_sock_port },
 	{ OPT_sock_protocol,	stress_set_sock_protocol },
+	{ OPT_sock_rr,		stress_set_sock_rr },
+	{ OPT_sock_rr_depth,	stress_set_sock_rr_depth },
+	{ OPT_sock_rr_req,	stress_set_sock_rr_req },
+	{ OPT_sock_rr_resp,	stress_set_sock_rr_resp },
 	{ OPT_sock_zerocopy,	stress_set_sock_zerocopy },
 	{ 0,			NULL }
 };
@@ -21,7 +21,9 @@
 #include "core-affinity.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-net.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_NETINET_TCP_H)
 #include <netinet/tcp.h>
@@ -36,13 +38,41 @@ UNEXPECTED
 #define SOCKET_MANY_BUF		(8)
 #define SOCKET_MANY_FDS		(100000)
 
+#define MIN_SOCKET_MANY_CHURN	(1)
+#define MAX_SOCKET_MANY_CHURN	(64)
+
 typedef struct {
 	int max_fd;
 	int fds[SOCKET_MANY_FDS];
 } stress_sock_fds_t;
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(SO_REUSEPORT)
+#define STRESS_SOCKMANY_CHURN
+
+typedef struct {
+	struct sockaddr_storage addr;	/* listening address */
+	socklen_t addr_len;
+	bool fastopen;			/* send the request in the SYN */
+	volatile bool stop;
+} stress_sockmany_churn_t;
+
+typedef struct {
+	stress_sockmany_churn_t *churn;
+	pthread_t pthread;
+	int sfd;			/* server listening socket */
+	uint64_t conns;			/* connections completed */
+	uint64_t fastopens;		/* connections with data in the SYN */
+	uint64_t exhausted;		/* connects failed with EADDRNOTAVAIL */
+	uint64_t failed;		/* other connect or reply failures */
+	stress_latency_t latency;	/* connect to first reply latency */
+} stress_sockmany_churn_thread_t;
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL, "sockmany N",		"start N workers exercising many socket connections" },
+	{ NULL,	"sockmany-churn N",	"open and close connections as fast as possible with N listener threads" },
+	{ NULL,	"sockmany-fastopen",	"use TCP_FASTOPEN in sockmany-churn mode" },
 	{ NULL,	"sockmany-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"sockmany-ops N",	"stop after N sockmany bogo operations" },
 	{ NULL,	"sockmany-port",	"use socket ports P to P + number of workers - 1" },
@@ -67,6 +97,25 @@ static int stress_set_sockmany_if(const char *name)
 	return stress_set_setting("sockmany-if", TYPE_ID_STR, name);
 }
 
+/*
+ *  stress_set_sockmany_churn()
+ *	set number of SO_REUSEPORT listener and client threads
+ */
+static int stress_set_sockmany_churn(const char *opt)
+{
+	uint32_t sockmany_churn;
+
+	sockmany_churn = stress_get_uint32(opt);
+	stress_check_range("sockmany-churn", (uint64_t)sockmany_churn,
+		MIN_SOCKET_MANY_CHURN, MAX_SOCKET_MANY_CHURN);
+	return stress_set_setting("sockmany-churn", TYPE_ID_UINT32, &sockmany_churn);
+}
+
+static int stress_set_sockmany_fastopen(const char *opt)
+{
+	return stress_set_setting_true("sockmany-fastopen", opt);
+}
+
 /*
  *  stress_sockmany_cleanup()
  *	close sockets
@@ -292,6 +341,310 @@ die:
 	return rc;
 }
 
+#if defined(STRESS_SOCKMANY_CHURN)
+/*
+ *  stress_sockmany_churn_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_sockmany_churn_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_sockmany_churn_server()
+ *	accept, read the request, reply and close as fast as
+ *	possible on one SO_REUSEPORT listener
+ */
+static void *stress_sockmany_churn_server(void *arg)
+{
+	stress_sockmany_churn_thread_t *t = (stress_sockmany_churn_thread_t *)arg;
+	char buf[SOCKET_MANY_BUF];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigdelset(&set, SIGKILL);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	(void)shim_memset(buf, 'r', sizeof(buf));
+
+	for (;;) {
+		const int sfd = accept(t->sfd, NULL, NULL);
+
+		if (UNLIKELY(sfd < 0)) {
+			/* out of fds or aborted connections, just keep going */
+			(void)shim_sched_yield();
+			continue;
+		}
+		if (LIKELY(recv(sfd, buf, sizeof(buf), MSG_WAITALL) == (ssize_t)sizeof(buf)))
+			(void)send(sfd, buf, sizeof(buf), MSG_NOSIGNAL);
+		(void)close(sfd);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_sockmany_churn_client()
+ *	connect, send a request, wait for the reply and close in a
+ *	tight loop, the latency covers the handshake, the wait in the
+ *	accept queue and the first reply
+ */
+static void *stress_sockmany_churn_client(void *arg)
+{
+	stress_sockmany_churn_thread_t *t = (stress_sockmany_churn_thread_t *)arg;
+	const stress_sockmany_churn_t *churn = t->churn;
+	char buf[SOCKET_MANY_BUF];
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+	(void)shim_memset(buf, 'q', sizeof(buf));
+
+	while (!churn->stop) {
+		struct timeval tv;
+		const uint64_t t_start = stress_sockmany_churn_now_ns();
+		ssize_t n;
+		int fd, ret;
+
+		fd = socket(churn->addr.ss_family, SOCK_STREAM, 0);
+		if (UNLIKELY(fd < 0)) {
+			(void)shim_sched_yield();
+			continue;
+		}
+		tv.tv_sec = 1;
+		tv.tv_usec = 0;
+		(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+#if defined(MSG_FASTOPEN)
+		if (churn->fastopen) {
+			/* the request goes in the SYN if the kernel has a cookie */
+			n = sendto(fd, buf, sizeof(buf), MSG_FASTOPEN | MSG_NOSIGNAL,
+				(const struct sockaddr *)&churn->addr, churn->addr_len);
+			ret = (n == (ssize_t)sizeof(buf)) ? 0 : -1;
+		} else
+#endif
+		{
+			ret = connect(fd, (const struct sockaddr *)&churn->addr, churn->addr_len);
+			if (LIKELY(ret == 0))
+				ret = (send(fd, buf, sizeof(buf), MSG_NOSIGNAL) == (ssize_t)sizeof(buf)) ? 0 : -1;
+		}
+		if (UNLIKELY(ret < 0)) {
+			/* ephemeral ports used up, or the accept queue overflowed */
+			if (errno == EADDRNOTAVAIL)
+				t->exhausted++;
+			else
+				t->failed++;
+			(void)close(fd);
+			(void)shim_usleep(1000);
+			continue;
+		}
+		n = recv(fd, buf, sizeof(buf), MSG_WAITALL);
+		if (LIKELY(n == (ssize_t)sizeof(buf))) {
+			stress_latency_add(&t->latency, stress_sockmany_churn_now_ns() - t_start);
+			t->conns++;
+#if defined(SOL_TCP) &&		\
+    defined(TCP_INFO) &&	\
+    defined(TCPI_OPT_SYN_DATA)
+			if (churn->fastopen) {
+				struct tcp_info info;
+				socklen_t len = sizeof(info);
+
+				if ((getsockopt(fd, SOL_TCP, TCP_INFO, &info, &len) == 0) &&
+				    (info.tcpi_options & TCPI_OPT_SYN_DATA))
+					t->fastopens++;
+			}
+#endif
+		} else {
+			t->failed++;
+		}
+		(void)close(fd);
+	}
+	return NULL;
+}
+
+/*
+ *  stress_sockmany_churn()
+ *	establish and close connections as fast as possible, the
+ *	child process accepts on churn_threads SO_REUSEPORT listeners
+ *	sharing the port, each with its own thread, and the same
+ *	number of client threads in this process connect to them
+ */
+static int stress_sockmany_churn(
+	stress_args_t *args,
+	const int sockmany_port,
+	const pid_t mypid,
+	const char *sockmany_if,
+	const uint32_t churn_threads,
+	const bool fastopen)
+{
+	stress_sockmany_churn_thread_t *servers, *clients;
+	stress_sockmany_churn_t churn;
+	struct sockaddr *addr = NULL;
+	uint64_t conns = 0, fastopens = 0, exhausted = 0, failed = 0;
+	uint32_t i, n_clients = 0;
+	int rc = EXIT_SUCCESS, parent_cpu;
+	double t_start, duration;
+	pid_t pid;
+
+	(void)shim_memset(&churn, 0, sizeof(churn));
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			AF_INET, sockmany_port, sockmany_if,
+			&addr, &churn.addr_len, NET_ADDR_ANY) < 0)
+		return EXIT_FAILURE;
+	if (churn.addr_len > sizeof(churn.addr))
+		return EXIT_FAILURE;
+	(void)shim_memcpy(&churn.addr, addr, churn.addr_len);
+	churn.fastopen = fastopen;
+
+	servers = (stress_sockmany_churn_thread_t *)calloc((size_t)churn_threads, sizeof(*servers));
+	clients = (stress_sockmany_churn_thread_t *)calloc((size_t)churn_threads, sizeof(*clients));
+	if (!servers || !clients) {
+		pr_inf_skip("%s: cannot allocate thread state, skipping stressor\n", args->name);
+		free(clients);
+		free(servers);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* listeners are created before the fork so clients never race a bind */
+	for (i = 0; i < churn_threads; i++)
+		servers[i].sfd = -1;
+	for (i = 0; i < churn_threads; i++) {
+		int sfd, one = 1;
+
+		sfd = socket(AF_INET, SOCK_STREAM, 0);
+		if (sfd < 0) {
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		servers[i].sfd = sfd;
+		(void)setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if (setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+			pr_inf_skip("%s: setsockopt SO_REUSEPORT failed, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fds;
+		}
+#if defined(SOL_TCP) &&	\
+    defined(TCP_FASTOPEN)
+		if (fastopen) {
+			int qlen = SOMAXCONN;
+
+			/* server side needs net.ipv4.tcp_fastopen bit 2 set to take effect */
+			(void)setsockopt(sfd, SOL_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen));
+		}
+#endif
+		if (bind(sfd, (struct sockaddr *)&churn.addr, churn.addr_len) < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: bind failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_fds;
+		}
+		if (listen(sfd, SOMAXCONN) < 0) {
+			pr_fail("%s: listen failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+	}
+
+again:
+	parent_cpu = stress_get_cpu();
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (stress_continue(args)) {
+			pr_err("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		goto close_fds;
+	} else if (pid == 0) {
+		(void)stress_change_cpu(args, parent_cpu);
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+
+		for (i = 1; i < churn_threads; i++)
+			(void)pthread_create(&servers[i].pthread, NULL,
+				stress_sockmany_churn_server, &servers[i]);
+		(void)stress_sockmany_churn_server(&servers[0]);
+		_exit(EXIT_SUCCESS);
+	}
+
+	for (i = 0; i < churn_threads; i++) {
+		clients[i].churn = &churn;
+		if (pthread_create(&clients[i].pthread, NULL, stress_sockmany_churn_client, &clients[i]))
+			break;
+		n_clients++;
+	}
+	if (n_clients == 0) {
+		pr_inf_skip("%s: cannot create client threads, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+	}
+
+	t_start = stress_time_now();
+	while ((rc == EXIT_SUCCESS) && stress_continue(args)) {
+		uint64_t total = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_clients; i++)
+			total += clients[i].conns;
+		stress_bogo_set(args, total);
+	}
+	churn.stop = true;
+	for (i = 0; i < n_clients; i++)
+		(void)pthread_join(clients[i].pthread, NULL);
+	duration = stress_time_now() - t_start;
+	(void)stress_kill_pid_wait(pid, NULL);
+
+	for (i = 0; i < n_clients; i++) {
+		const stress_sockmany_churn_thread_t *t = &clients[i];
+
+		conns += t->conns;
+		fastopens += t->fastopens;
+		exhausted += t->exhausted;
+		failed += t->failed;
+		stress_latency_merge(args->latency, &t->latency);
+	}
+	stress_bogo_set(args, conns);
+
+	if ((rc == EXIT_SUCCESS) && (duration > 0.0)) {
+		pr_dbg("%s: %" PRIu32 " listeners, %" PRIu64 " connections, %" PRIu64
+			" with data in the SYN, %" PRIu64 " connects out of ports, %"
+			PRIu64 " failed connects\n", args->name, churn_threads,
+			conns, fastopens, exhausted, failed);
+		stress_metrics_set(args, 0, "connections per sec",
+			(double)conns / duration, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "connects out of ports per sec",
+			(double)exhausted / duration, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "failed connects per sec",
+			(double)failed / duration, STRESS_GEOMETRIC_MEAN);
+		if (fastopen)
+			stress_metrics_set(args, 3, "% connections with data in SYN",
+				conns ? 100.0 * (double)fastopens / (double)conns : 0.0,
+				STRESS_GEOMETRIC_MEAN);
+	}
+
+close_fds:
+	for (i = 0; i < churn_threads; i++) {
+		if (servers[i].sfd >= 0)
+			(void)close(servers[i].sfd);
+	}
+	free(clients);
+	free(servers);
+
+	return rc;
+}
+#endif
+
 static void stress_sockmany_sigpipe_handler(int signum)
 {
 	(void)signum;
@@ -310,10 +663,14 @@ static int stress_sockmany(stress_args_t *args)
 	int sockmany_port = DEFAULT_SOCKET_MANY_PORT;
 	int rc = EXIT_SUCCESS, reserved_port, parent_cpu;
 	char *sockmany_if = NULL;
+	uint32_t sockmany_churn = 0;
+	bool sockmany_fastopen = false;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
+	(void)stress_get_setting("sockmany-churn", &sockmany_churn);
+	(void)stress_get_setting("sockmany-fastopen", &sockmany_fastopen);
 	(void)stress_get_setting("sockmany-if", &sockmany_if);
 	(void)stress_get_setting("sockmany-port", &sockmany_port);
 
@@ -341,6 +698,26 @@ static int stress_sockmany(stress_args_t *args)
 	pr_dbg("%s: process [%d] using socket port %d\n",
 		args->name, (int)args->pid, sockmany_port);
 
+	if (sockmany_churn) {
+		if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0) {
+			stress_net_release_ports(sockmany_port, sockmany_port);
+			return EXIT_NO_RESOURCE;
+		}
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+#if defined(STRESS_SOCKMANY_CHURN)
+		rc = stress_sockmany_churn(args, sockmany_port, ppid, sockmany_if,
+				sockmany_churn, sockmany_fastopen);
+#else
+		(void)sockmany_fastopen;
+		pr_inf_skip("%s: sockmany-churn requires pthreads and SO_REUSEPORT, "
+			"skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+#endif
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		stress_net_release_ports(sockmany_port, sockmany_port);
+		return rc;
+	}
+
 	sock_fds = (stress_sock_fds_t *)stress_mmap_populate(NULL, sizeof(*sock_fds),
 		PROT_READ | PROT_WRITE,
 		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
@@ -389,6 +766,8 @@ finish:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sockmany_churn,	stress_set_sockmany_churn },
+	{ OPT_sockmany_fastopen, stress_set_sockmany_fastopen },
 	{ OPT_sockmany_if,	stress_set_sockmany_if },
 	{ OPT_sockmany_port,	stress_set_sockmany_port },
 	{ 0,			NULL },
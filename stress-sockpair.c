@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-ipc-sweep.h"
 #include "core-killpid.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
@@ -30,6 +31,7 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"sockpair N",	  "start N workers exercising socket pair I/O activity" },
+	{ NULL,	"sockpair-ipc-sweep", "sweep stream and ping-pong message sizes 8B..1MB" },
 	{ NULL,	"sockpair-ops N", "stop after N socket pair bogo operations" },
 	{ NULL,	NULL,		  NULL }
 };
@@ -333,6 +335,65 @@ finish:
 	return EXIT_SUCCESS;
 }
 
+/* one AF_UNIX stream socket pair carries both directions of the IPC sweep */
+typedef struct {
+	int fds[2];
+} stress_sockpair_ipc_t;
+
+static int stress_sockpair_ipc_open(stress_args_t *args, void *ctxt, size_t *max_chunk)
+{
+	stress_sockpair_ipc_t *ipc = (stress_sockpair_ipc_t *)ctxt;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, ipc->fds) < 0) {
+		pr_inf_skip("%s: socketpair failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	*max_chunk = SIZE_MAX;
+	return 0;
+}
+
+static void stress_sockpair_ipc_close(void *ctxt)
+{
+	stress_sockpair_ipc_t *ipc = (stress_sockpair_ipc_t *)ctxt;
+
+	(void)close(ipc->fds[0]);
+	(void)close(ipc->fds[1]);
+}
+
+static ssize_t stress_sockpair_ipc_send(void *ctxt, const int dir, const void *buf, const size_t len)
+{
+	stress_sockpair_ipc_t *ipc = (stress_sockpair_ipc_t *)ctxt;
+
+	/* the parent sends on fds[0] and the child on fds[1] */
+	return write(ipc->fds[dir == STRESS_IPC_TO_CHILD ? 0 : 1], buf, len);
+}
+
+static ssize_t stress_sockpair_ipc_recv(void *ctxt, const int dir, void *buf, const size_t len)
+{
+	stress_sockpair_ipc_t *ipc = (stress_sockpair_ipc_t *)ctxt;
+
+	return read(ipc->fds[dir == STRESS_IPC_TO_CHILD ? 1 : 0], buf, len);
+}
+
+static const stress_ipc_transport_t stress_sockpair_ipc_transport = {
+	"sockpair",
+	stress_sockpair_ipc_open,
+	stress_sockpair_ipc_close,
+	stress_sockpair_ipc_send,
+	stress_sockpair_ipc_recv,
+};
+
+static int stress_set_sockpair_ipc_sweep(const char *opt)
+{
+	return stress_set_setting_true("sockpair-ipc-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sockpair_ipc_sweep,	stress_set_sockpair_ipc_sweep },
+	{ 0,				NULL }
+};
+
 /*
  *  stress_sockpair
  *	stress by heavy socket_pair I/O
@@ -340,7 +401,14 @@ finish:
 static int stress_sockpair(stress_args_t *args)
 {
 	int rc;
+	bool sockpair_ipc_sweep = false;
+
+	(void)stress_get_setting("sockpair-ipc-sweep", &sockpair_ipc_sweep);
+	if (sockpair_ipc_sweep) {
+		stress_sockpair_ipc_t ipc;
 
+		return stress_ipc_sweep(args, &stress_sockpair_ipc_transport, &ipc);
+	}
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	if (stress_sighandler(args->name, SIGPIPE, stress_sighandler_nop, NULL) < 0)
@@ -356,6 +424,7 @@ static int stress_sockpair(stress_args_t *args)
 stressor_info_t stress_sockpair_info = {
 	.stressor = stress_sockpair,
 	.class = CLASS_NETWORK | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
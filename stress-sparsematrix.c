@@ -17,8 +17,11 @@
  *
  */
 #include "stress-ng.h"
+#include "core-art.h"
 #include "core-builtin.h"
+#include "core-open-hash.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_SYS_TREE_H)
 #include <sys/tree.h>
@@ -106,9 +109,11 @@ static const stress_sparsematrix_method_info_t sparsematrix_methods[];
 static const stress_help_t help[] = {
 	{ NULL,	"sparsematrix N",	 "start N workers that exercise a sparse matrix" },
 	{ NULL,	"sparsematrix-items N",	 "N is the number of items in the spare matrix" },
-	{ NULL,	"sparsematrix-method M", "select storage method: all, hash, hashjudy, judy, list, mmap, qhash, rb, splay" },
+	{ NULL,	"sparsematrix-method M", "select storage method: all, art, hash, hashjudy, judy, list, mmap, qhash, rb, robinhood, splay, swiss" },
 	{ NULL,	"sparsematrix-ops N",	 "stop after N bogo sparse matrix operations" },
 	{ NULL,	"sparsematrix-size N",	 "M is the width and height X x Y of the matrix" },
+	{ NULL,	"sparsematrix-spmv P",	 "run CSR and ELL matrix-vector multiplies, P: banded, none, powerlaw, random" },
+	{ NULL,	"sparsematrix-threads N", "run matrix-vector multiplies on N threads, 0 = no threads" },
 	{ NULL,	NULL,		 	 NULL }
 };
 
@@ -198,12 +203,20 @@ typedef struct {
 	uint32_t y;
 } sparse_mmap_t;
 
+typedef struct {
+	stress_art_t art;	/* adaptive radix tree */
+	size_t bytes_max;	/* peak tree size in bytes */
+} sparse_art_t;
+
 typedef struct {
 	size_t	max_objmem;	/* Object memory allocation estimate */
 	double	put_duration;	/* Total put duration time, seconds */
 	double	get_duration;	/* Total get duration time, seconds */
+	double	del_duration;	/* Total del duration time, seconds */
 	uint64_t put_ops;	/* Total put object op count */
-	uint64_t get_ops;	/* Total put object op count */
+	uint64_t get_ops;	/* Total get object op count */
+	uint64_t del_ops;	/* Total del object op count */
+	uint64_t items;		/* Number of items per test */
 	bool	skip_no_mem;	/* True if can't allocate memory */
 } test_info_t;
 
@@ -523,6 +536,168 @@ static void qhash_del(void *handle, const uint32_t x, const uint32_t y)
 		node->value = 0;
 }
 
+/*
+ *  art_create()
+ *	create an adaptive radix tree based sparse matrix
+ */
+static void *art_create(const uint64_t n, const uint32_t x, const uint32_t y)
+{
+	sparse_art_t *table;
+
+	(void)n;
+	(void)x;
+	(void)y;
+
+	table = (sparse_art_t *)malloc(sizeof(*table));
+	if (!table)
+		return NULL;
+	stress_art_init(&table->art);
+	table->bytes_max = 0;
+	return (void *)table;
+}
+
+/*
+ *  art_destroy()
+ *	destroy an adaptive radix tree based sparse matrix
+ */
+static void art_destroy(void *handle, size_t *objmem)
+{
+	sparse_art_t *table = (sparse_art_t *)handle;
+
+	*objmem = 0;
+	if (!table)
+		return;
+	/* items are deleted before the destroy, so use the peak size */
+	*objmem = sizeof(*table) + table->bytes_max;
+	stress_art_free(&table->art);
+	free(table);
+}
+
+/*
+ *  art_put()
+ *	put a value into an adaptive radix tree based sparse matrix
+ */
+static int OPTIMIZE3 art_put(void *handle, const uint32_t x, const uint32_t y, const uint32_t value)
+{
+	sparse_art_t *table = (sparse_art_t *)handle;
+	const uint64_t xy = ((uint64_t)x << 32) | y;
+
+	if (!stress_art_insert(&table->art, xy, value))
+		return -1;
+	if (table->art.bytes > table->bytes_max)
+		table->bytes_max = table->art.bytes;
+	return 0;
+}
+
+/*
+ *  art_get()
+ *	get the (x,y) value in an adaptive radix tree based sparse matrix
+ */
+static uint32_t OPTIMIZE3 art_get(void *handle, const uint32_t x, const uint32_t y)
+{
+	const sparse_art_t *table = (sparse_art_t *)handle;
+	const uint64_t xy = ((uint64_t)x << 32) | y;
+	const uint64_t *value = stress_art_get(&table->art, xy);
+
+	return value ? (uint32_t)*value : 0;
+}
+
+/*
+ *  art_del()
+ *	remove the (x,y) value from an adaptive radix tree
+ */
+static void art_del(void *handle, const uint32_t x, const uint32_t y)
+{
+	sparse_art_t *table = (sparse_art_t *)handle;
+	const uint64_t xy = ((uint64_t)x << 32) | y;
+
+	(void)stress_art_delete(&table->art, xy);
+}
+
+/*
+ *  open_hash_create()
+ *	create an open addressing hash table based sparse matrix
+ */
+static void *open_hash_create(const stress_open_hash_type_t type, const uint64_t n)
+{
+	if (n > SIZE_MAX)
+		return NULL;
+	return (void *)stress_open_hash_create(type, (size_t)n, NULL, NULL);
+}
+
+/*
+ *  open_hash_destroy()
+ *	destroy an open addressing hash table based sparse matrix
+ */
+static void open_hash_destroy(void *handle, size_t *objmem)
+{
+	stress_open_hash_t *table = (stress_open_hash_t *)handle;
+
+	*objmem = 0;
+	if (!table)
+		return;
+	*objmem = stress_open_hash_bytes(table);
+	stress_open_hash_destroy(table);
+}
+
+/*
+ *  open_hash_put()
+ *	put a value into an open addressing hash table based sparse matrix
+ */
+static int OPTIMIZE3 open_hash_put(void *handle, const uint32_t x, const uint32_t y, const uint32_t value)
+{
+	const uint64_t xy = ((uint64_t)x << 32) | y;
+
+	return stress_open_hash_put((stress_open_hash_t *)handle, xy, value) ? 0 : -1;
+}
+
+/*
+ *  open_hash_get()
+ *	get the (x,y) value in an open addressing hash table based sparse matrix
+ */
+static uint32_t OPTIMIZE3 open_hash_get(void *handle, const uint32_t x, const uint32_t y)
+{
+	const uint64_t xy = ((uint64_t)x << 32) | y;
+	const uint64_t *value = stress_open_hash_get((stress_open_hash_t *)handle, xy);
+
+	return value ? (uint32_t)*value : 0;
+}
+
+/*
+ *  open_hash_del()
+ *	remove the (x,y) value from an open addressing hash table
+ */
+static void open_hash_del(void *handle, const uint32_t x, const uint32_t y)
+{
+	const uint64_t xy = ((uint64_t)x << 32) | y;
+
+	(void)stress_open_hash_del((stress_open_hash_t *)handle, xy);
+}
+
+/*
+ *  robinhood_create()
+ *	create a robin hood hash table based sparse matrix
+ */
+static void *robinhood_create(const uint64_t n, const uint32_t x, const uint32_t y)
+{
+	(void)x;
+	(void)y;
+
+	return open_hash_create(STRESS_OPEN_HASH_ROBINHOOD, n);
+}
+
+/*
+ *  swiss_create()
+ *	create a swiss table hash based sparse matrix
+ */
+static void *swiss_create(const uint64_t n, const uint32_t x, const uint32_t y)
+{
+	(void)x;
+	(void)y;
+
+	return open_hash_create(STRESS_OPEN_HASH_SWISS, n);
+}
+
 #if defined(HAVE_JUDY)
 
 /*
@@ -1192,6 +1367,7 @@ static int stress_sparse_method_test(
 	test_info->get_duration += (t2 - t1);
 
 	stress_mwc_set_seed(w, z);
+	t1 = stress_time_now();
 	for (i = 0; stress_continue_flag() && (i < sparsematrix_items); i++) {
 		const uint32_t x = stress_mwc32modn(sparsematrix_size);
 		const uint32_t y = stress_mwc32modn(sparsematrix_size);
@@ -1200,6 +1376,9 @@ static int stress_sparse_method_test(
 
 		info->del(handle, x, y);
 	}
+	t2 = stress_time_now();
+	test_info->del_ops += i;
+	test_info->del_duration += (t2 - t1);
 err:
 	info->destroy(handle, &objmem);
 	if (objmem > test_info->max_objmem)
@@ -1321,11 +1500,453 @@ static uint32_t mmap_get(void *handle, const uint32_t x, const uint32_t y)
 	return *((uint32_t *)(m->mmap) + offset);
 }
 
+/*
+ *  Sparse matrix-vector multiply, y = A.x, with A held in compressed
+ *  sparse row (CSR) and ELLPACK (ELL) forms. CSR stores the non-zero
+ *  elements row by row with a row start offset array, ELL pads every
+ *  row to the longest row and stores the elements column major so
+ *  consecutive rows are contiguous in memory. Values and the input
+ *  vector are small integers so sums are exact and the CSR and ELL
+ *  results can be compared bit for bit.
+ */
+#define SPMV_PATTERN_NONE	(0)
+#define SPMV_PATTERN_BANDED	(1)
+#define SPMV_PATTERN_POWERLAW	(2)
+#define SPMV_PATTERN_RANDOM	(3)
+
+#define SPMV_ELL_PAD_MAX	(4)		/* max ELL size / non-zero elements */
+#define SPMV_WORK		(16 * MB)	/* elements processed per kernel pass */
+#define SPMV_REPS_MAX		(4096)
+
+#define MIN_SPARSEMATRIX_THREADS	(0)
+#define MAX_SPARSEMATRIX_THREADS	(64)
+
+typedef struct {
+	size_t n;		/* rows and columns */
+	size_t nnz;		/* non-zero elements */
+	size_t *row_ptr;	/* CSR row start offsets, n + 1 entries */
+	uint32_t *col;		/* CSR column indices */
+	double *val;		/* CSR values */
+	size_t ell_width;	/* ELL elements per row, 0 = no ELL */
+	uint32_t *ell_col;	/* ELL column indices, column major */
+	double *ell_val;	/* ELL values, column major, zero padded */
+	double *x;		/* input vector */
+	double *y;		/* CSR result vector */
+	double *y_ell;		/* ELL result vector */
+} spmv_matrix_t;
+
+typedef struct {
+	double duration;	/* time spent in kernel */
+	double flops;		/* floating point operations performed */
+	double bytes;		/* bytes of matrix and vectors touched */
+} spmv_stats_t;
+
+static const char * const spmv_patterns[] = {
+	"none",
+	"banded",
+	"powerlaw",
+	"random",
+};
+
+/*
+ *  stress_set_sparsematrix_spmv()
+ *	set the sparse matrix-vector multiply sparsity pattern
+ */
+static int stress_set_sparsematrix_spmv(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(spmv_patterns); i++) {
+		if (!strcmp(spmv_patterns[i], opt)) {
+			stress_set_setting("sparsematrix-spmv", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "sparsematrix-spmv must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(spmv_patterns); i++)
+		(void)fprintf(stderr, " %s", spmv_patterns[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_set_sparsematrix_threads()
+ *	set number of sparse matrix-vector multiply threads
+ */
+static int stress_set_sparsematrix_threads(const char *opt)
+{
+	uint32_t sparsematrix_threads;
+
+	sparsematrix_threads = stress_get_uint32(opt);
+	stress_check_range("sparsematrix-threads", (uint64_t)sparsematrix_threads,
+		MIN_SPARSEMATRIX_THREADS, MAX_SPARSEMATRIX_THREADS);
+	return stress_set_setting("sparsematrix-threads", TYPE_ID_UINT32, &sparsematrix_threads);
+}
+
+static int spmv_col_cmp(const void *p1, const void *p2)
+{
+	const uint32_t c1 = *(const uint32_t *)p1;
+	const uint32_t c2 = *(const uint32_t *)p2;
+
+	return (c1 > c2) - (c1 < c2);
+}
+
+/*
+ *  spmv_free()
+ *	free matrix and vectors
+ */
+static void spmv_free(spmv_matrix_t *m)
+{
+	free(m->row_ptr);
+	free(m->col);
+	free(m->val);
+	free(m->ell_col);
+	free(m->ell_val);
+	free(m->x);
+	free(m->y);
+	free(m->y_ell);
+	(void)shim_memset(m, 0, sizeof(*m));
+}
+
+/*
+ *  spmv_create()
+ *	create a n x n matrix with about nnz non-zero elements in
+ *	the given sparsity pattern, returns -1 if out of memory
+ */
+static int spmv_create(
+	stress_args_t *args,
+	spmv_matrix_t *m,
+	const size_t n,
+	const size_t nnz,
+	const size_t pattern)
+{
+	size_t r, k, max_len = 0;
+
+	(void)shim_memset(m, 0, sizeof(*m));
+	m->n = n;
+	m->row_ptr = (size_t *)calloc(n + 1, sizeof(*m->row_ptr));
+	m->x = (double *)calloc(n, sizeof(*m->x));
+	m->y = (double *)calloc(n, sizeof(*m->y));
+	m->y_ell = (double *)calloc(n, sizeof(*m->y_ell));
+	if (!m->row_ptr || !m->x || !m->y || !m->y_ell)
+		goto err;
+
+	/* row lengths, stored in row_ptr[r + 1] */
+	switch (pattern) {
+	case SPMV_PATTERN_POWERLAW:
+		/*
+		 *  cubing a uniform random number piles the elements
+		 *  into the first rows, a few rows are very long and
+		 *  most rows are short or empty, as in graph adjacency
+		 *  matrices
+		 */
+		for (k = 0; k < nnz; k++) {
+			const double u = (double)stress_mwc32() / 4294967296.0;
+
+			r = (size_t)((double)n * u * u * u);
+			if (r >= n)
+				r = n - 1;
+			if (m->row_ptr[r + 1] < n)
+				m->row_ptr[r + 1]++;
+		}
+		break;
+	default:
+		for (r = 0; r < n; r++)
+			m->row_ptr[r + 1] = (nnz / n) + ((r < (nnz % n)) ? 1 : 0);
+		break;
+	}
+	for (r = 0; r < n; r++) {
+		if (m->row_ptr[r + 1] > max_len)
+			max_len = m->row_ptr[r + 1];
+		m->row_ptr[r + 1] += m->row_ptr[r];
+	}
+	m->nnz = m->row_ptr[n];
+
+	m->col = (uint32_t *)calloc(m->nnz, sizeof(*m->col));
+	m->val = (double *)calloc(m->nnz, sizeof(*m->val));
+	if (!m->col || !m->val)
+		goto err;
+
+	for (r = 0; r < n; r++) {
+		const size_t begin = m->row_ptr[r];
+		const size_t len = m->row_ptr[r + 1] - begin;
+
+		if (pattern == SPMV_PATTERN_BANDED) {
+			/* contiguous band of columns around the diagonal */
+			size_t start = (r > len / 2) ? r - len / 2 : 0;
+
+			if (start + len > n)
+				start = n - len;
+			for (k = 0; k < len; k++)
+				m->col[begin + k] = (uint32_t)(start + k);
+		} else {
+			for (k = 0; k < len; k++)
+				m->col[begin + k] = stress_mwc32modn((uint32_t)n);
+			qsort(&m->col[begin], len, sizeof(*m->col), spmv_col_cmp);
+		}
+		for (k = 0; k < len; k++)
+			m->val[begin + k] = (double)(1 + (stress_mwc8() & 7));
+	}
+	for (r = 0; r < n; r++)
+		m->x[r] = (double)((int)(r % 13) - 6);
+
+	/* ELL, skipped if row padding makes it far larger than CSR */
+	if ((max_len > 0) && (n * max_len <= (SPMV_ELL_PAD_MAX * m->nnz) + n)) {
+		m->ell_col = (uint32_t *)calloc(n * max_len, sizeof(*m->ell_col));
+		m->ell_val = (double *)calloc(n * max_len, sizeof(*m->ell_val));
+		if (!m->ell_col || !m->ell_val) {
+			free(m->ell_col);
+			free(m->ell_val);
+			m->ell_col = NULL;
+			m->ell_val = NULL;
+		} else {
+			m->ell_width = max_len;
+			for (r = 0; r < n; r++) {
+				const size_t begin = m->row_ptr[r];
+				const size_t len = m->row_ptr[r + 1] - begin;
+
+				for (k = 0; k < len; k++) {
+					m->ell_col[(k * n) + r] = m->col[begin + k];
+					m->ell_val[(k * n) + r] = m->val[begin + k];
+				}
+			}
+		}
+	}
+	if ((m->ell_width == 0) && (args->instance == 0))
+		pr_inf("%s: ELL sparse matrix-vector multiply skipped, longest row of %zu "
+			"elements needs too much padding or memory\n", args->name, max_len);
+	return 0;
+
+err:
+	spmv_free(m);
+	return -1;
+}
+
+/*
+ *  spmv_csr()
+ *	y = A.x for rows begin..end-1 of a CSR matrix
+ */
+static void OPTIMIZE3 spmv_csr(const spmv_matrix_t *m, const size_t begin, const size_t end)
+{
+	const size_t *row_ptr = m->row_ptr;
+	const uint32_t *col = m->col;
+	const double *val = m->val;
+	const double *x = m->x;
+	double *y = m->y;
+	register size_t r;
+
+	for (r = begin; r < end; r++) {
+		register size_t k;
+		register double sum = 0.0;
+
+		for (k = row_ptr[r]; k < row_ptr[r + 1]; k++)
+			sum += val[k] * x[col[k]];
+		y[r] = sum;
+	}
+}
+
+/*
+ *  spmv_ell()
+ *	y = A.x for rows begin..end-1 of an ELL matrix, the inner
+ *	loop runs down the rows so it streams through the columns
+ */
+static void OPTIMIZE3 spmv_ell(const spmv_matrix_t *m, const size_t begin, const size_t end)
+{
+	const uint32_t *col = m->ell_col;
+	const double *val = m->ell_val;
+	const double *x = m->x;
+	double *y = m->y_ell;
+	const size_t n = m->n;
+	register size_t r, k;
+
+	for (r = begin; r < end; r++)
+		y[r] = 0.0;
+	for (k = 0; k < m->ell_width; k++) {
+		const size_t offset = k * n;
+
+		for (r = begin; r < end; r++)
+			y[r] += val[offset + r] * x[col[offset + r]];
+	}
+}
+
+/*
+ *  spmv_kernel()
+ *	run reps CSR or ELL multiplies over rows begin..end-1
+ */
+static void spmv_kernel(
+	const spmv_matrix_t *m,
+	const bool ell,
+	const size_t begin,
+	const size_t end,
+	const size_t reps)
+{
+	size_t i;
+
+	for (i = 0; (i < reps) && stress_continue_flag(); i++) {
+		if (ell)
+			spmv_ell(m, begin, end);
+		else
+			spmv_csr(m, begin, end);
+	}
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	stress_pthread_args_t pargs;
+	pthread_t pthread;
+	const spmv_matrix_t *m;
+	volatile bool *start;
+	bool ell;
+	size_t begin;		/* first row */
+	size_t end;		/* last row + 1 */
+	size_t reps;		/* multiplies to perform */
+} spmv_thread_t;
+
+/*
+ *  spmv_thread()
+ *	multiply a block of rows
+ */
+static void *spmv_thread(void *arg)
+{
+	spmv_thread_t *t = (spmv_thread_t *)arg;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	while (!*t->start)
+		shim_sched_yield();
+
+	spmv_kernel(t->m, t->ell, t->begin, t->end, t->reps);
+	return NULL;
+}
+#endif
+
+/*
+ *  spmv_run()
+ *	run a CSR or ELL multiply pass on n_threads threads, or in
+ *	the calling process if n_threads is zero. CSR rows are split
+ *	so each thread gets about the same number of elements, ELL
+ *	rows are all the same length so are split evenly.
+ */
+static void spmv_run(
+	stress_args_t *args,
+	const spmv_matrix_t *m,
+	const bool ell,
+	const uint32_t n_threads,
+	spmv_stats_t *stats)
+{
+	const size_t elements = ell ? m->n * m->ell_width : m->nnz;
+	size_t reps = SPMV_WORK / (elements + m->n + 1);
+	double t, bytes;
+
+	if (reps < 1)
+		reps = 1;
+	if (reps > SPMV_REPS_MAX)
+		reps = SPMV_REPS_MAX;
+
+#if defined(HAVE_LIB_PTHREAD)
+	if (n_threads > 0) {
+		spmv_thread_t threads[MAX_SPARSEMATRIX_THREADS];
+		volatile bool start = false;
+		uint32_t j, started = 0;
+		size_t r = 0;
+
+		for (j = 0; j < n_threads; j++) {
+			spmv_thread_t *th = &threads[j];
+
+			th->pargs.args = args;
+			th->m = m;
+			th->start = &start;
+			th->ell = ell;
+			th->reps = reps;
+			th->begin = r;
+			if (ell) {
+				r = (m->n * (j + 1)) / n_threads;
+			} else {
+				const size_t target = (m->nnz * (j + 1)) / n_threads;
+
+				while ((r < m->n) && (m->row_ptr[r + 1] <= target))
+					r++;
+				if (j == n_threads - 1)
+					r = m->n;
+			}
+			th->end = r;
+			if (pthread_create(&th->pthread, NULL, spmv_thread, th))
+				break;
+			started++;
+		}
+		t = stress_time_now();
+		start = true;
+		for (j = 0; j < started; j++)
+			(void)pthread_join(threads[j].pthread, NULL);
+		t = stress_time_now() - t;
+
+		if (started != n_threads) {
+			/* complete the rows the missing threads would have done */
+			pr_dbg("%s: could only start %" PRIu32 " of %" PRIu32 " threads\n",
+				args->name, started, n_threads);
+			spmv_kernel(m, ell, started ? threads[started].begin : 0, m->n, reps);
+			return;
+		}
+	} else
+#else
+	(void)args;
+	(void)n_threads;
+#endif
+	{
+		t = stress_time_now();
+		spmv_kernel(m, ell, 0, m->n, reps);
+		t = stress_time_now() - t;
+	}
+
+	/* matrix and column indices, row offsets or not, x read and y written */
+	bytes = (double)elements * (double)(sizeof(double) + sizeof(uint32_t)) +
+		(double)m->n * (double)(2 * sizeof(double));
+	if (!ell)
+		bytes += (double)(m->n + 1) * (double)sizeof(size_t);
+
+	stats->duration += t;
+	stats->flops += 2.0 * (double)m->nnz * (double)reps;
+	stats->bytes += bytes * (double)reps;
+}
+
+/*
+ *  spmv_verify()
+ *	check the CSR and ELL results are identical and that
+ *	the sum of y matches the sum of all the A.x products
+ */
+static int spmv_verify(stress_args_t *args, const spmv_matrix_t *m)
+{
+	double sum_y = 0.0, sum_ax = 0.0;
+	size_t r, k;
+
+	for (k = 0; k < m->nnz; k++)
+		sum_ax += m->val[k] * m->x[m->col[k]];
+	for (r = 0; r < m->n; r++) {
+		sum_y += m->y[r];
+		if ((m->ell_width > 0) && (m->y[r] != m->y_ell[r])) {
+			pr_fail("%s: ELL sparse matrix-vector multiply row %zu is %.0f, "
+				"CSR row is %.0f\n", args->name, r, m->y_ell[r], m->y[r]);
+			return -1;
+		}
+	}
+	if (sum_y != sum_ax) {
+		pr_fail("%s: CSR sparse matrix-vector multiply result sum is %.0f, "
+			"expected %.0f\n", args->name, sum_y, sum_ax);
+		return -1;
+	}
+	return 0;
+}
+
 /*
  * Table of sparse matrix stress methods
  */
 static const stress_sparsematrix_method_info_t sparsematrix_methods[] = {
 	{ "all",	NULL, NULL, NULL, NULL, NULL },
+	{ "art",	art_create, art_destroy, art_put, art_del, art_get },
 	{ "hash",	hash_create, hash_destroy, hash_put, hash_del, hash_get },
 #if defined(HAVE_JUDY)
 	{ "hashjudy",	hashjudy_create, hashjudy_destroy, hashjudy_put, hashjudy_del, hashjudy_get },
@@ -1341,10 +1962,12 @@ static const stress_sparsematrix_method_info_t sparsematrix_methods[] = {
     defined(RB_ENTRY)
 	{ "rb",		rb_create, rb_destroy, rb_put, rb_del, rb_get },
 #endif
+	{ "robinhood",	robinhood_create, open_hash_destroy, open_hash_put, open_hash_del, open_hash_get },
 #if defined(HAVE_SPLAY_TREE) &&	\
     defined(SPLAY_ENTRY)
 	{ "splay",	splay_create, splay_destroy, splay_put, splay_del, splay_get },
 #endif
+	{ "swiss",	swiss_create, open_hash_destroy, open_hash_put, open_hash_del, open_hash_get },
 };
 
 /*
@@ -1375,6 +1998,8 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_sparsematrix_items,	stress_set_sparsematrix_items },
 	{ OPT_sparsematrix_method,	stress_set_sparsematrix_method },
 	{ OPT_sparsematrix_size,	stress_set_sparsematrix_size },
+	{ OPT_sparsematrix_spmv,	stress_set_sparsematrix_spmv },
+	{ OPT_sparsematrix_threads,	stress_set_sparsematrix_threads },
 	{ 0,				NULL }
 };
 
@@ -1398,17 +2023,26 @@ static int stress_sparsematrix(stress_args_t *args)
 	test_info_t test_info[SIZEOF_ARRAY(sparsematrix_methods)];
 	size_t i, begin, end;
 	size_t method = 0;	/* All methods */
+	size_t spmv_pattern = SPMV_PATTERN_NONE;
+	uint32_t sparsematrix_threads = 0;
+	spmv_matrix_t spmv;
+	spmv_stats_t spmv_stats[2];
 
 	for (i = 0; i < SIZEOF_ARRAY(test_info); i++) {
 		test_info[i].skip_no_mem = false;
 		test_info[i].max_objmem = 0;
 		test_info[i].put_duration = 0.0;
 		test_info[i].get_duration = 0.0;
+		test_info[i].del_duration = 0.0;
 		test_info[i].put_ops = 0;
 		test_info[i].get_ops = 0;
+		test_info[i].del_ops = 0;
+		test_info[i].items = 0;
 	}
 
 	(void)stress_get_setting("sparsematrix-method", &method);
+	(void)stress_get_setting("sparsematrix-spmv", &spmv_pattern);
+	(void)stress_get_setting("sparsematrix-threads", &sparsematrix_threads);
 
 	if (!stress_get_setting("sparsematrix-size", &sparsematrix_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -1443,6 +2077,21 @@ static int stress_sparsematrix(stress_args_t *args)
 			percent_full);
 	}
 
+	for (i = 0; i < SIZEOF_ARRAY(test_info); i++)
+		test_info[i].items = sparsematrix_items;
+
+	(void)shim_memset(&spmv, 0, sizeof(spmv));
+	(void)shim_memset(spmv_stats, 0, sizeof(spmv_stats));
+	if (spmv_pattern != SPMV_PATTERN_NONE) {
+		if (spmv_create(args, &spmv, (size_t)sparsematrix_size,
+				(size_t)sparsematrix_items, spmv_pattern) < 0) {
+			pr_inf_skip("%s: failed to allocate %" PRIu32 " x %" PRIu32
+				" matrix for sparse matrix-vector multiply, skipping stressor\n",
+				args->name, sparsematrix_size, sparsematrix_size);
+			return EXIT_NO_RESOURCE;
+		}
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -1468,6 +2117,18 @@ static int stress_sparsematrix(stress_args_t *args)
 			}
 		}
 
+		if (spmv_pattern != SPMV_PATTERN_NONE) {
+			spmv_run(args, &spmv, false, sparsematrix_threads, &spmv_stats[0]);
+			if (spmv.ell_width > 0)
+				spmv_run(args, &spmv, true, sparsematrix_threads, &spmv_stats[1]);
+			if ((g_opt_flags & OPT_FLAGS_VERIFY) &&
+			    stress_continue_flag() &&
+			    (spmv_verify(args, &spmv) < 0)) {
+				rc = EXIT_FAILURE;
+				goto err;
+			}
+		}
+
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
@@ -1483,23 +2144,50 @@ static int stress_sparsematrix(stress_args_t *args)
 
 	for (i = begin; (i < end); i++) {
 		if (!test_info[i].skip_no_mem) {
-			char tmp[32];
+			char tmp[64];
 			double rate;
 
 			(void)snprintf(tmp, sizeof(tmp), "%s gets per sec", sparsematrix_methods[i].name);
 			rate = test_info[i].get_duration > 0.0 ? (double)test_info[i].get_ops / test_info[i].get_duration : 0.0;
-			stress_metrics_set(args, (i * 2) + 0, tmp,
+			stress_metrics_set(args, (i * 4) + 0, tmp,
 				rate, STRESS_HARMONIC_MEAN);
 
 			(void)snprintf(tmp, sizeof(tmp), "%s puts per sec", sparsematrix_methods[i].name);
 			rate = test_info[i].put_duration > 0.0 ? (double)test_info[i].put_ops / test_info[i].put_duration : 0.0;
-			stress_metrics_set(args, (i * 2) + 1, tmp,
+			stress_metrics_set(args, (i * 4) + 1, tmp,
+				rate, STRESS_HARMONIC_MEAN);
+
+			(void)snprintf(tmp, sizeof(tmp), "%s deletes per sec", sparsematrix_methods[i].name);
+			rate = test_info[i].del_duration > 0.0 ? (double)test_info[i].del_ops / test_info[i].del_duration : 0.0;
+			stress_metrics_set(args, (i * 4) + 2, tmp,
 				rate, STRESS_HARMONIC_MEAN);
+
+			(void)snprintf(tmp, sizeof(tmp), "%s bytes per item", sparsematrix_methods[i].name);
+			rate = test_info[i].items > 0 ? (double)test_info[i].max_objmem / (double)test_info[i].items : 0.0;
+			stress_metrics_set(args, (i * 4) + 3, tmp,
+				rate, STRESS_GEOMETRIC_MEAN);
 		}
 	}
 
+	for (i = 0; i < SIZEOF_ARRAY(spmv_stats); i++) {
+		const size_t idx = (SIZEOF_ARRAY(sparsematrix_methods) * 4) + (i * 2);
+		static const char * const spmv_formats[] = { "CSR", "ELL" };
+		const double duration = spmv_stats[i].duration;
+		char tmp[64];
+
+		if (duration <= 0.0)
+			continue;
+		(void)snprintf(tmp, sizeof(tmp), "%s %s SpMV GFLOP/s", spmv_formats[i], spmv_patterns[spmv_pattern]);
+		stress_metrics_set(args, idx, tmp,
+			spmv_stats[i].flops / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+		(void)snprintf(tmp, sizeof(tmp), "%s %s SpMV GB/s", spmv_formats[i], spmv_patterns[spmv_pattern]);
+		stress_metrics_set(args, idx + 1, tmp,
+			spmv_stats[i].bytes / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+	}
+
 	rc = EXIT_SUCCESS;
 err:
+	spmv_free(&spmv);
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	return rc;
@@ -18,6 +18,9 @@
  *
  */
 #include "stress-ng.h"
+#include "core-arch.h"
+#include "core-builtin.h"
+#include "core-cpu.h"
 
 #define STR1LEN 256
 #define STR2LEN 128
@@ -48,8 +51,10 @@ typedef struct {
 
 static const stress_help_t help[] = {
 	{ NULL,	"str N",	   "start N workers exercising lib C string functions" },
+	{ NULL,	"str-impl I",	   "select strchr, strcmp, strlen implementation: all, libc, naive, sse42, avx2" },
 	{ NULL,	"str-method func", "specify the string function to stress" },
 	{ NULL,	"str-ops N",	   "stop after N bogo string operations" },
+	{ NULL,	"str-sweep",	   "sweep string lengths and alignments, report GB/s per implementation" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -69,6 +74,328 @@ static inline void strchk(
 
 #define STRCHK(info, test)	strchk(info, test, STR(test))
 
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    (defined(HAVE_TARGET_CLONES_SSE4_2) ||	\
+     defined(HAVE_TARGET_CLONES_AVX2))
+#include <immintrin.h>
+#endif
+
+#define STR_SWEEP_MAX		(64 * KB)	/* longest sweep string */
+#define STR_SWEEP_BATCH		(256 * KB)	/* bytes scanned per timing batch */
+#define STR_SWEEP_ALIGN		(64)		/* string start offsets 0..63 */
+#define STR_PAGE_CROSS(p, n)	((((uintptr_t)(p)) & 4095) > (4096 - (n)))
+
+typedef size_t (*str_len_func_t)(const char *s);
+typedef char * (*str_chr_func_t)(const char *s, int c);
+typedef int (*str_cmp_func_t)(const char *s1, const char *s2);
+
+/*
+ *  implementations of strchr, strcmp and strlen
+ */
+typedef struct {
+	const char *name;		/* implementation name */
+	bool (*supported)(void);	/* true if cpu can run it */
+	const str_chr_func_t chr;	/* strchr */
+	const str_cmp_func_t cmp;	/* strcmp */
+	const str_len_func_t len;	/* strlen */
+} stress_str_impl_t;
+
+/* sweep string length classes */
+static const struct {
+	const size_t max;	/* longest string in class */
+	const char *label;	/* lengths in class */
+	const bool metric;	/* report as a metric */
+} str_sweep_class[] = {
+	{ 16,		"1-16",		true },
+	{ 64,		"17-64",	false },
+	{ 256,		"65-256",	false },
+	{ 1 * KB,	"257-1K",	true },
+	{ 4 * KB,	"1K-4K",	false },
+	{ 16 * KB,	"4K-16K",	false },
+	{ 64 * KB,	"16K-64K",	true },
+};
+
+/* sweep functions */
+#define STR_SWEEP_CHR		(0)
+#define STR_SWEEP_CMP		(1)
+#define STR_SWEEP_LEN		(2)
+#define STR_SWEEP_FUNCS		(3)
+
+static const char * const str_sweep_func_names[] = {
+	"strchr",
+	"strcmp",
+	"strlen",
+};
+
+typedef struct {
+	double bytes;		/* total bytes scanned */
+	double duration;	/* total time scanning */
+} stress_str_sweep_t;
+
+static bool stress_str_impl_always_supported(void)
+{
+	return true;
+}
+
+static inline unsigned int stress_str_ctz(uint32_t mask)
+{
+#if defined(HAVE_BUILTIN_CTZ)
+	return (unsigned int)__builtin_ctz(mask);
+#else
+	unsigned int n = 0;
+
+	while (!(mask & 1)) {
+		mask >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/*
+ *  naive byte at a time implementations
+ */
+static size_t NOINLINE stress_strlen_naive(const char *s)
+{
+	register const char *p = s;
+
+	while (*p)
+		p++;
+	return (size_t)(p - s);
+}
+
+static char * NOINLINE stress_strchr_naive(const char *s, int c)
+{
+	register const char ch = (char)c;
+
+	for (;;) {
+		if (*s == ch)
+			return (char *)s;
+		if (!*s)
+			return NULL;
+		s++;
+	}
+}
+
+static int NOINLINE stress_strcmp_naive(const char *s1, const char *s2)
+{
+	register const unsigned char *p1 = (const unsigned char *)s1;
+	register const unsigned char *p2 = (const unsigned char *)s2;
+
+	while (*p1 && (*p1 == *p2)) {
+		p1++;
+		p2++;
+	}
+	return (int)*p1 - (int)*p2;
+}
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    defined(HAVE_TARGET_CLONES_SSE4_2)
+#define HAVE_STR_SSE42
+#define STR_SSE42	__attribute__((target("sse4.2")))
+
+static bool stress_str_sse42_supported(void)
+{
+	return stress_cpu_x86_has_sse4_2();
+}
+
+/*
+ *  SSE4.2 implementations using pcmpistri string compares, the
+ *  unaligned head is scanned a byte at a time so that the aligned
+ *  16 byte loads never cross into an unmapped page
+ */
+static size_t NOINLINE STR_SSE42 stress_strlen_sse42(const char *s)
+{
+	register const char *p = s;
+	/* byte range 0x01..0xff, negated matches the terminator */
+	const __m128i range = _mm_setr_epi8(1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	while ((uintptr_t)p & 15) {
+		if (!*p)
+			return (size_t)(p - s);
+		p++;
+	}
+	for (;;) {
+		const __m128i v = _mm_load_si128((const __m128i *)p);
+		const int idx = _mm_cmpistri(range, v, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+						_SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+
+		if (idx < 16)
+			return (size_t)(p - s) + (size_t)idx;
+		p += 16;
+	}
+}
+
+static char * NOINLINE STR_SSE42 stress_strchr_sse42(const char *s, int c)
+{
+	register const char *p = s;
+	const char ch = (char)c;
+	__m128i set;
+
+	if (!ch)
+		return (char *)s + stress_strlen_sse42(s);
+
+	while ((uintptr_t)p & 15) {
+		if (*p == ch)
+			return (char *)p;
+		if (!*p)
+			return NULL;
+		p++;
+	}
+	set = _mm_cvtsi32_si128((int)(unsigned char)ch);
+	for (;;) {
+		const __m128i v = _mm_load_si128((const __m128i *)p);
+		const int idx = _mm_cmpistri(set, v, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+						_SIDD_LEAST_SIGNIFICANT);
+
+		if (idx < 16)
+			return (char *)p + idx;
+		if (_mm_cmpistrz(set, v, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+					 _SIDD_LEAST_SIGNIFICANT))
+			return NULL;
+		p += 16;
+	}
+}
+
+static int NOINLINE STR_SSE42 stress_strcmp_sse42(const char *s1, const char *s2)
+{
+	for (;;) {
+		__m128i v1, v2;
+		int idx;
+
+		/* a byte at a time if a 16 byte load would cross a page */
+		if (STR_PAGE_CROSS(s1, 16) || STR_PAGE_CROSS(s2, 16)) {
+			const int diff = (int)(unsigned char)*s1 - (int)(unsigned char)*s2;
+
+			if (diff || !*s1)
+				return diff;
+			s1++;
+			s2++;
+			continue;
+		}
+		v1 = _mm_loadu_si128((const __m128i *)s1);
+		v2 = _mm_loadu_si128((const __m128i *)s2);
+		idx = _mm_cmpistri(v1, v2, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH |
+					   _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+		if (idx < 16)
+			return (int)(unsigned char)s1[idx] - (int)(unsigned char)s2[idx];
+		if (_mm_cmpistrz(v1, v2, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH |
+					 _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT))
+			return 0;
+		s1 += 16;
+		s2 += 16;
+	}
+}
+#endif
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    defined(HAVE_TARGET_CLONES_AVX2)
+#define HAVE_STR_AVX2
+#define STR_AVX2	__attribute__((target("avx2")))
+
+static bool stress_str_avx2_supported(void)
+{
+	return stress_cpu_x86_has_avx2();
+}
+
+/*
+ *  AVX2 implementations comparing 32 bytes at a time, strlen and
+ *  strchr use aligned loads and discard the bytes before the start
+ *  of the string, aligned loads never cross into an unmapped page
+ */
+static size_t NOINLINE STR_AVX2 stress_strlen_avx2(const char *s)
+{
+	register const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)31);
+	const __m256i zero = _mm256_setzero_si256();
+	uint32_t mask;
+
+	mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), zero));
+	mask >>= (s - p);
+	if (mask)
+		return (size_t)stress_str_ctz(mask);
+	for (;;) {
+		p += 32;
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *)p), zero));
+		if (mask)
+			return (size_t)(p - s) + (size_t)stress_str_ctz(mask);
+	}
+}
+
+static char * NOINLINE STR_AVX2 stress_strchr_avx2(const char *s, int c)
+{
+	register const char *p = (const char *)((uintptr_t)s & ~(uintptr_t)31);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i vc = _mm256_set1_epi8((char)c);
+	__m256i v;
+	uint32_t mask;
+
+	v = _mm256_load_si256((const __m256i *)p);
+	mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, vc)));
+	mask >>= (s - p);
+	if (mask) {
+		p = s + stress_str_ctz(mask);
+		return (*p == (char)c) ? (char *)p : NULL;
+	}
+	for (;;) {
+		p += 32;
+		v = _mm256_load_si256((const __m256i *)p);
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, vc)));
+		if (mask) {
+			p += stress_str_ctz(mask);
+			return (*p == (char)c) ? (char *)p : NULL;
+		}
+	}
+}
+
+static int NOINLINE STR_AVX2 stress_strcmp_avx2(const char *s1, const char *s2)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	for (;;) {
+		__m256i v1, v2;
+		uint32_t mask;
+
+		/* a byte at a time if a 32 byte load would cross a page */
+		if (STR_PAGE_CROSS(s1, 32) || STR_PAGE_CROSS(s2, 32)) {
+			const int diff = (int)(unsigned char)*s1 - (int)(unsigned char)*s2;
+
+			if (diff || !*s1)
+				return diff;
+			s1++;
+			s2++;
+			continue;
+		}
+		v1 = _mm256_loadu_si256((const __m256i *)s1);
+		v2 = _mm256_loadu_si256((const __m256i *)s2);
+		/* first byte that differs or is the terminator */
+		mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2)) |
+			(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, zero));
+		if (mask) {
+			const unsigned int idx = stress_str_ctz(mask);
+
+			return (int)(unsigned char)s1[idx] - (int)(unsigned char)s2[idx];
+		}
+		s1 += 32;
+		s2 += 32;
+	}
+}
+#endif
+
+static const stress_str_impl_t str_impls[] = {
+	{ "all",	stress_str_impl_always_supported, NULL, NULL, NULL },
+	{ "libc",	stress_str_impl_always_supported, strchr, strcmp, strlen },
+	{ "naive",	stress_str_impl_always_supported, stress_strchr_naive, stress_strcmp_naive, stress_strlen_naive },
+#if defined(HAVE_STR_SSE42)
+	{ "sse42",	stress_str_sse42_supported, stress_strchr_sse42, stress_strcmp_sse42, stress_strlen_sse42 },
+#endif
+#if defined(HAVE_STR_AVX2)
+	{ "avx2",	stress_str_avx2_supported, stress_strchr_avx2, stress_strcmp_avx2, stress_strlen_avx2 },
+#endif
+};
+
 #if defined(HAVE_STRINGS_H)
 /*
  *  stress_strcasecmp()
@@ -602,6 +929,27 @@ static const stress_str_method_info_t str_methods[] = {
 };
 
 static stress_metrics_t metrics[SIZEOF_ARRAY(str_methods)];
+static const stress_str_impl_t *str_impl = NULL;	/* NULL, use libc */
+
+/*
+ *  stress_str_method_func()
+ *	the function a method exercises, strchr, strcmp and strlen
+ *	use the selected implementation
+ */
+static void *stress_str_method_func(const size_t method)
+{
+	const char *name = str_methods[method].name;
+
+	if (!str_impl)
+		return str_methods[method].libc_func;
+	if (!strcmp(name, "strchr"))
+		return (void *)str_impl->chr;
+	if (!strcmp(name, "strcmp"))
+		return (void *)str_impl->cmp;
+	if (!strcmp(name, "strlen"))
+		return (void *)str_impl->len;
+	return str_methods[method].libc_func;
+}
 
 /*
  *  stress_str_all()
@@ -613,7 +961,7 @@ static size_t stress_str_all(stress_args_t *args, stress_str_args_t *info)
 	stress_str_args_t info_all = *info;
 	double t;
 
-	info_all.libc_func = str_methods[i].libc_func;
+	info_all.libc_func = stress_str_method_func(i);
 
 	t = stress_time_now();
 	metrics[i].count += (double)str_methods[i].func(args, &info_all);
@@ -649,6 +997,204 @@ static int stress_set_str_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_str_impl()
+ *	set the strchr, strcmp and strlen implementation
+ */
+static int stress_set_str_impl(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(str_impls); i++) {
+		if (!strcmp(str_impls[i].name, name)) {
+			stress_set_setting("str-impl", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "str-impl must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(str_impls); i++) {
+		(void)fprintf(stderr, " %s", str_impls[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+static int stress_set_str_sweep(const char *opt)
+{
+	return stress_set_setting_true("str-sweep", opt);
+}
+
+static double stress_str_rate_gbs(const stress_str_sweep_t *cell)
+{
+	return (cell->duration > 0.0) ? cell->bytes / (cell->duration * 1.0E9) : 0.0;
+}
+
+/*
+ *  stress_str_sweep_dump()
+ *	dump GB/s for each implementation, length class and function
+ */
+static void stress_str_sweep_dump(
+	stress_args_t *args,
+	const stress_str_sweep_t *sweep,
+	const size_t *impls,
+	const size_t n_impls)
+{
+	const size_t n_classes = SIZEOF_ARRAY(str_sweep_class);
+	size_t i, j, k, metric = 0;
+
+	for (i = 0; i < n_impls; i++) {
+		const char *name = str_impls[impls[i]].name;
+
+		/* skip implementations the run ended before reaching */
+		if (sweep[i * n_classes * STR_SWEEP_FUNCS].duration <= 0.0)
+			continue;
+		if (args->instance == 0) {
+			pr_inf("%s: %s GB/s:\n", args->name, name);
+			pr_inf("%s: %10s %8s %8s %8s\n", args->name, "length",
+				str_sweep_func_names[0], str_sweep_func_names[1],
+				str_sweep_func_names[2]);
+		}
+		for (j = 0; j < n_classes; j++) {
+			const stress_str_sweep_t *row = &sweep[(i * n_classes + j) * STR_SWEEP_FUNCS];
+
+			if (args->instance == 0)
+				pr_inf("%s: %10s %8.3f %8.3f %8.3f\n", args->name,
+					str_sweep_class[j].label,
+					stress_str_rate_gbs(&row[0]),
+					stress_str_rate_gbs(&row[1]),
+					stress_str_rate_gbs(&row[2]));
+
+			/* short, medium and long strings only, there are too few metrics slots for all */
+			if (!str_sweep_class[j].metric)
+				continue;
+			for (k = 0; k < STR_SWEEP_FUNCS; k++) {
+				char msg[64];
+
+				(void)snprintf(msg, sizeof(msg), "%s %s GB/s at %s", name,
+					str_sweep_func_names[k], str_sweep_class[j].label);
+				stress_metrics_set(args, metric++, msg,
+					stress_str_rate_gbs(&row[k]), STRESS_GEOMETRIC_MEAN);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_str_sweep()
+ *	sweep strchr, strcmp and strlen over string lengths from 1 byte
+ *	to 64K with random start alignments and report the GB/s of each
+ *	implementation
+ */
+static int stress_str_sweep(stress_args_t *args, const size_t str_impl)
+{
+	const size_t n_classes = SIZEOF_ARRAY(str_sweep_class);
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t impls[SIZEOF_ARRAY(str_impls)];
+	size_t n_impls = 0, buf_size, i, j;
+	stress_str_sweep_t *sweep;
+	char *buf, *buf1, *buf2;
+	int rc = EXIT_SUCCESS;
+
+	for (i = 1; i < SIZEOF_ARRAY(str_impls); i++) {
+		if (((str_impl == 0) || (str_impl == i)) &&
+		    str_impls[i].supported())
+			impls[n_impls++] = i;
+	}
+
+	buf_size = STR_SWEEP_MAX + args->page_size;
+	buf = (char *)stress_mmap_populate(NULL, 2 * buf_size,
+			PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1 , 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate %zu byte sweep buffers, skipping stressor\n",
+			args->name, 2 * buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	buf1 = buf;
+	buf2 = buf + buf_size;
+
+	sweep = (stress_str_sweep_t *)calloc(n_impls * n_classes * STR_SWEEP_FUNCS, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		(void)munmap((void *)buf, 2 * buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_rndstr(buf1, buf_size);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_impls) && stress_continue(args); i++) {
+			const stress_str_impl_t *impl = &str_impls[impls[i]];
+
+			for (j = 0; (j < n_classes) && stress_continue_flag(); j++) {
+				stress_str_sweep_t *cell = &sweep[(i * n_classes + j) * STR_SWEEP_FUNCS];
+				const size_t lo = j ? str_sweep_class[j - 1].max + 1 : 1;
+				const size_t len = lo + (size_t)stress_mwc32modn((uint32_t)(str_sweep_class[j].max - lo + 1));
+				const size_t batch = STRESS_MAXIMUM(1, STR_SWEEP_BATCH / len);
+				char *s1 = buf1 + stress_mwc8modn(STR_SWEEP_ALIGN);
+				char *s2 = buf2 + stress_mwc8modn(STR_SWEEP_ALIGN);
+				const char last = s1[len - 1], end = s1[len];
+				register size_t l, n = 0;
+				double t;
+
+				/* s1 ends in a '+' to search for, s2 is the same but sorts after s1 */
+				s1[len - 1] = '+';
+				s1[len] = '\0';
+				(void)shim_memcpy(s2, s1, len + 1);
+				s2[len - 1] = ',';
+
+				t = stress_time_now();
+				for (l = 0; l < batch; l++)
+					n += (impl->chr(s1, '+') == s1 + len - 1);
+				cell[STR_SWEEP_CHR].duration += stress_time_now() - t;
+				cell[STR_SWEEP_CHR].bytes += (double)len * (double)batch;
+				if (verify && (n != batch)) {
+					pr_fail("%s: %s strchr on a %zu byte string at offset %zu did not find the last character\n",
+						args->name, impl->name, len, (size_t)(s1 - buf1));
+					rc = EXIT_FAILURE;
+				}
+
+				t = stress_time_now();
+				for (n = 0, l = 0; l < batch; l++)
+					n += (impl->cmp(s1, s2) < 0);
+				cell[STR_SWEEP_CMP].duration += stress_time_now() - t;
+				cell[STR_SWEEP_CMP].bytes += 2.0 * (double)len * (double)batch;
+				if (verify && (n != batch)) {
+					pr_fail("%s: %s strcmp on %zu byte strings at offsets %zu and %zu did not "
+						"find the strings differ\n", args->name, impl->name, len,
+						(size_t)(s1 - buf1), (size_t)(s2 - buf2));
+					rc = EXIT_FAILURE;
+				}
+
+				t = stress_time_now();
+				for (n = 0, l = 0; l < batch; l++)
+					n += impl->len(s1);
+				cell[STR_SWEEP_LEN].duration += stress_time_now() - t;
+				cell[STR_SWEEP_LEN].bytes += (double)(len + 1) * (double)batch;
+				if (verify && (n != len * batch)) {
+					pr_fail("%s: %s strlen on a %zu byte string at offset %zu returned the wrong length\n",
+						args->name, impl->name, len, (size_t)(s1 - buf1));
+					rc = EXIT_FAILURE;
+				}
+
+				s1[len - 1] = last;
+				s1[len] = end;
+			}
+			stress_bogo_inc(args);
+		}
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_str_sweep_dump(args, sweep, impls, n_impls);
+
+	free(sweep);
+	(void)munmap((void *)buf, 2 * buf_size);
+
+	return rc;
+}
+
 /*
  *  stress_str()
  *	stress CPU by doing various string operations
@@ -659,12 +1205,26 @@ static int stress_str(stress_args_t *args)
 	char ALIGN64 strdst[STRDSTLEN];
 	stress_str_args_t info;
 	const stress_str_method_info_t *str_method_info;
-	size_t i, j, str_method = 0;
+	size_t i, j, str_method = 0, str_impl_idx = 0;
+	bool str_sweep = false;
 
 	(void)stress_get_setting("str-method", &str_method);
+	(void)stress_get_setting("str-impl", &str_impl_idx);
+	(void)stress_get_setting("str-sweep", &str_sweep);
+	if (!str_impls[str_impl_idx].supported()) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cpu does not support the %s string implementation, "
+				"skipping stressor\n", args->name, str_impls[str_impl_idx].name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (str_sweep)
+		return stress_str_sweep(args, str_impl_idx);
+
+	/* all implementations is only meaningful for sweeps, use libc */
+	str_impl = (str_impl_idx > 0) ? &str_impls[str_impl_idx] : NULL;
 	str_method_info = &str_methods[str_method];
 
-	info.libc_func = str_method_info->libc_func;
+	info.libc_func = stress_str_method_func(str_method);
 	info.str1 = str1;
 	info.len1 = sizeof(str1);
 	info.str2 = str2;
@@ -727,7 +1287,9 @@ static void stress_str_set_default(void)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_str_impl,		stress_set_str_impl },
 	{ OPT_str_method,	stress_set_str_method },
+	{ OPT_str_sweep,	stress_set_str_sweep },
 	{ 0,			NULL }
 };
 
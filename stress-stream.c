@@ -29,17 +29,40 @@
  *
  */
 #include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-builtin.h"
 #include "core-cpu.h"
 #include "core-cpu-cache.h"
 #include "core-nt-store.h"
 #include "core-numa.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 #include "core-target-clones.h"
 
 #define MIN_STREAM_L3_SIZE	(4 * KB)
 #define MAX_STREAM_L3_SIZE	(MAX_MEM_LIMIT)
 #define DEFAULT_STREAM_L3_SIZE	(4 * MB)
 
+#define STREAM_KERNELS		(4)	/* copy, scale, add and triad */
+#define STREAM_SWEEP_LLC_SCALE	(4)	/* largest sweep size, x LLC size */
+#define STREAM_SWEEP_LEVELS	(4)	/* L1, L2, L3 and DRAM */
+#define STREAM_SWEEP_MAX	(32)
+#define MAX_STREAM_THREADS	(1024)
+#define STREAM_NUMA_NODES_MAX	(6)	/* matrix of up to 6 x 6 nodes */
+
+#if defined(HAVE_LIB_PTHREAD)
+#define HAVE_STREAM_THREADS
+#endif
+
+#if defined(HAVE_STREAM_THREADS) &&	\
+    defined(HAVE_LINUX_MEMPOLICY_H) &&	\
+    defined(__NR_mbind)
+#include <linux/mempolicy.h>
+#define HAVE_STREAM_NUMA
+#define NUMA_LONG_BITS		(sizeof(unsigned long) * 8)
+#define STREAM_NUMA_MASK_BITS	(1024)	/* kernel MAX_NUMNODES upper limit */
+#endif
+
 #if defined(HAVE_NT_STORE_DOUBLE)
 #define NT_STORE(dst, src)		stress_nt_store_double(&dst, src)
 #endif
@@ -51,13 +74,37 @@ typedef struct {
 	const int advice;
 } stress_stream_madvise_info_t;
 
+/* Per kernel accumulated run time and bytes read + written */
+typedef struct {
+	double dt;
+	double bytes;
+} stress_stream_kernel_t;
+
+/* A working set size in a sweep */
+typedef struct {
+	uint64_t n;			/* number of doubles per array */
+	size_t level;			/* cache level index that fits, 3 = DRAM */
+	stress_stream_kernel_t kernel[STREAM_KERNELS];
+} stress_stream_sweep_t;
+
+static const char * const stream_kernel_names[STREAM_KERNELS] = {
+	"copy", "scale", "add", "triad"
+};
+
+static const char * const stream_level_names[STREAM_SWEEP_LEVELS] = {
+	"L1", "L2", "L3", "DRAM"
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"stream N",		"start N workers exercising memory bandwidth" },
 	{ NULL,	"stream-index N",	"specify number of indices into the data (0..3)" },
 	{ NULL,	"stream-l3-size N",	"specify the L3 cache size of the CPU" },
 	{ NULL,	"stream-madvise M",	"specify mmap'd stream buffer madvise advice" },
 	{ NULL,	"stream-mlock",		"attempt to mlock pages into memory" },
+	{ NULL,	"stream-numa-matrix",	"report the bandwidth of each CPU node to memory node pair" },
 	{ NULL,	"stream-ops N",		"stop after N bogo stream operations" },
+	{ NULL,	"stream-sweep",		"sweep array sizes from L1 to DRAM, report GB/s per cache level" },
+	{ NULL,	"stream-threads N",	"run N threads per instance, each first touching its own arrays" },
 	{ NULL,	NULL,                   NULL }
 };
 
@@ -87,6 +134,25 @@ static int stress_set_stream_mlock(const char *opt)
 	return stress_set_setting_true("stream-mlock", opt);
 }
 
+static int stress_set_stream_numa_matrix(const char *opt)
+{
+	return stress_set_setting_true("stream-numa-matrix", opt);
+}
+
+static int stress_set_stream_threads(const char *opt)
+{
+	uint32_t stream_threads;
+
+	stream_threads = stress_get_uint32(opt);
+	stress_check_range("stream-threads", (uint64_t)stream_threads, 1, MAX_STREAM_THREADS);
+	return stress_set_setting("stream-threads", TYPE_ID_UINT32, &stream_threads);
+}
+
+static int stress_set_stream_sweep(const char *opt)
+{
+	return stress_set_setting_true("stream-sweep", opt);
+}
+
 static int stress_set_stream_L3_size(const char *opt)
 {
 	uint64_t stream_L3_size;
@@ -802,6 +868,704 @@ static void stress_stream_init_index(
 	}
 }
 
+/*
+ *  stress_stream_kernel_end()
+ *	account the time and bytes of a kernel started at t with
+ *	bytes read + written count of bytes_begin
+ */
+static inline void stress_stream_kernel_end(
+	stress_stream_kernel_t *kernel,
+	const double t,
+	const double bytes_begin,
+	const double rd_bytes,
+	const double wr_bytes)
+{
+	kernel->dt += stress_time_now() - t;
+	kernel->bytes += (rd_bytes + wr_bytes) - bytes_begin;
+}
+
+/*
+ *  stress_stream_run()
+ *	run one round of the copy, scale, add and triad kernels
+ *	for the given stream index, timing each kernel separately.
+ *	The non-temporal index 0 kernels are used if nt is true.
+ */
+static void stress_stream_run(
+	double *const RESTRICT a,
+	double *const RESTRICT b,
+	double *const RESTRICT c,
+	const double q,
+	const size_t *const RESTRICT idx1,
+	const size_t *const RESTRICT idx2,
+	const size_t *const RESTRICT idx3,
+	const uint64_t n,
+	const uint32_t stream_index,
+	const bool nt,
+	stress_stream_kernel_t kernel[STREAM_KERNELS],
+	double *const RESTRICT rd_bytes,
+	double *const RESTRICT wr_bytes,
+	double *const RESTRICT fp_ops)
+{
+	double t, bytes;
+
+#if !defined(HAVE_NT_STORE_DOUBLE)
+	(void)nt;
+#endif
+
+	t = stress_time_now();
+	bytes = *rd_bytes + *wr_bytes;
+	switch (stream_index) {
+	case 3:
+		stress_stream_copy_index3(c, a, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 2:
+		stress_stream_copy_index2(c, a, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 1:
+		stress_stream_copy_index1(c, a, idx1, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 0:
+	default:
+#if defined(HAVE_NT_STORE_DOUBLE)
+		if (nt) {
+			stress_stream_copy_index0_nt(c, a, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+#endif
+		stress_stream_copy_index0(c, a, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	}
+	stress_stream_kernel_end(&kernel[0], t, bytes, *rd_bytes, *wr_bytes);
+
+	t = stress_time_now();
+	bytes = *rd_bytes + *wr_bytes;
+	switch (stream_index) {
+	case 3:
+		stress_stream_scale_index3(b, c, q, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 2:
+		stress_stream_scale_index2(b, c, q, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 1:
+		stress_stream_scale_index1(b, c, q, idx1, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 0:
+	default:
+#if defined(HAVE_NT_STORE_DOUBLE)
+		if (nt) {
+			stress_stream_scale_index0_nt(b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+#endif
+		stress_stream_scale_index0(b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	}
+	stress_stream_kernel_end(&kernel[1], t, bytes, *rd_bytes, *wr_bytes);
+
+	t = stress_time_now();
+	bytes = *rd_bytes + *wr_bytes;
+	switch (stream_index) {
+	case 3:
+		stress_stream_add_index3(c, b, a, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 2:
+		stress_stream_add_index2(c, b, a, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 1:
+		stress_stream_add_index1(c, b, a, idx1, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 0:
+	default:
+#if defined(HAVE_NT_STORE_DOUBLE)
+		if (nt) {
+			stress_stream_add_index0_nt(c, b, a, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+#endif
+		stress_stream_add_index0(c, b, a, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	}
+	stress_stream_kernel_end(&kernel[2], t, bytes, *rd_bytes, *wr_bytes);
+
+	t = stress_time_now();
+	bytes = *rd_bytes + *wr_bytes;
+	switch (stream_index) {
+	case 3:
+		stress_stream_triad_index3(a, b, c, q, idx1, idx2, idx3, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 2:
+		stress_stream_triad_index2(a, b, c, q, idx1, idx2, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 1:
+		stress_stream_triad_index1(a, b, c, q, idx1, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	case 0:
+	default:
+#if defined(HAVE_NT_STORE_DOUBLE)
+		if (nt) {
+			stress_stream_triad_index0_nt(a, b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+			break;
+		}
+#endif
+		stress_stream_triad_index0(a, b, c, q, n, rd_bytes, wr_bytes, fp_ops);
+		break;
+	}
+	stress_stream_kernel_end(&kernel[3], t, bytes, *rd_bytes, *wr_bytes);
+}
+
+/*
+ *  stress_stream_sweep_sizes()
+ *	fill in the sweep with array sizes where the 3 arrays step
+ *	in powers of 2 from a quarter of the L1 cache size to
+ *	STREAM_SWEEP_LLC_SCALE x the last level cache size, each
+ *	size is tagged with the smallest cache level it fits in.
+ *	Returns the number of sizes and the largest n in max_n.
+ */
+static size_t stress_stream_sweep_sizes(
+	stress_stream_sweep_t *sweep,
+	uint64_t *max_n,
+	uint64_t *llc_size)
+{
+	uint64_t level_size[STREAM_SWEEP_LEVELS - 1];
+	uint64_t ws, ws_max, llc = 0;
+	size_t level, n_sweep = 0;
+
+	for (level = 0; level < STREAM_SWEEP_LEVELS - 1; level++) {
+		size_t cache_size, cache_line_size;
+
+		stress_cpu_cache_get_level_size((uint16_t)(level + 1), &cache_size, &cache_line_size);
+		level_size[level] = (uint64_t)cache_size;
+		if (cache_size)
+			llc = (uint64_t)cache_size;
+	}
+	if (!level_size[0])
+		level_size[0] = 32 * KB;
+	if (!llc)
+		llc = DEFAULT_STREAM_L3_SIZE;
+
+	ws_max = STREAM_SWEEP_LLC_SCALE * llc;
+	for (ws = 4 * KB; ws < level_size[0] / 4; ws *= 2)
+		;
+	for (*max_n = 0; (ws <= ws_max) && (n_sweep < STREAM_SWEEP_MAX); ws *= 2) {
+		uint64_t n = ws / (3 * sizeof(double));
+
+		/* n must be a multiple of the max unroll size (8) */
+		n = (n + 7) & ~(uint64_t)7;
+		sweep[n_sweep].n = n;
+		for (level = 0; level < STREAM_SWEEP_LEVELS - 1; level++) {
+			if (level_size[level] && (ws <= level_size[level]))
+				break;
+		}
+		sweep[n_sweep].level = level;
+		*max_n = STRESS_MAXIMUM(*max_n, n);
+		n_sweep++;
+	}
+	*llc_size = llc;
+	return n_sweep;
+}
+
+/*
+ *  stress_stream_sweep()
+ *	run the stream kernels over a range of array sizes that
+ *	step across the cache level boundaries into DRAM and
+ *	report the bandwidth per kernel for each cache level
+ */
+static int stress_stream_sweep(
+	stress_args_t *args,
+	const uint32_t stream_index,
+	const bool stream_mlock,
+	const bool has_nt)
+{
+	stress_stream_sweep_t sweep[STREAM_SWEEP_MAX];
+	stress_stream_kernel_t level_kernel[STREAM_SWEEP_LEVELS][STREAM_KERNELS];
+	double *a = MAP_FAILED, *b = MAP_FAILED, *c = MAP_FAILED;
+	size_t *idx1 = MAP_FAILED, *idx2 = MAP_FAILED, *idx3 = MAP_FAILED;
+	const double q = 3.0;
+	double rd_bytes = 0.0, wr_bytes = 0.0, fp_ops = 0.0, slice;
+	uint64_t max_n, llc_size, sz, sz_idx;
+	size_t i, k, n_sweep, metric = 0;
+	int rc = EXIT_NO_RESOURCE;
+
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+	(void)shim_memset(level_kernel, 0, sizeof(level_kernel));
+	n_sweep = stress_stream_sweep_sizes(sweep, &max_n, &llc_size);
+
+	sz = max_n * sizeof(*a);
+	sz_idx = max_n * sizeof(size_t);
+	a = stress_stream_mmap(args, sz, stream_mlock);
+	if (a == MAP_FAILED)
+		goto err_unmap;
+	b = stress_stream_mmap(args, sz, stream_mlock);
+	if (b == MAP_FAILED)
+		goto err_unmap;
+	c = stress_stream_mmap(args, sz, stream_mlock);
+	if (c == MAP_FAILED)
+		goto err_unmap;
+	if (stream_index >= 1) {
+		idx1 = stress_stream_mmap(args, sz_idx, stream_mlock);
+		if (idx1 == MAP_FAILED)
+			goto err_unmap;
+	}
+	if (stream_index >= 2) {
+		idx2 = stress_stream_mmap(args, sz_idx, stream_mlock);
+		if (idx2 == MAP_FAILED)
+			goto err_unmap;
+	}
+	if (stream_index >= 3) {
+		idx3 = stress_stream_mmap(args, sz_idx, stream_mlock);
+		if (idx3 == MAP_FAILED)
+			goto err_unmap;
+	}
+
+	/* spread the run over all sizes, repeating the sweep if time remains */
+	slice = (double)g_opt_timeout / (double)n_sweep;
+	slice = STRESS_MINIMUM(1.0, STRESS_MAXIMUM(0.05, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < n_sweep) && stress_continue(args); i++) {
+			const uint64_t n = sweep[i].n;
+			/* streaming stores only help once the arrays spill out of the LLC */
+			const bool nt = has_nt && (3 * n * sizeof(*a) > llc_size);
+			double t_start;
+
+			stress_stream_init_data(a, b, c, n);
+			if (idx1 != MAP_FAILED)
+				stress_stream_init_index(idx1, n);
+			if (idx2 != MAP_FAILED)
+				stress_stream_init_index(idx2, n);
+			if (idx3 != MAP_FAILED)
+				stress_stream_init_index(idx3, n);
+
+			t_start = stress_time_now();
+			do {
+				stress_stream_run(a, b, c, q, idx1, idx2, idx3, n, stream_index, nt,
+					sweep[i].kernel, &rd_bytes, &wr_bytes, &fp_ops);
+				stress_bogo_inc(args);
+			} while ((stress_time_now() - t_start < slice) && stress_continue(args));
+		}
+	} while (stress_continue(args));
+
+	if (args->instance == 0)
+		pr_inf("%s: %-5s %10s %10s %10s %10s %10s\n", args->name,
+			"level", "set (KB)", "copy GB/s", "scale GB/s", "add GB/s", "triad GB/s");
+
+	for (i = 0; i < n_sweep; i++) {
+		const double ws = 3.0 * (double)(sweep[i].n * sizeof(*a));
+		double rate[STREAM_KERNELS];
+
+		if (sweep[i].kernel[0].dt <= 0.0)
+			continue;
+		for (k = 0; k < STREAM_KERNELS; k++) {
+			const stress_stream_kernel_t *kernel = &sweep[i].kernel[k];
+
+			rate[k] = (kernel->dt > 0.0) ? kernel->bytes / kernel->dt / 1.0E9 : 0.0;
+			level_kernel[sweep[i].level][k].dt += kernel->dt;
+			level_kernel[sweep[i].level][k].bytes += kernel->bytes;
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %-5s %10.0f %10.2f %10.2f %10.2f %10.2f\n", args->name,
+				stream_level_names[sweep[i].level], ws / (double)KB,
+				rate[0], rate[1], rate[2], rate[3]);
+	}
+
+	for (i = 0; i < STREAM_SWEEP_LEVELS; i++) {
+		for (k = 0; k < STREAM_KERNELS; k++) {
+			const stress_stream_kernel_t *kernel = &level_kernel[i][k];
+			char msg[64];
+
+			if (kernel->dt <= 0.0)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "GB per sec %s %s",
+				stream_level_names[i], stream_kernel_names[k]);
+			stress_metrics_set(args, metric++, msg,
+				kernel->bytes / kernel->dt / 1.0E9, STRESS_HARMONIC_MEAN);
+		}
+	}
+	rc = EXIT_SUCCESS;
+
+err_unmap:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (idx3 != MAP_FAILED)
+		(void)munmap((void *)idx3, sz_idx);
+	if (idx2 != MAP_FAILED)
+		(void)munmap((void *)idx2, sz_idx);
+	if (idx1 != MAP_FAILED)
+		(void)munmap((void *)idx1, sz_idx);
+	if (c != MAP_FAILED)
+		(void)munmap((void *)c, sz);
+	if (b != MAP_FAILED)
+		(void)munmap((void *)b, sz);
+	if (a != MAP_FAILED)
+		(void)munmap((void *)a, sz);
+	return rc;
+}
+
+#if defined(HAVE_STREAM_THREADS)
+/* State shared by the threads of a threaded run */
+typedef struct {
+	uint64_t n;			/* doubles per array per thread */
+	uint32_t stream_index;		/* number of indices, 0..3 */
+	bool nt;			/* use non-temporal stores */
+	bool stream_mlock;		/* mlock the arrays */
+	int cpu_node;			/* NUMA node to run on, -1 = any */
+	int mem_node;			/* NUMA node to bind memory to, -1 = first touch */
+	volatile bool stop;		/* threads should exit */
+} stress_stream_threads_t;
+
+typedef struct {
+	stress_stream_threads_t *shared; /* shared run state */
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	bool failed;			/* allocation, affinity or bind failure */
+	volatile uint64_t rounds;	/* completed copy, scale, add, triad rounds */
+	stress_stream_kernel_t kernel[STREAM_KERNELS];
+} stress_stream_thread_t;
+
+/*
+ *  stress_stream_thread_mmap()
+ *	mmap an unpopulated array so the first touch is by the
+ *	calling thread, bind it to mem_node if it is not -1
+ */
+static void *stress_stream_thread_mmap(
+	const stress_stream_threads_t *shared,
+	const size_t sz)
+{
+	void *ptr;
+
+	ptr = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return ptr;
+#if defined(HAVE_STREAM_NUMA)
+	if (shared->mem_node >= 0) {
+		unsigned long max_node = 0, node_mask[STREAM_NUMA_MASK_BITS / NUMA_LONG_BITS];
+
+		(void)stress_numa_count_mem_nodes(&max_node);
+		(void)shim_memset(node_mask, 0, sizeof(node_mask));
+		STRESS_SETBIT(node_mask, (unsigned long)shared->mem_node);
+		if (shim_mbind(ptr, (unsigned long)sz, MPOL_BIND, node_mask,
+			       STRESS_MINIMUM(max_node, STREAM_NUMA_MASK_BITS), 0) < 0) {
+			(void)munmap(ptr, sz);
+			return MAP_FAILED;
+		}
+	}
+#endif
+	if (shared->stream_mlock)
+		(void)shim_mlock(ptr, sz);
+	return ptr;
+}
+
+/*
+ *  stress_stream_thread()
+ *	run the stream kernels on arrays that are allocated and first
+ *	touched by this thread until told to stop
+ */
+static void *stress_stream_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_stream_thread_t *thread = (stress_stream_thread_t *)arg;
+	stress_stream_threads_t *shared = thread->shared;
+	const uint64_t n = shared->n;
+	const size_t sz = (size_t)n * sizeof(double);
+	const size_t sz_idx = (size_t)n * sizeof(size_t);
+	double *a = MAP_FAILED, *b = MAP_FAILED, *c = MAP_FAILED;
+	size_t *idx1 = MAP_FAILED, *idx2 = MAP_FAILED, *idx3 = MAP_FAILED;
+	double rd_bytes = 0.0, wr_bytes = 0.0, fp_ops = 0.0;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	if ((shared->cpu_node >= 0) && (stress_node_affinity_set(shared->cpu_node) < 0))
+		goto fail;
+
+	a = (double *)stress_stream_thread_mmap(shared, sz);
+	if (a == MAP_FAILED)
+		goto fail;
+	b = (double *)stress_stream_thread_mmap(shared, sz);
+	if (b == MAP_FAILED)
+		goto fail;
+	c = (double *)stress_stream_thread_mmap(shared, sz);
+	if (c == MAP_FAILED)
+		goto fail;
+	if (shared->stream_index >= 1) {
+		idx1 = (size_t *)stress_stream_thread_mmap(shared, sz_idx);
+		if (idx1 == MAP_FAILED)
+			goto fail;
+		stress_stream_init_index(idx1, n);
+	}
+	if (shared->stream_index >= 2) {
+		idx2 = (size_t *)stress_stream_thread_mmap(shared, sz_idx);
+		if (idx2 == MAP_FAILED)
+			goto fail;
+		stress_stream_init_index(idx2, n);
+	}
+	if (shared->stream_index >= 3) {
+		idx3 = (size_t *)stress_stream_thread_mmap(shared, sz_idx);
+		if (idx3 == MAP_FAILED)
+			goto fail;
+		stress_stream_init_index(idx3, n);
+	}
+	/* first touch, the pages are allocated on the node of this thread */
+	stress_stream_init_data(a, b, c, n);
+
+	while (!shared->stop) {
+		stress_stream_run(a, b, c, 3.0, idx1, idx2, idx3, n, shared->stream_index,
+			shared->nt, thread->kernel, &rd_bytes, &wr_bytes, &fp_ops);
+		thread->rounds++;
+	}
+	goto unmap;
+
+fail:
+	thread->failed = true;
+unmap:
+	if (idx3 != MAP_FAILED)
+		(void)munmap((void *)idx3, sz_idx);
+	if (idx2 != MAP_FAILED)
+		(void)munmap((void *)idx2, sz_idx);
+	if (idx1 != MAP_FAILED)
+		(void)munmap((void *)idx1, sz_idx);
+	if (c != MAP_FAILED)
+		(void)munmap((void *)c, sz);
+	if (b != MAP_FAILED)
+		(void)munmap((void *)b, sz);
+	if (a != MAP_FAILED)
+		(void)munmap((void *)a, sz);
+	return &nowt;
+}
+
+/*
+ *  stress_stream_threads_run()
+ *	run n_threads stream threads for duration seconds, or until
+ *	the stressor is told to stop if duration is zero, the bogo
+ *	ops count is the number of rounds completed by all threads.
+ *	The bandwidth of each kernel summed over the threads is added
+ *	to rate, returns the number of threads that ran or -1 if the
+ *	threads could not be created.
+ */
+static int stress_stream_threads_run(
+	stress_args_t *args,
+	stress_stream_threads_t *shared,
+	stress_stream_thread_t *threads,
+	const uint32_t n_threads,
+	const double duration,
+	double rate[STREAM_KERNELS])
+{
+	const uint64_t bogo_base = stress_bogo_get(args);
+	const double t_start = stress_time_now();
+	uint32_t i, started = 0;
+	int ran = 0, rc = 0;
+	size_t k;
+
+	(void)shim_memset(threads, 0, sizeof(*threads) * n_threads);
+	shared->stop = false;
+	for (i = 0; i < n_threads; i++) {
+		threads[i].shared = shared;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_stream_thread, (void *)&threads[i]);
+		if (threads[i].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, threads[i].ret, strerror(threads[i].ret));
+			rc = -1;
+			break;
+		}
+		started++;
+	}
+
+	while ((rc == 0) && stress_continue(args)) {
+		uint64_t rounds = 0;
+
+		(void)shim_usleep(50000);
+		for (i = 0; i < started; i++)
+			rounds += threads[i].rounds;
+		stress_bogo_set(args, bogo_base + rounds);
+		if ((duration > 0.0) && (stress_time_now() - t_start >= duration))
+			break;
+	}
+
+	shared->stop = true;
+	for (i = 0; i < started; i++) {
+		if (threads[i].ret)
+			continue;
+		(void)pthread_join(threads[i].pthread, NULL);
+		if (threads[i].failed)
+			continue;
+		ran++;
+		for (k = 0; k < STREAM_KERNELS; k++) {
+			const stress_stream_kernel_t *kernel = &threads[i].kernel[k];
+
+			if (kernel->dt > 0.0)
+				rate[k] += kernel->bytes / kernel->dt / 1.0E9;
+		}
+	}
+	return (rc < 0) ? rc : ran;
+}
+
+/*
+ *  stress_stream_threaded()
+ *	run n_threads threads, each with arrays of n doubles that
+ *	are first touched by the thread so the memory is local to
+ *	the NUMA node the thread runs on
+ */
+static int stress_stream_threaded(
+	stress_args_t *args,
+	stress_stream_threads_t *shared,
+	const uint32_t n_threads)
+{
+	stress_stream_thread_t *threads;
+	double rate[STREAM_KERNELS] = { 0.0, 0.0, 0.0, 0.0 };
+	int ran;
+	size_t k;
+
+	threads = (stress_stream_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate thread data, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	shared->cpu_node = -1;
+	shared->mem_node = -1;
+
+	if (args->instance == 0)
+		pr_dbg("%s: %" PRIu32 " threads with %" PRIu64 "K arrays per thread\n",
+			args->name, n_threads, (uint64_t)((shared->n * sizeof(double)) / KB));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	ran = stress_stream_threads_run(args, shared, threads, n_threads, 0.0, rate);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(threads);
+	if (ran < 0)
+		return EXIT_NO_RESOURCE;
+	if (ran == 0) {
+		pr_inf_skip("%s: no threads could allocate their arrays, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (args->instance == 0)
+		pr_inf("%s: %d threads, kernel rate: copy %.2f, scale %.2f, add %.2f, triad %.2f GB/sec\n",
+			args->name, ran, rate[0], rate[1], rate[2], rate[3]);
+	for (k = 0; k < STREAM_KERNELS; k++) {
+		char msg[32];
+
+		(void)snprintf(msg, sizeof(msg), "GB per sec %s rate", stream_kernel_names[k]);
+		stress_metrics_set(args, k, msg, rate[k], STRESS_HARMONIC_MEAN);
+	}
+	return EXIT_SUCCESS;
+}
+
+#if defined(HAVE_STREAM_NUMA)
+/*
+ *  stress_stream_numa_matrix()
+ *	for each pair of NUMA nodes (A, B) run the threads on the CPUs
+ *	of node A with the arrays bound to node B and report the triad
+ *	bandwidth matrix, the off diagonal entries show the bandwidth
+ *	across the socket interconnect
+ */
+static int stress_stream_numa_matrix(
+	stress_args_t *args,
+	stress_stream_threads_t *shared,
+	const uint32_t n_threads)
+{
+	int nodes[STREAM_NUMA_NODES_MAX];
+	double matrix_rate[STREAM_NUMA_NODES_MAX][STREAM_NUMA_NODES_MAX];
+	uint32_t matrix_passes[STREAM_NUMA_NODES_MAX][STREAM_NUMA_NODES_MAX];
+	stress_stream_thread_t *threads;
+	unsigned long max_node = 0, node;
+	size_t n_nodes = 0, i, j, metric = 0;
+	double slice;
+	char buf[16 * STREAM_NUMA_NODES_MAX], *ptr;
+
+	if (stress_numa_count_mem_nodes(&max_node) < 1) {
+		if (args->instance == 0)
+			pr_inf("%s: cannot determine NUMA nodes, ignoring --stream-numa-matrix\n",
+				args->name);
+		return -1;
+	}
+	for (node = 0; (node < max_node) && (n_nodes < STREAM_NUMA_NODES_MAX); node++) {
+		char path[PATH_MAX];
+
+		(void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%lu", node);
+		if ((node < STREAM_NUMA_MASK_BITS) && (access(path, F_OK) == 0))
+			nodes[n_nodes++] = (int)node;
+	}
+	if (n_nodes == 0) {
+		if (args->instance == 0)
+			pr_inf("%s: no NUMA nodes found, ignoring --stream-numa-matrix\n",
+				args->name);
+		return -1;
+	}
+
+	threads = (stress_stream_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate thread data, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(matrix_rate, 0, sizeof(matrix_rate));
+	(void)shim_memset(matrix_passes, 0, sizeof(matrix_passes));
+
+	/* spread the run over all node pairs, repeating if time remains */
+	slice = (double)g_opt_timeout / (double)(n_nodes * n_nodes);
+	slice = STRESS_MINIMUM(5.0, STRESS_MAXIMUM(0.5, slice));
+
+	if (args->instance == 0)
+		pr_dbg("%s: %zu x %zu NUMA node matrix, %" PRIu32 " threads per node pair\n",
+			args->name, n_nodes, n_nodes, n_threads);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_nodes) && stress_continue(args); i++) {
+			for (j = 0; (j < n_nodes) && stress_continue(args); j++) {
+				double rate[STREAM_KERNELS] = { 0.0, 0.0, 0.0, 0.0 };
+				int ran;
+
+				shared->cpu_node = nodes[i];
+				shared->mem_node = nodes[j];
+				ran = stress_stream_threads_run(args, shared, threads, n_threads, slice, rate);
+				if (ran < 0)
+					goto done;
+				if (ran == 0)
+					continue;
+				matrix_rate[i][j] += rate[3];
+				matrix_passes[i][j]++;
+			}
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(threads);
+
+	if (args->instance == 0) {
+		pr_inf("%s: triad GB/sec, CPU node (rows) to memory node (columns):\n", args->name);
+		for (ptr = buf, j = 0; j < n_nodes; j++)
+			ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), " %8s%-2d", "node", nodes[j]);
+		pr_inf("%s: %-8s%s\n", args->name, "cpu\\mem", buf);
+	}
+	for (i = 0; i < n_nodes; i++) {
+		for (ptr = buf, j = 0; j < n_nodes; j++) {
+			const double rate = matrix_passes[i][j] ?
+				matrix_rate[i][j] / (double)matrix_passes[i][j] : 0.0;
+
+			ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), " %10.2f", rate);
+			if (matrix_passes[i][j]) {
+				char msg[64];
+
+				(void)snprintf(msg, sizeof(msg), "GB per sec triad node %d to node %d",
+					nodes[i], nodes[j]);
+				stress_metrics_set(args, metric++, msg, rate, STRESS_HARMONIC_MEAN);
+			}
+		}
+		if (args->instance == 0)
+			pr_inf("%s: node%-4d%s\n", args->name, nodes[i], buf);
+	}
+	return EXIT_SUCCESS;
+}
+#endif
+#endif
+
 /*
  *  stress_stream()
  *	stress cache/memory/CPU with stream stressors
@@ -813,22 +1577,33 @@ static int stress_stream(stress_args_t *args)
 	size_t *idx1 = MAP_FAILED, *idx2 = MAP_FAILED, *idx3 = MAP_FAILED;
 	const double q = 3.0;
 	double old_checksum = -1.0;
-	double fp_ops = 0.0, t1, t2, dt;
+	double fp_ops = 0.0, dt;
 	uint32_t w, z, stream_index = 0;
 	uint64_t L3, sz, n, sz_idx;
 	uint64_t stream_L3_size = DEFAULT_STREAM_L3_SIZE;
 	uint32_t init_counter, init_counter_max;
 	bool guess = false;
 	bool stream_mlock = false;
+	bool stream_sweep = false;
+	bool stream_numa_matrix = false;
+	bool nt;
+	uint32_t stream_threads = 0;
 #if defined(HAVE_NT_STORE_DOUBLE)
-	const bool has_sse2 = stress_cpu_x86_has_sse2();
+	const bool has_nt = stress_cpu_x86_has_sse2();
+#else
+	const bool has_nt = false;
 #endif
 	double rd_bytes = 0.0, wr_bytes = 0.0;
+	stress_stream_kernel_t kernel[STREAM_KERNELS];
+	size_t k;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
 
 	stress_catch_sigill();
 
 	(void)stress_get_setting("stream-mlock", &stream_mlock);
+	(void)stress_get_setting("stream-sweep", &stream_sweep);
+	(void)stress_get_setting("stream-numa-matrix", &stream_numa_matrix);
+	(void)stress_get_setting("stream-threads", &stream_threads);
 
 	if (stress_get_setting("stream-L3-size", &stream_L3_size))
 		L3 = stream_L3_size;
@@ -858,6 +1633,9 @@ static int stress_stream(stress_args_t *args)
 		}
 	}
 
+	if (stream_sweep)
+		return stress_stream_sweep(args, stream_index, stream_mlock, has_nt);
+
 	/* ..and shared amongst all the STREAM stressor instances */
 	L3 /= args->num_instances;
 	if (L3 < args->page_size)
@@ -874,6 +1652,40 @@ static int stress_stream(stress_args_t *args)
 	 */
 	n = (n + 7) & ~(uint64_t)7;
 	sz = n * sizeof(*a);
+	/* streaming stores only help once the arrays spill out of the L3 */
+	nt = has_nt && (3 * sz > L3);
+
+	if (stream_numa_matrix || stream_threads) {
+#if defined(HAVE_STREAM_THREADS)
+		stress_stream_threads_t shared;
+
+		/* the threads split the arrays of the instance between them */
+		if (!stream_threads)
+			stream_threads = (uint32_t)STRESS_MAXIMUM(1,
+				stress_get_processors_online() / stress_numa_nodes());
+		(void)shim_memset(&shared, 0, sizeof(shared));
+		shared.n = STRESS_MAXIMUM((n / stream_threads) & ~(uint64_t)7, 8);
+		shared.stream_index = stream_index;
+		shared.nt = nt;
+		shared.stream_mlock = stream_mlock;
+#if defined(HAVE_STREAM_NUMA)
+		if (stream_numa_matrix) {
+			rc = stress_stream_numa_matrix(args, &shared, stream_threads);
+			if (rc >= 0)
+				return rc;
+		}
+#else
+		if (stream_numa_matrix && (args->instance == 0))
+			pr_inf("%s: NUMA memory binding not supported, ignoring --stream-numa-matrix\n",
+				args->name);
+#endif
+		return stress_stream_threaded(args, &shared, stream_threads);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads not supported, ignoring --stream-threads and --stream-numa-matrix\n",
+				args->name);
+#endif
+	}
 
 	a = stress_stream_mmap(args, sz, stream_mlock);
 	if (a == MAP_FAILED)
@@ -919,7 +1731,7 @@ case_stream_index_1:
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	dt = 0.0;
+	(void)shim_memset(kernel, 0, sizeof(kernel));
 	do {
 		if (init_counter == 0) {
 			stress_mwc_set_seed(w, z);
@@ -929,53 +1741,8 @@ case_stream_index_1:
 		if (init_counter >= init_counter_max)
 			init_counter = 0;
 
-		switch (stream_index) {
-		case 3:
-			t1 = stress_time_now();
-			stress_stream_copy_index3(c, a, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index3(b, c, q, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index3(c, b, a, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index3(a, b, c, q, idx1, idx2, idx3, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		case 2:
-			t1 = stress_time_now();
-			stress_stream_copy_index2(c, a, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index2(b, c, q, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index2(c, b, a, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index2(a, b, c, q, idx1, idx2, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		case 1:
-			t1 = stress_time_now();
-			stress_stream_copy_index1(c, a, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index1(b, c, q, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index1(c, b, a, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index1(a, b, c, q, idx1, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		case 0:
-		default:
-#if defined(HAVE_NT_STORE_DOUBLE)
-			if (has_sse2) {
-				t1 = stress_time_now();
-				stress_stream_copy_index0_nt(c, a, n, &rd_bytes, &wr_bytes, &fp_ops);
-				stress_stream_scale_index0_nt(b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-				stress_stream_add_index0_nt(c, b, a, n,  &rd_bytes, &wr_bytes, &fp_ops);
-				stress_stream_triad_index0_nt(a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-				t2 = stress_time_now();
-				break;
-			}
-#endif
-			t1 = stress_time_now();
-			stress_stream_copy_index0(c, a, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_scale_index0(b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_add_index0(c, b, a, n, &rd_bytes, &wr_bytes, &fp_ops);
-			stress_stream_triad_index0(a, b, c, q, n, &rd_bytes, &wr_bytes, &fp_ops);
-			t2 = stress_time_now();
-			break;
-		}
-		dt += (t2 - t1);
+		stress_stream_run(a, b, c, q, idx1, idx2, idx3, n, stream_index, nt,
+			kernel, &rd_bytes, &wr_bytes, &fp_ops);
 
 		if (verify) {
 			double new_checksum;
@@ -996,6 +1763,9 @@ case_stream_index_1:
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
 
+	for (dt = 0.0, k = 0; k < STREAM_KERNELS; k++)
+		dt += kernel[k].dt;
+
 	if (dt >= 4.5) {
 		const double mb_rd_rate = (rd_bytes / (double)MB) / dt;
 		const double mb_wr_rate = (wr_bytes / (double)MB) / dt;
@@ -1004,12 +1774,28 @@ case_stream_index_1:
 		pr_inf("%s: memory rate: %.2f MB read/sec, %.2f MB write/sec, %.2f double precision Mflop/sec"
 			" (instance %" PRIu32 ")\n",
 			args->name, mb_rd_rate, mb_wr_rate, fp_rate, args->instance);
+		pr_inf("%s: kernel rate: copy %.2f, scale %.2f, add %.2f, triad %.2f GB/sec"
+			" (instance %" PRIu32 ")\n", args->name,
+			(kernel[0].dt > 0.0) ? kernel[0].bytes / kernel[0].dt / 1.0E9 : 0.0,
+			(kernel[1].dt > 0.0) ? kernel[1].bytes / kernel[1].dt / 1.0E9 : 0.0,
+			(kernel[2].dt > 0.0) ? kernel[2].bytes / kernel[2].dt / 1.0E9 : 0.0,
+			(kernel[3].dt > 0.0) ? kernel[3].bytes / kernel[3].dt / 1.0E9 : 0.0,
+			args->instance);
 		stress_metrics_set(args, 0, "MB per sec memory read rate",
 			mb_rd_rate, STRESS_HARMONIC_MEAN);
 		stress_metrics_set(args, 1, "MB per sec memory write rate",
 			mb_wr_rate, STRESS_HARMONIC_MEAN);
 		stress_metrics_set(args, 2, "Mflop per sec (double precision) compute rate",
 			fp_rate, STRESS_HARMONIC_MEAN);
+		for (k = 0; k < STREAM_KERNELS; k++) {
+			char msg[32];
+
+			if (kernel[k].dt <= 0.0)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "GB per sec %s rate", stream_kernel_names[k]);
+			stress_metrics_set(args, 3 + k, msg,
+				kernel[k].bytes / kernel[k].dt / 1.0E9, STRESS_HARMONIC_MEAN);
+		}
 	} else {
 		if (args->instance == 0)
 			pr_inf("%s: run duration too short to reliably determine memory rate\n", args->name);
@@ -1038,6 +1824,9 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_stream_l3_size,	stress_set_stream_L3_size },
 	{ OPT_stream_madvise,	stress_set_stream_madvise },
 	{ OPT_stream_mlock,	stress_set_stream_mlock },
+	{ OPT_stream_numa_matrix, stress_set_stream_numa_matrix },
+	{ OPT_stream_sweep,	stress_set_stream_sweep },
+	{ OPT_stream_threads,	stress_set_stream_threads },
 	{ 0,			NULL }
 };
 
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-latency.h"
 #include "core-madvise.h"
 #include "core-out-of-memory.h"
 
@@ -36,9 +37,27 @@
 #define SHIM_FS_NOCOW_FL		0x00800000 /* No Copy-on-Write file */
 
 static const stress_help_t help[] = {
-	{ NULL,	"swap N",	"start N workers exercising swapon/swapoff" },
-	{ NULL,	"swap-ops N",	"stop after N swapon/swapoff operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"swap N",		"start N workers exercising swapon/swapoff" },
+	{ NULL,	"swap-cluster-sweep",	"sweep /proc/sys/vm/page-cluster swap readahead sizes" },
+	{ NULL,	"swap-ops N",		"stop after N swapon/swapoff operations" },
+	{ NULL,	"swap-zswap-compare",	"compare swapping with zswap enabled and disabled" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_swap_cluster_sweep(const char *opt)
+{
+	return stress_set_setting_true("swap-cluster-sweep", opt);
+}
+
+static int stress_set_swap_zswap_compare(const char *opt)
+{
+	return stress_set_setting_true("swap-zswap-compare", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_swap_cluster_sweep,	stress_set_swap_cluster_sweep },
+	{ OPT_swap_zswap_compare,	stress_set_swap_zswap_compare },
+	{ 0,				NULL }
 };
 
 #if defined(HAVE_SYS_SWAP_H) &&	\
@@ -60,6 +79,12 @@ static const stress_help_t help[] = {
 #define SWAP_FLAG_PRIO_MASK	(0x7fff)
 #endif
 
+#define SWAP_PAGE_CLUSTER_MAX	(5)	/* sweep page-cluster 0..5, 1..32 pages */
+#define SWAP_CONFIGS_MAX	((SWAP_PAGE_CLUSTER_MAX + 1) * 2)
+
+#define SWAP_PAGE_CLUSTER	"/proc/sys/vm/page-cluster"
+#define SWAP_ZSWAP_ENABLED	"/sys/module/zswap/parameters/enabled"
+
 #define SWAP_HDR_SANE		(0x01)
 #define SWAP_HDR_BAD_SIGNATURE	(0x02)
 #define SWAP_HDR_BAD_VERSION	(0x04)
@@ -67,6 +92,17 @@ static const stress_help_t help[] = {
 #define SWAP_HDR_BAD_LAST_PAGE	(0x10)
 #define SWAP_HDR_BAD_NR_BAD	(0x20)
 
+/* swap-out and swap-in statistics for a page-cluster and zswap setting */
+typedef struct {
+	int page_cluster;		/* page-cluster setting, -1 = unchanged */
+	int zswap;			/* zswap enabled setting, -1 = unchanged */
+	double out_bytes;		/* bytes swapped out */
+	double out_duration;		/* time spent swapping out */
+	double in_bytes;		/* bytes swapped in */
+	double in_duration;		/* time spent swapping in */
+	stress_latency_t lat;		/* swap-in (major fault) latency */
+} stress_swap_stats_t;
+
 static const int bad_header_flags[] = {
 	SWAP_HDR_BAD_SIGNATURE,
 	SWAP_HDR_BAD_VERSION,
@@ -194,31 +230,208 @@ static int stress_swap_set_size(
 	return 0;
 }
 
-static void stress_swap_check_swapped(
+/*
+ *  stress_swap_check_swapped()
+ *	count the pages that are not resident, vec holds the
+ *	mincore residency of each page for the swap-in timing
+ */
+static size_t stress_swap_check_swapped(
 	void *addr,
 	const size_t page_size,
 	const uint32_t npages,
+	unsigned char *vec,
 	uint64_t *swapped_out,
 	uint64_t *swapped_total)
 {
-	unsigned char *vec;
 	register size_t n = 0;
 
 	*swapped_total += npages;
 
-	vec = calloc((size_t)npages, sizeof(*vec));
-	if (!vec)
-		return;
-
 	if (shim_mincore(addr, page_size * (size_t)npages, vec) == 0) {
 		register uint32_t i;
 
 		for (i = 0; i < npages; i++)
 			n += ((vec[i] & 1) == 0);
+	} else {
+		/* unknown residency, assume all resident */
+		(void)shim_memset(vec, 1, (size_t)npages);
 	}
 
 	*swapped_out += n;
-	free(vec);
+	return n;
+}
+
+/*
+ *  stress_swap_lat_add()
+ *	add a swap-in latency to a latency histogram
+ */
+static void stress_swap_lat_add(stress_latency_t *lat, const double duration)
+{
+	const uint64_t ns = (duration > 0.0) ? (uint64_t)(duration * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(lat, ns);
+}
+
+/*
+ *  stress_swap_setting_get()
+ *	read an integer or Y/N system setting, -1 if not readable
+ */
+static int stress_swap_setting_get(const char *path)
+{
+	char buf[16];
+
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return -1;
+	if ((buf[0] == 'Y') || (buf[0] == 'y'))
+		return 1;
+	if ((buf[0] == 'N') || (buf[0] == 'n'))
+		return 0;
+	return atoi(buf);
+}
+
+/*
+ *  stress_swap_setting_set()
+ *	write an integer or Y/N (yes_no true) system setting
+ */
+static int stress_swap_setting_set(const char *path, const int value, const bool yes_no)
+{
+	char buf[16];
+
+	if (value < 0)
+		return 0;
+	if (yes_no)
+		(void)snprintf(buf, sizeof(buf), "%c\n", value ? 'Y' : 'N');
+	else
+		(void)snprintf(buf, sizeof(buf), "%d\n", value);
+	return (stress_system_write(path, buf, strlen(buf)) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_swap_configs()
+ *	fill in the page-cluster and zswap settings to rotate
+ *	through, returns the number of configurations
+ */
+static size_t stress_swap_configs(
+	stress_args_t *args,
+	stress_swap_stats_t *stats,
+	const int page_cluster,
+	const int zswap)
+{
+	bool swap_cluster_sweep = false;
+	bool swap_zswap_compare = false;
+	int pc, pc_lo, pc_hi, zs, zs_lo, zs_hi;
+	size_t n = 0;
+
+	(void)stress_get_setting("swap-cluster-sweep", &swap_cluster_sweep);
+	(void)stress_get_setting("swap-zswap-compare", &swap_zswap_compare);
+
+	/* the settings are system wide, so just the first instance changes them */
+	if ((swap_cluster_sweep || swap_zswap_compare) && (args->instance != 0)) {
+		swap_cluster_sweep = false;
+		swap_zswap_compare = false;
+	}
+	if (swap_cluster_sweep &&
+	    ((page_cluster < 0) || (stress_swap_setting_set(SWAP_PAGE_CLUSTER, page_cluster, false) < 0))) {
+		pr_inf("%s: cannot write to %s, ignoring --swap-cluster-sweep\n",
+			args->name, SWAP_PAGE_CLUSTER);
+		swap_cluster_sweep = false;
+	}
+	if (swap_zswap_compare &&
+	    ((zswap < 0) || (stress_swap_setting_set(SWAP_ZSWAP_ENABLED, zswap, true) < 0))) {
+		pr_inf("%s: zswap not available or %s not writable, ignoring --swap-zswap-compare\n",
+			args->name, SWAP_ZSWAP_ENABLED);
+		swap_zswap_compare = false;
+	}
+	pc_lo = swap_cluster_sweep ? 0 : -1;
+	pc_hi = swap_cluster_sweep ? SWAP_PAGE_CLUSTER_MAX : -1;
+	zs_lo = swap_zswap_compare ? 0 : -1;
+	zs_hi = swap_zswap_compare ? 1 : -1;
+
+	for (zs = zs_lo; zs <= zs_hi; zs++) {
+		for (pc = pc_lo; pc <= pc_hi; pc++) {
+			(void)shim_memset(&stats[n], 0, sizeof(stats[n]));
+			stats[n].page_cluster = pc;
+			stats[n].zswap = zs;
+			n++;
+		}
+	}
+	return n;
+}
+
+/*
+ *  stress_swap_report()
+ *	report swap-out/in throughput and swap-in latency percentiles,
+ *	per page-cluster and zswap setting when these are being rotated
+ */
+static void stress_swap_report(
+	stress_args_t *args,
+	const stress_swap_stats_t *stats,
+	const size_t n_configs)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	static stress_swap_stats_t total;
+	size_t i, metric = 0;
+	double rate;
+
+	(void)shim_memset(&total, 0, sizeof(total));
+	for (i = 0; i < n_configs; i++) {
+		total.out_bytes += stats[i].out_bytes;
+		total.out_duration += stats[i].out_duration;
+		total.in_bytes += stats[i].in_bytes;
+		total.in_duration += stats[i].in_duration;
+		stress_latency_merge(&total.lat, &stats[i].lat);
+	}
+
+	rate = (total.out_duration > 0.0) ? total.out_bytes / (total.out_duration * (double)MB) : 0.0;
+	stress_metrics_set(args, metric++, "MB per sec swap out rate", rate, STRESS_GEOMETRIC_MEAN);
+	rate = (total.in_duration > 0.0) ? total.in_bytes / (total.in_duration * (double)MB) : 0.0;
+	stress_metrics_set(args, metric++, "MB per sec swap in rate", rate, STRESS_GEOMETRIC_MEAN);
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		char msg[64];
+
+		(void)snprintf(msg, sizeof(msg), "swap in major fault latency p%g (ns)", percentiles[i]);
+		stress_metrics_set(args, metric++, msg,
+			(double)stress_latency_percentile(&total.lat, percentiles[i]), STRESS_GEOMETRIC_MEAN);
+	}
+	if (n_configs < 2)
+		return;
+
+	pr_inf("%s: %12s %6s %12s %12s %12s %12s\n", args->name, "page-cluster", "zswap",
+		"out MB/s", "in MB/s", "in p50 ns", "in p99 ns");
+	for (i = 0; i < n_configs; i++) {
+		const stress_swap_stats_t *st = &stats[i];
+		const double out_rate = (st->out_duration > 0.0) ?
+			st->out_bytes / (st->out_duration * (double)MB) : 0.0;
+		const double in_rate = (st->in_duration > 0.0) ?
+			st->in_bytes / (st->in_duration * (double)MB) : 0.0;
+		const double p99 = (double)stress_latency_percentile(&st->lat, 99.0);
+		char pc[16], zs[8], msg[80], cfg[48];
+
+		if (st->page_cluster >= 0)
+			(void)snprintf(pc, sizeof(pc), "%d", st->page_cluster);
+		else
+			(void)shim_strscpy(pc, "-", sizeof(pc));
+		if (st->zswap >= 0)
+			(void)shim_strscpy(zs, st->zswap ? "on" : "off", sizeof(zs));
+		else
+			(void)shim_strscpy(zs, "-", sizeof(zs));
+
+		pr_inf("%s: %12s %6s %12.2f %12.2f %12.0f %12.0f\n", args->name, pc, zs,
+			out_rate, in_rate, (double)stress_latency_percentile(&st->lat, 50.0), p99);
+
+		if (st->in_duration <= 0.0)
+			continue;
+		if ((st->page_cluster >= 0) && (st->zswap >= 0))
+			(void)snprintf(cfg, sizeof(cfg), "page-cluster %s, zswap %s", pc, zs);
+		else if (st->page_cluster >= 0)
+			(void)snprintf(cfg, sizeof(cfg), "page-cluster %s", pc);
+		else
+			(void)snprintf(cfg, sizeof(cfg), "zswap %s", zs);
+		(void)snprintf(msg, sizeof(msg), "MB per sec swap in, %s", cfg);
+		stress_metrics_set(args, metric++, msg, in_rate, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "swap in p99 (ns), %s", cfg);
+		stress_metrics_set(args, metric++, msg, p99, STRESS_GEOMETRIC_MEAN);
+	}
 }
 
 static void stress_swap_clean_dir(stress_args_t *args)
@@ -262,6 +475,11 @@ static int stress_swap_child(stress_args_t *args, void *context)
 	int32_t max_swap_pages;
 	const size_t page_size = args->page_size;
 	double swapped_percent;
+	unsigned char vec[MAX_SWAP_PAGES];
+	static stress_swap_stats_t stats[SWAP_CONFIGS_MAX];
+	size_t n_configs, config = 0;
+	const int page_cluster = stress_swap_setting_get(SWAP_PAGE_CLUSTER);
+	const int zswap = stress_swap_setting_get(SWAP_ZSWAP_ENABLED);
 
 	(void)context;
 
@@ -317,9 +535,12 @@ static int stress_swap_child(stress_args_t *args, void *context)
 		goto tidy_close;
 	}
 
+	n_configs = stress_swap_configs(args, stats, page_cluster, zswap);
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
+		stress_swap_stats_t *st = &stats[config];
 		int swapflags = 0;
 		int bad_flags;
 		char *ptr;
@@ -383,12 +604,18 @@ static int stress_swap_child(stress_args_t *args, void *context)
 			goto tidy_close;
 		}
 
+		if (n_configs > 1) {
+			(void)stress_swap_setting_set(SWAP_PAGE_CLUSTER, st->page_cluster, false);
+			(void)stress_swap_setting_set(SWAP_ZSWAP_ENABLED, st->zswap, true);
+		}
+
 		ptr = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
 				MAP_SHARED | MAP_ANONYMOUS, -1, 0);
 		if (ptr != MAP_FAILED) {
-			size_t i;
+			size_t i, n;
 			const char *p_end = ptr + mmap_size;
 			char *p;
+			double t;
 
 			/* Add simple check value to start of each page */
 			for (i = 0, p = ptr; p < p_end; p += page_size, i++) {
@@ -397,17 +624,34 @@ static int stress_swap_child(stress_args_t *args, void *context)
 				(void)shim_memset(p, (int)i, page_size);
 				*up = (uintptr_t)p;
 			}
+			t = stress_time_now();
 #if defined(MADV_PAGEOUT)
 			(void)shim_madvise(ptr, mmap_size, MADV_PAGEOUT);
 #endif
-			stress_swap_check_swapped(ptr, page_size, npages,
-				&swapped_out, &swapped_total);
+			t = stress_time_now() - t;
+			n = stress_swap_check_swapped(ptr, page_size, npages,
+				vec, &swapped_out, &swapped_total);
+			if (n) {
+				st->out_bytes += (double)(n * page_size);
+				st->out_duration += t;
+			}
 
-			/* Check page has check address value */
+			/* Check page has check address value, time the swap-ins */
 			for (i = 0, p = ptr; p < p_end; p += page_size, i++) {
 				uintptr_t *up = (uintptr_t *)(uintptr_t)p;
-
-				if (*up != (uintptr_t)p) {
+				uintptr_t val;
+
+				if ((vec[i] & 1) == 0) {
+					t = stress_time_now();
+					val = *(volatile uintptr_t *)up;
+					t = stress_time_now() - t;
+					st->in_bytes += (double)page_size;
+					st->in_duration += t;
+					stress_swap_lat_add(&st->lat, t);
+				} else {
+					val = *up;
+				}
+				if (val != (uintptr_t)p) {
 					pr_fail("%s: failed: address %p contains "
 						"%" PRIuPTR " and not %" PRIuPTR "\n",
 						args->name, (void *)p, *up, (uintptr_t)p);
@@ -441,8 +685,16 @@ static int stress_swap_child(stress_args_t *args, void *context)
 			VOID_RET(int, stress_swapoff(filename));/* Should never happen */
 
 		stress_bogo_inc(args);
+		config = (config + 1) % n_configs;
 	} while (stress_continue(args));
 
+	/* restore the original system settings */
+	if (n_configs > 1) {
+		(void)stress_swap_setting_set(SWAP_PAGE_CLUSTER, page_cluster, false);
+		(void)stress_swap_setting_set(SWAP_ZSWAP_ENABLED, zswap, true);
+	}
+	stress_swap_report(args, stats, n_configs);
+
 	swapped_percent = (swapped_total == 0) ?
 		0.0 : (100.0 * (double)swapped_out) / (double)swapped_total;
 	pr_inf("%s: %" PRIu64 " of %" PRIu64 " (%.2f%%) pages were swapped out\n",
@@ -478,6 +730,7 @@ stressor_info_t stress_swap_info = {
 	.stressor = stress_swap,
 	.supported = stress_swap_supported,
 	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -485,6 +738,7 @@ stressor_info_t stress_swap_info = {
 stressor_info_t stress_swap_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sys/swap.h or swap() system call"
@@ -20,8 +20,11 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-latency.h"
 #include "core-killpid.h"
 
+#include <sched.h>
+
 #if defined(HAVE_MQUEUE_H)
 #include <mqueue.h>
 #else
@@ -34,9 +37,18 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
+#if defined(HAVE_LINUX_FUTEX_H)
+#include <linux/futex.h>
+#endif
+
 static const stress_help_t help[] = {
 	{ "s N","switch N",	 	"start N workers doing rapid context switches" },
 	{ NULL, "switch-freq N", 	"set frequency of context switches" },
+	{ NULL, "switch-latency",	"measure round trip wake up latency across CPU placements" },
 	{ NULL, "switch-method M",	"mq | pipe | sem-sysv" },
 	{ NULL,	"switch-ops N",	 	"stop after N context switch bogo operations" },
 	{ NULL, NULL, 			NULL }
@@ -522,6 +534,554 @@ static int stress_set_switch_method(const char *name)
 	return -1;
 }
 
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define STRESS_SWITCH_LATENCY
+#endif
+
+#if defined(STRESS_SWITCH_LATENCY)
+
+#define SWITCH_LAT_WARMUP	(100)	/* untimed round trips per pass */
+
+#define SWITCH_LAT_TO_CHILD	(0)	/* parent wakes child */
+#define SWITCH_LAT_TO_PARENT	(1)	/* child wakes parent */
+
+/* the two wake up channels, one per direction */
+typedef struct {
+	int fds[2][2];			/* pipe and eventfd file descriptors */
+	int sem_id;			/* SYSV semaphore set */
+#if defined(HAVE_MQUEUE_H) &&	\
+    defined(HAVE_LIB_RT) &&	\
+    defined(HAVE_MQ_POSIX)
+	mqd_t mq[2];			/* POSIX message queues */
+#endif
+	uint32_t *futex;		/* futex words in a shared mapping */
+} stress_switch_lat_chan_t;
+
+typedef struct {
+	const char *name;
+	int (*open)(stress_args_t *args, stress_switch_lat_chan_t *ch);
+	void (*close)(stress_switch_lat_chan_t *ch);
+	int (*post)(stress_switch_lat_chan_t *ch, const int dir);
+	int (*wait)(stress_switch_lat_chan_t *ch, const int dir);
+} stress_switch_lat_method_t;
+
+/* a pair of CPUs of a topology placement */
+typedef struct {
+	const char *name;
+	int32_t cpu_parent;
+	int32_t cpu_child;
+} stress_switch_lat_placement_t;
+
+static int stress_switch_lat_pipe_open(stress_args_t *args, stress_switch_lat_chan_t *ch)
+{
+	if (pipe(ch->fds[0]) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+		return -1;
+	}
+	if (pipe(ch->fds[1]) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+		(void)close(ch->fds[0][0]);
+		(void)close(ch->fds[0][1]);
+		return -1;
+	}
+	return 0;
+}
+
+static void stress_switch_lat_pipe_close(stress_switch_lat_chan_t *ch)
+{
+	(void)close(ch->fds[0][0]);
+	(void)close(ch->fds[0][1]);
+	(void)close(ch->fds[1][0]);
+	(void)close(ch->fds[1][1]);
+}
+
+static int stress_switch_lat_pipe_post(stress_switch_lat_chan_t *ch, const int dir)
+{
+	const char ch_val = 'x';
+
+	return (write(ch->fds[dir][1], &ch_val, sizeof(ch_val)) == (ssize_t)sizeof(ch_val)) ? 0 : -1;
+}
+
+static int stress_switch_lat_pipe_wait(stress_switch_lat_chan_t *ch, const int dir)
+{
+	char ch_val;
+
+	return (read(ch->fds[dir][0], &ch_val, sizeof(ch_val)) == (ssize_t)sizeof(ch_val)) ? 0 : -1;
+}
+
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+static int stress_switch_lat_eventfd_open(stress_args_t *args, stress_switch_lat_chan_t *ch)
+{
+	ch->fds[0][0] = eventfd(0, 0);
+	if (ch->fds[0][0] < 0) {
+		pr_fail("%s: eventfd failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+		return -1;
+	}
+	ch->fds[1][0] = eventfd(0, 0);
+	if (ch->fds[1][0] < 0) {
+		pr_fail("%s: eventfd failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+		(void)close(ch->fds[0][0]);
+		return -1;
+	}
+	return 0;
+}
+
+static void stress_switch_lat_eventfd_close(stress_switch_lat_chan_t *ch)
+{
+	(void)close(ch->fds[0][0]);
+	(void)close(ch->fds[1][0]);
+}
+
+static int stress_switch_lat_eventfd_post(stress_switch_lat_chan_t *ch, const int dir)
+{
+	const uint64_t val = 1;
+
+	return (write(ch->fds[dir][0], &val, sizeof(val)) == (ssize_t)sizeof(val)) ? 0 : -1;
+}
+
+static int stress_switch_lat_eventfd_wait(stress_switch_lat_chan_t *ch, const int dir)
+{
+	uint64_t val;
+
+	return (read(ch->fds[dir][0], &val, sizeof(val)) == (ssize_t)sizeof(val)) ? 0 : -1;
+}
+#endif
+
+#if defined(HAVE_LINUX_FUTEX_H)
+static int stress_switch_lat_futex_open(stress_args_t *args, stress_switch_lat_chan_t *ch)
+{
+	/* one futex word per cache line, shared with the child */
+	ch->futex = (uint32_t *)mmap(NULL, args->page_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (ch->futex == MAP_FAILED) {
+		pr_fail("%s: mmap of futexes failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void stress_switch_lat_futex_close(stress_switch_lat_chan_t *ch)
+{
+	(void)munmap((void *)ch->futex, (size_t)stress_get_page_size());
+}
+
+static int stress_switch_lat_futex_post(stress_switch_lat_chan_t *ch, const int dir)
+{
+	uint32_t *futex = &ch->futex[dir * 16];
+
+	__atomic_store_n(futex, 1, __ATOMIC_RELEASE);
+	(void)shim_futex_wake(futex, 1);
+	return 0;
+}
+
+static int stress_switch_lat_futex_wait(stress_switch_lat_chan_t *ch, const int dir)
+{
+	uint32_t *futex = &ch->futex[dir * 16];
+
+	while (__atomic_exchange_n(futex, 0, __ATOMIC_ACQUIRE) == 0) {
+		if ((shim_futex_wait(futex, 0, NULL) < 0) && (errno == EINTR))
+			return -1;
+	}
+	return 0;
+}
+#endif
+
+#if defined(HAVE_SEM_SYSV) &&	\
+    defined(HAVE_KEY_T)
+static int stress_switch_lat_sem_sysv_open(stress_args_t *args, stress_switch_lat_chan_t *ch)
+{
+	int i;
+
+	ch->sem_id = semget(IPC_PRIVATE, 2, IPC_CREAT | S_IRUSR | S_IWUSR);
+	if (ch->sem_id < 0) {
+		pr_inf("%s: semget failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		union semun {
+			int val;
+		} arg;
+
+		arg.val = 0;
+		if (semctl(ch->sem_id, i, SETVAL, arg) < 0) {
+			pr_fail("%s: semctl failed, errno=%d (%s)\n", args->name, errno, strerror(errno));
+			(void)semctl(ch->sem_id, 0, IPC_RMID);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void stress_switch_lat_sem_sysv_close(stress_switch_lat_chan_t *ch)
+{
+	(void)semctl(ch->sem_id, 0, IPC_RMID);
+}
+
+static int stress_switch_lat_sem_sysv_post(stress_switch_lat_chan_t *ch, const int dir)
+{
+	struct sembuf sop;
+
+	sop.sem_num = (unsigned short)dir;
+	sop.sem_op = 1;
+	sop.sem_flg = 0;
+	return semop(ch->sem_id, &sop, 1);
+}
+
+static int stress_switch_lat_sem_sysv_wait(stress_switch_lat_chan_t *ch, const int dir)
+{
+	struct sembuf sop;
+
+	sop.sem_num = (unsigned short)dir;
+	sop.sem_op = -1;
+	sop.sem_flg = 0;
+	return semop(ch->sem_id, &sop, 1);
+}
+#endif
+
+#if defined(HAVE_MQUEUE_H) &&	\
+    defined(HAVE_LIB_RT) &&	\
+    defined(HAVE_MQ_POSIX)
+static int stress_switch_lat_mq_open(stress_args_t *args, stress_switch_lat_chan_t *ch)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct mq_attr attr;
+		char mq_name[64];
+
+		(void)snprintf(mq_name, sizeof(mq_name), "/%s-lat-%" PRIdMAX "-%" PRIu32 "-%d",
+			args->name, (intmax_t)args->pid, args->instance, i);
+		attr.mq_flags = 0;
+		attr.mq_maxmsg = 1;
+		attr.mq_msgsize = sizeof(uint64_t);
+		attr.mq_curmsgs = 0;
+		ch->mq[i] = mq_open(mq_name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR, &attr);
+		if (ch->mq[i] < 0) {
+			pr_inf("%s: message queue open failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			if (i > 0)
+				(void)mq_close(ch->mq[0]);
+			return -1;
+		}
+		/* the descriptors are inherited by the child, the names are not needed */
+		(void)mq_unlink(mq_name);
+	}
+	return 0;
+}
+
+static void stress_switch_lat_mq_close(stress_switch_lat_chan_t *ch)
+{
+	(void)mq_close(ch->mq[0]);
+	(void)mq_close(ch->mq[1]);
+}
+
+static int stress_switch_lat_mq_post(stress_switch_lat_chan_t *ch, const int dir)
+{
+	const uint64_t val = 1;
+
+	return mq_send(ch->mq[dir], (const char *)&val, sizeof(val), 0);
+}
+
+static int stress_switch_lat_mq_wait(stress_switch_lat_chan_t *ch, const int dir)
+{
+	uint64_t val;
+	unsigned int prio;
+
+	return (mq_receive(ch->mq[dir], (char *)&val, sizeof(val), &prio) < 0) ? -1 : 0;
+}
+#endif
+
+static const stress_switch_lat_method_t stress_switch_lat_methods[] = {
+	{ "pipe",	stress_switch_lat_pipe_open, stress_switch_lat_pipe_close,
+			stress_switch_lat_pipe_post, stress_switch_lat_pipe_wait },
+#if defined(HAVE_SYS_EVENTFD_H) &&	\
+    defined(HAVE_EVENTFD)
+	{ "eventfd",	stress_switch_lat_eventfd_open, stress_switch_lat_eventfd_close,
+			stress_switch_lat_eventfd_post, stress_switch_lat_eventfd_wait },
+#endif
+#if defined(HAVE_LINUX_FUTEX_H)
+	{ "futex",	stress_switch_lat_futex_open, stress_switch_lat_futex_close,
+			stress_switch_lat_futex_post, stress_switch_lat_futex_wait },
+#endif
+#if defined(HAVE_MQUEUE_H) &&	\
+    defined(HAVE_LIB_RT) &&	\
+    defined(HAVE_MQ_POSIX)
+	{ "mq",		stress_switch_lat_mq_open, stress_switch_lat_mq_close,
+			stress_switch_lat_mq_post, stress_switch_lat_mq_wait },
+#endif
+#if defined(HAVE_SEM_SYSV) &&	\
+    defined(HAVE_KEY_T)
+	{ "sem-sysv",	stress_switch_lat_sem_sysv_open, stress_switch_lat_sem_sysv_close,
+			stress_switch_lat_sem_sysv_post, stress_switch_lat_sem_sysv_wait },
+#endif
+};
+
+/*
+ *  stress_switch_lat()
+ *	add the time from t_start to t_end to a latency histogram
+ */
+static inline void stress_switch_lat(stress_latency_t *lat, const double t_start, const double t_end)
+{
+	const uint64_t ns = (t_end > t_start) ? (uint64_t)((t_end - t_start) * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(lat, ns);
+}
+
+/*
+ *  stress_switch_lat_pin()
+ *	pin the calling process to a CPU
+ */
+static void stress_switch_lat_pin(const int32_t cpu)
+{
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET((int)cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+/*
+ *  stress_switch_lat_pass()
+ *	round trip wake ups between a parent and child pinned to
+ *	the placement CPUs for duration seconds, returns -1 on error
+ */
+static int stress_switch_lat_pass(
+	stress_args_t *args,
+	const stress_switch_lat_method_t *method,
+	const stress_switch_lat_placement_t *placement,
+	const double duration,
+	stress_latency_t *lat,
+	double *rtt_total,
+	uint64_t *rtt_count)
+{
+	stress_switch_lat_chan_t ch;
+	double t_end;
+	pid_t pid;
+	int i, rc = 0;
+
+	(void)shim_memset(&ch, 0, sizeof(ch));
+	if (method->open(args, &ch) < 0)
+		return -1;
+
+	stress_switch_lat_pin(placement->cpu_parent);
+again:
+	pid = fork();
+	if (pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		method->close(&ch);
+		if (!stress_continue(args))
+			return 0;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	} else if (pid == 0) {
+		stress_switch_lat_pin(placement->cpu_child);
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+
+		while (stress_continue_flag()) {
+			if (method->wait(&ch, SWITCH_LAT_TO_CHILD) < 0) {
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			if (method->post(&ch, SWITCH_LAT_TO_PARENT) < 0)
+				break;
+		}
+		_exit(EXIT_SUCCESS);
+	}
+
+	t_end = stress_time_now() + duration;
+	for (i = 0; stress_continue(args); i++) {
+		double t_start;
+
+		t_start = stress_time_now();
+		if (method->post(&ch, SWITCH_LAT_TO_CHILD) < 0) {
+			if (errno != EINTR) {
+				pr_fail("%s: %s wake of child failed, errno=%d (%s)\n",
+					args->name, method->name, errno, strerror(errno));
+				rc = -1;
+			}
+			break;
+		}
+		if (method->wait(&ch, SWITCH_LAT_TO_PARENT) < 0) {
+			if (errno != EINTR) {
+				pr_fail("%s: %s wait for child failed, errno=%d (%s)\n",
+					args->name, method->name, errno, strerror(errno));
+				rc = -1;
+			}
+			break;
+		}
+		if (i >= SWITCH_LAT_WARMUP) {
+			const double t = stress_time_now();
+
+			stress_switch_lat(lat, t_start, t);
+			*rtt_total += t - t_start;
+			(*rtt_count)++;
+			stress_bogo_inc(args);
+			if (t >= t_end)
+				break;
+		}
+	}
+
+	(void)stress_kill_pid_wait(pid, NULL);
+	method->close(&ch);
+
+	return rc;
+}
+
+/*
+ *  stress_switch_latency()
+ *	measure the round trip wake up latency of each switch method
+ *	with the two processes on the same CPU, SMT siblings, sharing
+ *	a last level cache, on different caches and packages
+ */
+static int stress_switch_latency(stress_args_t *args)
+{
+	static const char * const placement_names[] = {
+		"same-cpu", "smt", "same-llc", "cross-llc", "cross-package",
+	};
+	typedef struct {
+		stress_latency_t lat;
+		double rtt_total;
+		uint64_t rtt_count;
+		bool failed;
+	} stress_switch_lat_result_t;
+
+	stress_switch_lat_placement_t placements[SIZEOF_ARRAY(placement_names)];
+	stress_switch_lat_result_t *results;
+	stress_placement_cpu_t *topology;
+	cpu_set_t proc_mask;
+	const size_t n_methods = SIZEOF_ARRAY(stress_switch_lat_methods);
+	size_t n_cpus = 0, n_placements = 0, n_results, i, idx = 0, metric = 0;
+	double slice;
+	int rc = EXIT_SUCCESS;
+
+	if (sched_getaffinity(0, sizeof(proc_mask), &proc_mask) < 0) {
+		pr_fail("%s: sched_getaffinity could not get CPU affinity, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	topology = (stress_placement_cpu_t *)calloc((size_t)CPU_SETSIZE, sizeof(*topology));
+	if (!topology) {
+		pr_inf_skip("%s: cannot allocate CPU table, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < CPU_SETSIZE; i++) {
+		if (CPU_ISSET((int)i, &proc_mask))
+			stress_placement_topology(&topology[n_cpus++], (int32_t)i);
+	}
+	if (n_cpus == 0) {
+		free(topology);
+		pr_inf_skip("%s: no usable CPUs, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* the first CPU of this instance and the first CPU of each class away from it */
+	{
+		const stress_placement_cpu_t *a = &topology[args->instance % n_cpus];
+		int32_t found[SIZEOF_ARRAY(placement_names)];
+
+		for (i = 0; i < SIZEOF_ARRAY(found); i++)
+			found[i] = -1;
+		found[0] = a->cpu;
+		for (i = 0; i < n_cpus; i++) {
+			const stress_placement_cpu_t *b = &topology[i];
+			size_t class;
+
+			if (b->cpu == a->cpu)
+				continue;
+			if (b->package != a->package)
+				class = 4;
+			else if (b->core == a->core)
+				class = 1;
+			else if (b->llc == a->llc)
+				class = 2;
+			else
+				class = 3;
+			if (found[class] < 0)
+				found[class] = b->cpu;
+		}
+		for (i = 0; i < SIZEOF_ARRAY(found); i++) {
+			if (found[i] < 0)
+				continue;
+			placements[n_placements].name = placement_names[i];
+			placements[n_placements].cpu_parent = a->cpu;
+			placements[n_placements].cpu_child = found[i];
+			n_placements++;
+		}
+	}
+	free(topology);
+
+	n_results = n_methods * n_placements;
+	results = (stress_switch_lat_result_t *)calloc(n_results, sizeof(*results));
+	if (!results) {
+		pr_inf_skip("%s: cannot allocate results, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	slice = (g_opt_timeout > 0) ? (double)g_opt_timeout / (double)n_results : 1.0;
+	slice = STRESS_MAXIMUM(0.1, STRESS_MINIMUM(2.0, slice));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		stress_switch_lat_result_t *result = &results[idx];
+
+		if (!result->failed &&
+		    (stress_switch_lat_pass(args, &stress_switch_lat_methods[idx / n_placements],
+				&placements[idx % n_placements], slice, &result->lat,
+				&result->rtt_total, &result->rtt_count) < 0)) {
+			result->failed = true;
+			rc = EXIT_FAILURE;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)sched_setaffinity(0, sizeof(proc_mask), &proc_mask);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %-14s %9s %9s %10s %10s %10s\n", args->name,
+			"method", "placement", "cpus", "mean ns", "p50 ns", "p99 ns", "p99.9 ns");
+	for (i = 0; i < n_results; i++) {
+		const stress_switch_lat_result_t *result = &results[i];
+		const char *method_name = stress_switch_lat_methods[i / n_placements].name;
+		const stress_switch_lat_placement_t *placement = &placements[i % n_placements];
+		char cpus[24], str[64];
+
+		if (result->rtt_count == 0)
+			continue;
+		if (args->instance == 0) {
+			(void)snprintf(cpus, sizeof(cpus), "%" PRId32 ",%" PRId32,
+				placement->cpu_parent, placement->cpu_child);
+			pr_inf("%s: %-9s %-14s %9s %9.0f %10.0f %10.0f %10.0f\n", args->name,
+				method_name, placement->name, cpus,
+				STRESS_DBL_NANOSECOND * result->rtt_total / (double)result->rtt_count,
+				(double)stress_latency_percentile(&result->lat, 50.0),
+				(double)stress_latency_percentile(&result->lat, 99.0),
+				(double)stress_latency_percentile(&result->lat, 99.9));
+		}
+		if (metric + 2 > STRESS_STRESSOR_METRICS_MAX)
+			continue;
+		(void)snprintf(str, sizeof(str), "%s %s round trip p50 (ns)",
+			method_name, placement->name);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&result->lat, 50.0), STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s %s round trip p99 (ns)",
+			method_name, placement->name);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&result->lat, 99.0), STRESS_GEOMETRIC_MEAN);
+	}
+	free(results);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_switch
  *	stress by heavy context switching
@@ -530,7 +1090,19 @@ static int stress_switch(stress_args_t *args)
 {
 	uint64_t switch_freq = 0, switch_delay, threshold;
 	size_t switch_method;
+	bool switch_latency = false;
 
+	(void)stress_get_setting("switch-latency", &switch_latency);
+	if (switch_latency) {
+#if defined(STRESS_SWITCH_LATENCY)
+		return stress_switch_latency(args);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: switch-latency requires sched_getaffinity and "
+				"sched_setaffinity, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
 	(void)stress_get_setting("switch-freq", &switch_freq);
 	(void)stress_get_setting("switch-method", &switch_method);
 
@@ -545,8 +1117,14 @@ static void stress_switch_set_default(void)
 	stress_set_switch_method("pipe");
 }
 
+static int stress_set_switch_latency(const char *opt)
+{
+	return stress_set_setting_true("switch-latency", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_switch_freq,	stress_set_switch_freq },
+	{ OPT_switch_latency,	stress_set_switch_latency },
 	{ OPT_switch_method,	stress_set_switch_method },
 	{ 0,			NULL }
 };
@@ -18,15 +18,30 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-latency.h"
+#include "core-pthread.h"
 
 #define MIN_SYNC_FILE_BYTES	(1 * MB)
 #define MAX_SYNC_FILE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_SYNC_FILE_BYTES	(1 * GB)
 
+#define MIN_SYNC_FILE_WRITERS		(1)
+#define MAX_SYNC_FILE_WRITERS		(64)
+#define DEFAULT_SYNC_FILE_WRITERS	(4)
+
+#define SYNC_FILE_RECORD_SIZE		(128)
+#define SYNC_FILE_JOURNAL_SLICE		(1.0)		/* seconds per commit mode */
+#define SYNC_FILE_COMMIT_DELAY_NS	(200000)	/* group commit wait */
+/* no-group + powers of 2 up to MAX_SYNC_FILE_WRITERS */
+#define SYNC_FILE_BATCHES_MAX		(8)
+
 static const stress_help_t help[] = {
 	{ NULL,	"sync-file N",	     "start N workers exercise sync_file_range" },
 	{ NULL,	"sync-file-bytes N", "size of file to be sync'd" },
+	{ NULL,	"sync-file-journal", "append records and fsync, with and without group commit" },
 	{ NULL,	"sync-file-ops N",   "stop after N sync_file_range bogo operations" },
+	{ NULL,	"sync-file-writers N", "number of journal writer threads" },
 	{ NULL,	NULL,		     NULL }
 };
 
@@ -53,13 +68,54 @@ static int stress_set_sync_file_bytes(const char *opt)
 	return stress_set_setting("sync_file-bytes", TYPE_ID_OFF_T, &sync_file_bytes);
 }
 
+static int stress_set_sync_file_journal(const char *opt)
+{
+	return stress_set_setting_true("sync-file-journal", opt);
+}
+
+static int stress_set_sync_file_writers(const char *opt)
+{
+	size_t sync_file_writers;
+
+	sync_file_writers = (size_t)stress_get_uint32(opt);
+	stress_check_range("sync-file-writers", (uint64_t)sync_file_writers,
+		MIN_SYNC_FILE_WRITERS, MAX_SYNC_FILE_WRITERS);
+	return stress_set_setting("sync-file-writers", TYPE_ID_SIZE_T, &sync_file_writers);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_sync_file_bytes,	stress_set_sync_file_bytes },
+	{ OPT_sync_file_journal, stress_set_sync_file_journal },
+	{ OPT_sync_file_writers, stress_set_sync_file_writers },
 	{ 0,			NULL }
 };
 
 #if defined(HAVE_SYNC_FILE_RANGE)
 
+typedef struct {
+	stress_latency_t latency;	/* fsync latency */
+	double fsyncs;			/* fsync calls */
+	double records;			/* records committed */
+	double duration;		/* run time */
+} stress_sync_file_stats_t;
+
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_mutex_t lock;		/* protects everything below */
+	pthread_cond_t written;		/* writer to coordinator */
+	pthread_cond_t committed;	/* coordinator to writers */
+	int fd;				/* journal file */
+	size_t batch;			/* group size, 0 = no group commit */
+	size_t writers_active;		/* running writer threads */
+	uint64_t write_seq;		/* records written */
+	uint64_t commit_seq;		/* records made durable */
+	volatile bool stop;		/* writers should stop */
+	bool coordinator_done;		/* coordinator has finished */
+	int fsync_errno;		/* fsync failure */
+	stress_sync_file_stats_t *stats;
+} stress_sync_file_journal_t;
+#endif
+
 /*
  *  shrink and re-allocate the file to be sync'd
  *
@@ -105,6 +161,315 @@ static int stress_sync_allocate(
 	return 0;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_sync_file_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_sync_file_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_sync_file_fsync()
+ *	fsync the journal and account the latency, called with
+ *	the journal lock held, drops it over the fsync
+ */
+static int stress_sync_file_fsync(stress_sync_file_journal_t *journal)
+{
+	uint64_t t, ns;
+	int ret;
+
+	(void)pthread_mutex_unlock(&journal->lock);
+	t = stress_sync_file_now_ns();
+	ret = shim_fsync(journal->fd);
+	ns = stress_sync_file_now_ns() - t;
+	(void)pthread_mutex_lock(&journal->lock);
+
+	if (ret < 0) {
+		if ((errno != ENOSPC) && (errno != EINTR))
+			journal->fsync_errno = errno;
+		return -1;
+	}
+	stress_latency_add(&journal->stats->latency, ns);
+	journal->stats->fsyncs += 1.0;
+	return 0;
+}
+
+/*
+ *  stress_sync_file_writer()
+ *	append small records to the journal, either syncing each
+ *	record or waiting for the group commit coordinator
+ */
+static void *stress_sync_file_writer(void *ptr)
+{
+	static void *nowt = NULL;
+	stress_sync_file_journal_t *journal = (stress_sync_file_journal_t *)ptr;
+	char record[SYNC_FILE_RECORD_SIZE];
+	uint64_t n = 0;
+
+	(void)shim_memset(record, 'J', sizeof(record));
+	record[sizeof(record) - 1] = '\n';
+
+	while (!journal->stop && stress_continue_flag()) {
+		uint64_t seq;
+
+		(void)snprintf(record, sizeof(record) - 1, "%16.16" PRIx64, n++);
+		if (write(journal->fd, record, sizeof(record)) != (ssize_t)sizeof(record))
+			break;
+
+		(void)pthread_mutex_lock(&journal->lock);
+		if (journal->batch == 0) {
+			if (stress_sync_file_fsync(journal) == 0)
+				journal->stats->records += 1.0;
+			(void)pthread_mutex_unlock(&journal->lock);
+			continue;
+		}
+		seq = ++journal->write_seq;
+		(void)pthread_cond_signal(&journal->written);
+		while ((journal->commit_seq < seq) && !journal->coordinator_done)
+			(void)pthread_cond_wait(&journal->committed, &journal->lock);
+		(void)pthread_mutex_unlock(&journal->lock);
+	}
+
+	(void)pthread_mutex_lock(&journal->lock);
+	journal->writers_active--;
+	(void)pthread_cond_signal(&journal->written);
+	(void)pthread_mutex_unlock(&journal->lock);
+
+	return &nowt;
+}
+
+/*
+ *  stress_sync_file_coordinator()
+ *	group commit, wait for a batch of records (bounded by the
+ *	active writers) or the commit delay, then one fsync commits
+ *	every record written so far
+ */
+static void stress_sync_file_coordinator(
+	stress_sync_file_journal_t *journal,
+	const double t_end)
+{
+	(void)pthread_mutex_lock(&journal->lock);
+	for (;;) {
+		uint64_t pending, seq;
+		size_t target;
+
+		if (!journal->stop && ((stress_time_now() >= t_end) || !stress_continue_flag()))
+			journal->stop = true;
+
+		pending = journal->write_seq - journal->commit_seq;
+		if ((journal->writers_active == 0) && (pending == 0))
+			break;
+		target = STRESS_MAXIMUM(STRESS_MINIMUM(journal->batch, journal->writers_active), 1);
+		if (pending < target) {
+			struct timespec abstime;
+			int ret;
+
+			if (clock_gettime(CLOCK_REALTIME, &abstime) < 0)
+				break;
+			abstime.tv_nsec += SYNC_FILE_COMMIT_DELAY_NS;
+			if (abstime.tv_nsec >= STRESS_NANOSECOND) {
+				abstime.tv_nsec -= STRESS_NANOSECOND;
+				abstime.tv_sec++;
+			}
+			ret = pthread_cond_timedwait(&journal->written, &journal->lock, &abstime);
+			pending = journal->write_seq - journal->commit_seq;
+			if (pending == 0)
+				continue;
+			/* keep gathering unless the commit delay has expired */
+			target = STRESS_MAXIMUM(STRESS_MINIMUM(journal->batch, journal->writers_active), 1);
+			if ((ret != ETIMEDOUT) && (pending < target))
+				continue;
+		}
+		seq = journal->write_seq;
+		if (stress_sync_file_fsync(journal) == 0)
+			journal->stats->records += (double)(seq - journal->commit_seq);
+		journal->commit_seq = seq;
+		(void)pthread_cond_broadcast(&journal->committed);
+	}
+	journal->coordinator_done = true;
+	(void)pthread_cond_broadcast(&journal->committed);
+	(void)pthread_mutex_unlock(&journal->lock);
+}
+
+/*
+ *  stress_sync_file_journal_run()
+ *	run the writers for one time slice in one commit mode
+ */
+static int stress_sync_file_journal_run(
+	stress_args_t *args,
+	const int fd,
+	const size_t writers,
+	const size_t batch,
+	stress_sync_file_stats_t *stats)
+{
+	stress_sync_file_journal_t journal;
+	pthread_t *pthreads;
+	int *create_ret;
+	size_t i;
+	double t_start, t_end;
+	const double records = stats->records;
+
+	pthreads = (pthread_t *)calloc(writers, sizeof(*pthreads));
+	if (!pthreads)
+		return -ENOMEM;
+	create_ret = (int *)calloc(writers, sizeof(*create_ret));
+	if (!create_ret) {
+		free(pthreads);
+		return -ENOMEM;
+	}
+	if (ftruncate(fd, 0) < 0) {
+		free(create_ret);
+		free(pthreads);
+		return -errno;
+	}
+
+	(void)shim_memset(&journal, 0, sizeof(journal));
+	(void)pthread_mutex_init(&journal.lock, NULL);
+	(void)pthread_cond_init(&journal.written, NULL);
+	(void)pthread_cond_init(&journal.committed, NULL);
+	journal.fd = fd;
+	journal.batch = batch;
+	journal.stats = stats;
+
+	t_start = stress_time_now();
+	for (i = 0; i < writers; i++) {
+		(void)pthread_mutex_lock(&journal.lock);
+		journal.writers_active++;
+		(void)pthread_mutex_unlock(&journal.lock);
+		create_ret[i] = pthread_create(&pthreads[i], NULL, stress_sync_file_writer, &journal);
+		if (create_ret[i] != 0) {
+			(void)pthread_mutex_lock(&journal.lock);
+			journal.writers_active--;
+			(void)pthread_mutex_unlock(&journal.lock);
+		}
+	}
+	t_end = t_start + SYNC_FILE_JOURNAL_SLICE;
+
+	if (batch) {
+		stress_sync_file_coordinator(&journal, t_end);
+	} else {
+		while (stress_continue(args) && (stress_time_now() < t_end))
+			(void)shim_usleep(10000);
+		journal.stop = true;
+	}
+	for (i = 0; i < writers; i++) {
+		if (create_ret[i] == 0)
+			(void)pthread_join(pthreads[i], NULL);
+	}
+	stats->duration += stress_time_now() - t_start;
+	stress_bogo_add(args, (uint64_t)(stats->records - records));
+
+	(void)pthread_cond_destroy(&journal.committed);
+	(void)pthread_cond_destroy(&journal.written);
+	(void)pthread_mutex_destroy(&journal.lock);
+	free(create_ret);
+	free(pthreads);
+
+	if (journal.fsync_errno) {
+		pr_fail("%s: fsync failed, errno=%d (%s)\n",
+			args->name, journal.fsync_errno, strerror(journal.fsync_errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_sync_file_journal()
+ *	W writer threads append small records and fsync, first
+ *	each writer syncing its own records and then with a group
+ *	commit coordinator for batch sizes 1, 2, 4 .. W
+ */
+static int stress_sync_file_journal(
+	stress_args_t *args,
+	const int fd,
+	const char *fs_type)
+{
+	stress_sync_file_stats_t *stats;
+	size_t batches[SYNC_FILE_BATCHES_MAX];
+	size_t i, n_batches = 0, sync_file_writers = DEFAULT_SYNC_FILE_WRITERS;
+	size_t metric = 0;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("sync-file-writers", &sync_file_writers);
+
+	batches[n_batches++] = 0;
+	for (i = 1; i < sync_file_writers; i <<= 1)
+		batches[n_batches++] = i;
+	batches[n_batches++] = sync_file_writers;
+
+	stats = (stress_sync_file_stats_t *)calloc(n_batches, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: cannot allocate statistics, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: journal mode, %zu writers, %d byte records%s\n",
+			args->name, sync_file_writers, SYNC_FILE_RECORD_SIZE, fs_type);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; i < n_batches; i++) {
+			int ret;
+
+			ret = stress_sync_file_journal_run(args, fd, sync_file_writers,
+							batches[i], &stats[i]);
+			if (ret == -1) {
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			if (ret < 0) {
+				pr_inf_skip("%s: cannot run journal writers, errno=%d (%s), "
+					"skipping stressor\n", args->name, -ret, strerror(-ret));
+				rc = EXIT_NO_RESOURCE;
+				goto done;
+			}
+			if (!stress_continue(args))
+				break;
+		}
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (i = 0; i < n_batches; i++) {
+		const stress_sync_file_stats_t *s = &stats[i];
+		char name[32], str[64];
+		double rate;
+
+		if (s->fsyncs <= 0.0)
+			continue;
+		if (batches[i] == 0)
+			(void)shim_strscpy(name, "no-group", sizeof(name));
+		else
+			(void)snprintf(name, sizeof(name), "batch-%zu", batches[i]);
+
+		rate = (s->duration > 0.0) ? s->records / s->duration : 0.0;
+		(void)snprintf(str, sizeof(str), "%s records committed per sec", name);
+		stress_metrics_set(args, metric++, str, rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s records per fsync", name);
+		stress_metrics_set(args, metric++, str, s->records / s->fsyncs, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s nanosecs fsync latency p50", name);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&s->latency, 50.0), STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s nanosecs fsync latency p99", name);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&s->latency, 99.0), STRESS_GEOMETRIC_MEAN);
+		stress_latency_merge(args->latency, &s->latency);
+	}
+	free(stats);
+	return rc;
+}
+#endif
+
 /*
  *  stress_sync_file
  *	stress the sync_file_range system call
@@ -116,6 +481,7 @@ static int stress_sync_file(stress_args_t *args)
 	off_t sync_file_bytes = DEFAULT_SYNC_FILE_BYTES;
 	char filename[PATH_MAX];
 	const char *fs_type;
+	bool sync_file_journal = false;
 
 	if (!stress_get_setting("sync_file-bytes", &sync_file_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -151,6 +517,21 @@ static int stress_sync_file(stress_args_t *args)
 	fs_type = stress_get_fs_type(filename);
 	(void)shim_unlink(filename);
 
+	(void)stress_get_setting("sync-file-journal", &sync_file_journal);
+	if (sync_file_journal) {
+#if defined(HAVE_LIB_PTHREAD)
+		ret = stress_sync_file_journal(args, fd, fs_type);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: journal mode requires pthread support, skipping stressor\n",
+				args->name);
+		ret = EXIT_NO_RESOURCE;
+#endif
+		(void)close(fd);
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
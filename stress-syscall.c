@@ -21,6 +21,9 @@
 #include "core-cpu-cache.h"
 #include "core-builtin.h"
 #include "core-io-priority.h"
+#include "core-compare.h"
+#include "core-latency.h"
+#include "core-lock.h"
 
 #include <sched.h>
 
@@ -249,11 +252,21 @@ typedef struct {
 	double average_duration;	/* average syscall duration */
 	uint64_t min_duration;		/* syscall min duration in ns */
 	uint64_t max_test_duration;	/* maximum test duration */
+	stress_latency_t latency;	/* syscall duration distribution */
 	int syscall_errno;		/* syscall errno */
 	bool ignore;			/* true if too slow */
 	bool succeed;			/* syscall returned OK */
 } syscall_stats_t;
 
+/*
+ *  system call duration distributions merged from all the instances
+ */
+typedef struct {
+	void *lock;			/* merge lock */
+	uint32_t merged;		/* # instances merged */
+	stress_latency_t latency[];	/* per syscall duration distribution */
+} syscall_latencies_t;
+
 #if (defined(HAVE_CLOCK_ADJTIME) &&	\
      defined(HAVE_SYS_TIMEX_H) &&	\
      defined(HAVE_TIMEX)) ||		\
@@ -528,9 +541,11 @@ static uint64_t syscall_time_now(void)
 
 static const stress_help_t help[] = {
 	{ NULL,	"syscall N",		"start N workers that exercise a wide range of system calls" },
+	{ NULL,	"syscall-compare F",	"compare per system call latencies against baseline YAML file F" },
 	{ NULL,	"syscall-method M",	"select method of selecting system calls to exercise" },
 	{ NULL,	"syscall-ops N",	"stop after N syscall bogo operations" },
 	{ NULL,	"syscall-top N",	"display fastest top N system calls" },
+	{ NULL,	"syscall-yaml F",	"write per system call latency distributions to YAML file F" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -579,6 +594,16 @@ static int stress_set_syscall_top(const char *opt)
 	return stress_set_setting("syscall-top", TYPE_ID_SIZE_T, &syscall_top);
 }
 
+static int stress_set_syscall_compare(const char *opt)
+{
+	return stress_set_setting("syscall-compare", TYPE_ID_STR, opt);
+}
+
+static int stress_set_syscall_yaml(const char *opt)
+{
+	return stress_set_setting("syscall-yaml", TYPE_ID_STR, opt);
+}
+
 #if defined(HAVE_SYS_UN_H) &&	\
     defined(AF_UNIX)
 
@@ -8378,6 +8403,8 @@ static const syscall_t syscalls[] = {
 
 static syscall_stats_t syscall_stats[STRESS_SYSCALLS_MAX];	/* stats */
 static size_t stress_syscall_index[STRESS_SYSCALLS_MAX];	/* shuffle index */
+static syscall_latencies_t *syscall_latencies = MAP_FAILED;	/* merged latencies */
+static size_t syscall_latencies_size;
 
 /*
  *  stress_syscall_reset_index()
@@ -8516,17 +8543,22 @@ static void stress_syscall_report_syscall_top10(stress_args_t *args)
 	pr_block_begin();
 	pr_inf("%s: Top %zu fastest system calls (timings in nanosecs):\n",
 		args->name, syscall_top);
-	pr_inf("%s: %25s %10s %10s\n", args->name, "System Call", "Avg (ns)", "Min (ns)");
+	pr_inf("%s: %25s %10s %10s %10s %10s %10s\n", args->name, "System Call",
+		"Avg (ns)", "Min (ns)", "P50 (ns)", "P99 (ns)", "Max (ns)");
 	for (i = 0; i < syscall_top; i++) {
 		const size_t j = sort_index[i];
 		syscall_stats_t *ss = &syscall_stats[j];
 
 		if (ss->succeed) {
-			pr_inf("%s: %25s %10.1f %10" PRIu64 "\n",
+			pr_inf("%s: %25s %10.1f %10" PRIu64 " %10" PRIu64
+				" %10" PRIu64 " %10" PRIu64 "\n",
 				args->name,
 				syscalls[j].name,
 				ss->total_duration / (double)ss->count,
-				ss->min_duration);
+				ss->min_duration,
+				stress_latency_percentile(&ss->latency, 50.0),
+				stress_latency_percentile(&ss->latency, 99.0),
+				ss->latency.max);
 		}
 	}
 	pr_block_end();
@@ -8667,6 +8699,7 @@ static void stress_syscall_benchmark_calls(stress_args_t *args)
 		if ((d > 0) && (ret >= 0) && (t1 != ~0ULL) && (t2 != ~0ULL)) {
 			if (ss->min_duration > d)
 				ss->min_duration = d;
+			stress_latency_add(&ss->latency, d);
 			ss->total_duration += (double)d;
 			ss->succeed = true;
 			ss->count++;
@@ -8675,6 +8708,225 @@ static void stress_syscall_benchmark_calls(stress_args_t *args)
 	}
 }
 
+/*
+ *  stress_syscall_init()
+ *	allocate the per system call duration distributions shared
+ *	by all the instances for --syscall-yaml and --syscall-compare
+ */
+static void stress_syscall_init(void)
+{
+	syscall_latencies_size = sizeof(*syscall_latencies) +
+		(sizeof(stress_latency_t) * STRESS_SYSCALLS_MAX);
+	syscall_latencies = (syscall_latencies_t *)mmap(NULL, syscall_latencies_size,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+	if (syscall_latencies == MAP_FAILED)
+		return;
+	syscall_latencies->lock = stress_lock_create("syscall-latencies");
+	if (!syscall_latencies->lock) {
+		(void)munmap((void *)syscall_latencies, syscall_latencies_size);
+		syscall_latencies = MAP_FAILED;
+	}
+}
+
+/*
+ *  stress_syscall_deinit()
+ *	free the shared per system call duration distributions
+ */
+static void stress_syscall_deinit(void)
+{
+	if (syscall_latencies == MAP_FAILED)
+		return;
+	(void)stress_lock_destroy(syscall_latencies->lock);
+	(void)munmap((void *)syscall_latencies, syscall_latencies_size);
+	syscall_latencies = MAP_FAILED;
+}
+
+/*
+ *  stress_syscall_compare_load()
+ *	load the p50 and p99 durations of each system call from a
+ *	baseline YAML file written by an earlier --syscall-yaml run,
+ *	returns the number of system calls loaded or -1 on error
+ */
+static ssize_t stress_syscall_compare_load(
+	stress_args_t *args,
+	const char *filename,
+	double *base_p50,
+	double *base_p99)
+{
+	FILE *fp;
+	char buf[256];
+	ssize_t j = -1, n = 0;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_inf("%s: cannot open baseline file %s, errno=%d (%s), skipping compare\n",
+			args->name, filename, errno, strerror(errno));
+		return -1;
+	}
+	while (fgets(buf, sizeof(buf), fp)) {
+		buf[strcspn(buf, "\r\n")] = '\0';
+
+		if (!strncmp(buf, "    - syscall: ", 15)) {
+			size_t i;
+
+			j = -1;
+			for (i = 0; i < STRESS_SYSCALLS_MAX; i++) {
+				if (!strcmp(buf + 15, syscalls[i].name)) {
+					j = (ssize_t)i;
+					n++;
+					break;
+				}
+			}
+		} else if ((j >= 0) && !strncmp(buf, "      p50-ns: ", 14)) {
+			base_p50[j] = atof(buf + 14);
+		} else if ((j >= 0) && !strncmp(buf, "      p99-ns: ", 14)) {
+			base_p99[j] = atof(buf + 14);
+		}
+	}
+	(void)fclose(fp);
+
+	return n;
+}
+
+/*
+ *  stress_syscall_latencies_dump()
+ *	write the merged per system call duration distributions to
+ *	the --syscall-yaml file and flag system calls that have regressed
+ *	against the --syscall-compare baseline by more than the
+ *	--compare-threshold percentage
+ */
+static void stress_syscall_latencies_dump(
+	stress_args_t *args,
+	const char *yaml_filename,
+	const char *compare_filename)
+{
+	static double base_p50[STRESS_SYSCALLS_MAX];
+	static double base_p99[STRESS_SYSCALLS_MAX];
+	const double threshold = stress_compare_get_threshold();
+	size_t i, compared = 0, regressed = 0, improved = 0, missing = 0;
+	FILE *yaml = NULL;
+
+	for (i = 0; i < STRESS_SYSCALLS_MAX; i++) {
+		base_p50[i] = -1.0;
+		base_p99[i] = -1.0;
+	}
+	if (compare_filename &&
+	    (stress_syscall_compare_load(args, compare_filename, base_p50, base_p99) < 0))
+		compare_filename = NULL;
+
+	if (yaml_filename) {
+		yaml = fopen(yaml_filename, "w");
+		if (!yaml)
+			pr_inf("%s: cannot create YAML file %s, errno=%d (%s)\n",
+				args->name, yaml_filename, errno, strerror(errno));
+	}
+	pr_yaml(yaml, "---\n");
+	pr_yaml(yaml, "syscall-latencies:\n");
+
+	if (compare_filename) {
+		pr_block_begin();
+		pr_inf("%s: compare against baseline %s, regression threshold %.2f%%\n",
+			args->name, compare_filename, threshold);
+		pr_inf("%s: %25s %12s %12s %8s %12s %12s %s\n", args->name, "System Call",
+			"base P50 ns", "P50 ns", "delta", "base P99 ns", "P99 ns", "verdict");
+	}
+
+	for (i = 0; i < STRESS_SYSCALLS_MAX; i++) {
+		const stress_latency_t *latency = &syscall_latencies->latency[i];
+		const uint64_t p50 = stress_latency_percentile(latency, 50.0);
+		const uint64_t p99 = stress_latency_percentile(latency, 99.0);
+
+		if (latency->count == 0)
+			continue;
+
+		pr_yaml(yaml, "    - syscall: %s\n", syscalls[i].name);
+		pr_yaml(yaml, "      count: %" PRIu64 "\n", latency->count);
+		pr_yaml(yaml, "      min-ns: %" PRIu64 "\n", latency->min);
+		pr_yaml(yaml, "      mean-ns: %f\n", latency->sum / (double)latency->count);
+		pr_yaml(yaml, "      p50-ns: %" PRIu64 "\n", p50);
+		pr_yaml(yaml, "      p90-ns: %" PRIu64 "\n", stress_latency_percentile(latency, 90.0));
+		pr_yaml(yaml, "      p99-ns: %" PRIu64 "\n", p99);
+		pr_yaml(yaml, "      p99.9-ns: %" PRIu64 "\n", stress_latency_percentile(latency, 99.9));
+		pr_yaml(yaml, "      max-ns: %" PRIu64 "\n", latency->max);
+
+		if (compare_filename) {
+			double delta;
+			const char *verdict;
+
+			if (base_p50[i] <= 0.0) {
+				missing++;
+				pr_yaml(yaml, "\n");
+				continue;
+			}
+			compared++;
+
+			/* p50 decides, it is far less sensitive to preemption than p99 */
+			delta = 100.0 * ((double)p50 - base_p50[i]) / base_p50[i];
+			if (delta > threshold) {
+				verdict = "regressed";
+				regressed++;
+			} else if (delta < -threshold) {
+				verdict = "improved";
+				improved++;
+			} else {
+				verdict = "unchanged";
+			}
+			pr_yaml(yaml, "      baseline-p50-ns: %.0f\n", base_p50[i]);
+			pr_yaml(yaml, "      baseline-p99-ns: %.0f\n", base_p99[i]);
+			pr_yaml(yaml, "      delta-percent: %f\n", delta);
+			pr_yaml(yaml, "      verdict: %s\n", verdict);
+
+			/* only report changes, there are several hundred system calls */
+			if (strcmp(verdict, "unchanged"))
+				pr_inf("%s: %25s %12.0f %12" PRIu64 " %7.2f%% %12.0f %12" PRIu64 " %s\n",
+					args->name, syscalls[i].name, base_p50[i], p50,
+					delta, base_p99[i], p99, verdict);
+		}
+		pr_yaml(yaml, "\n");
+	}
+
+	if (compare_filename) {
+		pr_inf("%s: %zu system calls compared, %zu regressed, %zu improved, "
+			"%zu not in baseline\n", args->name, compared, regressed,
+			improved, missing);
+		pr_block_end();
+		if (regressed)
+			pr_warn("%s: %zu system calls regressed by more than %.2f%% "
+				"against baseline %s\n", args->name, regressed,
+				threshold, compare_filename);
+	}
+	if (yaml)
+		(void)fclose(yaml);
+}
+
+/*
+ *  stress_syscall_latencies_merge()
+ *	merge the instance's system call duration distributions into
+ *	the shared distributions, the last instance to finish writes
+ *	the YAML file and compares against the baseline
+ */
+static void stress_syscall_latencies_merge(stress_args_t *args)
+{
+	char *yaml_filename = NULL, *compare_filename = NULL;
+	size_t i;
+	bool last;
+
+	(void)stress_get_setting("syscall-yaml", &yaml_filename);
+	(void)stress_get_setting("syscall-compare", &compare_filename);
+	if ((!yaml_filename && !compare_filename) || (syscall_latencies == MAP_FAILED))
+		return;
+
+	if (stress_lock_acquire(syscall_latencies->lock) < 0)
+		return;
+	for (i = 0; i < STRESS_SYSCALLS_MAX; i++)
+		stress_latency_merge(&syscall_latencies->latency[i], &syscall_stats[i].latency);
+	syscall_latencies->merged++;
+	last = (syscall_latencies->merged >= args->num_instances);
+	if (last)
+		stress_syscall_latencies_dump(args, yaml_filename, compare_filename);
+	(void)stress_lock_release(syscall_latencies->lock);
+}
+
 /*
  *  stress_syscall
  *	stress system calls
@@ -8776,6 +9028,7 @@ static int stress_syscall(stress_args_t *args)
 		ss->max_test_duration = 0ULL;
 		ss->succeed = false;
 		ss->ignore = false;
+		(void)shim_memset(&ss->latency, 0, sizeof(ss->latency));
 	}
 
 	syscall_brk_addr = shim_sbrk(0);
@@ -8817,6 +9070,7 @@ static int stress_syscall(stress_args_t *args)
 			(double)exercised * 100.0 / (double)STRESS_SYSCALLS_MAX);
 		stress_syscall_report_syscall_top10(args);
 	}
+	stress_syscall_latencies_merge(args);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	rc = EXIT_SUCCESS;
@@ -8844,13 +9098,17 @@ err_close_dir_fd:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_syscall_compare,	stress_set_syscall_compare },
 	{ OPT_syscall_method, 	stress_set_syscall_method },
 	{ OPT_syscall_top,	stress_set_syscall_top },
+	{ OPT_syscall_yaml,	stress_set_syscall_yaml },
 	{ 0,			NULL },
 };
 
 stressor_info_t stress_syscall_info = {
 	.stressor = stress_syscall,
+	.init = stress_syscall_init,
+	.deinit = stress_syscall_deinit,
 	.class = CLASS_OS,
 	.opt_set_funcs = opt_set_funcs,
 	.help = help
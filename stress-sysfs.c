@@ -22,6 +22,7 @@
 #include "core-capabilities.h"
 #include "core-hash.h"
 #include "core-killpid.h"
+#include "core-path-latency.h"
 #include "core-pthread.h"
 #include "core-put.h"
 #include "core-try-open.h"
@@ -45,9 +46,31 @@ UNEXPECTED
 #endif
 
 static const stress_help_t help[] = {
-	{ NULL,	"sysfs N",	"start N workers reading files from /sys" },
-	{ NULL,	"sysfs-ops N",	"stop after sysfs bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"sysfs N",		"start N workers reading files from /sys" },
+	{ NULL,	"sysfs-latency N",	"report the N /sys paths with the slowest read times" },
+	{ NULL,	"sysfs-ops N",		"stop after sysfs bogo operations" },
+	{ NULL,	"sysfs-yaml F",		"write per /sys path read times to YAML file F" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_sysfs_latency(const char *opt)
+{
+	uint32_t sysfs_latency;
+
+	sysfs_latency = stress_get_uint32(opt);
+	stress_check_range("sysfs-latency", (uint64_t)sysfs_latency, 1, 1000);
+	return stress_set_setting("sysfs-latency", TYPE_ID_UINT32, &sysfs_latency);
+}
+
+static int stress_set_sysfs_yaml(const char *opt)
+{
+	return stress_set_setting("sysfs-yaml", TYPE_ID_STR, opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_sysfs_latency,	stress_set_sysfs_latency },
+	{ OPT_sysfs_yaml,	stress_set_sysfs_yaml },
+	{ 0,			NULL },
 };
 
 #if defined(HAVE_LIB_PTHREAD) &&	\
@@ -69,6 +92,7 @@ static const char signum_path[] = "/sys/kernel/notes";
 static uint32_t os_release;
 static stress_hash_table_t *sysfs_hash_table;
 static uint64_t hash_items = 0;
+static stress_path_latency_t *sysfs_latency;	/* NULL = not recording */
 
 typedef struct {
 	stress_args_t *args;	/* stressor args */
@@ -179,7 +203,7 @@ static inline bool stress_sys_rw(stress_ctxt_t *ctxt)
 	size_t page_size = ctxt->args->page_size;
 
 	while (stress_continue_flag()) {
-		double t_start;
+		double t_start, t_read;
 		uint8_t *ptr;
 		fd_set rfds;
 		struct timeval tv;
@@ -203,6 +227,7 @@ static inline bool stress_sys_rw(stress_ctxt_t *ctxt)
 			stress_sys_add_bad(path);
 			goto next;
 		}
+		t_read = stress_time_now();
 		if ((fd = open(path, O_RDONLY | O_NONBLOCK)) < 0) {
 			stress_sys_add_bad(path);
 			goto next;
@@ -216,6 +241,7 @@ static inline bool stress_sys_rw(stress_ctxt_t *ctxt)
 		(void)shim_pthread_spin_unlock(&open_lock);
 
 		if (stress_time_now() - t_start > threshold) {
+			stress_path_latency_add(sysfs_latency, path, stress_time_now() - t_read);
 			(void)close(fd);
 			goto next;
 		}
@@ -241,10 +267,12 @@ static inline bool stress_sys_rw(stress_ctxt_t *ctxt)
 				goto drain;
 			}
 			if (stress_time_now() - t_start > threshold) {
+				stress_path_latency_add(sysfs_latency, path, stress_time_now() - t_read);
 				(void)close(fd);
 				goto next;
 			}
 		}
+		stress_path_latency_add(sysfs_latency, path, stress_time_now() - t_read);
 
 		/* file stat should be OK if we've just opened it */
 		if (g_opt_flags & OPT_FLAGS_VERIFY) {
@@ -675,6 +703,32 @@ static bool stress_sysfs_bad_signal(const int status)
 	return false;
 }
 
+/*
+ *  stress_sysfs_init()
+ *	create the per path read time table shared by all
+ *	the instances for --sysfs-latency and --sysfs-yaml
+ */
+static void stress_sysfs_init(void)
+{
+	uint32_t top_n = 0;
+	char *yaml_filename = NULL;
+
+	(void)stress_get_setting("sysfs-latency", &top_n);
+	(void)stress_get_setting("sysfs-yaml", &yaml_filename);
+	if (top_n || yaml_filename)
+		sysfs_latency = stress_path_latency_create("sysfs-latency");
+}
+
+/*
+ *  stress_sysfs_deinit()
+ *	free the per path read time table
+ */
+static void stress_sysfs_deinit(void)
+{
+	stress_path_latency_destroy(sysfs_latency);
+	sysfs_latency = NULL;
+}
+
 /*
  *  stress_sysfs
  *	stress reading all of /sys
@@ -879,6 +933,14 @@ again:
 
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (sysfs_latency) {
+		uint32_t top_n = 0;
+		char *yaml_filename = NULL;
+
+		(void)stress_get_setting("sysfs-latency", &top_n);
+		(void)stress_get_setting("sysfs-yaml", &yaml_filename);
+		stress_path_latency_report(args, sysfs_latency, top_n ? top_n : 10, yaml_filename);
+	}
 
 	(void)shim_pthread_spin_destroy(&hash_lock);
 exit_destroy_open_lock:
@@ -905,7 +967,10 @@ exit_no_sysfs_entries:
 
 stressor_info_t stress_sysfs_info = {
 	.stressor = stress_sysfs,
+	.init = stress_sysfs_init,
+	.deinit = stress_sysfs_deinit,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -913,6 +978,7 @@ stressor_info_t stress_sysfs_info = {
 stressor_info_t stress_sysfs_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "not Linux or built without pthread support"
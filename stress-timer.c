@@ -19,6 +19,16 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-energy.h"
+#include "core-latency.h"
+
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+
+#if defined(HAVE_SYS_TIMERFD_H)
+#include <sys/timerfd.h>
+#endif
 
 #define MIN_TIMER_FREQ		(1)
 #define MAX_TIMER_FREQ		(100000000)
@@ -29,6 +39,7 @@ static const stress_help_t help[] = {
 	{ NULL, "timer-freq F",	"run timer(s) at F Hz, range 1 to 1000000000" },
 	{ NULL, "timer-ops N",	"stop after N timer bogo events" },
 	{ NULL, "timer-rand",	"enable random timer frequency" },
+	{ NULL, "timer-sweep",	"sweep timer slack over timer wake-up mechanisms" },
 	{ NULL, NULL,		NULL }
 };
 
@@ -66,9 +77,15 @@ static int stress_set_timer_rand(const char *opt)
 	return stress_set_setting_true("timer-rand", opt);
 }
 
+static int stress_set_timer_sweep(const char *opt)
+{
+	return stress_set_setting_true("timer-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_timer_freq,	stress_set_timer_freq },
 	{ OPT_timer_rand,	stress_set_timer_rand },
+	{ OPT_timer_sweep,	stress_set_timer_sweep },
 	{ 0,			NULL }
 };
 
@@ -170,6 +187,343 @@ cancel:
 		timer_settime_failure++;
 }
 
+#if defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(HAVE_PRCTL) &&		\
+    defined(PR_SET_TIMERSLACK) &&	\
+    defined(PR_GET_TIMERSLACK) &&	\
+    defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(HAVE_SIGWAITINFO) &&	\
+    defined(CLOCK_MONOTONIC)
+#define STRESS_TIMER_SWEEP
+
+#define STRESS_TIMER_SWEEP_FREQ		(1000)	/* default sweep timer frequency, Hz */
+
+#define STRESS_TIMER_SWEEP_POSIX	(0)
+#define STRESS_TIMER_SWEEP_TIMERFD	(1)
+#define STRESS_TIMER_SWEEP_NANOSLEEP	(2)
+#define STRESS_TIMER_SWEEP_MECH_MAX	(3)
+
+/* timer slack values swept, 50000 ns is the kernel default */
+static const uint64_t timer_sweep_slack_ns[] = {
+	1, 50000, 500000, 5000000
+};
+
+static const char * const timer_sweep_mechs[STRESS_TIMER_SWEEP_MECH_MAX] = {
+	"posix-timer",
+	"timerfd",
+	"clock_nanosleep",
+};
+
+/* per mechanism and slack sweep point results */
+typedef struct {
+	uint64_t wakeups;		/* wake-ups */
+	double duration;		/* time spent at this point, seconds */
+	uint64_t energy_uj;		/* RAPL package energy, microjoules */
+	stress_latency_t lateness;	/* wake-up lateness, nanoseconds */
+} stress_timer_sweep_t;
+
+/*
+ *  stress_timer_sweep_ns()
+ *	CLOCK_MONOTONIC time in nanoseconds
+ */
+static inline uint64_t stress_timer_sweep_ns(void)
+{
+	struct timespec ts;
+
+	(void)clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ *  stress_timer_sweep_timespec()
+ *	nanoseconds to timespec
+ */
+static inline void stress_timer_sweep_timespec(struct timespec *ts, const uint64_t ns)
+{
+	ts->tv_sec = (time_t)(ns / STRESS_NANOSECOND);
+	ts->tv_nsec = (long)(ns % STRESS_NANOSECOND);
+}
+
+/*
+ *  stress_timer_sweep_point()
+ *	run a periodic timer of period_ns nanoseconds using mechanism
+ *	mech for duration seconds, the lateness of each wake-up is the
+ *	time since the timer expiry it woke for, returns -1 on failure
+ */
+static int stress_timer_sweep_point(
+	stress_args_t *args,
+	const int mech,
+	const uint64_t period_ns,
+	const double duration,
+	stress_timer_sweep_t *point)
+{
+	const uint64_t t_start = stress_timer_sweep_ns();
+	const uint64_t t_end = t_start + (uint64_t)(duration * STRESS_DBL_NANOSECOND);
+	struct itimerspec its;
+	uint64_t expiries = 0, t_now = t_start, energy_start, energy_end;
+	timer_t sweep_timerid = (timer_t)0;
+	sigset_t mask;
+	int fd = -1, rc = 0;
+
+	stress_timer_sweep_timespec(&its.it_value, period_ns);
+	stress_timer_sweep_timespec(&its.it_interval, period_ns);
+	(void)sigemptyset(&mask);
+	(void)sigaddset(&mask, SIGRTMIN);
+
+	switch (mech) {
+	case STRESS_TIMER_SWEEP_POSIX: {
+		struct sigevent sev;
+
+		(void)shim_memset(&sev, 0, sizeof(sev));
+		sev.sigev_notify = SIGEV_SIGNAL;
+		sev.sigev_signo = SIGRTMIN;
+		if (timer_create(CLOCK_MONOTONIC, &sev, &sweep_timerid) < 0)
+			return -1;
+		if (timer_settime(sweep_timerid, 0, &its, NULL) < 0) {
+			(void)timer_delete(sweep_timerid);
+			return -1;
+		}
+		break;
+	}
+#if defined(HAVE_SYS_TIMERFD_H) &&	\
+    defined(HAVE_TIMERFD_CREATE) &&	\
+    defined(HAVE_TIMERFD_SETTIME)
+	case STRESS_TIMER_SWEEP_TIMERFD:
+		fd = timerfd_create(CLOCK_MONOTONIC, 0);
+		if (fd < 0)
+			return -1;
+		if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+			(void)close(fd);
+			return -1;
+		}
+		break;
+#endif
+#if defined(HAVE_CLOCK_NANOSLEEP)
+	case STRESS_TIMER_SWEEP_NANOSLEEP:
+		break;
+#endif
+	default:
+		return -1;
+	}
+
+	if (!stress_energy_package_uj(&energy_start))
+		energy_start = 0;
+
+	while ((t_now < t_end) && stress_continue(args)) {
+		uint64_t n = 1;
+
+		switch (mech) {
+		case STRESS_TIMER_SWEEP_POSIX: {
+			int ret;
+
+			if (sigwaitinfo(&mask, NULL) < 0) {
+				if (errno == EINTR)
+					continue;
+				rc = -1;
+				goto stop;
+			}
+			ret = timer_getoverrun(sweep_timerid);
+			if (ret > 0)
+				n += (uint64_t)ret;
+			break;
+		}
+#if defined(HAVE_SYS_TIMERFD_H) &&	\
+    defined(HAVE_TIMERFD_CREATE) &&	\
+    defined(HAVE_TIMERFD_SETTIME)
+		case STRESS_TIMER_SWEEP_TIMERFD:
+			if (read(fd, &n, sizeof(n)) != (ssize_t)sizeof(n)) {
+				if (errno == EINTR)
+					continue;
+				rc = -1;
+				goto stop;
+			}
+			break;
+#endif
+#if defined(HAVE_CLOCK_NANOSLEEP)
+		case STRESS_TIMER_SWEEP_NANOSLEEP: {
+			struct timespec req;
+			int ret;
+
+			/* skip missed expiries as a periodic timer would */
+			if (t_now >= t_start + ((expiries + 1) * period_ns))
+				expiries = (t_now - t_start) / period_ns;
+			stress_timer_sweep_timespec(&req, t_start + ((expiries + 1) * period_ns));
+			ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &req, NULL);
+			if (ret == EINTR)
+				continue;
+			if (ret != 0) {
+				rc = -1;
+				goto stop;
+			}
+			break;
+		}
+#endif
+		default:
+			break;
+		}
+		t_now = stress_timer_sweep_ns();
+		expiries += n;
+		{
+			const uint64_t t_expiry = t_start + (expiries * period_ns);
+
+			stress_latency_add(&point->lateness, (t_now > t_expiry) ? t_now - t_expiry : 0);
+		}
+		point->wakeups++;
+		stress_bogo_inc(args);
+	}
+stop:
+	if (stress_energy_package_uj(&energy_end) && (energy_end > energy_start))
+		point->energy_uj += energy_end - energy_start;
+	point->duration += (double)(stress_timer_sweep_ns() - t_start) / STRESS_DBL_NANOSECOND;
+
+	switch (mech) {
+	case STRESS_TIMER_SWEEP_POSIX: {
+		sigset_t pending;
+
+		(void)timer_delete(sweep_timerid);
+		/* discard any queued expiry signal */
+		while ((sigpending(&pending) == 0) && sigismember(&pending, SIGRTMIN))
+			(void)sigwaitinfo(&mask, NULL);
+		break;
+	}
+	case STRESS_TIMER_SWEEP_TIMERFD:
+		(void)close(fd);
+		break;
+	default:
+		break;
+	}
+	return rc;
+}
+
+/*
+ *  stress_timer_sweep()
+ *	sweep timer slack over the POSIX timer, timerfd and
+ *	clock_nanosleep wake-up mechanisms, reporting the wake-up
+ *	rate, lateness percentiles and with --energy the RAPL
+ *	package power for each point
+ */
+static int stress_timer_sweep(stress_args_t *args, const uint64_t timer_freq)
+{
+	const size_t n_slack = SIZEOF_ARRAY(timer_sweep_slack_ns);
+	const size_t n_points = n_slack * STRESS_TIMER_SWEEP_MECH_MAX;
+	const uint64_t period_ns = STRESS_NANOSECOND / timer_freq;
+	stress_timer_sweep_t *points;
+	sigset_t mask;
+	size_t i, j;
+	int slack, metric = 0, rc = EXIT_SUCCESS;
+	bool energy;
+	uint64_t uj;
+
+	points = (stress_timer_sweep_t *)calloc(n_points, sizeof(*points));
+	if (!points) {
+		pr_inf_skip("%s: cannot allocate %zu sweep points, skipping stressor\n",
+			args->name, n_points);
+		return EXIT_NO_RESOURCE;
+	}
+	energy = stress_energy_package_uj(&uj);
+	if ((args->instance == 0) && !energy)
+		pr_inf("%s: no RAPL package energy counters, use --energy "
+			"to report package power\n", args->name);
+
+	/* POSIX timer expiries are collected with sigwaitinfo */
+	(void)sigemptyset(&mask);
+	(void)sigaddset(&mask, SIGRTMIN);
+	(void)sigprocmask(SIG_BLOCK, &mask, NULL);
+
+	slack = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		const double t_left = args->time_end - stress_time_now();
+		double slice = t_left / (double)n_points;
+
+		slice = STRESS_MINIMUM(slice, 1.0);
+		slice = STRESS_MAXIMUM(slice, 0.05);
+
+		for (i = 0; i < n_slack; i++) {
+			if (prctl(PR_SET_TIMERSLACK, timer_sweep_slack_ns[i], 0, 0, 0) < 0) {
+				pr_inf_skip("%s: prctl PR_SET_TIMERSLACK failed, errno=%d (%s), "
+					"skipping stressor\n", args->name, errno, strerror(errno));
+				rc = EXIT_NO_RESOURCE;
+				goto tidy;
+			}
+			for (j = 0; j < STRESS_TIMER_SWEEP_MECH_MAX; j++) {
+				if (stress_timer_sweep_point(args, (int)j, period_ns, slice,
+							     &points[(j * n_slack) + i]) < 0) {
+					pr_fail("%s: %s wake-up failed, errno=%d (%s)\n",
+						args->name, timer_sweep_mechs[j], errno, strerror(errno));
+					rc = EXIT_FAILURE;
+					goto tidy;
+				}
+				if (!stress_continue(args))
+					goto report;
+			}
+		}
+	} while (stress_continue(args));
+
+report:
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %.0f Hz timers, lateness in microseconds%s\n", args->name,
+			(double)timer_freq, energy ? ", package power in watts" : "");
+		pr_inf("%s: %-15s %10s %10s %8s %8s %8s %8s%s\n", args->name,
+			"mechanism", "slack ns", "wakeups/s", "P50", "P90", "P99", "max",
+			energy ? "    watts" : "");
+	}
+	for (j = 0; j < STRESS_TIMER_SWEEP_MECH_MAX; j++) {
+		for (i = 0; i < n_slack; i++) {
+			const stress_timer_sweep_t *point = &points[(j * n_slack) + i];
+			const double rate = (point->duration > 0.0) ?
+				(double)point->wakeups / point->duration : 0.0;
+			const double watts = (point->duration > 0.0) ?
+				((double)point->energy_uj / 1000000.0) / point->duration : 0.0;
+			const double p50 = (double)stress_latency_percentile(&point->lateness, 50.0) / 1000.0;
+			const double p99 = (double)stress_latency_percentile(&point->lateness, 99.0) / 1000.0;
+			char str[64];
+
+			if (point->wakeups == 0)
+				continue;
+			if (args->instance == 0) {
+				char wstr[16];
+
+				if (energy)
+					(void)snprintf(wstr, sizeof(wstr), " %8.3f", watts);
+				else
+					*wstr = '\0';
+				pr_inf("%s: %-15s %10" PRIu64 " %10.1f %8.1f %8.1f %8.1f %8.1f%s\n",
+					args->name, timer_sweep_mechs[j], timer_sweep_slack_ns[i], rate, p50,
+					(double)stress_latency_percentile(&point->lateness, 90.0) / 1000.0,
+					p99, (double)point->lateness.max / 1000.0, wstr);
+			}
+			(void)snprintf(str, sizeof(str), "%s slack %" PRIu64 "ns wakeups/sec",
+				timer_sweep_mechs[j], timer_sweep_slack_ns[i]);
+			stress_metrics_set(args, metric++, str, rate, STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s slack %" PRIu64 "ns P50 late usecs",
+				timer_sweep_mechs[j], timer_sweep_slack_ns[i]);
+			stress_metrics_set(args, metric++, str, p50, STRESS_GEOMETRIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s slack %" PRIu64 "ns P99 late usecs",
+				timer_sweep_mechs[j], timer_sweep_slack_ns[i]);
+			stress_metrics_set(args, metric++, str, p99, STRESS_GEOMETRIC_MEAN);
+			if (energy) {
+				(void)snprintf(str, sizeof(str), "%s slack %" PRIu64 "ns package watts",
+					timer_sweep_mechs[j], timer_sweep_slack_ns[i]);
+				stress_metrics_set(args, metric++, str, watts, STRESS_GEOMETRIC_MEAN);
+			}
+		}
+	}
+	if (args->instance == 0)
+		pr_block_end();
+tidy:
+	if (slack >= 0)
+		(void)prctl(PR_SET_TIMERSLACK, (unsigned long)slack, 0, 0, 0);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(points);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_timer
  *	stress timers
@@ -181,6 +535,7 @@ static int stress_timer(stress_args_t *args)
 	sigset_t mask;
 	uint64_t timer_freq = DEFAULT_TIMER_FREQ;
 	int n = 0, rc = EXIT_SUCCESS;
+	bool timer_sweep = false;
 
 	time_end = args->time_end;
 	timer_counter = 0;
@@ -204,6 +559,21 @@ static int stress_timer(stress_args_t *args)
 	rate_ns = timer_freq ? (double)STRESS_NANOSECOND / (double)timer_freq :
 			       (double)STRESS_NANOSECOND;
 
+	(void)stress_get_setting("timer-sweep", &timer_sweep);
+	if (timer_sweep) {
+#if defined(STRESS_TIMER_SWEEP)
+		uint64_t sweep_freq = STRESS_TIMER_SWEEP_FREQ;
+
+		(void)stress_get_setting("timer-freq", &sweep_freq);
+		return stress_timer_sweep(args, sweep_freq);
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: --timer-sweep needs prctl PR_SET_TIMERSLACK, "
+				"clock_gettime and sigwaitinfo, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
+
 	if (stress_sighandler(args->name, SIGRTMIN, stress_timer_handler, NULL) < 0)
 		return EXIT_FAILURE;
 
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-capabilities.h"
+#include "core-event-reap.h"
 
 #if defined(HAVE_SYS_TIMERFD_H)
 #include <sys/timerfd.h>
@@ -48,6 +49,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"timerfd-freq F", "run timer(s) at F Hz, range 1 to 1000000000" },
 	{ NULL,	"timerfd-ops N",  "stop after N timerfd bogo events" },
 	{ NULL,	"timerfd-rand",	  "enable random timerfd frequency" },
+	{ NULL,	"timerfd-reap M", "reap timerfd wake-ups using poll, epoll or io-uring" },
 	{ NULL,	NULL,		  NULL }
 };
 
@@ -95,10 +97,43 @@ static int stress_set_timerfd_rand(const char *opt)
 	return stress_set_setting_true("timerfd-rand", opt);
 }
 
+#define TIMERFD_REAP_POLL	(-1)	/* default, poll or select */
+
+typedef struct {
+	const char *name;	/* reap method name */
+	const int method;	/* stress_event_reap_method_t or poll */
+} stress_timerfd_reap_t;
+
+static const stress_timerfd_reap_t timerfd_reaps[] = {
+	{ "poll",	TIMERFD_REAP_POLL },
+	{ "epoll",	STRESS_EVENT_REAP_EPOLL },
+	{ "io-uring",	STRESS_EVENT_REAP_IO_URING },
+};
+
+/*
+ *  stress_set_timerfd_reap()
+ *	set the timerfd wake-up reaping method
+ */
+static int stress_set_timerfd_reap(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(timerfd_reaps); i++) {
+		if (!strcmp(timerfd_reaps[i].name, opt))
+			return stress_set_setting("timerfd-reap", TYPE_ID_INT, &timerfd_reaps[i].method);
+	}
+	(void)fprintf(stderr, "timerfd-reap must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(timerfd_reaps); i++)
+		(void)fprintf(stderr, " %s", timerfd_reaps[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_timerfd_fds,	stress_set_timerfd_fds },
 	{ OPT_timerfd_freq,	stress_set_timerfd_freq },
 	{ OPT_timerfd_rand,	stress_set_timerfd_rand },
+	{ OPT_timerfd_reap,	stress_set_timerfd_reap },
 	{ 0,			NULL }
 };
 
@@ -139,6 +174,112 @@ static void stress_timerfd_set(
 	timer->it_interval.tv_nsec = timer->it_value.tv_nsec;
 }
 
+/*
+ *  stress_timerfd_reap()
+ *	reap timerfd wake-ups in batches using epoll or io_uring
+ *	multishot polls, report wake-ups per second and the number
+ *	of wait and read syscalls needed per wake-up
+ */
+static int stress_timerfd_reap(
+	stress_args_t *args,
+	const int *timerfds,
+	const int timerfd_fds,
+	const int method,
+	struct itimerspec *timer,
+	const bool timerfd_rand)
+{
+	stress_event_reap_t *reap;
+	int *ready, i, n_fds = 0;
+	uint64_t wakeups = 0, expirations = 0, reaps = 0, reads = 0;
+	double t_start, duration;
+	int rc = EXIT_SUCCESS;
+
+	reap = stress_event_reap_create((stress_event_reap_method_t)method, (size_t)timerfd_fds);
+	if (!reap) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cannot create %s reaper, errno=%d (%s), "
+				"skipping stressor\n", args->name,
+				timerfd_reaps[method + 1].name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	ready = (int *)calloc((size_t)timerfd_fds, sizeof(*ready));
+	if (!ready) {
+		pr_inf_skip("%s: cannot allocate %d ready file descriptors, "
+			"skipping stressor\n", args->name, timerfd_fds);
+		stress_event_reap_destroy(reap);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < timerfd_fds; i++) {
+		if (timerfds[i] < 0)
+			continue;
+		/* multishot polls can report an fd that has already been read */
+		(void)fcntl(timerfds[i], F_SETFL, O_NONBLOCK);
+		if (stress_event_reap_add(reap, timerfds[i]) < 0) {
+			pr_fail("%s: cannot add timerfd to %s reaper, errno=%d (%s)\n",
+				args->name, timerfd_reaps[method + 1].name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto free_ready;
+		}
+		n_fds++;
+	}
+
+	t_start = stress_time_now();
+	do {
+		const int n = stress_event_reap_wait(reap, ready, n_fds, 500);
+
+		if (UNLIKELY(n < 0)) {
+			pr_fail("%s: %s reap failed, errno=%d (%s)\n",
+				args->name, timerfd_reaps[method + 1].name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		reaps++;
+		for (i = 0; i < n; i++) {
+			uint64_t expval;
+			ssize_t rret;
+
+			reads++;
+			rret = read(ready[i], &expval, sizeof(expval));
+			if (UNLIKELY(rret < 0)) {
+				if (errno == EAGAIN)
+					continue;
+				pr_fail("%s: read of timerfd failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+				goto done;
+			}
+			if (timerfd_rand) {
+				stress_timerfd_set(timer, timerfd_rand);
+				(void)timerfd_settime(ready[i], 0, timer, NULL);
+			}
+			wakeups++;
+			expirations += expval;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+done:
+	duration = stress_time_now() - t_start;
+
+	if (wakeups > 0) {
+		const uint64_t syscalls = stress_event_reap_syscalls(reap) + reads;
+
+		stress_metrics_set(args, 0, "wake-ups per second",
+			duration > 0.0 ? (double)wakeups / duration : 0.0, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "syscalls per wake-up",
+			(double)syscalls / (double)wakeups, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "wake-ups per reap",
+			reaps ? (double)wakeups / (double)reaps : 0.0, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "timer expirations per wake-up",
+			(double)expirations / (double)wakeups, STRESS_GEOMETRIC_MEAN);
+	}
+
+free_ready:
+	free(ready);
+	stress_event_reap_destroy(reap);
+
+	return rc;
+}
+
 /*
  *  stress_timerfd
  *	stress timerfd
@@ -148,6 +289,7 @@ static int stress_timerfd(stress_args_t *args)
 	struct itimerspec timer;
 	uint64_t timerfd_freq = DEFAULT_TIMERFD_FREQ;
 	int timerfd_fds = TIMER_FDS_DEFAULT;
+	int timerfd_reap = TIMERFD_REAP_POLL;
 	int count = 0, i, max_timerfd = -1;
 	bool timerfd_rand = false;
 	int file_fd;
@@ -165,6 +307,7 @@ static int stress_timerfd(stress_args_t *args)
 
 	(void)stress_get_setting("timerfd-rand", &timerfd_rand);
 	(void)stress_get_setting("timerfd-fds", &timerfd_fds);
+	(void)stress_get_setting("timerfd-reap", &timerfd_reap);
 
 	if (!stress_get_setting("timerfd-freq", &timerfd_freq)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -274,6 +417,12 @@ static int stress_timerfd(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (timerfd_reap != TIMERFD_REAP_POLL) {
+		rc = stress_timerfd_reap(args, timerfds, timerfd_fds,
+			timerfd_reap, &timer, timerfd_rand);
+		goto deinit;
+	}
+
 	do {
 		uint64_t expval;
 		struct itimerspec value;
@@ -401,6 +550,7 @@ static int stress_timerfd(stress_args_t *args)
 		}
 	} while (stress_continue(args));
 
+deinit:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 close_file_fd:
@@ -18,20 +18,34 @@
  *
  */
 #include "stress-ng.h"
+#include "core-asm-generic.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-interrupts.h"
 #include "core-killpid.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
 static const stress_help_t help[] = {
 	{ NULL,	"tlb-shootdown N",	"start N workers that force TLB shootdowns" },
 	{ NULL,	"tlb-shootdown-ops N",	"stop after N TLB shootdown bogo ops" },
+	{ NULL,	"tlb-shootdown-sweep",	"measure shootdown cost against number of CPUs holding the mm" },
 	{ NULL,	NULL,			NULL }
 };
 
+static int stress_set_tlb_shootdown_sweep(const char *opt)
+{
+	return stress_set_setting_true("tlb-shootdown-sweep", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_tlb_shootdown_sweep,	stress_set_tlb_shootdown_sweep },
+	{ 0,				NULL }
+};
+
 #if defined(HAVE_SCHED_GETAFFINITY) && 	\
     defined(HAVE_MPROTECT)
 
@@ -141,6 +155,228 @@ static void *stress_tlb_shootdown_mmap(
 	return mem;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+
+#define TLB_SWEEP_MAX		(16)	/* 1, 2, 4 .. 32768 CPUs */
+
+/*
+ *  --tlb-shootdown-sweep, threads pinned to other CPUs spin in
+ *  the mm so these CPUs are in the mm's CPU mask and receive
+ *  TLB flush IPIs when the main thread changes the mappings
+ */
+typedef struct {
+	pthread_t	pthread;	/* thread handle */
+	int		ret;		/* pthread_create return */
+	int32_t		cpu;		/* CPU to spin on */
+	volatile bool	*stop;		/* set at end of round */
+} stress_tlb_thread_t;
+
+typedef struct {
+	int32_t		cpus;		/* CPUs holding the mm */
+	double		mprotect_ns;	/* total mprotect time */
+	double		munmap_ns;	/* total munmap time */
+	uint64_t	ops;		/* mprotect/munmap cycles */
+	uint64_t	ipis;		/* TLB IPIs received */
+	int32_t		ipi_cpus;	/* most CPUs receiving IPIs in a round */
+} stress_tlb_sweep_t;
+
+/*
+ *  stress_tlb_thread()
+ *	spin on a CPU in the mm until told to stop
+ */
+static void *stress_tlb_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_tlb_thread_t *thread = (stress_tlb_thread_t *)arg;
+	cpu_set_t mask;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	CPU_ZERO(&mask);
+	CPU_SET(thread->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	while (!*thread->stop)
+		stress_asm_nop();
+
+	return &nowt;
+}
+
+/*
+ *  stress_tlb_shootdown_round()
+ *	spin threads on sweep->cpus - 1 other CPUs and time mprotect
+ *	and munmap calls on a populated mapping for slice seconds
+ */
+static int stress_tlb_shootdown_round(
+	stress_args_t *args,
+	const int32_t *cpus,
+	stress_tlb_thread_t *thread,
+	stress_tlb_sweep_t *sweep,
+	uint64_t *ipi_start,
+	uint64_t *ipi_end,
+	const int32_t max_cpus,
+	const double slice)
+{
+	const size_t page_size = args->page_size;
+	const size_t mmap_size = page_size * MMAP_PAGES;
+	volatile bool stop = false;
+	int32_t i, started, ipi_cpus = 0;
+	int rc = EXIT_SUCCESS, ipi_ok;
+	double t_end;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpus[0], &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	for (started = 0; started < sweep->cpus - 1; started++) {
+		thread[started].cpu = cpus[started + 1];
+		thread[started].stop = &stop;
+		thread[started].ret = pthread_create(&thread[started].pthread, NULL,
+			stress_tlb_thread, (void *)&thread[started]);
+		if (thread[started].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, thread[started].ret, strerror(thread[started].ret));
+			rc = EXIT_NO_RESOURCE;
+			goto stop;
+		}
+	}
+	/* let the threads migrate to and spin on their CPUs */
+	(void)shim_usleep(10000);
+
+	ipi_ok = stress_interrupts_per_cpu("TLB:", ipi_start, max_cpus);
+	t_end = stress_time_now() + slice;
+	do {
+		uint8_t *mem;
+		double t0, t1, t2, t3;
+
+		mem = (uint8_t *)mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			(void)shim_usleep(10000);
+			continue;
+		}
+		stress_tlb_shootdown_write_mem(mem, mmap_size, page_size);
+
+		t0 = stress_time_now();
+		(void)mprotect(mem, mmap_size, PROT_READ);
+		t1 = stress_time_now();
+		stress_tlb_shootdown_read_mem(mem, mmap_size, page_size);
+		t2 = stress_time_now();
+		(void)munmap(mem, mmap_size);
+		t3 = stress_time_now();
+
+		sweep->mprotect_ns += (t1 - t0) * STRESS_DBL_NANOSECOND;
+		sweep->munmap_ns += (t3 - t2) * STRESS_DBL_NANOSECOND;
+		sweep->ops++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args) && (stress_time_now() < t_end));
+
+	if ((ipi_ok > 0) && (stress_interrupts_per_cpu("TLB:", ipi_end, max_cpus) > 0)) {
+		for (i = 0; i < max_cpus; i++) {
+			if (ipi_end[i] > ipi_start[i]) {
+				sweep->ipis += ipi_end[i] - ipi_start[i];
+				ipi_cpus++;
+			}
+		}
+		sweep->ipi_cpus = STRESS_MAXIMUM(sweep->ipi_cpus, ipi_cpus);
+	}
+stop:
+	stop = true;
+	for (i = 0; i < started; i++)
+		(void)pthread_join(thread[i].pthread, NULL);
+
+	return rc;
+}
+
+/*
+ *  stress_tlb_shootdown_sweep()
+ *	measure mprotect and munmap shootdown cost and TLB IPIs
+ *	with 1, 2, 4 .. all available CPUs holding the mm
+ */
+static int stress_tlb_shootdown_sweep(stress_args_t *args, cpu_set_t *proc_mask)
+{
+	const int32_t max_cpus = stress_get_processors_configured();
+	stress_tlb_sweep_t sweep[TLB_SWEEP_MAX];
+	stress_tlb_thread_t *thread = NULL;
+	uint64_t *ipi_start = NULL, *ipi_end = NULL;
+	int32_t *cpus = NULL, n_cpus = 0, c, i;
+	size_t n = 0, metric = 0;
+	double slice;
+	int rc = EXIT_NO_RESOURCE;
+
+	if (max_cpus < 1)
+		return EXIT_NO_RESOURCE;
+	cpus = (int32_t *)calloc((size_t)max_cpus, sizeof(*cpus));
+	thread = (stress_tlb_thread_t *)calloc((size_t)max_cpus, sizeof(*thread));
+	ipi_start = (uint64_t *)calloc((size_t)max_cpus, sizeof(*ipi_start));
+	ipi_end = (uint64_t *)calloc((size_t)max_cpus, sizeof(*ipi_end));
+	if (!cpus || !thread || !ipi_start || !ipi_end) {
+		pr_inf_skip("%s: cannot allocate per CPU arrays, skipping stressor\n", args->name);
+		goto err;
+	}
+	for (i = 0; i < max_cpus; i++) {
+		if (CPU_ISSET(i, proc_mask))
+			cpus[n_cpus++] = i;
+	}
+	if (n_cpus < 1) {
+		pr_inf_skip("%s: no CPUs available, skipping stressor\n", args->name);
+		goto err;
+	}
+
+	(void)shim_memset(sweep, 0, sizeof(sweep));
+	for (c = 1; (c < n_cpus) && (n < TLB_SWEEP_MAX - 1); c <<= 1)
+		sweep[n++].cpus = c;
+	sweep[n++].cpus = n_cpus;
+
+	slice = (double)g_opt_timeout / (double)n;
+	slice = STRESS_MINIMUM(2.0, STRESS_MAXIMUM(0.1, slice));
+
+	rc = EXIT_SUCCESS;
+	do {
+		for (i = 0; (i < (int32_t)n) && stress_continue(args); i++) {
+			rc = stress_tlb_shootdown_round(args, cpus, thread, &sweep[i],
+				ipi_start, ipi_end, max_cpus, slice);
+			if (rc != EXIT_SUCCESS)
+				goto err;
+		}
+	} while (stress_continue(args));
+
+	for (i = 0; i < (int32_t)n; i++) {
+		const double ops = (double)sweep[i].ops;
+		const double mprotect_ns = (ops > 0.0) ? sweep[i].mprotect_ns / ops : 0.0;
+		const double munmap_ns = (ops > 0.0) ? sweep[i].munmap_ns / ops : 0.0;
+		const double ipis = (ops > 0.0) ? (double)sweep[i].ipis / (2.0 * ops) : 0.0;
+		char msg[64];
+
+		if (sweep[i].ops == 0)
+			continue;
+		if (args->instance == 0) {
+			if (i == 0)
+				pr_inf("%s: %6s %14s %14s %14s %10s\n", args->name,
+					"CPUs", "mprotect ns", "munmap ns", "TLB IPIs/call", "IPI CPUs");
+			pr_inf("%s: %6" PRId32 " %14.1f %14.1f %14.2f %10" PRId32 "\n", args->name,
+				sweep[i].cpus, mprotect_ns, munmap_ns, ipis, sweep[i].ipi_cpus);
+		}
+		(void)snprintf(msg, sizeof(msg), "mprotect ns, %" PRId32 " CPUs", sweep[i].cpus);
+		stress_metrics_set(args, metric++, msg, mprotect_ns, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "munmap ns, %" PRId32 " CPUs", sweep[i].cpus);
+		stress_metrics_set(args, metric++, msg, munmap_ns, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "TLB IPIs per call, %" PRId32 " CPUs", sweep[i].cpus);
+		stress_metrics_set(args, metric++, msg, ipis, STRESS_GEOMETRIC_MEAN);
+	}
+err:
+	free(ipi_end);
+	free(ipi_start);
+	free(thread);
+	free(cpus);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_tlb_shootdown()
  *	stress out TLB shootdowns
@@ -158,6 +394,7 @@ static int stress_tlb_shootdown(stress_args_t *args)
 	cpu_set_t proc_mask;
 	int32_t tlb_procs, i;
 	uint8_t *mem;
+	bool tlb_shootdown_sweep = false;
 #if defined(HAVE_MADVISE) &&	\
     defined(MADV_DONTNEED)
 	int fd, ret;
@@ -166,6 +403,25 @@ static int stress_tlb_shootdown(stress_args_t *args)
 	char filename[PATH_MAX];
 #endif
 
+	(void)stress_get_setting("tlb-shootdown-sweep", &tlb_shootdown_sweep);
+	if (tlb_shootdown_sweep) {
+#if defined(HAVE_LIB_PTHREAD)
+		if (sched_getaffinity(0, sizeof(proc_mask), &proc_mask) < 0) {
+			pr_fail("%s: sched_getaffinity could not get CPU affinity, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		rc = stress_tlb_shootdown_sweep(args, &proc_mask);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --tlb-shootdown-sweep needs pthread support, ignoring option\n",
+				args->name);
+#endif
+	}
+
 #if defined(HAVE_MADVISE) &&	\
     defined(MADV_DONTNEED)
 	ret = stress_temp_dir_mk_args(args);
@@ -356,12 +612,14 @@ err_rmdir:
 stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_tlb_shootdown,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without sched_getaffinity() or mprotect() system calls"
 };
@@ -306,7 +306,7 @@ static int stress_touch(stress_args_t *args)
 	pid_t pids[TOUCH_PROCS];
 	size_t i;
 
-	touch_lock = stress_lock_create();
+	touch_lock = stress_lock_create("touch");
 	if (!touch_lock) {
 		pr_inf_skip("%s: cannot create lock, skipping stressor\n", args->name);
 		return EXIT_NO_RESOURCE;
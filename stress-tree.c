@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
 #include "core-pragma.h"
 #include "core-target-clones.h"
 
@@ -67,6 +68,8 @@
 #define MAX_TREE_SIZE		(25000000)	/* Must be uint32_t sized or less */
 #define DEFAULT_TREE_SIZE	(250000)
 
+#define MAX_TREE_SWEEP		(7)	/* L1..L3 fit and spill + DRAM */
+
 struct tree_node;
 
 typedef struct {
@@ -76,6 +79,11 @@ typedef struct {
 	double count;		/* total nodes exercised */
 } stress_tree_metrics_t;
 
+typedef struct {
+	const char *boundary;	/* cache boundary being probed */
+	size_t n;		/* tree size */
+} stress_tree_sweep_t;
+
 typedef void (*stress_tree_func)(stress_args_t *args,
 				 const size_t n,
 				 struct tree_node *data,
@@ -90,9 +98,10 @@ static const stress_tree_method_info_t stress_tree_methods[];
 
 static const stress_help_t help[] = {
 	{ NULL,	"tree N",	 "start N workers that exercise tree structures" },
-	{ NULL,	"tree-method M", "select tree method: all,avl,binary,btree,rb,splay" },
+	{ NULL,	"tree-method M", "select tree method: all,avl,binary,bplus,btree,eytzinger,rb,rb-arena,splay" },
 	{ NULL,	"tree-ops N",	 "stop after N bogo tree operations" },
 	{ NULL,	"tree-size N",	 "N is the number of items in the tree" },
+	{ NULL,	"tree-sweep",	 "sweep tree sizes across the cache levels" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -173,6 +182,11 @@ static int stress_set_tree_size(const char *opt)
 	return stress_set_setting("tree-size", TYPE_ID_UINT64, &tree_size);
 }
 
+static int stress_set_tree_sweep(const char *opt)
+{
+	return stress_set_setting_true("tree-sweep", opt);
+}
+
 /*
  *  stress_tree_handler()
  *	SIGALRM generic handler
@@ -857,6 +871,585 @@ PRAGMA_UNROLL_N(4)
 	metrics->count += (double)n;
 }
 
+/*
+ *  Cache conscious B+ tree, a node is four 64 byte cache lines,
+ *  children are 32 bit indices into a node arena rather than
+ *  pointers so an inner node holds 31 keys and 32 children and
+ *  a leaf holds 63 keys. Keys within a node are scanned linearly
+ *  since the whole node is brought in as adjacent cache lines.
+ */
+#define BPLUS_NODE_SIZE	(256)
+#define BPLUS_INNER	(((BPLUS_NODE_SIZE - 4) / 8))		/* 31 keys */
+#define BPLUS_LEAF	(((BPLUS_NODE_SIZE - 4) / 4))		/* 63 keys */
+
+typedef struct {
+	uint16_t count;				/* keys in use */
+	uint16_t leaf;				/* non-zero for a leaf */
+	union {
+		struct {
+			uint32_t key[BPLUS_INNER];
+			uint32_t child[BPLUS_INNER + 1];
+		} inner;
+		uint32_t key[BPLUS_LEAF];
+	} u;
+} bplus_node_t;
+
+typedef struct {
+	bplus_node_t *nodes;			/* node arena */
+	size_t nodes_size;			/* arena size in bytes */
+	uint32_t used;				/* nodes allocated */
+	uint32_t max;				/* arena capacity */
+	uint32_t root;				/* root node index */
+} bplus_tree_t;
+
+static inline uint32_t OPTIMIZE3 bplus_alloc(bplus_tree_t *tree, const bool leaf)
+{
+	bplus_node_t *node;
+
+	if (UNLIKELY(tree->used >= tree->max))
+		return 0;
+	node = &tree->nodes[tree->used];
+	node->count = 0;
+	node->leaf = leaf;
+	return tree->used++;
+}
+
+/*
+ *  bplus_rank()
+ *	number of keys <= value, the index of the child to descend
+ */
+static inline uint32_t OPTIMIZE3 bplus_rank(
+	const uint32_t *key,
+	const uint32_t count,
+	const uint32_t value)
+{
+	register uint32_t i, rank = 0;
+
+	for (i = 0; i < count; i++)
+		rank += (key[i] <= value);
+	return rank;
+}
+
+/*
+ *  bplus_insert_node()
+ *	insert value below node idx, returns true if the node split
+ *	with *up_key and *up_idx to be added to the parent
+ */
+static bool OPTIMIZE3 bplus_insert_node(
+	bplus_tree_t *tree,
+	const uint32_t idx,
+	const uint32_t value,
+	uint32_t *up_key,
+	uint32_t *up_idx,
+	bool *alloc_fail)
+{
+	bplus_node_t *node = &tree->nodes[idx];
+	bplus_node_t *new_node;
+	uint32_t pos, new_idx, i, half;
+
+	if (node->leaf) {
+		uint32_t key[BPLUS_LEAF + 1];
+
+		pos = bplus_rank(node->u.key, node->count, value);
+		if ((pos > 0) && (node->u.key[pos - 1] == value))
+			return false;
+		if (node->count < BPLUS_LEAF) {
+			(void)memmove(&node->u.key[pos + 1], &node->u.key[pos],
+				(node->count - pos) * sizeof(uint32_t));
+			node->u.key[pos] = value;
+			node->count++;
+			return false;
+		}
+		new_idx = bplus_alloc(tree, true);
+		if (UNLIKELY(!new_idx)) {
+			*alloc_fail = true;
+			return false;
+		}
+		new_node = &tree->nodes[new_idx];
+		(void)shim_memcpy(key, node->u.key, pos * sizeof(uint32_t));
+		key[pos] = value;
+		(void)shim_memcpy(&key[pos + 1], &node->u.key[pos],
+			(BPLUS_LEAF - pos) * sizeof(uint32_t));
+		half = (BPLUS_LEAF + 1) / 2;
+		(void)shim_memcpy(node->u.key, key, half * sizeof(uint32_t));
+		(void)shim_memcpy(new_node->u.key, &key[half],
+			(BPLUS_LEAF + 1 - half) * sizeof(uint32_t));
+		node->count = (uint16_t)half;
+		new_node->count = (uint16_t)(BPLUS_LEAF + 1 - half);
+		*up_key = new_node->u.key[0];
+		*up_idx = new_idx;
+		return true;
+	} else {
+		uint32_t key[BPLUS_INNER + 1], child[BPLUS_INNER + 2];
+		uint32_t child_key, child_idx;
+
+		pos = bplus_rank(node->u.inner.key, node->count, value);
+		if (!bplus_insert_node(tree, node->u.inner.child[pos], value,
+				       &child_key, &child_idx, alloc_fail))
+			return false;
+		/* the arena does not move, node is still valid */
+		if (node->count < BPLUS_INNER) {
+			(void)memmove(&node->u.inner.key[pos + 1], &node->u.inner.key[pos],
+				(node->count - pos) * sizeof(uint32_t));
+			(void)memmove(&node->u.inner.child[pos + 2], &node->u.inner.child[pos + 1],
+				(node->count - pos) * sizeof(uint32_t));
+			node->u.inner.key[pos] = child_key;
+			node->u.inner.child[pos + 1] = child_idx;
+			node->count++;
+			return false;
+		}
+		new_idx = bplus_alloc(tree, false);
+		if (UNLIKELY(!new_idx)) {
+			*alloc_fail = true;
+			return false;
+		}
+		new_node = &tree->nodes[new_idx];
+		for (i = 0; i < pos; i++) {
+			key[i] = node->u.inner.key[i];
+			child[i] = node->u.inner.child[i];
+		}
+		child[pos] = node->u.inner.child[pos];
+		key[pos] = child_key;
+		child[pos + 1] = child_idx;
+		for (i = pos; i < BPLUS_INNER; i++) {
+			key[i + 1] = node->u.inner.key[i];
+			child[i + 2] = node->u.inner.child[i + 1];
+		}
+		/* left keeps half keys, the middle key moves up */
+		half = (BPLUS_INNER + 1) / 2;
+		for (i = 0; i < half; i++) {
+			node->u.inner.key[i] = key[i];
+			node->u.inner.child[i] = child[i];
+		}
+		node->u.inner.child[half] = child[half];
+		node->count = (uint16_t)half;
+		for (i = half + 1; i <= BPLUS_INNER; i++) {
+			new_node->u.inner.key[i - half - 1] = key[i];
+			new_node->u.inner.child[i - half - 1] = child[i];
+		}
+		new_node->u.inner.child[BPLUS_INNER - half] = child[BPLUS_INNER + 1];
+		new_node->count = (uint16_t)(BPLUS_INNER - half);
+		*up_key = key[half];
+		*up_idx = new_idx;
+		return true;
+	}
+}
+
+static bool OPTIMIZE3 bplus_insert(bplus_tree_t *tree, const uint32_t value)
+{
+	uint32_t up_key, up_idx;
+	bool alloc_fail = false;
+
+	if (bplus_insert_node(tree, tree->root, value, &up_key, &up_idx, &alloc_fail)) {
+		const uint32_t idx = bplus_alloc(tree, false);
+		bplus_node_t *root;
+
+		if (UNLIKELY(!idx))
+			return false;
+		root = &tree->nodes[idx];
+		root->u.inner.key[0] = up_key;
+		root->u.inner.child[0] = tree->root;
+		root->u.inner.child[1] = up_idx;
+		root->count = 1;
+		tree->root = idx;
+	}
+	return !alloc_fail;
+}
+
+static bool OPTIMIZE3 bplus_find(const bplus_tree_t *tree, const uint32_t value)
+{
+	register const bplus_node_t *node = &tree->nodes[tree->root];
+	register uint32_t i;
+
+	while (!node->leaf) {
+		const uint32_t pos = bplus_rank(node->u.inner.key, node->count, value);
+
+		node = &tree->nodes[node->u.inner.child[pos]];
+	}
+	for (i = 0; i < node->count; i++) {
+		if (node->u.key[i] == value)
+			return true;
+	}
+	return false;
+}
+
+static void stress_tree_bplus(
+	stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes,
+	stress_tree_metrics_t *metrics)
+{
+	size_t i;
+	struct tree_node *node;
+	bplus_tree_t tree;
+	double t;
+
+	/* leaves and inner nodes are at least half full */
+	tree.max = (uint32_t)((n / (BPLUS_INNER / 2)) + 16);
+	tree.nodes_size = (size_t)tree.max * sizeof(bplus_node_t);
+	tree.nodes = (bplus_node_t *)stress_mmap_populate(NULL, tree.nodes_size,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (tree.nodes == MAP_FAILED)
+		return;
+	/* node 0 is reserved, index 0 means allocation failure */
+	tree.used = 1;
+
+	t = stress_time_now();
+	tree.root = bplus_alloc(&tree, true);
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		if (UNLIKELY(!bplus_insert(&tree, node->value))) {
+			pr_fail("%s: bplus tree node arena exhausted\n", args->name);
+			break;
+		}
+	}
+	metrics->insert += stress_time_now() - t;
+
+	/* Manditory forward tree check */
+	t = stress_time_now();
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		if (!bplus_find(&tree, node->value))
+			pr_fail("%s: bplus tree node #%zd not found\n",
+				args->name, i);
+	}
+	metrics->find += stress_time_now() - t;
+
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32modn(n);
+
+			if (!bplus_find(&tree, nodes[j].value))
+				pr_fail("%s: bplus tree node #%zd not found\n",
+					args->name, j);
+		}
+	}
+	t = stress_time_now();
+	(void)munmap((void *)tree.nodes, tree.nodes_size);
+	metrics->remove += stress_time_now() - t;
+	metrics->count += (double)n;
+}
+
+/*
+ *  Static search tree in Eytzinger (breadth first) order, node k
+ *  has children 2k and 2k + 1 so the top levels of the tree are
+ *  packed together and the next levels can be prefetched with no
+ *  pointers to chase. Inserting is a sort and a layout pass.
+ */
+static int OPTIMIZE3 eytzinger_cmp(const void *p1, const void *p2)
+{
+	const uint32_t v1 = *(const uint32_t *)p1;
+	const uint32_t v2 = *(const uint32_t *)p2;
+
+	return (v1 > v2) - (v1 < v2);
+}
+
+static size_t OPTIMIZE3 eytzinger_fill(
+	uint32_t *tree,
+	const uint32_t *sorted,
+	size_t i,
+	const size_t k,
+	const size_t n)
+{
+	if (k <= n) {
+		i = eytzinger_fill(tree, sorted, i, 2 * k, n);
+		tree[k] = sorted[i++];
+		i = eytzinger_fill(tree, sorted, i, 2 * k + 1, n);
+	}
+	return i;
+}
+
+static inline bool OPTIMIZE3 eytzinger_find(
+	const uint32_t *tree,
+	const size_t n,
+	const uint32_t value)
+{
+	register size_t k = 1;
+
+	while (k <= n) {
+		/* 16 uint32_t per cache line, fetch the great grandchildren */
+		shim_builtin_prefetch(tree + (k * 16));
+		k = (2 * k) + (tree[k] < value);
+	}
+	/* strip the right turns and the final left turn */
+	while (k & 1)
+		k >>= 1;
+	k >>= 1;
+	return (k > 0) && (tree[k] == value);
+}
+
+static void stress_tree_eytzinger(
+	stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes,
+	stress_tree_metrics_t *metrics)
+{
+	size_t i, size;
+	struct tree_node *node;
+	uint32_t *sorted, *tree;
+	double t;
+
+	size = (n + 1) * sizeof(uint32_t);
+	sorted = (uint32_t *)stress_mmap_populate(NULL, size,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (sorted == MAP_FAILED)
+		return;
+	tree = (uint32_t *)stress_mmap_populate(NULL, size,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (tree == MAP_FAILED) {
+		(void)munmap((void *)sorted, size);
+		return;
+	}
+
+	t = stress_time_now();
+	for (node = nodes, i = 0; i < n; i++, node++)
+		sorted[i] = node->value;
+	qsort(sorted, n, sizeof(*sorted), eytzinger_cmp);
+	tree[0] = 0;
+	(void)eytzinger_fill(tree, sorted, 0, 1, n);
+	metrics->insert += stress_time_now() - t;
+
+	/* Manditory forward tree check */
+	t = stress_time_now();
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		if (!eytzinger_find(tree, n, node->value))
+			pr_fail("%s: eytzinger tree node #%zd not found\n",
+				args->name, i);
+	}
+	metrics->find += stress_time_now() - t;
+
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32modn(n);
+
+			if (!eytzinger_find(tree, n, nodes[j].value))
+				pr_fail("%s: eytzinger tree node #%zd not found\n",
+					args->name, j);
+		}
+	}
+	t = stress_time_now();
+	(void)munmap((void *)tree, size);
+	(void)munmap((void *)sorted, size);
+	metrics->remove += stress_time_now() - t;
+	metrics->count += (double)n;
+}
+
+/*
+ *  Red-black tree with 16 byte nodes allocated sequentially from
+ *  an arena and linked with 32 bit indices, index 0 is the black
+ *  nil node and the top bit of the parent index is the red flag
+ */
+#define RBA_RED		(0x80000000U)
+
+typedef struct {
+	uint32_t value;
+	uint32_t left;
+	uint32_t right;
+	uint32_t parent;
+} rba_node_t;
+
+typedef struct {
+	rba_node_t *nodes;
+	uint32_t root;
+	uint32_t used;
+} rba_tree_t;
+
+#define RBA_PARENT(nd, x)	((nd)[x].parent & ~RBA_RED)
+#define RBA_IS_RED(nd, x)	((nd)[x].parent & RBA_RED)
+#define RBA_SET_RED(nd, x)	((nd)[x].parent |= RBA_RED)
+#define RBA_SET_BLACK(nd, x)	((nd)[x].parent &= ~RBA_RED)
+
+static inline void OPTIMIZE3 rba_set_parent(rba_node_t *nd, const uint32_t x, const uint32_t p)
+{
+	nd[x].parent = (nd[x].parent & RBA_RED) | p;
+}
+
+static inline void OPTIMIZE3 rba_replace_child(
+	rba_tree_t *tree,
+	const uint32_t p,
+	const uint32_t old_child,
+	const uint32_t new_child)
+{
+	rba_node_t *nd = tree->nodes;
+
+	if (!p)
+		tree->root = new_child;
+	else if (nd[p].left == old_child)
+		nd[p].left = new_child;
+	else
+		nd[p].right = new_child;
+}
+
+static void OPTIMIZE3 rba_rotate_left(rba_tree_t *tree, const uint32_t x)
+{
+	rba_node_t *nd = tree->nodes;
+	const uint32_t y = nd[x].right;
+	const uint32_t p = RBA_PARENT(nd, x);
+
+	nd[x].right = nd[y].left;
+	if (nd[y].left)
+		rba_set_parent(nd, nd[y].left, x);
+	rba_set_parent(nd, y, p);
+	rba_replace_child(tree, p, x, y);
+	nd[y].left = x;
+	rba_set_parent(nd, x, y);
+}
+
+static void OPTIMIZE3 rba_rotate_right(rba_tree_t *tree, const uint32_t x)
+{
+	rba_node_t *nd = tree->nodes;
+	const uint32_t y = nd[x].left;
+	const uint32_t p = RBA_PARENT(nd, x);
+
+	nd[x].left = nd[y].right;
+	if (nd[y].right)
+		rba_set_parent(nd, nd[y].right, x);
+	rba_set_parent(nd, y, p);
+	rba_replace_child(tree, p, x, y);
+	nd[y].right = x;
+	rba_set_parent(nd, x, y);
+}
+
+static void OPTIMIZE3 rba_insert(rba_tree_t *tree, const uint32_t value)
+{
+	rba_node_t *nd = tree->nodes;
+	register uint32_t x = tree->root, y = 0, z;
+
+	while (x) {
+		y = x;
+		if (UNLIKELY(value == nd[x].value))
+			return;
+		x = (value < nd[x].value) ? nd[x].left : nd[x].right;
+	}
+	z = tree->used++;
+	nd[z].value = value;
+	nd[z].left = 0;
+	nd[z].right = 0;
+	nd[z].parent = y | RBA_RED;
+	if (!y)
+		tree->root = z;
+	else if (value < nd[y].value)
+		nd[y].left = z;
+	else
+		nd[y].right = z;
+
+	while ((z != tree->root) && RBA_IS_RED(nd, RBA_PARENT(nd, z))) {
+		uint32_t p = RBA_PARENT(nd, z);
+		const uint32_t g = RBA_PARENT(nd, p);
+
+		if (p == nd[g].left) {
+			const uint32_t u = nd[g].right;
+
+			if (u && RBA_IS_RED(nd, u)) {
+				RBA_SET_BLACK(nd, p);
+				RBA_SET_BLACK(nd, u);
+				RBA_SET_RED(nd, g);
+				z = g;
+			} else {
+				if (z == nd[p].right) {
+					z = p;
+					rba_rotate_left(tree, z);
+					p = RBA_PARENT(nd, z);
+				}
+				RBA_SET_BLACK(nd, p);
+				RBA_SET_RED(nd, g);
+				rba_rotate_right(tree, g);
+			}
+		} else {
+			const uint32_t u = nd[g].left;
+
+			if (u && RBA_IS_RED(nd, u)) {
+				RBA_SET_BLACK(nd, p);
+				RBA_SET_BLACK(nd, u);
+				RBA_SET_RED(nd, g);
+				z = g;
+			} else {
+				if (z == nd[p].left) {
+					z = p;
+					rba_rotate_right(tree, z);
+					p = RBA_PARENT(nd, z);
+				}
+				RBA_SET_BLACK(nd, p);
+				RBA_SET_RED(nd, g);
+				rba_rotate_left(tree, g);
+			}
+		}
+	}
+	RBA_SET_BLACK(nd, tree->root);
+}
+
+static inline bool OPTIMIZE3 rba_find(const rba_tree_t *tree, const uint32_t value)
+{
+	register const rba_node_t *nd = tree->nodes;
+	register uint32_t x = tree->root;
+
+	while (x) {
+		if (nd[x].value == value)
+			return true;
+		x = (value < nd[x].value) ? nd[x].left : nd[x].right;
+	}
+	return false;
+}
+
+static void stress_tree_rb_arena(
+	stress_args_t *args,
+	const size_t n,
+	struct tree_node *nodes,
+	stress_tree_metrics_t *metrics)
+{
+	size_t i, size;
+	struct tree_node *node;
+	rba_tree_t tree;
+	double t;
+
+	size = (n + 1) * sizeof(rba_node_t);
+	tree.nodes = (rba_node_t *)stress_mmap_populate(NULL, size,
+				PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (tree.nodes == MAP_FAILED)
+		return;
+	(void)shim_memset(&tree.nodes[0], 0, sizeof(tree.nodes[0]));
+	tree.root = 0;
+	tree.used = 1;
+
+	t = stress_time_now();
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++)
+		rba_insert(&tree, node->value);
+	metrics->insert += stress_time_now() - t;
+
+	/* Manditory forward tree check */
+	t = stress_time_now();
+PRAGMA_UNROLL_N(4)
+	for (node = nodes, i = 0; i < n; i++, node++) {
+		if (!rba_find(&tree, node->value))
+			pr_fail("%s: rb-arena tree node #%zd not found\n",
+				args->name, i);
+	}
+	metrics->find += stress_time_now() - t;
+
+	if (g_opt_flags & OPT_FLAGS_VERIFY) {
+		/* optional random find */
+		for (i = 0; i < n; i++) {
+			const size_t j = stress_mwc32modn(n);
+
+			if (!rba_find(&tree, nodes[j].value))
+				pr_fail("%s: rb-arena tree node #%zd not found\n",
+					args->name, j);
+		}
+	}
+	t = stress_time_now();
+	(void)munmap((void *)tree.nodes, size);
+	metrics->remove += stress_time_now() - t;
+	metrics->count += (double)n;
+}
+
 static void stress_tree_all(
 	stress_args_t *args,
 	const size_t n,
@@ -877,9 +1470,15 @@ static const stress_tree_method_info_t stress_tree_methods[] = {
 	{ "splay",	stress_tree_splay },
 #endif
 	{ "btree",	stress_tree_btree },
+	{ "bplus",	stress_tree_bplus },
+	{ "eytzinger",	stress_tree_eytzinger },
+	{ "rb-arena",	stress_tree_rb_arena },
 };
 
 static stress_tree_metrics_t stress_tree_metrics[SIZEOF_ARRAY(stress_tree_methods)];
+static stress_tree_metrics_t stress_tree_sweep_metrics[MAX_TREE_SWEEP][SIZEOF_ARRAY(stress_tree_methods)];
+static stress_tree_sweep_t stress_tree_sweep[MAX_TREE_SWEEP];
+static size_t stress_tree_n_sweep;
 
 static void stress_tree_all(
 	stress_args_t *args,
@@ -923,6 +1522,7 @@ static int stress_set_tree_method(const char *name)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_tree_method,	stress_set_tree_method },
 	{ OPT_tree_size,	stress_set_tree_size },
+	{ OPT_tree_sweep,	stress_set_tree_sweep },
 	{ 0,			NULL }
 };
 
@@ -947,6 +1547,132 @@ PRAGMA_UNROLL_N(4)
 	}
 }
 
+/*
+ *  stress_tree_sweep_sizes()
+ *	fill in the tree sizes that fit in half and spill to twice
+ *	each cache level and 4 times the largest cache for DRAM
+ *	assuming a nominal 32 bytes per item, returns number of sizes
+ */
+static size_t stress_tree_sweep_sizes(stress_tree_sweep_t *sweep)
+{
+	static const char * const fit[] = { "L1 fit", "L2 fit", "L3 fit" };
+	static const char * const spill[] = { "L1 spill", "L2 spill", "L3 spill" };
+	size_t level, n_sweep = 0, largest = 0, i;
+	double ws[MAX_TREE_SWEEP];
+
+	for (level = 1; level <= 3; level++) {
+		size_t cache_size, cache_line_size;
+
+		stress_cpu_cache_get_level_size((uint16_t)level, &cache_size, &cache_line_size);
+		if (cache_size == 0)
+			continue;
+		largest = cache_size;
+		sweep[n_sweep].boundary = fit[level - 1];
+		ws[n_sweep++] = (double)cache_size / 2.0;
+		sweep[n_sweep].boundary = spill[level - 1];
+		ws[n_sweep++] = (double)cache_size * 2.0;
+	}
+	if (largest == 0)
+		largest = 8 * MB;
+	sweep[n_sweep].boundary = "DRAM";
+	ws[n_sweep++] = (double)largest * 4.0;
+
+	for (i = 0; i < n_sweep; i++) {
+		size_t n = (size_t)(ws[i] / 32.0);
+
+		n = STRESS_MAXIMUM(n, MIN_TREE_SIZE);
+		n = STRESS_MINIMUM(n, MAX_TREE_SIZE);
+		sweep[i].n = n;
+	}
+
+	/* small caches may clamp to the same size, drop duplicates */
+	for (i = 1, level = 1; i < n_sweep; i++) {
+		if (sweep[i].n != sweep[level - 1].n)
+			sweep[level++] = sweep[i];
+	}
+	return level;
+}
+
+/*
+ *  stress_tree_sweep_run()
+ *	run the method (or all the methods) on each sweep size
+ *	for a time slice
+ */
+static void stress_tree_sweep_run(
+	stress_args_t *args,
+	const size_t tree_method,
+	struct tree_node *nodes)
+{
+	const size_t n_methods = (tree_method == 0) ? SIZEOF_ARRAY(stress_tree_methods) - 1 : 1;
+	size_t i, j;
+	double slice;
+
+	/* spread the run over all sizes, repeating the sweep if time remains */
+	slice = (double)g_opt_timeout / (double)(stress_tree_n_sweep * n_methods);
+	slice = STRESS_MINIMUM(1.0, STRESS_MAXIMUM(0.05, slice));
+
+	for (i = 0; (i < stress_tree_n_sweep) && stress_continue(args); i++) {
+		const size_t n = stress_tree_sweep[i].n;
+
+		for (j = 1; (j < SIZEOF_ARRAY(stress_tree_methods)) && stress_continue(args); j++) {
+			const double t_start = stress_time_now();
+
+			if ((tree_method != 0) && (j != tree_method))
+				continue;
+			do {
+				stress_tree_methods[j].func(args, n, nodes,
+					&stress_tree_sweep_metrics[i][j]);
+				stress_tree_shuffle(nodes, n);
+				stress_bogo_inc(args);
+			} while ((stress_time_now() - t_start < slice) && stress_continue(args));
+		}
+	}
+}
+
+/*
+ *  stress_tree_sweep_report()
+ *	report lookups per second for each size and method, and
+ *	inserts per second too when a single method is swept
+ */
+static void stress_tree_sweep_report(stress_args_t *args, const size_t tree_method)
+{
+	size_t i, j, metric = 0;
+
+	if (args->instance == 0)
+		pr_inf("%s: %-9s %9s %-10s %14s %14s\n", args->name,
+			"boundary", "items", "method", "inserts/sec", "lookups/sec");
+
+	for (i = 0; i < stress_tree_n_sweep; i++) {
+		const char *boundary = stress_tree_sweep[i].boundary;
+
+		for (j = 1; j < SIZEOF_ARRAY(stress_tree_methods); j++) {
+			const stress_tree_metrics_t *m = &stress_tree_sweep_metrics[i][j];
+			const char *name = stress_tree_methods[j].name;
+			double inserts, lookups;
+			char msg[64];
+
+			if ((m->count <= 0.0) || (m->insert <= 0.0) || (m->find <= 0.0))
+				continue;
+			inserts = m->count / m->insert;
+			lookups = m->count / m->find;
+			if (args->instance == 0)
+				pr_inf("%s: %-9s %9zu %-10s %14.0f %14.0f\n", args->name,
+					boundary, stress_tree_sweep[i].n, name, inserts, lookups);
+			/* all methods over all sizes can exceed the metrics table */
+			if (tree_method != 0) {
+				if (metric >= STRESS_STRESSOR_METRICS_MAX)
+					continue;
+				(void)snprintf(msg, sizeof(msg), "%s %s inserts per sec", boundary, name);
+				stress_metrics_set(args, metric++, msg, inserts, STRESS_HARMONIC_MEAN);
+			}
+			if (metric >= STRESS_STRESSOR_METRICS_MAX)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "%s %s lookups per sec", boundary, name);
+			stress_metrics_set(args, metric++, msg, lookups, STRESS_HARMONIC_MEAN);
+		}
+	}
+}
+
 /*
  *  stress_tree()
  *	stress tree
@@ -960,6 +1686,7 @@ static int stress_tree(stress_args_t *args)
 	int ret;
 	stress_tree_func func;
 	stress_tree_metrics_t *metrics;
+	bool tree_sweep = false;
 
 	stress_catch_sigill();
 
@@ -969,8 +1696,11 @@ static int stress_tree(stress_args_t *args)
 		stress_tree_metrics[i].remove = 0.0;
 		stress_tree_metrics[i].count = 0.0;
 	}
+	(void)shim_memset(stress_tree_sweep_metrics, 0, sizeof(stress_tree_sweep_metrics));
+	stress_tree_n_sweep = 0;
 
 	(void)stress_get_setting("tree-method", &tree_method);
+	(void)stress_get_setting("tree-sweep", &tree_sweep);
 
 	func = stress_tree_methods[tree_method].func;
 	metrics = &stress_tree_metrics[tree_method];
@@ -982,6 +1712,11 @@ static int stress_tree(stress_args_t *args)
 			tree_size = MIN_TREE_SIZE;
 	}
 	n = (size_t)tree_size;
+	if (tree_sweep) {
+		stress_tree_n_sweep = stress_tree_sweep_sizes(stress_tree_sweep);
+		for (n = 0, i = 0; i < stress_tree_n_sweep; i++)
+			n = STRESS_MAXIMUM(n, stress_tree_sweep[i].n);
+	}
 	nodes = calloc(n, sizeof(*nodes));
 	if (!nodes) {
 		pr_inf_skip("%s: malloc failed allocating %zd tree nodes, "
@@ -1010,17 +1745,22 @@ static int stress_tree(stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		func(args, n, nodes, metrics);
-		stress_tree_shuffle(nodes, n);
-
-		stress_bogo_inc(args);
+		if (stress_tree_n_sweep > 0) {
+			stress_tree_sweep_run(args, tree_method, nodes);
+		} else {
+			func(args, n, nodes, metrics);
+			stress_tree_shuffle(nodes, n);
+			stress_bogo_inc(args);
+		}
 	} while (stress_continue(args));
 
 	do_jmp = false;
 	(void)stress_sigrestore(args->name, SIGALRM, &old_action);
 
 tidy:
-	for (i = 0, j = 0; i < SIZEOF_ARRAY(stress_tree_metrics); i++) {
+	if (stress_tree_n_sweep > 0)
+		stress_tree_sweep_report(args, tree_method);
+	for (i = 0, j = 0; (stress_tree_n_sweep == 0) && (i < SIZEOF_ARRAY(stress_tree_metrics)); i++) {
 		double duration = stress_tree_metrics[i].insert +
 				  stress_tree_metrics[i].find +
 				  stress_tree_metrics[i].remove;
@@ -1033,6 +1773,18 @@ tidy:
 			stress_metrics_set(args, j, msg,
 				rate, STRESS_HARMONIC_MEAN);
 			j++;
+			if (stress_tree_metrics[i].insert > 0.0) {
+				rate = stress_tree_metrics[i].count / stress_tree_metrics[i].insert;
+				(void)snprintf(msg, sizeof(msg), "%s inserts per sec", stress_tree_methods[i].name);
+				stress_metrics_set(args, j, msg, rate, STRESS_HARMONIC_MEAN);
+				j++;
+			}
+			if (stress_tree_metrics[i].find > 0.0) {
+				rate = stress_tree_metrics[i].count / stress_tree_metrics[i].find;
+				(void)snprintf(msg, sizeof(msg), "%s lookups per sec", stress_tree_methods[i].name);
+				stress_metrics_set(args, j, msg, rate, STRESS_HARMONIC_MEAN);
+				j++;
+			}
 		}
 	}
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -26,15 +26,34 @@
 #define TANSUM			(-710.4128636743199902703338466380955651402473L)
 #define STRESS_TRIG_LOOPS	(10000)
 
+#define STRESS_TRIG_MODE_THROUGHPUT	(0x01)
+#define STRESS_TRIG_MODE_LATENCY	(0x02)
+#define STRESS_TRIG_MODE_BOTH		(STRESS_TRIG_MODE_THROUGHPUT | STRESS_TRIG_MODE_LATENCY)
+
 typedef struct {
 	const char *name;
-	bool (*trig_func)(stress_args_t *args);
+	bool (*trig_func)(stress_args_t *args);		/* independent calls, throughput */
+	bool (*trig_lat_func)(stress_args_t *args);	/* dependent chain, latency */
 } stress_trig_method_t;
 
+typedef struct {
+	const char *name;
+	const int mode;
+} stress_trig_mode_t;
+
+static const stress_trig_mode_t stress_trig_modes[] = {
+	{ "throughput",	STRESS_TRIG_MODE_THROUGHPUT },
+	{ "latency",	STRESS_TRIG_MODE_LATENCY },
+	{ "both",	STRESS_TRIG_MODE_BOTH },
+};
+
+static int stress_trig_mode = STRESS_TRIG_MODE_THROUGHPUT;
+
 static const stress_help_t help[] = {
 	{ NULL,	"trig N",	 "start N workers exercising trigonometric functions" },
 	{ NULL,	"trig-ops N",	 "stop after N trig bogo trigonometric operations" },
 	{ NULL, "trig-method M", "select trigonometric function to exercise" },
+	{ NULL, "trig-mode M",	 "select throughput, latency or both modes" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -299,31 +318,324 @@ PRAGMA_UNROLL_N(8)
 	return shim_fabsl(sumtan - (long double)TANSUM) > precision;
 }
 
+/*
+ *  Latency variants of the above, each call depends on the result
+ *  of the previous call by feeding it back into the argument as
+ *  r * 0.0 (which the compiler cannot fold away without fast-math),
+ *  so the loop runs as a single dependent chain while computing
+ *  exactly the same values and checksums as the throughput variants
+ */
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_cos_lat(stress_args_t *args)
+{
+	double sumcos = 0.0;
+	double theta = 0.0;
+	double dtheta = (PI * 2.0) / (double)STRESS_TRIG_LOOPS;
+	double precision = 1E-7;
+	double r = 0.0;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_cos(theta + r * 0.0);
+		sumcos += r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabs(sumcos - (double)0.0) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_cosf_lat(stress_args_t *args)
+{
+	double sumcos = 0.0;
+	double theta = 0.0;
+	double dtheta = (PI * 2.0) / (float)STRESS_TRIG_LOOPS;
+	double precision = 1E-4;
+	float r = 0.0f;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_cosf((float)(theta + r * 0.0));
+		sumcos += (double)r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabs(sumcos - (float)0.0) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_cosl_lat(stress_args_t *args)
+{
+	long double sumcos = 0.0L;
+	long double theta = 0.0L;
+	long double dtheta = (PI * 2.0L) / (long double)STRESS_TRIG_LOOPS;
+	long double precision;
+	long double r = 0.0L;
+	int i;
+
+	switch (sizeof(precision)) {
+	case 16:
+		precision = 1E-12;
+		break;
+	case 12:
+		precision = 1E-8;
+		break;
+	default:
+		precision = 1E-7;
+		break;
+	}
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_cosl(theta + r * 0.0L);
+		sumcos += r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabsl(sumcos - (long double)0.0) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_sin_lat(stress_args_t *args)
+{
+	double sumsin = 0.0;
+	double theta = 0.0;
+	double dtheta = (PI * 2.0) / (double)STRESS_TRIG_LOOPS;
+	double precision = 1E-7;
+	double r = 0.0;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_sin(theta + r * 0.0);
+		sumsin += r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabs(sumsin - (double)0.0) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_sinf_lat(stress_args_t *args)
+{
+	double sumsin = 0.0;
+	double theta = 0.0;
+	double dtheta = (PI * 2.0) / (float)STRESS_TRIG_LOOPS;
+	double precision = 1E-4;
+	float r = 0.0f;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_sinf((float)(theta + r * 0.0));
+		sumsin += (double)r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabs(sumsin - (float)0.0) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_sinl_lat(stress_args_t *args)
+{
+	long double sumsin = 0.0L;
+	long double theta = 0.0L;
+	long double dtheta = (PI * 2.0L) / (long double)STRESS_TRIG_LOOPS;
+	long double precision;
+	long double r = 0.0L;
+	int i;
+
+	switch (sizeof(precision)) {
+	case 16:
+		precision = 1E-12;
+		break;
+	case 12:
+		precision = 1E-8;
+		break;
+	default:
+		precision = 1E-7;
+		break;
+	}
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_sinl(theta + r * 0.0L);
+		sumsin += r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabsl(sumsin - (long double)0.0) > precision;
+}
+
+#if defined(HAVE_SINCOS)
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_sincos_lat(stress_args_t *args)
+{
+	double sumsin = 0.0, sumcos = 0.0;
+	double theta = 0.0;
+	double dtheta = (PI * 2.0) / (double)STRESS_TRIG_LOOPS;
+	double precision = 1E-7;
+	double r = 0.0;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		double c, s;
+
+		shim_sincos(theta + r * 0.0, &s, &c);
+		r = s + c;
+		sumsin += s;
+		sumcos += c;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return (shim_fabs(sumsin - (double)0.0) > precision) ||
+	       (shim_fabs(sumcos - (double)0.0) > precision);
+}
+#endif
+
+#if defined(HAVE_SINCOSF)
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_sincosf_lat(stress_args_t *args)
+{
+	double sumsin = 0.0, sumcos = 0.0;
+	double theta = 0.0;
+	double dtheta = (PI * 2.0) / (float)STRESS_TRIG_LOOPS;
+	double precision = 1E-4;
+	double r = 0.0;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		float c, s;
+
+		shim_sincosf((float)(theta + r * 0.0), &s, &c);
+		r = (double)(s + c);
+		sumsin += s;
+		sumcos += c;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return (shim_fabs(sumsin - (float)0.0) > precision) ||
+	       (shim_fabs(sumcos - (float)0.0) > precision);
+}
+#endif
+
+#if defined(HAVE_SINCOSL)
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_sincosl_lat(stress_args_t *args)
+{
+	long double sumsin = 0.0, sumcos = 0.0;
+	long double theta = 0.0L;
+	long double dtheta = (PI * 2.0L) / (long double)STRESS_TRIG_LOOPS;
+	long double precision;
+	long double r = 0.0L;
+	int i;
+
+	switch (sizeof(precision)) {
+	case 16:
+		precision = 1E-12;
+		break;
+	case 12:
+		precision = 1E-8;
+		break;
+	default:
+		precision = 1E-7;
+		break;
+	}
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		long double s, c;
+
+		shim_sincosl(theta + r * 0.0L, &s, &c);
+		r = s + c;
+		sumsin += s;
+		sumcos += c;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return (shim_fabsl(sumsin - (long double)0.0) > precision) ||
+	       (shim_fabsl(sumcos - (long double)0.0) > precision);
+}
+#endif
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_tan_lat(stress_args_t *args)
+{
+	double sumtan = 0.0;
+	double theta = 3.0;
+	double dtheta = ((double)PI - theta) / (double)STRESS_TRIG_LOOPS;
+	double precision = 1E-7;
+	double r = 0.0;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_tan(theta + r * 0.0);
+		sumtan += r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabs(sumtan - (double)TANSUM) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_tanf_lat(stress_args_t *args)
+{
+	double sumtan = 0.0;
+	double theta = 3.0;
+	double dtheta = ((double)PI - theta) / (double)STRESS_TRIG_LOOPS;
+	double precision = 1E-5;
+	float r = 0.0f;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_tanf((float)(theta + r * 0.0));
+		sumtan += (double)r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabs(sumtan - (double)TANSUM) > precision;
+}
+
+static bool OPTIMIZE3 TARGET_CLONES stress_trig_tanl_lat(stress_args_t *args)
+{
+	long double sumtan = 0.0;
+	long double theta = 3.0;
+	long double dtheta = ((long double)PI - theta) / (long double)STRESS_TRIG_LOOPS;
+	long double precision = 1E-7;
+	long double r = 0.0L;
+	int i;
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < STRESS_TRIG_LOOPS; i++) {
+		r = shim_tanl(theta + r * 0.0L);
+		sumtan += r;
+		theta += dtheta;
+	}
+	stress_bogo_inc(args);
+	return shim_fabsl(sumtan - (long double)TANSUM) > precision;
+}
+
 static bool stress_trig_all(stress_args_t *args);
 
 static const stress_trig_method_t stress_trig_methods[] = {
-	{ "all",	stress_trig_all },
-	{ "cos",	stress_trig_cos	},
-	{ "cosf",	stress_trig_cosf },
-	{ "cosl",	stress_trig_cosl },
-	{ "sin",	stress_trig_sin	},
-	{ "sinf",	stress_trig_sinf },
-	{ "sinl",	stress_trig_sinl },
+	{ "all",	stress_trig_all,	stress_trig_all },
+	{ "cos",	stress_trig_cos,	stress_trig_cos_lat },
+	{ "cosf",	stress_trig_cosf,	stress_trig_cosf_lat },
+	{ "cosl",	stress_trig_cosl,	stress_trig_cosl_lat },
+	{ "sin",	stress_trig_sin,	stress_trig_sin_lat },
+	{ "sinf",	stress_trig_sinf,	stress_trig_sinf_lat },
+	{ "sinl",	stress_trig_sinl,	stress_trig_sinl_lat },
 #if defined(HAVE_SINCOS)
-	{ "sincos",	stress_trig_sincos },
+	{ "sincos",	stress_trig_sincos,	stress_trig_sincos_lat },
 #endif
 #if defined(HAVE_SINCOSF)
-	{ "sincosf",	stress_trig_sincosf },
+	{ "sincosf",	stress_trig_sincosf,	stress_trig_sincosf_lat },
 #endif
 #if defined(HAVE_SINCOSL)
-	{ "sincosl",	stress_trig_sincosl },
+	{ "sincosl",	stress_trig_sincosl,	stress_trig_sincosl_lat },
 #endif
-	{ "tan",	stress_trig_tan },
-	{ "tanf",	stress_trig_tanf },
-	{ "tanl",	stress_trig_tanl },
+	{ "tan",	stress_trig_tan,	stress_trig_tan_lat },
+	{ "tanf",	stress_trig_tanf,	stress_trig_tanf_lat },
+	{ "tanl",	stress_trig_tanl,	stress_trig_tanl_lat },
 };
 
-stress_metrics_t stress_trig_metrics[SIZEOF_ARRAY(stress_trig_methods)];
+static stress_metrics_t stress_trig_metrics[SIZEOF_ARRAY(stress_trig_methods)];
+static stress_metrics_t stress_trig_lat_metrics[SIZEOF_ARRAY(stress_trig_methods)];
 
 static int stress_set_trig_method(const char *opt)
 {
@@ -342,14 +654,35 @@ static int stress_set_trig_method(const char *opt)
 	return -1;
 }
 
-static bool stess_trig_exercise(stress_args_t *args, const size_t index)
+static int stress_set_trig_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_trig_modes); i++) {
+		if (strcmp(opt, stress_trig_modes[i].name) == 0)
+			return stress_set_setting("trig-mode", TYPE_ID_INT, &stress_trig_modes[i].mode);
+	}
+
+	(void)fprintf(stderr, "trig-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(stress_trig_modes); i++) {
+		(void)fprintf(stderr, " %s", stress_trig_modes[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static bool stess_trig_exercise_func(
+	stress_args_t *args,
+	const size_t index,
+	bool (*trig_func)(stress_args_t *args),
+	stress_metrics_t *metrics)
 {
 	bool ret;
 	const double t = stress_time_now();
 
-	ret = stress_trig_methods[index].trig_func(args);
-	stress_trig_metrics[index].duration += (stress_time_now() - t);
-	stress_trig_metrics[index].count += 1.0;
+	ret = trig_func(args);
+	metrics->duration += (stress_time_now() - t);
+	metrics->count += 1.0;
 	if (ret) {
 		pr_fail("trig: %s does not match expected checksum\n",
 			stress_trig_methods[index].name);
@@ -357,6 +690,22 @@ static bool stess_trig_exercise(stress_args_t *args, const size_t index)
 	return ret;
 }
 
+static bool stess_trig_exercise(stress_args_t *args, const size_t index)
+{
+	bool ret = false;
+
+	if (index == 0)
+		return stress_trig_all(args);
+
+	if (stress_trig_mode & STRESS_TRIG_MODE_THROUGHPUT)
+		ret |= stess_trig_exercise_func(args, index,
+			stress_trig_methods[index].trig_func, &stress_trig_metrics[index]);
+	if (stress_trig_mode & STRESS_TRIG_MODE_LATENCY)
+		ret |= stess_trig_exercise_func(args, index,
+			stress_trig_methods[index].trig_lat_func, &stress_trig_lat_metrics[index]);
+	return ret;
+}
+
 static bool stress_trig_all(stress_args_t *args)
 {
 	size_t i;
@@ -368,6 +717,17 @@ static bool stress_trig_all(stress_args_t *args)
 	return ret;
 }
 
+/*
+ *  stress_trig_ns_per_op()
+ *	nanoseconds per trig function call
+ */
+static double stress_trig_ns_per_op(const stress_metrics_t *metrics)
+{
+	const double ops = (double)STRESS_TRIG_LOOPS * metrics->count;
+
+	return (ops > 0.0) ? (1.0E9 * metrics->duration) / ops : 0.0;
+}
+
 /*
  * stress_trig()
  *	stress system by various trig function calls
@@ -378,10 +738,13 @@ static int stress_trig(stress_args_t *args)
 	size_t trig_method = 0;
 
 	(void)stress_get_setting("trig-method", &trig_method);
+	(void)stress_get_setting("trig-mode", &stress_trig_mode);
 
 	for (i = 0; i < SIZEOF_ARRAY(stress_trig_metrics); i++) {
 		stress_trig_metrics[i].duration = 0.0;
 		stress_trig_metrics[i].count = 0.0;
+		stress_trig_lat_metrics[i].duration = 0.0;
+		stress_trig_lat_metrics[i].count = 0.0;
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
@@ -392,15 +755,44 @@ static int stress_trig(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+	if ((stress_trig_mode == STRESS_TRIG_MODE_BOTH) && (args->instance == 0)) {
+		pr_inf("%s: %-10s %14s %14s %8s\n", args->name,
+			"method", "latency ns", "throughput ns", "ratio");
+		for (i = 1; i < SIZEOF_ARRAY(stress_trig_metrics); i++) {
+			const double lat = stress_trig_ns_per_op(&stress_trig_lat_metrics[i]);
+			const double tput = stress_trig_ns_per_op(&stress_trig_metrics[i]);
+
+			if ((lat > 0.0) && (tput > 0.0))
+				pr_inf("%s: %-10s %14.3f %14.3f %8.2f\n", args->name,
+					stress_trig_methods[i].name, lat, tput, lat / tput);
+		}
+	}
+
 	for (i = 1, j = 0; i < SIZEOF_ARRAY(stress_trig_metrics); i++) {
+		char buf[80];
+
+		if (stress_trig_mode == STRESS_TRIG_MODE_THROUGHPUT) {
+			if (stress_trig_metrics[i].duration > 0.0) {
+				const double rate = (double)STRESS_TRIG_LOOPS *
+					stress_trig_metrics[i].count / stress_trig_metrics[i].duration;
+
+				(void)snprintf(buf, sizeof(buf), "%s ops per second", stress_trig_methods[i].name);
+				stress_metrics_set(args, j, buf,
+					rate, STRESS_HARMONIC_MEAN);
+				j++;
+			}
+			continue;
+		}
+		if (stress_trig_lat_metrics[i].duration > 0.0) {
+			(void)snprintf(buf, sizeof(buf), "%s ns per op (latency)", stress_trig_methods[i].name);
+			stress_metrics_set(args, j, buf,
+				stress_trig_ns_per_op(&stress_trig_lat_metrics[i]), STRESS_GEOMETRIC_MEAN);
+			j++;
+		}
 		if (stress_trig_metrics[i].duration > 0.0) {
-			char buf[80];
-			const double rate = (double)STRESS_TRIG_LOOPS *
-				stress_trig_metrics[i].count / stress_trig_metrics[i].duration;
-
-			(void)snprintf(buf, sizeof(buf), "%s ops per second", stress_trig_methods[i].name);
+			(void)snprintf(buf, sizeof(buf), "%s ns per op (throughput)", stress_trig_methods[i].name);
 			stress_metrics_set(args, j, buf,
-				rate, STRESS_HARMONIC_MEAN);
+				stress_trig_ns_per_op(&stress_trig_metrics[i]), STRESS_GEOMETRIC_MEAN);
 			j++;
 		}
 	}
@@ -409,6 +801,7 @@ static int stress_trig(stress_args_t *args)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_trig_method,	stress_set_trig_method },
+	{ OPT_trig_mode,	stress_set_trig_mode },
 	{ 0,			NULL },
 };
 
@@ -23,6 +23,7 @@
 #include "core-capabilities.h"
 #include "core-killpid.h"
 #include "core-net.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LINUX_IF_TUN_H)
 #include <linux/if_tun.h>
@@ -42,12 +43,48 @@ UNEXPECTED
 UNEXPECTED
 #endif
 
+#if defined(HAVE_NETINET_IP_H)
+#include <netinet/ip.h>
+#endif
+
+#if defined(HAVE_NETINET_UDP_H)
+#include <netinet/udp.h>
+#endif
+
 #include <arpa/inet.h>
+#include <netinet/in.h>
 
 #define PACKETS_TO_SEND		(64)
 
+#define MIN_TUN_MQ		(1)
+#define MAX_TUN_MQ		(16)
+#define MIN_TUN_BATCH		(1)
+#define MAX_TUN_BATCH		(64)
+#define DEFAULT_TUN_BATCH	(16)
+
+#define TUN_MQ_PAYLOAD		(1472)	/* UDP payload of a 1500 byte packet */
+#define TUN_MQ_GSO_SEGS		(44)	/* segments that fit a 64K datagram */
+
+/* virtio-net header ABI, linux/virtio_net.h may be too old for UDP_L4 */
+#define TUN_VNET_HDR_F_NEEDS_CSUM	(1)
+#define TUN_VNET_HDR_GSO_NONE		(0)
+#define TUN_VNET_HDR_GSO_UDP_L4		(5)
+
+#if !defined(TUN_F_USO4)
+#define TUN_F_USO4		(0x20)
+#endif
+#if !defined(TUN_F_USO6)
+#define TUN_F_USO6		(0x40)
+#endif
+#if !defined(UDP_SEGMENT)
+#define UDP_SEGMENT		(103)
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"tun N",	"start N workers exercising tun interface" },
+	{ NULL,	"tun-batch N",	"write N packets per queue per loop in tun-mq mode" },
+	{ NULL,	"tun-gso",	"use UDP GSO super-datagrams in tun-mq mode" },
+	{ NULL,	"tun-mq N",	"use a multiqueue tun with vnet headers, N queues and threads" },
 	{ NULL,	"tun-ops N",	"stop after N tun bogo operations" },
 	{ NULL, "tun-tap",	"use TAP interface instead of TUN" },
 	{ NULL,	NULL,		NULL }
@@ -63,6 +100,51 @@ static const stress_help_t help[] = {
 
 static const char tun_dev[] = "/dev/net/tun";
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SENDMMSG) &&		\
+    defined(HAVE_RECVMMSG) &&		\
+    defined(HAVE_NETINET_IP_H) &&	\
+    defined(HAVE_NETINET_UDP_H) &&	\
+    defined(IFF_MULTI_QUEUE) &&		\
+    defined(IFF_VNET_HDR) &&		\
+    defined(IFF_NO_PI) &&		\
+    defined(TUNSETVNETHDRSZ) &&		\
+    defined(TUNSETOFFLOAD) &&		\
+    defined(TUN_F_CSUM)
+#define STRESS_TUN_MQ
+
+typedef struct {
+	uint8_t flags;			/* TUN_VNET_HDR_F_* */
+	uint8_t gso_type;		/* TUN_VNET_HDR_GSO_* */
+	uint16_t hdr_len;		/* IP + UDP header length */
+	uint16_t gso_size;		/* GSO segment payload size */
+	uint16_t csum_start;		/* checksum from here */
+	uint16_t csum_offset;		/* checksum stored at csum_start + this */
+} stress_tun_vnet_hdr_t;
+
+typedef struct {
+	struct in_addr local;		/* host side address */
+	struct in_addr peer;		/* guest side address */
+	uint32_t batch;			/* packets written per loop */
+	volatile bool stop;
+} stress_tun_mq_t;
+
+typedef struct {
+	stress_tun_mq_t *mq;
+	pthread_t pthread;
+	uint32_t queue;			/* tun queue number */
+	int fd;				/* tun queue fd, the guest end */
+	int sfd;			/* host UDP socket */
+	int port;			/* UDP port of this queue's flow */
+	bool gso_tx;			/* write UDP GSO super-datagrams */
+	bool gso_rx;			/* reflect with UDP_SEGMENT */
+	uint64_t tx_pkts;		/* guest to host packets */
+	uint64_t tx_bytes;
+	uint64_t rx_pkts;		/* host to guest packets */
+	uint64_t rx_bytes;
+} stress_tun_mq_thread_t;
+#endif
+
 /*
  *  stress_tun_supported()
  *      check if we can run this
@@ -94,6 +176,453 @@ static int stress_set_tun_tap(const char *opt)
 	return stress_set_setting_true("tun-tap", opt);
 }
 
+/*
+ *  stress_set_tun_mq()
+ *	set number of tun queues, each driven by its own thread
+ */
+static int stress_set_tun_mq(const char *opt)
+{
+	uint32_t tun_mq;
+
+	tun_mq = stress_get_uint32(opt);
+	stress_check_range("tun-mq", (uint64_t)tun_mq, MIN_TUN_MQ, MAX_TUN_MQ);
+	return stress_set_setting("tun-mq", TYPE_ID_UINT32, &tun_mq);
+}
+
+/*
+ *  stress_set_tun_batch()
+ *	set number of packets written per queue per loop
+ */
+static int stress_set_tun_batch(const char *opt)
+{
+	uint32_t tun_batch;
+
+	tun_batch = stress_get_uint32(opt);
+	stress_check_range("tun-batch", (uint64_t)tun_batch, MIN_TUN_BATCH, MAX_TUN_BATCH);
+	return stress_set_setting("tun-batch", TYPE_ID_UINT32, &tun_batch);
+}
+
+static int stress_set_tun_gso(const char *opt)
+{
+	return stress_set_setting_true("tun-gso", opt);
+}
+
+#if defined(STRESS_TUN_MQ)
+/*
+ *  stress_tun_mq_fill()
+ *	fill in the vnet header and the IPv4 and UDP headers of a
+ *	guest to host datagram with a UDP payload of len bytes,
+ *	a GSO super-datagram is cut into gso_size byte segments
+ */
+static size_t stress_tun_mq_fill(
+	uint8_t *buf,
+	const stress_tun_mq_t *mq,
+	const int port,
+	const size_t len,
+	const uint16_t gso_size)
+{
+	stress_tun_vnet_hdr_t *vh = (stress_tun_vnet_hdr_t *)buf;
+	struct iphdr *ip = (struct iphdr *)(buf + sizeof(*vh));
+	struct udphdr *udp = (struct udphdr *)((uint8_t *)ip + sizeof(*ip));
+	const uint16_t *words;
+	uint32_t sum;
+	size_t i;
+
+	(void)shim_memset(buf, 0, sizeof(*vh) + sizeof(*ip) + sizeof(*udp));
+
+	ip->ihl = 5;
+	ip->version = 4;
+	ip->tot_len = htons((uint16_t)(sizeof(*ip) + sizeof(*udp) + len));
+	ip->id = htons((uint16_t)stress_mwc16());
+	ip->ttl = 64;
+	ip->protocol = IPPROTO_UDP;
+	ip->saddr = mq->peer.s_addr;
+	ip->daddr = mq->local.s_addr;
+	ip->check = stress_ipv4_checksum((uint16_t *)ip, sizeof(*ip));
+
+	udp->source = htons((uint16_t)port);
+	udp->dest = htons((uint16_t)port);
+	udp->len = htons((uint16_t)(sizeof(*udp) + len));
+
+	/* leave the pseudo header sum, the payload is checksummed by offload */
+	words = (const uint16_t *)&ip->saddr;
+	for (sum = 0, i = 0; i < 4; i++)
+		sum += words[i];
+	sum += htons(IPPROTO_UDP) + udp->len;
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+	udp->check = (uint16_t)sum;
+
+	vh->flags = TUN_VNET_HDR_F_NEEDS_CSUM;
+	vh->csum_start = (uint16_t)sizeof(*ip);
+	vh->csum_offset = (uint16_t)offsetof(struct udphdr, check);
+	if (gso_size) {
+		vh->gso_type = TUN_VNET_HDR_GSO_UDP_L4;
+		vh->gso_size = gso_size;
+		vh->hdr_len = (uint16_t)(sizeof(*ip) + sizeof(*udp));
+	}
+	return sizeof(*vh) + sizeof(*ip) + sizeof(*udp) + len;
+}
+
+/*
+ *  stress_tun_mq_queue()
+ *	drive one tun queue like a virtio-net backend: write a batch
+ *	of guest to host datagrams, reflect the ones that arrived on
+ *	the host socket back towards the guest, then drain whatever
+ *	the kernel steered onto this queue
+ */
+static void *stress_tun_mq_queue(void *arg)
+{
+	stress_tun_mq_thread_t *t = (stress_tun_mq_thread_t *)arg;
+	const stress_tun_mq_t *mq = t->mq;
+	const uint32_t batch = mq->batch;
+	const size_t hdrs = sizeof(stress_tun_vnet_hdr_t) + sizeof(struct iphdr) + sizeof(struct udphdr);
+	const size_t gso_segs = STRESS_MINIMUM(batch, TUN_MQ_GSO_SEGS);
+	const size_t buf_size = sizeof(stress_tun_vnet_hdr_t) + 65536;
+	struct mmsghdr msgs[MAX_TUN_BATCH];
+	struct iovec iovs[MAX_TUN_BATCH];
+	uint8_t *wbuf, *rbuf, *hbuf;
+	size_t wlen, i;
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	wbuf = (uint8_t *)calloc(1, (2 * buf_size) + (MAX_TUN_BATCH * TUN_MQ_PAYLOAD));
+	if (!wbuf)
+		return NULL;
+	rbuf = wbuf + buf_size;
+	hbuf = rbuf + buf_size;
+
+	for (i = 0; i < MAX_TUN_BATCH; i++) {
+		iovs[i].iov_base = hbuf + (i * TUN_MQ_PAYLOAD);
+		iovs[i].iov_len = TUN_MQ_PAYLOAD;
+		(void)shim_memset(&msgs[i], 0, sizeof(msgs[i]));
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	wlen = t->gso_tx ?
+		stress_tun_mq_fill(wbuf, mq, t->port, gso_segs * TUN_MQ_PAYLOAD, TUN_MQ_PAYLOAD) :
+		stress_tun_mq_fill(wbuf, mq, t->port, TUN_MQ_PAYLOAD, 0);
+
+	while (!mq->stop) {
+		int n;
+
+		/* guest TX, one GSO super-datagram or a batch of datagrams */
+		if (t->gso_tx) {
+			if (LIKELY(write(t->fd, wbuf, wlen) == (ssize_t)wlen)) {
+				t->tx_pkts += gso_segs;
+				t->tx_bytes += wlen - sizeof(stress_tun_vnet_hdr_t);
+			} else if (errno == EINVAL) {
+				/* kernel cannot take UDP GSO from tun, send it segmented */
+				t->gso_tx = false;
+				wlen = stress_tun_mq_fill(wbuf, mq, t->port, TUN_MQ_PAYLOAD, 0);
+			}
+		} else {
+			for (i = 0; i < batch; i++) {
+				if (UNLIKELY(write(t->fd, wbuf, wlen) != (ssize_t)wlen))
+					break;
+				t->tx_pkts++;
+				t->tx_bytes += wlen - sizeof(stress_tun_vnet_hdr_t);
+			}
+		}
+
+		/* host, reflect what arrived back through the tun device */
+		n = recvmmsg(t->sfd, msgs, batch, MSG_DONTWAIT, NULL);
+		if (n > 0) {
+			if (t->gso_rx) {
+				int done;
+
+				for (done = 0; done < n; done += TUN_MQ_GSO_SEGS) {
+					const size_t segs = STRESS_MINIMUM((size_t)(n - done), TUN_MQ_GSO_SEGS);
+
+					(void)send(t->sfd, hbuf, segs * TUN_MQ_PAYLOAD, MSG_DONTWAIT);
+				}
+			} else {
+				(void)sendmmsg(t->sfd, msgs, (unsigned int)n, MSG_DONTWAIT);
+			}
+		}
+
+		/* guest RX, drain the queue */
+		for (i = 0; i < 4 * batch; i++) {
+			const stress_tun_vnet_hdr_t *vh = (const stress_tun_vnet_hdr_t *)rbuf;
+			const ssize_t ret = read(t->fd, rbuf, buf_size);
+
+			if (ret <= (ssize_t)sizeof(*vh))
+				break;
+			t->rx_bytes += (uint64_t)ret - sizeof(*vh);
+			if ((vh->gso_type != TUN_VNET_HDR_GSO_NONE) && vh->gso_size && ((size_t)ret > hdrs))
+				t->rx_pkts += (((size_t)ret - hdrs) + vh->gso_size - 1) / vh->gso_size;
+			else
+				t->rx_pkts++;
+		}
+	}
+	free(wbuf);
+
+	return NULL;
+}
+
+/*
+ *  stress_tun_mq_ifreq()
+ *	set an IPv4 address in an ifreq using a given ioctl
+ */
+static int stress_tun_mq_ifreq(
+	const int sfd,
+	const char *name,
+	const unsigned long request,
+	const struct in_addr *in)
+{
+	struct ifreq ifr;
+	struct sockaddr_in *sin = (struct sockaddr_in *)&ifr.ifr_addr;
+
+	(void)shim_memset(&ifr, 0, sizeof(ifr));
+	(void)shim_strscpy(ifr.ifr_name, name, sizeof(ifr.ifr_name));
+	sin->sin_family = AF_INET;
+	sin->sin_addr = *in;
+
+	return ioctl(sfd, request, &ifr);
+}
+
+/*
+ *  stress_tun_mq()
+ *	open a multiqueue tun device with vnet headers and offloads,
+ *	drive each queue from its own thread and report per queue
+ *	and total throughput
+ */
+static int stress_tun_mq(
+	stress_args_t *args,
+	const uint32_t tun_mq,
+	const uint32_t tun_batch,
+	const bool tun_gso)
+{
+	stress_tun_mq_thread_t *threads;
+	stress_tun_mq_t mq;
+	struct ifreq ifr;
+	char name[IFNAMSIZ];
+	uint64_t tx_pkts = 0, tx_bytes = 0, rx_pkts = 0, rx_bytes = 0;
+	uint32_t i, n_threads = 0;
+	int sfd, port, rc = EXIT_SUCCESS, hdr_sz = (int)sizeof(stress_tun_vnet_hdr_t);
+	unsigned int offload = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+	bool gso_rx = false;
+	double t_start, duration;
+
+	/* RFC 2544 benchmarking addresses, /32 point to point, no real routes touched */
+	(void)shim_memset(&mq, 0, sizeof(mq));
+	mq.local.s_addr = htonl(0xc6120000 | ((args->instance & 0x7fff) << 1) | 1);
+	mq.peer.s_addr = htonl(0xc6130000 | ((args->instance & 0x7fff) << 1) | 1);
+	mq.batch = tun_batch;
+
+	port = 2000 + (int)(stress_mwc16() & 0x3fff);
+	port = stress_net_reserve_ports(port, port + (int)tun_mq - 1);
+	if (port < 0) {
+		pr_inf_skip("%s: cannot reserve %" PRIu32 " ports, skipping stressor\n",
+			args->name, tun_mq);
+		return EXIT_NO_RESOURCE;
+	}
+
+	threads = (stress_tun_mq_thread_t *)calloc((size_t)tun_mq, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate thread state, skipping stressor\n", args->name);
+		stress_net_release_ports(port, port + (int)tun_mq - 1);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < tun_mq; i++)
+		threads[i].fd = threads[i].sfd = -1;
+
+	/* the first TUNSETIFF names the device, the other queues attach by name */
+	(void)shim_memset(name, 0, sizeof(name));
+	for (i = 0; i < tun_mq; i++) {
+		stress_tun_mq_thread_t *t = &threads[i];
+
+		t->fd = open(tun_dev, O_RDWR | O_NONBLOCK);
+		if (t->fd < 0) {
+			pr_fail("%s: cannot open %s, errno=%d (%s)\n",
+				args->name, tun_dev, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		(void)shim_memset(&ifr, 0, sizeof(ifr));
+		(void)shim_strscpy(ifr.ifr_name, name, sizeof(ifr.ifr_name));
+		ifr.ifr_flags = IFF_TUN | IFF_NO_PI | IFF_MULTI_QUEUE | IFF_VNET_HDR;
+		if (ioctl(t->fd, TUNSETIFF, (void *)&ifr) < 0) {
+			if ((i == 0) && (errno == EINVAL)) {
+				pr_inf_skip("%s: multiqueue tun not supported, skipping stressor\n",
+					args->name);
+				rc = EXIT_NO_RESOURCE;
+			} else {
+				pr_fail("%s: ioctl TUNSETIFF on queue %" PRIu32 " failed, errno=%d (%s)\n",
+					args->name, i, errno, strerror(errno));
+				rc = EXIT_FAILURE;
+			}
+			goto close_fds;
+		}
+		if (i == 0)
+			(void)shim_strscpy(name, ifr.ifr_name, sizeof(name));
+	}
+
+	if (ioctl(threads[0].fd, TUNSETVNETHDRSZ, &hdr_sz) < 0) {
+		pr_fail("%s: ioctl TUNSETVNETHDRSZ failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fds;
+	}
+	/* UDP segmentation offload needs Linux 6.2, fall back to TSO and checksums */
+	if (tun_gso && (ioctl(threads[0].fd, TUNSETOFFLOAD, offload | TUN_F_USO4 | TUN_F_USO6) == 0)) {
+		gso_rx = true;
+	} else if (ioctl(threads[0].fd, TUNSETOFFLOAD, offload) < 0) {
+		pr_fail("%s: ioctl TUNSETOFFLOAD failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fds;
+	}
+	if (tun_gso && !gso_rx && (args->instance == 0))
+		pr_inf("%s: tun UDP segmentation offload not supported, "
+			"host to guest datagrams will be segmented\n", args->name);
+
+	sfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sfd < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto close_fds;
+	}
+	if ((stress_tun_mq_ifreq(sfd, name, SIOCSIFADDR, &mq.local) < 0) ||
+	    (stress_tun_mq_ifreq(sfd, name, SIOCSIFDSTADDR, &mq.peer) < 0)) {
+		pr_fail("%s: cannot set %s addresses, errno=%d (%s)\n",
+			args->name, name, errno, strerror(errno));
+		(void)close(sfd);
+		rc = EXIT_FAILURE;
+		goto close_fds;
+	}
+	(void)shim_memset(&ifr, 0, sizeof(ifr));
+	(void)shim_strscpy(ifr.ifr_name, name, sizeof(ifr.ifr_name));
+	ifr.ifr_flags = IFF_UP | IFF_RUNNING | IFF_POINTOPOINT | IFF_NOARP;
+	if (ioctl(sfd, SIOCSIFFLAGS, &ifr) < 0) {
+		pr_fail("%s: cannot bring %s up, errno=%d (%s)\n",
+			args->name, name, errno, strerror(errno));
+		(void)close(sfd);
+		rc = EXIT_FAILURE;
+		goto close_fds;
+	}
+	(void)close(sfd);
+
+	/* one connected host socket per queue, flows hash onto different queues */
+	for (i = 0; i < tun_mq; i++) {
+		stress_tun_mq_thread_t *t = &threads[i];
+		struct sockaddr_in addr;
+
+		t->mq = &mq;
+		t->queue = i;
+		t->port = port + (int)i;
+		t->gso_tx = tun_gso;
+		t->sfd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (t->sfd < 0) {
+			pr_fail("%s: socket failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+		(void)shim_memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons((uint16_t)t->port);
+		addr.sin_addr = mq.local;
+		if (bind(t->sfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: bind failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			goto close_fds;
+		}
+		addr.sin_addr = mq.peer;
+		if (connect(t->sfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			pr_fail("%s: connect failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			goto close_fds;
+		}
+#if defined(UDP_SEGMENT)
+		if (gso_rx) {
+			int val = TUN_MQ_PAYLOAD;
+
+			t->gso_rx = (setsockopt(t->sfd, IPPROTO_UDP, UDP_SEGMENT, &val, sizeof(val)) == 0);
+		}
+#endif
+	}
+
+	for (i = 0; i < tun_mq; i++) {
+		if (pthread_create(&threads[i].pthread, NULL, stress_tun_mq_queue, &threads[i]))
+			break;
+		n_threads++;
+	}
+	if (n_threads == 0) {
+		pr_inf_skip("%s: cannot create queue threads, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+	}
+
+	t_start = stress_time_now();
+	while ((rc == EXIT_SUCCESS) && stress_continue(args)) {
+		uint64_t total = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_threads; i++)
+			total += threads[i].tx_pkts + threads[i].rx_pkts;
+		stress_bogo_set(args, total);
+	}
+	mq.stop = true;
+	for (i = 0; i < n_threads; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	duration = stress_time_now() - t_start;
+
+	for (i = 0; i < n_threads; i++) {
+		const stress_tun_mq_thread_t *t = &threads[i];
+
+		tx_pkts += t->tx_pkts;
+		tx_bytes += t->tx_bytes;
+		rx_pkts += t->rx_pkts;
+		rx_bytes += t->rx_bytes;
+	}
+	stress_bogo_set(args, tx_pkts + rx_pkts);
+
+	if ((rc == EXIT_SUCCESS) && (duration > 0.0)) {
+		pr_dbg("%s: %s, %" PRIu32 " queues, %" PRIu64 " packets written, %"
+			PRIu64 " packets read\n", args->name, name, n_threads,
+			tx_pkts, rx_pkts);
+		stress_metrics_set(args, 0, "guest tx Gbit per sec",
+			((double)tx_bytes * 8.0) / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "guest tx packets per sec",
+			(double)tx_pkts / duration, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 2, "guest rx Gbit per sec",
+			((double)rx_bytes * 8.0) / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 3, "guest rx packets per sec",
+			(double)rx_pkts / duration, STRESS_HARMONIC_MEAN);
+		for (i = 0; i < n_threads; i++) {
+			const stress_tun_mq_thread_t *t = &threads[i];
+			char str[40];
+
+			(void)snprintf(str, sizeof(str), "queue %" PRIu32 " Gbit per sec", i);
+			stress_metrics_set(args, 4 + (2 * i), str,
+				((double)(t->tx_bytes + t->rx_bytes) * 8.0) / (duration * 1.0E9),
+				STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "queue %" PRIu32 " packets per sec", i);
+			stress_metrics_set(args, 5 + (2 * i), str,
+				(double)(t->tx_pkts + t->rx_pkts) / duration,
+				STRESS_HARMONIC_MEAN);
+		}
+	}
+
+close_fds:
+	for (i = 0; i < tun_mq; i++) {
+		if (threads[i].sfd >= 0)
+			(void)close(threads[i].sfd);
+		if (threads[i].fd >= 0)
+			(void)close(threads[i].fd);
+	}
+	free(threads);
+	stress_net_release_ports(port, port + (int)tun_mq - 1);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_tun
  *	stress tun interface
@@ -105,8 +634,32 @@ static int stress_tun(stress_args_t *args)
 	const gid_t group = getegid();
 	char ip_addr[32];
 	bool tun_tap = false;
+	bool tun_gso = false;
+	uint32_t tun_mq = 0;
+	uint32_t tun_batch = DEFAULT_TUN_BATCH;
 
 	(void)stress_get_setting("tun-tap", &tun_tap);
+	(void)stress_get_setting("tun-mq", &tun_mq);
+	(void)stress_get_setting("tun-batch", &tun_batch);
+	(void)stress_get_setting("tun-gso", &tun_gso);
+
+	if (tun_mq) {
+		if (tun_tap && (args->instance == 0))
+			pr_inf("%s: tun-tap is ignored in tun-mq mode, a tun device is used\n",
+				args->name);
+		if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0)
+			return EXIT_NO_RESOURCE;
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+#if defined(STRESS_TUN_MQ)
+		rc = stress_tun_mq(args, tun_mq, tun_batch, tun_gso);
+#else
+		pr_inf_skip("%s: tun-mq requires pthreads, sendmmsg, recvmmsg and "
+			"multiqueue tun support, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+#endif
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+		return rc;
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -395,6 +948,9 @@ clean_up:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_tun_batch,	stress_set_tun_batch },
+	{ OPT_tun_gso,		stress_set_tun_gso },
+	{ OPT_tun_mq,		stress_set_tun_mq },
 	{ OPT_tun_tap,		stress_set_tun_tap },
 	{ 0,                    NULL }
 };
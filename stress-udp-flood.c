@@ -27,16 +27,41 @@
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_SOCK_DIAG_H)
+#include <linux/sock_diag.h>
+#endif
+
 #define MAX_UDP_SIZE	(2048)
+#define MAX_UDP_PPS	(1000000000ULL)
+#define MAX_UDP_BPS	(1000000000000ULL)
+
+/* largest IPv4 UDP payload that fits a 1500 byte MTU */
+#define UDP_MTU_PAYLOAD	(1472)
+
+#define UDP_FLOOD_SIZE_RAMP	(0)	/* 1..23 + instance bytes, the default */
+#define UDP_FLOOD_SIZE_UNIFORM	(1)	/* uniformly random 1..1472 bytes */
+#define UDP_FLOOD_SIZE_IMIX	(2)	/* 7:4:1 mix of 64, 576 and 1500 byte packets */
+#define UDP_FLOOD_SIZE_FIXED	(3)	/* fixed size, sizes above this */
 
 static const stress_help_t help[] = {
 	{ NULL,	"udp-flood N",		"start N workers that performs a UDP flood attack" },
+	{ NULL,	"udp-flood-bps N",	"pace the flood to N bits per second, K, M or G suffixes allowed" },
 	{ NULL,	"udp-flood-domain D",	"specify domain, default is ipv4" },
+	{ NULL,	"udp-flood-fq",		"pace bits per second with SO_MAX_PACING_RATE, needs an fq qdisc" },
 	{ NULL, "udp-flood-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"udp-flood-ops N",	"stop after N udp flood bogo operations" },
+	{ NULL,	"udp-flood-pps N",	"pace the flood to N packets per second" },
+	{ NULL,	"udp-flood-size S",	"datagram sizes, one of ramp, uniform, imix or a size in bytes" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const stress_scale_t udp_flood_bps_scales[] = {
+	{ 'k',	1000ULL },
+	{ 'm',	1000000ULL },
+	{ 'g',	1000000000ULL },
+	{ 0,	0 },
+};
+
 /*
  *  stress_set_udp_domain()
  *      set the udp domain option
@@ -57,14 +82,231 @@ static int stress_set_udp_flood_if(const char *name)
 	return stress_set_setting("udp-flood-if", TYPE_ID_STR, name);
 }
 
+/*
+ *  stress_set_udp_flood_pps()
+ *	set target packets per second
+ */
+static int stress_set_udp_flood_pps(const char *opt)
+{
+	uint64_t udp_flood_pps;
+
+	udp_flood_pps = stress_get_uint64(opt);
+	stress_check_range("udp-flood-pps", udp_flood_pps, 1, MAX_UDP_PPS);
+	return stress_set_setting("udp-flood-pps", TYPE_ID_UINT64, &udp_flood_pps);
+}
+
+/*
+ *  stress_set_udp_flood_bps()
+ *	set target bits per second, decimal K, M and G multipliers
+ */
+static int stress_set_udp_flood_bps(const char *opt)
+{
+	uint64_t udp_flood_bps;
+
+	udp_flood_bps = stress_get_uint64_scale(opt, udp_flood_bps_scales, "bit rate");
+	stress_check_range("udp-flood-bps", udp_flood_bps, 8, MAX_UDP_BPS);
+	return stress_set_setting("udp-flood-bps", TYPE_ID_UINT64, &udp_flood_bps);
+}
+
+static int stress_set_udp_flood_fq(const char *opt)
+{
+	return stress_set_setting_true("udp-flood-fq", opt);
+}
+
+/*
+ *  stress_set_udp_flood_size()
+ *	set size distribution, or a fixed size
+ */
+static int stress_set_udp_flood_size(const char *opt)
+{
+	size_t udp_flood_size;
+
+	if (!strcmp(opt, "ramp")) {
+		udp_flood_size = UDP_FLOOD_SIZE_RAMP;
+	} else if (!strcmp(opt, "uniform")) {
+		udp_flood_size = UDP_FLOOD_SIZE_UNIFORM;
+	} else if (!strcmp(opt, "imix")) {
+		udp_flood_size = UDP_FLOOD_SIZE_IMIX;
+	} else {
+		const uint64_t sz = stress_get_uint64(opt);
+
+		stress_check_range("udp-flood-size", sz, 1, MAX_UDP_SIZE);
+		udp_flood_size = UDP_FLOOD_SIZE_FIXED + (size_t)sz;
+	}
+	return stress_set_setting("udp-flood-size", TYPE_ID_SIZE_T, &udp_flood_size);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_udp_flood_bps,	stress_set_udp_flood_bps },
 	{ OPT_udp_flood_domain,	stress_set_udp_flood_domain },
+	{ OPT_udp_flood_fq,	stress_set_udp_flood_fq },
 	{ OPT_udp_flood_if,	stress_set_udp_flood_if },
+	{ OPT_udp_flood_pps,	stress_set_udp_flood_pps },
+	{ OPT_udp_flood_size,	stress_set_udp_flood_size },
 	{ 0,			NULL }
 };
 
 #if defined(AF_PACKET)
 
+/*
+ *  user space pacer, each datagram is due at t_next
+ */
+typedef struct {
+	uint64_t t_next;		/* when the next datagram is due, ns */
+	uint64_t ns_per_pkt;		/* pps pacing interval, ns */
+	double ns_per_byte;		/* bps pacing interval, ns */
+} stress_udp_flood_pacer_t;
+
+/*
+ *  stress_udp_flood_now_ns()
+ *	monotonic time in nanoseconds
+ */
+static inline uint64_t stress_udp_flood_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_udp_flood_pace()
+ *	wait until a datagram of sz bytes is due, sleep if it is more
+ *	than 50us away and spin otherwise. Falling more than 100ms
+ *	behind resets the schedule rather than sending a burst
+ */
+static void OPTIMIZE3 stress_udp_flood_pace(stress_udp_flood_pacer_t *pacer, const size_t sz)
+{
+	uint64_t now, interval;
+
+	if (!pacer->ns_per_pkt && (pacer->ns_per_byte <= 0.0))
+		return;
+
+	now = stress_udp_flood_now_ns();
+	if (now + 50000 < pacer->t_next)
+		(void)shim_nanosleep_uint64(pacer->t_next - now - 50000);
+	while (stress_udp_flood_now_ns() < pacer->t_next)
+		;
+	now = stress_udp_flood_now_ns();
+	if (now > pacer->t_next + 100000000)
+		pacer->t_next = now;
+
+	interval = (uint64_t)(pacer->ns_per_byte * (double)sz);
+	pacer->t_next += STRESS_MAXIMUM(interval, pacer->ns_per_pkt);
+}
+
+/*
+ *  stress_udp_flood_size()
+ *	next datagram size for the size distribution
+ */
+static inline size_t OPTIMIZE3 stress_udp_flood_size(
+	const size_t udp_flood_size,
+	const size_t sz,
+	const size_t sz_max)
+{
+	switch (udp_flood_size) {
+	case UDP_FLOOD_SIZE_RAMP:
+		return UNLIKELY(sz + 1 >= sz_max) ? 1 : sz + 1;
+	case UDP_FLOOD_SIZE_UNIFORM:
+		return 1 + (size_t)stress_mwc16modn(UDP_MTU_PAYLOAD);
+	case UDP_FLOOD_SIZE_IMIX: {
+			/* IPv4 payloads of 64, 576 and 1500 byte packets */
+			const uint8_t r = stress_mwc8modn(12);
+
+			return (r < 7) ? 36 : ((r < 11) ? 548 : UDP_MTU_PAYLOAD);
+		}
+	default:
+		return udp_flood_size - UDP_FLOOD_SIZE_FIXED;
+	}
+}
+
+/*
+ *  stress_udp_flood_snmp_drops()
+ *	system wide UDP datagrams dropped on receive errors and
+ *	full send or receive buffers, from /proc/net/snmp for
+ *	IPv4 or /proc/net/snmp6 for IPv6
+ */
+static uint64_t stress_udp_flood_snmp_drops(const int domain)
+{
+	static const char * const fields[] = {
+		"InErrors", "RcvbufErrors", "SndbufErrors"
+	};
+	char hdr[1024], vals[1024];
+	uint64_t drops = 0;
+	FILE *fp;
+	size_t i;
+
+	if (domain == AF_INET6) {
+		fp = fopen("/proc/net/snmp6", "r");
+		if (!fp)
+			return 0;
+		while (fgets(hdr, sizeof(hdr), fp)) {
+			char name[64];
+			uint64_t val;
+
+			if (sscanf(hdr, "%63s %" SCNu64, name, &val) != 2)
+				continue;
+			if (strncmp(name, "Udp6", 4))
+				continue;
+			for (i = 0; i < SIZEOF_ARRAY(fields); i++) {
+				if (!strcmp(name + 4, fields[i]))
+					drops += val;
+			}
+		}
+		(void)fclose(fp);
+		return drops;
+	}
+
+	fp = fopen("/proc/net/snmp", "r");
+	if (!fp)
+		return 0;
+	/* a Udp: line of field names is followed by a Udp: line of values */
+	while (fgets(hdr, sizeof(hdr), fp)) {
+		char *h, *v, *hsave = NULL, *vsave = NULL;
+
+		if (strncmp(hdr, "Udp: ", 5))
+			continue;
+		if (!fgets(vals, sizeof(vals), fp))
+			break;
+		for (h = strtok_r(hdr, " \n", &hsave), v = strtok_r(vals, " \n", &vsave);
+		     h && v;
+		     h = strtok_r(NULL, " \n", &hsave), v = strtok_r(NULL, " \n", &vsave)) {
+			for (i = 0; i < SIZEOF_ARRAY(fields); i++) {
+				if (!strcmp(h, fields[i]))
+					drops += (uint64_t)strtoull(v, NULL, 10);
+			}
+		}
+		break;
+	}
+	(void)fclose(fp);
+
+	return drops;
+}
+
+/*
+ *  stress_udp_flood_sock_drops()
+ *	datagrams dropped by the socket, from SO_MEMINFO
+ */
+static uint64_t stress_udp_flood_sock_drops(const int fd)
+{
+#if defined(SO_MEMINFO) &&		\
+    defined(HAVE_LINUX_SOCK_DIAG_H) &&	\
+    defined(SK_MEMINFO_DROPS)
+	uint32_t meminfo[SK_MEMINFO_VARS];
+	socklen_t len = sizeof(meminfo);
+
+	(void)shim_memset(meminfo, 0, sizeof(meminfo));
+	if (getsockopt(fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) == 0)
+		return (uint64_t)meminfo[SK_MEMINFO_DROPS];
+#else
+	(void)fd;
+#endif
+	return 0;
+}
+
 /*
  *  stress_udp_flood
  *	UDP flood
@@ -80,10 +322,18 @@ static int OPTIMIZE3 stress_udp_flood(stress_args_t *args)
 	size_t sz = 1;
 	char *udp_flood_if = NULL;
 	double bytes = 0.0, duration, t, rate;
-	uint64_t sendto_failed = 0, total_count;
+	uint64_t sendto_failed = 0, total_count, sent, snmp_drops;
+	uint64_t udp_flood_pps = 0, udp_flood_bps = 0;
+	size_t udp_flood_size = UDP_FLOOD_SIZE_RAMP;
+	bool udp_flood_fq = false;
+	stress_udp_flood_pacer_t pacer;
 
+	(void)stress_get_setting("udp-flood-bps", &udp_flood_bps);
 	(void)stress_get_setting("udp-flood-domain", &udp_flood_domain);
+	(void)stress_get_setting("udp-flood-fq", &udp_flood_fq);
 	(void)stress_get_setting("udp-flood-if", &udp_flood_if);
+	(void)stress_get_setting("udp-flood-pps", &udp_flood_pps);
+	(void)stress_get_setting("udp-flood-size", &udp_flood_size);
 
 	if (udp_flood_if) {
 		int ret;
@@ -113,9 +363,38 @@ static int OPTIMIZE3 stress_udp_flood(stress_args_t *args)
 			&addr, &addr_len, NET_ADDR_ANY) < 0) {
 	}
 
+	(void)shim_memset(&pacer, 0, sizeof(pacer));
+	pacer.ns_per_pkt = udp_flood_pps ? STRESS_NANOSECOND / udp_flood_pps : 0;
+	if (udp_flood_bps && udp_flood_fq) {
+#if defined(SO_MAX_PACING_RATE)
+		/* the kernel paces in bytes per second, fq clamps to 32 bits */
+		const uint32_t pacing_rate = (uint32_t)STRESS_MINIMUM(udp_flood_bps / 8, UINT32_MAX);
+
+		if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &pacing_rate, sizeof(pacing_rate)) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: setsockopt SO_MAX_PACING_RATE failed, errno=%d (%s), "
+					"pacing in user space instead\n",
+					args->name, errno, strerror(errno));
+			udp_flood_fq = false;
+		}
+#else
+		if (args->instance == 0)
+			pr_inf("%s: SO_MAX_PACING_RATE is not supported, "
+				"pacing in user space instead\n", args->name);
+		udp_flood_fq = false;
+#endif
+	}
+	if (udp_flood_bps && !udp_flood_fq)
+		pacer.ns_per_byte = (STRESS_DBL_NANOSECOND * 8.0) / (double)udp_flood_bps;
+
+	snmp_drops = stress_udp_flood_snmp_drops(udp_flood_domain);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	if (udp_flood_size != UDP_FLOOD_SIZE_RAMP)
+		sz = stress_udp_flood_size(udp_flood_size, sz, sz_max);
+
 	t = stress_time_now();
+	pacer.t_next = stress_udp_flood_now_ns();
 	do {
 		char buf[MAX_UDP_SIZE];
 		int rand_port, reserved_port;
@@ -131,6 +410,7 @@ static int OPTIMIZE3 stress_udp_flood(stress_args_t *args)
 
 		stress_set_sockaddr_port(udp_flood_domain, port, addr);
 		(void)shim_memset(buf, stress_ascii64[j++ & 63], sz);
+		stress_udp_flood_pace(&pacer, sz);
 		n = sendto(fd, buf, sz, 0, addr, addr_len);
 		if (LIKELY(n > 0)) {
 			stress_bogo_inc(args);
@@ -159,6 +439,7 @@ static int OPTIMIZE3 stress_udp_flood(stress_args_t *args)
 			continue;
 		rand_port = reserved_port;
 		stress_set_sockaddr_port(udp_flood_domain, rand_port, addr);
+		stress_udp_flood_pace(&pacer, sz);
 		n = sendto(fd, buf, sz, 0, addr, addr_len);
 		if (LIKELY(n > 0)) {
 			stress_bogo_inc(args);
@@ -167,11 +448,12 @@ static int OPTIMIZE3 stress_udp_flood(stress_args_t *args)
 			sendto_failed++;
 		}
 		stress_net_release_ports(rand_port, rand_port);
-		if (UNLIKELY(++sz >= sz_max))
-			sz = 1;
+		sz = stress_udp_flood_size(udp_flood_size, sz, sz_max);
 	} while (stress_continue(args));
 
 	duration = stress_time_now() - t;
+	snmp_drops = stress_udp_flood_snmp_drops(udp_flood_domain) - snmp_drops;
+	sent = stress_bogo_get(args);
 
 	rate = (duration > 0.0) ? (bytes / duration) / (double)MB : 0.0;
 	stress_metrics_set(args, 0, "MB per sec sendto rate",
@@ -179,10 +461,26 @@ static int OPTIMIZE3 stress_udp_flood(stress_args_t *args)
 	rate = (duration > 0.0) ? (stress_bogo_get(args) / duration) : 0.0;
 	stress_metrics_set(args, 1, "sendto calls per sec",
 		rate, STRESS_HARMONIC_MEAN);
-	total_count = stress_bogo_get(args) + sendto_failed;
-	rate = (total_count > 0) ? ((total_count - sendto_failed) / total_count) * 100.0 : 0.0;
+	total_count = sent + sendto_failed;
+	rate = (total_count > 0) ? ((double)(total_count - sendto_failed) / (double)total_count) * 100.0 : 0.0;
 	stress_metrics_set(args, 2, "% sendto calls succeeded",
 		rate, STRESS_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (bytes * 8.0) / (duration * 1.0E9) : 0.0;
+	stress_metrics_set(args, 3, "Gbit per sec sendto rate",
+		rate, STRESS_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)snmp_drops / duration : 0.0;
+	stress_metrics_set(args, 4, "system UDP drops per sec",
+		rate, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 5, "socket drops (SO_MEMINFO)",
+		(double)stress_udp_flood_sock_drops(fd), STRESS_GEOMETRIC_MEAN);
+	if ((duration > 0.0) && (udp_flood_pps || udp_flood_bps)) {
+		/* the tighter of the two targets is the one that limits the rate */
+		const double pps_frac = udp_flood_pps ? (double)sent / (duration * (double)udp_flood_pps) : 0.0;
+		const double bps_frac = udp_flood_bps ? (bytes * 8.0) / (duration * (double)udp_flood_bps) : 0.0;
+
+		stress_metrics_set(args, 6, "% of target rate achieved",
+			100.0 * STRESS_MAXIMUM(pps_frac, bps_frac), STRESS_GEOMETRIC_MEAN);
+	}
 
 	/* 100% sendto failure is not good */
 	if ((total_count > 0) && (sendto_failed == total_count)) {
@@ -30,6 +30,10 @@
 UNEXPECTED
 #endif
 
+#if defined(HAVE_LINUX_NET_TSTAMP_H)
+#include <linux/net_tstamp.h>
+#endif
+
 #if defined(HAVE_LINUX_UDP_H)
 #include <linux/udp.h>
 #else
@@ -50,6 +54,17 @@ UNEXPECTED
 
 #define UDP_BUF			(1024)	/* UDP I/O buffer size */
 
+#define MIN_UDP_BATCH		(1)
+#define MAX_UDP_BATCH		(256)
+#define MIN_UDP_GSO		(64)
+#define MAX_UDP_GSO		(8192)
+#define MIN_UDP_TXTIME		(1000)
+#define MAX_UDP_TXTIME		(100000000)
+
+#define UDP_GSO_SEGS_MAX	(64)		/* kernel UDP_MAX_SEGMENTS */
+#define UDP_MSG_MAX		(65000)		/* largest GSO super-datagram */
+#define UDP_TXTIME_AHEAD_NS	(50000000ULL)	/* max time to queue ahead */
+
 /* See bugs section of udplite(7) */
 #if !defined(SOL_UDPLITE)
 #define SOL_UDPLITE		(136)
@@ -63,12 +78,15 @@ UNEXPECTED
 
 static const stress_help_t help[] = {
 	{ NULL,	"udp N",	"start N workers performing UDP send/receives " },
+	{ NULL,	"udp-batch N",	"send and receive N datagrams per sendmmsg/recvmmsg call" },
 	{ NULL,	"udp-domain D",	"specify domain, default is ipv4" },
 	{ NULL, "udp-gro",	"enable UDP-GRO" },
+	{ NULL,	"udp-gso N",	"send GSO super-datagrams of N byte UDP_SEGMENT segments" },
 	{ NULL,	"udp-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"udp-lite",	"use the UDP-Lite (RFC 3828) protocol" },
 	{ NULL,	"udp-ops N",	"stop after N udp bogo operations" },
 	{ NULL,	"udp-port P",	"use ports P to P + number of workers - 1" },
+	{ NULL,	"udp-txtime N",	"pace sends to N packets per second using SO_TXTIME" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -110,6 +128,48 @@ static int stress_set_udp_if(const char *name)
 	return stress_set_setting("udp-if", TYPE_ID_STR, name);
 }
 
+/*
+ *  stress_set_udp_batch()
+ *	set number of datagrams per sendmmsg/recvmmsg
+ */
+static int stress_set_udp_batch(const char *opt)
+{
+	uint32_t udp_batch;
+
+	udp_batch = stress_get_uint32(opt);
+	stress_check_range("udp-batch", (uint64_t)udp_batch,
+		MIN_UDP_BATCH, MAX_UDP_BATCH);
+	return stress_set_setting("udp-batch", TYPE_ID_UINT32, &udp_batch);
+}
+
+/*
+ *  stress_set_udp_gso()
+ *	set UDP_SEGMENT GSO segment size
+ */
+static int stress_set_udp_gso(const char *opt)
+{
+	uint32_t udp_gso;
+
+	udp_gso = (uint32_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("udp-gso", (uint64_t)udp_gso,
+		MIN_UDP_GSO, MAX_UDP_GSO);
+	return stress_set_setting("udp-gso", TYPE_ID_UINT32, &udp_gso);
+}
+
+/*
+ *  stress_set_udp_txtime()
+ *	set SO_TXTIME pacing rate in packets per second
+ */
+static int stress_set_udp_txtime(const char *opt)
+{
+	uint32_t udp_txtime;
+
+	udp_txtime = stress_get_uint32(opt);
+	stress_check_range("udp-txtime", (uint64_t)udp_txtime,
+		MIN_UDP_TXTIME, MAX_UDP_TXTIME);
+	return stress_set_setting("udp-txtime", TYPE_ID_UINT32, &udp_txtime);
+}
+
 static int OPTIMIZE3 stress_udp_client(
 	stress_args_t *args,
 	const pid_t mypid,
@@ -441,6 +501,413 @@ die:
 	return rc;
 }
 
+#if defined(HAVE_SENDMMSG) &&	\
+    defined(HAVE_RECVMMSG)
+#define HAVE_UDP_BATCH
+
+#if defined(SO_TXTIME) &&		\
+    defined(SCM_TXTIME) &&		\
+    defined(HAVE_LINUX_NET_TSTAMP_H) &&	\
+    defined(CLOCK_MONOTONIC)
+#define HAVE_UDP_TXTIME
+#endif
+
+/*
+ *  per end totals in the batched datagram mode
+ */
+typedef struct {
+	double t_start;			/* wall clock start */
+	uint64_t packets;		/* wire sized datagrams */
+	uint64_t bytes;			/* payload bytes */
+	uint64_t syscalls;		/* sendmmsg/recvmmsg calls */
+} stress_udp_batch_t;
+
+/*
+ *  stress_udp_now_ns()
+ *	monotonic time in nanoseconds, the SO_TXTIME clock
+ */
+static inline uint64_t stress_udp_now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
+/*
+ *  stress_udp_batch_metrics()
+ *	report packets/s, Gbit/s and syscalls per packet for one end
+ */
+static void stress_udp_batch_metrics(
+	stress_args_t *args,
+	const size_t idx,
+	const char *end,
+	const char *call,
+	const stress_udp_batch_t *st)
+{
+	const double duration = stress_time_now() - st->t_start;
+	char str[64];
+
+	if ((duration <= 0.0) || (st->packets == 0))
+		return;
+
+	(void)snprintf(str, sizeof(str), "%s packets per sec", end);
+	stress_metrics_set(args, idx, str,
+		(double)st->packets / duration, STRESS_HARMONIC_MEAN);
+	(void)snprintf(str, sizeof(str), "%s Gbit per sec", end);
+	stress_metrics_set(args, idx + 1, str,
+		((double)st->bytes * 8.0) / (duration * 1.0E9), STRESS_HARMONIC_MEAN);
+	(void)snprintf(str, sizeof(str), "%s syscalls per packet", call);
+	stress_metrics_set(args, idx + 2, str,
+		(double)st->syscalls / (double)st->packets, STRESS_GEOMETRIC_MEAN);
+}
+
+/*
+ *  stress_udp_batch_client()
+ *	send batches of datagrams with sendmmsg, optionally as GSO
+ *	super-datagrams and paced with SO_TXTIME
+ */
+static int OPTIMIZE3 stress_udp_batch_client(
+	stress_args_t *args,
+	const pid_t mypid,
+	const int udp_domain,
+	const int udp_proto,
+	const int udp_port,
+	const char *udp_if,
+	const uint32_t udp_batch,
+	uint32_t udp_gso,
+	uint32_t udp_txtime)
+{
+	struct sockaddr *addr = NULL;
+	struct mmsghdr *msgvec;
+	struct iovec iov;
+	stress_udp_batch_t st;
+	const pid_t pid = getpid();
+	char *buf, *control = NULL;
+	size_t msg_size, seg_size, ctrl_size = 0, i;
+	uint32_t pkts_per_msg;
+	uint64_t t_next = 0, interval_ns = 0;
+	double t_report;
+	socklen_t len;
+	int fd, rc = EXIT_FAILURE;
+
+	stress_parent_died_alarm();
+	(void)sched_settings_apply(true);
+
+	buf = (char *)stress_mmap_populate(NULL, UDP_MSG_MAX,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED)
+		return EXIT_NO_RESOURCE;
+	msgvec = (struct mmsghdr *)calloc(udp_batch, sizeof(*msgvec));
+	if (!msgvec) {
+		(void)munmap((void *)buf, UDP_MSG_MAX);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if ((fd = socket(udp_domain, SOCK_DGRAM, udp_proto)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_msgvec;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			udp_domain, udp_port, udp_if,
+			&addr, &len, NET_ADDR_ANY) < 0) {
+		rc = EXIT_NO_RESOURCE;
+		goto close_fd;
+	}
+	if (connect(fd, addr, len) < 0) {
+		pr_fail("%s: connect failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto close_fd;
+	}
+
+#if defined(UDP_SEGMENT)
+	if (udp_gso) {
+		int val = (int)udp_gso;
+
+		if (setsockopt(fd, IPPROTO_UDP, UDP_SEGMENT, &val, sizeof(val)) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: cannot enable UDP_SEGMENT, errno=%d (%s), "
+					"sending without GSO\n", args->name, errno, strerror(errno));
+			udp_gso = 0;
+		}
+	}
+#else
+	udp_gso = 0;
+#endif
+#if defined(HAVE_UDP_TXTIME)
+	if (udp_txtime) {
+		struct sock_txtime txtime;
+
+		(void)shim_memset(&txtime, 0, sizeof(txtime));
+		txtime.clockid = CLOCK_MONOTONIC;
+		if (setsockopt(fd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: cannot enable SO_TXTIME, errno=%d (%s), "
+					"sending unpaced\n", args->name, errno, strerror(errno));
+			udp_txtime = 0;
+		}
+	}
+#else
+	udp_txtime = 0;
+#endif
+
+	if (udp_gso) {
+		pkts_per_msg = STRESS_MINIMUM(UDP_GSO_SEGS_MAX, UDP_MSG_MAX / udp_gso);
+		seg_size = udp_gso;
+		msg_size = (size_t)pkts_per_msg * seg_size;
+	} else {
+		pkts_per_msg = 1;
+		seg_size = UDP_BUF;
+		msg_size = UDP_BUF;
+	}
+
+	/* every wire packet carries the sender pid for the receiver to check */
+	(void)shim_memset(buf, stress_mwc8(), msg_size);
+	for (i = 0; i < msg_size; i += seg_size)
+		(void)shim_memcpy(buf + i, &pid, sizeof(pid));
+
+	iov.iov_base = buf;
+	iov.iov_len = msg_size;
+	if (udp_txtime) {
+		ctrl_size = CMSG_SPACE(sizeof(uint64_t));
+		control = (char *)calloc(udp_batch, ctrl_size);
+		if (!control) {
+			rc = EXIT_NO_RESOURCE;
+			goto close_fd;
+		}
+		interval_ns = (STRESS_NANOSECOND * pkts_per_msg) / udp_txtime;
+	}
+	for (i = 0; i < udp_batch; i++) {
+		msgvec[i].msg_hdr.msg_iov = &iov;
+		msgvec[i].msg_hdr.msg_iovlen = 1;
+		if (control) {
+			struct cmsghdr *cm;
+
+			msgvec[i].msg_hdr.msg_control = control + (i * ctrl_size);
+			msgvec[i].msg_hdr.msg_controllen = ctrl_size;
+			cm = CMSG_FIRSTHDR(&msgvec[i].msg_hdr);
+			cm->cmsg_level = SOL_SOCKET;
+			cm->cmsg_type = SCM_TXTIME;
+			cm->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+		}
+	}
+
+	(void)shim_memset(&st, 0, sizeof(st));
+	st.t_start = stress_time_now();
+	t_report = st.t_start + 1.0;
+	do {
+		int n;
+
+		if (control) {
+			const uint64_t now = stress_udp_now_ns();
+
+			/* launch times are spaced evenly, never in the past */
+			if (t_next < now)
+				t_next = now;
+			else if (t_next > now + UDP_TXTIME_AHEAD_NS)
+				(void)shim_nanosleep_uint64(t_next - now - UDP_TXTIME_AHEAD_NS);
+			for (i = 0; i < udp_batch; i++) {
+				const uint64_t t_send = t_next;
+
+				(void)shim_memcpy(CMSG_DATA(CMSG_FIRSTHDR(&msgvec[i].msg_hdr)),
+					&t_send, sizeof(t_send));
+				t_next += interval_ns;
+			}
+		}
+		n = sendmmsg(fd, msgvec, udp_batch, 0);
+		st.syscalls++;
+		if (UNLIKELY(n < 0)) {
+			if ((errno == EINTR) || (errno == ENETUNREACH))
+				break;
+			if ((errno == ENOBUFS) || (errno == ENOMEM) || (errno == ECONNREFUSED)) {
+				(void)shim_usleep(10000);
+				continue;
+			}
+			if (errno == EPERM) {
+				(void)shim_usleep(250000);
+				continue;
+			}
+			pr_fail("%s: sendmmsg on port %d failed, errno=%d (%s)\n",
+				args->name, udp_port, errno, strerror(errno));
+			goto free_control;
+		}
+		st.packets += (uint64_t)n * pkts_per_msg;
+		st.bytes += (uint64_t)n * msg_size;
+
+		/* the receiver kills the sender when done, so report as we go */
+		if (UNLIKELY(stress_time_now() >= t_report)) {
+			stress_udp_batch_metrics(args, 3, "sent", "send", &st);
+			t_report += 1.0;
+		}
+	} while (stress_continue(args));
+	stress_udp_batch_metrics(args, 3, "sent", "send", &st);
+	rc = EXIT_SUCCESS;
+
+free_control:
+	free(control);
+close_fd:
+	(void)close(fd);
+free_msgvec:
+	free(msgvec);
+	(void)munmap((void *)buf, UDP_MSG_MAX);
+	return rc;
+}
+
+/*
+ *  stress_udp_batch_server()
+ *	receive batches of datagrams with recvmmsg, with UDP_GRO a
+ *	datagram may hold several coalesced wire packets
+ */
+static int OPTIMIZE3 stress_udp_batch_server(
+	stress_args_t *args,
+	const pid_t mypid,
+	const pid_t client_pid,
+	const int udp_domain,
+	const int udp_proto,
+	const int udp_port,
+	const bool udp_gro,
+	const char *udp_if,
+	const uint32_t udp_batch)
+{
+	struct sockaddr *addr = NULL;
+	struct mmsghdr *msgvec;
+	struct iovec *iovs;
+	stress_udp_batch_t st;
+	char *bufs, *control;
+	const size_t bufs_size = (size_t)udp_batch * UDP_MSG_MAX;
+	const size_t ctrl_size = CMSG_SPACE(sizeof(int));
+	socklen_t addr_len = 0;
+	int fd = -1, rcvbuf = 4 * MB, so_reuseaddr = 1, rc = EXIT_FAILURE;
+	uint32_t i;
+
+	bufs = (char *)stress_mmap_populate(NULL, bufs_size,
+			PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (bufs == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate %zu byte receive buffers, skipping stressor\n",
+			args->name, bufs_size);
+		return EXIT_NO_RESOURCE;
+	}
+	msgvec = (struct mmsghdr *)calloc(udp_batch, sizeof(*msgvec));
+	iovs = (struct iovec *)calloc(udp_batch, sizeof(*iovs));
+	control = (char *)calloc(udp_batch, ctrl_size);
+	if (!msgvec || !iovs || !control) {
+		rc = EXIT_NO_RESOURCE;
+		goto free_bufs;
+	}
+
+	if (stress_sig_stop_stressing(args->name, SIGALRM) < 0)
+		goto free_bufs;
+	if ((fd = socket(udp_domain, SOCK_DGRAM, udp_proto)) < 0) {
+		pr_fail("%s: socket failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_bufs;
+	}
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			udp_domain, udp_port, udp_if,
+			&addr, &addr_len, NET_ADDR_ANY) < 0)
+		goto free_bufs;
+	(void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &so_reuseaddr, sizeof(so_reuseaddr));
+	/* best effort, a deeper receive queue drops fewer batches */
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	if (bind(fd, addr, addr_len) < 0) {
+		pr_fail("%s: bind failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto free_bufs;
+	}
+#if defined(UDP_GRO)
+	if (udp_gro) {
+		int val = 1;
+
+		VOID_RET(int, setsockopt(fd, udp_proto, UDP_GRO, &val, sizeof(val)));
+	}
+#else
+	(void)udp_gro;
+#endif
+
+	(void)shim_memset(&st, 0, sizeof(st));
+	st.t_start = stress_time_now();
+	do {
+		int j, n, flags = 0;
+
+		for (i = 0; i < udp_batch; i++) {
+			iovs[i].iov_base = bufs + ((size_t)i * UDP_MSG_MAX);
+			iovs[i].iov_len = UDP_MSG_MAX;
+			(void)shim_memset(&msgvec[i].msg_hdr, 0, sizeof(msgvec[i].msg_hdr));
+			msgvec[i].msg_hdr.msg_iov = &iovs[i];
+			msgvec[i].msg_hdr.msg_iovlen = 1;
+			msgvec[i].msg_hdr.msg_control = control + (i * ctrl_size);
+			msgvec[i].msg_hdr.msg_controllen = ctrl_size;
+		}
+#if defined(MSG_WAITFORONE)
+		flags = MSG_WAITFORONE;
+#endif
+		n = recvmmsg(fd, msgvec, udp_batch, flags, NULL);
+		st.syscalls++;
+		if (UNLIKELY(n <= 0)) {
+			if (n == 0)
+				break;
+			if (errno == ENOBUFS) {
+				(void)shim_usleep(10000);
+				continue;
+			}
+			if (errno != EINTR) {
+				pr_fail("%s: recvmmsg failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				goto free_bufs;
+			}
+			break;
+		}
+		for (j = 0; j < n; j++) {
+			const size_t msg_len = msgvec[j].msg_len;
+			const char *buf = (const char *)iovs[j].iov_base;
+			uint64_t pkts = 1;
+			pid_t pid;
+#if defined(UDP_GRO)
+			struct cmsghdr *cm;
+
+			for (cm = CMSG_FIRSTHDR(&msgvec[j].msg_hdr); cm; cm = CMSG_NXTHDR(&msgvec[j].msg_hdr, cm)) {
+				if ((cm->cmsg_level == IPPROTO_UDP) && (cm->cmsg_type == UDP_GRO)) {
+					int gso_size;
+
+					(void)shim_memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+					if (gso_size > 0)
+						pkts = (msg_len + (size_t)gso_size - 1) / (size_t)gso_size;
+				}
+			}
+#endif
+			(void)shim_memcpy(&pid, buf, sizeof(pid));
+			if (UNLIKELY(pid != client_pid)) {
+				pr_fail("%s: server received unexpected data "
+					"contents, got 0x%" PRIxMAX ", "
+					"expected 0x%" PRIxMAX "\n",
+					args->name, (intmax_t)pid,
+					(intmax_t)client_pid);
+				goto free_bufs;
+			}
+			st.packets += pkts;
+			st.bytes += msg_len;
+			stress_bogo_add(args, pkts);
+		}
+	} while (stress_continue(args));
+	stress_udp_batch_metrics(args, 0, "received", "recv", &st);
+	rc = EXIT_SUCCESS;
+
+free_bufs:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (fd >= 0)
+		(void)close(fd);
+	free(control);
+	free(iovs);
+	free(msgvec);
+	(void)munmap((void *)bufs, bufs_size);
+	return rc;
+}
+#endif
+
 /*
  *  stress_udp
  *	stress by heavy udp ops
@@ -457,6 +924,7 @@ static int stress_udp(stress_args_t *args)
 #endif
 	bool udp_gro = false;
 	char *udp_if = NULL;
+	uint32_t udp_batch = 0, udp_gso = 0, udp_txtime = 0;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -464,6 +932,19 @@ static int stress_udp(stress_args_t *args)
 	(void)stress_get_setting("udp-if", &udp_if);
 	(void)stress_get_setting("udp-port", &udp_port);
 	(void)stress_get_setting("udp-domain", &udp_domain);
+	(void)stress_get_setting("udp-batch", &udp_batch);
+	(void)stress_get_setting("udp-gso", &udp_gso);
+	(void)stress_get_setting("udp-txtime", &udp_txtime);
+#if defined(HAVE_UDP_BATCH)
+	/* GSO and pacing go through the batched sendmmsg path */
+	if ((udp_batch == 0) && (udp_gso || udp_txtime))
+		udp_batch = 1;
+#else
+	if ((udp_batch || udp_gso || udp_txtime) && (args->instance == 0))
+		pr_inf("%s: sendmmsg and recvmmsg are not available, ignoring "
+			"--udp-batch, --udp-gso and --udp-txtime\n", args->name);
+	udp_batch = 0;
+#endif
 #if defined(IPPROTO_UDPLITE)
 	(void)stress_get_setting("udp-lite", &udp_lite);
 
@@ -517,12 +998,24 @@ again:
 		return EXIT_FAILURE;
 	} else if (pid == 0) {
 		(void)stress_change_cpu(args, parent_cpu);
-		rc = stress_udp_client(args, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
+#if defined(HAVE_UDP_BATCH)
+		if (udp_batch)
+			rc = stress_udp_batch_client(args, mypid, udp_domain, udp_proto, udp_port,
+				udp_if, udp_batch, udp_gso, udp_txtime);
+		else
+#endif
+			rc = stress_udp_client(args, mypid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
 		_exit(rc);
 	} else {
 		int status;
 
-		rc = stress_udp_server(args, mypid, pid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
+#if defined(HAVE_UDP_BATCH)
+		if (udp_batch)
+			rc = stress_udp_batch_server(args, mypid, pid, udp_domain, udp_proto, udp_port,
+				udp_gro, udp_if, udp_batch);
+		else
+#endif
+			rc = stress_udp_server(args, mypid, pid, udp_domain, udp_proto, udp_port, udp_gro, udp_if);
 		(void)stress_kill_pid_wait(pid, &status);
 		if (WIFEXITED(status))
 			if (WEXITSTATUS(status) != EXIT_SUCCESS)
@@ -532,11 +1025,14 @@ again:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_udp_batch,	stress_set_udp_batch },
 	{ OPT_udp_domain,	stress_set_udp_domain },
 	{ OPT_udp_port,		stress_set_udp_port },
 	{ OPT_udp_lite,		stress_set_udp_lite },
 	{ OPT_udp_gro,		stress_set_udp_gro },
+	{ OPT_udp_gso,		stress_set_udp_gso },
 	{ OPT_udp_if,		stress_set_udp_if },
+	{ OPT_udp_txtime,	stress_set_udp_txtime },
 	{ 0,			NULL }
 };
 
@@ -20,7 +20,9 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-latency.h"
 #include "core-out-of-memory.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
@@ -42,12 +44,35 @@ UNEXPECTED
 #define MAX_USERFAULT_BYTES	(MAX_MEM_LIMIT)
 #define DEFAULT_USERFAULT_BYTES	(256 * MB)
 
+#define MIN_USERFAULT_HANDLERS	(1)
+#define MAX_USERFAULT_HANDLERS	(64)
+#define DEFAULT_USERFAULT_HANDLERS (1)
+
+#define MIN_USERFAULT_BATCH	(1)
+#define MAX_USERFAULT_BATCH	(512)
+#define DEFAULT_USERFAULT_BATCH	(1)
+
+#define USERFAULT_MODE_MISSING	(0)	/* UFFDIO_COPY / UFFDIO_ZEROPAGE */
+#define USERFAULT_MODE_WP	(1)	/* UFFDIO_WRITEPROTECT */
+#define USERFAULT_MODE_MINOR	(2)	/* shmem UFFDIO_CONTINUE */
+
+
 static const stress_help_t help[] = {
 	{ NULL,	"userfaultfd N",	"start N page faulting workers with userspace handling" },
+	{ NULL,	"userfaultfd-batch N",	"resolve up to N pages per fault" },
+	{ NULL,	"userfaultfd-bytes N",	"size of mmap'd region to page fault on" },
+	{ NULL,	"userfaultfd-handlers N", "use N fault handler threads and N faulting children" },
+	{ NULL,	"userfaultfd-mode M",	"fault mode: missing, wp (write-protect) or minor (shmem)" },
 	{ NULL,	"userfaultfd-ops N",	"stop after N page faults have been handled" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const char * const userfaultfd_modes[] = {
+	"missing",
+	"wp",
+	"minor",
+};
+
 #if defined(HAVE_USERFAULTFD) && 	 \
     defined(HAVE_LINUX_USERFAULTFD_H) && \
     defined(HAVE_POLL_H) &&		 \
@@ -56,13 +81,16 @@ static const stress_help_t help[] = {
 #define STACK_SIZE	(64 * 1024)
 #define COUNT_MAX	(256)
 
-/* Context for clone */
+/* Context for clone, one per faulting child */
 typedef struct {
 	stress_args_t *args;
-	uint8_t *data;
+	uint8_t *data;			/* start of the child's slice */
 	size_t page_size;
-	size_t sz;
+	size_t sz;			/* size of the child's slice */
 	pid_t parent;
+	int fd;				/* userfaultfd */
+	size_t mode;			/* USERFAULT_MODE_* */
+	volatile double fault_time;	/* time of the latest page touch */
 } stress_context_t;
 
 #endif
@@ -77,8 +105,48 @@ static int stress_set_userfaultfd_bytes(const char *opt)
 	return stress_set_setting("userfaultfd-bytes", TYPE_ID_SIZE_T, &userfaultfd_bytes);
 }
 
+static int stress_set_userfaultfd_batch(const char *opt)
+{
+	size_t userfaultfd_batch;
+
+	userfaultfd_batch = (size_t)stress_get_uint64(opt);
+	stress_check_range("userfaultfd-batch", (uint64_t)userfaultfd_batch,
+		MIN_USERFAULT_BATCH, MAX_USERFAULT_BATCH);
+	return stress_set_setting("userfaultfd-batch", TYPE_ID_SIZE_T, &userfaultfd_batch);
+}
+
+static int stress_set_userfaultfd_handlers(const char *opt)
+{
+	size_t userfaultfd_handlers;
+
+	userfaultfd_handlers = (size_t)stress_get_uint64(opt);
+	stress_check_range("userfaultfd-handlers", (uint64_t)userfaultfd_handlers,
+		MIN_USERFAULT_HANDLERS, MAX_USERFAULT_HANDLERS);
+	return stress_set_setting("userfaultfd-handlers", TYPE_ID_SIZE_T, &userfaultfd_handlers);
+}
+
+static int stress_set_userfaultfd_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(userfaultfd_modes); i++) {
+		if (!strcmp(userfaultfd_modes[i], opt))
+			return stress_set_setting("userfaultfd-mode", TYPE_ID_SIZE_T, &i);
+	}
+
+	(void)fprintf(stderr, "userfaultfd-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(userfaultfd_modes); i++)
+		(void)fprintf(stderr, " %s", userfaultfd_modes[i]);
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_userfaultfd_batch,	stress_set_userfaultfd_batch },
 	{ OPT_userfaultfd_bytes,	stress_set_userfaultfd_bytes },
+	{ OPT_userfaultfd_handlers,	stress_set_userfaultfd_handlers },
+	{ OPT_userfaultfd_mode,		stress_set_userfaultfd_mode },
 	{ 0,				NULL }
 };
 
@@ -92,6 +160,30 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 #define STRESS_USERFAULT_SUPPORTED_CHECK_ALWAYS	(STRESS_USERFAULT_REPORT_ALWAYS |	\
 						 STRESS_USERFAULT_SUPPORTED_CHECK)
 
+/* Fault handler state, one per handler thread */
+typedef struct {
+	stress_args_t *args;
+	int fd;				/* userfaultfd */
+	bool do_poll;			/* poll before read */
+	uint8_t *data;			/* whole faulting region */
+	size_t sz;			/* size of whole region */
+	stress_context_t *c;		/* faulting children contexts */
+	size_t n_children;		/* number of faulting children */
+	void *src;			/* batch sized UFFDIO_COPY source */
+	size_t batch;			/* pages to resolve per fault */
+	size_t mode;			/* USERFAULT_MODE_* */
+	volatile bool *stop;		/* set to stop handler threads */
+	uint64_t faults;		/* faults resolved */
+	uint64_t pages;			/* pages resolved */
+	double duration;		/* time spent handling faults */
+	stress_latency_t *lat;		/* fault to resolve latency */
+	int rc;				/* handler return status */
+#if defined(HAVE_LIB_PTHREAD)
+	pthread_t pthread;		/* handler thread */
+	int ret;			/* pthread_create return */
+#endif
+} stress_userfaultfd_handler_t;
+
 /*
  *  stress_userfaultfd_error()
  *	convert errno into stress-ng return error code and report
@@ -146,14 +238,22 @@ static int stress_userfaultfd_supported(const char *name)
 	return -1;
 }
 
+static pid_t stress_userfaultfd_pid;	/* pid of the fault handling parent */
+
 /*
  *  stress_child_alarm_handler()
- *	SIGALRM handler to terminate child immediately
+ *	SIGALRM handler to terminate child immediately, the handler
+ *	is shared with the parent (CLONE_SIGHAND) so the parent just
+ *	stops and reports rather than exiting
  */
-static void MLOCKED_TEXT NORETURN stress_child_alarm_handler(int signum)
+static void MLOCKED_TEXT stress_child_alarm_handler(int signum)
 {
 	(void)signum;
 
+	if (getpid() == stress_userfaultfd_pid) {
+		stress_continue_set_flag(false);
+		return;
+	}
 	_exit(0);
 }
 
@@ -176,15 +276,38 @@ static int stress_userfaultfd_clone(void *arg)
 		register uint8_t *ptr;
 		register const uint8_t *end = c->data + c->sz;
 
-		/* hint we don't need these pages */
-		if (shim_madvise(c->data, c->sz, MADV_DONTNEED) < 0) {
-			pr_fail("%s: madvise failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			return -1;
+#if defined(UFFDIO_WRITEPROTECT) &&	\
+    defined(UFFDIO_WRITEPROTECT_MODE_WP)
+		if (c->mode == USERFAULT_MODE_WP) {
+			struct uffdio_writeprotect wp;
+
+			/* write protect the pages so writes fault */
+			wp.range.start = (unsigned long)c->data;
+			wp.range.len = c->sz;
+			wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+			if (ioctl(c->fd, UFFDIO_WRITEPROTECT, &wp) < 0) {
+				pr_fail("%s: ioctl UFFDIO_WRITEPROTECT failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+		} else
+#endif
+		{
+			/*
+			 *  hint we don't need these pages, for shmem the
+			 *  page cache pages remain so the faults are minor
+			 */
+			if (shim_madvise(c->data, c->sz, MADV_DONTNEED) < 0) {
+				pr_fail("%s: madvise failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
 		}
 		/* and trigger some page faults */
-		for (ptr = c->data; ptr < end; ptr += c->page_size)
+		for (ptr = c->data; ptr < end; ptr += c->page_size) {
+			c->fault_time = stress_time_now();
 			*ptr = 0xff;
+		}
 	} while (stress_continue(args));
 
 	return 0;
@@ -192,49 +315,316 @@ static int stress_userfaultfd_clone(void *arg)
 
 /*
  *  handle_page_fault()
- *	handle a write page fault caused by child
+ *	handle a write page fault caused by a child, resolving up to
+ *	batch pages of the child's slice from the faulting page onwards.
+ *	Returns the number of pages resolved or -1 on failure.
  */
-static inline int handle_page_fault(
-	stress_args_t *args,
-	const int fd,
+static inline long handle_page_fault(
+	stress_userfaultfd_handler_t *h,
 	uint8_t *addr,
-	void *zero_page,
-	const uint8_t *data_start,
-	const uint8_t *data_end,
-	const size_t page_size)
+	stress_context_t *c)
 {
-	if ((addr < data_start) || (addr >= data_end)) {
-		pr_fail("%s: page fault address is out of range\n", args->name);
-		return -1;
+	stress_args_t *args = h->args;
+	const size_t page_size = args->page_size;
+	uint8_t *page = (uint8_t *)((uintptr_t)addr & ~((uintptr_t)page_size - 1));
+	const size_t len = STRESS_MINIMUM(h->batch * page_size, (size_t)((c->data + c->sz) - page));
+	struct uffdio_range wake;
+	long pages = (long)(len / page_size);
+
+	switch (h->mode) {
+#if defined(UFFDIO_WRITEPROTECT)
+	case USERFAULT_MODE_WP: {
+			struct uffdio_writeprotect wp;
+
+			/* remove write protection, this also wakes the faulting child */
+			wp.range.start = (unsigned long)page;
+			wp.range.len = len;
+			wp.mode = 0;
+			if (ioctl(h->fd, UFFDIO_WRITEPROTECT, &wp) < 0) {
+				pr_fail("%s: page fault ioctl UFFDIO_WRITEPROTECT failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+		}
+		break;
+#endif
+#if defined(UFFDIO_CONTINUE)
+	case USERFAULT_MODE_MINOR: {
+			struct uffdio_continue cont;
+
+			/* map the existing shmem page cache pages */
+			cont.range.start = (unsigned long)page;
+			cont.range.len = len;
+			cont.mode = 0;
+			cont.mapped = 0;
+			if (ioctl(h->fd, UFFDIO_CONTINUE, &cont) < 0) {
+				if (errno != EEXIST) {
+					pr_fail("%s: page fault ioctl UFFDIO_CONTINUE failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					return -1;
+				}
+				/* part of the range was already mapped */
+				pages = (cont.mapped > 0) ? (long)((size_t)cont.mapped / page_size) : 0;
+			}
+		}
+		break;
+#endif
+	default:
+		if (stress_mwc32() & 1) {
+			struct uffdio_copy copy;
+
+			copy.copy = 0;
+			copy.mode = 0;
+			copy.dst = (unsigned long)page;
+			copy.src = (unsigned long)h->src;
+			copy.len = len;
+
+			if (ioctl(h->fd, UFFDIO_COPY, &copy) < 0) {
+				if (errno != EEXIST) {
+					pr_fail("%s: page fault ioctl UFFDIO_COPY failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					return -1;
+				}
+				pages = (copy.copy > 0) ? (long)((size_t)copy.copy / page_size) : 0;
+			}
+		} else {
+			struct uffdio_zeropage zeropage;
+
+			zeropage.range.start = (unsigned long)page;
+			zeropage.range.len = len;
+			zeropage.mode = 0;
+			zeropage.zeropage = 0;
+			if (ioctl(h->fd, UFFDIO_ZEROPAGE, &zeropage) < 0) {
+				if (errno != EEXIST) {
+					pr_fail("%s: page fault ioctl UFFDIO_ZEROPAGE failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					return -1;
+				}
+				pages = (zeropage.zeropage > 0) ? (long)((size_t)zeropage.zeropage / page_size) : 0;
+			}
+		}
+		break;
 	}
 
-	if (stress_mwc32() & 1) {
-		struct uffdio_copy copy;
+	/* wake the faulting child in case it raced with a partial resolve */
+	(void)shim_memset(&wake, 0, sizeof(wake));
+	wake.start = (uintptr_t)page;
+	wake.len = page_size;
+	VOID_RET(int, ioctl(h->fd, UFFDIO_WAKE, &wake));
 
-		copy.copy = 0;
-		copy.mode = 0;
-		copy.dst = (unsigned long)addr;
-		copy.src = (unsigned long)zero_page;
-		copy.len = page_size;
+	return pages;
+}
 
-		if (ioctl(fd, UFFDIO_COPY, &copy) < 0) {
-			pr_fail("%s: page fault ioctl UFFDIO_COPY failed, errno=%d (%s)\n",
-				args->name, errno, strerror(errno));
-			return -1;
+/*
+ *  stress_userfaultfd_lat()
+ *	add the time from t_start to t_end to a latency histogram
+ */
+static inline void stress_userfaultfd_lat(stress_latency_t *lat, const double t_start, const double t_end)
+{
+	const uint64_t ns = (t_end > t_start) ? (uint64_t)((t_end - t_start) * STRESS_DBL_NANOSECOND) : 0;
+
+	stress_latency_add(lat, ns);
+}
+
+/*
+ *  stress_userfaultfd_handle()
+ *	read and resolve page faults until told to stop, the
+ *	main handler (with no stop flag) also accounts the
+ *	bogo ops of all the handlers
+ */
+static int stress_userfaultfd_handle(
+	stress_userfaultfd_handler_t *h,
+	stress_userfaultfd_handler_t *handlers,
+	const size_t n_handlers)
+{
+	stress_args_t *args = h->args;
+	const pid_t self = getpid();
+	const int timeout = h->stop ? 100 : 1000;
+	uint64_t accounted = 0;
+	int count = 0;
+
+	for (;;) {
+		struct uffd_msg msg;
+		ssize_t ret;
+		uint8_t *addr;
+		size_t idx;
+		long pages;
+		double t, t_fault;
+
+		if (h->stop) {
+			if (*h->stop)
+				break;
+		} else {
+			size_t i;
+			uint64_t total = 0;
+
+			/* main handler, account all the handlers bogo ops */
+			for (i = 0; i < n_handlers; i++)
+				total += handlers[i].faults;
+			if (total > accounted) {
+				stress_bogo_add(args, total - accounted);
+				accounted = total;
+			}
+			if (!stress_continue(args))
+				break;
 		}
-	} else {
-		struct uffdio_zeropage zeropage;
-
-		zeropage.range.start = (unsigned long)addr;
-		zeropage.range.len = page_size;
-		zeropage.mode = 0;
-		if (ioctl(fd, UFFDIO_ZEROPAGE, &zeropage) < 0) {
-			pr_fail("%s: page fault ioctl UFFDIO_ZEROPAGE failed, errno=%d (%s)\n",
+
+		/* check we should break out before we block on the read */
+		if (!stress_continue_flag())
+			break;
+
+		t = stress_time_now();
+		/*
+		 * polled wait exercises userfaultfd_poll
+		 * in the kernel, but only works if fd is NONBLOCKing
+		 */
+		if (h->do_poll) {
+			struct pollfd fds[1];
+
+			(void)shim_memset(fds, 0, sizeof fds);
+			fds[0].fd = h->fd;
+			fds[0].events = POLLIN;
+
+			ret = poll(fds, 1, timeout);
+			if (ret == 0)
+				continue;	/* timed out, redo the poll */
+			if (ret < 0) {
+				if (errno == EINTR)
+					continue;
+				if (errno != ENOMEM) {
+					pr_fail("%s: poll failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					if (!stress_continue_flag())
+						break;
+				}
+				/*
+				 *  poll ran out of free space for internal
+				 *  fd tables, so give up and block on the
+				 *  read anyway
+				 */
+				goto do_read;
+			}
+			/* No data, re-poll */
+			if (!(fds[0].revents & POLLIN))
+				continue;
+
+			if (UNLIKELY(count++ >= COUNT_MAX)) {
+				(void)stress_read_fdinfo(self, h->fd);
+				count = 0;
+			}
+		}
+
+do_read:
+		ret = read(h->fd, &msg, sizeof(msg));
+		if (ret < 0) {
+			/* another handler may have read the message */
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			pr_fail("%s: read failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
-			return -1;
+			if (!stress_continue_flag())
+				break;
+			continue;
+		}
+		/* We only expect a page fault event */
+		if (msg.event != UFFD_EVENT_PAGEFAULT) {
+			pr_fail("%s: msg event not a pagefault event\n", args->name);
+			continue;
+		}
+		/* We only expect a write fault */
+		if (!(msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE)) {
+			pr_fail("%s: msg event not write page fault event\n", args->name);
+			continue;
+		}
+		addr = (uint8_t *)(intptr_t)msg.arg.pagefault.address;
+		if ((addr < h->data) || (addr >= h->data + h->sz)) {
+			pr_fail("%s: page fault address is out of range\n", args->name);
+			h->rc = EXIT_FAILURE;
+			break;
+		}
+		idx = STRESS_MINIMUM((size_t)(addr - h->data) / h->c[0].sz, h->n_children - 1);
+		t_fault = h->c[idx].fault_time;
+
+		/* Go handle the page fault */
+		pages = handle_page_fault(h, addr, &h->c[idx]);
+		if (pages < 0) {
+			h->rc = EXIT_FAILURE;
+			break;
 		}
+		stress_userfaultfd_lat(h->lat, t_fault, stress_time_now());
+		h->duration += stress_time_now() - t;
+		h->pages += (uint64_t)pages;
+		h->faults++;
+	}
+	return h->rc;
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_userfaultfd_handler()
+ *	extra fault handler thread
+ */
+static void *stress_userfaultfd_handler(void *arg)
+{
+	static void *nowt = NULL;
+	stress_userfaultfd_handler_t *h = (stress_userfaultfd_handler_t *)arg;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	(void)stress_userfaultfd_handle(h, NULL, 0);
+
+	return &nowt;
+}
+#endif
+
+/*
+ *  stress_userfaultfd_report()
+ *	merge the handler statistics and report the resolve rates
+ *	and the fault to resolve latency percentiles
+ */
+static void stress_userfaultfd_report(
+	stress_args_t *args,
+	const stress_userfaultfd_handler_t *handlers,
+	const size_t n_handlers,
+	const double duration)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	stress_latency_t *lat = handlers[0].lat;
+	uint64_t faults = 0, pages = 0;
+	double handle_duration = 0.0, rate;
+	size_t i, metric = 0;
+
+	/* merge the handler latencies into the main handler's histogram */
+	for (i = 0; i < n_handlers; i++) {
+		faults += handlers[i].faults;
+		pages += handlers[i].pages;
+		handle_duration += handlers[i].duration;
+		if (i > 0)
+			stress_latency_merge(lat, handlers[i].lat);
+	}
+
+	rate = (faults > 0) ? handle_duration / (double)faults : 0.0;
+	stress_metrics_set(args, metric++, "nanosecs per page fault",
+		rate * STRESS_DBL_NANOSECOND, STRESS_HARMONIC_MEAN);
+	rate = (duration > 0.0) ? (double)faults / duration : 0.0;
+	stress_metrics_set(args, metric++, "faults resolved per sec", rate, STRESS_GEOMETRIC_MEAN);
+	rate = (duration > 0.0) ? (double)pages / duration : 0.0;
+	stress_metrics_set(args, metric++, "pages resolved per sec", rate, STRESS_GEOMETRIC_MEAN);
+	if (faults == 0)
+		return;
+	for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+		char msg[64];
+
+		(void)snprintf(msg, sizeof(msg), "fault to resolve latency p%g (ns)", percentiles[i]);
+		stress_metrics_set(args, metric++, msg,
+			(double)stress_latency_percentile(lat, percentiles[i]), STRESS_GEOMETRIC_MEAN);
 	}
-	return 0;
 }
 
 /*
@@ -246,28 +636,32 @@ static inline int handle_page_fault(
 static int stress_userfaultfd_child(stress_args_t *args, void *context)
 {
 	const size_t page_size = args->page_size;
-	size_t sz;
+	size_t sz, slice, i, n_handlers = DEFAULT_USERFAULT_HANDLERS, started = 0;
 	uint8_t *data;
-	void *zero_page = NULL;
-	int fd = -1, rc = EXIT_SUCCESS, count = 0;
+	uint8_t *stacks = MAP_FAILED;
+	void *src = NULL;
+	int fd = -1, rc = EXIT_SUCCESS;
 	const unsigned int uffdio_copy = 1 << _UFFDIO_COPY;
 	const unsigned int uffdio_zeropage = 1 << _UFFDIO_ZEROPAGE;
-	pid_t pid;
+	uint64_t features = 0, reg_mode = UFFDIO_REGISTER_MODE_MISSING, reg_ioctls;
+	pid_t pids[MAX_USERFAULT_HANDLERS];
 	const pid_t self = getpid();
 	struct uffdio_api api;
 	struct uffdio_register reg;
-	stress_context_t c;
+	stress_context_t c[MAX_USERFAULT_HANDLERS];
+	stress_userfaultfd_handler_t handlers[MAX_USERFAULT_HANDLERS];
+	stress_latency_t *lats;
 	bool do_poll = true;
-	static uint8_t stack[STACK_SIZE]; /* Child clone stack */
-	uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)stack, STACK_SIZE);
+	volatile bool stop = false;
 	size_t userfaultfd_bytes = DEFAULT_USERFAULT_BYTES;
-	double t, duration = 0.0, rate;
+	size_t userfaultfd_batch = DEFAULT_USERFAULT_BATCH;
+	size_t userfaultfd_mode = USERFAULT_MODE_MISSING;
+	double t;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
 	(void)context;
-	(void)shim_memset(stack, 0, sizeof(stack));
 
 	if (!stress_get_setting("userfaultfd-bytes", &userfaultfd_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -275,26 +669,91 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			userfaultfd_bytes = MIN_USERFAULT_BYTES;
 	}
+	(void)stress_get_setting("userfaultfd-batch", &userfaultfd_batch);
+	(void)stress_get_setting("userfaultfd-handlers", &n_handlers);
+	(void)stress_get_setting("userfaultfd-mode", &userfaultfd_mode);
+#if !defined(HAVE_LIB_PTHREAD)
+	if (n_handlers > 1) {
+		if (args->instance == 0)
+			pr_inf("%s: --userfaultfd-handlers needs pthread support, using 1 handler\n",
+				args->name);
+		n_handlers = 1;
+	}
+#endif
+
 	userfaultfd_bytes /= args->num_instances;
 	if (userfaultfd_bytes < MIN_USERFAULT_BYTES)
 		userfaultfd_bytes = MIN_USERFAULT_BYTES;
 	if (userfaultfd_bytes < args->page_size)
 		userfaultfd_bytes = args->page_size;
 
+	/* each faulting child gets an equal page aligned slice */
 	sz = userfaultfd_bytes & ~(page_size - 1);
+	n_handlers = STRESS_MINIMUM(n_handlers, sz / page_size);
+	slice = ((sz / page_size) / n_handlers) * page_size;
+	sz = slice * n_handlers;
+
+	switch (userfaultfd_mode) {
+	case USERFAULT_MODE_WP:
+#if defined(UFFD_FEATURE_PAGEFAULT_FLAG_WP) &&	\
+    defined(UFFDIO_REGISTER_MODE_WP) &&		\
+    defined(UFFDIO_WRITEPROTECT)
+		features = UFFD_FEATURE_PAGEFAULT_FLAG_WP;
+		reg_mode = UFFDIO_REGISTER_MODE_WP;
+		break;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: write-protect mode not supported, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	case USERFAULT_MODE_MINOR:
+#if defined(UFFD_FEATURE_MINOR_SHMEM) &&	\
+    defined(UFFDIO_REGISTER_MODE_MINOR) &&	\
+    defined(UFFDIO_CONTINUE)
+		features = UFFD_FEATURE_MINOR_SHMEM;
+		reg_mode = UFFDIO_REGISTER_MODE_MINOR;
+		break;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: minor fault mode not supported, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+#endif
+	default:
+		break;
+	}
 
-	if (posix_memalign(&zero_page, page_size, page_size)) {
+	if (posix_memalign(&src, page_size, page_size * userfaultfd_batch)) {
 		pr_err("%s: zero page allocation failed\n", args->name);
 		return EXIT_NO_RESOURCE;
 	}
+	(void)shim_memset(src, 0, page_size * userfaultfd_batch);
+	lats = (stress_latency_t *)calloc(n_handlers, sizeof(*lats));
+	if (!lats) {
+		pr_err("%s: latency histogram allocation failed\n", args->name);
+		free(src);
+		return EXIT_NO_RESOURCE;
+	}
 
+	/* minor faults need shmem page cache pages that stay resident */
 	data = mmap(NULL, sz, PROT_READ | PROT_WRITE,
-		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		((userfaultfd_mode == USERFAULT_MODE_MINOR) ? MAP_SHARED : MAP_PRIVATE) |
+		MAP_ANONYMOUS, -1, 0);
 	if (data == MAP_FAILED) {
 		rc = EXIT_NO_RESOURCE;
 		pr_err("%s: mmap failed\n", args->name);
 		goto free_zeropage;
 	}
+	/* write-protect and minor faults need populated pages */
+	if (userfaultfd_mode != USERFAULT_MODE_MISSING)
+		(void)shim_memset(data, 0xff, sz);
+
+	stacks = (uint8_t *)mmap(NULL, STACK_SIZE * n_handlers, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (stacks == MAP_FAILED) {
+		rc = EXIT_NO_RESOURCE;
+		pr_err("%s: mmap of child stacks failed\n", args->name);
+		goto unmap_data;
+	}
 
 	/* Exercise invalid flags */
 	fd = shim_userfaultfd(~0);
@@ -315,8 +774,16 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 	/* API sanity check */
 	(void)shim_memset(&api, 0, sizeof(api));
 	api.api = UFFD_API;
-	api.features = 0;
+	api.features = features;
 	if (ioctl(fd, UFFDIO_API, &api) < 0) {
+		if (features) {
+			if (args->instance == 0)
+				pr_inf_skip("%s: ioctl UFFDIO_API does not support %s mode, errno=%d (%s), "
+					"skipping stressor\n", args->name,
+					userfaultfd_modes[userfaultfd_mode], errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto unmap_data;
+		}
 		pr_fail("%s: ioctl UFFDIO_API failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		rc = EXIT_FAILURE;
@@ -333,7 +800,7 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 	(void)shim_memset(&reg, 0, sizeof(reg));
 	reg.range.start = (unsigned long)data;
 	reg.range.len = sz;
-	reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+	reg.mode = reg_mode;
 	if (ioctl(fd, UFFDIO_REGISTER, &reg) < 0) {
 		pr_fail("%s: ioctl UFFDIO_REGISTER failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
@@ -341,138 +808,131 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 		goto unmap_data;
 	}
 
-	/* OK, so do we have copy supported? */
-	if ((reg.ioctls & uffdio_copy) != uffdio_copy) {
-		pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_COPY\n",
-			args->name);
-		rc = EXIT_FAILURE;
-		goto unmap_data;
-	}
-	/* OK, so do we have zeropage supported? */
-	if ((reg.ioctls & uffdio_zeropage) != uffdio_zeropage) {
-		pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_ZEROPAGE\n",
-			args->name);
-		rc = EXIT_FAILURE;
-		goto unmap_data;
+	reg_ioctls = reg.ioctls;
+	switch (userfaultfd_mode) {
+#if defined(_UFFDIO_WRITEPROTECT)
+	case USERFAULT_MODE_WP:
+		if ((reg_ioctls & (1ULL << _UFFDIO_WRITEPROTECT)) == 0) {
+			pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_WRITEPROTECT\n",
+				args->name);
+			rc = EXIT_FAILURE;
+			goto unreg;
+		}
+		break;
+#endif
+#if defined(_UFFDIO_CONTINUE)
+	case USERFAULT_MODE_MINOR:
+		if ((reg_ioctls & (1ULL << _UFFDIO_CONTINUE)) == 0) {
+			pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_CONTINUE\n",
+				args->name);
+			rc = EXIT_FAILURE;
+			goto unreg;
+		}
+		break;
+#endif
+	default:
+		/* OK, so do we have copy supported? */
+		if ((reg_ioctls & uffdio_copy) != uffdio_copy) {
+			pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_COPY\n",
+				args->name);
+			rc = EXIT_FAILURE;
+			goto unreg;
+		}
+		/* OK, so do we have zeropage supported? */
+		if ((reg_ioctls & uffdio_zeropage) != uffdio_zeropage) {
+			pr_fail("%s: ioctl UFFDIO_REGISTER did not support _UFFDIO_ZEROPAGE\n",
+				args->name);
+			rc = EXIT_FAILURE;
+			goto unreg;
+		}
+		break;
 	}
 
-	/* Set up context for child */
-	c.args = args;
-	c.data = data;
-	c.sz = sz;
-	c.page_size = page_size;
-	c.parent = self;
+	(void)shim_memset(handlers, 0, sizeof(handlers));
+	for (i = 0; i < n_handlers; i++) {
+		/* Set up context for child */
+		c[i].args = args;
+		c[i].data = data + (i * slice);
+		c[i].sz = slice;
+		c[i].page_size = page_size;
+		c[i].parent = self;
+		c[i].fd = fd;
+		c[i].mode = userfaultfd_mode;
+		c[i].fault_time = 0.0;
+		pids[i] = -1;
+
+		handlers[i].args = args;
+		handlers[i].fd = fd;
+		handlers[i].do_poll = do_poll;
+		handlers[i].data = data;
+		handlers[i].sz = sz;
+		handlers[i].c = c;
+		handlers[i].n_children = n_handlers;
+		handlers[i].src = src;
+		handlers[i].batch = userfaultfd_batch;
+		handlers[i].mode = userfaultfd_mode;
+		handlers[i].stop = i ? &stop : NULL;
+		handlers[i].rc = EXIT_SUCCESS;
+		handlers[i].lat = &lats[i];
+	}
 
+	stress_userfaultfd_pid = self;
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	/*
 	 *  We need to clone and share the same VM address space
 	 *  as parent so we can perform the page fault handling
 	 */
-	pid = clone(stress_userfaultfd_clone, stress_align_stack(stack_top),
-		SIGCHLD | CLONE_FILES | CLONE_FS | CLONE_SIGHAND | CLONE_VM, &c);
-	if (pid < 0) {
-		pr_err("%s: clone failed, errno=%d (%s)\n",
-			args->name, errno, strerror(errno));
-		goto unreg;
-	}
-
-	/* Parent */
-	do {
-		struct uffd_msg msg;
-		struct uffdio_range wake;
-		ssize_t ret;
-		double counter;
-
-		/* check we should break out before we block on the read */
-		if (!stress_continue_flag())
-			break;
-
-		t = stress_time_now();
-		/*
-		 * polled wait exercises userfaultfd_poll
-		 * in the kernel, but only works if fd is NONBLOCKing
-		 */
-		if (do_poll) {
-			struct pollfd fds[1];
+	for (i = 0; i < n_handlers; i++) {
+		uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)(stacks + (i * STACK_SIZE)), STACK_SIZE);
 
-			(void)shim_memset(fds, 0, sizeof fds);
-			fds[0].fd = fd;
-			fds[0].events = POLLIN;
-			/* wait for 1 second max */
-
-			ret = poll(fds, 1, 1000);
-			if (ret == 0)
-				continue;	/* timed out, redo the poll */
-			if (ret < 0) {
-				if (errno == EINTR)
-					continue;
-				if (errno != ENOMEM) {
-					pr_fail("%s: poll failed, errno=%d (%s)\n",
-						args->name, errno, strerror(errno));
-					if (!stress_continue_flag())
-						break;
-				}
-				/*
-				 *  poll ran out of free space for internal
-				 *  fd tables, so give up and block on the
-				 *  read anyway
-				 */
-				goto do_read;
-			}
-			/* No data, re-poll */
-			if (!(fds[0].revents & POLLIN))
-				continue;
-
-			if (UNLIKELY(count++ >= COUNT_MAX)) {
-				(void)stress_read_fdinfo(self, fd);
-				count = 0;
-			}
-		}
-
-do_read:
-		ret = read(fd, &msg, sizeof(msg));
-		if (ret < 0) {
-			if (errno == EINTR)
-				continue;
-			pr_fail("%s: read failed, errno=%d (%s)\n",
+		pids[i] = clone(stress_userfaultfd_clone, stress_align_stack(stack_top),
+			SIGCHLD | CLONE_FILES | CLONE_FS | CLONE_SIGHAND | CLONE_VM, &c[i]);
+		if (pids[i] < 0) {
+			pr_err("%s: clone failed, errno=%d (%s)\n",
 				args->name, errno, strerror(errno));
-			if (!stress_continue_flag())
-				break;
-			continue;
-		}
-		/* We only expect a page fault event */
-		if (msg.event != UFFD_EVENT_PAGEFAULT) {
-			pr_fail("%s: msg event not a pagefault event\n", args->name);
-			continue;
-		}
-		/* We only expect a write fault */
-		if (!(msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WRITE)) {
-			pr_fail("%s: msg event not write page fault event\n", args->name);
-			continue;
+			goto reap;
 		}
-		/* Go handle the page fault */
-		if (handle_page_fault(args, fd, (uint8_t *)(intptr_t)msg.arg.pagefault.address,
-				zero_page, data, data + sz, page_size) < 0)
-			break;
-		duration += stress_time_now() - t;
-		stress_bogo_inc(args);
-		counter = (double)stress_bogo_get(args);
+	}
 
-		rate = (counter > 0.0) ? duration / counter : 0.0;
-		stress_metrics_set(args, 0, "nanosecs per page fault",
-			rate * STRESS_DBL_NANOSECOND, STRESS_HARMONIC_MEAN);
+#if defined(HAVE_LIB_PTHREAD)
+	for (started = 1; started < n_handlers; started++) {
+		handlers[started].ret = pthread_create(&handlers[started].pthread, NULL,
+			stress_userfaultfd_handler, (void *)&handlers[started]);
+		if (handlers[started].ret) {
+			pr_inf("%s: pthread_create failed, errno=%d (%s), using %zu handlers\n",
+				args->name, handlers[started].ret,
+				strerror(handlers[started].ret), started);
+			break;
+		}
+	}
+#endif
 
-		(void)shim_memset(&wake, 0, sizeof(wake));
-		wake.start = (uintptr_t)data;
-		wake.len = page_size;
-		VOID_RET(int, ioctl(fd, UFFDIO_WAKE, &wake));
+	/* Parent, the main fault handler */
+	t = stress_time_now();
+	rc = stress_userfaultfd_handle(&handlers[0], handlers, n_handlers);
 
-	} while (stress_continue(args));
+	stop = true;
+#if defined(HAVE_LIB_PTHREAD)
+	for (i = 1; i < started; i++) {
+		(void)pthread_join(handlers[i].pthread, NULL);
+		if (handlers[i].rc != EXIT_SUCCESS)
+			rc = handlers[i].rc;
+	}
+#else
+	(void)started;
+#endif
+	stress_userfaultfd_report(args, handlers, n_handlers, stress_time_now() - t);
+	if ((args->instance == 0) && (n_handlers > 1 || userfaultfd_batch > 1 || userfaultfd_mode != USERFAULT_MODE_MISSING))
+		pr_dbg("%s: %s mode, %zu handlers, batch of %zu pages\n", args->name,
+			userfaultfd_modes[userfaultfd_mode], n_handlers, userfaultfd_batch);
 
+reap:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-
-	stress_kill_and_wait(args, pid, SIGALRM, false);
+	for (i = 0; i < n_handlers; i++) {
+		if (pids[i] > 0)
+			stress_kill_and_wait(args, pids[i], SIGALRM, false);
+	}
 unreg:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 	if (ioctl(fd, UFFDIO_UNREGISTER, &reg) < 0) {
@@ -483,10 +943,13 @@ unreg:
 	}
 unmap_data:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (stacks != MAP_FAILED)
+		(void)munmap((void *)stacks, STACK_SIZE * n_handlers);
 	(void)munmap(data, sz);
 free_zeropage:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
-	free(zero_page);
+	free(lats);
+	free(src);
 	if (fd > -1)
 		(void)close(fd);
 
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-clocksource.h"
 
 #if defined(HAVE_SYS_AUXV_H)
 #include <sys/auxv.h>
@@ -79,7 +80,44 @@ typedef struct vdso_sym {
 	bool duplicate;		/* True if a duplicate call */
 } stress_vdso_sym_t;
 
+/*
+ *  vDSO function addresses for the per function cost table,
+ *  found regardless of any vdso-func selection
+ */
+typedef enum {
+	VDSO_COST_CLOCK_GETTIME,
+	VDSO_COST_GETTIMEOFDAY,
+	VDSO_COST_TIME,
+	VDSO_COST_GETCPU,
+	VDSO_COST_GETRANDOM,
+	VDSO_COST_MAX,
+} stress_vdso_cost_func_t;
+
+typedef struct {
+	const char *name;	/* Function name without vDSO prefix */
+	void *addr;		/* Function address in vDSO */
+} stress_vdso_addr_t;
+
+/*
+ *  A vDSO function and the equivalent system call
+ */
+typedef struct stress_vdso_cost {
+	const char *name;	/* Function name */
+	const char *arg;	/* Clock name or argument description */
+	stress_vdso_cost_func_t func;	/* vDSO function */
+	clockid_t clockid;	/* clock_gettime clock id */
+	int (*vdso_call)(const struct stress_vdso_cost *cost, void *addr);
+	int (*syscall_call)(const struct stress_vdso_cost *cost, void *addr);
+} stress_vdso_cost_t;
+
 static stress_vdso_sym_t *vdso_sym_list;
+static stress_vdso_addr_t vdso_addrs[VDSO_COST_MAX] = {
+	{ "clock_gettime",	NULL },
+	{ "gettimeofday",	NULL },
+	{ "time",		NULL },
+	{ "getcpu",		NULL },
+	{ "getrandom",		NULL },
+};
 
 /*
  *  wrap_getcpu()
@@ -200,6 +238,36 @@ static const stress_wrap_func_t wrap_funcs[] = {
 	{ wrap_time,		"__kernel_time" },
 };
 
+/*
+ *  vdso_func_basename()
+ *	strip __vdso_ or __kernel_ prefix from a vDSO symbol name
+ */
+static const char *vdso_func_basename(const char *name)
+{
+	if (!strncmp(name, "__vdso_", 7))
+		return name + 7;
+	if (!strncmp(name, "__kernel_", 9))
+		return name + 9;
+	return name;
+}
+
+/*
+ *  vdso_addr_record()
+ *	record address of a vDSO function used in the cost table
+ */
+static void vdso_addr_record(const char *name, void *addr)
+{
+	size_t i;
+
+	name = vdso_func_basename(name);
+	for (i = 0; i < SIZEOF_ARRAY(vdso_addrs); i++) {
+		if (!strcmp(name, vdso_addrs[i].name)) {
+			vdso_addrs[i].addr = addr;
+			return;
+		}
+	}
+}
+
 /*
  *  func_find()
  *	find wrapper function by symbol name
@@ -297,6 +365,8 @@ static int dl_wrapback(struct dl_phdr_info* info, size_t info_size, void *vdso)
 							    (sym->st_shndx == SHN_UNDEF))
 								continue;
 
+							vdso_addr_record(name, (void *)(sym->st_value + (uintptr_t)load_offset));
+
 							/*
 							 *  Do we have a wrapper for this function?
 							 */
@@ -480,6 +550,375 @@ static int vdso_sym_list_check_vdso_func(stress_vdso_sym_t **list)
 	return 0;
 }
 
+#define VDSO_COST_BATCH		(256)
+#define VDSO_COST_DURATION	(0.005)
+
+#if defined(__linux__)
+/*
+ *  getrandom vDSO opaque state parameters, see linux/random.h
+ */
+typedef struct {
+	uint32_t size_of_opaque_state;
+	uint32_t mmap_prot;
+	uint32_t mmap_flags;
+	uint32_t reserved[13];
+} stress_vgetrandom_params_t;
+
+static void *vdso_getrandom_state;
+static size_t vdso_getrandom_state_size;
+static size_t vdso_getrandom_mmap_size;
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME)
+static int OPTIMIZE3 cost_vdso_clock_gettime(const stress_vdso_cost_t *cost, void *addr)
+{
+	int (*vdso_clock_gettime)(clockid_t clk_id, struct timespec *tp);
+	struct timespec tp;
+
+	*(void **)(&vdso_clock_gettime) = addr;
+	return vdso_clock_gettime(cost->clockid, &tp);
+}
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME) &&		\
+    defined(HAVE_SYSCALL) &&			\
+    defined(__NR_clock_gettime)
+static int OPTIMIZE3 cost_syscall_clock_gettime(const stress_vdso_cost_t *cost, void *addr)
+{
+	struct timespec tp;
+
+	(void)addr;
+	return (int)syscall(__NR_clock_gettime, cost->clockid, &tp);
+}
+#else
+#define cost_syscall_clock_gettime	NULL
+#endif
+
+static int OPTIMIZE3 cost_vdso_gettimeofday(const stress_vdso_cost_t *cost, void *addr)
+{
+	(void)cost;
+	return wrap_gettimeofday(addr);
+}
+
+#if defined(HAVE_SYSCALL) &&			\
+    defined(__NR_gettimeofday)
+static int OPTIMIZE3 cost_syscall_gettimeofday(const stress_vdso_cost_t *cost, void *addr)
+{
+	struct timeval tv;
+
+	(void)cost;
+	(void)addr;
+	return (int)syscall(__NR_gettimeofday, &tv, NULL);
+}
+#else
+#define cost_syscall_gettimeofday	NULL
+#endif
+
+static int OPTIMIZE3 cost_vdso_time(const stress_vdso_cost_t *cost, void *addr)
+{
+	(void)cost;
+	return wrap_time(addr);
+}
+
+#if defined(HAVE_SYSCALL) &&			\
+    defined(__NR_time)
+static int OPTIMIZE3 cost_syscall_time(const stress_vdso_cost_t *cost, void *addr)
+{
+	time_t t;
+
+	(void)cost;
+	(void)addr;
+	return (syscall(__NR_time, &t) == -1) ? -1 : 0;
+}
+#else
+#define cost_syscall_time		NULL
+#endif
+
+static int OPTIMIZE3 cost_vdso_getcpu(const stress_vdso_cost_t *cost, void *addr)
+{
+	(void)cost;
+	return wrap_getcpu(addr);
+}
+
+#if defined(HAVE_SYSCALL) &&			\
+    defined(__NR_getcpu)
+static int OPTIMIZE3 cost_syscall_getcpu(const stress_vdso_cost_t *cost, void *addr)
+{
+	unsigned int cpu, node;
+
+	(void)cost;
+	(void)addr;
+	return (int)syscall(__NR_getcpu, &cpu, &node, NULL);
+}
+#else
+#define cost_syscall_getcpu		NULL
+#endif
+
+#if defined(__linux__)
+static int OPTIMIZE3 cost_vdso_getrandom(const stress_vdso_cost_t *cost, void *addr)
+{
+	ssize_t (*vdso_getrandom)(void *buf, size_t len, unsigned int flags,
+				  void *opaque_state, size_t opaque_len);
+	uint8_t buf[16];
+
+	(void)cost;
+	*(void **)(&vdso_getrandom) = addr;
+	return (vdso_getrandom(buf, sizeof(buf), 0, vdso_getrandom_state,
+			       vdso_getrandom_state_size) < 0) ? -1 : 0;
+}
+#else
+#define cost_vdso_getrandom		NULL
+#endif
+
+#if defined(HAVE_SYSCALL) &&			\
+    defined(__NR_getrandom)
+static int OPTIMIZE3 cost_syscall_getrandom(const stress_vdso_cost_t *cost, void *addr)
+{
+	uint8_t buf[16];
+
+	(void)cost;
+	(void)addr;
+	return (syscall(__NR_getrandom, buf, sizeof(buf), 0) < 0) ? -1 : 0;
+}
+#else
+#define cost_syscall_getrandom		NULL
+#endif
+
+#if defined(HAVE_CLOCK_GETTIME)
+#define VDSO_COST_CLOCK(clk)	\
+	{ "clock_gettime", #clk, VDSO_COST_CLOCK_GETTIME, clk, \
+	  cost_vdso_clock_gettime, cost_syscall_clock_gettime }
+#endif
+
+static const stress_vdso_cost_t vdso_costs[] = {
+#if defined(HAVE_CLOCK_GETTIME)
+#if defined(CLOCK_REALTIME)
+	VDSO_COST_CLOCK(CLOCK_REALTIME),
+#endif
+#if defined(CLOCK_MONOTONIC)
+	VDSO_COST_CLOCK(CLOCK_MONOTONIC),
+#endif
+#if defined(CLOCK_MONOTONIC_RAW)
+	VDSO_COST_CLOCK(CLOCK_MONOTONIC_RAW),
+#endif
+#if defined(CLOCK_BOOTTIME)
+	VDSO_COST_CLOCK(CLOCK_BOOTTIME),
+#endif
+#if defined(CLOCK_TAI)
+	VDSO_COST_CLOCK(CLOCK_TAI),
+#endif
+#if defined(CLOCK_REALTIME_COARSE)
+	VDSO_COST_CLOCK(CLOCK_REALTIME_COARSE),
+#endif
+#if defined(CLOCK_MONOTONIC_COARSE)
+	VDSO_COST_CLOCK(CLOCK_MONOTONIC_COARSE),
+#endif
+#if defined(CLOCK_PROCESS_CPUTIME_ID)
+	VDSO_COST_CLOCK(CLOCK_PROCESS_CPUTIME_ID),
+#endif
+#endif
+	{ "gettimeofday", "", VDSO_COST_GETTIMEOFDAY, 0,
+	  cost_vdso_gettimeofday, cost_syscall_gettimeofday },
+	{ "time", "", VDSO_COST_TIME, 0,
+	  cost_vdso_time, cost_syscall_time },
+	{ "getcpu", "", VDSO_COST_GETCPU, 0,
+	  cost_vdso_getcpu, cost_syscall_getcpu },
+	{ "getrandom", "16 bytes", VDSO_COST_GETRANDOM, 0,
+	  cost_vdso_getrandom, cost_syscall_getrandom },
+};
+
+/*
+ *  vdso_getrandom_state_init()
+ *	allocate the opaque state required by the vDSO getrandom,
+ *	returns false if vDSO getrandom is not usable
+ */
+static bool vdso_getrandom_state_init(void)
+{
+#if defined(__linux__)
+	ssize_t (*vdso_getrandom)(void *buf, size_t len, unsigned int flags,
+				  void *opaque_state, size_t opaque_len);
+	stress_vgetrandom_params_t params;
+	const size_t page_size = stress_get_page_size();
+	void *addr = vdso_addrs[VDSO_COST_GETRANDOM].addr;
+
+	if (!addr)
+		return false;
+
+	/* A zero length request with ~0 opaque_len fetches the state parameters */
+	(void)memset(&params, 0, sizeof(params));
+	*(void **)(&vdso_getrandom) = addr;
+	if (vdso_getrandom(NULL, 0, 0, &params, ~0UL) != 0)
+		return false;
+	if (params.size_of_opaque_state == 0)
+		return false;
+
+	vdso_getrandom_mmap_size = (params.size_of_opaque_state + page_size - 1) & ~(page_size - 1);
+	vdso_getrandom_state = mmap(NULL, vdso_getrandom_mmap_size, (int)params.mmap_prot,
+				    (int)params.mmap_flags, -1, 0);
+	if (vdso_getrandom_state == MAP_FAILED) {
+		vdso_getrandom_state = NULL;
+		return false;
+	}
+	vdso_getrandom_state_size = params.size_of_opaque_state;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ *  vdso_getrandom_state_free()
+ *	free vDSO getrandom opaque state
+ */
+static void vdso_getrandom_state_free(void)
+{
+#if defined(__linux__)
+	if (vdso_getrandom_state) {
+		(void)munmap(vdso_getrandom_state, vdso_getrandom_mmap_size);
+		vdso_getrandom_state = NULL;
+	}
+#endif
+}
+
+/*
+ *  vdso_cost_ns()
+ *	measure nanoseconds per call, takes the fastest of batches
+ *	of calls to discard batches that got preempted or interrupted,
+ *	returns -1.0 if the call is not available or fails
+ */
+static double vdso_cost_ns(
+	const stress_vdso_cost_t *cost,
+	int (*call)(const stress_vdso_cost_t *cost, void *addr),
+	void *addr)
+{
+	double t_start, t_best = -1.0;
+
+	if (!call)
+		return -1.0;
+	if (call(cost, addr) < 0)
+		return -1.0;
+
+	t_start = stress_time_now();
+	do {
+		register int i;
+		double t1, dt;
+
+		t1 = stress_time_now();
+		for (i = 0; i < VDSO_COST_BATCH; i++)
+			(void)call(cost, addr);
+		dt = stress_time_now() - t1;
+		if ((t_best < 0.0) || (dt < t_best))
+			t_best = dt;
+	} while ((stress_time_now() - t_start) < VDSO_COST_DURATION);
+
+	return (t_best * (double)STRESS_NANOSECOND) / (double)VDSO_COST_BATCH;
+}
+
+/*
+ *  stress_vdso_cost()
+ *	measure the cost of each vDSO function against the equivalent
+ *	system call, the vDSO clock functions fall back to the system call
+ *	when the clocksource cannot be read from user space, so a vDSO
+ *	call that costs as much as the system call flags a clocksource
+ *	regression, returns next free metrics index
+ */
+static size_t stress_vdso_cost(stress_args_t *args, size_t idx)
+{
+	char clocksource[64];
+	char *vdso_func = NULL;
+	const char *func_name = NULL;
+	size_t i;
+	bool getrandom_state, fallback = false;
+	double vdso_ns[SIZEOF_ARRAY(vdso_costs)];
+	double syscall_ns[SIZEOF_ARRAY(vdso_costs)];
+
+	if (stress_get_setting("vdso-func", &vdso_func))
+		func_name = vdso_func_basename(vdso_func);
+	if (stress_clocksource_get(clocksource, sizeof(clocksource)) < 0)
+		(void)shim_strscpy(clocksource, "unknown", sizeof(clocksource));
+
+	getrandom_state = vdso_getrandom_state_init();
+
+	for (i = 0; i < SIZEOF_ARRAY(vdso_costs); i++) {
+		const stress_vdso_cost_t *cost = &vdso_costs[i];
+		void *addr = vdso_addrs[cost->func].addr;
+
+		vdso_ns[i] = -1.0;
+		syscall_ns[i] = -1.0;
+		if (func_name && strcmp(func_name, cost->name))
+			continue;
+		if (addr && ((cost->func != VDSO_COST_GETRANDOM) || getrandom_state))
+			vdso_ns[i] = vdso_cost_ns(cost, cost->vdso_call, addr);
+		syscall_ns[i] = vdso_cost_ns(cost, cost->syscall_call, NULL);
+	}
+	vdso_getrandom_state_free();
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: clocksource: %s\n", args->name, clocksource);
+		pr_inf("%s: %-14s %-24s %10s %10s %8s\n", args->name,
+			"function", "argument", "vDSO ns", "syscall ns", "speedup");
+		for (i = 0; i < SIZEOF_ARRAY(vdso_costs); i++) {
+			const stress_vdso_cost_t *cost = &vdso_costs[i];
+			char vdso_str[16], syscall_str[16], speedup_str[16];
+
+			if ((vdso_ns[i] < 0.0) && (syscall_ns[i] < 0.0))
+				continue;
+
+			(void)shim_strscpy(vdso_str, "n/a", sizeof(vdso_str));
+			(void)shim_strscpy(syscall_str, "n/a", sizeof(syscall_str));
+			(void)shim_strscpy(speedup_str, "n/a", sizeof(speedup_str));
+			if (vdso_ns[i] >= 0.0)
+				(void)snprintf(vdso_str, sizeof(vdso_str), "%.2f", vdso_ns[i]);
+			if (syscall_ns[i] >= 0.0)
+				(void)snprintf(syscall_str, sizeof(syscall_str), "%.2f", syscall_ns[i]);
+			if ((vdso_ns[i] > 0.0) && (syscall_ns[i] >= 0.0))
+				(void)snprintf(speedup_str, sizeof(speedup_str), "%.2fx", syscall_ns[i] / vdso_ns[i]);
+
+			pr_inf("%s: %-14s %-24s %10s %10s %8s\n", args->name,
+				cost->name, cost->arg, vdso_str, syscall_str, speedup_str);
+		}
+		pr_block_end();
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(vdso_costs); i++) {
+		const stress_vdso_cost_t *cost = &vdso_costs[i];
+		const char *arg = strncmp(cost->arg, "CLOCK_", 6) ? cost->arg : cost->arg + 6;
+		char str[64];
+
+		if (vdso_ns[i] >= 0.0) {
+			(void)snprintf(str, sizeof(str), "%s%s%s vDSO nanosecs per call",
+				cost->name, *arg ? " " : "", arg);
+			stress_metrics_set(args, idx++, str, vdso_ns[i], STRESS_HARMONIC_MEAN);
+		}
+		if (syscall_ns[i] >= 0.0) {
+			(void)snprintf(str, sizeof(str), "%s%s%s syscall nanosecs per call",
+				cost->name, *arg ? " " : "", arg);
+			stress_metrics_set(args, idx++, str, syscall_ns[i], STRESS_HARMONIC_MEAN);
+		}
+
+		/*
+		 *  High resolution clocks that are not at least twice
+		 *  as fast as the system call are falling back to the
+		 *  system call, typically because the clocksource is
+		 *  not readable from user space, e.g. HPET
+		 */
+		if ((cost->func == VDSO_COST_CLOCK_GETTIME) &&
+		    (vdso_ns[i] > 0.0) && (syscall_ns[i] > 0.0) &&
+		    (vdso_ns[i] * 2.0 > syscall_ns[i]) &&
+		    (strstr(cost->arg, "COARSE") == NULL) &&
+		    (strstr(cost->arg, "CPUTIME") == NULL))
+			fallback = true;
+	}
+
+	if (fallback && (args->instance == 0))
+		pr_warn("%s: vDSO clock_gettime is not significantly faster than the "
+			"system call, the %s clocksource may not support vDSO clock reads\n",
+			args->name, clocksource);
+
+	return idx;
+}
+
 /*
  *  stress_vdso()
  *	stress system wraps in vDSO
@@ -554,6 +993,7 @@ static int stress_vdso(stress_args_t *args)
 		stress_metrics_set(args, 1, "nanosecs for test overhead",
 			overhead_ns, STRESS_GEOMETRIC_MEAN);
 	}
+	(void)stress_vdso_cost(args, 2);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
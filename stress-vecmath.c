@@ -19,6 +19,8 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-cpu.h"
+#include "core-freq.h"
 #include "core-put.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
@@ -26,9 +28,20 @@
 static const stress_help_t help[] = {
 	{ NULL,	"vecmath N",	 "start N workers performing vector math ops" },
 	{ NULL,	"vecmath-ops N", "stop after N vector math bogo operations" },
+	{ NULL,	"vecmath-wide",	 "use 512 bit (AVX-512 on x86) vectors instead of 128 bit vectors" },
 	{ NULL,	NULL,		 NULL }
 };
 
+static int stress_set_vecmath_wide(const char *opt)
+{
+	return stress_set_setting_true("vecmath-wide", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_vecmath_wide,	stress_set_vecmath_wide },
+	{ 0,			NULL }
+};
+
 #if defined(HAVE_VECMATH)
 
 typedef int8_t  stress_vint8_t  __attribute__ ((vector_size (16)));
@@ -39,6 +52,35 @@ typedef int64_t stress_vint64_t __attribute__ ((vector_size (16)));
 typedef __uint128_t stress_vint128_t __attribute__ ((vector_size (16)));
 #endif
 
+/* 512 bit vectors for --vecmath-wide, 4 copies of the 128 bit lanes */
+typedef int8_t  stress_vwint8_t  __attribute__ ((vector_size (64)));
+typedef int16_t stress_vwint16_t __attribute__ ((vector_size (64)));
+typedef int32_t stress_vwint32_t __attribute__ ((vector_size (64)));
+typedef int64_t stress_vwint64_t __attribute__ ((vector_size (64)));
+
+#define VECMATH_MHZ_SAMPLE	(64)	/* sample effective clock every N bogo ops */
+
+#if defined(STRESS_ARCH_X86_64) &&		\
+    defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+#define VECMATH_WIDE_ATTR	__attribute__((target("avx512f,avx512bw")))
+#define VECMATH_WIDE_NAME	"avx512"
+#define VECMATH_WIDE_SUPPORTED() stress_cpu_x86_has_avx512_bw()
+#else
+#define VECMATH_WIDE_ATTR	TARGET_CLONES
+#define VECMATH_WIDE_NAME	"512 bit"
+#define VECMATH_WIDE_SUPPORTED() (true)
+#endif
+
+/* checksum values */
+static const uint8_t csum8_val =  (uint8_t)0x1b;
+static const uint16_t csum16_val = (uint16_t)0xe76b;
+static const uint32_t csum32_val = (uint32_t)0xd18aef8UL;
+static const uint64_t csum64_val = (uint64_t)0x14eb06da7b6dd9c3ULL;
+#if defined(HAVE_INT128_T)
+static const uint64_t csum128lo_val = (uint64_t)0x00000000a61974ccULL;
+static const uint64_t csum128hi_val = (uint64_t)0x0625922a4b5da4bbULL;
+#endif
+
 /*
  *  Convert various sized n * 8 bit tuples into n * 8 bit integers
  */
@@ -123,6 +165,11 @@ typedef __uint128_t stress_vint128_t __attribute__ ((vector_size (16)));
 	H64(a0, a1, a2, a3, a4, a5, a6, a7),					\
 	H64(a8, a9, aa, ab, ac, ad, ae, af)
 
+/*
+ *  Replicate a 128 bit constant across the 4 lanes of a 512 bit vector
+ */
+#define W4(V, M)	V(M), V(M), V(M), V(M)
+
 #if defined(HAVE_INT128_T)
 #define INT1x128(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, aa, ab, ac, ad, ae, af)\
 	H128(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, aa, ab, ac, ad, ae, af)
@@ -151,6 +198,134 @@ do {				\
 	b = b ^ c;		\
 } while (0)
 
+/*
+ *  stress_vecmath_mhz_sample()
+ *	sample the clock straight after the vector ops
+ */
+static inline void stress_vecmath_mhz_sample(
+	stress_args_t *args,
+	double *mhz_sum,
+	double *mhz_count)
+{
+	if ((stress_bogo_get(args) % VECMATH_MHZ_SAMPLE) == 1) {
+		const double mhz = stress_freq_effective_mhz();
+
+		if (mhz > 0.0) {
+			*mhz_sum += mhz;
+			*mhz_count += 1.0;
+		}
+	}
+}
+
+/*
+ *  stress_vecmath_wide()
+ *	one bogo op of the 128 bit vecmath operations on 512 bit
+ *	vectors, each 128 bit lane must produce the 128 bit checksums
+ */
+static void VECMATH_WIDE_ATTR OPTIMIZE3 stress_vecmath_wide(stress_args_t *args)
+{
+	const stress_vwint8_t v23_8 = { W4(V23, INT16x8) };
+	const stress_vwint8_t v3_8 = { W4(V3, INT16x8) };
+	const stress_vwint16_t v23_16 = { W4(V23, INT8x16) };
+	const stress_vwint16_t v3_16 = { W4(V3, INT8x16) };
+	const stress_vwint32_t v23_32 = { W4(V23, INT4x32) };
+	const stress_vwint32_t v3_32 = { W4(V3, INT4x32) };
+	const stress_vwint64_t v23_64 = { W4(V23, INT2x64) };
+	const stress_vwint64_t v3_64 = { W4(V3, INT2x64) };
+
+	stress_vwint8_t a8 = { W4(A, INT16x8) };
+	stress_vwint8_t b8 = { W4(B, INT16x8) };
+	stress_vwint8_t c8 = { W4(C, INT16x8) };
+	stress_vwint8_t s8 = { W4(S, INT16x8) };
+
+	stress_vwint16_t a16 = { W4(A, INT8x16) };
+	stress_vwint16_t b16 = { W4(B, INT8x16) };
+	stress_vwint16_t c16 = { W4(C, INT8x16) };
+	stress_vwint16_t s16 = { W4(S, INT8x16) };
+
+	stress_vwint32_t a32 = { W4(A, INT4x32) };
+	stress_vwint32_t b32 = { W4(B, INT4x32) };
+	stress_vwint32_t c32 = { W4(C, INT4x32) };
+	stress_vwint32_t s32 = { W4(S, INT4x32) };
+
+	stress_vwint64_t a64 = { W4(A, INT2x64) };
+	stress_vwint64_t b64 = { W4(B, INT2x64) };
+	stress_vwint64_t c64 = { W4(C, INT2x64) };
+	stress_vwint64_t s64 = { W4(S, INT2x64) };
+	int i, lane;
+
+	/* same number of OPS per type per loop as stress_vecmath() */
+	for (i = 1000; i; i--) {
+		OPS(a8, b8, c8, s8, v23_8, v3_8);
+		OPS(a16, b16, c16, s16, v23_16, v3_16);
+		OPS(a32, b32, c32, s32, v23_32, v3_32);
+		OPS(a64, b64, c64, s64, v23_64, v3_64);
+
+		OPS(a32, b32, c32, s32, v23_32, v3_32);
+		OPS(a16, b16, c16, s16, v23_16, v3_16);
+		OPS(a8, b8, c8, s8, v23_8, v3_8);
+		OPS(a64, b64, c64, s64, v23_64, v3_64);
+
+		OPS(a8, b8, c8, s8, v23_8, v3_8);
+		OPS(a8, b8, c8, s8, v23_8, v3_8);
+		OPS(a8, b8, c8, s8, v23_8, v3_8);
+		OPS(a8, b8, c8, s8, v23_8, v3_8);
+
+		OPS(a16, b16, c16, s16, v23_16, v3_16);
+		OPS(a16, b16, c16, s16, v23_16, v3_16);
+		OPS(a16, b16, c16, s16, v23_16, v3_16);
+		OPS(a16, b16, c16, s16, v23_16, v3_16);
+
+		OPS(a32, b32, c32, s32, v23_32, v3_32);
+		OPS(a32, b32, c32, s32, v23_32, v3_32);
+		OPS(a32, b32, c32, s32, v23_32, v3_32);
+		OPS(a32, b32, c32, s32, v23_32, v3_32);
+
+		OPS(a64, b64, c64, s64, v23_64, v3_64);
+		OPS(a64, b64, c64, s64, v23_64, v3_64);
+		OPS(a64, b64, c64, s64, v23_64, v3_64);
+		OPS(a64, b64, c64, s64, v23_64, v3_64);
+	}
+
+	for (lane = 0; lane < 4; lane++) {
+		uint8_t csum8 = 0;
+		uint16_t csum16 = 0;
+		uint32_t csum32 = 0;
+		uint64_t csum64 = 0;
+
+		for (i = 0; i < 16; i++)
+			csum8 ^= (uint8_t)a8[(lane * 16) + i];
+		for (i = 0; i < 8; i++)
+			csum16 ^= (uint16_t)a16[(lane * 8) + i];
+		for (i = 0; i < 4; i++)
+			csum32 ^= (uint32_t)a32[(lane * 4) + i];
+		for (i = 0; i < 2; i++)
+			csum64 ^= (uint64_t)a64[(lane * 2) + i];
+
+		stress_uint8_put(csum8);
+		stress_uint16_put(csum16);
+		stress_uint32_put(csum32);
+		stress_uint64_put(csum64);
+
+		if (csum8 != csum8_val) {
+			pr_fail("%s: 64 x 8 bit vector lane %d checksum mismatch, got 0x%2.2" PRIx8
+				", expected 0x%" PRIx8 "\n", args->name, lane, csum8, csum8_val);
+		}
+		if (csum16 != csum16_val) {
+			pr_fail("%s: 32 x 16 bit vector lane %d checksum mismatch, got 0x%4.4" PRIx16
+				", expected 0x%" PRIx16 "\n", args->name, lane, csum16, csum16_val);
+		}
+		if (csum32 != csum32_val) {
+			pr_fail("%s: 16 x 32 bit vector lane %d checksum mismatch, got 0x%8.8" PRIx32
+				", expected 0x%" PRIx32 "\n", args->name, lane, csum32, csum32_val);
+		}
+		if (csum64 != csum64_val) {
+			pr_fail("%s: 8 x 64 bit vector lane %d checksum mismatch, got 0x%16.16" PRIx64
+				", expected 0x%" PRIx64 "\n", args->name, lane, csum64, csum64_val);
+		}
+	}
+}
+
 /*
  *  stress_vecmath()
  *	stress GCC vector maths
@@ -161,16 +336,6 @@ static int stress_vecmath(stress_args_t *args)
 static int TARGET_CLONES stress_vecmath(stress_args_t *args)
 #endif
 {
-	/* checksum values */
-	const uint8_t csum8_val =  (uint8_t)0x1b;
-	const uint16_t csum16_val = (uint16_t)0xe76b;
-	const uint32_t csum32_val = (uint32_t)0xd18aef8UL;
-	const uint64_t csum64_val = (uint64_t)0x14eb06da7b6dd9c3ULL;
-#if defined(HAVE_INT128_T)
-	const uint64_t csum128lo_val = (uint64_t)0x00000000a61974ccULL;
-	const uint64_t csum128hi_val = (uint64_t)0x0625922a4b5da4bbULL;
-#endif
-
 	const stress_vint8_t v23_8 = { V23(INT16x8) };
 	const stress_vint8_t v3_8 = { V3(INT16x8) };
 	const stress_vint16_t v23_16 = { V23(INT8x16) };
@@ -183,6 +348,16 @@ static int TARGET_CLONES stress_vecmath(stress_args_t *args)
 	const stress_vint128_t v23_128 = { V23(INT1x128) };
 	const stress_vint128_t v3_128 = { V3(INT1x128) };
 #endif
+	bool vecmath_wide = false;
+	double mhz_sum = 0.0, mhz_count = 0.0;
+
+	(void)stress_get_setting("vecmath-wide", &vecmath_wide);
+	if (vecmath_wide && !VECMATH_WIDE_SUPPORTED()) {
+		if (args->instance == 0)
+			pr_inf("%s: CPU does not support %s, ignoring --vecmath-wide\n",
+				args->name, VECMATH_WIDE_NAME);
+		vecmath_wide = false;
+	}
 
 	stress_catch_sigill();
 
@@ -191,6 +366,13 @@ static int TARGET_CLONES stress_vecmath(stress_args_t *args)
 	do {
 		int i;
 
+		if (vecmath_wide) {
+			stress_vecmath_wide(args);
+			stress_bogo_inc(args);
+			stress_vecmath_mhz_sample(args, &mhz_sum, &mhz_count);
+			continue;
+		}
+
 		uint8_t csum8;
 		stress_vint8_t a8 = { A(INT16x8) };
 		stress_vint8_t b8 = { B(INT16x8) };
@@ -310,8 +492,17 @@ static int TARGET_CLONES stress_vecmath(stress_args_t *args)
 				csum128hi, csum128lo, csum128hi_val, csum128lo_val);
 		}
 #endif
+		stress_vecmath_mhz_sample(args, &mhz_sum, &mhz_count);
 	} while (stress_continue(args));
 
+	if (mhz_count > 0.0) {
+		char msg[64];
+
+		(void)snprintf(msg, sizeof(msg), "effective MHz (%s vectors)",
+			vecmath_wide ? VECMATH_WIDE_NAME : "128 bit");
+		stress_metrics_set(args, 0, msg, mhz_sum / mhz_count, STRESS_GEOMETRIC_MEAN);
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	return EXIT_SUCCESS;
@@ -320,6 +511,7 @@ static int TARGET_CLONES stress_vecmath(stress_args_t *args)
 stressor_info_t stress_vecmath_info = {
 	.stressor = stress_vecmath,
 	.class = CLASS_CPU | CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -327,6 +519,7 @@ stressor_info_t stress_vecmath_info = {
 stressor_info_t stress_vecmath_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_CPU | CLASS_CPU_CACHE,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
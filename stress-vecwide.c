@@ -19,6 +19,8 @@
 #include "stress-ng.h"
 #include "core-arch.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-freq.h"
 #include "core-pragma.h"
 #include "core-put.h"
 #include "core-target-clones.h"
@@ -32,6 +34,21 @@
 
 #define VERY_WIDE	(0)
 
+/* sample the effective clock after every N calls of a kernel */
+#define VECWIDE_MHZ_SAMPLE	(32)
+
+#if defined(STRESS_ARCH_X86_64) &&		\
+    defined(HAVE_TARGET_CLONES_SKYLAKE_AVX512)
+#define HAVE_VECWIDE_AVX512
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&			\
+    defined(__aarch64__) &&			\
+    defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#define HAVE_VECWIDE_SVE
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"vecwide N",	 "start N workers performing vector math ops" },
 	{ NULL,	"vecwide-ops N", "stop after N vector math bogo operations" },
@@ -79,14 +96,21 @@ typedef struct {
 typedef void (*stress_vecwide_func_t)(const vec_args_t *vec_args);
 
 typedef struct {
+	const char *name;		/* NULL = generic, else explicit ISA */
 	const stress_vecwide_func_t vecwide_func;
-	const size_t byte_size;
+	bool (*supported)(void);	/* NULL = always supported */
+	size_t byte_size;		/* vector size, 0 = set at run time */
 	double duration;
 	double count;
+	double mhz_sum;			/* sum of effective MHz samples */
+	double mhz_count;		/* number of effective MHz samples */
 } stress_vecwide_funcs_t;
 
 #define STRESS_VECWIDE(name, type)				\
-static void TARGET_CLONES OPTIMIZE3 name (const vec_args_t *vec_args) \
+	STRESS_VECWIDE_ATTR(name, type, TARGET_CLONES)
+
+#define STRESS_VECWIDE_ATTR(name, type, attr)			\
+static void attr OPTIMIZE3 name (const vec_args_t *vec_args)	\
 {								\
 	type ALIGN64 a;						\
 	type ALIGN64 b;						\
@@ -138,27 +162,101 @@ STRESS_VECWIDE(stress_vecwide_32, stress_vint8w32_t)
 STRESS_VECWIDE(stress_vecwide_16, stress_vint8w16_t)
 #endif
 
+#if defined(HAVE_VECWIDE_AVX512)
+/*
+ *  explicit 512 bit AVX-512 kernel, unlike the target clones
+ *  above this is never built for a narrower ISA, so it always
+ *  exercises the 512 bit datapath (and its frequency license)
+ */
+STRESS_VECWIDE_ATTR(stress_vecwide_avx512, stress_vint8w512_t, __attribute__((target("avx512f,avx512bw"))))
+#endif
+
+#if defined(HAVE_VECWIDE_SVE)
+/*
+ *  stress_vecwide_sve()
+ *	vector length agnostic SVE kernel, the same operations as
+ *	the generic kernels on one full hardware vector
+ */
+static void OPTIMIZE3 stress_vecwide_sve(const vec_args_t *vec_args)
+{
+	const svbool_t pg = svptrue_b8();
+	svint8_t a = svld1_s8(pg, (const int8_t *)vec_args->a);
+	svint8_t b = svld1_s8(pg, (const int8_t *)vec_args->b);
+	svint8_t c = svld1_s8(pg, (const int8_t *)vec_args->c);
+	svint8_t s = svld1_s8(pg, (const int8_t *)vec_args->s);
+	const svint8_t v23 = svld1_s8(pg, (const int8_t *)vec_args->v23);
+	const svint8_t v3 = svld1_s8(pg, (const int8_t *)vec_args->v23);
+	int8_t ALIGN64 res[VEC_MAX_SZ];
+	register int i;
+	const int n = (int)svcntb();
+
+PRAGMA_UNROLL_N(8)
+	for (i = 0; i < 2048; i++) {
+		a = svadd_s8_x(pg, a, b);
+		b = svsub_s8_x(pg, b, c);
+		c = svadd_s8_x(pg, c, v3);
+		s = sveor_s8_x(pg, s, b);
+		a = svadd_s8_x(pg, a, v23);
+		b = svmul_s8_x(pg, b, v3);
+		a = svmul_s8_x(pg, a, s);
+	}
+
+	svst1_s8(pg, res, svadd_s8_x(pg, svadd_s8_x(pg, a, b), c));
+
+	for (i = 0; i < n; i++) {
+		stress_uint8_put((uint8_t)res[i]);
+	}
+}
+
+static bool stress_vecwide_sve_supported(void)
+{
+	/* SVE vectors are at most 2048 bits, the size of the vec_args arrays */
+	return svcntb() <= VEC_MAX_SZ;
+}
+#endif
+
 static stress_vecwide_funcs_t stress_vecwide_funcs[] = {
 #if VERY_WIDE
-	{ stress_vecwide_8192, sizeof(stress_vint8w8192_t), 0.0, 0.0 },
-	{ stress_vecwide_4096, sizeof(stress_vint8w4096_t), 0.0, 0.0 },
+	{ NULL, stress_vecwide_8192, NULL, sizeof(stress_vint8w8192_t), 0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_4096, NULL, sizeof(stress_vint8w4096_t), 0.0, 0.0, 0.0, 0.0 },
 #endif
-	{ stress_vecwide_2048, sizeof(stress_vint8w2048_t), 0.0, 0.0 },
-	{ stress_vecwide_1024, sizeof(stress_vint8w1024_t), 0.0, 0.0 },
-	{ stress_vecwide_512,  sizeof(stress_vint8w512_t),  0.0, 0.0 },
-	{ stress_vecwide_256,  sizeof(stress_vint8w256_t),  0.0, 0.0 },
-	{ stress_vecwide_128,  sizeof(stress_vint8w128_t),  0.0, 0.0 },
-	{ stress_vecwide_64,   sizeof(stress_vint8w64_t),   0.0, 0.0 },
-	{ stress_vecwide_32,   sizeof(stress_vint8w32_t),   0.0, 0.0 },
+	{ NULL, stress_vecwide_2048, NULL, sizeof(stress_vint8w2048_t), 0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_1024, NULL, sizeof(stress_vint8w1024_t), 0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_512,  NULL, sizeof(stress_vint8w512_t),  0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_256,  NULL, sizeof(stress_vint8w256_t),  0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_128,  NULL, sizeof(stress_vint8w128_t),  0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_64,   NULL, sizeof(stress_vint8w64_t),   0.0, 0.0, 0.0, 0.0 },
+	{ NULL, stress_vecwide_32,   NULL, sizeof(stress_vint8w32_t),   0.0, 0.0, 0.0, 0.0 },
 #if VERY_SMALL
-	{ stress_vecwide_16,   sizeof(stress_vint8w16_t),   0.0, 0.0 },
+	{ NULL, stress_vecwide_16,   NULL, sizeof(stress_vint8w16_t),   0.0, 0.0, 0.0, 0.0 },
+#endif
+#if defined(HAVE_VECWIDE_AVX512)
+	{ "avx512", stress_vecwide_avx512, stress_cpu_x86_has_avx512_bw,
+		sizeof(stress_vint8w512_t), 0.0, 0.0, 0.0, 0.0 },
+#endif
+#if defined(HAVE_VECWIDE_SVE)
+	{ "sve", stress_vecwide_sve, stress_vecwide_sve_supported, 0, 0.0, 0.0, 0.0, 0.0 },
 #endif
 };
 
+static bool stress_vecwide_func_enabled[SIZEOF_ARRAY(stress_vecwide_funcs)];
+
+/*
+ *  stress_vecwide_name()
+ *	name a kernel by its width or by its explicit ISA
+ */
+static void stress_vecwide_name(const stress_vecwide_funcs_t *func, char *buf, const size_t len)
+{
+	if (func->name)
+		(void)snprintf(buf, len, "vecwide %s", func->name);
+	else
+		(void)snprintf(buf, len, "vecwide%zd", func->byte_size * 8);
+}
+
 static int stress_vecwide(stress_args_t *args)
 {
 	static vec_args_t *vec_args;
-	size_t i;
+	size_t i, j;
 	double total_duration = 0.0;
 	size_t total_bytes = 0;
 	const size_t vec_args_size = (sizeof(*vec_args) + args->page_size - 1) & ~(args->page_size - 1);
@@ -176,8 +274,20 @@ static int stress_vecwide(stress_args_t *args)
 	}
 
 	for (i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
-		stress_vecwide_funcs[i].duration = 0.0;
-		stress_vecwide_funcs[i].count = 0.0;
+		stress_vecwide_funcs_t *func = &stress_vecwide_funcs[i];
+
+		func->duration = 0.0;
+		func->count = 0.0;
+		func->mhz_sum = 0.0;
+		func->mhz_count = 0.0;
+		stress_vecwide_func_enabled[i] = !func->supported || func->supported();
+#if defined(HAVE_VECWIDE_SVE)
+		if (func->vecwide_func == stress_vecwide_sve)
+			func->byte_size = stress_vecwide_func_enabled[i] ? svcntb() : 0;
+#endif
+		if (func->name && !stress_vecwide_func_enabled[i] && (args->instance == 0))
+			pr_dbg("%s: %s kernel not supported by this CPU, skipping it\n",
+				args->name, func->name);
 	}
 
 	for (i = 0; i < SIZEOF_ARRAY(vec_args->a); i++) {
@@ -196,6 +306,8 @@ static int stress_vecwide(stress_args_t *args)
 		for (i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
 			double t1, t2, dt;
 
+			if (!stress_vecwide_func_enabled[i])
+				continue;
 			vec_args->res = vec_args->res1;
 			t1 = stress_time_now();
 			stress_vecwide_funcs[i].vecwide_func(vec_args);
@@ -207,6 +319,19 @@ static int stress_vecwide(stress_args_t *args)
 			stress_vecwide_funcs[i].count += 1.0;
 			stress_bogo_inc(args);
 
+			/*
+			 *  sample the clock straight after the kernel to
+			 *  catch any wide vector frequency drop
+			 */
+			if (((uint64_t)stress_vecwide_funcs[i].count % VECWIDE_MHZ_SAMPLE) == 1) {
+				const double mhz = stress_freq_effective_mhz();
+
+				if (mhz > 0.0) {
+					stress_vecwide_funcs[i].mhz_sum += mhz;
+					stress_vecwide_funcs[i].mhz_count += 1.0;
+				}
+			}
+
 			if (verify) {
 				vec_args->res = vec_args->res2;
 				t1 = stress_time_now();
@@ -227,7 +352,8 @@ static int stress_vecwide(stress_args_t *args)
 	} while (stress_continue(args));
 
 	for (i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
-		total_bytes += stress_vecwide_funcs[i].byte_size;
+		if (stress_vecwide_func_enabled[i])
+			total_bytes += stress_vecwide_funcs[i].byte_size;
 	}
 
 	if (args->instance == 0) {
@@ -236,27 +362,40 @@ static int stress_vecwide(stress_args_t *args)
 		for (i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
 			double dur_pc, exp_pc, win;
 
+			if (!stress_vecwide_func_enabled[i] || (stress_vecwide_funcs[i].duration <= 0.0))
+				continue;
+
 			dur_pc = stress_vecwide_funcs[i].duration / total_duration * 100.0;
 			exp_pc = (double)stress_vecwide_funcs[i].byte_size / (double)total_bytes * 100.0;
 			win    = exp_pc / dur_pc;
 
-			pr_dbg("%s: %5zd %5.2f%% %5.2f%% %5.2f\n",
+			pr_dbg("%s: %5zd %5.2f%% %5.2f%% %5.2f %s\n",
 				args->name, 8 * stress_vecwide_funcs[i].byte_size,
-				dur_pc, exp_pc, win);
+				dur_pc, exp_pc, win,
+				stress_vecwide_funcs[i].name ? stress_vecwide_funcs[i].name : "");
 		}
 		pr_dbg("%s: Key: Bits = vector width in bits, Dur = %% total run time,\n", args->name);
 		pr_dbg("%s       Exp = %% expected run time, Win = performance gain\n", args->name);
 		pr_block_end();
 	}
 
-	for (i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
-		char str[64];
-		const double rate = (stress_vecwide_funcs[i].duration > 0) ?
-				stress_vecwide_funcs[i].count / stress_vecwide_funcs[i].duration : 0.0;
-
-		(void)snprintf(str, sizeof(str), "vecwide%zd ops per sec", stress_vecwide_funcs[i].byte_size * 8);
-		stress_metrics_set(args, i, str,
+	for (j = 0, i = 0; i < SIZEOF_ARRAY(stress_vecwide_funcs); i++) {
+		const stress_vecwide_funcs_t *func = &stress_vecwide_funcs[i];
+		char name[32], str[64];
+		const double rate = (func->duration > 0) ?
+				func->count / func->duration : 0.0;
+
+		if (!stress_vecwide_func_enabled[i])
+			continue;
+		stress_vecwide_name(func, name, sizeof(name));
+		(void)snprintf(str, sizeof(str), "%s ops per sec", name);
+		stress_metrics_set(args, j++, str,
 			rate, STRESS_HARMONIC_MEAN);
+		if (func->mhz_count > 0.0) {
+			(void)snprintf(str, sizeof(str), "%s effective MHz", name);
+			stress_metrics_set(args, j++, str,
+				func->mhz_sum / func->mhz_count, STRESS_GEOMETRIC_MEAN);
+		}
 	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
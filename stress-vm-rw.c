@@ -37,6 +37,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"vm-rw N",	 "start N vm read/write process_vm* copy workers" },
 	{ NULL,	"vm-rw-bytes N", "transfer N bytes of memory per bogo operation" },
 	{ NULL,	"vm-rw-ops N",	 "stop after N vm process_vm* copy bogo operations" },
+	{ NULL,	"vm-rw-sweep",	 "sweep iovecs per call and segment sizes, report GB/s" },
 	{ NULL,	NULL,		 NULL }
 };
 
@@ -62,6 +63,55 @@ typedef struct {
 	uint8_t val;	/* Value to check */
 } stress_addr_msg_t;
 
+#define VM_RW_SWEEP_VAL		(0xa5)	/* child buffer fill value */
+#define VM_RW_SWEEP_IOV_MAX	(1024)	/* largest iovec count, IOV_MAX */
+
+typedef enum {
+	VM_RW_SWEEP_READV,
+	VM_RW_SWEEP_WRITEV,
+	VM_RW_SWEEP_VMSPLICE,
+	VM_RW_SWEEP_MEMCPY,
+} stress_vm_rw_sweep_method_t;
+
+/* a sweep point and its accumulated transfers */
+typedef struct {
+	stress_vm_rw_sweep_method_t method;
+	size_t seg_size;	/* bytes per iovec segment */
+	size_t iovecs;		/* iovec segments per call */
+	double bytes;		/* bytes transferred */
+	double duration;	/* time transferring */
+	double syscalls;	/* system calls made */
+	double segments;	/* iovec segments transferred */
+} stress_vm_rw_sweep_result_t;
+
+/* the parent and child buffers of a --vm-rw-sweep */
+typedef struct {
+	stress_args_t *args;
+	pid_t pid;		/* child process */
+	size_t sz;		/* size of each buffer */
+	uint8_t *localbuf;	/* parent buffer */
+	uint8_t *remotebuf;	/* child buffer, same address in the child */
+	uint8_t *sharedbuf;	/* buffer shared with the child */
+	int fd;			/* pipe to the child for vmsplice */
+	struct iovec *local;	/* local iovecs */
+	struct iovec *remote;	/* remote iovecs */
+} stress_vm_rw_sweep_t;
+
+static const char * const stress_vm_rw_sweep_methods[] = {
+	"readv",
+	"writev",
+	"vmsplice",
+	"memcpy",
+};
+
+static const size_t stress_vm_rw_sweep_seg_sizes[] = {
+	4 * KB, 64 * KB, 1 * MB,
+};
+
+static const size_t stress_vm_rw_sweep_iovecs[] = {
+	1, 4, 16, 64, 256, VM_RW_SWEEP_IOV_MAX,
+};
+
 #endif
 
 static int stress_set_vm_rw_bytes(const char *opt)
@@ -74,8 +124,14 @@ static int stress_set_vm_rw_bytes(const char *opt)
 	return stress_set_setting("vm-rw-bytes", TYPE_ID_SIZE_T, &vm_rw_bytes);
 }
 
+static int stress_set_vm_rw_sweep(const char *opt)
+{
+	return stress_set_setting_true("vm-rw-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_vm_rw_bytes,	stress_set_vm_rw_bytes },
+	{ OPT_vm_rw_sweep,	stress_set_vm_rw_sweep },
 	{ 0,			NULL }
 };
 
@@ -359,6 +415,387 @@ fail:
 	return EXIT_SUCCESS;
 }
 
+/*
+ *  stress_vm_rw_sweep_child()
+ *	fill the child's copy of the buffer and then drain the
+ *	vmsplice'd data into it until the parent kills the child
+ */
+static void NORETURN stress_vm_rw_sweep_child(
+	const stress_vm_rw_sweep_t *sweep,
+	const int fd_rd,
+	const int fd_ready)
+{
+	size_t offset = 0;
+	const char ready = 'r';
+
+	stress_parent_died_alarm();
+
+	/* breaks the copy on write sharing with the parent */
+	(void)shim_memset(sweep->remotebuf, VM_RW_SWEEP_VAL, sweep->sz);
+	if (write(fd_ready, &ready, sizeof(ready)) != sizeof(ready))
+		_exit(EXIT_FAILURE);
+	(void)close(fd_ready);
+
+	for (;;) {
+		const ssize_t ret = read(fd_rd, sweep->remotebuf + offset, sweep->sz - offset);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (ret == 0)
+			break;
+		offset += (size_t)ret;
+		if (offset >= sweep->sz)
+			offset = 0;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+#if defined(HAVE_VMSPLICE)
+/*
+ *  stress_vm_rw_sweep_vmsplice()
+ *	vmsplice all of the iovecs, vmsplice stops at partial
+ *	segments when the pipe is full so carry on from there
+ */
+static ssize_t stress_vm_rw_sweep_vmsplice(
+	const int fd,
+	struct iovec *iov,
+	size_t n,
+	double *syscalls)
+{
+	ssize_t total = 0;
+
+	while ((n > 0) && stress_continue_flag()) {
+		ssize_t ret = vmsplice(fd, iov, n, 0);
+
+		(*syscalls)++;
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return -1;
+		}
+		total += ret;
+		while ((n > 0) && ((size_t)ret >= iov->iov_len)) {
+			ret -= (ssize_t)iov->iov_len;
+			iov++;
+			n--;
+		}
+		if (n > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + ret;
+			iov->iov_len -= (size_t)ret;
+		}
+	}
+	return total;
+}
+#endif
+
+/*
+ *  stress_vm_rw_sweep_pass()
+ *	transfer the buffer with the method of the sweep point,
+ *	with iovecs segments of seg_size bytes per call
+ */
+static int OPTIMIZE3 stress_vm_rw_sweep_pass(
+	stress_vm_rw_sweep_t *sweep,
+	stress_vm_rw_sweep_result_t *result)
+{
+	stress_args_t *args = sweep->args;
+	const size_t seg_size = result->seg_size;
+	const size_t iovecs = result->iovecs;
+	const size_t chunk = seg_size * iovecs;
+	const size_t calls = sweep->sz / chunk;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	double t, syscalls = 0.0, bytes = 0.0;
+	size_t i, j;
+
+	if (verify && (result->method == VM_RW_SWEEP_READV))
+		(void)shim_memset(sweep->localbuf, 0, sweep->sz);
+
+	t = stress_time_now();
+	for (i = 0; (i < calls) && stress_continue_flag(); i++) {
+		uint8_t *lptr = sweep->localbuf + (i * chunk);
+		uint8_t *rptr = sweep->remotebuf + (i * chunk);
+		ssize_t ret;
+
+		switch (result->method) {
+		case VM_RW_SWEEP_READV:
+		case VM_RW_SWEEP_WRITEV:
+			for (j = 0; j < iovecs; j++) {
+				sweep->local[j].iov_base = lptr + (j * seg_size);
+				sweep->local[j].iov_len = seg_size;
+				sweep->remote[j].iov_base = rptr + (j * seg_size);
+				sweep->remote[j].iov_len = seg_size;
+			}
+			ret = (result->method == VM_RW_SWEEP_READV) ?
+				process_vm_readv(sweep->pid, sweep->local, iovecs, sweep->remote, iovecs, 0) :
+				process_vm_writev(sweep->pid, sweep->local, iovecs, sweep->remote, iovecs, 0);
+			syscalls++;
+			if (UNLIKELY(ret < 0)) {
+				pr_fail("%s: process_vm_%s failed, errno=%d (%s)\n",
+					args->name, stress_vm_rw_sweep_methods[result->method],
+					errno, strerror(errno));
+				return -1;
+			}
+			bytes += (double)ret;
+			break;
+#if defined(HAVE_VMSPLICE)
+		case VM_RW_SWEEP_VMSPLICE:
+			for (j = 0; j < iovecs; j++) {
+				sweep->local[j].iov_base = lptr + (j * seg_size);
+				sweep->local[j].iov_len = seg_size;
+			}
+			ret = stress_vm_rw_sweep_vmsplice(sweep->fd, sweep->local, iovecs, &syscalls);
+			if (UNLIKELY(ret < 0)) {
+				pr_fail("%s: vmsplice failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+			bytes += (double)ret;
+			break;
+#endif
+		case VM_RW_SWEEP_MEMCPY:
+		default:
+			for (j = 0; j < iovecs; j++)
+				(void)shim_memcpy(sweep->sharedbuf + (i * chunk) + (j * seg_size),
+					lptr + (j * seg_size), seg_size);
+			bytes += (double)chunk;
+			break;
+		}
+	}
+	result->duration += stress_time_now() - t;
+	result->bytes += bytes;
+	result->syscalls += syscalls;
+	result->segments += bytes / (double)seg_size;
+
+	if (verify && (result->method == VM_RW_SWEEP_READV)) {
+		const uint8_t *ptr, *end = sweep->localbuf + (calls * chunk);
+
+		for (ptr = sweep->localbuf; (ptr < end) && stress_continue_flag(); ptr += args->page_size) {
+			if (UNLIKELY(*ptr != VM_RW_SWEEP_VAL)) {
+				pr_fail("%s: memory at %p (offset %tx): %d vs %d\n",
+					args->name, (const void *)ptr, ptr - sweep->localbuf,
+					*ptr, VM_RW_SWEEP_VAL);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_vm_rw_sweep()
+ *	measure the bandwidth of process_vm_readv, process_vm_writev
+ *	and vmsplice between the parent and a forked child with
+ *	different numbers of iovecs per call and segment sizes, and
+ *	of a memcpy into memory shared with the child for comparison
+ */
+static int stress_vm_rw_sweep(stress_args_t *args, const size_t sz)
+{
+	stress_vm_rw_sweep_t sweep;
+	stress_vm_rw_sweep_result_t *results, *result;
+	const size_t max_results = SIZEOF_ARRAY(stress_vm_rw_sweep_methods) *
+		SIZEOF_ARRAY(stress_vm_rw_sweep_seg_sizes) *
+		SIZEOF_ARRAY(stress_vm_rw_sweep_iovecs);
+	size_t i, j, k, n_results = 0, idx = 0, metric = 0;
+	int fds_splice[2], fds_ready[2];
+	char ready;
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&sweep, 0, sizeof(sweep));
+	sweep.args = args;
+	sweep.sz = sz;
+	sweep.pid = -1;
+
+	results = (stress_vm_rw_sweep_result_t *)calloc(max_results, sizeof(*results));
+	sweep.local = (struct iovec *)calloc(VM_RW_SWEEP_IOV_MAX, sizeof(*sweep.local));
+	sweep.remote = (struct iovec *)calloc(VM_RW_SWEEP_IOV_MAX, sizeof(*sweep.remote));
+	if (!results || !sweep.local || !sweep.remote) {
+		pr_inf_skip("%s: cannot allocate sweep results and iovecs, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_results;
+	}
+	sweep.localbuf = (uint8_t *)stress_mmap_populate(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (sweep.localbuf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sz, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto free_results;
+	}
+	/* the child gets its own copy of this at the same address */
+	sweep.remotebuf = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (sweep.remotebuf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sz, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_localbuf;
+	}
+	sweep.sharedbuf = (uint8_t *)stress_mmap_populate(NULL, sz, PROT_READ | PROT_WRITE,
+		MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+	if (sweep.sharedbuf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, sz, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_remotebuf;
+	}
+	(void)shim_memset(sweep.localbuf, VM_RW_SWEEP_VAL, sz);
+
+	if (pipe(fds_splice) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto unmap_sharedbuf;
+	}
+	if (pipe(fds_ready) < 0) {
+		pr_fail("%s: pipe failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto close_splice;
+	}
+#if defined(F_SETPIPE_SZ)
+	/* fewer vmsplice calls stall on a full pipe with a larger pipe */
+	(void)fcntl(fds_splice[1], F_SETPIPE_SZ, (int)MB);
+#endif
+
+again:
+	sweep.pid = fork();
+	if (sweep.pid < 0) {
+		if (stress_redo_fork(args, errno))
+			goto again;
+		if (!stress_continue(args))
+			goto close_ready;
+		pr_fail("%s: fork failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto close_ready;
+	} else if (sweep.pid == 0) {
+		(void)close(fds_splice[1]);
+		(void)close(fds_ready[0]);
+		stress_vm_rw_sweep_child(&sweep, fds_splice[0], fds_ready[1]);
+	}
+	(void)close(fds_splice[0]);
+	(void)close(fds_ready[1]);
+	fds_splice[0] = -1;
+	fds_ready[1] = -1;
+	sweep.fd = fds_splice[1];
+
+	/* wait for the child to populate its buffer */
+	if (read(fds_ready[0], &ready, sizeof(ready)) != sizeof(ready)) {
+		pr_fail("%s: child failed to start\n", args->name);
+		rc = EXIT_FAILURE;
+		goto reap;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(stress_vm_rw_sweep_methods); i++) {
+#if !defined(HAVE_VMSPLICE)
+		if (i == VM_RW_SWEEP_VMSPLICE)
+			continue;
+#endif
+		for (j = 0; j < SIZEOF_ARRAY(stress_vm_rw_sweep_seg_sizes); j++) {
+			for (k = 0; k < SIZEOF_ARRAY(stress_vm_rw_sweep_iovecs); k++) {
+				const size_t seg_size = stress_vm_rw_sweep_seg_sizes[j];
+				const size_t iovecs = stress_vm_rw_sweep_iovecs[k];
+
+				/* a memcpy has no per call cost to amortize */
+				if ((i == VM_RW_SWEEP_MEMCPY) && (k > 0))
+					break;
+				if (seg_size * iovecs > sz)
+					break;
+				result = &results[n_results++];
+				result->method = (stress_vm_rw_sweep_method_t)i;
+				result->seg_size = seg_size;
+				result->iovecs = iovecs;
+			}
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		if (stress_vm_rw_sweep_pass(&sweep, &results[idx]) < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		idx++;
+		if (idx >= n_results)
+			idx = 0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0)
+		pr_inf("%s: %-8s %8s %7s %10s %14s %12s\n", args->name,
+			"method", "segment", "iovecs", "GB/sec", "syscalls/GB", "ns/segment");
+	for (i = 0; i < n_results; i++) {
+		char seg_str[32], iov_str[16], str[128];
+		double gb_rate, syscalls_per_gb, ns_per_seg;
+		const char *method;
+		bool last;
+
+		result = &results[i];
+		if ((result->duration <= 0.0) || (result->bytes <= 0.0))
+			continue;
+		method = stress_vm_rw_sweep_methods[result->method];
+		(void)stress_uint64_to_str(seg_str, sizeof(seg_str), (uint64_t)result->seg_size);
+		if (result->method == VM_RW_SWEEP_MEMCPY)
+			(void)shim_strscpy(iov_str, "-", sizeof(iov_str));
+		else
+			(void)snprintf(iov_str, sizeof(iov_str), "%zu", result->iovecs);
+		gb_rate = (result->bytes / (double)GB) / result->duration;
+		syscalls_per_gb = result->syscalls / (result->bytes / (double)GB);
+		ns_per_seg = STRESS_DBL_NANOSECOND * result->duration / result->segments;
+		if (args->instance == 0)
+			pr_inf("%s: %-8s %8s %7s %10.3f %14.2f %12.2f\n", args->name,
+				method, seg_str, iov_str, gb_rate, syscalls_per_gb, ns_per_seg);
+
+		/* metrics for the largest iovec count of each segment size */
+		last = (i + 1 >= n_results) ||
+		       (results[i + 1].method != result->method) ||
+		       (results[i + 1].seg_size != result->seg_size);
+		if (!last || (metric + 2 > STRESS_STRESSOR_METRICS_MAX))
+			continue;
+		if (result->method == VM_RW_SWEEP_MEMCPY) {
+			(void)snprintf(str, sizeof(str), "%s %s GB per sec", method, seg_str);
+			stress_metrics_set(args, metric++, str, gb_rate, STRESS_HARMONIC_MEAN);
+			continue;
+		}
+		(void)snprintf(str, sizeof(str), "%s %s x %s GB per sec", method, seg_str, iov_str);
+		stress_metrics_set(args, metric++, str, gb_rate, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s %s x %s syscalls per GB", method, seg_str, iov_str);
+		stress_metrics_set(args, metric++, str, syscalls_per_gb, STRESS_GEOMETRIC_MEAN);
+	}
+
+reap:
+	(void)close(sweep.fd);
+	sweep.fd = -1;
+	fds_splice[1] = -1;
+	stress_kill_and_wait(args, sweep.pid, SIGKILL, false);
+close_ready:
+	if (fds_ready[0] >= 0)
+		(void)close(fds_ready[0]);
+	if (fds_ready[1] >= 0)
+		(void)close(fds_ready[1]);
+close_splice:
+	if (fds_splice[0] >= 0)
+		(void)close(fds_splice[0]);
+	if (fds_splice[1] >= 0)
+		(void)close(fds_splice[1]);
+unmap_sharedbuf:
+	(void)munmap((void *)sweep.sharedbuf, sz);
+unmap_remotebuf:
+	(void)munmap((void *)sweep.remotebuf, sz);
+unmap_localbuf:
+	(void)munmap((void *)sweep.localbuf, sz);
+free_results:
+	free(sweep.remote);
+	free(sweep.local);
+	free(results);
+
+	return rc;
+}
+
 /*
  *  stress_vm_rw
  *	stress vm_read_v/vm_write_v
@@ -369,6 +806,7 @@ static int stress_vm_rw(stress_args_t *args)
 	uint8_t stack[64*1024];
 	uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)stack, STACK_SIZE);
 	size_t vm_rw_bytes = DEFAULT_VM_RW_BYTES;
+	bool vm_rw_sweep = false;
 	int rc;
 
 	if (!stress_get_setting("vm-rw-bytes", &vm_rw_bytes)) {
@@ -377,6 +815,7 @@ static int stress_vm_rw(stress_args_t *args)
 		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
 			vm_rw_bytes = MIN_VM_RW_BYTES;
 	}
+	(void)stress_get_setting("vm-rw-sweep", &vm_rw_sweep);
 	vm_rw_bytes /= args->num_instances;
 	if (vm_rw_bytes < MIN_VM_RW_BYTES)
 		vm_rw_bytes = MIN_VM_RW_BYTES;
@@ -386,6 +825,9 @@ static int stress_vm_rw(stress_args_t *args)
 	ctxt.sz = vm_rw_bytes & ~(args->page_size - 1);
 	ctxt.iov_count = (ctxt.sz + CHUNK_SIZE - 1) / CHUNK_SIZE;
 
+	if (vm_rw_sweep)
+		return stress_vm_rw_sweep(args, ctxt.sz);
+
 	if (pipe(ctxt.pipe_wr) < 0) {
 		pr_fail("%s: pipe failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
@@ -28,9 +28,24 @@
 #include "core-nt-load.h"
 #include "core-nt-store.h"
 #include "core-out-of-memory.h"
+#include "core-perf.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 #include "core-vecmath.h"
 
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
+/*
+ *  --vm-threads needs per thread method state, the methods keep
+ *  their state between calls in THREAD_LOCAL statics
+ */
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_THREAD_LOCAL)
+#define HAVE_VM_THREADS
+#endif
+
 #define MIN_VM_BYTES		(4 * KB)
 #define MAX_VM_BYTES		(MAX_MEM_LIMIT)
 #define DEFAULT_VM_BYTES	(256 * MB)
@@ -47,6 +62,25 @@
 
 #define NO_MEM_RETRIES_MAX	(100)
 
+#define MIN_VM_THREADS		(1)
+#define MAX_VM_THREADS		(1024)
+#define DEFAULT_VM_THREADS	(1)
+
+#define VM_HUGEPAGE_NONE	(0)	/* small pages, THP disabled */
+#define VM_HUGEPAGE_THP		(1)	/* transparent huge pages */
+#define VM_HUGEPAGE_2M		(2)	/* 2MB hugetlbfs pages */
+#define VM_HUGEPAGE_1G		(3)	/* 1GB hugetlbfs pages */
+
+#define VM_DTLB_INVALID		(~0ULL)
+
+#if !defined(MAP_HUGE_2MB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_2MB    (21 << MAP_HUGE_SHIFT)
+#endif
+
+#if !defined(MAP_HUGE_1GB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_1GB    (30 << MAP_HUGE_SHIFT)
+#endif
+
 static size_t stress_vm_cache_line_size;
 
 /*
@@ -70,10 +104,27 @@ typedef struct {
 	const stress_vm_method_info_t *vm_method;
 } stress_vm_context_t;
 
+typedef struct {
+	const char *name;	/* --vm-hugepage name */
+	const int mode;		/* VM_HUGEPAGE_* mode */
+	const int flags;	/* extra mmap flags */
+	const size_t size;	/* huge page size, 0 for small pages */
+} stress_vm_hugepage_info_t;
+
+/* per method accounting */
+typedef struct {
+	double duration;	/* time exercising the mapping */
+	double bytes;		/* bytes of mapping exercised */
+	double huge_bytes;	/* bytes of mapping backed by huge pages */
+	double dtlb_misses;	/* user space dTLB load misses */
+	double dtlb_bytes;	/* bytes of mapping exercised with dTLB counts */
+} stress_vm_method_stats_t;
+
 static const stress_help_t help[] = {
 	{ "m N", "vm N",	 "start N workers spinning on anonymous mmap" },
 	{ NULL,	 "vm-bytes N",	 "allocate N bytes per vm worker (default 256MB)" },
 	{ NULL,	 "vm-hang N",	 "sleep N seconds before freeing memory" },
+	{ NULL,	 "vm-hugepage M", "back mapping with none, thp, 2m or 1g pages and report TLB metrics" },
 	{ NULL,	 "vm-keep",	 "redirty memory instead of reallocating" },
 #if defined(MAP_LOCKED)
 	{ NULL,	 "vm-locked",	 "lock the pages of the mapped region into memory" },
@@ -84,6 +135,7 @@ static const stress_help_t help[] = {
 #if defined(MAP_POPULATE)
 	{ NULL,	 "vm-populate",	 "populate (prefault) page tables for a mapping" },
 #endif
+	{ NULL,	 "vm-threads N", "run N threads per worker on slices of one shared mapping" },
 	{ NULL,	 NULL,		 NULL }
 };
 
@@ -123,6 +175,19 @@ static const stress_vm_madvise_info_t vm_madvise_info[] = {
 #endif
 };
 
+static const stress_vm_hugepage_info_t vm_hugepage_info[] = {
+	{ "none",	VM_HUGEPAGE_NONE,	0,	0 },
+	{ "thp",	VM_HUGEPAGE_THP,	0,	2 * MB },
+#if defined(MAP_HUGETLB) &&	\
+    defined(MAP_HUGE_2MB)
+	{ "2m",		VM_HUGEPAGE_2M,		MAP_HUGETLB | MAP_HUGE_2MB, 2 * MB },
+#endif
+#if defined(MAP_HUGETLB) &&	\
+    defined(MAP_HUGE_1GB)
+	{ "1g",		VM_HUGEPAGE_1G,		MAP_HUGETLB | MAP_HUGE_1GB, 1 * GB },
+#endif
+};
+
 /*
  *  stress_continue(args)
  *	returns true if we can keep on running a stressor
@@ -209,6 +274,31 @@ static int stress_set_vm_keep(const char *opt)
 	return stress_set_setting_true("vm-keep", opt);
 }
 
+static int stress_set_vm_hugepage(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(vm_hugepage_info); i++) {
+		if (!strcmp(opt, vm_hugepage_info[i].name))
+			return stress_set_setting("vm-hugepage", TYPE_ID_SIZE_T, &i);
+	}
+	(void)fprintf(stderr, "vm-hugepage must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(vm_hugepage_info); i++)
+		(void)fprintf(stderr, " %s", vm_hugepage_info[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_vm_threads(const char *opt)
+{
+	uint32_t vm_threads;
+
+	vm_threads = stress_get_uint32(opt);
+	stress_check_range("vm-threads", (uint64_t)vm_threads,
+		MIN_VM_THREADS, MAX_VM_THREADS);
+	return stress_set_setting("vm-threads", TYPE_ID_UINT32, &vm_threads);
+}
+
 #define SET_AND_TEST(ptr, val, bit_errors)	\
 do {						\
 	*ptr = val;				\
@@ -357,6 +447,90 @@ static inline size_t PURE stress_vm_count_bits(uint64_t v)
 #endif
 }
 
+#define VM_PATTERN_WORDS	(8)	/* 64 bit words in a verify pattern */
+#define VM_PATTERN_BLOCK	(4 * VM_PATTERN_WORDS * sizeof(uint64_t))
+
+#if defined(HAVE_VECMATH)
+typedef uint64_t stress_vm_v8u64_t __attribute__ ((vector_size(VM_PATTERN_WORDS * sizeof(uint64_t))));
+#endif
+
+static const uint64_t vm_pattern_zero[VM_PATTERN_WORDS] = {
+	0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL, 0ULL
+};
+
+static const uint64_t vm_pattern_one[VM_PATTERN_WORDS] = {
+	~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL
+};
+
+/*
+ *  stress_vm_pattern_errors_scalar()
+ *	count differing bits (bits true) or words between [ptr, end)
+ *	and a repeating pattern, ptr must be at the start of the pattern
+ */
+static size_t stress_vm_pattern_errors_scalar(
+	const uint8_t *ptr,
+	const uint8_t *end,
+	const uint64_t pattern[VM_PATTERN_WORDS],
+	const bool bits)
+{
+	size_t errors = 0, i = 0;
+
+	for (; ptr + sizeof(uint64_t) <= end; ptr += sizeof(uint64_t)) {
+		uint64_t diff;
+
+		(void)shim_memcpy(&diff, ptr, sizeof(diff));
+		diff ^= pattern[i];
+		errors += bits ? stress_vm_count_bits(diff) : (diff != 0);
+		i = (i + 1) & (VM_PATTERN_WORDS - 1);
+	}
+	return errors;
+}
+
+/*
+ *  stress_vm_pattern_errors()
+ *	count differing bits (bits true) or words between [buf, buf_end)
+ *	and a repeating pattern of 8 x 64 bit words. Blocks are compared
+ *	with vector xor/or and only blocks that differ are rescanned with
+ *	scalar code to count the exact errors. Returns early if the run
+ *	is stopped, callers check stress_continue_flag()
+ */
+static size_t OPTIMIZE3 TARGET_CLONES stress_vm_pattern_errors(
+	const void *buf,
+	const void *buf_end,
+	const uint64_t pattern[VM_PATTERN_WORDS],
+	const bool bits)
+{
+	register const uint8_t *ptr = (const uint8_t *)buf;
+	const uint8_t *end = (const uint8_t *)buf_end;
+	size_t errors = 0;
+#if defined(HAVE_VECMATH)
+	stress_vm_v8u64_t v;
+
+	(void)shim_memcpy(&v, pattern, sizeof(v));
+	while (ptr + VM_PATTERN_BLOCK <= end) {
+		stress_vm_v8u64_t v0, v1, v2, v3, diff;
+		uint64_t any = 0;
+		size_t i;
+
+		(void)shim_memcpy(&v0, ptr + (0 * sizeof(v)), sizeof(v));
+		(void)shim_memcpy(&v1, ptr + (1 * sizeof(v)), sizeof(v));
+		(void)shim_memcpy(&v2, ptr + (2 * sizeof(v)), sizeof(v));
+		(void)shim_memcpy(&v3, ptr + (3 * sizeof(v)), sizeof(v));
+		diff = (v0 ^ v) | (v1 ^ v) | (v2 ^ v) | (v3 ^ v);
+		for (i = 0; i < VM_PATTERN_WORDS; i++)
+			any |= diff[i];
+		if (UNLIKELY(any))
+			errors += stress_vm_pattern_errors_scalar(ptr, ptr + VM_PATTERN_BLOCK, pattern, bits);
+		ptr += VM_PATTERN_BLOCK;
+		if (UNLIKELY((((uintptr_t)ptr & 4095) == 0) && !stress_continue_flag()))
+			return errors;
+	}
+#endif
+	errors += stress_vm_pattern_errors_scalar(ptr, end, pattern, bits);
+
+	return errors;
+}
+
 /*
  *  stress_vm_moving_inversion()
  *	work sequentially through memory setting 8 bytes at a time
@@ -734,7 +908,7 @@ static size_t TARGET_CLONES OPTIMIZE3 stress_vm_gray(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static THREAD_LOCAL uint8_t val = 0;
 	register uint8_t v;
 	register uint8_t *ptr;
 	register size_t bit_errors = 0;
@@ -817,7 +991,7 @@ static size_t TARGET_CLONES stress_vm_grayflip(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static THREAD_LOCAL uint8_t val = 0;
 	uint8_t v;
 	register uint8_t *ptr;
 	size_t bit_errors = 0;
@@ -894,7 +1068,7 @@ static size_t TARGET_CLONES stress_vm_incdec(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static THREAD_LOCAL uint8_t val = 0;
 	register uint8_t *ptr;
 	size_t bit_errors = 0;
 	register uint64_t c = stress_bogo_get(args);
@@ -940,7 +1114,7 @@ static size_t TARGET_CLONES stress_vm_prime_incdec(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static THREAD_LOCAL uint8_t val = 0;
 	register uint8_t *ptr = buf;
 	size_t bit_errors = 0, i;
 	const uint64_t prime = stress_get_prime64(sz + 4096);
@@ -1399,7 +1573,6 @@ static size_t TARGET_CLONES stress_vm_zero_one(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	register uint64_t *ptr;
 	register uint64_t c = stress_bogo_get(args);
 	size_t bit_errors = 0;
 
@@ -1410,38 +1583,16 @@ static size_t TARGET_CLONES stress_vm_zero_one(
 	inject_random_bit_errors(buf, sz);
 	c += sz / 8;
 
-	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
-		bit_errors += stress_vm_count_bits(*(ptr + 0));
-		bit_errors += stress_vm_count_bits(*(ptr + 1));
-		bit_errors += stress_vm_count_bits(*(ptr + 2));
-		bit_errors += stress_vm_count_bits(*(ptr + 3));
-		bit_errors += stress_vm_count_bits(*(ptr + 4));
-		bit_errors += stress_vm_count_bits(*(ptr + 5));
-		bit_errors += stress_vm_count_bits(*(ptr + 6));
-		bit_errors += stress_vm_count_bits(*(ptr + 7));
-
-		if (UNLIKELY(!stress_continue_flag()))
-			goto abort;
-	}
+	bit_errors += stress_vm_pattern_errors(buf, buf_end, vm_pattern_zero, true);
+	if (UNLIKELY(!stress_continue_flag()))
+		goto abort;
 
 	(void)shim_memset(buf, 0xff, sz);
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 	c += sz / 8;
 
-	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
-		bit_errors += stress_vm_count_bits(~*(ptr + 0));
-		bit_errors += stress_vm_count_bits(~*(ptr + 1));
-		bit_errors += stress_vm_count_bits(~*(ptr + 2));
-		bit_errors += stress_vm_count_bits(~*(ptr + 3));
-		bit_errors += stress_vm_count_bits(~*(ptr + 4));
-		bit_errors += stress_vm_count_bits(~*(ptr + 5));
-		bit_errors += stress_vm_count_bits(~*(ptr + 6));
-		bit_errors += stress_vm_count_bits(~*(ptr + 7));
-
-		if (UNLIKELY(!stress_continue_flag()))
-			break;
-	}
+	bit_errors += stress_vm_pattern_errors(buf, buf_end, vm_pattern_one, true);
 	stress_vm_check("zero-one", bit_errors);
 abort:
 	stress_bogo_set(args, c);
@@ -1462,7 +1613,6 @@ static size_t TARGET_CLONES stress_vm_galpat_zero(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	register uint64_t *ptr;
 	size_t i, bit_errors = 0, bits_set = 0;
 	size_t bits_bad = sz / 4096;
 	register uint64_t c = stress_bogo_get(args);
@@ -1487,19 +1637,10 @@ static size_t TARGET_CLONES stress_vm_galpat_zero(
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
-	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
-		bits_set += stress_vm_count_bits(*(ptr + 0));
-		bits_set += stress_vm_count_bits(*(ptr + 1));
-		bits_set += stress_vm_count_bits(*(ptr + 2));
-		bits_set += stress_vm_count_bits(*(ptr + 3));
-		bits_set += stress_vm_count_bits(*(ptr + 4));
-		bits_set += stress_vm_count_bits(*(ptr + 5));
-		bits_set += stress_vm_count_bits(*(ptr + 6));
-		bits_set += stress_vm_count_bits(*(ptr + 7));
-		c++;
-		if (UNLIKELY(!stress_continue_flag()))
-			goto ret;
-	}
+	bits_set = stress_vm_pattern_errors(buf, buf_end, vm_pattern_zero, true);
+	c += sz / 64;
+	if (UNLIKELY(!stress_continue_flag()))
+		goto ret;
 
 	if (bits_set != bits_bad)
 		bit_errors += UNSIGNED_ABS(bits_set, bits_bad);
@@ -1526,7 +1667,6 @@ static size_t TARGET_CLONES stress_vm_galpat_one(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	register uint64_t *ptr;
 	size_t i, bit_errors = 0, bits_set = 0;
 	size_t bits_bad = sz / 4096;
 	register uint64_t c = stress_bogo_get(args);
@@ -1551,19 +1691,10 @@ static size_t TARGET_CLONES stress_vm_galpat_one(
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
-	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
-		bits_set += stress_vm_count_bits(~(*(ptr + 0)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 1)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 2)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 3)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 4)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 5)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 6)));
-		bits_set += stress_vm_count_bits(~(*(ptr + 7)));
-		c++;
-		if (UNLIKELY(!stress_continue_flag()))
-			goto ret;
-	}
+	bits_set = stress_vm_pattern_errors(buf, buf_end, vm_pattern_one, true);
+	c += sz / 64;
+	if (UNLIKELY(!stress_continue_flag()))
+		goto ret;
 
 	if (bits_set != bits_bad)
 		bit_errors += UNSIGNED_ABS(bits_set, bits_bad);
@@ -1589,7 +1720,7 @@ static size_t TARGET_CLONES stress_vm_inc_nybble(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint8_t val = 0;
+	static THREAD_LOCAL uint8_t val = 0;
 	register uint8_t *ptr;
 	size_t bit_errors = 0;
 	register uint64_t c = stress_bogo_get(args);
@@ -1755,7 +1886,7 @@ static size_t TARGET_CLONES stress_vm_prime_zero(
 	register uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr = (uint8_t *)buf + offset;
 
 #if SIZE_MAX > UINT32_MAX
@@ -1815,7 +1946,7 @@ static size_t TARGET_CLONES stress_vm_prime_one(
 	uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr = (uint8_t *)buf + offset;
 
 #if SIZE_MAX > UINT32_MAX
@@ -1875,7 +2006,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_zero(
 	register uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr = (uint8_t *)buf + offset;
 
 #if SIZE_MAX > UINT32_MAX
@@ -1935,7 +2066,7 @@ static size_t TARGET_CLONES stress_vm_prime_gray_one(
 	register uint64_t c = stress_bogo_get(args);
 	register uint8_t i = 0;
 	register size_t prime = 61; /* prime less than cache line size */
-	static size_t offset = 0;
+	static THREAD_LOCAL size_t offset = 0;
 	register uint8_t *ptr = (uint8_t *)buf + offset;
 
 #if SIZE_MAX > UINT32_MAX
@@ -1989,7 +2120,7 @@ static size_t OPTIMIZE3 TARGET_CLONES stress_vm_write64(
 	stress_args_t *args,
 	const uint64_t max_ops)
 {
-	static uint64_t val;
+	static THREAD_LOCAL uint64_t val;
 	register uint64_t *ptr = (uint64_t *)buf;
 	register const uint64_t v = val;
 	register size_t i = 0;
@@ -2087,7 +2218,7 @@ static size_t TARGET_CLONES stress_vm_write64nt(
 	const uint64_t max_ops)
 {
 	if (stress_cpu_x86_has_sse2()) {
-		static uint64_t val;
+		static THREAD_LOCAL uint64_t val;
 		register uint64_t *ptr = (uint64_t *)buf;
 		register const uint64_t v = val;
 		register size_t i = 0;
@@ -2232,7 +2363,7 @@ static size_t TARGET_CLONES stress_vm_write1024v(
 
 	stress_vint8w1024_t *ptr = (stress_vint8w1024_t *)buf;
 	stress_vint8w1024_t v;
-	static uint64_t val = 0;
+	static THREAD_LOCAL uint64_t val = 0;
 	uint64x16_t *vptr = (uint64x16_t *)&v;
 	register size_t i = 0;
 	register const size_t n = sz / sizeof(*ptr);
@@ -2283,7 +2414,7 @@ static size_t TARGET_CLONES stress_vm_rowhammer(
 {
 	size_t bit_errors = 0;
 	uint32_t *buf32 = (uint32_t *)buf;
-	static uint32_t val = 0xff5a00a5;
+	static THREAD_LOCAL uint32_t val = 0xff5a00a5;
 	register size_t j;
 	register volatile uint32_t *addr0, *addr1;
 	register size_t errors = 0;
@@ -2691,7 +2822,7 @@ static size_t TARGET_CLONES stress_vm_cache_lines(
 	size_t bit_errors = 0;
 	register uint64_t c = stress_bogo_get(args);
 	uint8_t i;
-	static size_t offset = 0;
+	static THREAD_LOCAL size_t offset = 0;
 
 	for (i = 0, ptr = (uint8_t *)buf + offset; ptr < (uint8_t *)buf_end; ptr += stress_vm_cache_line_size) {
 		*ptr = i++;
@@ -3065,6 +3196,8 @@ static size_t TARGET_CLONES stress_vm_checkerboard(
 	const uint64_t v5 = 0xaa55aa55aa55aa55ULL;
 	const uint64_t v6 = 0x5a5a5a5a5a5a5a5aULL;
 	const uint64_t v7 = 0xa5a5a5a5a5a5a5a5ULL;
+	/* layout after the swaps */
+	const uint64_t pattern[VM_PATTERN_WORDS] = { v1, v0, v3, v2, v5, v4, v7, v6 };
 
 	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
 		if (UNLIKELY(!stress_continue_flag()))
@@ -3119,21 +3252,12 @@ static size_t TARGET_CLONES stress_vm_checkerboard(
 	(void)stress_mincore_touch_pages(buf, sz);
 	inject_random_bit_errors(buf, sz);
 
-	for (ptr = (uint64_t *)buf; ptr < (uint64_t *)buf_end; ptr += 8) {
-		if (UNLIKELY(!stress_continue_flag()))
-			return 0;
-		bit_errors += (*(ptr + 0) != v1);
-		bit_errors += (*(ptr + 1) != v0);
-		bit_errors += (*(ptr + 2) != v3);
-		bit_errors += (*(ptr + 3) != v2);
-		bit_errors += (*(ptr + 4) != v5);
-		bit_errors += (*(ptr + 5) != v4);
-		bit_errors += (*(ptr + 6) != v7);
-		bit_errors += (*(ptr + 7) != v6);
-		c++;
-		if (UNLIKELY(max_ops && (c >= max_ops)))
-			break;
-	}
+	bit_errors = stress_vm_pattern_errors(buf, buf_end, pattern, false);
+	if (UNLIKELY(!stress_continue_flag()))
+		return 0;
+	c += sz / 64;
+	if (UNLIKELY(max_ops && (c >= max_ops)))
+		c = max_ops;
 
 	stress_vm_check("checkerboard", bit_errors);
 	stress_bogo_set(args, c);
@@ -3239,6 +3363,336 @@ static int stress_set_vm_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_vm_dtlb_open()
+ *	open a user space dTLB load miss counter on the
+ *	calling thread, -1 if not available
+ */
+static int stress_vm_dtlb_open(void)
+{
+#if defined(STRESS_PERF_STATS)
+	return stress_perf_hw_cache_open(PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+	return -1;
+#endif
+}
+
+/*
+ *  stress_vm_dtlb_read()
+ *	read a dTLB miss counter, VM_DTLB_INVALID if not available
+ */
+static uint64_t stress_vm_dtlb_read(const int fd)
+{
+#if defined(STRESS_PERF_STATS)
+	const uint64_t misses = stress_perf_hw_read(fd);
+
+	return (misses == STRESS_PERF_INVALID) ? VM_DTLB_INVALID : misses;
+#else
+	(void)fd;
+
+	return VM_DTLB_INVALID;
+#endif
+}
+
+/*
+ *  stress_vm_dtlb_delta()
+ *	dTLB misses since start, VM_DTLB_INVALID if not available
+ */
+static uint64_t stress_vm_dtlb_delta(const int fd, const uint64_t start)
+{
+	uint64_t end;
+
+	if (start == VM_DTLB_INVALID)
+		return VM_DTLB_INVALID;
+	end = stress_vm_dtlb_read(fd);
+	if (end == VM_DTLB_INVALID)
+		return VM_DTLB_INVALID;
+	return end - start;
+}
+
+/*
+ *  stress_vm_mmap()
+ *	mmap the vm buffer, the 2m and 1g huge page modes map
+ *	hugetlbfs pages, the thp mode maps a huge page aligned
+ *	region advised for transparent huge pages
+ */
+static void *stress_vm_mmap(
+	const size_t buf_sz,
+	const int vm_flags,
+	const stress_vm_hugepage_info_t *hugepage)
+{
+	const int flags = MAP_PRIVATE | MAP_ANONYMOUS | vm_flags;
+	uint8_t *buf;
+
+	if (!hugepage)
+		return mmap(NULL, buf_sz, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+	if (hugepage->mode == VM_HUGEPAGE_THP) {
+		uintptr_t aligned;
+		size_t head, tail;
+
+		/* over allocate so the region can be huge page aligned, then trim */
+		buf = (uint8_t *)mmap(NULL, buf_sz + hugepage->size,
+			PROT_READ | PROT_WRITE, flags, -1, 0);
+		if (buf == MAP_FAILED)
+			return MAP_FAILED;
+		aligned = ((uintptr_t)buf + hugepage->size - 1) & ~(uintptr_t)(hugepage->size - 1);
+		head = (size_t)(aligned - (uintptr_t)buf);
+		tail = hugepage->size - head;
+		if (head)
+			(void)munmap((void *)buf, head);
+		if (tail)
+			(void)munmap((void *)(aligned + buf_sz), tail);
+#if defined(MADV_HUGEPAGE)
+		(void)shim_madvise((void *)aligned, buf_sz, MADV_HUGEPAGE);
+#endif
+		return (void *)aligned;
+	}
+
+	buf = (uint8_t *)mmap(NULL, buf_sz, PROT_READ | PROT_WRITE,
+		flags | hugepage->flags, -1, 0);
+#if defined(MADV_NOHUGEPAGE)
+	if ((buf != MAP_FAILED) && (hugepage->mode == VM_HUGEPAGE_NONE))
+		(void)shim_madvise((void *)buf, buf_sz, MADV_NOHUGEPAGE);
+#endif
+	return (void *)buf;
+}
+
+/*
+ *  stress_vm_huge_bytes()
+ *	number of bytes of the mapping backed by huge pages
+ */
+static size_t stress_vm_huge_bytes(
+	const void *buf,
+	const size_t buf_sz,
+	const stress_vm_hugepage_info_t *hugepage)
+{
+	size_t huge_bytes;
+
+	if ((hugepage->mode == VM_HUGEPAGE_2M) || (hugepage->mode == VM_HUGEPAGE_1G))
+		huge_bytes = stress_smaps_field(buf, "Private_Hugetlb");
+	else
+		huge_bytes = stress_smaps_field(buf, "AnonHugePages");
+
+	return STRESS_MINIMUM(huge_bytes, buf_sz);
+}
+
+#if defined(HAVE_VM_THREADS)
+/*
+ *  Threaded mode, --vm-threads K threads of a worker share one
+ *  vm-bytes mapping, each exercising the method on its own page
+ *  aligned slice. A fresh mapping is first touched concurrently
+ *  by all the threads, so page faults contend on the mmap lock
+ */
+typedef struct {
+	pthread_mutex_t		lock;		/* protects the fields below */
+	pthread_cond_t		start;		/* new round for the threads */
+	pthread_cond_t		done;		/* all slices completed */
+	uint64_t		generation;	/* round number */
+	size_t			remaining;	/* slices still to complete */
+	bool			stop;		/* threads should exit */
+	stress_vm_func		func;		/* method of the round */
+	uint8_t			*buf;		/* shared mapping */
+	size_t			buf_sz;		/* size of shared mapping */
+	uint64_t		max_ops;	/* per thread bogo op limit */
+	bool			dtlb;		/* count dTLB misses */
+} stress_vm_threads_t;
+
+typedef struct {
+	stress_args_t		args;		/* copy with a private bogo counter */
+	stress_vm_threads_t	*threads;	/* shared round state */
+	pthread_t		pthread;	/* thread handle */
+	int			ret;		/* pthread_create return */
+	size_t			index;		/* slice index */
+	size_t			n_threads;	/* number of slices */
+	size_t			bit_errors;	/* bit errors of the last round */
+	uint64_t		counter;	/* bogo ops already accounted for */
+	uint64_t		dtlb_misses;	/* dTLB misses of the last round */
+} stress_vm_thread_t;
+
+/*
+ *  stress_vm_thread()
+ *	wait for each new round and exercise this thread's slice
+ */
+static void *stress_vm_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_vm_thread_t *thread = (stress_vm_thread_t *)arg;
+	stress_vm_threads_t *threads = thread->threads;
+	const size_t page_size = thread->args.page_size;
+	uint64_t generation = 0;
+	sigset_t set;
+	int perf_fd;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	stress_mwc_reseed();
+	perf_fd = threads->dtlb ? stress_vm_dtlb_open() : -1;
+
+	for (;;) {
+		stress_vm_func func;
+		uint8_t *buf;
+		size_t pages, lo, hi, bit_errors = 0;
+		uint64_t dtlb_start;
+
+		(void)pthread_mutex_lock(&threads->lock);
+		while (!threads->stop && (threads->generation == generation))
+			(void)pthread_cond_wait(&threads->start, &threads->lock);
+		if (threads->stop) {
+			(void)pthread_mutex_unlock(&threads->lock);
+			break;
+		}
+		generation = threads->generation;
+		func = threads->func;
+		buf = threads->buf;
+		pages = threads->buf_sz / page_size;
+		(void)pthread_mutex_unlock(&threads->lock);
+
+		lo = ((thread->index * pages) / thread->n_threads) * page_size;
+		hi = (((thread->index + 1) * pages) / thread->n_threads) * page_size;
+		dtlb_start = (perf_fd >= 0) ? stress_vm_dtlb_read(perf_fd) : VM_DTLB_INVALID;
+		if (hi > lo) {
+			(void)stress_mincore_touch_pages(buf + lo, hi - lo);
+			bit_errors = func(buf + lo, buf + hi, hi - lo, &thread->args, threads->max_ops);
+		}
+
+		(void)pthread_mutex_lock(&threads->lock);
+		thread->bit_errors = bit_errors;
+		thread->dtlb_misses = stress_vm_dtlb_delta(perf_fd, dtlb_start);
+		threads->remaining--;
+		if (threads->remaining == 0)
+			(void)pthread_cond_signal(&threads->done);
+		(void)pthread_mutex_unlock(&threads->lock);
+	}
+	if (perf_fd >= 0)
+		(void)close(perf_fd);
+	return &nowt;
+}
+
+/*
+ *  stress_vm_threads_round()
+ *	run func over the shared mapping buf with all the threads,
+ *	account the bogo ops of the threads, sum the dTLB misses
+ *	into dtlb_misses and return the total number of bit errors
+ */
+static size_t stress_vm_threads_round(
+	stress_args_t *args,
+	stress_vm_threads_t *threads,
+	stress_vm_thread_t *thread,
+	const size_t n_threads,
+	const stress_vm_func func,
+	uint8_t *buf,
+	const size_t buf_sz,
+	uint64_t *dtlb_misses)
+{
+	size_t i, bit_errors = 0;
+	uint64_t ops = 0;
+
+	*dtlb_misses = 0;
+
+	(void)pthread_mutex_lock(&threads->lock);
+	threads->func = func;
+	threads->buf = buf;
+	threads->buf_sz = buf_sz;
+	threads->remaining = n_threads;
+	threads->generation++;
+	(void)pthread_cond_broadcast(&threads->start);
+	while (threads->remaining > 0)
+		(void)pthread_cond_wait(&threads->done, &threads->lock);
+	(void)pthread_mutex_unlock(&threads->lock);
+
+	for (i = 0; i < n_threads; i++) {
+		const uint64_t counter = stress_bogo_get(&thread[i].args);
+
+		ops += counter - thread[i].counter;
+		thread[i].counter = counter;
+		bit_errors += thread[i].bit_errors;
+		if ((thread[i].dtlb_misses == VM_DTLB_INVALID) || (*dtlb_misses == VM_DTLB_INVALID))
+			*dtlb_misses = VM_DTLB_INVALID;
+		else
+			*dtlb_misses += thread[i].dtlb_misses;
+	}
+	stress_bogo_add(args, ops);
+
+	return bit_errors;
+}
+
+/*
+ *  stress_vm_threads_stop()
+ *	stop and reap the first started threads
+ */
+static void stress_vm_threads_stop(
+	stress_vm_threads_t *threads,
+	stress_vm_thread_t *thread,
+	const size_t started)
+{
+	size_t i;
+
+	(void)pthread_mutex_lock(&threads->lock);
+	threads->stop = true;
+	(void)pthread_cond_broadcast(&threads->start);
+	(void)pthread_mutex_unlock(&threads->lock);
+	for (i = 0; i < started; i++)
+		(void)pthread_join(thread[i].pthread, NULL);
+	(void)pthread_cond_destroy(&threads->done);
+	(void)pthread_cond_destroy(&threads->start);
+	(void)pthread_mutex_destroy(&threads->lock);
+}
+#endif
+
+/*
+ *  stress_vm_report()
+ *	report per method rates, huge page coverage and dTLB
+ *	misses of the --vm-hugepage mode
+ */
+static void stress_vm_report(
+	stress_args_t *args,
+	const stress_vm_method_stats_t *stats,
+	const stress_vm_hugepage_info_t *hugepage,
+	size_t metric)
+{
+	const size_t n_methods = SIZEOF_ARRAY(vm_methods);
+	double bytes = 0.0, huge_bytes = 0.0;
+	size_t i;
+
+	if (args->instance == 0)
+		pr_inf("%s: %-14s %8s %8s %16s (%s pages)\n", args->name,
+			"method", "GB/s", "huge %", "dTLB misses/MB", hugepage->name);
+	for (i = 1; i < n_methods; i++) {
+		const stress_vm_method_stats_t *stat = &stats[i];
+		char dtlb[32];
+
+		if ((stat->duration <= 0.0) || (stat->bytes <= 0.0))
+			continue;
+		bytes += stat->bytes;
+		huge_bytes += stat->huge_bytes;
+		if (stat->dtlb_bytes > 0.0) {
+			const double per_mb = stat->dtlb_misses / (stat->dtlb_bytes / (double)MB);
+			char msg[64];
+
+			(void)snprintf(dtlb, sizeof(dtlb), "%16.2f", per_mb);
+			(void)snprintf(msg, sizeof(msg), "%s dTLB misses per MB", vm_methods[i].name);
+			stress_metrics_set(args, metric++, msg, per_mb, STRESS_GEOMETRIC_MEAN);
+		} else {
+			(void)snprintf(dtlb, sizeof(dtlb), "%16s", "n/a");
+		}
+		if (args->instance == 0)
+			pr_inf("%s: %-14s %8.2f %8.2f %s\n", args->name, vm_methods[i].name,
+				stat->bytes / stat->duration / 1.0E9,
+				100.0 * stat->huge_bytes / stat->bytes, dtlb);
+	}
+	if (bytes > 0.0)
+		stress_metrics_set(args, metric, "huge page coverage %",
+			100.0 * huge_bytes / bytes, STRESS_GEOMETRIC_MEAN);
+}
+
 static int stress_vm_child(stress_args_t *args, void *ctxt)
 {
 	int no_mem_retries = 0;
@@ -3248,12 +3702,24 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	int vm_flags = 0;                      /* VM mmap flags */
 	int vm_madvise = -1;
 	int rc = EXIT_SUCCESS;
-	size_t buf_sz;
+	int dtlb_fd = -1;
+	size_t buf_sz, i, metric = 0;
 	size_t vm_bytes = DEFAULT_VM_BYTES;
+	size_t vm_hugepage = SIZEOF_ARRAY(vm_hugepage_info);
 	const size_t page_size = args->page_size;
+	const size_t n_methods = SIZEOF_ARRAY(vm_methods);
 	bool vm_keep = false;
 	stress_vm_context_t *context = (stress_vm_context_t *)ctxt;
-	const stress_vm_func func = context->vm_method->func;
+	const bool vm_all = (context->vm_method == &vm_methods[0]);
+	size_t method = vm_all ? 1 : (size_t)(context->vm_method - vm_methods);
+	const stress_vm_hugepage_info_t *hugepage = NULL;
+	stress_vm_method_stats_t stats[SIZEOF_ARRAY(vm_methods)];
+	uint32_t vm_threads = DEFAULT_VM_THREADS;
+#if defined(HAVE_VM_THREADS)
+	stress_vm_threads_t threads;
+	stress_vm_thread_t *thread = NULL;
+	size_t started = 0;
+#endif
 
 	stress_catch_sigill();
 
@@ -3272,8 +3738,79 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 		vm_bytes = MIN_VM_BYTES;
 	buf_sz = vm_bytes & ~(page_size - 1);
 	(void)stress_get_setting("vm-madvise", &vm_madvise);
+	(void)stress_get_setting("vm-threads", &vm_threads);
+	(void)stress_get_setting("vm-hugepage", &vm_hugepage);
+
+	if (vm_hugepage < SIZEOF_ARRAY(vm_hugepage_info)) {
+		hugepage = &vm_hugepage_info[vm_hugepage];
+		/* whole huge pages only */
+		if (hugepage->size)
+			buf_sz = (buf_sz + hugepage->size - 1) & ~(hugepage->size - 1);
+		if ((vm_madvise >= 0) && (args->instance == 0))
+			pr_inf("%s: --vm-hugepage overrides --vm-madvise\n", args->name);
+		dtlb_fd = stress_vm_dtlb_open();
+		if ((dtlb_fd < 0) && (args->instance == 0))
+			pr_inf("%s: dTLB miss counter not available, dTLB misses will not be reported\n",
+				args->name);
+		if (args->instance == 0)
+			pr_dbg("%s: %zuK mapping using %s pages\n",
+				args->name, buf_sz / 1024, hugepage->name);
+	}
+	(void)shim_memset(stats, 0, sizeof(stats));
+
+	if (vm_threads > 1) {
+#if defined(HAVE_VM_THREADS)
+		/* at least a page per thread */
+		vm_threads = (uint32_t)STRESS_MINIMUM((size_t)vm_threads, buf_sz / page_size);
+
+		thread = (stress_vm_thread_t *)calloc((size_t)vm_threads, sizeof(*thread));
+		if (!thread) {
+			pr_inf_skip("%s: failed to allocate %" PRIu32 " thread states, skipping stressor\n",
+				args->name, vm_threads);
+			rc = EXIT_NO_RESOURCE;
+			goto tidy_dtlb;
+		}
+		(void)shim_memset(&threads, 0, sizeof(threads));
+		threads.max_ops = max_ops ? (max_ops + vm_threads - 1) / vm_threads : 0;
+		/* the threads count their own dTLB misses */
+		threads.dtlb = (dtlb_fd >= 0);
+		(void)pthread_mutex_init(&threads.lock, NULL);
+		(void)pthread_cond_init(&threads.start, NULL);
+		(void)pthread_cond_init(&threads.done, NULL);
+
+		for (i = 0; i < (size_t)vm_threads; i++) {
+			thread[i].args = *args;
+			thread[i].args.ci.counter = 0;
+			thread[i].args.ops_rate = NULL;	/* paced by the worker */
+			thread[i].threads = &threads;
+			thread[i].index = i;
+			thread[i].n_threads = (size_t)vm_threads;
+			thread[i].ret = pthread_create(&thread[i].pthread, NULL,
+				stress_vm_thread, (void *)&thread[i]);
+			if (thread[i].ret) {
+				pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+					args->name, thread[i].ret, strerror(thread[i].ret));
+				stress_vm_threads_stop(&threads, thread, started);
+				free(thread);
+				rc = EXIT_NO_RESOURCE;
+				goto tidy_dtlb;
+			}
+			started++;
+		}
+		if (args->instance == 0)
+			pr_dbg("%s: %" PRIu32 " threads sharing a %zuK mapping\n",
+				args->name, vm_threads, buf_sz / 1024);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: threads not supported, ignoring --vm-threads\n", args->name);
+		vm_threads = 1;
+#endif
+	}
 
 	do {
+		uint64_t dtlb_misses = VM_DTLB_INVALID;
+		double t;
+
 		if (no_mem_retries >= NO_MEM_RETRIES_MAX) {
 			pr_inf_skip("%s: gave up trying to mmap, no available memory, skipping stressor\n",
 				args->name);
@@ -3282,31 +3819,71 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 		}
 		if (!vm_keep || (buf == NULL)) {
 			if (!stress_continue_flag())
-				return EXIT_SUCCESS;
+				break;
 			if ((g_opt_flags & OPT_FLAGS_OOM_AVOID) && stress_low_memory(buf_sz)) {
 				buf = MAP_FAILED;
 			} else {
-				buf = (uint8_t *)mmap(NULL, buf_sz,
-					PROT_READ | PROT_WRITE,
-					MAP_PRIVATE | MAP_ANONYMOUS |
-					vm_flags, -1, 0);
+				buf = stress_vm_mmap(buf_sz, vm_flags, hugepage);
 			}
 			if (buf == MAP_FAILED) {
 				buf = NULL;
+				if (hugepage && hugepage->flags) {
+					/* hugetlbfs pages are reserved up front, retrying will not help */
+					pr_inf_skip("%s: cannot mmap %zuK of %s huge pages, errno=%d (%s), "
+						"check /proc/sys/vm/nr_hugepages, skipping stressor\n",
+						args->name, buf_sz / 1024, hugepage->name, errno, strerror(errno));
+					rc = EXIT_NO_RESOURCE;
+					break;
+				}
 				no_mem_retries++;
 				(void)shim_usleep(100000);
 				continue;	/* Try again */
 			}
 			buf_end = (void *)((uint8_t *)buf + buf_sz);
-			if (vm_madvise < 0)
-				(void)stress_madvise_random(buf, buf_sz);
-			else
-				(void)shim_madvise(buf, buf_sz, vm_madvise);
+			if (!hugepage) {
+				if (vm_madvise < 0)
+					(void)stress_madvise_random(buf, buf_sz);
+				else
+					(void)shim_madvise(buf, buf_sz, vm_madvise);
+			}
 		}
 
 		no_mem_retries = 0;
-		(void)stress_mincore_touch_pages(buf, buf_sz);
-		*(context->bit_error_count) += func(buf, buf_end, buf_sz, args, max_ops);
+		t = stress_time_now();
+#if defined(HAVE_VM_THREADS)
+		if (thread) {
+			*(context->bit_error_count) += stress_vm_threads_round(args, &threads,
+				thread, (size_t)vm_threads, vm_methods[method].func, buf, buf_sz,
+				&dtlb_misses);
+		} else
+#endif
+		{
+			const uint64_t dtlb_start = (dtlb_fd >= 0) ?
+				stress_vm_dtlb_read(dtlb_fd) : VM_DTLB_INVALID;
+
+			(void)stress_mincore_touch_pages(buf, buf_sz);
+			*(context->bit_error_count) += vm_methods[method].func(buf, buf_end, buf_sz, args, max_ops);
+			dtlb_misses = stress_vm_dtlb_delta(dtlb_fd, dtlb_start);
+		}
+		/* ignore rounds cut short by the end of the run */
+		if (stress_continue_flag()) {
+			stress_vm_method_stats_t *stat = &stats[method];
+
+			stat->duration += stress_time_now() - t;
+			stat->bytes += (double)buf_sz;
+			if (hugepage) {
+				stat->huge_bytes += (double)stress_vm_huge_bytes(buf, buf_sz, hugepage);
+				if (dtlb_misses != VM_DTLB_INVALID) {
+					stat->dtlb_misses += (double)dtlb_misses;
+					stat->dtlb_bytes += (double)buf_sz;
+				}
+			}
+		}
+		if (vm_all) {
+			method++;
+			if (method >= n_methods)
+				method = 1;
+		}
 
 		if (vm_hang == 0) {
 			while (stress_continue_vm(args)) {
@@ -3317,7 +3894,8 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 		}
 
 		if (!vm_keep) {
-			(void)stress_madvise_random(buf, buf_sz);
+			if (!hugepage)
+				(void)stress_madvise_random(buf, buf_sz);
 			(void)stress_munmap_retry_enomem(buf, buf_sz);
 		}
 	} while (stress_continue_vm(args));
@@ -3325,6 +3903,30 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	if (vm_keep && (buf != NULL))
 		(void)stress_munmap_retry_enomem((void *)buf, buf_sz);
 
+#if defined(HAVE_VM_THREADS)
+	if (thread) {
+		stress_vm_threads_stop(&threads, thread, started);
+		free(thread);
+
+		for (i = 1; i < n_methods; i++) {
+			char msg[64];
+
+			if (stats[i].duration <= 0.0)
+				continue;
+			(void)snprintf(msg, sizeof(msg), "%s aggregate GB/s", vm_methods[i].name);
+			stress_metrics_set(args, metric++, msg,
+				stats[i].bytes / stats[i].duration / 1.0E9, STRESS_HARMONIC_MEAN);
+		}
+	}
+#endif
+	if (hugepage && (rc == EXIT_SUCCESS))
+		stress_vm_report(args, stats, hugepage, metric);
+#if defined(HAVE_VM_THREADS)
+tidy_dtlb:
+#endif
+	if (dtlb_fd >= 0)
+		(void)close(dtlb_fd);
+
 	return rc;
 }
 
@@ -3429,11 +4031,13 @@ static void stress_vm_set_default(void)
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_vm_bytes,		stress_set_vm_bytes },
 	{ OPT_vm_hang,		stress_set_vm_hang },
+	{ OPT_vm_hugepage,	stress_set_vm_hugepage },
 	{ OPT_vm_keep,		stress_set_vm_keep },
 	{ OPT_vm_madvise,	stress_set_vm_madvise },
 	{ OPT_vm_method,	stress_set_vm_method },
 	{ OPT_vm_mmap_locked,	stress_set_vm_mmap_locked },
 	{ OPT_vm_mmap_populate,	stress_set_vm_mmap_populate },
+	{ OPT_vm_threads,	stress_set_vm_threads },
 	{ 0,			NULL }
 };
 
@@ -85,6 +85,7 @@ typedef struct {
 	const uint32_t			 vnni_checksum_le;	/* little endian */
 	const uint32_t			 vnni_checksum_be;	/* big endian */
 	const bool			 vnni_intrinsic;	/* uses intrinsics */
+	const double			 vnni_ops;		/* int/fp ops per call, 0 = no TOPS */
 	bool				 vnni_capable;		/* is capable */
 	double				 count;			/* usage count */
 	double				 duration;		/* usage duration */
@@ -373,6 +374,266 @@ static void TARGET_CLONES OPTIMIZE3 stress_vnni_vpdpwssd(stress_args_t *args)
 	}
 }
 
+/*
+ *  AMX tile multiply, C[M][N] += A[M][K] * B[K][N] repeated
+ *  VEC_AMX_ITERS times, A is a_init (4 rows x 64 bytes), B is
+ *  b_amx (16 rows x 64 bytes) and C is the 256 byte result
+ */
+#define VEC_AMX_M		(4)	/* rows of A and C */
+#define VEC_AMX_ROW_BYTES	(64)	/* bytes per tile row */
+#define VEC_AMX_K_ROWS		(16)	/* rows of B */
+#define VEC_AMX_ITERS		(32)	/* tile multiplies per call */
+#define VEC_AMX_INT8_OPS	(2.0 * VEC_AMX_M * 16 * 64 * VEC_AMX_ITERS)
+#define VEC_AMX_BF16_OPS	(2.0 * VEC_AMX_M * 16 * 32 * VEC_AMX_ITERS)
+
+static uint8_t b_amx[VEC_AMX_K_ROWS * VEC_AMX_ROW_BYTES] ALIGNED(64);
+static uint16_t a_bf16[VEC_AMX_M * 32] ALIGNED(64);
+static uint16_t b_bf16[VEC_AMX_K_ROWS * 32] ALIGNED(64);
+static float c_f32[VEC_AMX_M * 16] ALIGNED(64);
+
+/*
+ *  stress_vnni_bf16()
+ *	convert float to bf16 by truncation, exact for small integers
+ */
+static inline uint16_t stress_vnni_bf16(const float f)
+{
+	uint32_t val;
+
+	(void)shim_memcpy(&val, &f, sizeof(val));
+	return (uint16_t)(val >> 16);
+}
+
+/*
+ *  stress_vnni_bf16_to_float()
+ *	convert bf16 to float
+ */
+static inline float stress_vnni_bf16_to_float(const uint16_t bf16)
+{
+	const uint32_t val = (uint32_t)bf16 << 16;
+	float f;
+
+	(void)shim_memcpy(&f, &val, sizeof(f));
+	return f;
+}
+
+/*
+ *  stress_vnni_amx_init()
+ *	set up the AMX tile data, the bf16 values are small integers
+ *	so all products and sums are exact in any summation order
+ */
+static void stress_vnni_amx_init(void)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(b_amx); i++)
+		b_amx[i] = (uint8_t)(b_init[i % VEC_SIZE_BYTES] + (i / VEC_SIZE_BYTES));
+	for (i = 0; i < SIZEOF_ARRAY(a_bf16); i++)
+		a_bf16[i] = stress_vnni_bf16((float)((int8_t)a_init[i] >> 2));
+	for (i = 0; i < SIZEOF_ARRAY(b_bf16); i++)
+		b_bf16[i] = stress_vnni_bf16((float)((int8_t)b_amx[i] >> 2));
+	for (i = 0; i < SIZEOF_ARRAY(c_f32); i++)
+		c_f32[i] = (float)((int8_t)c_init[i] >> 2);
+}
+
+/*
+ *  stress_vnni_put_le32()
+ *	store 32 bit results in little endian order so the generic
+ *	tile checksums are the same on all architectures
+ */
+static inline void stress_vnni_put_le32(uint8_t *ptr, const uint32_t val)
+{
+	ptr[0] = (uint8_t)(val >> 0);
+	ptr[1] = (uint8_t)(val >> 8);
+	ptr[2] = (uint8_t)(val >> 16);
+	ptr[3] = (uint8_t)(val >> 24);
+}
+
+static void TARGET_CLONES OPTIMIZE3 stress_vnni_tdpbusd(stress_args_t *args)
+{
+	uint32_t c[VEC_AMX_M][16];
+	register int i, m, n, k;
+
+	(void)args;
+
+	for (m = 0; m < VEC_AMX_M; m++) {
+		for (n = 0; n < 16; n++) {
+			const uint8_t *ptr = &c_init[(m * 64) + (n * 4)];
+
+			c[m][n] = (uint32_t)ptr[0] | ((uint32_t)ptr[1] << 8) |
+				  ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 24);
+		}
+	}
+	for (i = 0; i < VEC_AMX_ITERS; i++) {
+		for (m = 0; m < VEC_AMX_M; m++) {
+			const uint8_t *a = &a_init[m * VEC_AMX_ROW_BYTES];
+
+			for (k = 0; k < VEC_AMX_K_ROWS; k++) {
+				const uint8_t *b = &b_amx[k * VEC_AMX_ROW_BYTES];
+
+				for (n = 0; n < 16; n++) {
+					c[m][n] += (uint32_t)(
+						((int32_t)a[(k * 4) + 0] * (int32_t)(int8_t)b[(n * 4) + 0]) +
+						((int32_t)a[(k * 4) + 1] * (int32_t)(int8_t)b[(n * 4) + 1]) +
+						((int32_t)a[(k * 4) + 2] * (int32_t)(int8_t)b[(n * 4) + 2]) +
+						((int32_t)a[(k * 4) + 3] * (int32_t)(int8_t)b[(n * 4) + 3]));
+				}
+			}
+		}
+	}
+	for (m = 0; m < VEC_AMX_M; m++) {
+		for (n = 0; n < 16; n++)
+			stress_vnni_put_le32(&result[(m * 64) + (n * 4)], c[m][n]);
+	}
+}
+
+static void TARGET_CLONES OPTIMIZE3 stress_vnni_tdpbf16ps(stress_args_t *args)
+{
+	float c[VEC_AMX_M][16];
+	register int i, m, n, k;
+
+	(void)args;
+
+	(void)shim_memcpy(c, c_f32, sizeof(c));
+	for (i = 0; i < VEC_AMX_ITERS; i++) {
+		for (m = 0; m < VEC_AMX_M; m++) {
+			const uint16_t *a = &a_bf16[m * 32];
+
+			for (k = 0; k < VEC_AMX_K_ROWS; k++) {
+				const uint16_t *b = &b_bf16[k * 32];
+
+				for (n = 0; n < 16; n++) {
+					c[m][n] += (stress_vnni_bf16_to_float(a[(k * 2) + 0]) *
+						    stress_vnni_bf16_to_float(b[(n * 2) + 0])) +
+						   (stress_vnni_bf16_to_float(a[(k * 2) + 1]) *
+						    stress_vnni_bf16_to_float(b[(n * 2) + 1]));
+				}
+			}
+		}
+	}
+	for (m = 0; m < VEC_AMX_M; m++) {
+		for (n = 0; n < 16; n++) {
+			uint32_t val;
+
+			(void)shim_memcpy(&val, &c[m][n], sizeof(val));
+			stress_vnni_put_le32(&result[(m * 64) + (n * 4)], val);
+		}
+	}
+}
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(__linux__) &&		\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    (defined(HAVE_TILE_DPBUSD) ||	\
+     defined(HAVE_TILE_DPBF16PS))
+#define HAVE_STRESS_VNNI_AMX
+
+#if !defined(ARCH_REQ_XCOMP_PERM)
+#define ARCH_REQ_XCOMP_PERM	(0x1023)
+#endif
+#define XFEATURE_XTILEDATA	(18)
+
+/* AMX tile configuration, palette 1 */
+typedef struct {
+	uint8_t palette_id;
+	uint8_t start_row;
+	uint8_t reserved[14];
+	uint16_t colsb[16];
+	uint8_t rows[16];
+} stress_vnni_tile_config_t;
+
+/*
+ *  stress_vnni_amx_config()
+ *	tile 0 = C (M rows), tile 1 = A (M rows), tile 2 = B (K rows)
+ */
+static void stress_vnni_amx_config(stress_vnni_tile_config_t *cfg)
+{
+	(void)shim_memset(cfg, 0, sizeof(*cfg));
+	cfg->palette_id = 1;
+	cfg->colsb[0] = VEC_AMX_ROW_BYTES;
+	cfg->rows[0] = VEC_AMX_M;
+	cfg->colsb[1] = VEC_AMX_ROW_BYTES;
+	cfg->rows[1] = VEC_AMX_M;
+	cfg->colsb[2] = VEC_AMX_ROW_BYTES;
+	cfg->rows[2] = VEC_AMX_K_ROWS;
+}
+
+/*
+ *  stress_vnni_amx_permit()
+ *	the kernel only allows AMX tile data use once the
+ *	process has asked for permission to use it
+ */
+static bool stress_vnni_amx_permit(void)
+{
+	static int permitted = -1;
+
+	if (permitted < 0)
+		permitted = (shim_arch_prctl(ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) == 0);
+	return permitted > 0;
+}
+#endif
+
+#if defined(HAVE_STRESS_VNNI_AMX) &&	\
+    defined(HAVE_TILE_DPBUSD)
+#define HAVE_STRESS_VNNI_TDPBUSD_AMX
+static void __attribute__ ((target("amx-tile,amx-int8"))) OPTIMIZE3 stress_vnni_tdpbusd_amx(stress_args_t *args)
+{
+	stress_vnni_tile_config_t cfg;
+	register int i;
+
+	(void)args;
+
+	stress_vnni_amx_config(&cfg);
+	_tile_loadconfig(&cfg);
+	_tile_loadd(0, c_init, VEC_AMX_ROW_BYTES);
+	_tile_loadd(1, a_init, VEC_AMX_ROW_BYTES);
+	_tile_loadd(2, b_amx, VEC_AMX_ROW_BYTES);
+	for (i = 0; i < VEC_AMX_ITERS; i++)
+		_tile_dpbusd(0, 1, 2);
+	_tile_stored(0, result, VEC_AMX_ROW_BYTES);
+	_tile_release();
+}
+
+static bool stress_amx_int8_capable(void)
+{
+	if (stress_cpu_x86_has_amx_int8() && stress_vnni_amx_permit()) {
+		avx_capable = true;
+		return true;
+	}
+	return false;
+}
+#endif
+
+#if defined(HAVE_STRESS_VNNI_AMX) &&	\
+    defined(HAVE_TILE_DPBF16PS)
+#define HAVE_STRESS_VNNI_TDPBF16PS_AMX
+static void __attribute__ ((target("amx-tile,amx-bf16"))) OPTIMIZE3 stress_vnni_tdpbf16ps_amx(stress_args_t *args)
+{
+	stress_vnni_tile_config_t cfg;
+	register int i;
+
+	(void)args;
+
+	stress_vnni_amx_config(&cfg);
+	_tile_loadconfig(&cfg);
+	_tile_loadd(0, c_f32, VEC_AMX_ROW_BYTES);
+	_tile_loadd(1, a_bf16, VEC_AMX_ROW_BYTES);
+	_tile_loadd(2, b_bf16, VEC_AMX_ROW_BYTES);
+	for (i = 0; i < VEC_AMX_ITERS; i++)
+		_tile_dpbf16ps(0, 1, 2);
+	_tile_stored(0, result, VEC_AMX_ROW_BYTES);
+	_tile_release();
+}
+
+static bool stress_amx_bf16_capable(void)
+{
+	if (stress_cpu_x86_has_amx_bf16() && stress_vnni_amx_permit()) {
+		avx_capable = true;
+		return true;
+	}
+	return false;
+}
+#endif
+
 #if defined(HAVE_STRESS_VNNI_VPADDB512)
 static bool stress_avx512_bw_capable(void)
 {
@@ -417,37 +678,45 @@ static bool stress_always_capable(void)
 static void stress_vnni_all(stress_args_t *args);
 
 static stress_vnni_method_t stress_vnni_methods[] = {
-	{ "all",	 stress_vnni_all,	  stress_always_capable,      0xffffffff, 0xffffffff, false, false, 0.0, 0.0 },
+	{ "all",	 stress_vnni_all,	  stress_always_capable,      0xffffffff, 0xffffffff, false, 0.0, false, 0.0, 0.0 },
 #if defined(HAVE_STRESS_VNNI_VPADDB512)
-	{ "vpaddb512",	 stress_vnni_vpaddb512,   stress_avx512_bw_capable,   0xd93496ff, 0xd93496ff, true,  false, 0.0, 0.0 },
+	{ "vpaddb512",	 stress_vnni_vpaddb512,   stress_avx512_bw_capable,   0xd93496ff, 0xd93496ff, true,  0.0, false, 0.0, 0.0 },
 #endif
 #if defined(HAVE_STRESS_VNNI_VPADDB256)
-	{ "vpaddb256",	 stress_vnni_vpaddb256,   stress_avx_vnni_capable,    0xd93496ff, 0xd93496ff, true,  false, 0.0, 0.0 },
+	{ "vpaddb256",	 stress_vnni_vpaddb256,   stress_avx_vnni_capable,    0xd93496ff, 0xd93496ff, true,  0.0, false, 0.0, 0.0 },
 #endif
 #if defined(HAVE_STRESS_VNNI_VPADDB128)
-	{ "vpaddb128",	 stress_vnni_vpaddb128,   stress_avx_vnni_capable,    0xd93496ff, 0xd93496ff, true,  false, 0.0, 0.0 },
+	{ "vpaddb128",	 stress_vnni_vpaddb128,   stress_avx_vnni_capable,    0xd93496ff, 0xd93496ff, true,  0.0, false, 0.0, 0.0 },
 #endif
-	{ "vpaddb",	 stress_vnni_vpaddb,      stress_always_capable,      0xd93496ff, 0xd93496ff, false, false, 0.0, 0.0 },
+	{ "vpaddb",	 stress_vnni_vpaddb,      stress_always_capable,      0xd93496ff, 0xd93496ff, false, 0.0, false, 0.0, 0.0 },
 #if defined(HAVE_STRESS_VNNI_VPDPBUSD512)
-	{ "vpdpbusd512", stress_vnni_vpdpbusd512, stress_avx512_vnni_capable, 0xc10ef48a, 0x1b509895, true,  false, 0.0, 0.0 },
+	{ "vpdpbusd512", stress_vnni_vpdpbusd512, stress_avx512_vnni_capable, 0xc10ef48a, 0x1b509895, true,  512.0, false, 0.0, 0.0 },
 #endif
 #if defined(HAVE_STRESS_VNNI_VPDPBUSD256)
-	{ "vpdpbusd256", stress_vnni_vpdpbusd256, stress_avx_vnni_capable,    0xc10ef48a, 0x1b509895, true,  false, 0.0, 0.0 },
+	{ "vpdpbusd256", stress_vnni_vpdpbusd256, stress_avx_vnni_capable,    0xc10ef48a, 0x1b509895, true,  512.0, false, 0.0, 0.0 },
 #endif
 #if defined(HAVE_STRESS_VNNI_VPDPBUSD128)
-	{ "vpdpbusd128", stress_vnni_vpdpbusd128, stress_avx_vnni_capable,    0xc10ef48a, 0x1b509895, true,  false, 0.0, 0.0 },
+	{ "vpdpbusd128", stress_vnni_vpdpbusd128, stress_avx_vnni_capable,    0xc10ef48a, 0x1b509895, true,  512.0, false, 0.0, 0.0 },
 #endif
-	{ "vpdpbusd",	 stress_vnni_vpdpbusd,    stress_always_capable,      0xc10ef48a, 0x1b509895, false, false, 0.0, 0.0 },
+	{ "vpdpbusd",	 stress_vnni_vpdpbusd,    stress_always_capable,      0xc10ef48a, 0x1b509895, false, 512.0, false, 0.0, 0.0 },
 #if defined(HAVE_STRESS_VNNI_VPDPWSSD512)
-	{ "vpdpwssd512", stress_vnni_vpdpwssd512, stress_avx512_vnni_capable, 0x8e323fb8, 0xeef5d2a3, true,  false, 0.0, 0.0 },
+	{ "vpdpwssd512", stress_vnni_vpdpwssd512, stress_avx512_vnni_capable, 0x8e323fb8, 0xeef5d2a3, true,  256.0, false, 0.0, 0.0 },
 #endif
 #if defined(HAVE_STRESS_VNNI_VPDPWSSD256)
-	{ "vpdpwssd256", stress_vnni_vpdpwssd256, stress_avx_vnni_capable,    0x8e323fb8, 0xeef5d2a3, true,  false, 0.0, 0.0 },
+	{ "vpdpwssd256", stress_vnni_vpdpwssd256, stress_avx_vnni_capable,    0x8e323fb8, 0xeef5d2a3, true,  256.0, false, 0.0, 0.0 },
 #endif
 #if defined(HAVE_STRESS_VNNI_VPDPWSSD128)
-	{ "vpdpwssd128", stress_vnni_vpdpwssd128, stress_avx_vnni_capable,    0x8e323fb8, 0xeef5d2a3, true,  false, 0.0, 0.0 },
+	{ "vpdpwssd128", stress_vnni_vpdpwssd128, stress_avx_vnni_capable,    0x8e323fb8, 0xeef5d2a3, true,  256.0, false, 0.0, 0.0 },
+#endif
+	{ "vpdpwssd",	 stress_vnni_vpdpwssd,    stress_always_capable,      0x8e323fb8, 0xeef5d2a3, false, 256.0, false, 0.0, 0.0 },
+#if defined(HAVE_STRESS_VNNI_TDPBUSD_AMX)
+	{ "tdpbusd-amx", stress_vnni_tdpbusd_amx, stress_amx_int8_capable,    0x88882584, 0x88882584, true,  VEC_AMX_INT8_OPS, false, 0.0, 0.0 },
+#endif
+	{ "tdpbusd",	 stress_vnni_tdpbusd,     stress_always_capable,      0x88882584, 0x88882584, false, VEC_AMX_INT8_OPS, false, 0.0, 0.0 },
+#if defined(HAVE_STRESS_VNNI_TDPBF16PS_AMX)
+	{ "tdpbf16ps-amx", stress_vnni_tdpbf16ps_amx, stress_amx_bf16_capable, 0x902ee8eb, 0x902ee8eb, true, VEC_AMX_BF16_OPS, false, 0.0, 0.0 },
 #endif
-	{ "vpdpwssd",	 stress_vnni_vpdpwssd,    stress_always_capable,      0x8e323fb8, 0xeef5d2a3, false, false, 0.0, 0.0 },
+	{ "tdpbf16ps",	 stress_vnni_tdpbf16ps,   stress_always_capable,      0x902ee8eb, 0x902ee8eb, false, VEC_AMX_BF16_OPS, false, 0.0, 0.0 },
 };
 
 static void OPTIMIZE3 stress_vnni_exercise(stress_args_t *args, const size_t n)
@@ -533,6 +802,7 @@ static int stress_vnni(stress_args_t *args)
 	stress_uint8rnd4((uint8_t *)&a_init, sizeof(a_init));
 	stress_uint8rnd4((uint8_t *)&b_init, sizeof(b_init));
 	stress_uint8rnd4((uint8_t *)&c_init, sizeof(c_init));
+	stress_vnni_amx_init();
 
 	vnni_intrinsic = false;
 	(void)stress_get_setting("vnni-method", &vnni_method);
@@ -593,6 +863,12 @@ static int stress_vnni(stress_args_t *args)
 			stress_metrics_set(args, j, buf,
 				rate, STRESS_HARMONIC_MEAN);
 			j++;
+			if (stress_vnni_methods[i].vnni_ops > 0.0) {
+				(void)snprintf(buf, sizeof(buf), "%s TOPS", stress_vnni_methods[i].name);
+				stress_metrics_set(args, j, buf,
+					rate * stress_vnni_methods[i].vnni_ops / 1.0E12, STRESS_HARMONIC_MEAN);
+				j++;
+			}
 		}
 	}
 
@@ -20,6 +20,8 @@
  */
 #include "stress-ng.h"
 #include "core-arch.h"
+#include "core-builtin.h"
+#include "core-cpu.h"
 
 #if defined(HAVE_BSD_WCHAR)
 #include <bsd/wchar.h>
@@ -37,8 +39,10 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"wcs N",	   "start N workers on lib C wide char string functions" },
+	{ NULL,	"wcs-impl I",	   "select wcschr, wcscmp, wcslen implementation: all, libc, naive, sse2, avx2" },
 	{ NULL,	"wcs-method func", "specify the wide character string function to stress" },
 	{ NULL,	"wcs-ops N",	   "stop after N bogo wide character string operations" },
+	{ NULL,	"wcs-sweep",	   "sweep string lengths and alignments, report GB/s per implementation" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -119,6 +123,331 @@ static void wcschk(
 
 #define WCSCHK(info, test)	wcschk(info, test, STR(test))
 
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H)
+#include <immintrin.h>
+#endif
+
+#define WCS_SWEEP_MAX		(64 * KB)	/* longest sweep string, in characters */
+#define WCS_SWEEP_BATCH		(256 * KB)	/* bytes scanned per timing batch */
+#define WCS_SWEEP_ALIGN		(16)		/* string start offsets 0..15 characters */
+#define WCS_PAGE_CROSS(p, n)	((((uintptr_t)(p)) & 4095) > (4096 - (n)))
+
+typedef size_t (*wcs_len_func_t)(const wchar_t *s);
+typedef wchar_t * (*wcs_chr_func_t)(const wchar_t *s, wchar_t c);
+typedef int (*wcs_cmp_func_t)(const wchar_t *s1, const wchar_t *s2);
+
+/*
+ *  implementations of wcschr, wcscmp and wcslen
+ */
+typedef struct {
+	const char *name;		/* implementation name */
+	bool (*supported)(void);	/* true if cpu can run it */
+	const wcs_chr_func_t chr;	/* wcschr */
+	const wcs_cmp_func_t cmp;	/* wcscmp */
+	const wcs_len_func_t len;	/* wcslen */
+} stress_wcs_impl_t;
+
+/* sweep string length classes, in characters */
+static const struct {
+	const size_t max;	/* longest string in class */
+	const char *label;	/* lengths in class */
+	const bool metric;	/* report as a metric */
+} wcs_sweep_class[] = {
+	{ 16,		"1-16",		true },
+	{ 64,		"17-64",	false },
+	{ 256,		"65-256",	false },
+	{ 1 * KB,	"257-1K",	true },
+	{ 4 * KB,	"1K-4K",	false },
+	{ 16 * KB,	"4K-16K",	false },
+	{ 64 * KB,	"16K-64K",	true },
+};
+
+/* sweep functions */
+#define WCS_SWEEP_CHR		(0)
+#define WCS_SWEEP_CMP		(1)
+#define WCS_SWEEP_LEN		(2)
+#define WCS_SWEEP_FUNCS		(3)
+
+static const char * const wcs_sweep_func_names[] = {
+	"wcschr",
+	"wcscmp",
+	"wcslen",
+};
+
+typedef struct {
+	double bytes;		/* total bytes scanned */
+	double duration;	/* total time scanning */
+} stress_wcs_sweep_t;
+
+static bool stress_wcs_impl_always_supported(void)
+{
+	return true;
+}
+
+static inline unsigned int stress_wcs_ctz(uint32_t mask)
+{
+#if defined(HAVE_BUILTIN_CTZ)
+	return (unsigned int)__builtin_ctz(mask);
+#else
+	unsigned int n = 0;
+
+	while (!(mask & 1)) {
+		mask >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static inline int stress_wcs_diff(const wchar_t c1, const wchar_t c2)
+{
+	return (c1 > c2) - (c1 < c2);
+}
+
+#if defined(HAVE_WCSCHR) &&	\
+    defined(HAVE_WCSCMP) &&	\
+    defined(HAVE_WCSLEN) &&	\
+    defined(HAVE_WCHAR_H)
+#define HAVE_WCS_LIBC
+
+static wchar_t *stress_wcschr_libc(const wchar_t *s, wchar_t c)
+{
+	return (wchar_t *)wcschr(s, c);
+}
+#endif
+
+/*
+ *  naive character at a time implementations
+ */
+static size_t NOINLINE stress_wcslen_naive(const wchar_t *s)
+{
+	register const wchar_t *p = s;
+
+	while (*p)
+		p++;
+	return (size_t)(p - s);
+}
+
+static wchar_t * NOINLINE stress_wcschr_naive(const wchar_t *s, wchar_t c)
+{
+	for (;;) {
+		if (*s == c)
+			return (wchar_t *)s;
+		if (!*s)
+			return NULL;
+		s++;
+	}
+}
+
+static int NOINLINE stress_wcscmp_naive(const wchar_t *s1, const wchar_t *s2)
+{
+	while (*s1 && (*s1 == *s2)) {
+		s1++;
+		s2++;
+	}
+	return stress_wcs_diff(*s1, *s2);
+}
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    defined(__SSE2__)
+#define HAVE_WCS_SSE2
+
+/*
+ *  the SIMD implementations compare 32 bit characters
+ */
+static bool stress_wcs_sse2_supported(void)
+{
+	return sizeof(wchar_t) == sizeof(uint32_t);
+}
+
+/*
+ *  SSE2 implementations comparing 4 characters at a time, SSE4.2
+ *  string compares only handle 8 and 16 bit characters. wcslen and
+ *  wcschr use aligned loads and discard the characters before the
+ *  start of the string, aligned loads never cross into an unmapped page
+ */
+static size_t NOINLINE stress_wcslen_sse2(const wchar_t *s)
+{
+	register const wchar_t *p = (const wchar_t *)((uintptr_t)s & ~(uintptr_t)15);
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t mask;
+
+	mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_load_si128((const __m128i *)p), zero));
+	mask >>= ((uintptr_t)s - (uintptr_t)p);
+	if (mask)
+		return (size_t)(stress_wcs_ctz(mask) / sizeof(wchar_t));
+	for (;;) {
+		p += 16 / sizeof(wchar_t);
+		mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_load_si128((const __m128i *)p), zero));
+		if (mask)
+			return (size_t)(p - s) + (size_t)(stress_wcs_ctz(mask) / sizeof(wchar_t));
+	}
+}
+
+static wchar_t * NOINLINE stress_wcschr_sse2(const wchar_t *s, wchar_t c)
+{
+	register const wchar_t *p = (const wchar_t *)((uintptr_t)s & ~(uintptr_t)15);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vc = _mm_set1_epi32((int)c);
+	__m128i v;
+	uint32_t mask;
+
+	v = _mm_load_si128((const __m128i *)p);
+	mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi32(v, zero), _mm_cmpeq_epi32(v, vc)));
+	mask >>= ((uintptr_t)s - (uintptr_t)p);
+	if (mask) {
+		p = s + (stress_wcs_ctz(mask) / sizeof(wchar_t));
+		return (*p == c) ? (wchar_t *)p : NULL;
+	}
+	for (;;) {
+		p += 16 / sizeof(wchar_t);
+		v = _mm_load_si128((const __m128i *)p);
+		mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi32(v, zero), _mm_cmpeq_epi32(v, vc)));
+		if (mask) {
+			p += stress_wcs_ctz(mask) / sizeof(wchar_t);
+			return (*p == c) ? (wchar_t *)p : NULL;
+		}
+	}
+}
+
+static int NOINLINE stress_wcscmp_sse2(const wchar_t *s1, const wchar_t *s2)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for (;;) {
+		__m128i v1, v2;
+		uint32_t mask;
+
+		/* a character at a time if a 16 byte load would cross a page */
+		if (WCS_PAGE_CROSS(s1, 16) || WCS_PAGE_CROSS(s2, 16)) {
+			if ((*s1 != *s2) || !*s1)
+				return stress_wcs_diff(*s1, *s2);
+			s1++;
+			s2++;
+			continue;
+		}
+		v1 = _mm_loadu_si128((const __m128i *)s1);
+		v2 = _mm_loadu_si128((const __m128i *)s2);
+		/* first character that differs or is the terminator */
+		mask = (~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(v1, v2)) & 0xffff) |
+			(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi32(v1, zero));
+		if (mask) {
+			const unsigned int idx = stress_wcs_ctz(mask) / sizeof(wchar_t);
+
+			return stress_wcs_diff(s1[idx], s2[idx]);
+		}
+		s1 += 16 / sizeof(wchar_t);
+		s2 += 16 / sizeof(wchar_t);
+	}
+}
+#endif
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    defined(HAVE_TARGET_CLONES_AVX2)
+#define HAVE_WCS_AVX2
+#define WCS_AVX2	__attribute__((target("avx2")))
+
+static bool stress_wcs_avx2_supported(void)
+{
+	return (sizeof(wchar_t) == sizeof(uint32_t)) && stress_cpu_x86_has_avx2();
+}
+
+/*
+ *  AVX2 implementations comparing 8 characters at a time
+ */
+static size_t NOINLINE WCS_AVX2 stress_wcslen_avx2(const wchar_t *s)
+{
+	register const wchar_t *p = (const wchar_t *)((uintptr_t)s & ~(uintptr_t)31);
+	const __m256i zero = _mm256_setzero_si256();
+	uint32_t mask;
+
+	mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *)p), zero));
+	mask >>= ((uintptr_t)s - (uintptr_t)p);
+	if (mask)
+		return (size_t)(stress_wcs_ctz(mask) / sizeof(wchar_t));
+	for (;;) {
+		p += 32 / sizeof(wchar_t);
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *)p), zero));
+		if (mask)
+			return (size_t)(p - s) + (size_t)(stress_wcs_ctz(mask) / sizeof(wchar_t));
+	}
+}
+
+static wchar_t * NOINLINE WCS_AVX2 stress_wcschr_avx2(const wchar_t *s, wchar_t c)
+{
+	register const wchar_t *p = (const wchar_t *)((uintptr_t)s & ~(uintptr_t)31);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i vc = _mm256_set1_epi32((int)c);
+	__m256i v;
+	uint32_t mask;
+
+	v = _mm256_load_si256((const __m256i *)p);
+	mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi32(v, zero), _mm256_cmpeq_epi32(v, vc)));
+	mask >>= ((uintptr_t)s - (uintptr_t)p);
+	if (mask) {
+		p = s + (stress_wcs_ctz(mask) / sizeof(wchar_t));
+		return (*p == c) ? (wchar_t *)p : NULL;
+	}
+	for (;;) {
+		p += 32 / sizeof(wchar_t);
+		v = _mm256_load_si256((const __m256i *)p);
+		mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi32(v, zero), _mm256_cmpeq_epi32(v, vc)));
+		if (mask) {
+			p += stress_wcs_ctz(mask) / sizeof(wchar_t);
+			return (*p == c) ? (wchar_t *)p : NULL;
+		}
+	}
+}
+
+static int NOINLINE WCS_AVX2 stress_wcscmp_avx2(const wchar_t *s1, const wchar_t *s2)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	for (;;) {
+		__m256i v1, v2;
+		uint32_t mask;
+
+		/* a character at a time if a 32 byte load would cross a page */
+		if (WCS_PAGE_CROSS(s1, 32) || WCS_PAGE_CROSS(s2, 32)) {
+			if ((*s1 != *s2) || !*s1)
+				return stress_wcs_diff(*s1, *s2);
+			s1++;
+			s2++;
+			continue;
+		}
+		v1 = _mm256_loadu_si256((const __m256i *)s1);
+		v2 = _mm256_loadu_si256((const __m256i *)s2);
+		/* first character that differs or is the terminator */
+		mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(v1, v2)) |
+			(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi32(v1, zero));
+		if (mask) {
+			const unsigned int idx = stress_wcs_ctz(mask) / sizeof(wchar_t);
+
+			return stress_wcs_diff(s1[idx], s2[idx]);
+		}
+		s1 += 32 / sizeof(wchar_t);
+		s2 += 32 / sizeof(wchar_t);
+	}
+}
+#endif
+
+static const stress_wcs_impl_t wcs_impls[] = {
+	{ "all",	stress_wcs_impl_always_supported, NULL, NULL, NULL },
+#if defined(HAVE_WCS_LIBC)
+	{ "libc",	stress_wcs_impl_always_supported, stress_wcschr_libc, wcscmp, wcslen },
+#endif
+	{ "naive",	stress_wcs_impl_always_supported, stress_wcschr_naive, stress_wcscmp_naive, stress_wcslen_naive },
+#if defined(HAVE_WCS_SSE2)
+	{ "sse2",	stress_wcs_sse2_supported, stress_wcschr_sse2, stress_wcscmp_sse2, stress_wcslen_sse2 },
+#endif
+#if defined(HAVE_WCS_AVX2)
+	{ "avx2",	stress_wcs_avx2_supported, stress_wcschr_avx2, stress_wcscmp_avx2, stress_wcslen_avx2 },
+#endif
+};
+
 #if defined(HAVE_WCSCASECMP) &&	\
     defined(HAVE_WCHAR_H)
 /*
@@ -654,6 +983,27 @@ static const stress_wcs_method_info_t wcs_methods[] = {
 };
 
 static stress_metrics_t metrics[SIZEOF_ARRAY(wcs_methods)];
+static const stress_wcs_impl_t *wcs_impl = NULL;	/* NULL, use libc */
+
+/*
+ *  stress_wcs_method_func()
+ *	the function a method exercises, wcschr, wcscmp and wcslen
+ *	use the selected implementation
+ */
+static void *stress_wcs_method_func(const size_t method)
+{
+	const char *name = wcs_methods[method].name;
+
+	if (!wcs_impl)
+		return wcs_methods[method].libc_func;
+	if (!strcmp(name, "wcschr"))
+		return (void *)wcs_impl->chr;
+	if (!strcmp(name, "wcscmp"))
+		return (void *)wcs_impl->cmp;
+	if (!strcmp(name, "wcslen"))
+		return (void *)wcs_impl->len;
+	return wcs_methods[method].libc_func;
+}
 
 /*
  *  stress_wcs_all()
@@ -668,7 +1018,7 @@ static size_t stress_wcs_all(stress_args_t *args, stress_wcs_args_t *info)
 	if (UNLIKELY(SIZEOF_ARRAY(wcs_methods) < 2))
 		return 0;
 
-	info_all.libc_func = wcs_methods[i].libc_func;
+	info_all.libc_func = stress_wcs_method_func(i);
 
 	t = stress_time_now();
 	metrics[i].count += (double)wcs_methods[i].func(args, &info_all);
@@ -706,26 +1056,238 @@ static int stress_set_wcs_method(const char *name)
 	return -1;
 }
 
+/*
+ *  stress_set_wcs_impl()
+ *	set the wcschr, wcscmp and wcslen implementation
+ */
+static int stress_set_wcs_impl(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(wcs_impls); i++) {
+		if (!strcmp(wcs_impls[i].name, name)) {
+			stress_set_setting("wcs-impl", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "wcs-impl must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(wcs_impls); i++) {
+		(void)fprintf(stderr, " %s", wcs_impls[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+static int stress_set_wcs_sweep(const char *opt)
+{
+	return stress_set_setting_true("wcs-sweep", opt);
+}
+
+static double stress_wcs_rate_gbs(const stress_wcs_sweep_t *cell)
+{
+	return (cell->duration > 0.0) ? cell->bytes / (cell->duration * 1.0E9) : 0.0;
+}
+
+/*
+ *  stress_wcs_sweep_dump()
+ *	dump GB/s for each implementation, length class and function
+ */
+static void stress_wcs_sweep_dump(
+	stress_args_t *args,
+	const stress_wcs_sweep_t *sweep,
+	const size_t *impls,
+	const size_t n_impls)
+{
+	const size_t n_classes = SIZEOF_ARRAY(wcs_sweep_class);
+	size_t i, j, k, metric = 0;
+
+	for (i = 0; i < n_impls; i++) {
+		const char *name = wcs_impls[impls[i]].name;
+
+		/* skip implementations the run ended before reaching */
+		if (sweep[i * n_classes * WCS_SWEEP_FUNCS].duration <= 0.0)
+			continue;
+		if (args->instance == 0) {
+			pr_inf("%s: %s GB/s:\n", args->name, name);
+			pr_inf("%s: %10s %8s %8s %8s\n", args->name, "length",
+				wcs_sweep_func_names[0], wcs_sweep_func_names[1],
+				wcs_sweep_func_names[2]);
+		}
+		for (j = 0; j < n_classes; j++) {
+			const stress_wcs_sweep_t *row = &sweep[(i * n_classes + j) * WCS_SWEEP_FUNCS];
+
+			if (args->instance == 0)
+				pr_inf("%s: %10s %8.3f %8.3f %8.3f\n", args->name,
+					wcs_sweep_class[j].label,
+					stress_wcs_rate_gbs(&row[0]),
+					stress_wcs_rate_gbs(&row[1]),
+					stress_wcs_rate_gbs(&row[2]));
+
+			/* short, medium and long strings only, there are too few metrics slots for all */
+			if (!wcs_sweep_class[j].metric)
+				continue;
+			for (k = 0; k < WCS_SWEEP_FUNCS; k++) {
+				char msg[64];
+
+				(void)snprintf(msg, sizeof(msg), "%s %s GB/s at %s", name,
+					wcs_sweep_func_names[k], wcs_sweep_class[j].label);
+				stress_metrics_set(args, metric++, msg,
+					stress_wcs_rate_gbs(&row[k]), STRESS_GEOMETRIC_MEAN);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_wcs_sweep()
+ *	sweep wcschr, wcscmp and wcslen over string lengths from 1 byte
+ *	to 64K with random start alignments and report the GB/s of each
+ *	implementation
+ */
+static int stress_wcs_sweep(stress_args_t *args, const size_t wcs_impl)
+{
+	const size_t n_classes = SIZEOF_ARRAY(wcs_sweep_class);
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t impls[SIZEOF_ARRAY(wcs_impls)];
+	size_t n_impls = 0, buf_size, i, j;
+	stress_wcs_sweep_t *sweep;
+	wchar_t *buf, *buf1, *buf2;
+	int rc = EXIT_SUCCESS;
+
+	for (i = 1; i < SIZEOF_ARRAY(wcs_impls); i++) {
+		if (((wcs_impl == 0) || (wcs_impl == i)) &&
+		    wcs_impls[i].supported())
+			impls[n_impls++] = i;
+	}
+
+	buf_size = (WCS_SWEEP_MAX * sizeof(wchar_t)) + args->page_size;
+	buf = (wchar_t *)stress_mmap_populate(NULL, 2 * buf_size,
+			PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1 , 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: cannot allocate %zu byte sweep buffers, skipping stressor\n",
+			args->name, 2 * buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	buf1 = buf;
+	buf2 = buf + (buf_size / sizeof(wchar_t));
+
+	sweep = (stress_wcs_sweep_t *)calloc(n_impls * n_classes * WCS_SWEEP_FUNCS, sizeof(*sweep));
+	if (!sweep) {
+		pr_inf_skip("%s: cannot allocate sweep results, skipping stressor\n", args->name);
+		(void)munmap((void *)buf, 2 * buf_size);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_wcs_fill(buf1, buf_size / sizeof(wchar_t));
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_impls) && stress_continue(args); i++) {
+			const stress_wcs_impl_t *impl = &wcs_impls[impls[i]];
+
+			for (j = 0; (j < n_classes) && stress_continue_flag(); j++) {
+				stress_wcs_sweep_t *cell = &sweep[(i * n_classes + j) * WCS_SWEEP_FUNCS];
+				const size_t lo = j ? wcs_sweep_class[j - 1].max + 1 : 1;
+				const size_t len = lo + (size_t)stress_mwc32modn((uint32_t)(wcs_sweep_class[j].max - lo + 1));
+				const size_t batch = STRESS_MAXIMUM(1, WCS_SWEEP_BATCH / (len * sizeof(wchar_t)));
+				wchar_t *s1 = buf1 + stress_mwc8modn(WCS_SWEEP_ALIGN);
+				wchar_t *s2 = buf2 + stress_mwc8modn(WCS_SWEEP_ALIGN);
+				const wchar_t last = s1[len - 1], end = s1[len];
+				register size_t l, n = 0;
+				double t;
+
+				/* s1 ends in a '@' to search for, s2 is the same but sorts after s1 */
+				s1[len - 1] = L'@';
+				s1[len] = L'\0';
+				(void)shim_memcpy(s2, s1, (len + 1) * sizeof(wchar_t));
+				s2[len - 1] = L'A';
+
+				t = stress_time_now();
+				for (l = 0; l < batch; l++)
+					n += (impl->chr(s1, L'@') == s1 + len - 1);
+				cell[WCS_SWEEP_CHR].duration += stress_time_now() - t;
+				cell[WCS_SWEEP_CHR].bytes += (double)(len * sizeof(wchar_t)) * (double)batch;
+				if (verify && (n != batch)) {
+					pr_fail("%s: %s wcschr on a %zu character string at offset %zu did not find the last character\n",
+						args->name, impl->name, len, (size_t)(s1 - buf1));
+					rc = EXIT_FAILURE;
+				}
+
+				t = stress_time_now();
+				for (n = 0, l = 0; l < batch; l++)
+					n += (impl->cmp(s1, s2) < 0);
+				cell[WCS_SWEEP_CMP].duration += stress_time_now() - t;
+				cell[WCS_SWEEP_CMP].bytes += 2.0 * (double)(len * sizeof(wchar_t)) * (double)batch;
+				if (verify && (n != batch)) {
+					pr_fail("%s: %s wcscmp on %zu character strings at offsets %zu and %zu did not "
+						"find the strings differ\n", args->name, impl->name, len,
+						(size_t)(s1 - buf1), (size_t)(s2 - buf2));
+					rc = EXIT_FAILURE;
+				}
+
+				t = stress_time_now();
+				for (n = 0, l = 0; l < batch; l++)
+					n += impl->len(s1);
+				cell[WCS_SWEEP_LEN].duration += stress_time_now() - t;
+				cell[WCS_SWEEP_LEN].bytes += (double)((len + 1) * sizeof(wchar_t)) * (double)batch;
+				if (verify && (n != len * batch)) {
+					pr_fail("%s: %s wcslen on a %zu character string at offset %zu returned the wrong length\n",
+						args->name, impl->name, len, (size_t)(s1 - buf1));
+					rc = EXIT_FAILURE;
+				}
+
+				s1[len - 1] = last;
+				s1[len] = end;
+			}
+			stress_bogo_inc(args);
+		}
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_wcs_sweep_dump(args, sweep, impls, n_impls);
+
+	free(sweep);
+	(void)munmap((void *)buf, 2 * buf_size);
+
+	return rc;
+}
+
 /*
  *  stress_wcs()
  *	stress CPU by doing wide character string ops
  */
 static int stress_wcs(stress_args_t *args)
 {
-	size_t i, j, wcs_method = 0;
+	size_t i, j, wcs_method = 0, wcs_impl_idx = 0;
+	bool wcs_sweep = false;
 	const stress_wcs_method_info_t *wcs_method_info;
 	wchar_t ALIGN64 str1[STR1LEN], ALIGN64 str2[STR2LEN];
 	wchar_t strdst[STRDSTLEN];
 	stress_wcs_args_t info;
 	int metrics_count = 0;
 
+	(void)stress_get_setting("wcs-method", &wcs_method);
+	(void)stress_get_setting("wcs-impl", &wcs_impl_idx);
+	(void)stress_get_setting("wcs-sweep", &wcs_sweep);
+	if (!wcs_impls[wcs_impl_idx].supported()) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: cpu does not support the %s wide string implementation, "
+				"skipping stressor\n", args->name, wcs_impls[wcs_impl_idx].name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (wcs_sweep)
+		return stress_wcs_sweep(args, wcs_impl_idx);
+
 	/* No wcs* functions available on this system? */
 	if (SIZEOF_ARRAY(wcs_methods) < 2)
 		return stress_unimplemented(args);
 
-	(void)stress_get_setting("wcs-method", &wcs_method);
+	/* all implementations is only meaningful for sweeps, use libc */
+	wcs_impl = (wcs_impl_idx > 0) ? &wcs_impls[wcs_impl_idx] : NULL;
 	wcs_method_info = &wcs_methods[wcs_method];
-	info.libc_func = wcs_method_info->libc_func;
+	info.libc_func = stress_wcs_method_func(wcs_method);
 	info.str1 = str1;
 	info.len1 = STR1LEN;
 	info.str2 = str2;
@@ -795,7 +1357,9 @@ static void stress_wcs_set_default(void)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_wcs_impl,		stress_set_wcs_impl },
 	{ OPT_wcs_method,	stress_set_wcs_method },
+	{ OPT_wcs_sweep,	stress_set_wcs_sweep },
 	{ 0,			NULL }
 };
 
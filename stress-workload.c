@@ -25,6 +25,8 @@
 #include "core-asm-generic.h"
 #include "core-cpu-cache.h"
 #include "core-builtin.h"
+#include "core-latency.h"
+#include "core-lock.h"
 #include "core-pthread.h"
 #include "core-put.h"
 #include "core-target-clones.h"
@@ -41,6 +43,13 @@
 #define WORKLOAD_THREADED	(1)
 #endif
 
+#if defined(HAVE_LIB_PTHREAD) &&		\
+    defined(HAVE_ATOMIC_COMPARE_EXCHANGE) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&		\
+    defined(HAVE_ATOMIC_STORE)
+#define WORKLOAD_POOL		(1)
+#endif
+
 typedef struct {
 #if defined(WORKLOAD_THREADED)
 	pthread_t pthread;
@@ -48,12 +57,34 @@ typedef struct {
 	int ret;
 } workload_thread_t;
 
+/*
+ *  response times of the quanta run at one offered load,
+ *  the quanta are timed from their scheduled arrival so
+ *  queueing behind late quanta is included (open loop)
+ */
+typedef struct {
+	uint32_t load;			/* offered load percentage */
+	uint32_t n_quanta;		/* quanta arriving per slice */
+	double t_start;			/* time load level started */
+	double t_end;			/* time load level ended */
+	double service;			/* total quanta service time */
+	uint64_t dispatched;		/* quanta handed to worker threads */
+	stress_latency_t response;	/* completion - scheduled arrival */
+	stress_latency_t queued;	/* start - scheduled arrival */
+} stress_workload_level_t;
+
+typedef struct {
+	stress_workload_level_t *levels;	/* load levels */
+	void *lock;			/* serializes updates from threads */
+} stress_workload_results_t;
+
 #if defined(WORKLOAD_THREADED)
 typedef struct {
 	mqd_t	mq;
 	uint8_t *buffer;
 	size_t buffer_len;
 	int workload_method;
+	stress_workload_results_t *results;
 } stress_workload_ctxt_t;
 #endif
 
@@ -74,8 +105,23 @@ typedef struct {
 #define STRESS_WORKLOAD_DIST_RANDOM2	(4)
 #define STRESS_WORKLOAD_DIST_RANDOM3	(5)
 
+#define STRESS_WORKLOAD_POOL_MQ		(0)
+#define STRESS_WORKLOAD_POOL_FIFO	(1)
+#define STRESS_WORKLOAD_POOL_STATIC	(2)
+#define STRESS_WORKLOAD_POOL_STEAL	(3)
+
+/* quanta per pool deque, must be a power of 2 */
+#define STRESS_WORKLOAD_DEQUE_SIZE	(1024)
+/* pool worker sleep when no work has been found after spinning */
+#define STRESS_WORKLOAD_POOL_IDLE_NS	(20000)
+
 #define STRESS_WORKLOAD_THREADS		(4)
 
+/* sweep offered load from 10% to 100% in 10% steps */
+#define STRESS_WORKLOAD_SWEEP_LEVELS	(10)
+/* saturated when the p99 response time is this many service times */
+#define STRESS_WORKLOAD_SATURATED	(10.0)
+
 #define STRESS_WORKLOAD_METHOD_ALL	(0)
 #define STRESS_WORKLOAD_METHOD_TIME	(1)
 #define STRESS_WORKLOAD_METHOD_NOP	(2)
@@ -96,6 +142,8 @@ typedef struct {
 typedef struct {
 	double when_us;
 	double run_duration_sec;
+	double arrival;			/* scheduled arrival time */
+	uint32_t level;			/* load level index */
 } stress_workload_t;
 
 typedef struct {
@@ -108,6 +156,11 @@ typedef struct {
 	const int policy;
 } stress_workload_sched_t;
 
+typedef struct {
+	const char *name;
+	const int type;
+} stress_workload_pool_type_t;
+
 typedef struct {
 	const char *name;
 	const int method;
@@ -119,14 +172,58 @@ typedef struct {
 	uint64_t overflow;
 } stress_workload_bucket_t;
 
+#if defined(WORKLOAD_POOL)
+/*
+ *  Chase-Lev work stealing deque, quanta are pushed onto
+ *  the bottom by the dispatcher and taken from the top by
+ *  the workers
+ */
+typedef struct {
+	uint64_t top;			/* next quantum to take */
+	uint8_t pad1[56];		/* keep top and bottom on separate cache lines */
+	uint64_t bottom;		/* next free slot */
+	uint8_t pad2[56];
+	stress_workload_t items[STRESS_WORKLOAD_DEQUE_SIZE];
+} stress_workload_deque_t;
+
+struct stress_workload_pool;
+
+typedef struct {
+	pthread_t pthread;
+	int ret;			/* pthread_create return */
+	uint32_t index;			/* worker index, own deque */
+	uint64_t completed;		/* quanta completed */
+	uint64_t stolen;		/* quanta taken from other workers */
+	struct stress_workload_pool *pool;
+} stress_workload_worker_t;
+
+typedef struct stress_workload_pool {
+	int type;			/* STRESS_WORKLOAD_POOL_* */
+	uint32_t n_workers;		/* number of worker threads */
+	uint32_t n_deques;		/* number of deques */
+	uint32_t next;			/* next deque to push to */
+	volatile bool run;		/* false to stop workers */
+	stress_workload_deque_t *deques;
+	stress_workload_worker_t *workers;
+	uint8_t *buffer;
+	size_t buffer_len;
+	int workload_method;
+	stress_workload_results_t *results;
+} stress_workload_pool_t;
+#else
+typedef struct stress_workload_pool stress_workload_pool_t;
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"workload N",		"start N workers that exercise a mix of scheduling loads" },
 	{ NULL,	"workload-dist type",	"workload distribution type [random1, random2, random3, cluster]" },
 	{ NULL, "workload-load P",	"percentage load P per workload time slice" },
 	{ NULL,	"workload-ops N",	"stop after N workload bogo operations" },
+	{ NULL,	"workload-pool type",	"thread pool type [mq, fifo, static, steal]" },
 	{ NULL,	"workload-quanta-us N",	"max duration of each quanta work item in microseconds" },
 	{ NULL, "workload-sched P",	"select scheduler policy [idle, fifo, rr, other, batch, deadline]" },
 	{ NULL, "workload-slice-us N",	"duration of workload time load in microseconds" },
+	{ NULL,	"workload-sweep",	"sweep offered load from 10% to 100% until response times saturate" },
 	{ NULL,	"workload-threads N",	"number of workload threads workers to use, default is 0 (disabled)" },
 	{ NULL, "workload-method M",	"select a workload method, default is all" },
 	{ NULL,	NULL,			NULL }
@@ -196,6 +293,29 @@ static int stress_set_workload_sched(const char *opt)
 	return -1;
 }
 
+static int stress_set_workload_pool(const char *opt)
+{
+	static const stress_workload_pool_type_t workload_pools[] = {
+		{ "fifo",	STRESS_WORKLOAD_POOL_FIFO },
+		{ "mq",		STRESS_WORKLOAD_POOL_MQ },
+		{ "static",	STRESS_WORKLOAD_POOL_STATIC },
+		{ "steal",	STRESS_WORKLOAD_POOL_STEAL },
+	};
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(workload_pools); i++) {
+		if (strcmp(opt, workload_pools[i].name) == 0)
+			return stress_set_setting("workload-pool", TYPE_ID_INT, &workload_pools[i].type);
+	}
+
+	(void)fprintf(stderr, "workload-pool must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(workload_pools); i++) {
+		(void)fprintf(stderr, " %s", workload_pools[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 /*
  *  stress_set_workload_load()
  *	set workload load (%)
@@ -284,13 +404,20 @@ static int stress_set_workload_threads(const char *opt)
 	return stress_set_setting("workload-threads", TYPE_ID_UINT32, &workload_threads);
 }
 
+static int stress_set_workload_sweep(const char *opt)
+{
+	return stress_set_setting_true("workload-sweep", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_workload_dist,		stress_set_workload_dist },
 	{ OPT_workload_load,		stress_set_workload_load },
 	{ OPT_workload_method,		stress_set_workload_method },
+	{ OPT_workload_pool,		stress_set_workload_pool },
 	{ OPT_workload_quanta_us,	stress_set_workload_quanta_us },
 	{ OPT_workload_sched,		stress_set_workload_sched },
 	{ OPT_workload_slice_us,	stress_set_workload_slice_us },
+	{ OPT_workload_sweep,		stress_set_workload_sweep },
 	{ OPT_workload_threads,		stress_set_workload_threads },
 	{ 0,				NULL }
 };
@@ -746,48 +873,325 @@ static int stress_workload_cmp(const void *p1, const void *p2)
 		return 0;
 }
 
+/*
+ *  stress_workload_record()
+ *	account a quantum that arrived at arrival, started
+ *	running at t_start and completed at t_end
+ */
+static void stress_workload_record(
+	stress_workload_results_t *results,
+	const uint32_t level,
+	const double arrival,
+	const double t_start,
+	const double t_end)
+{
+	stress_workload_level_t *lvl = &results->levels[level];
+	const double response = t_end - arrival;
+	const double queued = t_start - arrival;
+
+	if (results->lock && (stress_lock_acquire(results->lock) < 0))
+		return;
+	stress_latency_add(&lvl->response,
+		(response > 0.0) ? (uint64_t)(response * STRESS_DBL_NANOSECOND) : 0);
+	stress_latency_add(&lvl->queued,
+		(queued > 0.0) ? (uint64_t)(queued * STRESS_DBL_NANOSECOND) : 0);
+	lvl->service += t_end - t_start;
+	if (results->lock)
+		(void)stress_lock_release(results->lock);
+}
+
+#if defined(WORKLOAD_POOL)
+/*
+ *  stress_workload_deque_push()
+ *	push a quantum onto the bottom of a Chase-Lev deque, only
+ *	the dispatcher pushes so the bottom has a single owner
+ */
+static bool stress_workload_deque_push(
+	stress_workload_deque_t *dq,
+	const stress_workload_t *wl)
+{
+	const uint64_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+	const uint64_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+
+	if (b - t >= STRESS_WORKLOAD_DEQUE_SIZE)
+		return false;
+	dq->items[b & (STRESS_WORKLOAD_DEQUE_SIZE - 1)] = *wl;
+	__atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/*
+ *  stress_workload_deque_steal()
+ *	take the oldest quantum from the top of a Chase-Lev deque,
+ *	returns false if the deque is empty
+ */
+static bool stress_workload_deque_steal(
+	stress_workload_deque_t *dq,
+	stress_workload_t *wl)
+{
+	for (;;) {
+		uint64_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+		uint64_t b;
+
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+		if (t >= b)
+			return false;
+		/* may be torn if another thief wins, the CAS then fails */
+		*wl = dq->items[t & (STRESS_WORKLOAD_DEQUE_SIZE - 1)];
+		if (__atomic_compare_exchange_n(&dq->top, &t, t + 1, false,
+						__ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			return true;
+	}
+}
+
+/*
+ *  stress_workload_pool_push()
+ *	hand a quantum to the pool, the shared fifo pool has one
+ *	deque, static and stealing pools assign quanta round robin
+ */
+static bool stress_workload_pool_push(
+	stress_workload_pool_t *pool,
+	const stress_workload_t *wl)
+{
+	stress_workload_deque_t *dq = &pool->deques[pool->next];
+
+	pool->next++;
+	if (pool->next >= pool->n_deques)
+		pool->next = 0;
+
+	while (!stress_workload_deque_push(dq, wl)) {
+		if (!stress_continue_flag())
+			return false;
+		shim_sched_yield();
+	}
+	return true;
+}
+
+/*
+ *  stress_workload_worker()
+ *	pool worker, runs quanta from its own deque and when
+ *	stealing is enabled takes quanta from the other deques
+ *	when its own deque is empty
+ */
+static void *stress_workload_worker(void *arg)
+{
+	stress_workload_worker_t *w = (stress_workload_worker_t *)arg;
+	stress_workload_pool_t *pool = w->pool;
+	stress_workload_deque_t *own = &pool->deques[w->index % pool->n_deques];
+	uint32_t idle = 0;
+
+	while (pool->run) {
+		stress_workload_t wl;
+		bool got = stress_workload_deque_steal(own, &wl);
+
+		if (!got && (pool->type == STRESS_WORKLOAD_POOL_STEAL)) {
+			uint32_t i;
+
+			for (i = 1; i < pool->n_deques; i++) {
+				const uint32_t victim = (w->index + i) % pool->n_deques;
+
+				if (stress_workload_deque_steal(&pool->deques[victim], &wl)) {
+					w->stolen++;
+					got = true;
+					break;
+				}
+			}
+		}
+		if (got) {
+			const double t_start = stress_time_now();
+
+			stress_workload_waste_time(pool->workload_method, wl.run_duration_sec,
+						   pool->buffer, pool->buffer_len);
+			stress_workload_record(pool->results, wl.level, wl.arrival, t_start, stress_time_now());
+			w->completed++;
+			idle = 0;
+		} else if (idle < 64) {
+			idle++;
+			shim_sched_yield();
+		} else {
+			shim_nanosleep_uint64(STRESS_WORKLOAD_POOL_IDLE_NS);
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  stress_workload_pool_stop()
+ *	stop and reap the pool workers
+ */
+static void stress_workload_pool_stop(stress_workload_pool_t *pool)
+{
+	uint32_t i;
+
+	pool->run = false;
+	for (i = 0; i < pool->n_workers; i++) {
+		if (pool->workers[i].ret == 0) {
+			VOID_RET(int, pthread_join(pool->workers[i].pthread, NULL));
+			pool->workers[i].ret = -1;
+		}
+	}
+}
+
+/*
+ *  stress_workload_pool_free()
+ *	stop the pool workers and free the pool
+ */
+static void stress_workload_pool_free(stress_workload_pool_t *pool)
+{
+	if (!pool)
+		return;
+	stress_workload_pool_stop(pool);
+	free(pool->workers);
+	free(pool->deques);
+	free(pool);
+}
+
+/*
+ *  stress_workload_pool_create()
+ *	create a pool of n_workers threads fed from deques
+ */
+static stress_workload_pool_t *stress_workload_pool_create(
+	stress_args_t *args,
+	const int type,
+	const uint32_t n_workers,
+	uint8_t *buffer,
+	const size_t buffer_len,
+	const int workload_method,
+	stress_workload_results_t *results)
+{
+	stress_workload_pool_t *pool;
+	uint32_t i, started = 0;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool) {
+		pr_inf_skip("%s: cannot allocate thread pool, skipping stressor\n", args->name);
+		return NULL;
+	}
+	pool->type = type;
+	pool->n_deques = (type == STRESS_WORKLOAD_POOL_FIFO) ? 1 : n_workers;
+	pool->buffer = buffer;
+	pool->buffer_len = buffer_len;
+	pool->workload_method = workload_method;
+	pool->results = results;
+	pool->run = true;
+
+	pool->deques = calloc((size_t)pool->n_deques, sizeof(*pool->deques));
+	if (!pool->deques) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " work queues, "
+			"skipping stressor\n", args->name, pool->n_deques);
+		free(pool);
+		return NULL;
+	}
+	pool->workers = calloc((size_t)n_workers, sizeof(*pool->workers));
+	if (!pool->workers) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " thread descriptors, "
+			"skipping stressor\n", args->name, n_workers);
+		free(pool->deques);
+		free(pool);
+		return NULL;
+	}
+	pool->n_workers = n_workers;
+	for (i = 0; i < n_workers; i++) {
+		pool->workers[i].index = i;
+		pool->workers[i].pool = pool;
+		pool->workers[i].ret = pthread_create(&pool->workers[i].pthread, NULL,
+				stress_workload_worker, (void *)&pool->workers[i]);
+		if (pool->workers[i].ret == 0)
+			started++;
+	}
+	if (started < n_workers) {
+		/* static assignment needs a worker for every deque */
+		pr_inf_skip("%s: only %" PRIu32 " of %" PRIu32 " pool threads started, "
+			"skipping stressor\n", args->name, started, n_workers);
+		stress_workload_pool_free(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+/*
+ *  stress_workload_pool_report()
+ *	report pool throughput and work stealing rates
+ */
+static void stress_workload_pool_report(
+	stress_args_t *args,
+	const stress_workload_pool_t *pool,
+	const double duration,
+	size_t metric)
+{
+	uint64_t completed = 0, stolen = 0;
+	uint32_t i;
+
+	if (duration <= 0.0)
+		return;
+	for (i = 0; i < pool->n_workers; i++) {
+		completed += pool->workers[i].completed;
+		stolen += pool->workers[i].stolen;
+	}
+	stress_metrics_set(args, metric++, "pool quanta completed per sec",
+		(double)completed / duration, STRESS_HARMONIC_MEAN);
+	if (pool->type == STRESS_WORKLOAD_POOL_STEAL) {
+		stress_metrics_set(args, metric++, "pool quanta stolen per sec",
+			(double)stolen / duration, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, metric++, "pool quanta stolen %",
+			completed ? 100.0 * (double)stolen / (double)completed : 0.0,
+			STRESS_GEOMETRIC_MEAN);
+	}
+}
+#endif
+
+/*
+ *  stress_workload_exercise()
+ *	dispatch n_quanta quanta in the slice starting at *t_slice,
+ *	the slices are scheduled back to back from the start time
+ *	and not from when the previous slice completed so late
+ *	quanta queue up rather than slowing the arrival rate
+ */
 static int stress_workload_exercise(
 	stress_args_t *args,
 #if defined(WORKLOAD_THREADED)
 	const mqd_t mq,
 #endif
 	const uint32_t workload_method,
-	const uint32_t workload_load,
 	const uint32_t workload_slice_us,
 	const uint32_t workload_quanta_us,
 	const uint32_t workload_threads,
-	const uint32_t max_quanta,
+	const uint32_t n_quanta,
+	const double run_duration_sec,
 	const int workload_dist,
 	stress_workload_t *workload,
 	stress_workload_bucket_t *slice_offset_bucket,
 	uint8_t *buffer,
-	const size_t buffer_len)
+	const size_t buffer_len,
+	stress_workload_results_t *results,
+	stress_workload_pool_t *pool,
+	const uint32_t level,
+	double *t_slice)
 {
 	size_t i;
 	const double scale_us_to_sec = 1.0 / STRESS_DBL_MICROSECOND;
-	double t_begin, t_end, sleep_duration_ns, run_duration_sec;
+	double t_begin, t_end, sleep_duration_ns;
 	double scale32bit = 1.0 / (double)4294967296.0;
 	double sum, scale;
 	uint32_t offset;
 
-	run_duration_sec = (double)workload_quanta_us * scale_us_to_sec * ((double)workload_load / 100.0);
-
 	switch (workload_dist) {
 	case STRESS_WORKLOAD_DIST_RANDOM1:
-		for (i = 0; i < max_quanta; i++) {
+		for (i = 0; i < n_quanta; i++) {
 			workload[i].when_us = (double)stress_mwc32modn(workload_slice_us - workload_quanta_us);
 			workload[i].run_duration_sec = run_duration_sec;
 		}
 		break;
 	case STRESS_WORKLOAD_DIST_RANDOM2:
-		for (i = 0; i < max_quanta; i++) {
+		for (i = 0; i < n_quanta; i++) {
 			workload[i].when_us = (double)(stress_mwc32modn(workload_slice_us - workload_quanta_us) +
 					       stress_mwc32modn(workload_slice_us - workload_quanta_us)) / 2.0;
 			workload[i].run_duration_sec = run_duration_sec;
 		}
 		break;
 	case STRESS_WORKLOAD_DIST_RANDOM3:
-		for (i = 0; i < max_quanta; i++) {
+		for (i = 0; i < n_quanta; i++) {
 			workload[i].when_us = (double)(stress_mwc32modn(workload_slice_us - workload_quanta_us) +
 					       stress_mwc32modn(workload_slice_us - workload_quanta_us) +
 					       stress_mwc32modn(workload_slice_us - workload_quanta_us)) / 3.0;
@@ -796,18 +1200,18 @@ static int stress_workload_exercise(
 		break;
 	case STRESS_WORKLOAD_DIST_CLUSTER:
 		offset = stress_mwc32modn(workload_slice_us / 2);
-		for (i = 0; i < (max_quanta * 2) / 3; i++) {
+		for (i = 0; i < (n_quanta * 2) / 3; i++) {
 			workload[i].when_us = (double)(stress_mwc32modn(workload_quanta_us) + offset);
 			workload[i].run_duration_sec = run_duration_sec;
 		}
-		for (; i < max_quanta; i++) {
+		for (; i < n_quanta; i++) {
 			workload[i].when_us = (double)stress_mwc32modn(workload_slice_us - workload_quanta_us);
 			workload[i].run_duration_sec = run_duration_sec;
 		}
 		break;
 	case STRESS_WORKLOAD_DIST_POISSON:
 		sum = 0.0;
-		for (i = 0; i < max_quanta; i++) {
+		for (i = 0; i < n_quanta; i++) {
 			double rnd = (double)stress_mwc32() * scale32bit;
 			double val = -log(1.0 - rnd);
 
@@ -815,27 +1219,28 @@ static int stress_workload_exercise(
 			workload[i].when_us = sum;
 		}
 		scale = (workload_slice_us - workload_quanta_us) / sum;
-		for (i = 0; i < max_quanta; i++) {
+		for (i = 0; i < n_quanta; i++) {
 			workload[i].when_us *= scale;
 			workload[i].run_duration_sec = run_duration_sec;
 		}
 		break;
 	case STRESS_WORKLOAD_DIST_EVEN:
-		scale = (double)workload_slice_us / (double)max_quanta;
-		for (i = 0; i < max_quanta; i++) {
+		scale = (double)workload_slice_us / (double)n_quanta;
+		for (i = 0; i < n_quanta; i++) {
 			workload[i].when_us = (double)i * scale;
 			workload[i].run_duration_sec = run_duration_sec;
 		}
 		break;
 	}
 
-	qsort(workload, max_quanta, sizeof(*workload), stress_workload_cmp);
+	qsort(workload, n_quanta, sizeof(*workload), stress_workload_cmp);
 
-	t_begin = stress_time_now();
+	t_begin = *t_slice;
 	t_end = t_begin + ((double)workload_slice_us * scale_us_to_sec);
 
-	for (i = 0; i < max_quanta; i++) {
+	for (i = 0; i < n_quanta; i++) {
 		const double run_when = t_begin + (workload[i].when_us * scale_us_to_sec);
+		double t_start;
 
 		sleep_duration_ns = (run_when - stress_time_now()) * STRESS_DBL_NANOSECOND;
 		if (sleep_duration_ns > 10000.0) {
@@ -843,29 +1248,35 @@ static int stress_workload_exercise(
 		} else {
 			shim_sched_yield();
 		}
-		stress_workload_bucket_account(slice_offset_bucket, STRESS_DBL_MICROSECOND * (stress_time_now() - t_begin));
+		t_start = stress_time_now();
+		stress_workload_bucket_account(slice_offset_bucket, STRESS_DBL_MICROSECOND * (t_start - t_begin));
+		workload[i].arrival = run_when;
+		workload[i].level = level;
 		if (run_duration_sec > 0.0) {
 			if (workload_threads) {
+#if defined(WORKLOAD_POOL)
+				if (pool) {
+					if (stress_workload_pool_push(pool, &workload[i]))
+						results->levels[level].dispatched++;
+				} else
+#endif
+				{
 #if defined(WORKLOAD_THREADED)
-				double sleep_secs;
-
-				if (i == (max_quanta - 1)) {
-					sleep_secs = t_end - stress_time_now();
-				} else {
-					sleep_secs = (workload[i + 1].when_us - workload[i].when_us) / STRESS_DBL_MICROSECOND;
-				}
-				(void)mq_send(mq, (const char *)&workload[i], sizeof(workload[i]), 0);
-				if (sleep_secs > 0.0)
-					shim_nanosleep_uint64((uint64_t)(run_duration_sec * STRESS_DBL_NANOSECOND));
+					if (mq_send(mq, (const char *)&workload[i], sizeof(workload[i]), 0) == 0)
+						results->levels[level].dispatched++;
 #else
-				stress_workload_waste_time(workload_method, run_duration_sec, buffer, buffer_len);
+					stress_workload_waste_time(workload_method, run_duration_sec, buffer, buffer_len);
+					stress_workload_record(results, level, run_when, t_start, stress_time_now());
 #endif
+				}
 			} else {
 				stress_workload_waste_time(workload_method, run_duration_sec, buffer, buffer_len);
+				stress_workload_record(results, level, run_when, t_start, stress_time_now());
 			}
 		}
 		stress_bogo_inc(args);
 	}
+	*t_slice = t_end;
 	sleep_duration_ns = (t_end - stress_time_now()) * STRESS_DBL_NANOSECOND;
 	if (sleep_duration_ns > 100.0)
 		shim_nanosleep_uint64((uint64_t)sleep_duration_ns);
@@ -884,9 +1295,12 @@ static void *stress_workload_thread(void *ctxt)
 		stress_workload_t wl;
 
 		ret = mq_receive(c->mq, (char *)&wl, sizeof(wl), &prio);
-		if (ret == sizeof(wl))
+		if (ret == sizeof(wl)) {
+			const double t_start = stress_time_now();
+
 			stress_workload_waste_time(c->workload_method, wl.run_duration_sec, c->buffer, c->buffer_len);
-		else {
+			stress_workload_record(c->results, wl.level, wl.arrival, t_start, stress_time_now());
+		} else {
 			if ((errno == EINTR) || (errno == ETIMEDOUT)) {
 				continue;
 			}
@@ -897,13 +1311,163 @@ static void *stress_workload_thread(void *ctxt)
 }
 #endif
 
+#if defined(WORKLOAD_THREADED) ||	\
+    defined(WORKLOAD_POOL)
+/*
+ *  stress_workload_drain()
+ *	wait for the worker threads to complete the quanta
+ *	dispatched to them at a load level
+ */
+static void stress_workload_drain(
+	stress_workload_results_t *results,
+	const uint32_t level)
+{
+	const stress_workload_level_t *lvl = &results->levels[level];
+	const double t_end = stress_time_now() + 1.0;
+
+	while (stress_continue_flag() && (stress_time_now() < t_end)) {
+		uint64_t count;
+
+		if (stress_lock_acquire(results->lock) < 0)
+			break;
+		count = lvl->response.count;
+		(void)stress_lock_release(results->lock);
+		if (count >= lvl->dispatched)
+			break;
+		(void)shim_usleep(1000);
+	}
+}
+#endif
+
+/*
+ *  stress_workload_achieved()
+ *	percentage of the servers' time spent running quanta
+ */
+static double stress_workload_achieved(
+	const stress_workload_level_t *lvl,
+	const uint32_t servers)
+{
+	const double duration = lvl->t_end - lvl->t_start;
+
+	return (duration > 0.0) ? 100.0 * lvl->service / (duration * (double)servers) : 0.0;
+}
+
+/*
+ *  stress_workload_report()
+ *	report response time and queueing delay metrics,
+ *	returns the next free metrics index
+ */
+static size_t stress_workload_report(
+	stress_args_t *args,
+	const stress_workload_results_t *results,
+	const uint32_t servers)
+{
+	const stress_workload_level_t *lvl = &results->levels[0];
+	static const double pcts[] = { 50.0, 90.0, 99.0, 99.9 };
+	static const char * const pct_names[] = { "p50", "p90", "p99", "p99.9" };
+	char str[64];
+	size_t i;
+	size_t metric = 0;
+
+	if (lvl->response.count == 0)
+		return metric;
+
+	for (i = 0; i < SIZEOF_ARRAY(pcts); i++) {
+		(void)snprintf(str, sizeof(str), "response time %s usec", pct_names[i]);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&lvl->response, pcts[i]) / 1000.0,
+			STRESS_GEOMETRIC_MEAN);
+	}
+	stress_metrics_set(args, metric++, "response time max usec",
+		(double)lvl->response.max / 1000.0, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, metric++, "queueing delay mean usec",
+		lvl->queued.sum / (double)lvl->queued.count / 1000.0, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, metric++, "queueing delay p99 usec",
+		(double)stress_latency_percentile(&lvl->queued, 99.0) / 1000.0,
+		STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, metric++, "service time mean usec",
+		STRESS_DBL_MICROSECOND * lvl->service / (double)lvl->response.count,
+		STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, metric++, "achieved load %",
+		stress_workload_achieved(lvl, servers), STRESS_GEOMETRIC_MEAN);
+	return metric;
+}
+
+/*
+ *  stress_workload_sweep_report()
+ *	report response times against offered load for each
+ *	load level run in the sweep, returns the next free
+ *	metrics index
+ */
+static size_t stress_workload_sweep_report(
+	stress_args_t *args,
+	const stress_workload_results_t *results,
+	const uint32_t n_levels,
+	const uint32_t servers,
+	const uint32_t saturated)
+{
+	char str[64];
+	uint32_t i;
+	size_t metric = 0;
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %7s %8s %10s %10s %10s %10s %10s\n", args->name,
+			"offered", "achieved", "p50 us", "p90 us", "p99 us",
+			"p99.9 us", "queue us");
+		for (i = 0; i < n_levels; i++) {
+			const stress_workload_level_t *lvl = &results->levels[i];
+
+			if (lvl->response.count == 0)
+				continue;
+			pr_inf("%s: %6" PRIu32 "%% %7.1f%% %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+				args->name, lvl->load,
+				stress_workload_achieved(lvl, servers),
+				(double)stress_latency_percentile(&lvl->response, 50.0) / 1000.0,
+				(double)stress_latency_percentile(&lvl->response, 90.0) / 1000.0,
+				(double)stress_latency_percentile(&lvl->response, 99.0) / 1000.0,
+				(double)stress_latency_percentile(&lvl->response, 99.9) / 1000.0,
+				lvl->queued.sum / (double)lvl->queued.count / 1000.0);
+		}
+		if (saturated)
+			pr_inf("%s: response times saturated at %" PRIu32 "%% offered load\n",
+				args->name, saturated);
+		else
+			pr_inf("%s: response times did not saturate\n", args->name);
+		pr_block_end();
+	}
+
+	for (i = 0; i < n_levels; i++) {
+		const stress_workload_level_t *lvl = &results->levels[i];
+
+		if (lvl->response.count == 0)
+			continue;
+		(void)snprintf(str, sizeof(str), "%" PRIu32 "%% load response p50 usec", lvl->load);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&lvl->response, 50.0) / 1000.0,
+			STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%" PRIu32 "%% load response p99 usec", lvl->load);
+		stress_metrics_set(args, metric++, str,
+			(double)stress_latency_percentile(&lvl->response, 99.0) / 1000.0,
+			STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%" PRIu32 "%% load queueing delay mean usec", lvl->load);
+		stress_metrics_set(args, metric++, str,
+			lvl->queued.sum / (double)lvl->queued.count / 1000.0,
+			STRESS_GEOMETRIC_MEAN);
+	}
+	if (saturated)
+		stress_metrics_set(args, metric++, "saturation offered load %",
+			(double)saturated, STRESS_GEOMETRIC_MEAN);
+	return metric;
+}
+
 static int stress_workload(stress_args_t *args)
 {
 	uint32_t workload_load = 30;
 	uint32_t workload_slice_us = 100000;	/* 1/10th second */
 	uint32_t workload_quanta_us = 1000;	/* 1/1000th second */
 	uint32_t workload_threads = 0;		/* 0 = disabled */
-	uint32_t max_quanta;
+	uint32_t max_quanta, servers, n_levels, level, saturated = 0;
 	size_t workload_sched = 0;		/* undefined */
 	int workload_dist = STRESS_WORKLOAD_DIST_CLUSTER;
 	int workload_method = STRESS_WORKLOAD_METHOD_ALL;
@@ -911,7 +1475,13 @@ static int stress_workload(stress_args_t *args)
 	uint8_t *buffer;
 	const size_t buffer_len = MB;
 	stress_workload_bucket_t slice_offset_bucket;
+	stress_workload_results_t results;
+	stress_workload_pool_t *pool = NULL;
+	double run_duration_sec, level_duration, t_slice, t_run;
+	bool workload_sweep = false;
+	int workload_pool = STRESS_WORKLOAD_POOL_MQ;
 	int rc = EXIT_SUCCESS;
+	size_t metric;
 #if defined(WORKLOAD_THREADED)
 	workload_thread_t *threads = NULL;
 	char mq_name[64];
@@ -922,9 +1492,11 @@ static int stress_workload(stress_args_t *args)
 	(void)stress_get_setting("workload-dist", &workload_dist);
 	(void)stress_get_setting("workload-load", &workload_load);
 	(void)stress_get_setting("workload-method", &workload_method);
+	(void)stress_get_setting("workload-pool", &workload_pool);
 	(void)stress_get_setting("workload-quanta-us", &workload_quanta_us);
 	(void)stress_get_setting("workload-sched", &workload_sched);
 	(void)stress_get_setting("workload-slice-us", &workload_slice_us);
+	(void)stress_get_setting("workload-sweep", &workload_sweep);
 	(void)stress_get_setting("workload-threads", &workload_threads);
 
 	if (args->instance == 0) {
@@ -950,7 +1522,41 @@ static int stress_workload(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 
-	if (workload_threads > 0) {
+	n_levels = workload_sweep ? STRESS_WORKLOAD_SWEEP_LEVELS : 1;
+	results.lock = NULL;
+	results.levels = calloc((size_t)n_levels, sizeof(*results.levels));
+	if (!results.levels) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " load level results, "
+			"skipping stressor\n", args->name, n_levels);
+		rc = EXIT_NO_RESOURCE;
+		goto exit_free_buffer;
+	}
+
+	if (workload_pool != STRESS_WORKLOAD_POOL_MQ) {
+#if defined(WORKLOAD_POOL)
+		if (workload_threads == 0)
+			workload_threads = STRESS_WORKLOAD_THREADS;
+		results.lock = stress_lock_create("workload-results");
+		if (!results.lock) {
+			pr_inf_skip("%s: cannot create results lock, "
+				"skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto exit_free_levels;
+		}
+		pool = stress_workload_pool_create(args, workload_pool, workload_threads,
+				buffer, buffer_len, workload_method, &results);
+		if (!pool) {
+			rc = EXIT_NO_RESOURCE;
+			goto exit_free_pool;
+		}
+#else
+		pr_inf("%s: thread pools require pthread and atomic operation "
+			"support, using the message queue instead\n", args->name);
+		workload_pool = STRESS_WORKLOAD_POOL_MQ;
+#endif
+	}
+
+	if ((workload_threads > 0) && !pool) {
 #if defined(WORKLOAD_THREADED)
 		struct mq_attr attr;
 		stress_workload_ctxt_t c;
@@ -968,7 +1574,14 @@ static int stress_workload(stress_args_t *args)
 				"skipping stressor\n", args->name,
 				errno, strerror(errno));
 			rc = EXIT_NO_RESOURCE;
-			goto exit_free_buffer;
+			goto exit_free_levels;
+		}
+		results.lock = stress_lock_create("workload-results");
+		if (!results.lock) {
+			pr_inf_skip("%s: cannot create results lock, "
+				"skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto exit_close_mq;
 		}
 		threads = calloc((size_t)workload_threads, sizeof(*threads));
 		if (!threads) {
@@ -983,6 +1596,7 @@ static int stress_workload(stress_args_t *args)
 		c.buffer_len = buffer_len;
 		c.workload_method = workload_method;
 		c.mq = mq;
+		c.results = &results;
 		for (i = 0; i < workload_threads; i++) {
 			threads[i].ret = pthread_create(&threads[i].pthread, NULL,
                                 stress_workload_thread, (void *)&c);
@@ -1003,9 +1617,17 @@ static int stress_workload(stress_args_t *args)
 		workload_threads = 0;
 #endif
 	}
-	if (args->instance == 0)
-		pr_inf("%s: running with %" PRIu32 " threads per stressor instance\n",
-			args->name, workload_threads);
+	if (args->instance == 0) {
+		static const char * const pool_names[] = {
+			"message queue", "shared fifo", "static", "work stealing"
+		};
+
+		pr_inf("%s: running with %" PRIu32 " threads per stressor instance%s%s%s\n",
+			args->name, workload_threads,
+			workload_threads ? " using a " : "",
+			workload_threads ? pool_names[workload_pool] : "",
+			workload_threads ? " pool" : "");
+	}
 
 	if (workload_quanta_us > workload_slice_us) {
 		pr_err("%s: workload-quanta-us %" PRIu32 " must be less "
@@ -1015,7 +1637,7 @@ static int stress_workload(stress_args_t *args)
 #if defined(WORKLOAD_THREADED)
 		goto exit_free_threads;
 #else
-		goto exit_free_buffer;
+		goto exit_free_pool;
 #endif
 	}
 
@@ -1034,7 +1656,7 @@ static int stress_workload(stress_args_t *args)
 #if defined(WORKLOAD_THREADED)
 		goto exit_free_threads;
 #else
-		goto exit_free_buffer;
+		goto exit_free_pool;
 #endif
 	}
 
@@ -1042,34 +1664,115 @@ static int stress_workload(stress_args_t *args)
 
 	(void)stress_workload_set_sched(args, workload_sched);
 
+	servers = (workload_threads > 0) ? workload_threads : 1;
+	if (workload_sweep) {
+		/*
+		 *  each quantum runs for the full quanta and the number
+		 *  of quanta arriving per slice is scaled to the offered
+		 *  load, each load level gets an equal share of the run
+		 */
+		run_duration_sec = (double)workload_quanta_us / STRESS_DBL_MICROSECOND;
+		level_duration = (double)g_opt_timeout / (double)n_levels;
+		if (level_duration < (double)workload_slice_us / STRESS_DBL_MICROSECOND)
+			level_duration = (double)workload_slice_us / STRESS_DBL_MICROSECOND;
+		if (args->instance == 0)
+			pr_inf("%s: sweeping offered load from %d%% to 100%%, %.2f seconds per load level\n",
+				args->name, 100 / STRESS_WORKLOAD_SWEEP_LEVELS, level_duration);
+	} else {
+		run_duration_sec = (double)workload_quanta_us / STRESS_DBL_MICROSECOND *
+				   ((double)workload_load / 100.0);
+		level_duration = 0.0;
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
-	do {
-		stress_workload_exercise(args,
+	t_run = stress_time_now();
+	for (level = 0; level < n_levels; level++) {
+		stress_workload_level_t *lvl = &results.levels[level];
+		uint32_t n_quanta = max_quanta;
+
+		if (workload_sweep) {
+			lvl->load = ((level + 1) * 100) / n_levels;
+			n_quanta = (uint32_t)(((uint64_t)max_quanta * lvl->load) / 100);
+			if (n_quanta < 1)
+				n_quanta = 1;
+		} else {
+			lvl->load = workload_load;
+		}
+		lvl->n_quanta = n_quanta;
+		lvl->t_start = stress_time_now();
+		t_slice = lvl->t_start;
+
+		do {
+			stress_workload_exercise(args,
 #if defined(WORKLOAD_THREADED)
-					mq,
+						mq,
+#endif
+						workload_method,
+						workload_slice_us,
+						workload_quanta_us,
+						workload_threads,
+						n_quanta,
+						run_duration_sec,
+						workload_dist,
+						workload,
+						&slice_offset_bucket,
+						buffer, buffer_len,
+						&results, pool, level, &t_slice);
+		} while (stress_continue(args) &&
+			 (!workload_sweep || (stress_time_now() < lvl->t_start + level_duration)));
+
+#if defined(WORKLOAD_THREADED) ||	\
+    defined(WORKLOAD_POOL)
+		if (workload_threads > 0)
+			stress_workload_drain(&results, level);
 #endif
-					workload_method,
-					workload_load,
-					workload_slice_us,
-					workload_quanta_us,
-					workload_threads,
-					max_quanta, workload_dist,
-					workload,
-					&slice_offset_bucket,
-					buffer, buffer_len);
-	} while (stress_continue(args));
+		lvl->t_end = stress_time_now();
+
+		if (workload_sweep && (lvl->response.count > 0) &&
+		    ((double)stress_latency_percentile(&lvl->response, 99.0) >
+		     STRESS_WORKLOAD_SATURATED * run_duration_sec * STRESS_DBL_NANOSECOND)) {
+			saturated = lvl->load;
+			break;
+		}
+		if (!stress_continue(args))
+			break;
+	}
+
+	t_run = stress_time_now() - t_run;
+
+	/* sweep complete, idle until the end of the run */
+	while (workload_sweep && stress_continue(args))
+		(void)shim_usleep(100000);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	if (args->instance == 0)
 		stress_workload_bucket_report(&slice_offset_bucket);
 
+	if (args->latency) {
+		for (level = 0; level < n_levels; level++)
+			stress_latency_merge(args->latency, &results.levels[level].response);
+	}
+	if (workload_sweep)
+		metric = stress_workload_sweep_report(args, &results, n_levels, servers, saturated);
+	else
+		metric = stress_workload_report(args, &results, servers);
+#if defined(WORKLOAD_POOL)
+	if (pool) {
+		stress_workload_pool_stop(pool);
+		stress_workload_pool_report(args, pool, t_run, metric);
+	}
+#else
+	(void)metric;
+	(void)t_run;
+#endif
+
 	free(workload);
 
 #if defined(WORKLOAD_THREADED)
 exit_free_threads:
-	for (i = 0; i < workload_threads; i++) {
+	for (i = 0; threads && (i < workload_threads); i++) {
 		if (threads[i].ret == 0) {
 			VOID_RET(int, pthread_cancel(threads[i].pthread));
 			VOID_RET(int, pthread_join(threads[i].pthread, NULL));
@@ -1084,6 +1787,14 @@ exit_close_mq:
 
 	free(threads);
 #endif
+exit_free_pool:
+#if defined(WORKLOAD_POOL)
+	stress_workload_pool_free(pool);
+#endif
+	if (results.lock)
+		(void)stress_lock_destroy(results.lock);
+exit_free_levels:
+	free(results.levels);
 exit_free_buffer:
 	(void)munmap((void *)buffer, buffer_len);
 	return rc;
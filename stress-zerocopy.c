@@ -0,0 +1,698 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+
+#include <sys/socket.h>
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
+#define MIN_ZEROCOPY_BYTES	(1 * MB)
+#define MAX_ZEROCOPY_BYTES	(1 * GB)
+#define DEFAULT_ZEROCOPY_BYTES	(16 * MB)
+
+#define MIN_ZEROCOPY_SIZE	(1 * KB)
+#define MAX_ZEROCOPY_SIZE	(16 * MB)
+
+#define ZEROCOPY_PIPE_SIZE	(1 * MB)
+#define ZEROCOPY_BUF_SIZE	(64 * KB)
+
+static const stress_help_t help[] = {
+	{ NULL,	"zerocopy N",		"start N workers comparing data movement methods" },
+	{ NULL,	"zerocopy-bytes N",	"number of bytes to move per transfer" },
+	{ NULL,	"zerocopy-ops N",	"stop after N bogo transfers" },
+	{ NULL,	"zerocopy-size N",	"move data in N byte chunks rather than 4K, 64K and 1M" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_zerocopy_bytes(const char *opt)
+{
+	uint64_t zerocopy_bytes;
+
+	zerocopy_bytes = stress_get_uint64_byte_filesystem(opt, 1);
+	stress_check_range_bytes("zerocopy-bytes", zerocopy_bytes,
+		MIN_ZEROCOPY_BYTES, MAX_ZEROCOPY_BYTES);
+	return stress_set_setting("zerocopy-bytes", TYPE_ID_UINT64, &zerocopy_bytes);
+}
+
+static int stress_set_zerocopy_size(const char *opt)
+{
+	uint64_t zerocopy_size;
+
+	zerocopy_size = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("zerocopy-size", zerocopy_size,
+		MIN_ZEROCOPY_SIZE, MAX_ZEROCOPY_SIZE);
+	return stress_set_setting("zerocopy-size", TYPE_ID_UINT64, &zerocopy_size);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_zerocopy_bytes,	stress_set_zerocopy_bytes },
+	{ OPT_zerocopy_size,	stress_set_zerocopy_size },
+	{ 0,			NULL }
+};
+
+#if defined(__linux__) &&	\
+    defined(AF_UNIX)
+
+#define ZEROCOPY_FILE_FILE	(0)	/* file to file */
+#define ZEROCOPY_FILE_SOCK	(1)	/* file to socket */
+#define ZEROCOPY_PIPE_FILE	(2)	/* pipe to file */
+#define ZEROCOPY_PATHS		(3)
+
+static const char * const zerocopy_paths[ZEROCOPY_PATHS] = {
+	"file-file",
+	"file-sock",
+	"pipe-file",
+};
+
+static const size_t zerocopy_sizes[] = {
+	4 * KB,
+	64 * KB,
+	1 * MB,
+};
+
+typedef struct {
+	int src_fd;			/* source file */
+	int dst_fd;			/* destination file */
+	int sock_fd;			/* socket to the draining child */
+	int pipe_fd;			/* pipe from the filling child */
+	int splice_fds[2];		/* intermediate pipe for file splicing */
+	size_t splice_size;		/* intermediate pipe size */
+	uint64_t bytes;			/* bytes moved per transfer */
+	uint8_t *src_map;		/* mmap'd source file, NULL if not mapped */
+	uint8_t *buf;			/* read/write buffer */
+} stress_zerocopy_ctx_t;
+
+/* move up to len bytes, off is NULL if fd_in is a pipe */
+typedef ssize_t (*stress_zerocopy_func_t)(const stress_zerocopy_ctx_t *ctx,
+	const int fd_in, const int fd_out, off_t *off, const size_t len);
+
+typedef struct {
+	const char *name;		/* method name */
+	const stress_zerocopy_func_t func; /* data mover */
+	const bool paths[ZEROCOPY_PATHS]; /* data paths the method can move */
+} stress_zerocopy_method_t;
+
+typedef struct {
+	double bytes;			/* bytes moved */
+	double duration;		/* wall clock time moving bytes */
+	double cpu;			/* user + system time moving bytes */
+} stress_zerocopy_stats_t;
+
+/*
+ *  stress_zerocopy_cpu_time()
+ *	user and system time of this process in seconds
+ */
+static double stress_zerocopy_cpu_time(void)
+{
+	struct rusage usage;
+
+	if (shim_getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return (double)usage.ru_utime.tv_sec + ((double)usage.ru_utime.tv_usec / STRESS_DBL_MICROSECOND) +
+	       (double)usage.ru_stime.tv_sec + ((double)usage.ru_stime.tv_usec / STRESS_DBL_MICROSECOND);
+}
+
+/*
+ *  stress_zerocopy_write_all()
+ *	write all of buf, returns bytes written or -1 if nothing
+ *	could be written
+ */
+static ssize_t stress_zerocopy_write_all(const int fd, const uint8_t *buf, const size_t len)
+{
+	size_t done = 0;
+
+	while (done < len) {
+		const ssize_t ret = write(fd, buf + done, len - done);
+
+		if (ret <= 0)
+			return done ? (ssize_t)done : ret;
+		done += (size_t)ret;
+	}
+	return (ssize_t)done;
+}
+
+/*
+ *  stress_zerocopy_rw()
+ *	copy through a user space buffer with read and write
+ */
+static ssize_t stress_zerocopy_rw(
+	const stress_zerocopy_ctx_t *ctx,
+	const int fd_in,
+	const int fd_out,
+	off_t *off,
+	const size_t len)
+{
+	const size_t n = STRESS_MINIMUM(len, ZEROCOPY_BUF_SIZE);
+	ssize_t ret;
+
+	ret = off ? pread(fd_in, ctx->buf, n, *off) : read(fd_in, ctx->buf, n);
+	if (ret <= 0)
+		return ret;
+	ret = stress_zerocopy_write_all(fd_out, ctx->buf, (size_t)ret);
+	if ((ret > 0) && off)
+		*off += ret;
+	return ret;
+}
+
+#if defined(HAVE_SYS_SENDFILE_H) &&	\
+    defined(HAVE_SENDFILE)
+/*
+ *  stress_zerocopy_sendfile()
+ *	move file data in the kernel with sendfile
+ */
+static ssize_t stress_zerocopy_sendfile(
+	const stress_zerocopy_ctx_t *ctx,
+	const int fd_in,
+	const int fd_out,
+	off_t *off,
+	const size_t len)
+{
+	(void)ctx;
+
+	return sendfile(fd_out, fd_in, off, len);
+}
+#endif
+
+#if defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MOVE)
+/*
+ *  stress_zerocopy_splice()
+ *	splice from a pipe directly, or from a file via
+ *	an intermediate pipe
+ */
+static ssize_t stress_zerocopy_splice(
+	const stress_zerocopy_ctx_t *ctx,
+	const int fd_in,
+	const int fd_out,
+	off_t *off,
+	const size_t len)
+{
+	shim_off64_t off_in;
+	ssize_t ret, done = 0;
+
+	if (!off)
+		return splice(fd_in, NULL, fd_out, NULL, len, SPLICE_F_MOVE);
+
+	off_in = (shim_off64_t)*off;
+	ret = splice(fd_in, &off_in, ctx->splice_fds[1], NULL,
+		STRESS_MINIMUM(len, ctx->splice_size), SPLICE_F_MOVE);
+	if (ret <= 0)
+		return ret;
+	while (done < ret) {
+		const ssize_t n = splice(ctx->splice_fds[0], NULL, fd_out, NULL,
+			(size_t)(ret - done), SPLICE_F_MOVE);
+
+		if (n <= 0) {
+			const int saved_errno = errno;
+
+			/* drain the intermediate pipe so the next transfer starts empty */
+			while (done < ret) {
+				const ssize_t r = read(ctx->splice_fds[0], ctx->buf,
+					STRESS_MINIMUM((size_t)(ret - done), ZEROCOPY_BUF_SIZE));
+
+				if (r <= 0)
+					break;
+				done += r;
+			}
+			errno = saved_errno;
+			return -1;
+		}
+		done += n;
+	}
+	*off += ret;
+	return ret;
+}
+#endif
+
+/*
+ *  stress_zerocopy_copy_file_range()
+ *	copy file to file in the kernel, may reflink
+ */
+static ssize_t stress_zerocopy_copy_file_range(
+	const stress_zerocopy_ctx_t *ctx,
+	const int fd_in,
+	const int fd_out,
+	off_t *off,
+	const size_t len)
+{
+	shim_off64_t off_in = (shim_off64_t)*off;
+	ssize_t ret;
+
+	(void)ctx;
+
+	ret = shim_copy_file_range(fd_in, &off_in, fd_out, NULL, len, 0);
+	if (ret > 0)
+		*off += ret;
+	return ret;
+}
+
+/*
+ *  stress_zerocopy_mmap_write()
+ *	write directly from the mmap'd source file
+ */
+static ssize_t stress_zerocopy_mmap_write(
+	const stress_zerocopy_ctx_t *ctx,
+	const int fd_in,
+	const int fd_out,
+	off_t *off,
+	const size_t len)
+{
+	ssize_t ret;
+
+	(void)fd_in;
+
+	ret = stress_zerocopy_write_all(fd_out, ctx->src_map + *off, len);
+	if (ret > 0)
+		*off += ret;
+	return ret;
+}
+
+static const stress_zerocopy_method_t zerocopy_methods[] = {
+	/*				  file-file file-sock pipe-file */
+	{ "read-write",	stress_zerocopy_rw,	{ true,	true,	true } },
+#if defined(HAVE_SYS_SENDFILE_H) &&	\
+    defined(HAVE_SENDFILE)
+	{ "sendfile",	stress_zerocopy_sendfile, { true, true,	false } },
+#endif
+#if defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MOVE)
+	{ "splice",	stress_zerocopy_splice,	{ true,	true,	true } },
+#endif
+	{ "copy_file_range", stress_zerocopy_copy_file_range, { true, false, false } },
+	{ "mmap-write",	stress_zerocopy_mmap_write, { true, true, false } },
+};
+
+/*
+ *  stress_zerocopy_transfer()
+ *	move ctx->bytes with a method along a data path in size
+ *	byte chunks, returns 0 on success, 1 if the method is not
+ *	supported on this path and -1 on failure
+ */
+static int stress_zerocopy_transfer(
+	stress_args_t *args,
+	const stress_zerocopy_ctx_t *ctx,
+	const size_t path,
+	const stress_zerocopy_method_t *method,
+	const size_t size,
+	stress_zerocopy_stats_t *stats)
+{
+	int fd_in, fd_out;
+	off_t off = 0, *offp = &off;
+	uint64_t moved = 0;
+	double t, cpu;
+
+	switch (path) {
+	case ZEROCOPY_FILE_FILE:
+	default:
+		fd_in = ctx->src_fd;
+		fd_out = ctx->dst_fd;
+		break;
+	case ZEROCOPY_FILE_SOCK:
+		fd_in = ctx->src_fd;
+		fd_out = ctx->sock_fd;
+		break;
+	case ZEROCOPY_PIPE_FILE:
+		fd_in = ctx->pipe_fd;
+		fd_out = ctx->dst_fd;
+		offp = NULL;
+		break;
+	}
+	if (fd_out == ctx->dst_fd) {
+		if (ftruncate(ctx->dst_fd, 0) < 0) {
+			pr_fail("%s: ftruncate failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		(void)lseek(ctx->dst_fd, 0, SEEK_SET);
+	}
+
+	cpu = stress_zerocopy_cpu_time();
+	t = stress_time_now();
+	while (moved < ctx->bytes) {
+		const size_t len = (size_t)STRESS_MINIMUM((uint64_t)size, ctx->bytes - moved);
+		const ssize_t ret = method->func(ctx, fd_in, fd_out, offp, len);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				break;
+			if ((errno == EINVAL) || (errno == ENOSYS) ||
+			    (errno == EOPNOTSUPP) || (errno == EXDEV)) {
+				pr_dbg("%s: %s %s not supported, errno=%d (%s)\n",
+					args->name, zerocopy_paths[path], method->name,
+					errno, strerror(errno));
+				return 1;
+			}
+			pr_fail("%s: %s %s failed, errno=%d (%s)\n",
+				args->name, zerocopy_paths[path], method->name,
+				errno, strerror(errno));
+			return -1;
+		} else if (ret == 0) {
+			break;
+		}
+		moved += (uint64_t)ret;
+	}
+	stats->duration += stress_time_now() - t;
+	stats->cpu += stress_zerocopy_cpu_time() - cpu;
+	stats->bytes += (double)moved;
+
+	return 0;
+}
+
+/*
+ *  stress_zerocopy_peer()
+ *	fork a child that drains (fill false) or fills (fill true) fd
+ */
+static pid_t stress_zerocopy_peer(stress_args_t *args, const int fd, const bool fill)
+{
+	pid_t pid;
+
+	pid = fork();
+	if (pid == 0) {
+		static uint8_t buf[ZEROCOPY_BUF_SIZE];
+
+		stress_parent_died_alarm();
+		(void)sched_settings_apply(true);
+		(void)signal(SIGPIPE, SIG_IGN);
+
+		if (fill) {
+			stress_rndbuf(buf, sizeof(buf));
+			while (stress_continue_flag()) {
+				if (write(fd, buf, sizeof(buf)) < 0)
+					break;
+			}
+		} else {
+			while (read(fd, buf, sizeof(buf)) > 0)
+				;
+		}
+		_exit(EXIT_SUCCESS);
+	} else if (pid < 0) {
+		pr_inf_skip("%s: fork failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+	}
+	return pid;
+}
+
+/*
+ *  stress_zerocopy_report()
+ *	per buffer size results, too many to report as metrics
+ */
+static void stress_zerocopy_report(
+	stress_args_t *args,
+	stress_zerocopy_stats_t stats[ZEROCOPY_PATHS][SIZEOF_ARRAY(zerocopy_methods)][SIZEOF_ARRAY(zerocopy_sizes)],
+	const size_t *sizes,
+	const size_t n_sizes)
+{
+	size_t p, m, s;
+
+	if (args->instance != 0)
+		return;
+
+	pr_inf("%s: %-10s %-16s %8s %10s %12s\n", args->name,
+		"path", "method", "size", "GB/sec", "CPU ms/GB");
+	for (p = 0; p < ZEROCOPY_PATHS; p++) {
+		for (m = 0; m < SIZEOF_ARRAY(zerocopy_methods); m++) {
+			for (s = 0; s < n_sizes; s++) {
+				const stress_zerocopy_stats_t *st = &stats[p][m][s];
+				const double gb = st->bytes / (double)GB;
+
+				if (gb <= 0.0)
+					continue;
+				pr_inf("%s: %-10s %-16s %7zuK %10.3f %12.2f\n", args->name,
+					zerocopy_paths[p], zerocopy_methods[m].name,
+					(size_t)(sizes[s] / KB),
+					(st->duration > 0.0) ? gb / st->duration : 0.0,
+					(st->cpu * STRESS_DBL_MILLISECOND) / gb);
+			}
+		}
+	}
+}
+
+/*
+ *  stress_zerocopy
+ *	compare moving the same bytes file to file, file to socket
+ *	and pipe to file with different data movement system calls
+ */
+static int stress_zerocopy(stress_args_t *args)
+{
+	static stress_zerocopy_stats_t stats[ZEROCOPY_PATHS][SIZEOF_ARRAY(zerocopy_methods)][SIZEOF_ARRAY(zerocopy_sizes)];
+	bool supported[ZEROCOPY_PATHS][SIZEOF_ARRAY(zerocopy_methods)];
+	stress_zerocopy_ctx_t ctx;
+	char filename[PATH_MAX];
+	uint64_t zerocopy_bytes = DEFAULT_ZEROCOPY_BYTES;
+	uint64_t zerocopy_size = 0, i;
+	size_t sizes[SIZEOF_ARRAY(zerocopy_sizes)];
+	size_t n_sizes, p, m, s, metric = 0;
+	int sv[2], pipe_fds[2];
+	pid_t drain_pid = -1, fill_pid = -1;
+	int ret, rc = EXIT_NO_RESOURCE;
+
+	if (!stress_get_setting("zerocopy-bytes", &zerocopy_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			zerocopy_bytes = MAX_ZEROCOPY_BYTES;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			zerocopy_bytes = MIN_ZEROCOPY_BYTES;
+	}
+	zerocopy_bytes /= args->num_instances;
+	if (zerocopy_bytes < MIN_ZEROCOPY_BYTES)
+		zerocopy_bytes = MIN_ZEROCOPY_BYTES;
+
+	if (stress_get_setting("zerocopy-size", &zerocopy_size)) {
+		sizes[0] = (size_t)zerocopy_size;
+		n_sizes = 1;
+	} else {
+		for (n_sizes = 0; n_sizes < SIZEOF_ARRAY(zerocopy_sizes); n_sizes++)
+			sizes[n_sizes] = zerocopy_sizes[n_sizes];
+	}
+
+	(void)shim_memset(&ctx, 0, sizeof(ctx));
+	ctx.bytes = zerocopy_bytes;
+	ctx.src_fd = -1;
+	ctx.dst_fd = -1;
+	ctx.splice_fds[0] = -1;
+	ctx.splice_fds[1] = -1;
+	sv[0] = -1;
+	sv[1] = -1;
+	pipe_fds[0] = -1;
+	pipe_fds[1] = -1;
+	(void)shim_memset(stats, 0, sizeof(stats));
+
+	ctx.buf = (uint8_t *)malloc(ZEROCOPY_BUF_SIZE);
+	if (!ctx.buf) {
+		pr_inf_skip("%s: cannot allocate %zu byte buffer, skipping stressor\n",
+			args->name, (size_t)ZEROCOPY_BUF_SIZE);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(ctx.buf);
+		return stress_exit_status(-ret);
+	}
+
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	ctx.src_fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (ctx.src_fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy;
+	}
+	(void)shim_unlink(filename);
+
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	ctx.dst_fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (ctx.dst_fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto tidy;
+	}
+	(void)shim_unlink(filename);
+
+	for (i = 0; i < zerocopy_bytes; i += ZEROCOPY_BUF_SIZE) {
+		stress_rndbuf(ctx.buf, ZEROCOPY_BUF_SIZE);
+		if (stress_zerocopy_write_all(ctx.src_fd, ctx.buf, ZEROCOPY_BUF_SIZE) != ZEROCOPY_BUF_SIZE) {
+			pr_inf_skip("%s: cannot write %" PRIu64 " byte source file, "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, zerocopy_bytes, errno, strerror(errno));
+			goto tidy;
+		}
+		if (!stress_continue_flag()) {
+			rc = EXIT_SUCCESS;
+			goto tidy;
+		}
+	}
+
+	ctx.src_map = (uint8_t *)mmap(NULL, (size_t)zerocopy_bytes, PROT_READ,
+		MAP_SHARED, ctx.src_fd, 0);
+	if (ctx.src_map == MAP_FAILED)
+		ctx.src_map = NULL;
+
+	if (pipe(ctx.splice_fds) < 0) {
+		pr_inf_skip("%s: pipe failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		goto tidy;
+	}
+	if (pipe(pipe_fds) < 0) {
+		pr_inf_skip("%s: pipe failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		goto tidy;
+	}
+	ctx.splice_size = 64 * KB;
+#if defined(F_SETPIPE_SZ) &&	\
+    defined(F_GETPIPE_SZ)
+	(void)fcntl(ctx.splice_fds[1], F_SETPIPE_SZ, ZEROCOPY_PIPE_SIZE);
+	(void)fcntl(pipe_fds[1], F_SETPIPE_SZ, ZEROCOPY_PIPE_SIZE);
+	ret = fcntl(ctx.splice_fds[1], F_GETPIPE_SZ);
+	if (ret > 0)
+		ctx.splice_size = (size_t)ret;
+#endif
+	ctx.pipe_fd = pipe_fds[0];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+		pr_inf_skip("%s: socketpair failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		goto tidy;
+	}
+	ctx.sock_fd = sv[0];
+
+	drain_pid = stress_zerocopy_peer(args, sv[1], false);
+	if (drain_pid < 0)
+		goto tidy;
+	fill_pid = stress_zerocopy_peer(args, pipe_fds[1], true);
+	if (fill_pid < 0)
+		goto tidy;
+	(void)close(sv[1]);
+	sv[1] = -1;
+	(void)close(pipe_fds[1]);
+	pipe_fds[1] = -1;
+
+	for (p = 0; p < ZEROCOPY_PATHS; p++) {
+		for (m = 0; m < SIZEOF_ARRAY(zerocopy_methods); m++) {
+			supported[p][m] = zerocopy_methods[m].paths[p];
+			if ((zerocopy_methods[m].func == stress_zerocopy_mmap_write) && !ctx.src_map)
+				supported[p][m] = false;
+		}
+	}
+
+	rc = EXIT_SUCCESS;
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (p = 0; p < ZEROCOPY_PATHS; p++) {
+			for (m = 0; m < SIZEOF_ARRAY(zerocopy_methods); m++) {
+				for (s = 0; (s < n_sizes) && supported[p][m]; s++) {
+					ret = stress_zerocopy_transfer(args, &ctx, p,
+						&zerocopy_methods[m], sizes[s], &stats[p][m][s]);
+					if (ret < 0) {
+						rc = EXIT_FAILURE;
+						goto finish;
+					} else if (ret > 0) {
+						supported[p][m] = false;
+					}
+					stress_bogo_inc(args);
+					if (!stress_continue(args))
+						goto finish;
+				}
+			}
+		}
+	} while (stress_continue(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	for (p = 0; p < ZEROCOPY_PATHS; p++) {
+		for (m = 0; m < SIZEOF_ARRAY(zerocopy_methods); m++) {
+			stress_zerocopy_stats_t total;
+			char description[64];
+			double gb;
+
+			(void)shim_memset(&total, 0, sizeof(total));
+			for (s = 0; s < n_sizes; s++) {
+				total.bytes += stats[p][m][s].bytes;
+				total.duration += stats[p][m][s].duration;
+				total.cpu += stats[p][m][s].cpu;
+			}
+			gb = total.bytes / (double)GB;
+			if (gb <= 0.0)
+				continue;
+			(void)snprintf(description, sizeof(description), "%s %s GB per sec",
+				zerocopy_paths[p], zerocopy_methods[m].name);
+			stress_metrics_set(args, metric++, description,
+				(total.duration > 0.0) ? gb / total.duration : 0.0,
+				STRESS_HARMONIC_MEAN);
+			(void)snprintf(description, sizeof(description), "%s %s CPU ms per GB",
+				zerocopy_paths[p], zerocopy_methods[m].name);
+			stress_metrics_set(args, metric++, description,
+				(total.cpu * STRESS_DBL_MILLISECOND) / gb,
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	if (n_sizes > 1)
+		stress_zerocopy_report(args, stats, sizes, n_sizes);
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (sv[0] >= 0)
+		(void)close(sv[0]);
+	if (sv[1] >= 0)
+		(void)close(sv[1]);
+	if (pipe_fds[0] >= 0)
+		(void)close(pipe_fds[0]);
+	if (pipe_fds[1] >= 0)
+		(void)close(pipe_fds[1]);
+	if (drain_pid > 0)
+		(void)stress_kill_and_wait(args, drain_pid, SIGKILL, false);
+	if (fill_pid > 0)
+		(void)stress_kill_and_wait(args, fill_pid, SIGKILL, false);
+	if (ctx.splice_fds[0] >= 0)
+		(void)close(ctx.splice_fds[0]);
+	if (ctx.splice_fds[1] >= 0)
+		(void)close(ctx.splice_fds[1]);
+	if (ctx.src_map)
+		(void)munmap((void *)ctx.src_map, (size_t)zerocopy_bytes);
+	if (ctx.dst_fd >= 0)
+		(void)close(ctx.dst_fd);
+	if (ctx.src_fd >= 0)
+		(void)close(ctx.src_fd);
+	(void)stress_temp_dir_rm_args(args);
+	free(ctx.buf);
+
+	return rc;
+}
+
+stressor_info_t stress_zerocopy_info = {
+	.stressor = stress_zerocopy,
+	.class = CLASS_PIPE_IO | CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_zerocopy_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_PIPE_IO | CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help,
+	.unimplemented_reason = "only supported on Linux"
+};
+#endif
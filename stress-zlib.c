@@ -24,16 +24,19 @@
 #include "core-builtin.h"
 #include "core-cpu.h"
 #include "core-killpid.h"
+#include "core-pthread.h"
 #include "core-target-clones.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"zlib N",		"start N workers compressing data with zlib" },
+	{ NULL,	"zlib-codec C",		"specify codec C, zlib, zstd-N, lz4, libdeflate-N or all" },
 	{ NULL,	"zlib-level L",		"specify zlib compression level 0=fast, 9=best" },
 	{ NULL,	"zlib-mem-level L",	"specify zlib compression state memory usage 1=minimum, 9=maximum" },
 	{ NULL,	"zlib-method M",	"specify zlib random data generation method M" },
 	{ NULL,	"zlib-ops N",		"stop after N zlib bogo compression operations" },
 	{ NULL,	"zlib-strategy S",	"specify zlib strategy 0=default, 1=filtered, 2=huffman only, 3=rle, 4=fixed" },
 	{ NULL,	"zlib-stream-bytes S",	"specify the number of bytes to deflate until the current stream will be closed" },
+	{ NULL,	"zlib-threads N",	"compress independent blocks with N threads per worker" },
 	{ NULL,	"zlib-window-bits W",	"specify zlib window bits -8-(-15) | 8-15 | 24-31 | 40-47" },
 	{ NULL,	NULL,			NULL }
 };
@@ -42,6 +45,27 @@ static const stress_help_t help[] = {
 
 #include "zlib.h"
 
+#if defined(HAVE_LIB_ZSTD)
+#include <zstd.h>
+#endif
+#if defined(HAVE_LIB_LZ4)
+#include <lz4.h>
+#endif
+#if defined(HAVE_LIB_DEFLATE)
+#include <libdeflate.h>
+#endif
+
+#if defined(HAVE_LIB_PTHREAD)
+#define HAVE_ZLIB_PIPELINE
+#endif
+
+#define MAX_ZLIB_THREADS	(64)
+#define ZLIB_BLOCKS_PER_THREAD	(4)
+#define ZLIB_BLOCK_SIZE		(KB * 128)	/* Must be a multiple of 64 bytes */
+/* worst case expansion of all the codecs is less than this */
+#define ZLIB_BLOCK_COMP_SIZE	(ZLIB_BLOCK_SIZE + (ZLIB_BLOCK_SIZE / 8) + 1024)
+#define ZLIB_LIBDEFLATE_LEVELS	(13)
+
 #define DATA_SIZE_64K 	(KB * 64)	/* Must be a multiple of 64 bytes */
 #define DATA_SIZE DATA_SIZE_64K
 
@@ -253,17 +277,9 @@ static void stress_rand_data_binary(
 	uint64_t *RESTRICT data,
 	uint64_t *RESTRICT data_end)
 {
-	register uint32_t *ptr = (uint32_t *)data;
-	register const uint32_t *end = (uint32_t *)data_end;
-
 	(void)args;
 
-	while (ptr < end) {
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-		*(ptr++) = stress_mwc32();
-	}
+	stress_mwc_fill(data, (size_t)((uintptr_t)data_end - (uintptr_t)data));
 }
 
 /*
@@ -1419,13 +1435,275 @@ static int stress_set_zlib_strategy(const char *opt)
 	return stress_set_setting("zlib-strategy", TYPE_ID_UINT32, &zlib_strategy);
 }
 
+/*
+ *  per thread codec state, allocated on first use
+ */
+typedef struct {
+#if defined(HAVE_LIB_ZSTD)
+	ZSTD_CCtx *zstd_cctx;
+	ZSTD_DCtx *zstd_dctx;
+#endif
+#if defined(HAVE_LIB_DEFLATE)
+	struct libdeflate_compressor *deflate_c[ZLIB_LIBDEFLATE_LEVELS];
+	struct libdeflate_decompressor *deflate_d;
+#endif
+	int zlib_level;		/* --zlib-level for the zlib codec */
+} stress_zlib_codec_ctx_t;
+
+/*
+ *  compress or decompress src into dst, set *dst_len, returns
+ *  0 on success, -1 on failure
+ */
+typedef int (*stress_zlib_codec_func_t)(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len);
+
+typedef struct {
+	const char *name;			/* codec name */
+	const int level;			/* codec level or acceleration */
+	const stress_zlib_codec_func_t compress;	/* compressor */
+	const stress_zlib_codec_func_t decompress;	/* decompressor */
+} stress_zlib_codec_t;
+
+static int stress_zlib_codec_zlib_compress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	uLongf len = (uLongf)dst_size;
+
+	(void)level;
+
+	if (compress2((Bytef *)dst, &len, (const Bytef *)src, (uLong)src_len, ctx->zlib_level) != Z_OK)
+		return -1;
+	*dst_len = (size_t)len;
+	return 0;
+}
+
+static int stress_zlib_codec_zlib_decompress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	uLongf len = (uLongf)dst_size;
+
+	(void)ctx;
+	(void)level;
+
+	if (uncompress((Bytef *)dst, &len, (const Bytef *)src, (uLong)src_len) != Z_OK)
+		return -1;
+	*dst_len = (size_t)len;
+	return 0;
+}
+
+#if defined(HAVE_LIB_ZSTD)
+static int stress_zlib_codec_zstd_compress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	size_t len;
+
+	if (!ctx->zstd_cctx) {
+		ctx->zstd_cctx = ZSTD_createCCtx();
+		if (!ctx->zstd_cctx)
+			return -1;
+	}
+	len = ZSTD_compressCCtx(ctx->zstd_cctx, dst, dst_size, src, src_len, level);
+	if (ZSTD_isError(len))
+		return -1;
+	*dst_len = len;
+	return 0;
+}
+
+static int stress_zlib_codec_zstd_decompress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	size_t len;
+
+	(void)level;
+
+	if (!ctx->zstd_dctx) {
+		ctx->zstd_dctx = ZSTD_createDCtx();
+		if (!ctx->zstd_dctx)
+			return -1;
+	}
+	len = ZSTD_decompressDCtx(ctx->zstd_dctx, dst, dst_size, src, src_len);
+	if (ZSTD_isError(len))
+		return -1;
+	*dst_len = len;
+	return 0;
+}
+#endif
+
+#if defined(HAVE_LIB_LZ4)
+static int stress_zlib_codec_lz4_compress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	int len;
+
+	(void)ctx;
+
+	len = LZ4_compress_fast((const char *)src, (char *)dst, (int)src_len, (int)dst_size, level);
+	if (len <= 0)
+		return -1;
+	*dst_len = (size_t)len;
+	return 0;
+}
+
+static int stress_zlib_codec_lz4_decompress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	int len;
+
+	(void)ctx;
+	(void)level;
+
+	len = LZ4_decompress_safe((const char *)src, (char *)dst, (int)src_len, (int)dst_size);
+	if (len < 0)
+		return -1;
+	*dst_len = (size_t)len;
+	return 0;
+}
+#endif
+
+#if defined(HAVE_LIB_DEFLATE)
+static int stress_zlib_codec_libdeflate_compress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	size_t len;
+
+	if (!ctx->deflate_c[level]) {
+		ctx->deflate_c[level] = libdeflate_alloc_compressor(level);
+		if (!ctx->deflate_c[level])
+			return -1;
+	}
+	len = libdeflate_deflate_compress(ctx->deflate_c[level], src, src_len, dst, dst_size);
+	if (len == 0)
+		return -1;
+	*dst_len = len;
+	return 0;
+}
+
+static int stress_zlib_codec_libdeflate_decompress(stress_zlib_codec_ctx_t *ctx, const int level,
+	const uint8_t *src, const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len)
+{
+	(void)level;
+
+	if (!ctx->deflate_d) {
+		ctx->deflate_d = libdeflate_alloc_decompressor();
+		if (!ctx->deflate_d)
+			return -1;
+	}
+	if (libdeflate_deflate_decompress(ctx->deflate_d, src, src_len,
+					  dst, dst_size, dst_len) != LIBDEFLATE_SUCCESS)
+		return -1;
+	return 0;
+}
+#endif
+
+/*
+ *  stress_zlib_codec_ctx_free()
+ *	free per thread codec state
+ */
+static void stress_zlib_codec_ctx_free(stress_zlib_codec_ctx_t *ctx)
+{
+#if defined(HAVE_LIB_DEFLATE)
+	size_t i;
+#endif
+
+#if defined(HAVE_LIB_ZSTD)
+	if (ctx->zstd_cctx)
+		(void)ZSTD_freeCCtx(ctx->zstd_cctx);
+	if (ctx->zstd_dctx)
+		(void)ZSTD_freeDCtx(ctx->zstd_dctx);
+#endif
+#if defined(HAVE_LIB_DEFLATE)
+	for (i = 0; i < ZLIB_LIBDEFLATE_LEVELS; i++) {
+		if (ctx->deflate_c[i])
+			libdeflate_free_compressor(ctx->deflate_c[i]);
+	}
+	if (ctx->deflate_d)
+		libdeflate_free_decompressor(ctx->deflate_d);
+#endif
+	(void)shim_memset(ctx, 0, sizeof(*ctx));
+}
+
+/*
+ * Table of codecs for the block pipeline
+ */
+static const stress_zlib_codec_t zlib_codecs[] = {
+	{ "all",		0,	NULL,				NULL },	/* Special "all" codecs */
+	{ "zlib",		0,	stress_zlib_codec_zlib_compress,	stress_zlib_codec_zlib_decompress },
+#if defined(HAVE_LIB_ZSTD)
+	{ "zstd-1",		1,	stress_zlib_codec_zstd_compress,	stress_zlib_codec_zstd_decompress },
+	{ "zstd-3",		3,	stress_zlib_codec_zstd_compress,	stress_zlib_codec_zstd_decompress },
+	{ "zstd-9",		9,	stress_zlib_codec_zstd_compress,	stress_zlib_codec_zstd_decompress },
+	{ "zstd-19",		19,	stress_zlib_codec_zstd_compress,	stress_zlib_codec_zstd_decompress },
+#endif
+#if defined(HAVE_LIB_LZ4)
+	{ "lz4",		1,	stress_zlib_codec_lz4_compress,		stress_zlib_codec_lz4_decompress },
+	{ "lz4-fast",		8,	stress_zlib_codec_lz4_compress,		stress_zlib_codec_lz4_decompress },
+#endif
+#if defined(HAVE_LIB_DEFLATE)
+	{ "libdeflate-1",	1,	stress_zlib_codec_libdeflate_compress,	stress_zlib_codec_libdeflate_decompress },
+	{ "libdeflate-6",	6,	stress_zlib_codec_libdeflate_compress,	stress_zlib_codec_libdeflate_decompress },
+	{ "libdeflate-12",	12,	stress_zlib_codec_libdeflate_compress,	stress_zlib_codec_libdeflate_decompress },
+#endif
+};
+
+/* index of the zlib codec, the default */
+#define ZLIB_CODEC_ZLIB		(1)
+
+/*
+ *  stress_set_zlib_codec()
+ *	set the codec used by the block pipeline
+ */
+static int stress_set_zlib_codec(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(zlib_codecs); i++) {
+		if (!strcmp(zlib_codecs[i].name, opt)) {
+			stress_set_setting("zlib-codec", TYPE_ID_SIZE_T, &i);
+			return 0;
+		}
+	}
+
+	(void)fprintf(stderr, "zlib-codec must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(zlib_codecs); i++) {
+		(void)fprintf(stderr, " %s", zlib_codecs[i].name);
+	}
+	(void)fprintf(stderr, "\n");
+
+	return -1;
+}
+
+/*
+ *  stress_set_zlib_threads
+ *	set the number of block pipeline threads, 0 = use
+ *	the deflate/inflate pipe between two processes
+ */
+static int stress_set_zlib_threads(const char *opt)
+{
+	uint32_t zlib_threads;
+
+	zlib_threads = stress_get_uint32(opt);
+	stress_check_range("zlib-threads", (uint64_t)zlib_threads, 0, MAX_ZLIB_THREADS);
+	return stress_set_setting("zlib-threads", TYPE_ID_UINT32, &zlib_threads);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_zlib_codec,		stress_set_zlib_codec },
 	{ OPT_zlib_level,		stress_set_zlib_level },
 	{ OPT_zlib_mem_level,		stress_set_zlib_mem_level },
 	{ OPT_zlib_method,		stress_set_zlib_method },
 	{ OPT_zlib_window_bits,		stress_set_zlib_window_bits },
 	{ OPT_zlib_stream_bytes,	stress_set_zlib_stream_bytes },
 	{ OPT_zlib_strategy,		stress_set_zlib_strategy },
+	{ OPT_zlib_threads,		stress_set_zlib_threads },
 	{ 0,				NULL }
 };
 
@@ -1781,6 +2059,344 @@ zlib_checksum_error:
 	return ret;
 }
 
+#if defined(HAVE_ZLIB_PIPELINE)
+typedef struct {
+	uint64_t	*data;		/* generated data */
+	uint8_t		*comp;		/* compressed data */
+	uint8_t		*decomp;	/* decompressed data */
+	size_t		comp_len;	/* compressed size */
+	bool		failed;		/* codec failure */
+} stress_zlib_block_t;
+
+typedef struct {
+	pthread_mutex_t		lock;		/* protects the fields below */
+	pthread_cond_t		start;		/* new phase for the threads */
+	pthread_cond_t		done;		/* all threads completed the phase */
+	uint64_t		generation;	/* phase number */
+	size_t			remaining;	/* threads still busy */
+	size_t			next;		/* next block to process */
+	size_t			codec;		/* codec of the phase */
+	bool			decompress;	/* decompress or compress phase */
+	bool			stop;		/* threads should exit */
+	size_t			n_blocks;	/* number of blocks */
+	stress_zlib_block_t	*blocks;	/* blocks to process */
+} stress_zlib_pipeline_t;
+
+typedef struct {
+	stress_zlib_pipeline_t	*pipeline;	/* shared pipeline state */
+	pthread_t		pthread;	/* thread handle */
+	int			ret;		/* pthread_create return */
+	stress_zlib_codec_ctx_t	ctx;		/* codec state */
+} stress_zlib_thread_t;
+
+typedef struct {
+	double		bytes;		/* uncompressed bytes */
+	double		comp_bytes;	/* compressed bytes */
+	double		comp_time;	/* compress phase wall clock time */
+	double		decomp_time;	/* decompress phase wall clock time */
+} stress_zlib_stats_t;
+
+/*
+ *  stress_zlib_pipeline_thread()
+ *	compress or decompress blocks until there are none left
+ *	in the current phase
+ */
+static void *stress_zlib_pipeline_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_zlib_thread_t *thread = (stress_zlib_thread_t *)arg;
+	stress_zlib_pipeline_t *pipeline = thread->pipeline;
+	uint64_t generation = 0;
+	sigset_t set;
+
+	/*
+	 *  Block all signals, let controlling thread
+	 *  handle these
+	 */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	for (;;) {
+		const stress_zlib_codec_t *codec;
+		bool decompress;
+
+		(void)pthread_mutex_lock(&pipeline->lock);
+		while (!pipeline->stop && (pipeline->generation == generation))
+			(void)pthread_cond_wait(&pipeline->start, &pipeline->lock);
+		if (pipeline->stop) {
+			(void)pthread_mutex_unlock(&pipeline->lock);
+			break;
+		}
+		generation = pipeline->generation;
+		codec = &zlib_codecs[pipeline->codec];
+		decompress = pipeline->decompress;
+		(void)pthread_mutex_unlock(&pipeline->lock);
+
+		for (;;) {
+			stress_zlib_block_t *block;
+			size_t idx, len;
+
+			(void)pthread_mutex_lock(&pipeline->lock);
+			idx = pipeline->next++;
+			(void)pthread_mutex_unlock(&pipeline->lock);
+			if (idx >= pipeline->n_blocks)
+				break;
+
+			block = &pipeline->blocks[idx];
+			if (decompress) {
+				if (block->failed)
+					continue;
+				if ((codec->decompress(&thread->ctx, codec->level,
+						block->comp, block->comp_len,
+						block->decomp, ZLIB_BLOCK_SIZE, &len) < 0) ||
+				    (len != ZLIB_BLOCK_SIZE))
+					block->failed = true;
+			} else {
+				block->failed = (codec->compress(&thread->ctx, codec->level,
+						(const uint8_t *)block->data, ZLIB_BLOCK_SIZE,
+						block->comp, ZLIB_BLOCK_COMP_SIZE, &len) < 0);
+				block->comp_len = block->failed ? 0 : len;
+			}
+		}
+
+		(void)pthread_mutex_lock(&pipeline->lock);
+		pipeline->remaining--;
+		if (pipeline->remaining == 0)
+			(void)pthread_cond_signal(&pipeline->done);
+		(void)pthread_mutex_unlock(&pipeline->lock);
+	}
+	stress_zlib_codec_ctx_free(&thread->ctx);
+
+	return &nowt;
+}
+
+/*
+ *  stress_zlib_pipeline_phase()
+ *	run a compress or decompress phase across all the threads,
+ *	returns the wall clock time of the phase
+ */
+static double stress_zlib_pipeline_phase(
+	stress_zlib_pipeline_t *pipeline,
+	const size_t n_threads,
+	const size_t codec,
+	const bool decompress)
+{
+	const double t = stress_time_now();
+
+	(void)pthread_mutex_lock(&pipeline->lock);
+	pipeline->codec = codec;
+	pipeline->decompress = decompress;
+	pipeline->next = 0;
+	pipeline->remaining = n_threads;
+	pipeline->generation++;
+	(void)pthread_cond_broadcast(&pipeline->start);
+	while (pipeline->remaining > 0)
+		(void)pthread_cond_wait(&pipeline->done, &pipeline->lock);
+	(void)pthread_mutex_unlock(&pipeline->lock);
+
+	return stress_time_now() - t;
+}
+
+/*
+ *  stress_zlib_pipeline()
+ *	fill blocks with generated data and have n_threads threads
+ *	compress and then decompress the independent blocks
+ */
+static int stress_zlib_pipeline(stress_args_t *args, const size_t n_threads)
+{
+	const size_t n_blocks = n_threads * ZLIB_BLOCKS_PER_THREAD;
+	const size_t n_codecs = SIZEOF_ARRAY(zlib_codecs);
+	const size_t n_methods = SIZEOF_ARRAY(zlib_rand_data_methods);
+	const size_t block_mmap_size = ZLIB_BLOCK_SIZE * 2 + ZLIB_BLOCK_COMP_SIZE;
+	const size_t mmap_size = n_blocks * block_mmap_size;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	stress_zlib_pipeline_t pipeline;
+	stress_zlib_thread_t *threads;
+	stress_zlib_stats_t *stats;
+	size_t i, j, codec, zlib_codec = ZLIB_CODEC_ZLIB;
+	size_t zlib_method = 0, started = 0, metric = 0;
+	uint32_t zlib_level = Z_BEST_COMPRESSION;
+	uint8_t *buf;
+	bool dumped_heading = false;
+	int ret = EXIT_NO_RESOURCE;
+
+	(void)stress_get_setting("zlib-codec", &zlib_codec);
+	(void)stress_get_setting("zlib-method", &zlib_method);
+	(void)stress_get_setting("zlib-level", &zlib_level);
+	codec = (zlib_codec == 0) ? ZLIB_CODEC_ZLIB : zlib_codec;
+
+	stats = (stress_zlib_stats_t *)calloc(n_codecs * n_methods, sizeof(*stats));
+	if (!stats) {
+		pr_inf_skip("%s: failed to allocate statistics, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	threads = (stress_zlib_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: failed to allocate %zu threads, skipping stressor\n",
+			args->name, n_threads);
+		goto tidy_stats;
+	}
+	pipeline.blocks = (stress_zlib_block_t *)calloc(n_blocks, sizeof(*pipeline.blocks));
+	if (!pipeline.blocks) {
+		pr_inf_skip("%s: failed to allocate %zu blocks, skipping stressor\n",
+			args->name, n_blocks);
+		goto tidy_threads_alloc;
+	}
+	buf = (uint8_t *)stress_mmap_populate(NULL, mmap_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, mmap_size, errno, strerror(errno));
+		goto tidy_blocks;
+	}
+	for (i = 0; i < n_blocks; i++) {
+		uint8_t *ptr = buf + (i * block_mmap_size);
+
+		pipeline.blocks[i].data = (uint64_t *)ptr;
+		pipeline.blocks[i].decomp = ptr + ZLIB_BLOCK_SIZE;
+		pipeline.blocks[i].comp = ptr + (ZLIB_BLOCK_SIZE * 2);
+	}
+	pipeline.n_blocks = n_blocks;
+	pipeline.generation = 0;
+	pipeline.stop = false;
+	(void)pthread_mutex_init(&pipeline.lock, NULL);
+	(void)pthread_cond_init(&pipeline.start, NULL);
+	(void)pthread_cond_init(&pipeline.done, NULL);
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].pipeline = &pipeline;
+		threads[i].ctx.zlib_level = (int)zlib_level;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+			stress_zlib_pipeline_thread, (void *)&threads[i]);
+		if (threads[i].ret) {
+			pr_inf_skip("%s: pthread_create failed, errno=%d (%s), skipping stressor\n",
+				args->name, threads[i].ret, strerror(threads[i].ret));
+			goto tidy_threads;
+		}
+		started++;
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: %zu threads compressing %zu blocks of %zu bytes per round\n",
+			args->name, n_threads, n_blocks, (size_t)ZLIB_BLOCK_SIZE);
+
+	ret = EXIT_SUCCESS;
+	do {
+		size_t method = zlib_method;
+		stress_zlib_stats_t *stat;
+		double comp_bytes = 0.0;
+
+		/* one generator per round so stats are per generator */
+		if (method == 0)
+			method = stress_mwc32modn((uint32_t)n_methods - 1) + 1;
+		for (i = 0; i < n_blocks; i++) {
+			uint64_t *data = pipeline.blocks[i].data;
+
+			zlib_rand_data_methods[method].func(args, data,
+				data + (ZLIB_BLOCK_SIZE / sizeof(*data)));
+		}
+
+		stat = &stats[(codec * n_methods) + method];
+		stat->comp_time += stress_zlib_pipeline_phase(&pipeline, n_threads, codec, false);
+		stat->decomp_time += stress_zlib_pipeline_phase(&pipeline, n_threads, codec, true);
+
+		for (i = 0; i < n_blocks; i++) {
+			const stress_zlib_block_t *block = &pipeline.blocks[i];
+
+			if (block->failed) {
+				pr_fail("%s: %s failed to compress or decompress %s data\n",
+					args->name, zlib_codecs[codec].name,
+					zlib_rand_data_methods[method].name);
+				ret = EXIT_FAILURE;
+				break;
+			}
+			if (verify && shim_memcmp(block->data, block->decomp, ZLIB_BLOCK_SIZE)) {
+				pr_fail("%s: %s decompressed %s data differs from the original data\n",
+					args->name, zlib_codecs[codec].name,
+					zlib_rand_data_methods[method].name);
+				ret = EXIT_FAILURE;
+				break;
+			}
+			comp_bytes += (double)block->comp_len;
+		}
+		if (ret != EXIT_SUCCESS)
+			break;
+		stat->bytes += (double)(n_blocks * ZLIB_BLOCK_SIZE);
+		stat->comp_bytes += comp_bytes;
+		stress_bogo_add(args, (uint64_t)n_blocks);
+
+		if (zlib_codec == 0) {
+			codec++;
+			if (codec >= n_codecs)
+				codec = 1;
+		}
+	} while (stress_continue(args));
+
+	/* per codec metrics, per codec and generator table */
+	for (i = 1; i < n_codecs; i++) {
+		stress_zlib_stats_t total;
+		char msg[64];
+
+		(void)shim_memset(&total, 0, sizeof(total));
+		for (j = 1; j < n_methods; j++) {
+			const stress_zlib_stats_t *stat = &stats[(i * n_methods) + j];
+
+			if ((stat->bytes <= 0.0) || (stat->comp_time <= 0.0) ||
+			    (stat->decomp_time <= 0.0) || (stat->comp_bytes <= 0.0))
+				continue;
+			total.bytes += stat->bytes;
+			total.comp_bytes += stat->comp_bytes;
+			total.comp_time += stat->comp_time;
+			total.decomp_time += stat->decomp_time;
+
+			if (args->instance != 0)
+				continue;
+			if (!dumped_heading) {
+				dumped_heading = true;
+				pr_inf("%s: %-14s %-12s %11s %11s %7s\n", args->name,
+					"codec", "data", "comp MB/s", "decomp MB/s", "ratio");
+			}
+			pr_inf("%s: %-14s %-12s %11.2f %11.2f %7.3f\n", args->name,
+				zlib_codecs[i].name, zlib_rand_data_methods[j].name,
+				stat->bytes / (stat->comp_time * MB),
+				stat->bytes / (stat->decomp_time * MB),
+				stat->bytes / stat->comp_bytes);
+		}
+		if (total.bytes <= 0.0)
+			continue;
+		(void)snprintf(msg, sizeof(msg), "%s compress MB per sec", zlib_codecs[i].name);
+		stress_metrics_set(args, metric++, msg,
+			total.bytes / (total.comp_time * MB), STRESS_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s decompress MB per sec", zlib_codecs[i].name);
+		stress_metrics_set(args, metric++, msg,
+			total.bytes / (total.decomp_time * MB), STRESS_HARMONIC_MEAN);
+		(void)snprintf(msg, sizeof(msg), "%s compression ratio", zlib_codecs[i].name);
+		stress_metrics_set(args, metric++, msg,
+			total.bytes / total.comp_bytes, STRESS_GEOMETRIC_MEAN);
+	}
+
+tidy_threads:
+	(void)pthread_mutex_lock(&pipeline.lock);
+	pipeline.stop = true;
+	(void)pthread_cond_broadcast(&pipeline.start);
+	(void)pthread_mutex_unlock(&pipeline.lock);
+	for (i = 0; i < started; i++)
+		(void)pthread_join(threads[i].pthread, NULL);
+	(void)pthread_cond_destroy(&pipeline.done);
+	(void)pthread_cond_destroy(&pipeline.start);
+	(void)pthread_mutex_destroy(&pipeline.lock);
+	(void)munmap((void *)buf, mmap_size);
+tidy_blocks:
+	free(pipeline.blocks);
+tidy_threads_alloc:
+	free(threads);
+tidy_stats:
+	free(stats);
+
+	return ret;
+}
+#endif
+
 /*
  *  stress_zlib()
  *	stress cpu with compression and decompression
@@ -1792,9 +2408,28 @@ static int stress_zlib(stress_args_t *args)
 	bool error = false;
 	bool interrupted = false;
 	stress_zlib_shared_checksums_t *shared_checksums;
+	size_t zlib_codec = ZLIB_CODEC_ZLIB;
+	uint32_t zlib_threads = 0;
 
 	stress_catch_sigill();
 
+	(void)stress_get_setting("zlib-codec", &zlib_codec);
+	(void)stress_get_setting("zlib-threads", &zlib_threads);
+	if ((zlib_threads > 0) || (zlib_codec != ZLIB_CODEC_ZLIB)) {
+#if defined(HAVE_ZLIB_PIPELINE)
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		ret = stress_zlib_pipeline(args, zlib_threads > 0 ? (size_t)zlib_threads : 1);
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf_skip("%s: pthreads not supported, cannot use "
+				"--zlib-codec or --zlib-threads, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+#endif
+	}
+
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#define EIGEN_SUPPORTED
+
+#if !defined(__GNUC__)
+#error "only g++ supported"
+#undef EIGEN_SUPPORTED
+#endif
+
+#if defined(__clang__)
+#error "clang not supported"
+#undef EIGEN_SUPPORTED
+#endif
+
+#if !defined(_OPENMP)
+#error "OpenMP not enabled"
+#undef EIGEN_SUPPORTED
+#endif
+
+#if defined(EIGEN_SUPPORTED)
+
+#include <omp.h>
+#include <eigen3/Eigen/Dense>
+using namespace Eigen;
+
+extern "C" {
+
+int main(void)
+{
+	typedef Matrix < double, Dynamic, Dynamic > matrix;
+	matrix a, b, result;
+
+	Eigen::setNbThreads(omp_get_max_threads());
+	a = matrix::Random(64, 64);
+	b = matrix::Random(64, 64);
+	result = a * b;
+
+	return (Eigen::nbThreads() > 0) && (result.norm() > 0.0) ? 0 : 1;
+}
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2024      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <libdeflate.h>
+#include <string.h>
+
+int main(void)
+{
+	static const char buffer[] = "test123test123test123";
+	char cbuf[256], dbuf[256];
+	struct libdeflate_compressor *c;
+	struct libdeflate_decompressor *d;
+	size_t clen, dlen = 0;
+
+	c = libdeflate_alloc_compressor(6);
+	d = libdeflate_alloc_decompressor();
+	clen = libdeflate_deflate_compress(c, buffer, sizeof(buffer), cbuf, sizeof(cbuf));
+	(void)libdeflate_deflate_decompress(d, cbuf, clen, dbuf, sizeof(dbuf), &dlen);
+	libdeflate_free_decompressor(d);
+	libdeflate_free_compressor(c);
+
+	return (int)dlen;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2024      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <stdint.h>
+#include <intel-ipsec-mb.h>
+
+/*
+ *  The burst API macros call through IMB_MGR function pointers,
+ *  so check the macros, the manager members they use and the
+ *  library symbols all agree rather than just the header
+ */
+#if !defined(IMB_GET_NEXT_BURST) ||	\
+    !defined(IMB_SUBMIT_BURST) ||	\
+    !defined(IMB_FLUSH_BURST)
+#error no IPSec MB burst API
+#endif
+
+#if defined(IMB_MAX_BURST_SIZE)
+#define BURST_MAX	(IMB_MAX_BURST_SIZE)
+#else
+#define BURST_MAX	(128)
+#endif
+
+int main(void)
+{
+	IMB_MGR *mb_mgr;
+	IMB_JOB *jobs[BURST_MAX];
+	uint32_t n;
+
+	mb_mgr = alloc_mb_mgr(0);
+	if (!mb_mgr)
+		return 1;
+	init_mb_mgr_sse(mb_mgr);
+	n = IMB_GET_NEXT_BURST(mb_mgr, 1, jobs);
+	n += IMB_SUBMIT_BURST(mb_mgr, 0, jobs);
+	n += IMB_FLUSH_BURST(mb_mgr, BURST_MAX, jobs);
+	free_mb_mgr(mb_mgr);
+
+	return (int)n;
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2024      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <lz4.h>
+#include <string.h>
+
+int main(void)
+{
+	static const char buffer[] = "test123test123test123";
+	char cbuf[256], dbuf[256];
+	int clen;
+
+	clen = LZ4_compress_default(buffer, cbuf, (int)sizeof(buffer), (int)sizeof(cbuf));
+	return LZ4_decompress_safe(cbuf, dbuf, clen, (int)sizeof(dbuf));
+}
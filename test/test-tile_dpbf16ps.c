@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <immintrin.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef struct {
+	uint8_t palette_id;
+	uint8_t start_row;
+	uint8_t reserved[14];
+	uint16_t colsb[16];
+	uint8_t rows[16];
+} tile_config_t;
+
+static uint8_t a[1024], b[1024];
+static uint32_t c[256];
+
+int __attribute__ ((target("amx-tile,amx-bf16"))) main(int argc, char **argv)
+{
+	tile_config_t cfg;
+	int i;
+
+	(void)memset(&cfg, 0, sizeof(cfg));
+	cfg.palette_id = 1;
+	for (i = 0; i < 3; i++) {
+		cfg.colsb[i] = 64;
+		cfg.rows[i] = 16;
+	}
+	_tile_loadconfig(&cfg);
+	_tile_loadd(0, c, 64);
+	_tile_loadd(1, a, 64);
+	_tile_loadd(2, b, 64);
+	_tile_dpbf16ps(0, 1, 2);
+	_tile_stored(0, c, 64);
+	_tile_release();
+
+	return (int)c[argc];
+}